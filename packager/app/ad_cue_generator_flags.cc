@@ -17,3 +17,10 @@ DEFINE_string(ad_cues,
               "{start_time}[,{duration}][;{start_time}[,{duration}]]..."
               "The start_time represents the start of the cue marker in "
               "seconds relative to the start of the program.");
+DEFINE_uint64(ad_cue_max_buffered_bytes,
+              16 * 1024 * 1024,
+              "Max size in bytes of the samples of a stream buffered while "
+              "waiting for the other streams to reach the next cue. When it is "
+              "reached, the cue is promoted early at its start time instead of "
+              "at the next video key frame. 0 means no limit other than the "
+              "number of samples.");
@@ -10,5 +10,6 @@
 #include <gflags/gflags.h>
 
 DECLARE_string(ad_cues);
+DECLARE_uint64(ad_cue_max_buffered_bytes);
 
 #endif  // PACKAGER_APP_AD_CUE_GENERATOR_FLAGS_H_
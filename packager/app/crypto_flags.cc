@@ -27,9 +27,42 @@ DEFINE_int32(
     "Apply to video streams with 'cbcs' and 'cens' protection schemes only; "
     "ignored otherwise.");
 DEFINE_bool(vp9_subsample_encryption, true, "Enable VP9 subsample encryption.");
+DEFINE_uint64(parallel_encryption_window,
+              0,
+              "Maximum number of samples of a stream encrypted concurrently "
+              "on the threads shared by all the streams, see "
+              "--task_executor_threads. The samples are still output in "
+              "order. 0 or 1 disables parallel encryption.");
+DEFINE_string(crypto_backend,
+              "",
+              "Name of the backend the parallel encryption is offloaded to, "
+              "e.g. a registered crypto accelerator. Default is 'software', "
+              "which encrypts on the threads shared by all the streams.");
 DEFINE_string(playready_extra_header_data,
               "",
               "Extra XML data to add to PlayReady headers.");
+DEFINE_string(key_cache_dir,
+              "",
+              "Directory to cache the keys from the Widevine or PlayReady key "
+              "server in, so repackaging the same content does not request "
+              "the keys again. Requires --key_cache_wrapping_key.");
+DEFINE_hex_bytes(key_cache_wrapping_key,
+                 "",
+                 "16, 24 or 32 bytes AES key in hex string, used to encrypt "
+                 "the cached keys.");
+DEFINE_uint64(key_cache_ttl,
+              86400,
+              "Time to live of the cached keys in seconds.");
+DEFINE_bool(key_cache_shared,
+            false,
+            "Whether --key_cache_dir is shared by several packagers, e.g. a "
+            "s3:// or gs:// bucket. The cache is then reloaded on a miss "
+            "and saved as soon as a key is fetched.");
+DEFINE_double(key_fetch_timeout,
+              0,
+              "Maximum time in seconds to wait for the keys from the key "
+              "server at startup. The keys are fetched while the rest of "
+              "the packager is set up. 0 waits indefinitely.");
 
 bool ValueNotGreaterThanTen(const char* flagname, int32_t value) {
   if (value > 10) {
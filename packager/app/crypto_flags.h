@@ -12,10 +12,19 @@
 
 #include <gflags/gflags.h>
 
+#include "packager/app/gflags_hex_bytes.h"
+
 DECLARE_string(protection_scheme);
 DECLARE_int32(crypt_byte_block);
 DECLARE_int32(skip_byte_block);
 DECLARE_bool(vp9_subsample_encryption);
+DECLARE_uint64(parallel_encryption_window);
+DECLARE_string(crypto_backend);
 DECLARE_string(playready_extra_header_data);
+DECLARE_string(key_cache_dir);
+DECLARE_hex_bytes(key_cache_wrapping_key);
+DECLARE_uint64(key_cache_ttl);
+DECLARE_bool(key_cache_shared);
+DECLARE_double(key_fetch_timeout);
 
 #endif  // PACKAGER_APP_CRYPTO_FLAGS_H_
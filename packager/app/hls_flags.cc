@@ -30,3 +30,16 @@ DEFINE_int32(hls_media_sequence_number,
               "EXT-X-MEDIA-SEQUENCE value, which allows continuous media "
               "sequence across packager restarts. See #691 for more "
               "information about the reasoning of this and its use cases.");
+DEFINE_double(hls_skip_boundary,
+              0,
+              "If positive, LIVE and EVENT playlists advertise Playlist Delta "
+              "Updates (CAN-SKIP-UNTIL) with this skip boundary, in seconds, "
+              "and a delta playlist is written next to each media playlist, "
+              "with '_delta' inserted before the extension. It is raised to "
+              "six target durations if shorter.");
+DEFINE_bool(hls_program_date_time,
+            false,
+            "Tag the segments of the media playlists with "
+            "EXT-X-PROGRAM-DATE-TIME, the wall clock time at which their "
+            "content was packaged, anchored when the first segment of each "
+            "playlist is added.");
@@ -14,5 +14,7 @@ DECLARE_string(hls_base_url);
 DECLARE_string(hls_key_uri);
 DECLARE_string(hls_playlist_type);
 DECLARE_int32(hls_media_sequence_number);
+DECLARE_double(hls_skip_boundary);
+DECLARE_bool(hls_program_date_time);
 
 #endif  // PACKAGER_APP_HLS_FLAGS_H_
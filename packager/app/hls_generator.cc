@@ -0,0 +1,215 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+#include "packager/app/hls_generator_flags.h"
+#include "packager/app/manifest_generator_util.h"
+#include "packager/app/vlog_flags.h"
+#include "packager/base/at_exit.h"
+#include "packager/base/command_line.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/hls/public/hls_params.h"
+#include "packager/hls/util/hls_writer.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/tools/license_notice.h"
+#include "packager/version/version.h"
+
+#if defined(OS_WIN)
+#include <codecvt>
+#include <functional>
+#include <locale>
+#endif  // defined(OS_WIN)
+
+DEFINE_bool(licenses, false, "Dump licenses.");
+DEFINE_string(test_packager_version,
+              "",
+              "Packager version for testing. Should be used for testing only.");
+
+namespace shaka {
+namespace {
+const char kUsage[] =
+    "HLS playlist generation driver program.\n"
+    "This program accepts MediaInfo files in human readable text format and "
+    "outputs an HLS master playlist and its media playlists, without the "
+    "media, e.g. to change the base URL, the key URI or the playlist type of "
+    "packaged content.\n"
+    "The MediaInfo files must record the segments of the streams, i.e. be "
+    "dumped from outputs with a segment template. The MediaInfo files of the "
+    "time shards of the streams, see --vod_time_shards, are merged.\n"
+    "Sample Usage:\n"
+    "%s --input=\"video1.media_info,video2.media_info,audio1.media_info\" "
+    "--output=\"master.m3u8\" --hls_base_url=\"https://cdn.example.com/\"\n"
+    "Many master playlists can be generated at once, in parallel, with "
+    "--batch.";
+
+enum ExitStatus {
+  kSuccess = 0,
+  kEmptyInputError,
+  kEmptyOutputError,
+  kFailedToWriteHlsPlaylistsError,
+  kInvalidBatchError,
+  kInvalidPlaylistTypeError
+};
+
+bool GetHlsPlaylistType(const std::string& playlist_type,
+                        HlsPlaylistType* playlist_type_enum) {
+  if (base::ToUpperASCII(playlist_type) == "VOD") {
+    *playlist_type_enum = HlsPlaylistType::kVod;
+  } else if (base::ToUpperASCII(playlist_type) == "LIVE") {
+    *playlist_type_enum = HlsPlaylistType::kLive;
+  } else if (base::ToUpperASCII(playlist_type) == "EVENT") {
+    *playlist_type_enum = HlsPlaylistType::kEvent;
+  } else {
+    LOG(ERROR) << "Unrecognized playlist type " << playlist_type;
+    return false;
+  }
+  return true;
+}
+
+ExitStatus CheckRequiredFlags() {
+  if (!FLAGS_batch.empty()) {
+    if (!FLAGS_input.empty() || !FLAGS_output.empty()) {
+      LOG(ERROR) << "--batch cannot be used with --input or --output.";
+      return kInvalidBatchError;
+    }
+    return kSuccess;
+  }
+
+  if (FLAGS_input.empty()) {
+    LOG(ERROR) << "--input is required.";
+    return kEmptyInputError;
+  }
+
+  if (FLAGS_output.empty()) {
+    LOG(ERROR) << "--output is required.";
+    return kEmptyOutputError;
+  }
+
+  return kSuccess;
+}
+
+ExitStatus RunHlsGenerator() {
+  DCHECK_EQ(CheckRequiredFlags(), kSuccess);
+
+  HlsParams hls_params;
+  if (!GetHlsPlaylistType(FLAGS_hls_playlist_type, &hls_params.playlist_type))
+    return kInvalidPlaylistTypeError;
+  hls_params.base_url = FLAGS_hls_base_url;
+  hls_params.key_uri = FLAGS_hls_key_uri;
+
+  std::vector<ManifestJob> jobs;
+  if (!FLAGS_batch.empty()) {
+    if (!ReadBatchFile(FLAGS_batch, &jobs))
+      return kInvalidBatchError;
+  } else {
+    ManifestJob job;
+    job.output = FLAGS_output;
+    job.input_files = base::SplitString(FLAGS_input, ",", base::KEEP_WHITESPACE,
+                                        base::SPLIT_WANT_ALL);
+    jobs.push_back(job);
+  }
+
+  const size_t num_threads = GetNumWorkerThreads(FLAGS_num_worker_threads);
+  // The threads left over when there are fewer master playlists than threads
+  // read the MediaInfo files of each master playlist in parallel.
+  const size_t num_threads_per_job = std::max<size_t>(
+      1, num_threads / std::min(num_threads, jobs.size()));
+
+  // Not std::vector<bool>, which cannot be written concurrently.
+  std::vector<char> job_succeeded(jobs.size(), false);
+  ParallelRunner job_runner(jobs.size(), [&](size_t job_index) {
+    const ManifestJob& job = jobs[job_index];
+    std::vector<std::unique_ptr<MediaInfo>> media_infos;
+    ReadMediaInfoFiles(job.input_files, num_threads_per_job, &media_infos);
+
+    hls::HlsWriter hls_writer;
+    for (const auto& media_info : media_infos) {
+      if (media_info)
+        hls_writer.AddMediaInfo(*media_info);
+    }
+    HlsParams job_hls_params = hls_params;
+    job_hls_params.master_playlist_output = job.output;
+    if (!hls_writer.WriteToFile(job_hls_params)) {
+      LOG(ERROR) << "Failed to write HLS playlists to " << job.output;
+      return;
+    }
+    job_succeeded[job_index] = true;
+  });
+  job_runner.RunOnThreads(num_threads);
+
+  for (char succeeded : job_succeeded) {
+    if (!succeeded)
+      return kFailedToWriteHlsPlaylistsError;
+  }
+  return kSuccess;
+}
+
+int HlsMain(int argc, char** argv) {
+  base::AtExitManager exit;
+  // Needed to enable VLOG/DVLOG through --vmodule or --v.
+  base::CommandLine::Init(argc, argv);
+
+  // Set up logging.
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LOG_TO_SYSTEM_DEBUG_LOG;
+  CHECK(logging::InitLogging(log_settings));
+
+  google::SetVersionString(GetPackagerVersion());
+  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0]));
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_licenses) {
+    for (const char* line : kLicenseNotice)
+      std::cout << line << std::endl;
+    return kSuccess;
+  }
+
+  ExitStatus status = CheckRequiredFlags();
+  if (status != kSuccess) {
+    google::ShowUsageWithFlags("Usage");
+    return status;
+  }
+
+  if (!FLAGS_test_packager_version.empty())
+    SetPackagerVersionForTesting(FLAGS_test_packager_version);
+
+  return RunHlsGenerator();
+}
+
+}  // namespace
+}  // namespace shaka
+
+#if defined(OS_WIN)
+// Windows wmain, which converts wide character arguments to UTF-8.
+int wmain(int argc, wchar_t* argv[], wchar_t* envp[]) {
+  std::unique_ptr<char* [], std::function<void(char**)>> utf8_argv(
+      new char*[argc], [argc](char** utf8_args) {
+        // TODO(tinskip): This leaks, but if this code is enabled, it crashes.
+        // Figure out why. I suspect gflags does something funny with the
+        // argument array.
+        // for (int idx = 0; idx < argc; ++idx)
+        //   delete[] utf8_args[idx];
+        delete[] utf8_args;
+      });
+  std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+  for (int idx = 0; idx < argc; ++idx) {
+    std::string utf8_arg(converter.to_bytes(argv[idx]));
+    utf8_arg += '\0';
+    utf8_argv[idx] = new char[utf8_arg.size()];
+    memcpy(utf8_argv[idx], &utf8_arg[0], utf8_arg.size());
+  }
+  return shaka::HlsMain(argc, utf8_argv.get());
+}
+#else
+int main(int argc, char** argv) {
+  return shaka::HlsMain(argc, argv);
+}
+#endif  // !defined(OS_WIN)
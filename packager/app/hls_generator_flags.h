@@ -0,0 +1,42 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef APP_HLS_GENERATOR_FLAGS_H_
+#define APP_HLS_GENERATOR_FLAGS_H_
+
+#include <gflags/gflags.h>
+
+DEFINE_string(input, "", "Comma separated list of MediaInfo input files.");
+DEFINE_string(output,
+              "",
+              "HLS master playlist output file name. The media playlists are "
+              "written next to it.");
+DEFINE_string(batch,
+              "",
+              "File listing the master playlists to generate, instead of "
+              "--input and --output. Each line has the master playlist output "
+              "file name, whitespace, and the comma separated list of "
+              "MediaInfo input files. Empty lines and lines starting with '#' "
+              "are ignored.");
+DEFINE_int32(num_worker_threads,
+             0,
+             "Number of threads reading the MediaInfo files and writing the "
+             "playlists. 0 uses the number of hardware threads.");
+DEFINE_string(hls_base_url,
+              "",
+              "The base URL of the HLS media playlists and segments. They are "
+              "relative to the master playlist if it is empty.");
+DEFINE_string(hls_key_uri,
+              "",
+              "The key uri for 'identity' and 'com.apple.streamingkeydelivery' "
+              "key formats. Ignored if the playlist is not encrypted or not "
+              "using the above key formats.");
+DEFINE_string(hls_playlist_type,
+              "VOD",
+              "VOD, EVENT, or LIVE. This defines the EXT-X-PLAYLIST-TYPE in "
+              "the HLS specification. For hls_playlist_type of LIVE, "
+              "EXT-X-PLAYLIST-TYPE tag is omitted.");
+#endif  // APP_HLS_GENERATOR_FLAGS_H_
@@ -0,0 +1,356 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/incremental_packaging.h"
+
+#include <set>
+#include <utility>
+
+#include "packager/app/packager_util.h"
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/base/logging.h"
+#include "packager/base/sha1.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/file/file.h"
+#include "packager/hls/base/hls_notifier.h"
+#include "packager/hls/util/hls_writer.h"
+#include "packager/media/event/muxer_listener_factory.h"
+#include "packager/media/event/vod_media_info_dump_muxer_listener.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/base/mpd_notifier.h"
+#include "packager/mpd/util/mpd_writer.h"
+#include "packager/packager.h"
+#include "packager/version/version.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kFingerprintSuffix[] = ".fingerprint";
+const char kMediaInfoSuffix[] = ".media_info";
+const char kLocalFilePrefix[] = "file://";
+
+// The fingerprint is the SHA-1 digest of a description of the output, with a
+// field per line.
+void Append(const char* name, const std::string& value, std::string* out) {
+  base::StringAppendF(out, "%s=%s\n", name, value.c_str());
+}
+
+void Append(const char* name, double value, std::string* out) {
+  base::StringAppendF(out, "%s=%.17g\n", name, value);
+}
+
+void Append(const char* name,
+            const std::vector<uint8_t>& value,
+            std::string* out) {
+  Append(name, value.empty() ? "" : base::HexEncode(value.data(), value.size()),
+         out);
+}
+
+void AppendRawKeys(const char* name,
+                   const RawKeyParams& raw_key,
+                   std::string* out) {
+  // The key IDs identify the keys, which are not part of the fingerprint.
+  for (const auto& entry : raw_key.key_map) {
+    Append(name, entry.first, out);
+    Append("key_id", entry.second.key_id, out);
+    Append("key_iv", entry.second.iv, out);
+  }
+}
+
+// Get the size and the modification time of a local file, which identify the
+// version of the input.
+bool GetInputIdentity(const std::string& input, std::string* out) {
+  std::string path = input;
+  if (base::StartsWith(path, kLocalFilePrefix, base::CompareCase::SENSITIVE))
+    path = path.substr(sizeof(kLocalFilePrefix) - 1);
+  base::File::Info info;
+  if (!base::GetFileInfo(base::FilePath::FromUTF8Unsafe(path), &info))
+    return false;
+  Append("input", input, out);
+  Append("input_size", static_cast<double>(info.size), out);
+  Append("input_modification_time",
+         static_cast<double>(info.last_modified.ToInternalValue()), out);
+  return true;
+}
+
+// Set the manifest options of |stream| in |media_info|, which may have
+// changed since the output was packaged.
+void SetManifestOptions(const StreamDescriptor& stream,
+                        MediaInfo* media_info) {
+  media_info->clear_dash_roles();
+  for (const std::string& role : stream.dash_roles)
+    media_info->add_dash_roles(role);
+  media_info->clear_dash_accessibilities();
+  for (const std::string& accessibility : stream.dash_accessiblities)
+    media_info->add_dash_accessibilities(accessibility);
+  media_info->clear_hls_characteristics();
+  for (const std::string& characteristic : stream.hls_characteristics)
+    media_info->add_hls_characteristics(characteristic);
+  media_info->set_hls_playlist_name(stream.hls_playlist_name);
+  media_info->set_hls_name(stream.hls_name);
+  media_info->set_hls_group_id(stream.hls_group_id);
+}
+
+Status AddToMpd(const MediaInfo& media_info, MpdNotifier* mpd_notifier) {
+  MediaInfo container_media_info = media_info;
+  container_media_info.clear_segments();
+  uint32_t container_id = 0;
+  if (!mpd_notifier->NotifyNewContainer(container_media_info, &container_id))
+    return Status(error::INTERNAL_ERROR, "Failed to add a reused output.");
+  for (const MediaInfo::Segment& segment : media_info.segments()) {
+    if (!mpd_notifier->NotifyNewSegment(container_id, segment.start_time(),
+                                        segment.duration(), segment.size())) {
+      return Status(error::INTERNAL_ERROR,
+                    "Failed to add the segments of a reused output.");
+    }
+  }
+  return Status::OK;
+}
+
+}  // namespace
+
+IncrementalPackaging::IncrementalPackaging(
+    const PackagingParams& packaging_params)
+    : packaging_params_(packaging_params) {}
+
+IncrementalPackaging::~IncrementalPackaging() {}
+
+Status IncrementalPackaging::ReuseUnchangedOutputs(
+    const std::vector<StreamDescriptor>& streams,
+    MuxerListenerFactory* muxer_listener_factory,
+    MpdNotifier* mpd_notifier,
+    hls::HlsNotifier* hls_notifier,
+    std::vector<StreamDescriptor>* remaining_streams) {
+  DCHECK(muxer_listener_factory);
+  DCHECK(remaining_streams);
+
+  std::vector<std::string> fingerprints(streams.size());
+  std::vector<MediaInfo> media_infos(streams.size());
+  // The input streams with an output which cannot be reused.
+  std::set<std::pair<std::string, std::string>> changed_input_streams;
+  for (size_t i = 0; i < streams.size(); ++i) {
+    const StreamDescriptor& stream = streams[i];
+    if (stream.output.empty() && stream.segment_template.empty())
+      continue;
+    fingerprints[i] = GetFingerprint(stream, packaging_params_);
+    const bool needs_segments = hls_notifier && !stream.dash_only;
+    if (fingerprints[i].empty() ||
+        !ReadReusableMediaInfo(stream, fingerprints[i], needs_segments,
+                               &media_infos[i])) {
+      changed_input_streams.emplace(stream.input, stream.stream_selector);
+    }
+  }
+
+  for (size_t i = 0; i < streams.size(); ++i) {
+    const StreamDescriptor& stream = streams[i];
+    const std::string media_info_output = GetMediaInfoOutput(stream);
+    if (changed_input_streams.count({stream.input, stream.stream_selector})) {
+      remaining_streams->push_back(stream);
+      if (fingerprints[i].empty())
+        continue;
+      // Not reused if the run fails after the output is partly rewritten.
+      const std::string fingerprint_file =
+          media_info_output + kFingerprintSuffix;
+      File::Delete(fingerprint_file.c_str());
+      pending_fingerprints_[fingerprint_file] = fingerprints[i];
+      continue;
+    }
+    if (stream.output.empty() && stream.segment_template.empty())
+      continue;
+
+    LOG(INFO) << "Reusing the unchanged output " << media_info_output << ".";
+    MediaInfo& media_info = media_infos[i];
+    SetManifestOptions(stream, &media_info);
+    if (!VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
+            media_info, media_info_output + kMediaInfoSuffix,
+            packaging_params_.binary_media_info
+                ? MediaInfoFileFormat::kBinary
+                : MediaInfoFileFormat::kText)) {
+      return Status(error::FILE_FAILURE,
+                    "Failed to write the MediaInfo of " + media_info_output);
+    }
+
+    const int stream_index = muxer_listener_factory->ReserveStreamIndex();
+    if (mpd_notifier && !stream.hls_only)
+      RETURN_IF_ERROR(AddToMpd(media_info, mpd_notifier));
+    if (hls_notifier && !stream.dash_only) {
+      const std::string playlist_name =
+          stream.hls_playlist_name.empty()
+              ? base::StringPrintf("stream_%d.m3u8", stream_index)
+              : stream.hls_playlist_name;
+      const std::string name = stream.hls_name.empty()
+                                   ? base::StringPrintf("stream_%d",
+                                                        stream_index)
+                                   : stream.hls_name;
+      if (!hls::HlsWriter::AddStream(media_info, playlist_name, name,
+                                     hls_notifier)) {
+        return Status(error::INTERNAL_ERROR,
+                      "Failed to add the reused output " + media_info_output +
+                          " to the HLS playlists.");
+      }
+    }
+  }
+  return Status::OK;
+}
+
+Status IncrementalPackaging::WriteFingerprints() {
+  for (const auto& entry : pending_fingerprints_) {
+    if (!File::WriteFileAtomically(entry.first.c_str(), entry.second)) {
+      return Status(error::FILE_FAILURE,
+                    "Failed to write the fingerprint " + entry.first);
+    }
+  }
+  pending_fingerprints_.clear();
+  return Status::OK;
+}
+
+std::string IncrementalPackaging::GetFingerprint(
+    const StreamDescriptor& stream,
+    const PackagingParams& packaging_params) {
+  std::string description;
+  if (!GetInputIdentity(stream.input, &description))
+    return std::string();
+  Append("version", GetPackagerVersion(), &description);
+
+  Append("stream_selector", stream.stream_selector, &description);
+  Append("output", stream.output, &description);
+  Append("segment_template", stream.segment_template, &description);
+  Append("output_format", stream.output_format, &description);
+  Append("skip_encryption", stream.skip_encryption, &description);
+  Append("drm_label", stream.drm_label, &description);
+  Append("trick_play_factor", stream.trick_play_factor, &description);
+  Append("bandwidth", stream.bandwidth, &description);
+  Append("language", stream.language, &description);
+  Append("start_time", stream.start_time, &description);
+  Append("end_time", stream.end_time, &description);
+
+  const ChunkingParams& chunking = packaging_params.chunking_params;
+  Append("segment_duration", chunking.segment_duration_in_seconds,
+         &description);
+  Append("subsegment_duration", chunking.subsegment_duration_in_seconds,
+         &description);
+  Append("segment_sap_aligned", chunking.segment_sap_aligned, &description);
+  Append("subsegment_sap_aligned", chunking.subsegment_sap_aligned,
+         &description);
+  Append("low_latency_chunk_num_frames", chunking.low_latency_chunk_num_frames,
+         &description);
+  Append("low_latency_chunk_duration",
+         chunking.low_latency_chunk_duration_in_seconds, &description);
+  Append("low_latency_chunk_target_bytes",
+         chunking.low_latency_chunk_target_bytes, &description);
+  Append("low_latency_chunk_min_duration",
+         chunking.low_latency_chunk_min_duration_in_seconds, &description);
+
+  const Mp4OutputParams& mp4 = packaging_params.mp4_output_params;
+  Append("include_pssh_in_stream", mp4.include_pssh_in_stream, &description);
+  Append("generate_sidx_in_media_segments",
+         mp4.generate_sidx_in_media_segments, &description);
+  Append("single_pass_single_segment", mp4.single_pass_single_segment,
+         &description);
+  Append("hierarchical_sidx_subsegments", mp4.hierarchical_sidx_subsegments,
+         &description);
+  Append("fragment_passthrough", mp4.fragment_passthrough, &description);
+  Append("generate_prft_boxes", mp4.generate_prft_boxes, &description);
+  Append("transport_stream_timestamp_offset",
+         packaging_params.transport_stream_timestamp_offset_ms, &description);
+  Append("webm_single_pass_single_segment",
+         packaging_params.webm_single_pass_single_segment, &description);
+  Append("trick_play_key_frame_interval",
+         packaging_params.trick_play_key_frame_interval, &description);
+  Append("deterministic_output", packaging_params.deterministic_output,
+         &description);
+  Append("num_vod_time_slices", packaging_params.num_vod_time_slices,
+         &description);
+
+  const EncryptionParams& encryption = packaging_params.encryption_params;
+  Append("key_provider", static_cast<int>(encryption.key_provider),
+         &description);
+  if (encryption.key_provider != KeyProvider::kNone) {
+    Append("protection_scheme", encryption.protection_scheme, &description);
+    Append("protection_systems",
+           static_cast<uint16_t>(encryption.protection_systems), &description);
+    Append("clear_lead", encryption.clear_lead_in_seconds, &description);
+    Append("crypt_byte_block", encryption.crypt_byte_block, &description);
+    Append("skip_byte_block", encryption.skip_byte_block, &description);
+    Append("crypto_period_duration",
+           encryption.crypto_period_duration_in_seconds, &description);
+    Append("vp9_subsample_encryption", encryption.vp9_subsample_encryption,
+           &description);
+    Append("playready_extra_header_data",
+           encryption.playready_extra_header_data, &description);
+    Append("raw_key_iv", encryption.raw_key.iv, &description);
+    Append("raw_key_pssh", encryption.raw_key.pssh, &description);
+    AppendRawKeys("raw_key_label", encryption.raw_key, &description);
+    Append("widevine_key_server_url", encryption.widevine.key_server_url,
+           &description);
+    Append("widevine_content_id", encryption.widevine.content_id,
+           &description);
+    Append("widevine_policy", encryption.widevine.policy, &description);
+    Append("widevine_group_id", encryption.widevine.group_id, &description);
+    Append("widevine_entitlement",
+           encryption.widevine.enable_entitlement_license, &description);
+    Append("playready_key_server_url", encryption.playready.key_server_url,
+           &description);
+    Append("playready_program_identifier",
+           encryption.playready.program_identifier, &description);
+  }
+
+  const DecryptionParams& decryption = packaging_params.decryption_params;
+  Append("decryption_key_provider", static_cast<int>(decryption.key_provider),
+         &description);
+  AppendRawKeys("decryption_raw_key_label", decryption.raw_key, &description);
+  Append("decryption_widevine_key_server_url",
+         decryption.widevine.key_server_url, &description);
+
+  const std::string digest = base::SHA1HashString(description);
+  return base::HexEncode(digest.data(), digest.size());
+}
+
+bool IncrementalPackaging::ReadReusableMediaInfo(
+    const StreamDescriptor& stream,
+    const std::string& fingerprint,
+    bool needs_segments,
+    MediaInfo* media_info) {
+  const std::string media_info_output = GetMediaInfoOutput(stream);
+  const std::string fingerprint_file = media_info_output + kFingerprintSuffix;
+  std::string previous_fingerprint;
+  if (!File::ReadFileToString(fingerprint_file.c_str(),
+                              &previous_fingerprint) ||
+      previous_fingerprint != fingerprint) {
+    VLOG(1) << "The output " << media_info_output << " changed.";
+    return false;
+  }
+  if (!MpdWriter::ReadMediaInfoFile(media_info_output + kMediaInfoSuffix,
+                                    media_info)) {
+    return false;
+  }
+  // The HLS playlists of single file outputs need their byte ranges, which
+  // are not recorded.
+  if (needs_segments && media_info->segments_size() == 0) {
+    VLOG(1) << "The MediaInfo of " << media_info_output
+            << " has no segments for the HLS playlists.";
+    return false;
+  }
+  const std::string& media_file =
+      !stream.output.empty()
+          ? stream.output
+          : (media_info->segments_size() > 0
+                 ? media_info->segments(media_info->segments_size() - 1)
+                       .name()
+                 : std::string());
+  if (!media_file.empty() && File::GetFileSize(media_file.c_str()) < 0) {
+    VLOG(1) << "The output " << media_file << " is missing.";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,94 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_INCREMENTAL_PACKAGING_H_
+#define PACKAGER_APP_INCREMENTAL_PACKAGING_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "packager/status.h"
+
+namespace shaka {
+
+class MediaInfo;
+class MpdNotifier;
+struct PackagingParams;
+struct StreamDescriptor;
+
+namespace hls {
+class HlsNotifier;
+}  // namespace hls
+
+namespace media {
+
+class MuxerListenerFactory;
+
+/// Reuses the outputs of a previous run of a VOD job whose inputs and options
+/// did not change, see PackagingParams.incremental_packaging.
+///
+/// The media files of an output depend on the identity of its input, i.e. its
+/// name, size and modification time, on its stream descriptor, and on the
+/// chunking, encryption and muxer options. They are fingerprinted in a
+/// ".fingerprint" file next to the MediaInfo file of the output once it is
+/// packaged. The outputs whose fingerprint matches are not packaged again, and
+/// are added to the manifests from their MediaInfo files instead, with the
+/// manifest options of their current stream descriptors.
+class IncrementalPackaging {
+ public:
+  /// @param packaging_params are the params of the run, which must outlive
+  ///        this object.
+  explicit IncrementalPackaging(const PackagingParams& packaging_params);
+  ~IncrementalPackaging();
+
+  /// Add the outputs of @a streams which are unchanged since the previous run
+  /// to the manifests, and return the other streams, to package, in
+  /// @a remaining_streams. The outputs of a stream of an input are reused
+  /// together, as they share its chunking and trick play. The fingerprints of
+  /// the remaining outputs are removed, so that they are not reused if the
+  /// run fails.
+  /// @param muxer_listener_factory names the HLS playlists of the reused
+  ///        outputs without a playlist name.
+  /// @param mpd_notifier may be null.
+  /// @param hls_notifier may be null.
+  Status ReuseUnchangedOutputs(
+      const std::vector<StreamDescriptor>& streams,
+      MuxerListenerFactory* muxer_listener_factory,
+      MpdNotifier* mpd_notifier,
+      hls::HlsNotifier* hls_notifier,
+      std::vector<StreamDescriptor>* remaining_streams);
+
+  /// Write the fingerprints of the outputs packaged by the run, once it
+  /// succeeds.
+  Status WriteFingerprints();
+
+  /// @return The fingerprint of the media files of the output of @a stream,
+  ///         or an empty string if its input cannot be identified, i.e. is
+  ///         not a local file.
+  static std::string GetFingerprint(const StreamDescriptor& stream,
+                                    const PackagingParams& packaging_params);
+
+ private:
+  IncrementalPackaging(const IncrementalPackaging&) = delete;
+  IncrementalPackaging& operator=(const IncrementalPackaging&) = delete;
+
+  // Read the MediaInfo of the output of |stream| to |media_info| if its
+  // fingerprint is |fingerprint| and it can be added to the manifests.
+  bool ReadReusableMediaInfo(const StreamDescriptor& stream,
+                             const std::string& fingerprint,
+                             bool needs_segments,
+                             MediaInfo* media_info);
+
+  const PackagingParams& packaging_params_;
+  // The fingerprints of the outputs packaged, by fingerprint file name.
+  std::map<std::string, std::string> pending_fingerprints_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_INCREMENTAL_PACKAGING_H_
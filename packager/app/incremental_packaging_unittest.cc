@@ -0,0 +1,103 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/incremental_packaging.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/files/file_util.h"
+#include "packager/packager.h"
+
+namespace shaka {
+namespace media {
+namespace {
+const char kInputContent[] = "input";
+const char kChangedInputContent[] = "changed input";
+const uint8_t kKeyId[] = {0x01, 0x02, 0x03, 0x04};
+const uint8_t kOtherKeyId[] = {0x05, 0x06, 0x07, 0x08};
+const uint8_t kKey[] = {0x11, 0x12, 0x13, 0x14};
+const uint8_t kOtherKey[] = {0x15, 0x16, 0x17, 0x18};
+}  // namespace
+
+class IncrementalPackagingTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateTemporaryFile(&input_path_));
+    ASSERT_EQ(static_cast<int>(sizeof(kInputContent)),
+              base::WriteFile(input_path_, kInputContent,
+                              sizeof(kInputContent)));
+    stream_.input = input_path_.AsUTF8Unsafe();
+    stream_.stream_selector = "video";
+    stream_.segment_template = "video-$Number$.mp4";
+    stream_.output = "video-init.mp4";
+    packaging_params_.chunking_params.segment_duration_in_seconds = 6;
+  }
+
+  void TearDown() override { base::DeleteFile(input_path_, false); }
+
+  void SetRawKey(const uint8_t* key_id, const uint8_t* key) {
+    EncryptionParams& encryption = packaging_params_.encryption_params;
+    encryption.key_provider = KeyProvider::kRawKey;
+    encryption.raw_key.key_map[""].key_id.assign(key_id, key_id + 4);
+    encryption.raw_key.key_map[""].key.assign(key, key + 4);
+  }
+
+  std::string GetFingerprint() {
+    return IncrementalPackaging::GetFingerprint(stream_, packaging_params_);
+  }
+
+  base::FilePath input_path_;
+  StreamDescriptor stream_;
+  PackagingParams packaging_params_;
+};
+
+TEST_F(IncrementalPackagingTest, Stable) {
+  const std::string fingerprint = GetFingerprint();
+  ASSERT_FALSE(fingerprint.empty());
+  EXPECT_EQ(fingerprint, GetFingerprint());
+
+  // The manifest options do not change the media files.
+  stream_.hls_name = "video";
+  stream_.dash_roles.push_back("main");
+  EXPECT_EQ(fingerprint, GetFingerprint());
+}
+
+TEST_F(IncrementalPackagingTest, ChangedOptions) {
+  const std::string fingerprint = GetFingerprint();
+  packaging_params_.chunking_params.segment_duration_in_seconds = 4;
+  EXPECT_NE(fingerprint, GetFingerprint());
+
+  packaging_params_.chunking_params.segment_duration_in_seconds = 6;
+  stream_.bandwidth = 1000000;
+  EXPECT_NE(fingerprint, GetFingerprint());
+}
+
+TEST_F(IncrementalPackagingTest, ChangedInput) {
+  const std::string fingerprint = GetFingerprint();
+  ASSERT_EQ(static_cast<int>(sizeof(kChangedInputContent)),
+            base::WriteFile(input_path_, kChangedInputContent,
+                            sizeof(kChangedInputContent)));
+  EXPECT_NE(fingerprint, GetFingerprint());
+}
+
+TEST_F(IncrementalPackagingTest, KeyIds) {
+  SetRawKey(kKeyId, kKey);
+  const std::string fingerprint = GetFingerprint();
+
+  // Only the key IDs are fingerprinted.
+  SetRawKey(kKeyId, kOtherKey);
+  EXPECT_EQ(fingerprint, GetFingerprint());
+  SetRawKey(kOtherKeyId, kOtherKey);
+  EXPECT_NE(fingerprint, GetFingerprint());
+}
+
+TEST_F(IncrementalPackagingTest, NonLocalInput) {
+  stream_.input = "udp://224.1.1.5:5003";
+  EXPECT_EQ("", GetFingerprint());
+}
+
+}  // namespace media
+}  // namespace shaka
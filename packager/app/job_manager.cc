@@ -6,7 +6,16 @@
 
 #include "packager/app/job_manager.h"
 
+#include <algorithm>
+#include <map>
+#include <set>
+#include <thread>
+
 #include "packager/app/libcrypto_threading.h"
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/file/cpu_affinity.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/chunking/sync_point_queue.h"
 #include "packager/media/origin/origin_handler.h"
 
@@ -25,36 +34,130 @@ void Job::Cancel() {
   work_->Cancel();
 }
 
-void Job::Run() {
+void Job::RunOnCurrentThread() {
+  // Pooled worker threads are pinned again for each job they run.
+  if (!cpus_.empty())
+    SetCurrentThreadCpus(cpus_);
   status_ = work_->Run();
   wait_.Signal();
 }
 
+void Job::Run() {
+  RunOnCurrentThread();
+}
+
 JobManager::JobManager(std::unique_ptr<SyncPointQueue> sync_points)
-    : sync_points_(std::move(sync_points)) {}
+    : JobManager(std::move(sync_points), 0) {}
+
+JobManager::JobManager(std::unique_ptr<SyncPointQueue> sync_points,
+                       size_t num_worker_threads)
+    : sync_points_(std::move(sync_points)),
+      num_worker_threads_(num_worker_threads),
+      jobs_added_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                  base::WaitableEvent::InitialState::NOT_SIGNALED) {}
 
 void JobManager::Add(const std::string& name,
-                     std::shared_ptr<OriginHandler> handler) {
+                     std::shared_ptr<OriginHandler> handler,
+                     const std::string& input) {
   // Stores Job entries for delayed construction of Job objects, to avoid
   // setting up SimpleThread until we know all workers can be initialized
   // successfully.
-  job_entries_.push_back({name, std::move(handler)});
+  base::AutoLock auto_lock(lock_);
+  job_entries_.push_back({name, std::move(handler), false, input});
+}
+
+void JobManager::AddPooled(const std::string& name,
+                           std::shared_ptr<OriginHandler> handler,
+                           const std::string& input) {
+  base::AutoLock auto_lock(lock_);
+  job_entries_.push_back({name, std::move(handler), true, input});
 }
 
 Status JobManager::InitializeJobs() {
+  return CreateJobs(&dedicated_jobs_, &pooled_jobs_);
+}
+
+Status JobManager::CreateJobs(std::vector<Job*>* dedicated_jobs,
+                              std::vector<Job*>* pooled_jobs) {
+  std::vector<JobEntry> new_entries;
+  {
+    base::AutoLock auto_lock(lock_);
+    new_entries.assign(job_entries_.begin() + jobs_.size(), job_entries_.end());
+  }
   Status status;
-  for (const JobEntry& job_entry : job_entries_)
+  for (const JobEntry& job_entry : new_entries)
     status.Update(job_entry.worker->Initialize());
   if (!status.ok())
     return status;
 
   // Create Job objects after successfully initialized all workers.
-  for (const JobEntry& job_entry : job_entries_)
-    jobs_.emplace_back(new Job(job_entry.name, std::move(job_entry.worker)));
+  base::AutoLock auto_lock(lock_);
+  for (const JobEntry& job_entry : new_entries) {
+    jobs_.emplace_back(new Job(job_entry.name, job_entry.worker));
+    jobs_.back()->set_input(job_entry.input);
+    if (!cpu_sets_.empty()) {
+      // A new input gets the next CPU set.
+      const size_t next_index = cpu_set_indexes_.size() % cpu_sets_.size();
+      auto iter =
+          cpu_set_indexes_.insert(std::make_pair(job_entry.input, next_index))
+              .first;
+      jobs_.back()->set_cpus(cpu_sets_[iter->second]);
+    }
+    if (job_entry.pooled)
+      pooled_jobs->push_back(jobs_.back().get());
+    else
+      dedicated_jobs->push_back(jobs_.back().get());
+  }
   return status;
 }
 
 Status JobManager::RunJobs() {
+  const bool pool_all_jobs =
+      num_worker_threads_ > 0 && num_worker_threads_ < jobs_.size();
+  if (sync_points_) {
+    // A job blocked on cue alignment waits for all the other jobs to reach
+    // the cue, which would never happen if those jobs are waiting for a
+    // worker thread.
+    if (pool_all_jobs) {
+      LOG(WARNING) << "Ignoring the worker pool size " << num_worker_threads_
+                   << " as cue alignment requires all the " << jobs_.size()
+                   << " jobs to run at the same time.";
+    }
+    dedicated_jobs_.insert(dedicated_jobs_.end(), pooled_jobs_.begin(),
+                           pooled_jobs_.end());
+    pooled_jobs_.clear();
+  } else if (pool_all_jobs) {
+    // Every job runs on the worker pool, in the order they were added.
+    dedicated_jobs_.clear();
+    pooled_jobs_.clear();
+    for (auto& job : jobs_)
+      pooled_jobs_.push_back(job.get());
+  }
+
+  const size_t pool_size =
+      num_worker_threads_ > 0
+          ? num_worker_threads_
+          : std::max(1u, std::thread::hardware_concurrency());
+  return RunJobsOnThreads(std::min(pool_size, pooled_jobs_.size()));
+}
+
+Status JobManager::RunJobsOnThreads(size_t num_workers) {
+  if (!pooled_jobs_.empty()) {
+    VLOG(1) << "Running " << pooled_jobs_.size() << " jobs on " << num_workers
+            << " worker threads.";
+  }
+  {
+    base::AutoLock auto_lock(lock_);
+    running_ = true;
+  }
+  std::vector<std::unique_ptr<ClosureThread>> workers;
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers.emplace_back(new ClosureThread(
+        "JobWorker",
+        base::Bind(&JobManager::RunPendingJobs, base::Unretained(this))));
+    workers.back()->Start();
+  }
+
   // We need to store the jobs and the waits separately in order to use the
   // |WaitMany| function. |WaitMany| takes an array of WaitableEvents but we
   // need to access the jobs in order to join the thread and check the status.
@@ -65,29 +168,61 @@ Status JobManager::RunJobs() {
 
   // Start every job and add it to the active jobs list so that we can wait
   // on each one.
-  for (auto& job : jobs_) {
+  for (Job* job : dedicated_jobs_) {
     job->Start();
 
-    active_jobs.push_back(job.get());
+    active_jobs.push_back(job);
     active_waits.push_back(job->wait());
   }
 
-  // Wait for all jobs to complete or an error occurs.
+  // Wait for all jobs to complete or an error occurs. |jobs_added_| is waited
+  // on last, after the waits of the active jobs.
+  active_waits.push_back(&jobs_added_);
   Status status;
-  while (status.ok() && active_jobs.size()) {
+  while (status.ok()) {
+    {
+      base::AutoLock auto_lock(lock_);
+      for (Job* job : added_jobs_) {
+        job->Start();
+
+        active_jobs.push_back(job);
+        active_waits.insert(active_waits.end() - 1, job->wait());
+      }
+      added_jobs_.clear();
+      // No jobs can be added once the session has ended.
+      if (active_jobs.empty()) {
+        running_ = false;
+        break;
+      }
+    }
+
     // Wait for an event to finish and then update our status so that we can
     // quit if something has gone wrong.
     const size_t done =
         base::WaitableEvent::WaitMany(active_waits.data(), active_waits.size());
+    if (done == active_jobs.size())
+      continue;
     Job* job = active_jobs[done];
 
     job->Join();
-    status.Update(job->status());
+    bool removed = false;
+    {
+      base::AutoLock auto_lock(lock_);
+      removed = removed_inputs_.count(job->input()) > 0;
+    }
+    if (!removed)
+      status.Update(job->status());
 
     // Remove the job and the wait from our tracking.
     active_jobs.erase(active_jobs.begin() + done);
     active_waits.erase(active_waits.begin() + done);
   }
+  {
+    base::AutoLock auto_lock(lock_);
+    running_ = false;
+    // The jobs added after the failure never started.
+    added_jobs_.clear();
+  }
 
   // If the main loop has exited and there are still jobs running,
   // we need to cancel them and clean-up.
@@ -96,17 +231,131 @@ Status JobManager::RunJobs() {
   for (auto& job : active_jobs) {
     job->Cancel();
   }
+  if (!status.ok() && !workers.empty()) {
+    {
+      base::AutoLock auto_lock(lock_);
+      cancelled_ = true;
+    }
+    for (Job* job : pooled_jobs_)
+      job->Cancel();
+  }
 
   for (auto& job : active_jobs) {
     job->Join();
   }
+  for (auto& worker : workers)
+    worker->Join();
 
+  base::AutoLock auto_lock(lock_);
+  // A failed pooled job cancels the jobs on their own threads, so report its
+  // error rather than the cancellation.
+  if (status.error_code() == error::CANCELLED && !pool_status_.ok())
+    return pool_status_;
+  status.Update(pool_status_);
   return status;
 }
 
+Status JobManager::StartAddedJobs() {
+  {
+    base::AutoLock auto_lock(lock_);
+    if (!running_)
+      return Status(error::INVALID_ARGUMENT, "The jobs are not running.");
+  }
+  std::vector<Job*> new_jobs;
+  Status status = CreateJobs(&new_jobs, &new_jobs);
+  base::AutoLock auto_lock(lock_);
+  if (!status.ok()) {
+    // The entries which failed are not retried by the next call.
+    job_entries_.erase(job_entries_.begin() + jobs_.size(),
+                       job_entries_.end());
+    return status;
+  }
+  if (!running_)
+    return Status(error::INVALID_ARGUMENT, "The jobs are not running.");
+  added_jobs_.insert(added_jobs_.end(), new_jobs.begin(), new_jobs.end());
+  jobs_added_.Signal();
+  return Status::OK;
+}
+
+void JobManager::DiscardAddedJobs() {
+  base::AutoLock auto_lock(lock_);
+  job_entries_.erase(job_entries_.begin() + jobs_.size(), job_entries_.end());
+}
+
+Status JobManager::RemoveJobs(const std::string& input) {
+  std::vector<Job*> removed_jobs;
+  {
+    base::AutoLock auto_lock(lock_);
+    if (!running_)
+      return Status(error::INVALID_ARGUMENT, "The jobs are not running.");
+    removed_inputs_.insert(input);
+    for (auto& job : jobs_) {
+      if (job->input() == input)
+        removed_jobs.push_back(job.get());
+    }
+  }
+  if (removed_jobs.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "No jobs with input " + input + ".");
+  }
+  for (Job* job : removed_jobs)
+    job->Cancel();
+  // The jobs signal their waits when they exit, whether they were started or
+  // not, unless the session ended before they started.
+  for (Job* job : removed_jobs) {
+    while (!job->wait()->TimedWait(base::TimeDelta::FromMilliseconds(100))) {
+      base::AutoLock auto_lock(lock_);
+      if (!running_)
+        break;
+    }
+  }
+  return Status::OK;
+}
+
+void JobManager::RunPendingJobs() {
+  while (true) {
+    Job* job = nullptr;
+    {
+      base::AutoLock auto_lock(lock_);
+      if (cancelled_ || !pool_status_.ok() ||
+          next_job_index_ >= pooled_jobs_.size()) {
+        return;
+      }
+      job = pooled_jobs_[next_job_index_++];
+    }
+
+    job->RunOnCurrentThread();
+
+    bool failed = false;
+    {
+      base::AutoLock auto_lock(lock_);
+      failed = pool_status_.ok() && !job->status().ok();
+      pool_status_.Update(job->status());
+    }
+    // Stop the other running jobs on the first failure, which matches the
+    // behavior of running every job on its own thread.
+    if (failed)
+      CancelJobs();
+  }
+}
+
+std::vector<HandlerStats> JobManager::GetHandlerStats() const {
+  base::AutoLock auto_lock(lock_);
+  std::set<const MediaHandler*> visited;
+  std::vector<HandlerStats> stats;
+  for (const JobEntry& job_entry : job_entries_)
+    job_entry.worker->CollectStats(&visited, &stats);
+  return stats;
+}
+
 void JobManager::CancelJobs() {
+  {
+    base::AutoLock auto_lock(lock_);
+    cancelled_ = true;
+  }
   if (sync_points_)
     sync_points_->Cancel();
+  base::AutoLock auto_lock(lock_);
   for (auto& job : jobs_) {
     job->Cancel();
   }
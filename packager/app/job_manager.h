@@ -7,10 +7,15 @@
 #ifndef PACKAGER_APP_JOB_MANAGER_H_
 #define PACKAGER_APP_JOB_MANAGER_H_
 
+#include <map>
 #include <memory>
+#include <set>
+#include <string>
 #include <vector>
 
+#include "packager/base/synchronization/lock.h"
 #include "packager/base/threading/simple_thread.h"
+#include "packager/media/public/handler_stats.h"
 #include "packager/status.h"
 
 namespace shaka {
@@ -30,6 +35,17 @@ class Job : public base::SimpleThread {
   // |wait|.
   void Cancel();
 
+  // Run the job to completion on the calling thread instead of on its own
+  // thread. It should not be mixed with |Start|.
+  void RunOnCurrentThread();
+
+  // Pin the thread running the job to |cpus|, if not empty.
+  void set_cpus(const std::vector<int>& cpus) { cpus_ = cpus; }
+
+  // The input of the job, see |JobManager::Add|.
+  void set_input(const std::string& input) { input_ = input; }
+  const std::string& input() const { return input_; }
+
   // Get the current status of the job. If the job failed to initialize
   // or encountered an error during execution this will return the error.
   const Status& status() const { return status_; }
@@ -45,6 +61,8 @@ class Job : public base::SimpleThread {
   void Run() override;
 
   std::shared_ptr<OriginHandler> work_;
+  std::vector<int> cpus_;
+  std::string input_;
   Status status_;
 
   base::WaitableEvent wait_;
@@ -60,10 +78,46 @@ class JobManager {
   //        fails or is cancelled. It can be NULL.
   explicit JobManager(std::unique_ptr<SyncPointQueue> sync_points);
 
+  // @param sync_points is an optional SyncPointQueue used to synchronize and
+  //        align cue points. JobManager cancels @a sync_points when any job
+  //        fails or is cancelled. It can be NULL.
+  // @param num_worker_threads is the maximum number of jobs that run at the
+  //        same time. Jobs are run on a pool of worker threads, in the order
+  //        they are added, if there are more jobs than worker threads. Zero
+  //        means every job runs on its own thread. Note that a job does not
+  //        release its worker thread until it completes, so the pool should
+  //        only be used with inputs that terminate. Cue alignment requires all
+  //        jobs to run at the same time, so the pool is not used if
+  //        @a sync_points is not NULL.
+  JobManager(std::unique_ptr<SyncPointQueue> sync_points,
+             size_t num_worker_threads);
+
   // Create a new job entry by specifying the origin handler at the top of the
   // chain and a name for the thread. This will only register the job. To start
-  // the job, you need to call |RunJobs|.
-  void Add(const std::string& name, std::shared_ptr<OriginHandler> handler);
+  // the job, you need to call |RunJobs|. |input| is the input of the job; the
+  // jobs of an input run on the same CPU set, see |set_cpu_sets|.
+  void Add(const std::string& name,
+           std::shared_ptr<OriginHandler> handler,
+           const std::string& input);
+
+  // Same as |Add|, for a job that terminates on its own, e.g. one reading a
+  // text file. Such jobs share the pool of worker threads even when the other
+  // jobs run on their own threads, so that many small jobs do not need a
+  // thread each. The pool has |num_worker_threads| threads, or as many
+  // threads as there are cores if it is zero. Pooled jobs run on their own
+  // threads if |sync_points| is not NULL, as cue alignment requires all jobs
+  // to run at the same time.
+  void AddPooled(const std::string& name,
+                 std::shared_ptr<OriginHandler> handler,
+                 const std::string& input);
+
+  // Pin the jobs to |cpu_sets|, so that the memory and the I/O threads of a
+  // job stay on the NUMA node of its CPUs. The jobs of each input are pinned
+  // to one of the sets, which are assigned to the inputs in turn, in the order
+  // the inputs are added. It should be called before |InitializeJobs|.
+  void set_cpu_sets(const std::vector<std::vector<int>>& cpu_sets) {
+    cpu_sets_ = cpu_sets;
+  }
 
   // Initialize all registered jobs. If any job fails to initialize, this will
   // return the error and it will not be safe to call |RunJobs| as not all jobs
@@ -79,22 +133,80 @@ class JobManager {
   // unblock a call to |RunJobs|.
   void CancelJobs();
 
+  // Initialize the jobs added since |InitializeJobs| or the last call, and run
+  // them on their own threads along with the running jobs. It can be called
+  // from any thread while |RunJobs| is running. If any of the jobs fails to
+  // initialize, none of them runs and the error is returned.
+  Status StartAddedJobs();
+
+  // Discard the jobs added since |InitializeJobs| or the last call to
+  // |StartAddedJobs|, e.g. if their handlers could not be set up.
+  void DiscardAddedJobs();
+
+  // Stop the jobs of |input| and wait for them to exit, while the other jobs
+  // keep running. Their status, e.g. their cancellation, does not affect the
+  // status of |RunJobs|. It can be called from any thread while |RunJobs| is
+  // running.
+  Status RemoveJobs(const std::string& input);
+
+  // Collect the statistics of the handlers of all the jobs. It can be called
+  // from any thread while the jobs are running.
+  std::vector<HandlerStats> GetHandlerStats() const;
+
   SyncPointQueue* sync_points() { return sync_points_.get(); }
 
  private:
   JobManager(const JobManager&) = delete;
   JobManager& operator=(const JobManager&) = delete;
 
+  // Run every job in |dedicated_jobs_| on its own thread, and the jobs in
+  // |pooled_jobs_| on |num_workers| worker threads.
+  Status RunJobsOnThreads(size_t num_workers);
+  // Worker thread body. Runs pending jobs until there are no more jobs, or
+  // until any job fails or the jobs are cancelled.
+  void RunPendingJobs();
+  // Initialize the entries in |job_entries_| without a job, and create their
+  // jobs, which are added to |dedicated_jobs| or |pooled_jobs|.
+  Status CreateJobs(std::vector<Job*>* dedicated_jobs,
+                    std::vector<Job*>* pooled_jobs);
+
   struct JobEntry {
     std::string name;
     std::shared_ptr<OriginHandler> worker;
+    bool pooled;
+    std::string input;
   };
-  // Stores Job entries for delayed construction of Job object.
+  // Stores Job entries for delayed construction of Job object. The jobs in
+  // |jobs_| are created for the entries in the same order.
   std::vector<JobEntry> job_entries_;
   std::vector<std::unique_ptr<Job>> jobs_;
+  // The jobs in |jobs_| run on their own threads, and the ones run by the
+  // worker pool, in the order they were added.
+  std::vector<Job*> dedicated_jobs_;
+  std::vector<Job*> pooled_jobs_;
   // Stored in JobManager so JobManager can cancel |sync_points| when any job
   // fails or is cancelled.
   std::unique_ptr<SyncPointQueue> sync_points_;
+  std::vector<std::vector<int>> cpu_sets_;
+  // The indexes in |cpu_sets_| assigned to the inputs.
+  std::map<std::string, size_t> cpu_set_indexes_;
+
+  const size_t num_worker_threads_ = 0;
+  // Protects the jobs and the states below.
+  mutable base::Lock lock_;
+  // Index of the next job in |pooled_jobs_| to be run by the worker pool.
+  size_t next_job_index_ = 0;
+  // Combined status of the jobs run by the worker pool.
+  Status pool_status_;
+  bool cancelled_ = false;
+  // Whether |RunJobs| is running, so jobs can be added or removed.
+  bool running_ = false;
+  // The jobs started by |StartAddedJobs|, to be run by |RunJobs|.
+  std::vector<Job*> added_jobs_;
+  // Signaled when jobs are added to |added_jobs_|.
+  base::WaitableEvent jobs_added_;
+  // The inputs removed by |RemoveJobs|.
+  std::set<std::string> removed_inputs_;
 };
 
 }  // namespace media
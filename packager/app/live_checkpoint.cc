@@ -0,0 +1,780 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/live_checkpoint.h"
+
+#include <algorithm>
+
+#include "packager/app/live_checkpoint.pb.h"
+#include "packager/base/logging.h"
+#include "packager/file/file.h"
+#include "packager/hls/base/hls_notifier.h"
+#include "packager/media/demuxer/demuxer.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/base/mpd_notifier.h"
+#include "packager/mpd/base/mpd_options.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// The events are kept for twice the live window, so that the window of the
+// notifiers is always within the replayed events.
+const double kRecordedWindowFactor = 2.0;
+
+typedef google::protobuf::RepeatedPtrField<LiveCheckpointStream> StreamList;
+typedef google::protobuf::RepeatedPtrField<LiveCheckpointEvent> EventList;
+
+// The state of an HLS stream or a DASH container being recorded.
+struct StreamState {
+  LiveCheckpointStream data;
+  uint32_t time_scale = 0;
+  // The duration of the segments in |data.events|.
+  uint64_t events_duration = 0;
+  bool has_last_segment = false;
+  uint64_t last_segment_start_time = 0;
+  bool encrypted = false;
+  bool pending_discontinuity = false;
+};
+
+void InitStreamState(const MediaInfo& media_info, StreamState* state) {
+  media_info.SerializeToString(state->data.mutable_media_info());
+  state->data.set_segment_template(media_info.segment_template());
+  state->time_scale = media_info.reference_time_scale();
+}
+
+// @return The index of the first segment in |events|, or -1 if there is none.
+int FindFirstSegment(const EventList& events) {
+  for (int i = 0; i < events.size(); ++i) {
+    if (events.Get(i).type() == LiveCheckpointEvent::SEGMENT)
+      return i;
+  }
+  return -1;
+}
+
+// @return The index of the last segment in |events|, or -1 if there is none.
+int FindLastSegment(const EventList& events) {
+  for (int i = events.size() - 1; i >= 0; --i) {
+    if (events.Get(i).type() == LiveCheckpointEvent::SEGMENT)
+      return i;
+  }
+  return -1;
+}
+
+// Remove the events up to the first segment, included, except for the
+// encryption updates in effect at the segment, which are kept for the next
+// segments, as the notifiers do.
+void RemoveFirstSegment(StreamState* state) {
+  EventList* events = state->data.mutable_events();
+  const int segment_index = FindFirstSegment(*events);
+  DCHECK_GE(segment_index, 0);
+  state->events_duration -= events->Get(segment_index).duration();
+  state->data.set_num_removed_segments(state->data.num_removed_segments() + 1);
+
+  int keys_begin = segment_index;
+  int keys_end = segment_index;
+  for (int i = segment_index - 1; i >= 0; --i) {
+    if (events->Get(i).type() == LiveCheckpointEvent::ENCRYPTION_UPDATE) {
+      if (keys_end == segment_index)
+        keys_end = i + 1;
+      keys_begin = i;
+    } else if (keys_end != segment_index) {
+      break;
+    }
+  }
+
+  EventList kept_events;
+  for (int i = keys_begin; i < keys_end; ++i)
+    kept_events.Add()->Swap(events->Mutable(i));
+  for (int i = segment_index + 1; i < events->size(); ++i)
+    kept_events.Add()->Swap(events->Mutable(i));
+  events->Swap(&kept_events);
+
+  // The discontinuity before the new first segment is removed with the
+  // previous segment.
+  const int next_segment_index = FindFirstSegment(*events);
+  if (next_segment_index >= 0 &&
+      events->Get(next_segment_index).discontinuity()) {
+    events->Mutable(next_segment_index)->clear_discontinuity();
+    state->data.set_num_removed_discontinuities(
+        state->data.num_removed_discontinuities() + 1);
+  }
+}
+
+// Add |event| to the events of |state|, and remove the segments out of twice
+// the live window of |time_shift_buffer_depth| seconds.
+void AddEvent(double time_shift_buffer_depth,
+              const LiveCheckpointEvent& event,
+              StreamState* state) {
+  LiveCheckpointEvent* new_event = state->data.add_events();
+  *new_event = event;
+  if (event.type() == LiveCheckpointEvent::SEGMENT) {
+    // Mirror the discontinuities of HLS media playlists, which follow a
+    // segment starting before the previous one, and the first key of a
+    // stream with clear segments.
+    if (state->pending_discontinuity ||
+        (state->has_last_segment &&
+         event.start_time() < state->last_segment_start_time)) {
+      new_event->set_discontinuity(true);
+    }
+    state->pending_discontinuity = false;
+    state->has_last_segment = true;
+    state->last_segment_start_time = event.start_time();
+    state->events_duration += event.duration();
+    state->data.set_num_segments(state->data.num_segments() + 1);
+  } else if (event.type() == LiveCheckpointEvent::ENCRYPTION_UPDATE) {
+    if (!state->encrypted && state->has_last_segment)
+      state->pending_discontinuity = true;
+    state->encrypted = true;
+  }
+
+  if (time_shift_buffer_depth <= 0 || state->time_scale == 0)
+    return;
+  const uint64_t recorded_window = static_cast<uint64_t>(
+      kRecordedWindowFactor * time_shift_buffer_depth * state->time_scale);
+  while (true) {
+    const int segment_index = FindFirstSegment(state->data.events());
+    if (segment_index < 0)
+      return;
+    const uint64_t duration = state->data.events(segment_index).duration();
+    if (state->events_duration - duration <= recorded_window)
+      return;
+    RemoveFirstSegment(state);
+  }
+}
+
+// Restore the counters of a state from a loaded stream, before its events
+// are replayed.
+void RestoreStreamState(const LiveCheckpointStream& stream,
+                        StreamState* state) {
+  state->data.set_num_segments(stream.num_removed_segments());
+  state->data.set_num_removed_segments(stream.num_removed_segments());
+  state->data.set_num_removed_discontinuities(
+      stream.num_removed_discontinuities());
+  state->data.set_timestamp_offset_in_seconds(
+      stream.timestamp_offset_in_seconds());
+}
+
+std::vector<uint8_t> ToVector(const std::string& bytes) {
+  return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+}  // namespace
+
+// Records the events of the HLS streams, and passes them on.
+class LiveCheckpoint::HlsRecorder : public hls::HlsNotifier {
+ public:
+  explicit HlsRecorder(std::unique_ptr<hls::HlsNotifier> notifier)
+      : HlsNotifier(notifier->hls_params()), notifier_(std::move(notifier)) {}
+
+  // Replay |stream| to the notifier.
+  bool Restore(const LiveCheckpointStream& stream) {
+    MediaInfo media_info;
+    if (!media_info.ParseFromString(stream.media_info()))
+      return false;
+    uint32_t stream_id = 0;
+    if (!notifier_->NotifyNewStream(media_info, stream.playlist_name(),
+                                    stream.stream_name(), stream.group_id(),
+                                    &stream_id) ||
+        !notifier_->SetSequenceNumbers(
+            stream_id,
+            hls_params().media_sequence_number +
+                stream.num_removed_segments(),
+            stream.num_removed_discontinuities())) {
+      return false;
+    }
+    {
+      base::AutoLock auto_lock(lock_);
+      StreamState* state = AddStream(stream_id, media_info,
+                                     stream.playlist_name(),
+                                     stream.stream_name(), stream.group_id());
+      RestoreStreamState(stream, state);
+      restored_streams_[stream.playlist_name()] = stream_id;
+    }
+    if (stream.has_sample_duration() &&
+        !NotifySampleDuration(stream_id, stream.sample_duration())) {
+      return false;
+    }
+    for (const LiveCheckpointEvent& event : stream.events()) {
+      if (!Replay(stream_id, event))
+        return false;
+    }
+    return true;
+  }
+
+  void Snapshot(StreamList* streams) {
+    base::AutoLock auto_lock(lock_);
+    for (const auto& entry : streams_)
+      *streams->Add() = entry.second.data;
+  }
+
+  bool Init() override { return notifier_->Init(); }
+
+  bool NotifyNewStream(const MediaInfo& media_info,
+                       const std::string& playlist_name,
+                       const std::string& stream_name,
+                       const std::string& group_id,
+                       uint32_t* stream_id) override {
+    {
+      base::AutoLock auto_lock(lock_);
+      auto iter = restored_streams_.find(playlist_name);
+      if (iter != restored_streams_.end()) {
+        *stream_id = iter->second;
+        restored_streams_.erase(iter);
+        return true;
+      }
+    }
+    if (!notifier_->NotifyNewStream(media_info, playlist_name, stream_name,
+                                    group_id, stream_id)) {
+      return false;
+    }
+    base::AutoLock auto_lock(lock_);
+    AddStream(*stream_id, media_info, playlist_name, stream_name, group_id);
+    return true;
+  }
+
+  bool NotifySampleDuration(uint32_t stream_id,
+                            uint32_t sample_duration) override {
+    if (!notifier_->NotifySampleDuration(stream_id, sample_duration))
+      return false;
+    base::AutoLock auto_lock(lock_);
+    auto iter = streams_.find(stream_id);
+    if (iter != streams_.end())
+      iter->second.data.set_sample_duration(sample_duration);
+    return true;
+  }
+
+  bool NotifyNewSegment(uint32_t stream_id,
+                        const std::string& segment_name,
+                        uint64_t start_time,
+                        uint64_t duration,
+                        uint64_t start_byte_offset,
+                        uint64_t size) override {
+    if (!notifier_->NotifyNewSegment(stream_id, segment_name, start_time,
+                                     duration, start_byte_offset, size)) {
+      return false;
+    }
+    LiveCheckpointEvent event;
+    event.set_type(LiveCheckpointEvent::SEGMENT);
+    event.set_segment_name(segment_name);
+    event.set_start_time(start_time);
+    event.set_duration(duration);
+    event.set_start_byte_offset(start_byte_offset);
+    event.set_size(size);
+    Record(stream_id, event);
+    return true;
+  }
+
+  // The parts of the segments written before a restart are not needed.
+  bool NotifyNewPart(uint32_t stream_id,
+                     const std::string& segment_name,
+                     uint64_t start_time,
+                     uint64_t duration,
+                     uint64_t start_byte_offset,
+                     uint64_t size) override {
+    return notifier_->NotifyNewPart(stream_id, segment_name, start_time,
+                                    duration, start_byte_offset, size);
+  }
+
+  bool NotifyKeyFrame(uint32_t stream_id,
+                      uint64_t timestamp,
+                      uint64_t start_byte_offset,
+                      uint64_t size) override {
+    if (!notifier_->NotifyKeyFrame(stream_id, timestamp, start_byte_offset,
+                                   size)) {
+      return false;
+    }
+    LiveCheckpointEvent event;
+    event.set_type(LiveCheckpointEvent::KEY_FRAME);
+    event.set_start_time(timestamp);
+    event.set_start_byte_offset(start_byte_offset);
+    event.set_size(size);
+    Record(stream_id, event);
+    return true;
+  }
+
+  bool NotifyCueEvent(uint32_t stream_id, uint64_t timestamp) override {
+    if (!notifier_->NotifyCueEvent(stream_id, timestamp))
+      return false;
+    LiveCheckpointEvent event;
+    event.set_type(LiveCheckpointEvent::CUE);
+    event.set_start_time(timestamp);
+    Record(stream_id, event);
+    return true;
+  }
+
+  bool NotifyEncryptionUpdate(
+      uint32_t stream_id,
+      const std::vector<uint8_t>& key_id,
+      const std::vector<uint8_t>& system_id,
+      const std::vector<uint8_t>& iv,
+      const std::vector<uint8_t>& protection_system_specific_data) override {
+    if (!notifier_->NotifyEncryptionUpdate(stream_id, key_id, system_id, iv,
+                                           protection_system_specific_data)) {
+      return false;
+    }
+    LiveCheckpointEvent event;
+    event.set_type(LiveCheckpointEvent::ENCRYPTION_UPDATE);
+    event.set_key_id(key_id.data(), key_id.size());
+    event.set_system_id(system_id.data(), system_id.size());
+    event.set_iv(iv.data(), iv.size());
+    event.set_protection_system_specific_data(
+        protection_system_specific_data.data(),
+        protection_system_specific_data.size());
+    Record(stream_id, event);
+    return true;
+  }
+
+  bool SetSequenceNumbers(uint32_t stream_id,
+                          uint32_t media_sequence_number,
+                          int discontinuity_sequence_number) override {
+    return notifier_->SetSequenceNumbers(stream_id, media_sequence_number,
+                                         discontinuity_sequence_number);
+  }
+
+  bool RemoveStream(const std::string& segment_template) override {
+    if (!notifier_->RemoveStream(segment_template))
+      return false;
+    base::AutoLock auto_lock(lock_);
+    for (auto iter = restored_streams_.begin();
+         iter != restored_streams_.end();) {
+      if (streams_[iter->second].data.segment_template() == segment_template)
+        iter = restored_streams_.erase(iter);
+      else
+        ++iter;
+    }
+    for (auto iter = streams_.begin(); iter != streams_.end();) {
+      if (iter->second.data.segment_template() == segment_template)
+        iter = streams_.erase(iter);
+      else
+        ++iter;
+    }
+    return true;
+  }
+
+  bool Flush() override { return notifier_->Flush(); }
+
+ private:
+  HlsRecorder(const HlsRecorder&) = delete;
+  HlsRecorder& operator=(const HlsRecorder&) = delete;
+
+  // |lock_| must be held.
+  StreamState* AddStream(uint32_t stream_id,
+                         const MediaInfo& media_info,
+                         const std::string& playlist_name,
+                         const std::string& stream_name,
+                         const std::string& group_id) {
+    StreamState* state = &streams_[stream_id];
+    InitStreamState(media_info, state);
+    state->data.set_playlist_name(playlist_name);
+    state->data.set_stream_name(stream_name);
+    state->data.set_group_id(group_id);
+    return state;
+  }
+
+  void Record(uint32_t stream_id, const LiveCheckpointEvent& event) {
+    base::AutoLock auto_lock(lock_);
+    auto iter = streams_.find(stream_id);
+    if (iter != streams_.end())
+      AddEvent(hls_params().time_shift_buffer_depth, event, &iter->second);
+  }
+
+  bool Replay(uint32_t stream_id, const LiveCheckpointEvent& event) {
+    switch (event.type()) {
+      case LiveCheckpointEvent::SEGMENT:
+        return NotifyNewSegment(stream_id, event.segment_name(),
+                                event.start_time(), event.duration(),
+                                event.start_byte_offset(), event.size());
+      case LiveCheckpointEvent::KEY_FRAME:
+        return NotifyKeyFrame(stream_id, event.start_time(),
+                              event.start_byte_offset(), event.size());
+      case LiveCheckpointEvent::CUE:
+        return NotifyCueEvent(stream_id, event.start_time());
+      case LiveCheckpointEvent::ENCRYPTION_UPDATE:
+        return NotifyEncryptionUpdate(
+            stream_id, ToVector(event.key_id()), ToVector(event.system_id()),
+            ToVector(event.iv()),
+            ToVector(event.protection_system_specific_data()));
+    }
+    return false;
+  }
+
+  const std::unique_ptr<hls::HlsNotifier> notifier_;
+
+  base::Lock lock_;
+  std::map<uint32_t, StreamState> streams_;
+  // The restored streams not yet notified again, by playlist name.
+  std::map<std::string, uint32_t> restored_streams_;
+};
+
+// Records the events of the DASH containers with segment templates, and
+// passes them on.
+class LiveCheckpoint::MpdRecorder : public MpdNotifier {
+ public:
+  MpdRecorder(const MpdOptions& mpd_options,
+              std::unique_ptr<MpdNotifier> notifier)
+      : MpdNotifier(mpd_options),
+        time_shift_buffer_depth_(
+            mpd_options.mpd_params.time_shift_buffer_depth),
+        notifier_(std::move(notifier)) {}
+
+  // Replay |stream| to the notifier.
+  bool Restore(const LiveCheckpointStream& stream) {
+    MediaInfo media_info;
+    if (!media_info.ParseFromString(stream.media_info()))
+      return false;
+    uint32_t container_id = 0;
+    if (!notifier_->NotifyNewContainer(media_info, &container_id) ||
+        !notifier_->SetStartNumber(container_id,
+                                   stream.num_removed_segments() + 1)) {
+      return false;
+    }
+    {
+      base::AutoLock auto_lock(lock_);
+      StreamState* state = &containers_[container_id];
+      InitStreamState(media_info, state);
+      RestoreStreamState(stream, state);
+      restored_containers_[stream.segment_template()] = container_id;
+    }
+    if (stream.has_sample_duration() &&
+        !NotifySampleDuration(container_id, stream.sample_duration())) {
+      return false;
+    }
+    for (const LiveCheckpointEvent& event : stream.events()) {
+      if (!Replay(container_id, event))
+        return false;
+    }
+    return true;
+  }
+
+  void Snapshot(StreamList* streams) {
+    base::AutoLock auto_lock(lock_);
+    for (const auto& entry : containers_)
+      *streams->Add() = entry.second.data;
+  }
+
+  bool Init() override { return notifier_->Init(); }
+
+  bool NotifyNewContainer(const MediaInfo& media_info,
+                          uint32_t* container_id) override {
+    // Only the segmented containers are live.
+    const std::string& segment_template = media_info.segment_template();
+    if (!segment_template.empty()) {
+      base::AutoLock auto_lock(lock_);
+      auto iter = restored_containers_.find(segment_template);
+      if (iter != restored_containers_.end()) {
+        *container_id = iter->second;
+        restored_containers_.erase(iter);
+        return true;
+      }
+    }
+    if (!notifier_->NotifyNewContainer(media_info, container_id))
+      return false;
+    if (!segment_template.empty()) {
+      base::AutoLock auto_lock(lock_);
+      InitStreamState(media_info, &containers_[*container_id]);
+    }
+    return true;
+  }
+
+  bool NotifySampleDuration(uint32_t container_id,
+                            uint32_t sample_duration) override {
+    if (!notifier_->NotifySampleDuration(container_id, sample_duration))
+      return false;
+    base::AutoLock auto_lock(lock_);
+    auto iter = containers_.find(container_id);
+    if (iter != containers_.end())
+      iter->second.data.set_sample_duration(sample_duration);
+    return true;
+  }
+
+  bool NotifyNewSegment(uint32_t container_id,
+                        uint64_t start_time,
+                        uint64_t duration,
+                        uint64_t size) override {
+    if (!notifier_->NotifyNewSegment(container_id, start_time, duration, size))
+      return false;
+    LiveCheckpointEvent event;
+    event.set_type(LiveCheckpointEvent::SEGMENT);
+    event.set_start_time(start_time);
+    event.set_duration(duration);
+    event.set_size(size);
+    Record(container_id, event);
+    return true;
+  }
+
+  bool NotifyCueEvent(uint32_t container_id, uint64_t timestamp) override {
+    if (!notifier_->NotifyCueEvent(container_id, timestamp))
+      return false;
+    LiveCheckpointEvent event;
+    event.set_type(LiveCheckpointEvent::CUE);
+    event.set_start_time(timestamp);
+    Record(container_id, event);
+    return true;
+  }
+
+  bool NotifyEncryptionUpdate(uint32_t container_id,
+                              const std::string& drm_uuid,
+                              const std::vector<uint8_t>& new_key_id,
+                              const std::vector<uint8_t>& new_pssh) override {
+    if (!notifier_->NotifyEncryptionUpdate(container_id, drm_uuid, new_key_id,
+                                           new_pssh)) {
+      return false;
+    }
+    LiveCheckpointEvent event;
+    event.set_type(LiveCheckpointEvent::ENCRYPTION_UPDATE);
+    event.set_system_id(drm_uuid);
+    event.set_key_id(new_key_id.data(), new_key_id.size());
+    event.set_protection_system_specific_data(new_pssh.data(),
+                                              new_pssh.size());
+    Record(container_id, event);
+    return true;
+  }
+
+  bool NotifyMediaInfoUpdate(uint32_t container_id,
+                             const MediaInfo& media_info) override {
+    if (!notifier_->NotifyMediaInfoUpdate(container_id, media_info))
+      return false;
+    base::AutoLock auto_lock(lock_);
+    auto iter = containers_.find(container_id);
+    if (iter != containers_.end())
+      media_info.SerializeToString(iter->second.data.mutable_media_info());
+    return true;
+  }
+
+  bool SetStartNumber(uint32_t container_id, uint32_t start_number) override {
+    return notifier_->SetStartNumber(container_id, start_number);
+  }
+
+  bool RemoveContainer(const std::string& segment_template) override {
+    if (!notifier_->RemoveContainer(segment_template))
+      return false;
+    base::AutoLock auto_lock(lock_);
+    restored_containers_.erase(segment_template);
+    for (auto iter = containers_.begin(); iter != containers_.end();) {
+      if (iter->second.data.segment_template() == segment_template)
+        iter = containers_.erase(iter);
+      else
+        ++iter;
+    }
+    return true;
+  }
+
+  bool GetAvailabilityStartTime(std::string* availability_start_time) override {
+    return notifier_->GetAvailabilityStartTime(availability_start_time);
+  }
+
+  bool SetAvailabilityStartTime(
+      const std::string& availability_start_time) override {
+    return notifier_->SetAvailabilityStartTime(availability_start_time);
+  }
+
+  bool Flush() override { return notifier_->Flush(); }
+
+  bool RequestFlush() override { return notifier_->RequestFlush(); }
+
+ private:
+  MpdRecorder(const MpdRecorder&) = delete;
+  MpdRecorder& operator=(const MpdRecorder&) = delete;
+
+  void Record(uint32_t container_id, const LiveCheckpointEvent& event) {
+    base::AutoLock auto_lock(lock_);
+    auto iter = containers_.find(container_id);
+    if (iter != containers_.end())
+      AddEvent(time_shift_buffer_depth_, event, &iter->second);
+  }
+
+  bool Replay(uint32_t container_id, const LiveCheckpointEvent& event) {
+    switch (event.type()) {
+      case LiveCheckpointEvent::SEGMENT:
+        return NotifyNewSegment(container_id, event.start_time(),
+                                event.duration(), event.size());
+      case LiveCheckpointEvent::CUE:
+        return NotifyCueEvent(container_id, event.start_time());
+      case LiveCheckpointEvent::ENCRYPTION_UPDATE:
+        return NotifyEncryptionUpdate(
+            container_id, event.system_id(), ToVector(event.key_id()),
+            ToVector(event.protection_system_specific_data()));
+      case LiveCheckpointEvent::KEY_FRAME:
+        break;
+    }
+    return false;
+  }
+
+  const double time_shift_buffer_depth_;
+  const std::unique_ptr<MpdNotifier> notifier_;
+
+  base::Lock lock_;
+  std::map<uint32_t, StreamState> containers_;
+  // The restored containers not yet notified again, by segment template.
+  std::map<std::string, uint32_t> restored_containers_;
+};
+
+LiveCheckpoint::LiveCheckpoint(const std::string& file_name)
+    : file_name_(file_name) {}
+
+LiveCheckpoint::~LiveCheckpoint() {}
+
+Status LiveCheckpoint::Load() {
+  std::string contents;
+  if (!File::ReadFileToString(file_name_.c_str(), &contents)) {
+    LOG(INFO) << "No live checkpoint in '" << file_name_
+              << "'. Starting a new session.";
+    return Status::OK;
+  }
+  std::unique_ptr<LiveCheckpointData> loaded(new LiveCheckpointData);
+  if (!loaded->ParseFromString(contents)) {
+    return Status(error::PARSER_FAILURE,
+                  "Invalid live checkpoint '" + file_name_ + "'.");
+  }
+
+  for (const StreamList* streams :
+       {&loaded->hls_streams(), &loaded->dash_streams()}) {
+    for (const LiveCheckpointStream& stream : *streams) {
+      ResumePoint& resume_point = resume_points_[stream.segment_template()];
+      resume_point.num_segments =
+          std::max(resume_point.num_segments, stream.num_segments());
+      resume_point.timestamp_offset_in_seconds =
+          stream.timestamp_offset_in_seconds();
+
+      MediaInfo media_info;
+      const int last_segment = FindLastSegment(stream.events());
+      if (last_segment >= 0 &&
+          media_info.ParseFromString(stream.media_info()) &&
+          media_info.reference_time_scale() > 0) {
+        const LiveCheckpointEvent& segment = stream.events(last_segment);
+        resume_point.end_time_in_seconds = std::max(
+            resume_point.end_time_in_seconds,
+            static_cast<double>(segment.start_time() + segment.duration()) /
+                media_info.reference_time_scale());
+      }
+    }
+  }
+  LOG(INFO) << "Resuming " << resume_points_.size()
+            << " streams from the live checkpoint '" << file_name_ << "'.";
+  loaded_ = std::move(loaded);
+  return Status::OK;
+}
+
+std::unique_ptr<hls::HlsNotifier> LiveCheckpoint::WrapHlsNotifier(
+    std::unique_ptr<hls::HlsNotifier> notifier) {
+  std::unique_ptr<HlsRecorder> recorder(new HlsRecorder(std::move(notifier)));
+  hls_recorder_ = recorder.get();
+  return std::move(recorder);
+}
+
+std::unique_ptr<MpdNotifier> LiveCheckpoint::WrapMpdNotifier(
+    const MpdOptions& mpd_options,
+    std::unique_ptr<MpdNotifier> notifier) {
+  std::unique_ptr<MpdRecorder> recorder(
+      new MpdRecorder(mpd_options, std::move(notifier)));
+  mpd_recorder_ = recorder.get();
+  return std::move(recorder);
+}
+
+Status LiveCheckpoint::Restore() {
+  if (!loaded_)
+    return Status::OK;
+
+  if (hls_recorder_) {
+    for (const LiveCheckpointStream& stream : loaded_->hls_streams()) {
+      if (!hls_recorder_->Restore(stream)) {
+        return Status(error::INVALID_ARGUMENT,
+                      "Failed to restore the HLS playlist " +
+                          stream.playlist_name() +
+                          " from the live checkpoint.");
+      }
+    }
+    if (!hls_recorder_->Flush())
+      return Status(error::INVALID_ARGUMENT, "Failed to flush Hls.");
+  }
+  if (mpd_recorder_) {
+    if (loaded_->has_availability_start_time()) {
+      mpd_recorder_->SetAvailabilityStartTime(
+          loaded_->availability_start_time());
+    }
+    for (const LiveCheckpointStream& stream : loaded_->dash_streams()) {
+      if (!mpd_recorder_->Restore(stream)) {
+        return Status(error::INVALID_ARGUMENT,
+                      "Failed to restore the DASH stream " +
+                          stream.segment_template() +
+                          " from the live checkpoint.");
+      }
+    }
+    if (!mpd_recorder_->Flush())
+      return Status(error::INVALID_ARGUMENT, "Failed to flush Mpd.");
+  }
+  return Status::OK;
+}
+
+uint32_t LiveCheckpoint::GetFirstSegmentIndex(
+    const std::string& segment_template) const {
+  auto iter = resume_points_.find(segment_template);
+  return iter == resume_points_.end() ? 0 : iter->second.num_segments;
+}
+
+void LiveCheckpoint::ResumeInput(
+    const std::vector<std::string>& segment_templates,
+    std::shared_ptr<Demuxer> demuxer) {
+  bool resumed = false;
+  double resume_time_in_seconds = 0;
+  double timestamp_offset_in_seconds = 0;
+  for (const std::string& segment_template : segment_templates) {
+    auto iter = resume_points_.find(segment_template);
+    if (iter == resume_points_.end())
+      continue;
+    resumed = true;
+    resume_time_in_seconds =
+        std::max(resume_time_in_seconds, iter->second.end_time_in_seconds);
+    timestamp_offset_in_seconds = iter->second.timestamp_offset_in_seconds;
+  }
+  if (resumed) {
+    demuxer->set_resume_time(resume_time_in_seconds,
+                             timestamp_offset_in_seconds);
+  }
+
+  base::AutoLock auto_lock(lock_);
+  for (const std::string& segment_template : segment_templates)
+    demuxers_[segment_template] = demuxer;
+}
+
+Status LiveCheckpoint::Write() {
+  LiveCheckpointData data;
+  std::string availability_start_time;
+  if (mpd_recorder_ &&
+      mpd_recorder_->GetAvailabilityStartTime(&availability_start_time)) {
+    data.set_availability_start_time(availability_start_time);
+  }
+  if (hls_recorder_)
+    hls_recorder_->Snapshot(data.mutable_hls_streams());
+  if (mpd_recorder_)
+    mpd_recorder_->Snapshot(data.mutable_dash_streams());
+
+  {
+    base::AutoLock auto_lock(lock_);
+    for (StreamList* streams :
+         {data.mutable_hls_streams(), data.mutable_dash_streams()}) {
+      for (LiveCheckpointStream& stream : *streams) {
+        auto iter = demuxers_.find(stream.segment_template());
+        if (iter != demuxers_.end()) {
+          stream.set_timestamp_offset_in_seconds(
+              iter->second->timestamp_offset_in_seconds());
+        }
+      }
+    }
+  }
+
+  std::string contents;
+  if (!data.SerializeToString(&contents) ||
+      !File::WriteFileAtomically(file_name_.c_str(), contents)) {
+    return Status(error::FILE_FAILURE,
+                  "Failed to write the live checkpoint '" + file_name_ + "'.");
+  }
+  return Status::OK;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,114 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_LIVE_CHECKPOINT_H_
+#define PACKAGER_APP_LIVE_CHECKPOINT_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+class LiveCheckpointData;
+class MpdNotifier;
+struct MpdOptions;
+
+namespace hls {
+class HlsNotifier;
+}  // namespace hls
+
+namespace media {
+
+class Demuxer;
+
+/// Checkpoints the state of a live packaging session to a file, so that the
+/// session resumes from it when the packager restarts, e.g. after a deploy or
+/// a crash, without losing the live window of its manifests.
+///
+/// The checkpoint records the notifier events of the segments in the live
+/// window, which are replayed to the notifiers on restart, with the numbers of
+/// the segments out of the window. The muxers then continue the segment
+/// numbering, and the demuxers shift the timestamps of the inputs to continue
+/// the timeline. The key periods of key rotation follow the timestamps.
+class LiveCheckpoint {
+ public:
+  /// @param file_name is the checkpoint file.
+  explicit LiveCheckpoint(const std::string& file_name);
+  ~LiveCheckpoint();
+
+  /// Read the checkpoint of the previous run of the session, if any.
+  /// @return OK if the checkpoint is read or does not exist.
+  Status Load();
+
+  /// @return A notifier which records the events passed to @a notifier.
+  std::unique_ptr<hls::HlsNotifier> WrapHlsNotifier(
+      std::unique_ptr<hls::HlsNotifier> notifier);
+
+  /// @return A notifier which records the events passed to @a notifier,
+  ///         which is created with @a mpd_options.
+  std::unique_ptr<MpdNotifier> WrapMpdNotifier(
+      const MpdOptions& mpd_options,
+      std::unique_ptr<MpdNotifier> notifier);
+
+  /// Replay the events of the loaded checkpoint to the wrapped notifiers,
+  /// which must be initialized. The streams later notified by the muxers with
+  /// the same playlist, for HLS, or segment template, for DASH, continue the
+  /// replayed streams.
+  Status Restore();
+
+  /// @return The number of segments of the stream with @a segment_template
+  ///         in the loaded checkpoint, i.e. the index of its next segment.
+  uint32_t GetFirstSegmentIndex(const std::string& segment_template) const;
+
+  /// Continue the timestamps of the input of @a demuxer from the loaded
+  /// checkpoint, see Demuxer::set_resume_time(), and record the shift of its
+  /// timestamps in the next checkpoints.
+  /// @param segment_templates are the segment templates of the streams of the
+  ///        input.
+  void ResumeInput(const std::vector<std::string>& segment_templates,
+                   std::shared_ptr<Demuxer> demuxer);
+
+  /// Write the checkpoint of the current state of the session atomically.
+  Status Write();
+
+ private:
+  LiveCheckpoint(const LiveCheckpoint&) = delete;
+  LiveCheckpoint& operator=(const LiveCheckpoint&) = delete;
+
+  class HlsRecorder;
+  class MpdRecorder;
+
+  // Where the streams of the loaded checkpoint stopped.
+  struct ResumePoint {
+    uint32_t num_segments = 0;
+    double end_time_in_seconds = 0;
+    double timestamp_offset_in_seconds = 0;
+  };
+
+  const std::string file_name_;
+  // The checkpoint read by Load().
+  std::unique_ptr<LiveCheckpointData> loaded_;
+  // The resume points of the loaded streams, by segment template.
+  std::map<std::string, ResumePoint> resume_points_;
+  // Owned by the callers of WrapHlsNotifier() and WrapMpdNotifier(), and must
+  // outlive this object.
+  HlsRecorder* hls_recorder_ = nullptr;
+  MpdRecorder* mpd_recorder_ = nullptr;
+
+  base::Lock lock_;
+  // The demuxers of the inputs, by the segment templates of their streams.
+  std::map<std::string, std::shared_ptr<Demuxer>> demuxers_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_LIVE_CHECKPOINT_H_
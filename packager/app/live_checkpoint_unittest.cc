@@ -0,0 +1,174 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/live_checkpoint.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/hls/base/hls_notifier.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/status_test_util.h"
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::InSequence;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kCheckpointFile[] = "memory://live_checkpoint";
+const char kSegmentTemplate[] = "video-$Number$.ts";
+const char kPlaylistName[] = "video.m3u8";
+const uint32_t kTimeScale = 1000;
+const uint64_t kSegmentDuration = 10 * kTimeScale;
+const uint64_t kSegmentSize = 1000;
+// The checkpoint keeps twice this window, i.e. 4 segments, and the segment
+// which started it.
+const double kTimeShiftBufferDepth = 20;
+
+class MockHlsNotifier : public hls::HlsNotifier {
+ public:
+  explicit MockHlsNotifier(const HlsParams& hls_params)
+      : HlsNotifier(hls_params) {}
+
+  MOCK_METHOD0(Init, bool());
+  MOCK_METHOD5(NotifyNewStream,
+               bool(const MediaInfo& media_info,
+                    const std::string& playlist_name,
+                    const std::string& name,
+                    const std::string& group_id,
+                    uint32_t* stream_id));
+  MOCK_METHOD2(NotifySampleDuration,
+               bool(uint32_t stream_id, uint32_t sample_duration));
+  MOCK_METHOD6(NotifyNewSegment,
+               bool(uint32_t stream_id,
+                    const std::string& segment_name,
+                    uint64_t start_time,
+                    uint64_t duration,
+                    uint64_t start_byte_offset,
+                    uint64_t size));
+  MOCK_METHOD6(NotifyNewPart,
+               bool(uint32_t stream_id,
+                    const std::string& segment_name,
+                    uint64_t start_time,
+                    uint64_t duration,
+                    uint64_t start_byte_offset,
+                    uint64_t size));
+  MOCK_METHOD4(NotifyKeyFrame,
+               bool(uint32_t stream_id,
+                    uint64_t timestamp,
+                    uint64_t start_byte_offset,
+                    uint64_t size));
+  MOCK_METHOD2(NotifyCueEvent, bool(uint32_t stream_id, uint64_t timestamp));
+  MOCK_METHOD5(
+      NotifyEncryptionUpdate,
+      bool(uint32_t stream_id,
+           const std::vector<uint8_t>& key_id,
+           const std::vector<uint8_t>& system_id,
+           const std::vector<uint8_t>& iv,
+           const std::vector<uint8_t>& protection_system_specific_data));
+  MOCK_METHOD3(SetSequenceNumbers,
+               bool(uint32_t stream_id,
+                    uint32_t media_sequence_number,
+                    int discontinuity_sequence_number));
+  MOCK_METHOD0(Flush, bool());
+};
+
+MediaInfo GetMediaInfo() {
+  MediaInfo media_info;
+  media_info.set_reference_time_scale(kTimeScale);
+  media_info.set_segment_template(kSegmentTemplate);
+  return media_info;
+}
+
+std::string GetSegmentName(int index) {
+  return "video-" + std::to_string(index + 1) + ".ts";
+}
+
+}  // namespace
+
+class LiveCheckpointTest : public ::testing::Test {
+ protected:
+  LiveCheckpointTest() {
+    hls_params_.time_shift_buffer_depth = kTimeShiftBufferDepth;
+  }
+
+  HlsParams hls_params_;
+};
+
+TEST_F(LiveCheckpointTest, NoCheckpoint) {
+  LiveCheckpoint checkpoint("memory://no_live_checkpoint");
+  ASSERT_OK(checkpoint.Load());
+  EXPECT_EQ(0u, checkpoint.GetFirstSegmentIndex(kSegmentTemplate));
+  ASSERT_OK(checkpoint.Restore());
+}
+
+TEST_F(LiveCheckpointTest, ResumeHlsStream) {
+  const int kNumSegments = 7;
+  {
+    LiveCheckpoint checkpoint(kCheckpointFile);
+    ASSERT_OK(checkpoint.Load());
+    std::unique_ptr<MockHlsNotifier> mock_notifier(
+        new MockHlsNotifier(hls_params_));
+    EXPECT_CALL(*mock_notifier, NotifyNewStream(_, kPlaylistName, _, _, _))
+        .WillOnce(DoAll(SetArgPointee<4>(1), Return(true)));
+    EXPECT_CALL(*mock_notifier, NotifyNewSegment(1, _, _, _, _, _))
+        .Times(kNumSegments)
+        .WillRepeatedly(Return(true));
+    std::unique_ptr<hls::HlsNotifier> notifier =
+        checkpoint.WrapHlsNotifier(std::move(mock_notifier));
+
+    uint32_t stream_id = 0;
+    ASSERT_TRUE(notifier->NotifyNewStream(GetMediaInfo(), kPlaylistName,
+                                          "video", "group", &stream_id));
+    for (int i = 0; i < kNumSegments; ++i) {
+      ASSERT_TRUE(notifier->NotifyNewSegment(stream_id, GetSegmentName(i),
+                                             i * kSegmentDuration,
+                                             kSegmentDuration, 0,
+                                             kSegmentSize));
+    }
+    ASSERT_OK(checkpoint.Write());
+  }
+
+  LiveCheckpoint checkpoint(kCheckpointFile);
+  ASSERT_OK(checkpoint.Load());
+  EXPECT_EQ(static_cast<uint32_t>(kNumSegments),
+            checkpoint.GetFirstSegmentIndex(kSegmentTemplate));
+
+  std::unique_ptr<MockHlsNotifier> mock_notifier(
+      new MockHlsNotifier(hls_params_));
+  {
+    InSequence in_sequence;
+    EXPECT_CALL(*mock_notifier,
+                NotifyNewStream(_, kPlaylistName, "video", "group", _))
+        .WillOnce(DoAll(SetArgPointee<4>(3), Return(true)));
+    EXPECT_CALL(*mock_notifier, SetSequenceNumbers(3, 2, 0))
+        .WillOnce(Return(true));
+    for (int i = 2; i < kNumSegments; ++i) {
+      EXPECT_CALL(*mock_notifier,
+                  NotifyNewSegment(3, GetSegmentName(i), i * kSegmentDuration,
+                                   kSegmentDuration, 0, kSegmentSize))
+          .WillOnce(Return(true));
+    }
+    EXPECT_CALL(*mock_notifier, Flush()).WillOnce(Return(true));
+  }
+  std::unique_ptr<hls::HlsNotifier> notifier =
+      checkpoint.WrapHlsNotifier(std::move(mock_notifier));
+  ASSERT_OK(checkpoint.Restore());
+
+  // The muxer of the stream continues the restored stream.
+  uint32_t stream_id = 0;
+  ASSERT_TRUE(notifier->NotifyNewStream(GetMediaInfo(), kPlaylistName, "video",
+                                        "group", &stream_id));
+  EXPECT_EQ(3u, stream_id);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,328 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/manifest_aggregator.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "packager/app/manifest_event.pb.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/hls/base/hls_notifier.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/base/mpd_notifier.h"
+
+namespace shaka {
+namespace {
+
+const char kEventsPath[] = "/events";
+// The start times of this many segments of each stream are kept for the
+// alignment checks, which covers the lag between the nodes.
+const size_t kMaxRecordedSegments = 64;
+
+std::string GetContentType(const MediaInfo& media_info) {
+  if (media_info.has_video_info())
+    return "video";
+  if (media_info.has_audio_info())
+    return "audio";
+  if (media_info.has_text_info())
+    return "text";
+  return std::string();
+}
+
+std::vector<uint8_t> ToVector(const std::string& bytes) {
+  return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+std::string ErrorResponse(const std::string& status,
+                          const std::string& error,
+                          std::string* response_body) {
+  *response_body = base::StringPrintf("{\"error\":\"%s\"}", error.c_str());
+  return status;
+}
+
+}  // namespace
+
+ManifestAggregator::ManifestAggregator(
+    std::unique_ptr<MpdNotifier> mpd_notifier,
+    std::unique_ptr<hls::HlsNotifier> hls_notifier,
+    double alignment_tolerance_in_seconds)
+    : mpd_notifier_(std::move(mpd_notifier)),
+      hls_notifier_(std::move(hls_notifier)),
+      alignment_tolerance_in_seconds_(alignment_tolerance_in_seconds) {}
+
+ManifestAggregator::~ManifestAggregator() {}
+
+Status ManifestAggregator::Init() {
+  if (mpd_notifier_ && !mpd_notifier_->Init()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Failed to initialize MpdNotifier.");
+  }
+  if (hls_notifier_ && !hls_notifier_->Init()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Failed to initialize HlsNotifier.");
+  }
+  return Status::OK;
+}
+
+Status ManifestAggregator::HandleEvents(const ManifestEventBatch& batch,
+                                        size_t* num_rejected_events) {
+  base::AutoLock auto_lock(lock_);
+  auto sequence_number = next_sequence_numbers_.find(batch.node_id());
+  if (sequence_number != next_sequence_numbers_.end()) {
+    if (batch.sequence_number() < sequence_number->second) {
+      VLOG(1) << "Ignoring batch " << batch.sequence_number() << " of "
+              << batch.node_id() << ", which was already received.";
+      if (num_rejected_events)
+        *num_rejected_events = 0;
+      return Status::OK;
+    }
+    if (batch.sequence_number() > sequence_number->second) {
+      LOG(WARNING) << "Missed batches " << sequence_number->second << " to "
+                   << batch.sequence_number() - 1 << " of "
+                   << batch.node_id() << ".";
+    }
+  }
+  next_sequence_numbers_[batch.node_id()] = batch.sequence_number() + 1;
+
+  size_t num_rejected = 0;
+  if (mpd_notifier_) {
+    for (const ManifestEvent& event : batch.dash_events()) {
+      if (!HandleDashEvent(event))
+        ++num_rejected;
+    }
+  }
+  if (hls_notifier_) {
+    for (const ManifestEvent& event : batch.hls_events()) {
+      if (!HandleHlsEvent(event))
+        ++num_rejected;
+    }
+  }
+  if (num_rejected > 0) {
+    LOG(WARNING) << "Rejected " << num_rejected << " events of "
+                 << batch.node_id() << ".";
+  }
+  if (num_rejected_events)
+    *num_rejected_events = num_rejected;
+
+  // The live HLS playlists are written with every segment.
+  if (mpd_notifier_ && batch.dash_events_size() > 0 &&
+      !mpd_notifier_->Flush()) {
+    return Status(error::FILE_FAILURE, "Failed to write the MPD.");
+  }
+  return Status::OK;
+}
+
+std::string ManifestAggregator::HandleRequest(const std::string& method,
+                                              const std::string& path,
+                                              const std::string& body,
+                                              std::string* response_body) {
+  if (path.substr(0, path.find('?')) != kEventsPath)
+    return ErrorResponse("404 Not Found", "Not found.", response_body);
+  if (method != "POST" && method != "PUT") {
+    return ErrorResponse("405 Method Not Allowed",
+                         "Only POST and PUT are supported.", response_body);
+  }
+  ManifestEventBatch batch;
+  if (!batch.ParseFromString(body)) {
+    return ErrorResponse("400 Bad Request", "Invalid event batch.",
+                         response_body);
+  }
+  size_t num_rejected_events = 0;
+  const Status status = HandleEvents(batch, &num_rejected_events);
+  if (!status.ok()) {
+    return ErrorResponse("500 Internal Server Error", status.error_message(),
+                         response_body);
+  }
+  *response_body = base::StringPrintf("{\"rejected_events\":%zu}",
+                                      num_rejected_events);
+  return "200 OK";
+}
+
+Status ManifestAggregator::Flush() {
+  base::AutoLock auto_lock(lock_);
+  if (mpd_notifier_ && !mpd_notifier_->Flush())
+    return Status(error::FILE_FAILURE, "Failed to write the MPD.");
+  if (hls_notifier_ && !hls_notifier_->Flush())
+    return Status(error::FILE_FAILURE, "Failed to write the HLS playlists.");
+  return Status::OK;
+}
+
+uint64_t ManifestAggregator::num_misaligned_segments() {
+  base::AutoLock auto_lock(lock_);
+  return num_misaligned_segments_;
+}
+
+bool ManifestAggregator::HandleDashEvent(const ManifestEvent& event) {
+  const std::string& segment_template = event.segment_template();
+  if (event.type() == ManifestEvent::NEW_STREAM) {
+    MediaInfo media_info;
+    if (!media_info.ParseFromString(event.media_info())) {
+      LOG(ERROR) << "Invalid MediaInfo of " << segment_template;
+      return false;
+    }
+    auto iter = dash_streams_.find(segment_template);
+    if (iter != dash_streams_.end()) {
+      // Announced again, e.g. by a restarted node, which continues it.
+      return iter->second.time_scale == media_info.reference_time_scale();
+    }
+    Stream stream;
+    if (!mpd_notifier_->NotifyNewContainer(media_info, &stream.id))
+      return false;
+    stream.time_scale = media_info.reference_time_scale();
+    stream.content_type = GetContentType(media_info);
+    dash_streams_[segment_template] = stream;
+    return true;
+  }
+  if (event.type() == ManifestEvent::REMOVE_STREAM) {
+    if (dash_streams_.erase(segment_template) == 0)
+      return false;
+    return mpd_notifier_->RemoveContainer(segment_template);
+  }
+
+  auto iter = dash_streams_.find(segment_template);
+  if (iter == dash_streams_.end()) {
+    LOG(ERROR) << "Unknown DASH stream " << segment_template;
+    return false;
+  }
+  Stream& stream = iter->second;
+  switch (event.type()) {
+    case ManifestEvent::SAMPLE_DURATION:
+      return mpd_notifier_->NotifySampleDuration(stream.id,
+                                                 event.sample_duration());
+    case ManifestEvent::SEGMENT:
+      if (stream.time_scale > 0) {
+        CheckAlignment(
+            segment_template,
+            static_cast<double>(event.start_time()) / stream.time_scale,
+            static_cast<double>(event.start_time() + event.duration()) /
+                stream.time_scale,
+            dash_streams_, &stream);
+      }
+      return mpd_notifier_->NotifyNewSegment(stream.id, event.start_time(),
+                                             event.duration(), event.size());
+    case ManifestEvent::CUE:
+      return mpd_notifier_->NotifyCueEvent(stream.id, event.start_time());
+    case ManifestEvent::ENCRYPTION_UPDATE:
+      return mpd_notifier_->NotifyEncryptionUpdate(
+          stream.id, event.system_id(), ToVector(event.key_id()),
+          ToVector(event.protection_system_specific_data()));
+    case ManifestEvent::MEDIA_INFO_UPDATE: {
+      MediaInfo media_info;
+      return media_info.ParseFromString(event.media_info()) &&
+             mpd_notifier_->NotifyMediaInfoUpdate(stream.id, media_info);
+    }
+    case ManifestEvent::NEW_STREAM:
+    case ManifestEvent::REMOVE_STREAM:
+      break;
+  }
+  return false;
+}
+
+bool ManifestAggregator::HandleHlsEvent(const ManifestEvent& event) {
+  const std::string& segment_template = event.segment_template();
+  if (event.type() == ManifestEvent::NEW_STREAM) {
+    MediaInfo media_info;
+    if (!media_info.ParseFromString(event.media_info())) {
+      LOG(ERROR) << "Invalid MediaInfo of " << segment_template;
+      return false;
+    }
+    auto iter = hls_streams_.find(segment_template);
+    if (iter != hls_streams_.end()) {
+      // Announced again, e.g. by a restarted node, which continues it.
+      return iter->second.time_scale == media_info.reference_time_scale();
+    }
+    Stream stream;
+    if (!hls_notifier_->NotifyNewStream(media_info, event.playlist_name(),
+                                        event.stream_name(), event.group_id(),
+                                        &stream.id)) {
+      return false;
+    }
+    stream.time_scale = media_info.reference_time_scale();
+    stream.content_type = GetContentType(media_info);
+    hls_streams_[segment_template] = stream;
+    return true;
+  }
+  if (event.type() == ManifestEvent::REMOVE_STREAM) {
+    if (hls_streams_.erase(segment_template) == 0)
+      return false;
+    return hls_notifier_->RemoveStream(segment_template);
+  }
+
+  auto iter = hls_streams_.find(segment_template);
+  if (iter == hls_streams_.end()) {
+    LOG(ERROR) << "Unknown HLS stream " << segment_template;
+    return false;
+  }
+  Stream& stream = iter->second;
+  switch (event.type()) {
+    case ManifestEvent::SAMPLE_DURATION:
+      return hls_notifier_->NotifySampleDuration(stream.id,
+                                                 event.sample_duration());
+    case ManifestEvent::SEGMENT:
+      if (stream.time_scale > 0) {
+        CheckAlignment(
+            segment_template,
+            static_cast<double>(event.start_time()) / stream.time_scale,
+            static_cast<double>(event.start_time() + event.duration()) /
+                stream.time_scale,
+            hls_streams_, &stream);
+      }
+      return hls_notifier_->NotifyNewSegment(
+          stream.id, event.segment_name(), event.start_time(),
+          event.duration(), event.start_byte_offset(), event.size());
+    case ManifestEvent::CUE:
+      return hls_notifier_->NotifyCueEvent(stream.id, event.start_time());
+    case ManifestEvent::ENCRYPTION_UPDATE:
+      return hls_notifier_->NotifyEncryptionUpdate(
+          stream.id, ToVector(event.key_id()), ToVector(event.system_id()),
+          ToVector(event.iv()),
+          ToVector(event.protection_system_specific_data()));
+    case ManifestEvent::NEW_STREAM:
+    case ManifestEvent::MEDIA_INFO_UPDATE:
+    case ManifestEvent::REMOVE_STREAM:
+      break;
+  }
+  return false;
+}
+
+void ManifestAggregator::CheckAlignment(const std::string& segment_template,
+                                        double start_time,
+                                        double end_time,
+                                        const StreamMap& streams,
+                                        Stream* stream) {
+  for (const auto& entry : streams) {
+    const Stream& other = entry.second;
+    if (&other == stream || other.content_type != stream->content_type ||
+        other.segment_start_times.empty()) {
+      continue;
+    }
+    // Only the segments within the recorded segments of the other stream
+    // are checked. The other stream checks the segments it adds later.
+    if (start_time < *other.segment_start_times.begin() ||
+        start_time >= other.end_time) {
+      continue;
+    }
+    auto iter = other.segment_start_times.lower_bound(
+        start_time - alignment_tolerance_in_seconds_);
+    if (iter == other.segment_start_times.end() ||
+        *iter > start_time + alignment_tolerance_in_seconds_) {
+      LOG(WARNING) << "The segment of " << segment_template << " at "
+                   << start_time << "s is not aligned with the segments of "
+                   << entry.first << ".";
+      ++num_misaligned_segments_;
+      break;
+    }
+  }
+
+  stream->segment_start_times.insert(start_time);
+  if (stream->segment_start_times.size() > kMaxRecordedSegments)
+    stream->segment_start_times.erase(stream->segment_start_times.begin());
+  stream->end_time = std::max(stream->end_time, end_time);
+}
+
+}  // namespace shaka
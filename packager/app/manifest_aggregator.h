@@ -0,0 +1,120 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_MANIFEST_AGGREGATOR_H_
+#define PACKAGER_APP_MANIFEST_AGGREGATOR_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+class ManifestEvent;
+class ManifestEventBatch;
+class MpdNotifier;
+
+namespace hls {
+class HlsNotifier;
+}  // namespace hls
+
+/// Builds the MPD and the HLS playlists of a live channel whose streams are
+/// packaged on several nodes, from the notifier events the nodes publish with
+/// ManifestEventPublisher. The streams are identified by their segment
+/// templates, which must be unique across the nodes, and their segment names
+/// must be valid for the aggregated manifests, e.g. on a shared storage.
+///
+/// The segments of the streams of a type, i.e. video, audio or text, are
+/// checked to start at the same times, as the players switch between the
+/// streams at the segment boundaries. The misaligned segments are still
+/// added, and reported. This class is thread safe.
+class ManifestAggregator {
+ public:
+  /// @param mpd_notifier builds the MPD. It may be null.
+  /// @param hls_notifier builds the HLS playlists. It may be null.
+  /// @param alignment_tolerance_in_seconds is how far apart the starts of
+  ///        aligned segments may be.
+  ManifestAggregator(std::unique_ptr<MpdNotifier> mpd_notifier,
+                     std::unique_ptr<hls::HlsNotifier> hls_notifier,
+                     double alignment_tolerance_in_seconds);
+  ~ManifestAggregator();
+
+  /// Initialize the notifiers.
+  Status Init();
+
+  /// Apply the events of a node to the manifests. The batches of a node
+  /// received more than once are ignored. The invalid events, e.g. of an
+  /// unknown stream, are logged and skipped, so that the node does not send
+  /// them again.
+  /// @param num_rejected_events gets the number of invalid events. It may be
+  ///        null.
+  Status HandleEvents(const ManifestEventBatch& batch,
+                      size_t* num_rejected_events);
+
+  /// Handle a request of the aggregation API:
+  ///   POST or PUT /events applies a serialized ManifestEventBatch.
+  /// The response is a JSON object with the number of rejected events. It
+  /// matches MetricsServer::RequestHandler.
+  std::string HandleRequest(const std::string& method,
+                            const std::string& path,
+                            const std::string& body,
+                            std::string* response_body);
+
+  /// Write the manifests with all the events received.
+  Status Flush();
+
+  /// @return The number of segments which were not aligned with the segments
+  ///         of the other streams of their type.
+  uint64_t num_misaligned_segments();
+
+ private:
+  ManifestAggregator(const ManifestAggregator&) = delete;
+  ManifestAggregator& operator=(const ManifestAggregator&) = delete;
+
+  // A stream of the MPD or of the HLS playlists.
+  struct Stream {
+    uint32_t id = 0;
+    uint32_t time_scale = 0;
+    std::string content_type;
+    // The start times of the last segments, in seconds.
+    std::set<double> segment_start_times;
+    double end_time = 0;
+  };
+  typedef std::map<std::string, Stream> StreamMap;
+
+  // |lock_| must be held.
+  bool HandleDashEvent(const ManifestEvent& event);
+  bool HandleHlsEvent(const ManifestEvent& event);
+  // Check that the segment at |start_time| and |end_time|, in seconds, of
+  // |stream| is aligned with the other |streams|, and record it.
+  void CheckAlignment(const std::string& segment_template,
+                      double start_time,
+                      double end_time,
+                      const StreamMap& streams,
+                      Stream* stream);
+
+  const std::unique_ptr<MpdNotifier> mpd_notifier_;
+  const std::unique_ptr<hls::HlsNotifier> hls_notifier_;
+  const double alignment_tolerance_in_seconds_;
+
+  base::Lock lock_;
+  // The following are protected by |lock_|.
+  StreamMap dash_streams_;
+  StreamMap hls_streams_;
+  // The sequence number of the next batch of each node.
+  std::map<std::string, uint64_t> next_sequence_numbers_;
+  uint64_t num_misaligned_segments_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_MANIFEST_AGGREGATOR_H_
@@ -0,0 +1,170 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/manifest_aggregator.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/app/manifest_event.pb.h"
+#include "packager/app/manifest_event_publisher.h"
+#include "packager/file/file.h"
+#include "packager/hls/base/hls_notifier.h"
+#include "packager/mpd/base/mock_mpd_notifier.h"
+#include "packager/status_test_util.h"
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+namespace shaka {
+namespace {
+
+const char kEventsUrl[] = "memory://manifest_events";
+const char kVideoTemplate[] = "video_$Number$.m4s";
+const char kOtherVideoTemplate[] = "video_hd_$Number$.m4s";
+const uint32_t kTimeScale = 1000;
+const uint64_t kSegmentDuration = 2 * kTimeScale;
+const uint64_t kSegmentSize = 1000;
+const double kAlignmentTolerance = 0.01;
+
+MediaInfo GetVideoMediaInfo(const std::string& segment_template) {
+  MediaInfo media_info;
+  media_info.set_reference_time_scale(kTimeScale);
+  media_info.set_segment_template(segment_template);
+  media_info.mutable_video_info()->set_width(1280);
+  return media_info;
+}
+
+ManifestEvent NewStreamEvent(const std::string& segment_template) {
+  ManifestEvent event;
+  event.set_type(ManifestEvent::NEW_STREAM);
+  event.set_segment_template(segment_template);
+  GetVideoMediaInfo(segment_template)
+      .SerializeToString(event.mutable_media_info());
+  return event;
+}
+
+ManifestEvent SegmentEvent(const std::string& segment_template,
+                           uint64_t start_time) {
+  ManifestEvent event;
+  event.set_type(ManifestEvent::SEGMENT);
+  event.set_segment_template(segment_template);
+  event.set_start_time(start_time);
+  event.set_duration(kSegmentDuration);
+  event.set_size(kSegmentSize);
+  return event;
+}
+
+}  // namespace
+
+class ManifestAggregatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::unique_ptr<MockMpdNotifier> mpd_notifier(
+        new MockMpdNotifier(mpd_options_));
+    mpd_notifier_ = mpd_notifier.get();
+    EXPECT_CALL(*mpd_notifier_, Init()).WillOnce(Return(true));
+    EXPECT_CALL(*mpd_notifier_, Flush()).WillRepeatedly(Return(true));
+    aggregator_.reset(new ManifestAggregator(
+        std::move(mpd_notifier), nullptr, kAlignmentTolerance));
+    ASSERT_OK(aggregator_->Init());
+  }
+
+  MpdOptions mpd_options_;
+  MockMpdNotifier* mpd_notifier_ = nullptr;
+  std::unique_ptr<ManifestAggregator> aggregator_;
+};
+
+TEST_F(ManifestAggregatorTest, PublishedEvents) {
+  const uint32_t kNodeContainerId = 3;
+  const uint32_t kContainerId = 7;
+  std::unique_ptr<MockMpdNotifier> node_notifier(
+      new MockMpdNotifier(mpd_options_));
+  EXPECT_CALL(*node_notifier, NotifyNewContainer(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(kNodeContainerId), Return(true)));
+  EXPECT_CALL(*node_notifier,
+              NotifyNewSegment(kNodeContainerId, 0, kSegmentDuration,
+                               kSegmentSize))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*node_notifier, Flush()).WillOnce(Return(true));
+
+  ManifestEventPublisher publisher(kEventsUrl, "node");
+  std::unique_ptr<MpdNotifier> notifier =
+      publisher.WrapMpdNotifier(mpd_options_, std::move(node_notifier));
+  uint32_t container_id = 0;
+  ASSERT_TRUE(notifier->NotifyNewContainer(GetVideoMediaInfo(kVideoTemplate),
+                                           &container_id));
+  EXPECT_EQ(kNodeContainerId, container_id);
+  ASSERT_TRUE(notifier->NotifyNewSegment(container_id, 0, kSegmentDuration,
+                                         kSegmentSize));
+  ASSERT_TRUE(notifier->Flush());
+
+  std::string body;
+  ASSERT_TRUE(File::ReadFileToString(kEventsUrl, &body));
+  EXPECT_CALL(*mpd_notifier_, NotifyNewContainer(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(kContainerId), Return(true)));
+  EXPECT_CALL(*mpd_notifier_,
+              NotifyNewSegment(kContainerId, 0, kSegmentDuration,
+                               kSegmentSize))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mpd_notifier_, Flush()).WillOnce(Return(true));
+  std::string response_body;
+  EXPECT_EQ("200 OK",
+            aggregator_->HandleRequest("PUT", "/events", body, &response_body));
+  EXPECT_EQ("{\"rejected_events\":0}", response_body);
+
+  // Sent again, e.g. after a lost response.
+  EXPECT_EQ("200 OK",
+            aggregator_->HandleRequest("PUT", "/events", body, &response_body));
+}
+
+TEST_F(ManifestAggregatorTest, UnknownStream) {
+  ManifestEventBatch batch;
+  batch.set_node_id("node");
+  *batch.add_dash_events() = SegmentEvent(kVideoTemplate, 0);
+  size_t num_rejected_events = 0;
+  ASSERT_OK(aggregator_->HandleEvents(batch, &num_rejected_events));
+  EXPECT_EQ(1u, num_rejected_events);
+}
+
+TEST_F(ManifestAggregatorTest, MisalignedSegments) {
+  EXPECT_CALL(*mpd_notifier_, NotifyNewContainer(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(1), Return(true)))
+      .WillOnce(DoAll(SetArgPointee<1>(2), Return(true)));
+  EXPECT_CALL(*mpd_notifier_, NotifyNewSegment(_, _, _, _))
+      .WillRepeatedly(Return(true));
+
+  ManifestEventBatch first_node;
+  first_node.set_node_id("first");
+  *first_node.add_dash_events() = NewStreamEvent(kVideoTemplate);
+  for (int i = 0; i < 3; ++i) {
+    *first_node.add_dash_events() =
+        SegmentEvent(kVideoTemplate, i * kSegmentDuration);
+  }
+  ASSERT_OK(aggregator_->HandleEvents(first_node, nullptr));
+
+  ManifestEventBatch second_node;
+  second_node.set_node_id("second");
+  *second_node.add_dash_events() = NewStreamEvent(kOtherVideoTemplate);
+  *second_node.add_dash_events() =
+      SegmentEvent(kOtherVideoTemplate, kSegmentDuration);
+  *second_node.add_dash_events() =
+      SegmentEvent(kOtherVideoTemplate, kSegmentDuration * 3 / 2);
+  ASSERT_OK(aggregator_->HandleEvents(second_node, nullptr));
+  EXPECT_EQ(1u, aggregator_->num_misaligned_segments());
+}
+
+TEST_F(ManifestAggregatorTest, InvalidRequest) {
+  std::string response_body;
+  EXPECT_EQ("400 Bad Request", aggregator_->HandleRequest(
+                                   "POST", "/events", "\xff", &response_body));
+  EXPECT_EQ("404 Not Found", aggregator_->HandleRequest(
+                                 "POST", "/sessions", "", &response_body));
+}
+
+}  // namespace shaka
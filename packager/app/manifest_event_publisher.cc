@@ -0,0 +1,425 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/manifest_event_publisher.h"
+
+#include <inttypes.h>
+
+#include <map>
+
+#include "packager/app/manifest_event.pb.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+#include "packager/hls/base/hls_notifier.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/base/mpd_notifier.h"
+#include "packager/mpd/base/mpd_options.h"
+
+namespace shaka {
+
+namespace {
+
+typedef google::protobuf::RepeatedPtrField<ManifestEvent> EventList;
+
+// The segment templates of the streams, by the ids of a notifier.
+class StreamTemplates {
+ public:
+  void Add(uint32_t stream_id, const std::string& segment_template) {
+    base::AutoLock auto_lock(lock_);
+    templates_[stream_id] = segment_template;
+  }
+
+  void Remove(const std::string& segment_template) {
+    base::AutoLock auto_lock(lock_);
+    for (auto iter = templates_.begin(); iter != templates_.end();) {
+      if (iter->second == segment_template)
+        iter = templates_.erase(iter);
+      else
+        ++iter;
+    }
+  }
+
+  // @return false if |stream_id| is not published.
+  bool Get(uint32_t stream_id, std::string* segment_template) {
+    base::AutoLock auto_lock(lock_);
+    auto iter = templates_.find(stream_id);
+    if (iter == templates_.end())
+      return false;
+    *segment_template = iter->second;
+    return true;
+  }
+
+ private:
+  base::Lock lock_;
+  std::map<uint32_t, std::string> templates_;
+};
+
+}  // namespace
+
+// Publishes the events of the HLS streams, and passes them on.
+class ManifestEventPublisher::HlsPublisher : public hls::HlsNotifier {
+ public:
+  HlsPublisher(ManifestEventPublisher* publisher,
+               std::unique_ptr<hls::HlsNotifier> notifier)
+      : HlsNotifier(notifier->hls_params()),
+        publisher_(publisher),
+        notifier_(std::move(notifier)) {}
+
+  bool Init() override { return notifier_->Init(); }
+
+  bool NotifyNewStream(const MediaInfo& media_info,
+                       const std::string& playlist_name,
+                       const std::string& stream_name,
+                       const std::string& group_id,
+                       uint32_t* stream_id) override {
+    if (!notifier_->NotifyNewStream(media_info, playlist_name, stream_name,
+                                    group_id, stream_id)) {
+      return false;
+    }
+    // Only the segmented streams can be identified across the nodes.
+    if (media_info.segment_template().empty())
+      return true;
+    templates_.Add(*stream_id, media_info.segment_template());
+    ManifestEvent event;
+    event.set_type(ManifestEvent::NEW_STREAM);
+    media_info.SerializeToString(event.mutable_media_info());
+    event.set_playlist_name(playlist_name);
+    event.set_stream_name(stream_name);
+    event.set_group_id(group_id);
+    Queue(*stream_id, &event);
+    return true;
+  }
+
+  bool NotifySampleDuration(uint32_t stream_id,
+                            uint32_t sample_duration) override {
+    if (!notifier_->NotifySampleDuration(stream_id, sample_duration))
+      return false;
+    ManifestEvent event;
+    event.set_type(ManifestEvent::SAMPLE_DURATION);
+    event.set_sample_duration(sample_duration);
+    Queue(stream_id, &event);
+    return true;
+  }
+
+  bool NotifyNewSegment(uint32_t stream_id,
+                        const std::string& segment_name,
+                        uint64_t start_time,
+                        uint64_t duration,
+                        uint64_t start_byte_offset,
+                        uint64_t size) override {
+    if (!notifier_->NotifyNewSegment(stream_id, segment_name, start_time,
+                                     duration, start_byte_offset, size)) {
+      return false;
+    }
+    ManifestEvent event;
+    event.set_type(ManifestEvent::SEGMENT);
+    event.set_segment_name(segment_name);
+    event.set_start_time(start_time);
+    event.set_duration(duration);
+    event.set_start_byte_offset(start_byte_offset);
+    event.set_size(size);
+    Queue(stream_id, &event);
+    // The live playlists are written with every segment, not on Flush().
+    publisher_->Publish();
+    return true;
+  }
+
+  // The aggregated playlists do not have partial segments.
+  bool NotifyNewPart(uint32_t stream_id,
+                     const std::string& segment_name,
+                     uint64_t start_time,
+                     uint64_t duration,
+                     uint64_t start_byte_offset,
+                     uint64_t size) override {
+    return notifier_->NotifyNewPart(stream_id, segment_name, start_time,
+                                    duration, start_byte_offset, size);
+  }
+
+  // Nor I-frame playlists.
+  bool NotifyKeyFrame(uint32_t stream_id,
+                      uint64_t timestamp,
+                      uint64_t start_byte_offset,
+                      uint64_t size) override {
+    return notifier_->NotifyKeyFrame(stream_id, timestamp, start_byte_offset,
+                                     size);
+  }
+
+  bool NotifyCueEvent(uint32_t stream_id, uint64_t timestamp) override {
+    if (!notifier_->NotifyCueEvent(stream_id, timestamp))
+      return false;
+    ManifestEvent event;
+    event.set_type(ManifestEvent::CUE);
+    event.set_start_time(timestamp);
+    Queue(stream_id, &event);
+    return true;
+  }
+
+  bool NotifyEncryptionUpdate(
+      uint32_t stream_id,
+      const std::vector<uint8_t>& key_id,
+      const std::vector<uint8_t>& system_id,
+      const std::vector<uint8_t>& iv,
+      const std::vector<uint8_t>& protection_system_specific_data) override {
+    if (!notifier_->NotifyEncryptionUpdate(stream_id, key_id, system_id, iv,
+                                           protection_system_specific_data)) {
+      return false;
+    }
+    ManifestEvent event;
+    event.set_type(ManifestEvent::ENCRYPTION_UPDATE);
+    event.set_key_id(key_id.data(), key_id.size());
+    event.set_system_id(system_id.data(), system_id.size());
+    event.set_iv(iv.data(), iv.size());
+    event.set_protection_system_specific_data(
+        protection_system_specific_data.data(),
+        protection_system_specific_data.size());
+    Queue(stream_id, &event);
+    return true;
+  }
+
+  bool SetSequenceNumbers(uint32_t stream_id,
+                          uint32_t media_sequence_number,
+                          int discontinuity_sequence_number) override {
+    return notifier_->SetSequenceNumbers(stream_id, media_sequence_number,
+                                         discontinuity_sequence_number);
+  }
+
+  bool RemoveStream(const std::string& segment_template) override {
+    if (!notifier_->RemoveStream(segment_template))
+      return false;
+    templates_.Remove(segment_template);
+    ManifestEvent event;
+    event.set_type(ManifestEvent::REMOVE_STREAM);
+    event.set_segment_template(segment_template);
+    publisher_->Queue(false, &event);
+    return true;
+  }
+
+  bool Flush() override {
+    const bool flushed = notifier_->Flush();
+    // The aggregator is not required for the local playlists.
+    publisher_->Publish();
+    return flushed;
+  }
+
+ private:
+  HlsPublisher(const HlsPublisher&) = delete;
+  HlsPublisher& operator=(const HlsPublisher&) = delete;
+
+  void Queue(uint32_t stream_id, ManifestEvent* event) {
+    if (templates_.Get(stream_id, event->mutable_segment_template()))
+      publisher_->Queue(false, event);
+  }
+
+  ManifestEventPublisher* const publisher_;
+  const std::unique_ptr<hls::HlsNotifier> notifier_;
+  StreamTemplates templates_;
+};
+
+// Publishes the events of the DASH containers with segment templates, and
+// passes them on.
+class ManifestEventPublisher::MpdPublisher : public MpdNotifier {
+ public:
+  MpdPublisher(const MpdOptions& mpd_options,
+               ManifestEventPublisher* publisher,
+               std::unique_ptr<MpdNotifier> notifier)
+      : MpdNotifier(mpd_options),
+        publisher_(publisher),
+        notifier_(std::move(notifier)) {}
+
+  bool Init() override { return notifier_->Init(); }
+
+  bool NotifyNewContainer(const MediaInfo& media_info,
+                          uint32_t* container_id) override {
+    if (!notifier_->NotifyNewContainer(media_info, container_id))
+      return false;
+    if (media_info.segment_template().empty())
+      return true;
+    templates_.Add(*container_id, media_info.segment_template());
+    ManifestEvent event;
+    event.set_type(ManifestEvent::NEW_STREAM);
+    media_info.SerializeToString(event.mutable_media_info());
+    Queue(*container_id, &event);
+    return true;
+  }
+
+  bool NotifySampleDuration(uint32_t container_id,
+                            uint32_t sample_duration) override {
+    if (!notifier_->NotifySampleDuration(container_id, sample_duration))
+      return false;
+    ManifestEvent event;
+    event.set_type(ManifestEvent::SAMPLE_DURATION);
+    event.set_sample_duration(sample_duration);
+    Queue(container_id, &event);
+    return true;
+  }
+
+  bool NotifyNewSegment(uint32_t container_id,
+                        uint64_t start_time,
+                        uint64_t duration,
+                        uint64_t size) override {
+    if (!notifier_->NotifyNewSegment(container_id, start_time, duration, size))
+      return false;
+    ManifestEvent event;
+    event.set_type(ManifestEvent::SEGMENT);
+    event.set_start_time(start_time);
+    event.set_duration(duration);
+    event.set_size(size);
+    Queue(container_id, &event);
+    return true;
+  }
+
+  bool NotifyCueEvent(uint32_t container_id, uint64_t timestamp) override {
+    if (!notifier_->NotifyCueEvent(container_id, timestamp))
+      return false;
+    ManifestEvent event;
+    event.set_type(ManifestEvent::CUE);
+    event.set_start_time(timestamp);
+    Queue(container_id, &event);
+    return true;
+  }
+
+  bool NotifyEncryptionUpdate(uint32_t container_id,
+                              const std::string& drm_uuid,
+                              const std::vector<uint8_t>& new_key_id,
+                              const std::vector<uint8_t>& new_pssh) override {
+    if (!notifier_->NotifyEncryptionUpdate(container_id, drm_uuid, new_key_id,
+                                           new_pssh)) {
+      return false;
+    }
+    ManifestEvent event;
+    event.set_type(ManifestEvent::ENCRYPTION_UPDATE);
+    event.set_system_id(drm_uuid);
+    event.set_key_id(new_key_id.data(), new_key_id.size());
+    event.set_protection_system_specific_data(new_pssh.data(),
+                                              new_pssh.size());
+    Queue(container_id, &event);
+    return true;
+  }
+
+  bool NotifyMediaInfoUpdate(uint32_t container_id,
+                             const MediaInfo& media_info) override {
+    if (!notifier_->NotifyMediaInfoUpdate(container_id, media_info))
+      return false;
+    ManifestEvent event;
+    event.set_type(ManifestEvent::MEDIA_INFO_UPDATE);
+    media_info.SerializeToString(event.mutable_media_info());
+    Queue(container_id, &event);
+    return true;
+  }
+
+  bool SetStartNumber(uint32_t container_id, uint32_t start_number) override {
+    return notifier_->SetStartNumber(container_id, start_number);
+  }
+
+  bool RemoveContainer(const std::string& segment_template) override {
+    if (!notifier_->RemoveContainer(segment_template))
+      return false;
+    templates_.Remove(segment_template);
+    ManifestEvent event;
+    event.set_type(ManifestEvent::REMOVE_STREAM);
+    event.set_segment_template(segment_template);
+    publisher_->Queue(true, &event);
+    return true;
+  }
+
+  bool GetAvailabilityStartTime(std::string* availability_start_time) override {
+    return notifier_->GetAvailabilityStartTime(availability_start_time);
+  }
+
+  bool SetAvailabilityStartTime(
+      const std::string& availability_start_time) override {
+    return notifier_->SetAvailabilityStartTime(availability_start_time);
+  }
+
+  bool Flush() override {
+    const bool flushed = notifier_->Flush();
+    // The aggregator is not required for the local MPD.
+    publisher_->Publish();
+    return flushed;
+  }
+
+  bool RequestFlush() override {
+    const bool flushed = notifier_->RequestFlush();
+    publisher_->Publish();
+    return flushed;
+  }
+
+ private:
+  MpdPublisher(const MpdPublisher&) = delete;
+  MpdPublisher& operator=(const MpdPublisher&) = delete;
+
+  void Queue(uint32_t container_id, ManifestEvent* event) {
+    if (templates_.Get(container_id, event->mutable_segment_template()))
+      publisher_->Queue(true, event);
+  }
+
+  ManifestEventPublisher* const publisher_;
+  const std::unique_ptr<MpdNotifier> notifier_;
+  StreamTemplates templates_;
+};
+
+ManifestEventPublisher::ManifestEventPublisher(const std::string& url,
+                                               const std::string& node_id)
+    : url_(url),
+      node_id_(base::StringPrintf(
+          "%s-%" PRId64, node_id.empty() ? "node" : node_id.c_str(),
+          base::Time::Now().ToInternalValue())),
+      pending_(new ManifestEventBatch) {}
+
+ManifestEventPublisher::~ManifestEventPublisher() {}
+
+std::unique_ptr<hls::HlsNotifier> ManifestEventPublisher::WrapHlsNotifier(
+    std::unique_ptr<hls::HlsNotifier> notifier) {
+  return std::unique_ptr<hls::HlsNotifier>(
+      new HlsPublisher(this, std::move(notifier)));
+}
+
+std::unique_ptr<MpdNotifier> ManifestEventPublisher::WrapMpdNotifier(
+    const MpdOptions& mpd_options,
+    std::unique_ptr<MpdNotifier> notifier) {
+  return std::unique_ptr<MpdNotifier>(
+      new MpdPublisher(mpd_options, this, std::move(notifier)));
+}
+
+bool ManifestEventPublisher::Publish() {
+  base::AutoLock publish_lock(publish_lock_);
+  while (true) {
+    if (!sending_) {
+      std::unique_ptr<ManifestEventBatch> batch(new ManifestEventBatch);
+      {
+        base::AutoLock auto_lock(lock_);
+        if (pending_->hls_events_size() == 0 &&
+            pending_->dash_events_size() == 0) {
+          return true;
+        }
+        batch.swap(pending_);
+      }
+      batch->set_node_id(node_id_);
+      batch->set_sequence_number(next_sequence_number_++);
+      sending_ = std::move(batch);
+    }
+    // A batch sent again keeps its sequence number, as it may have been
+    // received. The events queued since are sent in the next batch.
+    if (!File::WriteFileAtomically(url_.c_str(),
+                                   sending_->SerializeAsString())) {
+      LOG(WARNING) << "Failed to publish the manifest events to " << url_
+                   << ". They are sent again with the next segment.";
+      return false;
+    }
+    sending_.reset();
+  }
+}
+
+void ManifestEventPublisher::Queue(bool dash, ManifestEvent* event) {
+  base::AutoLock auto_lock(lock_);
+  EventList* events =
+      dash ? pending_->mutable_dash_events() : pending_->mutable_hls_events();
+  events->Add()->Swap(event);
+}
+
+}  // namespace shaka
@@ -0,0 +1,86 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_MANIFEST_EVENT_PUBLISHER_H_
+#define PACKAGER_APP_MANIFEST_EVENT_PUBLISHER_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+class ManifestEvent;
+class ManifestEventBatch;
+class MpdNotifier;
+struct MpdOptions;
+
+namespace hls {
+class HlsNotifier;
+}  // namespace hls
+
+/// Publishes the notifier events of the streams of a packager node to a
+/// ManifestAggregator, so that the streams of a live channel can be packaged
+/// on several nodes with a single MPD and HLS master playlist.
+///
+/// The events are queued by the wrapped notifiers, and sent when they are
+/// flushed, i.e. with every segment of a live stream. The events of a failed
+/// request are sent again with the next flush.
+class ManifestEventPublisher {
+ public:
+  /// @param url is where the batches of events are uploaded, e.g.
+  ///        http://<aggregator>:<port>/events.
+  /// @param node_id identifies the node. It is made unique to this run.
+  ManifestEventPublisher(const std::string& url, const std::string& node_id);
+  ~ManifestEventPublisher();
+
+  /// @return A notifier which publishes the events passed to @a notifier.
+  std::unique_ptr<hls::HlsNotifier> WrapHlsNotifier(
+      std::unique_ptr<hls::HlsNotifier> notifier);
+
+  /// @return A notifier which publishes the events passed to @a notifier,
+  ///         which is created with @a mpd_options.
+  std::unique_ptr<MpdNotifier> WrapMpdNotifier(
+      const MpdOptions& mpd_options,
+      std::unique_ptr<MpdNotifier> notifier);
+
+  /// Send the queued events, if any.
+  /// @return false if they could not be sent. They are kept for the next
+  ///         call.
+  bool Publish();
+
+ private:
+  ManifestEventPublisher(const ManifestEventPublisher&) = delete;
+  ManifestEventPublisher& operator=(const ManifestEventPublisher&) = delete;
+
+  class HlsPublisher;
+  class MpdPublisher;
+
+  // Queue |event| to be sent, with the DASH events if |dash| is true, or the
+  // HLS events otherwise.
+  void Queue(bool dash, ManifestEvent* event);
+
+  const std::string url_;
+  const std::string node_id_;
+
+  base::Lock lock_;
+  // The events not sent yet, protected by |lock_|.
+  std::unique_ptr<ManifestEventBatch> pending_;
+
+  // Serializes the requests, so that the batches arrive in order.
+  base::Lock publish_lock_;
+  // The batch being sent and the sequence number of the next batch, protected
+  // by |publish_lock_|.
+  std::unique_ptr<ManifestEventBatch> sending_;
+  uint64_t next_sequence_number_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_MANIFEST_EVENT_PUBLISHER_H_
@@ -19,6 +19,21 @@ DEFINE_uint64(
     "stages of content serving pipeline, so that the segments stay accessible "
     "as they may still be accessed by the player."
     "The segments are not removed if the value is zero.");
+DEFINE_double(bandwidth_estimation_window,
+              0,
+              "Duration, in seconds, of the sliding window of the latest "
+              "segments used to estimate the peak and average bitrates of "
+              "the streams in the manifests, e.g. for live streams whose "
+              "bitrate changes over time. The latest segment is always "
+              "included. All the segments are used if the value is zero. "
+              "The window is at most '--time_shift_buffer_depth' for live "
+              "streams.");
+DEFINE_bool(gzip_manifests,
+            false,
+            "Write a gzip copy of each manifest beside it, with a '.gz' "
+            "extension, compressed once per update, so that the origin can "
+            "serve the compressed manifests without compressing them per "
+            "request.");
 DEFINE_string(default_language,
               "",
               "For DASH, any audio/text tracks tagged with this language will "
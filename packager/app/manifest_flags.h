@@ -13,6 +13,8 @@
 
 DECLARE_double(time_shift_buffer_depth);
 DECLARE_uint64(preserved_segments_outside_live_window);
+DECLARE_double(bandwidth_estimation_window);
+DECLARE_bool(gzip_manifests);
 DECLARE_string(default_language);
 DECLARE_string(default_text_language);
 
@@ -0,0 +1,112 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/manifest_generator_util.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/file/file.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/util/mpd_writer.h"
+
+namespace shaka {
+
+ParallelRunner::ParallelRunner(size_t num_tasks,
+                               const std::function<void(size_t)>& task)
+    : num_tasks_(num_tasks), task_(task) {}
+
+ParallelRunner::~ParallelRunner() {}
+
+void ParallelRunner::RunOnThreads(size_t num_threads) {
+  num_threads = std::min(num_threads, num_tasks_);
+  if (num_threads <= 1) {
+    Run();
+    return;
+  }
+  std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads;
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back(
+        new base::DelegateSimpleThread(this, "ManifestWorker"));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads)
+    thread->Join();
+}
+
+void ParallelRunner::Run() {
+  while (true) {
+    size_t index = 0;
+    {
+      base::AutoLock auto_lock(lock_);
+      if (next_task_ >= num_tasks_)
+        return;
+      index = next_task_++;
+    }
+    task_(index);
+  }
+}
+
+bool ReadBatchFile(const std::string& batch_file,
+                   std::vector<ManifestJob>* jobs) {
+  std::string content;
+  if (!File::ReadFileToString(batch_file.c_str(), &content)) {
+    LOG(ERROR) << "Failed to read " << batch_file;
+    return false;
+  }
+  for (const std::string& line :
+       base::SplitString(content, "\n", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    if (line[0] == '#')
+      continue;
+    const size_t separator = line.find_first_of(" \t");
+    if (separator == std::string::npos) {
+      LOG(ERROR) << "Missing the input files in " << batch_file << ": "
+                 << line;
+      return false;
+    }
+    ManifestJob job;
+    job.output = line.substr(0, separator);
+    job.input_files =
+        base::SplitString(line.substr(separator), ",", base::TRIM_WHITESPACE,
+                          base::SPLIT_WANT_NONEMPTY);
+    jobs->push_back(job);
+  }
+  if (jobs->empty()) {
+    LOG(ERROR) << "No manifest listed in " << batch_file;
+    return false;
+  }
+  return true;
+}
+
+size_t GetNumWorkerThreads(int32_t num_worker_threads) {
+  // hardware_concurrency() may return 0 if it is not computable.
+  return num_worker_threads > 0
+             ? static_cast<size_t>(num_worker_threads)
+             : std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ReadMediaInfoFiles(const std::vector<std::string>& input_files,
+                        size_t num_threads,
+                        std::vector<std::unique_ptr<MediaInfo>>* media_infos) {
+  media_infos->clear();
+  media_infos->resize(input_files.size());
+  ParallelRunner read_runner(
+      input_files.size(), [&input_files, media_infos](size_t file_index) {
+        const std::string& file = input_files[file_index];
+        std::unique_ptr<MediaInfo> media_info(new MediaInfo);
+        if (!MpdWriter::ReadMediaInfoFile(file, media_info.get())) {
+          LOG(WARNING) << "Failed to read " << file << ", skipping.";
+          return;
+        }
+        (*media_infos)[file_index] = std::move(media_info);
+      });
+  read_runner.RunOnThreads(num_threads);
+}
+
+}  // namespace shaka
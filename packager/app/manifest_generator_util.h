@@ -0,0 +1,75 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// Utilities shared by mpd_generator and hls_generator, which generate
+// manifests from MediaInfo files.
+
+#ifndef PACKAGER_APP_MANIFEST_GENERATOR_UTIL_H_
+#define PACKAGER_APP_MANIFEST_GENERATOR_UTIL_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/simple_thread.h"
+
+namespace shaka {
+
+class MediaInfo;
+
+/// A manifest to generate, and the MediaInfo files of its streams.
+struct ManifestJob {
+  std::string output;
+  std::vector<std::string> input_files;
+};
+
+/// Runs a task for each index in [0, num_tasks) on a pool of threads.
+class ParallelRunner : public base::DelegateSimpleThread::Delegate {
+ public:
+  ParallelRunner(size_t num_tasks, const std::function<void(size_t)>& task);
+  ~ParallelRunner() override;
+
+  /// Run the tasks on at most @a num_threads threads, and wait for them. The
+  /// tasks are run on the calling thread if @a num_threads is at most 1.
+  void RunOnThreads(size_t num_threads);
+
+ private:
+  ParallelRunner(const ParallelRunner&) = delete;
+  ParallelRunner& operator=(const ParallelRunner&) = delete;
+
+  void Run() override;
+
+  const size_t num_tasks_;
+  const std::function<void(size_t)> task_;
+  base::Lock lock_;
+  size_t next_task_ = 0;
+};
+
+/// Read the manifests to generate from @a batch_file. Each line has the
+/// manifest output file name, whitespace, and the comma separated list of
+/// MediaInfo input files. Empty lines and lines starting with '#' are
+/// ignored.
+/// @return false if the file cannot be read or lists no manifest.
+bool ReadBatchFile(const std::string& batch_file,
+                   std::vector<ManifestJob>* jobs);
+
+/// @return The number of worker threads, which is the number of hardware
+///         threads if @a num_worker_threads is not positive.
+size_t GetNumWorkerThreads(int32_t num_worker_threads);
+
+/// Read @a input_files in parallel on @a num_threads threads. The files which
+/// cannot be read are logged, and left null in @a media_infos.
+void ReadMediaInfoFiles(const std::vector<std::string>& input_files,
+                        size_t num_threads,
+                        std::vector<std::unique_ptr<MediaInfo>>* media_infos);
+
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_MANIFEST_GENERATOR_UTIL_H_
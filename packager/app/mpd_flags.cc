@@ -20,8 +20,20 @@ DEFINE_bool(output_media_info,
             false,
             "Create a human readable format of MediaInfo. The output file name "
             "will be the name specified by output flag, suffixed with "
-            "'.media_info'.");
+            "'.media_info'. The segments of the outputs with a segment "
+            "template are recorded, so that mpd_generator can generate their "
+            "manifests.");
+DEFINE_bool(binary_media_info,
+            false,
+            "Write the MediaInfo of --output_media_info as binary protobuf "
+            "instead of text, which mpd_generator and hls_generator parse "
+            "much faster for long segment lists.");
 DEFINE_string(mpd_output, "", "MPD output file name.");
+DEFINE_string(mpd_patch_output,
+              "",
+              "MPD Patch output file name. If specified, a patch updating the "
+              "previous MPD to the current one is written with every MPD "
+              "update. For dynamic MPD only.");
 DEFINE_string(base_urls,
               "",
               "Comma separated BaseURLs for the MPD. The values will be added "
@@ -59,6 +71,13 @@ DEFINE_bool(
     "completely."
     "Ignored if $Time$ is used in segment template, since $Time$ requires "
     "accurate Segment Timeline.");
+DEFINE_bool(segment_template_constant_duration,
+            false,
+            "For live profile with $Number$ only. Generate "
+            "SegmentTemplate@duration instead of a SegmentTimeline while all "
+            "the segments in the window, except the last one, have the same "
+            "duration, within one sample. The SegmentTimeline is generated "
+            "again while a segment of another duration is in the window.");
 DEFINE_bool(allow_codec_switching,
             false,
             "If enabled, allow adaptive switching between different codecs, "
@@ -69,3 +88,9 @@ DEFINE_bool(include_mspr_pro_for_playready,
             "If enabled, PlayReady Object <mspr:pro> will be inserted into "
             "<ContentProtection ...> element alongside with <cenc:pssh> "
             "when using PlayReady protection system.");
+DEFINE_string(availability_start_time,
+              "",
+              "The availabilityStartTime of the dynamic MPD, as an xs:dateTime "
+              "in UTC, e.g. 2020-01-01T00:00:00Z. If not specified, it is "
+              "derived from the time of the first segment. Required with "
+              "--deterministic_output.");
@@ -13,7 +13,9 @@
 
 DECLARE_bool(generate_static_live_mpd);
 DECLARE_bool(output_media_info);
+DECLARE_bool(binary_media_info);
 DECLARE_string(mpd_output);
+DECLARE_string(mpd_patch_output);
 DECLARE_string(base_urls);
 DECLARE_double(minimum_update_period);
 DECLARE_double(min_buffer_time);
@@ -21,7 +23,9 @@ DECLARE_double(suggested_presentation_delay);
 DECLARE_string(utc_timings);
 DECLARE_bool(generate_dash_if_iop_compliant_mpd);
 DECLARE_bool(allow_approximate_segment_timeline);
+DECLARE_bool(segment_template_constant_duration);
 DECLARE_bool(allow_codec_switching);
 DECLARE_bool(include_mspr_pro_for_playready);
+DECLARE_string(availability_start_time);
 
 #endif  // APP_MPD_FLAGS_H_
@@ -4,8 +4,11 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
 
+#include "packager/app/manifest_generator_util.h"
 #include "packager/app/mpd_generator_flags.h"
 #include "packager/app/vlog_flags.h"
 #include "packager/base/at_exit.h"
@@ -13,6 +16,8 @@
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_split.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/hls/util/hls_writer.h"
+#include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/util/mpd_writer.h"
 #include "packager/tools/license_notice.h"
 #include "packager/version/version.h"
@@ -41,23 +46,45 @@ const char kUsage[] =
     "audio, and 1 text.\n"
     "Sample Usage:\n"
     "%s --input=\"video1.media_info,video2.media_info,audio1.media_info\" "
-    "--output=\"video_audio.mpd\"";
+    "--output=\"video_audio.mpd\"\n"
+    "Many MPDs can be generated at once, in parallel, with --batch.\n"
+    "The MediaInfo files of the time shards of the streams, see "
+    "--vod_time_shards, are merged, and HLS playlists can be generated as "
+    "well, with --hls_master_playlist_output.";
 
 enum ExitStatus {
   kSuccess = 0,
   kEmptyInputError,
   kEmptyOutputError,
-  kFailedToWriteMpdToFileError
+  kFailedToWriteMpdToFileError,
+  kInvalidBatchError,
+  kFailedToWriteHlsPlaylistsError
+};
+
+// An MPD to generate, and the HLS playlists of the same streams if
+// |hls_master_playlist_output| is set.
+struct MpdJob : ManifestJob {
+  std::string hls_master_playlist_output;
 };
 
 ExitStatus CheckRequiredFlags() {
+  if (!FLAGS_batch.empty()) {
+    if (!FLAGS_input.empty() || !FLAGS_output.empty() ||
+        !FLAGS_hls_master_playlist_output.empty()) {
+      LOG(ERROR) << "--batch cannot be used with --input, --output or "
+                    "--hls_master_playlist_output.";
+      return kInvalidBatchError;
+    }
+    return kSuccess;
+  }
+
   if (FLAGS_input.empty()) {
     LOG(ERROR) << "--input is required.";
     return kEmptyInputError;
   }
 
-  if (FLAGS_output.empty()) {
-    LOG(ERROR) << "--output is required.";
+  if (FLAGS_output.empty() && FLAGS_hls_master_playlist_output.empty()) {
+    LOG(ERROR) << "--output or --hls_master_playlist_output is required.";
     return kEmptyOutputError;
   }
 
@@ -67,31 +94,85 @@ ExitStatus CheckRequiredFlags() {
 ExitStatus RunMpdGenerator() {
   DCHECK_EQ(CheckRequiredFlags(), kSuccess);
   std::vector<std::string> base_urls;
-  typedef std::vector<std::string>::const_iterator Iterator;
 
-  std::vector<std::string> input_files = base::SplitString(
-      FLAGS_input, ",", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+  std::vector<MpdJob> jobs;
+  if (!FLAGS_batch.empty()) {
+    std::vector<ManifestJob> batch_jobs;
+    if (!ReadBatchFile(FLAGS_batch, &batch_jobs))
+      return kInvalidBatchError;
+    for (const ManifestJob& batch_job : batch_jobs) {
+      MpdJob job;
+      job.output = batch_job.output;
+      job.input_files = batch_job.input_files;
+      jobs.push_back(job);
+    }
+  } else {
+    MpdJob job;
+    job.output = FLAGS_output;
+    job.hls_master_playlist_output = FLAGS_hls_master_playlist_output;
+    job.input_files = base::SplitString(FLAGS_input, ",", base::KEEP_WHITESPACE,
+                                        base::SPLIT_WANT_ALL);
+    jobs.push_back(job);
+  }
 
   if (!FLAGS_base_urls.empty()) {
     base_urls = base::SplitString(FLAGS_base_urls, ",", base::KEEP_WHITESPACE,
                                   base::SPLIT_WANT_ALL);
   }
 
-  MpdWriter mpd_writer;
-  for (Iterator it = base_urls.begin(); it != base_urls.end(); ++it)
-    mpd_writer.AddBaseUrl(*it);
+  const size_t num_threads = GetNumWorkerThreads(FLAGS_num_worker_threads);
+  // The threads left over when there are fewer MPDs than threads read the
+  // MediaInfo files of each MPD in parallel.
+  const size_t num_threads_per_job = std::max<size_t>(
+      1, num_threads / std::min(num_threads, jobs.size()));
+
+  // Not std::vector<bool>, which cannot be written concurrently.
+  std::vector<char> job_succeeded(jobs.size(), false);
+  std::vector<char> hls_succeeded(jobs.size(), true);
+  ParallelRunner job_runner(jobs.size(), [&](size_t job_index) {
+    const MpdJob& job = jobs[job_index];
+    std::vector<std::unique_ptr<MediaInfo>> media_infos;
+    ReadMediaInfoFiles(job.input_files, num_threads_per_job, &media_infos);
+
+    if (!job.hls_master_playlist_output.empty()) {
+      hls::HlsWriter hls_writer;
+      for (const auto& media_info : media_infos) {
+        if (media_info)
+          hls_writer.AddMediaInfo(*media_info);
+      }
+      if (!hls_writer.WriteToFile(job.hls_master_playlist_output,
+                                  FLAGS_hls_base_url)) {
+        LOG(ERROR) << "Failed to write HLS playlists to "
+                   << job.hls_master_playlist_output;
+        hls_succeeded[job_index] = false;
+      }
+    }
 
-  for (const std::string& file : input_files) {
-    if (!mpd_writer.AddFile(file)) {
-      LOG(WARNING) << "MpdWriter failed to read " << file << ", skipping.";
+    if (!job.output.empty()) {
+      MpdWriter mpd_writer;
+      for (const std::string& base_url : base_urls)
+        mpd_writer.AddBaseUrl(base_url);
+      for (const auto& media_info : media_infos) {
+        if (media_info)
+          mpd_writer.AddMediaInfo(*media_info);
+      }
+      if (!mpd_writer.WriteMpdToFile(job.output.c_str())) {
+        LOG(ERROR) << "Failed to write MPD to " << job.output;
+        return;
+      }
     }
-  }
+    job_succeeded[job_index] = true;
+  });
+  job_runner.RunOnThreads(num_threads);
 
-  if (!mpd_writer.WriteMpdToFile(FLAGS_output.c_str())) {
-    LOG(ERROR) << "Failed to write MPD to " << FLAGS_output;
-    return kFailedToWriteMpdToFileError;
+  for (char succeeded : job_succeeded) {
+    if (!succeeded)
+      return kFailedToWriteMpdToFileError;
+  }
+  for (char succeeded : hls_succeeded) {
+    if (!succeeded)
+      return kFailedToWriteHlsPlaylistsError;
   }
-
   return kSuccess;
 }
 
@@ -10,9 +10,32 @@
 #include <gflags/gflags.h>
 
 DEFINE_string(input, "", "Comma separated list of MediaInfo input files.");
-DEFINE_string(output, "", "MPD output file name.");
+DEFINE_string(output,
+              "",
+              "MPD output file name. Optional with "
+              "--hls_master_playlist_output.");
 DEFINE_string(base_urls,
               "",
               "Comma separated BaseURLs for the MPD. The values will be added "
               "as <BaseURL> element(s) immediately under the <MPD> element.");
+DEFINE_string(batch,
+              "",
+              "File listing the MPDs to generate, instead of --input and "
+              "--output. Each line has the MPD output file name, whitespace, "
+              "and the comma separated list of MediaInfo input files. Empty "
+              "lines and lines starting with '#' are ignored.");
+DEFINE_int32(num_worker_threads,
+             0,
+             "Number of threads reading the MediaInfo files and writing the "
+             "MPDs. 0 uses the number of hardware threads.");
+DEFINE_string(hls_master_playlist_output,
+              "",
+              "HLS master playlist output file name. The media playlists are "
+              "written next to it. Requires MediaInfo files which record the "
+              "segments of the streams, i.e. of outputs with a segment "
+              "template. Cannot be used with --batch.");
+DEFINE_string(hls_base_url,
+              "",
+              "The base URL of the HLS media playlists and segments. They are "
+              "relative to the master playlist if it is empty.");
 #endif  // APP_MPD_GENERATOR_FLAGS_H_
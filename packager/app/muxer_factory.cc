@@ -6,6 +6,7 @@
 
 #include "packager/app/muxer_factory.h"
 
+#include "packager/app/live_checkpoint.h"
 #include "packager/base/time/clock.h"
 #include "packager/media/base/muxer.h"
 #include "packager/media/base/muxer_options.h"
@@ -22,20 +23,72 @@ MuxerFactory::MuxerFactory(const PackagingParams& packaging_params)
     : mp4_params_(packaging_params.mp4_output_params),
       transport_stream_timestamp_offset_ms_(
           packaging_params.transport_stream_timestamp_offset_ms),
+      webm_single_pass_single_segment_(
+          packaging_params.webm_single_pass_single_segment),
       temp_dir_(packaging_params.temp_dir) {}
 
 std::shared_ptr<Muxer> MuxerFactory::CreateMuxer(
     MediaContainerName output_format,
     const StreamDescriptor& stream) {
+  return CreateMuxerWithOptions(output_format, GetMuxerOptions(stream));
+}
+
+std::shared_ptr<Muxer> MuxerFactory::CreateTimeSliceMuxer(
+    MediaContainerName output_format,
+    const StreamDescriptor& stream,
+    uint32_t first_segment_index) {
+  if ((output_format != CONTAINER_MOV && output_format != CONTAINER_MPEG2TS) ||
+      stream.segment_template.empty()) {
+    LOG(ERROR) << "Time slices are only supported for MP4 and MPEG-2 TS "
+                  "segment templates.";
+    return nullptr;
+  }
+  MuxerOptions options = GetMuxerOptions(stream);
+  options.time_slice = true;
+  options.first_segment_index = first_segment_index;
+  return CreateMuxerWithOptions(output_format, options);
+}
+
+std::shared_ptr<Muxer> MuxerFactory::CreateTimeShardMuxer(
+    MediaContainerName output_format,
+    const StreamDescriptor& stream,
+    uint32_t first_segment_index,
+    uint32_t shard_index,
+    uint32_t num_shards) {
+  if ((output_format != CONTAINER_MOV && output_format != CONTAINER_MPEG2TS) ||
+      stream.segment_template.empty()) {
+    LOG(ERROR) << "Time shards are only supported for MP4 and MPEG-2 TS "
+                  "segment templates.";
+    return nullptr;
+  }
+  MuxerOptions options = GetMuxerOptions(stream);
+  options.time_slice = true;
+  options.first_segment_index = first_segment_index;
+  options.time_shard_index = shard_index;
+  options.num_time_shards = num_shards;
+  return CreateMuxerWithOptions(output_format, options);
+}
+
+MuxerOptions MuxerFactory::GetMuxerOptions(const StreamDescriptor& stream) {
   MuxerOptions options;
   options.mp4_params = mp4_params_;
   options.transport_stream_timestamp_offset_ms =
       transport_stream_timestamp_offset_ms_;
+  options.webm_single_pass_single_segment = webm_single_pass_single_segment_;
   options.temp_dir = temp_dir_;
   options.output_file_name = stream.output;
   options.segment_template = stream.segment_template;
   options.bandwidth = stream.bandwidth;
+  if (live_checkpoint_) {
+    options.first_segment_index =
+        live_checkpoint_->GetFirstSegmentIndex(stream.segment_template);
+  }
+  return options;
+}
 
+std::shared_ptr<Muxer> MuxerFactory::CreateMuxerWithOptions(
+    MediaContainerName output_format,
+    const MuxerOptions& options) {
   std::shared_ptr<Muxer> muxer;
 
   switch (output_format) {
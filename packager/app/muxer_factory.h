@@ -23,8 +23,10 @@ struct StreamDescriptor;
 
 namespace media {
 
+class LiveCheckpoint;
 class Muxer;
 class MuxerListener;
+struct MuxerOptions;
 
 /// To make it easier to create muxers, this factory allows for all
 /// configuration to be set at the factory level so that when a function
@@ -38,18 +40,52 @@ class MuxerFactory {
   std::shared_ptr<Muxer> CreateMuxer(MediaContainerName output_format,
                                      const StreamDescriptor& stream);
 
+  /// Create a new muxer for a time slice of the given stream, see
+  /// MuxerOptions.time_slice. Only MP4 and MPEG-2 TS outputs with a segment
+  /// template are supported.
+  /// @param first_segment_index is the index of the first segment of the
+  ///        slice.
+  std::shared_ptr<Muxer> CreateTimeSliceMuxer(MediaContainerName output_format,
+                                              const StreamDescriptor& stream,
+                                              uint32_t first_segment_index);
+
+  /// Create a new muxer for a time shard of the given stream, see
+  /// PackagingParams.num_vod_time_shards, which is muxed as a time slice.
+  /// @param first_segment_index is the index of the first segment of the
+  ///        shard.
+  /// @param shard_index is the index of the shard.
+  /// @param num_shards is the number of shards of the stream.
+  std::shared_ptr<Muxer> CreateTimeShardMuxer(MediaContainerName output_format,
+                                              const StreamDescriptor& stream,
+                                              uint32_t first_segment_index,
+                                              uint32_t shard_index,
+                                              uint32_t num_shards);
+
   /// For testing, if you need to replace the clock that muxers work with
   /// this will replace the clock for all muxers created after this call.
   void OverrideClock(base::Clock* clock);
 
+  /// Continue the segment numbering of the streams of @a live_checkpoint in
+  /// the muxers created after this call.
+  void SetLiveCheckpoint(const LiveCheckpoint* live_checkpoint) {
+    live_checkpoint_ = live_checkpoint;
+  }
+
  private:
   MuxerFactory(const MuxerFactory&) = delete;
   MuxerFactory& operator=(const MuxerFactory&) = delete;
 
+  MuxerOptions GetMuxerOptions(const StreamDescriptor& stream);
+  std::shared_ptr<Muxer> CreateMuxerWithOptions(
+      MediaContainerName output_format,
+      const MuxerOptions& options);
+
   const Mp4OutputParams mp4_params_;
   const uint32_t transport_stream_timestamp_offset_ms_ = 0;
+  const bool webm_single_pass_single_segment_ = false;
   const std::string temp_dir_;
   base::Clock* clock_ = nullptr;
+  const LiveCheckpoint* live_checkpoint_ = nullptr;
 };
 
 }  // namespace media
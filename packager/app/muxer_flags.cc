@@ -34,6 +34,29 @@ DEFINE_bool(fragment_sap_aligned,
             true,
             "Force fragments to begin with stream access points. This flag "
             "implies segment_sap_aligned.");
+DEFINE_int32(low_latency_chunk_num_frames,
+             0,
+             "MP4 with segment_template only: write each segment out in "
+             "chunks of this many frames, each chunk being a 'moof' + 'mdat' "
+             "pair which is flushed to the output as soon as it is complete, "
+             "for low latency streaming. Media segments written in chunks do "
+             "not have a 'sidx' box. Can be combined with "
+             "low_latency_chunk_duration.");
+DEFINE_double(low_latency_chunk_duration,
+              0,
+              "MP4 with segment_template only: write each segment out in "
+              "chunks of about this duration in seconds, e.g. 0.2. See "
+              "low_latency_chunk_num_frames.");
+DEFINE_uint64(low_latency_chunk_target_bytes,
+              0,
+              "With low_latency_chunk_duration, which is then the maximum "
+              "chunk duration: also end a chunk once its samples add up to "
+              "this many bytes, so the chunks are shorter where the bitrate "
+              "peaks, e.g. on scene changes.");
+DEFINE_double(low_latency_chunk_min_duration,
+              0,
+              "The minimum duration in seconds of the chunks ended by "
+              "low_latency_chunk_target_bytes.");
 DEFINE_bool(generate_sidx_in_media_segments,
             true,
             "For ISO BMFF with DASH live profile only. Indicates whether to "
@@ -46,6 +69,43 @@ DEFINE_string(temp_dir,
 DEFINE_bool(mp4_include_pssh_in_stream,
             true,
             "MP4 only: include pssh in the encrypted stream.");
+DEFINE_bool(mp4_scatter_gather_output,
+            false,
+            "MP4 only: write the sample data of the fragments directly from "
+            "the sample buffers using vectored writes, instead of copying it "
+            "into an intermediate fragment buffer.");
+DEFINE_bool(mp4_single_pass_single_segment,
+            false,
+            "MP4 with single segment (on-demand) output only: reserve space "
+            "for the index at the start of the output file and write the "
+            "file in a single pass, instead of going through a temporary "
+            "file. Falls back to the temporary file if the reserved space "
+            "turns out to be too small.");
+DEFINE_bool(mp4_async_segment_write,
+            false,
+            "MP4 with segment_template only: write the completed segment "
+            "files on the I/O threads, see --io_threads, while muxing "
+            "continues. The manifests are updated once a segment file is "
+            "closed.");
+DEFINE_uint64(mp4_hierarchical_sidx_subsegments,
+              0,
+              "MP4 with single segment (on-demand) output only: if positive, "
+              "index the subsegments with a top level 'sidx' box referencing a "
+              "child 'sidx' box for every this many subsegments, instead of "
+              "with a single 'sidx' box.");
+DEFINE_bool(mp4_fragment_passthrough,
+            false,
+            "MP4 with segment_template only: copy the fragments of already "
+            "fragmented, unencrypted single track MP4 inputs to the media "
+            "segments as they are, instead of demuxing and fragmenting the "
+            "samples again. Streams with encryption, decryption, trick play, "
+            "language override or ad cues are packaged as usual.");
+DEFINE_bool(mp4_prft,
+            false,
+            "Write a 'prft' (producer reference time) box in front of the "
+            "fragments, mapping the start of each segment or low latency "
+            "chunk to the wall clock time its first sample arrived at the "
+            "input. Useful to measure the latency of live streams.");
 DEFINE_int32(transport_stream_timestamp_offset_ms,
              100,
              "A positive value, in milliseconds, by which output timestamps "
@@ -53,3 +113,19 @@ DEFINE_int32(transport_stream_timestamp_offset_ms,
              "input. For example, timestamps from ISO-BMFF after adjusted by "
              "EditList could be negative. In transport streams, timestamps are "
              "not allowed to be less than zero.");
+DEFINE_bool(multiplex_ts_streams,
+            false,
+            "MPEG2-TS with segment_template only: mux the streams of an input "
+            "which share the same segment_template into a single program of "
+            "one output, e.g. the video and audio of a rendition, instead of "
+            "rejecting the duplicated segment_template. The segments follow "
+            "the first video stream. Not supported with encryption, trick "
+            "play, ad cues or asynchronous queues.");
+DEFINE_bool(webm_single_pass_single_segment,
+            false,
+            "WebM with single segment (on-demand) output only: write the "
+            "output in a single pass, reserving the space for the Cues, "
+            "estimated from the media duration and --segment_duration, in "
+            "front of the Clusters, instead of writing to a temporary file "
+            "and copying it to the output. Falls back to the two-pass output "
+            "for non-seekable outputs or an unknown media duration.");
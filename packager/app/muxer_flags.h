@@ -16,9 +16,21 @@ DECLARE_double(segment_duration);
 DECLARE_bool(segment_sap_aligned);
 DECLARE_double(fragment_duration);
 DECLARE_bool(fragment_sap_aligned);
+DECLARE_int32(low_latency_chunk_num_frames);
+DECLARE_double(low_latency_chunk_duration);
+DECLARE_uint64(low_latency_chunk_target_bytes);
+DECLARE_double(low_latency_chunk_min_duration);
 DECLARE_bool(generate_sidx_in_media_segments);
 DECLARE_string(temp_dir);
 DECLARE_bool(mp4_include_pssh_in_stream);
+DECLARE_bool(mp4_scatter_gather_output);
+DECLARE_bool(mp4_single_pass_single_segment);
+DECLARE_bool(mp4_async_segment_write);
+DECLARE_bool(mp4_fragment_passthrough);
+DECLARE_bool(mp4_prft);
+DECLARE_uint64(mp4_hierarchical_sidx_subsegments);
 DECLARE_int32(transport_stream_timestamp_offset_ms);
+DECLARE_bool(multiplex_ts_streams);
+DECLARE_bool(webm_single_pass_single_segment);
 
 #endif  // APP_MUXER_FLAGS_H_
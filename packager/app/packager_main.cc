@@ -5,14 +5,18 @@
 // https://developers.google.com/open-source/licenses/bsd
 
 #include <gflags/gflags.h>
+#include <signal.h>
 #include <iostream>
+#include <limits>
 
 #include "packager/app/ad_cue_generator_flags.h"
 #include "packager/app/crypto_flags.h"
 #include "packager/app/hls_flags.h"
+#include "packager/app/manifest_aggregator.h"
 #include "packager/app/manifest_flags.h"
 #include "packager/app/mpd_flags.h"
 #include "packager/app/muxer_flags.h"
+#include "packager/app/packager_service.h"
 #include "packager/app/packager_util.h"
 #include "packager/app/playready_key_encryption_flags.h"
 #include "packager/app/protection_system_flags.h"
@@ -27,7 +31,13 @@
 #include "packager/base/strings/string_split.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/platform_thread.h"
 #include "packager/file/file.h"
+#include "packager/file/memory_origin_server.h"
+#include "packager/hls/base/simple_hls_notifier.h"
+#include "packager/metrics/metrics.h"
+#include "packager/metrics/metrics_server.h"
+#include "packager/mpd/base/simple_mpd_notifier.h"
 #include "packager/packager.h"
 #include "packager/tools/license_notice.h"
 
@@ -45,6 +55,210 @@ DEFINE_bool(use_fake_clock_for_muxer,
             "Set to true to use a fake clock for muxer. With this flag set, "
             "creation time and modification time in outputs are set to 0. "
             "Should only be used for testing.");
+DEFINE_uint64(async_queue_capacity,
+              0,
+              "If non-zero, chunking, encryption and muxing of each audio / "
+              "video stream run on a dedicated thread, decoupled from "
+              "demuxing through a queue holding up to this many messages.");
+DEFINE_uint64(output_queue_capacity,
+              0,
+              "If non-zero, each output of a stream, including trick play "
+              "outputs, is muxed on a dedicated thread fed through a queue "
+              "holding up to this many messages.");
+DEFINE_uint64(trick_play_key_frame_interval,
+              0,
+              "The number of frames from one key frame to the next in the "
+              "video inputs with trick play outputs, which must have a "
+              "constant frame rate. If non-zero, trick play frames are muxed "
+              "as soon as they are demuxed instead of being held back until "
+              "the next trick play frame.");
+DEFINE_uint64(memory_budget_mb,
+              0,
+              "If non-zero, the buffers of the pipeline share a budget of "
+              "this many MB. The inputs wait while it is exceeded by data "
+              "yet to be written by the outputs.");
+DEFINE_double(stats_log_interval,
+              0,
+              "If positive, log the throughput and latency statistics of the "
+              "pipeline handlers as a JSON line every this many seconds.");
+DEFINE_int32(metrics_port,
+             0,
+             "If non-zero, serve the packager metrics in the Prometheus text "
+             "format at http://<host>:<metrics_port>/metrics while packaging.");
+DEFINE_string(listen_address,
+              "127.0.0.1",
+              "The IPv4 address the servers of --metrics_port, --service_port "
+              "and --manifest_aggregator_port listen on. The loopback address "
+              "by default, so that only the local host can reach them. "
+              "0.0.0.0 listens on all the interfaces.");
+DEFINE_int32(origin_port,
+             0,
+             "If non-zero, serve the memory:// outputs over HTTP at "
+             "http://<host>:<origin_port>/<name> while packaging, so the "
+             "packager can be its own origin.");
+DEFINE_string(trace_output,
+              "",
+              "If not empty, record a timeline of the pipeline, e.g. "
+              "demuxing, encryption, muxing and manifest writes, and write "
+              "it to this file in the Chrome trace event JSON format.");
+DEFINE_bool(output_segment_report,
+            false,
+            "Write a report of the segments of each output, named like the "
+            "output suffixed with '.segments.jsonl', with a JSON line per "
+            "segment: its start, duration, size and number of samples, the "
+            "time spent encrypting, muxing and writing it, and the time it "
+            "was published.");
+DEFINE_string(live_checkpoint_file,
+              "",
+              "If not empty, periodically checkpoint the state of the live "
+              "session, i.e. the live window of the manifests and the segment "
+              "numbers, to this file, and resume from it on restart.");
+DEFINE_double(live_checkpoint_interval,
+              0,
+              "The interval in seconds between live checkpoints. 0 uses the "
+              "segment duration.");
+DEFINE_string(manifest_aggregator_url,
+              "",
+              "If not empty, also publish the manifest events of the "
+              "segmented streams, i.e. their segments, cues and key updates, "
+              "to the packager running with --manifest_aggregator_port at "
+              "this URL, e.g. http://<host>:<port>/events, which generates "
+              "the manifests of a live channel packaged on several nodes. "
+              "Requires --mpd_output or --hls_master_playlist_output, e.g. to "
+              "a scratch location.");
+DEFINE_string(manifest_node_id,
+              "",
+              "Identifies the node in the logs of the manifest aggregator, "
+              "see --manifest_aggregator_url.");
+DEFINE_bool(deterministic_output,
+            false,
+            "If enabled, derive the segments and the manifests only from the "
+            "input timeline, so that redundant packagers fed the same input "
+            "write identical segments and manifests: the segments start at "
+            "segment boundaries and are numbered from their start times, and "
+            "the initialization vectors are derived from the keys. Requires "
+            "--availability_start_time for a dynamic MPD.");
+DEFINE_int32(manifest_aggregator_port,
+             0,
+             "If non-zero, run as a manifest aggregator which generates "
+             "--mpd_output and --hls_master_playlist_output from the manifest "
+             "events published by the packagers of a live channel at "
+             "http://<host>:<manifest_aggregator_port>/events, see "
+             "--manifest_aggregator_url, until it is interrupted. The streams "
+             "are identified by their segment templates, which must be unique "
+             "across the packagers.");
+DEFINE_double(manifest_alignment_tolerance,
+              0.01,
+              "How far apart, in seconds, the starts of the segments of the "
+              "streams of a type may be for the manifest aggregator, see "
+              "--manifest_aggregator_port. The misaligned segments are "
+              "reported.");
+DEFINE_double(live_max_lag,
+              0,
+              "If positive, the samples of the live streams whose segments "
+              "are published more than this many seconds behind real time "
+              "are encrypted first on the shared worker threads.");
+DEFINE_bool(degrade_low_priority_outputs,
+            false,
+            "Thin out the trick play frames while a live stream, which is "
+            "not low_priority, lags more than --live_max_lag.");
+DEFINE_int32(num_worker_threads,
+             0,
+             "Maximum number of inputs packaged at the same time. Extra inputs "
+             "wait for a worker thread, so only use it with inputs that "
+             "terminate, e.g. VOD. 0 packages all the inputs at the same time; "
+             "-1 uses the number of hardware threads. Segmented text inputs "
+             "always share a pool of this many threads, or of the number of "
+             "hardware threads if 0, unless there are ad cues to align.");
+DEFINE_string(job_cpu_sets,
+              "",
+              "Semicolon separated CPU sets, in the Linux cpulist format, the "
+              "packaging jobs are pinned to, e.g. '0-7,16-23;8-15,24-31' on a "
+              "dual socket server. The jobs of an input are pinned to one of "
+              "the sets, which are assigned to the inputs in turn, and their "
+              "sample buffers and I/O threads stay on the NUMA node of the "
+              "set. Linux only.");
+DEFINE_string(huge_pages,
+              "",
+              "Allocate the demuxer read buffers, the I/O caches and the "
+              "other large buffers on huge pages: 'thp' on transparent huge "
+              "pages, 'hugetlbfs' on the reserved huge pages, falling back "
+              "to transparent huge pages. The buffers which cannot be are "
+              "allocated from the heap. Linux only.");
+DEFINE_bool(use_memory_mapped_input,
+            false,
+            "Read local input files through memory mapping instead of "
+            "buffered reads. Not supported on Windows.");
+DEFINE_bool(parallel_track_demuxing,
+            false,
+            "Demux the tracks of local, non-fragmented MP4 inputs in "
+            "parallel, with one reader per track, when more than one track "
+            "of the input is packaged.");
+DEFINE_bool(async_manifest_updates,
+            false,
+            "Update the manifests on a thread of their own instead of the "
+            "threads of the muxers, so that packaging does not wait for the "
+            "manifests to be written.");
+DEFINE_bool(use_input_sample_index,
+            false,
+            "Read the samples of local MP4 inputs from their "
+            "<input>.sample_index sidecar files, if they are up to date, "
+            "instead of parsing the inputs again. Otherwise the sidecar files "
+            "are written for the next runs.");
+DEFINE_int32(vod_time_slices,
+             0,
+             "If greater than one, split MP4 outputs with a segment template "
+             "into up to this many time slices at segment boundaries, which "
+             "are packaged in parallel. Only for inputs which are local, "
+             "single track MP4 files with an up to date sample index, see "
+             "--use_input_sample_index, and outputs without encryption, trick "
+             "play, ad cues, fragments shorter than the segments or low "
+             "latency chunks.");
+DEFINE_int32(vod_time_shards,
+             0,
+             "If positive, package only the time shard --vod_time_shard_index "
+             "of each output, the outputs being split into up to this many "
+             "shards at segment boundaries, so that they can be packaged on "
+             "many machines. Requires --output_media_info: the MediaInfo "
+             "files of all the shards are passed to mpd_generator to generate "
+             "the manifests. Only for MP4 and MPEG-2 TS outputs with a "
+             "segment template, from local single track MP4 inputs.");
+DEFINE_int32(vod_time_shard_index,
+             0,
+             "The index of the time shard packaged, see --vod_time_shards.");
+DEFINE_bool(jit_packaging,
+            false,
+            "Package the segments of the outputs when they are requested from "
+            "the origin, see --origin_port, instead of packaging the inputs "
+            "up front. Only for inputs which are local, single track MP4 "
+            "files, whose sample index is built if it is not up to date, and "
+            "memory:// MP4 or TS outputs with a $Number$ segment template. "
+            "No manifest is generated.");
+DEFINE_bool(incremental_packaging,
+            false,
+            "Skip the outputs whose local input, stream descriptor and "
+            "packaging options did not change since the previous run, as "
+            "fingerprinted next to their MediaInfo files, and add them to the "
+            "manifests from their MediaInfo files. Requires "
+            "--output_media_info.");
+DEFINE_int32(service_port,
+             0,
+             "If non-zero, run as a service which packages the sessions "
+             "started through its JSON API at "
+             "http://<host>:<service_port>/sessions, until it is interrupted, "
+             "instead of the streams of the command line. The other flags "
+             "configure the sessions. The metrics are served at /metrics.");
+DEFINE_string(service_token_file,
+              "",
+              "File holding a shared secret, which the requests to the API of "
+              "--service_port must carry in an 'Authorization: Bearer "
+              "<secret>' header. Required if --listen_address is not a "
+              "loopback address, as the sessions read and write any path the "
+              "service can access.");
+DEFINE_int32(max_running_sessions,
+             0,
+             "Maximum number of sessions running at the same time in service "
+             "mode, see --service_port. 0 means no limit.");
 DEFINE_string(test_packager_version,
               "",
               "Packager version for testing. Should be used for testing only.");
@@ -311,18 +525,81 @@ base::Optional<PackagingParams> GetPackagingParams() {
   PackagingParams packaging_params;
 
   packaging_params.temp_dir = FLAGS_temp_dir;
+  packaging_params.async_queue_capacity =
+      static_cast<uint32_t>(FLAGS_async_queue_capacity);
+  packaging_params.output_queue_capacity =
+      static_cast<uint32_t>(FLAGS_output_queue_capacity);
+  packaging_params.trick_play_key_frame_interval =
+      static_cast<uint32_t>(FLAGS_trick_play_key_frame_interval);
+  packaging_params.memory_budget_in_bytes =
+      FLAGS_memory_budget_mb * 1024 * 1024;
+  packaging_params.stats_log_interval_in_seconds = FLAGS_stats_log_interval;
+  if (FLAGS_metrics_port < 0 || FLAGS_metrics_port > 65535) {
+    LOG(ERROR) << "--metrics_port should be in the range [0, 65535].";
+    return base::nullopt;
+  }
+  packaging_params.metrics_port = static_cast<uint16_t>(FLAGS_metrics_port);
+  packaging_params.metrics_address = FLAGS_listen_address;
+  if (FLAGS_origin_port < 0 || FLAGS_origin_port > 65535) {
+    LOG(ERROR) << "--origin_port should be in the range [0, 65535].";
+    return base::nullopt;
+  }
+  packaging_params.origin_port = static_cast<uint16_t>(FLAGS_origin_port);
+  packaging_params.trace_output = FLAGS_trace_output;
+  packaging_params.live_checkpoint_file = FLAGS_live_checkpoint_file;
+  packaging_params.live_checkpoint_interval_in_seconds =
+      FLAGS_live_checkpoint_interval;
+  packaging_params.manifest_aggregator_url = FLAGS_manifest_aggregator_url;
+  packaging_params.manifest_node_id = FLAGS_manifest_node_id;
+  packaging_params.deterministic_output = FLAGS_deterministic_output;
+  packaging_params.live_max_lag_in_seconds = FLAGS_live_max_lag;
+  packaging_params.degrade_low_priority_outputs =
+      FLAGS_degrade_low_priority_outputs;
+  packaging_params.num_worker_threads = FLAGS_num_worker_threads;
+  packaging_params.job_cpu_sets =
+      base::SplitString(FLAGS_job_cpu_sets, ";", base::TRIM_WHITESPACE,
+                        base::SPLIT_WANT_NONEMPTY);
+  packaging_params.huge_pages = FLAGS_huge_pages;
+  packaging_params.use_memory_mapped_input = FLAGS_use_memory_mapped_input;
+  packaging_params.parallel_track_demuxing = FLAGS_parallel_track_demuxing;
+  packaging_params.async_manifest_updates = FLAGS_async_manifest_updates;
+  packaging_params.use_input_sample_index = FLAGS_use_input_sample_index;
+  if (FLAGS_vod_time_slices < 0) {
+    LOG(ERROR) << "--vod_time_slices should not be negative.";
+    return base::nullopt;
+  }
+  packaging_params.num_vod_time_slices = FLAGS_vod_time_slices;
+  if (FLAGS_vod_time_shards < 0 || FLAGS_vod_time_shard_index < 0) {
+    LOG(ERROR) << "--vod_time_shards and --vod_time_shard_index should not be "
+                  "negative.";
+    return base::nullopt;
+  }
+  packaging_params.num_vod_time_shards = FLAGS_vod_time_shards;
+  packaging_params.vod_time_shard_index = FLAGS_vod_time_shard_index;
+  packaging_params.jit_packaging = FLAGS_jit_packaging;
+  packaging_params.incremental_packaging = FLAGS_incremental_packaging;
 
   AdCueGeneratorParams& ad_cue_generator_params =
       packaging_params.ad_cue_generator_params;
   if (!ParseAdCues(FLAGS_ad_cues, &ad_cue_generator_params.cue_points)) {
     return base::nullopt;
   }
+  ad_cue_generator_params.max_buffered_bytes_per_stream =
+      FLAGS_ad_cue_max_buffered_bytes;
 
   ChunkingParams& chunking_params = packaging_params.chunking_params;
   chunking_params.segment_duration_in_seconds = FLAGS_segment_duration;
   chunking_params.subsegment_duration_in_seconds = FLAGS_fragment_duration;
   chunking_params.segment_sap_aligned = FLAGS_segment_sap_aligned;
   chunking_params.subsegment_sap_aligned = FLAGS_fragment_sap_aligned;
+  chunking_params.low_latency_chunk_num_frames =
+      FLAGS_low_latency_chunk_num_frames;
+  chunking_params.low_latency_chunk_duration_in_seconds =
+      FLAGS_low_latency_chunk_duration;
+  chunking_params.low_latency_chunk_target_bytes =
+      FLAGS_low_latency_chunk_target_bytes;
+  chunking_params.low_latency_chunk_min_duration_in_seconds =
+      FLAGS_low_latency_chunk_min_duration;
 
   int num_key_providers = 0;
   EncryptionParams& encryption_params = packaging_params.encryption_params;
@@ -360,11 +637,21 @@ base::Optional<PackagingParams> GetPackagingParams() {
     encryption_params.crypto_period_duration_in_seconds =
         FLAGS_crypto_period_duration;
     encryption_params.vp9_subsample_encryption = FLAGS_vp9_subsample_encryption;
+    encryption_params.parallel_encryption_window =
+        static_cast<uint32_t>(FLAGS_parallel_encryption_window);
+    encryption_params.crypto_backend = FLAGS_crypto_backend;
     encryption_params.stream_label_func = std::bind(
         &Packager::DefaultStreamLabelFunction, FLAGS_max_sd_pixels,
         FLAGS_max_hd_pixels, FLAGS_max_uhd1_pixels, std::placeholders::_1);
     encryption_params.playready_extra_header_data =
         FLAGS_playready_extra_header_data;
+
+    KeyCacheParams& key_cache = encryption_params.key_cache;
+    key_cache.cache_directory = FLAGS_key_cache_dir;
+    key_cache.wrapping_key = FLAGS_key_cache_wrapping_key_bytes;
+    key_cache.ttl_in_seconds = static_cast<uint32_t>(FLAGS_key_cache_ttl);
+    key_cache.shared = FLAGS_key_cache_shared;
+    encryption_params.key_fetch_timeout_in_seconds = FLAGS_key_fetch_timeout;
   }
   switch (encryption_params.key_provider) {
     case KeyProvider::kWidevine: {
@@ -375,6 +662,8 @@ base::Optional<PackagingParams> GetPackagingParams() {
       widevine.policy = FLAGS_policy;
       widevine.group_id = FLAGS_group_id_bytes;
       widevine.enable_entitlement_license = FLAGS_enable_entitlement_license;
+      widevine.key_prefetch_crypto_periods = FLAGS_key_prefetch_crypto_periods;
+      widevine.max_concurrent_key_requests = FLAGS_max_concurrent_key_requests;
       if (!GetWidevineSigner(&widevine.signer))
         return base::nullopt;
       break;
@@ -437,14 +726,35 @@ base::Optional<PackagingParams> GetPackagingParams() {
   mp4_params.generate_sidx_in_media_segments =
       FLAGS_generate_sidx_in_media_segments;
   mp4_params.include_pssh_in_stream = FLAGS_mp4_include_pssh_in_stream;
+  mp4_params.scatter_gather_output = FLAGS_mp4_scatter_gather_output;
+  mp4_params.single_pass_single_segment =
+      FLAGS_mp4_single_pass_single_segment;
+  mp4_params.async_segment_write = FLAGS_mp4_async_segment_write;
+  mp4_params.fragment_passthrough = FLAGS_mp4_fragment_passthrough;
+  mp4_params.generate_prft_boxes = FLAGS_mp4_prft;
+  // The 'sidx' reference count is a 16-bit field.
+  if (FLAGS_mp4_hierarchical_sidx_subsegments >
+      std::numeric_limits<uint16_t>::max()) {
+    LOG(ERROR) << "--mp4_hierarchical_sidx_subsegments should not exceed "
+               << std::numeric_limits<uint16_t>::max();
+    return base::nullopt;
+  }
+  mp4_params.hierarchical_sidx_subsegments =
+      static_cast<uint32_t>(FLAGS_mp4_hierarchical_sidx_subsegments);
 
   packaging_params.transport_stream_timestamp_offset_ms =
       FLAGS_transport_stream_timestamp_offset_ms;
+  packaging_params.multiplex_ts_streams = FLAGS_multiplex_ts_streams;
+  packaging_params.webm_single_pass_single_segment =
+      FLAGS_webm_single_pass_single_segment;
 
   packaging_params.output_media_info = FLAGS_output_media_info;
+  packaging_params.binary_media_info = FLAGS_binary_media_info;
+  packaging_params.output_segment_report = FLAGS_output_segment_report;
 
   MpdParams& mpd_params = packaging_params.mpd_params;
   mpd_params.mpd_output = FLAGS_mpd_output;
+  mpd_params.mpd_patch_output = FLAGS_mpd_patch_output;
   mpd_params.base_urls = base::SplitString(
       FLAGS_base_urls, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
   mpd_params.min_buffer_time = FLAGS_min_buffer_time;
@@ -453,6 +763,8 @@ base::Optional<PackagingParams> GetPackagingParams() {
   mpd_params.time_shift_buffer_depth = FLAGS_time_shift_buffer_depth;
   mpd_params.preserved_segments_outside_live_window =
       FLAGS_preserved_segments_outside_live_window;
+  mpd_params.bandwidth_estimation_window = FLAGS_bandwidth_estimation_window;
+  mpd_params.gzip_manifests = FLAGS_gzip_manifests;
 
   if (!FLAGS_utc_timings.empty()) {
     base::StringPairs pairs;
@@ -473,8 +785,11 @@ base::Optional<PackagingParams> GetPackagingParams() {
       FLAGS_generate_dash_if_iop_compliant_mpd;
   mpd_params.allow_approximate_segment_timeline =
       FLAGS_allow_approximate_segment_timeline;
+  mpd_params.segment_template_constant_duration =
+      FLAGS_segment_template_constant_duration;
   mpd_params.allow_codec_switching = FLAGS_allow_codec_switching;
   mpd_params.include_mspr_pro = FLAGS_include_mspr_pro_for_playready;
+  mpd_params.availability_start_time = FLAGS_availability_start_time;
 
   HlsParams& hls_params = packaging_params.hls_params;
   if (!GetHlsPlaylistType(FLAGS_hls_playlist_type, &hls_params.playlist_type)) {
@@ -486,9 +801,13 @@ base::Optional<PackagingParams> GetPackagingParams() {
   hls_params.time_shift_buffer_depth = FLAGS_time_shift_buffer_depth;
   hls_params.preserved_segments_outside_live_window =
       FLAGS_preserved_segments_outside_live_window;
+  hls_params.bandwidth_estimation_window = FLAGS_bandwidth_estimation_window;
+  hls_params.gzip_manifests = FLAGS_gzip_manifests;
   hls_params.default_language = FLAGS_default_language;
   hls_params.default_text_language = FLAGS_default_text_language;
   hls_params.media_sequence_number = FLAGS_hls_media_sequence_number;
+  hls_params.skip_boundary = FLAGS_hls_skip_boundary;
+  hls_params.program_date_time = FLAGS_hls_program_date_time;
 
   TestParams& test_params = packaging_params.test_params;
   test_params.dump_stream_info = FLAGS_dump_stream_info;
@@ -499,6 +818,147 @@ base::Optional<PackagingParams> GetPackagingParams() {
   return packaging_params;
 }
 
+// Set by the signal handlers to stop the service.
+volatile sig_atomic_t g_stop_service = 0;
+
+void StopService(int signal_number) {
+  g_stop_service = 1;
+}
+
+int RunPackagerService(const PackagingParams& packaging_params) {
+  if (FLAGS_service_port < 0 || FLAGS_service_port > 65535) {
+    LOG(ERROR) << "--service_port should be in the range [0, 65535].";
+    return kArgumentValidationFailed;
+  }
+  if (FLAGS_max_running_sessions < 0) {
+    LOG(ERROR) << "--max_running_sessions should not be negative.";
+    return kArgumentValidationFailed;
+  }
+
+  std::string service_token;
+  if (!FLAGS_service_token_file.empty()) {
+    std::string contents;
+    if (!File::ReadFileToString(FLAGS_service_token_file.c_str(),
+                                &contents)) {
+      LOG(ERROR) << "Failed to read --service_token_file "
+                 << FLAGS_service_token_file << ".";
+      return kArgumentValidationFailed;
+    }
+    base::TrimWhitespaceASCII(contents, base::TRIM_ALL, &service_token);
+    if (service_token.empty()) {
+      LOG(ERROR) << "--service_token_file " << FLAGS_service_token_file
+                 << " is empty.";
+      return kArgumentValidationFailed;
+    }
+  } else if (!MetricsServer::IsLoopbackAddress(FLAGS_listen_address)) {
+    LOG(ERROR) << "--service_token_file is required to serve the sessions API "
+                  "on --listen_address "
+               << FLAGS_listen_address << ".";
+    return kArgumentValidationFailed;
+  }
+
+  PackagerService service(packaging_params, FLAGS_max_running_sessions);
+  // Declared after |service| so it stops serving first.
+  MetricsServer server(Metrics::GetInstance());
+  server.set_request_handler(
+      std::bind(&PackagerService::HandleRequest, &service,
+                std::placeholders::_1, std::placeholders::_2,
+                std::placeholders::_3, std::placeholders::_4));
+  server.set_listen_address(FLAGS_listen_address);
+  server.set_request_token(service_token);
+  if (!server.Start(static_cast<uint16_t>(FLAGS_service_port))) {
+    LOG(ERROR) << "Failed to serve on " << FLAGS_listen_address << ":"
+               << FLAGS_service_port << ".";
+    return kInternalError;
+  }
+
+  MemoryOriginServer origin_server(MemoryOriginServer::kDefaultNumThreads);
+  if (packaging_params.origin_port > 0 &&
+      !origin_server.Start(packaging_params.origin_port)) {
+    LOG(ERROR) << "Failed to serve the memory files on port "
+               << packaging_params.origin_port << ".";
+    return kInternalError;
+  }
+
+  signal(SIGINT, StopService);
+  signal(SIGTERM, StopService);
+  LOG(INFO) << "Serving packaging sessions at http://"
+            << FLAGS_listen_address << ":" << server.port() << "/sessions";
+  while (!g_stop_service)
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(100));
+
+  server.Stop();
+  origin_server.Stop();
+  return kSuccess;
+}
+
+int RunManifestAggregator(const PackagingParams& packaging_params) {
+  if (FLAGS_manifest_aggregator_port < 0 ||
+      FLAGS_manifest_aggregator_port > 65535) {
+    LOG(ERROR) << "--manifest_aggregator_port should be in the range "
+                  "[0, 65535].";
+    return kArgumentValidationFailed;
+  }
+  if (FLAGS_manifest_alignment_tolerance < 0) {
+    LOG(ERROR) << "--manifest_alignment_tolerance should not be negative.";
+    return kArgumentValidationFailed;
+  }
+  const MpdParams& mpd_params = packaging_params.mpd_params;
+  const HlsParams& hls_params = packaging_params.hls_params;
+  if (mpd_params.mpd_output.empty() &&
+      hls_params.master_playlist_output.empty()) {
+    LOG(ERROR) << "The manifest aggregator requires --mpd_output or "
+                  "--hls_master_playlist_output.";
+    return kArgumentValidationFailed;
+  }
+
+  std::unique_ptr<MpdNotifier> mpd_notifier;
+  if (!mpd_params.mpd_output.empty()) {
+    const bool kOnDemandProfile = false;
+    mpd_notifier.reset(new SimpleMpdNotifier(
+        media::GetMpdOptions(kOnDemandProfile, mpd_params)));
+  }
+  std::unique_ptr<hls::HlsNotifier> hls_notifier;
+  if (!hls_params.master_playlist_output.empty())
+    hls_notifier.reset(new hls::SimpleHlsNotifier(hls_params));
+  ManifestAggregator aggregator(std::move(mpd_notifier),
+                                std::move(hls_notifier),
+                                FLAGS_manifest_alignment_tolerance);
+  const Status status = aggregator.Init();
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+    return kArgumentValidationFailed;
+  }
+
+  // Declared after |aggregator| so it stops serving first.
+  MetricsServer server(Metrics::GetInstance());
+  server.set_request_handler(
+      std::bind(&ManifestAggregator::HandleRequest, &aggregator,
+                std::placeholders::_1, std::placeholders::_2,
+                std::placeholders::_3, std::placeholders::_4));
+  server.set_listen_address(FLAGS_listen_address);
+  if (!server.Start(static_cast<uint16_t>(FLAGS_manifest_aggregator_port))) {
+    LOG(ERROR) << "Failed to serve on " << FLAGS_listen_address << ":"
+               << FLAGS_manifest_aggregator_port << ".";
+    return kInternalError;
+  }
+
+  signal(SIGINT, StopService);
+  signal(SIGTERM, StopService);
+  LOG(INFO) << "Aggregating the manifest events at http://"
+            << FLAGS_listen_address << ":" << server.port() << "/events";
+  while (!g_stop_service)
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(100));
+
+  server.Stop();
+  const Status flush_status = aggregator.Flush();
+  if (!flush_status.ok()) {
+    LOG(ERROR) << flush_status;
+    return kPackagingFailed;
+  }
+  return kSuccess;
+}
+
 int PackagerMain(int argc, char** argv) {
   // Needed to enable VLOG/DVLOG through --vmodule or --v.
   base::CommandLine::Init(argc, argv);
@@ -516,7 +976,8 @@ int PackagerMain(int argc, char** argv) {
       std::cout << line << std::endl;
     return kSuccess;
   }
-  if (argc < 2) {
+  if (argc < 2 && FLAGS_service_port == 0 &&
+      FLAGS_manifest_aggregator_port == 0) {
     google::ShowUsageWithFlags("Usage");
     return kSuccess;
   }
@@ -532,6 +993,11 @@ int PackagerMain(int argc, char** argv) {
   if (!packaging_params)
     return kArgumentValidationFailed;
 
+  if (FLAGS_service_port != 0)
+    return RunPackagerService(packaging_params.value());
+  if (FLAGS_manifest_aggregator_port != 0)
+    return RunManifestAggregator(packaging_params.value());
+
   std::vector<StreamDescriptor> stream_descriptors;
   for (int i = 1; i < argc; ++i) {
     base::Optional<StreamDescriptor> stream_descriptor =
@@ -0,0 +1,235 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/packager_service.h"
+
+#include "packager/app/stream_descriptor.h"
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/proto_json_util.h"
+
+namespace shaka {
+namespace {
+
+const char kSessionsPath[] = "/sessions";
+
+std::string ErrorResponse(const std::string& status,
+                          const std::string& error,
+                          std::string* response_body) {
+  PackagerSessionStatus session_status;
+  session_status.set_error(error);
+  *response_body = media::MessageToJsonString(session_status);
+  return status;
+}
+
+}  // namespace
+
+PackagerService::PackagerService(const PackagingParams& packaging_params,
+                                 size_t max_running_sessions)
+    : packaging_params_(packaging_params),
+      max_running_sessions_(max_running_sessions) {}
+
+PackagerService::~PackagerService() {
+  {
+    base::AutoLock auto_lock(lock_);
+    for (auto& entry : sessions_) {
+      Session* session = entry.second.get();
+      session->cancelled = true;
+      if (session->initialized)
+        session->packager.Cancel();
+    }
+  }
+  // The session threads update their sessions under |lock_| before they exit.
+  for (auto& entry : sessions_)
+    entry.second->thread.reset();
+}
+
+std::string PackagerService::HandleRequest(const std::string& method,
+                                           const std::string& path,
+                                           const std::string& body,
+                                           std::string* response_body) {
+  const std::string path_without_query = path.substr(0, path.find('?'));
+  if (path_without_query == kSessionsPath) {
+    if (method == "GET") {
+      PackagerSessionList session_list;
+      {
+        base::AutoLock auto_lock(lock_);
+        for (const auto& entry : sessions_)
+          *session_list.add_sessions() = entry.second->status;
+      }
+      *response_body = media::MessageToJsonString(session_list);
+      return "200 OK";
+    }
+    if (method == "POST") {
+      PackagerSessionRequest request;
+      if (!media::JsonStringToMessage(body, &request)) {
+        return ErrorResponse("400 Bad Request", "Invalid session request.",
+                             response_body);
+      }
+      PackagerSessionStatus session_status;
+      const Status status = StartSession(request, &session_status);
+      if (status.error_code() == error::INVALID_ARGUMENT) {
+        return ErrorResponse("400 Bad Request", status.error_message(),
+                             response_body);
+      }
+      if (!status.ok()) {
+        return ErrorResponse("503 Service Unavailable", status.error_message(),
+                             response_body);
+      }
+      *response_body = media::MessageToJsonString(session_status);
+      return "201 Created";
+    }
+    return ErrorResponse("405 Method Not Allowed",
+                         "Only GET and POST are supported.", response_body);
+  }
+
+  const std::string sessions_prefix = std::string(kSessionsPath) + "/";
+  if (path_without_query.find(sessions_prefix) != 0)
+    return ErrorResponse("404 Not Found", "Not found.", response_body);
+  const std::string session_id =
+      path_without_query.substr(sessions_prefix.size());
+
+  PackagerSessionStatus session_status;
+  bool found = false;
+  if (method == "GET") {
+    found = GetSessionStatus(session_id, &session_status);
+  } else if (method == "DELETE") {
+    found = CancelSession(session_id, &session_status);
+  } else {
+    return ErrorResponse("405 Method Not Allowed",
+                         "Only GET and DELETE are supported.", response_body);
+  }
+  if (!found) {
+    return ErrorResponse("404 Not Found", "No session " + session_id + ".",
+                         response_body);
+  }
+  *response_body = media::MessageToJsonString(session_status);
+  return "200 OK";
+}
+
+Status PackagerService::StartSession(const PackagerSessionRequest& request,
+                                     PackagerSessionStatus* session_status) {
+  DCHECK(session_status);
+
+  std::unique_ptr<Session> session(new Session);
+  for (const std::string& stream : request.streams()) {
+    base::Optional<StreamDescriptor> stream_descriptor =
+        ParseStreamDescriptor(stream);
+    if (!stream_descriptor) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Invalid stream descriptor " + stream + ".");
+    }
+    session->stream_descriptors.push_back(stream_descriptor.value());
+  }
+  if (session->stream_descriptors.empty())
+    return Status(error::INVALID_ARGUMENT, "No streams.");
+
+  session->packaging_params = packaging_params_;
+  // The service serves the metrics of all the sessions itself.
+  session->packaging_params.metrics_port = 0;
+  // The service serves the memory files of all the sessions itself.
+  session->packaging_params.origin_port = 0;
+  if (request.has_mpd_output())
+    session->packaging_params.mpd_params.mpd_output = request.mpd_output();
+  if (request.has_hls_master_playlist_output()) {
+    session->packaging_params.hls_params.master_playlist_output =
+        request.hls_master_playlist_output();
+  }
+
+  base::AutoLock auto_lock(lock_);
+  if (max_running_sessions_ > 0 &&
+      num_running_sessions_ >= max_running_sessions_) {
+    return Status(error::STOPPED,
+                  "There are already " + std::to_string(num_running_sessions_) +
+                      " sessions running.");
+  }
+  const std::string session_id = std::to_string(next_session_id_++);
+  session->status.set_id(session_id);
+  session->status.set_state(PackagerSessionStatus::INITIALIZING);
+  session->thread.reset(new media::ClosureThread(
+      "PackagerSession", base::Bind(&PackagerService::RunSession,
+                                    base::Unretained(this), session.get())));
+  ++num_running_sessions_;
+  *session_status = session->status;
+  Session* new_session = session.get();
+  sessions_[session_id] = std::move(session);
+  new_session->thread->Start();
+  VLOG(1) << "Started session " << session_id << ".";
+  return Status::OK;
+}
+
+bool PackagerService::GetSessionStatus(const std::string& session_id,
+                                       PackagerSessionStatus* session_status) {
+  DCHECK(session_status);
+  base::AutoLock auto_lock(lock_);
+  auto iter = sessions_.find(session_id);
+  if (iter == sessions_.end())
+    return false;
+  *session_status = iter->second->status;
+  return true;
+}
+
+bool PackagerService::CancelSession(const std::string& session_id,
+                                    PackagerSessionStatus* session_status) {
+  DCHECK(session_status);
+  std::unique_ptr<Session> ended_session;
+  {
+    base::AutoLock auto_lock(lock_);
+    auto iter = sessions_.find(session_id);
+    if (iter == sessions_.end())
+      return false;
+    Session* session = iter->second.get();
+    *session_status = session->status;
+    switch (session->status.state()) {
+      case PackagerSessionStatus::INITIALIZING:
+      case PackagerSessionStatus::RUNNING:
+        session->cancelled = true;
+        if (session->initialized)
+          session->packager.Cancel();
+        return true;
+      default:
+        ended_session = std::move(iter->second);
+        sessions_.erase(iter);
+        break;
+    }
+  }
+  // Joins the thread of the session, which has ended, outside of |lock_|.
+  ended_session.reset();
+  return true;
+}
+
+void PackagerService::RunSession(Session* session) {
+  Status status = session->packager.Initialize(session->packaging_params,
+                                               session->stream_descriptors);
+  {
+    base::AutoLock auto_lock(lock_);
+    if (status.ok() && session->cancelled)
+      status = Status(error::CANCELLED, "Session cancelled");
+    if (status.ok()) {
+      session->initialized = true;
+      session->status.set_state(PackagerSessionStatus::RUNNING);
+    }
+  }
+
+  if (status.ok())
+    status = session->packager.Run();
+
+  base::AutoLock auto_lock(lock_);
+  if (status.ok()) {
+    session->status.set_state(PackagerSessionStatus::SUCCEEDED);
+  } else if (status.error_code() == error::CANCELLED && session->cancelled) {
+    session->status.set_state(PackagerSessionStatus::CANCELLED);
+  } else {
+    LOG(ERROR) << "Session " << session->status.id()
+               << " failed: " << status.ToString();
+    session->status.set_state(PackagerSessionStatus::FAILED);
+    session->status.set_error(status.ToString());
+  }
+  --num_running_sessions_;
+}
+
+}  // namespace shaka
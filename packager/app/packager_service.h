@@ -0,0 +1,109 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_PACKAGER_SERVICE_H_
+#define PACKAGER_APP_PACKAGER_SERVICE_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/app/packager_service.pb.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/packager.h"
+
+namespace shaka {
+
+namespace media {
+class ClosureThread;
+}  // namespace media
+
+/// PackagerService runs many packaging sessions in one process, so that the
+/// sessions share the process wide state, e.g. the libcurl and OpenSSL
+/// initialization, the connection pool and the key cache, instead of paying
+/// for it on every packager invocation. The sessions are controlled through a
+/// JSON API, see HandleRequest(). A session reads and writes any path its
+/// request names, with the permissions of the process, so the API must only
+/// be reachable by trusted clients, e.g. on the loopback address or with a
+/// shared token, see MetricsServer. This class is thread safe.
+class PackagerService {
+ public:
+  /// @param packaging_params is the configuration of the sessions, i.e. the
+  ///        command line of the service. The sessions override its manifest
+  ///        outputs.
+  /// @param max_running_sessions is the maximum number of sessions running at
+  ///        the same time. Zero means no limit.
+  PackagerService(const PackagingParams& packaging_params,
+                  size_t max_running_sessions);
+  /// Cancels the running sessions and waits for them to exit.
+  ~PackagerService();
+
+  /// Handle a request of the control API:
+  ///   POST /sessions starts a session described by a PackagerSessionRequest.
+  ///   GET /sessions lists the sessions.
+  ///   GET /sessions/<id> gets the status of a session.
+  ///   DELETE /sessions/<id> cancels a running session, or forgets a session
+  ///   which has ended.
+  /// The responses are PackagerSessionStatus or PackagerSessionList messages
+  /// in JSON. It matches MetricsServer::RequestHandler.
+  std::string HandleRequest(const std::string& method,
+                            const std::string& path,
+                            const std::string& body,
+                            std::string* response_body);
+
+  /// Start a packaging session.
+  /// @param request describes the session.
+  /// @param session_status gets the status of the new session on success.
+  /// @return OK on success, INVALID_ARGUMENT if @a request is invalid, or
+  ///         STOPPED if there are already max_running_sessions sessions
+  ///         running.
+  Status StartSession(const PackagerSessionRequest& request,
+                      PackagerSessionStatus* session_status);
+
+  /// @return false if there is no session @a session_id.
+  bool GetSessionStatus(const std::string& session_id,
+                        PackagerSessionStatus* session_status);
+
+  /// Cancel the session @a session_id if it is running, or forget it if it
+  /// has ended.
+  /// @return false if there is no session @a session_id.
+  bool CancelSession(const std::string& session_id,
+                     PackagerSessionStatus* session_status);
+
+ private:
+  PackagerService(const PackagerService&) = delete;
+  PackagerService& operator=(const PackagerService&) = delete;
+
+  struct Session {
+    PackagerSessionStatus status;
+    PackagingParams packaging_params;
+    std::vector<StreamDescriptor> stream_descriptors;
+    Packager packager;
+    // Set once |packager| is initialized, so it can be cancelled.
+    bool initialized = false;
+    bool cancelled = false;
+    std::unique_ptr<media::ClosureThread> thread;
+  };
+
+  // Session thread body.
+  void RunSession(Session* session);
+
+  const PackagingParams packaging_params_;
+  const size_t max_running_sessions_;
+
+  base::Lock lock_;
+  // The following are protected by |lock_|.
+  std::map<std::string, std::unique_ptr<Session>> sessions_;
+  size_t num_running_sessions_ = 0;
+  uint64_t next_session_id_ = 1;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_PACKAGER_SERVICE_H_
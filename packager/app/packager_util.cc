@@ -10,6 +10,7 @@
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_split.h"
 #include "packager/file/file.h"
+#include "packager/media/base/caching_key_source.h"
 #include "packager/media/base/media_handler.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/playready_key_source.h"
@@ -17,6 +18,7 @@
 #include "packager/media/base/request_signer.h"
 #include "packager/media/base/widevine_key_source.h"
 #include "packager/mpd/base/mpd_options.h"
+#include "packager/packager.h"
 #include "packager/status.h"
 
 namespace shaka {
@@ -42,6 +44,82 @@ std::unique_ptr<RequestSigner> CreateSigner(const WidevineSigner& signer) {
   return request_signer;
 }
 
+// Creates a Widevine key source with its keys fetched. The parameters should
+// have been validated already.
+std::unique_ptr<KeySource> CreateWidevineKeySource(
+    FourCC protection_scheme,
+    const EncryptionParams& encryption_params) {
+  const WidevineEncryptionParams& widevine = encryption_params.widevine;
+  std::unique_ptr<WidevineKeySource> widevine_key_source(
+      new WidevineKeySource(widevine.key_server_url,
+                            encryption_params.protection_systems,
+                            protection_scheme));
+  if (!widevine.signer.signer_name.empty()) {
+    std::unique_ptr<RequestSigner> request_signer(
+        CreateSigner(widevine.signer));
+    if (!request_signer)
+      return nullptr;
+    widevine_key_source->set_signer(std::move(request_signer));
+  }
+  widevine_key_source->set_group_id(widevine.group_id);
+  widevine_key_source->set_enable_entitlement_license(
+      widevine.enable_entitlement_license);
+  widevine_key_source->set_key_prefetch(
+      widevine.key_prefetch_crypto_periods,
+      widevine.max_concurrent_key_requests);
+
+  Status status =
+      widevine_key_source->FetchKeys(widevine.content_id, widevine.policy);
+  if (!status.ok()) {
+    LOG(ERROR) << "Widevine encryption key source failed to fetch keys: "
+               << status.ToString();
+    return nullptr;
+  }
+  return std::move(widevine_key_source);
+}
+
+// Creates a PlayReady key source with its keys fetched. The parameters should
+// have been validated already.
+std::unique_ptr<KeySource> CreatePlayReadyKeySource(
+    const EncryptionParams& encryption_params) {
+  const PlayReadyEncryptionParams& playready = encryption_params.playready;
+  std::unique_ptr<PlayReadyKeySource> playready_key_source;
+  // private_key_password is allowed to be empty for unencrypted key.
+  if (!playready.client_cert_file.empty()) {
+    playready_key_source.reset(new PlayReadyKeySource(
+        playready.key_server_url, playready.client_cert_file,
+        playready.client_cert_private_key_file,
+        playready.client_cert_private_key_password,
+        encryption_params.protection_systems));
+  } else {
+    playready_key_source.reset(new PlayReadyKeySource(
+        playready.key_server_url, encryption_params.protection_systems));
+  }
+  if (!playready.ca_file.empty()) {
+    playready_key_source->SetCaFile(playready.ca_file);
+  }
+  Status status = playready_key_source->FetchKeysWithProgramIdentifier(
+      playready.program_identifier);
+  if (!status.ok()) {
+    LOG(ERROR) << "PlayReady encryption key source failed to fetch keys: "
+               << status.ToString();
+    return nullptr;
+  }
+  return std::move(playready_key_source);
+}
+
+// Wraps the key source created by |key_source_factory| in a CachingKeySource
+// if the key cache is enabled. |cache_id| identifies the keys in the cache.
+std::unique_ptr<KeySource> MaybeCacheKeySource(
+    const KeyCacheParams& key_cache,
+    const std::string& cache_id,
+    const CachingKeySource::KeySourceFactory& key_source_factory) {
+  if (key_cache.cache_directory.empty())
+    return key_source_factory();
+  return CachingKeySource::Create(key_cache, cache_id, key_source_factory,
+                                  nullptr);
+}
+
 }  // namespace
 
 std::unique_ptr<KeySource> CreateEncryptionKeySource(
@@ -59,29 +137,22 @@ std::unique_ptr<KeySource> CreateEncryptionKeySource(
         LOG(ERROR) << "'content_id' should not be empty.";
         return nullptr;
       }
-      std::unique_ptr<WidevineKeySource> widevine_key_source(
-          new WidevineKeySource(widevine.key_server_url,
-                                encryption_params.protection_systems,
-                                protection_scheme));
-      if (!widevine.signer.signer_name.empty()) {
-        std::unique_ptr<RequestSigner> request_signer(
-            CreateSigner(widevine.signer));
-        if (!request_signer)
-          return nullptr;
-        widevine_key_source->set_signer(std::move(request_signer));
-      }
-      widevine_key_source->set_group_id(widevine.group_id);
-      widevine_key_source->set_enable_entitlement_license(
-          widevine.enable_entitlement_license);
-
-      Status status =
-          widevine_key_source->FetchKeys(widevine.content_id, widevine.policy);
-      if (!status.ok()) {
-        LOG(ERROR) << "Widevine encryption key source failed to fetch keys: "
-                   << status.ToString();
-        return nullptr;
-      }
-      encryption_key_source = std::move(widevine_key_source);
+      const std::string cache_id =
+          "widevine|" + widevine.key_server_url + "|" +
+          base::HexEncode(widevine.content_id.data(),
+                          widevine.content_id.size()) +
+          "|" + widevine.policy + "|" +
+          base::HexEncode(widevine.group_id.data(), widevine.group_id.size()) +
+          "|" + FourCCToString(protection_scheme) + "|" +
+          base::IntToString(
+              static_cast<int>(encryption_params.protection_systems)) +
+          (widevine.enable_entitlement_license ? "|entitlement" : "");
+      encryption_key_source = MaybeCacheKeySource(
+          encryption_params.key_cache, cache_id,
+          [protection_scheme, encryption_params]() {
+            return CreateWidevineKeySource(protection_scheme,
+                                           encryption_params);
+          });
       break;
     }
     case KeyProvider::kRawKey: {
@@ -98,36 +169,21 @@ std::unique_ptr<KeySource> CreateEncryptionKeySource(
                         "is not set.";
           return nullptr;
         }
-        std::unique_ptr<PlayReadyKeySource> playready_key_source;
-        // private_key_password is allowed to be empty for unencrypted key.
-        if (!playready.client_cert_file.empty() ||
-            !playready.client_cert_private_key_file.empty()) {
-          if (playready.client_cert_file.empty() ||
-              playready.client_cert_private_key_file.empty()) {
-            LOG(ERROR) << "Either PlayReady client_cert_file or "
-                          "client_cert_private_key_file is not set.";
-            return nullptr;
-          }
-          playready_key_source.reset(new PlayReadyKeySource(
-              playready.key_server_url, playready.client_cert_file,
-              playready.client_cert_private_key_file,
-              playready.client_cert_private_key_password,
-              encryption_params.protection_systems));
-        } else {
-          playready_key_source.reset(new PlayReadyKeySource(
-              playready.key_server_url, encryption_params.protection_systems));
-        }
-        if (!playready.ca_file.empty()) {
-          playready_key_source->SetCaFile(playready.ca_file);
-        }
-        Status status = playready_key_source->FetchKeysWithProgramIdentifier(
-            playready.program_identifier);
-        if (!status.ok()) {
-          LOG(ERROR) << "PlayReady encryption key source failed to fetch keys: "
-                     << status.ToString();
+        if (playready.client_cert_file.empty() !=
+            playready.client_cert_private_key_file.empty()) {
+          LOG(ERROR) << "Either PlayReady client_cert_file or "
+                        "client_cert_private_key_file is not set.";
           return nullptr;
         }
-        encryption_key_source = std::move(playready_key_source);
+        const std::string cache_id =
+            "playready|" + playready.key_server_url + "|" +
+            playready.program_identifier + "|" +
+            base::IntToString(
+                static_cast<int>(encryption_params.protection_systems));
+        encryption_key_source = MaybeCacheKeySource(
+            encryption_params.key_cache, cache_id, [encryption_params]() {
+              return CreatePlayReadyKeySource(encryption_params);
+            });
       } else {
         LOG(ERROR) << "Error creating PlayReady key source.";
         return nullptr;
@@ -188,5 +244,19 @@ MpdOptions GetMpdOptions(bool on_demand_profile, const MpdParams& mpd_params) {
   return mpd_options;
 }
 
+std::string GetMediaInfoOutput(const StreamDescriptor& stream) {
+  if (!stream.output.empty())
+    return stream.output;
+  std::string name;
+  bool in_identifier = false;
+  for (char c : stream.segment_template) {
+    if (c == '$')
+      in_identifier = !in_identifier;
+    else if (!in_identifier)
+      name += c;
+  }
+  return name;
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -10,6 +10,7 @@
 #define PACKAGER_APP_PACKAGER_UTIL_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "packager/media/base/fourccs.h"
@@ -21,6 +22,7 @@ struct DecryptionParams;
 struct EncryptionParams;
 struct MpdOptions;
 struct MpdParams;
+struct StreamDescriptor;
 
 namespace media {
 
@@ -47,6 +49,11 @@ std::unique_ptr<KeySource> CreateDecryptionKeySource(
 /// @return MpdOptions from provided inputs.
 MpdOptions GetMpdOptions(bool on_demand_profile, const MpdParams& mpd_params);
 
+/// @return The name of the MediaInfo file of @a stream, without its suffix:
+///         the output of the stream, or its segment template without the
+///         identifiers if it has no output, e.g. MPEG-2 TS.
+std::string GetMediaInfoOutput(const StreamDescriptor& stream);
+
 }  // namespace media
 }  // namespace shaka
 
@@ -35,6 +35,9 @@ enum FieldType {
   kDashRolesField,
   kDashOnlyField,
   kHlsOnlyField,
+  kStartTimeField,
+  kEndTimeField,
+  kLowPriorityField,
 };
 
 struct FieldNameToTypeMapping {
@@ -81,6 +84,9 @@ const FieldNameToTypeMapping kFieldNameTypeMappings[] = {
     {"role", kDashRolesField},
     {"dash_only", kDashOnlyField},
     {"hls_only", kHlsOnlyField},
+    {"start_time", kStartTimeField},
+    {"end_time", kEndTimeField},
+    {"low_priority", kLowPriorityField},
 };
 
 FieldType GetFieldType(const std::string& field_name) {
@@ -236,6 +242,35 @@ base::Optional<StreamDescriptor> ParseStreamDescriptor(
         }
         descriptor.hls_only = hls_only_value > 0;
         break;
+      case kStartTimeField:
+        if (!base::StringToDouble(iter->second, &descriptor.start_time) ||
+            descriptor.start_time < 0) {
+          LOG(ERROR) << "start_time should be a non-negative number of "
+                        "seconds, but seeing " << iter->second;
+          return base::nullopt;
+        }
+        break;
+      case kEndTimeField:
+        if (!base::StringToDouble(iter->second, &descriptor.end_time) ||
+            descriptor.end_time <= 0) {
+          LOG(ERROR) << "end_time should be a positive number of seconds, but "
+                        "seeing " << iter->second;
+          return base::nullopt;
+        }
+        break;
+      case kLowPriorityField:
+        unsigned low_priority_value;
+        if (!base::StringToUint(iter->second, &low_priority_value)) {
+          LOG(ERROR) << "Non-numeric option for low_priority field "
+                        "specified (" << iter->second << ").";
+          return base::nullopt;
+        }
+        if (low_priority_value > 1) {
+          LOG(ERROR) << "low_priority should be either 0 or 1.";
+          return base::nullopt;
+        }
+        descriptor.low_priority = low_priority_value > 0;
+        break;
       default:
         LOG(ERROR) << "Unknown field in stream descriptor (\"" << iter->first
                    << "\").";
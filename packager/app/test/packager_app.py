@@ -11,10 +11,31 @@ import logging
 import os
 import platform
 import subprocess
+import sys
+import tempfile
+import time
 
 import test_env
 
 
+def _ParseStraceSummary(summary):
+  """Returns the total number of calls of a strace -c summary."""
+  # The rows of the syscalls are between two dashed lines, e.g.
+  # % time     seconds  usecs/call     calls    errors syscall
+  # ------ ----------- ----------- --------- --------- ----------------
+  #  52.10    0.001234          12       100         3 read
+  # ------ ----------- ----------- --------- --------- ----------------
+  # 100.00    0.002368                   180         3 total
+  num_calls = 0
+  num_dashed_lines = 0
+  for line in summary.splitlines():
+    if line.startswith('------'):
+      num_dashed_lines += 1
+    elif num_dashed_lines == 1:
+      num_calls += int(line.split()[3])
+  return num_calls
+
+
 class PackagerApp(object):
   """Main integration class for testing the packager binaries."""
 
@@ -51,8 +72,7 @@ class PackagerApp(object):
     return subprocess.check_output(
         [self.packager_binary, '--version'], env=self.GetEnv()).decode()
 
-  def Package(self, streams, flags=None):
-    """Executes packager command."""
+  def _GetPackageCommand(self, streams, flags):
     if flags is None:
       flags = []
     cmd = [self.packager_binary]
@@ -67,11 +87,74 @@ class PackagerApp(object):
     # Put single-quotes around each entry so that things like '$' signs in
     # segment templates won't be interpreted as shell variables.
     self.packaging_command_line = ' '.join(["'%s'" % entry for entry in cmd])
+    return cmd
+
+  def Package(self, streams, flags=None):
+    """Executes packager command."""
+    cmd = self._GetPackageCommand(streams, flags)
     packaging_result = subprocess.call(cmd, env=self.GetEnv())
     if packaging_result != 0:
       logging.error('%s returned non-0 status', self.packaging_command_line)
     return packaging_result
 
+  def PackageAndMeasure(self, streams, flags=None):
+    """Executes packager command and measures its resource usage.
+
+    Only supported on POSIX systems.
+
+    Returns:
+      A dict with the 'wall_time' and the 'cpu_time' of the command in seconds
+      and its 'peak_rss' in bytes, or None if the command failed.
+    """
+    cmd = self._GetPackageCommand(streams, flags)
+    start_time = time.time()
+    process = subprocess.Popen(cmd, env=self.GetEnv())
+    # Unlike Popen.wait(), wait4() returns the resource usage of the process.
+    _, status, rusage = os.wait4(process.pid, 0)
+    wall_time = time.time() - start_time
+    if os.WIFEXITED(status):
+      process.returncode = os.WEXITSTATUS(status)
+    else:
+      process.returncode = -os.WTERMSIG(status)
+    if process.returncode != 0:
+      logging.error('%s returned non-0 status', self.packaging_command_line)
+      return None
+
+    # ru_maxrss is in kilobytes, except on macOS.
+    peak_rss = rusage.ru_maxrss
+    if sys.platform != 'darwin':
+      peak_rss *= 1024
+    return {
+        'wall_time': wall_time,
+        'cpu_time': rusage.ru_utime + rusage.ru_stime,
+        'peak_rss': peak_rss,
+    }
+
+  def CountSyscalls(self, streams, flags=None):
+    """Executes packager command under strace and counts its system calls.
+
+    Returns:
+      The number of system calls of all the threads of the command, or None if
+      strace is not available or the command failed.
+    """
+    cmd = self._GetPackageCommand(streams, flags)
+    summary_file, summary_path = tempfile.mkstemp()
+    os.close(summary_file)
+    try:
+      try:
+        result = subprocess.call(['strace', '-f', '-c', '-o', summary_path] +
+                                 cmd, env=self.GetEnv())
+      except OSError:
+        logging.error('strace is not available.')
+        return None
+      if result != 0:
+        logging.error('%s returned non-0 status', self.packaging_command_line)
+        return None
+      with open(summary_path) as f:
+        return _ParseStraceSummary(f.read())
+    finally:
+      os.remove(summary_path)
+
   def GetCommandLine(self):
     return self.packaging_command_line
 
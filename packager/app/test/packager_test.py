@@ -9,6 +9,7 @@
 
 import filecmp
 import glob
+import json
 import logging
 import os
 import re
@@ -1956,5 +1957,221 @@ class PackagerCommandParsingTest(PackagerAppTest):
     self.assertEqual(packaging_result, 1)
 
 
+# The metrics of the benchmarks, and whether higher values are better.
+_BENCHMARK_METRICS = {
+    'wall_time': False,
+    'cpu_time': False,
+    'peak_rss': False,
+    'syscalls': False,
+    'output_throughput': True,
+}
+
+
+def _Median(values):
+  values = sorted(values)
+  middle = len(values) // 2
+  if len(values) % 2:
+    return values[middle]
+  return (values[middle - 1] + values[middle]) / 2.0
+
+
+def _GetDirSize(dir_path):
+  size = 0
+  for root, _, files in os.walk(dir_path):
+    for file_name in files:
+      size += os.path.getsize(os.path.join(root, file_name))
+  return size
+
+
+@unittest.skipUnless(test_env.options.benchmark, 'Requires --benchmark.')
+@unittest.skipUnless(hasattr(os, 'wait4'), 'Requires a POSIX system.')
+class PackagerBenchmarkTest(PackagerAppTest):
+  """Measures the performance of representative packaging configurations.
+
+  Each benchmark records the wall time, the CPU time, the peak RSS and the
+  output throughput of the packager, and optionally its number of system
+  calls, and fails if one of them regresses past its threshold compared with
+  the baselines. The baselines depend on the machine, so they are recorded
+  with --benchmark_update_baselines on the machine running the benchmarks.
+  Most of the inputs are generated, see synthetic_input_options.rst, so that
+  they are long enough to be measured.
+  """
+
+  def setUp(self):
+    super(PackagerBenchmarkTest, self).setUp()
+    self.output_dir = os.path.join(self.tmp_dir, 'output')
+    self.mpd_output = os.path.join(self.output_dir, 'output.mpd')
+    self.hls_master_playlist_output = os.path.join(self.output_dir,
+                                                   'output.m3u8')
+    self.duration = test_env.options.benchmark_duration
+    self.baselines_path = (
+        test_env.options.benchmark_baselines or
+        os.path.join(self.golden_file_dir, 'benchmark_baselines.json'))
+
+  def _GetSyntheticInput(self, **params):
+    params.setdefault('duration', self.duration)
+    return 'synthetic://' + '&'.join(
+        '%s=%s' % (key, value) for key, value in sorted(params.items()))
+
+  def _GetBenchmarkStream(self, input_name, stream_selector, name,
+                          output_format='mp4'):
+    stream = StreamDescriptor(input_name)
+    stream.Append('stream', stream_selector)
+    output_prefix = os.path.join(self.output_dir, name)
+    if output_format in ('ts', 'vtt'):
+      stream.Append('playlist_name', name + '.m3u8')
+    else:
+      stream.Append('init_segment',
+                    '%s-init.%s' % (output_prefix, output_format))
+    stream.Append('segment_template', '%s-$Number$.%s' %
+                  (output_prefix, GetSegmentedExtension(output_format)))
+    return str(stream)
+
+  def _LoadBaselines(self):
+    if not os.path.exists(self.baselines_path):
+      return {}
+    with open(self.baselines_path) as f:
+      return json.load(f)
+
+  def _UpdateJsonFile(self, path, name, results):
+    content = {}
+    if os.path.exists(path):
+      with open(path) as f:
+        content = json.load(f)
+    content.setdefault('benchmarks', {})[name] = results
+    with open(path, 'w') as f:
+      json.dump(content, f, indent=2, sort_keys=True)
+      f.write('\n')
+
+  def _Measure(self, streams, flags):
+    runs = []
+    for _ in range(max(1, test_env.options.benchmark_runs)):
+      if os.path.exists(self.output_dir):
+        shutil.rmtree(self.output_dir)
+      os.makedirs(self.output_dir)
+      run = self.packager.PackageAndMeasure(streams, flags)
+      self.assertTrue(run, self.packager.GetCommandLine())
+      run['output_throughput'] = (
+          _GetDirSize(self.output_dir) / max(run['wall_time'], 1e-6))
+      runs.append(run)
+
+    results = {
+        metric: _Median([run[metric] for run in runs])
+        for metric in ('wall_time', 'cpu_time', 'output_throughput')
+    }
+    results['peak_rss'] = max(run['peak_rss'] for run in runs)
+    if test_env.options.benchmark_count_syscalls:
+      syscalls = self.packager.CountSyscalls(streams, flags)
+      self.assertIsNotNone(syscalls, 'Cannot count the system calls.')
+      results['syscalls'] = syscalls
+    return results
+
+  def _Benchmark(self, name, streams, flags):
+    """Runs a benchmark and compares its results with the baselines."""
+    results = self._Measure(streams, flags)
+    logging.info('Benchmark %s: %s', name, json.dumps(results, sort_keys=True))
+    if test_env.options.benchmark_output:
+      self._UpdateJsonFile(test_env.options.benchmark_output, name, results)
+    if test_env.options.benchmark_update_baselines:
+      self._UpdateJsonFile(self.baselines_path, name, results)
+      return
+
+    baselines = self._LoadBaselines()
+    baseline = baselines.get('benchmarks', {}).get(name)
+    if not baseline:
+      logging.warning('No baseline for benchmark %s in %s. Run with '
+                      '--benchmark_update_baselines to record one.', name,
+                      self.baselines_path)
+      return
+    # The thresholds are in percent.
+    thresholds = baselines.get('thresholds', {})
+    regressions = []
+    for metric, higher_is_better in sorted(_BENCHMARK_METRICS.items()):
+      if metric not in results or not baseline.get(metric):
+        continue
+      threshold = thresholds.get(metric, test_env.options.benchmark_threshold)
+      change = (results[metric] - baseline[metric]) * 100.0 / baseline[metric]
+      if higher_is_better:
+        change = -change
+      if change > threshold:
+        regressions.append(
+            '%s regressed by %.1f%% (threshold %.1f%%): %g vs baseline %g' %
+            (metric, change, threshold, results[metric], baseline[metric]))
+    if regressions:
+      self.fail('Benchmark %s regressed:\n%s\n%s' %
+                (name, '\n'.join(regressions),
+                 self.packager.GetCommandLine()))
+
+  def testVodLadderWithCenc(self):
+    renditions = [(1920, 1080, 5000000), (1280, 720, 3000000),
+                  (854, 480, 1500000), (640, 360, 800000)]
+    streams = []
+    for width, height, bitrate in renditions:
+      video_input = self._GetSyntheticInput(
+          width=width, height=height, video_bitrate=bitrate, b_frames=2,
+          audio_codec='none')
+      streams.append(
+          self._GetBenchmarkStream(video_input, 'video', 'video-%d' % height))
+    audio_input = self._GetSyntheticInput(video_codec='none')
+    streams.append(self._GetBenchmarkStream(audio_input, 'audio', 'audio'))
+    self._Benchmark(
+        'vod_ladder_cenc', streams,
+        self._GetFlags(encryption=True, output_dash=True, output_hls=True,
+                       segment_duration=4))
+
+  def testLiveTsWithSampleAes(self):
+    live_input = self._GetSyntheticInput(b_frames=2, gop_size=60)
+    streams = [
+        self._GetBenchmarkStream(live_input, 'video', 'video', 'ts'),
+        self._GetBenchmarkStream(live_input, 'audio', 'audio', 'ts'),
+    ]
+    self._Benchmark(
+        'live_ts_sample_aes', streams,
+        self._GetFlags(encryption=True, protection_scheme='cbcs',
+                       output_hls=True, hls_playlist_type='LIVE',
+                       time_shift_buffer_depth=30.0, segment_duration=2))
+
+  def testWebm(self):
+    # There is no generated WebM input, so it is the least representative
+    # benchmark.
+    test_file = os.path.join(self.test_data_dir, 'bear-640x360.webm')
+    streams = [
+        self._GetBenchmarkStream(test_file, 'video', 'video', 'webm'),
+        self._GetBenchmarkStream(test_file, 'audio', 'audio', 'webm'),
+    ]
+    self._Benchmark('webm', streams,
+                    self._GetFlags(encryption=True, output_dash=True))
+
+  def testTextHeavy(self):
+    # A cue every half second, with styling.
+    text_input = os.path.join(self.tmp_dir, 'text-heavy.vtt')
+    with open(text_input, 'w') as f:
+      f.write('WEBVTT\n\n')
+      for index in range(self.duration * 2):
+        f.write('%02d:%02d:%02d.%03d --> %02d:%02d:%02d.%03d line:90%%\n' %
+                (index // 7200, index // 120 % 60, index // 2 % 60,
+                 index % 2 * 500, (index + 1) // 7200,
+                 (index + 1) // 120 % 60, (index + 1) // 2 % 60,
+                 (index + 1) % 2 * 500))
+        f.write('<v Speaker>Cue %d <b>with</b> <i>some</i> text.\n\n' % index)
+    streams = [
+        self._GetBenchmarkStream(text_input, 'text', 'text-mp4', 'mp4'),
+        self._GetBenchmarkStream(text_input, 'text', 'text-vtt', 'vtt'),
+    ]
+    self._Benchmark('text_heavy', streams,
+                    self._GetFlags(output_dash=True, output_hls=True))
+
+  def testKeyRotation(self):
+    input_name = self._GetSyntheticInput()
+    streams = [
+        self._GetBenchmarkStream(input_name, 'video', 'video'),
+        self._GetBenchmarkStream(input_name, 'audio', 'audio'),
+    ]
+    self._Benchmark(
+        'key_rotation', streams,
+        self._GetFlags(encryption=True, key_rotation=True, output_dash=True,
+                       time_shift_buffer_depth=30.0))
+
+
 if __name__ == '__main__':
   unittest.main()
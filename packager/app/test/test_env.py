@@ -52,6 +52,29 @@ rsa = parser.add_argument_group(
     'rsa flags',
     'These flags are required to enable RSA signed encryption tests.')
 rsa.add_argument('--rsa_signing_key_path')
+benchmark = parser.add_argument_group(
+    'benchmark flags',
+    'These flags run the benchmarks, which compare the performance of the '
+    'packager with the baselines and fail on regressions.')
+benchmark.add_argument('--benchmark', action='store_true')
+benchmark.add_argument('--benchmark_baselines',
+                       help='Path of the baselines JSON file. Default to '
+                       'testdata/benchmark_baselines.json.')
+benchmark.add_argument('--benchmark_update_baselines', action='store_true',
+                       help='Record the results as the new baselines.')
+benchmark.add_argument('--benchmark_output',
+                       help='Path of a JSON file to write the results to.')
+benchmark.add_argument('--benchmark_runs', type=int, default=3,
+                       help='Number of runs of each benchmark. The median '
+                       'of the runs is compared.')
+benchmark.add_argument('--benchmark_duration', type=int, default=60,
+                       help='Duration, in seconds, of the generated inputs.')
+benchmark.add_argument('--benchmark_threshold', type=float, default=10,
+                       help='Regression threshold in percent, for the '
+                       'metrics without a threshold in the baselines.')
+benchmark.add_argument('--benchmark_count_syscalls', action='store_true',
+                       help='Count the system calls with strace, in an '
+                       'extra run.')
 
 options, args = parser.parse_known_args()
 sys.argv[1:] = args
@@ -62,6 +62,15 @@ DEFINE_hex_bytes(group_id, "", "Identifier for a group of licenses (hex).");
 DEFINE_bool(enable_entitlement_license,
             false,
             "Enable entitlement license when using Widevine key server.");
+DEFINE_int32(key_prefetch_crypto_periods,
+             0,
+             "The number of crypto periods to fetch keys for ahead of the "
+             "media when key rotation is enabled. 0 means as far ahead as "
+             "possible.");
+DEFINE_int32(max_concurrent_key_requests,
+             1,
+             "The maximum number of concurrent key requests to the Widevine "
+             "key server when key rotation is enabled.");
 
 namespace shaka {
 namespace {
@@ -168,6 +177,14 @@ bool ValidateWidevineCryptoFlags() {
     PrintError("--crypto_period_duration should not be negative.");
     success = false;
   }
+  if (FLAGS_key_prefetch_crypto_periods < 0) {
+    PrintError("--key_prefetch_crypto_periods should not be negative.");
+    success = false;
+  }
+  if (FLAGS_max_concurrent_key_requests < 1) {
+    PrintError("--max_concurrent_key_requests should be at least 1.");
+    success = false;
+  }
   return success;
 }
 
@@ -28,6 +28,8 @@ DECLARE_string(rsa_signing_key_path);
 DECLARE_int32(crypto_period_duration);
 DECLARE_hex_bytes(group_id);
 DECLARE_bool(enable_entitlement_license);
+DECLARE_int32(key_prefetch_crypto_periods);
+DECLARE_int32(max_concurrent_key_requests);
 
 namespace shaka {
 
@@ -16,8 +16,16 @@ CallbackFile::CallbackFile(const char* file_name, const char* mode)
 CallbackFile::~CallbackFile() {}
 
 bool CallbackFile::Close() {
+  bool result = true;
+  if (callback_params_ && callback_params_->shared_write_func &&
+      file_mode_[0] == 'w') {
+    SharedBufferInfo info;
+    info.offset = shared_write_offset_;
+    info.is_last = true;
+    result = callback_params_->shared_write_func(name_, nullptr, info) >= 0;
+  }
   delete this;
-  return true;
+  return result;
 }
 
 int64_t CallbackFile::Read(void* buffer, uint64_t length) {
@@ -29,6 +37,11 @@ int64_t CallbackFile::Read(void* buffer, uint64_t length) {
 }
 
 int64_t CallbackFile::Write(const void* buffer, uint64_t length) {
+  if (callback_params_->shared_write_func) {
+    const uint8_t* data = static_cast<const uint8_t*>(buffer);
+    return WriteSharedBuffer(
+        std::make_shared<std::vector<uint8_t>>(data, data + length));
+  }
   if (!callback_params_->write_func) {
     LOG(ERROR) << "Write function not defined.";
     return -1;
@@ -36,6 +49,38 @@ int64_t CallbackFile::Write(const void* buffer, uint64_t length) {
   return callback_params_->write_func(name_, buffer, length);
 }
 
+int64_t CallbackFile::WriteV(const std::vector<IoBlock>& blocks) {
+  if (!callback_params_->shared_write_func)
+    return File::WriteV(blocks);
+  // Gather the blocks into a single buffer, so they are handed off at once.
+  uint64_t total_length = 0;
+  for (const IoBlock& block : blocks)
+    total_length += block.length;
+  std::shared_ptr<std::vector<uint8_t>> buffer(new std::vector<uint8_t>);
+  buffer->reserve(total_length);
+  for (const IoBlock& block : blocks) {
+    const uint8_t* data = static_cast<const uint8_t*>(block.buffer);
+    buffer->insert(buffer->end(), data, data + block.length);
+  }
+  return WriteSharedBuffer(std::move(buffer));
+}
+
+bool CallbackFile::CanTakeSharedBuffers() {
+  return callback_params_ && callback_params_->shared_write_func;
+}
+
+int64_t CallbackFile::WriteSharedBuffer(SharedBuffer buffer) {
+  if (!callback_params_->shared_write_func)
+    return File::WriteSharedBuffer(std::move(buffer));
+  SharedBufferInfo info;
+  info.offset = shared_write_offset_;
+  const int64_t result =
+      callback_params_->shared_write_func(name_, buffer, info);
+  if (result > 0)
+    shared_write_offset_ += result;
+  return result;
+}
+
 int64_t CallbackFile::Size() {
   LOG(INFO) << "CallbackFile does not support Size().";
   return -1;
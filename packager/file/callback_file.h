@@ -24,6 +24,9 @@ class CallbackFile : public File {
   bool Close() override;
   int64_t Read(void* buffer, uint64_t length) override;
   int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t WriteV(const std::vector<IoBlock>& blocks) override;
+  bool CanTakeSharedBuffers() override;
+  int64_t WriteSharedBuffer(SharedBuffer buffer) override;
   int64_t Size() override;
   bool Flush() override;
   bool Seek(uint64_t position) override;
@@ -42,6 +45,8 @@ class CallbackFile : public File {
   const BufferCallbackParams* callback_params_ = nullptr;
   std::string name_;
   std::string file_mode_;
+  // Number of bytes handed off to |shared_write_func|.
+  uint64_t shared_write_offset_ = 0;
 };
 
 }  // namespace shaka
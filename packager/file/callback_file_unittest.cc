@@ -163,4 +163,60 @@ TEST(CallbackFileTest, WriteFunctionNotDefined) {
   ASSERT_EQ(-1, writer->Write(kBuffer, kBufferSize));
 }
 
+TEST(CallbackFileTest, SharedWrite) {
+  std::vector<SharedBuffer> buffers;
+  std::vector<SharedBufferInfo> infos;
+  BufferCallbackParams callback_params;
+  callback_params.shared_write_func = [&buffers, &infos](
+                                          const std::string& name,
+                                          SharedBuffer buffer,
+                                          const SharedBufferInfo& info) {
+    EXPECT_EQ(kBufferLabel, name);
+    buffers.push_back(buffer);
+    infos.push_back(info);
+    return buffer ? static_cast<int64_t>(buffer->size()) : 0;
+  };
+
+  std::string file_name =
+      File::MakeCallbackFileName(callback_params, kBufferLabel);
+  File* writer = File::Open(file_name.c_str(), "w");
+  ASSERT_TRUE(writer);
+  ASSERT_TRUE(writer->CanTakeSharedBuffers());
+
+  SharedBuffer buffer(new std::vector<uint8_t>(kBuffer, kBuffer + kBufferSize));
+  EXPECT_EQ(static_cast<int64_t>(kBufferSize),
+            writer->WriteSharedBuffer(buffer));
+  // Plain writes are copied into a new buffer.
+  EXPECT_EQ(static_cast<int64_t>(kBufferSize),
+            writer->Write(kBuffer, kBufferSize));
+  EXPECT_TRUE(writer->Close());
+
+  ASSERT_EQ(3u, buffers.size());
+  // The buffer is handed off as is.
+  EXPECT_EQ(buffer, buffers[0]);
+  EXPECT_EQ(0u, infos[0].offset);
+  EXPECT_FALSE(infos[0].is_last);
+  EXPECT_EQ(*buffer, *buffers[1]);
+  EXPECT_EQ(kBufferSize, infos[1].offset);
+  EXPECT_FALSE(infos[1].is_last);
+  // The end of the output.
+  EXPECT_FALSE(buffers[2]);
+  EXPECT_EQ(2 * kBufferSize, infos[2].offset);
+  EXPECT_TRUE(infos[2].is_last);
+}
+
+TEST(CallbackFileTest, SharedWriteError) {
+  BufferCallbackParams callback_params;
+  callback_params.shared_write_func =
+      [](const std::string& name, SharedBuffer buffer,
+         const SharedBufferInfo& info) -> int64_t { return kFileError; };
+
+  std::string file_name =
+      File::MakeCallbackFileName(callback_params, kBufferLabel);
+  File* writer = File::Open(file_name.c_str(), "w");
+  ASSERT_TRUE(writer);
+  EXPECT_EQ(kFileError, writer->Write(kBuffer, kBufferSize));
+  EXPECT_FALSE(writer->Close());
+}
+
 }  // namespace shaka
@@ -0,0 +1,105 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/cpu_affinity.h"
+
+#if defined(OS_LINUX)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // defined(OS_LINUX)
+
+#include <algorithm>
+
+#include "packager/base/files/file_util.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace {
+
+// The NUMA node of the thread, recorded when it is pinned.
+thread_local int g_numa_node = -1;
+
+}  // namespace
+
+bool ParseCpuList(const std::string& cpu_list, std::vector<int>* cpus) {
+  DCHECK(cpus);
+  cpus->clear();
+  for (const std::string& range :
+       base::SplitString(cpu_list, ",", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    const size_t dash_pos = range.find('-');
+    int first = 0;
+    int last = 0;
+    if (!base::StringToInt(range.substr(0, dash_pos), &first) ||
+        (dash_pos != std::string::npos &&
+         !base::StringToInt(range.substr(dash_pos + 1), &last)) ||
+        first < 0) {
+      LOG(ERROR) << "Invalid CPU list " << cpu_list;
+      return false;
+    }
+    if (dash_pos == std::string::npos)
+      last = first;
+    if (last < first) {
+      LOG(ERROR) << "Invalid CPU range " << range << " in " << cpu_list;
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus->push_back(cpu);
+  }
+  std::sort(cpus->begin(), cpus->end());
+  cpus->erase(std::unique(cpus->begin(), cpus->end()), cpus->end());
+  return !cpus->empty();
+}
+
+bool SetCurrentThreadCpus(const std::vector<int>& cpus) {
+#if defined(OS_LINUX)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      LOG(ERROR) << "CPU " << cpu << " is out of range.";
+      return false;
+    }
+    CPU_SET(cpu, &cpu_set);
+  }
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    PLOG(ERROR) << "Failed to set the CPU affinity of the thread";
+    return false;
+  }
+  // The thread is moved to one of |cpus| before sched_setaffinity returns.
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+    g_numa_node = static_cast<int>(node);
+  return true;
+#else
+  LOG(WARNING) << "CPU affinity is not supported on this platform.";
+  return false;
+#endif  // defined(OS_LINUX)
+}
+
+int GetCurrentThreadNumaNode() {
+  return g_numa_node;
+}
+
+std::vector<int> GetNumaNodeCpus(int node) {
+  std::vector<int> cpus;
+  std::string cpu_list;
+  if (node >= 0 &&
+      base::ReadFileToString(
+          base::FilePath(base::StringPrintf(
+              "/sys/devices/system/node/node%d/cpulist", node)),
+          &cpu_list)) {
+    ParseCpuList(cpu_list, &cpus);
+  }
+  return cpus;
+}
+
+}  // namespace shaka
@@ -0,0 +1,36 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_CPU_AFFINITY_H_
+#define PACKAGER_FILE_CPU_AFFINITY_H_
+
+#include <string>
+#include <vector>
+
+namespace shaka {
+
+/// Parse a CPU list in the Linux cpulist format, e.g. "0-7,16-23".
+/// @param cpu_list is the list to parse.
+/// @param cpus gets the CPUs of the list, in increasing order.
+/// @return true on success.
+bool ParseCpuList(const std::string& cpu_list, std::vector<int>* cpus);
+
+/// Pin the calling thread to @a cpus, and record the NUMA node it then runs
+/// on, see GetCurrentThreadNumaNode(). The memory the thread touches first is
+/// allocated on that node by the default NUMA policy. Only supported on Linux.
+/// @return true on success.
+bool SetCurrentThreadCpus(const std::vector<int>& cpus);
+
+/// @return The NUMA node of the calling thread if it is pinned with
+///         SetCurrentThreadCpus(), -1 otherwise. It is cheap to call.
+int GetCurrentThreadNumaNode();
+
+/// @return The CPUs of NUMA node @a node, which is empty if it is not known.
+std::vector<int> GetNumaNodeCpus(int node);
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_CPU_AFFINITY_H_
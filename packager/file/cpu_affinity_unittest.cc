@@ -0,0 +1,56 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/cpu_affinity.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#if defined(OS_LINUX)
+#include <sched.h>
+#endif  // defined(OS_LINUX)
+
+#include <thread>
+
+using ::testing::ElementsAre;
+
+namespace shaka {
+
+TEST(CpuAffinityTest, ParseCpuList) {
+  std::vector<int> cpus;
+  ASSERT_TRUE(ParseCpuList("0-2,8,10-11\n", &cpus));
+  EXPECT_THAT(cpus, ElementsAre(0, 1, 2, 8, 10, 11));
+  ASSERT_TRUE(ParseCpuList("3,1,1", &cpus));
+  EXPECT_THAT(cpus, ElementsAre(1, 3));
+}
+
+TEST(CpuAffinityTest, ParseInvalidCpuList) {
+  std::vector<int> cpus;
+  EXPECT_FALSE(ParseCpuList("", &cpus));
+  EXPECT_FALSE(ParseCpuList("a", &cpus));
+  EXPECT_FALSE(ParseCpuList("3-1", &cpus));
+  EXPECT_FALSE(ParseCpuList("-1", &cpus));
+}
+
+#if defined(OS_LINUX)
+TEST(CpuAffinityTest, SetCurrentThreadCpus) {
+  cpu_set_t cpu_set;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpu_set), &cpu_set));
+  int allowed_cpu = 0;
+  while (!CPU_ISSET(allowed_cpu, &cpu_set))
+    ++allowed_cpu;
+
+  EXPECT_EQ(-1, GetCurrentThreadNumaNode());
+  std::thread thread([allowed_cpu]() {
+    ASSERT_TRUE(SetCurrentThreadCpus({allowed_cpu}));
+    EXPECT_EQ(allowed_cpu, sched_getcpu());
+    EXPECT_GE(GetCurrentThreadNumaNode(), 0);
+  });
+  thread.join();
+}
+#endif  // defined(OS_LINUX)
+
+}  // namespace shaka
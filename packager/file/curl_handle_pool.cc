@@ -0,0 +1,121 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/curl_handle_pool.h"
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+
+namespace {
+
+// The maximum number of idle curl handles kept for reuse.
+const size_t kMaxIdleCurlHandles = 16;
+
+class LibCurlInitializer {
+ public:
+  LibCurlInitializer() : initialized_(false) {
+    base::AutoLock lock(lock_);
+    if (!initialized_) {
+      curl_global_init(CURL_GLOBAL_DEFAULT);
+      initialized_ = true;
+    }
+  }
+
+  ~LibCurlInitializer() {
+    base::AutoLock lock(lock_);
+    if (initialized_) {
+      curl_global_cleanup();
+      initialized_ = false;
+    }
+  }
+
+ private:
+  base::Lock lock_;
+  bool initialized_;
+
+  DISALLOW_COPY_AND_ASSIGN(LibCurlInitializer);
+};
+
+}  // namespace
+
+CurlHandlePool* CurlHandlePool::GetInstance() {
+  static LibCurlInitializer lib_curl_initializer;
+  // Constructed after |lib_curl_initializer| so it is destroyed before it.
+  static CurlHandlePool curl_handle_pool;
+  return &curl_handle_pool;
+}
+
+CurlHandlePool::CurlHandlePool() : share_(curl_share_init()) {
+  if (!share_) {
+    LOG(WARNING) << "curl_share_init() failed. Connections are not shared.";
+    return;
+  }
+  curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, LockShareData);
+  curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, UnlockShareData);
+  curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+}
+
+CurlHandlePool::~CurlHandlePool() {
+  for (CURL* curl : idle_handles_)
+    curl_easy_cleanup(curl);
+  if (share_)
+    curl_share_cleanup(share_);
+}
+
+CURL* CurlHandlePool::Acquire() {
+  CURL* curl = nullptr;
+  {
+    base::AutoLock scoped_lock(lock_);
+    if (!idle_handles_.empty()) {
+      curl = idle_handles_.back();
+      idle_handles_.pop_back();
+    }
+  }
+  if (curl) {
+    // Resetting the options keeps the live connections of the handle.
+    curl_easy_reset(curl);
+  } else {
+    curl = curl_easy_init();
+    if (!curl)
+      return nullptr;
+  }
+  if (share_)
+    curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+  return curl;
+}
+
+void CurlHandlePool::Release(CURL* curl) {
+  DCHECK(curl);
+  {
+    base::AutoLock scoped_lock(lock_);
+    if (idle_handles_.size() < kMaxIdleCurlHandles) {
+      idle_handles_.push_back(curl);
+      return;
+    }
+  }
+  curl_easy_cleanup(curl);
+}
+
+void CurlHandlePool::LockShareData(CURL* /* handle */,
+                                   curl_lock_data data,
+                                   curl_lock_access /* access */,
+                                   void* userptr) {
+  static_cast<CurlHandlePool*>(userptr)->share_locks_[data].Acquire();
+}
+
+void CurlHandlePool::UnlockShareData(CURL* /* handle */,
+                                     curl_lock_data data,
+                                     void* userptr) {
+  static_cast<CurlHandlePool*>(userptr)->share_locks_[data].Release();
+}
+
+}  // namespace shaka
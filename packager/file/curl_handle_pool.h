@@ -0,0 +1,92 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_CURL_HANDLE_POOL_H_
+#define PACKAGER_FILE_CURL_HANDLE_POOL_H_
+
+#include <curl/curl.h>
+
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+/// A process wide pool of curl handles, so connections are kept alive and
+/// reused across requests and threads instead of paying for a TCP and TLS
+/// handshake on every request. The connection cache, DNS cache and TLS
+/// sessions are shared between all the handles. This class is thread safe.
+class CurlHandlePool {
+ public:
+  /// @return the process wide pool. libcurl is initialized on the first call,
+  ///         which may not be safe while other threads use libcurl.
+  static CurlHandlePool* GetInstance();
+
+  /// @return A handle with default options, or NULL on failure. The handle
+  ///         should be returned with Release() once the request completes.
+  CURL* Acquire();
+  /// Return a handle obtained with Acquire() to the pool.
+  void Release(CURL* curl);
+
+ private:
+  CurlHandlePool();
+  ~CurlHandlePool();
+
+  static void LockShareData(CURL* handle,
+                            curl_lock_data data,
+                            curl_lock_access access,
+                            void* userptr);
+  static void UnlockShareData(CURL* handle, curl_lock_data data, void* userptr);
+
+  CURLSH* share_;
+  // One lock per type of shared data, as required by curl_share.
+  base::Lock share_locks_[CURL_LOCK_DATA_LAST];
+  base::Lock lock_;
+  std::vector<CURL*> idle_handles_;
+
+  DISALLOW_COPY_AND_ASSIGN(CurlHandlePool);
+};
+
+/// Scoped CURL implementation which returns the handle to the pool when goes
+/// out of scope.
+class ScopedCurl {
+ public:
+  explicit ScopedCurl(CurlHandlePool* pool)
+      : pool_(pool), ptr_(pool->Acquire()) {}
+  ~ScopedCurl() {
+    if (ptr_)
+      pool_->Release(ptr_);
+  }
+
+  CURL* get() { return ptr_; }
+
+ private:
+  CurlHandlePool* pool_;
+  CURL* ptr_;
+  DISALLOW_COPY_AND_ASSIGN(ScopedCurl);
+};
+
+/// Scoped curl_slist implementation which frees itself when goes out of scope.
+class ScopedCurlSlist {
+ public:
+  ScopedCurlSlist() {}
+  ~ScopedCurlSlist() {
+    if (ptr_)
+      curl_slist_free_all(ptr_);
+  }
+
+  void Append(const char* string) { ptr_ = curl_slist_append(ptr_, string); }
+  curl_slist* get() { return ptr_; }
+
+ private:
+  curl_slist* ptr_ = nullptr;
+  DISALLOW_COPY_AND_ASSIGN(ScopedCurlSlist);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_CURL_HANDLE_POOL_H_
@@ -8,6 +8,16 @@
 
 #include <gflags/gflags.h>
 #include <inttypes.h>
+#if defined(OS_POSIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif  // defined(OS_POSIX)
+#if defined(OS_LINUX)
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif  // defined(OS_LINUX)
 #include <algorithm>
 #include <memory>
 #include "packager/base/files/file_util.h"
@@ -17,9 +27,20 @@
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/callback_file.h"
 #include "packager/file/file_util.h"
+#include "packager/file/http_file.h"
+#if defined(OS_LINUX)
+#include "packager/file/io_uring_file.h"
+#endif  // defined(OS_LINUX)
 #include "packager/file/local_file.h"
 #include "packager/file/memory_file.h"
+#include "packager/file/object_storage_file.h"
+#if defined(OS_LINUX)
+#include "packager/file/shm_file.h"
+#endif  // defined(OS_LINUX)
 #include "packager/file/threaded_io_file.h"
+#if defined(OS_LINUX)
+#include "packager/file/udp_event_loop.h"
+#endif  // defined(OS_LINUX)
 #include "packager/file/udp_file.h"
 
 DEFINE_uint64(io_cache_size,
@@ -29,6 +50,29 @@ DEFINE_uint64(io_cache_size,
 DEFINE_uint64(io_block_size,
               1ULL << 16,
               "Size of the block size used for threaded I/O, in bytes.");
+DEFINE_uint64(io_cache_autotune_limit,
+              0,
+              "If non-zero, the threaded I/O caches start small and double "
+              "whenever the packager waits on them, up to --io_cache_size, "
+              "with blocks of an eighth of the cache up to --io_block_size, "
+              "as long as the caches of all the files fit in this many "
+              "bytes. If zero, every cache has --io_cache_size bytes.");
+DEFINE_bool(io_uring,
+            false,
+            "Write local files asynchronously through a process wide io_uring "
+            "submission ring instead of a thread per file, on Linux. "
+            "--io_cache_size and --io_block_size specify the maximum number "
+            "of bytes in flight per file and the write size. Threaded I/O is "
+            "used if io_uring is not available.");
+DEFINE_string(atomic_write_durability,
+              "none",
+              "How atomic writes of local files, e.g. of the manifests, are "
+              "made durable. 'none' leaves it to the platform. 'file' syncs "
+              "the data of the new file before it replaces the old one, so a "
+              "crash does not leave an empty file behind. 'directory' also "
+              "syncs the directory once the file is replaced, so the "
+              "replacement itself survives a crash; the manifests written in "
+              "the same update share one sync per directory.");
 
 // Needed for Windows weirdness which somewhere defines CopyFile as CopyFileW.
 #ifdef CopyFile
@@ -38,8 +82,13 @@ DEFINE_uint64(io_block_size,
 namespace shaka {
 
 const char* kCallbackFilePrefix = "callback://";
+const char* kGcsFilePrefix = "gs://";
+const char* kHttpFilePrefix = "http://";
+const char* kHttpsFilePrefix = "https://";
 const char* kLocalFilePrefix = "file://";
 const char* kMemoryFilePrefix = "memory://";
+const char* kS3FilePrefix = "s3://";
+const char* kShmFilePrefix = "shm://";
 const char* kUdpFilePrefix = "udp://";
 
 namespace {
@@ -68,8 +117,44 @@ bool DeleteLocalFile(const char* file_name) {
   return LocalFile::Delete(file_name);
 }
 
+// The directories to sync at the end of the outermost AtomicWriteBatch of the
+// thread, or null outside of batches.
+thread_local std::set<std::string>* g_pending_directory_syncs = nullptr;
+
+// Syncs a file, or a directory, through a descriptor of its own. Syncing any
+// descriptor of a file writes out all of its dirty data.
+bool SyncPath(const std::string& path, bool data_only) {
+#if defined(OS_POSIX)
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to open '" << path << "' to sync it, errno "
+               << errno;
+    return false;
+  }
+#if defined(OS_LINUX)
+  const int result = data_only ? fdatasync(fd) : fsync(fd);
+#else
+  const int result = fsync(fd);
+#endif  // defined(OS_LINUX)
+  if (result != 0)
+    LOG(ERROR) << "Failed to sync '" << path << "', errno " << errno;
+  close(fd);
+  return result == 0;
+#else
+  // Not supported on Windows.
+  return true;
+#endif  // defined(OS_POSIX)
+}
+
 bool WriteLocalFileAtomically(const char* file_name,
                               const std::string& contents) {
+  const std::string& durability = FLAGS_atomic_write_durability;
+  if (durability != "none" && durability != "file" &&
+      durability != "directory") {
+    LOG(ERROR) << "Invalid --atomic_write_durability " << durability;
+    return false;
+  }
+
   const base::FilePath file_path = base::FilePath::FromUTF8Unsafe(file_name);
   const std::string dir_name = file_path.DirName().AsUTF8Unsafe();
   std::string temp_file_name;
@@ -77,6 +162,13 @@ bool WriteLocalFileAtomically(const char* file_name,
     return false;
   if (!File::WriteStringToFile(temp_file_name.c_str(), contents))
     return false;
+
+  if (durability != "none" &&
+      !SyncPath(temp_file_name, true /* data_only */)) {
+    File::Delete(temp_file_name.c_str());
+    return false;
+  }
+
   base::File::Error replace_file_error = base::File::FILE_OK;
   if (!base::ReplaceFile(base::FilePath::FromUTF8Unsafe(temp_file_name),
                          file_path, &replace_file_error)) {
@@ -84,15 +176,90 @@ bool WriteLocalFileAtomically(const char* file_name,
                << temp_file_name << "', error: " << replace_file_error;
     return false;
   }
+
+  if (durability == "directory") {
+    if (g_pending_directory_syncs) {
+      g_pending_directory_syncs->insert(dir_name);
+      return true;
+    }
+    return SyncPath(dir_name, false /* data_only */);
+  }
   return true;
 }
 
+// The file name passed to the HTTP(S) functions has the scheme stripped.
+std::string MakeHttpUrl(const char* file_name) {
+  return std::string(kHttpFilePrefix) + file_name;
+}
+
+std::string MakeHttpsUrl(const char* file_name) {
+  return std::string(kHttpsFilePrefix) + file_name;
+}
+
+File* CreateHttpFile(const char* file_name, const char* mode) {
+  return new HttpFile(MakeHttpUrl(file_name).c_str(), mode);
+}
+
+File* CreateHttpsFile(const char* file_name, const char* mode) {
+  return new HttpFile(MakeHttpsUrl(file_name).c_str(), mode);
+}
+
+bool DeleteHttpFile(const char* file_name) {
+  return HttpFile::Delete(MakeHttpUrl(file_name).c_str());
+}
+
+bool DeleteHttpsFile(const char* file_name) {
+  return HttpFile::Delete(MakeHttpsUrl(file_name).c_str());
+}
+
+bool WriteHttpFileAtomically(const char* file_name,
+                             const std::string& contents) {
+  return HttpFile::WriteAtomically(MakeHttpUrl(file_name).c_str(), contents);
+}
+
+bool WriteHttpsFileAtomically(const char* file_name,
+                              const std::string& contents) {
+  return HttpFile::WriteAtomically(MakeHttpsUrl(file_name).c_str(), contents);
+}
+
+File* CreateS3File(const char* file_name, const char* mode) {
+  return new ObjectStorageFile(ObjectStorageClient::Service::kS3, file_name,
+                               mode);
+}
+
+File* CreateGcsFile(const char* file_name, const char* mode) {
+  return new ObjectStorageFile(ObjectStorageClient::Service::kGcs, file_name,
+                               mode);
+}
+
+bool DeleteS3File(const char* file_name) {
+  return ObjectStorageFile::Delete(ObjectStorageClient::Service::kS3,
+                                   file_name);
+}
+
+bool DeleteGcsFile(const char* file_name) {
+  return ObjectStorageFile::Delete(ObjectStorageClient::Service::kGcs,
+                                   file_name);
+}
+
+bool WriteS3FileAtomically(const char* file_name, const std::string& contents) {
+  return ObjectStorageFile::WriteAtomically(ObjectStorageClient::Service::kS3,
+                                            file_name, contents);
+}
+
+bool WriteGcsFileAtomically(const char* file_name,
+                            const std::string& contents) {
+  return ObjectStorageFile::WriteAtomically(ObjectStorageClient::Service::kGcs,
+                                            file_name, contents);
+}
+
 File* CreateUdpFile(const char* file_name, const char* mode) {
-  if (strcmp(mode, "r")) {
-    NOTIMPLEMENTED() << "UdpFile only supports read (receive) mode.";
+  if (strcmp(mode, "r") && strcmp(mode, "w")) {
+    NOTIMPLEMENTED() << "UdpFile only supports read (receive) and write "
+                        "(send) modes.";
     return NULL;
   }
-  return new UdpFile(file_name);
+  return new UdpFile(file_name, mode);
 }
 
 File* CreateMemoryFile(const char* file_name, const char* mode) {
@@ -104,6 +271,20 @@ bool DeleteMemoryFile(const char* file_name) {
   return true;
 }
 
+#if defined(OS_LINUX)
+File* CreateShmFile(const char* file_name, const char* mode) {
+  if (strcmp(mode, "r") && strcmp(mode, "w")) {
+    NOTIMPLEMENTED() << "ShmFile only supports read and write modes.";
+    return NULL;
+  }
+  return new ShmFile(file_name, mode);
+}
+
+bool DeleteShmFile(const char* file_name) {
+  return ShmFile::Delete(file_name);
+}
+#endif  // defined(OS_LINUX)
+
 static const FileTypeInfo kFileTypeInfo[] = {
     {
         kLocalFilePrefix,
@@ -114,6 +295,15 @@ static const FileTypeInfo kFileTypeInfo[] = {
     {kUdpFilePrefix, &CreateUdpFile, nullptr, nullptr},
     {kMemoryFilePrefix, &CreateMemoryFile, &DeleteMemoryFile, nullptr},
     {kCallbackFilePrefix, &CreateCallbackFile, nullptr, nullptr},
+    {kHttpFilePrefix, &CreateHttpFile, &DeleteHttpFile,
+     &WriteHttpFileAtomically},
+    {kHttpsFilePrefix, &CreateHttpsFile, &DeleteHttpsFile,
+     &WriteHttpsFileAtomically},
+    {kS3FilePrefix, &CreateS3File, &DeleteS3File, &WriteS3FileAtomically},
+    {kGcsFilePrefix, &CreateGcsFile, &DeleteGcsFile, &WriteGcsFileAtomically},
+#if defined(OS_LINUX)
+    {kShmFilePrefix, &CreateShmFile, &DeleteShmFile, nullptr},
+#endif  // defined(OS_LINUX)
 };
 
 base::StringPiece GetFileTypePrefix(base::StringPiece file_name) {
@@ -135,29 +325,127 @@ const FileTypeInfo* GetFileTypeInfo(base::StringPiece file_name,
   return &kFileTypeInfo[0];
 }
 
+#if defined(OS_LINUX)
+// Copy up to |max_copy| bytes from |in_fd| to |out_fd| in the kernel, from
+// and to their current positions. copy_file_range shares the extents on
+// filesystems supporting reflinks, and is tried first; sendfile is used
+// where it is not available, e.g. across filesystems on older kernels.
+// Returns the number of bytes copied, or -1 on error. |supported| is set to
+// false if neither is supported, in which case nothing is copied.
+int64_t KernelCopy(int in_fd, int out_fd, int64_t max_copy, bool* supported) {
+  // Each call copies at most 1 GiB, so progress is made in bounded steps.
+  const int64_t kMaxChunkSize = 1 << 30;
+#if defined(__NR_copy_file_range)
+  bool use_copy_file_range = true;
+#else
+  bool use_copy_file_range = false;
+#endif  // defined(__NR_copy_file_range)
+  *supported = true;
+  int64_t bytes_copied = 0;
+  while (bytes_copied < max_copy) {
+    const size_t size = std::min(kMaxChunkSize, max_copy - bytes_copied);
+    ssize_t result;
+#if defined(__NR_copy_file_range)
+    if (use_copy_file_range) {
+      result = syscall(__NR_copy_file_range, in_fd, nullptr, out_fd, nullptr,
+                       size, 0u);
+    } else {
+      result = sendfile(out_fd, in_fd, nullptr, size);
+    }
+#else
+    result = sendfile(out_fd, in_fd, nullptr, size);
+#endif  // defined(__NR_copy_file_range)
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      const bool unsupported = errno == ENOSYS || errno == EXDEV ||
+                               errno == EINVAL || errno == EOPNOTSUPP;
+      if (unsupported && bytes_copied == 0) {
+        if (use_copy_file_range) {
+          use_copy_file_range = false;
+          continue;
+        }
+        *supported = false;
+        return 0;
+      }
+      LOG(ERROR) << "Kernel side copy failed, errno " << errno;
+      return -1;
+    }
+    if (result == 0)
+      break;
+    bytes_copied += result;
+  }
+  return bytes_copied;
+}
+#endif  // defined(OS_LINUX)
+
 }  // namespace
 
 File* File::Create(const char* file_name, const char* mode) {
+#if defined(OS_LINUX)
+  if (FLAGS_io_uring && (!strcmp(mode, "w") || !strcmp(mode, "a"))) {
+    base::StringPiece real_file_name;
+    const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
+    if (file_type == &kFileTypeInfo[0] && IoUringFile::IsSupported()) {
+      return new IoUringFile(real_file_name.data(), mode, FLAGS_io_cache_size,
+                             FLAGS_io_block_size);
+    }
+  }
+#endif  // defined(OS_LINUX)
+
   std::unique_ptr<File, FileCloser> internal_file(
       CreateInternalFile(file_name, mode));
 
   base::StringPiece file_type_prefix = GetFileTypePrefix(file_name);
   if (file_type_prefix == kMemoryFilePrefix ||
-      file_type_prefix == kCallbackFilePrefix) {
-    // Disable caching for memory and callback files.
+      file_type_prefix == kCallbackFilePrefix ||
+      file_type_prefix == kHttpFilePrefix ||
+      file_type_prefix == kHttpsFilePrefix ||
+      file_type_prefix == kS3FilePrefix ||
+      file_type_prefix == kGcsFilePrefix ||
+      file_type_prefix == kShmFilePrefix) {
+    // Disable caching for memory and callback files. HTTP files upload on their
+    // own thread already. Shared memory files are rings themselves.
+    return internal_file.release();
+  }
+#if defined(OS_LINUX)
+  if (file_type_prefix == kUdpFilePrefix && !strcmp(mode, "r") &&
+      UdpEventLoop::GetInstance()) {
+    // The UDP event loop buffers the datagrams in a ring already.
     return internal_file.release();
   }
+#endif  // defined(OS_LINUX)
 
   if (FLAGS_io_cache_size) {
     // Enable threaded I/O for "r", "w", and "a" modes only.
     if (!strcmp(mode, "r")) {
-      return new ThreadedIoFile(std::move(internal_file),
-                                ThreadedIoFile::kInputMode, FLAGS_io_cache_size,
-                                FLAGS_io_block_size);
+      // Reading from a UDP socket or a pipe blocks until data arrives, which
+      // would hold a thread of the shared executor indefinitely.
+      base::StringPiece real_file_name;
+      const bool is_local_file =
+          GetFileTypeInfo(file_name, &real_file_name) == &kFileTypeInfo[0];
+      std::unique_ptr<IoExecutor> dedicated_executor;
+      if (file_type_prefix == kUdpFilePrefix ||
+          (is_local_file && !IsLocalRegularFile(file_name))) {
+        // On the NUMA node of the calling job, like the shared executor.
+        dedicated_executor.reset(new IoExecutor(1, "BlockingFileIo",
+                                                IoExecutor::GetLocalCpus()));
+      }
+      return new ThreadedIoFile(
+          std::move(internal_file), ThreadedIoFile::kInputMode,
+          FLAGS_io_cache_size, FLAGS_io_block_size,
+          FLAGS_io_cache_autotune_limit, std::move(dedicated_executor));
     } else if (!strcmp(mode, "w") || !strcmp(mode, "a")) {
-      return new ThreadedIoFile(std::move(internal_file),
-                                ThreadedIoFile::kOutputMode,
-                                FLAGS_io_cache_size, FLAGS_io_block_size);
+      // Likewise, paced UDP sends wait for the send times of the datagrams.
+      std::unique_ptr<IoExecutor> dedicated_executor;
+      if (file_type_prefix == kUdpFilePrefix) {
+        dedicated_executor.reset(new IoExecutor(1, "BlockingFileIo",
+                                                IoExecutor::GetLocalCpus()));
+      }
+      return new ThreadedIoFile(
+          std::move(internal_file), ThreadedIoFile::kOutputMode,
+          FLAGS_io_cache_size, FLAGS_io_block_size,
+          FLAGS_io_cache_autotune_limit, std::move(dedicated_executor));
     }
   }
 
@@ -195,6 +483,28 @@ File* File::OpenWithNoBuffering(const char* file_name, const char* mode) {
   return file;
 }
 
+int64_t File::WriteV(const std::vector<IoBlock>& blocks) {
+  int64_t total_bytes_written = 0;
+  for (const IoBlock& block : blocks) {
+    const uint8_t* buffer = static_cast<const uint8_t*>(block.buffer);
+    uint64_t remaining_length = block.length;
+    while (remaining_length > 0) {
+      const int64_t bytes_written = Write(buffer, remaining_length);
+      if (bytes_written <= 0)
+        return total_bytes_written > 0 ? total_bytes_written : bytes_written;
+      buffer += bytes_written;
+      remaining_length -= bytes_written;
+      total_bytes_written += bytes_written;
+    }
+  }
+  return total_bytes_written;
+}
+
+int64_t File::WriteSharedBuffer(SharedBuffer buffer) {
+  DCHECK(buffer);
+  return WriteV({{buffer->data(), buffer->size()}});
+}
+
 bool File::Delete(const char* file_name) {
   base::StringPiece real_file_name;
   const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
@@ -278,7 +588,68 @@ bool File::WriteFileAtomically(const char* file_name,
   return WriteStringToFile(file_name, contents);
 }
 
+AtomicWriteBatch::AtomicWriteBatch() {
+  if (!g_pending_directory_syncs) {
+    g_pending_directory_syncs = &directories_;
+    outermost_ = true;
+  }
+}
+
+AtomicWriteBatch::~AtomicWriteBatch() {
+  if (!outermost_)
+    return;
+  g_pending_directory_syncs = nullptr;
+  // The files have been replaced already, so a failure only leaves them less
+  // durable, which is logged by SyncPath().
+  for (const std::string& directory : directories_)
+    SyncPath(directory, false /* data_only */);
+}
+
 bool File::Copy(const char* from_file_name, const char* to_file_name) {
+#if defined(OS_LINUX)
+  base::StringPiece real_from_file_name;
+  base::StringPiece real_to_file_name;
+  if (GetFileTypeInfo(from_file_name, &real_from_file_name) ==
+          &kFileTypeInfo[0] &&
+      GetFileTypeInfo(to_file_name, &real_to_file_name) == &kFileTypeInfo[0]) {
+    // Local files are copied in the kernel. Opening the destination truncates
+    // it, so a file copied to itself is left alone.
+    struct stat from_stat;
+    struct stat to_stat;
+    if (stat(real_from_file_name.data(), &from_stat) == 0 &&
+        stat(real_to_file_name.data(), &to_stat) == 0 &&
+        from_stat.st_dev == to_stat.st_dev &&
+        from_stat.st_ino == to_stat.st_ino) {
+      return true;
+    }
+
+    std::unique_ptr<File, FileCloser> input_file(
+        File::OpenWithNoBuffering(from_file_name, "r"));
+    if (!input_file) {
+      LOG(ERROR) << "Failed to open file " << from_file_name;
+      return false;
+    }
+    std::unique_ptr<File, FileCloser> output_file(
+        File::OpenWithNoBuffering(to_file_name, "w"));
+    if (!output_file) {
+      LOG(ERROR) << "Failed to write to " << to_file_name;
+      return false;
+    }
+    if (CopyFile(input_file.get(), output_file.get()) < 0) {
+      LOG(ERROR) << "Failure while copying " << from_file_name << " to "
+                 << to_file_name;
+      return false;
+    }
+    if (!output_file.release()->Close()) {
+      LOG(ERROR)
+          << "Failed to close file '" << to_file_name
+          << "', possibly file permission issue or running out of disk space.";
+      return false;
+    }
+    return true;
+  }
+#endif  // defined(OS_LINUX)
+
   std::string content;
   if (!ReadFileToString(from_file_name, &content)) {
     LOG(ERROR) << "Failed to open file " << from_file_name;
@@ -323,6 +694,29 @@ int64_t File::CopyFile(File* source, File* destination, int64_t max_copy) {
   if (max_copy < 0)
     max_copy = std::numeric_limits<int64_t>::max();
 
+#if defined(OS_LINUX)
+  const int source_fd = source->BeginKernelCopy();
+  if (source_fd >= 0) {
+    const int destination_fd = destination->BeginKernelCopy();
+    if (destination_fd < 0) {
+      if (!source->EndKernelCopy(0))
+        return -1;
+    } else {
+      bool supported = false;
+      const int64_t bytes_copied =
+          KernelCopy(source_fd, destination_fd, max_copy, &supported);
+      const uint64_t bytes_moved = std::max<int64_t>(bytes_copied, 0);
+      const bool source_ended = source->EndKernelCopy(bytes_moved);
+      const bool destination_ended = destination->EndKernelCopy(bytes_moved);
+      if (bytes_copied < 0 || !source_ended || !destination_ended)
+        return -1;
+      if (supported)
+        return bytes_copied;
+      // Otherwise fall back to copying through a user space buffer.
+    }
+  }
+#endif  // defined(OS_LINUX)
+
   const int64_t kBufferSize = 0x40000;  // 256KB.
   std::unique_ptr<uint8_t[]> buffer(new uint8_t[kBufferSize]);
   int64_t bytes_copied = 0;
@@ -15,18 +15,36 @@
       'sources': [
         'callback_file.cc',
         'callback_file.h',
+        'cpu_affinity.cc',
+        'cpu_affinity.h',
+        'curl_handle_pool.cc',
+        'curl_handle_pool.h',
         'file.cc',
         'file.h',
         'file_util.cc',
         'file_util.h',
         'file_closer.h',
+        'http_file.cc',
+        'http_file.h',
         'io_cache.cc',
         'io_cache.h',
+        'io_executor.cc',
+        'io_executor.h',
         'local_file.cc',
         'local_file.h',
         'memory_file.cc',
         'memory_file.h',
+        'memory_mapped_file_reader.cc',
+        'memory_mapped_file_reader.h',
+        'memory_origin_server.cc',
+        'memory_origin_server.h',
+        'object_storage_client.cc',
+        'object_storage_client.h',
+        'object_storage_file.cc',
+        'object_storage_file.h',
         'public/buffer_callback_params.h',
+        'segment_reaper.cc',
+        'segment_reaper.h',
         'threaded_io_file.cc',
         'threaded_io_file.h',
         'udp_file.cc',
@@ -36,20 +54,59 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../metrics/metrics.gyp:metrics',
+        '../third_party/boringssl/boringssl.gyp:boringssl',
+        '../third_party/curl/curl.gyp:libcurl',
         '../third_party/gflags/gflags.gyp:gflags',
       ],
+      'conditions': [
+        ['OS == "linux"', {
+          'sources': [
+            'io_uring_file.cc',
+            'io_uring_file.h',
+            'shm_file.cc',
+            'shm_file.h',
+            'udp_event_loop.cc',
+            'udp_event_loop.h',
+          ],
+          'link_settings': {
+            'libraries': [
+              '-lrt',
+            ],
+          },
+        }],
+      ],
     },
     {
       'target_name': 'file_unittest',
       'type': '<(gtest_target_type)',
       'sources': [
         'callback_file_unittest.cc',
+        'cpu_affinity_unittest.cc',
         'file_unittest.cc',
         'file_util_unittest.cc',
+        'http_file_unittest.cc',
         'io_cache_unittest.cc',
+        'io_executor_unittest.cc',
         'memory_file_unittest.cc',
+        'memory_mapped_file_reader_unittest.cc',
+        'object_storage_client_unittest.cc',
+        'segment_reaper_unittest.cc',
         'udp_options_unittest.cc',
       ],
+      'conditions': [
+        ['OS == "linux"', {
+          'sources': [
+            'shm_file_unittest.cc',
+            'udp_event_loop_unittest.cc',
+          ],
+        }],
+        ['OS != "win"', {
+          'sources': [
+            'memory_origin_server_unittest.cc',
+          ],
+        }],
+      ],
       'dependencies': [
         '../media/test/media_test.gyp:run_tests_with_atexit_manager',
         '../testing/gmock.gyp:gmock',
@@ -9,7 +9,9 @@
 
 #include <stdint.h>
 
+#include <set>
 #include <string>
+#include <vector>
 
 #include "packager/base/macros.h"
 #include "packager/file/public/buffer_callback_params.h"
@@ -17,8 +19,13 @@
 namespace shaka {
 
 extern const char* kCallbackFilePrefix;
+extern const char* kGcsFilePrefix;
+extern const char* kHttpFilePrefix;
+extern const char* kHttpsFilePrefix;
 extern const char* kLocalFilePrefix;
 extern const char* kMemoryFilePrefix;
+extern const char* kS3FilePrefix;
+extern const char* kShmFilePrefix;
 extern const char* kUdpFilePrefix;
 const int64_t kWholeFile = -1;
 
@@ -67,6 +74,31 @@ class File {
   /// @return Number of bytes written, or a value < 0 on error.
   virtual int64_t Write(const void* buffer, uint64_t length) = 0;
 
+  /// A block of memory to be written with WriteV().
+  struct IoBlock {
+    const void* buffer;
+    uint64_t length;
+  };
+
+  /// Write a sequence of blocks of data, in order, as if they were a single
+  /// contiguous block. The default implementation calls Write() for each
+  /// block; implementations that support vectored I/O may override it to
+  /// avoid the extra system calls.
+  /// @param blocks contains the blocks to be written.
+  /// @return Number of bytes written, or a value < 0 on error.
+  virtual int64_t WriteV(const std::vector<IoBlock>& blocks);
+
+  /// @return true if the file can take ownership of the buffers passed to
+  ///         WriteSharedBuffer() instead of copying them.
+  virtual bool CanTakeSharedBuffers() { return false; }
+
+  /// Write a reference counted buffer, which the file may keep instead of
+  /// copying the data. The default implementation calls Write().
+  /// @param buffer contains the data to be written. It should not be modified
+  ///        afterwards.
+  /// @return Number of bytes written, or a value < 0 on error.
+  virtual int64_t WriteSharedBuffer(SharedBuffer buffer);
+
   /// @return Size of the file in bytes. A return value less than zero
   ///         indicates a problem getting the size.
   virtual int64_t Size() = 0;
@@ -114,16 +146,18 @@ class File {
   static bool WriteStringToFile(const char* file_name,
                                 const std::string& contents);
 
-  /// Save `contents` to `file_name` in an atomic manner.
+  /// Save `contents` to `file_name` in an atomic manner. How local files are
+  /// made durable is specified by --atomic_write_durability.
   /// @param file_name is the destination file name.
   /// @param contents is the data to be saved.
   /// @return true on success, false otherwise.
   static bool WriteFileAtomically(const char* file_name,
                                   const std::string& contents);
 
-  /// Copies files. This is not good for copying huge files. Although not
-  /// recommended, it is safe to have source file and destination file name be
-  /// the same.
+  /// Copies files. Local files are copied in the kernel where supported;
+  /// other files are read into memory first, which is not good for huge
+  /// files. Although not recommended, it is safe to have source file and
+  /// destination file name be the same.
   /// @param from_file_name is the source file name.
   /// @param to_file_name is the destination file name.
   /// @return true on success, false otherwise.
@@ -135,7 +169,9 @@ class File {
   /// @return Number of bytes written, or a value < 0 on error.
   static int64_t CopyFile(File* source, File* destination);
 
-  /// Copies the contents from source to destination.
+  /// Copies the contents from source to destination. When both are local
+  /// files, the data is copied in the kernel, with copy_file_range or
+  /// sendfile, instead of going through a user space buffer.
   /// @param source The file to copy from.
   /// @param destination The file to copy to.
   /// @param max_copy The maximum number of bytes to copy; < 0 to copy to EOF.
@@ -176,6 +212,19 @@ class File {
   /// Internal open. Should not be used directly.
   virtual bool Open() = 0;
 
+  /// Prepare the file for a kernel side copy at its current position, by
+  /// CopyFile(). This is only supported by local files.
+  /// @return the file descriptor positioned at the current position, or -1 if
+  ///         kernel side copies are not supported. EndKernelCopy() must be
+  ///         called once the copy is done if the descriptor is valid.
+  virtual int BeginKernelCopy() { return -1; }
+
+  /// Complete a kernel side copy started with BeginKernelCopy().
+  /// @param bytes_copied is the number of bytes copied through the file
+  ///        descriptor, which advanced its position.
+  /// @return true on success, false otherwise.
+  virtual bool EndKernelCopy(uint64_t bytes_copied) { return false; }
+
  private:
   friend class ThreadedIoFile;
 
@@ -191,6 +240,25 @@ class File {
   DISALLOW_COPY_AND_ASSIGN(File);
 };
 
+/// Batches the directory syncs of the atomic writes of local files made by the
+/// calling thread while it is in scope, when --atomic_write_durability is
+/// 'directory'. Each directory written to is synced once when the outermost
+/// batch goes out of scope, instead of once per file, so the manifests of an
+/// update share the syncs.
+class AtomicWriteBatch {
+ public:
+  AtomicWriteBatch();
+  ~AtomicWriteBatch();
+
+ private:
+  AtomicWriteBatch(const AtomicWriteBatch&) = delete;
+  AtomicWriteBatch& operator=(const AtomicWriteBatch&) = delete;
+
+  // The directories to sync, if this is the outermost batch of the thread.
+  std::set<std::string> directories_;
+  bool outermost_ = false;
+};
+
 }  // namespace shaka
 
 #endif  // PACKAGER_FILE_FILE_H_
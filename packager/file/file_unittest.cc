@@ -12,6 +12,9 @@
 
 DECLARE_uint64(io_cache_size);
 DECLARE_uint64(io_block_size);
+DECLARE_bool(io_uring);
+DECLARE_string(local_file_cache_mode);
+DECLARE_string(atomic_write_durability);
 
 namespace {
 const int kDataSize = 1024;
@@ -90,6 +93,52 @@ TEST_F(LocalFileTest, Copy) {
   base::DeleteFile(temp_dir, true);
 }
 
+TEST_F(LocalFileTest, CopyItself) {
+  ASSERT_TRUE(File::WriteStringToFile(local_file_name_.c_str(), data_));
+  ASSERT_TRUE(
+      File::Copy(local_file_name_.c_str(), local_file_name_no_prefix_.c_str()));
+  std::string read_data;
+  ASSERT_TRUE(File::ReadFileToString(local_file_name_.c_str(), &read_data));
+  EXPECT_EQ(data_, read_data);
+}
+
+TEST_F(LocalFileTest, CopyFileRange) {
+  const int kOffset = 10;
+  const int kCopySize = 100;
+  ASSERT_TRUE(File::WriteStringToFile(local_file_name_.c_str(), data_));
+
+  FilePath temp_file_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&temp_file_path));
+  const std::string destination_name = temp_file_path.AsUTF8Unsafe();
+
+  // The copy has to account for the data cached by threaded I/O.
+  File* source = File::Open(local_file_name_.c_str(), "r");
+  ASSERT_TRUE(source);
+  ASSERT_TRUE(source->Seek(kOffset));
+  File* destination = File::Open(destination_name.c_str(), "w");
+  ASSERT_TRUE(destination);
+  ASSERT_EQ(3, destination->Write("abc", 3));
+
+  EXPECT_EQ(kCopySize, File::CopyFile(source, destination, kCopySize));
+
+  uint64_t position = 0;
+  ASSERT_TRUE(source->Tell(&position));
+  EXPECT_EQ(static_cast<uint64_t>(kOffset + kCopySize), position);
+  char next_byte = 0;
+  ASSERT_EQ(1, source->Read(&next_byte, 1));
+  EXPECT_EQ(data_[kOffset + kCopySize], next_byte);
+  EXPECT_TRUE(source->Close());
+
+  ASSERT_EQ(3, destination->Write("xyz", 3));
+  EXPECT_EQ(3 + kCopySize + 3, destination->Size());
+  EXPECT_TRUE(destination->Close());
+
+  std::string read_data;
+  ASSERT_TRUE(File::ReadFileToString(destination_name.c_str(), &read_data));
+  EXPECT_EQ("abc" + data_.substr(kOffset, kCopySize) + "xyz", read_data);
+  base::DeleteFile(temp_file_path, false);
+}
+
 TEST_F(LocalFileTest, Write) {
   // Write file using File API.
   File* file = File::Open(local_file_name_.c_str(), "w");
@@ -107,6 +156,58 @@ TEST_F(LocalFileTest, Write) {
   EXPECT_EQ(data_, read_data);
 }
 
+TEST_F(LocalFileTest, WriteWithCacheModes) {
+  google::FlagSaver flag_saver;
+  for (const char* cache_mode : {"dontneed", "direct"}) {
+    FLAGS_local_file_cache_mode = cache_mode;
+    // Not a multiple of the O_DIRECT alignment, so there is a tail to write.
+    const std::string data = data_ + data_.substr(0, 123);
+    File* file = File::Open(local_file_name_.c_str(), "w");
+    ASSERT_TRUE(file != NULL);
+    EXPECT_EQ(static_cast<int64_t>(data.size()),
+              file->Write(data.data(), data.size()));
+    EXPECT_EQ(static_cast<int64_t>(data.size()), file->Size());
+    EXPECT_TRUE(file->Close());
+
+    std::string read_data;
+    ASSERT_TRUE(File::ReadFileToString(local_file_name_.c_str(), &read_data));
+    EXPECT_EQ(data, read_data) << cache_mode;
+  }
+}
+
+TEST_F(LocalFileTest, InvalidCacheMode) {
+  google::FlagSaver flag_saver;
+  FLAGS_local_file_cache_mode = "invalid";
+  EXPECT_FALSE(File::Open(local_file_name_.c_str(), "w"));
+}
+
+TEST_F(LocalFileTest, WriteV) {
+  // Interleave Write() and WriteV() to verify the writes stay in order, with
+  // and without buffering.
+  const int kHalfDataSize = kDataSize / 2;
+  for (bool no_buffering : {false, true}) {
+    File* file = no_buffering
+                     ? File::OpenWithNoBuffering(local_file_name_.c_str(), "w")
+                     : File::Open(local_file_name_.c_str(), "w");
+    ASSERT_TRUE(file != NULL);
+    EXPECT_EQ(1, file->Write(&data_[0], 1));
+    const std::vector<File::IoBlock> blocks = {
+        {&data_[1], 0},
+        {&data_[1], kHalfDataSize - 1},
+        {&data_[kHalfDataSize], kHalfDataSize - 1},
+    };
+    EXPECT_EQ(kDataSize - 2, file->WriteV(blocks));
+    EXPECT_EQ(1, file->Write(&data_[kDataSize - 1], 1));
+    EXPECT_EQ(kDataSize, file->Size());
+    EXPECT_TRUE(file->Close());
+
+    std::string read_data(kDataSize, 0);
+    ASSERT_EQ(kDataSize,
+              base::ReadFile(test_file_path_, &read_data[0], kDataSize));
+    EXPECT_EQ(data_, read_data);
+  }
+}
+
 TEST_F(LocalFileTest, Read_And_Eof) {
   // Write file using file_util API.
   ASSERT_EQ(kDataSize,
@@ -174,6 +275,33 @@ TEST_F(LocalFileTest, AtomicWriteRead) {
   EXPECT_EQ(data_, read_data);
 }
 
+TEST_F(LocalFileTest, AtomicWriteWithDurabilityModes) {
+  google::FlagSaver flag_saver;
+  for (const char* durability : {"file", "directory"}) {
+    FLAGS_atomic_write_durability = durability;
+    {
+      AtomicWriteBatch batch;
+      ASSERT_TRUE(File::WriteFileAtomically(
+          local_file_name_no_prefix_.c_str(), durability));
+      // Nested batches leave the syncs to the outermost one.
+      AtomicWriteBatch nested_batch;
+      ASSERT_TRUE(File::WriteFileAtomically(
+          local_file_name_no_prefix_.c_str(), data_));
+    }
+    std::string read_data;
+    ASSERT_TRUE(File::ReadFileToString(local_file_name_no_prefix_.c_str(),
+                                       &read_data));
+    EXPECT_EQ(data_, read_data) << durability;
+  }
+}
+
+TEST_F(LocalFileTest, InvalidAtomicWriteDurability) {
+  google::FlagSaver flag_saver;
+  FLAGS_atomic_write_durability = "invalid";
+  EXPECT_FALSE(
+      File::WriteFileAtomically(local_file_name_no_prefix_.c_str(), data_));
+}
+
 TEST_F(LocalFileTest, WriteFlushCheckSize) {
   const uint32_t kNumCycles(10);
   const uint32_t kNumWrites(10);
@@ -261,6 +389,40 @@ INSTANTIATE_TEST_CASE_P(TestSeekWithDifferentCacheSizes,
                         ParamLocalFileTest,
                         ::testing::Values(20u, 1000u));
 
+// Falls back to threaded I/O if io_uring is not available.
+TEST_F(LocalFileTest, IoUringWriteRead) {
+  google::FlagSaver flag_saver;
+  FLAGS_io_uring = true;
+  FLAGS_io_block_size = 100;
+  FLAGS_io_cache_size = 300;
+
+  File* file = File::Open(local_file_name_.c_str(), "w");
+  ASSERT_TRUE(file != nullptr);
+  for (int i = 0; i < 10; ++i)
+    ASSERT_EQ(kDataSize, file->Write(data_.data(), kDataSize));
+  // Overwrite the beginning of the file.
+  ASSERT_TRUE(file->Seek(0));
+  ASSERT_EQ(3, file->Write("abc", 3));
+  uint64_t position;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(3u, position);
+  EXPECT_EQ(10 * kDataSize, file->Size());
+  ASSERT_TRUE(file->Close());
+
+  file = File::Open(local_file_name_.c_str(), "a");
+  ASSERT_TRUE(file != nullptr);
+  ASSERT_EQ(kDataSize, file->Write(data_.data(), kDataSize));
+  ASSERT_TRUE(file->Close());
+
+  std::string expected_data;
+  for (int i = 0; i < 11; ++i)
+    expected_data += data_;
+  expected_data.replace(0, 3, "abc");
+  std::string read_data;
+  ASSERT_TRUE(File::ReadFileToString(local_file_name_.c_str(), &read_data));
+  EXPECT_EQ(expected_data, read_data);
+}
+
 // This test should only be enabled for filesystems which do not allow seeking
 // past EOF.
 TEST_F(LocalFileTest, DISABLED_WriteSeekOutOfBounds) {
@@ -0,0 +1,286 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/http_file.h"
+
+#include <gflags/gflags.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/location.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/base/time/time.h"
+#include "packager/file/curl_handle_pool.h"
+
+DEFINE_string(http_upload_method,
+              "PUT",
+              "HTTP method used to upload the files written to http:// and "
+              "https:// URLs, PUT or POST.");
+DEFINE_int32(http_upload_retries,
+             3,
+             "Number of times a failed upload to an http:// or https:// URL "
+             "is retried, with an exponential backoff starting at one "
+             "second. Client errors, i.e. 4xx responses other than 408 and "
+             "429, and failures after more than 8 MB of a file was sent are "
+             "not retried.");
+
+namespace shaka {
+
+namespace {
+
+const char kUserAgentString[] = "shaka-packager-uploader/1.0";
+const char kContentTypeHeader[] = "Content-Type: application/octet-stream";
+// Size of the buffer between the muxer and the upload thread.
+const uint64_t kUploadCacheSize = 1 << 20;
+// The data of a chunked upload is kept up to this size, to be sent again if
+// the request is retried. Uploads which fail once more data was sent are not
+// retried.
+const size_t kMaxReplayDataSize = 8 << 20;
+const int kInitialRetryDelayInSeconds = 1;
+
+bool IsUploadMethodValid() {
+  if (FLAGS_http_upload_method == "PUT" || FLAGS_http_upload_method == "POST")
+    return true;
+  LOG(ERROR) << "Invalid --http_upload_method " << FLAGS_http_upload_method
+             << ". Expecting PUT or POST.";
+  return false;
+}
+
+size_t DiscardResponse(char* /* ptr */,
+                       size_t size,
+                       size_t nmemb,
+                       void* /* user_data */) {
+  return size * nmemb;
+}
+
+// The data of a non chunked upload.
+struct UploadData {
+  const std::string* contents;
+  size_t position;
+};
+
+size_t ReadUploadData(char* buffer,
+                      size_t size,
+                      size_t nitems,
+                      void* user_data) {
+  UploadData* upload_data = static_cast<UploadData*>(user_data);
+  const size_t length =
+      std::min(size * nitems,
+               upload_data->contents->size() - upload_data->position);
+  memcpy(buffer, upload_data->contents->data() + upload_data->position,
+         length);
+  upload_data->position += length;
+  return length;
+}
+
+// Perform the request set up by |set_up_request| on a pooled handle, retrying
+// on connection errors, timeouts and server errors. |set_up_request| returns
+// false if the request cannot be attempted again, which fails it.
+bool PerformRequest(const std::string& url,
+                    const char* method,
+                    const std::function<bool(CURL*)>& set_up_request) {
+  for (int attempt = 0;; ++attempt) {
+    {
+      ScopedCurl scoped_curl(CurlHandlePool::GetInstance());
+      CURL* curl = scoped_curl.get();
+      if (!curl) {
+        LOG(ERROR) << "curl_easy_init() failed.";
+        return false;
+      }
+      curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+      curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+      curl_easy_setopt(curl, CURLOPT_USERAGENT, kUserAgentString);
+      curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+      curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+      curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+      curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, DiscardResponse);
+      ScopedCurlSlist headers;
+      headers.Append(kContentTypeHeader);
+      curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.get());
+      if (!set_up_request(curl))
+        return false;
+
+      const CURLcode res = curl_easy_perform(curl);
+      if (res == CURLE_OK)
+        return true;
+
+      long response_code = 0;
+      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+      LOG(WARNING) << method << " " << url
+                   << " failed: " << curl_easy_strerror(res)
+                   << " Response code: " << response_code << ".";
+      const bool client_error = res == CURLE_HTTP_RETURNED_ERROR &&
+                                response_code >= 400 && response_code < 500 &&
+                                response_code != 408 && response_code != 429;
+      if (client_error || attempt >= FLAGS_http_upload_retries) {
+        LOG(ERROR) << method << " " << url << " failed after " << attempt + 1
+                   << " attempt(s).";
+        return false;
+      }
+    }
+    base::PlatformThread::Sleep(base::TimeDelta::FromSeconds(
+        kInitialRetryDelayInSeconds << std::min(attempt, 5)));
+  }
+}
+
+}  // namespace
+
+HttpFile::HttpFile(const char* url, const char* mode)
+    : File(url),
+      url_(url),
+      mode_(mode),
+      cache_(kUploadCacheSize),
+      position_(0),
+      replay_position_(0),
+      replay_data_dropped_(false),
+      upload_failed_(false),
+      task_exit_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                       base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+HttpFile::~HttpFile() {}
+
+bool HttpFile::Delete(const char* url) {
+  return PerformRequest(url, "DELETE", [](CURL* /* curl */) { return true; });
+}
+
+bool HttpFile::WriteAtomically(const char* url, const std::string& contents) {
+  if (!IsUploadMethodValid())
+    return false;
+  UploadData upload_data;
+  return PerformRequest(
+      url, FLAGS_http_upload_method.c_str(),
+      [&contents, &upload_data](CURL* curl) {
+        upload_data.contents = &contents;
+        upload_data.position = 0;
+        curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+        curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE,
+                         static_cast<curl_off_t>(contents.size()));
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, ReadUploadData);
+        curl_easy_setopt(curl, CURLOPT_READDATA, &upload_data);
+        return true;
+      });
+}
+
+bool HttpFile::Open() {
+  if (mode_ != "w") {
+    LOG(ERROR) << "HttpFile only supports write mode: " << url_;
+    return false;
+  }
+  if (!IsUploadMethodValid())
+    return false;
+
+  base::WorkerPool::PostTask(
+      FROM_HERE, base::Bind(&HttpFile::UploadTask, base::Unretained(this)),
+      true /* task_is_slow */);
+  return true;
+}
+
+bool HttpFile::Close() {
+  // Closing the cache ends the request body once the cached data is sent.
+  cache_.Close();
+  task_exit_event_.Wait();
+  const bool result = !upload_failed_;
+  delete this;
+  return result;
+}
+
+int64_t HttpFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "HttpFile does not support reading.";
+  return -1;
+}
+
+int64_t HttpFile::Write(const void* buffer, uint64_t length) {
+  if (upload_failed_)
+    return -1;
+  const uint64_t bytes_written = cache_.Write(buffer, length);
+  if (bytes_written == 0 && length > 0)
+    return -1;
+  position_ += bytes_written;
+  return bytes_written;
+}
+
+int64_t HttpFile::Size() {
+  return position_;
+}
+
+bool HttpFile::Flush() {
+  // The data is sent as soon as it is written.
+  return !upload_failed_;
+}
+
+bool HttpFile::Seek(uint64_t position) {
+  LOG(ERROR) << "HttpFile does not support seeking: " << url_;
+  return false;
+}
+
+bool HttpFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  *position = position_;
+  return true;
+}
+
+void HttpFile::UploadTask() {
+  const bool success = PerformRequest(
+      url_, FLAGS_http_upload_method.c_str(), [this](CURL* curl) {
+        if (replay_data_dropped_) {
+          LOG(ERROR) << "Not retrying the upload to " << url_
+                     << ", as more than " << kMaxReplayDataSize
+                     << " bytes were sent.";
+          return false;
+        }
+        // Retries send the data uploaded so far again first.
+        replay_position_ = 0;
+        // No content length, so the body is sent with chunked transfer
+        // encoding as it is written.
+        curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, ReadCallback);
+        curl_easy_setopt(curl, CURLOPT_READDATA, this);
+        return true;
+      });
+  if (!success) {
+    upload_failed_ = true;
+    // Unblock the writer.
+    cache_.Close();
+  }
+  task_exit_event_.Signal();
+}
+
+size_t HttpFile::ReadCallback(char* buffer,
+                              size_t size,
+                              size_t nitems,
+                              void* user_data) {
+  HttpFile* file = static_cast<HttpFile*>(user_data);
+  const size_t length = size * nitems;
+  if (file->replay_position_ < file->sent_data_.size()) {
+    const size_t bytes_to_replay =
+        std::min(length, file->sent_data_.size() - file->replay_position_);
+    memcpy(buffer, file->sent_data_.data() + file->replay_position_,
+           bytes_to_replay);
+    file->replay_position_ += bytes_to_replay;
+    return bytes_to_replay;
+  }
+  // Blocks until there is data, or returns 0 at the end of the file.
+  const size_t bytes_read = file->cache_.Read(buffer, length);
+  if (!file->replay_data_dropped_) {
+    if (file->sent_data_.size() + bytes_read > kMaxReplayDataSize) {
+      // Too large to be kept, so the request is not retried if it fails.
+      file->replay_data_dropped_ = true;
+      std::string().swap(file->sent_data_);
+    } else {
+      file->sent_data_.append(buffer, bytes_read);
+    }
+  }
+  file->replay_position_ += bytes_read;
+  return bytes_read;
+}
+
+}  // namespace shaka
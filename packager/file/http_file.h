@@ -0,0 +1,100 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_HTTP_FILE_H_
+#define PACKAGER_FILE_HTTP_FILE_H_
+
+#include <atomic>
+#include <string>
+
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/file/file.h"
+#include "packager/file/io_cache.h"
+
+namespace shaka {
+
+/// HttpFile uploads the data written to it to an HTTP(S) server, e.g. a live
+/// origin, so segments and manifests go from the muxers to the origin without
+/// being written to disk first.
+///
+/// The data is streamed as it is written, with a chunked transfer encoded PUT
+/// or POST request (see --http_upload_method) running on a worker thread.
+/// Connections are kept alive and reused across files. Up to 8 MB of the data
+/// sent is kept until the upload completes, so failed requests, e.g.
+/// connection errors or server errors, are retried (see
+/// --http_upload_retries). Requests which fail once more data was sent are not
+/// retried. Close() returns false if the upload eventually fails.
+///
+/// Only the write mode, "w", is supported. Seeking is not supported.
+class HttpFile : public File {
+ public:
+  /// @param url is the URL to upload to, including the http:// or https://
+  ///        scheme.
+  /// @param mode is the file access mode. Must be "w".
+  HttpFile(const char* url, const char* mode);
+
+  /// Delete a file with an HTTP DELETE request.
+  /// @param url is the URL of the file to be deleted.
+  /// @return true if successful, or false otherwise.
+  static bool Delete(const char* url);
+
+  /// Upload @a contents with a single, non chunked request, so the server gets
+  /// either the complete contents or nothing.
+  /// @param url is the URL to upload to.
+  /// @return true if successful, or false otherwise.
+  static bool WriteAtomically(const char* url, const std::string& contents);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~HttpFile() override;
+
+  bool Open() override;
+
+ private:
+  HttpFile(const HttpFile&) = delete;
+  HttpFile& operator=(const HttpFile&) = delete;
+
+  // The upload task, which runs on a worker thread.
+  void UploadTask();
+  // curl read callback. Returns the data sent by the previous attempts first,
+  // then the data from |cache_|.
+  static size_t ReadCallback(char* buffer,
+                             size_t size,
+                             size_t nitems,
+                             void* user_data);
+
+  const std::string url_;
+  const std::string mode_;
+  IoCache cache_;
+  uint64_t position_;
+
+  // The following are only accessed on the upload thread.
+  // The data read from |cache_| so far, replayed on retries, unless it is
+  // larger than the replay limit.
+  std::string sent_data_;
+  size_t replay_position_;
+  // Set once |sent_data_| is dropped for exceeding the replay limit.
+  bool replay_data_dropped_;
+
+  // Set by the upload thread if the upload failed.
+  std::atomic<bool> upload_failed_;
+  // Signalled when the upload task exits.
+  base::WaitableEvent task_exit_event_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_HTTP_FILE_H_
@@ -0,0 +1,180 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/http_file.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#if !defined(OS_WIN)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#endif  // !defined(OS_WIN)
+
+DECLARE_string(http_upload_method);
+DECLARE_int32(http_upload_retries);
+
+namespace shaka {
+
+namespace {
+// Nothing listens on port 1, so connections are refused right away.
+const char kUnreachableUrl[] = "http://127.0.0.1:1/segment.m4s";
+
+#if !defined(OS_WIN)
+// Receives the uploads on a local port. The first |num_failures| uploads are
+// received in full, then dropped without a response, which fails them.
+class FlakyUploadServer {
+ public:
+  explicit FlakyUploadServer(int num_failures) : num_failures_(num_failures) {
+    socket_ = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_size = sizeof(addr);
+    EXPECT_EQ(0, bind(socket_, reinterpret_cast<struct sockaddr*>(&addr),
+                      addr_size));
+    EXPECT_EQ(0, listen(socket_, 4));
+    EXPECT_EQ(0, getsockname(socket_, reinterpret_cast<struct sockaddr*>(&addr),
+                             &addr_size));
+    url_ = "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) +
+           "/segment.m4s";
+    thread_ = std::thread(&FlakyUploadServer::Run, this);
+  }
+
+  ~FlakyUploadServer() {
+    stopping_ = true;
+    thread_.join();
+    close(socket_);
+  }
+
+  const std::string& url() const { return url_; }
+  int num_uploads() const { return num_uploads_; }
+
+ private:
+  void Run() {
+    while (!stopping_) {
+      struct pollfd poll_fd = {socket_, POLLIN, 0};
+      if (poll(&poll_fd, 1, 100) <= 0)
+        continue;
+      const int connection = accept(socket_, nullptr, nullptr);
+      if (connection < 0)
+        continue;
+      ServeUpload(connection);
+      close(connection);
+    }
+  }
+
+  void ServeUpload(int connection) {
+    const int upload = ++num_uploads_;
+    // The uploads are chunked, and end with the last, empty chunk.
+    const std::string kLastChunk = "\r\n0\r\n\r\n";
+    std::string request;
+    bool headers_received = false;
+    char buffer[65536];
+    while (request.size() < kLastChunk.size() ||
+           request.compare(request.size() - kLastChunk.size(),
+                           kLastChunk.size(), kLastChunk) != 0) {
+      const ssize_t result = recv(connection, buffer, sizeof(buffer), 0);
+      if (result <= 0)
+        return;
+      request.append(buffer, result);
+      if (!headers_received &&
+          request.find("\r\n\r\n") != std::string::npos) {
+        headers_received = true;
+        if (request.find("Expect: 100-continue") != std::string::npos)
+          Send(connection, "HTTP/1.1 100 Continue\r\n\r\n");
+      }
+    }
+    if (upload > num_failures_)
+      Send(connection, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+  }
+
+  void Send(int connection, const std::string& response) {
+    EXPECT_EQ(static_cast<ssize_t>(response.size()),
+              send(connection, response.data(), response.size(), 0));
+  }
+
+  const int num_failures_;
+  int socket_;
+  std::string url_;
+  std::atomic<int> num_uploads_{0};
+  std::atomic<bool> stopping_{false};
+  std::thread thread_;
+};
+#endif  // !defined(OS_WIN)
+
+}  // namespace
+
+TEST(HttpFileTest, ReadModeNotSupported) {
+  EXPECT_EQ(nullptr, File::Open(kUnreachableUrl, "r"));
+}
+
+TEST(HttpFileTest, InvalidUploadMethod) {
+  google::FlagSaver flag_saver;
+  FLAGS_http_upload_method = "GET";
+  EXPECT_EQ(nullptr, File::Open(kUnreachableUrl, "w"));
+  EXPECT_FALSE(File::WriteFileAtomically(kUnreachableUrl, "data"));
+}
+
+TEST(HttpFileTest, SeekNotSupported) {
+  google::FlagSaver flag_saver;
+  FLAGS_http_upload_retries = 0;
+  File* file = File::Open(kUnreachableUrl, "w");
+  ASSERT_NE(nullptr, file);
+  EXPECT_FALSE(file->Seek(0));
+  file->Close();
+}
+
+TEST(HttpFileTest, UploadFailure) {
+  google::FlagSaver flag_saver;
+  FLAGS_http_upload_retries = 1;
+  File* file = File::Open(kUnreachableUrl, "w");
+  ASSERT_NE(nullptr, file);
+  const std::string kData(1000, 'x');
+  // Writes are buffered, so they may succeed before the upload fails.
+  file->Write(kData.data(), kData.size());
+  EXPECT_FALSE(file->Close());
+
+  EXPECT_FALSE(File::WriteFileAtomically(kUnreachableUrl, kData));
+  EXPECT_FALSE(File::Delete(kUnreachableUrl));
+}
+
+#if !defined(OS_WIN)
+TEST(HttpFileTest, RetriesUpload) {
+  google::FlagSaver flag_saver;
+  FLAGS_http_upload_retries = 1;
+  FlakyUploadServer server(1);
+  File* file = File::Open(server.url().c_str(), "w");
+  ASSERT_NE(nullptr, file);
+  const std::string kData(1000, 'x');
+  EXPECT_EQ(static_cast<int64_t>(kData.size()),
+            file->Write(kData.data(), kData.size()));
+  EXPECT_TRUE(file->Close());
+  EXPECT_EQ(2, server.num_uploads());
+}
+
+TEST(HttpFileTest, DoesNotRetryUploadLargerThanReplayLimit) {
+  google::FlagSaver flag_saver;
+  FLAGS_http_upload_retries = 1;
+  FlakyUploadServer server(1);
+  File* file = File::Open(server.url().c_str(), "w");
+  ASSERT_NE(nullptr, file);
+  // Larger than the 8 MB kept for retries.
+  const std::string kData(9 << 20, 'x');
+  file->Write(kData.data(), kData.size());
+  EXPECT_FALSE(file->Close());
+  EXPECT_EQ(1, server.num_uploads());
+}
+#endif  // !defined(OS_WIN)
+
+}  // namespace shaka
@@ -11,55 +11,69 @@
 #include <algorithm>
 
 #include "packager/base/logging.h"
+#include "packager/metrics/metrics.h"
 
 namespace shaka {
 
 using base::AutoLock;
-using base::AutoUnlock;
 
 IoCache::IoCache(uint64_t cache_size)
     : cache_size_(cache_size),
-      read_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                  base::WaitableEvent::InitialState::NOT_SIGNALED),
-      write_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                   base::WaitableEvent::InitialState::NOT_SIGNALED),
-      // Make the buffer one byte larger than the cache so that when the
-      // condition r_ptr == w_ptr is unambiguous (buffer empty).
-      circular_buffer_(cache_size + 1),
-      end_ptr_(&circular_buffer_[0] + cache_size + 1),
-      r_ptr_(circular_buffer_.data()),
-      w_ptr_(circular_buffer_.data()),
-      closed_(false) {}
+      // Not initialized, so the pages are only committed once written.
+      circular_buffer_(HugePageAllocator::GetInstance()->Allocate(cache_size)),
+      circular_buffer_data_(circular_buffer_.get()),
+      read_position_(0),
+      write_position_(0),
+      closed_(false),
+      progress_(&lock_),
+      num_waiters_(0),
+      num_reader_waits_(0),
+      num_writer_waits_(0) {
+  DCHECK_GT(cache_size, 0u);
+  // The values of all the caches add up, as they have the same labels.
+  metrics_collector_id_ =
+      Metrics::GetInstance()->AddCollector([this](Metrics::Writer* writer) {
+        writer->Add("packager_io_cache_bytes", Metrics::Type::kGauge,
+                    "Bytes held in the threaded I/O caches.", {},
+                    static_cast<double>(BytesCached()));
+        writer->Add("packager_io_cache_capacity_bytes", Metrics::Type::kGauge,
+                    "Capacity of the threaded I/O caches.", {},
+                    static_cast<double>(cache_size()));
+      });
+}
 
 IoCache::~IoCache() {
+  Metrics::GetInstance()->RemoveCollector(metrics_collector_id_);
   Close();
 }
 
 uint64_t IoCache::Read(void* buffer, uint64_t size) {
   DCHECK(buffer);
 
-  AutoLock lock(lock_);
-  while (!closed_ && (BytesCachedInternal() == 0)) {
-    AutoUnlock unlock(lock_);
-    write_event_.Wait();
+  const uint64_t read_position =
+      read_position_.load(std::memory_order_relaxed);
+  uint64_t write_position = write_position_.load(std::memory_order_acquire);
+  if (write_position == read_position) {
+    num_reader_waits_.fetch_add(1, std::memory_order_relaxed);
+    WaitUntil([this, read_position]() {
+      return write_position_.load(std::memory_order_seq_cst) != read_position;
+    });
+    write_position = write_position_.load(std::memory_order_acquire);
   }
 
-  size = std::min(size, BytesCachedInternal());
-  uint64_t first_chunk_size(
-      std::min(size, static_cast<uint64_t>(end_ptr_ - r_ptr_)));
-  memcpy(buffer, r_ptr_, first_chunk_size);
-  r_ptr_ += first_chunk_size;
-  DCHECK_GE(end_ptr_, r_ptr_);
-  if (r_ptr_ == end_ptr_)
-    r_ptr_ = &circular_buffer_[0];
-  uint64_t second_chunk_size(size - first_chunk_size);
-  if (second_chunk_size) {
-    memcpy(static_cast<uint8_t*>(buffer) + first_chunk_size, r_ptr_,
-           second_chunk_size);
-    r_ptr_ += second_chunk_size;
-    DCHECK_GT(end_ptr_, r_ptr_);
-  }
-  read_event_.Signal();
+  size = std::min(size, write_position - read_position);
+  if (size == 0)
+    return 0;
+  // Loaded after the write position, which is advanced after a resize.
+  const uint64_t cache_size = cache_size_.load(std::memory_order_relaxed);
+  const uint8_t* data = circular_buffer_data_.load(std::memory_order_relaxed);
+  const uint64_t offset = read_position % cache_size;
+  const uint64_t first_chunk_size = std::min(size, cache_size - offset);
+  memcpy(buffer, data + offset, first_chunk_size);
+  memcpy(static_cast<uint8_t*>(buffer) + first_chunk_size, data,
+         size - first_chunk_size);
+  read_position_.store(read_position + size, std::memory_order_seq_cst);
+  WakeUpWaiters();
   return size;
 }
 
@@ -68,89 +82,109 @@ uint64_t IoCache::Write(const void* buffer, uint64_t size) {
 
   const uint8_t* r_ptr(static_cast<const uint8_t*>(buffer));
   uint64_t bytes_left(size);
+  // Only the writer resizes the cache.
+  const uint64_t cache_size = cache_size_.load(std::memory_order_relaxed);
+  uint8_t* const data = circular_buffer_data_.load(std::memory_order_relaxed);
   while (bytes_left) {
-    AutoLock lock(lock_);
-    while (!closed_ && (BytesFreeInternal() == 0)) {
-      AutoUnlock unlock(lock_);
+    const uint64_t write_position =
+        write_position_.load(std::memory_order_relaxed);
+    uint64_t read_position = read_position_.load(std::memory_order_acquire);
+    if (write_position - read_position == cache_size) {
+      num_writer_waits_.fetch_add(1, std::memory_order_relaxed);
       VLOG(1) << "Circular buffer is full, which can happen if data arrives "
                  "faster than being consumed by packager. Ignore if it is not "
                  "live packaging. Otherwise, try increasing --io_cache_size.";
-      read_event_.Wait();
+      WaitUntil([this, write_position, cache_size]() {
+        return write_position -
+                   read_position_.load(std::memory_order_seq_cst) <
+               cache_size;
+      });
+      read_position = read_position_.load(std::memory_order_acquire);
     }
-    if (closed_)
+    if (closed_.load(std::memory_order_acquire))
       return 0;
 
-    uint64_t write_size(std::min(bytes_left, BytesFreeInternal()));
-    uint64_t first_chunk_size(
-        std::min(write_size, static_cast<uint64_t>(end_ptr_ - w_ptr_)));
-    memcpy(w_ptr_, r_ptr, first_chunk_size);
-    w_ptr_ += first_chunk_size;
-    DCHECK_GE(end_ptr_, w_ptr_);
-    if (w_ptr_ == end_ptr_)
-      w_ptr_ = &circular_buffer_[0];
-    r_ptr += first_chunk_size;
-    uint64_t second_chunk_size(write_size - first_chunk_size);
-    if (second_chunk_size) {
-      memcpy(w_ptr_, r_ptr, second_chunk_size);
-      w_ptr_ += second_chunk_size;
-      DCHECK_GT(end_ptr_, w_ptr_);
-      r_ptr += second_chunk_size;
-    }
+    const uint64_t write_size =
+        std::min(bytes_left, cache_size - (write_position - read_position));
+    const uint64_t offset = write_position % cache_size;
+    const uint64_t first_chunk_size = std::min(write_size, cache_size - offset);
+    memcpy(data + offset, r_ptr, first_chunk_size);
+    memcpy(data, r_ptr + first_chunk_size, write_size - first_chunk_size);
+    r_ptr += write_size;
     bytes_left -= write_size;
-    write_event_.Signal();
+    write_position_.store(write_position + write_size,
+                          std::memory_order_seq_cst);
+    WakeUpWaiters();
   }
   return size;
 }
 
 void IoCache::Clear() {
-  AutoLock lock(lock_);
-  r_ptr_ = w_ptr_ = circular_buffer_.data();
+  read_position_.store(write_position_.load(std::memory_order_acquire),
+                       std::memory_order_seq_cst);
   // Let any writers know that there is room in the cache.
-  read_event_.Signal();
+  WakeUpWaiters();
 }
 
 void IoCache::Close() {
+  closed_.store(true, std::memory_order_seq_cst);
   AutoLock lock(lock_);
-  closed_ = true;
-  read_event_.Signal();
-  write_event_.Signal();
+  progress_.Broadcast();
 }
 
 void IoCache::Reopen() {
-  AutoLock lock(lock_);
   CHECK(closed_);
-  r_ptr_ = w_ptr_ = circular_buffer_.data();
+  read_position_ = 0;
+  write_position_ = 0;
   closed_ = false;
-  read_event_.Reset();
-  write_event_.Reset();
 }
 
 uint64_t IoCache::BytesCached() {
-  AutoLock lock(lock_);
-  return BytesCachedInternal();
+  const uint64_t read_position = read_position_.load(std::memory_order_acquire);
+  return write_position_.load(std::memory_order_acquire) - read_position;
 }
 
 uint64_t IoCache::BytesFree() {
-  AutoLock lock(lock_);
-  return BytesFreeInternal();
+  return cache_size() - BytesCached();
 }
 
-uint64_t IoCache::BytesCachedInternal() {
-  return (r_ptr_ <= w_ptr_)
-             ? w_ptr_ - r_ptr_
-             : (end_ptr_ - r_ptr_) + (w_ptr_ - circular_buffer_.data());
+void IoCache::WaitUntilEmptyOrClosed() {
+  WaitUntil([this]() {
+    return read_position_.load(std::memory_order_seq_cst) ==
+           write_position_.load(std::memory_order_seq_cst);
+  });
 }
 
-uint64_t IoCache::BytesFreeInternal() {
-  return cache_size_ - BytesCachedInternal();
+bool IoCache::Grow(uint64_t cache_size) {
+  if (cache_size <= this->cache_size() || BytesCached() != 0)
+    return false;
+  // The reader is done with the buffer once it has caught up with the
+  // writer, and it only loads the buffer again once the write position is
+  // advanced, after the resize.
+  circular_buffer_ = HugePageAllocator::GetInstance()->Allocate(cache_size);
+  circular_buffer_data_.store(circular_buffer_.get(),
+                              std::memory_order_relaxed);
+  cache_size_.store(cache_size, std::memory_order_relaxed);
+  return true;
 }
 
-void IoCache::WaitUntilEmptyOrClosed() {
+template <typename Predicate>
+void IoCache::WaitUntil(Predicate ready) {
   AutoLock lock(lock_);
-  while (!closed_ && BytesCachedInternal()) {
-    AutoUnlock unlock(lock_);
-    read_event_.Wait();
-  }
+  // Registering as a waiter before checking the condition guarantees that the
+  // other side either sees the waiter after making progress, or made progress
+  // before the condition is checked.
+  num_waiters_.fetch_add(1, std::memory_order_seq_cst);
+  while (!closed_.load(std::memory_order_seq_cst) && !ready())
+    progress_.Wait();
+  num_waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void IoCache::WakeUpWaiters() {
+  if (num_waiters_.load(std::memory_order_seq_cst) == 0)
+    return;
+  AutoLock lock(lock_);
+  progress_.Broadcast();
 }
 
 }  // namespace shaka
@@ -8,14 +8,19 @@
 #define PACKAGER_FILE_IO_CACHE_H_
 
 #include <stdint.h>
-#include <vector>
+#include <atomic>
+#include <memory>
 #include "packager/base/macros.h"
+#include "packager/base/synchronization/condition_variable.h"
 #include "packager/base/synchronization/lock.h"
-#include "packager/base/synchronization/waitable_event.h"
+#include "packager/metrics/huge_page_allocator.h"
 
 namespace shaka {
 
 /// Declaration of class which implements a thread-safe circular buffer.
+/// There must be a single reader thread and a single writer thread at a time.
+/// Read() and Write() do not take any lock unless the cache is empty or full
+/// respectively, in which case they park until the other side makes progress.
 class IoCache {
  public:
   explicit IoCache(uint64_t cache_size);
@@ -38,7 +43,7 @@ class IoCache {
   ///         closed.
   uint64_t Write(const void* buffer, uint64_t size);
 
-  /// Empties the cache.
+  /// Empties the cache. Must be called on the reader side.
   void Clear();
 
   /// Close the cache. This will call any blocking calls to unblock, and the
@@ -46,9 +51,10 @@ class IoCache {
   void Close();
 
   /// @return true if the cache is closed, false otherwise.
-  bool closed() { return closed_; }
+  bool closed() { return closed_.load(std::memory_order_acquire); }
 
-  /// Reopens the cache. Any data still in the cache will be lost.
+  /// Reopens the cache. Any data still in the cache will be lost. Must not be
+  /// called concurrently with Read() or Write().
   void Reopen();
 
   /// Returns the number of bytes in the cache.
@@ -62,19 +68,58 @@ class IoCache {
   /// Waits until the cache is empty or has been closed.
   void WaitUntilEmptyOrClosed();
 
- private:
-  uint64_t BytesCachedInternal();
-  uint64_t BytesFreeInternal();
+  /// Grow the cache to @a cache_size bytes. Must be called on the writer
+  /// side. The cache is only resized while it is empty, so that no data is
+  /// moved and the reader never sees the resize.
+  /// @return true if the cache was grown, false if it is not empty or not
+  ///         smaller than @a cache_size.
+  bool Grow(uint64_t cache_size);
+
+  /// @return The size of the cache.
+  uint64_t cache_size() const {
+    return cache_size_.load(std::memory_order_relaxed);
+  }
+
+  /// @return The number of times Read() waited for data, i.e. the reader was
+  ///         starved.
+  uint64_t num_reader_waits() const {
+    return num_reader_waits_.load(std::memory_order_relaxed);
+  }
+  /// @return The number of times Write() waited for room, i.e. the cache was
+  ///         too small for the bursts of the writer.
+  uint64_t num_writer_waits() const {
+    return num_writer_waits_.load(std::memory_order_relaxed);
+  }
 
-  const uint64_t cache_size_;
+ private:
+  // Park the calling thread until |ready| returns true or the cache is closed.
+  template <typename Predicate>
+  void WaitUntil(Predicate ready);
+  // Wake up the parked threads, if any.
+  void WakeUpWaiters();
+
+  // Only changed by Grow() while the cache is empty, before the write
+  // position is advanced, so the reader sees them with the data.
+  std::atomic<uint64_t> cache_size_;
+  HugePageAllocator::Buffer circular_buffer_;
+  std::atomic<uint8_t*> circular_buffer_data_;
+  // Total number of bytes read and written. They only increase, so the ring
+  // is empty if they are equal and full if they differ by |cache_size_|.
+  // |read_position_| is only modified by the reader and |write_position_| by
+  // the writer.
+  std::atomic<uint64_t> read_position_;
+  std::atomic<uint64_t> write_position_;
+  std::atomic<bool> closed_;
+
+  // Used to park the threads when the cache is empty or full.
   base::Lock lock_;
-  base::WaitableEvent read_event_;
-  base::WaitableEvent write_event_;
-  std::vector<uint8_t> circular_buffer_;
-  const uint8_t* end_ptr_;
-  uint8_t* r_ptr_;
-  uint8_t* w_ptr_;
-  bool closed_;
+  base::ConditionVariable progress_;
+  std::atomic<int> num_waiters_;
+  std::atomic<uint64_t> num_reader_waits_;
+  std::atomic<uint64_t> num_writer_waits_;
+
+  // Reports the fill level of the cache to the metrics registry.
+  int metrics_collector_id_;
 
   DISALLOW_COPY_AND_ASSIGN(IoCache);
 };
@@ -0,0 +1,70 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/file/io_cache.h"
+#include "packager/media/test/perf_test_util.h"
+
+namespace shaka {
+
+namespace {
+
+const uint64_t kCacheSize = 32 << 20;
+const uint64_t kReadSize = 64 << 10;
+// Bytes transferred per measured run.
+const uint64_t kBytesPerRun = 4 << 20;
+
+class ReaderThread : public base::SimpleThread {
+ public:
+  explicit ReaderThread(IoCache* cache)
+      : base::SimpleThread("ReaderThread"), cache_(cache) {}
+
+  void Run() override {
+    std::vector<uint8_t> buffer(kReadSize);
+    while (cache_->Read(buffer.data(), buffer.size()) > 0) {
+    }
+  }
+
+ private:
+  IoCache* cache_;
+};
+
+// Streams data through an IoCache written |write_size| bytes at a time, e.g.
+// the boxes and samples written by BufferWriter::WriteToFile, and read by
+// another thread as ThreadedIoFile does.
+void MeasureTransferThroughput(const std::string& trace, uint64_t write_size) {
+  IoCache cache(kCacheSize);
+  ReaderThread reader(&cache);
+  reader.Start();
+
+  const std::vector<uint8_t> data(write_size, 0xAB);
+  media::MeasureThroughput("io_cache_transfer", trace, kBytesPerRun, [&]() {
+    for (uint64_t written = 0; written < kBytesPerRun; written += write_size)
+      ASSERT_EQ(write_size, cache.Write(data.data(), write_size));
+  });
+
+  cache.Close();
+  reader.Join();
+}
+
+}  // namespace
+
+TEST(IoCachePerfTest, SmallWrites) {
+  MeasureTransferThroughput("8_bytes", 8);
+  MeasureTransferThroughput("188_bytes", 188);
+}
+
+TEST(IoCachePerfTest, LargeWrites) {
+  MeasureTransferThroughput("64k_bytes", 64 << 10);
+}
+
+}  // namespace shaka
@@ -161,6 +161,30 @@ TEST_F(IoCacheTest, LotsOfUnalignedBlocks) {
   }
 }
 
+TEST_F(IoCacheTest, LotsOfSmallWrites) {
+  const uint64_t kNumWrites(100000);
+  const uint64_t kSmallWriteSize(7);
+  const uint64_t kReadSize(64);
+
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kSmallWriteSize, &write_buffer);
+  WriteToCacheThreaded(write_buffer, kNumWrites, 0, true);
+
+  uint64_t total_bytes_read(0);
+  std::vector<uint8_t> read_buffer(kReadSize);
+  while (true) {
+    uint64_t bytes_read = cache_->Read(read_buffer.data(), kReadSize);
+    if (bytes_read == 0)
+      break;
+    for (uint64_t idx = 0; idx < bytes_read; ++idx) {
+      ASSERT_EQ((total_bytes_read + idx) % kSmallWriteSize,
+                read_buffer[idx]);
+    }
+    total_bytes_read += bytes_read;
+  }
+  EXPECT_EQ(kNumWrites * kSmallWriteSize, total_bytes_read);
+}
+
 TEST_F(IoCacheTest, SlowWrite) {
   const int kWriteDelayMs(50);
   const uint64_t kNumWrites(kCacheSize * 5 / kBlockSize);
@@ -272,4 +296,49 @@ TEST_F(IoCacheTest, LargeRead) {
   cache_->Close();
 }
 
+TEST_F(IoCacheTest, CountsWaits) {
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kCacheSize, &write_buffer);
+  EXPECT_EQ(kCacheSize, cache_->Write(write_buffer.data(), kCacheSize));
+  EXPECT_EQ(0u, cache_->num_writer_waits());
+  // The cache is full, so the writer waits for the reader.
+  WriteToCacheThreaded(write_buffer, 1, 0, false);
+  while (cache_->num_writer_waits() == 0)
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(1));
+
+  std::vector<uint8_t> read_buffer(2 * kCacheSize);
+  uint64_t bytes_read = 0;
+  while (bytes_read < read_buffer.size()) {
+    bytes_read += cache_->Read(&read_buffer[bytes_read],
+                               read_buffer.size() - bytes_read);
+  }
+  WaitForWriterThread();
+  EXPECT_GE(cache_->num_writer_waits(), 1u);
+}
+
+TEST_F(IoCacheTest, Grow) {
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kBlockSize, &write_buffer);
+  EXPECT_EQ(kBlockSize, cache_->Write(write_buffer.data(), kBlockSize));
+  // Not resized while there is data in the cache.
+  EXPECT_FALSE(cache_->Grow(2 * kCacheSize));
+
+  std::vector<uint8_t> read_buffer(kBlockSize);
+  EXPECT_EQ(kBlockSize, cache_->Read(read_buffer.data(), kBlockSize));
+  EXPECT_FALSE(cache_->Grow(kCacheSize));
+  EXPECT_TRUE(cache_->Grow(2 * kCacheSize));
+  EXPECT_EQ(2 * kCacheSize, cache_->cache_size());
+  EXPECT_EQ(2 * kCacheSize, cache_->BytesFree());
+
+  // The data wraps around the grown cache.
+  const uint64_t kNumWrites(2 * kCacheSize * 10 / kBlockSize);
+  WriteToCacheThreaded(write_buffer, kNumWrites, 0, false);
+  for (uint64_t num_reads = 0; num_reads < kNumWrites; ++num_reads) {
+    EXPECT_EQ(kBlockSize, cache_->Read(read_buffer.data(), kBlockSize));
+    EXPECT_EQ(write_buffer, read_buffer);
+  }
+  WaitForWriterThread();
+  EXPECT_EQ(0u, cache_->BytesCached());
+}
+
 }  // namespace shaka
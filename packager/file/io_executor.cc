@@ -0,0 +1,135 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/io_executor.h"
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/file/cpu_affinity.h"
+
+DEFINE_int32(io_threads,
+             4,
+             "Number of threads performing the threaded I/O of all the files, "
+             "see --io_cache_size. UDP and pipe inputs, which may block "
+             "indefinitely, use a thread of their own.");
+
+namespace shaka {
+
+namespace {
+
+// Maximum number of NUMA nodes with an executor of their own.
+const int kMaxNumaNodes = 64;
+
+}  // namespace
+
+IoExecutor::IoExecutor(size_t num_threads, const std::string& name_prefix)
+    : IoExecutor(num_threads, name_prefix, std::vector<int>()) {}
+
+IoExecutor::IoExecutor(size_t num_threads,
+                       const std::string& name_prefix,
+                       const std::vector<int>& cpus)
+    : cpus_(cpus), task_available_(&lock_) {
+  DCHECK_GT(num_threads, 0u);
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(new base::DelegateSimpleThread(this, name_prefix));
+    threads_.back()->Start();
+  }
+}
+
+IoExecutor::~IoExecutor() {
+  {
+    base::AutoLock auto_lock(lock_);
+    shutting_down_ = true;
+    task_available_.Broadcast();
+  }
+  for (auto& thread : threads_)
+    thread->Join();
+}
+
+IoExecutor* IoExecutor::GetInstance() {
+  // Leaked, so the threads outlive the files closed at exit.
+  static IoExecutor* io_executor =
+      new IoExecutor(std::max(FLAGS_io_threads, 1), "IoExecutor");
+  return io_executor;
+}
+
+IoExecutor* IoExecutor::GetLocalInstance() {
+  const int node = GetCurrentThreadNumaNode();
+  if (node < 0 || node >= kMaxNumaNodes)
+    return GetInstance();
+
+  // Leaked, like the process wide executor.
+  static std::atomic<IoExecutor*> node_io_executors[kMaxNumaNodes];
+  IoExecutor* io_executor =
+      node_io_executors[node].load(std::memory_order_acquire);
+  if (io_executor)
+    return io_executor;
+  std::unique_ptr<IoExecutor> new_io_executor(
+      new IoExecutor(std::max(FLAGS_io_threads, 1),
+                     "IoExecutorNode" + base::IntToString(node),
+                     GetNumaNodeCpus(node)));
+  if (node_io_executors[node].compare_exchange_strong(
+          io_executor, new_io_executor.get(), std::memory_order_acq_rel)) {
+    return new_io_executor.release();
+  }
+  // Another thread created it first.
+  return io_executor;
+}
+
+std::vector<int> IoExecutor::GetLocalCpus() {
+  return GetNumaNodeCpus(GetCurrentThreadNumaNode());
+}
+
+void IoExecutor::PostTask(const base::Closure& task) {
+  base::AutoLock auto_lock(lock_);
+  tasks_.push_back({task, base::TimeTicks::Now()});
+  stats_.queue_depth = tasks_.size();
+  stats_.max_queue_depth = std::max(stats_.max_queue_depth,
+                                    stats_.queue_depth);
+  task_available_.Signal();
+}
+
+IoExecutor::Stats IoExecutor::GetStats() {
+  base::AutoLock auto_lock(lock_);
+  return stats_;
+}
+
+void IoExecutor::Run() {
+  if (!cpus_.empty())
+    SetCurrentThreadCpus(cpus_);
+  while (true) {
+    PendingTask pending_task;
+    base::TimeTicks start_time;
+    {
+      base::AutoLock auto_lock(lock_);
+      while (tasks_.empty() && !shutting_down_)
+        task_available_.Wait();
+      if (tasks_.empty())
+        return;
+      pending_task = tasks_.front();
+      tasks_.pop_front();
+      stats_.queue_depth = tasks_.size();
+      start_time = base::TimeTicks::Now();
+      const base::TimeDelta queue_time = start_time - pending_task.post_time;
+      stats_.total_queue_time += queue_time;
+      stats_.max_queue_time = std::max(stats_.max_queue_time, queue_time);
+    }
+
+    pending_task.task.Run();
+
+    const base::TimeDelta run_time = base::TimeTicks::Now() - start_time;
+    base::AutoLock auto_lock(lock_);
+    ++stats_.tasks_completed;
+    stats_.total_run_time += run_time;
+  }
+}
+
+}  // namespace shaka
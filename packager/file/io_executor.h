@@ -0,0 +1,106 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_IO_EXECUTOR_H_
+#define PACKAGER_FILE_IO_EXECUTOR_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/callback.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// A pool of a bounded number of threads which runs the I/O tasks of buffered
+/// files, in the order they are posted. Tasks should not block indefinitely.
+/// This class is thread safe.
+class IoExecutor : public base::DelegateSimpleThread::Delegate {
+ public:
+  /// Queue depth and latency statistics.
+  struct Stats {
+    /// Number of tasks waiting for a thread.
+    uint64_t queue_depth = 0;
+    /// Maximum number of tasks waiting for a thread at once.
+    uint64_t max_queue_depth = 0;
+    /// Number of tasks run.
+    uint64_t tasks_completed = 0;
+    /// Total and maximum time between posting a task and running it.
+    base::TimeDelta total_queue_time;
+    base::TimeDelta max_queue_time;
+    /// Total time spent running tasks, i.e. performing I/O.
+    base::TimeDelta total_run_time;
+  };
+
+  /// @param num_threads is the number of threads, which must be at least 1.
+  /// @param name_prefix is the prefix of the thread names.
+  IoExecutor(size_t num_threads, const std::string& name_prefix);
+
+  /// Same as above, with the threads pinned to @a cpus if it is not empty.
+  IoExecutor(size_t num_threads,
+             const std::string& name_prefix,
+             const std::vector<int>& cpus);
+
+  /// Runs the tasks already posted, then joins the threads.
+  ~IoExecutor() override;
+
+  /// @return the process wide executor shared by the buffered files, with
+  ///         --io_threads threads.
+  static IoExecutor* GetInstance();
+
+  /// @return the executor of the NUMA node of the calling thread, with
+  ///         --io_threads threads pinned to the CPUs of the node, if the
+  ///         calling thread is pinned with SetCurrentThreadCpus(), so that the
+  ///         I/O of a job stays on the node of the job. GetInstance()
+  ///         otherwise.
+  static IoExecutor* GetLocalInstance();
+
+  /// @return the CPUs the threads of GetLocalInstance() are pinned to, which
+  ///         is empty if they are not pinned.
+  static std::vector<int> GetLocalCpus();
+
+  /// Post a task to run on one of the threads.
+  void PostTask(const base::Closure& task);
+
+  /// @return the statistics collected so far.
+  Stats GetStats();
+
+ private:
+  IoExecutor(const IoExecutor&) = delete;
+  IoExecutor& operator=(const IoExecutor&) = delete;
+
+  struct PendingTask {
+    base::Closure task;
+    base::TimeTicks post_time;
+  };
+
+  // base::DelegateSimpleThread::Delegate implementation, which runs the tasks
+  // until the executor is destroyed.
+  void Run() override;
+
+  // The CPUs the threads are pinned to, if not empty.
+  const std::vector<int> cpus_;
+  base::Lock lock_;
+  // Signaled when a task is posted, or on destruction.
+  base::ConditionVariable task_available_;
+  // The following are protected by |lock_|.
+  std::deque<PendingTask> tasks_;
+  bool shutting_down_ = false;
+  Stats stats_;
+
+  std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_IO_EXECUTOR_H_
@@ -0,0 +1,110 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/io_executor.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/base/files/file_util.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+namespace {
+
+void AppendValue(base::Lock* lock, std::vector<int>* values, int value) {
+  base::AutoLock auto_lock(*lock);
+  values->push_back(value);
+}
+
+void WaitForEvent(base::WaitableEvent* event) {
+  event->Wait();
+}
+
+}  // namespace
+
+TEST(IoExecutorTest, RunsTasksInOrder) {
+  base::Lock lock;
+  std::vector<int> values;
+  {
+    IoExecutor executor(1, "IoExecutorTest");
+    for (int i = 0; i < 100; ++i)
+      executor.PostTask(base::Bind(&AppendValue, &lock, &values, i));
+    // The destructor runs the tasks posted.
+  }
+  ASSERT_EQ(100u, values.size());
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(i, values[i]);
+}
+
+TEST(IoExecutorTest, Stats) {
+  base::WaitableEvent event(base::WaitableEvent::ResetPolicy::MANUAL,
+                            base::WaitableEvent::InitialState::NOT_SIGNALED);
+  base::Lock lock;
+  std::vector<int> values;
+  IoExecutor executor(1, "IoExecutorTest");
+  // Keep the only thread busy, so the next tasks are queued.
+  executor.PostTask(base::Bind(&WaitForEvent, &event));
+  executor.PostTask(base::Bind(&AppendValue, &lock, &values, 1));
+  executor.PostTask(base::Bind(&AppendValue, &lock, &values, 2));
+  EXPECT_GE(executor.GetStats().max_queue_depth, 2u);
+  event.Signal();
+}
+
+// Lots of buffered files share the few executor threads.
+TEST(IoExecutorTest, ManyThreadedFiles) {
+  const int kNumFiles = 32;
+  const std::string kData(100000, 'x');
+
+  std::vector<base::FilePath> paths(kNumFiles);
+  std::vector<std::unique_ptr<File, FileCloser>> files;
+  for (int i = 0; i < kNumFiles; ++i) {
+    ASSERT_TRUE(base::CreateTemporaryFile(&paths[i]));
+    files.emplace_back(File::Open(paths[i].AsUTF8Unsafe().c_str(), "w"));
+    ASSERT_TRUE(files.back());
+  }
+  // Interleave the writes of the files.
+  for (size_t offset = 0; offset < kData.size(); offset += 1000) {
+    for (auto& file : files)
+      ASSERT_EQ(1000, file->Write(kData.data() + offset, 1000));
+  }
+  for (auto& file : files)
+    EXPECT_TRUE(file.release()->Close());
+
+  for (int i = 0; i < kNumFiles; ++i) {
+    files[i].reset(File::Open(paths[i].AsUTF8Unsafe().c_str(), "r"));
+    ASSERT_TRUE(files[i]);
+  }
+  std::vector<std::string> read_data(kNumFiles);
+  for (size_t offset = 0; offset < kData.size(); offset += 1000) {
+    for (int i = 0; i < kNumFiles; ++i) {
+      char buffer[1000];
+      int64_t bytes_read = 0;
+      while (bytes_read < 1000) {
+        const int64_t result =
+            files[i]->Read(buffer + bytes_read, 1000 - bytes_read);
+        ASSERT_GT(result, 0);
+        bytes_read += result;
+      }
+      read_data[i].append(buffer, bytes_read);
+    }
+  }
+  for (int i = 0; i < kNumFiles; ++i) {
+    EXPECT_TRUE(files[i].release()->Close());
+    EXPECT_EQ(kData, read_data[i]);
+    base::DeleteFile(paths[i], false);
+  }
+  EXPECT_GT(IoExecutor::GetInstance()->GetStats().tasks_completed, 0u);
+}
+
+}  // namespace shaka
@@ -0,0 +1,412 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/io_uring_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/location.h"
+#include "packager/base/logging.h"
+#include "packager/base/posix/eintr_wrapper.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/worker_pool.h"
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define SHAKA_HAS_IO_URING 1
+#endif
+#endif
+
+namespace shaka {
+
+// A write request, which may be submitted several times on short writes.
+class IoUringFile::WriteRequest {
+ public:
+  WriteRequest(IoUringFile* file, std::vector<uint8_t>* data, uint64_t offset)
+      : file_(file), offset_(offset) {
+    data_.swap(*data);
+  }
+
+  // Called by the ring with the result of the last submission, i.e. the number
+  // of bytes written or a negative errno.
+  void OnComplete(int result);
+
+  int fd() const { return file_->fd_; }
+  size_t size() const { return data_.size(); }
+  // The remaining part of the request, to be submitted.
+  const iovec* remaining() {
+    remaining_.iov_base = data_.data() + bytes_written_;
+    remaining_.iov_len = data_.size() - bytes_written_;
+    return &remaining_;
+  }
+  uint64_t remaining_offset() const { return offset_ + bytes_written_; }
+
+ private:
+  IoUringFile* const file_;
+  std::vector<uint8_t> data_;
+  const uint64_t offset_;
+  size_t bytes_written_ = 0;
+  // Must stay valid until the submission completes.
+  iovec remaining_;
+};
+
+namespace {
+
+#if defined(SHAKA_HAS_IO_URING)
+
+// Size of the submission ring shared by all the files.
+const unsigned int kRingEntries = 256;
+
+// A process wide io_uring submission ring. Submission is thread safe. The
+// completions are reaped on a dedicated worker thread, which calls
+// WriteRequest::OnComplete. The ring is intentionally never destroyed.
+class IoUring {
+ public:
+  // Returns nullptr if io_uring is not available.
+  static IoUring* GetInstance() {
+    static IoUring* instance = Create();
+    return instance;
+  }
+
+  // Submit a write of the remaining part of |request|. Blocks if the ring is
+  // at capacity, unless called from the completion thread.
+  void SubmitWrite(IoUringFile::WriteRequest* request) {
+    base::AutoLock auto_lock(lock_);
+    if (base::PlatformThread::CurrentId() != completion_thread_id_) {
+      while (in_flight_ >= sq_entries_)
+        slot_available_.Wait();
+    }
+    ++in_flight_;
+
+    const unsigned int tail = *sq_tail_;
+    const unsigned int index = tail & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = request->fd();
+    sqe->addr = reinterpret_cast<uintptr_t>(request->remaining());
+    sqe->len = 1;
+    sqe->off = request->remaining_offset();
+    sqe->user_data = reinterpret_cast<uintptr_t>(request);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    while (true) {
+      int result = syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0);
+      if (result >= 0)
+        break;
+      if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        PLOG(FATAL) << "Failed to submit io_uring request.";
+    }
+  }
+
+ private:
+  IoUring() : slot_available_(&lock_) {}
+
+  static IoUring* Create() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int ring_fd = syscall(__NR_io_uring_setup, kRingEntries, &params);
+    if (ring_fd < 0) {
+      PLOG(WARNING) << "io_uring is not available.";
+      return nullptr;
+    }
+
+    const size_t sq_ring_size =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    const size_t cq_ring_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const size_t sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+    const size_t ring_size =
+        single_mmap ? std::max(sq_ring_size, cq_ring_size) : sq_ring_size;
+    void* sq_ring =
+        mmap(nullptr, ring_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    void* cq_ring = sq_ring;
+    if (sq_ring != MAP_FAILED && !single_mmap) {
+      cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    }
+    void* sqes = MAP_FAILED;
+    if (cq_ring != MAP_FAILED) {
+      sqes = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    }
+    if (sqes == MAP_FAILED) {
+      PLOG(WARNING) << "Failed to map io_uring.";
+      // The mappings, if any, are released with the ring.
+      close(ring_fd);
+      return nullptr;
+    }
+
+    IoUring* ring = new IoUring;
+    uint8_t* sq = static_cast<uint8_t*>(sq_ring);
+    uint8_t* cq = static_cast<uint8_t*>(cq_ring);
+    ring->ring_fd_ = ring_fd;
+    ring->sq_entries_ = params.sq_entries;
+    ring->sq_tail_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+    ring->sq_mask_ =
+        reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+    ring->sq_array_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+    ring->sqes_ = static_cast<io_uring_sqe*>(sqes);
+    ring->cq_head_ = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+    ring->cq_tail_ = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+    ring->cq_mask_ =
+        reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+    ring->cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&IoUring::ReapCompletions, base::Unretained(ring)),
+        true /* task_is_slow */);
+    return ring;
+  }
+
+  // The completion thread body. Never returns.
+  void ReapCompletions() {
+    {
+      base::AutoLock auto_lock(lock_);
+      completion_thread_id_ = base::PlatformThread::CurrentId();
+    }
+    while (true) {
+      int result = syscall(__NR_io_uring_enter, ring_fd_, 0, 1,
+                           IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (result < 0 && errno != EINTR)
+        PLOG(ERROR) << "Failed to wait for io_uring completions.";
+
+      unsigned int head = *cq_head_;
+      const unsigned int tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        IoUringFile::WriteRequest* request =
+            reinterpret_cast<IoUringFile::WriteRequest*>(cqe.user_data);
+        const int cqe_result = cqe.res;
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+
+        // Resubmissions from OnComplete do not wait for a slot, so the slot
+        // is only released after the callback.
+        request->OnComplete(cqe_result);
+        base::AutoLock auto_lock(lock_);
+        --in_flight_;
+        slot_available_.Signal();
+      }
+    }
+  }
+
+  int ring_fd_ = -1;
+  unsigned int sq_entries_ = 0;
+  unsigned int* sq_tail_ = nullptr;
+  unsigned int* sq_mask_ = nullptr;
+  unsigned int* sq_array_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  unsigned int* cq_head_ = nullptr;
+  unsigned int* cq_tail_ = nullptr;
+  unsigned int* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+
+  base::Lock lock_;
+  base::ConditionVariable slot_available_;
+  // The following are protected by |lock_|. The number of requests in flight
+  // is bounded by the submission ring size, so the completion ring, which is
+  // at least as large, never overflows.
+  unsigned int in_flight_ = 0;
+  base::PlatformThreadId completion_thread_id_ = base::kInvalidThreadId;
+};
+
+#else  // !defined(SHAKA_HAS_IO_URING)
+
+class IoUring {
+ public:
+  static IoUring* GetInstance() { return nullptr; }
+  void SubmitWrite(IoUringFile::WriteRequest* request) { NOTREACHED(); }
+};
+
+#endif  // defined(SHAKA_HAS_IO_URING)
+
+}  // namespace
+
+void IoUringFile::WriteRequest::OnComplete(int result) {
+  if (result == -EINTR || result == -EAGAIN) {
+    IoUring::GetInstance()->SubmitWrite(this);
+    return;
+  }
+  if (result <= 0) {
+    // A zero byte write would otherwise be resubmitted forever.
+    file_->OnWriteDone(this, result < 0 ? result : -EIO);
+    return;
+  }
+  bytes_written_ += result;
+  if (bytes_written_ < data_.size()) {
+    IoUring::GetInstance()->SubmitWrite(this);
+    return;
+  }
+  file_->OnWriteDone(this, 0);
+}
+
+IoUringFile::IoUringFile(const char* file_name,
+                         const char* mode,
+                         uint64_t max_in_flight_bytes,
+                         uint64_t block_size)
+    : File(file_name),
+      file_mode_(mode),
+      max_in_flight_bytes_(std::max(max_in_flight_bytes, block_size)),
+      block_size_(std::max<uint64_t>(block_size, 1)),
+      fd_(-1),
+      block_offset_(0),
+      size_(0),
+      write_done_(&lock_),
+      in_flight_bytes_(0),
+      error_(0) {}
+
+IoUringFile::~IoUringFile() {}
+
+bool IoUringFile::IsSupported() {
+  return IoUring::GetInstance() != nullptr;
+}
+
+bool IoUringFile::Open() {
+  int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+  if (file_mode_ == "w") {
+    flags |= O_TRUNC;
+  } else if (file_mode_ != "a") {
+    NOTIMPLEMENTED() << "IoUringFile only supports write modes.";
+    return false;
+  }
+  fd_ = HANDLE_EINTR(open(file_name().c_str(), flags, 0666));
+  if (fd_ < 0) {
+    PLOG(ERROR) << "Failed to open " << file_name();
+    return false;
+  }
+  struct stat stat_buf;
+  if (fstat(fd_, &stat_buf) != 0) {
+    PLOG(ERROR) << "Failed to stat " << file_name();
+    IGNORE_EINTR(close(fd_));
+    fd_ = -1;
+    return false;
+  }
+  // Writes are submitted with explicit offsets, so append mode starts at the
+  // end of the file instead of using O_APPEND.
+  size_ = file_mode_ == "a" ? stat_buf.st_size : 0;
+  block_offset_ = size_;
+  block_.reserve(block_size_);
+  return true;
+}
+
+bool IoUringFile::Close() {
+  bool result = true;
+  if (fd_ >= 0) {
+    result = Flush();
+    if (IGNORE_EINTR(close(fd_)) != 0) {
+      PLOG(ERROR) << "Failed to close " << file_name();
+      result = false;
+    }
+    fd_ = -1;
+  }
+  delete this;
+  return result;
+}
+
+int64_t IoUringFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "IoUringFile does not support reading.";
+  return -1;
+}
+
+int64_t IoUringFile::Write(const void* buffer, uint64_t length) {
+  DCHECK_GE(fd_, 0);
+  {
+    base::AutoLock auto_lock(lock_);
+    if (error_)
+      return error_;
+  }
+
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_left = length;
+  while (bytes_left > 0) {
+    const uint64_t bytes_to_copy =
+        std::min(bytes_left, block_size_ - block_.size());
+    block_.insert(block_.end(), data, data + bytes_to_copy);
+    data += bytes_to_copy;
+    bytes_left -= bytes_to_copy;
+    if (block_.size() == block_size_)
+      SubmitBlock();
+  }
+  size_ = std::max(size_, block_offset_ + block_.size());
+  return length;
+}
+
+int64_t IoUringFile::Size() {
+  return size_;
+}
+
+bool IoUringFile::Flush() {
+  SubmitBlock();
+  return WaitForWrites();
+}
+
+bool IoUringFile::Seek(uint64_t position) {
+  // Writes to overlapping ranges may complete in any order, so wait for the
+  // submitted writes before writing at another position.
+  if (!Flush())
+    return false;
+  block_offset_ = position;
+  return true;
+}
+
+bool IoUringFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  *position = block_offset_ + block_.size();
+  return true;
+}
+
+void IoUringFile::SubmitBlock() {
+  if (block_.empty())
+    return;
+  const uint64_t offset = block_offset_;
+  block_offset_ += block_.size();
+  {
+    base::AutoLock auto_lock(lock_);
+    while (in_flight_bytes_ + block_.size() > max_in_flight_bytes_)
+      write_done_.Wait();
+    in_flight_bytes_ += block_.size();
+  }
+  WriteRequest* request = new WriteRequest(this, &block_, offset);
+  block_.reserve(block_size_);
+  IoUring::GetInstance()->SubmitWrite(request);
+}
+
+void IoUringFile::OnWriteDone(WriteRequest* request, int error) {
+  base::AutoLock auto_lock(lock_);
+  if (error != 0 && error_ == 0) {
+    LOG(ERROR) << "Failed to write " << file_name() << ": " << strerror(-error);
+    error_ = error;
+  }
+  in_flight_bytes_ -= request->size();
+  delete request;
+  write_done_.Broadcast();
+}
+
+bool IoUringFile::WaitForWrites() {
+  base::AutoLock auto_lock(lock_);
+  while (in_flight_bytes_ > 0)
+    write_done_.Wait();
+  return error_ == 0;
+}
+
+}  // namespace shaka
@@ -0,0 +1,97 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_IO_URING_FILE_H_
+#define PACKAGER_FILE_IO_URING_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// IoUringFile writes local files asynchronously through io_uring, on Linux.
+/// All the IoUringFile instances share a single, process wide submission ring
+/// and their completions are reaped by a single thread, instead of a thread and
+/// a circular buffer per file as with ThreadedIoFile.
+///
+/// Write() copies the data to a block buffer, which is submitted once it is
+/// full; it only blocks if too many bytes are in flight. Flush(), Seek() and
+/// Close() wait for the submitted writes to complete. A write error is
+/// returned on the next call. Only the write modes, "w" and "a", are supported.
+class IoUringFile : public File {
+ public:
+  /// @param file_name is the path of the local file.
+  /// @param mode is the file access mode, "w" or "a".
+  /// @param max_in_flight_bytes is the maximum number of bytes submitted but
+  ///        not completed yet, after which Write() blocks.
+  /// @param block_size is the size of the writes submitted to the ring.
+  IoUringFile(const char* file_name,
+              const char* mode,
+              uint64_t max_in_flight_bytes,
+              uint64_t block_size);
+
+  /// @return true if io_uring is available, i.e. if the kernel supports it
+  ///         and it is not blocked for the process.
+  static bool IsSupported();
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+  // Internal to the implementation, public for the process wide ring.
+  class WriteRequest;
+
+ protected:
+  ~IoUringFile() override;
+
+  bool Open() override;
+
+ private:
+  IoUringFile(const IoUringFile&) = delete;
+  IoUringFile& operator=(const IoUringFile&) = delete;
+
+  // Submit |block_| at |block_offset_|. No-op if |block_| is empty.
+  void SubmitBlock();
+  // Called on the completion thread once |request| is fully written, or failed
+  // with |error|, which is a negative errno.
+  void OnWriteDone(WriteRequest* request, int error);
+  // Wait for the submitted writes to complete. Returns false on write errors.
+  bool WaitForWrites();
+
+  const std::string file_mode_;
+  const uint64_t max_in_flight_bytes_;
+  const uint64_t block_size_;
+  int fd_;
+  // Data written but not submitted yet, to be written at |block_offset_|.
+  std::vector<uint8_t> block_;
+  uint64_t block_offset_;
+  uint64_t size_;
+
+  base::Lock lock_;
+  // Signaled by the completion thread when a write completes.
+  base::ConditionVariable write_done_;
+  // Protected by |lock_|.
+  uint64_t in_flight_bytes_;
+  // The first write error, as a negative errno. Protected by |lock_|.
+  int error_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_IO_URING_FILE_H_
@@ -6,19 +6,47 @@
 
 #include "packager/file/local_file.h"
 
+#include <gflags/gflags.h>
 #include <stdio.h>
+#include <stdlib.h>
 #if defined(OS_WIN)
 #include <windows.h>
 #else
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #endif  // defined(OS_WIN)
+
+#include <algorithm>
+
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
 
+DEFINE_string(local_file_cache_mode,
+              "default",
+              "How local files use the page cache, on Linux. 'default' leaves "
+              "it to the kernel. 'dontneed' hints sequential reads for inputs "
+              "and drops the pages of outputs from the page cache when they "
+              "are closed, after syncing them to disk, so outputs do not "
+              "evict the inputs. 'direct' also hints sequential reads, and "
+              "writes new outputs with O_DIRECT through aligned buffers, "
+              "bypassing the page cache.");
+
 namespace shaka {
 namespace {
 
+#if defined(OS_LINUX)
+// O_DIRECT requires the buffers, sizes and offsets to be aligned, to the
+// logical block size of the device, which is at most a page in practice.
+const size_t kDirectIoAlignment = 4096;
+const size_t kDirectIoBufferSize = 1 << 20;
+#endif  // defined(OS_LINUX)
+
 // Check if the directory |path| exists. Returns false if it does not exist or
 // it is not a directory. On non-Windows, |mode| will be filled with the file
 // permission bits on success.
@@ -96,7 +124,10 @@ bool CreateDirectory(const base::FilePath& full_path) {
 const char kAdditionalFileMode[] = "b";
 
 LocalFile::LocalFile(const char* file_name, const char* mode)
-    : File(file_name), file_mode_(mode), internal_file_(NULL) {
+    : File(file_name),
+      file_mode_(mode),
+      internal_file_(NULL),
+      direct_buffer_(nullptr, &free) {
   if (file_mode_.find(kAdditionalFileMode) == std::string::npos)
     file_mode_ += kAdditionalFileMode;
 }
@@ -104,7 +135,19 @@ LocalFile::LocalFile(const char* file_name, const char* mode)
 bool LocalFile::Close() {
   bool result = true;
   if (internal_file_) {
-    result = base::CloseFile(internal_file_);
+    result = EndDirectIo();
+#if defined(OS_LINUX)
+    if (drop_cache_on_close_) {
+      // Only clean pages can be dropped, so write the data out first.
+      const int fd = fileno(internal_file_);
+      if (fflush(internal_file_) != 0 || fdatasync(fd) != 0 ||
+          posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) != 0) {
+        LOG(WARNING) << "Failed to drop " << file_name()
+                     << " from the page cache, errno " << errno;
+      }
+    }
+#endif  // defined(OS_LINUX)
+    result &= base::CloseFile(internal_file_);
     internal_file_ = NULL;
   }
   delete this;
@@ -126,6 +169,21 @@ int64_t LocalFile::Read(void* buffer, uint64_t length) {
 int64_t LocalFile::Write(const void* buffer, uint64_t length) {
   DCHECK(buffer != NULL);
   DCHECK(internal_file_ != NULL);
+  if (direct_io_) {
+    const uint8_t* data = static_cast<const uint8_t*>(buffer);
+    uint64_t bytes_left = length;
+    while (bytes_left > 0) {
+      const size_t size = std::min<uint64_t>(
+          bytes_left, kDirectIoBufferSize - direct_buffer_size_);
+      memcpy(direct_buffer_.get() + direct_buffer_size_, data, size);
+      direct_buffer_size_ += size;
+      data += size;
+      bytes_left -= size;
+      if (direct_buffer_size_ == kDirectIoBufferSize && !WriteDirectBuffer())
+        return -1;
+    }
+    return length;
+  }
   size_t bytes_written = fwrite(buffer, sizeof(char), length, internal_file_);
   VLOG(2) << "Write " << length << " return " << bytes_written << " error "
           << ferror(internal_file_);
@@ -135,9 +193,115 @@ int64_t LocalFile::Write(const void* buffer, uint64_t length) {
   return bytes_written;
 }
 
+int64_t LocalFile::WriteV(const std::vector<IoBlock>& blocks) {
+#if defined(OS_WIN)
+  return File::WriteV(blocks);
+#else
+  DCHECK(internal_file_ != NULL);
+  // Gathered in the aligned buffer.
+  if (direct_io_)
+    return File::WriteV(blocks);
+  // Data buffered in |internal_file_| has to reach the file descriptor first
+  // to preserve the write order.
+  if (!Flush())
+    return -1;
+
+  std::vector<struct iovec> iov(blocks.size());
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    iov[i].iov_base = const_cast<void*>(blocks[i].buffer);
+    iov[i].iov_len = blocks[i].length;
+  }
+
+  const int fd = fileno(internal_file_);
+  int64_t total_bytes_written = 0;
+  size_t next_iov = 0;
+  while (next_iov < iov.size()) {
+    const int iov_count =
+        static_cast<int>(std::min<size_t>(iov.size() - next_iov, IOV_MAX));
+    ssize_t bytes_written = writev(fd, &iov[next_iov], iov_count);
+    if (bytes_written < 0) {
+      if (errno == EINTR)
+        continue;
+      LOG(ERROR) << "writev failed for " << file_name() << " errno " << errno;
+      return total_bytes_written > 0 ? total_bytes_written : -1;
+    }
+    total_bytes_written += bytes_written;
+    // Skip the blocks that are written completely and adjust the partially
+    // written one, if any.
+    while (next_iov < iov.size() &&
+           static_cast<size_t>(bytes_written) >= iov[next_iov].iov_len) {
+      bytes_written -= iov[next_iov].iov_len;
+      ++next_iov;
+    }
+    if (bytes_written > 0) {
+      iov[next_iov].iov_base =
+          static_cast<uint8_t*>(iov[next_iov].iov_base) + bytes_written;
+      iov[next_iov].iov_len -= bytes_written;
+    }
+  }
+  // Resynchronize the stream position of |internal_file_|, which may have
+  // been cached, with the file descriptor.
+  const off_t position = lseek(fd, 0, SEEK_CUR);
+  if (position < 0 || fseeko(internal_file_, position, SEEK_SET) < 0) {
+    LOG(ERROR) << "Failed to update file position for " << file_name();
+    return -1;
+  }
+  VLOG(2) << "WriteV " << blocks.size() << " blocks return "
+          << total_bytes_written;
+  return total_bytes_written;
+#endif  // defined(OS_WIN)
+}
+
+int LocalFile::BeginKernelCopy() {
+#if defined(OS_WIN)
+  return -1;
+#else
+  DCHECK(internal_file_ != NULL);
+  if (!EndDirectIo())
+    return -1;
+  // Move the file descriptor to the stream position, i.e. write out the
+  // buffered data, or discard the data read ahead.
+  const off_t position = ftello(internal_file_);
+  if (position < 0 || fflush(internal_file_) != 0)
+    return -1;
+  const int fd = fileno(internal_file_);
+  if (lseek(fd, position, SEEK_SET) < 0)
+    return -1;
+  return fd;
+#endif  // defined(OS_WIN)
+}
+
+bool LocalFile::EndKernelCopy(uint64_t bytes_copied) {
+#if defined(OS_WIN)
+  NOTREACHED();
+  return false;
+#else
+  DCHECK(internal_file_ != NULL);
+  // Resynchronize the stream position with the file descriptor.
+  const off_t position = lseek(fileno(internal_file_), 0, SEEK_CUR);
+  if (position < 0 || fseeko(internal_file_, position, SEEK_SET) < 0) {
+    LOG(ERROR) << "Failed to update file position for " << file_name();
+    return false;
+  }
+  return true;
+#endif  // defined(OS_WIN)
+}
+
 int64_t LocalFile::Size() {
   DCHECK(internal_file_ != NULL);
 
+#if defined(OS_LINUX)
+  if (direct_io_) {
+    // The pending data is only written out once a full buffer is collected.
+    const off_t position = lseek(fileno(internal_file_), 0, SEEK_CUR);
+    if (position < 0) {
+      LOG(ERROR) << "Cannot get file size.";
+      return -1;
+    }
+    return position + direct_buffer_size_;
+  }
+#endif  // defined(OS_LINUX)
+
   // Flush any buffered data, so we get the true file size.
   if (!Flush()) {
     LOG(ERROR) << "Cannot flush file.";
@@ -155,10 +319,14 @@ int64_t LocalFile::Size() {
 
 bool LocalFile::Flush() {
   DCHECK(internal_file_ != NULL);
+  if (direct_io_ && direct_buffer_size_ > 0 && !EndDirectIo())
+    return false;
   return ((fflush(internal_file_) == 0) && !ferror(internal_file_));
 }
 
 bool LocalFile::Seek(uint64_t position) {
+  if (!EndDirectIo())
+    return false;
 #if defined(OS_WIN)
   return _fseeki64(internal_file_, static_cast<__int64>(position), SEEK_SET) ==
          0;
@@ -168,6 +336,15 @@ bool LocalFile::Seek(uint64_t position) {
 }
 
 bool LocalFile::Tell(uint64_t* position) {
+#if defined(OS_LINUX)
+  if (direct_io_) {
+    const int64_t size = Size();
+    if (size < 0)
+      return false;
+    *position = size;
+    return true;
+  }
+#endif  // defined(OS_LINUX)
 #if defined(OS_WIN)
   __int64 offset = _ftelli64(internal_file_);
 #else
@@ -192,8 +369,132 @@ bool LocalFile::Open() {
     }
   }
 
+#if defined(OS_LINUX)
+  const std::string& cache_mode = FLAGS_local_file_cache_mode;
+  if (cache_mode != "default" && cache_mode != "dontneed" &&
+      cache_mode != "direct") {
+    LOG(ERROR) << "Invalid --local_file_cache_mode " << cache_mode;
+    return false;
+  }
+  // Only new files start at an aligned offset.
+  if (cache_mode == "direct" && file_mode_ == "wb") {
+    const int fd =
+        open(file_path.value().c_str(),
+             O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT | O_CLOEXEC, 0666);
+    if (fd >= 0) {
+      void* buffer = nullptr;
+      if (posix_memalign(&buffer, kDirectIoAlignment, kDirectIoBufferSize) !=
+              0 ||
+          !(internal_file_ = fdopen(fd, file_mode_.c_str()))) {
+        free(buffer);
+        close(fd);
+        return false;
+      }
+      direct_buffer_.reset(static_cast<uint8_t*>(buffer));
+      direct_io_ = true;
+      return true;
+    }
+    // Some filesystems, e.g. tmpfs, do not support O_DIRECT.
+    if (errno != EINVAL)
+      return false;
+    VLOG(1) << "O_DIRECT is not supported for " << file_name();
+  }
+#endif  // defined(OS_LINUX)
+
   internal_file_ = base::OpenFile(file_path, file_mode_.c_str());
-  return (internal_file_ != NULL);
+  if (!internal_file_)
+    return false;
+
+#if defined(OS_LINUX)
+  if (cache_mode != "default") {
+    if (file_mode_ == "rb") {
+      posix_fadvise(fileno(internal_file_), 0, 0, POSIX_FADV_SEQUENTIAL);
+    } else {
+      drop_cache_on_close_ = true;
+    }
+  }
+#endif  // defined(OS_LINUX)
+  return true;
+}
+
+bool LocalFile::WriteDirectBuffer() {
+#if defined(OS_LINUX)
+  DCHECK(direct_io_);
+  DCHECK_EQ(0u, direct_buffer_size_ % kDirectIoAlignment);
+  const int fd = fileno(internal_file_);
+  size_t bytes_written = 0;
+  while (bytes_written < direct_buffer_size_) {
+    const ssize_t result =
+        write(fd, direct_buffer_.get() + bytes_written,
+              direct_buffer_size_ - bytes_written);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      // The filesystem may accept O_DIRECT on open but not on write.
+      if (errno == EINVAL) {
+        const int flags = fcntl(fd, F_GETFL);
+        if (flags >= 0 && (flags & O_DIRECT) &&
+            fcntl(fd, F_SETFL, flags & ~O_DIRECT) == 0) {
+          continue;
+        }
+      }
+      LOG(ERROR) << "O_DIRECT write failed for " << file_name() << " errno "
+                 << errno;
+      return false;
+    }
+    bytes_written += result;
+  }
+  direct_buffer_size_ = 0;
+  return true;
+#else
+  NOTREACHED();
+  return false;
+#endif  // defined(OS_LINUX)
+}
+
+bool LocalFile::EndDirectIo() {
+#if defined(OS_LINUX)
+  if (!direct_io_)
+    return true;
+  // The aligned part is written with O_DIRECT, the tail without.
+  const size_t tail_size = direct_buffer_size_ % kDirectIoAlignment;
+  direct_buffer_size_ -= tail_size;
+  if (!WriteDirectBuffer())
+    return false;
+  direct_io_ = false;
+
+  const int fd = fileno(internal_file_);
+  const int flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags & ~O_DIRECT) < 0) {
+    LOG(ERROR) << "Failed to clear O_DIRECT for " << file_name();
+    return false;
+  }
+  if (tail_size > 0) {
+    memmove(direct_buffer_.get(),
+            direct_buffer_.get() + direct_buffer_size_, tail_size);
+    direct_buffer_size_ = tail_size;
+    const uint8_t* tail = direct_buffer_.get();
+    size_t bytes_left = tail_size;
+    while (bytes_left > 0) {
+      const ssize_t result = write(fd, tail, bytes_left);
+      if (result < 0) {
+        if (errno == EINTR)
+          continue;
+        LOG(ERROR) << "Write failed for " << file_name() << " errno " << errno;
+        return false;
+      }
+      tail += result;
+      bytes_left -= result;
+    }
+  }
+  direct_buffer_.reset();
+  direct_buffer_size_ = 0;
+  // Resynchronize the stream position with the file descriptor.
+  const off_t position = lseek(fd, 0, SEEK_CUR);
+  return position >= 0 && fseeko(internal_file_, position, SEEK_SET) >= 0;
+#else
+  return true;
+#endif  // defined(OS_LINUX)
 }
 
 bool LocalFile::Delete(const char* file_name) {
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 
 #include "packager/base/compiler_specific.h"
@@ -29,6 +30,7 @@ class LocalFile : public File {
   bool Close() override;
   int64_t Read(void* buffer, uint64_t length) override;
   int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t WriteV(const std::vector<IoBlock>& blocks) override;
   int64_t Size() override;
   bool Flush() override;
   bool Seek(uint64_t position) override;
@@ -44,10 +46,25 @@ class LocalFile : public File {
   ~LocalFile() override;
 
   bool Open() override;
+  int BeginKernelCopy() override;
+  bool EndKernelCopy(uint64_t bytes_copied) override;
 
  private:
+  // Write out the aligned buffer with O_DIRECT.
+  bool WriteDirectBuffer();
+  // Write out the data pending in the aligned buffer and leave the O_DIRECT
+  // mode, for operations that need the file position to be up to date.
+  bool EndDirectIo();
+
   std::string file_mode_;
   FILE* internal_file_;
+  // Drop the pages of the file from the page cache on Close().
+  bool drop_cache_on_close_ = false;
+  // Set while writing with O_DIRECT through |direct_buffer_|.
+  bool direct_io_ = false;
+  std::unique_ptr<uint8_t, void (*)(void*)> direct_buffer_;
+  // The number of bytes of |direct_buffer_| pending.
+  size_t direct_buffer_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(LocalFile);
 };
@@ -6,19 +6,33 @@
 
 #include "packager/file/memory_file.h"
 
+#include <gflags/gflags.h>
 #include <string.h>  // for memcpy
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <list>
 #include <map>
 #include <memory>
-#include <set>
 
 #include "packager/base/logging.h"
+#include "packager/base/synchronization/condition_variable.h"
 #include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+DEFINE_uint64(memory_file_max_size,
+              0,
+              "Maximum total size of the closed memory:// files, in bytes. The "
+              "least recently used files which are not open are evicted to "
+              "stay under it. 0 means no limit.");
 
 namespace shaka {
 namespace {
 
+const size_t kNumShards = 16;
+
 // A helper filesystem object.  This holds the data for the memory files.
 class FileSystem {
  public:
@@ -30,67 +44,189 @@ class FileSystem {
   }
 
   void Delete(const std::string& file_name) {
-    base::AutoLock auto_lock(lock_);
+    Shard* shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard->lock);
 
-    if (open_files_.find(file_name) != open_files_.end()) {
+    auto iter = shard->files.find(file_name);
+    if (iter == shard->files.end())
+      return;
+    if (iter->second.IsOpen()) {
       LOG(ERROR) << "File '" << file_name
                  << "' is still open. Deleting an open MemoryFile is not "
                     "allowed. Exit without deleting the file.";
       return;
     }
-
-    files_.erase(file_name);
+    EraseLocked(shard, iter);
   }
 
   void DeleteAll() {
-    base::AutoLock auto_lock(lock_);
-    if (!open_files_.empty()) {
+    // Take all the locks, in order, so no file is opened in between.
+    for (Shard& shard : shards_)
+      shard.lock.Acquire();
+    bool has_open_files = false;
+    for (Shard& shard : shards_) {
+      for (const auto& entry : shard.files)
+        has_open_files |= entry.second.IsOpen();
+    }
+    if (has_open_files) {
       LOG(ERROR) << "There are still files open. Deleting an open MemoryFile "
                     "is not allowed. Exit without deleting the file.";
-      return;
+    } else {
+      for (Shard& shard : shards_) {
+        shard.files.clear();
+        shard.lru.clear();
+      }
+      total_size_ = 0;
     }
-    files_.clear();
+    for (size_t i = kNumShards; i > 0; --i)
+      shards_[i - 1].lock.Release();
   }
 
-  std::vector<uint8_t>* Open(const std::string& file_name,
-                             const std::string& mode) {
-    base::AutoLock auto_lock(lock_);
+  // Returns false if the file cannot be opened for writing.
+  bool OpenForWriting(const std::string& file_name) {
+    Shard* shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard->lock);
+
+    auto iter = shard->files.find(file_name);
+    if (iter != shard->files.end()) {
+      if (iter->second.IsOpen()) {
+        NOTIMPLEMENTED() << "File '" << file_name
+                         << "' is already open. MemoryFile does not support "
+                            "writing a file which is open.";
+        return false;
+      }
+      // The previous data stays valid for the readers holding a snapshot.
+      total_size_ -= iter->second.data->size();
+      iter->second.data.reset();
+    } else {
+      iter = shard->files.emplace(file_name, Entry()).first;
+      iter->second.lru_position =
+          shard->lru.insert(shard->lru.end(), file_name);
+    }
+    iter->second.writing = true;
+    return true;
+  }
 
-    if (open_files_.find(file_name) != open_files_.end()) {
-      NOTIMPLEMENTED() << "File '" << file_name
-                       << "' is already open. MemoryFile does not support "
-                          "open the same file before it is closed.";
-      return nullptr;
+  // Publish |chunk|, which follows the data flushed so far to |file_name|.
+  void PublishFlushed(const std::string& file_name,
+                      std::vector<uint8_t> chunk) {
+    Shard* shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard->lock);
+
+    auto iter = shard->files.find(file_name);
+    if (iter == shard->files.end() || !iter->second.writing)
+      return;
+    iter->second.flushed_size += chunk.size();
+    iter->second.flushed_chunks.push_back(std::move(chunk));
+    shard->data_published.Broadcast();
+  }
+
+  bool GetPublishedData(const std::string& file_name,
+                        uint64_t offset,
+                        base::TimeDelta timeout,
+                        MemoryFile::PublishedData* published) {
+    Shard* shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard->lock);
+
+    const base::TimeTicks deadline = base::TimeTicks::Now() + timeout;
+    while (true) {
+      auto iter = shard->files.find(file_name);
+      if (iter == shard->files.end())
+        return false;
+      Entry& entry = iter->second;
+      if (!entry.writing) {
+        published->snapshot = entry.data;
+        published->generation = entry.generation;
+        TouchLocked(shard, &entry);
+        return true;
+      }
+      if (entry.flushed_size > offset) {
+        uint64_t chunk_offset = 0;
+        for (const std::vector<uint8_t>& chunk : entry.flushed_chunks) {
+          const uint64_t chunk_end = chunk_offset + chunk.size();
+          if (chunk_end > offset) {
+            const uint64_t start = std::max(offset, chunk_offset);
+            published->flushed_data.insert(
+                published->flushed_data.end(),
+                chunk.begin() + (start - chunk_offset), chunk.end());
+          }
+          chunk_offset = chunk_end;
+        }
+        return true;
+      }
+      const base::TimeDelta remaining = deadline - base::TimeTicks::Now();
+      if (remaining <= base::TimeDelta())
+        return true;
+      shard->data_published.TimedWait(remaining);
     }
+  }
 
-    auto iter = files_.find(file_name);
-    if (mode == "r") {
-      if (iter == files_.end())
-        return nullptr;
-    } else if (mode == "w") {
-      if (iter != files_.end())
-        iter->second.clear();
-    } else {
-      NOTIMPLEMENTED() << "File mode '" << mode
-                       << "' not supported by MemoryFile";
-      return nullptr;
+  bool WaitForNewVersion(const std::string& file_name,
+                         uint64_t generation,
+                         base::TimeDelta timeout) {
+    Shard* shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard->lock);
+
+    const base::TimeTicks deadline = base::TimeTicks::Now() + timeout;
+    while (true) {
+      auto iter = shard->files.find(file_name);
+      if (iter != shard->files.end() && !iter->second.writing &&
+          iter->second.generation != generation) {
+        return true;
+      }
+      const base::TimeDelta remaining = deadline - base::TimeTicks::Now();
+      if (remaining <= base::TimeDelta())
+        return false;
+      shard->data_published.TimedWait(remaining);
     }
+  }
 
-    open_files_[file_name] = mode;
-    return &files_[file_name];
+  // Returns nullptr if the file does not exist or is being written.
+  MemoryFile::Snapshot OpenForReading(const std::string& file_name) {
+    return GetSnapshot(file_name, true);
   }
 
-  bool Close(const std::string& file_name) {
-    base::AutoLock auto_lock(lock_);
+  MemoryFile::Snapshot GetSnapshot(const std::string& file_name) {
+    return GetSnapshot(file_name, false);
+  }
 
-    auto iter = open_files_.find(file_name);
-    if (iter == open_files_.end()) {
+  // Publish the data written to |file_name|.
+  bool CloseWriter(const std::string& file_name,
+                   std::unique_ptr<std::vector<uint8_t>> data) {
+    {
+      Shard* shard = GetShard(file_name);
+      base::AutoLock auto_lock(shard->lock);
+
+      auto iter = shard->files.find(file_name);
+      if (iter == shard->files.end() || !iter->second.writing) {
+        LOG(ERROR) << "Cannot close file '" << file_name
+                   << "' which is not open.";
+        return false;
+      }
+      total_size_ += data->size();
+      iter->second.data.reset(data.release());
+      iter->second.writing = false;
+      iter->second.generation = ++generation_;
+      iter->second.flushed_chunks.clear();
+      iter->second.flushed_size = 0;
+      TouchLocked(shard, &iter->second);
+      shard->data_published.Broadcast();
+    }
+    EvictIfNeeded();
+    return true;
+  }
+
+  bool CloseReader(const std::string& file_name) {
+    Shard* shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard->lock);
+
+    auto iter = shard->files.find(file_name);
+    if (iter == shard->files.end() || iter->second.num_readers == 0) {
       LOG(ERROR) << "Cannot close file '" << file_name
                  << "' which is not open.";
       return false;
     }
-
-    open_files_.erase(iter);
+    --iter->second.num_readers;
     return true;
   }
 
@@ -100,23 +236,122 @@ class FileSystem {
 
   FileSystem() = default;
 
-  // Filename to file data map.
-  std::map<std::string, std::vector<uint8_t>> files_;
-  // Filename to file open modes map.
-  std::map<std::string, std::string> open_files_;
+  struct Entry {
+    bool IsOpen() const { return writing || num_readers > 0; }
+
+    // The data of the closed file, or nullptr while it is first written.
+    MemoryFile::Snapshot data;
+    bool writing = false;
+    int num_readers = 0;
+    // The time of the last access, for eviction.
+    uint64_t last_access = 0;
+    std::list<std::string>::iterator lru_position;
+    // Identifies the version of |data|, see MemoryFile::PublishedData.
+    uint64_t generation = 0;
+    // The data flushed by the writer so far, in the order it was written.
+    std::vector<std::vector<uint8_t>> flushed_chunks;
+    uint64_t flushed_size = 0;
+  };
+
+  struct Shard {
+    Shard() : data_published(&lock) {}
+
+    base::Lock lock;
+    // Signaled when data is flushed or a file is closed by its writer.
+    base::ConditionVariable data_published;
+    // Filename to file map.
+    std::map<std::string, Entry> files;
+    // Filenames from the least to the most recently used.
+    std::list<std::string> lru;
+  };
+
+  Shard* GetShard(const std::string& file_name) {
+    return &shards_[std::hash<std::string>()(file_name) % kNumShards];
+  }
+
+  MemoryFile::Snapshot GetSnapshot(const std::string& file_name, bool open) {
+    Shard* shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard->lock);
+
+    auto iter = shard->files.find(file_name);
+    if (iter == shard->files.end() || iter->second.writing)
+      return nullptr;
+    if (open)
+      ++iter->second.num_readers;
+    TouchLocked(shard, &iter->second);
+    return iter->second.data;
+  }
+
+  void TouchLocked(Shard* shard, Entry* entry) {
+    entry->last_access = ++clock_;
+    shard->lru.splice(shard->lru.end(), shard->lru, entry->lru_position);
+  }
+
+  void EraseLocked(Shard* shard, std::map<std::string, Entry>::iterator iter) {
+    if (iter->second.data)
+      total_size_ -= iter->second.data->size();
+    shard->lru.erase(iter->second.lru_position);
+    shard->files.erase(iter);
+  }
+
+  // Evict the least recently used files which are not open, across the shards,
+  // until the total size is under --memory_file_max_size.
+  void EvictIfNeeded() {
+    const uint64_t max_size = FLAGS_memory_file_max_size;
+    if (max_size == 0)
+      return;
+    while (total_size_ > max_size) {
+      Shard* oldest_shard = nullptr;
+      std::string oldest_file_name;
+      uint64_t oldest_access = std::numeric_limits<uint64_t>::max();
+      for (Shard& shard : shards_) {
+        base::AutoLock auto_lock(shard.lock);
+        for (const std::string& file_name : shard.lru) {
+          const Entry& entry = shard.files.find(file_name)->second;
+          if (entry.IsOpen())
+            continue;
+          if (entry.last_access < oldest_access) {
+            oldest_shard = &shard;
+            oldest_file_name = file_name;
+            oldest_access = entry.last_access;
+          }
+          break;
+        }
+      }
+      if (!oldest_shard)
+        return;
+
+      base::AutoLock auto_lock(oldest_shard->lock);
+      auto iter = oldest_shard->files.find(oldest_file_name);
+      // Skip the file if it was accessed in the meantime.
+      if (iter != oldest_shard->files.end() && !iter->second.IsOpen() &&
+          iter->second.last_access == oldest_access) {
+        VLOG(1) << "Evicting memory file '" << oldest_file_name << "'.";
+        EraseLocked(oldest_shard, iter);
+      }
+    }
+  }
 
-  base::Lock lock_;
+  Shard shards_[kNumShards];
+  // The total size of the closed files.
+  std::atomic<uint64_t> total_size_{0};
+  std::atomic<uint64_t> clock_{0};
+  std::atomic<uint64_t> generation_{0};
 };
 
 }  // namespace
 
 MemoryFile::MemoryFile(const std::string& file_name, const std::string& mode)
-    : File(file_name), mode_(mode), file_(NULL), position_(0) {}
+    : File(file_name), mode_(mode), position_(0), flushed_size_(0) {}
 
 MemoryFile::~MemoryFile() {}
 
 bool MemoryFile::Close() {
-  if (!FileSystem::Instance()->Close(file_name()))
+  const bool result =
+      buffer_ ? FileSystem::Instance()->CloseWriter(file_name(),
+                                                    std::move(buffer_))
+              : FileSystem::Instance()->CloseReader(file_name());
+  if (!result)
     return false;
   delete this;
   return true;
@@ -129,7 +364,7 @@ int64_t MemoryFile::Read(void* buffer, uint64_t length) {
     return 0;
 
   const uint64_t bytes_to_read = std::min(length, size - position_);
-  memcpy(buffer, &(*file_)[position_], bytes_to_read);
+  memcpy(buffer, &data()[position_], bytes_to_read);
   position_ += bytes_to_read;
   return bytes_to_read;
 }
@@ -141,23 +376,36 @@ int64_t MemoryFile::Write(const void* buffer, uint64_t length) {
   if (length == 0) {
     return 0;
   }
+  if (!buffer_) {
+    LOG(ERROR) << "File '" << file_name() << "' is not open for writing.";
+    return -1;
+  }
 
   const uint64_t size = Size();
   if (size < position_ + length) {
-    file_->resize(position_ + length);
+    buffer_->resize(position_ + length);
   }
 
-  memcpy(&(*file_)[position_], buffer, length);
+  LOG_IF(WARNING, position_ < flushed_size_)
+      << "Rewriting data of '" << file_name()
+      << "' which is already flushed. The readers of the flushed data do not "
+         "see the change until the file is closed.";
+  memcpy(&(*buffer_)[position_], buffer, length);
   position_ += length;
   return length;
 }
 
 int64_t MemoryFile::Size() {
-  DCHECK(file_);
-  return file_->size();
+  return data().size();
 }
 
 bool MemoryFile::Flush() {
+  if (buffer_ && buffer_->size() > flushed_size_) {
+    FileSystem::Instance()->PublishFlushed(
+        file_name(), std::vector<uint8_t>(buffer_->begin() + flushed_size_,
+                                          buffer_->end()));
+    flushed_size_ = buffer_->size();
+  }
   return true;
 }
 
@@ -175,14 +423,29 @@ bool MemoryFile::Tell(uint64_t* position) {
 }
 
 bool MemoryFile::Open() {
-  file_ = FileSystem::Instance()->Open(file_name(), mode_);
-  if (!file_)
+  if (mode_ == "r") {
+    snapshot_ = FileSystem::Instance()->OpenForReading(file_name());
+    if (!snapshot_)
+      return false;
+  } else if (mode_ == "w") {
+    if (!FileSystem::Instance()->OpenForWriting(file_name()))
+      return false;
+    buffer_.reset(new std::vector<uint8_t>);
+  } else {
+    NOTIMPLEMENTED() << "File mode '" << mode_
+                     << "' not supported by MemoryFile";
     return false;
+  }
 
   position_ = 0;
   return true;
 }
 
+const std::vector<uint8_t>& MemoryFile::data() const {
+  DCHECK(buffer_ || snapshot_);
+  return buffer_ ? *buffer_ : *snapshot_;
+}
+
 void MemoryFile::DeleteAll() {
   FileSystem::Instance()->DeleteAll();
 }
@@ -191,4 +454,26 @@ void MemoryFile::Delete(const std::string& file_name) {
   FileSystem::Instance()->Delete(file_name);
 }
 
+MemoryFile::Snapshot MemoryFile::GetSnapshot(const std::string& file_name) {
+  return FileSystem::Instance()->GetSnapshot(file_name);
+}
+
+bool MemoryFile::GetPublishedData(const std::string& file_name,
+                                  uint64_t offset,
+                                  int64_t timeout_ms,
+                                  PublishedData* published) {
+  DCHECK(published);
+  *published = PublishedData();
+  return FileSystem::Instance()->GetPublishedData(
+      file_name, offset, base::TimeDelta::FromMilliseconds(timeout_ms),
+      published);
+}
+
+bool MemoryFile::WaitForNewVersion(const std::string& file_name,
+                                   uint64_t generation,
+                                   int64_t timeout_ms) {
+  return FileSystem::Instance()->WaitForNewVersion(
+      file_name, generation, base::TimeDelta::FromMilliseconds(timeout_ms));
+}
+
 }  // namespace shaka
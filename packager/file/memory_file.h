@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -16,10 +17,25 @@
 
 namespace shaka {
 
-/// Implements a File that is stored in memory.  This should be only used for
-/// testing, since this does not support larger files.
+/// Implements a File that is stored in memory.
+///
+/// The store is sharded by file name, so files with different names do not
+/// contend. A file being written is private to its writer until it is closed.
+/// The closed file is then published as an immutable snapshot, which any
+/// number of readers can open concurrently, and which stays valid for them
+/// even if the file is overwritten, deleted or evicted in the meantime.
+///
+/// If --memory_file_max_size is set, the least recently used files which are
+/// not open are evicted to keep the total size of the closed files under it,
+/// so the store can serve as a bounded in-memory segment cache.
+///
+/// Flush() publishes the data written so far to a file before it is closed,
+/// e.g. the chunks of a low latency segment, see GetPublishedData().
 class MemoryFile : public File {
  public:
+  /// The immutable data of a closed file.
+  typedef std::shared_ptr<const std::vector<uint8_t>> Snapshot;
+
   MemoryFile(const std::string& file_name, const std::string& mode);
 
   /// @name File implementation overrides.
@@ -41,14 +57,62 @@ class MemoryFile : public File {
   /// with that file name will be in an undefined state.
   static void Delete(const std::string& file_name);
 
+  /// Get the data of a closed file without copying it. This counts as an
+  /// access for eviction.
+  /// @param file_name is the name of the file, without the memory:// prefix.
+  /// @return the snapshot of the file, or nullptr if the file does not exist
+  ///         or is being written.
+  static Snapshot GetSnapshot(const std::string& file_name);
+
+  /// The published data of a file, see GetPublishedData().
+  struct PublishedData {
+    /// The data of the closed file, or nullptr if it is being written.
+    Snapshot snapshot;
+    /// Identifies the version of @a snapshot. It changes every time the file
+    /// is written again.
+    uint64_t generation = 0;
+    /// The data flushed by the writer from the requested offset, if the file
+    /// is being written.
+    std::vector<uint8_t> flushed_data;
+  };
+
+  /// Get the data of a file, or the data flushed by its writer if it is being
+  /// written, without opening it.
+  /// @param file_name is the name of the file, without the memory:// prefix.
+  /// @param offset is the offset of the flushed data to get.
+  /// @param timeout_ms is how long to wait for the writer to flush data past
+  ///        @a offset or close the file. @a published is left empty if it
+  ///        does neither in time.
+  /// @return false if the file does not exist.
+  static bool GetPublishedData(const std::string& file_name,
+                               uint64_t offset,
+                               int64_t timeout_ms,
+                               PublishedData* published);
+
+  /// Wait for a new version of a file to be closed.
+  /// @param generation is the PublishedData::generation of the current
+  ///        version.
+  /// @return true if a version with another generation is closed within
+  ///         @a timeout_ms.
+  static bool WaitForNewVersion(const std::string& file_name,
+                                uint64_t generation,
+                                int64_t timeout_ms);
+
  protected:
   ~MemoryFile() override;
   bool Open() override;
 
  private:
+  const std::vector<uint8_t>& data() const;
+
   std::string mode_;
-  std::vector<uint8_t>* file_;
+  // The data being written, in write mode.
+  std::unique_ptr<std::vector<uint8_t>> buffer_;
+  // The data being read, in read mode.
+  Snapshot snapshot_;
   uint64_t position_;
+  // The size of the data published by Flush(), in write mode.
+  uint64_t flushed_size_;
 
   DISALLOW_COPY_AND_ASSIGN(MemoryFile);
 };
@@ -3,17 +3,27 @@
 // found in the LICENSE file.
 
 #include "packager/file/memory_file.h"
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <memory>
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
 
+DECLARE_uint64(memory_file_max_size);
+
 namespace shaka {
 namespace {
 
 const uint8_t kWriteBuffer[] = {1, 2, 3, 4, 5, 6, 7, 8};
 const int64_t kWriteBufferSize = sizeof(kWriteBuffer);
 
+void WriteFile(const char* file_name) {
+  std::unique_ptr<File, FileCloser> writer(File::Open(file_name, "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(kWriteBufferSize, writer->Write(kWriteBuffer, kWriteBufferSize));
+  ASSERT_TRUE(writer.release()->Close());
+}
+
 }  // namespace
 
 class MemoryFileTest : public testing::Test {
@@ -109,4 +119,103 @@ TEST_F(MemoryFileTest, WriteExistingFileDeletes) {
   EXPECT_EQ(0, file2->Size());
 }
 
+TEST_F(MemoryFileTest, ConcurrentReaders) {
+  WriteFile("memory://file1");
+
+  std::unique_ptr<File, FileCloser> reader1(File::Open("memory://file1", "r"));
+  std::unique_ptr<File, FileCloser> reader2(File::Open("memory://file1", "r"));
+  ASSERT_TRUE(reader1);
+  ASSERT_TRUE(reader2);
+  // The file cannot be written while it is being read.
+  EXPECT_FALSE(File::Open("memory://file1", "w"));
+
+  uint8_t read_buffer[kWriteBufferSize];
+  ASSERT_EQ(kWriteBufferSize, reader1->Read(read_buffer, kWriteBufferSize));
+  EXPECT_EQ(0, memcmp(kWriteBuffer, read_buffer, kWriteBufferSize));
+  ASSERT_EQ(kWriteBufferSize, reader2->Read(read_buffer, kWriteBufferSize));
+  EXPECT_EQ(0, memcmp(kWriteBuffer, read_buffer, kWriteBufferSize));
+}
+
+TEST_F(MemoryFileTest, FileBeingWrittenIsNotReadable) {
+  std::unique_ptr<File, FileCloser> writer(File::Open("memory://file1", "w"));
+  ASSERT_TRUE(writer);
+  EXPECT_FALSE(File::Open("memory://file1", "r"));
+  EXPECT_FALSE(MemoryFile::GetSnapshot("file1"));
+}
+
+TEST_F(MemoryFileTest, SnapshotOutlivesFile) {
+  WriteFile("memory://file1");
+  MemoryFile::Snapshot snapshot = MemoryFile::GetSnapshot("file1");
+  ASSERT_TRUE(snapshot);
+
+  std::unique_ptr<File, FileCloser> writer(File::Open("memory://file1", "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(1, writer->Write(kWriteBuffer, 1));
+  ASSERT_TRUE(writer.release()->Close());
+  MemoryFile::Delete("file1");
+
+  EXPECT_EQ(std::vector<uint8_t>(kWriteBuffer, kWriteBuffer + kWriteBufferSize),
+            *snapshot);
+  EXPECT_FALSE(MemoryFile::GetSnapshot("file1"));
+}
+
+TEST_F(MemoryFileTest, FlushPublishesDataBeingWritten) {
+  std::unique_ptr<File, FileCloser> writer(File::Open("memory://file1", "w"));
+  ASSERT_TRUE(writer);
+  MemoryFile::PublishedData published;
+  ASSERT_TRUE(MemoryFile::GetPublishedData("file1", 0, 0, &published));
+  EXPECT_FALSE(published.snapshot);
+  EXPECT_TRUE(published.flushed_data.empty());
+
+  ASSERT_EQ(4, writer->Write(kWriteBuffer, 4));
+  ASSERT_TRUE(writer->Flush());
+  ASSERT_EQ(4, writer->Write(kWriteBuffer + 4, 4));
+  ASSERT_TRUE(writer->Flush());
+  ASSERT_TRUE(MemoryFile::GetPublishedData("file1", 2, 0, &published));
+  EXPECT_FALSE(published.snapshot);
+  EXPECT_EQ(std::vector<uint8_t>(kWriteBuffer + 2, kWriteBuffer + 8),
+            published.flushed_data);
+  // The file is still not readable until it is closed.
+  EXPECT_FALSE(MemoryFile::GetSnapshot("file1"));
+
+  ASSERT_TRUE(writer.release()->Close());
+  ASSERT_TRUE(MemoryFile::GetPublishedData("file1", 0, 0, &published));
+  ASSERT_TRUE(published.snapshot);
+  EXPECT_EQ(std::vector<uint8_t>(kWriteBuffer, kWriteBuffer + kWriteBufferSize),
+            *published.snapshot);
+  EXPECT_TRUE(published.flushed_data.empty());
+
+  EXPECT_FALSE(MemoryFile::GetPublishedData("file2", 0, 0, &published));
+}
+
+TEST_F(MemoryFileTest, WaitForNewVersion) {
+  WriteFile("memory://file1");
+  MemoryFile::PublishedData published;
+  ASSERT_TRUE(MemoryFile::GetPublishedData("file1", 0, 0, &published));
+  EXPECT_FALSE(MemoryFile::WaitForNewVersion("file1", published.generation, 0));
+
+  WriteFile("memory://file1");
+  EXPECT_TRUE(MemoryFile::WaitForNewVersion("file1", published.generation, 0));
+}
+
+TEST_F(MemoryFileTest, EvictsLeastRecentlyUsedFiles) {
+  google::FlagSaver flag_saver;
+  FLAGS_memory_file_max_size = 3 * kWriteBufferSize;
+
+  WriteFile("memory://file1");
+  WriteFile("memory://file2");
+  WriteFile("memory://file3");
+  // file1 becomes the most recently used.
+  ASSERT_TRUE(MemoryFile::GetSnapshot("file1"));
+  // file2 is open, so it is not evicted.
+  std::unique_ptr<File, FileCloser> reader(File::Open("memory://file2", "r"));
+  ASSERT_TRUE(reader);
+
+  WriteFile("memory://file4");
+  EXPECT_TRUE(MemoryFile::GetSnapshot("file1"));
+  EXPECT_TRUE(MemoryFile::GetSnapshot("file2"));
+  EXPECT_FALSE(MemoryFile::GetSnapshot("file3"));
+  EXPECT_TRUE(MemoryFile::GetSnapshot("file4"));
+}
+
 }  // namespace shaka
@@ -0,0 +1,121 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/memory_mapped_file_reader.h"
+
+#if !defined(OS_WIN)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(OS_WIN)
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+MemoryMappedFileReader::MemoryMappedFileReader(int fd,
+                                               uint64_t file_size,
+                                               size_t window_size)
+    : fd_(fd), file_size_(file_size), window_size_(window_size) {}
+
+MemoryMappedFileReader::~MemoryMappedFileReader() {
+#if !defined(OS_WIN)
+  UnmapWindow();
+  if (fd_ >= 0)
+    close(fd_);
+#endif  // !defined(OS_WIN)
+}
+
+std::unique_ptr<MemoryMappedFileReader> MemoryMappedFileReader::Open(
+    const std::string& file_name,
+    size_t window_size) {
+#if defined(OS_WIN)
+  return nullptr;
+#else
+  DCHECK_GT(window_size, 0u);
+  std::string path = file_name;
+  if (base::StartsWith(path, kLocalFilePrefix, base::CompareCase::SENSITIVE))
+    path = path.substr(strlen(kLocalFilePrefix));
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Cannot open " << file_name << " errno " << errno;
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    LOG(ERROR) << "Cannot map " << file_name << ", which is not a regular file.";
+    close(fd);
+    return nullptr;
+  }
+
+  // Windows have to start at page boundaries.
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  window_size = (window_size + page_size - 1) / page_size * page_size;
+
+  return std::unique_ptr<MemoryMappedFileReader>(new MemoryMappedFileReader(
+      fd, static_cast<uint64_t>(info.st_size), window_size));
+#endif  // defined(OS_WIN)
+}
+
+bool MemoryMappedFileReader::MapNextWindow(const uint8_t** data,
+                                           size_t* size) {
+  DCHECK(data);
+  DCHECK(size);
+#if defined(OS_WIN)
+  NOTIMPLEMENTED();
+  return false;
+#else
+  UnmapWindow();
+  if (next_offset_ >= file_size_) {
+    *data = nullptr;
+    *size = 0;
+    return true;
+  }
+
+  const size_t window_size = static_cast<size_t>(
+      std::min<uint64_t>(window_size_, file_size_ - next_offset_));
+  void* window = mmap(nullptr, window_size, PROT_READ, MAP_PRIVATE, fd_,
+                      static_cast<off_t>(next_offset_));
+  if (window == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map " << window_size << " bytes at offset "
+               << next_offset_ << " errno " << errno;
+    return false;
+  }
+  // The window is read once from start to end. This is only a hint, so
+  // failures are not fatal.
+  if (madvise(window, window_size, MADV_SEQUENTIAL) != 0)
+    VLOG(1) << "madvise failed with errno " << errno;
+
+  window_ = window;
+  mapped_size_ = window_size;
+  next_offset_ += window_size;
+
+  *data = static_cast<const uint8_t*>(window_);
+  *size = mapped_size_;
+  return true;
+#endif  // defined(OS_WIN)
+}
+
+void MemoryMappedFileReader::UnmapWindow() {
+#if !defined(OS_WIN)
+  if (!window_)
+    return;
+  if (munmap(window_, mapped_size_) != 0)
+    LOG(WARNING) << "munmap failed with errno " << errno;
+  window_ = nullptr;
+  mapped_size_ = 0;
+#endif  // !defined(OS_WIN)
+}
+
+}  // namespace shaka
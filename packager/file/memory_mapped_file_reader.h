@@ -0,0 +1,65 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_MEMORY_MAPPED_FILE_READER_H_
+#define PACKAGER_FILE_MEMORY_MAPPED_FILE_READER_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/base/macros.h"
+
+namespace shaka {
+
+/// Reads a local file sequentially through memory mapped windows, which lets
+/// the caller access the file data without copying it into a buffer first.
+/// Only one window is mapped at a time, so arbitrarily large files can be read
+/// without exhausting the address space. Not supported on Windows.
+class MemoryMappedFileReader {
+ public:
+  ~MemoryMappedFileReader();
+
+  /// Open a local file for memory mapped reading.
+  /// @param file_name is the path of a local file, optionally prefixed with
+  ///        kLocalFilePrefix.
+  /// @param window_size is the maximum size of a mapped window. It is rounded
+  ///        up to a multiple of the page size.
+  /// @return A MemoryMappedFileReader on success, NULL if the file cannot be
+  ///         opened or mapped.
+  static std::unique_ptr<MemoryMappedFileReader> Open(
+      const std::string& file_name,
+      size_t window_size);
+
+  /// Map the next window of the file. The previous window is unmapped, so the
+  /// data returned by the previous call is no longer accessible.
+  /// @param[out] data is set to the start of the window.
+  /// @param[out] size is set to the size of the window. Zero at end of file.
+  /// @return true on success, false on error.
+  bool MapNextWindow(const uint8_t** data, size_t* size);
+
+  uint64_t file_size() const { return file_size_; }
+
+ private:
+  MemoryMappedFileReader(int fd, uint64_t file_size, size_t window_size);
+
+  void UnmapWindow();
+
+  int fd_ = -1;
+  uint64_t file_size_ = 0;
+  size_t window_size_ = 0;
+  // Offset of the next window in the file.
+  uint64_t next_offset_ = 0;
+  void* window_ = nullptr;
+  size_t mapped_size_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryMappedFileReader);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_MEMORY_MAPPED_FILE_READER_H_
@@ -0,0 +1,94 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/memory_mapped_file_reader.h"
+
+#include <gtest/gtest.h>
+#if !defined(OS_WIN)
+#include <unistd.h>
+#endif  // !defined(OS_WIN)
+
+#include "packager/base/files/file_util.h"
+
+namespace shaka {
+
+#if !defined(OS_WIN)
+
+namespace {
+// Small enough to be rounded up to a single page.
+const size_t kWindowSize = 100;
+}  // namespace
+
+class MemoryMappedFileReaderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateTemporaryFile(&test_file_path_));
+  }
+
+  void TearDown() override { base::DeleteFile(test_file_path_, false); }
+
+  void WriteTestFile(size_t size) {
+    data_.resize(size);
+    for (size_t i = 0; i < size; ++i)
+      data_[i] = static_cast<char>(i % 251);
+    ASSERT_EQ(static_cast<int>(size),
+              base::WriteFile(test_file_path_, data_.data(), size));
+  }
+
+  std::string ReadAll(MemoryMappedFileReader* reader) {
+    std::string result;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    while (reader->MapNextWindow(&data, &size) && size > 0)
+      result.append(reinterpret_cast<const char*>(data), size);
+    return result;
+  }
+
+  base::FilePath test_file_path_;
+  std::string data_;
+};
+
+TEST_F(MemoryMappedFileReaderTest, OpenNonExistentFile) {
+  ASSERT_TRUE(base::DeleteFile(test_file_path_, false));
+  EXPECT_FALSE(
+      MemoryMappedFileReader::Open(test_file_path_.AsUTF8Unsafe(), kWindowSize));
+}
+
+TEST_F(MemoryMappedFileReaderTest, EmptyFile) {
+  WriteTestFile(0);
+  std::unique_ptr<MemoryMappedFileReader> reader =
+      MemoryMappedFileReader::Open(test_file_path_.AsUTF8Unsafe(), kWindowSize);
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(0u, reader->file_size());
+
+  const uint8_t* data = nullptr;
+  size_t size = 1;
+  ASSERT_TRUE(reader->MapNextWindow(&data, &size));
+  EXPECT_EQ(0u, size);
+}
+
+TEST_F(MemoryMappedFileReaderTest, ReadInMultipleWindows) {
+  const size_t kPageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  WriteTestFile(kPageSize * 3 + kPageSize / 2);
+  std::unique_ptr<MemoryMappedFileReader> reader =
+      MemoryMappedFileReader::Open(test_file_path_.AsUTF8Unsafe(), kWindowSize);
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(data_.size(), reader->file_size());
+
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  ASSERT_TRUE(reader->MapNextWindow(&data, &size));
+  // The window size is rounded up to the page size.
+  EXPECT_EQ(kPageSize, size);
+  EXPECT_EQ(data_.substr(0, kPageSize),
+            std::string(reinterpret_cast<const char*>(data), size));
+
+  EXPECT_EQ(data_.substr(kPageSize), ReadAll(reader.get()));
+}
+
+#endif  // !defined(OS_WIN)
+
+}  // namespace shaka
@@ -0,0 +1,872 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/memory_origin_server.h"
+
+#if defined(OS_WIN)
+
+#include <windows.h>
+#include <ws2tcpip.h>
+#define close closesocket
+#define poll WSAPoll
+
+#else
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define INVALID_SOCKET -1
+
+#endif  // defined(OS_WIN)
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+namespace {
+
+// How often the threads check whether they should stop.
+const int kPollIntervalMs = 100;
+// Requests are read up to the end of their headers, which are not larger.
+const size_t kMaxRequestSize = 8192;
+// Requests are dropped if they are not received within this time.
+const int kRequestTimeoutSeconds = 5;
+// Idle connections are closed after this time.
+const int kKeepAliveTimeoutSeconds = 30;
+// Streaming a file being written stops if its writer neither flushes data nor
+// closes it within this time.
+const int kWriterTimeoutSeconds = 30;
+// Blocking playlist reloads are held for up to this many target durations,
+// as recommended by the HLS specification.
+const int kBlockingReloadTargetDurations = 3;
+
+#if defined(MSG_NOSIGNAL)
+// Writing to a connection closed by the client must not raise SIGPIPE.
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+int GetSocketErrorCode() {
+#if defined(OS_WIN)
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+bool SetBlocking(SOCKET socket, bool blocking) {
+#if defined(OS_WIN)
+  u_long non_blocking = blocking ? 0 : 1;
+  return ioctlsocket(socket, FIONBIO, &non_blocking) == 0;
+#else
+  const int flags = fcntl(socket, F_GETFL, 0);
+  return flags >= 0 &&
+         fcntl(socket, F_SETFL,
+               blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool SendAll(SOCKET socket, const char* data, size_t size) {
+  size_t sent = 0;
+  while (sent < size) {
+    const int result = send(socket, data + sent,
+                            static_cast<int>(size - sent), kSendFlags);
+    if (result <= 0) {
+      VLOG(1) << "Failed to send the response, error = "
+              << GetSocketErrorCode();
+      return false;
+    }
+    sent += result;
+  }
+  return true;
+}
+
+bool SendAll(SOCKET socket, const std::string& data) {
+  return SendAll(socket, data.data(), data.size());
+}
+
+bool SendChunk(SOCKET socket, const uint8_t* data, size_t size) {
+  return SendAll(socket, base::StringPrintf("%zx\r\n", size)) &&
+         SendAll(socket, reinterpret_cast<const char*>(data), size) &&
+         SendAll(socket, "\r\n");
+}
+
+// Formats the status line and the headers of a response. |headers| are
+// "Name: value\r\n" lines.
+std::string FormatResponseHead(const std::string& status,
+                               const std::string& headers,
+                               bool keep_alive) {
+  return "HTTP/1.1 " + status + "\r\n" + headers +
+         (keep_alive ? "" : "Connection: close\r\n") + "\r\n";
+}
+
+bool SendError(SOCKET socket,
+               const std::string& status,
+               bool head_only,
+               bool keep_alive) {
+  const std::string body = status + "\n";
+  return SendAll(
+      socket,
+      FormatResponseHead(status,
+                         "Content-Type: text/plain\r\n"
+                         "Content-Length: " +
+                             base::SizeTToString(body.size()) + "\r\n",
+                         keep_alive) +
+          (head_only ? "" : body));
+}
+
+std::string GetContentType(const std::string& file_name) {
+  const struct {
+    const char* extension;
+    const char* content_type;
+  } kContentTypes[] = {
+      {".m3u8", "application/vnd.apple.mpegurl"},
+      {".mpd", "application/dash+xml"},
+      {".mp4", "video/mp4"},
+      {".m4s", "video/mp4"},
+      {".m4v", "video/mp4"},
+      {".m4a", "audio/mp4"},
+      {".cmfv", "video/mp4"},
+      {".cmfa", "audio/mp4"},
+      {".ts", "video/mp2t"},
+      {".aac", "audio/aac"},
+      {".ac3", "audio/ac3"},
+      {".ec3", "audio/eac3"},
+      {".vtt", "text/vtt"},
+      {".webm", "video/webm"},
+  };
+  for (const auto& entry : kContentTypes) {
+    if (base::EndsWith(file_name, entry.extension,
+                       base::CompareCase::INSENSITIVE_ASCII)) {
+      return entry.content_type;
+    }
+  }
+  return "application/octet-stream";
+}
+
+// A single byte range of a Range header, see RFC 7233.
+struct ByteRange {
+  // Set for "bytes=-<suffix_length>".
+  bool is_suffix = false;
+  uint64_t suffix_length = 0;
+  // Set for "bytes=<first>-" and "bytes=<first>-<last>".
+  uint64_t first = 0;
+  bool has_last = false;
+  uint64_t last = 0;
+};
+
+// Returns false if |value| is not a single byte range, which is then ignored
+// as allowed by RFC 7233.
+bool ParseByteRange(const std::string& value, ByteRange* range) {
+  const char kBytesUnit[] = "bytes=";
+  if (!base::StartsWith(value, kBytesUnit, base::CompareCase::SENSITIVE))
+    return false;
+  const std::string spec = value.substr(strlen(kBytesUnit));
+  const size_t dash = spec.find('-');
+  if (dash == std::string::npos || spec.find(',') != std::string::npos)
+    return false;
+  const std::string first = spec.substr(0, dash);
+  const std::string last = spec.substr(dash + 1);
+  if (first.empty()) {
+    range->is_suffix = true;
+    return base::StringToUint64(last, &range->suffix_length);
+  }
+  if (!base::StringToUint64(first, &range->first))
+    return false;
+  if (last.empty())
+    return true;
+  range->has_last = true;
+  return base::StringToUint64(last, &range->last) &&
+         range->last >= range->first;
+}
+
+// Gets the bytes of a file of |size| bytes in |range|. Returns false if the
+// range is not satisfiable.
+bool ResolveByteRange(const ByteRange& range,
+                      uint64_t size,
+                      uint64_t* start,
+                      uint64_t* length) {
+  if (range.is_suffix) {
+    if (range.suffix_length == 0 || size == 0)
+      return false;
+    *start = size - std::min(range.suffix_length, size);
+  } else {
+    if (range.first >= size)
+      return false;
+    *start = range.first;
+  }
+  const uint64_t end =
+      range.has_last ? std::min(range.last + 1, size) : size;
+  *length = end - *start;
+  return true;
+}
+
+// What an HLS media playlist has, for blocking playlist reloads.
+struct PlaylistState {
+  // The media sequence number of the segment following the last complete
+  // segment.
+  uint64_t next_media_sequence_number = 0;
+  // The number of parts of that segment.
+  uint64_t num_next_parts = 0;
+  double target_duration = 0;
+  bool ended = false;
+};
+
+PlaylistState ParsePlaylist(const std::vector<uint8_t>& playlist) {
+  PlaylistState state;
+  uint64_t media_sequence_number = 0;
+  uint64_t num_segments = 0;
+  const char kMediaSequence[] = "#EXT-X-MEDIA-SEQUENCE:";
+  const char kTargetDuration[] = "#EXT-X-TARGETDURATION:";
+  for (const std::string& line :
+       base::SplitString(std::string(playlist.begin(), playlist.end()),
+                         "\r\n", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    if (base::StartsWith(line, kMediaSequence,
+                         base::CompareCase::SENSITIVE)) {
+      base::StringToUint64(line.substr(strlen(kMediaSequence)),
+                           &media_sequence_number);
+    } else if (base::StartsWith(line, kTargetDuration,
+                                base::CompareCase::SENSITIVE)) {
+      base::StringToDouble(line.substr(strlen(kTargetDuration)),
+                           &state.target_duration);
+    } else if (base::StartsWith(line, "#EXTINF:",
+                                base::CompareCase::SENSITIVE)) {
+      // The parts of a segment precede it.
+      ++num_segments;
+      state.num_next_parts = 0;
+    } else if (base::StartsWith(line, "#EXT-X-PART:",
+                                base::CompareCase::SENSITIVE)) {
+      ++state.num_next_parts;
+    } else if (line == "#EXT-X-ENDLIST") {
+      state.ended = true;
+    }
+  }
+  state.next_media_sequence_number = media_sequence_number + num_segments;
+  return state;
+}
+
+}  // namespace
+
+// A connection between its requests.
+struct MemoryOriginServer::Connection {
+  explicit Connection(SOCKET socket) : socket(socket) {}
+  ~Connection() { close(socket); }
+
+  const SOCKET socket;
+  // The data received and not served yet.
+  std::string received;
+  // The connection is closed if no complete request is received by then.
+  base::TimeTicks deadline;
+};
+
+class MemoryOriginServer::Poller
+    : public base::DelegateSimpleThread::Delegate {
+ public:
+  explicit Poller(MemoryOriginServer* server) : server_(server) {}
+
+  void Run() override { server_->PollConnections(); }
+
+ private:
+  MemoryOriginServer* const server_;
+};
+
+struct MemoryOriginServer::Request {
+  std::string method;
+  // The name of the requested memory file.
+  std::string file_name;
+  std::map<std::string, std::string> query;
+  // The headers, by lower case name.
+  std::map<std::string, std::string> headers;
+  bool keep_alive = true;
+
+  bool head_only() const { return method == "HEAD"; }
+
+  const std::string* GetHeader(const std::string& name) const {
+    auto iter = headers.find(name);
+    return iter == headers.end() ? nullptr : &iter->second;
+  }
+};
+
+MemoryOriginServer::MemoryOriginServer(size_t num_threads)
+    : num_threads_(num_threads),
+      etag_prefix_(base::Int64ToString(
+          base::Time::Now().ToInternalValue())),
+      socket_(INVALID_SOCKET),
+      wake_up_socket_(INVALID_SOCKET),
+      connection_ready_(&lock_) {
+  DCHECK_GE(num_threads_, 1u);
+}
+
+MemoryOriginServer::~MemoryOriginServer() {
+  Stop();
+}
+
+bool MemoryOriginServer::Start(uint16_t port) {
+  DCHECK_EQ(INVALID_SOCKET, socket_);
+
+#if defined(OS_WIN)
+  WSADATA wsa_data;
+  int wsa_error = WSAStartup(MAKEWORD(2, 2), &wsa_data);
+  if (wsa_error != 0) {
+    LOG(ERROR) << "Winsock start up failed with error " << wsa_error;
+    return false;
+  }
+  wsa_started_ = true;
+#endif  // defined(OS_WIN)
+
+  SOCKET new_socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (new_socket == INVALID_SOCKET) {
+    LOG(ERROR) << "Could not allocate socket, error = " << GetSocketErrorCode();
+    return false;
+  }
+
+  const int optval = 1;
+  if (setsockopt(new_socket, SOL_SOCKET, SO_REUSEADDR,
+                 reinterpret_cast<const char*>(&optval),
+                 sizeof(optval)) < 0) {
+    LOG(WARNING) << "Failed to set SO_REUSEADDR, error = "
+                 << GetSocketErrorCode();
+  }
+
+  struct sockaddr_in local_sock_addr;
+  memset(&local_sock_addr, 0, sizeof(local_sock_addr));
+  local_sock_addr.sin_family = AF_INET;
+  local_sock_addr.sin_port = htons(port);
+  local_sock_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  socklen_t addr_size = sizeof(local_sock_addr);
+  // The socket is non-blocking, as another thread may accept a pending
+  // connection first.
+  if (!SetBlocking(new_socket, false) ||
+      bind(new_socket, reinterpret_cast<struct sockaddr*>(&local_sock_addr),
+           addr_size) < 0 ||
+      listen(new_socket, SOMAXCONN) < 0 ||
+      getsockname(new_socket,
+                  reinterpret_cast<struct sockaddr*>(&local_sock_addr),
+                  &addr_size) < 0) {
+    LOG(ERROR) << "Could not listen on port " << port
+               << ", error = " << GetSocketErrorCode();
+    close(new_socket);
+    return false;
+  }
+
+  SOCKET wake_up_socket = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in wake_up_addr;
+  memset(&wake_up_addr, 0, sizeof(wake_up_addr));
+  wake_up_addr.sin_family = AF_INET;
+  wake_up_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t wake_up_addr_size = sizeof(wake_up_addr);
+  if (wake_up_socket == INVALID_SOCKET ||
+      !SetBlocking(wake_up_socket, false) ||
+      bind(wake_up_socket, reinterpret_cast<struct sockaddr*>(&wake_up_addr),
+           wake_up_addr_size) < 0 ||
+      getsockname(wake_up_socket,
+                  reinterpret_cast<struct sockaddr*>(&wake_up_addr),
+                  &wake_up_addr_size) < 0 ||
+      connect(wake_up_socket,
+              reinterpret_cast<struct sockaddr*>(&wake_up_addr),
+              wake_up_addr_size) < 0) {
+    LOG(ERROR) << "Could not create the wake up socket, error = "
+               << GetSocketErrorCode();
+    if (wake_up_socket != INVALID_SOCKET)
+      close(wake_up_socket);
+    close(new_socket);
+    return false;
+  }
+
+  socket_ = new_socket;
+  wake_up_socket_ = wake_up_socket;
+  port_ = ntohs(local_sock_addr.sin_port);
+  VLOG(1) << "Serving the memory files at http://localhost:" << port_ << "/";
+  poller_.reset(new Poller(this));
+  poller_thread_.reset(
+      new base::DelegateSimpleThread(poller_.get(), "MemoryOriginPoller"));
+  poller_thread_->Start();
+  for (size_t i = 0; i < num_threads_; ++i) {
+    threads_.emplace_back(
+        new base::DelegateSimpleThread(this, "MemoryOriginServer"));
+    threads_.back()->Start();
+  }
+  return true;
+}
+
+void MemoryOriginServer::Stop() {
+  if (socket_ != INVALID_SOCKET) {
+    {
+      base::AutoLock auto_lock(lock_);
+      stopping_ = true;
+      connection_ready_.Broadcast();
+    }
+    WakeUpPoller();
+    poller_thread_->Join();
+    poller_thread_.reset();
+    poller_.reset();
+    for (auto& thread : threads_)
+      thread->Join();
+    threads_.clear();
+    ready_connections_.clear();
+    returned_connections_.clear();
+    close(wake_up_socket_);
+    wake_up_socket_ = INVALID_SOCKET;
+    close(socket_);
+    socket_ = INVALID_SOCKET;
+  }
+#if defined(OS_WIN)
+  if (wsa_started_) {
+    WSACleanup();
+    wsa_started_ = false;
+  }
+#endif  // defined(OS_WIN)
+}
+
+bool MemoryOriginServer::ParseRequest(const std::string& head,
+                                      Request* request) {
+  const std::vector<std::string> lines = base::SplitString(
+      head, "\r\n", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  if (lines.empty())
+    return false;
+
+  // The request line, e.g. "GET /live/video.m3u8?_HLS_msn=10 HTTP/1.1".
+  const std::vector<std::string> request_line = base::SplitString(
+      lines[0], " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  if (request_line.size() != 3 || request_line[1][0] != '/')
+    return false;
+  request->method = request_line[0];
+  const std::string& target = request_line[1];
+  const size_t query_start = target.find('?');
+  request->file_name = target.substr(1, query_start - 1);
+  if (query_start != std::string::npos) {
+    base::StringPairs pairs;
+    // Parameters without a value are kept with an empty value.
+    base::SplitStringIntoKeyValuePairs(target.substr(query_start + 1), '=',
+                                       '&', &pairs);
+    for (const auto& pair : pairs)
+      request->query[pair.first] = pair.second;
+  }
+
+  for (size_t i = 1; i < lines.size(); ++i) {
+    const size_t colon = lines[i].find(':');
+    if (colon == std::string::npos)
+      return false;
+    std::string value;
+    base::TrimWhitespaceASCII(lines[i].substr(colon + 1), base::TRIM_ALL,
+                              &value);
+    request->headers[base::ToLowerASCII(lines[i].substr(0, colon))] = value;
+  }
+
+  const std::string* connection = request->GetHeader("connection");
+  const std::string connection_option =
+      connection ? base::ToLowerASCII(*connection) : std::string();
+  request->keep_alive = request_line[2] == "HTTP/1.1"
+                            ? connection_option != "close"
+                            : connection_option == "keep-alive";
+  return true;
+}
+
+void MemoryOriginServer::Run() {
+  while (true) {
+    std::unique_ptr<Connection> connection;
+    {
+      base::AutoLock auto_lock(lock_);
+      while (ready_connections_.empty() && !stopping_)
+        connection_ready_.Wait();
+      if (stopping_)
+        return;
+      connection = std::move(ready_connections_.front());
+      ready_connections_.pop_front();
+    }
+    if (ServeConnection(connection.get()))
+      ReturnConnection(std::move(connection));
+  }
+}
+
+void MemoryOriginServer::PollConnections() {
+  std::vector<std::unique_ptr<Connection>> connections;
+  std::vector<struct pollfd> poll_fds;
+  while (!stopping_) {
+    {
+      base::AutoLock auto_lock(lock_);
+      for (auto& connection : returned_connections_)
+        connections.push_back(std::move(connection));
+      returned_connections_.clear();
+    }
+
+    // The listening socket and the wake up socket, followed by the
+    // connections.
+    poll_fds.resize(2 + connections.size());
+    poll_fds[0].fd = socket_;
+    poll_fds[1].fd = wake_up_socket_;
+    for (size_t i = 0; i < connections.size(); ++i)
+      poll_fds[2 + i].fd = connections[i]->socket;
+    for (struct pollfd& poll_fd : poll_fds) {
+      poll_fd.events = POLLIN;
+      poll_fd.revents = 0;
+    }
+    if (poll(poll_fds.data(), static_cast<unsigned long>(poll_fds.size()),
+             kPollIntervalMs) < 0) {
+      VLOG(1) << "Failed to poll the connections, error = "
+              << GetSocketErrorCode();
+      continue;
+    }
+
+    if (poll_fds[1].revents & POLLIN) {
+      char buffer[64];
+      while (recv(wake_up_socket_, buffer, sizeof(buffer), 0) > 0) {
+      }
+    }
+
+    const base::TimeTicks now = base::TimeTicks::Now();
+    std::vector<std::unique_ptr<Connection>> idle_connections;
+    for (size_t i = 0; i < connections.size(); ++i) {
+      std::unique_ptr<Connection>& connection = connections[i];
+      if (poll_fds[2 + i].revents & (POLLIN | POLLHUP | POLLERR)) {
+        if (!ReceiveRequest(connection.get()))
+          continue;
+        if (connection->received.find("\r\n\r\n") != std::string::npos) {
+          base::AutoLock auto_lock(lock_);
+          ready_connections_.push_back(std::move(connection));
+          connection_ready_.Signal();
+          continue;
+        }
+      } else if (now > connection->deadline) {
+        continue;
+      }
+      idle_connections.push_back(std::move(connection));
+    }
+    connections.swap(idle_connections);
+
+    if (poll_fds[0].revents & POLLIN) {
+      // The listening socket is non-blocking.
+      SOCKET accepted;
+      while ((accepted = accept(socket_, nullptr, nullptr)) !=
+             INVALID_SOCKET) {
+        std::unique_ptr<Connection> connection(new Connection(accepted));
+#if defined(SO_NOSIGPIPE)
+        const int optval = 1;
+        setsockopt(accepted, SOL_SOCKET, SO_NOSIGPIPE, &optval,
+                   sizeof(optval));
+#endif
+        if (!SetBlocking(accepted, true))
+          continue;
+        connection->deadline =
+            now + base::TimeDelta::FromSeconds(kKeepAliveTimeoutSeconds);
+        connections.push_back(std::move(connection));
+      }
+    }
+  }
+}
+
+bool MemoryOriginServer::ReceiveRequest(Connection* connection) {
+  // The connection is readable, so it does not block.
+  char buffer[4096];
+  const int result = recv(connection->socket, buffer, sizeof(buffer), 0);
+  if (result <= 0)
+    return false;
+  if (connection->received.empty()) {
+    connection->deadline = base::TimeTicks::Now() +
+                           base::TimeDelta::FromSeconds(kRequestTimeoutSeconds);
+  }
+  connection->received.append(buffer, result);
+  return connection->received.size() <= kMaxRequestSize ||
+         connection->received.find("\r\n\r\n") != std::string::npos;
+}
+
+void MemoryOriginServer::ReturnConnection(
+    std::unique_ptr<Connection> connection) {
+  // A partial request must be completed in time, and an idle connection is
+  // closed after the keep alive timeout.
+  connection->deadline =
+      base::TimeTicks::Now() +
+      base::TimeDelta::FromSeconds(connection->received.empty()
+                                       ? kKeepAliveTimeoutSeconds
+                                       : kRequestTimeoutSeconds);
+  {
+    base::AutoLock auto_lock(lock_);
+    if (stopping_)
+      return;
+    returned_connections_.push_back(std::move(connection));
+  }
+  WakeUpPoller();
+}
+
+void MemoryOriginServer::WakeUpPoller() {
+  const char kWakeUp = 0;
+  send(wake_up_socket_, &kWakeUp, sizeof(kWakeUp), 0);
+}
+
+bool MemoryOriginServer::ServeConnection(Connection* connection) {
+  while (!stopping_) {
+    const size_t headers_end = connection->received.find("\r\n\r\n");
+    if (headers_end == std::string::npos)
+      return connection->received.size() <= kMaxRequestSize;
+
+    Request request;
+    const bool valid =
+        ParseRequest(connection->received.substr(0, headers_end), &request);
+    // GET and HEAD requests have no body, so what follows is the next
+    // request.
+    connection->received.erase(0, headers_end + 4);
+    if (!valid) {
+      SendError(connection->socket, "400 Bad Request", false, false);
+      return false;
+    }
+    if (!ServeRequest(connection->socket, request) || !request.keep_alive)
+      return false;
+  }
+  return false;
+}
+
+bool MemoryOriginServer::ServeRequest(SOCKET connection,
+                                      const Request& request) {
+  if (request.method != "GET" && request.method != "HEAD") {
+    return SendError(connection, "405 Method Not Allowed",
+                     request.head_only(), request.keep_alive);
+  }
+  if (request.file_name.empty() ||
+      request.file_name.find("..") != std::string::npos) {
+    return SendError(connection, "404 Not Found", request.head_only(),
+                     request.keep_alive);
+  }
+
+  if (request.query.count("_HLS_msn") > 0 &&
+      base::EndsWith(request.file_name, ".m3u8",
+                     base::CompareCase::INSENSITIVE_ASCII)) {
+    const std::string error_status = WaitForPlaylistUpdate(request);
+    if (!error_status.empty()) {
+      return SendError(connection, error_status, request.head_only(),
+                       request.keep_alive);
+    }
+  }
+
+  MemoryFile::PublishedData published;
+  if (!MemoryFile::GetPublishedData(request.file_name, 0, 0, &published) &&
+      (!missing_file_handler_ || !missing_file_handler_(request.file_name) ||
+       !MemoryFile::GetPublishedData(request.file_name, 0, 0, &published))) {
+    return SendError(connection, "404 Not Found", request.head_only(),
+                     request.keep_alive);
+  }
+  if (!published.snapshot)
+    return ServeFileBeingWritten(connection, request);
+  return ServeFile(connection, request, *published.snapshot,
+                   published.generation);
+}
+
+bool MemoryOriginServer::ServeFile(SOCKET connection,
+                                   const Request& request,
+                                   const std::vector<uint8_t>& data,
+                                   uint64_t generation) {
+  const std::string etag =
+      "\"" + etag_prefix_ + "-" + base::Uint64ToString(generation) + "\"";
+  std::string headers = "Content-Type: " + GetContentType(request.file_name) +
+                        "\r\n"
+                        "ETag: " +
+                        etag +
+                        "\r\n"
+                        "Accept-Ranges: bytes\r\n";
+
+  const std::string* if_none_match = request.GetHeader("if-none-match");
+  if (if_none_match && (*if_none_match == "*" ||
+                        if_none_match->find(etag) != std::string::npos)) {
+    return SendAll(connection, FormatResponseHead("304 Not Modified", headers,
+                                                  request.keep_alive));
+  }
+
+  std::string status = "200 OK";
+  uint64_t start = 0;
+  uint64_t length = data.size();
+  const std::string* range_header = request.GetHeader("range");
+  ByteRange range;
+  if (range_header && ParseByteRange(*range_header, &range)) {
+    if (!ResolveByteRange(range, data.size(), &start, &length)) {
+      headers += "Content-Range: bytes */" + base::SizeTToString(data.size()) +
+                 "\r\n"
+                 "Content-Length: 0\r\n";
+      return SendAll(connection,
+                     FormatResponseHead("416 Range Not Satisfiable", headers,
+                                        request.keep_alive));
+    }
+    status = "206 Partial Content";
+    headers += "Content-Range: bytes " + base::Uint64ToString(start) + "-" +
+               base::Uint64ToString(start + length - 1) + "/" +
+               base::SizeTToString(data.size()) + "\r\n";
+  }
+  headers += "Content-Length: " + base::Uint64ToString(length) + "\r\n";
+
+  // The data is sent from the snapshot, without copying it.
+  return SendAll(connection,
+                 FormatResponseHead(status, headers, request.keep_alive)) &&
+         (request.head_only() ||
+          SendAll(connection,
+                  reinterpret_cast<const char*>(data.data()) + start,
+                  length));
+}
+
+bool MemoryOriginServer::ServeFileBeingWritten(SOCKET connection,
+                                               const Request& request) {
+  const std::string* range_header = request.GetHeader("range");
+  ByteRange range;
+  const bool has_range = range_header && ParseByteRange(*range_header, &range);
+
+  base::TimeTicks last_data_time = base::TimeTicks::Now();
+  const base::TimeDelta writer_timeout =
+      base::TimeDelta::FromSeconds(kWriterTimeoutSeconds);
+  if (has_range && range.is_suffix) {
+    // The end of the file is not known until it is closed.
+    MemoryFile::PublishedData published;
+    while (!published.snapshot) {
+      if (stopping_ ||
+          base::TimeTicks::Now() - last_data_time > writer_timeout ||
+          !MemoryFile::GetPublishedData(
+              request.file_name, std::numeric_limits<uint64_t>::max(),
+              kPollIntervalMs, &published)) {
+        return SendError(connection, "503 Service Unavailable",
+                         request.head_only(), false);
+      }
+    }
+    return ServeFile(connection, request, *published.snapshot,
+                     published.generation);
+  }
+
+  // The data is streamed as it is flushed. A bounded range has a known length,
+  // otherwise the data is sent in chunks, until the file is closed. The file
+  // has no ETag until it is complete.
+  const bool chunked = !has_range || !range.has_last;
+  uint64_t offset = has_range ? range.first : 0;
+  const uint64_t end =
+      chunked ? std::numeric_limits<uint64_t>::max() : range.last + 1;
+  std::string headers =
+      "Content-Type: " + GetContentType(request.file_name) + "\r\n";
+  if (chunked) {
+    headers += "Transfer-Encoding: chunked\r\n";
+  } else {
+    // The size of the file is not known yet.
+    headers += "Content-Range: bytes " + base::Uint64ToString(range.first) +
+               "-" + base::Uint64ToString(range.last) +
+               "/*\r\n"
+               "Content-Length: " +
+               base::Uint64ToString(end - offset) + "\r\n";
+  }
+  if (!SendAll(connection,
+               FormatResponseHead(has_range ? "206 Partial Content" : "200 OK",
+                                  headers, request.keep_alive))) {
+    return false;
+  }
+  if (request.head_only())
+    return true;
+
+  bool complete = false;
+  while (offset < end && !complete) {
+    if (stopping_)
+      return false;
+    MemoryFile::PublishedData published;
+    if (!MemoryFile::GetPublishedData(request.file_name, offset,
+                                      kPollIntervalMs, &published)) {
+      return false;
+    }
+    const uint8_t* data = nullptr;
+    uint64_t size = 0;
+    if (published.snapshot) {
+      const std::vector<uint8_t>& file = *published.snapshot;
+      if (file.size() > offset) {
+        data = &file[offset];
+        size = std::min<uint64_t>(file.size(), end) - offset;
+      }
+      complete = true;
+    } else if (!published.flushed_data.empty()) {
+      data = &published.flushed_data[0];
+      size = std::min<uint64_t>(published.flushed_data.size(), end - offset);
+    } else {
+      if (base::TimeTicks::Now() - last_data_time > writer_timeout) {
+        LOG(WARNING) << "Stopped streaming '" << request.file_name
+                     << "', which has not been written for "
+                     << kWriterTimeoutSeconds << " seconds.";
+        return false;
+      }
+      continue;
+    }
+    last_data_time = base::TimeTicks::Now();
+    if (size == 0)
+      continue;
+    if (!(chunked ? SendChunk(connection, data, size)
+                  : SendAll(connection, reinterpret_cast<const char*>(data),
+                            size))) {
+      return false;
+    }
+    offset += size;
+  }
+  // The file ended before the end of the range, so the response is cut short.
+  if (offset < end && !chunked)
+    return false;
+  return !chunked || SendAll(connection, "0\r\n\r\n");
+}
+
+std::string MemoryOriginServer::WaitForPlaylistUpdate(const Request& request) {
+  uint64_t media_sequence_number = 0;
+  if (!base::StringToUint64(request.query.at("_HLS_msn"),
+                            &media_sequence_number)) {
+    return "400 Bad Request";
+  }
+  auto part_param = request.query.find("_HLS_part");
+  const bool has_part = part_param != request.query.end();
+  uint64_t part_index = 0;
+  if (has_part && !base::StringToUint64(part_param->second, &part_index))
+    return "400 Bad Request";
+
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  base::TimeTicks deadline =
+      start_time + base::TimeDelta::FromSeconds(kWriterTimeoutSeconds);
+  bool has_deadline_from_playlist = false;
+  while (!stopping_) {
+    MemoryFile::PublishedData published;
+    if (!MemoryFile::GetPublishedData(request.file_name, 0, 0, &published))
+      return "404 Not Found";
+    if (published.snapshot) {
+      const PlaylistState state = ParsePlaylist(*published.snapshot);
+      if (state.ended ||
+          media_sequence_number < state.next_media_sequence_number ||
+          (has_part &&
+           media_sequence_number == state.next_media_sequence_number &&
+           part_index < state.num_next_parts)) {
+        return std::string();
+      }
+      // The HLS specification asks to reject the requests for segments more
+      // than two segments after the last one.
+      if (media_sequence_number > state.next_media_sequence_number + 1)
+        return "400 Bad Request";
+      if (!has_deadline_from_playlist && state.target_duration > 0) {
+        deadline = start_time + base::TimeDelta::FromSecondsD(
+                                    kBlockingReloadTargetDurations *
+                                    state.target_duration);
+        has_deadline_from_playlist = true;
+      }
+    }
+    const base::TimeDelta remaining = deadline - base::TimeTicks::Now();
+    if (remaining <= base::TimeDelta())
+      break;
+    MemoryFile::WaitForNewVersion(
+        request.file_name, published.generation,
+        std::min<int64_t>(remaining.InMilliseconds() + 1, kPollIntervalMs));
+  }
+  return "503 Service Unavailable";
+}
+
+}  // namespace shaka
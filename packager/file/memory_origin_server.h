@@ -0,0 +1,152 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_MEMORY_ORIGIN_SERVER_H_
+#define PACKAGER_FILE_MEMORY_ORIGIN_SERVER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/simple_thread.h"
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#else
+typedef int SOCKET;
+#endif  // defined(OS_WIN)
+
+namespace shaka {
+
+/// An HTTP/1.1 origin serving the memory:// files, e.g. the segments and the
+/// manifests of a live session, so that a CDN or a player can fetch them from
+/// the packager directly. The file memory://<name> is served at /<name>.
+///
+/// Segments being written are streamed with chunked transfer encoding as
+/// their chunks are flushed, see MemoryFile::Flush(). Requests to an HLS
+/// playlist with the _HLS_msn and _HLS_part query parameters are held until
+/// the playlist has the requested segment or part, i.e. LL-HLS blocking
+/// playlist reload. Complete files have an ETag, which is checked against
+/// If-None-Match, and single byte ranges are served.
+///
+/// Connections are kept alive. The connections between requests are watched
+/// by a single thread with poll(), which hands the connections with a
+/// complete request to a fixed number of threads, serving one request per
+/// thread at a time, so idle connections do not hold a serving thread.
+class MemoryOriginServer : public base::DelegateSimpleThread::Delegate {
+ public:
+  /// Creates a missing file, e.g. a segment packaged just in time.
+  /// @param file_name is the name of the file, without the memory:// prefix.
+  /// @return true if the file is created.
+  typedef std::function<bool(const std::string& file_name)> MissingFileHandler;
+
+  /// The default number of requests served at the same time. Blocking
+  /// playlist reloads and segments being streamed hold a serving thread
+  /// until they complete.
+  static const size_t kDefaultNumThreads = 32;
+
+  /// @param num_threads is the number of requests served at the same time,
+  ///        which must be at least 1.
+  explicit MemoryOriginServer(size_t num_threads);
+
+  /// Stops the server if it is running.
+  ~MemoryOriginServer() override;
+
+  /// Listen on @a port on all the interfaces and start serving.
+  /// @param port is the TCP port to listen on. 0 picks a free port.
+  /// @return true on success.
+  bool Start(uint16_t port);
+
+  /// Stop serving and wait for the serving threads to exit.
+  void Stop();
+
+  /// Create the requested files which do not exist with @a handler, which is
+  /// called from the serving threads. It must be called before Start().
+  void set_missing_file_handler(MissingFileHandler handler) {
+    missing_file_handler_ = std::move(handler);
+  }
+
+  /// @return The port the server listens on, once started.
+  uint16_t port() const { return port_; }
+
+ private:
+  MemoryOriginServer(const MemoryOriginServer&) = delete;
+  MemoryOriginServer& operator=(const MemoryOriginServer&) = delete;
+
+  struct Request;
+  struct Connection;
+  class Poller;
+
+  // Parses the request line and the headers of a request.
+  static bool ParseRequest(const std::string& head, Request* request);
+
+  // base::DelegateSimpleThread::Delegate implementation override, which
+  // serves the connections handed over by PollConnections().
+  void Run() override;
+
+  // Accepts the connections, and waits for the requests of the idle ones,
+  // until the server stops.
+  void PollConnections();
+  // Receives from |connection|, which is readable. Returns false if the
+  // connection should be closed.
+  bool ReceiveRequest(Connection* connection);
+  // Hands |connection| back to PollConnections() once its requests are
+  // served.
+  void ReturnConnection(std::unique_ptr<Connection> connection);
+  // Wakes up PollConnections() if it is waiting.
+  void WakeUpPoller();
+
+  // Serves the complete requests received on |connection|. Returns false if
+  // the connection should be closed.
+  bool ServeConnection(Connection* connection);
+  // The following return false if the connection should be closed.
+  bool ServeRequest(SOCKET connection, const Request& request);
+  bool ServeFile(SOCKET connection,
+                 const Request& request,
+                 const std::vector<uint8_t>& data,
+                 uint64_t generation);
+  bool ServeFileBeingWritten(SOCKET connection, const Request& request);
+
+  // Holds a blocking playlist reload until the playlist has the requested
+  // segment or part.
+  // @return The HTTP error status of the request, or an empty string if the
+  //         playlist can be served.
+  std::string WaitForPlaylistUpdate(const Request& request);
+
+  const size_t num_threads_;
+  MissingFileHandler missing_file_handler_;
+  // Makes the ETags of different runs of the server differ.
+  const std::string etag_prefix_;
+  SOCKET socket_;
+  // A UDP socket connected to itself, which is readable once written to, to
+  // wake up PollConnections().
+  SOCKET wake_up_socket_;
+  uint16_t port_ = 0;
+  std::atomic<bool> stopping_{false};
+  bool wsa_started_ = false;
+  std::unique_ptr<Poller> poller_;
+  std::unique_ptr<base::DelegateSimpleThread> poller_thread_;
+  std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads_;
+
+  base::Lock lock_;
+  // Signaled when a connection is ready or the server stops.
+  base::ConditionVariable connection_ready_;
+  // The connections with a complete request, waiting for a serving thread.
+  std::deque<std::unique_ptr<Connection>> ready_connections_;
+  // The connections served, to be watched by PollConnections() again.
+  std::vector<std::unique_ptr<Connection>> returned_connections_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_MEMORY_ORIGIN_SERVER_H_
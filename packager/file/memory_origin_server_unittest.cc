@@ -0,0 +1,283 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/memory_origin_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+namespace {
+
+const int kTimeoutMs = 5000;
+
+const char kPlaylist[] =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:2\n"
+    "#EXT-X-MEDIA-SEQUENCE:5\n"
+    "#EXTINF:2.000,\n"
+    "segment5.m4s\n"
+    "#EXT-X-PART:DURATION=1.000,URI=\"segment6.m4s\",BYTERANGE=\"100@0\"\n";
+const char kUpdatedPlaylist[] =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:2\n"
+    "#EXT-X-MEDIA-SEQUENCE:5\n"
+    "#EXTINF:2.000,\n"
+    "segment5.m4s\n"
+    "#EXT-X-PART:DURATION=1.000,URI=\"segment6.m4s\",BYTERANGE=\"100@0\"\n"
+    "#EXT-X-PART:DURATION=1.000,URI=\"segment6.m4s\",BYTERANGE=\"100@100\"\n";
+
+// Returns true if |socket| becomes readable within |timeout_ms|.
+bool WaitReadable(int socket, int timeout_ms) {
+  struct pollfd poll_fd;
+  poll_fd.fd = socket;
+  poll_fd.events = POLLIN;
+  poll_fd.revents = 0;
+  return poll(&poll_fd, 1, timeout_ms) > 0;
+}
+
+// Returns a socket connected to the server listening on |port|.
+int Connect(uint16_t port) {
+  const int connection = socket(AF_INET, SOCK_STREAM, 0);
+  EXPECT_GE(connection, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  EXPECT_EQ(0, connect(connection, reinterpret_cast<sockaddr*>(&addr),
+                       sizeof(addr)));
+  return connection;
+}
+
+}  // namespace
+
+class MemoryOriginServerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    server_.reset(new MemoryOriginServer(2));
+    ASSERT_TRUE(server_->Start(0));
+    connection_ = Connect(server_->port());
+  }
+
+  void TearDown() override {
+    close(connection_);
+    server_.reset();
+    MemoryFile::DeleteAll();
+  }
+
+  void WriteFile(const std::string& file_name, const std::string& data) {
+    ASSERT_TRUE(File::WriteStringToFile(file_name.c_str(), data));
+  }
+
+  void SendRequest(const std::string& target, const std::string& headers) {
+    const std::string request =
+        "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n" + headers +
+        "\r\n";
+    ASSERT_EQ(static_cast<ssize_t>(request.size()),
+              send(connection_, request.data(), request.size(), 0));
+  }
+
+  // Reads from the connection until |received_| contains |text|, and returns
+  // what precedes it, including it.
+  std::string ReadUntil(const std::string& text) {
+    size_t pos;
+    while ((pos = received_.find(text)) == std::string::npos) {
+      if (!WaitReadable(connection_, kTimeoutMs))
+        return std::string();
+      char buffer[1024];
+      const ssize_t result = recv(connection_, buffer, sizeof(buffer), 0);
+      if (result <= 0)
+        return std::string();
+      received_.append(buffer, result);
+    }
+    const std::string result = received_.substr(0, pos + text.size());
+    received_.erase(0, pos + text.size());
+    return result;
+  }
+
+  // Reads a response with a Content-Length.
+  std::string ReadResponse() {
+    std::string response = ReadUntil("\r\n\r\n");
+    const char kContentLength[] = "Content-Length: ";
+    const size_t pos = response.find(kContentLength);
+    if (pos == std::string::npos)
+      return response;
+    const size_t length =
+        std::stoul(response.substr(pos + strlen(kContentLength)));
+    while (received_.size() < length) {
+      if (!WaitReadable(connection_, kTimeoutMs))
+        return response;
+      char buffer[1024];
+      const ssize_t result = recv(connection_, buffer, sizeof(buffer), 0);
+      if (result <= 0)
+        return response;
+      received_.append(buffer, result);
+    }
+    response += received_.substr(0, length);
+    received_.erase(0, length);
+    return response;
+  }
+
+  std::unique_ptr<MemoryOriginServer> server_;
+  int connection_ = -1;
+  std::string received_;
+};
+
+TEST_F(MemoryOriginServerTest, ServesFile) {
+  WriteFile("memory://live/segment1.m4s", "0123456789");
+
+  SendRequest("/live/segment1.m4s", "");
+  std::string response = ReadResponse();
+  EXPECT_EQ(0u, response.find("HTTP/1.1 200 OK\r\n"));
+  EXPECT_NE(std::string::npos, response.find("Content-Type: video/mp4\r\n"));
+  EXPECT_NE(std::string::npos, response.find("\r\n\r\n0123456789"));
+
+  // The connection is kept alive.
+  const size_t etag_start = response.find("ETag: ") + strlen("ETag: ");
+  const std::string etag =
+      response.substr(etag_start, response.find("\r\n", etag_start) -
+                                      etag_start);
+  SendRequest("/live/segment1.m4s", "If-None-Match: " + etag + "\r\n");
+  EXPECT_EQ(0u, ReadResponse().find("HTTP/1.1 304 Not Modified\r\n"));
+
+  SendRequest("/live/missing.m4s", "");
+  EXPECT_EQ(0u, ReadResponse().find("HTTP/1.1 404 Not Found\r\n"));
+}
+
+TEST_F(MemoryOriginServerTest, ServesRange) {
+  WriteFile("memory://segment1.m4s", "0123456789");
+
+  SendRequest("/segment1.m4s", "Range: bytes=2-4\r\n");
+  std::string response = ReadResponse();
+  EXPECT_EQ(0u, response.find("HTTP/1.1 206 Partial Content\r\n"));
+  EXPECT_NE(std::string::npos,
+            response.find("Content-Range: bytes 2-4/10\r\n"));
+  EXPECT_NE(std::string::npos, response.find("\r\n\r\n234"));
+
+  SendRequest("/segment1.m4s", "Range: bytes=-3\r\n");
+  EXPECT_NE(std::string::npos, ReadResponse().find("\r\n\r\n789"));
+
+  SendRequest("/segment1.m4s", "Range: bytes=10-\r\n");
+  response = ReadResponse();
+  EXPECT_EQ(0u, response.find("HTTP/1.1 416 Range Not Satisfiable\r\n"));
+  EXPECT_NE(std::string::npos, response.find("Content-Range: bytes */10\r\n"));
+}
+
+TEST_F(MemoryOriginServerTest, StreamsFileBeingWritten) {
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open("memory://segment1.m4s", "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(4, writer->Write("abcd", 4));
+  ASSERT_TRUE(writer->Flush());
+
+  SendRequest("/segment1.m4s", "");
+  const std::string head = ReadUntil("\r\n\r\n");
+  EXPECT_EQ(0u, head.find("HTTP/1.1 200 OK\r\n"));
+  EXPECT_NE(std::string::npos, head.find("Transfer-Encoding: chunked\r\n"));
+  EXPECT_EQ("4\r\nabcd\r\n", ReadUntil("abcd\r\n"));
+
+  ASSERT_EQ(2, writer->Write("ef", 2));
+  ASSERT_TRUE(writer->Flush());
+  EXPECT_EQ("2\r\nef\r\n", ReadUntil("ef\r\n"));
+
+  ASSERT_EQ(1, writer->Write("g", 1));
+  ASSERT_TRUE(writer.release()->Close());
+  EXPECT_EQ("1\r\ng\r\n0\r\n\r\n", ReadUntil("0\r\n\r\n"));
+}
+
+TEST_F(MemoryOriginServerTest, BlockingPlaylistReload) {
+  WriteFile("memory://video.m3u8", kPlaylist);
+
+  // The first part of segment 6 is available.
+  SendRequest("/video.m3u8?_HLS_msn=6&_HLS_part=0", "");
+  EXPECT_NE(std::string::npos, ReadResponse().find(kPlaylist));
+
+  // The second part is not, so the request is held until it is.
+  SendRequest("/video.m3u8?_HLS_msn=6&_HLS_part=1", "");
+  EXPECT_FALSE(WaitReadable(connection_, 200));
+  WriteFile("memory://video.m3u8", kUpdatedPlaylist);
+  EXPECT_NE(std::string::npos, ReadResponse().find(kUpdatedPlaylist));
+
+  // Segment 8 is too far ahead.
+  SendRequest("/video.m3u8?_HLS_msn=8", "");
+  EXPECT_EQ(0u, ReadResponse().find("HTTP/1.1 400 Bad Request\r\n"));
+}
+
+TEST_F(MemoryOriginServerTest, ServesEmptyFile) {
+  WriteFile("memory://empty.vtt", "");
+  SendRequest("/empty.vtt", "");
+  const std::string response = ReadResponse();
+  EXPECT_EQ(0u, response.find("HTTP/1.1 200 OK\r\n"));
+  EXPECT_NE(std::string::npos, response.find("Content-Length: 0\r\n"));
+}
+
+// Idle keep-alive connections do not hold the serving threads.
+TEST_F(MemoryOriginServerTest, ServesRequestsWhileConnectionsAreIdle) {
+  WriteFile("memory://segment1.m4s", "0123456789");
+  SendRequest("/segment1.m4s", "");
+  EXPECT_EQ(0u, ReadResponse().find("HTTP/1.1 200 OK\r\n"));
+
+  // More idle connections than serving threads, one of them with a partial
+  // request.
+  std::vector<int> idle_connections;
+  for (int i = 0; i < 4; ++i)
+    idle_connections.push_back(Connect(server_->port()));
+  const char kPartialRequest[] = "GET /segment1.m4s HTTP/1.1\r\n";
+  ASSERT_EQ(static_cast<ssize_t>(strlen(kPartialRequest)),
+            send(idle_connections[0], kPartialRequest,
+                 strlen(kPartialRequest), 0));
+
+  SendRequest("/segment1.m4s", "");
+  EXPECT_EQ(0u, ReadResponse().find("HTTP/1.1 200 OK\r\n"));
+  for (int idle_connection : idle_connections)
+    close(idle_connection);
+}
+
+TEST(MemoryOriginServerMissingFileTest, CreatesMissingFile) {
+  MemoryOriginServer server(1);
+  server.set_missing_file_handler([](const std::string& file_name) {
+    if (file_name != "segment2.m4s")
+      return false;
+    return File::WriteStringToFile("memory://segment2.m4s", "created");
+  });
+  ASSERT_TRUE(server.Start(0));
+  const int connection = Connect(server.port());
+
+  const std::string request =
+      "GET /segment2.m4s HTTP/1.1\r\nConnection: close\r\n\r\n";
+  ASSERT_EQ(static_cast<ssize_t>(request.size()),
+            send(connection, request.data(), request.size(), 0));
+  std::string response;
+  char buffer[1024];
+  ssize_t result;
+  while (WaitReadable(connection, kTimeoutMs) &&
+         (result = recv(connection, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, result);
+  }
+  close(connection);
+  server.Stop();
+  MemoryFile::DeleteAll();
+
+  EXPECT_EQ(0u, response.find("HTTP/1.1 200 OK\r\n"));
+  EXPECT_NE(std::string::npos, response.find("\r\n\r\ncreated"));
+}
+
+}  // namespace shaka
@@ -0,0 +1,341 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/object_storage_client.h"
+
+#include <gflags/gflags.h>
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/time/time.h"
+#include "packager/file/curl_handle_pool.h"
+
+DEFINE_string(s3_region,
+              "",
+              "AWS region of the s3:// buckets. Defaults to the AWS_REGION "
+              "environment variable, or us-east-1. The credentials are read "
+              "from the AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY and optional "
+              "AWS_SESSION_TOKEN environment variables.");
+DEFINE_string(s3_endpoint,
+              "",
+              "Endpoint of an S3 compatible service to use for s3:// files "
+              "instead of AWS, e.g. http://localhost:9000. Buckets are "
+              "addressed with path style URLs.");
+DEFINE_int32(object_storage_retries,
+             3,
+             "Number of times a failed s3:// or gs:// request is retried, "
+             "with an exponential backoff starting at one second. The gs:// "
+             "HMAC credentials are read from the GCS_HMAC_ACCESS_KEY_ID and "
+             "GCS_HMAC_SECRET environment variables.");
+
+namespace shaka {
+
+namespace {
+
+const char kUserAgentString[] = "shaka-packager-object-storage/1.0";
+const char kSigningAlgorithm[] = "AWS4-HMAC-SHA256";
+const char kGcsEndpoint[] = "https://storage.googleapis.com";
+// HMAC keys of Google Cloud Storage are not bound to a region.
+const char kGcsRegion[] = "auto";
+const char kDefaultS3Region[] = "us-east-1";
+const int kInitialRetryDelayInSeconds = 1;
+
+std::string GetEnv(const char* name) {
+  const char* value = getenv(name);
+  return value ? value : "";
+}
+
+std::string HexEncodeLower(const uint8_t* data, size_t size) {
+  return base::ToLowerASCII(base::HexEncode(data, size));
+}
+
+std::string Sha256Hex(const std::string& data) {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(data.data()), data.size(), digest);
+  return HexEncodeLower(digest, sizeof(digest));
+}
+
+std::string HmacSha256(const std::string& key, const std::string& data) {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  unsigned int digest_size = 0;
+  CHECK(HMAC(EVP_sha256(), key.data(), key.size(),
+             reinterpret_cast<const uint8_t*>(data.data()), data.size(),
+             digest, &digest_size));
+  return std::string(reinterpret_cast<const char*>(digest), digest_size);
+}
+
+std::string CanonicalQueryString(
+    const std::map<std::string, std::string>& query) {
+  std::map<std::string, std::string> encoded_query;
+  for (const auto& parameter : query) {
+    encoded_query[ObjectStorageClient::UriEncode(parameter.first, true)] =
+        ObjectStorageClient::UriEncode(parameter.second, true);
+  }
+  std::string canonical_query;
+  for (const auto& parameter : encoded_query) {
+    if (!canonical_query.empty())
+      canonical_query += "&";
+    canonical_query += parameter.first + "=" + parameter.second;
+  }
+  return canonical_query;
+}
+
+// Returns the host, and port if any, of |endpoint|.
+std::string GetHost(const std::string& endpoint) {
+  const size_t scheme_end = endpoint.find("://");
+  const size_t host_begin =
+      scheme_end == std::string::npos ? 0 : scheme_end + 3;
+  return endpoint.substr(host_begin,
+                         endpoint.find('/', host_begin) - host_begin);
+}
+
+size_t AppendToString(char* ptr, size_t size, size_t nmemb, void* userdata) {
+  const size_t total_size = size * nmemb;
+  static_cast<std::string*>(userdata)->append(ptr, total_size);
+  return total_size;
+}
+
+size_t ParseHeader(char* buffer, size_t size, size_t nitems, void* userdata) {
+  const size_t total_size = size * nitems;
+  const std::string header(buffer, total_size);
+  const size_t colon = header.find(':');
+  if (colon != std::string::npos) {
+    std::string value;
+    base::TrimWhitespaceASCII(header.substr(colon + 1), base::TRIM_ALL,
+                              &value);
+    (*static_cast<std::map<std::string, std::string>*>(
+        userdata))[base::ToLowerASCII(header.substr(0, colon))] = value;
+  }
+  return total_size;
+}
+
+bool IsRetriable(long status_code) {
+  return status_code == 0 || status_code == 408 || status_code == 429 ||
+         status_code >= 500;
+}
+
+}  // namespace
+
+std::unique_ptr<ObjectStorageClient> ObjectStorageClient::Create(
+    Service service,
+    const std::string& path) {
+  const size_t slash = path.find('/');
+  if (slash == 0 || slash == std::string::npos || slash + 1 == path.size()) {
+    LOG(ERROR) << "Expecting <bucket>/<key>, got " << path;
+    return nullptr;
+  }
+  const std::string bucket = path.substr(0, slash);
+  const std::string key = path.substr(slash + 1);
+
+  Credentials credentials;
+  std::string region;
+  std::string endpoint;
+  std::string canonical_uri;
+  if (service == Service::kS3) {
+    credentials.access_key_id = GetEnv("AWS_ACCESS_KEY_ID");
+    credentials.secret_access_key = GetEnv("AWS_SECRET_ACCESS_KEY");
+    credentials.session_token = GetEnv("AWS_SESSION_TOKEN");
+    region = FLAGS_s3_region;
+    if (region.empty())
+      region = GetEnv("AWS_REGION");
+    if (region.empty())
+      region = kDefaultS3Region;
+    if (FLAGS_s3_endpoint.empty()) {
+      endpoint = base::StringPrintf("https://%s.s3.%s.amazonaws.com",
+                                    bucket.c_str(), region.c_str());
+      canonical_uri = "/" + UriEncode(key, false);
+    } else {
+      endpoint = FLAGS_s3_endpoint;
+      base::TrimString(endpoint, "/", &endpoint);
+      canonical_uri =
+          "/" + UriEncode(bucket, true) + "/" + UriEncode(key, false);
+    }
+  } else {
+    credentials.access_key_id = GetEnv("GCS_HMAC_ACCESS_KEY_ID");
+    credentials.secret_access_key = GetEnv("GCS_HMAC_SECRET");
+    region = kGcsRegion;
+    endpoint = kGcsEndpoint;
+    canonical_uri = "/" + UriEncode(bucket, true) + "/" + UriEncode(key, false);
+  }
+  if (credentials.access_key_id.empty() ||
+      credentials.secret_access_key.empty()) {
+    LOG(ERROR) << "Missing object storage credentials for " << path;
+    return nullptr;
+  }
+  return std::unique_ptr<ObjectStorageClient>(new ObjectStorageClient(
+      credentials, region, endpoint, canonical_uri, key));
+}
+
+ObjectStorageClient::ObjectStorageClient(const Credentials& credentials,
+                                         const std::string& region,
+                                         const std::string& endpoint,
+                                         const std::string& canonical_uri,
+                                         const std::string& key)
+    : credentials_(credentials),
+      region_(region),
+      endpoint_(endpoint),
+      canonical_uri_(canonical_uri),
+      key_(key) {}
+
+bool ObjectStorageClient::Send(const Request& request,
+                               Response* response) const {
+  DCHECK(response);
+  for (int attempt = 0;; ++attempt) {
+    *response = Response();
+    if (SendOnce(request, response) && response->status_code >= 200 &&
+        response->status_code < 300) {
+      return true;
+    }
+    LOG(WARNING) << request.method << " " << endpoint_ << canonical_uri_
+                 << " failed with response code " << response->status_code
+                 << ": " << response->body;
+    if (!IsRetriable(response->status_code) ||
+        attempt >= FLAGS_object_storage_retries) {
+      return false;
+    }
+    base::PlatformThread::Sleep(base::TimeDelta::FromSeconds(
+        kInitialRetryDelayInSeconds << std::min(attempt, 5)));
+  }
+}
+
+bool ObjectStorageClient::SendOnce(const Request& request,
+                                   Response* response) const {
+  ScopedCurl scoped_curl(CurlHandlePool::GetInstance());
+  CURL* curl = scoped_curl.get();
+  if (!curl) {
+    LOG(ERROR) << "curl_easy_init() failed.";
+    return false;
+  }
+
+  base::Time::Exploded now;
+  base::Time::Now().UTCExplode(&now);
+  const std::string amz_date =
+      base::StringPrintf("%04d%02d%02dT%02d%02d%02dZ", now.year, now.month,
+                         now.day_of_month, now.hour, now.minute, now.second);
+  const std::string payload_hash =
+      Sha256Hex(request.body ? *request.body : std::string());
+
+  std::map<std::string, std::string> headers = request.headers;
+  headers["host"] = GetHost(endpoint_);
+  headers["x-amz-content-sha256"] = payload_hash;
+  headers["x-amz-date"] = amz_date;
+  if (!credentials_.session_token.empty())
+    headers["x-amz-security-token"] = credentials_.session_token;
+  const std::string authorization =
+      GetAuthorization(credentials_, region_, request.method, canonical_uri_,
+                       request.query, headers, payload_hash, amz_date);
+
+  ScopedCurlSlist header_list;
+  for (const auto& header : headers) {
+    // curl sets the host header itself.
+    if (header.first != "host")
+      header_list.Append((header.first + ": " + header.second).c_str());
+  }
+  header_list.Append(("Authorization: " + authorization).c_str());
+  // Do not wait for "100 Continue" before sending the body.
+  header_list.Append("Expect:");
+
+  std::string url = endpoint_ + canonical_uri_;
+  const std::string query = CanonicalQueryString(request.query);
+  if (!query.empty())
+    url += "?" + query;
+
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, kUserAgentString);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list.get());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendToString);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response->body);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, ParseHeader);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response->headers);
+  if (request.method == "HEAD") {
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+  } else {
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+    if (request.body) {
+      curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body->data());
+      curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                       static_cast<curl_off_t>(request.body->size()));
+    }
+  }
+
+  const CURLcode res = curl_easy_perform(curl);
+  if (res != CURLE_OK) {
+    LOG(WARNING) << "curl_easy_perform() failed: " << curl_easy_strerror(res);
+    return false;
+  }
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response->status_code);
+  return true;
+}
+
+std::string ObjectStorageClient::GetAuthorization(
+    const Credentials& credentials,
+    const std::string& region,
+    const std::string& method,
+    const std::string& canonical_uri,
+    const std::map<std::string, std::string>& query,
+    const std::map<std::string, std::string>& canonical_headers,
+    const std::string& payload_hash,
+    const std::string& amz_date) {
+  const std::string date = amz_date.substr(0, 8);
+  const char kService[] = "s3";
+
+  std::string headers;
+  std::string signed_headers;
+  for (const auto& header : canonical_headers) {
+    headers += header.first + ":" + header.second + "\n";
+    if (!signed_headers.empty())
+      signed_headers += ";";
+    signed_headers += header.first;
+  }
+  const std::string canonical_request =
+      method + "\n" + canonical_uri + "\n" + CanonicalQueryString(query) +
+      "\n" + headers + "\n" + signed_headers + "\n" + payload_hash;
+
+  const std::string scope = date + "/" + region + "/" + kService +
+                            "/aws4_request";
+  const std::string string_to_sign = std::string(kSigningAlgorithm) + "\n" +
+                                     amz_date + "\n" + scope + "\n" +
+                                     Sha256Hex(canonical_request);
+
+  std::string signing_key =
+      HmacSha256("AWS4" + credentials.secret_access_key, date);
+  signing_key = HmacSha256(signing_key, region);
+  signing_key = HmacSha256(signing_key, kService);
+  signing_key = HmacSha256(signing_key, "aws4_request");
+  const std::string signature = HmacSha256(signing_key, string_to_sign);
+
+  return std::string(kSigningAlgorithm) +
+         " Credential=" + credentials.access_key_id + "/" + scope +
+         ", SignedHeaders=" + signed_headers + ", Signature=" +
+         HexEncodeLower(reinterpret_cast<const uint8_t*>(signature.data()),
+                        signature.size());
+}
+
+std::string ObjectStorageClient::UriEncode(const std::string& value,
+                                           bool encode_slash) {
+  std::string encoded;
+  for (const char c : value) {
+    if (base::IsAsciiAlpha(c) || base::IsAsciiDigit(c) || c == '-' ||
+        c == '_' || c == '.' || c == '~' || (c == '/' && !encode_slash)) {
+      encoded += c;
+    } else {
+      base::StringAppendF(&encoded, "%%%02X", static_cast<uint8_t>(c));
+    }
+  }
+  return encoded;
+}
+
+}  // namespace shaka
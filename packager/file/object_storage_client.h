@@ -0,0 +1,110 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_OBJECT_STORAGE_CLIENT_H_
+#define PACKAGER_FILE_OBJECT_STORAGE_CLIENT_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace shaka {
+
+/// A minimal client of the S3 REST API, which sends requests signed with AWS
+/// Signature Version 4. Google Cloud Storage is accessed through its S3
+/// compatible XML API, with HMAC keys. The client is thread safe.
+class ObjectStorageClient {
+ public:
+  enum class Service {
+    kS3,
+    kGcs,
+  };
+
+  struct Credentials {
+    std::string access_key_id;
+    std::string secret_access_key;
+    /// Optional, for temporary credentials.
+    std::string session_token;
+  };
+
+  struct Request {
+    std::string method;
+    /// Query parameters, e.g. the upload id of multipart uploads.
+    std::map<std::string, std::string> query;
+    /// Additional headers, with lower case names.
+    std::map<std::string, std::string> headers;
+    /// Optional request body.
+    const std::string* body = nullptr;
+  };
+
+  struct Response {
+    long status_code = 0;
+    std::string body;
+    /// Response headers, with lower case names.
+    std::map<std::string, std::string> headers;
+  };
+
+  /// Create a client for the object at @a path.
+  /// @param service specifies the storage service.
+  /// @param path is the path of the object, "<bucket>/<key>", i.e. the file
+  ///        name without the s3:// or gs:// prefix.
+  /// @return the client on success, or nullptr if @a path is invalid or the
+  ///         credentials are not set.
+  static std::unique_ptr<ObjectStorageClient> Create(Service service,
+                                                     const std::string& path);
+
+  /// Send a request for the object, retrying on transient failures.
+  /// @param request specifies the request.
+  /// @param[out] response contains the last response received.
+  /// @return true if a 2xx response is received.
+  bool Send(const Request& request, Response* response) const;
+
+  /// @return the Authorization header value for a request.
+  /// @param canonical_headers contains the headers to sign, with lower case
+  ///        names. It must include "host", "x-amz-content-sha256" and
+  ///        "x-amz-date".
+  /// Exposed for testing.
+  static std::string GetAuthorization(
+      const Credentials& credentials,
+      const std::string& region,
+      const std::string& method,
+      const std::string& canonical_uri,
+      const std::map<std::string, std::string>& query,
+      const std::map<std::string, std::string>& canonical_headers,
+      const std::string& payload_hash,
+      const std::string& amz_date);
+
+  /// @return @a value URI encoded as required for signing. '/' is kept as is
+  ///         if @a encode_slash is false.
+  static std::string UriEncode(const std::string& value, bool encode_slash);
+
+  /// @return the key of the object in the bucket.
+  const std::string& key() const { return key_; }
+
+ private:
+  ObjectStorageClient(const Credentials& credentials,
+                      const std::string& region,
+                      const std::string& endpoint,
+                      const std::string& canonical_uri,
+                      const std::string& key);
+  ObjectStorageClient(const ObjectStorageClient&) = delete;
+  ObjectStorageClient& operator=(const ObjectStorageClient&) = delete;
+
+  // Send |request| once. Returns false on transport errors.
+  bool SendOnce(const Request& request, Response* response) const;
+
+  const Credentials credentials_;
+  const std::string region_;
+  // Scheme and host, e.g. "https://bucket.s3.us-east-1.amazonaws.com".
+  const std::string endpoint_;
+  // The URI encoded path of the object.
+  const std::string canonical_uri_;
+  const std::string key_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_OBJECT_STORAGE_CLIENT_H_
@@ -0,0 +1,401 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/object_storage_file.h"
+
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/location.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/worker_pool.h"
+
+DEFINE_uint64(object_storage_part_size,
+              8ULL << 20,
+              "Size of the parts of s3:// and gs:// multipart uploads, and of "
+              "the ranged reads, in bytes. Parts are at least 5 MiB.");
+DEFINE_int32(object_storage_parts_in_flight,
+             4,
+             "Maximum number of parts of an s3:// or gs:// file uploaded "
+             "concurrently, and of ranges read ahead.");
+
+namespace shaka {
+
+namespace {
+
+// The minimum size of the parts of a multipart upload, except the last one.
+const uint64_t kMinPartSize = 5ULL << 20;
+
+// Returns the text of the first |tag| element of |xml|, or an empty string.
+std::string GetXmlElement(const std::string& xml, const std::string& tag) {
+  const std::string start_tag = "<" + tag + ">";
+  const size_t begin = xml.find(start_tag);
+  if (begin == std::string::npos)
+    return "";
+  const size_t end = xml.find("</" + tag + ">", begin);
+  if (end == std::string::npos)
+    return "";
+  return xml.substr(begin + start_tag.size(),
+                    end - begin - start_tag.size());
+}
+
+}  // namespace
+
+ObjectStorageFile::ObjectStorageFile(ObjectStorageClient::Service service,
+                                     const char* path,
+                                     const char* mode)
+    : File(path),
+      path_(path),
+      mode_(mode),
+      service_(service),
+      part_size_(std::max(FLAGS_object_storage_part_size, kMinPartSize)),
+      position_(0),
+      size_(0),
+      num_parts_(0),
+      part_done_(&lock_),
+      range_done_(&lock_),
+      fetches_in_flight_(0),
+      read_ahead_ranges_(1),
+      upload_failed_(false) {}
+
+ObjectStorageFile::~ObjectStorageFile() {}
+
+bool ObjectStorageFile::Delete(ObjectStorageClient::Service service,
+                               const char* path) {
+  std::unique_ptr<ObjectStorageClient> client =
+      ObjectStorageClient::Create(service, path);
+  if (!client)
+    return false;
+  ObjectStorageClient::Request request;
+  request.method = "DELETE";
+  ObjectStorageClient::Response response;
+  return client->Send(request, &response);
+}
+
+bool ObjectStorageFile::WriteAtomically(ObjectStorageClient::Service service,
+                                        const char* path,
+                                        const std::string& contents) {
+  std::unique_ptr<ObjectStorageClient> client =
+      ObjectStorageClient::Create(service, path);
+  if (!client)
+    return false;
+  ObjectStorageClient::Request request;
+  request.method = "PUT";
+  request.body = &contents;
+  ObjectStorageClient::Response response;
+  return client->Send(request, &response);
+}
+
+bool ObjectStorageFile::Open() {
+  if (mode_ != "r" && mode_ != "w") {
+    LOG(ERROR) << "Unsupported mode " << mode_ << " for " << path_;
+    return false;
+  }
+  client_ = ObjectStorageClient::Create(service_, path_);
+  if (!client_)
+    return false;
+  if (mode_ == "w")
+    return true;
+
+  ObjectStorageClient::Request request;
+  request.method = "HEAD";
+  ObjectStorageClient::Response response;
+  if (!client_->Send(request, &response))
+    return false;
+  if (!base::StringToInt64(response.headers["content-length"], &size_)) {
+    LOG(ERROR) << "Invalid object size for " << path_;
+    return false;
+  }
+  return true;
+}
+
+bool ObjectStorageFile::Close() {
+  bool result = true;
+  if (client_ && mode_ == "w") {
+    if (upload_id_.empty()) {
+      // The object fits in a single part.
+      ObjectStorageClient::Request request;
+      request.method = "PUT";
+      request.body = &part_;
+      ObjectStorageClient::Response response;
+      result = client_->Send(request, &response);
+    } else {
+      result = (part_.empty() || SubmitPart()) && WaitForParts() &&
+               CompleteMultipartUpload();
+      if (!result)
+        AbortMultipartUpload();
+    }
+  } else {
+    // The fetches in flight use |client_|.
+    base::AutoLock auto_lock(lock_);
+    while (fetches_in_flight_ > 0)
+      range_done_.Wait();
+  }
+  delete this;
+  return result;
+}
+
+int64_t ObjectStorageFile::Read(void* buffer, uint64_t length) {
+  DCHECK_EQ(mode_, "r");
+  uint8_t* data = static_cast<uint8_t*>(buffer);
+  uint64_t bytes_read = 0;
+  while (bytes_read < length && position_ < static_cast<uint64_t>(size_)) {
+    const uint64_t index = position_ / part_size_;
+    const Range* range = GetRange(index);
+    if (!range)
+      return bytes_read > 0 ? static_cast<int64_t>(bytes_read) : -1;
+    const uint64_t offset = position_ - index * part_size_;
+    const uint64_t bytes_to_copy =
+        std::min(length - bytes_read,
+                 static_cast<uint64_t>(range->data.size() - offset));
+    memcpy(data + bytes_read, range->data.data() + offset, bytes_to_copy);
+    bytes_read += bytes_to_copy;
+    position_ += bytes_to_copy;
+  }
+  return bytes_read;
+}
+
+int64_t ObjectStorageFile::Write(const void* buffer, uint64_t length) {
+  DCHECK_EQ(mode_, "w");
+  const char* data = static_cast<const char*>(buffer);
+  uint64_t bytes_left = length;
+  while (bytes_left > 0) {
+    const uint64_t bytes_to_copy =
+        std::min(bytes_left, part_size_ - part_.size());
+    part_.append(data, bytes_to_copy);
+    data += bytes_to_copy;
+    bytes_left -= bytes_to_copy;
+    if (part_.size() == part_size_ && !SubmitPart())
+      return -1;
+  }
+  position_ += length;
+  size_ = position_;
+  return length;
+}
+
+int64_t ObjectStorageFile::Size() {
+  return size_;
+}
+
+bool ObjectStorageFile::Flush() {
+  // Parts smaller than the part size cannot be uploaded before the last one.
+  base::AutoLock auto_lock(lock_);
+  return !upload_failed_;
+}
+
+bool ObjectStorageFile::Seek(uint64_t position) {
+  if (mode_ == "w") {
+    LOG(ERROR) << "Seeking is not supported for writing to " << path_;
+    return false;
+  }
+  position_ = position;
+  return true;
+}
+
+bool ObjectStorageFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  *position = position_;
+  return true;
+}
+
+const ObjectStorageFile::Range* ObjectStorageFile::GetRange(uint64_t index) {
+  const uint64_t num_ranges = (size_ + part_size_ - 1) / part_size_;
+  const int max_read_ahead_ranges =
+      std::max(FLAGS_object_storage_parts_in_flight, 1);
+
+  base::AutoLock auto_lock(lock_);
+  auto iter = ranges_.find(index);
+  if (iter == ranges_.end()) {
+    // Seeking, so reading ahead may be wasted.
+    read_ahead_ranges_ = 1;
+  } else if (!iter->second->done) {
+    // The reader caught up with the read-ahead.
+    read_ahead_ranges_ =
+        std::min(read_ahead_ranges_ * 2, max_read_ahead_ranges);
+  }
+
+  // Drop the ranges out of the read-ahead window. The ones in flight are
+  // dropped once fetched.
+  for (iter = ranges_.begin(); iter != ranges_.end();) {
+    if (iter->second->done &&
+        (iter->first < index || iter->first > index + max_read_ahead_ranges)) {
+      iter = ranges_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  for (uint64_t i = index; i <= index + read_ahead_ranges_ && i < num_ranges;
+       ++i) {
+    if (ranges_.find(i) == ranges_.end())
+      StartFetch(i);
+  }
+
+  Range* range = ranges_[index].get();
+  while (!range->done)
+    range_done_.Wait();
+  if (!range->success) {
+    ranges_.erase(index);
+    return nullptr;
+  }
+  return range;
+}
+
+void ObjectStorageFile::StartFetch(uint64_t index) {
+  lock_.AssertAcquired();
+  std::unique_ptr<Range>& range = ranges_[index];
+  range.reset(new Range);
+  ++fetches_in_flight_;
+  // |range| is not dropped while in flight, and Close() waits for the fetches
+  // in flight.
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&ObjectStorageFile::FetchRangeTask, base::Unretained(this),
+                 index, range.get()),
+      true /* task_is_slow */);
+}
+
+void ObjectStorageFile::FetchRangeTask(uint64_t index, Range* range) {
+  const uint64_t first_position = index * part_size_;
+  const uint64_t last_position =
+      std::min(first_position + part_size_, static_cast<uint64_t>(size_)) - 1;
+  ObjectStorageClient::Request request;
+  request.method = "GET";
+  request.headers["range"] = base::StringPrintf(
+      "bytes=%" PRIu64 "-%" PRIu64, first_position, last_position);
+  ObjectStorageClient::Response response;
+  bool success = client_->Send(request, &response);
+  if (success && response.body.size() != last_position - first_position + 1) {
+    LOG(ERROR) << "Unexpected range size " << response.body.size() << " for "
+               << path_;
+    success = false;
+  }
+
+  base::AutoLock auto_lock(lock_);
+  range->data.swap(response.body);
+  range->success = success;
+  range->done = true;
+  --fetches_in_flight_;
+  range_done_.Broadcast();
+}
+
+bool ObjectStorageFile::SubmitPart() {
+  if (upload_id_.empty()) {
+    ObjectStorageClient::Request request;
+    request.method = "POST";
+    request.query["uploads"] = "";
+    ObjectStorageClient::Response response;
+    if (!client_->Send(request, &response))
+      return false;
+    upload_id_ = GetXmlElement(response.body, "UploadId");
+    if (upload_id_.empty()) {
+      LOG(ERROR) << "Failed to start the multipart upload of " << path_ << ": "
+                 << response.body;
+      return false;
+    }
+  }
+
+  const int part_number = ++num_parts_;
+  {
+    base::AutoLock auto_lock(lock_);
+    while (!upload_failed_ && static_cast<int>(parts_in_flight_.size()) >=
+                                  FLAGS_object_storage_parts_in_flight) {
+      part_done_.Wait();
+    }
+    if (upload_failed_)
+      return false;
+    parts_in_flight_[part_number].swap(part_);
+    etags_.resize(part_number);
+  }
+  part_.clear();
+  part_.reserve(part_size_);
+
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&ObjectStorageFile::UploadPartTask, base::Unretained(this),
+                 part_number),
+      true /* task_is_slow */);
+  return true;
+}
+
+void ObjectStorageFile::UploadPartTask(int part_number) {
+  ObjectStorageClient::Request request;
+  request.method = "PUT";
+  request.query["partNumber"] = base::IntToString(part_number);
+  request.query["uploadId"] = upload_id_;
+  {
+    base::AutoLock auto_lock(lock_);
+    // References to map elements stay valid while other parts are added.
+    request.body = &parts_in_flight_[part_number];
+  }
+  ObjectStorageClient::Response response;
+  const bool success = client_->Send(request, &response);
+  const std::string etag = response.headers["etag"];
+
+  base::AutoLock auto_lock(lock_);
+  if (!success || etag.empty()) {
+    LOG(ERROR) << "Failed to upload part " << part_number << " of " << path_;
+    upload_failed_ = true;
+  } else {
+    etags_[part_number - 1] = etag;
+  }
+  parts_in_flight_.erase(part_number);
+  part_done_.Broadcast();
+}
+
+bool ObjectStorageFile::WaitForParts() {
+  base::AutoLock auto_lock(lock_);
+  while (!parts_in_flight_.empty())
+    part_done_.Wait();
+  return !upload_failed_;
+}
+
+bool ObjectStorageFile::CompleteMultipartUpload() {
+  std::string body = "<CompleteMultipartUpload>";
+  for (size_t i = 0; i < etags_.size(); ++i) {
+    base::StringAppendF(&body,
+                        "<Part><PartNumber>%zu</PartNumber>"
+                        "<ETag>%s</ETag></Part>",
+                        i + 1, etags_[i].c_str());
+  }
+  body += "</CompleteMultipartUpload>";
+
+  ObjectStorageClient::Request request;
+  request.method = "POST";
+  request.query["uploadId"] = upload_id_;
+  request.headers["content-type"] = "application/xml";
+  request.body = &body;
+  ObjectStorageClient::Response response;
+  if (!client_->Send(request, &response))
+    return false;
+  // Errors may be reported in the body of a successful response.
+  if (response.body.find("<Error>") != std::string::npos) {
+    LOG(ERROR) << "Failed to complete the multipart upload of " << path_
+               << ": " << response.body;
+    return false;
+  }
+  return true;
+}
+
+void ObjectStorageFile::AbortMultipartUpload() {
+  // Wait for the parts in flight, if any, so they are not left behind.
+  WaitForParts();
+  ObjectStorageClient::Request request;
+  request.method = "DELETE";
+  request.query["uploadId"] = upload_id_;
+  ObjectStorageClient::Response response;
+  if (!client_->Send(request, &response))
+    LOG(WARNING) << "Failed to abort the multipart upload of " << path_;
+}
+
+}  // namespace shaka
@@ -0,0 +1,138 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_OBJECT_STORAGE_FILE_H_
+#define PACKAGER_FILE_OBJECT_STORAGE_FILE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/file.h"
+#include "packager/file/object_storage_client.h"
+
+namespace shaka {
+
+/// ObjectStorageFile reads and writes objects of S3 (s3://) and Google Cloud
+/// Storage (gs://) buckets directly, without a local copy.
+///
+/// In write mode, "w", the data is uploaded with a multipart upload as it is
+/// written, with up to --object_storage_parts_in_flight parts of
+/// --object_storage_part_size bytes uploaded concurrently. Objects smaller
+/// than a part are uploaded with a single request. Seeking is not supported.
+///
+/// In read mode, "r", the object is read with ranged GET requests of
+/// --object_storage_part_size bytes, so parsers can seek within large objects
+/// without downloading them whole. The ranges following the one being read
+/// are fetched ahead on worker threads. The read-ahead starts at one range
+/// after a seek and doubles, up to --object_storage_parts_in_flight ranges,
+/// whenever the reader catches up with a range still being fetched.
+class ObjectStorageFile : public File {
+ public:
+  /// @param service specifies the storage service.
+  /// @param path is "<bucket>/<key>".
+  /// @param mode is the file access mode, "r" or "w".
+  ObjectStorageFile(ObjectStorageClient::Service service,
+                    const char* path,
+                    const char* mode);
+
+  /// Delete an object.
+  /// @return true if successful, or false otherwise.
+  static bool Delete(ObjectStorageClient::Service service, const char* path);
+
+  /// Upload @a contents as an object. Objects are always replaced atomically.
+  /// @return true if successful, or false otherwise.
+  static bool WriteAtomically(ObjectStorageClient::Service service,
+                              const char* path,
+                              const std::string& contents);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~ObjectStorageFile() override;
+
+  bool Open() override;
+
+ private:
+  ObjectStorageFile(const ObjectStorageFile&) = delete;
+  ObjectStorageFile& operator=(const ObjectStorageFile&) = delete;
+
+  // A range of --object_storage_part_size bytes of the object.
+  struct Range {
+    std::string data;
+    // The following are protected by |lock_|.
+    bool done = false;
+    bool success = false;
+  };
+
+  // Return range |index|, fetching it and the ranges ahead of it as needed.
+  // Blocks until range |index| is fetched. The range stays valid until the
+  // next call.
+  // @return The range, or nullptr if it cannot be fetched.
+  const Range* GetRange(uint64_t index);
+  // Start fetching range |index|. |lock_| must be held.
+  void StartFetch(uint64_t index);
+  // Fetch range |index| into |range|, which runs on a worker thread.
+  void FetchRangeTask(uint64_t index, Range* range);
+
+  // Upload |part_| as the next part, starting the multipart upload if needed.
+  // Blocks if too many parts are in flight.
+  bool SubmitPart();
+  // Upload |part_number|, which runs on a worker thread.
+  void UploadPartTask(int part_number);
+  bool WaitForParts();
+  bool CompleteMultipartUpload();
+  void AbortMultipartUpload();
+
+  const std::string path_;
+  const std::string mode_;
+  const ObjectStorageClient::Service service_;
+  const uint64_t part_size_;
+  std::unique_ptr<ObjectStorageClient> client_;
+  uint64_t position_;
+  int64_t size_;
+
+  // Write mode.
+  // The data of the part being written.
+  std::string part_;
+  std::string upload_id_;
+  int num_parts_;
+
+  base::Lock lock_;
+  // Signaled when a part upload completes.
+  base::ConditionVariable part_done_;
+  // Signaled when a range fetch completes.
+  base::ConditionVariable range_done_;
+  // The following are protected by |lock_|.
+  // Read mode.
+  // The ranges fetched or being fetched, by index.
+  std::map<uint64_t, std::unique_ptr<Range>> ranges_;
+  int fetches_in_flight_;
+  // The number of ranges currently fetched ahead of the one being read.
+  int read_ahead_ranges_;
+  // Write mode.
+  // The data of the parts being uploaded, by part number.
+  std::map<int, std::string> parts_in_flight_;
+  // The ETags of the uploaded parts, with part number N at index N - 1.
+  std::vector<std::string> etags_;
+  bool upload_failed_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_OBJECT_STORAGE_FILE_H_
@@ -7,10 +7,31 @@
 #ifndef PACKAGER_FILE_PUBLIC_BUFFER_CALLBACK_PARAMS_H_
 #define PACKAGER_FILE_PUBLIC_BUFFER_CALLBACK_PARAMS_H_
 
+#include <stdint.h>
+
 #include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace shaka {
 
+/// A reference counted buffer, which may be kept after the call it is passed
+/// to returns.
+typedef std::shared_ptr<const std::vector<uint8_t>> SharedBuffer;
+
+/// Information passed along with the buffers handed off to
+/// @a BufferCallbackParams.shared_write_func.
+struct SharedBufferInfo {
+  /// Position of the buffer in the output, i.e. the number of bytes handed off
+  /// since the output was opened.
+  uint64_t offset = 0;
+  /// True when the output is closed, in which case the buffer is null. Media
+  /// segments are written to an output opened for the segment, so this marks
+  /// the end of a segment.
+  bool is_last = false;
+};
+
 /// Buffer callback params.
 struct BufferCallbackParams {
   /// If this function is specified, packager treats @a StreamDescriptor.input
@@ -28,6 +49,17 @@ struct BufferCallbackParams {
   std::function<
       int64_t(const std::string& name, const void* buffer, uint64_t size)>
       write_func;
+  /// Zero copy variant of @a write_func. If this function is specified, it is
+  /// called instead of @a write_func with buffers whose ownership is shared
+  /// with the application, which may keep them, e.g. to hand them to its
+  /// network stack, instead of copying the data. The muxers hand their
+  /// segment buffers off as is; other writes are copied into a new buffer.
+  /// It is called one last time with a null buffer when the output is closed.
+  /// It should return the size of the buffer, or a negative value on error.
+  std::function<int64_t(const std::string& name,
+                        SharedBuffer buffer,
+                        const SharedBufferInfo& info)>
+      shared_write_func;
 };
 
 }  // namespace shaka
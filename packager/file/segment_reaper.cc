@@ -0,0 +1,109 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/segment_reaper.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/logging.h"
+#include "packager/file/file.h"
+#include "packager/file/io_executor.h"
+
+namespace shaka {
+namespace {
+
+// Number of attempts to delete a file before giving up.
+const int kMaxAttempts = 3;
+// Number of deleted files remembered, so that the files referenced by several
+// manifests are deleted once. The manifests slide their windows in lockstep,
+// so a few segments per stream are enough.
+const size_t kMaxDeletedFiles = 1024;
+
+}  // namespace
+
+SegmentReaper::SegmentReaper(IoExecutor* executor)
+    : executor_(executor), batch_done_(&lock_) {
+  DCHECK(executor_);
+}
+
+SegmentReaper::~SegmentReaper() {
+  Flush();
+}
+
+SegmentReaper* SegmentReaper::GetInstance() {
+  // Leaked, like the executor it posts to.
+  static SegmentReaper* segment_reaper =
+      new SegmentReaper(IoExecutor::GetInstance());
+  return segment_reaper;
+}
+
+void SegmentReaper::Delete(const std::string& file_name) {
+  base::AutoLock auto_lock(lock_);
+  if (!known_files_.insert(file_name).second)
+    return;
+  pending_deletes_.push_back({file_name, 0});
+  if (!batch_posted_)
+    PostBatch();
+}
+
+void SegmentReaper::Flush() {
+  base::AutoLock auto_lock(lock_);
+  // A batch is posted as long as there are pending deletes.
+  while (batch_posted_)
+    batch_done_.Wait();
+}
+
+void SegmentReaper::PostBatch() {
+  DCHECK(!batch_posted_);
+  // The failed deletes are retried first, in the order they were requested.
+  pending_deletes_.insert(pending_deletes_.begin(), failed_deletes_.begin(),
+                          failed_deletes_.end());
+  failed_deletes_.clear();
+  batch_posted_ = true;
+  executor_->PostTask(
+      base::Bind(&SegmentReaper::RunBatch, base::Unretained(this)));
+}
+
+void SegmentReaper::RunBatch() {
+  std::vector<PendingDelete> batch;
+  {
+    base::AutoLock auto_lock(lock_);
+    batch.swap(pending_deletes_);
+  }
+
+  std::vector<bool> deleted(batch.size());
+  for (size_t i = 0; i < batch.size(); ++i) {
+    VLOG(2) << "Deleting " << batch[i].file_name;
+    deleted[i] = File::Delete(batch[i].file_name.c_str());
+  }
+
+  base::AutoLock auto_lock(lock_);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    PendingDelete& pending_delete = batch[i];
+    if (deleted[i]) {
+      deleted_files_.push_back(pending_delete.file_name);
+      if (deleted_files_.size() > kMaxDeletedFiles) {
+        known_files_.erase(deleted_files_.front());
+        deleted_files_.pop_front();
+      }
+    } else if (++pending_delete.attempts < kMaxAttempts) {
+      LOG(WARNING) << "Failed to delete " << pending_delete.file_name
+                   << "; Will retry later.";
+      failed_deletes_.push_back(pending_delete);
+    } else {
+      LOG(WARNING) << "Failed to delete " << pending_delete.file_name
+                   << " after " << kMaxAttempts << " attempts.";
+      known_files_.erase(pending_delete.file_name);
+    }
+  }
+  // The deletes requested meanwhile go in the next batch.
+  batch_posted_ = false;
+  if (!pending_deletes_.empty())
+    PostBatch();
+  batch_done_.Broadcast();
+}
+
+}  // namespace shaka
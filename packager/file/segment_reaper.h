@@ -0,0 +1,80 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_SEGMENT_REAPER_H_
+#define PACKAGER_FILE_SEGMENT_REAPER_H_
+
+#include <deque>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+class IoExecutor;
+
+/// Deletes the segments which fell out of the live window in the background,
+/// so the deletes, which may be slow on network file systems, do not hold up
+/// the manifest updates. The deletes requested while a batch is running are
+/// done in the next batch, on the IoExecutor, and the failed ones are retried
+/// with the next batch. A segment referenced by several manifests, e.g. both
+/// HLS and DASH, is deleted once.
+/// This class is thread safe.
+class SegmentReaper {
+ public:
+  /// @param executor runs the batches of deletes. It must outlive the reaper.
+  explicit SegmentReaper(IoExecutor* executor);
+
+  /// Waits for the batch in progress, if any.
+  ~SegmentReaper();
+
+  /// @return the process wide reaper shared by the manifest notifiers.
+  static SegmentReaper* GetInstance();
+
+  /// Request the deletion of @a file_name. It is ignored if the file is
+  /// already pending deletion, or was recently deleted.
+  void Delete(const std::string& file_name);
+
+  /// Wait until the deletes requested so far have been attempted.
+  void Flush();
+
+ private:
+  SegmentReaper(const SegmentReaper&) = delete;
+  SegmentReaper& operator=(const SegmentReaper&) = delete;
+
+  struct PendingDelete {
+    std::string file_name;
+    int attempts;
+  };
+
+  // Post a batch with the pending deletes. |lock_| must be held.
+  void PostBatch();
+  // Delete the files of a batch.
+  void RunBatch();
+
+  IoExecutor* const executor_;
+
+  base::Lock lock_;
+  // Signaled when a batch is done.
+  base::ConditionVariable batch_done_;
+  // The following are protected by |lock_|.
+  bool batch_posted_ = false;
+  std::vector<PendingDelete> pending_deletes_;
+  // The failed deletes, retried with the next batch.
+  std::vector<PendingDelete> failed_deletes_;
+  // The files pending deletion or recently deleted, so each one is deleted
+  // once.
+  std::unordered_set<std::string> known_files_;
+  // The files recently deleted, oldest first.
+  std::deque<std::string> deleted_files_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_SEGMENT_REAPER_H_
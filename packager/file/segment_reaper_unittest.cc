@@ -0,0 +1,68 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/segment_reaper.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/base/strings/stringprintf.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/io_executor.h"
+
+namespace shaka {
+
+namespace {
+
+const char kSegmentTemplate[] = "memory://segment_reaper/%d.mp4";
+
+bool FileExists(const std::string& file_name) {
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name.c_str(), "r"));
+  return file != nullptr;
+}
+
+}  // namespace
+
+class SegmentReaperTest : public testing::Test {
+ protected:
+  SegmentReaperTest()
+      : executor_(1, "SegmentReaperTest"), segment_reaper_(&executor_) {}
+
+  IoExecutor executor_;
+  SegmentReaper segment_reaper_;
+};
+
+TEST_F(SegmentReaperTest, DeletesSegments) {
+  for (int i = 0; i < 10; ++i) {
+    const std::string segment = base::StringPrintf(kSegmentTemplate, i);
+    ASSERT_TRUE(File::WriteStringToFile(segment.c_str(), "segment"));
+    segment_reaper_.Delete(segment);
+  }
+  segment_reaper_.Flush();
+  for (int i = 0; i < 10; ++i)
+    EXPECT_FALSE(FileExists(base::StringPrintf(kSegmentTemplate, i)));
+}
+
+TEST_F(SegmentReaperTest, DeletesSegmentOnce) {
+  const std::string segment = base::StringPrintf(kSegmentTemplate, 0);
+  ASSERT_TRUE(File::WriteStringToFile(segment.c_str(), "segment"));
+  segment_reaper_.Delete(segment);
+  segment_reaper_.Flush();
+  EXPECT_FALSE(FileExists(segment));
+
+  // A second manifest referencing the same segment asks for its deletion
+  // again, which is ignored.
+  ASSERT_TRUE(File::WriteStringToFile(segment.c_str(), "segment"));
+  segment_reaper_.Delete(segment);
+  segment_reaper_.Flush();
+  EXPECT_TRUE(FileExists(segment));
+  File::Delete(segment.c_str());
+}
+
+}  // namespace shaka
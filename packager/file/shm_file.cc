@@ -0,0 +1,327 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/shm_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_piece.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/threading/platform_thread.h"
+
+namespace shaka {
+
+namespace {
+
+// The positions are shared with another process, so the atomics must not rely
+// on a lock of this process.
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "The shared memory ring needs lock free atomics.");
+static_assert(sizeof(ShmRingHeader) <= kShmRingDataOffset,
+              "The ring header overlaps the ring data.");
+
+// Number of waits which yield the processor before sleeping.
+const int kNumYields = 64;
+const int64_t kMinSleepUs = 50;
+const int64_t kMaxSleepUs = 1000;
+
+// Returns the name of the shared memory object of |file_name|, i.e. with a
+// leading slash and without the options.
+std::string GetShmName(base::StringPiece file_name) {
+  return "/" + file_name.substr(0, file_name.find('?')).as_string();
+}
+
+}  // namespace
+
+ShmFile::ShmFile(const char* file_name, const char* mode)
+    : File(file_name), is_writer_(strcmp(mode, "r") != 0) {}
+
+ShmFile::~ShmFile() {}
+
+bool ShmFile::Delete(const char* file_name) {
+  return shm_unlink(GetShmName(file_name).c_str()) == 0;
+}
+
+bool ShmFile::Close() {
+  if (header_) {
+    // Every write is already published.
+    if (is_writer_)
+      header_->end_of_stream.store(1, std::memory_order_release);
+    munmap(header_, mapped_size_);
+    header_ = nullptr;
+  }
+  delete this;
+  return true;
+}
+
+int64_t ShmFile::Read(void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  if (!header_ || is_writer_)
+    return -1;
+
+  int num_waits = 0;
+  base::TimeTicks idle_since;
+  while (true) {
+    const uint64_t write_position =
+        header_->write_position.load(std::memory_order_acquire);
+    if (write_position != position_) {
+      if (write_position - position_ > capacity_) {
+        LOG(ERROR) << "Invalid write position " << write_position << " of "
+                   << file_name() << ", at read position " << position_;
+        return -1;
+      }
+      const uint64_t size = std::min(length, write_position - position_);
+      const uint64_t offset = position_ % capacity_;
+      const uint64_t first_part = std::min(size, capacity_ - offset);
+      memcpy(buffer, data_ + offset, first_part);
+      memcpy(static_cast<uint8_t*>(buffer) + first_part, data_,
+             size - first_part);
+      position_ += size;
+      header_->read_position.store(position_, std::memory_order_release);
+      return size;
+    }
+    // |end_of_stream| is set after the last write position is published.
+    if (header_->end_of_stream.load(std::memory_order_acquire) &&
+        header_->write_position.load(std::memory_order_acquire) == position_) {
+      return 0;
+    }
+    const uint32_t producer_generation =
+        header_->producer_generation.load(std::memory_order_relaxed);
+    if (producer_generation != producer_generation_) {
+      LOG(WARNING) << "The producer of " << file_name()
+                   << " restarted, some data may be lost.";
+      producer_generation_ = producer_generation;
+    }
+    if (!WaitForOtherEnd(&num_waits, &idle_since)) {
+      LOG(ERROR) << "Timed out reading " << file_name();
+      return -1;
+    }
+  }
+}
+
+int64_t ShmFile::Write(const void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  if (!header_ || !is_writer_)
+    return -1;
+
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_written = 0;
+  int num_waits = 0;
+  base::TimeTicks idle_since;
+  while (bytes_written < length) {
+    const uint64_t read_position = std::min(
+        header_->read_position.load(std::memory_order_acquire), position_);
+    const uint64_t room = capacity_ - (position_ - read_position);
+    if (room == 0) {
+      if (!WaitForOtherEnd(&num_waits, &idle_since)) {
+        LOG(ERROR) << "Timed out writing " << file_name();
+        return bytes_written > 0 ? bytes_written : -1;
+      }
+      continue;
+    }
+    num_waits = 0;
+
+    const uint64_t size = std::min(room, length - bytes_written);
+    const uint64_t offset = position_ % capacity_;
+    const uint64_t first_part = std::min(size, capacity_ - offset);
+    memcpy(data_ + offset, data + bytes_written, first_part);
+    memcpy(data_, data + bytes_written + first_part, size - first_part);
+    position_ += size;
+    bytes_written += size;
+    header_->write_position.store(position_, std::memory_order_release);
+  }
+  return bytes_written;
+}
+
+int64_t ShmFile::Size() {
+  if (!header_)
+    return -1;
+  return std::numeric_limits<int64_t>::max();
+}
+
+bool ShmFile::Flush() {
+  // The writes are published as soon as they are copied.
+  return header_ != nullptr;
+}
+
+bool ShmFile::Seek(uint64_t position) {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+bool ShmFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  if (!header_)
+    return false;
+  *position = position_;
+  return true;
+}
+
+bool ShmFile::Open() {
+  const std::string file_name_with_options = file_name();
+  const size_t question_mark_pos = file_name_with_options.find('?');
+  if (question_mark_pos != std::string::npos) {
+    base::StringPairs pairs;
+    if (!base::SplitStringIntoKeyValuePairs(
+            file_name_with_options.substr(question_mark_pos + 1), '=', '&',
+            &pairs)) {
+      LOG(ERROR) << "Invalid shm options in " << file_name_with_options;
+      return false;
+    }
+    for (const auto& pair : pairs) {
+      uint64_t* value = nullptr;
+      if (pair.first == "size") {
+        value = &ring_size_;
+      } else if (pair.first == "timeout") {
+        value = &timeout_us_;
+      } else {
+        LOG(ERROR) << "Unknown shm option " << pair.first;
+        return false;
+      }
+      if (!base::StringToUint64(pair.second, value)) {
+        LOG(ERROR) << "Invalid shm option for " << pair.first << " field "
+                   << pair.second;
+        return false;
+      }
+    }
+  }
+  if (ring_size_ == 0) {
+    LOG(ERROR) << "Invalid shm ring size 0 for " << file_name_with_options;
+    return false;
+  }
+  shm_name_ = GetShmName(file_name_with_options);
+
+  // The consumer may start before the producer, so it waits for the object to
+  // be created and initialized.
+  int num_waits = 0;
+  base::TimeTicks idle_since;
+  int fd = -1;
+  struct stat stat_buffer;
+  while (true) {
+    if (fd < 0) {
+      fd = shm_open(shm_name_.c_str(), is_writer_ ? O_RDWR | O_CREAT : O_RDWR,
+                    0600);
+    }
+    if (fd < 0 && (is_writer_ || errno != ENOENT)) {
+      LOG(ERROR) << "Failed to open shared memory " << shm_name_ << ", errno "
+                 << errno;
+      return false;
+    }
+    if (fd >= 0) {
+      if (fstat(fd, &stat_buffer) != 0) {
+        LOG(ERROR) << "Failed to stat shared memory " << shm_name_
+                   << ", errno " << errno;
+        close(fd);
+        return false;
+      }
+      if (static_cast<uint64_t>(stat_buffer.st_size) > kShmRingDataOffset)
+        break;
+      if (is_writer_) {
+        stat_buffer.st_size = kShmRingDataOffset + ring_size_;
+        if (ftruncate(fd, stat_buffer.st_size) != 0) {
+          LOG(ERROR) << "Failed to size shared memory " << shm_name_
+                     << ", errno " << errno;
+          close(fd);
+          return false;
+        }
+        break;
+      }
+    }
+    if (!WaitForOtherEnd(&num_waits, &idle_since)) {
+      LOG(ERROR) << "Timed out waiting for the producer of " << shm_name_;
+      if (fd >= 0)
+        close(fd);
+      return false;
+    }
+  }
+
+  mapped_size_ = stat_buffer.st_size;
+  void* address =
+      mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map shared memory " << shm_name_ << ", errno "
+               << errno;
+    return false;
+  }
+  header_ = static_cast<ShmRingHeader*>(address);
+  data_ = static_cast<uint8_t*>(address) + kShmRingDataOffset;
+
+  if (is_writer_ &&
+      header_->magic.load(std::memory_order_acquire) != kShmRingMagic) {
+    header_->version = kShmRingVersion;
+    header_->capacity = mapped_size_ - kShmRingDataOffset;
+    header_->write_position.store(0, std::memory_order_relaxed);
+    header_->producer_generation.store(0, std::memory_order_relaxed);
+    header_->end_of_stream.store(0, std::memory_order_relaxed);
+    header_->read_position.store(0, std::memory_order_relaxed);
+    header_->magic.store(kShmRingMagic, std::memory_order_release);
+  }
+  while (header_->magic.load(std::memory_order_acquire) != kShmRingMagic) {
+    if (!WaitForOtherEnd(&num_waits, &idle_since)) {
+      LOG(ERROR) << "Timed out waiting for the producer of " << shm_name_;
+      return false;
+    }
+  }
+  capacity_ = header_->capacity;
+  if (header_->version != kShmRingVersion || capacity_ == 0 ||
+      capacity_ > mapped_size_ - kShmRingDataOffset) {
+    LOG(ERROR) << "Shared memory " << shm_name_ << " is not a version "
+               << kShmRingVersion << " ring.";
+    return false;
+  }
+
+  if (is_writer_) {
+    if (capacity_ != ring_size_) {
+      LOG(WARNING) << "Reusing shared memory " << shm_name_ << " of "
+                   << capacity_ << " bytes.";
+    }
+    // Restarting: continue after the data published before.
+    header_->producer_generation.fetch_add(1, std::memory_order_relaxed);
+    header_->end_of_stream.store(0, std::memory_order_release);
+    position_ = header_->write_position.load(std::memory_order_relaxed);
+  } else {
+    producer_generation_ =
+        header_->producer_generation.load(std::memory_order_relaxed);
+    // Restarting: resume after the data read before.
+    position_ = std::min(
+        header_->read_position.load(std::memory_order_acquire),
+        header_->write_position.load(std::memory_order_acquire));
+  }
+  return true;
+}
+
+bool ShmFile::WaitForOtherEnd(int* num_waits, base::TimeTicks* idle_since) {
+  if (*num_waits == 0) {
+    *idle_since = base::TimeTicks::Now();
+  } else if (timeout_us_ > 0 &&
+             static_cast<uint64_t>(
+                 (base::TimeTicks::Now() - *idle_since).InMicroseconds()) >=
+                 timeout_us_) {
+    return false;
+  }
+  if (*num_waits < kNumYields) {
+    base::PlatformThread::YieldCurrentThread();
+  } else {
+    const int doublings = std::min(*num_waits - kNumYields, 5);
+    base::PlatformThread::Sleep(base::TimeDelta::FromMicroseconds(
+        std::min(kMaxSleepUs, kMinSleepUs << doublings)));
+  }
+  ++*num_waits;
+  return true;
+}
+
+}  // namespace shaka
@@ -0,0 +1,127 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_SHM_FILE_H_
+#define PACKAGER_FILE_SHM_FILE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "packager/base/compiler_specific.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// Header of a shared memory ring, at the start of the POSIX shared memory
+/// object. The ring data starts at kShmRingDataOffset and is |capacity| bytes
+/// long.
+///
+/// The ring has a single producer and a single consumer, which exchange bytes
+/// without locks nor system calls:
+///   - The positions are the numbers of bytes written and read since the ring
+///     was created. They only grow; the byte at position p is at offset
+///     p % capacity of the data.
+///   - The producer copies its data at |write_position|, up to
+///     |read_position| + |capacity|, then publishes it by storing the new
+///     |write_position| with release semantics. When the ring is full, it
+///     waits for the consumer to make room, or drops the data if it must not
+///     block.
+///   - The consumer copies the data between |read_position| and
+///     |write_position|, loaded with acquire semantics, then releases it by
+///     storing the new |read_position| with release semantics.
+///   - The producer creates the object, sets |version| and |capacity|, then
+///     stores |magic| with release semantics. A producer restarting after a
+///     crash reuses the existing object, without unlinking it nor changing
+///     its capacity, increments |producer_generation| and continues at
+///     |write_position|. The data it did not publish before the crash is lost.
+///   - A consumer restarting after a crash resumes at |read_position|.
+///   - The producer sets |end_of_stream| once all its data is published.
+struct ShmRingHeader {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint64_t capacity;
+  // Written by the producer.
+  alignas(64) std::atomic<uint64_t> write_position;
+  std::atomic<uint32_t> producer_generation;
+  std::atomic<uint32_t> end_of_stream;
+  // Written by the consumer, on a cache line of its own.
+  alignas(64) std::atomic<uint64_t> read_position;
+};
+
+/// ShmRingHeader::magic, "SHKR".
+const uint32_t kShmRingMagic = 0x524b4853;
+/// ShmRingHeader::version.
+const uint32_t kShmRingVersion = 1;
+/// Offset of the ring data in the shared memory object.
+const uint64_t kShmRingDataOffset = 4096;
+
+/// ShmFile exchanges a byte stream through a shared memory ring, see
+/// ShmRingHeader, between processes on the same host, e.g. an encoder and the
+/// packager. It is of the form shm://<name>[?<option>[&<option>]...], where
+/// <name> is the name of the POSIX shared memory object, without the leading
+/// slash. The options are:
+///   - size=<bytes>, the capacity of the ring created by a writer, 4 MiB by
+///     default.
+///   - timeout=<microseconds>, after which a read or a write waiting for the
+///     other end fails. 0, the default, waits indefinitely.
+///
+/// The "r" mode is the consumer and the "w" mode is the producer. Reads and
+/// writes only copy from or to the mapped ring while data or room is
+/// available; they spin, then sleep, while waiting for the other end.
+class ShmFile : public File {
+ public:
+  /// @param file_name is the shared memory object name, with options.
+  /// @param mode is the file access mode, "r" or "w".
+  ShmFile(const char* file_name, const char* mode);
+
+  /// Unlink a shared memory object.
+  /// @param file_name is the shared memory object name, with options.
+  static bool Delete(const char* file_name);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~ShmFile() override;
+
+  bool Open() override;
+
+ private:
+  // Wait a little for the other end, which has not made progress in
+  // |*num_waits| previous waits since |*idle_since|. Returns false once the
+  // timeout has expired.
+  bool WaitForOtherEnd(int* num_waits, base::TimeTicks* idle_since);
+
+  std::string shm_name_;
+  const bool is_writer_;
+  uint64_t ring_size_ = 4 * 1024 * 1024;
+  uint64_t timeout_us_ = 0;
+
+  ShmRingHeader* header_ = nullptr;
+  uint8_t* data_ = nullptr;
+  uint64_t mapped_size_ = 0;
+  uint64_t capacity_ = 0;
+  // The position of this end of the ring.
+  uint64_t position_ = 0;
+  uint32_t producer_generation_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(ShmFile);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_SHM_FILE_H_
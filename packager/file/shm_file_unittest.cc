@@ -0,0 +1,141 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/shm_file.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+class ShmFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    name_ = "shaka_shm_file_test_" + std::to_string(getpid()) + "_" +
+            testing::UnitTest::GetInstance()->current_test_info()->name();
+  }
+
+  void TearDown() override { File::Delete(GetFileName("").c_str()); }
+
+  std::string GetFileName(const std::string& options) {
+    return std::string(kShmFilePrefix) + name_ + options;
+  }
+
+  std::string name_;
+};
+
+TEST_F(ShmFileTest, WriteThenRead) {
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open(GetFileName("").c_str(), "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(3, writer->Write("abc", 3));
+  ASSERT_TRUE(writer.release()->Close());
+
+  std::unique_ptr<File, FileCloser> reader(
+      File::Open(GetFileName("").c_str(), "r"));
+  ASSERT_TRUE(reader);
+  char buffer[8];
+  ASSERT_EQ(3, reader->Read(buffer, sizeof(buffer)));
+  EXPECT_EQ("abc", std::string(buffer, 3));
+  // The writer is closed.
+  EXPECT_EQ(0, reader->Read(buffer, sizeof(buffer)));
+}
+
+TEST_F(ShmFileTest, WrapsAroundWithBackpressure) {
+  const size_t kRingSize = 64;
+  const size_t kDataSize = 10000;
+  std::vector<uint8_t> data(kDataSize);
+  for (size_t i = 0; i < kDataSize; ++i)
+    data[i] = static_cast<uint8_t>(i * 7);
+
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open(GetFileName("?size=" + std::to_string(kRingSize)).c_str(),
+                 "w"));
+  ASSERT_TRUE(writer);
+  std::unique_ptr<File, FileCloser> reader(
+      File::Open(GetFileName("").c_str(), "r"));
+  ASSERT_TRUE(reader);
+
+  int64_t bytes_written = 0;
+  std::thread producer([&writer, &data, &bytes_written]() {
+    // Blocks while the ring is full.
+    bytes_written = writer->Write(data.data(), data.size());
+    writer.release()->Close();
+  });
+
+  std::vector<uint8_t> read_data;
+  uint8_t buffer[100];
+  int64_t size = 0;
+  while ((size = reader->Read(buffer, sizeof(buffer))) > 0) {
+    EXPECT_LE(size, static_cast<int64_t>(kRingSize));
+    read_data.insert(read_data.end(), buffer, buffer + size);
+  }
+  producer.join();
+
+  EXPECT_EQ(0, size);
+  EXPECT_EQ(static_cast<int64_t>(kDataSize), bytes_written);
+  EXPECT_EQ(data, read_data);
+}
+
+TEST_F(ShmFileTest, WriteTimesOutWhenFull) {
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open(GetFileName("?size=4&timeout=1000").c_str(), "w"));
+  ASSERT_TRUE(writer);
+  EXPECT_EQ(4, writer->Write("abcdef", 6));
+  EXPECT_EQ(-1, writer->Write("gh", 2));
+}
+
+TEST_F(ShmFileTest, ReadTimesOutWhenEmpty) {
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open(GetFileName("").c_str(), "w"));
+  ASSERT_TRUE(writer);
+  std::unique_ptr<File, FileCloser> reader(
+      File::Open(GetFileName("?timeout=1000").c_str(), "r"));
+  ASSERT_TRUE(reader);
+  char buffer[8];
+  EXPECT_EQ(-1, reader->Read(buffer, sizeof(buffer)));
+}
+
+TEST_F(ShmFileTest, OpenTimesOutWithoutProducer) {
+  EXPECT_FALSE(File::Open(GetFileName("?timeout=1000").c_str(), "r"));
+}
+
+TEST_F(ShmFileTest, RestartedEndsResume) {
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open(GetFileName("").c_str(), "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(3, writer->Write("abc", 3));
+  std::unique_ptr<File, FileCloser> reader(
+      File::Open(GetFileName("").c_str(), "r"));
+  ASSERT_TRUE(reader);
+  char buffer[8];
+  ASSERT_EQ(1, reader->Read(buffer, 1));
+  EXPECT_EQ('a', buffer[0]);
+
+  // The restarted reader resumes after the data read before.
+  reader.reset(File::Open(GetFileName("").c_str(), "r"));
+  ASSERT_TRUE(reader);
+  ASSERT_EQ(2, reader->Read(buffer, sizeof(buffer)));
+  EXPECT_EQ("bc", std::string(buffer, 2));
+
+  // The restarted writer continues after the data written before.
+  writer.reset(File::Open(GetFileName("").c_str(), "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(2, writer->Write("de", 2));
+  ASSERT_TRUE(writer.release()->Close());
+  ASSERT_EQ(2, reader->Read(buffer, sizeof(buffer)));
+  EXPECT_EQ("de", std::string(buffer, 2));
+  EXPECT_EQ(0, reader->Read(buffer, sizeof(buffer)));
+}
+
+}  // namespace shaka
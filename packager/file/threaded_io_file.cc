@@ -6,35 +6,118 @@
 
 #include "packager/file/threaded_io_file.h"
 
+#include <algorithm>
+
 #include "packager/base/bind.h"
 #include "packager/base/bind_helpers.h"
-#include "packager/base/location.h"
-#include "packager/base/threading/worker_pool.h"
+#include "packager/base/logging.h"
+#include "packager/metrics/memory_budget.h"
+#include "packager/metrics/metrics.h"
 
 namespace shaka {
+namespace {
+
+// The size of the caches of all the autotuned files.
+std::atomic<uint64_t> g_autotuned_cache_size(0);
+
+uint64_t GetInitialCacheSize(uint64_t io_cache_size,
+                             uint64_t autotune_total_cache_size) {
+  if (autotune_total_cache_size == 0)
+    return io_cache_size;
+  return std::min(io_cache_size,
+                  ThreadedIoFile::kInitialAutotunedCacheSize);
+}
+
+uint64_t GetBlockSize(uint64_t cache_size,
+                      uint64_t io_block_size,
+                      uint64_t autotune_total_cache_size) {
+  // Blocks larger than the cache would never fit.
+  if (autotune_total_cache_size == 0)
+    return std::min(io_block_size, cache_size);
+  // Autotuned blocks grow with the cache, so that it holds a few of them.
+  const uint64_t kNumBlocksPerCache = 8;
+  return std::max<uint64_t>(
+      1, std::min(io_block_size, cache_size / kNumBlocksPerCache));
+}
+
+}  // namespace
+
+const uint64_t ThreadedIoFile::kInitialAutotunedCacheSize;
 
 ThreadedIoFile::ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
                                Mode mode,
                                uint64_t io_cache_size,
-                               uint64_t io_block_size)
+                               uint64_t io_block_size,
+                               uint64_t autotune_total_cache_size,
+                               std::unique_ptr<IoExecutor> dedicated_executor)
     : File(internal_file->file_name()),
       internal_file_(std::move(internal_file)),
       mode_(mode),
-      cache_(io_cache_size),
-      io_buffer_(io_block_size),
+      cache_(GetInitialCacheSize(io_cache_size, autotune_total_cache_size)),
+      io_buffer_(GetBlockSize(cache_.cache_size(),
+                              io_block_size,
+                              autotune_total_cache_size)),
+      block_size_(io_buffer_.size()),
+      max_cache_size_(io_cache_size),
+      max_block_size_(io_block_size),
+      autotune_total_cache_size_(autotune_total_cache_size),
+      autotuned_cache_size_(autotune_total_cache_size ? cache_.cache_size()
+                                                      : 0),
+      num_reader_waits_at_growth_(0),
       position_(0),
       size_(0),
       eof_(false),
-      flushing_(false),
-      flush_complete_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                            base::WaitableEvent::InitialState::NOT_SIGNALED),
       internal_file_error_(0),
-      task_exit_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                       base::WaitableEvent::InitialState::NOT_SIGNALED) {
+      dedicated_executor_(std::move(dedicated_executor)),
+      executor_(dedicated_executor_ ? dedicated_executor_.get()
+                                    : IoExecutor::GetLocalInstance()),
+      task_done_(&lock_),
+      task_posted_(false),
+      stopped_(false),
+      input_done_(false) {
   DCHECK(internal_file_);
+  g_autotuned_cache_size.fetch_add(autotuned_cache_size_,
+                                   std::memory_order_relaxed);
+
+  const Metrics::Labels labels = {
+      {"file", file_name()},
+      {"mode", mode_ == kInputMode ? "input" : "output"}};
+  metrics_collector_id_ = Metrics::GetInstance()->AddCollector(
+      [this, labels](Metrics::Writer* writer) {
+        writer->Add("packager_threaded_io_file_cache_bytes",
+                    Metrics::Type::kGauge,
+                    "Bytes held in the cache of a threaded I/O file.", labels,
+                    static_cast<double>(cache_.BytesCached()));
+        writer->Add("packager_threaded_io_file_cache_capacity_bytes",
+                    Metrics::Type::kGauge,
+                    "Capacity of the cache of a threaded I/O file.", labels,
+                    static_cast<double>(cache_.cache_size()));
+        writer->Add("packager_threaded_io_file_block_bytes",
+                    Metrics::Type::kGauge,
+                    "Size of the blocks of a threaded I/O file.", labels,
+                    static_cast<double>(
+                        block_size_.load(std::memory_order_relaxed)));
+        writer->Add("packager_threaded_io_file_waits_total",
+                    Metrics::Type::kCounter,
+                    "Times the packager waited on the cache of a threaded "
+                    "I/O file, i.e. for room to write or for data to read.",
+                    labels,
+                    static_cast<double>(mode_ == kInputMode
+                                            ? cache_.num_reader_waits()
+                                            : cache_.num_writer_waits()));
+      });
 }
 
-ThreadedIoFile::~ThreadedIoFile() {}
+ThreadedIoFile::~ThreadedIoFile() {
+  Metrics::GetInstance()->RemoveCollector(metrics_collector_id_);
+  g_autotuned_cache_size.fetch_sub(autotuned_cache_size_,
+                                   std::memory_order_relaxed);
+}
+
+// static
+uint64_t ThreadedIoFile::GetAutotunedCacheSize() {
+  return g_autotuned_cache_size.load(std::memory_order_relaxed);
+}
 
 bool ThreadedIoFile::Open() {
   DCHECK(internal_file_);
@@ -45,10 +128,8 @@ bool ThreadedIoFile::Open() {
   position_ = 0;
   size_ = internal_file_->Size();
 
-  base::WorkerPool::PostTask(
-      FROM_HERE,
-      base::Bind(&ThreadedIoFile::TaskHandler, base::Unretained(this)),
-      true /* task_is_slow */);
+  if (mode_ == kInputMode)
+    ScheduleTask();
   return true;
 }
 
@@ -56,11 +137,17 @@ bool ThreadedIoFile::Close() {
   DCHECK(internal_file_);
 
   bool result = true;
-  if (mode_ == kOutputMode)
+  if (mode_ == kOutputMode) {
     result = Flush();
-
-  cache_.Close();
-  task_exit_event_.Wait();
+    cache_.Close();
+    WaitForTask();
+    // The data left in the cache after an error is not written out.
+    MemoryBudget::GetInstance()->Add(
+        MemoryBudget::kOutputCaches,
+        -static_cast<int64_t>(cache_.BytesCached()));
+  } else {
+    StopInputTask();
+  }
 
   result &= internal_file_.release()->Close();
   delete this;
@@ -79,6 +166,9 @@ int64_t ThreadedIoFile::Read(void* buffer, uint64_t length) {
 
   uint64_t bytes_read = cache_.Read(buffer, length);
   position_ += bytes_read;
+  // There may be room to read ahead again.
+  if (bytes_read > 0)
+    ScheduleTask();
 
   return bytes_read;
 }
@@ -90,7 +180,28 @@ int64_t ThreadedIoFile::Write(const void* buffer, uint64_t length) {
   if (internal_file_error_.load(std::memory_order_relaxed))
     return internal_file_error_.load(std::memory_order_relaxed);
 
-  uint64_t bytes_written = cache_.Write(buffer, length);
+  // The task is posted after every block, so it is running whenever this
+  // thread is blocked on a full cache.
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_written = 0;
+  while (bytes_written < length) {
+    uint64_t size =
+        std::min<uint64_t>(length - bytes_written, io_buffer_.size());
+    if (cache_.BytesFree() < size && CanGrowCache()) {
+      // Rather than waiting for room, wait for the cache to be written out
+      // and grow it.
+      WaitForTask();
+      if (internal_file_error_.load(std::memory_order_relaxed))
+        break;
+      GrowCache();
+      size = std::min<uint64_t>(length - bytes_written, io_buffer_.size());
+    }
+    if (cache_.Write(data + bytes_written, size) == 0)
+      break;
+    MemoryBudget::GetInstance()->Add(MemoryBudget::kOutputCaches, size);
+    bytes_written += size;
+    ScheduleTask();
+  }
   position_ += bytes_written;
   if (position_ > size_)
     size_ = position_;
@@ -111,9 +222,10 @@ bool ThreadedIoFile::Flush() {
   if (internal_file_error_.load(std::memory_order_relaxed))
     return false;
 
-  flushing_ = true;
-  cache_.Close();
-  flush_complete_event_.Wait();
+  // The task completes once the cache is written out.
+  WaitForTask();
+  if (internal_file_error_.load(std::memory_order_relaxed))
+    return false;
   return internal_file_->Flush();
 }
 
@@ -125,10 +237,8 @@ bool ThreadedIoFile::Seek(uint64_t position) {
     if (!internal_file_->Seek(position))
       return false;
   } else {
-    // Reading. Close cache, wait for thread task to exit, seek, and re-post
-    // the task.
-    cache_.Close();
-    task_exit_event_.Wait();
+    // Reading. Stop reading ahead, seek, and restart the task.
+    StopInputTask();
     bool result = internal_file_->Seek(position);
     if (!result) {
       // Seek failed. Seek to logical position instead.
@@ -136,12 +246,7 @@ bool ThreadedIoFile::Seek(uint64_t position) {
         LOG(WARNING) << "Seek failed. ThreadedIoFile left in invalid state.";
       }
     }
-    cache_.Reopen();
-    eof_ = false;
-    base::WorkerPool::PostTask(
-        FROM_HERE,
-        base::Bind(&ThreadedIoFile::TaskHandler, base::Unretained(this)),
-        true /* task_is_slow */);
+    StartInputTask();
     if (!result)
       return false;
   }
@@ -156,65 +261,203 @@ bool ThreadedIoFile::Tell(uint64_t* position) {
   return true;
 }
 
+int ThreadedIoFile::BeginKernelCopy() {
+  DCHECK(internal_file_);
+  if (mode_ == kOutputMode) {
+    // The cached data goes first.
+    if (!Flush())
+      return -1;
+    return internal_file_->BeginKernelCopy();
+  }
+  StopInputTask();
+  const int fd = internal_file_->Seek(position_)
+                     ? internal_file_->BeginKernelCopy()
+                     : -1;
+  if (fd < 0)
+    StartInputTask();
+  return fd;
+}
+
+bool ThreadedIoFile::EndKernelCopy(uint64_t bytes_copied) {
+  DCHECK(internal_file_);
+  const bool result = internal_file_->EndKernelCopy(bytes_copied);
+  position_ += bytes_copied;
+  if (mode_ == kOutputMode) {
+    if (position_ > size_)
+      size_ = position_;
+  } else {
+    StartInputTask();
+  }
+  return result;
+}
+
+void ThreadedIoFile::ScheduleTask() {
+  base::AutoLock auto_lock(lock_);
+  if (task_posted_ || !HasWorkLocked())
+    return;
+  task_posted_ = true;
+  executor_->PostTask(
+      base::Bind(&ThreadedIoFile::TaskHandler, base::Unretained(this)));
+}
+
 void ThreadedIoFile::TaskHandler() {
   if (mode_ == kInputMode)
-    RunInInputMode();
+    RunInputStep();
   else
-    RunInOutputMode();
-  task_exit_event_.Signal();
+    RunOutputStep();
+
+  // Checked under |lock_| so progress made by the other side after the step
+  // is not missed: either it sees |task_posted_| cleared and posts the task,
+  // or the task sees its progress here.
+  base::AutoLock auto_lock(lock_);
+  if (HasWorkLocked()) {
+    // Posted again rather than looping, so the files sharing the executor
+    // take turns.
+    executor_->PostTask(
+        base::Bind(&ThreadedIoFile::TaskHandler, base::Unretained(this)));
+    return;
+  }
+  task_posted_ = false;
+  task_done_.Broadcast();
 }
 
-void ThreadedIoFile::RunInInputMode() {
+void ThreadedIoFile::RunInputStep() {
   DCHECK(internal_file_);
   DCHECK_EQ(kInputMode, mode_);
 
-  while (true) {
-    int64_t read_result =
-        internal_file_->Read(&io_buffer_[0], io_buffer_.size());
-    if (read_result <= 0) {
-      eof_.store(read_result == 0, std::memory_order_relaxed);
-      internal_file_error_.store(read_result, std::memory_order_relaxed);
-      cache_.Close();
-      return;
-    }
-    if (cache_.Write(&io_buffer_[0], read_result) == 0) {
-      return;
+  // Only read full blocks, as some files, e.g. UDP, need a buffer large
+  // enough for a whole datagram.
+  if (cache_.BytesFree() < io_buffer_.size())
+    return;
+  int64_t read_result =
+      internal_file_->Read(&io_buffer_[0], io_buffer_.size());
+  if (read_result <= 0) {
+    eof_.store(read_result == 0, std::memory_order_relaxed);
+    internal_file_error_.store(read_result, std::memory_order_relaxed);
+    {
+      base::AutoLock auto_lock(lock_);
+      input_done_ = true;
     }
+    cache_.Close();
+    return;
+  }
+  // The reader waiting for data while the internal file fills whole blocks,
+  // i.e. is not the bottleneck, calls for larger blocks and read ahead. Files
+  // which return data as it arrives, e.g. UDP, fill partial blocks.
+  const uint64_t num_reader_waits = cache_.num_reader_waits();
+  if (static_cast<uint64_t>(read_result) == io_buffer_.size() &&
+      num_reader_waits > num_reader_waits_at_growth_ &&
+      cache_.BytesCached() == 0 && CanGrowCache()) {
+    num_reader_waits_at_growth_ = num_reader_waits;
+    GrowCache();
   }
+  // Does not block, as there is room for the block. The data is dropped if
+  // the cache was closed to stop reading ahead.
+  cache_.Write(&io_buffer_[0], read_result);
 }
 
-void ThreadedIoFile::RunInOutputMode() {
+void ThreadedIoFile::RunOutputStep() {
   DCHECK(internal_file_);
   DCHECK_EQ(kOutputMode, mode_);
 
-  while (true) {
-    uint64_t write_bytes = cache_.Read(&io_buffer_[0], io_buffer_.size());
-    if (write_bytes == 0) {
-      if (flushing_) {
-        cache_.Reopen();
-        flushing_ = false;
-        flush_complete_event_.Signal();
-      } else {
-        return;
-      }
-    } else {
-      uint64_t bytes_written(0);
-      while (bytes_written < write_bytes) {
-        int64_t write_result = internal_file_->Write(
-            &io_buffer_[bytes_written], write_bytes - bytes_written);
-        if (write_result < 0) {
-          internal_file_error_.store(write_result, std::memory_order_relaxed);
-          cache_.Close();
-          if (flushing_) {
-            flushing_ = false;
-            flush_complete_event_.Signal();
-          }
-          return;
-        }
-        bytes_written += write_result;
-      }
+  const uint64_t bytes_cached = cache_.BytesCached();
+  if (bytes_cached == 0)
+    return;
+  // Does not block, as there is data.
+  const uint64_t write_bytes = cache_.Read(
+      &io_buffer_[0], std::min<uint64_t>(bytes_cached, io_buffer_.size()));
+  MemoryBudget::GetInstance()->Add(MemoryBudget::kOutputCaches,
+                                   -static_cast<int64_t>(write_bytes));
+  uint64_t bytes_written(0);
+  while (bytes_written < write_bytes) {
+    int64_t write_result = internal_file_->Write(&io_buffer_[bytes_written],
+                                                 write_bytes - bytes_written);
+    if (write_result < 0) {
+      internal_file_error_.store(write_result, std::memory_order_relaxed);
+      // Unblock the writer.
+      cache_.Close();
+      return;
     }
+    bytes_written += write_result;
+  }
+}
+
+bool ThreadedIoFile::GrowCache() {
+  DCHECK(CanGrowCache());
+  const uint64_t cache_size = cache_.cache_size();
+  const uint64_t new_cache_size = std::min(max_cache_size_, 2 * cache_size);
+  const uint64_t increase = new_cache_size - cache_size;
+  uint64_t total_cache_size =
+      g_autotuned_cache_size.load(std::memory_order_relaxed);
+  do {
+    if (total_cache_size + increase > autotune_total_cache_size_) {
+      VLOG(1) << "The threaded I/O caches reached their total size of "
+              << autotune_total_cache_size_ << " bytes.";
+      return false;
+    }
+  } while (!g_autotuned_cache_size.compare_exchange_weak(
+      total_cache_size, total_cache_size + increase,
+      std::memory_order_relaxed));
+
+  if (!cache_.Grow(new_cache_size)) {
+    g_autotuned_cache_size.fetch_sub(increase, std::memory_order_relaxed);
+    return false;
+  }
+  autotuned_cache_size_ += increase;
+  const uint64_t block_size = GetBlockSize(new_cache_size, max_block_size_,
+                                           autotune_total_cache_size_);
+  {
+    // |io_buffer_| is sized under the lock for HasWorkLocked().
+    base::AutoLock auto_lock(lock_);
+    io_buffer_.resize(block_size);
+  }
+  block_size_.store(block_size, std::memory_order_relaxed);
+  VLOG(1) << "Grew the cache of " << file_name() << " to " << new_cache_size
+          << " bytes, with blocks of " << block_size << " bytes.";
+  return true;
+}
+
+bool ThreadedIoFile::CanGrowCache() const {
+  return autotune_total_cache_size_ > 0 &&
+         cache_.cache_size() < max_cache_size_ &&
+         GetAutotunedCacheSize() < autotune_total_cache_size_;
+}
+
+bool ThreadedIoFile::HasWorkLocked() {
+  lock_.AssertAcquired();
+  if (mode_ == kInputMode)
+    return !stopped_ && !input_done_ && cache_.BytesFree() >= io_buffer_.size();
+  return !internal_file_error_.load(std::memory_order_relaxed) &&
+         cache_.BytesCached() > 0;
+}
+
+void ThreadedIoFile::WaitForTask() {
+  base::AutoLock auto_lock(lock_);
+  while (task_posted_)
+    task_done_.Wait();
+}
+
+void ThreadedIoFile::StopInputTask() {
+  DCHECK_EQ(kInputMode, mode_);
+  {
+    base::AutoLock auto_lock(lock_);
+    stopped_ = true;
+  }
+  // Unblocks a task writing to the cache, if any.
+  cache_.Close();
+  WaitForTask();
+}
+
+void ThreadedIoFile::StartInputTask() {
+  DCHECK_EQ(kInputMode, mode_);
+  cache_.Reopen();
+  eof_ = false;
+  {
+    base::AutoLock auto_lock(lock_);
+    stopped_ = false;
+    input_done_ = false;
   }
+  ScheduleTask();
 }
 
 }  // namespace shaka
@@ -9,22 +9,49 @@
 
 #include <atomic>
 #include <memory>
-#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
 #include "packager/file/io_cache.h"
+#include "packager/file/io_executor.h"
 
 namespace shaka {
 
 /// Declaration of class which implements a thread-safe circular buffer.
+/// The I/O of the internal file is performed by tasks on an IoExecutor,
+/// shared by all the files by default. A file has at most one task posted at
+/// a time, which keeps its I/O in order.
 class ThreadedIoFile : public File {
  public:
   enum Mode { kInputMode, kOutputMode };
 
+  /// Initial cache size of the autotuned files.
+  static const uint64_t kInitialAutotunedCacheSize = 128 * 1024;
+
+  /// @param io_cache_size is the size of the cache, or its maximum size if
+  ///        the file is autotuned.
+  /// @param io_block_size is the size of the blocks read from or written to
+  ///        the internal file, or their maximum size if the file is
+  ///        autotuned.
+  /// @param autotune_total_cache_size autotunes the file if non-zero: the
+  ///        cache starts small and doubles whenever the writer of an output
+  ///        waits for room, or the reader of an input waits for data while
+  ///        the internal file fills whole blocks, as long as the caches of
+  ///        all the autotuned files fit in this many bytes. The block size
+  ///        is an eighth of the cache size.
+  /// @param dedicated_executor is an executor owned by the file, for internal
+  ///        files whose I/O may block indefinitely, e.g. UDP sockets. The
+  ///        process wide executor is used if it is null.
   ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
                  Mode mode,
                  uint64_t io_cache_size,
-                 uint64_t io_block_size);
+                 uint64_t io_block_size,
+                 uint64_t autotune_total_cache_size = 0,
+                 std::unique_ptr<IoExecutor> dedicated_executor = nullptr);
+
+  /// @return The size of the caches of all the autotuned files.
+  static uint64_t GetAutotunedCacheSize();
 
   /// @name File implementation overrides.
   /// @{
@@ -41,26 +68,65 @@ class ThreadedIoFile : public File {
   ~ThreadedIoFile() override;
 
   bool Open() override;
+  int BeginKernelCopy() override;
+  bool EndKernelCopy(uint64_t bytes_copied) override;
 
  private:
-  // Internal task handler implementation. Will dispatch to either
-  // |RunInInputMode| or |RunInOutputMode| depending on |mode_|.
+  // Post a task unless one is already posted.
+  void ScheduleTask();
+  // Runs on the executor. Dispatches to either |RunInputStep| or
+  // |RunOutputStep| depending on |mode_|, then posts the task again if there
+  // is more to do.
   void TaskHandler();
-  void RunInInputMode();
-  void RunInOutputMode();
+  // Read a block from |internal_file_| into the cache, or write a block of
+  // the cache to |internal_file_|. Never blocks on the cache.
+  void RunInputStep();
+  void RunOutputStep();
+  // Called with |lock_| held. Returns true if a task has work to do.
+  bool HasWorkLocked();
+  // Wait until no task is posted.
+  void WaitForTask();
+  // Stop reading ahead and wait for the input task to complete.
+  void StopInputTask();
+  // Restart the input task at the current position of |internal_file_|,
+  // discarding the data read ahead.
+  void StartInputTask();
+  // Double the cache of an autotuned file, and the block size with it, within
+  // the maximum sizes and the process wide limit. Must be called on the
+  // writer side of the cache while it is empty and no task uses |io_buffer_|.
+  bool GrowCache();
+  bool CanGrowCache() const;
 
   std::unique_ptr<File, FileCloser> internal_file_;
   const Mode mode_;
   IoCache cache_;
   std::vector<uint8_t> io_buffer_;
+  // The size of |io_buffer_|, for the metrics.
+  std::atomic<uint64_t> block_size_;
+  const uint64_t max_cache_size_;
+  const uint64_t max_block_size_;
+  const uint64_t autotune_total_cache_size_;
+  // The cache bytes accounted to the autotuned files.
+  uint64_t autotuned_cache_size_;
+  // The number of reader waits of the cache when it was last grown.
+  uint64_t num_reader_waits_at_growth_;
+  int metrics_collector_id_;
   uint64_t position_;
   uint64_t size_;
   std::atomic<bool> eof_;
-  bool flushing_;
-  base::WaitableEvent flush_complete_event_;
   std::atomic<int32_t> internal_file_error_;
-  // Signalled when thread task exits.
-  base::WaitableEvent task_exit_event_;
+  std::unique_ptr<IoExecutor> dedicated_executor_;
+  IoExecutor* const executor_;
+
+  base::Lock lock_;
+  // Signaled when the task completes without posting itself again.
+  base::ConditionVariable task_done_;
+  // The following are protected by |lock_|.
+  bool task_posted_;
+  // Set to stop reading ahead in input mode.
+  bool stopped_;
+  // Set on the end of the internal file or on errors in input mode.
+  bool input_done_;
 
   DISALLOW_COPY_AND_ASSIGN(ThreadedIoFile);
 };
@@ -0,0 +1,374 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/udp_event_loop.h"
+
+#include <errno.h>
+#include <gflags/gflags.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/base/time/time.h"
+
+DEFINE_int32(udp_event_loop_threads,
+             0,
+             "If non-zero, the UDP inputs are received by this number of "
+             "threads, each waiting for many sockets with epoll, into a ring "
+             "buffer per input of the size of its buffer_size option (4 MiB "
+             "by default), instead of by a thread per input. Linux only.");
+
+namespace shaka {
+
+namespace {
+
+// The largest UDP payload is 65507 bytes over IPv4.
+const size_t kMaxDatagramSize = 65536;
+// Room for the SO_TIMESTAMPNS and SO_RXQ_OVFL control messages.
+const size_t kControlSize =
+    CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t));
+// Maximum number of ready sockets handled per epoll_wait call.
+const int kMaxEvents = 64;
+// The epoll data of the event which stops a thread. The sockets start at 1.
+const uint64_t kStopEventId = 0;
+
+}  // namespace
+
+void ParseUdpControlMessages(const struct msghdr& message,
+                             int64_t* timestamp_ns,
+                             uint32_t* kernel_drops) {
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg;
+       cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&message), cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET)
+      continue;
+    if (cmsg->cmsg_type == SO_TIMESTAMPNS) {
+      struct timespec ts;
+      memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+      *timestamp_ns = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    } else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+      memcpy(kernel_drops, CMSG_DATA(cmsg), sizeof(*kernel_drops));
+    }
+  }
+}
+
+UdpEventLoop::Ring::Ring(size_t capacity)
+    : capacity_(capacity), datagram_available_(&lock_) {}
+
+UdpEventLoop::Ring::~Ring() {}
+
+bool UdpEventLoop::Ring::Pop(unsigned timeout_us, Datagram* datagram) {
+  base::AutoLock auto_lock(lock_);
+  const base::TimeTicks deadline =
+      base::TimeTicks::Now() + base::TimeDelta::FromMicroseconds(timeout_us);
+  while (datagrams_.empty() && !closed_) {
+    if (timeout_us == 0) {
+      datagram_available_.Wait();
+      continue;
+    }
+    const base::TimeDelta remaining = deadline - base::TimeTicks::Now();
+    if (remaining <= base::TimeDelta())
+      return false;
+    datagram_available_.TimedWait(remaining);
+  }
+  if (datagrams_.empty())
+    return false;
+  std::unique_ptr<Datagram> next = std::move(datagrams_.front());
+  datagrams_.pop_front();
+  size_ -= next->data.size();
+  std::swap(*datagram, *next);
+  free_datagrams_.push_back(std::move(next));
+  return true;
+}
+
+uint64_t UdpEventLoop::Ring::ring_drops() {
+  base::AutoLock auto_lock(lock_);
+  return ring_drops_;
+}
+
+void UdpEventLoop::Ring::TakeDatagrams(
+    size_t count,
+    std::vector<std::unique_ptr<Datagram>>* datagrams) {
+  base::AutoLock auto_lock(lock_);
+  while (datagrams->size() < count) {
+    if (free_datagrams_.empty()) {
+      datagrams->emplace_back(new Datagram);
+    } else {
+      datagrams->push_back(std::move(free_datagrams_.back()));
+      free_datagrams_.pop_back();
+    }
+  }
+}
+
+void UdpEventLoop::Ring::Push(
+    std::vector<std::unique_ptr<Datagram>>* datagrams) {
+  base::AutoLock auto_lock(lock_);
+  for (std::unique_ptr<Datagram>& datagram : *datagrams) {
+    if (closed_ || size_ + datagram->data.size() > capacity_) {
+      if (!closed_ && ring_drops_++ == 0) {
+        LOG(WARNING) << "UDP datagram(s) dropped as the ring buffer of "
+                        "the event loop is full. Consider increasing "
+                        "buffer_size.";
+      }
+      free_datagrams_.push_back(std::move(datagram));
+      continue;
+    }
+    size_ += datagram->data.size();
+    datagrams_.push_back(std::move(datagram));
+  }
+  datagrams->clear();
+  datagram_available_.Signal();
+}
+
+void UdpEventLoop::Ring::Close() {
+  base::AutoLock auto_lock(lock_);
+  closed_ = true;
+  datagram_available_.Signal();
+}
+
+// Waits for its sockets with epoll, and receives their datagrams in batches.
+class UdpEventLoop::LoopThread : public base::SimpleThread {
+ public:
+  LoopThread() : base::SimpleThread("UdpEventLoop") {}
+
+  ~LoopThread() override {
+    if (HasBeenStarted()) {
+      {
+        base::AutoLock auto_lock(lock_);
+        stopping_ = true;
+      }
+      // The event stays readable, so it is seen even if epoll_wait() was
+      // not called yet.
+      const uint64_t one = 1;
+      if (write(stop_fd_, &one, sizeof(one)) < 0)
+        PLOG(ERROR) << "Failed to stop the UDP event loop.";
+      Join();
+    }
+    if (stop_fd_ >= 0)
+      close(stop_fd_);
+    if (epoll_fd_ >= 0)
+      close(epoll_fd_);
+  }
+
+  bool Initialize() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ < 0 || stop_fd_ < 0) {
+      PLOG(ERROR) << "Failed to create the UDP event loop.";
+      return false;
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = kStopEventId;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &event) < 0) {
+      PLOG(ERROR) << "Failed to create the UDP event loop.";
+      return false;
+    }
+    Start();
+    return true;
+  }
+
+  bool AddSocket(int socket,
+                 unsigned batch_size,
+                 const std::shared_ptr<Ring>& ring) {
+    base::AutoLock auto_lock(lock_);
+    const uint64_t id = next_id_++;
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket, &event) < 0) {
+      PLOG(ERROR) << "Failed to add a UDP socket to the event loop.";
+      return false;
+    }
+    Source& source = sources_[id];
+    source.socket = socket;
+    source.batch_size = batch_size;
+    source.ring = ring;
+    source_ids_[socket] = id;
+    return true;
+  }
+
+  void RemoveSocket(int socket) {
+    base::AutoLock auto_lock(lock_);
+    const auto source_id = source_ids_.find(socket);
+    if (source_id == source_ids_.end())
+      return;
+    // Fails if the socket was removed after a receive error.
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket, nullptr);
+    sources_[source_id->second].ring->Close();
+    sources_.erase(source_id->second);
+    source_ids_.erase(source_id);
+  }
+
+  void Run() override {
+    struct epoll_event events[kMaxEvents];
+    while (true) {
+      const int num_events = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+      if (num_events < 0) {
+        if (errno == EINTR)
+          continue;
+        PLOG(ERROR) << "epoll_wait failed, stopping the UDP event loop.";
+        return;
+      }
+      // The events of the sockets removed since epoll_wait() returned are
+      // ignored, as their ids are not reused.
+      base::AutoLock auto_lock(lock_);
+      if (stopping_)
+        return;
+      for (int i = 0; i < num_events; ++i) {
+        const auto source = sources_.find(events[i].data.u64);
+        if (source != sources_.end())
+          Receive(&source->second);
+      }
+    }
+  }
+
+ private:
+  struct Source {
+    int socket = -1;
+    unsigned batch_size = 0;
+    std::shared_ptr<Ring> ring;
+    // The last number of datagrams dropped by the kernel.
+    uint32_t kernel_drops = 0;
+  };
+
+  // Receive a batch of the datagrams queued on |source|, without blocking.
+  // The level triggered events of a socket with more datagrams are returned
+  // again, after the other sockets are served.
+  void Receive(Source* source) {
+    const size_t batch_size = source->batch_size;
+    if (messages_.size() < batch_size) {
+      pool_.resize(batch_size * kMaxDatagramSize);
+      // uint64_t elements keep the control messages aligned.
+      control_.resize(batch_size * kControlSize / sizeof(uint64_t));
+      iovecs_.resize(batch_size);
+      messages_.resize(batch_size);
+      for (size_t i = 0; i < batch_size; ++i) {
+        iovecs_[i].iov_base = &pool_[i * kMaxDatagramSize];
+        iovecs_[i].iov_len = kMaxDatagramSize;
+        messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+        messages_[i].msg_hdr.msg_iovlen = 1;
+      }
+    }
+    static_assert(kControlSize % sizeof(uint64_t) == 0,
+                  "Control messages should be 64-bit aligned.");
+    char* control = reinterpret_cast<char*>(control_.data());
+    for (size_t i = 0; i < batch_size; ++i) {
+      messages_[i].msg_hdr.msg_control = control + i * kControlSize;
+      messages_[i].msg_hdr.msg_controllen = kControlSize;
+      messages_[i].msg_hdr.msg_flags = 0;
+    }
+
+    const int result = recvmmsg(source->socket, messages_.data(), batch_size,
+                                MSG_DONTWAIT, nullptr);
+    if (result < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        return;
+      // Level triggered, so the socket would be returned again and again.
+      PLOG(ERROR) << "Failed to receive from a UDP socket, closing it.";
+      epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, source->socket, nullptr);
+      source->ring->Close();
+      return;
+    }
+
+    source->ring->TakeDatagrams(result, &batch_);
+    for (int i = 0; i < result; ++i) {
+      const struct mmsghdr& message = messages_[i];
+      Datagram* datagram = batch_[i].get();
+      const uint8_t* data =
+          static_cast<const uint8_t*>(message.msg_hdr.msg_iov->iov_base);
+      datagram->data.assign(data, data + message.msg_len);
+      datagram->truncated = (message.msg_hdr.msg_flags & MSG_TRUNC) != 0;
+      datagram->timestamp_ns = 0;
+      ParseUdpControlMessages(message.msg_hdr, &datagram->timestamp_ns,
+                              &source->kernel_drops);
+      datagram->kernel_drops = source->kernel_drops;
+    }
+    source->ring->Push(&batch_);
+  }
+
+  int epoll_fd_ = -1;
+  // Readable once the thread should stop.
+  int stop_fd_ = -1;
+
+  // Protects the members below, and is held while receiving, so that a
+  // socket is not received from once it is removed.
+  base::Lock lock_;
+  bool stopping_ = false;
+  // The sockets, by id, which are not reused.
+  std::map<uint64_t, Source> sources_;
+  std::map<int, uint64_t> source_ids_;
+  uint64_t next_id_ = kStopEventId + 1;
+
+  // The receive buffers, sized for the largest batch size.
+  std::vector<uint8_t> pool_;
+  std::vector<uint64_t> control_;
+  std::vector<struct iovec> iovecs_;
+  std::vector<struct mmsghdr> messages_;
+  std::vector<std::unique_ptr<Datagram>> batch_;
+};
+
+UdpEventLoop::UdpEventLoop(size_t num_threads) {
+  DCHECK_GT(num_threads, 0u);
+  for (size_t i = 0; i < num_threads; ++i) {
+    std::unique_ptr<LoopThread> thread(new LoopThread);
+    if (thread->Initialize())
+      threads_.push_back(std::move(thread));
+  }
+}
+
+UdpEventLoop::~UdpEventLoop() {
+  DCHECK(socket_threads_.empty());
+}
+
+UdpEventLoop* UdpEventLoop::GetInstance() {
+  if (FLAGS_udp_event_loop_threads <= 0)
+    return nullptr;
+  // Leaked, like the I/O executor, so the threads outlive the files closed
+  // at exit.
+  static UdpEventLoop* udp_event_loop =
+      new UdpEventLoop(FLAGS_udp_event_loop_threads);
+  return udp_event_loop;
+}
+
+std::shared_ptr<UdpEventLoop::Ring> UdpEventLoop::AddSocket(
+    int socket,
+    unsigned batch_size,
+    size_t ring_capacity) {
+  base::AutoLock auto_lock(lock_);
+  if (threads_.empty())
+    return nullptr;
+  std::map<LoopThread*, size_t> num_sockets;
+  for (const auto& socket_thread : socket_threads_)
+    ++num_sockets[socket_thread.second];
+  LoopThread* thread = threads_[0].get();
+  for (const auto& candidate : threads_) {
+    if (num_sockets[candidate.get()] < num_sockets[thread])
+      thread = candidate.get();
+  }
+
+  std::shared_ptr<Ring> ring(new Ring(ring_capacity));
+  if (!thread->AddSocket(socket, batch_size, ring))
+    return nullptr;
+  socket_threads_[socket] = thread;
+  return ring;
+}
+
+void UdpEventLoop::RemoveSocket(int socket) {
+  base::AutoLock auto_lock(lock_);
+  const auto socket_thread = socket_threads_.find(socket);
+  if (socket_thread == socket_threads_.end())
+    return;
+  socket_thread->second->RemoveSocket(socket);
+  socket_threads_.erase(socket_thread);
+}
+
+}  // namespace shaka
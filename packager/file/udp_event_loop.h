@@ -0,0 +1,134 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_UDP_EVENT_LOOP_H_
+#define PACKAGER_FILE_UDP_EVENT_LOOP_H_
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+/// Get the kernel receive timestamp (SO_TIMESTAMPNS) and the number of
+/// datagrams dropped by the kernel since the socket was opened (SO_RXQ_OVFL)
+/// from the control messages of @a message. They are left unchanged if the
+/// control messages are missing.
+void ParseUdpControlMessages(const struct msghdr& message,
+                             int64_t* timestamp_ns,
+                             uint32_t* kernel_drops);
+
+/// Receives the datagrams of many UDP sockets on a few threads, instead of a
+/// thread blocking on each socket. Each thread waits for its sockets with
+/// epoll and receives a batch of datagrams per system call with recvmmsg,
+/// into a bounded ring buffer per socket, which the UdpFile of the socket
+/// reads. Linux only. This class is thread safe.
+class UdpEventLoop {
+ public:
+  /// A datagram received, with its control information.
+  struct Datagram {
+    std::vector<uint8_t> data;
+    /// Whether the datagram did not fit in the receive buffer.
+    bool truncated = false;
+    /// The kernel receive timestamp, in nanoseconds since the epoch, or 0.
+    int64_t timestamp_ns = 0;
+    /// The number of datagrams dropped by the kernel since the socket was
+    /// opened, as of this datagram.
+    uint32_t kernel_drops = 0;
+  };
+
+  /// The datagrams received from a socket, until they are read.
+  class Ring {
+   public:
+    /// @param capacity is the maximum number of bytes of the datagrams
+    ///        received and not read yet. Newer datagrams are dropped when it
+    ///        is reached.
+    explicit Ring(size_t capacity);
+    ~Ring();
+
+    /// Wait for the next datagram and swap it with @a datagram, whose buffer
+    /// is reused.
+    /// @param timeout_us is the maximum time to wait, in microseconds, or 0
+    ///        to wait until the ring is closed.
+    /// @return false on timeout, or if the ring is closed and empty.
+    bool Pop(unsigned timeout_us, Datagram* datagram);
+
+    /// @return the number of datagrams dropped because the ring was full.
+    uint64_t ring_drops();
+
+   private:
+    friend class UdpEventLoop;
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    // Take |count| datagrams, with the buffers of the datagrams read, to
+    // receive into.
+    void TakeDatagrams(size_t count,
+                       std::vector<std::unique_ptr<Datagram>>* datagrams);
+    // Queue |datagrams|, dropping the ones which do not fit, and clear it.
+    void Push(std::vector<std::unique_ptr<Datagram>>* datagrams);
+    // No datagram is pushed after this. Pop() fails once the ring is empty.
+    void Close();
+
+    const size_t capacity_;
+    base::Lock lock_;
+    base::ConditionVariable datagram_available_;
+    std::deque<std::unique_ptr<Datagram>> datagrams_;
+    // The datagrams read, whose buffers are reused.
+    std::vector<std::unique_ptr<Datagram>> free_datagrams_;
+    // The number of bytes of |datagrams_|.
+    size_t size_ = 0;
+    uint64_t ring_drops_ = 0;
+    bool closed_ = false;
+  };
+
+  /// @param num_threads is the number of threads, which must be at least 1.
+  explicit UdpEventLoop(size_t num_threads);
+
+  /// Stops the threads. The sockets should have been removed.
+  ~UdpEventLoop();
+
+  /// @return the process wide event loop, with --udp_event_loop_threads
+  ///         threads, or nullptr if --udp_event_loop_threads is 0, in which
+  ///         case each UdpFile receives from its socket itself.
+  static UdpEventLoop* GetInstance();
+
+  /// Start receiving the datagrams of @a socket, on the thread with the
+  /// fewest sockets. @a socket must stay open until it is removed.
+  /// @param batch_size is the maximum number of datagrams received at once.
+  /// @param ring_capacity is the maximum number of bytes buffered.
+  /// @return the ring the datagrams are received in, or nullptr on failure.
+  std::shared_ptr<Ring> AddSocket(int socket,
+                                  unsigned batch_size,
+                                  size_t ring_capacity);
+
+  /// Stop receiving the datagrams of @a socket, and close its ring. The
+  /// datagrams already received can still be read.
+  void RemoveSocket(int socket);
+
+ private:
+  UdpEventLoop(const UdpEventLoop&) = delete;
+  UdpEventLoop& operator=(const UdpEventLoop&) = delete;
+
+  class LoopThread;
+
+  base::Lock lock_;
+  std::vector<std::unique_ptr<LoopThread>> threads_;
+  // The thread receiving from each socket.
+  std::map<int, LoopThread*> socket_threads_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_UDP_EVENT_LOOP_H_
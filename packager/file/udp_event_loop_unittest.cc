@@ -0,0 +1,142 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/udp_event_loop.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace shaka {
+
+namespace {
+const unsigned kBatchSize = 4;
+const size_t kRingCapacity = 1000;
+const unsigned kTimeoutUs = 1000000;
+const size_t kNumSockets = 3;
+}  // namespace
+
+class UdpEventLoopTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    sender_ = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(sender_, 0);
+  }
+
+  void TearDown() override {
+    for (int receiver : receivers_)
+      close(receiver);
+    close(sender_);
+  }
+
+  // Open a socket bound to an ephemeral port of the loopback interface.
+  int OpenReceiver() {
+    const int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    EXPECT_GE(receiver, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(0, bind(receiver, reinterpret_cast<struct sockaddr*>(&address),
+                      sizeof(address)));
+    receivers_.push_back(receiver);
+    return receiver;
+  }
+
+  void Send(int receiver, const std::string& data) {
+    struct sockaddr_in address = {};
+    socklen_t address_size = sizeof(address);
+    ASSERT_EQ(0, getsockname(receiver,
+                             reinterpret_cast<struct sockaddr*>(&address),
+                             &address_size));
+    ASSERT_EQ(static_cast<ssize_t>(data.size()),
+              sendto(sender_, data.data(), data.size(), 0,
+                     reinterpret_cast<struct sockaddr*>(&address),
+                     address_size));
+  }
+
+  std::string Pop(UdpEventLoop::Ring* ring) {
+    UdpEventLoop::Datagram datagram;
+    if (!ring->Pop(kTimeoutUs, &datagram))
+      return "<timeout>";
+    return std::string(datagram.data.begin(), datagram.data.end());
+  }
+
+  UdpEventLoop event_loop_{2};
+  int sender_ = -1;
+  std::vector<int> receivers_;
+};
+
+TEST_F(UdpEventLoopTest, ReceivesManySockets) {
+  std::vector<std::shared_ptr<UdpEventLoop::Ring>> rings;
+  for (size_t i = 0; i < kNumSockets; ++i) {
+    rings.push_back(
+        event_loop_.AddSocket(OpenReceiver(), kBatchSize, kRingCapacity));
+    ASSERT_TRUE(rings.back());
+  }
+
+  for (size_t i = 0; i < kNumSockets; ++i) {
+    Send(receivers_[i], "first" + std::to_string(i));
+    Send(receivers_[i], "second" + std::to_string(i));
+  }
+  for (size_t i = 0; i < kNumSockets; ++i) {
+    EXPECT_EQ("first" + std::to_string(i), Pop(rings[i].get()));
+    EXPECT_EQ("second" + std::to_string(i), Pop(rings[i].get()));
+  }
+
+  for (int receiver : receivers_)
+    event_loop_.RemoveSocket(receiver);
+}
+
+TEST_F(UdpEventLoopTest, PopTimesOut) {
+  const int receiver = OpenReceiver();
+  std::shared_ptr<UdpEventLoop::Ring> ring =
+      event_loop_.AddSocket(receiver, kBatchSize, kRingCapacity);
+  ASSERT_TRUE(ring);
+  UdpEventLoop::Datagram datagram;
+  EXPECT_FALSE(ring->Pop(1000, &datagram));
+  event_loop_.RemoveSocket(receiver);
+}
+
+TEST_F(UdpEventLoopTest, DropsWhenFull) {
+  // Queued before the socket is added, so that they are received in a batch
+  // before any is read.
+  const int receiver = OpenReceiver();
+  const std::string datagram(kRingCapacity / 2, 'x');
+  Send(receiver, datagram);
+  Send(receiver, datagram);
+  Send(receiver, datagram);
+  Send(receiver, "last");
+
+  std::shared_ptr<UdpEventLoop::Ring> ring =
+      event_loop_.AddSocket(receiver, kBatchSize, kRingCapacity);
+  ASSERT_TRUE(ring);
+  EXPECT_EQ(datagram, Pop(ring.get()));
+  EXPECT_EQ(datagram, Pop(ring.get()));
+  event_loop_.RemoveSocket(receiver);
+
+  UdpEventLoop::Datagram dropped;
+  EXPECT_FALSE(ring->Pop(kTimeoutUs, &dropped));
+  EXPECT_EQ(2u, ring->ring_drops());
+}
+
+TEST_F(UdpEventLoopTest, RemovedSocketClosesRing) {
+  const int receiver = OpenReceiver();
+  std::shared_ptr<UdpEventLoop::Ring> ring =
+      event_loop_.AddSocket(receiver, kBatchSize, kRingCapacity);
+  ASSERT_TRUE(ring);
+  Send(receiver, "data");
+  EXPECT_EQ("data", Pop(ring.get()));
+  event_loop_.RemoveSocket(receiver);
+
+  // Fails without waiting for the timeout.
+  UdpEventLoop::Datagram datagram;
+  EXPECT_FALSE(ring->Pop(0, &datagram));
+}
+
+}  // namespace shaka
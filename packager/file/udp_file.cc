@@ -30,11 +30,39 @@
 #define IP_MULTICAST_ALL      49
 #endif
 
+#if defined(__linux__)
+#include <time.h>
+
+// Likewise for SO_RXQ_OVFL (2.6.33) and SO_BUSY_POLL (3.11).
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+// And SO_TXTIME (4.19).
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+#define SCM_TXTIME SO_TXTIME
+#endif
+#endif  // defined(__linux__)
+
 #endif  // defined(OS_WIN)
 
+#include <string.h>
+
+#include <algorithm>
 #include <limits>
+#include <map>
+#include <vector>
 
 #include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/time/time.h"
+#if defined(__linux__)
+#include "packager/file/udp_event_loop.h"
+#endif  // defined(__linux__)
 #include "packager/file/udp_options.h"
 
 namespace shaka {
@@ -53,24 +81,513 @@ int GetSocketErrorCode() {
 #endif
 }
 
+const size_t kTsPacketSize = 188;
+const uint8_t kTsSyncByte = 0x47;
+// The PCR clock runs at 27 MHz.
+const int64_t kPcrTicksPerUs = 27;
+// The datagrams sent within this time of each other are sent together.
+const int64_t kPacingSlackUs = 1000;
+// The pacing starts over from the current time when it falls behind by more
+// than this, or when the PCRs jump by more than this.
+const int64_t kMaxPacingLagUs = 1000000;
+
+int64_t NowUs() {
+  return (base::TimeTicks::Now() - base::TimeTicks()).InMicroseconds();
+}
+
+// Get the PCR, in 27 MHz ticks, of the first TS packet of |data| carrying one
+// on |*pid|, or on any PID if |*pid| is negative, in which case |*pid| is set
+// to the PID of that packet.
+bool FindPcr(const uint8_t* data, size_t size, int* pid, int64_t* pcr) {
+  for (size_t pos = 0; pos + kTsPacketSize <= size; pos += kTsPacketSize) {
+    const uint8_t* packet = data + pos;
+    if (packet[0] != kTsSyncByte)
+      return false;
+    const int packet_pid = ((packet[1] & 0x1f) << 8) | packet[2];
+    // The adaptation field, whose length is in the fifth byte, and its
+    // PCR_flag.
+    const bool has_adaptation_field = (packet[3] & 0x20) != 0;
+    if (!has_adaptation_field || packet[4] < 7 || !(packet[5] & 0x10))
+      continue;
+    if (*pid >= 0 && packet_pid != *pid)
+      continue;
+    const int64_t pcr_base = (static_cast<int64_t>(packet[6]) << 25) |
+                             (packet[7] << 17) | (packet[8] << 9) |
+                             (packet[9] << 1) | (packet[10] >> 7);
+    const int64_t pcr_extension = ((packet[10] & 0x01) << 8) | packet[11];
+    *pid = packet_pid;
+    *pcr = pcr_base * 300 + pcr_extension;
+    return true;
+  }
+  return false;
+}
+
+// Computes the send times of the datagrams sent to a destination, from the
+// PCRs of the TS packets they carry, or from a constant bitrate. A pacer is
+// kept per destination across the files written to it, e.g. the segments of
+// a segment template, so that their datagrams are paced continuously.
+class UdpPacer {
+ public:
+  // Get the pacer of |destination|, which is created on first use.
+  static std::shared_ptr<UdpPacer> Get(const std::string& destination) {
+    // Leaked, like the pacers.
+    static base::Lock* lock = new base::Lock;
+    static auto* pacers = new std::map<std::string, std::shared_ptr<UdpPacer>>;
+    base::AutoLock auto_lock(*lock);
+    std::shared_ptr<UdpPacer>& pacer = (*pacers)[destination];
+    if (!pacer)
+      pacer.reset(new UdpPacer);
+    return pacer;
+  }
+
+  // @return the time at which to send the datagram |data|, in microseconds
+  //         on the clock of base::TimeTicks.
+  int64_t GetSendTime(const uint8_t* data,
+                      size_t size,
+                      uint64_t bitrate,
+                      bool pcr_pacing,
+                      int64_t now_us) {
+    int64_t pcr = 0;
+    if (pcr_pacing && FindPcr(data, size, &pcr_pid_, &pcr)) {
+      const int64_t pcr_delta = pcr - last_pcr_;
+      if (last_pcr_ < 0 || pcr_delta <= 0 ||
+          pcr_delta > kMaxPacingLagUs * kPcrTicksPerUs) {
+        // The first PCR, or a discontinuity.
+        anchor_pcr_ = pcr;
+        anchor_time_us_ = now_us;
+      } else {
+        pcr_bitrate_ = bytes_since_reference_ * 8 * kPcrTicksPerUs *
+                       base::Time::kMicrosecondsPerSecond / pcr_delta;
+      }
+      last_pcr_ = pcr;
+      reference_time_us_ =
+          anchor_time_us_ + (pcr - anchor_pcr_) / kPcrTicksPerUs;
+      bytes_since_reference_ = 0;
+    } else if (reference_time_us_ == 0) {
+      reference_time_us_ = now_us;
+    }
+
+    // The bitrate between the last two PCRs is used after the last PCR.
+    if (pcr_pacing && pcr_bitrate_ > 0)
+      bitrate = pcr_bitrate_;
+    int64_t send_time_us = reference_time_us_;
+    if (bitrate > 0) {
+      send_time_us += static_cast<int64_t>(
+          bytes_since_reference_ * 8 * base::Time::kMicrosecondsPerSecond /
+          bitrate);
+    }
+    if (bytes_since_reference_ > kMaxBytesSinceReference) {
+      reference_time_us_ = send_time_us;
+      bytes_since_reference_ = 0;
+    }
+    bytes_since_reference_ += size;
+
+    if (send_time_us < now_us - kMaxPacingLagUs) {
+      // Fell behind, e.g. because the input stalled. Start over rather than
+      // sending a burst to catch up.
+      const int64_t lag_us = now_us - send_time_us;
+      anchor_time_us_ += lag_us;
+      reference_time_us_ += lag_us;
+      send_time_us = now_us;
+    }
+    return send_time_us;
+  }
+
+ private:
+  // The reference point moves forward past this, so that the send times do
+  // not overflow.
+  static const uint64_t kMaxBytesSinceReference = 1ull << 32;
+
+  UdpPacer() = default;
+  UdpPacer(const UdpPacer&) = delete;
+  UdpPacer& operator=(const UdpPacer&) = delete;
+
+  // The PID carrying the PCRs.
+  int pcr_pid_ = -1;
+  int64_t last_pcr_ = -1;
+  // The send time of |anchor_pcr_|, from which the send times of the next
+  // PCRs follow.
+  int64_t anchor_pcr_ = 0;
+  int64_t anchor_time_us_ = 0;
+  // The send time of the last PCR, or of the first datagram without PCR
+  // pacing, and the bytes sent since.
+  int64_t reference_time_us_ = 0;
+  uint64_t bytes_since_reference_ = 0;
+  // The bitrate measured between the last two PCRs.
+  uint64_t pcr_bitrate_ = 0;
+};
+
+#if defined(__linux__)
+// The largest UDP payload is 65507 bytes over IPv4.
+const size_t kMaxDatagramSize = 65536;
+// Room for the SO_TIMESTAMPNS and SO_RXQ_OVFL control messages.
+const size_t kControlSize =
+    CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t));
+// The ring buffer size of the inputs of the event loop without buffer_size.
+const size_t kDefaultRingCapacity = 4 << 20;
+
+// Update |stats| with the number of datagrams dropped by the kernel since the
+// socket was opened.
+void UpdateKernelDrops(uint32_t drops, UdpFile::Stats* stats) {
+  if (drops > stats->kernel_drops) {
+    LOG(WARNING) << drops - stats->kernel_drops
+                 << " UDP datagram(s) dropped by the kernel. Consider "
+                    "increasing buffer_size.";
+    stats->kernel_drops = drops;
+  }
+}
+#endif  // defined(__linux__)
+
 }  // anonymous namespace
 
-UdpFile::UdpFile(const char* file_name)
-    : File(file_name), socket_(INVALID_SOCKET) {}
+#if defined(__linux__)
+
+// Receives up to |batch_size| datagrams per recvmmsg call into a preallocated
+// pool, from which they are then read one at a time. This saves a system call
+// per datagram on high bitrate streams.
+class UdpFile::BatchReceiver {
+ public:
+  explicit BatchReceiver(unsigned batch_size)
+      : pool_(batch_size * kMaxDatagramSize),
+        // uint64_t elements keep the control messages aligned.
+        control_(batch_size * kControlSize / sizeof(uint64_t)),
+        iovecs_(batch_size),
+        messages_(batch_size) {
+    static_assert(kControlSize % sizeof(uint64_t) == 0,
+                  "Control messages should be 64-bit aligned.");
+    for (unsigned i = 0; i < batch_size; ++i) {
+      iovecs_[i].iov_base = &pool_[i * kMaxDatagramSize];
+      iovecs_[i].iov_len = kMaxDatagramSize;
+      messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+      messages_[i].msg_hdr.msg_iovlen = 1;
+    }
+  }
+
+  // Copies the next datagram to |buffer|, receiving a new batch first if all
+  // the datagrams received were read.
+  int64_t Read(SOCKET socket,
+               void* buffer,
+               uint64_t length,
+               Stats* stats,
+               int64_t* timestamp_ns) {
+    if (next_message_ == num_messages_ && !Receive(socket))
+      return -1;
+    const struct mmsghdr& message = messages_[next_message_++];
+
+    uint32_t kernel_drops = stats->kernel_drops;
+    ParseUdpControlMessages(message.msg_hdr, timestamp_ns, &kernel_drops);
+    UpdateKernelDrops(kernel_drops, stats);
+
+    uint64_t datagram_size = message.msg_len;
+    if ((message.msg_hdr.msg_flags & MSG_TRUNC) || datagram_size > length) {
+      ++stats->truncated_datagrams;
+      datagram_size = std::min(datagram_size, length);
+    }
+    memcpy(buffer, message.msg_hdr.msg_iov->iov_base, datagram_size);
+    ++stats->datagrams;
+    return datagram_size;
+  }
+
+ private:
+  BatchReceiver(const BatchReceiver&) = delete;
+  BatchReceiver& operator=(const BatchReceiver&) = delete;
+
+  bool Receive(SOCKET socket) {
+    char* control = reinterpret_cast<char*>(control_.data());
+    for (size_t i = 0; i < messages_.size(); ++i) {
+      messages_[i].msg_hdr.msg_control = control + i * kControlSize;
+      messages_[i].msg_hdr.msg_controllen = kControlSize;
+      messages_[i].msg_hdr.msg_flags = 0;
+    }
+    int result;
+    do {
+      // Block for the first datagram only, then take what is queued.
+      result = recvmmsg(socket, messages_.data(), messages_.size(),
+                        MSG_WAITFORONE, nullptr);
+    } while (result == -1 && errno == EINTR);
+    if (result <= 0)
+      return false;
+    num_messages_ = result;
+    next_message_ = 0;
+    return true;
+  }
+
+  std::vector<uint8_t> pool_;
+  std::vector<uint64_t> control_;
+  std::vector<struct iovec> iovecs_;
+  std::vector<struct mmsghdr> messages_;
+  // The number of datagrams received in the last batch.
+  size_t num_messages_ = 0;
+  // The next datagram of the batch to read.
+  size_t next_message_ = 0;
+};
+
+// Reads the datagrams of a socket from its ring buffer, once the event loop
+// received them, and removes the socket from the event loop when done.
+class UdpFile::RingReader {
+ public:
+  RingReader(UdpEventLoop* event_loop,
+             SOCKET socket,
+             const std::shared_ptr<UdpEventLoop::Ring>& ring,
+             unsigned timeout_us)
+      : event_loop_(event_loop),
+        socket_(socket),
+        ring_(ring),
+        timeout_us_(timeout_us) {}
+
+  ~RingReader() { event_loop_->RemoveSocket(socket_); }
+
+  // Copies the next datagram to |buffer|, waiting for it up to the timeout.
+  int64_t Read(void* buffer,
+               uint64_t length,
+               Stats* stats,
+               int64_t* timestamp_ns) {
+    if (!ring_->Pop(timeout_us_, &datagram_))
+      return -1;
+    UpdateKernelDrops(datagram_.kernel_drops, stats);
+    if (datagram_.timestamp_ns != 0)
+      *timestamp_ns = datagram_.timestamp_ns;
+
+    uint64_t datagram_size = datagram_.data.size();
+    if (datagram_.truncated || datagram_size > length) {
+      ++stats->truncated_datagrams;
+      datagram_size = std::min(datagram_size, length);
+    }
+    memcpy(buffer, datagram_.data.data(), datagram_size);
+    ++stats->datagrams;
+    return datagram_size;
+  }
+
+  uint64_t ring_drops() { return ring_->ring_drops(); }
+
+ private:
+  RingReader(const RingReader&) = delete;
+  RingReader& operator=(const RingReader&) = delete;
+
+  UdpEventLoop* const event_loop_;
+  const SOCKET socket_;
+  std::shared_ptr<UdpEventLoop::Ring> ring_;
+  const unsigned timeout_us_;
+  // The last datagram read, whose buffer is swapped with the next one.
+  UdpEventLoop::Datagram datagram_;
+};
+
+#else
+
+class UdpFile::BatchReceiver {};
+class UdpFile::RingReader {};
+
+#endif  // defined(__linux__)
+
+// Sends the data written in datagrams of |datagram_size| bytes, up to
+// |batch_size| per sendmmsg call where supported, at the send times of the
+// pacer of the destination, if any.
+class UdpFile::Sender {
+ public:
+  Sender(const UdpOptions& options, std::shared_ptr<UdpPacer> pacer)
+      : datagram_size_(options.datagram_size()),
+        batch_size_(options.batch_size()),
+        bitrate_(options.bitrate()),
+        pcr_pacing_(options.pcr_pacing()),
+        txtime_(options.txtime()),
+        pacer_(std::move(pacer)),
+        pool_(batch_size_ * datagram_size_),
+        sizes_(batch_size_),
+        send_times_us_(batch_size_) {
+#if defined(__linux__)
+    // uint64_t elements keep the control messages aligned.
+    control_.resize(batch_size_ * kTxtimeControlSize / sizeof(uint64_t));
+    iovecs_.resize(batch_size_);
+    messages_.resize(batch_size_);
+    static_assert(kTxtimeControlSize % sizeof(uint64_t) == 0,
+                  "Control messages should be 64-bit aligned.");
+#endif  // defined(__linux__)
+  }
+
+  bool Write(SOCKET socket, const uint8_t* data, size_t size) {
+    size_t pos = 0;
+    if (!pending_.empty()) {
+      pos = std::min(datagram_size_ - pending_.size(), size);
+      pending_.insert(pending_.end(), data, data + pos);
+      if (pending_.size() < datagram_size_)
+        return true;
+      if (!QueueDatagram(socket, pending_.data(), pending_.size()))
+        return false;
+      pending_.clear();
+    }
+    for (; pos + datagram_size_ <= size; pos += datagram_size_) {
+      if (!QueueDatagram(socket, data + pos, datagram_size_))
+        return false;
+    }
+    pending_.assign(data + pos, data + size);
+    return true;
+  }
+
+  // Sends the data left, in a shorter datagram if it does not fill one.
+  bool Flush(SOCKET socket) {
+    if (!pending_.empty()) {
+      if (!QueueDatagram(socket, pending_.data(), pending_.size()))
+        return false;
+      pending_.clear();
+    }
+    return num_datagrams_ == 0 || SendBatch(socket);
+  }
+
+ private:
+  Sender(const Sender&) = delete;
+  Sender& operator=(const Sender&) = delete;
+
+#if defined(__linux__)
+  // Room for the SCM_TXTIME control message.
+  static const size_t kTxtimeControlSize = CMSG_SPACE(sizeof(uint64_t));
+  // The batches are handed to the kernel this early with SO_TXTIME.
+  static const int64_t kTxtimeLeadUs = 2000;
+#endif  // defined(__linux__)
+
+  // Adds a datagram to the batch, sending the batch first if it is full, or
+  // if the datagram is due later than the batch without SO_TXTIME.
+  bool QueueDatagram(SOCKET socket, const uint8_t* data, size_t size) {
+    const int64_t send_time_us =
+        pacer_ ? pacer_->GetSendTime(data, size, bitrate_, pcr_pacing_,
+                                     NowUs())
+               : 0;
+    if (num_datagrams_ == batch_size_ ||
+        (num_datagrams_ > 0 && !txtime_ &&
+         send_time_us > send_times_us_[0] + kPacingSlackUs)) {
+      if (!SendBatch(socket))
+        return false;
+    }
+    memcpy(&pool_[num_datagrams_ * datagram_size_], data, size);
+    sizes_[num_datagrams_] = size;
+    send_times_us_[num_datagrams_] = send_time_us;
+    ++num_datagrams_;
+    return true;
+  }
+
+  bool SendBatch(SOCKET socket) {
+    DCHECK_GT(num_datagrams_, 0u);
+    // Wait for the first datagram to be due, or, with SO_TXTIME, to be close
+    // enough to be scheduled by the kernel.
+    int64_t wait_until_us = send_times_us_[0];
+#if defined(__linux__)
+    if (txtime_)
+      wait_until_us -= kTxtimeLeadUs;
+#endif  // defined(__linux__)
+    const int64_t now_us = NowUs();
+    if (send_times_us_[0] > 0 && wait_until_us > now_us) {
+      base::PlatformThread::Sleep(
+          base::TimeDelta::FromMicroseconds(wait_until_us - now_us));
+    }
+
+#if defined(__linux__)
+    char* control = reinterpret_cast<char*>(control_.data());
+    for (size_t i = 0; i < num_datagrams_; ++i) {
+      iovecs_[i].iov_base = &pool_[i * datagram_size_];
+      iovecs_[i].iov_len = sizes_[i];
+      struct msghdr& message = messages_[i].msg_hdr;
+      message = {};
+      message.msg_iov = &iovecs_[i];
+      message.msg_iovlen = 1;
+      if (txtime_ && send_times_us_[i] > 0) {
+        message.msg_control = control + i * kTxtimeControlSize;
+        message.msg_controllen = kTxtimeControlSize;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_TXTIME;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+        const uint64_t send_time_ns =
+            send_times_us_[i] * base::Time::kNanosecondsPerMicrosecond;
+        memcpy(CMSG_DATA(cmsg), &send_time_ns, sizeof(send_time_ns));
+      }
+    }
+    size_t sent = 0;
+    while (sent < num_datagrams_) {
+      const int result =
+          sendmmsg(socket, &messages_[sent], num_datagrams_ - sent, 0);
+      if (result < 0) {
+        if (errno == EINTR)
+          continue;
+        LOG(ERROR) << "Failed to send UDP datagrams, error = " << errno;
+        return false;
+      }
+      sent += result;
+    }
+#else
+    for (size_t i = 0; i < num_datagrams_; ++i) {
+      int result;
+      do {
+        result = send(socket,
+                      reinterpret_cast<const char*>(&pool_[i * datagram_size_]),
+                      sizes_[i], 0);
+      } while (result == -1 && GetSocketErrorCode() == EINTR_CODE);
+      if (result < 0) {
+        LOG(ERROR) << "Failed to send UDP datagram, error = "
+                   << GetSocketErrorCode();
+        return false;
+      }
+    }
+#endif  // defined(__linux__)
+    num_datagrams_ = 0;
+    return true;
+  }
+
+  const size_t datagram_size_;
+  const size_t batch_size_;
+  const uint64_t bitrate_;
+  const bool pcr_pacing_;
+  const bool txtime_;
+  // Null if the datagrams are not paced.
+  std::shared_ptr<UdpPacer> pacer_;
+  // The data written which does not fill a datagram yet.
+  std::vector<uint8_t> pending_;
+  // The datagrams of the batch, with their sizes and send times.
+  std::vector<uint8_t> pool_;
+  std::vector<size_t> sizes_;
+  std::vector<int64_t> send_times_us_;
+  size_t num_datagrams_ = 0;
+#if defined(__linux__)
+  std::vector<uint64_t> control_;
+  std::vector<struct iovec> iovecs_;
+  std::vector<struct mmsghdr> messages_;
+#endif  // defined(__linux__)
+};
+
+UdpFile::UdpFile(const char* file_name, const char* mode)
+    : File(file_name),
+      send_mode_(strcmp(mode, "w") == 0),
+      socket_(INVALID_SOCKET) {}
 
 UdpFile::~UdpFile() {}
 
 bool UdpFile::Close() {
+  bool result = true;
+  if (sender_ && socket_ != INVALID_SOCKET)
+    result = sender_->Flush(socket_);
+#if defined(__linux__)
+  if (ring_reader_) {
+    stats_.ring_drops = ring_reader_->ring_drops();
+    // Before the socket is closed, and its descriptor possibly reused.
+    ring_reader_.reset();
+  }
+#endif  // defined(__linux__)
+  if (stats_.kernel_drops > 0 || stats_.truncated_datagrams > 0 ||
+      stats_.ring_drops > 0) {
+    LOG(WARNING) << file_name() << ": received " << stats_.datagrams
+                 << " datagram(s), " << stats_.kernel_drops
+                 << " dropped by the kernel, " << stats_.ring_drops
+                 << " dropped by the event loop, "
+                 << stats_.truncated_datagrams << " truncated.";
+  }
   if (socket_ != INVALID_SOCKET) {
     close(socket_);
     socket_ = INVALID_SOCKET;
   }
-  delete this;
 #if defined(OS_WIN)
   if (wsa_started_)
     WSACleanup();
 #endif
-  return true;
+  delete this;
+  return result;
 }
 
 int64_t UdpFile::Read(void* buffer, uint64_t length) {
@@ -78,21 +595,35 @@ int64_t UdpFile::Read(void* buffer, uint64_t length) {
   DCHECK_GE(length, 65535u)
       << "Buffer may be too small to read entire datagram.";
 
-  if (socket_ == INVALID_SOCKET)
+  if (socket_ == INVALID_SOCKET || send_mode_)
     return -1;
 
+#if defined(__linux__)
+  if (ring_reader_)
+    return ring_reader_->Read(buffer, length, &stats_, &last_timestamp_ns_);
+  return batch_receiver_->Read(socket_, buffer, length, &stats_,
+                               &last_timestamp_ns_);
+#else
   int64_t result;
   do {
     result =
         recvfrom(socket_, reinterpret_cast<char*>(buffer), length, 0, NULL, 0);
   } while (result == -1 && GetSocketErrorCode() == EINTR_CODE);
 
+  if (result >= 0)
+    ++stats_.datagrams;
   return result;
+#endif  // defined(__linux__)
 }
 
 int64_t UdpFile::Write(const void* buffer, uint64_t length) {
-  NOTIMPLEMENTED();
-  return -1;
+  DCHECK(buffer);
+
+  if (socket_ == INVALID_SOCKET || !send_mode_)
+    return -1;
+  if (!sender_->Write(socket_, static_cast<const uint8_t*>(buffer), length))
+    return -1;
+  return length;
 }
 
 int64_t UdpFile::Size() {
@@ -103,8 +634,9 @@ int64_t UdpFile::Size() {
 }
 
 bool UdpFile::Flush() {
-  NOTIMPLEMENTED();
-  return false;
+  if (socket_ == INVALID_SOCKET || !send_mode_)
+    return false;
+  return sender_->Flush(socket_);
 }
 
 bool UdpFile::Seek(uint64_t position) {
@@ -170,6 +702,9 @@ bool UdpFile::Open() {
     return false;
   }
 
+  if (send_mode_)
+    return OpenSender(*options, local_in_addr, &new_socket);
+
   struct sockaddr_in local_sock_addr = {0};
   // TODO(kqyang): Support IPv6.
   local_sock_addr.sin_family = AF_INET;
@@ -290,8 +825,146 @@ bool UdpFile::Open() {
     }
   }
 
+#if defined(__linux__)
+  if (options->busy_poll_us() > 0) {
+    const int busy_poll_us = options->busy_poll_us();
+    if (setsockopt(new_socket.get(), SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us,
+                   sizeof(busy_poll_us)) < 0) {
+      LOG(ERROR) << "Failed to set SO_BUSY_POLL, error = "
+                 << GetSocketErrorCode();
+      return false;
+    }
+  }
+
+  if (options->timestamp()) {
+    const int optval = 1;
+    if (setsockopt(new_socket.get(), SOL_SOCKET, SO_TIMESTAMPNS, &optval,
+                   sizeof(optval)) < 0) {
+      LOG(ERROR) << "Failed to enable SO_TIMESTAMPNS, error = "
+                 << GetSocketErrorCode();
+      return false;
+    }
+  }
+
+  // Report the datagrams dropped by the kernel. Best effort.
+  const int optval_one = 1;
+  if (setsockopt(new_socket.get(), SOL_SOCKET, SO_RXQ_OVFL, &optval_one,
+                 sizeof(optval_one)) < 0) {
+    LOG(WARNING) << "Failed to enable SO_RXQ_OVFL, error = "
+                 << GetSocketErrorCode();
+  }
+
+  UdpEventLoop* event_loop = UdpEventLoop::GetInstance();
+  if (event_loop) {
+    const size_t ring_capacity = options->buffer_size() > 0
+                                     ? options->buffer_size()
+                                     : kDefaultRingCapacity;
+    std::shared_ptr<UdpEventLoop::Ring> ring = event_loop->AddSocket(
+        new_socket.get(), options->batch_size(), ring_capacity);
+    if (!ring)
+      return false;
+    ring_reader_.reset(new RingReader(event_loop, new_socket.get(), ring,
+                                      options->timeout_us()));
+  } else {
+    batch_receiver_.reset(new BatchReceiver(options->batch_size()));
+  }
+#endif  // defined(__linux__)
+
   socket_ = new_socket.release();
   return true;
 }
 
+bool UdpFile::OpenSender(const UdpOptions& options,
+                         const struct in_addr& address,
+                         ScopedSocket* new_socket) {
+  if (IsIpv4MulticastAddress(address)) {
+    if (options.interface_address() != "0.0.0.0") {
+      struct in_addr interface_in_addr = {0};
+      if (inet_pton(AF_INET, options.interface_address().c_str(),
+                    &interface_in_addr) != 1) {
+        LOG(ERROR) << "Malformed IPv4 interface address "
+                   << options.interface_address();
+        return false;
+      }
+      if (setsockopt(new_socket->get(), IPPROTO_IP, IP_MULTICAST_IF,
+                     reinterpret_cast<const char*>(&interface_in_addr),
+                     sizeof(interface_in_addr)) < 0) {
+        LOG(ERROR) << "Failed to set the multicast interface, error = "
+                   << GetSocketErrorCode();
+        return false;
+      }
+    }
+    if (options.ttl() > 0) {
+      const int ttl = options.ttl();
+      if (setsockopt(new_socket->get(), IPPROTO_IP, IP_MULTICAST_TTL,
+                     reinterpret_cast<const char*>(&ttl), sizeof(ttl)) < 0) {
+        LOG(ERROR) << "Failed to set the multicast TTL, error = "
+                   << GetSocketErrorCode();
+        return false;
+      }
+    }
+  } else if (options.ttl() > 0) {
+    const int ttl = options.ttl();
+    if (setsockopt(new_socket->get(), IPPROTO_IP, IP_TTL,
+                   reinterpret_cast<const char*>(&ttl), sizeof(ttl)) < 0) {
+      LOG(ERROR) << "Failed to set the TTL, error = " << GetSocketErrorCode();
+      return false;
+    }
+  }
+
+  if (options.buffer_size() > 0) {
+    const int send_buffer_size = options.buffer_size();
+    if (setsockopt(new_socket->get(), SOL_SOCKET, SO_SNDBUF,
+                   reinterpret_cast<const char*>(&send_buffer_size),
+                   sizeof(send_buffer_size)) < 0) {
+      LOG(ERROR) << "Failed to set the maximum send buffer size, error = "
+                 << GetSocketErrorCode();
+      return false;
+    }
+  }
+
+  if (options.txtime()) {
+#if defined(__linux__)
+    // struct sock_txtime, which older headers lack. The send times are on
+    // CLOCK_MONOTONIC, the clock of base::TimeTicks, which the fq qdisc
+    // supports.
+    struct {
+      clockid_t clockid;
+      uint32_t flags;
+    } sock_txtime = {CLOCK_MONOTONIC, 0};
+    if (setsockopt(new_socket->get(), SOL_SOCKET, SO_TXTIME, &sock_txtime,
+                   sizeof(sock_txtime)) < 0) {
+      LOG(ERROR) << "Failed to enable SO_TXTIME, error = "
+                 << GetSocketErrorCode();
+      return false;
+    }
+#else
+    LOG(ERROR) << "The txtime udp option is only supported on Linux.";
+    return false;
+#endif  // defined(__linux__)
+  }
+
+  struct sockaddr_in remote_sock_addr = {0};
+  remote_sock_addr.sin_family = AF_INET;
+  remote_sock_addr.sin_port = htons(options.port());
+  remote_sock_addr.sin_addr = address;
+  if (connect(new_socket->get(),
+              reinterpret_cast<struct sockaddr*>(&remote_sock_addr),
+              sizeof(remote_sock_addr)) < 0) {
+    LOG(ERROR) << "Could not connect UDP socket to " << options.address()
+               << ":" << options.port() << ", error = "
+               << GetSocketErrorCode();
+    return false;
+  }
+
+  std::shared_ptr<UdpPacer> pacer;
+  if (options.bitrate() > 0 || options.pcr_pacing()) {
+    pacer = UdpPacer::Get(options.address() + ":" +
+                          std::to_string(options.port()));
+  }
+  sender_.reset(new Sender(options, std::move(pacer)));
+  socket_ = new_socket->release();
+  return true;
+}
+
 }  // namespace shaka
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 
 #include "packager/base/compiler_specific.h"
@@ -20,14 +21,36 @@
 typedef int SOCKET;
 #endif  // defined(OS_WIN)
 
+struct in_addr;
+
 namespace shaka {
 
-/// Implements UdpFile, which receives UDP unicast and multicast streams.
+class ScopedSocket;
+class UdpOptions;
+
+/// Implements UdpFile, which receives or sends UDP unicast and multicast
+/// streams.
 class UdpFile : public File {
  public:
-  /// @param file_name C string containing the address of the stream to receive.
-  ///        It should be of the form "<ip_address>:<port>".
-  explicit UdpFile(const char* address_and_port);
+  /// @param file_name C string containing the address of the stream to receive
+  ///        or send. It should be of the form "<ip_address>:<port>".
+  /// @param mode C string containing the open mode, "r" to receive or "w" to
+  ///        send.
+  UdpFile(const char* address_and_port, const char* mode);
+
+  /// Receive statistics.
+  struct Stats {
+    /// Number of datagrams read.
+    uint64_t datagrams = 0;
+    /// Number of datagrams dropped by the kernel because the socket receive
+    /// buffer overran. Only reported on Linux.
+    uint64_t kernel_drops = 0;
+    /// Number of datagrams truncated because they did not fit in the buffer.
+    uint64_t truncated_datagrams = 0;
+    /// Number of datagrams dropped because the ring buffer of the UDP event
+    /// loop overran, see --udp_event_loop_threads.
+    uint64_t ring_drops = 0;
+  };
 
   /// @name File implementation overrides.
   /// @{
@@ -40,13 +63,39 @@ class UdpFile : public File {
   bool Tell(uint64_t* position) override;
   /// @}
 
+  /// @return the receive statistics.
+  const Stats& stats() const { return stats_; }
+
+  /// @return the kernel receive timestamp of the last datagram read, in
+  ///         nanoseconds since the epoch, or 0 if the timestamp option is not
+  ///         set or not supported.
+  int64_t last_timestamp_ns() const { return last_timestamp_ns_; }
+
  protected:
   ~UdpFile() override;
 
   bool Open() override;
 
  private:
+  // Receives batches of datagrams with recvmmsg.
+  class BatchReceiver;
+  // Reads the datagrams received by the UDP event loop.
+  class RingReader;
+  // Sends the data written in paced batches of datagrams.
+  class Sender;
+
+  // Set up |new_socket| to send to |address|.
+  bool OpenSender(const UdpOptions& options,
+                  const struct in_addr& address,
+                  ScopedSocket* new_socket);
+
+  const bool send_mode_;
   SOCKET socket_;
+  std::unique_ptr<BatchReceiver> batch_receiver_;
+  std::unique_ptr<RingReader> ring_reader_;
+  std::unique_ptr<Sender> sender_;
+  Stats stats_;
+  int64_t last_timestamp_ns_ = 0;
 #if defined(OS_WIN)
   // For Winsock in Windows.
   bool wsa_started_ = false;
@@ -22,11 +22,19 @@ namespace {
 
 enum FieldType {
   kUnknownField = 0,
+  kBatchSizeField,
   kBufferSizeField,
+  kBitrateField,
+  kBusyPollField,
+  kDatagramSizeField,
   kInterfaceAddressField,
   kMulticastSourceField,
+  kPcrPacingField,
   kReuseField,
   kTimeoutField,
+  kTimestampField,
+  kTtlField,
+  kTxtimeField,
 };
 
 struct FieldNameToTypeMapping {
@@ -35,11 +43,19 @@ struct FieldNameToTypeMapping {
 };
 
 const FieldNameToTypeMapping kFieldNameTypeMappings[] = {
+    {"batch_size", kBatchSizeField},
+    {"bitrate", kBitrateField},
     {"buffer_size", kBufferSizeField},
+    {"busy_poll", kBusyPollField},
+    {"datagram_size", kDatagramSizeField},
     {"interface", kInterfaceAddressField},
+    {"pcr_pacing", kPcrPacingField},
     {"reuse", kReuseField},
     {"source", kMulticastSourceField},
     {"timeout", kTimeoutField},
+    {"timestamp", kTimestampField},
+    {"ttl", kTtlField},
+    {"txtime", kTxtimeField},
 };
 
 FieldType GetFieldType(const std::string& field_name) {
@@ -89,6 +105,21 @@ std::unique_ptr<UdpOptions> UdpOptions::ParseFromString(
     }
     for (const auto& pair : pairs) {
       switch (GetFieldType(pair.first)) {
+        case kBatchSizeField:
+          if (!base::StringToUint(pair.second, &options->batch_size_) ||
+              options->batch_size_ == 0) {
+            LOG(ERROR) << "Invalid udp option for batch_size field "
+                       << pair.second;
+            return nullptr;
+          }
+          break;
+        case kBitrateField:
+          if (!base::StringToUint64(pair.second, &options->bitrate_)) {
+            LOG(ERROR) << "Invalid udp option for bitrate field "
+                       << pair.second;
+            return nullptr;
+          }
+          break;
         case kBufferSizeField:
           if (!base::StringToInt(pair.second, &options->buffer_size_)) {
             LOG(ERROR) << "Invalid udp option for buffer_size field "
@@ -96,6 +127,23 @@ std::unique_ptr<UdpOptions> UdpOptions::ParseFromString(
             return nullptr;
           }
           break;
+        case kBusyPollField:
+          if (!base::StringToUint(pair.second, &options->busy_poll_us_)) {
+            LOG(ERROR) << "Invalid udp option for busy_poll field "
+                       << pair.second;
+            return nullptr;
+          }
+          break;
+        case kDatagramSizeField:
+          // The largest UDP payload is 65507 bytes over IPv4.
+          if (!base::StringToUint(pair.second, &options->datagram_size_) ||
+              options->datagram_size_ == 0 ||
+              options->datagram_size_ > 65507) {
+            LOG(ERROR) << "Invalid udp option for datagram_size field "
+                       << pair.second;
+            return nullptr;
+          }
+          break;
         case kInterfaceAddressField:
           options->interface_address_ = pair.second;
           break;
@@ -103,6 +151,16 @@ std::unique_ptr<UdpOptions> UdpOptions::ParseFromString(
           options->source_address_ = pair.second;
           options->is_source_specific_multicast_ = true;
           break;
+        case kPcrPacingField: {
+          int pcr_pacing_value = 0;
+          if (!base::StringToInt(pair.second, &pcr_pacing_value)) {
+            LOG(ERROR) << "Invalid udp option for pcr_pacing field "
+                       << pair.second;
+            return nullptr;
+          }
+          options->pcr_pacing_ = pcr_pacing_value > 0;
+          break;
+        }
         case kReuseField: {
           int reuse_value = 0;
           if (!base::StringToInt(pair.second, &reuse_value)) {
@@ -119,6 +177,33 @@ std::unique_ptr<UdpOptions> UdpOptions::ParseFromString(
             return nullptr;
           }
           break;
+        case kTimestampField: {
+          int timestamp_value = 0;
+          if (!base::StringToInt(pair.second, &timestamp_value)) {
+            LOG(ERROR) << "Invalid udp option for timestamp field "
+                       << pair.second;
+            return nullptr;
+          }
+          options->timestamp_ = timestamp_value > 0;
+          break;
+        }
+        case kTtlField:
+          if (!base::StringToInt(pair.second, &options->ttl_) ||
+              options->ttl_ < 0 || options->ttl_ > 255) {
+            LOG(ERROR) << "Invalid udp option for ttl field " << pair.second;
+            return nullptr;
+          }
+          break;
+        case kTxtimeField: {
+          int txtime_value = 0;
+          if (!base::StringToInt(pair.second, &txtime_value)) {
+            LOG(ERROR) << "Invalid udp option for txtime field "
+                       << pair.second;
+            return nullptr;
+          }
+          options->txtime_ = txtime_value > 0;
+          break;
+        }
         default:
           LOG(ERROR) << "Unknown field in udp options (\"" << pair.first
                      << "\").";
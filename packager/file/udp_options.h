@@ -12,6 +12,7 @@
 namespace shaka {
 
 /// Options parsed from UDP url string of the form: udp://ip:port[?options]
+/// The same url is used to receive from and to send to ip:port.
 class UdpOptions {
  public:
   ~UdpOptions() = default;
@@ -31,6 +32,14 @@ class UdpOptions {
     return is_source_specific_multicast_;
   }
   int buffer_size() const { return buffer_size_; }
+  unsigned batch_size() const { return batch_size_; }
+  unsigned busy_poll_us() const { return busy_poll_us_; }
+  bool timestamp() const { return timestamp_; }
+  unsigned datagram_size() const { return datagram_size_; }
+  uint64_t bitrate() const { return bitrate_; }
+  bool pcr_pacing() const { return pcr_pacing_; }
+  bool txtime() const { return txtime_; }
+  int ttl() const { return ttl_; }
 
  private:
   UdpOptions() = default;
@@ -47,11 +56,30 @@ class UdpOptions {
   // Source specific multicast source address
   std::string source_address_ = "0.0.0.0";
   bool is_source_specific_multicast_ = false;
-  // Maximum receive buffer size in bytes.
+  // Maximum receive, or send, buffer size in bytes.
   // Note that the actual buffer size is capped by the maximum buffer size set
   // by the underlying operating system ('sysctl net.core.rmem_max' on Linux
   // returns the maximum receive memory size).
   int buffer_size_ = 0;
+  // Maximum number of datagrams received, or sent, per system call, where
+  // supported.
+  unsigned batch_size_ = 32;
+  // Busy poll time in microseconds (SO_BUSY_POLL). 0 to disable busy polling.
+  unsigned busy_poll_us_ = 0;
+  // Enable kernel receive timestamps.
+  bool timestamp_ = false;
+  // Size of the datagrams sent, 7 TS packets by default.
+  unsigned datagram_size_ = 7 * 188;
+  // Bitrate at which the datagrams are sent, in bits per second. 0 to send
+  // them as fast as possible, unless they are paced by PCR.
+  uint64_t bitrate_ = 0;
+  // Pace the datagrams sent by the PCRs of the TS packets they carry.
+  bool pcr_pacing_ = false;
+  // Schedule the datagrams sent in the kernel with SO_TXTIME, instead of
+  // waiting for their send times.
+  bool txtime_ = false;
+  // Time to live of the multicast datagrams sent. 0 for the system default.
+  int ttl_ = 0;
 };
 
 }  // namespace shaka
@@ -122,4 +122,55 @@ TEST_F(UdpOptionsTest, BufferSize) {
   EXPECT_EQ(1234, options->buffer_size());
 }
 
+TEST_F(UdpOptionsTest, BatchSize) {
+  auto options = UdpOptions::ParseFromString("224.1.2.30:88");
+  EXPECT_EQ(32u, options->batch_size());
+  options = UdpOptions::ParseFromString("224.1.2.30:88?batch_size=64");
+  EXPECT_EQ(64u, options->batch_size());
+}
+
+TEST_F(UdpOptionsTest, InvalidBatchSize) {
+  ASSERT_FALSE(UdpOptions::ParseFromString("224.1.2.30:88?batch_size=0"));
+  ASSERT_FALSE(UdpOptions::ParseFromString("224.1.2.30:88?batch_size=-1"));
+}
+
+TEST_F(UdpOptionsTest, BusyPollAndTimestamp) {
+  auto options = UdpOptions::ParseFromString("224.1.2.30:88");
+  EXPECT_EQ(0u, options->busy_poll_us());
+  EXPECT_FALSE(options->timestamp());
+  options =
+      UdpOptions::ParseFromString("224.1.2.30:88?busy_poll=50&timestamp=1");
+  EXPECT_EQ(50u, options->busy_poll_us());
+  EXPECT_TRUE(options->timestamp());
+}
+
+TEST_F(UdpOptionsTest, InvalidBusyPoll) {
+  ASSERT_FALSE(UdpOptions::ParseFromString("224.1.2.30:88?busy_poll=1a"));
+}
+
+TEST_F(UdpOptionsTest, SendOptions) {
+  auto options = UdpOptions::ParseFromString("224.1.2.30:88");
+  EXPECT_EQ(1316u, options->datagram_size());
+  EXPECT_EQ(0u, options->bitrate());
+  EXPECT_FALSE(options->pcr_pacing());
+  EXPECT_FALSE(options->txtime());
+  EXPECT_EQ(0, options->ttl());
+  options = UdpOptions::ParseFromString(
+      "224.1.2.30:88?datagram_size=188&bitrate=5000000&pcr_pacing=1&txtime=1&"
+      "ttl=16");
+  EXPECT_EQ(188u, options->datagram_size());
+  EXPECT_EQ(5000000u, options->bitrate());
+  EXPECT_TRUE(options->pcr_pacing());
+  EXPECT_TRUE(options->txtime());
+  EXPECT_EQ(16, options->ttl());
+}
+
+TEST_F(UdpOptionsTest, InvalidSendOptions) {
+  ASSERT_FALSE(UdpOptions::ParseFromString("224.1.2.30:88?datagram_size=0"));
+  ASSERT_FALSE(
+      UdpOptions::ParseFromString("224.1.2.30:88?datagram_size=65508"));
+  ASSERT_FALSE(UdpOptions::ParseFromString("224.1.2.30:88?bitrate=fast"));
+  ASSERT_FALSE(UdpOptions::ParseFromString("224.1.2.30:88?ttl=256"));
+}
+
 }  // namespace shaka
@@ -65,6 +65,24 @@ class HlsNotifier {
                                 uint64_t start_byte_offset,
                                 uint64_t size) = 0;
 
+  /// Called when a partial segment, i.e. a low latency chunk of the segment
+  /// being written, is available. Must be called before NotifyNewSegment() on
+  /// the segment containing it.
+  /// @param stream_id is the value set by NotifyNewStream().
+  /// @param segment_name is the name of the segment containing the part.
+  /// @param start_time is the start time of the part in timescale units
+  ///        passed in @a media_info.
+  /// @param duration is also in terms of timescale.
+  /// @param start_byte_offset is the offset of the part in the segment.
+  /// @param size is the size in bytes.
+  /// @return true on success, false otherwise.
+  virtual bool NotifyNewPart(uint32_t stream_id,
+                             const std::string& segment_name,
+                             uint64_t start_time,
+                             uint64_t duration,
+                             uint64_t start_byte_offset,
+                             uint64_t size) = 0;
+
   /// Called on every key frame. For Video only.
   /// @param stream_id is the value set by NotifyNewStream().
   /// @param timestamp is the timesamp of the key frame in timescale units
@@ -96,6 +114,31 @@ class HlsNotifier {
       const std::vector<uint8_t>& iv,
       const std::vector<uint8_t>& protection_system_specific_data) = 0;
 
+  /// Restore the sequence numbers of a stream of a restarted live session, see
+  /// LiveCheckpoint. Must be called before any segment of the stream is
+  /// notified.
+  /// @param stream_id is the value set by NotifyNewStream().
+  /// @param media_sequence_number is the media sequence number of the next
+  ///        segment.
+  /// @param discontinuity_sequence_number is the discontinuity sequence
+  ///        number of the next segment.
+  /// @return true on success, false otherwise, e.g. if it is not supported.
+  virtual bool SetSequenceNumbers(uint32_t stream_id,
+                                  uint32_t media_sequence_number,
+                                  int discontinuity_sequence_number) {
+    return false;
+  }
+
+  /// Remove the playlists of a stream detached from a running live session,
+  /// see Packager::RemoveInput(), from the master playlist. The stream must
+  /// not be notified anymore.
+  /// @param segment_template is the segment template of the stream, as in
+  ///        the MediaInfo passed to NotifyNewStream().
+  /// @return true on success, false otherwise, e.g. if it is not supported.
+  virtual bool RemoveStream(const std::string& segment_template) {
+    return false;
+  }
+
   /// Process any current buffered states/resources.
   /// @return true on success, false otherwise.
   virtual bool Flush() = 0;
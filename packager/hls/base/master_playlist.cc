@@ -14,9 +14,9 @@
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/file/file.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/hls/base/tag.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/version/version.h"
 
 namespace shaka {
@@ -465,7 +465,8 @@ MasterPlaylist::MasterPlaylist(const std::string& file_name,
                                const std::string& default_audio_language,
                                const std::string& default_text_language,
                                bool is_independent_segments)
-    : file_name_(file_name),
+    : file_writer_("hls"),
+      file_name_(file_name),
       default_audio_language_(default_audio_language),
       default_text_language_(default_text_language),
       is_independent_segments_(is_independent_segments) {}
@@ -476,6 +477,8 @@ bool MasterPlaylist::WriteMasterPlaylist(
     const std::string& base_url,
     const std::string& output_dir,
     const std::list<MediaPlaylist*>& playlists) {
+  ScopedTraceEvent trace_event("MasterPlaylist::WriteMasterPlaylist",
+                               "manifest");
   std::string content = "#EXTM3U\n";
   AppendVersionString(&content);
   
@@ -485,19 +488,14 @@ bool MasterPlaylist::WriteMasterPlaylist(
   AppendPlaylists(default_audio_language_, default_text_language_, base_url,
                   playlists, &content);
 
-  // Skip if the playlist is already written.
-  if (content == written_playlist_)
-    return true;
-
   std::string file_path =
       base::FilePath::FromUTF8Unsafe(output_dir)
           .Append(base::FilePath::FromUTF8Unsafe(file_name_))
           .AsUTF8Unsafe();
-  if (!File::WriteFileAtomically(file_path.c_str(), content)) {
+  if (!file_writer_.Write(file_path, content)) {
     LOG(ERROR) << "Failed to write master playlist to: " << file_path;
     return false;
   }
-  written_playlist_ = content;
   return true;
 }
 
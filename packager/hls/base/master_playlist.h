@@ -10,6 +10,8 @@
 #include <list>
 #include <string>
 
+#include "packager/mpd/base/manifest_file_writer.h"
+
 namespace shaka {
 namespace hls {
 
@@ -43,11 +45,16 @@ class MasterPlaylist {
                                    const std::string& output_dir,
                                    const std::list<MediaPlaylist*>& playlists);
 
+  /// Also write a gzip copy of the master playlist, with a ".gz" extension.
+  void set_write_gzip_copies(bool write_gzip_copies) {
+    file_writer_.set_write_gzip_copies(write_gzip_copies);
+  }
+
  private:
   MasterPlaylist(const MasterPlaylist&) = delete;
   MasterPlaylist& operator=(const MasterPlaylist&) = delete;
 
-  std::string written_playlist_;
+  ManifestFileWriter file_writer_;
   const std::string file_name_;
   const std::string default_audio_language_;
   const std::string default_text_language_;
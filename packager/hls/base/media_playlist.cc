@@ -12,13 +12,16 @@
 #include <cmath>
 #include <memory>
 
+#include "packager/base/files/file_path.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/file/file.h"
+#include "packager/file/segment_reaper.h"
 #include "packager/hls/base/tag.h"
 #include "packager/media/base/language_utils.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/metrics/metrics.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/version/version.h"
 
 namespace shaka {
@@ -37,6 +40,19 @@ uint32_t GetTimeScale(const MediaInfo& media_info) {
   return 0u;
 }
 
+// The segments out of the time shift buffer are not kept only for the
+// bandwidth estimate. Note that a window of 0, i.e. all the segments, does not
+// keep the segments.
+double GetBandwidthEstimationWindow(const HlsParams& hls_params) {
+  if (hls_params.playlist_type == HlsPlaylistType::kLive &&
+      hls_params.time_shift_buffer_depth > 0 &&
+      hls_params.bandwidth_estimation_window >
+          hls_params.time_shift_buffer_depth) {
+    return hls_params.time_shift_buffer_depth;
+  }
+  return hls_params.bandwidth_estimation_window;
+}
+
 std::string AdjustVideoCodec(const std::string& codec) {
   // Apple does not like video formats with the parameter sets stored in the
   // samples. It also fails mediastreamvalidator checks and some Apple devices /
@@ -107,7 +123,9 @@ std::string CreatePlaylistHeader(
     HlsPlaylistType type,
     MediaPlaylist::MediaPlaylistStreamType stream_type,
     uint32_t media_sequence_number,
-    int discontinuity_sequence_number) {
+    int discontinuity_sequence_number,
+    double part_target_duration,
+    double skip_boundary) {
   const std::string version = GetPackagerVersion();
   std::string version_line;
   if (!version.empty()) {
@@ -116,13 +134,30 @@ std::string CreatePlaylistHeader(
                            GetPackagerProjectUrl().c_str(), version.c_str());
   }
 
-  // 6 is required for EXT-X-MAP without EXT-X-I-FRAMES-ONLY.
+  // 6 is required for EXT-X-MAP without EXT-X-I-FRAMES-ONLY, 9 for
+  // EXT-X-SKIP.
   std::string header = base::StringPrintf(
       "#EXTM3U\n"
-      "#EXT-X-VERSION:6\n"
+      "#EXT-X-VERSION:%d\n"
       "%s"
       "#EXT-X-TARGETDURATION:%d\n",
-      version_line.c_str(), target_duration);
+      skip_boundary > 0 ? 9 : 6, version_line.c_str(), target_duration);
+
+  if (skip_boundary > 0 || part_target_duration > 0) {
+    // A file based packager cannot serve blocking playlist reloads, so only
+    // the delta updates and the hold back are advertised. Three part target
+    // durations is the recommended minimum hold back.
+    Tag tag("#EXT-X-SERVER-CONTROL", &header);
+    if (skip_boundary > 0)
+      tag.AddFloat("CAN-SKIP-UNTIL", skip_boundary);
+    if (part_target_duration > 0)
+      tag.AddFloat("PART-HOLD-BACK", 3 * part_target_duration);
+    header += '\n';
+  }
+  if (part_target_duration > 0) {
+    base::StringAppendF(&header, "#EXT-X-PART-INF:PART-TARGET=%.3f\n",
+                        part_target_duration);
+  }
 
   switch (type) {
     case HlsPlaylistType::kVod:
@@ -164,13 +199,18 @@ class SegmentInfoEntry : public HlsEntry {
   // specify the start byte offset in the tag.
   // |start_time| is in timescale.
   // |duration_seconds| is duration in seconds.
-  SegmentInfoEntry(const std::string& file_name,
+  // |file_name| is shared by the consecutive entries of the same file, e.g. the
+  // I-frames of a segment or the segments of a single file.
+  // |program_date_time| is the wall clock time of the start of the segment,
+  // tagged with EXT-X-PROGRAM-DATE-TIME unless it is null.
+  SegmentInfoEntry(std::shared_ptr<const std::string> file_name,
                    int64_t start_time,
                    double duration_seconds,
                    bool use_byte_range,
                    uint64_t start_byte_offset,
                    uint64_t segment_file_size,
-                   uint64_t previous_segment_end_offset);
+                   uint64_t previous_segment_end_offset,
+                   base::Time program_date_time);
 
   std::string ToString() override;
   int64_t start_time() const { return start_time_; }
@@ -183,33 +223,47 @@ class SegmentInfoEntry : public HlsEntry {
   SegmentInfoEntry(const SegmentInfoEntry&) = delete;
   SegmentInfoEntry& operator=(const SegmentInfoEntry&) = delete;
 
-  const std::string file_name_;
+  // The text of the entry is not cached, as it is kept in the rendered playlist
+  // and the entries are numerous in I-frame playlists.
+  const std::shared_ptr<const std::string> file_name_;
   const int64_t start_time_;
   double duration_seconds_;
   const bool use_byte_range_;
   const uint64_t start_byte_offset_;
   const uint64_t segment_file_size_;
   const uint64_t previous_segment_end_offset_;
+  const base::Time program_date_time_;
 };
 
-SegmentInfoEntry::SegmentInfoEntry(const std::string& file_name,
+SegmentInfoEntry::SegmentInfoEntry(std::shared_ptr<const std::string> file_name,
                                    int64_t start_time,
                                    double duration_seconds,
                                    bool use_byte_range,
                                    uint64_t start_byte_offset,
                                    uint64_t segment_file_size,
-                                   uint64_t previous_segment_end_offset)
+                                   uint64_t previous_segment_end_offset,
+                                   base::Time program_date_time)
     : HlsEntry(HlsEntry::EntryType::kExtInf),
-      file_name_(file_name),
+      file_name_(std::move(file_name)),
       start_time_(start_time),
       duration_seconds_(duration_seconds),
       use_byte_range_(use_byte_range),
       start_byte_offset_(start_byte_offset),
       segment_file_size_(segment_file_size),
-      previous_segment_end_offset_(previous_segment_end_offset) {}
+      previous_segment_end_offset_(previous_segment_end_offset),
+      program_date_time_(program_date_time) {}
 
 std::string SegmentInfoEntry::ToString() {
-  std::string result = base::StringPrintf("#EXTINF:%.3f,", duration_seconds_);
+  std::string result;
+  if (!program_date_time_.is_null()) {
+    base::Time::Exploded exploded;
+    program_date_time_.UTCExplode(&exploded);
+    result = base::StringPrintf(
+        "#EXT-X-PROGRAM-DATE-TIME:%04d-%02d-%02dT%02d:%02d:%02d.%03dZ\n",
+        exploded.year, exploded.month, exploded.day_of_month, exploded.hour,
+        exploded.minute, exploded.second, exploded.millisecond);
+  }
+  base::StringAppendF(&result, "#EXTINF:%.3f,", duration_seconds_);
 
   if (use_byte_range_) {
     base::StringAppendF(&result, "\n#EXT-X-BYTERANGE:%" PRIu64,
@@ -219,11 +273,68 @@ std::string SegmentInfoEntry::ToString() {
     }
   }
 
-  base::StringAppendF(&result, "\n%s", file_name_.c_str());
-
+  result += '\n';
+  result += *file_name_;
   return result;
 }
 
+class PartInfoEntry : public HlsEntry {
+ public:
+  // |start_time| is in timescale.
+  // |duration_seconds| is duration in seconds.
+  PartInfoEntry(const std::string& file_name,
+                int64_t start_time,
+                double duration_seconds,
+                bool independent,
+                uint64_t start_byte_offset,
+                uint64_t size);
+
+  std::string ToString() override;
+  const std::string& file_name() const { return file_name_; }
+  int64_t start_time() const { return start_time_; }
+  uint64_t end_byte_offset() const { return start_byte_offset_ + size_; }
+
+ private:
+  PartInfoEntry(const PartInfoEntry&) = delete;
+  PartInfoEntry& operator=(const PartInfoEntry&) = delete;
+
+  const std::string file_name_;
+  const int64_t start_time_;
+  const double duration_seconds_;
+  const bool independent_;
+  const uint64_t start_byte_offset_;
+  const uint64_t size_;
+  std::string cached_string_;
+};
+
+PartInfoEntry::PartInfoEntry(const std::string& file_name,
+                             int64_t start_time,
+                             double duration_seconds,
+                             bool independent,
+                             uint64_t start_byte_offset,
+                             uint64_t size)
+    : HlsEntry(HlsEntry::EntryType::kExtPart),
+      file_name_(file_name),
+      start_time_(start_time),
+      duration_seconds_(duration_seconds),
+      independent_(independent),
+      start_byte_offset_(start_byte_offset),
+      size_(size) {}
+
+std::string PartInfoEntry::ToString() {
+  if (!cached_string_.empty())
+    return cached_string_;
+
+  Tag tag("#EXT-X-PART", &cached_string_);
+  tag.AddFloat("DURATION", duration_seconds_);
+  tag.AddQuotedString("URI", file_name_);
+  // The parts of a segment are all in the segment file.
+  tag.AddQuotedNumberPair("BYTERANGE", size_, '@', start_byte_offset_);
+  if (independent_)
+    tag.AddString("INDEPENDENT", "YES");
+  return cached_string_;
+}
+
 class EncryptionInfoEntry : public HlsEntry {
  public:
   EncryptionInfoEntry(MediaPlaylist::EncryptionMethod method,
@@ -344,10 +455,16 @@ MediaPlaylist::MediaPlaylist(const HlsParams& hls_params,
       file_name_(file_name),
       name_(name),
       group_id_(group_id),
-      media_sequence_number_(hls_params_.media_sequence_number) {
+      media_sequence_number_(hls_params_.media_sequence_number),
+      bandwidth_estimator_(GetBandwidthEstimationWindow(hls_params_)),
+      next_media_sequence_number_(hls_params_.media_sequence_number),
+      file_writer_("hls") {
+        file_writer_.set_write_gzip_copies(hls_params_.gzip_manifests);
         // When there's a forced media_sequence_number, start with discontinuity
-        if (media_sequence_number_ > 0)
+        if (media_sequence_number_ > 0) {
           entries_.emplace_back(new DiscontinuityEntry());
+          RenderEntries(entries_.begin());
+        }
       }
 
 MediaPlaylist::~MediaPlaylist() {}
@@ -399,6 +516,14 @@ bool MediaPlaylist::SetMediaInfo(const MediaInfo& media_info) {
   return true;
 }
 
+void MediaPlaylist::SetSequenceNumbers(uint32_t media_sequence_number,
+                                       int discontinuity_sequence_number) {
+  DCHECK_EQ(next_media_sequence_number_, media_sequence_number_);
+  media_sequence_number_ = media_sequence_number;
+  next_media_sequence_number_ = media_sequence_number;
+  discontinuity_sequence_number_ = discontinuity_sequence_number;
+}
+
 void MediaPlaylist::SetSampleDuration(uint32_t sample_duration) {
   if (media_info_.has_video_info())
     media_info_.mutable_video_info()->set_frame_duration(sample_duration);
@@ -432,6 +557,35 @@ void MediaPlaylist::AddSegment(const std::string& file_name,
                              size);
 }
 
+void MediaPlaylist::AddPart(const std::string& file_name,
+                            int64_t start_time,
+                            int64_t duration,
+                            uint64_t start_byte_offset,
+                            uint64_t size) {
+  if (hls_params_.playlist_type == HlsPlaylistType::kVod ||
+      stream_type_ == MediaPlaylistStreamType::kVideoIFramesOnly) {
+    return;
+  }
+  if (time_scale_ == 0) {
+    LOG(WARNING) << "Timescale is not set. Ignoring the partial segment.";
+    return;
+  }
+
+  const double part_duration_seconds =
+      static_cast<double>(duration) / time_scale_;
+  longest_part_duration_seconds_ =
+      std::max(longest_part_duration_seconds_, part_duration_seconds);
+  // Segments begin with stream access points, and every audio frame is one.
+  const bool independent = num_pending_parts_ == 0 ||
+                           stream_type_ == MediaPlaylistStreamType::kAudio;
+  entries_.emplace_back(new PartInfoEntry(file_name, start_time,
+                                          part_duration_seconds, independent,
+                                          start_byte_offset, size));
+  part_entries_.push_back(std::prev(entries_.end()));
+  RenderEntries(part_entries_.back());
+  ++num_pending_parts_;
+}
+
 void MediaPlaylist::AddKeyFrame(int64_t timestamp,
                                 uint64_t start_byte_offset,
                                 uint64_t size) {
@@ -456,38 +610,103 @@ void MediaPlaylist::AddEncryptionInfo(MediaPlaylist::EncryptionMethod method,
   if (!inserted_discontinuity_tag_) {
     // Insert discontinuity tag only for the first EXT-X-KEY, only if there
     // are non-encrypted media segments.
-    if (!entries_.empty())
+    if (!entries_.empty()) {
       entries_.emplace_back(new DiscontinuityEntry());
+      RenderEntries(std::prev(entries_.end()));
+    }
     inserted_discontinuity_tag_ = true;
   }
   entries_.emplace_back(new EncryptionInfoEntry(
       method, url, key_id, iv, key_format, key_format_versions));
+  RenderEntries(std::prev(entries_.end()));
 }
 
 void MediaPlaylist::AddPlacementOpportunity() {
   entries_.emplace_back(new PlacementOpportunityEntry());
+  RenderEntries(std::prev(entries_.end()));
 }
 
 bool MediaPlaylist::WriteToFile(const std::string& file_path) {
+  ScopedMetricsTimer metrics_timer("packager_manifest_write_seconds",
+                                   "Latency of the manifest writes.",
+                                   {{"format", "hls"}});
+  ScopedTraceEvent trace_event("MediaPlaylist::WriteToFile", "manifest");
   if (!target_duration_set_) {
     SetTargetDuration(ceil(GetLongestSegmentDuration()));
   }
 
+  const bool has_parts = longest_part_duration_seconds_ > 0;
+  const double part_target_duration =
+      has_parts ? std::max(hls_params_.part_target_duration,
+                           longest_part_duration_seconds_)
+                : 0;
+  // The playlists which are not updated do not need delta updates.
+  const double skip_boundary =
+      hls_params_.skip_boundary > 0 &&
+              hls_params_.playlist_type != HlsPlaylistType::kVod
+          ? std::max(hls_params_.skip_boundary, 6.0 * target_duration_)
+          : 0;
   std::string content = CreatePlaylistHeader(
       media_info_, target_duration_, hls_params_.playlist_type, stream_type_,
-      media_sequence_number_, discontinuity_sequence_number_);
+      media_sequence_number_, discontinuity_sequence_number_,
+      part_target_duration, skip_boundary);
+  const size_t header_size = content.size();
+  content.reserve(playlist_size_);
+  content.append(body_, body_offset_, std::string::npos);
 
-  for (const auto& entry : entries_)
-    base::StringAppendF(&content, "%s\n", entry->ToString().c_str());
+  if (!entries_.empty() &&
+      entries_.back()->type() == HlsEntry::EntryType::kExtPart) {
+    // The next part continues the segment being added.
+    const PartInfoEntry& last_part =
+        *static_cast<PartInfoEntry*>(entries_.back().get());
+    Tag tag("#EXT-X-PRELOAD-HINT", &content);
+    tag.AddString("TYPE", "PART");
+    tag.AddQuotedString("URI", last_part.file_name());
+    tag.AddNumber("BYTERANGE-START", last_part.end_byte_offset());
+    content += '\n';
+  }
+  if (has_parts) {
+    for (const RenditionReport& rendition_report : rendition_reports_) {
+      Tag tag("#EXT-X-RENDITION-REPORT", &content);
+      tag.AddQuotedString("URI", rendition_report.uri);
+      tag.AddNumber("LAST-MSN", rendition_report.last_media_sequence_number);
+      tag.AddNumber("LAST-PART", rendition_report.last_part_index);
+      content += '\n';
+    }
+  }
 
   if (hls_params_.playlist_type == HlsPlaylistType::kVod) {
     content += "#EXT-X-ENDLIST\n";
   }
 
-  if (!File::WriteFileAtomically(file_path.c_str(), content)) {
+  playlist_size_ = content.size();
+  if (!file_writer_.Write(file_path, content)) {
     LOG(ERROR) << "Failed to write playlist to: " << file_path;
     return false;
   }
+
+  if (skip_boundary > 0) {
+    // The delta playlist is the full playlist with the text of the skipped
+    // segments replaced by EXT-X-SKIP.
+    uint32_t skipped_segments = 0;
+    const size_t skipped_size =
+        GetSkippedSize(skip_boundary, &skipped_segments);
+    std::string delta_content(content, 0, header_size);
+    if (skipped_segments > 0) {
+      base::StringAppendF(&delta_content, "#EXT-X-SKIP:SKIPPED-SEGMENTS=%u\n",
+                          skipped_segments);
+    }
+    delta_content.append(content, header_size + skipped_size,
+                         std::string::npos);
+    const std::string delta_file_path =
+        base::FilePath::FromUTF8Unsafe(file_path)
+            .InsertBeforeExtensionASCII("_delta")
+            .AsUTF8Unsafe();
+    if (!file_writer_.Write(delta_file_path, delta_content)) {
+      LOG(ERROR) << "Failed to write delta playlist to: " << delta_file_path;
+      return false;
+    }
+  }
   return true;
 }
 
@@ -501,6 +720,19 @@ uint64_t MediaPlaylist::AvgBitrate() const {
   return bandwidth_estimator_.Estimate();
 }
 
+size_t MediaPlaylist::EstimateMemoryUsage() const {
+  // The entries are approximated by the most common ones, the segments, each
+  // in a list node. Their text is in |body_|.
+  const size_t kEntrySize = sizeof(SegmentInfoEntry) +
+                            sizeof(std::unique_ptr<HlsEntry>) +
+                            2 * sizeof(void*);
+  size_t size = entries_.size() * kEntrySize + body_.capacity() +
+                bandwidth_estimator_.EstimateMemoryUsage();
+  for (const std::string& segment_name : segments_to_be_removed_)
+    size += sizeof(segment_name) + segment_name.capacity();
+  return size;
+}
+
 double MediaPlaylist::GetLongestSegmentDuration() const {
   return longest_segment_duration_seconds_;
 }
@@ -516,6 +748,28 @@ void MediaPlaylist::SetTargetDuration(uint32_t target_duration) {
   target_duration_set_ = true;
 }
 
+bool MediaPlaylist::GetLastPart(uint32_t* media_sequence_number,
+                                uint32_t* part_index) const {
+  DCHECK(media_sequence_number);
+  DCHECK(part_index);
+  if (num_pending_parts_ > 0) {
+    *media_sequence_number = next_media_sequence_number_;
+    *part_index = num_pending_parts_ - 1;
+    return true;
+  }
+  if (num_parts_in_last_segment_ > 0) {
+    *media_sequence_number = next_media_sequence_number_ - 1;
+    *part_index = num_parts_in_last_segment_ - 1;
+    return true;
+  }
+  return false;
+}
+
+void MediaPlaylist::SetRenditionReports(
+    const std::vector<RenditionReport>& rendition_reports) {
+  rendition_reports_ = rendition_reports;
+}
+
 int MediaPlaylist::GetNumChannels() const {
   return media_info_.audio_info().num_channels();
 }
@@ -582,13 +836,20 @@ void MediaPlaylist::AddSegmentInfoEntry(const std::string& segment_file_name,
                                         int64_t duration,
                                         uint64_t start_byte_offset,
                                         uint64_t size) {
+  if (!last_segment_file_name_ ||
+      *last_segment_file_name_ != segment_file_name) {
+    last_segment_file_name_ =
+        std::make_shared<const std::string>(segment_file_name);
+  }
+
   if (time_scale_ == 0) {
     LOG(WARNING) << "Timescale is not set and the duration for " << duration
                  << " cannot be calculated. The output will be wrong.";
 
     entries_.emplace_back(new SegmentInfoEntry(
-        segment_file_name, 0.0, 0.0, use_byte_range_, start_byte_offset, size,
-        previous_segment_end_offset_));
+        last_segment_file_name_, 0.0, 0.0, use_byte_range_, start_byte_offset,
+        size, previous_segment_end_offset_, base::Time()));
+    RenderEntries(std::prev(entries_.end()));
     return;
   }
 
@@ -606,23 +867,81 @@ void MediaPlaylist::AddSegmentInfoEntry(const std::string& segment_file_name,
   bandwidth_estimator_.AddBlock(size, segment_duration_seconds);
   current_buffer_depth_ += segment_duration_seconds;
 
-  if (!entries_.empty() &&
-      entries_.back()->type() == HlsEntry::EntryType::kExtInf) {
+  // The parts of the segment, if any, are listed before it.
+  auto first_part = entries_.end();
+  while (first_part != entries_.begin() &&
+         (*std::prev(first_part))->type() == HlsEntry::EntryType::kExtPart) {
+    --first_part;
+  }
+  if (first_part != entries_.begin() &&
+      (*std::prev(first_part))->type() == HlsEntry::EntryType::kExtInf) {
     const SegmentInfoEntry* segment_info =
-        static_cast<SegmentInfoEntry*>(entries_.back().get());
+        static_cast<SegmentInfoEntry*>(std::prev(first_part)->get());
     if (segment_info->start_time() > start_time) {
       LOG(WARNING)
           << "Insert a discontinuity tag after the segment with start time "
           << segment_info->start_time() << " as the next segment starts at "
           << start_time << ".";
-      entries_.emplace_back(new DiscontinuityEntry());
+      UnrenderEntries(first_part);
+      RenderEntries(entries_.emplace(first_part, new DiscontinuityEntry()));
     }
   }
 
+  base::Time program_date_time;
+  if (hls_params_.program_date_time) {
+    if (program_date_time_origin_.is_null()) {
+      // The segment has just been packaged, so its end is about now.
+      program_date_time_origin_ =
+          base::Time::Now() -
+          base::TimeDelta::FromSecondsD(
+              static_cast<double>(start_time + duration) / time_scale_);
+    }
+    program_date_time =
+        program_date_time_origin_ +
+        base::TimeDelta::FromSecondsD(static_cast<double>(start_time) /
+                                      time_scale_);
+  }
   entries_.emplace_back(new SegmentInfoEntry(
-      segment_file_name, start_time, segment_duration_seconds, use_byte_range_,
-      start_byte_offset, size, previous_segment_end_offset_));
+      last_segment_file_name_, start_time, segment_duration_seconds,
+      use_byte_range_, start_byte_offset, size, previous_segment_end_offset_,
+      program_date_time));
+  RenderEntries(std::prev(entries_.end()));
   previous_segment_end_offset_ = start_byte_offset + size - 1;
+  ++next_media_sequence_number_;
+  num_parts_in_last_segment_ = num_pending_parts_;
+  num_pending_parts_ = 0;
+  RemoveOldParts(start_time + duration);
+}
+
+void MediaPlaylist::RemoveOldParts(int64_t end_time) {
+  if (part_entries_.empty())
+    return;
+  DCHECK_GT(time_scale_, 0u);
+
+  const double target_duration =
+      target_duration_set_ ? target_duration_
+                           : ceil(GetLongestSegmentDuration());
+  const double max_part_age = 3 * target_duration;
+  auto is_old_part = [this, end_time, max_part_age](
+                         std::list<std::unique_ptr<HlsEntry>>::iterator entry) {
+    const PartInfoEntry& part = *static_cast<PartInfoEntry*>(entry->get());
+    return static_cast<double>(end_time - part.start_time()) / time_scale_ >
+           max_part_age;
+  };
+  if (!is_old_part(part_entries_.front()))
+    return;
+
+  // The old parts are close to the end of the playlist, so the text from the
+  // first of them is rendered again.
+  const bool from_begin = part_entries_.front() == entries_.begin();
+  const auto last_kept =
+      from_begin ? entries_.end() : std::prev(part_entries_.front());
+  UnrenderEntries(part_entries_.front());
+  while (!part_entries_.empty() && is_old_part(part_entries_.front())) {
+    entries_.erase(part_entries_.front());
+    part_entries_.pop_front();
+  }
+  RenderEntries(from_begin ? entries_.begin() : std::next(last_kept));
 }
 
 void MediaPlaylist::AdjustLastSegmentInfoEntryDuration(int64_t next_timestamp) {
@@ -641,8 +960,12 @@ void MediaPlaylist::AdjustLastSegmentInfoEntryDuration(int64_t next_timestamp) {
           next_timestamp_seconds -
           static_cast<double>(segment_info->start_time()) / time_scale_;
       // It could be negative if timestamp messed up.
-      if (segment_duration_seconds > 0)
+      if (segment_duration_seconds > 0) {
+        const auto entry = std::prev(iter.base());
+        UnrenderEntries(entry);
         segment_info->set_duration_seconds(segment_duration_seconds);
+        RenderEntries(entry);
+      }
       longest_segment_duration_seconds_ =
           std::max(longest_segment_duration_seconds_, segment_duration_seconds);
       break;
@@ -675,20 +998,29 @@ void MediaPlaylist::SlideWindow() {
   //    #EXT-X-KEY   <2>
   //    #EXTINF      <3>
   //    #EXTINF      <4>
-  std::list<std::unique_ptr<HlsEntry>> ext_x_keys;
+  std::vector<std::unique_ptr<HlsEntry>> ext_x_keys;
   // Consecutive key entries are either fully removed or not removed at all.
   // Keep track of entry types so we know if it is consecutive key entries.
   HlsEntry::EntryType prev_entry_type = HlsEntry::EntryType::kExtInf;
 
+  // The size of the text of the entries removed.
+  size_t removed_size = 0;
+
   std::list<std::unique_ptr<HlsEntry>>::iterator last = entries_.begin();
   for (; last != entries_.end(); ++last) {
     HlsEntry::EntryType entry_type = last->get()->type();
+    if (entry_type != HlsEntry::EntryType::kExtInf)
+      removed_size += (*last)->rendered_size();
     if (entry_type == HlsEntry::EntryType::kExtKey) {
       if (prev_entry_type != HlsEntry::EntryType::kExtKey)
         ext_x_keys.clear();
       ext_x_keys.push_back(std::move(*last));
     } else if (entry_type == HlsEntry::EntryType::kExtDiscontinuity) {
       ++discontinuity_sequence_number_;
+    } else if (entry_type == HlsEntry::EntryType::kExtPart) {
+      // The parts are in |part_entries_| in the same order.
+      DCHECK(part_entries_.front() == last);
+      part_entries_.pop_front();
     } else {
       DCHECK_EQ(entry_type, HlsEntry::EntryType::kExtInf);
 
@@ -701,6 +1033,7 @@ void MediaPlaylist::SlideWindow() {
           hls_params_.time_shift_buffer_depth;
       if (segment_within_time_shift_buffer)
         break;
+      removed_size += (*last)->rendered_size();
       current_buffer_depth_ -= segment_info.duration_seconds();
       RemoveOldSegment(segment_info.start_time());
       media_sequence_number_++;
@@ -711,6 +1044,23 @@ void MediaPlaylist::SlideWindow() {
   // Add key entries back.
   entries_.insert(entries_.begin(), std::make_move_iterator(ext_x_keys.begin()),
                   std::make_move_iterator(ext_x_keys.end()));
+
+  // The key entries kept were removed too, so their text fits in front of the
+  // remaining text.
+  std::string keys_text;
+  for (const auto& entry : ext_x_keys) {
+    keys_text += entry->ToString();
+    keys_text += '\n';
+  }
+  DCHECK_LE(keys_text.size(), removed_size);
+  body_offset_ += removed_size - keys_text.size();
+  body_.replace(body_offset_, keys_text.size(), keys_text);
+  // Drop the skipped text once it is most of the body, so the cost of sliding
+  // the window is amortized.
+  if (body_offset_ > body_.size() / 2) {
+    body_.erase(0, body_offset_);
+    body_offset_ = 0;
+  }
 }
 
 void MediaPlaylist::RemoveOldSegment(int64_t start_time) {
@@ -724,15 +1074,60 @@ void MediaPlaylist::RemoveOldSegment(int64_t start_time) {
                             media_sequence_number_, media_info_.bandwidth()));
   while (segments_to_be_removed_.size() >
          hls_params_.preserved_segments_outside_live_window) {
-    VLOG(2) << "Deleting " << segments_to_be_removed_.front();
-    if (!File::Delete(segments_to_be_removed_.front().c_str())) {
-      LOG(WARNING) << "Failed to delete " << segments_to_be_removed_.front()
-                   << "; Will retry later.";
-      break;
-    }
+    SegmentReaper::GetInstance()->Delete(segments_to_be_removed_.front());
     segments_to_be_removed_.pop_front();
   }
 }
 
+size_t MediaPlaylist::GetSkippedSize(double skip_boundary,
+                                     uint32_t* skipped_segments) {
+  // Only the entries within the skip boundary from the end of the playlist
+  // are visited.
+  double kept_duration = 0;
+  uint32_t kept_segments = 0;
+  size_t kept_size = 0;
+  auto entry = entries_.rbegin();
+  for (; entry != entries_.rend(); ++entry) {
+    if ((*entry)->type() == HlsEntry::EntryType::kExtInf) {
+      // The segments which end more than the skip boundary before the end of
+      // the playlist can be skipped, along with the entries before them.
+      if (kept_duration >= skip_boundary)
+        break;
+      kept_duration +=
+          static_cast<SegmentInfoEntry*>(entry->get())->duration_seconds();
+      ++kept_segments;
+    }
+    kept_size += (*entry)->rendered_size();
+  }
+  if (entry == entries_.rend()) {
+    *skipped_segments = 0;
+    return 0;
+  }
+  const uint32_t num_segments =
+      next_media_sequence_number_ - media_sequence_number_;
+  DCHECK_GT(num_segments, kept_segments);
+  *skipped_segments = num_segments - kept_segments;
+  return body_.size() - body_offset_ - kept_size;
+}
+
+void MediaPlaylist::RenderEntries(
+    std::list<std::unique_ptr<HlsEntry>>::iterator first) {
+  for (; first != entries_.end(); ++first) {
+    const std::string text = (*first)->ToString();
+    (*first)->set_rendered_size(text.size() + 1);
+    body_ += text;
+    body_ += '\n';
+  }
+}
+
+void MediaPlaylist::UnrenderEntries(
+    std::list<std::unique_ptr<HlsEntry>>::iterator first) {
+  size_t size = 0;
+  for (; first != entries_.end(); ++first)
+    size += (*first)->rendered_size();
+  DCHECK_LE(size, body_.size() - body_offset_);
+  body_.resize(body_.size() - size);
+}
+
 }  // namespace hls
 }  // namespace shaka
@@ -7,14 +7,17 @@
 #ifndef PACKAGER_HLS_BASE_MEDIA_PLAYLIST_H_
 #define PACKAGER_HLS_BASE_MEDIA_PLAYLIST_H_
 
+#include <deque>
 #include <list>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "packager/base/macros.h"
+#include "packager/base/time/time.h"
 #include "packager/hls/public/hls_params.h"
 #include "packager/mpd/base/bandwidth_estimator.h"
+#include "packager/mpd/base/manifest_file_writer.h"
 #include "packager/mpd/base/media_info.pb.h"
 
 namespace shaka {
@@ -30,17 +33,26 @@ class HlsEntry {
     kExtKey,
     kExtDiscontinuity,
     kExtPlacementOpportunity,
+    kExtPart,
   };
   virtual ~HlsEntry();
 
   EntryType type() const { return type_; }
   virtual std::string ToString() = 0;
 
+  /// @return The size of the text of the entry in the playlist, including the
+  ///         line feed, as of the last time it was rendered.
+  size_t rendered_size() const { return rendered_size_; }
+  void set_rendered_size(size_t rendered_size) {
+    rendered_size_ = rendered_size;
+  }
+
  protected:
   explicit HlsEntry(EntryType type);
 
  private:
   EntryType type_;
+  size_t rendered_size_ = 0;
 };
 
 /// Methods are virtual for mocking.
@@ -53,6 +65,13 @@ class MediaPlaylist {
     kVideoIFramesOnly,
     kSubtitle,
   };
+  /// The attributes of an EXT-X-RENDITION-REPORT tag.
+  struct RenditionReport {
+    /// The URI of the other Media Playlist, relative to this one.
+    std::string uri;
+    uint32_t last_media_sequence_number = 0;
+    uint32_t last_part_index = 0;
+  };
   enum class EncryptionMethod {
     kNone,           // No encryption, i.e. clear.
     kAes128,         // Completely encrypted using AES-CBC.
@@ -99,6 +118,15 @@ class MediaPlaylist {
   /// @return true on success, false otherwise.
   virtual bool SetMediaInfo(const MediaInfo& media_info);
 
+  /// Restore the sequence numbers of the playlist of a restarted live session,
+  /// see LiveCheckpoint. Must be called before any segment is added.
+  /// @param media_sequence_number is the EXT-X-MEDIA-SEQUENCE of the first
+  ///        segment added next.
+  /// @param discontinuity_sequence_number is the
+  ///        EXT-X-DISCONTINUITY-SEQUENCE of the first segment added next.
+  virtual void SetSequenceNumbers(uint32_t media_sequence_number,
+                                  int discontinuity_sequence_number);
+
   /// Set the sample duration. Sample duration is used to generate frame rate.
   /// Sample duration is not available right away especially. This allows
   /// setting the sample duration after the Media Playlist has been initialized.
@@ -118,6 +146,20 @@ class MediaPlaylist {
                           uint64_t start_byte_offset,
                           uint64_t size);
 
+  /// Partial segments (EXT-X-PART) must be added in order, before the segment
+  /// containing them is added with AddSegment(). They are only listed in live
+  /// and event playlists, except I-Frames only playlists.
+  /// @param file_name is the file name of the segment containing the part.
+  /// @param start_time is in terms of the timescale of the media.
+  /// @param duration is in terms of the timescale of the media.
+  /// @param start_byte_offset is the offset of the part in the segment.
+  /// @param size is size in bytes.
+  virtual void AddPart(const std::string& file_name,
+                       int64_t start_time,
+                       int64_t duration,
+                       uint64_t start_byte_offset,
+                       uint64_t size);
+
   /// Keyframes must be added in order. It is also called before the containing
   /// segment being called.
   /// @param timestamp is the timestamp of the key frame in timescale of the
@@ -172,6 +214,11 @@ class MediaPlaylist {
   /// @return The average bitrate (in bits per second) of this MediaPlaylist.
   virtual uint64_t AvgBitrate() const;
 
+  /// @return The approximate number of bytes allocated for the state which
+  ///         grows with the stream, e.g. the segments, not including the
+  ///         object itself.
+  size_t EstimateMemoryUsage() const;
+
   /// @return the longest segment’s duration. This will return 0 if no
   ///         segments have been added.
   virtual double GetLongestSegmentDuration() const;
@@ -185,6 +232,18 @@ class MediaPlaylist {
   /// @param target_duration is the target duration for this playlist.
   virtual void SetTargetDuration(uint32_t target_duration);
 
+  /// @return true if there is a partial segment in this playlist, while
+  ///         setting @a media_sequence_number and @a part_index to the values
+  ///         of the last one, i.e. LAST-MSN and LAST-PART of the rendition
+  ///         report of this playlist; false otherwise.
+  virtual bool GetLastPart(uint32_t* media_sequence_number,
+                           uint32_t* part_index) const;
+
+  /// Set the EXT-X-RENDITION-REPORTs of the other renditions, which are
+  /// written to the playlist along with the partial segments.
+  virtual void SetRenditionReports(
+      const std::vector<RenditionReport>& rendition_reports);
+
   /// @return number of channels for audio. 0 is returned for video.
   virtual int GetNumChannels() const;
 
@@ -228,6 +287,9 @@ class MediaPlaylist {
                            int64_t duration,
                            uint64_t start_byte_offset,
                            uint64_t size);
+  // Remove the partial segments which are more than three target durations
+  // from the end of the playlist.
+  void RemoveOldParts(int64_t end_time);
   // Adjust the duration of the last SegmentInfoEntry to end on
   // |next_timestamp|.
   void AdjustLastSegmentInfoEntryDuration(int64_t next_timestamp);
@@ -238,6 +300,16 @@ class MediaPlaylist {
   // happen at a later time depending on the value of
   // |preserved_segment_outside_live_window| in |hls_params_|.
   void RemoveOldSegment(int64_t start_time);
+  // @return The size of the text of the entries which are replaced by
+  //         EXT-X-SKIP in the delta playlist, with the number of segments
+  //         among them in |skipped_segments|.
+  size_t GetSkippedSize(double skip_boundary, uint32_t* skipped_segments);
+  // Append the text of the entries from |first| to the end of |entries_| to
+  // |body_|.
+  void RenderEntries(std::list<std::unique_ptr<HlsEntry>>::iterator first);
+  // Remove the text of the entries from |first| to the end of |entries_| from
+  // |body_|. Must be called before the entries are modified or removed.
+  void UnrenderEntries(std::list<std::unique_ptr<HlsEntry>>::iterator first);
 
   const HlsParams& hls_params_;
   // Mainly for MasterPlaylist to use these values.
@@ -271,19 +343,45 @@ class MediaPlaylist {
   // TODO(kqyang): This could be managed better by a separate class, than having
   // all them managed in MediaPlaylist.
   std::list<std::unique_ptr<HlsEntry>> entries_;
+  // The partial segments in |entries_|, oldest first, so the old ones can be
+  // removed without going through all the entries.
+  std::list<std::list<std::unique_ptr<HlsEntry>>::iterator> part_entries_;
+  // The text of |entries_|, starting at |body_offset_|. The entries are
+  // rendered as they are added and the text of the entries slid out of the
+  // window is skipped, so only the head and the tail of the playlist change
+  // from one write to the next.
+  std::string body_;
+  size_t body_offset_ = 0;
+  // The media sequence number of the next segment to be added.
+  uint32_t next_media_sequence_number_ = 0;
+  // The partial segments of the segment being added, and of the last segment
+  // added.
+  uint32_t num_pending_parts_ = 0;
+  uint32_t num_parts_in_last_segment_ = 0;
+  double longest_part_duration_seconds_ = 0.0;
+  std::vector<RenditionReport> rendition_reports_;
+  // Size of the last playlist written, to size the next one.
+  size_t playlist_size_ = 0;
+  // Writes the playlist and the delta playlist.
+  ManifestFileWriter file_writer_;
   double current_buffer_depth_ = 0;
   // A list to hold the file names of the segments to be removed temporarily.
   // Once a file is actually removed, it is removed from the list.
-  std::list<std::string> segments_to_be_removed_;
+  std::deque<std::string> segments_to_be_removed_;
 
-  // Used by kVideoIFrameOnly playlists to track the i-frames (key frames).
+  // Used by kVideoIFrameOnly playlists to track the i-frames (key frames) of
+  // the segment being added.
   struct KeyFrameInfo {
     int64_t timestamp;
     uint64_t start_byte_offset;
     uint64_t size;
-    std::string segment_file_name;
   };
-  std::list<KeyFrameInfo> key_frames_;
+  std::vector<KeyFrameInfo> key_frames_;
+  // The file name of the last segment added, shared with its entries.
+  std::shared_ptr<const std::string> last_segment_file_name_;
+  // The wall clock time of timestamp 0, for HlsParams::program_date_time.
+  // It is set when the first segment is added.
+  base::Time program_date_time_origin_;
 
   DISALLOW_COPY_AND_ASSIGN(MediaPlaylist);
 };
@@ -0,0 +1,66 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/file/file.h"
+#include "packager/hls/base/media_playlist.h"
+#include "packager/media/test/perf_test_util.h"
+
+namespace shaka {
+namespace hls {
+
+namespace {
+
+const uint64_t kTimeScale = 90000;
+const int64_t kSegmentDuration = 6 * kTimeScale;
+const uint64_t kSegmentSize = 1000000;
+
+// Measures how fast a playlist with |segment_count| segments is written.
+void MeasureWriteRate(HlsPlaylistType playlist_type, size_t segment_count) {
+  HlsParams hls_params;
+  hls_params.playlist_type = playlist_type;
+  MediaPlaylist playlist(hls_params, "playlist.m3u8", "name", "group");
+
+  MediaInfo media_info;
+  media_info.set_reference_time_scale(kTimeScale);
+  media_info.set_segment_template_url("segment-$Number$.ts");
+  MediaInfo::VideoInfo* video_info = media_info.mutable_video_info();
+  video_info->set_codec("avc1");
+  video_info->set_time_scale(kTimeScale);
+  video_info->set_frame_duration(3000);
+  video_info->set_width(1280);
+  video_info->set_height(720);
+  ASSERT_TRUE(playlist.SetMediaInfo(media_info));
+
+  for (size_t i = 0; i < segment_count; ++i) {
+    playlist.AddSegment(base::StringPrintf("segment-%zu.ts", i),
+                        i * kSegmentDuration, kSegmentDuration, 0,
+                        kSegmentSize);
+  }
+
+  const std::string kPlaylistPath = "memory://playlist.m3u8";
+  media::MeasureOperationRate(
+      "media_playlist_write_to_file",
+      base::StringPrintf("%zu_segments", segment_count),
+      [&]() { CHECK(playlist.WriteToFile(kPlaylistPath)); });
+  File::Delete(kPlaylistPath.c_str());
+}
+
+}  // namespace
+
+TEST(MediaPlaylistPerfTest, ShortVod) {
+  MeasureWriteRate(HlsPlaylistType::kVod, 100);
+}
+
+TEST(MediaPlaylistPerfTest, LongVod) {
+  MeasureWriteRate(HlsPlaylistType::kVod, 10000);
+}
+
+}  // namespace hls
+}  // namespace shaka
@@ -6,11 +6,16 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmath>
 
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
 #include "packager/file/file_test_util.h"
+#include "packager/file/segment_reaper.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/version/version.h"
 
@@ -686,6 +691,68 @@ TEST_F(LiveMediaPlaylistTest, Basic) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+TEST_F(LiveMediaPlaylistTest, ProgramDateTime) {
+  mutable_hls_params()->program_date_time = true;
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  media_playlist_->AddSegment("file1.ts", 0, 10 * kTimeScale, kZeroByteOffset,
+                              kMBytes);
+  media_playlist_->AddSegment("file2.ts", 10 * kTimeScale, 10 * kTimeScale,
+                              kZeroByteOffset, kMBytes);
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  std::string playlist;
+  ASSERT_TRUE(File::ReadFileToString(kMemoryFilePath, &playlist));
+
+  // Both segments are tagged, 10 seconds apart.
+  const char kTag[] = "#EXT-X-PROGRAM-DATE-TIME:";
+  const char kTimeFormat[] = "%*4d-%*2d-%*2dT%2d:%2d:%2d.%3dZ\n#EXTINF";
+  double seconds_of_day[2];
+  size_t position = 0;
+  for (double& seconds : seconds_of_day) {
+    position = playlist.find(kTag, position);
+    ASSERT_NE(std::string::npos, position);
+    position += strlen(kTag);
+    int hour, minute, second, millisecond;
+    ASSERT_EQ(4, sscanf(playlist.c_str() + position, kTimeFormat, &hour,
+                        &minute, &second, &millisecond));
+    seconds = hour * 3600 + minute * 60 + second + millisecond / 1000.0;
+  }
+  EXPECT_EQ(std::string::npos, playlist.find(kTag, position));
+  EXPECT_NEAR(10, std::fmod(seconds_of_day[1] - seconds_of_day[0] + 86400,
+                            86400),
+              0.002);
+}
+
+TEST_F(LiveMediaPlaylistTest, SequenceNumbersRestored) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  media_playlist_->SetSequenceNumbers(5, 2);
+
+  media_playlist_->AddSegment("file6.ts", 50 * kTimeScale, 10 * kTimeScale,
+                              kZeroByteOffset, kMBytes);
+  media_playlist_->AddSegment("file7.ts", 60 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  media_playlist_->AddSegment("file8.ts", 80 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:20\n"
+      "#EXT-X-MEDIA-SEQUENCE:6\n"
+      "#EXT-X-DISCONTINUITY-SEQUENCE:2\n"
+      "#EXTINF:20.000,\n"
+      "file7.ts\n"
+      "#EXTINF:20.000,\n"
+      "file8.ts\n";
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
 TEST_F(LiveMediaPlaylistTest, TimeShifted) {
   ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
 
@@ -819,6 +886,127 @@ TEST_F(LiveMediaPlaylistTest, TimeShiftedWithEncryptionInfoShifted) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+TEST_F(LiveMediaPlaylistTest, TimeShiftedWrittenOnEveryUpdate) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://example.com", "",
+      "0x12345678", "com.widevine", "1/2/4");
+
+  // The playlist is updated as the window slides, with the key kept in front
+  // of the segments.
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  for (int i = 0; i < 6; ++i) {
+    media_playlist_->AddSegment(base::StringPrintf("file%d.ts", i + 1),
+                                i * 10 * kTimeScale, 10 * kTimeScale,
+                                kZeroByteOffset, kMBytes);
+    EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  }
+
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:10\n"
+      "#EXT-X-MEDIA-SEQUENCE:3\n"
+      "#EXT-X-KEY:METHOD=SAMPLE-AES,"
+      "URI=\"http://example.com\",IV=0x12345678,KEYFORMATVERSIONS=\"1/2/4\","
+      "KEYFORMAT=\"com.widevine\"\n"
+      "#EXTINF:10.000,\n"
+      "file4.ts\n"
+      "#EXTINF:10.000,\n"
+      "file5.ts\n"
+      "#EXTINF:10.000,\n"
+      "file6.ts\n";
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
+TEST_F(LiveMediaPlaylistTest, Parts) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  media_playlist_->AddPart("file1.ts", 0, kTimeScale, 100, 1000);
+  media_playlist_->AddPart("file1.ts", kTimeScale, kTimeScale, 1100, 1000);
+  media_playlist_->AddSegment("file1.ts", 0, 2 * kTimeScale, kZeroByteOffset,
+                              2100);
+  media_playlist_->AddPart("file2.ts", 2 * kTimeScale, kTimeScale, 100, 1000);
+
+  uint32_t media_sequence_number = 0;
+  uint32_t part_index = 0;
+  ASSERT_TRUE(
+      media_playlist_->GetLastPart(&media_sequence_number, &part_index));
+  EXPECT_EQ(1u, media_sequence_number);
+  EXPECT_EQ(0u, part_index);
+
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=3.000\n"
+      "#EXT-X-PART-INF:PART-TARGET=1.000\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file1.ts\",BYTERANGE=\"1000@100\","
+      "INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file1.ts\",BYTERANGE=\"1000@1100\"\n"
+      "#EXTINF:2.000,\n"
+      "file1.ts\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file2.ts\",BYTERANGE=\"1000@100\","
+      "INDEPENDENT=YES\n"
+      "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"file2.ts\",BYTERANGE-START=1100\n";
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
+TEST_F(LiveMediaPlaylistTest, OldPartsRemoved) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  for (int i = 0; i < 4; ++i) {
+    const std::string file_name = base::StringPrintf("file%d.ts", i + 1);
+    media_playlist_->AddPart(file_name, i * 2 * kTimeScale, 2 * kTimeScale,
+                             100, 1000);
+    media_playlist_->AddSegment(file_name, i * 2 * kTimeScale, 2 * kTimeScale,
+                                kZeroByteOffset, 1100);
+  }
+  MediaPlaylist::RenditionReport rendition_report;
+  rendition_report.uri = "other.m3u8";
+  rendition_report.last_media_sequence_number = 3;
+  rendition_report.last_part_index = 1;
+  media_playlist_->SetRenditionReports({rendition_report});
+
+  // The parts of the first segment are more than three target durations from
+  // the end of the playlist.
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=6.000\n"
+      "#EXT-X-PART-INF:PART-TARGET=2.000\n"
+      "#EXTINF:2.000,\n"
+      "file1.ts\n"
+      "#EXT-X-PART:DURATION=2.000,URI=\"file2.ts\",BYTERANGE=\"1000@100\","
+      "INDEPENDENT=YES\n"
+      "#EXTINF:2.000,\n"
+      "file2.ts\n"
+      "#EXT-X-PART:DURATION=2.000,URI=\"file3.ts\",BYTERANGE=\"1000@100\","
+      "INDEPENDENT=YES\n"
+      "#EXTINF:2.000,\n"
+      "file3.ts\n"
+      "#EXT-X-PART:DURATION=2.000,URI=\"file4.ts\",BYTERANGE=\"1000@100\","
+      "INDEPENDENT=YES\n"
+      "#EXTINF:2.000,\n"
+      "file4.ts\n"
+      "#EXT-X-RENDITION-REPORT:URI=\"other.m3u8\",LAST-MSN=3,LAST-PART=1\n";
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
 class EventMediaPlaylistTest : public MediaPlaylistMultiSegmentTest {
  protected:
   EventMediaPlaylistTest()
@@ -849,6 +1037,41 @@ TEST_F(EventMediaPlaylistTest, Basic) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+TEST_F(EventMediaPlaylistTest, DeltaUpdates) {
+  // Raised to six target durations.
+  mutable_hls_params()->skip_boundary = 1;
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  for (int i = 0; i < 8; ++i) {
+    media_playlist_->AddSegment(base::StringPrintf("file%d.ts", i + 1),
+                                i * 10 * kTimeScale, 10 * kTimeScale,
+                                kZeroByteOffset, kMBytes);
+  }
+  const char kExpectedHeader[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:9\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:10\n"
+      "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=60.000\n"
+      "#EXT-X-PLAYLIST-TYPE:EVENT\n";
+  std::string expected_output = kExpectedHeader;
+  for (int i = 0; i < 8; ++i)
+    base::StringAppendF(&expected_output, "#EXTINF:10.000,\nfile%d.ts\n",
+                        i + 1);
+  // The segments which end more than 60 seconds before the end are skipped.
+  std::string expected_delta_output = kExpectedHeader;
+  expected_delta_output += "#EXT-X-SKIP:SKIPPED-SEGMENTS=2\n";
+  for (int i = 2; i < 8; ++i)
+    base::StringAppendF(&expected_delta_output, "#EXTINF:10.000,\nfile%d.ts\n",
+                        i + 1);
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, expected_output);
+  ASSERT_FILE_STREQ("memory://media_delta.m3u8", expected_delta_output);
+}
+
 class IFrameMediaPlaylistTest : public MediaPlaylistTest {};
 
 TEST_F(IFrameMediaPlaylistTest, MediaPlaylistType) {
@@ -1037,6 +1260,8 @@ class MediaPlaylistDeleteSegmentsTest
   }
 
   bool SegmentDeleted(const std::string& segment_name) {
+    // The segments are deleted in the background.
+    SegmentReaper::GetInstance()->Flush();
     std::unique_ptr<File, FileCloser> file_closer(
         File::Open(segment_name.c_str(), "r"));
     return file_closer.get() == nullptr;
@@ -7,6 +7,7 @@
 #include "packager/hls/base/simple_hls_notifier.h"
 
 #include <gflags/gflags.h>
+#include <algorithm>
 #include <cmath>
 
 #include "packager/base/base64.h"
@@ -15,11 +16,13 @@
 #include "packager/base/optional.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/file/file.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/media/base/protection_system_ids.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/proto_json_util.h"
 #include "packager/media/base/widevine_pssh_data.pb.h"
+#include "packager/metrics/metrics.h"
 
 DEFINE_bool(enable_legacy_widevine_hls_signaling,
             false,
@@ -251,6 +254,28 @@ bool HandleWidevineKeyFormats(
   return true;
 }
 
+// The URL of the media playlist |playlist_file_name| in the media playlist
+// |from_playlist_file_name|. Both are relative to the output directory.
+std::string GeneratePlaylistUrl(const std::string& playlist_file_name,
+                                const std::string& base_url,
+                                const std::string& from_playlist_file_name) {
+  if (!base_url.empty())
+    return base_url + playlist_file_name;
+  const FilePath playlist_path = FilePath::FromUTF8Unsafe(playlist_file_name);
+  if (FilePath::FromUTF8Unsafe(from_playlist_file_name).DirName() ==
+      playlist_path.DirName()) {
+    return playlist_path.BaseName().AsUTF8Unsafe();
+  }
+  // Go up to the output directory, then down to the playlist. The playlist
+  // file names use "/" as the separator.
+  std::string url;
+  const size_t depth = std::count(from_playlist_file_name.begin(),
+                                  from_playlist_file_name.end(), '/');
+  for (size_t i = 0; i < depth; ++i)
+    url += "../";
+  return url + playlist_file_name;
+}
+
 bool WriteMediaPlaylist(const std::string& output_dir,
                         MediaPlaylist* playlist) {
   std::string file_path =
@@ -292,9 +317,27 @@ SimpleHlsNotifier::SimpleHlsNotifier(const HlsParams& hls_params)
       new MasterPlaylist(master_playlist_path.BaseName().AsUTF8Unsafe(),
                          default_audio_langauge, default_text_language, 
                          hls_params.is_independent_segments));
+  master_playlist_->set_write_gzip_copies(hls_params.gzip_manifests);
+
+  metrics_collector_id_ =
+      Metrics::GetInstance()->AddCollector([this](Metrics::Writer* writer) {
+        size_t size = 0;
+        for (StreamEntry* stream : GetStreamEntries()) {
+          base::AutoLock playlist_lock(stream->lock);
+          size += stream->media_playlist->EstimateMemoryUsage();
+        }
+        writer->Add("packager_manifest_state_bytes", Metrics::Type::kGauge,
+                    "Approximate memory used by the state of the manifests "
+                    "which grows with the streams.",
+                    {{"format", "hls"},
+                     {"manifest", hls_params().master_playlist_output}},
+                    static_cast<double>(size));
+      });
 }
 
-SimpleHlsNotifier::~SimpleHlsNotifier() {}
+SimpleHlsNotifier::~SimpleHlsNotifier() {
+  Metrics::GetInstance()->RemoveCollector(metrics_collector_id_);
+}
 
 bool SimpleHlsNotifier::Init() {
   return true;
@@ -339,21 +382,19 @@ bool SimpleHlsNotifier::NotifyNewStream(const MediaInfo& media_info,
   base::AutoLock auto_lock(lock_);
   *stream_id = sequence_number_++;
   media_playlists_.push_back(media_playlist.get());
-  stream_map_[*stream_id].reset(
-      new StreamEntry{std::move(media_playlist), encryption_method});
+  stream_map_[*stream_id].reset(new StreamEntry(
+      std::move(media_playlist), encryption_method,
+      media_info.segment_template()));
   return true;
 }
 
 bool SimpleHlsNotifier::NotifySampleDuration(uint32_t stream_id,
                                              uint32_t sample_duration) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  media_playlist->SetSampleDuration(sample_duration);
+  base::AutoLock playlist_lock(stream->lock);
+  stream->media_playlist->SetSampleDuration(sample_duration);
   return true;
 }
 
@@ -363,47 +404,75 @@ bool SimpleHlsNotifier::NotifyNewSegment(uint32_t stream_id,
                                          uint64_t duration,
                                          uint64_t start_byte_offset,
                                          uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  const std::string& segment_url =
-      GenerateSegmentUrl(segment_name, hls_params().base_url,
-                         master_playlist_dir_, media_playlist->file_name());
-  media_playlist->AddSegment(segment_url, start_time, duration,
-                             start_byte_offset, size);
-
-  // Update target duration.
-  uint32_t longest_segment_duration =
-      static_cast<uint32_t>(ceil(media_playlist->GetLongestSegmentDuration()));
   bool target_duration_updated = false;
-  if (longest_segment_duration > target_duration_) {
-    target_duration_ = longest_segment_duration;
-    target_duration_updated = true;
+  {
+    base::AutoLock playlist_lock(stream->lock);
+    MediaPlaylist* media_playlist = stream->media_playlist.get();
+    const std::string& segment_url =
+        GenerateSegmentUrl(segment_name, hls_params().base_url,
+                           master_playlist_dir_, media_playlist->file_name());
+    media_playlist->AddSegment(segment_url, start_time, duration,
+                               start_byte_offset, size);
+    stream->memory.Set(media_playlist->EstimateMemoryUsage());
+    UpdateLastPart(stream);
+
+    // Update target duration.
+    uint32_t longest_segment_duration = static_cast<uint32_t>(
+        ceil(media_playlist->GetLongestSegmentDuration()));
+    base::AutoLock auto_lock(lock_);
+    if (longest_segment_duration > target_duration_) {
+      target_duration_ = longest_segment_duration;
+      target_duration_updated = true;
+    }
   }
 
   // Update the playlists when there is new segments in live mode.
   if (hls_params().playlist_type == HlsPlaylistType::kLive ||
       hls_params().playlist_type == HlsPlaylistType::kEvent) {
+    AtomicWriteBatch write_batch;
     // Update all playlists if target duration is updated.
     if (target_duration_updated) {
-      for (MediaPlaylist* playlist : media_playlists_) {
-        playlist->SetTargetDuration(target_duration_);
-        if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
+      for (StreamEntry* other_stream : GetStreamEntries()) {
+        if (!WriteStreamPlaylist(other_stream, true))
           return false;
       }
-    } else {
-      if (!WriteMediaPlaylist(master_playlist_dir_, media_playlist.get()))
-        return false;
-    }
-    if (!master_playlist_->WriteMasterPlaylist(
-            hls_params().base_url, master_playlist_dir_, media_playlists_)) {
-      LOG(ERROR) << "Failed to write master playlist.";
+    } else if (!WriteStreamPlaylist(stream, false)) {
       return false;
     }
+    return WriteMasterPlaylist();
+  }
+  return true;
+}
+
+bool SimpleHlsNotifier::NotifyNewPart(uint32_t stream_id,
+                                      const std::string& segment_name,
+                                      uint64_t start_time,
+                                      uint64_t duration,
+                                      uint64_t start_byte_offset,
+                                      uint64_t size) {
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
+    return false;
+  {
+    base::AutoLock playlist_lock(stream->lock);
+    MediaPlaylist* media_playlist = stream->media_playlist.get();
+    const std::string& segment_url =
+        GenerateSegmentUrl(segment_name, hls_params().base_url,
+                           master_playlist_dir_, media_playlist->file_name());
+    media_playlist->AddPart(segment_url, start_time, duration,
+                            start_byte_offset, size);
+    UpdateLastPart(stream);
+  }
+
+  // Only live playlists list the parts. Unlike new segments, new parts do not
+  // change the master playlist or the target duration, so only this playlist
+  // needs to be updated.
+  if (hls_params().playlist_type == HlsPlaylistType::kLive ||
+      hls_params().playlist_type == HlsPlaylistType::kEvent) {
+    return WriteStreamPlaylist(stream, false);
   }
   return true;
 }
@@ -412,26 +481,20 @@ bool SimpleHlsNotifier::NotifyKeyFrame(uint32_t stream_id,
                                        uint64_t timestamp,
                                        uint64_t start_byte_offset,
                                        uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  media_playlist->AddKeyFrame(timestamp, start_byte_offset, size);
+  base::AutoLock playlist_lock(stream->lock);
+  stream->media_playlist->AddKeyFrame(timestamp, start_byte_offset, size);
   return true;
 }
 
 bool SimpleHlsNotifier::NotifyCueEvent(uint32_t stream_id, uint64_t timestamp) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  media_playlist->AddPlacementOpportunity();
+  base::AutoLock playlist_lock(stream->lock);
+  stream->media_playlist->AddPlacementOpportunity();
   return true;
 }
 
@@ -441,23 +504,20 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
     const std::vector<uint8_t>& system_id,
     const std::vector<uint8_t>& iv,
     const std::vector<uint8_t>& protection_system_specific_data) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
-  }
+  base::AutoLock playlist_lock(stream->lock);
 
-  std::unique_ptr<MediaPlaylist>& media_playlist =
-      stream_iterator->second->media_playlist;
+  MediaPlaylist* media_playlist = stream->media_playlist.get();
   const MediaPlaylist::EncryptionMethod encryption_method =
-      stream_iterator->second->encryption_method;
+      stream->encryption_method;
   LOG_IF(WARNING, encryption_method == MediaPlaylist::EncryptionMethod::kNone)
       << "Got encryption notification but the encryption method is NONE";
   if (IsWidevineSystemId(system_id)) {
     return HandleWidevineKeyFormats(encryption_method,
                                     key_id, iv, protection_system_specific_data,
-                                    media_playlist.get());
+                                    media_playlist);
   }
 
   // Key Id does not need to be specified with "identity" and "sdk".
@@ -472,7 +532,7 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
       key_uri = Base64EncodeData(kUriBase64Prefix, key_uri_data);
     }
     NotifyEncryptionToMediaPlaylist(encryption_method, key_uri, empty_key_id,
-                                    iv, "identity", "", media_playlist.get());
+                                    iv, "identity", "", media_playlist);
     return true;
   }
   if (IsFairPlaySystemId(system_id)) {
@@ -488,7 +548,7 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
     const std::vector<uint8_t> empty_iv;
     NotifyEncryptionToMediaPlaylist(encryption_method, key_uri, empty_key_id,
                                     empty_iv, "com.apple.streamingkeydelivery",
-                                    "1", media_playlist.get());
+                                    "1", media_playlist);
     return true;
   }
 
@@ -497,15 +557,143 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
   return true;
 }
 
+bool SimpleHlsNotifier::SetSequenceNumbers(
+    uint32_t stream_id,
+    uint32_t media_sequence_number,
+    int discontinuity_sequence_number) {
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
+    return false;
+  base::AutoLock playlist_lock(stream->lock);
+  stream->media_playlist->SetSequenceNumbers(media_sequence_number,
+                                             discontinuity_sequence_number);
+  return true;
+}
+
+bool SimpleHlsNotifier::RemoveStream(const std::string& segment_template) {
+  bool removed = false;
+  {
+    base::AutoLock auto_lock(lock_);
+    for (auto iter = stream_map_.begin(); iter != stream_map_.end();) {
+      if (iter->second->segment_template != segment_template) {
+        ++iter;
+        continue;
+      }
+      media_playlists_.remove(iter->second->media_playlist.get());
+      removed_streams_.push_back(std::move(iter->second));
+      iter = stream_map_.erase(iter);
+      removed = true;
+    }
+  }
+  if (!removed) {
+    LOG(ERROR) << "Cannot find stream with segment template "
+               << segment_template;
+    return false;
+  }
+  return WriteMasterPlaylist();
+}
+
 bool SimpleHlsNotifier::Flush() {
-  base::AutoLock auto_lock(lock_);
-  for (MediaPlaylist* playlist : media_playlists_) {
-    playlist->SetTargetDuration(target_duration_);
-    if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
+  AtomicWriteBatch write_batch;
+  for (StreamEntry* stream : GetStreamEntries()) {
+    if (!WriteStreamPlaylist(stream, true))
       return false;
   }
-  if (!master_playlist_->WriteMasterPlaylist(
-          hls_params().base_url, master_playlist_dir_, media_playlists_)) {
+  return WriteMasterPlaylist();
+}
+
+SimpleHlsNotifier::StreamEntry* SimpleHlsNotifier::GetStreamEntry(
+    uint32_t stream_id) {
+  base::AutoLock auto_lock(lock_);
+  auto stream_iterator = stream_map_.find(stream_id);
+  if (stream_iterator == stream_map_.end()) {
+    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+    return nullptr;
+  }
+  return stream_iterator->second.get();
+}
+
+std::vector<SimpleHlsNotifier::StreamEntry*>
+SimpleHlsNotifier::GetStreamEntries() {
+  base::AutoLock auto_lock(lock_);
+  std::vector<StreamEntry*> streams;
+  streams.reserve(stream_map_.size());
+  for (const auto& stream : stream_map_)
+    streams.push_back(stream.second.get());
+  return streams;
+}
+
+void SimpleHlsNotifier::UpdateLastPart(StreamEntry* stream) {
+  uint32_t media_sequence_number = 0;
+  uint32_t part_index = 0;
+  const bool has_last_part = stream->media_playlist->GetLastPart(
+      &media_sequence_number, &part_index);
+
+  base::AutoLock auto_lock(lock_);
+  stream->has_last_part = has_last_part;
+  stream->last_media_sequence_number = media_sequence_number;
+  stream->last_part_index = part_index;
+}
+
+void SimpleHlsNotifier::UpdateRenditionReports(StreamEntry* stream) {
+  MediaPlaylist* playlist = stream->media_playlist.get();
+  std::vector<MediaPlaylist::RenditionReport> rendition_reports;
+  {
+    base::AutoLock auto_lock(lock_);
+    for (const auto& other_stream : stream_map_) {
+      if (other_stream.second.get() == stream ||
+          !other_stream.second->has_last_part) {
+        continue;
+      }
+      MediaPlaylist::RenditionReport rendition_report;
+      rendition_report.last_media_sequence_number =
+          other_stream.second->last_media_sequence_number;
+      rendition_report.last_part_index = other_stream.second->last_part_index;
+      // The file names of the playlists do not change.
+      rendition_report.uri = GeneratePlaylistUrl(
+          other_stream.second->media_playlist->file_name(),
+          hls_params().base_url, playlist->file_name());
+      rendition_reports.push_back(rendition_report);
+    }
+  }
+  playlist->SetRenditionReports(rendition_reports);
+}
+
+bool SimpleHlsNotifier::WriteStreamPlaylist(StreamEntry* stream,
+                                            bool update_target_duration) {
+  base::AutoLock playlist_lock(stream->lock);
+  MediaPlaylist* playlist = stream->media_playlist.get();
+  if (update_target_duration) {
+    uint32_t target_duration = 0;
+    {
+      base::AutoLock auto_lock(lock_);
+      target_duration = target_duration_;
+    }
+    playlist->SetTargetDuration(target_duration);
+  }
+  UpdateRenditionReports(stream);
+  return WriteMediaPlaylist(master_playlist_dir_, playlist);
+}
+
+bool SimpleHlsNotifier::WriteMasterPlaylist() {
+  const std::vector<StreamEntry*> streams = GetStreamEntries();
+  std::list<MediaPlaylist*> media_playlists;
+  {
+    base::AutoLock auto_lock(lock_);
+    media_playlists = media_playlists_;
+  }
+
+  base::AutoLock master_playlist_lock(master_playlist_lock_);
+  // The master playlist is generated from the state of all the media
+  // playlists. It is only written out if it changed.
+  for (StreamEntry* stream : streams)
+    stream->lock.Acquire();
+  const bool result = master_playlist_->WriteMasterPlaylist(
+      hls_params().base_url, master_playlist_dir_, media_playlists);
+  for (auto stream = streams.rbegin(); stream != streams.rend(); ++stream)
+    (*stream)->lock.Release();
+
+  if (!result) {
     LOG(ERROR) << "Failed to write master playlist.";
     return false;
   }
@@ -19,6 +19,7 @@
 #include "packager/hls/base/master_playlist.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/hls/public/hls_params.h"
+#include "packager/metrics/memory_budget.h"
 
 namespace shaka {
 namespace hls {
@@ -57,6 +58,12 @@ class SimpleHlsNotifier : public HlsNotifier {
                         uint64_t duration,
                         uint64_t start_byte_offset,
                         uint64_t size) override;
+  bool NotifyNewPart(uint32_t stream_id,
+                     const std::string& segment_name,
+                     uint64_t start_time,
+                     uint64_t duration,
+                     uint64_t start_byte_offset,
+                     uint64_t size) override;
   bool NotifyKeyFrame(uint32_t stream_id,
                       uint64_t timestamp,
                       uint64_t start_byte_offset,
@@ -68,30 +75,79 @@ class SimpleHlsNotifier : public HlsNotifier {
       const std::vector<uint8_t>& system_id,
       const std::vector<uint8_t>& iv,
       const std::vector<uint8_t>& protection_system_specific_data) override;
+  bool SetSequenceNumbers(uint32_t stream_id,
+                          uint32_t media_sequence_number,
+                          int discontinuity_sequence_number) override;
+  bool RemoveStream(const std::string& segment_template) override;
   bool Flush() override;
   /// }@
 
  private:
   friend class SimpleHlsNotifierTest;
 
+  // The locks are taken in this order: |master_playlist_lock_|, then the
+  // |lock| of the streams in the order of their IDs, then |lock_|. The
+  // playlist files are written with the lock of their stream only, so the
+  // renditions are updated in parallel.
   struct StreamEntry {
-    std::unique_ptr<MediaPlaylist> media_playlist;
-    MediaPlaylist::EncryptionMethod encryption_method;
+    StreamEntry(std::unique_ptr<MediaPlaylist> media_playlist,
+                MediaPlaylist::EncryptionMethod encryption_method,
+                const std::string& segment_template)
+        : media_playlist(std::move(media_playlist)),
+          encryption_method(encryption_method),
+          segment_template(segment_template) {}
+
+    // Guards |media_playlist|, including writing it out.
+    base::Lock lock;
+    const std::unique_ptr<MediaPlaylist> media_playlist;
+    const MediaPlaylist::EncryptionMethod encryption_method;
+    const std::string segment_template;
+    // The memory of |media_playlist|. Guarded by |lock|.
+    MemoryUsage memory{MemoryBudget::kManifestState};
+    // The last partial segment of |media_playlist|, for the rendition reports
+    // of the other playlists. Guarded by |lock_|.
+    bool has_last_part = false;
+    uint32_t last_media_sequence_number = 0;
+    uint32_t last_part_index = 0;
   };
 
+  // @return The stream with |stream_id|, or null if it does not exist.
+  StreamEntry* GetStreamEntry(uint32_t stream_id);
+  // @return All the streams, in the order of their IDs.
+  std::vector<StreamEntry*> GetStreamEntries();
+  // Publish the last partial segment of the playlist of |stream|. The caller
+  // holds the lock of |stream|.
+  void UpdateLastPart(StreamEntry* stream);
+  // Set the rendition reports of the other playlists in the playlist of
+  // |stream|, before it is written out. The caller holds the lock of
+  // |stream|.
+  void UpdateRenditionReports(StreamEntry* stream);
+  // Write the media playlist of |stream| out, with the current target duration
+  // if |update_target_duration| is set.
+  bool WriteStreamPlaylist(StreamEntry* stream, bool update_target_duration);
+  // Write the master playlist out if its content changed.
+  bool WriteMasterPlaylist();
+
   std::string master_playlist_dir_;
-  uint32_t target_duration_ = 0;
 
   std::unique_ptr<MediaPlaylistFactory> media_playlist_factory_;
   std::unique_ptr<MasterPlaylist> master_playlist_;
+  // Serializes the writes of the master playlist.
+  base::Lock master_playlist_lock_;
 
+  // Guards the members below, but not the playlists of the streams.
+  base::Lock lock_;
+  uint32_t target_duration_ = 0;
   // Maps to unique_ptr because StreamEntry also holds unique_ptr
   std::map<uint32_t, std::unique_ptr<StreamEntry>> stream_map_;
   std::list<MediaPlaylist*> media_playlists_;
-
   uint32_t sequence_number_ = 0;
+  // The streams removed by RemoveStream(), which are kept as the other
+  // threads may still hold them.
+  std::vector<std::unique_ptr<StreamEntry>> removed_streams_;
 
-  base::Lock lock_;
+  // Reports the memory used by the playlists to the metrics.
+  int metrics_collector_id_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(SimpleHlsNotifier);
 };
@@ -270,6 +270,58 @@ TEST_F(SimpleHlsNotifierTest, NotifyKeyFrame) {
       notifier.NotifyKeyFrame(stream_id, kTimestamp, kStartByteOffset, kSize));
 }
 
+TEST_F(SimpleHlsNotifierTest, RemoveStream) {
+  std::unique_ptr<MockMasterPlaylist> mock_master_playlist(
+      new MockMasterPlaylist());
+  std::unique_ptr<MockMediaPlaylistFactory> factory(
+      new MockMediaPlaylistFactory());
+
+  // Pointers released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist =
+      new MockMediaPlaylist("video.m3u8", "", "");
+  MockMediaPlaylist* mock_iframe_playlist =
+      new MockMediaPlaylist("video_iframe.m3u8", "", "");
+  MockMediaPlaylist* mock_audio_playlist =
+      new MockMediaPlaylist("audio.m3u8", "", "");
+  EXPECT_CALL(*mock_media_playlist, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*mock_iframe_playlist, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*mock_audio_playlist, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*factory, CreateMock(_, _, _, _))
+      .WillOnce(Return(mock_media_playlist))
+      .WillOnce(Return(mock_iframe_playlist))
+      .WillOnce(Return(mock_audio_playlist));
+
+  // Both playlists of the video stream are removed from the master playlist.
+  EXPECT_CALL(*mock_master_playlist,
+              WriteMasterPlaylist(_, _, ElementsAre(mock_audio_playlist)))
+      .WillOnce(Return(true));
+
+  SimpleHlsNotifier notifier(hls_params_);
+  InjectMasterPlaylist(std::move(mock_master_playlist), &notifier);
+  InjectMediaPlaylistFactory(std::move(factory), &notifier);
+  EXPECT_TRUE(notifier.Init());
+
+  MediaInfo video_media_info;
+  video_media_info.set_segment_template("video-$Number$.ts");
+  MediaInfo audio_media_info;
+  audio_media_info.set_segment_template("audio-$Number$.ts");
+  uint32_t video_stream_id;
+  uint32_t iframe_stream_id;
+  uint32_t audio_stream_id;
+  EXPECT_TRUE(notifier.NotifyNewStream(video_media_info, "video.m3u8", "name",
+                                       "groupid", &video_stream_id));
+  EXPECT_TRUE(notifier.NotifyNewStream(video_media_info, "video_iframe.m3u8",
+                                       "name", "groupid", &iframe_stream_id));
+  EXPECT_TRUE(notifier.NotifyNewStream(audio_media_info, "audio.m3u8", "name",
+                                       "groupid", &audio_stream_id));
+
+  EXPECT_TRUE(notifier.RemoveStream("video-$Number$.ts"));
+  EXPECT_EQ(1u, NumRegisteredMediaPlaylists(notifier));
+  EXPECT_FALSE(notifier.NotifyNewSegment(video_stream_id, "anything", 0u, 0u,
+                                         0u, 0u));
+  EXPECT_FALSE(notifier.RemoveStream("video-$Number$.ts"));
+}
+
 TEST_F(SimpleHlsNotifierTest, NotifyNewSegmentWithoutStreamsRegistered) {
   SimpleHlsNotifier notifier(hls_params_);
   EXPECT_TRUE(notifier.Init());
@@ -577,6 +629,53 @@ TEST_P(LiveOrEventSimpleHlsNotifierTest, NotifyNewSegment) {
                                         kDuration, 0, kSize));
 }
 
+TEST_P(LiveOrEventSimpleHlsNotifierTest, NotifyNewPart) {
+  std::unique_ptr<MockMasterPlaylist> mock_master_playlist(
+      new MockMasterPlaylist());
+  std::unique_ptr<MockMediaPlaylistFactory> factory(
+      new MockMediaPlaylistFactory());
+
+  // Pointer released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist =
+      new MockMediaPlaylist("playlist.m3u8", "", "");
+
+  EXPECT_CALL(*mock_media_playlist, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*factory, CreateMock(_, _, _, _))
+      .WillOnce(Return(mock_media_playlist));
+
+  const uint64_t kStartTime = 1328;
+  const uint64_t kDuration = 18000;
+  const uint64_t kStartByteOffset = 100;
+  const uint64_t kSize = 65958;
+  const std::string segment_name = "segmentname";
+  EXPECT_CALL(*mock_media_playlist,
+              AddPart(StrEq(kTestPrefix + segment_name), kStartTime, kDuration,
+                      kStartByteOffset, kSize));
+
+  // Only the media playlist is updated on new parts.
+  EXPECT_CALL(*mock_master_playlist, WriteMasterPlaylist(_, _, _)).Times(0);
+  EXPECT_CALL(*mock_media_playlist, SetTargetDuration(_)).Times(0);
+  EXPECT_CALL(*mock_media_playlist,
+              WriteToFile(StrEq(
+                  base::FilePath::FromUTF8Unsafe(kAnyOutputDir)
+                      .Append(base::FilePath::FromUTF8Unsafe("playlist.m3u8"))
+                      .AsUTF8Unsafe())))
+      .WillOnce(Return(true));
+
+  hls_params_.playlist_type = GetParam();
+  SimpleHlsNotifier notifier(hls_params_);
+  InjectMasterPlaylist(std::move(mock_master_playlist), &notifier);
+  InjectMediaPlaylistFactory(std::move(factory), &notifier);
+  EXPECT_TRUE(notifier.Init());
+  MediaInfo media_info;
+  uint32_t stream_id;
+  EXPECT_TRUE(notifier.NotifyNewStream(media_info, "playlist.m3u8", "name",
+                                       "groupid", &stream_id));
+
+  EXPECT_TRUE(notifier.NotifyNewPart(stream_id, segment_name, kStartTime,
+                                     kDuration, kStartByteOffset, kSize));
+}
+
 TEST_P(LiveOrEventSimpleHlsNotifierTest, NotifyNewSegmentsWithMultipleStreams) {
   const uint64_t kStartTime = 1328;
   const uint64_t kDuration = 398407;
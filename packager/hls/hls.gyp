@@ -29,11 +29,26 @@
         '../file/file.gyp:file',
         '../media/base/media_base.gyp:media_base',
         '../media/base/media_base.gyp:widevine_pssh_data_proto',
+        '../metrics/metrics.gyp:metrics',
         '../mpd/mpd.gyp:manifest_base',
         '../mpd/mpd.gyp:media_info_proto',
         '../third_party/gflags/gflags.gyp:gflags',
       ],
     },
+    {
+      'target_name': 'hls_util',
+      'type': '<(component)',
+      'sources': [
+        'util/hls_writer.cc',
+        'util/hls_writer.h',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../mpd/mpd.gyp:media_info_proto',
+        '../mpd/mpd.gyp:mpd_util',
+        'hls_builder',
+      ],
+    },
     {
       'target_name': 'hls_unittest',
       'type': '<(gtest_target_type)',
@@ -38,6 +38,16 @@ struct HlsParams {
   /// accessible as they may still be accessed by the player. The segments are
   /// not removed if the value is zero.
   size_t preserved_segments_outside_live_window = 0;
+  /// Duration, in seconds, of the sliding window of the latest segments used
+  /// to estimate the BANDWIDTH and AVERAGE-BANDWIDTH of the streams. The
+  /// latest segment is always included. All the segments are used if the value
+  /// is zero. The window is at most @a time_shift_buffer_depth for live
+  /// playlists.
+  double bandwidth_estimation_window = 0;
+  /// Write a gzip copy of each playlist beside it, with a ".gz" extension,
+  /// compressed once per update so that the origin can serve them without
+  /// compressing them per request.
+  bool gzip_manifests = false;
   /// Defines the key uri for "identity" and "com.apple.streamingkeydelivery"
   /// key formats. Ignored if the playlist is not encrypted or not using the
   /// above key formats.
@@ -59,9 +69,26 @@ struct HlsParams {
   /// be populated from segment duration specified in ChunkingParams if not
   /// specified.
   double target_segment_duration = 0;
+  /// The target duration of the partial segments (EXT-X-PART), i.e. the
+  /// low latency chunks of the segments. The longest partial segment duration
+  /// is used instead if it is longer. It will be populated from the low
+  /// latency chunk duration specified in ChunkingParams if not specified.
+  double part_target_duration = 0;
   /// Custom EXT-X-MEDIA-SEQUENCE value to allow continuous media playback
   /// across packager restarts. See #691 for details.
   uint32_t media_sequence_number = 0;
+  /// If positive, LIVE and EVENT media playlists advertise Playlist Delta
+  /// Updates with this skip boundary (CAN-SKIP-UNTIL), in seconds, and a
+  /// delta playlist, with the segments older than the skip boundary replaced
+  /// by an EXT-X-SKIP tag, is written next to each of them, with "_delta"
+  /// inserted before the extension. It is raised to six target durations,
+  /// the minimum allowed, if shorter.
+  double skip_boundary = 0;
+  /// Tag the segments of the media playlists with EXT-X-PROGRAM-DATE-TIME.
+  /// The media timeline of each playlist is anchored to the wall clock when
+  /// its first segment is added, i.e. when the input of the segment has been
+  /// packaged, so the tags are close to the time the content arrived.
+  bool program_date_time = false;
 };
 
 }  // namespace shaka
@@ -0,0 +1,137 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/hls/util/hls_writer.h"
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/hls/base/simple_hls_notifier.h"
+#include "packager/mpd/util/time_shard_merger.h"
+
+namespace shaka {
+namespace hls {
+
+namespace {
+
+// Notify the encryption of the stream |stream_id|, as recorded in
+// |protected_content|.
+bool NotifyEncryption(const MediaInfo::ProtectedContent& protected_content,
+                      uint32_t stream_id,
+                      HlsNotifier* notifier) {
+  const std::vector<uint8_t> key_id(protected_content.default_key_id().begin(),
+                                    protected_content.default_key_id().end());
+  const std::vector<uint8_t> iv(protected_content.iv().begin(),
+                                protected_content.iv().end());
+  for (const auto& entry : protected_content.content_protection_entry()) {
+    std::string uuid_hex;
+    base::RemoveChars(entry.uuid(), "-", &uuid_hex);
+    std::vector<uint8_t> system_id;
+    if (!base::HexStringToBytes(uuid_hex, &system_id)) {
+      LOG(ERROR) << "Invalid DRM system UUID " << entry.uuid();
+      return false;
+    }
+    const std::vector<uint8_t> pssh(entry.pssh().begin(), entry.pssh().end());
+    if (!notifier->NotifyEncryptionUpdate(stream_id, key_id, system_id, iv,
+                                          pssh)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+HlsWriter::HlsWriter() {}
+HlsWriter::~HlsWriter() {}
+
+void HlsWriter::AddMediaInfo(const MediaInfo& media_info) {
+  media_infos_.push_back(media_info);
+}
+
+bool HlsWriter::WriteToFile(const std::string& master_playlist_output,
+                            const std::string& base_url) {
+  HlsParams hls_params;
+  hls_params.playlist_type = HlsPlaylistType::kVod;
+  hls_params.master_playlist_output = master_playlist_output;
+  hls_params.base_url = base_url;
+  return WriteToFile(hls_params);
+}
+
+bool HlsWriter::WriteToFile(const HlsParams& hls_params) {
+  std::vector<MediaInfo> media_infos = media_infos_;
+  if (!MergeTimeShards(&media_infos)) {
+    LOG(ERROR) << "Failed to merge the time shards of the streams.";
+    return false;
+  }
+
+  SimpleHlsNotifier notifier(hls_params);
+  if (!notifier.Init()) {
+    LOG(ERROR) << "Failed to initialize the HLS notifier.";
+    return false;
+  }
+
+  for (size_t i = 0; i < media_infos.size(); ++i) {
+    const MediaInfo& media_info = media_infos[i];
+    if (media_info.segments_size() == 0) {
+      LOG(ERROR) << "HLS playlists require the segments of the streams, "
+                    "which are only recorded for segment templates: "
+                 << media_info.media_file_name();
+      return false;
+    }
+    const std::string playlist_name =
+        media_info.hls_playlist_name().empty()
+            ? base::StringPrintf("stream_%zu.m3u8", i)
+            : media_info.hls_playlist_name();
+    const std::string name = media_info.hls_name().empty()
+                                 ? base::StringPrintf("stream_%zu", i)
+                                 : media_info.hls_name();
+    if (!AddStream(media_info, playlist_name, name, &notifier))
+      return false;
+  }
+
+  if (!notifier.Flush()) {
+    LOG(ERROR) << "Failed to write the HLS playlists.";
+    return false;
+  }
+  return true;
+}
+
+bool HlsWriter::AddStream(const MediaInfo& media_info,
+                          const std::string& playlist_name,
+                          const std::string& name,
+                          HlsNotifier* notifier) {
+  MediaInfo stream_media_info = media_info;
+  stream_media_info.clear_segments();
+  uint32_t stream_id;
+  if (!notifier->NotifyNewStream(stream_media_info, playlist_name, name,
+                                 media_info.hls_group_id(), &stream_id)) {
+    LOG(ERROR) << "Failed to add the stream of "
+               << media_info.segment_template();
+    return false;
+  }
+  if (media_info.has_protected_content() &&
+      !NotifyEncryption(media_info.protected_content(), stream_id, notifier)) {
+    LOG(ERROR) << "Failed to add the encryption of "
+               << media_info.segment_template();
+    return false;
+  }
+  for (const MediaInfo::Segment& segment : media_info.segments()) {
+    const uint64_t kStartByteOffset = 0;
+    if (!notifier->NotifyNewSegment(stream_id, segment.name(),
+                                    segment.start_time(), segment.duration(),
+                                    kStartByteOffset, segment.size())) {
+      LOG(ERROR) << "Failed to add the segments of "
+                 << media_info.segment_template();
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace hls
+}  // namespace shaka
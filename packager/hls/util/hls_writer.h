@@ -0,0 +1,72 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_HLS_UTIL_HLS_WRITER_H_
+#define PACKAGER_HLS_UTIL_HLS_WRITER_H_
+
+#include <string>
+#include <vector>
+
+#include "packager/hls/public/hls_params.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+namespace hls {
+
+class HlsNotifier;
+
+/// HlsWriter generates the HLS playlists of streams from their MediaInfo, the
+/// way MpdWriter generates an MPD, without the media. The MediaInfo must
+/// record the segments of the streams, i.e. be dumped from outputs with a
+/// segment template, see PackagingParams.output_media_info, and the MediaInfo
+/// of the time shards of a stream are merged, see MergeTimeShards(). The
+/// I-frame playlists are not generated.
+class HlsWriter {
+ public:
+  HlsWriter();
+  ~HlsWriter();
+
+  /// Add @a media_info, e.g. as read by MpdWriter::ReadMediaInfoFile().
+  void AddMediaInfo(const MediaInfo& media_info);
+
+  /// Write the VOD master playlist to @a master_playlist_output, and the media
+  /// playlists of the streams, named after MediaInfo.hls_playlist_name or
+  /// "stream_<index>.m3u8", next to it.
+  /// @param base_url is the prefix of the playlists and the segments listed,
+  ///        which are relative to the master playlist if it is empty.
+  /// @return true on success, false otherwise.
+  bool WriteToFile(const std::string& master_playlist_output,
+                   const std::string& base_url);
+
+  /// Write the master playlist and the media playlists as above, to
+  /// HlsParams.master_playlist_output, with the base URL, key URI, playlist
+  /// type and the other options of @a hls_params, e.g. to regenerate the
+  /// playlists of packaged content with other options.
+  /// @return true on success, false otherwise.
+  bool WriteToFile(const HlsParams& hls_params);
+
+  /// Add the stream of @a media_info, with its segments and its encryption,
+  /// to @a notifier, e.g. to add an output packaged by a previous run to the
+  /// playlists of the current one.
+  /// @param playlist_name is the name of the media playlist of the stream.
+  /// @param name is the NAME attribute of the stream.
+  /// @return true on success, false otherwise.
+  static bool AddStream(const MediaInfo& media_info,
+                        const std::string& playlist_name,
+                        const std::string& name,
+                        HlsNotifier* notifier);
+
+ private:
+  HlsWriter(const HlsWriter&) = delete;
+  HlsWriter& operator=(const HlsWriter&) = delete;
+
+  std::vector<MediaInfo> media_infos_;
+};
+
+}  // namespace hls
+}  // namespace shaka
+
+#endif  // PACKAGER_HLS_UTIL_HLS_WRITER_H_
@@ -10,6 +10,7 @@
 #include <openssl/crypto.h>
 #include <openssl/err.h>
 #include <openssl/rand.h>
+#include <openssl/sha.h>
 
 #include <string>
 #include <vector>
@@ -24,14 +25,24 @@ bool IsIvSizeValid(size_t iv_size) {
   return iv_size == 8 || iv_size == 16;
 }
 
+// ISO/IEC 23001-7:2016 10.1 and 10.3 For 'cenc' and 'cens'
+// default_Per_Sample_IV_Size and Per_Sample_IV_Size SHOULD be 8-bytes.
+// There is no official guideline on the iv size for 'cbc1' and 'cbcs',
+// but 16-byte provides better security.
+size_t GetIvSize(shaka::media::FourCC protection_scheme) {
+  return (protection_scheme == shaka::media::FOURCC_cenc ||
+          protection_scheme == shaka::media::FOURCC_cens)
+             ? 8
+             : 16;
+}
+
 }  // namespace
 
 namespace shaka {
 namespace media {
 
 AesCryptor::AesCryptor(ConstantIvFlag constant_iv_flag)
-    : aes_key_(new AES_KEY),
-      constant_iv_flag_(constant_iv_flag),
+    : constant_iv_flag_(constant_iv_flag),
       num_crypt_bytes_(0) {
   CRYPTO_library_init();
 }
@@ -107,16 +118,16 @@ void AesCryptor::UpdateIv() {
   SetIvInternal();
 }
 
+void AesCryptor::UpdateIvForCryptedBytes(size_t num_crypt_bytes) {
+  if (constant_iv_flag_ == kUseConstantIv)
+    return;
+  num_crypt_bytes_ += num_crypt_bytes;
+  UpdateIv();
+}
+
 bool AesCryptor::GenerateRandomIv(FourCC protection_scheme,
                                   std::vector<uint8_t>* iv) {
-  // ISO/IEC 23001-7:2016 10.1 and 10.3 For 'cenc' and 'cens'
-  // default_Per_Sample_IV_Size and Per_Sample_IV_Size SHOULD be 8-bytes.
-  // There is no official guideline on the iv size for 'cbc1' and 'cbcs',
-  // but 16-byte provides better security.
-  const size_t iv_size =
-      (protection_scheme == FOURCC_cenc || protection_scheme == FOURCC_cens)
-          ? 8
-          : 16;
+  const size_t iv_size = GetIvSize(protection_scheme);
   iv->resize(iv_size);
   if (RAND_bytes(iv->data(), iv_size) != 1) {
     LOG(ERROR) << "RAND_bytes failed with error: "
@@ -126,6 +137,18 @@ bool AesCryptor::GenerateRandomIv(FourCC protection_scheme,
   return true;
 }
 
+void AesCryptor::DeriveIv(FourCC protection_scheme,
+                          const std::string& secret,
+                          int64_t position,
+                          std::vector<uint8_t>* iv) {
+  std::string data = secret;
+  for (int shift = 56; shift >= 0; shift -= 8)
+    data.push_back(static_cast<char>(position >> shift));
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(data.data()), data.size(), digest);
+  iv->assign(digest, digest + GetIvSize(protection_scheme));
+}
+
 size_t AesCryptor::NumPaddingBytes(size_t size) const {
   // No padding by default.
   return 0;
@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "packager/base/macros.h"
@@ -78,6 +79,13 @@ class AesCryptor {
   /// This is used by encryptors only. It is a NOP if using kUseConstantIv.
   void UpdateIv();
 
+  /// Update IV for next sample as UpdateIv() does, for a sample with
+  /// @a num_crypt_bytes encrypted bytes that was encrypted with the current iv
+  /// by another cryptor. Any bytes passed through Crypt() since the iv was
+  /// last updated are counted too.
+  /// This is used by encryptors only. It is a NOP if using kUseConstantIv.
+  void UpdateIvForCryptedBytes(size_t num_crypt_bytes);
+
   /// @return The current iv.
   const std::vector<uint8_t>& iv() const { return iv_; }
 
@@ -91,9 +99,28 @@ class AesCryptor {
   static bool GenerateRandomIv(FourCC protection_scheme,
                                std::vector<uint8_t>* iv);
 
+  /// Derive an initialization vector instead of generating a random one, so
+  /// that the samples of a stream are encrypted the same way by every
+  /// packager.
+  /// @param protection_scheme determines the iv size, as with
+  ///        GenerateRandomIv.
+  /// @param secret is unique to the key and the stream, e.g. the key followed
+  ///        by an identifier of the stream.
+  /// @param position identifies the sample in the stream, e.g. its decoding
+  ///        timestamp.
+  /// @param iv points to derived initialization vector.
+  static void DeriveIv(FourCC protection_scheme,
+                       const std::string& secret,
+                       int64_t position,
+                       std::vector<uint8_t>* iv);
+
  protected:
   const AES_KEY* aes_key() const { return aes_key_.get(); }
-  AES_KEY* mutable_aes_key() { return aes_key_.get(); }
+  /// Set the expanded key, which is shared with other cryptors using the same
+  /// key. See AesKeyScheduleCache.
+  void set_aes_key(std::shared_ptr<const AES_KEY> aes_key) {
+    aes_key_ = std::move(aes_key);
+  }
 
  private:
   // Internal implementation of crypt function.
@@ -119,8 +146,8 @@ class AesCryptor {
   // Note: No paddings should be needed except for pkcs5-cbc encryptor.
   virtual size_t NumPaddingBytes(size_t size) const;
 
-  // Openssl AES_KEY.
-  std::unique_ptr<AES_KEY> aes_key_;
+  // Openssl AES_KEY. It is immutable and may be shared with other cryptors.
+  std::shared_ptr<const AES_KEY> aes_key_;
 
   // Indicates whether a constant iv is used. Internal iv will be reset to
   // |iv_| before calling Crypt if that is the case.
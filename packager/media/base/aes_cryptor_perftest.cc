@@ -0,0 +1,71 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/aes_pattern_cryptor.h"
+#include "packager/media/test/perf_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const size_t kSampleSize = 1024 * 1024;
+const uint8_t kCryptByteBlock = 1u;
+const uint8_t kSkipByteBlock = 9u;
+
+std::vector<uint8_t> GetKey() {
+  return std::vector<uint8_t>(16, 0x11);
+}
+
+std::vector<uint8_t> GetIv() {
+  return std::vector<uint8_t>(16, 0x22);
+}
+
+// Measures the throughput of |cryptor| encrypting |kSampleSize| byte samples.
+void MeasureCryptorThroughput(const std::string& trace, AesCryptor* cryptor) {
+  ASSERT_TRUE(cryptor->InitializeWithIv(GetKey(), GetIv()));
+
+  std::vector<uint8_t> clear(kSampleSize);
+  for (size_t i = 0; i < clear.size(); ++i)
+    clear[i] = static_cast<uint8_t>(i);
+  std::vector<uint8_t> encrypted(kSampleSize);
+
+  MeasureThroughput("aes_encryption", trace, clear.size(), [&]() {
+    CHECK(cryptor->Crypt(clear.data(), clear.size(), encrypted.data()));
+  });
+}
+
+}  // namespace
+
+TEST(AesCryptorPerfTest, Ctr) {
+  AesCtrEncryptor encryptor;
+  MeasureCryptorThroughput("cenc_ctr", &encryptor);
+}
+
+TEST(AesCryptorPerfTest, Cbc) {
+  AesCbcEncryptor encryptor(kNoPadding, AesCryptor::kUseConstantIv);
+  MeasureCryptorThroughput("cbc1_cbc", &encryptor);
+}
+
+TEST(AesCryptorPerfTest, CbcsPattern) {
+  AesPatternCryptor encryptor(
+      kCryptByteBlock, kSkipByteBlock,
+      AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+      AesCryptor::kUseConstantIv,
+      std::unique_ptr<AesCryptor>(
+          new AesCbcEncryptor(kNoPadding, AesCryptor::kUseConstantIv)));
+  MeasureCryptorThroughput("cbcs_pattern", &encryptor);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -183,6 +183,44 @@ TEST_F(AesCtrEncryptorTest, 128BitIVBoundaryCaseEncryption) {
   EXPECT_EQ(encrypted, encrypted_verify);
 }
 
+TEST_F(AesCtrEncryptorTest, BulkEncryptionMatchesBytewiseEncryption) {
+  // Start two blocks before the 64-bit counter wraps around so the bulk path
+  // has to split the blocks at the wrap point.
+  const uint8_t kIvNearWrap[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+                                 0x07, 0x08, 0xff, 0xff, 0xff, 0xff,
+                                 0xff, 0xff, 0xff, 0xfe};
+  std::vector<uint8_t> iv(kIvNearWrap, kIvNearWrap + arraysize(kIvNearWrap));
+  std::vector<uint8_t> plaintext(1000);
+  for (size_t i = 0; i < plaintext.size(); ++i)
+    plaintext[i] = static_cast<uint8_t>(i * 7);
+
+  // Encrypt byte by byte, which only exercises the partial block path.
+  ASSERT_TRUE(encryptor_.InitializeWithIv(key_, iv));
+  std::vector<uint8_t> expected(plaintext.size());
+  for (size_t i = 0; i < plaintext.size(); ++i)
+    ASSERT_TRUE(encryptor_.Crypt(&plaintext[i], 1, &expected[i]));
+
+  // Encrypt in chunks that do not align with the block boundaries.
+  const size_t kChunkSizes[] = {5, 100, 11, 16, 300, 1, 567};
+  ASSERT_TRUE(encryptor_.InitializeWithIv(key_, iv));
+  std::vector<uint8_t> encrypted(plaintext.size());
+  size_t offset = 0;
+  for (size_t chunk_size : kChunkSizes) {
+    ASSERT_LE(offset + chunk_size, plaintext.size());
+    ASSERT_TRUE(
+        encryptor_.Crypt(&plaintext[offset], chunk_size, &encrypted[offset]));
+    offset += chunk_size;
+  }
+  ASSERT_EQ(plaintext.size(), offset);
+  EXPECT_EQ(expected, encrypted);
+
+  // In place bulk encryption.
+  ASSERT_TRUE(encryptor_.InitializeWithIv(key_, iv));
+  std::vector<uint8_t> buffer = plaintext;
+  ASSERT_TRUE(encryptor_.Crypt(&buffer[0], buffer.size(), &buffer[0]));
+  EXPECT_EQ(expected, buffer);
+}
+
 TEST_F(AesCtrEncryptorTest, 64BitIvUpdate) {
   std::vector<uint8_t> iv_zero(kIv64Zero, kIv64Zero + arraysize(kIv64Zero));
   ASSERT_TRUE(encryptor_.InitializeWithIv(key_, iv_zero));
@@ -205,6 +243,27 @@ TEST_F(AesCtrEncryptorTest, GenerateRandomIv) {
   LOG(INFO) << "Random IV: " << base::HexEncode(iv.data(), iv.size());
 }
 
+TEST_F(AesCtrEncryptorTest, DeriveIv) {
+  const uint8_t kCencIvSize = 8;
+  const uint8_t kCbcsIvSize = 16;
+  std::vector<uint8_t> iv;
+  AesCryptor::DeriveIv(FOURCC_cenc, "secret", 1000, &iv);
+  ASSERT_EQ(kCencIvSize, iv.size());
+
+  std::vector<uint8_t> same_iv;
+  AesCryptor::DeriveIv(FOURCC_cenc, "secret", 1000, &same_iv);
+  EXPECT_EQ(iv, same_iv);
+
+  std::vector<uint8_t> other_iv;
+  AesCryptor::DeriveIv(FOURCC_cenc, "secret", 1001, &other_iv);
+  EXPECT_NE(iv, other_iv);
+  AesCryptor::DeriveIv(FOURCC_cenc, "other secret", 1000, &other_iv);
+  EXPECT_NE(iv, other_iv);
+
+  AesCryptor::DeriveIv(FOURCC_cbcs, "secret", 1000, &iv);
+  EXPECT_EQ(kCbcsIvSize, iv.size());
+}
+
 TEST_F(AesCtrEncryptorTest, UnsupportedKeySize) {
   std::vector<uint8_t> key(kInvalidKey, kInvalidKey + arraysize(kInvalidKey));
   ASSERT_FALSE(encryptor_.InitializeWithIv(key, iv_));
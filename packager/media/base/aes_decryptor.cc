@@ -9,6 +9,7 @@
 #include <openssl/aes.h>
 #include <algorithm>
 #include "packager/base/logging.h"
+#include "packager/media/base/aes_key_schedule_cache.h"
 
 namespace {
 
@@ -44,8 +45,8 @@ bool AesCbcDecryptor::InitializeWithIv(const std::vector<uint8_t>& key,
     return false;
   }
 
-  CHECK_EQ(AES_set_decrypt_key(key.data(), key.size() * 8, mutable_aes_key()),
-           0);
+  set_aes_key(AesKeyScheduleCache::GetInstance()->GetKeySchedule(
+      key, AesKeyScheduleCache::kDecrypt));
   return SetIv(iv);
 }
 
@@ -7,8 +7,10 @@
 #include "packager/media/base/aes_encryptor.h"
 
 #include <openssl/aes.h>
+#include <string.h>
 
 #include "packager/base/logging.h"
+#include "packager/media/base/aes_key_schedule_cache.h"
 
 namespace {
 
@@ -22,6 +24,17 @@ bool Increment64(uint8_t* counter) {
   return true;
 }
 
+// Return the number of blocks that can be processed before the 8-byte
+// big-endian counter wraps around to zero. Return 0 if the counter is zero,
+// i.e. 2^64 blocks, which can never be reached in practice.
+uint64_t BlocksBeforeWrap64(const uint8_t* counter) {
+  DCHECK(counter);
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i)
+    value = (value << 8) | counter[i];
+  return ~value + 1;
+}
+
 // AES defines three key sizes: 128, 192 and 256 bits.
 bool IsKeySizeValidForAes(size_t key_size) {
   return key_size == 16 || key_size == 24 || key_size == 32;
@@ -43,8 +56,8 @@ bool AesEncryptor::InitializeWithIv(const std::vector<uint8_t>& key,
     return false;
   }
 
-  CHECK_EQ(AES_set_encrypt_key(key.data(), key.size() * 8, mutable_aes_key()),
-           0);
+  set_aes_key(AesKeyScheduleCache::GetInstance()->GetKeySchedule(
+      key, AesKeyScheduleCache::kEncrypt));
   return SetIv(iv);
 }
 
@@ -57,7 +70,6 @@ AesCtrEncryptor::AesCtrEncryptor()
 
 AesCtrEncryptor::~AesCtrEncryptor() {}
 
-
 bool AesCtrEncryptor::CryptInternal(const uint8_t* plaintext,
                                     size_t plaintext_size,
                                     uint8_t* ciphertext,
@@ -74,19 +86,52 @@ bool AesCtrEncryptor::CryptInternal(const uint8_t* plaintext,
   }
   *ciphertext_size = plaintext_size;
 
-  for (size_t i = 0; i < plaintext_size; ++i) {
-    if (block_offset_ == 0) {
-      AES_encrypt(&counter_[0], &encrypted_counter_[0], aes_key());
-      // As mentioned in ISO/IEC 23001-7:2016 CENC spec, of the 16 byte counter
-      // block, bytes 8 to 15 (i.e. the least significant bytes) are used as a
-      // simple 64 bit unsigned integer that is incremented by one for each
-      // subsequent block of sample data processed and is kept in network byte
-      // order.
-      Increment64(&counter_[8]);
-    }
-    ciphertext[i] = plaintext[i] ^ encrypted_counter_[block_offset_];
+  size_t offset = 0;
+
+  // Consume what is left of the current keystream block first.
+  while (block_offset_ != 0 && offset < plaintext_size) {
+    ciphertext[offset] = plaintext[offset] ^ encrypted_counter_[block_offset_];
+    ++offset;
     block_offset_ = (block_offset_ + 1) % AES_BLOCK_SIZE;
   }
+
+  // Encrypt the full blocks in bulk, which lets openssl generate the keystream
+  // for many blocks at once (pipelined with AES-NI when available).
+  while (plaintext_size - offset >= AES_BLOCK_SIZE) {
+    size_t num_blocks = (plaintext_size - offset) / AES_BLOCK_SIZE;
+    // As mentioned in ISO/IEC 23001-7:2016 CENC spec, of the 16 byte counter
+    // block, bytes 8 to 15 (i.e. the least significant bytes) are used as a
+    // simple 64 bit unsigned integer that is incremented by one for each
+    // subsequent block of sample data processed and is kept in network byte
+    // order. AES_ctr128_encrypt increments the full 128 bit counter, so the
+    // blocks are split at the point where the lower 64 bits wrap around and
+    // the carry into the upper 64 bits is dropped.
+    const uint64_t blocks_before_wrap = BlocksBeforeWrap64(&counter_[8]);
+    if (blocks_before_wrap != 0 && blocks_before_wrap < num_blocks)
+      num_blocks = static_cast<size_t>(blocks_before_wrap);
+
+    const size_t bulk_size = num_blocks * AES_BLOCK_SIZE;
+    uint8_t upper_counter[8];
+    memcpy(upper_counter, &counter_[0], sizeof(upper_counter));
+    unsigned int num = 0;
+    AES_ctr128_encrypt(plaintext + offset, ciphertext + offset, bulk_size,
+                       aes_key(), &counter_[0], &encrypted_counter_[0], &num);
+    DCHECK_EQ(num, 0u);
+    memcpy(&counter_[0], upper_counter, sizeof(upper_counter));
+    offset += bulk_size;
+  }
+
+  // Encrypt the residual partial block, if any.
+  if (offset < plaintext_size) {
+    AES_encrypt(&counter_[0], &encrypted_counter_[0], aes_key());
+    Increment64(&counter_[8]);
+    for (; offset < plaintext_size; ++offset) {
+      ciphertext[offset] =
+          plaintext[offset] ^ encrypted_counter_[block_offset_];
+      ++block_offset_;
+    }
+    DCHECK_LT(block_offset_, static_cast<uint32_t>(AES_BLOCK_SIZE));
+  }
   return true;
 }
 
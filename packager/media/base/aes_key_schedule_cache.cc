@@ -0,0 +1,72 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/aes_key_schedule_cache.h"
+
+#include <openssl/aes.h>
+#include <openssl/mem.h>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+AesKeyScheduleCache* AesKeyScheduleCache::GetInstance() {
+  // Intentionally leaked, so key schedules released during static destruction
+  // can still be returned to it.
+  static AesKeyScheduleCache* instance = new AesKeyScheduleCache;
+  return instance;
+}
+
+AesKeyScheduleCache::AesKeyScheduleCache() {}
+AesKeyScheduleCache::~AesKeyScheduleCache() {}
+
+std::shared_ptr<const AES_KEY> AesKeyScheduleCache::GetKeySchedule(
+    const std::vector<uint8_t>& key,
+    Direction direction) {
+  ScheduleId schedule_id(direction, key);
+
+  base::AutoLock auto_lock(lock_);
+  std::weak_ptr<const AES_KEY>& entry = key_schedules_[schedule_id];
+  std::shared_ptr<const AES_KEY> key_schedule = entry.lock();
+  if (key_schedule)
+    return key_schedule;
+
+  std::unique_ptr<AES_KEY> aes_key(new AES_KEY);
+  const unsigned int key_bits = static_cast<unsigned int>(key.size() * 8);
+  if (direction == kEncrypt) {
+    CHECK_EQ(AES_set_encrypt_key(key.data(), key_bits, aes_key.get()), 0);
+  } else {
+    CHECK_EQ(AES_set_decrypt_key(key.data(), key_bits, aes_key.get()), 0);
+  }
+  key_schedule.reset(aes_key.release(),
+                     [this, schedule_id](const AES_KEY* aes_key) {
+                       Release(schedule_id, const_cast<AES_KEY*>(aes_key));
+                     });
+  entry = key_schedule;
+  return key_schedule;
+}
+
+size_t AesKeyScheduleCache::NumKeySchedules() {
+  base::AutoLock auto_lock(lock_);
+  return key_schedules_.size();
+}
+
+void AesKeyScheduleCache::Release(const ScheduleId& schedule_id,
+                                  AES_KEY* aes_key) {
+  OPENSSL_cleanse(aes_key, sizeof(*aes_key));
+  delete aes_key;
+
+  base::AutoLock auto_lock(lock_);
+  auto iter = key_schedules_.find(schedule_id);
+  // The entry may have been replaced by a new key schedule for the same key
+  // after the last reference to this one was dropped.
+  if (iter != key_schedules_.end() && iter->second.expired())
+    key_schedules_.erase(iter);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,69 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_AES_KEY_SCHEDULE_CACHE_H_
+#define PACKAGER_MEDIA_BASE_AES_KEY_SCHEDULE_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+
+struct aes_key_st;
+typedef struct aes_key_st AES_KEY;
+
+namespace shaka {
+namespace media {
+
+/// Process wide cache of expanded AES key schedules, keyed by the key bytes.
+/// The key schedules are immutable once expanded, so the cryptors using the
+/// same key, e.g. the encryptors of the different outputs of a stream, share a
+/// single key schedule while keeping their own iv state. A key schedule is
+/// released and cleansed when the last cryptor using it is destroyed or
+/// re-initialized. This class is thread safe.
+class AesKeyScheduleCache {
+ public:
+  enum Direction {
+    kEncrypt,
+    kDecrypt,
+  };
+
+  /// @return the process wide instance.
+  static AesKeyScheduleCache* GetInstance();
+
+  /// Get the key schedule for @a key, expanding it if it is not in use.
+  /// @param key is the AES key. Its size must be 16, 24 or 32 bytes.
+  /// @param direction specifies whether the key schedule is for encryption or
+  ///        decryption.
+  /// @return the shared key schedule.
+  std::shared_ptr<const AES_KEY> GetKeySchedule(const std::vector<uint8_t>& key,
+                                                Direction direction);
+
+  /// @return the number of key schedules in use. Used by tests.
+  size_t NumKeySchedules();
+
+ private:
+  AesKeyScheduleCache();
+  ~AesKeyScheduleCache();
+  AesKeyScheduleCache(const AesKeyScheduleCache&) = delete;
+  AesKeyScheduleCache& operator=(const AesKeyScheduleCache&) = delete;
+
+  typedef std::pair<Direction, std::vector<uint8_t>> ScheduleId;
+
+  // Called when the last reference to a key schedule is released.
+  void Release(const ScheduleId& schedule_id, AES_KEY* aes_key);
+
+  base::Lock lock_;
+  // Protected by |lock_|.
+  std::map<ScheduleId, std::weak_ptr<const AES_KEY>> key_schedules_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_AES_KEY_SCHEDULE_CACHE_H_
@@ -0,0 +1,109 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/aes_key_schedule_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/aes_decryptor.h"
+#include "packager/media/base/aes_encryptor.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint8_t kKey[] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+const uint8_t kOtherKey[] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
+const uint8_t kIv[] = {
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+    0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+};
+
+}  // namespace
+
+class AesKeyScheduleCacheTest : public ::testing::Test {
+ public:
+  AesKeyScheduleCacheTest()
+      : cache_(AesKeyScheduleCache::GetInstance()),
+        key_(std::begin(kKey), std::end(kKey)),
+        other_key_(std::begin(kOtherKey), std::end(kOtherKey)),
+        iv_(std::begin(kIv), std::end(kIv)) {}
+
+  void SetUp() override {
+    initial_num_key_schedules_ = cache_->NumKeySchedules();
+  }
+
+  size_t NumNewKeySchedules() {
+    return cache_->NumKeySchedules() - initial_num_key_schedules_;
+  }
+
+ protected:
+  AesKeyScheduleCache* cache_;
+  std::vector<uint8_t> key_;
+  std::vector<uint8_t> other_key_;
+  std::vector<uint8_t> iv_;
+  size_t initial_num_key_schedules_ = 0;
+};
+
+TEST_F(AesKeyScheduleCacheTest, SharedWhileInUse) {
+  std::shared_ptr<const AES_KEY> key_schedule =
+      cache_->GetKeySchedule(key_, AesKeyScheduleCache::kEncrypt);
+  EXPECT_EQ(key_schedule,
+            cache_->GetKeySchedule(key_, AesKeyScheduleCache::kEncrypt));
+  EXPECT_NE(key_schedule,
+            cache_->GetKeySchedule(key_, AesKeyScheduleCache::kDecrypt));
+  EXPECT_NE(key_schedule,
+            cache_->GetKeySchedule(other_key_, AesKeyScheduleCache::kEncrypt));
+  // The temporary key schedules above are released already.
+  EXPECT_EQ(1u, NumNewKeySchedules());
+
+  key_schedule.reset();
+  EXPECT_EQ(0u, NumNewKeySchedules());
+}
+
+TEST_F(AesKeyScheduleCacheTest, CryptorsKeepTheirOwnState) {
+  const std::vector<uint8_t> plaintext(96, 0x5a);
+
+  AesCtrEncryptor encryptor;
+  ASSERT_TRUE(encryptor.InitializeWithIv(key_, iv_));
+  std::vector<uint8_t> expected_ciphertext;
+  ASSERT_TRUE(encryptor.Crypt(plaintext, &expected_ciphertext));
+
+  // A second encryptor sharing the key schedule starts from its own iv, while
+  // the first encryptor continues with its counter.
+  AesCtrEncryptor other_encryptor;
+  ASSERT_TRUE(other_encryptor.InitializeWithIv(key_, iv_));
+  EXPECT_EQ(1u, NumNewKeySchedules());
+  std::vector<uint8_t> ciphertext;
+  ASSERT_TRUE(other_encryptor.Crypt(plaintext, &ciphertext));
+  EXPECT_EQ(expected_ciphertext, ciphertext);
+  ASSERT_TRUE(encryptor.Crypt(plaintext, &ciphertext));
+  EXPECT_NE(expected_ciphertext, ciphertext);
+
+  AesCbcEncryptor cbc_encryptor(kNoPadding);
+  ASSERT_TRUE(cbc_encryptor.InitializeWithIv(key_, iv_));
+  AesCbcDecryptor cbc_decryptor(kNoPadding);
+  ASSERT_TRUE(cbc_decryptor.InitializeWithIv(key_, iv_));
+  EXPECT_EQ(2u, NumNewKeySchedules());
+  ASSERT_TRUE(cbc_encryptor.Crypt(plaintext, &ciphertext));
+  std::vector<uint8_t> decrypted;
+  ASSERT_TRUE(cbc_decryptor.Crypt(ciphertext, &decrypted));
+  EXPECT_EQ(plaintext, decrypted);
+
+  // Re-initializing with a different key releases the shared decryption key
+  // schedule.
+  ASSERT_TRUE(cbc_decryptor.InitializeWithIv(other_key_, iv_));
+  EXPECT_EQ(2u, NumNewKeySchedules());
+}
+
+}  // namespace media
+}  // namespace shaka
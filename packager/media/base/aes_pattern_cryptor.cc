@@ -7,7 +7,9 @@
 #include "packager/media/base/aes_pattern_cryptor.h"
 
 #include <openssl/aes.h>
-#include <algorithm>
+#include <string.h>
+#include <utility>
+
 #include "packager/base/logging.h"
 
 namespace shaka {
@@ -49,42 +51,68 @@ bool AesPatternCryptor::CryptInternal(const uint8_t* text,
   }
   *crypt_text_size = text_size;
 
-  while (text_size > 0) {
-    const size_t crypt_byte_size = crypt_byte_block_ * AES_BLOCK_SIZE;
-
-    if (text_size <= crypt_byte_size) {
-      const bool need_encrypt =
-          encryption_mode_ != kSkipIfCryptByteBlockRemaining &&
-          text_size >= AES_BLOCK_SIZE;
-      if (need_encrypt) {
-        // The partial pattern SHALL be followed with the partial 16-byte block
-        // remains unencrypted.
-        const size_t aligned_crypt_byte_size =
-            text_size / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
-        if (!cryptor_->Crypt(text, aligned_crypt_byte_size, crypt_text))
-          return false;
-        text += aligned_crypt_byte_size;
-        text_size -= aligned_crypt_byte_size;
-        crypt_text += aligned_crypt_byte_size;
-      }
+  // The clear bytes are passed through as is. The encrypted ranges are
+  // overwritten below.
+  if (crypt_text != text)
+    memmove(crypt_text, text, text_size);
 
-      // The remaining bytes are not encrypted.
-      memcpy(crypt_text, text, text_size);
-      return true;
+  // Collect the ranges to be encrypted, merging adjacent ranges, e.g. for
+  // patterns without skip blocks.
+  encrypted_ranges_.clear();
+  size_t encrypted_size = 0;
+  auto add_range = [this, &encrypted_size](size_t offset, size_t size) {
+    if (!encrypted_ranges_.empty() &&
+        encrypted_ranges_.back().first + encrypted_ranges_.back().second ==
+            offset) {
+      encrypted_ranges_.back().second += size;
+    } else {
+      encrypted_ranges_.push_back(std::make_pair(offset, size));
     }
+    encrypted_size += size;
+  };
 
-    if (!cryptor_->Crypt(text, crypt_byte_size, crypt_text))
-      return false;
-    text += crypt_byte_size;
-    text_size -= crypt_byte_size;
-    crypt_text += crypt_byte_size;
+  const size_t crypt_byte_size = crypt_byte_block_ * AES_BLOCK_SIZE;
+  const size_t pattern_size =
+      crypt_byte_size + skip_byte_block_ * AES_BLOCK_SIZE;
+  size_t offset = 0;
+  while (offset < text_size && text_size - offset > crypt_byte_size) {
+    add_range(offset, crypt_byte_size);
+    offset += pattern_size;
+  }
+  if (offset < text_size &&
+      encryption_mode_ != kSkipIfCryptByteBlockRemaining) {
+    // The partial pattern SHALL be followed with the partial 16-byte block
+    // remains unencrypted.
+    const size_t aligned_crypt_byte_size =
+        (text_size - offset) / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+    if (aligned_crypt_byte_size > 0)
+      add_range(offset, aligned_crypt_byte_size);
+  }
 
-    const size_t skip_byte_size = std::min(
-        static_cast<size_t>(skip_byte_block_ * AES_BLOCK_SIZE), text_size);
-    memcpy(crypt_text, text, skip_byte_size);
-    text += skip_byte_size;
-    text_size -= skip_byte_size;
-    crypt_text += skip_byte_size;
+  if (encrypted_ranges_.empty())
+    return true;
+  if (encrypted_ranges_.size() == 1) {
+    uint8_t* data = crypt_text + encrypted_ranges_[0].first;
+    return cryptor_->Crypt(data, encrypted_ranges_[0].second, data);
+  }
+
+  // The cipher block chain of |cryptor_| continues across the encrypted
+  // ranges, so the ranges can be gathered and encrypted in a single call,
+  // instead of one call per pattern.
+  encrypted_blocks_.resize(encrypted_size);
+  uint8_t* blocks = encrypted_blocks_.data();
+  for (const auto& range : encrypted_ranges_) {
+    memcpy(blocks, crypt_text + range.first, range.second);
+    blocks += range.second;
+  }
+  if (!cryptor_->Crypt(encrypted_blocks_.data(), encrypted_size,
+                       encrypted_blocks_.data())) {
+    return false;
+  }
+  blocks = encrypted_blocks_.data();
+  for (const auto& range : encrypted_ranges_) {
+    memcpy(crypt_text + range.first, blocks, range.second);
+    blocks += range.second;
   }
   return true;
 }
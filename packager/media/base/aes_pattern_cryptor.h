@@ -7,6 +7,8 @@
 #include "packager/media/base/aes_cryptor.h"
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "packager/base/macros.h"
 
@@ -72,6 +74,10 @@ class AesPatternCryptor : public AesCryptor {
   const uint8_t skip_byte_block_;
   const PatternEncryptionMode encryption_mode_;
   std::unique_ptr<AesCryptor> cryptor_;
+  // Scratch buffers reused across Crypt calls: the (offset, size) of the
+  // ranges to be encrypted and the gathered blocks of those ranges.
+  std::vector<std::pair<size_t, size_t>> encrypted_ranges_;
+  std::vector<uint8_t> encrypted_blocks_;
 
   DISALLOW_COPY_AND_ASSIGN(AesPatternCryptor);
 };
@@ -8,6 +8,7 @@
 #include <gtest/gtest.h>
 
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/aes_pattern_cryptor.h"
 #include "packager/media/base/mock_aes_cryptor.h"
 
@@ -208,5 +209,42 @@ TEST(SampleAesPatternCryptor, MoreThan16Bytes) {
   ASSERT_TRUE(pattern_cryptor.Crypt("0123456789abcdef012", &crypt_text));
 }
 
+TEST(AesPatternCryptorCbcTest, SameAsEncryptingPatternByPattern) {
+  const std::vector<uint8_t> kKey(16, 'k');
+  const std::vector<uint8_t> kIv(16, 'i');
+  const uint8_t kCbcsCryptByteBlock = 1;
+  const uint8_t kCbcsSkipByteBlock = 9;
+
+  AesPatternCryptor pattern_cryptor(
+      kCbcsCryptByteBlock, kCbcsSkipByteBlock,
+      AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+      AesCryptor::kUseConstantIv,
+      std::unique_ptr<AesCryptor>(new AesCbcEncryptor(kNoPadding)));
+  ASSERT_TRUE(pattern_cryptor.InitializeWithIv(kKey, kIv));
+
+  std::vector<uint8_t> text(1000);
+  for (size_t i = 0; i < text.size(); ++i)
+    text[i] = static_cast<uint8_t>(i);
+
+  // Encrypt the first block of every 10 blocks, one block at a time.
+  AesCbcEncryptor cbc_encryptor(kNoPadding);
+  ASSERT_TRUE(cbc_encryptor.InitializeWithIv(kKey, kIv));
+  std::vector<uint8_t> expected_crypt_text(text);
+  const size_t kBlockSize = 16;
+  for (size_t offset = 0; offset + kBlockSize <= text.size();
+       offset += kBlockSize * (kCbcsCryptByteBlock + kCbcsSkipByteBlock)) {
+    ASSERT_TRUE(cbc_encryptor.Crypt(&text[offset], kBlockSize,
+                                    &expected_crypt_text[offset]));
+  }
+
+  std::vector<uint8_t> crypt_text;
+  ASSERT_TRUE(pattern_cryptor.Crypt(text, &crypt_text));
+  EXPECT_EQ(expected_crypt_text, crypt_text);
+
+  // In place encryption.
+  ASSERT_TRUE(pattern_cryptor.Crypt(text.data(), text.size(), text.data()));
+  EXPECT_EQ(expected_crypt_text, text);
+}
+
 }  // namespace media
 }  // namespace shaka
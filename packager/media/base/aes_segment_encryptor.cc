@@ -0,0 +1,79 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/aes_segment_encryptor.h"
+
+#include <openssl/aes.h>
+#include <string.h>
+
+#include "packager/base/logging.h"
+#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/buffer_writer.h"
+
+namespace shaka {
+namespace media {
+
+AesSegmentEncryptor::AesSegmentEncryptor() {}
+AesSegmentEncryptor::~AesSegmentEncryptor() {}
+
+bool AesSegmentEncryptor::Initialize(const std::vector<uint8_t>& key) {
+  // The blocks are chained across the EncryptWritten() calls of a segment,
+  // and padded by FinalizeSegment() instead.
+  encryptor_.reset(new AesCbcEncryptor(kNoPadding, kDontUseConstantIv));
+  // The IV is set at the start of each segment.
+  return encryptor_->InitializeWithIv(key,
+                                      std::vector<uint8_t>(AES_BLOCK_SIZE, 0));
+}
+
+bool AesSegmentEncryptor::StartSegment(const std::vector<uint8_t>& iv) {
+  DCHECK(encryptor_);
+  if (iv.size() != AES_BLOCK_SIZE) {
+    LOG(ERROR) << "Invalid segment IV size: " << iv.size();
+    return false;
+  }
+  encrypted_size_ = 0;
+  return encryptor_->SetIv(iv);
+}
+
+void AesSegmentEncryptor::EncryptWritten(BufferWriter* buffer) {
+  DCHECK(encryptor_);
+  DCHECK_GE(buffer->Size(), encrypted_size_);
+  const size_t num_blocks = (buffer->Size() - encrypted_size_) / AES_BLOCK_SIZE;
+  if (num_blocks == 0)
+    return;
+  const size_t size = num_blocks * AES_BLOCK_SIZE;
+  uint8_t* data = buffer->MutableBuffer() + encrypted_size_;
+  // Complete blocks are encrypted in place, without a residual block.
+  const bool success = encryptor_->Crypt(data, size, data);
+  DCHECK(success);
+  encrypted_size_ += size;
+}
+
+void AesSegmentEncryptor::FinalizeSegment(BufferWriter* buffer) {
+  DCHECK_GE(buffer->Size(), encrypted_size_);
+  // PKCS#7 padding, which adds a whole block if the segment is a multiple of
+  // the block size.
+  const size_t num_padding_bytes =
+      AES_BLOCK_SIZE - (buffer->Size() - encrypted_size_) % AES_BLOCK_SIZE;
+  memset(buffer->Expand(num_padding_bytes), static_cast<int>(num_padding_bytes),
+         num_padding_bytes);
+  EncryptWritten(buffer);
+  DCHECK_EQ(buffer->Size(), encrypted_size_);
+}
+
+// static
+std::vector<uint8_t> AesSegmentEncryptor::GetSegmentIv(
+    uint64_t media_sequence_number) {
+  std::vector<uint8_t> iv(AES_BLOCK_SIZE, 0);
+  for (size_t i = AES_BLOCK_SIZE; i > 0 && media_sequence_number != 0; --i) {
+    iv[i - 1] = static_cast<uint8_t>(media_sequence_number);
+    media_sequence_number >>= 8;
+  }
+  return iv;
+}
+
+}  // namespace media
+}  // namespace shaka
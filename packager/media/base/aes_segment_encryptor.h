@@ -0,0 +1,69 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_AES_SEGMENT_ENCRYPTOR_H_
+#define PACKAGER_MEDIA_BASE_AES_SEGMENT_ENCRYPTOR_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "packager/base/macros.h"
+
+namespace shaka {
+namespace media {
+
+class AesCbcEncryptor;
+class BufferWriter;
+
+/// Encrypts whole segments with AES-128 CBC and PKCS#7 padding, i.e. the HLS
+/// AES-128 method, in place in the buffer they are written to. The complete
+/// blocks are encrypted as the segment is written, e.g. after each TS packet,
+/// and only the last block is padded when the segment is finalized, so the
+/// segment is never copied nor read again before it is written out.
+class AesSegmentEncryptor {
+ public:
+  AesSegmentEncryptor();
+  ~AesSegmentEncryptor();
+
+  /// Initialize the encryptor with the key of the segments.
+  /// @return true on success, false if the key is not a valid AES key.
+  bool Initialize(const std::vector<uint8_t>& key);
+
+  /// Start a segment, written from the start of an empty buffer.
+  /// @param iv is the 16 byte IV of the segment.
+  /// @return true on success, false if the IV is invalid.
+  bool StartSegment(const std::vector<uint8_t>& iv);
+
+  /// Encrypt, in place, the complete blocks written to @a buffer since the
+  /// last call. The bytes of the last, incomplete, block are encrypted by
+  /// the next call.
+  /// @param buffer holds the segment written so far. Its bytes already
+  ///        encrypted must not be modified.
+  void EncryptWritten(BufferWriter* buffer);
+
+  /// Pad the segment and encrypt the rest of it in place. @a buffer then
+  /// holds the encrypted segment, which is a multiple of 16 bytes.
+  void FinalizeSegment(BufferWriter* buffer);
+
+  /// @return The IV of the segment with @a media_sequence_number, which is
+  ///         used if the playlist does not specify one, i.e. the sequence
+  ///         number as a 16 byte big endian integer.
+  static std::vector<uint8_t> GetSegmentIv(uint64_t media_sequence_number);
+
+ private:
+  std::unique_ptr<AesCbcEncryptor> encryptor_;
+  // The number of bytes of the segment encrypted so far.
+  size_t encrypted_size_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(AesSegmentEncryptor);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_AES_SEGMENT_ENCRYPTOR_H_
@@ -0,0 +1,89 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/aes_segment_encryptor.h"
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+
+#include "packager/media/base/aes_decryptor.h"
+#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/buffer_writer.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint8_t kKey[] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+const size_t kTsPacketSize = 188;
+
+std::vector<uint8_t> GetPacket(uint8_t index) {
+  std::vector<uint8_t> packet(kTsPacketSize, index);
+  packet[0] = 0x47;
+  return packet;
+}
+
+}  // namespace
+
+class AesSegmentEncryptorTest : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(AesSegmentEncryptorTest, MatchesEncryptingTheWholeSegment) {
+  const size_t num_packets = GetParam();
+  const std::vector<uint8_t> key(std::begin(kKey), std::end(kKey));
+  const std::vector<uint8_t> iv = AesSegmentEncryptor::GetSegmentIv(7);
+
+  AesSegmentEncryptor segment_encryptor;
+  ASSERT_TRUE(segment_encryptor.Initialize(key));
+  ASSERT_TRUE(segment_encryptor.StartSegment(iv));
+  BufferWriter buffer;
+  std::vector<uint8_t> segment;
+  for (size_t i = 0; i < num_packets; ++i) {
+    const std::vector<uint8_t> packet = GetPacket(static_cast<uint8_t>(i));
+    buffer.AppendVector(packet);
+    segment.insert(segment.end(), packet.begin(), packet.end());
+    segment_encryptor.EncryptWritten(&buffer);
+  }
+  segment_encryptor.FinalizeSegment(&buffer);
+
+  AesCbcEncryptor encryptor(kPkcs5Padding);
+  ASSERT_TRUE(encryptor.InitializeWithIv(key, iv));
+  std::vector<uint8_t> expected;
+  ASSERT_TRUE(encryptor.Crypt(segment, &expected));
+  EXPECT_EQ(expected,
+            std::vector<uint8_t>(buffer.Buffer(),
+                                 buffer.Buffer() + buffer.Size()));
+
+  AesCbcDecryptor decryptor(kPkcs5Padding);
+  ASSERT_TRUE(decryptor.InitializeWithIv(key, iv));
+  std::vector<uint8_t> decrypted;
+  ASSERT_TRUE(decryptor.Crypt(expected, &decrypted));
+  EXPECT_EQ(segment, decrypted);
+}
+
+// 4 packets are a multiple of the block size, which gets a block of padding.
+INSTANTIATE_TEST_CASE_P(NumPackets,
+                        AesSegmentEncryptorTest,
+                        ::testing::Values(0, 1, 3, 4, 25));
+
+TEST(AesSegmentEncryptorIvTest, IsTheBigEndianSequenceNumber) {
+  const std::vector<uint8_t> iv =
+      AesSegmentEncryptor::GetSegmentIv(0x0102030405060708ull);
+  const std::vector<uint8_t> expected = {0, 0, 0, 0, 0, 0, 0, 0,
+                                         1, 2, 3, 4, 5, 6, 7, 8};
+  EXPECT_EQ(expected, iv);
+}
+
+TEST(AesSegmentEncryptorIvTest, RejectsShortIv) {
+  AesSegmentEncryptor segment_encryptor;
+  ASSERT_TRUE(segment_encryptor.Initialize(
+      std::vector<uint8_t>(std::begin(kKey), std::end(kKey))));
+  EXPECT_FALSE(segment_encryptor.StartSegment(std::vector<uint8_t>(8, 0)));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,116 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/async_handler.h"
+
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// The maximum number of messages the worker thread takes from the queue at
+// once, so that the queue lock is taken once per batch rather than once per
+// message when the downstream handlers fall behind.
+const size_t kMaxMessagesPerPop = 16;
+
+}  // namespace
+
+AsyncHandler::AsyncHandler(size_t queue_capacity)
+    : queue_(queue_capacity),
+      worker_thread_("async_handler",
+                     base::Bind(&AsyncHandler::ProcessQueue,
+                                base::Unretained(this))),
+      flush_done_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                  base::WaitableEvent::InitialState::NOT_SIGNALED) {
+  DCHECK_GT(queue_capacity, 0u);
+}
+
+AsyncHandler::~AsyncHandler() {
+  // Anything still queued at this point belongs to a cancelled or failed job.
+  StopWithError(Status(error::CANCELLED, "AsyncHandler destroyed."));
+  if (worker_thread_.HasBeenStarted() && !worker_thread_.HasBeenJoined())
+    worker_thread_.Join();
+}
+
+Status AsyncHandler::InitializeInternal() {
+  return Status::OK;
+}
+
+Status AsyncHandler::Process(std::unique_ptr<StreamData> stream_data) {
+  Message message;
+  message.stream_data = std::move(stream_data);
+  return Enqueue(message);
+}
+
+Status AsyncHandler::OnFlushRequest(size_t input_stream_index) {
+  Message message;
+  message.flush_stream_index = input_stream_index;
+  Status status = Enqueue(message);
+  if (!status.ok())
+    return status;
+  // Wait for the downstream handlers to catch up, so that the upstream handler
+  // is only done once the downstream handlers are done too.
+  flush_done_.Wait();
+  return GetDownstreamStatus();
+}
+
+Status AsyncHandler::Enqueue(const Message& message) {
+  if (!worker_thread_.HasBeenStarted())
+    worker_thread_.Start();
+  Status status = queue_.Push(message, kInfiniteTimeout);
+  if (status.error_code() == error::STOPPED)
+    return GetDownstreamStatus();
+  return status;
+}
+
+void AsyncHandler::ProcessQueue() {
+  std::vector<Message> messages;
+  while (queue_.PopMany(kMaxMessagesPerPop, &messages, kInfiniteTimeout).ok()) {
+    for (Message& message : messages) {
+      // Keep draining the queue after an error so that a pending flush request
+      // does not block forever, but do not pass anything downstream.
+      const bool stopped = !GetDownstreamStatus().ok();
+      if (message.stream_data) {
+        if (!stopped) {
+          // Output stream index is the same as input stream index.
+          Status status = Dispatch(std::unique_ptr<StreamData>(
+              new StreamData(std::move(*message.stream_data))));
+          if (!status.ok())
+            StopWithError(status);
+        }
+      } else {
+        if (!stopped) {
+          Status status = FlushDownstream(message.flush_stream_index);
+          if (!status.ok())
+            StopWithError(status);
+        }
+        flush_done_.Signal();
+      }
+      message = Message();
+    }
+  }
+}
+
+void AsyncHandler::StopWithError(const Status& status) {
+  {
+    base::AutoLock auto_lock(lock_);
+    if (downstream_status_.ok())
+      downstream_status_ = status;
+  }
+  queue_.Stop();
+}
+
+Status AsyncHandler::GetDownstreamStatus() {
+  base::AutoLock auto_lock(lock_);
+  return downstream_status_;
+}
+
+}  // namespace media
+}  // namespace shaka
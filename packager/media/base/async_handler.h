@@ -0,0 +1,82 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_ASYNC_HANDLER_H_
+#define PACKAGER_MEDIA_BASE_ASYNC_HANDLER_H_
+
+#include <memory>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/media_handler.h"
+#include "packager/media/base/producer_consumer_queue.h"
+
+namespace shaka {
+namespace media {
+
+/// AsyncHandler is an asynchronous edge in the handler graph. It forwards the
+/// stream data it receives to the downstream handlers unmodified, but the
+/// downstream part of the chain runs on a dedicated thread, decoupled from the
+/// upstream part through a bounded queue. This allows e.g. encryption and
+/// muxing of a stream to overlap with demuxing.
+///
+/// Flush requests are forwarded in order with the stream data. A flush request
+/// blocks until the downstream handlers have processed everything queued
+/// before it, so the upstream handler observes the same completion semantics
+/// as with a synchronous edge. An error returned by a downstream handler stops
+/// the edge and is returned to the upstream handler on its next call.
+///
+/// The number of output streams is the same as the number of input streams.
+class AsyncHandler : public MediaHandler {
+ public:
+  /// @param queue_capacity is the maximum number of stream data messages that
+  ///        can be buffered before the upstream handler blocks. Must be
+  ///        greater than zero.
+  explicit AsyncHandler(size_t queue_capacity);
+  ~AsyncHandler() override;
+
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status InitializeInternal() override;
+  Status Process(std::unique_ptr<StreamData> stream_data) override;
+  Status OnFlushRequest(size_t input_stream_index) override;
+  /// @}
+
+ private:
+  AsyncHandler(const AsyncHandler&) = delete;
+  AsyncHandler& operator=(const AsyncHandler&) = delete;
+
+  // Queue element. |stream_data| is null for flush requests.
+  struct Message {
+    size_t flush_stream_index = 0;
+    std::shared_ptr<StreamData> stream_data;
+  };
+
+  // Push |message| to the queue, starting the worker thread if needed.
+  Status Enqueue(const Message& message);
+  // The worker thread body, which runs the downstream handlers.
+  void ProcessQueue();
+  // Stop the edge with |status|. Messages still in the queue are dropped and
+  // the upstream handler is unblocked.
+  void StopWithError(const Status& status);
+  Status GetDownstreamStatus();
+
+  ProducerConsumerQueue<Message> queue_;
+  ClosureThread worker_thread_;
+  // Signaled by the worker thread after processing a flush request.
+  base::WaitableEvent flush_done_;
+
+  base::Lock lock_;
+  // The first error returned by the downstream handlers. Protected by |lock_|.
+  Status downstream_status_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_ASYNC_HANDLER_H_
@@ -0,0 +1,113 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/async_handler.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kStreamIndex = 0;
+const uint32_t kTimescale = 1000;
+const int64_t kDuration = 100;
+const bool kKeyFrame = true;
+const bool kEncrypted = true;
+const size_t kQueueCapacity = 2;
+const size_t kNumSamples = 10;
+
+// A downstream handler which fails on the sample with the given timestamp.
+class FailingMediaHandler : public MediaHandler {
+ public:
+  explicit FailingMediaHandler(int64_t failing_timestamp)
+      : failing_timestamp_(failing_timestamp) {}
+
+ private:
+  Status InitializeInternal() override { return Status::OK; }
+  Status Process(std::unique_ptr<StreamData> stream_data) override {
+    if (stream_data->media_sample &&
+        stream_data->media_sample->dts() == failing_timestamp_) {
+      return Status(error::MUXER_FAILURE, "Failed on purpose.");
+    }
+    return Status::OK;
+  }
+  Status OnFlushRequest(size_t input_stream_index) override {
+    return Status::OK;
+  }
+
+  const int64_t failing_timestamp_;
+};
+
+}  // namespace
+
+class AsyncHandlerTest : public MediaHandlerTestBase {
+ protected:
+  Status DispatchSample(int64_t timestamp, FakeInputMediaHandler* input) {
+    return input->Dispatch(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(timestamp, kDuration, kKeyFrame)));
+  }
+};
+
+TEST_F(AsyncHandlerTest, ForwardsInOrderAndBlocksOnFlush) {
+  ASSERT_OK(SetUpAndInitializeGraph(
+      std::make_shared<AsyncHandler>(kQueueCapacity), 1, 1));
+
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(0),
+                OnProcess(IsStreamInfo(kStreamIndex, kTimescale, !kEncrypted,
+                                       testing::_)));
+    for (size_t i = 0; i < kNumSamples; ++i) {
+      EXPECT_CALL(*Output(0),
+                  OnProcess(IsMediaSample(kStreamIndex, i * kDuration,
+                                          kDuration, !kEncrypted, kKeyFrame)));
+    }
+    EXPECT_CALL(*Output(0), OnFlush(kStreamIndex));
+  }
+
+  ASSERT_OK(Input(0)->Dispatch(
+      StreamData::FromStreamInfo(kStreamIndex, GetVideoStreamInfo(kTimescale))));
+  for (size_t i = 0; i < kNumSamples; ++i)
+    ASSERT_OK(DispatchSample(i * kDuration, Input(0)));
+  // All the downstream calls are expected to have completed when the flush
+  // returns.
+  ASSERT_OK(Input(0)->FlushAllDownstreams());
+  testing::Mock::VerifyAndClearExpectations(Output(0));
+}
+
+TEST_F(AsyncHandlerTest, DownstreamErrorIsReturnedUpstream) {
+  std::shared_ptr<FakeInputMediaHandler> input =
+      std::make_shared<FakeInputMediaHandler>();
+  std::shared_ptr<AsyncHandler> async_handler =
+      std::make_shared<AsyncHandler>(kQueueCapacity);
+  const int64_t kFailingTimestamp = 2 * kDuration;
+  ASSERT_OK(MediaHandler::Chain(
+      {input, async_handler,
+       std::make_shared<FailingMediaHandler>(kFailingTimestamp)}));
+  ASSERT_OK(input->Initialize());
+
+  // The error is reported asynchronously, but no later than the flush.
+  Status status;
+  for (size_t i = 0; i < kNumSamples && status.ok(); ++i)
+    status = DispatchSample(i * kDuration, input.get());
+  if (status.ok())
+    status = input->FlushAllDownstreams();
+  EXPECT_EQ(error::MUXER_FAILURE, status.error_code());
+
+  // All subsequent calls fail with the same error.
+  EXPECT_EQ(error::MUXER_FAILURE,
+            DispatchSample(kNumSamples * kDuration, input.get()).error_code());
+  EXPECT_EQ(error::MUXER_FAILURE,
+            input->FlushAllDownstreams().error_code());
+}
+
+}  // namespace media
+}  // namespace shaka
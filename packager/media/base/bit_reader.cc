@@ -4,7 +4,9 @@
 
 #include "packager/media/base/bit_reader.h"
 
-#include <algorithm>
+#include <string.h>
+
+#include "packager/base/sys_byteorder.h"
 
 namespace shaka {
 namespace media {
@@ -13,100 +15,110 @@ BitReader::BitReader(const uint8_t* data, size_t size)
     : data_(data),
       initial_size_(size),
       bytes_left_(size),
-      num_remaining_bits_in_curr_byte_(0) {
+      cache_(0),
+      bits_in_cache_(0) {
   DCHECK(data_ != NULL && bytes_left_ > 0);
-
-  UpdateCurrByte();
 }
 
 BitReader::~BitReader() {}
 
 bool BitReader::SkipBits(size_t num_bits) {
-  // Skip any bits in the current byte waiting to be processed, then
-  // process full bytes until less than 8 bits remaining.
-  if (num_bits > num_remaining_bits_in_curr_byte_) {
-    num_bits -= num_remaining_bits_in_curr_byte_;
-    num_remaining_bits_in_curr_byte_ = 0;
-
-    size_t num_bytes = num_bits / 8;
-    num_bits %= 8;
-    if (bytes_left_ < num_bytes) {
-      bytes_left_ = 0;
-      return false;
-    }
-    bytes_left_ -= num_bytes;
-    data_ += num_bytes;
-    UpdateCurrByte();
-
-    // If there is no more data remaining, only return true if we
-    // skipped all that were requested.
-    if (num_remaining_bits_in_curr_byte_ == 0)
-      return (num_bits == 0);
+  if (num_bits > bits_available()) {
+    ConsumeAll();
+    return false;
+  }
+  if (num_bits <= bits_in_cache_) {
+    ConsumeBits(num_bits);
+    return true;
   }
 
-  // Less than 8 bits remaining to skip. Use ReadBitsInternal to verify
-  // that the remaining bits we need exist, and adjust them as necessary
-  // for subsequent operations.
-  uint64_t not_needed;
-  return ReadBitsInternal(num_bits, &not_needed);
+  // Drop the cache, then skip full bytes without loading them.
+  num_bits -= bits_in_cache_;
+  cache_ = 0;
+  bits_in_cache_ = 0;
+  const size_t num_bytes = num_bits / 8;
+  data_ += num_bytes;
+  bytes_left_ -= num_bytes;
+  Refill();
+  ConsumeBits(num_bits % 8);
+  return true;
 }
 
 void BitReader::SkipToNextByte() {
-  // Already aligned.
-  if (num_remaining_bits_in_curr_byte_ == 8)
-    return;
-
-  num_remaining_bits_in_curr_byte_ = 0;
-  UpdateCurrByte();
+  ConsumeBits(bits_in_cache_ % 8);
 }
 
 bool BitReader::SkipBytes(size_t num_bytes) {
-  if (num_remaining_bits_in_curr_byte_ != 8)
+  if (bits_in_cache_ % 8 != 0 || bits_available() == 0)
     return false;
-  if (num_bytes == 0)
-    return true;
-
-  data_ += num_bytes - 1;  // One additional byte in curr_byte_.
-  if (num_bytes > bytes_left_ + 1)
+  if (num_bytes > bits_available() / 8)
     return false;
-  bytes_left_ -= num_bytes - 1;
-  num_remaining_bits_in_curr_byte_ = 0;
-  UpdateCurrByte();
-  return true;
+  return SkipBits(num_bytes * 8);
 }
 
 bool BitReader::ReadBitsInternal(size_t num_bits, uint64_t* out) {
   DCHECK_LE(num_bits, 64u);
 
   *out = 0;
+  if (num_bits > bits_available()) {
+    ConsumeAll();
+    return false;
+  }
+  if (num_bits == 0)
+    return true;
 
-  while (num_remaining_bits_in_curr_byte_ != 0 && num_bits != 0) {
-    size_t bits_to_take = std::min(num_remaining_bits_in_curr_byte_, num_bits);
-
-    *out <<= bits_to_take;
-    *out += curr_byte_ >> (num_remaining_bits_in_curr_byte_ - bits_to_take);
-    num_bits -= bits_to_take;
-    num_remaining_bits_in_curr_byte_ -= bits_to_take;
-    curr_byte_ &= (1 << num_remaining_bits_in_curr_byte_) - 1;
-
-    if (num_remaining_bits_in_curr_byte_ == 0)
-      UpdateCurrByte();
+  if (num_bits > bits_in_cache_)
+    Refill();
+  if (num_bits <= bits_in_cache_) {
+    *out = cache_ >> (64 - num_bits);
+    ConsumeBits(num_bits);
+    return true;
   }
 
-  return num_bits == 0;
+  // Reads of more than 56 bits may span more than the cache.
+  const size_t high_bits = bits_in_cache_;
+  const uint64_t high = cache_ >> (64 - high_bits);
+  ConsumeBits(high_bits);
+  Refill();
+  const size_t low_bits = num_bits - high_bits;
+  *out = (high << low_bits) | (cache_ >> (64 - low_bits));
+  ConsumeBits(low_bits);
+  return true;
 }
 
-void BitReader::UpdateCurrByte() {
-  DCHECK_EQ(num_remaining_bits_in_curr_byte_, 0u);
+void BitReader::Refill() {
+  while (bits_in_cache_ <= 56 && bytes_left_ > 0) {
+    if (bytes_left_ >= 8) {
+      // Load as many whole bytes as the cache can take with a single read.
+      uint64_t word;
+      memcpy(&word, data_, sizeof(word));
+      word = base::NetToHost64(word);
+      const size_t num_bytes = (64 - bits_in_cache_) / 8;
+      const size_t shift = 64 - 8 * num_bytes;
+      cache_ |= (word >> shift) << (shift - bits_in_cache_);
+      bits_in_cache_ += 8 * num_bytes;
+      data_ += num_bytes;
+      bytes_left_ -= num_bytes;
+      return;
+    }
+    cache_ |= static_cast<uint64_t>(*data_) << (56 - bits_in_cache_);
+    bits_in_cache_ += 8;
+    ++data_;
+    --bytes_left_;
+  }
+}
 
-  if (bytes_left_ == 0)
-    return;
+void BitReader::ConsumeBits(size_t num_bits) {
+  DCHECK_LE(num_bits, bits_in_cache_);
+  cache_ = num_bits < 64 ? cache_ << num_bits : 0;
+  bits_in_cache_ -= num_bits;
+}
 
-  // Load a new byte and advance pointers.
-  curr_byte_ = *data_;
-  ++data_;
-  --bytes_left_;
-  num_remaining_bits_in_curr_byte_ = 8;
+void BitReader::ConsumeAll() {
+  data_ += bytes_left_;
+  bytes_left_ = 0;
+  cache_ = 0;
+  bits_in_cache_ = 0;
 }
 
 }  // namespace media
@@ -13,7 +13,8 @@
 namespace shaka {
 namespace media {
 
-/// A class to read bit streams.
+/// A class to read bit streams. The bits are read from a 64-bit cache, which
+/// is refilled a word at a time.
 class BitReader {
  public:
   /// Initialize the BitReader object to read a data buffer.
@@ -86,9 +87,7 @@ class BitReader {
   bool SkipBytes(size_t num_bytes);
 
   /// @return The number of bits available for reading.
-  size_t bits_available() const {
-    return 8 * bytes_left_ + num_remaining_bits_in_curr_byte_;
-  }
+  size_t bits_available() const { return 8 * bytes_left_ + bits_in_cache_; }
 
   /// @return The current bit position.
   size_t bit_position() const { return 8 * initial_size_ - bits_available(); }
@@ -97,26 +96,33 @@ class BitReader {
   // Help function used by ReadBits to avoid inlining the bit reading logic.
   bool ReadBitsInternal(size_t num_bits, uint64_t* out);
 
-  // Advance to the next byte, loading it into curr_byte_.
-  // If the num_remaining_bits_in_curr_byte_ is 0 after this function returns,
-  // the stream has reached the end.
-  void UpdateCurrByte();
+  // Load bytes into |cache_| until it holds more than 56 bits, or the stream
+  // has reached the end.
+  void Refill();
+
+  // Drop |num_bits| from |cache_|, which has to hold them.
+  void ConsumeBits(size_t num_bits);
+
+  // Drop the rest of the stream, after a failed read or skip.
+  void ConsumeAll();
 
-  // Pointer to the next unread (not in curr_byte_) byte in the stream.
+  // Pointer to the next byte not loaded into |cache_|.
   const uint8_t* data_;
 
   // Initial size of the input data.
   size_t initial_size_;
 
-  // Bytes left in the stream (without the curr_byte_).
+  // Bytes left in the stream (without the bytes in |cache_|).
   size_t bytes_left_;
 
-  // Contents of the current byte; first unread bit starting at position
-  // 8 - num_remaining_bits_in_curr_byte_ from MSB.
-  uint8_t curr_byte_;
+  // The next bits of the stream starting from the MSB. The bits past the
+  // first |bits_in_cache_| are zero.
+  uint64_t cache_;
 
-  // Number of bits remaining in curr_byte_
-  size_t num_remaining_bits_in_curr_byte_;
+  // Number of bits in |cache_|. It always holds whole bytes of the stream
+  // minus the bits read, so bits_in_cache_ % 8 bits remain in the current
+  // byte.
+  size_t bits_in_cache_;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(BitReader);
@@ -113,5 +113,23 @@ TEST(BitReaderTest, SkipToNextByteTestUnaligned) {
   EXPECT_EQ(8u, reader.bit_position());
 }
 
+TEST(BitReaderTest, ReadBitsAcrossCacheRefills) {
+  uint8_t buffer[] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xab,
+                      0xcd, 0xef, 0xfe, 0xdc, 0xba};
+  BitReader reader(buffer, sizeof(buffer));
+  uint64_t value64 = 0;
+  uint8_t value8 = 0;
+
+  EXPECT_TRUE(reader.ReadBits(4, &value8));
+  EXPECT_EQ(0x0, value8);
+  EXPECT_TRUE(reader.ReadBits(64, &value64));
+  EXPECT_EQ(0x123456789abcdeffull, value64);
+  EXPECT_TRUE(reader.ReadBits(4, &value8));
+  EXPECT_EQ(0xe, value8);
+  EXPECT_EQ(16u, reader.bits_available());
+  EXPECT_FALSE(reader.ReadBits(17, &value64));
+  EXPECT_EQ(0u, reader.bits_available());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -6,24 +6,57 @@
 
 #include "packager/media/base/buffer_writer.h"
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/base/sys_byteorder.h"
+#include "packager/base/time/time.h"
 #include "packager/file/file.h"
+#include "packager/metrics/allocator_stats.h"
 
 namespace shaka {
 namespace media {
+namespace {
+
+// Time the thread has spent in BufferWriter::WriteToFile().
+thread_local int64_t g_thread_write_time_us = 0;
+
+// Adds the time it is in scope to |g_thread_write_time_us|.
+class ScopedWriteTimer {
+ public:
+  ScopedWriteTimer() : start_time_(base::TimeTicks::Now()) {}
+  ~ScopedWriteTimer() {
+    g_thread_write_time_us +=
+        (base::TimeTicks::Now() - start_time_).InMicroseconds();
+  }
+
+ private:
+  const base::TimeTicks start_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedWriteTimer);
+};
+
+}  // namespace
 
 BufferWriter::BufferWriter() {
   const size_t kDefaultReservedCapacity = 0x40000;  // 256KB.
   buf_.reserve(kDefaultReservedCapacity);
+  UpdateAccountedCapacity();
 }
 BufferWriter::BufferWriter(size_t reserved_size_in_bytes) {
   buf_.reserve(reserved_size_in_bytes);
+  UpdateAccountedCapacity();
+}
+BufferWriter::~BufferWriter() {
+  if (accounted_capacity_ > 0) {
+    AllocatorStats::GetInstance()->Release(AllocatorStats::kMuxingBuffers,
+                                           accounted_capacity_);
+  }
 }
-BufferWriter::~BufferWriter() {}
 
 void BufferWriter::AppendInt(uint8_t v) {
   buf_.push_back(v);
+  UpdateAccountedCapacity();
 }
 void BufferWriter::AppendInt(uint16_t v) {
   AppendInternal(base::HostToNet16(v));
@@ -53,23 +86,78 @@ void BufferWriter::AppendNBytes(uint64_t v, size_t num_bytes) {
 
 void BufferWriter::AppendVector(const std::vector<uint8_t>& v) {
   buf_.insert(buf_.end(), v.begin(), v.end());
+  UpdateAccountedCapacity();
 }
 
 void BufferWriter::AppendString(const std::string& s) {
   buf_.insert(buf_.end(), s.begin(), s.end());
+  UpdateAccountedCapacity();
 }
 
 void BufferWriter::AppendArray(const uint8_t* buf, size_t size) {
   buf_.insert(buf_.end(), buf, buf + size);
+  UpdateAccountedCapacity();
 }
 
 void BufferWriter::AppendBuffer(const BufferWriter& buffer) {
   buf_.insert(buf_.end(), buffer.buf_.begin(), buffer.buf_.end());
+  UpdateAccountedCapacity();
+}
+
+uint8_t* BufferWriter::Expand(size_t size) {
+  Reserve(size);
+  const size_t position = buf_.size();
+  buf_.resize(position + size);
+  return buf_.data() + position;
+}
+
+void BufferWriter::OverwriteNBytes(size_t position,
+                                   uint64_t v,
+                                   size_t num_bytes) {
+  DCHECK_GE(sizeof(v), num_bytes);
+  DCHECK_LE(position + num_bytes, buf_.size());
+  for (size_t i = num_bytes; i > 0; --i) {
+    buf_[position + i - 1] = static_cast<uint8_t>(v);
+    v >>= 8;
+  }
+}
+
+void BufferWriter::Reserve(size_t size_in_bytes) {
+  const size_t required_capacity = buf_.size() + size_in_bytes;
+  if (required_capacity > buf_.capacity())
+    buf_.reserve(std::max(required_capacity, 2 * buf_.capacity()));
+  UpdateAccountedCapacity();
+}
+
+void BufferWriter::Swap(BufferWriter* buffer) {
+  buf_.swap(buffer->buf_);
+  UpdateAccountedCapacity();
+  buffer->UpdateAccountedCapacity();
+}
+
+void BufferWriter::SwapBuffer(std::vector<uint8_t>* buffer) {
+  buf_.swap(*buffer);
+  UpdateAccountedCapacity();
 }
 
 Status BufferWriter::WriteToFile(File* file) {
   DCHECK(file);
   DCHECK(!buf_.empty());
+  ScopedWriteTimer write_timer;
+
+  if (file->CanTakeSharedBuffers()) {
+    // Hand the buffer off instead of having the file copy it.
+    const size_t size = buf_.size();
+    std::shared_ptr<std::vector<uint8_t>> buffer(new std::vector<uint8_t>);
+    buffer->swap(buf_);
+    UpdateAccountedCapacity();
+    if (file->WriteSharedBuffer(std::move(buffer)) !=
+        static_cast<int64_t>(size)) {
+      return Status(error::FILE_FAILURE,
+                    "Fail to write to file in BufferWriter");
+    }
+    return Status::OK;
+  }
 
   size_t remaining_size = buf_.size();
   const uint8_t* buf = &buf_[0];
@@ -86,6 +174,26 @@ Status BufferWriter::WriteToFile(File* file) {
   return Status::OK;
 }
 
+// static
+int64_t BufferWriter::GetThreadWriteTimeUs() {
+  return g_thread_write_time_us;
+}
+
+void BufferWriter::UpdateAccountedCapacity() {
+  const size_t capacity = buf_.capacity();
+  if (capacity == accounted_capacity_)
+    return;
+  AllocatorStats* allocator_stats = AllocatorStats::GetInstance();
+  if (capacity > accounted_capacity_) {
+    allocator_stats->Allocate(AllocatorStats::kMuxingBuffers,
+                              capacity - accounted_capacity_);
+  } else {
+    allocator_stats->Release(AllocatorStats::kMuxingBuffers,
+                             accounted_capacity_ - capacity);
+  }
+  accounted_capacity_ = capacity;
+}
+
 template <typename T>
 void BufferWriter::AppendInternal(T v) {
   AppendArray(reinterpret_cast<uint8_t*>(&v), sizeof(T));
@@ -52,13 +52,33 @@ class BufferWriter {
   void AppendArray(const uint8_t* buf, size_t size);
   void AppendBuffer(const BufferWriter& buffer);
 
-  void Swap(BufferWriter* buffer) { buf_.swap(buffer->buf_); }
-  void SwapBuffer(std::vector<uint8_t>* buffer) { buf_.swap(*buffer); }
+  /// Grow the buffer by @a size bytes, to be filled in directly through the
+  /// returned pointer instead of with a series of appends.
+  /// @return The first of the new bytes. It is invalidated by the next change
+  ///         to the buffer.
+  uint8_t* Expand(size_t size);
+
+  /// Overwrite @a num_bytes bytes at @a position with the least significant
+  /// @a num_bytes of @a v, in network byte order. Used to back-patch fields
+  /// that are only known after they have been written.
+  /// @param position must leave room for @a num_bytes bytes in the buffer.
+  /// @param num_bytes should not be larger than sizeof(@a v).
+  void OverwriteNBytes(size_t position, uint64_t v, size_t num_bytes);
+
+  void Swap(BufferWriter* buffer);
+  void SwapBuffer(std::vector<uint8_t>* buffer);
+
+  /// Make room for appending @a size_in_bytes bytes without reallocating the
+  /// buffer. The capacity still grows geometrically.
+  void Reserve(size_t size_in_bytes);
 
   void Clear() { buf_.clear(); }
   size_t Size() const { return buf_.size(); }
   /// @return Underlying buffer. Behavior is undefined if the buffer size is 0.
   const uint8_t* Buffer() const { return buf_.data(); }
+  /// @return Underlying buffer, to be modified in place. It is invalidated by
+  ///         the next change to the size of the buffer.
+  uint8_t* MutableBuffer() { return buf_.data(); }
 
   /// Write the buffer to file. The internal buffer will be cleared after
   /// writing.
@@ -66,12 +86,22 @@ class BufferWriter {
   /// @return OK on success.
   Status WriteToFile(File* file);
 
+  /// @return The time the calling thread has spent in WriteToFile(), in
+  ///         microseconds. Used to tell writing from muxing.
+  static int64_t GetThreadWriteTimeUs();
+
  private:
   // Internal implementation of multi-byte write.
   template <typename T>
   void AppendInternal(T v);
 
+  // Account the changes to the capacity of |buf_| to the muxing buffers
+  // arena.
+  void UpdateAccountedCapacity();
+
   std::vector<uint8_t> buf_;
+  // The capacity of |buf_| accounted to the muxing buffers arena.
+  size_t accounted_capacity_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(BufferWriter);
 };
@@ -93,6 +93,17 @@ TEST_F(BufferWriterTest, AppendNBytes) {
   ReadAndExpect(static_cast<uint32_t>(kuint64 & 0xFFFFFFFF));
 }
 
+TEST_F(BufferWriterTest, OverwriteNBytes) {
+  writer_->AppendInt(kuint32);
+  writer_->AppendInt(kuint16);
+  writer_->OverwriteNBytes(1, 0x123456, 3);
+  ASSERT_EQ(sizeof(uint32_t) + sizeof(uint16_t), writer_->Size());
+
+  CreateReader();
+  ReadAndExpect(static_cast<uint32_t>((kuint32 & 0xFF000000) | 0x123456));
+  ReadAndExpect(kuint16);
+}
+
 TEST_F(BufferWriterTest, AppendEmptyVector) {
   std::vector<uint8_t> v;
   writer_->AppendVector(v);
@@ -163,6 +174,23 @@ TEST_F(BufferWriterTest, Swap) {
   ASSERT_NO_FATAL_FAILURE(ReadAndExpect(kint64));
 }
 
+TEST_F(BufferWriterTest, Expand) {
+  writer_->AppendInt(kuint16);
+  uint8_t* bytes = writer_->Expand(sizeof(kuint8Array));
+  ASSERT_EQ(sizeof(kuint16) + sizeof(kuint8Array), writer_->Size());
+  for (size_t i = 0; i < sizeof(kuint8Array); ++i)
+    bytes[i] = kuint8Array[i];
+  writer_->AppendInt(kuint32);
+
+  CreateReader();
+  ASSERT_NO_FATAL_FAILURE(ReadAndExpect(kuint16));
+  std::vector<uint8_t> data_read;
+  ASSERT_TRUE(reader_->ReadToVector(&data_read, sizeof(kuint8Array)));
+  for (size_t i = 0; i < sizeof(kuint8Array); ++i)
+    EXPECT_EQ(kuint8Array[i], data_read[i]);
+  ASSERT_NO_FATAL_FAILURE(ReadAndExpect(kuint32));
+}
+
 TEST_F(BufferWriterTest, Clear) {
   writer_->AppendInt(kuint32);
   ASSERT_EQ(sizeof(kuint32), writer_->Size());
@@ -4,7 +4,16 @@
 
 #include "packager/media/base/byte_queue.h"
 
+#include <string.h>
+
+#if defined(OS_LINUX)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // defined(OS_LINUX)
+
 #include "packager/base/logging.h"
+#include "packager/metrics/huge_page_allocator.h"
 
 namespace shaka {
 namespace media {
@@ -12,9 +21,84 @@ namespace media {
 // Default starting size for the queue.
 enum { kDefaultQueueSize = 1024 };
 
+class ByteQueue::Buffer {
+ public:
+  // Returns a buffer of at least |min_size| bytes.
+  static std::unique_ptr<Buffer> Create(size_t min_size) {
+    std::unique_ptr<Buffer> buffer(new Buffer);
+    if (!buffer->CreateMirrored(min_size)) {
+      buffer->linear_data_ =
+          HugePageAllocator::GetInstance()->Allocate(min_size);
+      buffer->data_ = buffer->linear_data_.get();
+      buffer->size_ = min_size;
+    }
+    return buffer;
+  }
+
+  ~Buffer() {
+#if defined(OS_LINUX)
+    if (mirrored_)
+      munmap(data_, 2 * size_);
+#endif  // defined(OS_LINUX)
+  }
+
+  uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  // Whether the |size()| bytes following data() map to data() again, so that
+  // any |size()| bytes starting within the buffer are contiguous.
+  bool mirrored() const { return mirrored_; }
+
+ private:
+  Buffer() = default;
+  Buffer(const Buffer&) = delete;
+  Buffer& operator=(const Buffer&) = delete;
+
+  // Map a shared memory object of at least |min_size| bytes twice in a row.
+  bool CreateMirrored(size_t min_size) {
+#if defined(OS_LINUX) && defined(SYS_memfd_create)
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t size = (min_size + page_size - 1) / page_size * page_size;
+    const unsigned int kMemfdCloexec = 1;  // MFD_CLOEXEC.
+    const int fd = syscall(SYS_memfd_create, "byte_queue", kMemfdCloexec);
+    if (fd < 0)
+      return false;
+    bool success = false;
+    void* address = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+      // Reserve the address range, then map the object over both halves.
+      address = mmap(nullptr, 2 * size, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (address != MAP_FAILED) {
+      uint8_t* start = static_cast<uint8_t*>(address);
+      success = mmap(start, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+                mmap(start + size, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+      if (success) {
+        data_ = start;
+        size_ = size;
+        mirrored_ = true;
+      } else {
+        munmap(address, 2 * size);
+      }
+    }
+    close(fd);
+    return success;
+#else
+    return false;
+#endif  // defined(OS_LINUX) && defined(SYS_memfd_create)
+  }
+
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  bool mirrored_ = false;
+  HugePageAllocator::Buffer linear_data_;
+};
+
 ByteQueue::ByteQueue()
-    : buffer_(new uint8_t[kDefaultQueueSize]),
-      size_(kDefaultQueueSize),
+    : buffer_(Buffer::Create(kDefaultQueueSize)),
+      size_(buffer_->size()),
       offset_(0),
       used_(0) {
 }
@@ -31,30 +115,17 @@ void ByteQueue::Push(const uint8_t* data, int size) {
 
   size_t size_needed = used_ + size;
 
-  // Check to see if we need a bigger buffer.
-  if (size_needed > size_) {
-    size_t new_size = 2 * size_;
-    while (size_needed > new_size && new_size > size_)
-      new_size *= 2;
-
-    // Sanity check to make sure we didn't overflow.
-    CHECK_GT(new_size, size_);
-
-    std::unique_ptr<uint8_t[]> new_buffer(new uint8_t[new_size]);
-
-    // Copy the data from the old buffer to the start of the new one.
-    if (used_ > 0)
-      memcpy(new_buffer.get(), front(), used_);
-
-    buffer_.reset(new_buffer.release());
-    size_ = new_size;
-    offset_ = 0;
-  } else if ((offset_ + used_ + size) > size_) {
+  // Check to see if we need a bigger buffer, or a new one as the data
+  // previously popped from this one may still be referenced, see Share().
+  if (size_needed > size_ || buffer_.use_count() > 1) {
+    Reallocate(size_needed);
+  } else if (!buffer_->mirrored() && (offset_ + used_ + size) > size_) {
     // The buffer is big enough, but we need to move the data in the queue.
-    memmove(buffer_.get(), front(), used_);
+    memmove(buffer_->data(), front(), used_);
     offset_ = 0;
   }
 
+  // With a mirrored buffer, the data wraps around to the start of the buffer.
   memcpy(front() + used_, data, size);
   used_ += size;
 }
@@ -72,15 +143,49 @@ void ByteQueue::Pop(int count) {
   offset_ += count;
   used_ -= count;
 
-  // Move the offset back to 0 if we have reached the end of the buffer.
-  if (offset_ == size_) {
-    DCHECK_EQ(used_, 0);
+  if (used_ == 0) {
+    // Start over at the front, so the next data does not wrap around.
     offset_ = 0;
+  } else if (offset_ >= size_) {
+    DCHECK(buffer_->mirrored());
+    offset_ -= size_;
   }
 }
 
+std::shared_ptr<uint8_t> ByteQueue::Share(const uint8_t* data) const {
+  DCHECK(Contains(data, 0));
+  // The data is part of the storage, which is writable.
+  return std::shared_ptr<uint8_t>(buffer_, const_cast<uint8_t*>(data));
+}
+
+bool ByteQueue::Contains(const uint8_t* data, size_t size) const {
+  const uint8_t* queue_front = front();
+  return data >= queue_front &&
+         static_cast<size_t>(data - queue_front) + size <=
+             static_cast<size_t>(used_);
+}
+
 uint8_t* ByteQueue::front() const {
-  return buffer_.get() + offset_;
+  return buffer_->data() + offset_;
+}
+
+void ByteQueue::Reallocate(size_t size_needed) {
+  size_t new_size = size_;
+  while (size_needed > new_size) {
+    // Sanity check to make sure we didn't overflow.
+    CHECK_GT(2 * new_size, new_size);
+    new_size *= 2;
+  }
+
+  std::shared_ptr<Buffer> new_buffer = Buffer::Create(new_size);
+
+  // Copy the data from the old buffer to the start of the new one.
+  if (used_ > 0)
+    memcpy(new_buffer->data(), front(), used_);
+
+  buffer_ = std::move(new_buffer);
+  size_ = buffer_->size();
+  offset_ = 0;
 }
 
 }  // namespace media
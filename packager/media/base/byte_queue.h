@@ -19,6 +19,16 @@ namespace media {
 /// The contents of the queue can be observed via the Peek() method. This class
 /// manages the underlying storage of the queue and tries to minimize the
 /// number of buffer copies when data is appended and removed.
+///
+/// Where supported (Linux), the storage is a ring buffer mapped twice in a
+/// row in virtual memory, so that the queued data is always contiguous even
+/// when it wraps around. Queued data is then only ever copied when the buffer
+/// grows. Elsewhere, the data is moved to the front of a linear buffer when
+/// it runs out of room at the end.
+///
+/// Queued data can be referenced beyond its Pop() with Share(), e.g. by the
+/// media samples parsed from it, so they need not copy it. Push() then moves
+/// the queued data to a new buffer instead of overwriting the referenced one.
 class ByteQueue {
  public:
   ByteQueue();
@@ -38,11 +48,29 @@ class ByteQueue {
   /// @param count specifies number of bytes to be popped.
   void Pop(int count);
 
+  /// Get a reference to queued data, which keeps it valid and unchanged after
+  /// it is popped, until the reference is dropped.
+  /// @param data points to the queued data, as returned by Peek().
+  /// @return A pointer to @a data sharing the ownership of the storage of the
+  ///         queue. The data is writable once this is the only reference.
+  std::shared_ptr<uint8_t> Share(const uint8_t* data) const;
+
+  /// @return true if the @a size bytes at @a data are queued, so that they
+  ///         can be passed to Share().
+  bool Contains(const uint8_t* data, size_t size) const;
+
  private:
+  // A ring or linear buffer, defined in the .cc file.
+  class Buffer;
+
   // Returns a pointer to the front of the queue.
   uint8_t* front() const;
 
-  std::unique_ptr<uint8_t[]> buffer_;
+  // Replace |buffer_| with one which can hold at least |size_needed| bytes,
+  // copying the queued data to its front.
+  void Reallocate(size_t size_needed);
+
+  std::shared_ptr<Buffer> buffer_;
 
   // Size of |buffer_|.
   size_t size_;
@@ -0,0 +1,114 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/byte_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+std::vector<uint8_t> MakeData(int size, int start) {
+  std::vector<uint8_t> data(size);
+  for (int i = 0; i < size; ++i)
+    data[i] = static_cast<uint8_t>(start + i);
+  return data;
+}
+
+std::vector<uint8_t> PeekAll(const ByteQueue& queue) {
+  const uint8_t* data;
+  int size;
+  queue.Peek(&data, &size);
+  return std::vector<uint8_t>(data, data + size);
+}
+
+}  // namespace
+
+TEST(ByteQueueTest, Empty) {
+  ByteQueue queue;
+  EXPECT_TRUE(PeekAll(queue).empty());
+}
+
+TEST(ByteQueueTest, PushAndPop) {
+  ByteQueue queue;
+  const std::vector<uint8_t> data = MakeData(100, 0);
+  queue.Push(data.data(), data.size());
+  EXPECT_EQ(data, PeekAll(queue));
+  queue.Pop(40);
+  EXPECT_EQ(std::vector<uint8_t>(data.begin() + 40, data.end()),
+            PeekAll(queue));
+  queue.Pop(60);
+  EXPECT_TRUE(PeekAll(queue).empty());
+}
+
+// The queued data stays contiguous while it wraps around the end of the
+// buffer many times.
+TEST(ByteQueueTest, SteadyStateWrapAround) {
+  const int kChunkSize = 1000;
+  ByteQueue queue;
+  std::vector<uint8_t> expected;
+  for (int i = 0; i < 100; ++i) {
+    const std::vector<uint8_t> data = MakeData(kChunkSize, i);
+    queue.Push(data.data(), data.size());
+    expected.insert(expected.end(), data.begin(), data.end());
+    // Leave part of the data queued.
+    const int pop_size = i == 0 ? kChunkSize / 3 : kChunkSize;
+    queue.Pop(pop_size);
+    expected.erase(expected.begin(), expected.begin() + pop_size);
+    ASSERT_EQ(expected, PeekAll(queue)) << "Iteration " << i;
+  }
+}
+
+TEST(ByteQueueTest, Grow) {
+  ByteQueue queue;
+  const std::vector<uint8_t> data1 = MakeData(700, 0);
+  queue.Push(data1.data(), data1.size());
+  queue.Pop(500);
+  const std::vector<uint8_t> data2 = MakeData(100000, 7);
+  queue.Push(data2.data(), data2.size());
+
+  std::vector<uint8_t> expected(data1.begin() + 500, data1.end());
+  expected.insert(expected.end(), data2.begin(), data2.end());
+  EXPECT_EQ(expected, PeekAll(queue));
+}
+
+TEST(ByteQueueTest, Reset) {
+  ByteQueue queue;
+  const std::vector<uint8_t> data = MakeData(100, 0);
+  queue.Push(data.data(), data.size());
+  queue.Pop(10);
+  queue.Reset();
+  EXPECT_TRUE(PeekAll(queue).empty());
+  queue.Push(data.data(), data.size());
+  EXPECT_EQ(data, PeekAll(queue));
+}
+
+TEST(ByteQueueTest, Share) {
+  ByteQueue queue;
+  const std::vector<uint8_t> data1 = MakeData(600, 0);
+  queue.Push(data1.data(), data1.size());
+  const uint8_t* front;
+  int size;
+  queue.Peek(&front, &size);
+  EXPECT_TRUE(queue.Contains(front + 100, 500));
+  EXPECT_FALSE(queue.Contains(front + 100, 501));
+  std::shared_ptr<uint8_t> shared = queue.Share(front + 100);
+  queue.Pop(600);
+
+  // The shared data is not overwritten by the data pushed later.
+  const std::vector<uint8_t> data2 = MakeData(900, 50);
+  queue.Push(data2.data(), data2.size());
+  EXPECT_EQ(data2, PeekAll(queue));
+  EXPECT_EQ(std::vector<uint8_t>(data1.begin() + 100, data1.end()),
+            std::vector<uint8_t>(shared.get(), shared.get() + 500));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,390 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/caching_key_source.h"
+
+#include <openssl/sha.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+#include "packager/media/base/aes_decryptor.h"
+#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/key_cache.pb.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kCacheIvSize = 16;
+const char kCacheFileExtension[] = ".keys";
+
+std::string GetCacheFileName(const std::string& cache_directory,
+                             const std::string& cache_id) {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(cache_id.data()), cache_id.size(),
+         digest);
+  std::string file_name = cache_directory;
+  if (!file_name.empty() && file_name.back() != '/')
+    file_name += '/';
+  return file_name + base::HexEncode(digest, sizeof(digest)) +
+         kCacheFileExtension;
+}
+
+// The cache file is the random iv followed by the AES-CBC encrypted cache.
+bool EncryptCache(const std::vector<uint8_t>& wrapping_key,
+                  const std::string& serialized_cache,
+                  std::string* file_contents) {
+  std::vector<uint8_t> iv;
+  if (!AesCryptor::GenerateRandomIv(FOURCC_cbc1, &iv))
+    return false;
+  DCHECK_EQ(kCacheIvSize, iv.size());
+  AesCbcEncryptor encryptor(kPkcs5Padding, AesCryptor::kUseConstantIv);
+  std::string encrypted_cache;
+  if (!encryptor.InitializeWithIv(wrapping_key, iv) ||
+      !encryptor.Crypt(serialized_cache, &encrypted_cache)) {
+    return false;
+  }
+  file_contents->assign(iv.begin(), iv.end());
+  file_contents->append(encrypted_cache);
+  return true;
+}
+
+bool DecryptCache(const std::vector<uint8_t>& wrapping_key,
+                  const std::string& file_contents,
+                  std::string* serialized_cache) {
+  if (file_contents.size() <= kCacheIvSize)
+    return false;
+  const std::vector<uint8_t> iv(file_contents.begin(),
+                                file_contents.begin() + kCacheIvSize);
+  AesCbcDecryptor decryptor(kPkcs5Padding, AesCryptor::kUseConstantIv);
+  return decryptor.InitializeWithIv(wrapping_key, iv) &&
+         decryptor.Crypt(file_contents.substr(kCacheIvSize), serialized_cache);
+}
+
+void ToKeyCacheEntry(const EncryptionKey& key, KeyCacheEntry* entry) {
+  entry->set_key_id(key.key_id.data(), key.key_id.size());
+  for (const std::vector<uint8_t>& key_id : key.key_ids)
+    entry->add_key_ids(key_id.data(), key_id.size());
+  entry->set_key(key.key.data(), key.key.size());
+  entry->set_iv(key.iv.data(), key.iv.size());
+  for (const ProtectionSystemSpecificInfo& info : key.key_system_info) {
+    KeyCacheEntry::ProtectionSystemInfo* entry_info =
+        entry->add_key_system_info();
+    entry_info->set_system_id(info.system_id.data(), info.system_id.size());
+    entry_info->set_psshs(info.psshs.data(), info.psshs.size());
+  }
+}
+
+void FromKeyCacheEntry(const KeyCacheEntry& entry, EncryptionKey* key) {
+  key->key_id.assign(entry.key_id().begin(), entry.key_id().end());
+  for (const std::string& key_id : entry.key_ids())
+    key->key_ids.emplace_back(key_id.begin(), key_id.end());
+  key->key.assign(entry.key().begin(), entry.key().end());
+  key->iv.assign(entry.iv().begin(), entry.iv().end());
+  for (const KeyCacheEntry::ProtectionSystemInfo& entry_info :
+       entry.key_system_info()) {
+    ProtectionSystemSpecificInfo info;
+    info.system_id.assign(entry_info.system_id().begin(),
+                          entry_info.system_id().end());
+    info.psshs.assign(entry_info.psshs().begin(), entry_info.psshs().end());
+    key->key_system_info.push_back(info);
+  }
+}
+
+}  // namespace
+
+CachingKeySource::CachingKeySource(const KeyCacheParams& key_cache,
+                                   const std::string& cache_id,
+                                   const KeySourceFactory& key_source_factory,
+                                   base::Clock* clock)
+    : key_cache_(key_cache),
+      cache_id_(cache_id),
+      cache_file_name_(GetCacheFileName(key_cache.cache_directory, cache_id)),
+      key_source_factory_(key_source_factory),
+      clock_(clock) {}
+
+CachingKeySource::~CachingKeySource() {
+  bool has_new_keys = false;
+  {
+    base::AutoLock scoped_lock(lock_);
+    has_new_keys = has_new_keys_;
+  }
+  if (has_new_keys) {
+    Status status = Save();
+    LOG_IF(WARNING, !status.ok())
+        << "Failed to save the key cache: " << status.ToString();
+  }
+}
+
+std::unique_ptr<CachingKeySource> CachingKeySource::Create(
+    const KeyCacheParams& key_cache,
+    const std::string& cache_id,
+    const KeySourceFactory& key_source_factory,
+    base::Clock* clock) {
+  if (key_cache.cache_directory.empty()) {
+    LOG(ERROR) << "The key cache directory should not be empty.";
+    return nullptr;
+  }
+  const size_t wrapping_key_size = key_cache.wrapping_key.size();
+  if (wrapping_key_size != 16 && wrapping_key_size != 24 &&
+      wrapping_key_size != 32) {
+    LOG(ERROR) << "Invalid key cache wrapping key size " << wrapping_key_size
+               << ". It should be 16, 24 or 32 bytes.";
+    return nullptr;
+  }
+  std::unique_ptr<CachingKeySource> caching_key_source(
+      new CachingKeySource(key_cache, cache_id, key_source_factory, clock));
+  caching_key_source->Load();
+  return caching_key_source;
+}
+
+Status CachingKeySource::FetchKeys(EmeInitDataType init_data_type,
+                                   const std::vector<uint8_t>& init_data) {
+  KeySource* key_source = nullptr;
+  {
+    base::AutoLock scoped_lock(lock_);
+    key_source = GetKeySource();
+  }
+  if (!key_source)
+    return Status(error::INTERNAL_ERROR, "Failed to create the key source.");
+  return key_source->FetchKeys(init_data_type, init_data);
+}
+
+Status CachingKeySource::GetKey(const std::string& stream_label,
+                                EncryptionKey* key) {
+  DCHECK(key);
+  if (GetCachedKey(stream_label, key))
+    return Status::OK;
+  // Another packager sharing the cache may have fetched the key since.
+  if (key_cache_.shared) {
+    Load();
+    if (GetCachedKey(stream_label, key))
+      return Status::OK;
+  }
+  KeySource* key_source = nullptr;
+  {
+    base::AutoLock scoped_lock(lock_);
+    key_source = GetKeySource();
+  }
+  if (!key_source)
+    return Status(error::INTERNAL_ERROR, "Failed to create the key source.");
+  RETURN_IF_ERROR(key_source->GetKey(stream_label, key));
+
+  {
+    base::AutoLock scoped_lock(lock_);
+    CachedKey& cached_key = keys_[stream_label];
+    cached_key.key = *key;
+    cached_key.expiration_time = Now() + key_cache_.ttl_in_seconds;
+    has_new_keys_ = true;
+  }
+  SaveIfShared();
+  return Status::OK;
+}
+
+Status CachingKeySource::GetKey(const std::vector<uint8_t>& key_id,
+                                EncryptionKey* key) {
+  DCHECK(key);
+  KeySource* key_source = nullptr;
+  {
+    base::AutoLock scoped_lock(lock_);
+    const int64_t now = Now();
+    for (const auto& pair : keys_) {
+      if (pair.second.key.key_id == key_id &&
+          pair.second.expiration_time > now) {
+        *key = pair.second.key;
+        return Status::OK;
+      }
+    }
+    key_source = GetKeySource();
+  }
+  if (!key_source)
+    return Status(error::INTERNAL_ERROR, "Failed to create the key source.");
+  // The stream label of the key is unknown, so the key is not cached.
+  return key_source->GetKey(key_id, key);
+}
+
+Status CachingKeySource::GetCryptoPeriodKey(
+    uint32_t crypto_period_index,
+    uint32_t crypto_period_duration_in_seconds,
+    const std::string& stream_label,
+    EncryptionKey* key) {
+  DCHECK(key);
+  const CryptoPeriodKeyIndex index(crypto_period_index, stream_label);
+  if (GetCachedCryptoPeriodKey(index, crypto_period_duration_in_seconds, key))
+    return Status::OK;
+  // Another packager sharing the cache, e.g. the one packaging the channel
+  // before a failover, may have fetched the key since.
+  if (key_cache_.shared) {
+    Load();
+    if (GetCachedCryptoPeriodKey(index, crypto_period_duration_in_seconds,
+                                 key)) {
+      return Status::OK;
+    }
+  }
+  KeySource* key_source = nullptr;
+  {
+    base::AutoLock scoped_lock(lock_);
+    key_source = GetKeySource();
+  }
+  if (!key_source)
+    return Status(error::INTERNAL_ERROR, "Failed to create the key source.");
+  RETURN_IF_ERROR(key_source->GetCryptoPeriodKey(
+      crypto_period_index, crypto_period_duration_in_seconds, stream_label,
+      key));
+
+  {
+    base::AutoLock scoped_lock(lock_);
+    CachedKey& cached_key = crypto_period_keys_[index];
+    cached_key.key = *key;
+    cached_key.crypto_period_duration_in_seconds =
+        crypto_period_duration_in_seconds;
+    cached_key.expiration_time = Now() + key_cache_.ttl_in_seconds;
+    has_new_keys_ = true;
+  }
+  SaveIfShared();
+  return Status::OK;
+}
+
+Status CachingKeySource::Save() {
+  // The keys cached by the other packagers since the cache was loaded are
+  // kept, as the cache file is replaced as a whole.
+  if (key_cache_.shared)
+    Load();
+
+  base::AutoLock scoped_lock(lock_);
+  KeyCache cache;
+  cache.set_cache_id(cache_id_);
+  const int64_t now = Now();
+  for (const auto& pair : keys_) {
+    if (pair.second.expiration_time <= now)
+      continue;
+    KeyCacheEntry* entry = cache.add_entries();
+    entry->set_stream_label(pair.first);
+    entry->set_expiration_time(pair.second.expiration_time);
+    ToKeyCacheEntry(pair.second.key, entry);
+  }
+  for (const auto& pair : crypto_period_keys_) {
+    if (pair.second.expiration_time <= now)
+      continue;
+    KeyCacheEntry* entry = cache.add_entries();
+    entry->set_stream_label(pair.first.second);
+    entry->set_crypto_period_index(pair.first.first);
+    entry->set_crypto_period_duration_in_seconds(
+        pair.second.crypto_period_duration_in_seconds);
+    entry->set_expiration_time(pair.second.expiration_time);
+    ToKeyCacheEntry(pair.second.key, entry);
+  }
+
+  std::string file_contents;
+  if (!EncryptCache(key_cache_.wrapping_key, cache.SerializeAsString(),
+                    &file_contents)) {
+    return Status(error::ENCRYPTION_FAILURE,
+                  "Failed to encrypt the key cache.");
+  }
+  if (!File::WriteFileAtomically(cache_file_name_.c_str(), file_contents)) {
+    return Status(error::FILE_FAILURE,
+                  "Failed to write the key cache to " + cache_file_name_);
+  }
+  has_new_keys_ = false;
+  return Status::OK;
+}
+
+void CachingKeySource::Load() {
+  std::string file_contents;
+  if (!File::ReadFileToString(cache_file_name_.c_str(), &file_contents)) {
+    VLOG(1) << "No key cache found at " << cache_file_name_;
+    return;
+  }
+  std::string serialized_cache;
+  KeyCache cache;
+  if (!DecryptCache(key_cache_.wrapping_key, file_contents,
+                    &serialized_cache) ||
+      !cache.ParseFromString(serialized_cache) ||
+      cache.cache_id() != cache_id_) {
+    LOG(WARNING) << "Ignoring invalid key cache " << cache_file_name_
+                 << ". It may have been written with a different wrapping key.";
+    return;
+  }
+
+  // The keys already cached are only replaced by keys which expire later, as
+  // the cache may be loaded again when it is shared.
+  base::AutoLock scoped_lock(lock_);
+  const int64_t now = Now();
+  for (const KeyCacheEntry& entry : cache.entries()) {
+    if (entry.expiration_time() <= now)
+      continue;
+    CachedKey* cached_key = nullptr;
+    if (entry.has_crypto_period_index()) {
+      cached_key = &crypto_period_keys_[CryptoPeriodKeyIndex(
+          entry.crypto_period_index(), entry.stream_label())];
+    } else {
+      cached_key = &keys_[entry.stream_label()];
+    }
+    if (cached_key->expiration_time >= entry.expiration_time())
+      continue;
+    cached_key->key = EncryptionKey();
+    FromKeyCacheEntry(entry, &cached_key->key);
+    cached_key->crypto_period_duration_in_seconds =
+        entry.crypto_period_duration_in_seconds();
+    cached_key->expiration_time = entry.expiration_time();
+  }
+  VLOG(1) << "Loaded " << keys_.size() + crypto_period_keys_.size()
+          << " keys from the key cache " << cache_file_name_;
+}
+
+bool CachingKeySource::GetCachedKey(const std::string& stream_label,
+                                    EncryptionKey* key) {
+  base::AutoLock scoped_lock(lock_);
+  auto iter = keys_.find(stream_label);
+  if (iter == keys_.end() || iter->second.expiration_time <= Now())
+    return false;
+  *key = iter->second.key;
+  return true;
+}
+
+bool CachingKeySource::GetCachedCryptoPeriodKey(
+    const CryptoPeriodKeyIndex& index,
+    uint32_t crypto_period_duration_in_seconds,
+    EncryptionKey* key) {
+  base::AutoLock scoped_lock(lock_);
+  auto iter = crypto_period_keys_.find(index);
+  if (iter == crypto_period_keys_.end() ||
+      iter->second.crypto_period_duration_in_seconds !=
+          crypto_period_duration_in_seconds ||
+      iter->second.expiration_time <= Now()) {
+    return false;
+  }
+  *key = iter->second.key;
+  return true;
+}
+
+void CachingKeySource::SaveIfShared() {
+  if (!key_cache_.shared)
+    return;
+  Status status = Save();
+  LOG_IF(WARNING, !status.ok())
+      << "Failed to save the shared key cache: " << status.ToString();
+}
+
+KeySource* CachingKeySource::GetKeySource() {
+  lock_.AssertAcquired();
+  if (!key_source_ && !key_source_creation_failed_) {
+    VLOG(1) << "Key cache miss. Creating the key source.";
+    key_source_ = key_source_factory_();
+    key_source_creation_failed_ = !key_source_;
+  }
+  return key_source_.get();
+}
+
+int64_t CachingKeySource::Now() const {
+  return (clock_ ? clock_->Now() : base::Time::Now()).ToTimeT();
+}
+
+}  // namespace media
+}  // namespace shaka
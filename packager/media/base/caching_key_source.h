@@ -0,0 +1,130 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_CACHING_KEY_SOURCE_H_
+#define PACKAGER_MEDIA_BASE_CACHING_KEY_SOURCE_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/clock.h"
+#include "packager/media/base/key_source.h"
+#include "packager/media/public/crypto_params.h"
+
+namespace shaka {
+namespace media {
+
+/// A key source which caches the keys of another key source on disk, so
+/// repeated packaging runs of the same content skip the license requests.
+/// Keys are cached by stream label and, for key rotation, by crypto period.
+/// The cache is encrypted at rest with a wrapping key and its entries expire
+/// after a configurable time to live.
+///
+/// The wrapped key source is only created on the first cache miss, since
+/// creating it usually means a request to the license server.
+///
+/// The cache may be shared by a fleet of packagers, e.g. in a s3:// or gs://
+/// bucket, see KeyCacheParams.shared. The cache is then loaded again on a
+/// miss, before the wrapped key source is used, and saved, merged with the
+/// keys cached by the other packagers, as soon as a key is fetched, so a live
+/// channel failing over to another packager finds the keys of the current
+/// crypto periods.
+class CachingKeySource : public KeySource {
+ public:
+  /// Creates the wrapped key source, with its keys fetched. Returns null on
+  /// failure.
+  typedef std::function<std::unique_ptr<KeySource>()> KeySourceFactory;
+
+  ~CachingKeySource() override;
+
+  /// @name KeySource implementation overrides.
+  /// @{
+  Status FetchKeys(EmeInitDataType init_data_type,
+                   const std::vector<uint8_t>& init_data) override;
+  Status GetKey(const std::string& stream_label, EncryptionKey* key) override;
+  Status GetKey(const std::vector<uint8_t>& key_id,
+                EncryptionKey* key) override;
+  Status GetCryptoPeriodKey(uint32_t crypto_period_index,
+                            uint32_t crypto_period_duration_in_seconds,
+                            const std::string& stream_label,
+                            EncryptionKey* key) override;
+  /// @}
+
+  /// Creates a new CachingKeySource and loads the cached keys, if any. Returns
+  /// null if the parameters are malformed.
+  /// @param key_cache contains the cache parameters.
+  /// @param cache_id identifies the content and the key provider, e.g. the key
+  ///        server URL and the content ID. Keys are only shared between
+  ///        CachingKeySource objects with the same @a cache_id.
+  /// @param key_source_factory creates the wrapped key source.
+  /// @param clock is used to expire the cached keys. Uses the system clock if
+  ///        it is NULL. Owner retains ownership.
+  static std::unique_ptr<CachingKeySource> Create(
+      const KeyCacheParams& key_cache,
+      const std::string& cache_id,
+      const KeySourceFactory& key_source_factory,
+      base::Clock* clock);
+
+  /// Writes the cached keys to the cache file. This is done automatically on
+  /// destruction if there are new keys, and when a key is fetched if the
+  /// cache is shared.
+  /// @return OK on success, an error status otherwise.
+  Status Save();
+
+ private:
+  CachingKeySource(const KeyCacheParams& key_cache,
+                   const std::string& cache_id,
+                   const KeySourceFactory& key_source_factory,
+                   base::Clock* clock);
+  CachingKeySource(const CachingKeySource&) = delete;
+  CachingKeySource& operator=(const CachingKeySource&) = delete;
+
+  struct CachedKey {
+    EncryptionKey key;
+    uint32_t crypto_period_duration_in_seconds = 0;
+    int64_t expiration_time = 0;
+  };
+  // Crypto period index and stream label.
+  typedef std::pair<uint32_t, std::string> CryptoPeriodKeyIndex;
+
+  // Load the cached keys. A missing, stale or undecryptable cache is not an
+  // error; the keys are fetched again in that case.
+  void Load();
+  // Return true and set |key| if there is an unexpired cached key.
+  bool GetCachedKey(const std::string& stream_label, EncryptionKey* key);
+  bool GetCachedCryptoPeriodKey(const CryptoPeriodKeyIndex& index,
+                                uint32_t crypto_period_duration_in_seconds,
+                                EncryptionKey* key);
+  // Save the cache right away if it is shared.
+  void SaveIfShared();
+  // Return the wrapped key source, creating it if needed, or null on failure.
+  KeySource* GetKeySource();
+  int64_t Now() const;
+
+  const KeyCacheParams key_cache_;
+  const std::string cache_id_;
+  const std::string cache_file_name_;
+  const KeySourceFactory key_source_factory_;
+  base::Clock* const clock_;
+
+  base::Lock lock_;
+  // The following are protected by |lock_|.
+  std::unique_ptr<KeySource> key_source_;
+  bool key_source_creation_failed_ = false;
+  std::map<std::string, CachedKey> keys_;
+  std::map<CryptoPeriodKeyIndex, CachedKey> crypto_period_keys_;
+  bool has_new_keys_ = false;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_CACHING_KEY_SOURCE_H_
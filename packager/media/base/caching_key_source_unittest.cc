@@ -0,0 +1,192 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/file/memory_file.h"
+#include "packager/media/base/caching_key_source.h"
+#include "packager/media/base/raw_key_source.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kKeyIdHex[] = "0101020305080d1522375990e9000000";
+const char kKeyHex[] = "00100100200300500801302103405500";
+const char kIvHex[] = "000102030405060708090a0b0c0d0e0f";
+const char kWrappingKeyHex[] = "2b7e151628aed2a6abf7158809cf4f3c";
+const char kAnotherWrappingKeyHex[] = "3c4fcf098815f7aba6d2ae2816157e2b";
+const char kCacheDirectory[] = "memory://key_cache";
+const char kCacheId[] = "https://license.example.com|ContentFoo";
+const char kStreamLabel[] = "SD";
+const uint32_t kTtlInSeconds = 3600;
+const uint32_t kCryptoPeriodSeconds = 10;
+
+std::vector<uint8_t> HexStringToVector(const std::string& str) {
+  std::vector<uint8_t> vec;
+  CHECK(base::HexStringToBytes(str, &vec));
+  return vec;
+}
+
+class TestClock : public base::Clock {
+ public:
+  explicit TestClock(const base::Time& t) : time_(t) {}
+  ~TestClock() override {}
+
+  base::Time Now() override { return time_; }
+  void Advance(base::TimeDelta delta) { time_ += delta; }
+
+ private:
+  base::Time time_;
+};
+}  // namespace
+
+class CachingKeySourceTest : public ::testing::Test {
+ public:
+  CachingKeySourceTest() : clock_(base::Time::FromDoubleT(1577836800)) {}
+
+ protected:
+  void SetUp() override {
+    key_cache_.cache_directory = kCacheDirectory;
+    key_cache_.wrapping_key = HexStringToVector(kWrappingKeyHex);
+    key_cache_.ttl_in_seconds = kTtlInSeconds;
+  }
+
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  // Creates a CachingKeySource wrapping a RawKeySource, counting the number
+  // of times the RawKeySource is created in |key_source_creation_count_|.
+  std::unique_ptr<CachingKeySource> CreateCachingKeySource() {
+    return CachingKeySource::Create(
+        key_cache_, kCacheId,
+        [this]() -> std::unique_ptr<KeySource> {
+          ++key_source_creation_count_;
+          RawKeyParams raw_key;
+          raw_key.iv = HexStringToVector(kIvHex);
+          raw_key.key_map[kStreamLabel].key_id = HexStringToVector(kKeyIdHex);
+          raw_key.key_map[kStreamLabel].key = HexStringToVector(kKeyHex);
+          return RawKeySource::Create(raw_key);
+        },
+        &clock_);
+  }
+
+  KeyCacheParams key_cache_;
+  TestClock clock_;
+  int key_source_creation_count_ = 0;
+};
+
+TEST_F(CachingKeySourceTest, InvalidWrappingKey) {
+  key_cache_.wrapping_key.resize(15);
+  EXPECT_FALSE(CreateCachingKeySource());
+}
+
+TEST_F(CachingKeySourceTest, KeysAreCachedAcrossRuns) {
+  EncryptionKey key;
+  {
+    std::unique_ptr<CachingKeySource> key_source = CreateCachingKeySource();
+    ASSERT_TRUE(key_source);
+    ASSERT_OK(key_source->GetKey(kStreamLabel, &key));
+    ASSERT_OK(key_source->GetCryptoPeriodKey(1, kCryptoPeriodSeconds,
+                                             kStreamLabel, &key));
+    EXPECT_EQ(1, key_source_creation_count_);
+  }
+
+  std::unique_ptr<CachingKeySource> key_source = CreateCachingKeySource();
+  ASSERT_TRUE(key_source);
+  ASSERT_OK(key_source->GetKey(kStreamLabel, &key));
+  EXPECT_EQ(HexStringToVector(kKeyIdHex), key.key_id);
+  EXPECT_EQ(HexStringToVector(kKeyHex), key.key);
+  EXPECT_EQ(HexStringToVector(kIvHex), key.iv);
+  ASSERT_OK(key_source->GetKey(HexStringToVector(kKeyIdHex), &key));
+  EXPECT_EQ(HexStringToVector(kKeyHex), key.key);
+
+  EncryptionKey crypto_period_key;
+  ASSERT_OK(key_source->GetCryptoPeriodKey(1, kCryptoPeriodSeconds,
+                                           kStreamLabel, &crypto_period_key));
+  EXPECT_NE(key.key, crypto_period_key.key);
+  // Served from the cache, so the key source is not created again.
+  EXPECT_EQ(1, key_source_creation_count_);
+
+  // A crypto period that is not cached yet.
+  ASSERT_OK(key_source->GetCryptoPeriodKey(2, kCryptoPeriodSeconds,
+                                           kStreamLabel, &crypto_period_key));
+  EXPECT_EQ(2, key_source_creation_count_);
+}
+
+TEST_F(CachingKeySourceTest, ExpiredKeysAreFetchedAgain) {
+  EncryptionKey key;
+  {
+    std::unique_ptr<CachingKeySource> key_source = CreateCachingKeySource();
+    ASSERT_OK(key_source->GetKey(kStreamLabel, &key));
+  }
+  clock_.Advance(base::TimeDelta::FromSeconds(kTtlInSeconds));
+
+  std::unique_ptr<CachingKeySource> key_source = CreateCachingKeySource();
+  ASSERT_OK(key_source->GetKey(kStreamLabel, &key));
+  EXPECT_EQ(2, key_source_creation_count_);
+}
+
+TEST_F(CachingKeySourceTest, CacheWithAnotherWrappingKeyIsIgnored) {
+  EncryptionKey key;
+  {
+    std::unique_ptr<CachingKeySource> key_source = CreateCachingKeySource();
+    ASSERT_OK(key_source->GetKey(kStreamLabel, &key));
+  }
+  key_cache_.wrapping_key = HexStringToVector(kAnotherWrappingKeyHex);
+
+  std::unique_ptr<CachingKeySource> key_source = CreateCachingKeySource();
+  ASSERT_OK(key_source->GetKey(kStreamLabel, &key));
+  EXPECT_EQ(HexStringToVector(kKeyHex), key.key);
+  EXPECT_EQ(2, key_source_creation_count_);
+}
+
+TEST_F(CachingKeySourceTest, SharedCacheIsReloadedOnMiss) {
+  key_cache_.shared = true;
+  std::unique_ptr<CachingKeySource> key_source = CreateCachingKeySource();
+  std::unique_ptr<CachingKeySource> other_key_source =
+      CreateCachingKeySource();
+
+  EncryptionKey key;
+  ASSERT_OK(key_source->GetCryptoPeriodKey(1, kCryptoPeriodSeconds,
+                                           kStreamLabel, &key));
+  EXPECT_EQ(1, key_source_creation_count_);
+
+  // Saved as soon as it is fetched, so the other key source, which was
+  // created before, finds it without fetching it.
+  EncryptionKey other_key;
+  ASSERT_OK(other_key_source->GetCryptoPeriodKey(1, kCryptoPeriodSeconds,
+                                                 kStreamLabel, &other_key));
+  EXPECT_EQ(key.key, other_key.key);
+  EXPECT_EQ(1, key_source_creation_count_);
+}
+
+TEST_F(CachingKeySourceTest, SharedCacheIsMergedOnSave) {
+  key_cache_.shared = true;
+  std::unique_ptr<CachingKeySource> key_source = CreateCachingKeySource();
+  std::unique_ptr<CachingKeySource> other_key_source =
+      CreateCachingKeySource();
+
+  EncryptionKey key;
+  ASSERT_OK(key_source->GetCryptoPeriodKey(1, kCryptoPeriodSeconds,
+                                           kStreamLabel, &key));
+  ASSERT_OK(other_key_source->GetCryptoPeriodKey(2, kCryptoPeriodSeconds,
+                                                 kStreamLabel, &key));
+  EXPECT_EQ(2, key_source_creation_count_);
+
+  // Both crypto periods are in the cache, although each key source saved
+  // only one of them.
+  key_source = CreateCachingKeySource();
+  ASSERT_OK(key_source->GetCryptoPeriodKey(1, kCryptoPeriodSeconds,
+                                           kStreamLabel, &key));
+  ASSERT_OK(key_source->GetCryptoPeriodKey(2, kCryptoPeriodSeconds,
+                                           kStreamLabel, &key));
+  EXPECT_EQ(2, key_source_creation_count_);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -10,9 +10,11 @@
 
 #include <cctype>
 #include <limits>
+#include <vector>
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_util.h"
+#include "packager/file/file.h"
 #include "packager/media/base/bit_reader.h"
 #include "packager/mpd/base/xml/scoped_xml_ptr.h"
 
@@ -1643,6 +1645,24 @@ bool CheckWebVtt(const uint8_t* buffer, int buffer_size) {
                     arraysize(kWebVtt) - 1);
 }
 
+// Read from |file| until |buffer| holds |size| bytes or the end of file is
+// reached.
+bool ReadUpTo(File* file, size_t size, std::vector<uint8_t>* buffer) {
+  size_t bytes_read = buffer->size();
+  buffer->resize(size);
+  while (bytes_read < size) {
+    const int64_t read_result =
+        file->Read(buffer->data() + bytes_read, size - bytes_read);
+    if (read_result < 0)
+      return false;
+    if (read_result == 0)
+      break;
+    bytes_read += read_result;
+  }
+  buffer->resize(bytes_read);
+  return true;
+}
+
 bool CheckTtml(const uint8_t* buffer, int buffer_size) {
   // Sanity check first before reading the entire thing.
   if (!StartsWith(buffer, buffer_size, "<?xml"))
@@ -1668,20 +1688,18 @@ bool CheckTtml(const uint8_t* buffer, int buffer_size) {
 MediaContainerName DetermineContainer(const uint8_t* buffer, int buffer_size) {
   DCHECK(buffer);
 
-  // Since MOV/QuickTime/MPEG4 streams are common, check for them first.
-  if (CheckMov(buffer, buffer_size))
-    return CONTAINER_MOV;
+  // The common containers are identified by their signature.
+  MediaContainerName result =
+      DetermineContainerFromSignature(buffer, buffer_size);
+  if (result != CONTAINER_UNKNOWN)
+    return result;
 
   // Next attempt the simple checks, that typically look at just the
   // first few bytes of the file.
-  MediaContainerName result = LookupContainerByFirst4(buffer, buffer_size);
+  result = LookupContainerByFirst4(buffer, buffer_size);
   if (result != CONTAINER_UNKNOWN)
     return result;
 
-  // WebVTT check only checks for the first few bytes.
-  if (CheckWebVtt(buffer, buffer_size))
-      return CONTAINER_WEBVTT;
-
   // Additional checks that may scan a portion of the buffer.
   if (CheckMpeg2ProgramStream(buffer, buffer_size))
     return CONTAINER_MPEG2PS;
@@ -1724,6 +1742,52 @@ MediaContainerName DetermineContainer(const uint8_t* buffer, int buffer_size) {
   return CONTAINER_UNKNOWN;
 }
 
+MediaContainerName DetermineContainerFromSignature(const uint8_t* buffer,
+                                                   int buffer_size) {
+  DCHECK(buffer);
+
+  // Since MOV/QuickTime/MPEG4 streams are common, check for them first.
+  if (CheckMov(buffer, buffer_size))
+    return CONTAINER_MOV;
+  if (buffer_size >= 4 && Read32(buffer) == 0x1a45dfa3 &&
+      CheckWebm(buffer, buffer_size)) {
+    return CONTAINER_WEBM;
+  }
+  // WebVTT check only checks for the first few bytes.
+  if (CheckWebVtt(buffer, buffer_size))
+    return CONTAINER_WEBVTT;
+  return CONTAINER_UNKNOWN;
+}
+
+MediaContainerName ProbeContainer(const std::string& file_name) {
+  // The signatures are in the first few bytes, while some of the other checks
+  // scan a portion of the buffer.
+  const size_t kSignatureProbeSize = 0x1000;
+  const size_t kProbeSize = 0x10000;
+
+  File* file = File::Open(file_name.c_str(), "r");
+  if (!file) {
+    LOG(ERROR) << "Cannot open file for reading " << file_name;
+    return CONTAINER_UNKNOWN;
+  }
+  std::vector<uint8_t> buffer;
+  bool success = ReadUpTo(file, kSignatureProbeSize, &buffer);
+  MediaContainerName result = CONTAINER_UNKNOWN;
+  if (success && !buffer.empty()) {
+    result = DetermineContainerFromSignature(buffer.data(), buffer.size());
+    if (result == CONTAINER_UNKNOWN) {
+      if (buffer.size() == kSignatureProbeSize)
+        success = ReadUpTo(file, kProbeSize, &buffer);
+      if (success)
+        result = DetermineContainer(buffer.data(), buffer.size());
+    }
+  }
+  file->Close();
+  if (!success)
+    LOG(ERROR) << "Cannot read file " << file_name;
+  return result;
+}
+
 MediaContainerName DetermineContainerFromFormatName(
     const std::string& format_name) {
   if (base::EqualsCaseInsensitiveASCII(format_name, "aac") ||
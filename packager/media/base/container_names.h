@@ -62,6 +62,23 @@ enum MediaContainerName {
 /// Determine the container type from input data.
 MediaContainerName DetermineContainer(const uint8_t* buffer, int buffer_size);
 
+/// Determine the container type from the signature at the beginning of input
+/// data, which identifies ISO-BMFF, WebM and WebVTT inputs. This only looks
+/// at the first few bytes, or the first few boxes of ISO-BMFF inputs, and
+/// agrees with DetermineContainer() on the containers it identifies.
+/// @return the container type, or CONTAINER_UNKNOWN if the input has to be
+///         examined further with DetermineContainer().
+MediaContainerName DetermineContainerFromSignature(const uint8_t* buffer,
+                                                   int buffer_size);
+
+/// Determine the container type of a file, e.g. as a preflight check before
+/// packaging. Only the beginning of the file is read, and the first 64 KiB if
+/// the signature does not identify the container.
+/// @param file_name Specifies the file, which can be any supported File.
+/// @return the container type, or CONTAINER_UNKNOWN if it cannot be
+///         determined or if the file cannot be read.
+MediaContainerName ProbeContainer(const std::string& file_name);
+
 /// Determine the container type from the format name.
 /// @param format_name Specifies the format, e.g. 'webm', 'mov', 'mp4'.
 MediaContainerName DetermineContainerFromFormatName(
@@ -288,5 +288,53 @@ TEST(ContainerNamesTest, FileCheckUNKNOWN) {
   TestFile(CONTAINER_UNKNOWN, GetTestDataFilePath("README"));
 }
 
+TEST(ContainerNamesTest, FromSignature) {
+  const char kWebVtt[] = "WEBVTT\n";
+  EXPECT_EQ(CONTAINER_WEBVTT,
+            DetermineContainerFromSignature(
+                reinterpret_cast<const uint8_t*>(kWebVtt), arraysize(kWebVtt)));
+
+  // Only the first bytes of the files are needed for these containers.
+  char buffer[256];
+  ASSERT_EQ(static_cast<int>(sizeof(buffer)),
+            base::ReadFile(GetTestDataFilePath("bear-640x360.mp4"), buffer,
+                           sizeof(buffer)));
+  EXPECT_EQ(CONTAINER_MOV, DetermineContainerFromSignature(
+                               reinterpret_cast<const uint8_t*>(buffer),
+                               sizeof(buffer)));
+  ASSERT_EQ(static_cast<int>(sizeof(buffer)),
+            base::ReadFile(GetTestDataFilePath("bear-640x360.webm"), buffer,
+                           sizeof(buffer)));
+  EXPECT_EQ(CONTAINER_WEBM, DetermineContainerFromSignature(
+                                reinterpret_cast<const uint8_t*>(buffer),
+                                sizeof(buffer)));
+
+  // Transport streams are identified by a scan of the packets.
+  ASSERT_EQ(static_cast<int>(sizeof(buffer)),
+            base::ReadFile(GetTestDataFilePath("bear.m2ts"), buffer,
+                           sizeof(buffer)));
+  EXPECT_EQ(CONTAINER_UNKNOWN, DetermineContainerFromSignature(
+                                   reinterpret_cast<const uint8_t*>(buffer),
+                                   sizeof(buffer)));
+}
+
+TEST(ContainerNamesTest, ProbeContainer) {
+  EXPECT_EQ(CONTAINER_MOV,
+            ProbeContainer(
+                GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe()));
+  EXPECT_EQ(CONTAINER_WEBM,
+            ProbeContainer(
+                GetTestDataFilePath("bear-640x360.webm").AsUTF8Unsafe()));
+  EXPECT_EQ(CONTAINER_MPEG2TS,
+            ProbeContainer(GetTestDataFilePath("bear.m2ts").AsUTF8Unsafe()));
+  EXPECT_EQ(CONTAINER_MP3,
+            ProbeContainer(GetTestDataFilePath("id3_test.mp3").AsUTF8Unsafe()));
+  EXPECT_EQ(CONTAINER_UNKNOWN,
+            ProbeContainer(GetTestDataFilePath("README").AsUTF8Unsafe()));
+  EXPECT_EQ(CONTAINER_UNKNOWN,
+            ProbeContainer(
+                GetTestDataFilePath("no_such_file.mp4").AsUTF8Unsafe()));
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -20,13 +20,27 @@ DecryptConfig::DecryptConfig(const std::vector<uint8_t>& key_id,
                              FourCC protection_scheme,
                              uint8_t crypt_byte_block,
                              uint8_t skip_byte_block)
-    : key_id_(key_id),
-      iv_(iv),
-      subsamples_(subsamples),
+    : DecryptConfig(std::make_shared<const std::vector<uint8_t>>(key_id),
+                    Iv(iv),
+                    Subsamples(subsamples),
+                    protection_scheme,
+                    crypt_byte_block,
+                    skip_byte_block) {}
+
+DecryptConfig::DecryptConfig(std::shared_ptr<const std::vector<uint8_t>> key_id,
+                             Iv iv,
+                             Subsamples subsamples,
+                             FourCC protection_scheme,
+                             uint8_t crypt_byte_block,
+                             uint8_t skip_byte_block)
+    : key_id_(std::move(key_id)),
+      iv_(std::move(iv)),
+      subsamples_(std::move(subsamples)),
       protection_scheme_(protection_scheme),
       crypt_byte_block_(crypt_byte_block),
       skip_byte_block_(skip_byte_block) {
-  CHECK_GT(key_id.size(), 0u);
+  CHECK(key_id_);
+  CHECK_GT(key_id_->size(), 0u);
 }
 
 DecryptConfig::~DecryptConfig() {}
@@ -7,11 +7,13 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "packager/base/macros.h"
 #include "packager/media/base/fourccs.h"
+#include "packager/media/base/inline_vector.h"
 
 namespace shaka {
 namespace media {
@@ -42,6 +44,12 @@ class DecryptConfig {
   /// Keys are always 128 bits.
   static const size_t kDecryptionKeySize = 16;
 
+  /// The iv, which is 8 or 16 bytes, is stored inline.
+  typedef InlineVector<uint8_t, 16> Iv;
+  /// The subsamples are stored inline unless there are many, e.g. in video
+  /// frames with many slices.
+  typedef InlineVector<SubsampleEntry, 8> Subsamples;
+
   /// Create a 'cenc' decrypt config.
   /// @param key_id is the ID that references the decryption key.
   /// @param iv is the initialization vector defined by the encryptor.
@@ -71,6 +79,15 @@ class DecryptConfig {
                 uint8_t crypt_byte_block,
                 uint8_t skip_byte_block);
 
+  /// Same as above, with the key ID shared by the samples of a crypto period
+  /// instead of copied for every sample.
+  DecryptConfig(std::shared_ptr<const std::vector<uint8_t>> key_id,
+                Iv iv,
+                Subsamples subsamples,
+                FourCC protection_scheme,
+                uint8_t crypt_byte_block,
+                uint8_t skip_byte_block);
+
   ~DecryptConfig();
 
   /// @param clear_bytes is the size of clear bytes in the subsample to be
@@ -84,22 +101,25 @@ class DecryptConfig {
   /// @return The total size of subsamples.
   size_t GetTotalSizeOfSubsamples() const;
 
-  const std::vector<uint8_t>& key_id() const { return key_id_; }
-  const std::vector<uint8_t>& iv() const { return iv_; }
-  const std::vector<SubsampleEntry>& subsamples() const { return subsamples_; }
+  const std::vector<uint8_t>& key_id() const { return *key_id_; }
+  const std::shared_ptr<const std::vector<uint8_t>>& shared_key_id() const {
+    return key_id_;
+  }
+  const Iv& iv() const { return iv_; }
+  const Subsamples& subsamples() const { return subsamples_; }
   FourCC protection_scheme() const { return protection_scheme_; }
   uint8_t crypt_byte_block() const { return crypt_byte_block_; }
   uint8_t skip_byte_block() const { return skip_byte_block_; }
 
  private:
-  const std::vector<uint8_t> key_id_;
+  const std::shared_ptr<const std::vector<uint8_t>> key_id_;
 
   // Initialization vector.
-  const std::vector<uint8_t> iv_;
+  const Iv iv_;
 
   // Subsample information. May be empty for some formats, meaning entire frame
   // (less data ignored by data_offset_) is encrypted.
-  std::vector<SubsampleEntry> subsamples_;
+  Subsamples subsamples_;
 
   const FourCC protection_scheme_;
   // For pattern-based protection schemes, like CENS and CBCS.
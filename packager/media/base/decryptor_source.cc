@@ -6,6 +6,8 @@
 
 #include "packager/media/base/decryptor_source.h"
 
+#include <openssl/aes.h>
+
 #include "packager/base/logging.h"
 #include "packager/media/base/aes_decryptor.h"
 #include "packager/media/base/aes_pattern_cryptor.h"
@@ -25,6 +27,8 @@ bool CheckMemoryOverlap(const uint8_t* encrypted_buffer,
 namespace shaka {
 namespace media {
 
+const size_t DecryptorSource::kMaxCachedDecryptors;
+
 DecryptorSource::DecryptorSource(KeySource* key_source)
     : key_source_(key_source) {
   CHECK(key_source);
@@ -44,58 +48,10 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
     return false;
   }
 
-  // Get the decryptor object.
-  AesCryptor* decryptor = nullptr;
-  auto found = decryptor_map_.find(decrypt_config->key_id());
-  if (found == decryptor_map_.end()) {
-    // Create new AesDecryptor based on decryption mode.
-    EncryptionKey key;
-    Status status(key_source_->GetKey(decrypt_config->key_id(), &key));
-    if (!status.ok()) {
-      LOG(ERROR) << "Error retrieving decryption key: " << status;
-      return false;
-    }
-
-    std::unique_ptr<AesCryptor> aes_decryptor;
-    switch (decrypt_config->protection_scheme()) {
-      case FOURCC_cenc:
-        aes_decryptor.reset(new AesCtrDecryptor);
-        break;
-      case FOURCC_cbc1:
-        aes_decryptor.reset(new AesCbcDecryptor(kNoPadding));
-        break;
-      case FOURCC_cens:
-        aes_decryptor.reset(new AesPatternCryptor(
-            decrypt_config->crypt_byte_block(),
-            decrypt_config->skip_byte_block(),
-            AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
-            AesCryptor::kDontUseConstantIv,
-            std::unique_ptr<AesCryptor>(new AesCtrDecryptor())));
-        break;
-      case FOURCC_cbcs:
-        aes_decryptor.reset(new AesPatternCryptor(
-            decrypt_config->crypt_byte_block(),
-            decrypt_config->skip_byte_block(),
-            AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
-            AesCryptor::kUseConstantIv,
-            std::unique_ptr<AesCryptor>(new AesCbcDecryptor(kNoPadding))));
-        break;
-      default:
-        LOG(ERROR) << "Unsupported protection scheme: "
-                   << decrypt_config->protection_scheme();
-        return false;
-    }
-
-    if (!aes_decryptor->InitializeWithIv(key.key, decrypt_config->iv())) {
-      LOG(ERROR) << "Failed to initialize AesDecryptor for decryption.";
-      return false;
-    }
-    decryptor = aes_decryptor.get();
-    decryptor_map_[decrypt_config->key_id()] = std::move(aes_decryptor);
-  } else {
-    decryptor = found->second.get();
-  }
-  if (!decryptor->SetIv(decrypt_config->iv())) {
+  AesCryptor* decryptor = GetDecryptor(*decrypt_config);
+  if (!decryptor)
+    return false;
+  if (!decryptor->SetIv(decrypt_config->iv().ToVector())) {
     LOG(ERROR) << "Invalid initialization vector.";
     return false;
   }
@@ -110,15 +66,33 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
   }
 
   // Subsample decryption.
-  const std::vector<SubsampleEntry>& subsamples = decrypt_config->subsamples();
+  const DecryptConfig::Subsamples& subsamples = decrypt_config->subsamples();
+  size_t total_size = 0;
+  bool cipher_bytes_block_aligned = true;
+  for (const auto& subsample : subsamples) {
+    total_size += subsample.clear_bytes + subsample.cipher_bytes;
+    if (subsample.cipher_bytes % AES_BLOCK_SIZE != 0)
+      cipher_bytes_block_aligned = false;
+  }
+  if (total_size > buffer_size) {
+    LOG(ERROR) << "Subsamples overflow sample buffer.";
+    return false;
+  }
+
+  // The cipher stream continues across the subsamples for 'cenc' and, if all
+  // the protected ranges are block aligned, for 'cbc1', so the subsamples
+  // can be decrypted together. The pattern based schemes restart the pattern
+  // for every subsample.
+  const FourCC protection_scheme = decrypt_config->protection_scheme();
+  if (subsamples.size() > 1 &&
+      (protection_scheme == FOURCC_cenc ||
+       (protection_scheme == FOURCC_cbc1 && cipher_bytes_block_aligned))) {
+    return DecryptSubsamplesInBulk(subsamples, decryptor, encrypted_buffer,
+                                   decrypted_buffer);
+  }
+
   const uint8_t* current_ptr = encrypted_buffer;
-  const uint8_t* const buffer_end = encrypted_buffer + buffer_size;
   for (const auto& subsample : subsamples) {
-    if ((current_ptr + subsample.clear_bytes + subsample.cipher_bytes) >
-        buffer_end) {
-      LOG(ERROR) << "Subsamples overflow sample buffer.";
-      return false;
-    }
     memcpy(decrypted_buffer, current_ptr, subsample.clear_bytes);
     current_ptr += subsample.clear_bytes;
     decrypted_buffer += subsample.clear_bytes;
@@ -133,5 +107,107 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
   return true;
 }
 
+AesCryptor* DecryptorSource::GetDecryptor(const DecryptConfig& decrypt_config) {
+  for (auto iter = decryptors_.begin(); iter != decryptors_.end(); ++iter) {
+    if (iter->key_id == decrypt_config.key_id() &&
+        iter->protection_scheme == decrypt_config.protection_scheme() &&
+        iter->crypt_byte_block == decrypt_config.crypt_byte_block() &&
+        iter->skip_byte_block == decrypt_config.skip_byte_block()) {
+      decryptors_.splice(decryptors_.begin(), decryptors_, iter);
+      return decryptors_.front().decryptor.get();
+    }
+  }
+
+  // Create new AesDecryptor based on decryption mode.
+  EncryptionKey key;
+  Status status(key_source_->GetKey(decrypt_config.key_id(), &key));
+  if (!status.ok()) {
+    LOG(ERROR) << "Error retrieving decryption key: " << status;
+    return nullptr;
+  }
+
+  std::unique_ptr<AesCryptor> aes_decryptor;
+  switch (decrypt_config.protection_scheme()) {
+    case FOURCC_cenc:
+      aes_decryptor.reset(new AesCtrDecryptor);
+      break;
+    case FOURCC_cbc1:
+      aes_decryptor.reset(new AesCbcDecryptor(kNoPadding));
+      break;
+    case FOURCC_cens:
+      aes_decryptor.reset(new AesPatternCryptor(
+          decrypt_config.crypt_byte_block(), decrypt_config.skip_byte_block(),
+          AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+          AesCryptor::kDontUseConstantIv,
+          std::unique_ptr<AesCryptor>(new AesCtrDecryptor())));
+      break;
+    case FOURCC_cbcs:
+      aes_decryptor.reset(new AesPatternCryptor(
+          decrypt_config.crypt_byte_block(), decrypt_config.skip_byte_block(),
+          AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+          AesCryptor::kUseConstantIv,
+          std::unique_ptr<AesCryptor>(new AesCbcDecryptor(kNoPadding))));
+      break;
+    default:
+      LOG(ERROR) << "Unsupported protection scheme: "
+                 << decrypt_config.protection_scheme();
+      return nullptr;
+  }
+
+  if (!aes_decryptor->InitializeWithIv(key.key,
+                                       decrypt_config.iv().ToVector())) {
+    LOG(ERROR) << "Failed to initialize AesDecryptor for decryption.";
+    return nullptr;
+  }
+
+  if (decryptors_.size() >= kMaxCachedDecryptors)
+    decryptors_.pop_back();
+  CachedDecryptor cached_decryptor;
+  cached_decryptor.key_id = decrypt_config.key_id();
+  cached_decryptor.protection_scheme = decrypt_config.protection_scheme();
+  cached_decryptor.crypt_byte_block = decrypt_config.crypt_byte_block();
+  cached_decryptor.skip_byte_block = decrypt_config.skip_byte_block();
+  cached_decryptor.decryptor = std::move(aes_decryptor);
+  decryptors_.push_front(std::move(cached_decryptor));
+  return decryptors_.front().decryptor.get();
+}
+
+bool DecryptorSource::DecryptSubsamplesInBulk(
+    const std::vector<SubsampleEntry>& subsamples,
+    AesCryptor* decryptor,
+    const uint8_t* encrypted_buffer,
+    uint8_t* decrypted_buffer) {
+  // Copy the clear bytes and gather the cipher bytes.
+  cipher_bytes_.clear();
+  const uint8_t* current_ptr = encrypted_buffer;
+  uint8_t* output_ptr = decrypted_buffer;
+  for (const auto& subsample : subsamples) {
+    memcpy(output_ptr, current_ptr, subsample.clear_bytes);
+    current_ptr += subsample.clear_bytes;
+    output_ptr += subsample.clear_bytes + subsample.cipher_bytes;
+    cipher_bytes_.insert(cipher_bytes_.end(), current_ptr,
+                         current_ptr + subsample.cipher_bytes);
+    current_ptr += subsample.cipher_bytes;
+  }
+
+  if (!cipher_bytes_.empty() &&
+      !decryptor->Crypt(cipher_bytes_.data(), cipher_bytes_.size(),
+                        cipher_bytes_.data())) {
+    LOG(ERROR) << "Error decrypting subsample buffer.";
+    return false;
+  }
+
+  // Scatter the decrypted bytes back.
+  const uint8_t* decrypted_ptr = cipher_bytes_.data();
+  output_ptr = decrypted_buffer;
+  for (const auto& subsample : subsamples) {
+    output_ptr += subsample.clear_bytes;
+    memcpy(output_ptr, decrypted_ptr, subsample.cipher_bytes);
+    output_ptr += subsample.cipher_bytes;
+    decrypted_ptr += subsample.cipher_bytes;
+  }
+  return true;
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -7,7 +7,7 @@
 #ifndef PACKAGER_MEDIA_BASE_DECRYPTOR_SOURCE_H_
 #define PACKAGER_MEDIA_BASE_DECRYPTOR_SOURCE_H_
 
-#include <map>
+#include <list>
 #include <memory>
 #include <vector>
 
@@ -19,8 +19,15 @@ namespace shaka {
 namespace media {
 
 /// DecryptorSource wraps KeySource and is responsible for decryptor management.
+/// Initialized decryptors are cached per key ID, protection scheme and pattern,
+/// so inputs with interleaved key IDs do not re-create the decryptors and their
+/// key schedules.
 class DecryptorSource {
  public:
+  /// Maximum number of initialized decryptors kept around. The least recently
+  /// used decryptor is evicted when the limit is reached.
+  static const size_t kMaxCachedDecryptors = 16;
+
   /// Constructs a DecryptorSource object.
   /// @param key_source points to the key source that contains the keys.
   explicit DecryptorSource(KeySource* key_source);
@@ -41,8 +48,29 @@ class DecryptorSource {
                            uint8_t* decrypted_buffer);
 
  private:
+  struct CachedDecryptor {
+    std::vector<uint8_t> key_id;
+    FourCC protection_scheme;
+    uint8_t crypt_byte_block;
+    uint8_t skip_byte_block;
+    std::unique_ptr<AesCryptor> decryptor;
+  };
+
+  // Returns the decryptor for |decrypt_config|, creating it if it is not
+  // cached. Returns nullptr on failure.
+  AesCryptor* GetDecryptor(const DecryptConfig& decrypt_config);
+  // Decrypts the cipher bytes of all |subsamples| with a single Crypt call. The
+  // caller must have validated the subsamples against the buffer size.
+  bool DecryptSubsamplesInBulk(const std::vector<SubsampleEntry>& subsamples,
+                               AesCryptor* decryptor,
+                               const uint8_t* encrypted_buffer,
+                               uint8_t* decrypted_buffer);
+
   KeySource* key_source_;
-  std::map<std::vector<uint8_t>, std::unique_ptr<AesCryptor>> decryptor_map_;
+  // Most recently used first.
+  std::list<CachedDecryptor> decryptors_;
+  // Scratch buffer for bulk subsample decryption, reused across samples.
+  std::vector<uint8_t> cipher_bytes_;
 
   DISALLOW_COPY_AND_ASSIGN(DecryptorSource);
 };
@@ -144,6 +144,58 @@ TEST_F(DecryptorSourceTest, SubsampleDecryption) {
             decrypted_buffer_);
 }
 
+TEST_F(DecryptorSourceTest, LeastRecentlyUsedDecryptorEvicted) {
+  EncryptionKey encryption_key;
+  encryption_key.key.assign(kMockKey, kMockKey + arraysize(kMockKey));
+  const std::vector<uint8_t> iv(kIv, kIv + arraysize(kIv));
+
+  // Fill the cache with |key_id_| followed by other key ids.
+  const size_t kNumKeyIds = DecryptorSource::kMaxCachedDecryptors;
+  std::vector<std::vector<uint8_t>> key_ids;
+  for (size_t i = 0; i < kNumKeyIds; ++i) {
+    key_ids.push_back(key_id_);
+    key_ids.back()[0] += static_cast<uint8_t>(i);
+    EXPECT_CALL(mock_key_source_, GetKey(key_ids.back(), _))
+        .WillOnce(DoAll(SetArgPointee<1>(encryption_key), Return(Status::OK)));
+  }
+  for (const auto& key_id : key_ids) {
+    DecryptConfig decrypt_config(key_id, iv, std::vector<SubsampleEntry>());
+    ASSERT_TRUE(decryptor_source_.DecryptSampleBuffer(
+        &decrypt_config, &encrypted_buffer_[0], encrypted_buffer_.size(),
+        &decrypted_buffer_[0]));
+  }
+  Mock::VerifyAndClearExpectations(&mock_key_source_);
+
+  // Interleaving the cached key ids does not fetch the keys again. Touch all
+  // but the second key id so it becomes the least recently used one.
+  for (size_t i = 0; i < kNumKeyIds; ++i) {
+    if (i == 1)
+      continue;
+    DecryptConfig decrypt_config(key_ids[i], iv, std::vector<SubsampleEntry>());
+    ASSERT_TRUE(decryptor_source_.DecryptSampleBuffer(
+        &decrypt_config, &encrypted_buffer_[0], encrypted_buffer_.size(),
+        &decrypted_buffer_[0]));
+    EXPECT_EQ(std::vector<uint8_t>(kExpectedDecryptedBuffer,
+                                   kExpectedDecryptedBuffer +
+                                       arraysize(kExpectedDecryptedBuffer)),
+              decrypted_buffer_);
+  }
+
+  // A new key id evicts the second key id, which is fetched again afterwards.
+  std::vector<uint8_t> new_key_id = key_id_;
+  new_key_id[1] += 1;
+  EXPECT_CALL(mock_key_source_, GetKey(new_key_id, _))
+      .WillOnce(DoAll(SetArgPointee<1>(encryption_key), Return(Status::OK)));
+  EXPECT_CALL(mock_key_source_, GetKey(key_ids[1], _))
+      .WillOnce(DoAll(SetArgPointee<1>(encryption_key), Return(Status::OK)));
+  for (const auto& key_id : {new_key_id, key_ids[0], key_ids[1]}) {
+    DecryptConfig decrypt_config(key_id, iv, std::vector<SubsampleEntry>());
+    ASSERT_TRUE(decryptor_source_.DecryptSampleBuffer(
+        &decrypt_config, &encrypted_buffer_[0], encrypted_buffer_.size(),
+        &decrypted_buffer_[0]));
+  }
+}
+
 TEST_F(DecryptorSourceTest, SubsampleDecryptionSizeValidation) {
   EncryptionKey encryption_key;
   encryption_key.key.assign(kMockKey, kMockKey + arraysize(kMockKey));
@@ -0,0 +1,109 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/deferred_key_source.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/location.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/metrics/metrics.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+
+DeferredKeySource::DeferredKeySource(const std::string& name,
+                                     const KeySourceFactory& key_source_factory)
+    : name_(name),
+      key_source_factory_(key_source_factory),
+      start_time_(base::TimeTicks::Now()),
+      created_(base::WaitableEvent::ResetPolicy::MANUAL,
+               base::WaitableEvent::InitialState::NOT_SIGNALED) {
+  const Metrics::Labels labels = {{"provider", name_}};
+  metrics_collector_id_ = Metrics::GetInstance()->AddCollector(
+      [this, labels](Metrics::Writer* writer) {
+        // |fetch_duration_| is only set once the creation completes.
+        if (!created_.IsSignaled())
+          return;
+        writer->Add("packager_key_source_fetch_seconds", Metrics::Type::kGauge,
+                    "Time taken to create a key source and fetch its keys.",
+                    labels, fetch_duration_.InSecondsF());
+      });
+
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&DeferredKeySource::CreateKeySourceTask,
+                 base::Unretained(this)),
+      true /* task_is_slow */);
+}
+
+DeferredKeySource::~DeferredKeySource() {
+  Metrics::GetInstance()->RemoveCollector(metrics_collector_id_);
+  // The task references this object, so it must complete first, even if the
+  // caller stopped waiting for it.
+  created_.Wait();
+}
+
+Status DeferredKeySource::Wait(base::TimeDelta timeout) {
+  if (timeout > base::TimeDelta()) {
+    const base::TimeDelta remaining =
+        start_time_ + timeout - base::TimeTicks::Now();
+    if (!created_.IsSignaled() &&
+        (remaining <= base::TimeDelta() || !created_.TimedWait(remaining))) {
+      return Status(error::TIME_OUT,
+                    "Timed out fetching the keys from " + name_ + " after " +
+                        std::to_string(timeout.InSecondsF()) + " seconds.");
+    }
+  } else {
+    created_.Wait();
+  }
+  if (!key_source_)
+    return Status(error::INVALID_ARGUMENT, "Failed to create key source.");
+  return Status::OK;
+}
+
+Status DeferredKeySource::FetchKeys(EmeInitDataType init_data_type,
+                                    const std::vector<uint8_t>& init_data) {
+  RETURN_IF_ERROR(Wait(base::TimeDelta()));
+  return key_source_->FetchKeys(init_data_type, init_data);
+}
+
+Status DeferredKeySource::GetKey(const std::string& stream_label,
+                                 EncryptionKey* key) {
+  RETURN_IF_ERROR(Wait(base::TimeDelta()));
+  return key_source_->GetKey(stream_label, key);
+}
+
+Status DeferredKeySource::GetKey(const std::vector<uint8_t>& key_id,
+                                 EncryptionKey* key) {
+  RETURN_IF_ERROR(Wait(base::TimeDelta()));
+  return key_source_->GetKey(key_id, key);
+}
+
+Status DeferredKeySource::GetCryptoPeriodKey(
+    uint32_t crypto_period_index,
+    uint32_t crypto_period_duration_in_seconds,
+    const std::string& stream_label,
+    EncryptionKey* key) {
+  RETURN_IF_ERROR(Wait(base::TimeDelta()));
+  return key_source_->GetCryptoPeriodKey(
+      crypto_period_index, crypto_period_duration_in_seconds, stream_label,
+      key);
+}
+
+void DeferredKeySource::CreateKeySourceTask() {
+  key_source_ = key_source_factory_();
+  fetch_duration_ = base::TimeTicks::Now() - start_time_;
+  LOG(INFO) << (key_source_ ? "Fetched" : "Failed to fetch")
+            << " the keys from " << name_ << " in "
+            << fetch_duration_.InSecondsF() << " seconds.";
+  created_.Signal();
+}
+
+}  // namespace media
+}  // namespace shaka
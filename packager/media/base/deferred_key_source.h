@@ -0,0 +1,82 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_DEFERRED_KEY_SOURCE_H_
+#define PACKAGER_MEDIA_BASE_DEFERRED_KEY_SOURCE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/key_source.h"
+
+namespace shaka {
+namespace media {
+
+/// A key source which creates another key source, with its keys fetched, in
+/// the background, so the license request overlaps with the rest of the
+/// setup of the packager instead of blocking it. The calls to the key source
+/// wait for the creation to complete.
+class DeferredKeySource : public KeySource {
+ public:
+  /// Creates the wrapped key source, with its keys fetched. Returns null on
+  /// failure.
+  typedef std::function<std::unique_ptr<KeySource>()> KeySourceFactory;
+
+  /// Starts creating the key source in the background.
+  /// @param name identifies the key provider in the logs and the metrics.
+  /// @param key_source_factory creates the wrapped key source.
+  DeferredKeySource(const std::string& name,
+                    const KeySourceFactory& key_source_factory);
+  /// Waits for the key source creation to complete.
+  ~DeferredKeySource() override;
+
+  /// Waits for the key source creation to complete.
+  /// @param timeout is the maximum time the creation may take, counted from
+  ///        the construction of this object, so the time already spent on
+  ///        other work is deducted. Waits indefinitely if it is zero.
+  /// @return OK if the key source was created, an error status if it failed
+  ///         or if it did not complete within @a timeout.
+  Status Wait(base::TimeDelta timeout);
+
+  /// @name KeySource implementation overrides.
+  /// @{
+  Status FetchKeys(EmeInitDataType init_data_type,
+                   const std::vector<uint8_t>& init_data) override;
+  Status GetKey(const std::string& stream_label, EncryptionKey* key) override;
+  Status GetKey(const std::vector<uint8_t>& key_id,
+                EncryptionKey* key) override;
+  Status GetCryptoPeriodKey(uint32_t crypto_period_index,
+                            uint32_t crypto_period_duration_in_seconds,
+                            const std::string& stream_label,
+                            EncryptionKey* key) override;
+  /// @}
+
+ private:
+  DeferredKeySource(const DeferredKeySource&) = delete;
+  DeferredKeySource& operator=(const DeferredKeySource&) = delete;
+
+  void CreateKeySourceTask();
+
+  const std::string name_;
+  const KeySourceFactory key_source_factory_;
+  const base::TimeTicks start_time_;
+
+  // Signaled once |key_source_| and |fetch_duration_| are set, after which
+  // they are not modified.
+  base::WaitableEvent created_;
+  std::unique_ptr<KeySource> key_source_;
+  base::TimeDelta fetch_duration_;
+  int metrics_collector_id_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_DEFERRED_KEY_SOURCE_H_
@@ -0,0 +1,84 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/deferred_key_source.h"
+#include "packager/media/base/raw_key_source.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kKeyIdHex[] = "0101020305080d1522375990e9000000";
+const char kKeyHex[] = "00100100200300500801302103405500";
+const char kStreamLabel[] = "SD";
+const char kProviderName[] = "raw_key";
+
+std::vector<uint8_t> HexStringToVector(const std::string& str) {
+  std::vector<uint8_t> vec;
+  CHECK(base::HexStringToBytes(str, &vec));
+  return vec;
+}
+
+std::unique_ptr<KeySource> CreateRawKeySource() {
+  RawKeyParams raw_key;
+  raw_key.key_map[kStreamLabel].key_id = HexStringToVector(kKeyIdHex);
+  raw_key.key_map[kStreamLabel].key = HexStringToVector(kKeyHex);
+  return RawKeySource::Create(raw_key);
+}
+}  // namespace
+
+TEST(DeferredKeySourceTest, ForwardsToTheCreatedKeySource) {
+  DeferredKeySource key_source(kProviderName, &CreateRawKeySource);
+  ASSERT_OK(key_source.Wait(base::TimeDelta()));
+
+  EncryptionKey key;
+  ASSERT_OK(key_source.GetKey(kStreamLabel, &key));
+  EXPECT_EQ(HexStringToVector(kKeyIdHex), key.key_id);
+  EXPECT_EQ(HexStringToVector(kKeyHex), key.key);
+  ASSERT_OK(key_source.GetKey(HexStringToVector(kKeyIdHex), &key));
+  EXPECT_EQ(HexStringToVector(kKeyHex), key.key);
+}
+
+TEST(DeferredKeySourceTest, GetKeyWaitsForTheKeySource) {
+  // GetKey() is called without Wait().
+  DeferredKeySource key_source(kProviderName, &CreateRawKeySource);
+  EncryptionKey key;
+  ASSERT_OK(key_source.GetKey(kStreamLabel, &key));
+  EXPECT_EQ(HexStringToVector(kKeyHex), key.key);
+}
+
+TEST(DeferredKeySourceTest, CreationFailure) {
+  DeferredKeySource key_source(
+      kProviderName, []() { return std::unique_ptr<KeySource>(); });
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            key_source.Wait(base::TimeDelta()).error_code());
+  EncryptionKey key;
+  EXPECT_FALSE(key_source.GetKey(kStreamLabel, &key).ok());
+}
+
+TEST(DeferredKeySourceTest, Timeout) {
+  base::WaitableEvent release(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+  DeferredKeySource key_source(kProviderName, [&release]() {
+    release.Wait();
+    return CreateRawKeySource();
+  });
+  EXPECT_EQ(error::TIME_OUT,
+            key_source.Wait(base::TimeDelta::FromMilliseconds(10))
+                .error_code());
+
+  // The creation still completes after the timeout.
+  release.Signal();
+  ASSERT_OK(key_source.Wait(base::TimeDelta()));
+}
+
+}  // namespace media
+}  // namespace shaka
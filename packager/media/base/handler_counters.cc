@@ -0,0 +1,102 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/handler_counters.h"
+
+#include "packager/media/base/media_handler.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// The innermost timer alive on the current thread.
+thread_local ScopedProcessTimer* g_current_timer = nullptr;
+
+uint64_t Increment(std::atomic<uint64_t>* counter, uint64_t value) {
+  return counter->fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t Load(const std::atomic<uint64_t>& counter) {
+  return counter.load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+const uint64_t HandlerCounters::kTimingSampleInterval;
+
+bool HandlerCounters::Record(const StreamData& stream_data) {
+  switch (stream_data.stream_data_type) {
+    case StreamDataType::kStreamInfo:
+      Increment(&num_stream_infos_, 1);
+      break;
+    case StreamDataType::kMediaSample:
+      Increment(&num_media_samples_, 1);
+      Increment(&sample_bytes_, stream_data.media_sample->data_size());
+      break;
+    case StreamDataType::kTextSample:
+      Increment(&num_text_samples_, 1);
+      Increment(&sample_bytes_, stream_data.text_sample->payload().size());
+      break;
+    case StreamDataType::kSegmentInfo:
+      Increment(&num_segment_infos_, 1);
+      break;
+    case StreamDataType::kScte35Event:
+      Increment(&num_scte35_events_, 1);
+      break;
+    case StreamDataType::kCueEvent:
+      Increment(&num_cue_events_, 1);
+      break;
+    case StreamDataType::kUnknown:
+      break;
+  }
+
+  const uint64_t num_calls = Increment(&num_calls_, 1);
+  return num_calls % kTimingSampleInterval == 0 ||
+         ScopedProcessTimer::IsTiming();
+}
+
+void HandlerCounters::GetStats(HandlerStats* stats) const {
+  stats->num_stream_infos = Load(num_stream_infos_);
+  stats->num_media_samples = Load(num_media_samples_);
+  stats->num_text_samples = Load(num_text_samples_);
+  stats->num_segment_infos = Load(num_segment_infos_);
+  stats->num_scte35_events = Load(num_scte35_events_);
+  stats->num_cue_events = Load(num_cue_events_);
+  stats->sample_bytes = Load(sample_bytes_);
+
+  const uint64_t num_timed_calls = Load(num_timed_calls_);
+  if (num_timed_calls > 0) {
+    const double average_process_time_us =
+        static_cast<double>(Load(timed_process_time_us_)) / num_timed_calls;
+    stats->process_time_us =
+        static_cast<uint64_t>(average_process_time_us * Load(num_calls_));
+  }
+}
+
+ScopedProcessTimer::ScopedProcessTimer(HandlerCounters* counters)
+    : counters_(counters),
+      parent_(g_current_timer),
+      start_time_(base::TimeTicks::Now()) {
+  g_current_timer = this;
+}
+
+ScopedProcessTimer::~ScopedProcessTimer() {
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start_time_;
+  g_current_timer = parent_;
+  if (parent_)
+    parent_->nested_time_ += elapsed;
+
+  Increment(&counters_->num_timed_calls_, 1);
+  Increment(&counters_->timed_process_time_us_,
+            (elapsed - nested_time_).InMicroseconds());
+}
+
+bool ScopedProcessTimer::IsTiming() {
+  return g_current_timer != nullptr;
+}
+
+}  // namespace media
+}  // namespace shaka
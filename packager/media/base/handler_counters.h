@@ -0,0 +1,83 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_HANDLER_COUNTERS_H_
+#define PACKAGER_MEDIA_BASE_HANDLER_COUNTERS_H_
+
+#include <atomic>
+
+#include "packager/base/time/time.h"
+#include "packager/media/public/handler_stats.h"
+
+namespace shaka {
+namespace media {
+
+struct StreamData;
+
+/// Counters of the stream data processed by a MediaHandler. They are updated
+/// on the thread running the handler with relaxed atomic operations, and can
+/// be read from any other thread. Only one call to Process() out of
+/// kTimingSampleInterval is timed, so that they can be left on in production.
+class HandlerCounters {
+ public:
+  /// One call out of kTimingSampleInterval is timed.
+  static const uint64_t kTimingSampleInterval = 64;
+
+  HandlerCounters() = default;
+
+  /// Count @a stream_data, which is about to be processed.
+  /// @return true if the processing of @a stream_data should be timed with a
+  ///         ScopedProcessTimer.
+  bool Record(const StreamData& stream_data);
+
+  /// Fill the counters in @a stats, extrapolating the process time.
+  void GetStats(HandlerStats* stats) const;
+
+ private:
+  HandlerCounters(const HandlerCounters&) = delete;
+  HandlerCounters& operator=(const HandlerCounters&) = delete;
+
+  friend class ScopedProcessTimer;
+
+  std::atomic<uint64_t> num_stream_infos_{0};
+  std::atomic<uint64_t> num_media_samples_{0};
+  std::atomic<uint64_t> num_text_samples_{0};
+  std::atomic<uint64_t> num_segment_infos_{0};
+  std::atomic<uint64_t> num_scte35_events_{0};
+  std::atomic<uint64_t> num_cue_events_{0};
+  std::atomic<uint64_t> sample_bytes_{0};
+
+  std::atomic<uint64_t> num_calls_{0};
+  std::atomic<uint64_t> num_timed_calls_{0};
+  std::atomic<uint64_t> timed_process_time_us_{0};
+};
+
+/// Times the processing of a stream data by a handler, excluding the time
+/// spent in the timers nested in its scope, i.e. in the downstream handlers.
+/// While a timer is alive, all the nested processing on the same thread is
+/// timed, so that the nested time can be excluded.
+class ScopedProcessTimer {
+ public:
+  explicit ScopedProcessTimer(HandlerCounters* counters);
+  ~ScopedProcessTimer();
+
+  /// @return true if a timer is alive on the calling thread.
+  static bool IsTiming();
+
+ private:
+  ScopedProcessTimer(const ScopedProcessTimer&) = delete;
+  ScopedProcessTimer& operator=(const ScopedProcessTimer&) = delete;
+
+  HandlerCounters* const counters_;
+  ScopedProcessTimer* const parent_;
+  const base::TimeTicks start_time_;
+  base::TimeDelta nested_time_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_HANDLER_COUNTERS_H_
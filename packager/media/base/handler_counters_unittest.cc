@@ -0,0 +1,88 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/handler_counters.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/threading/platform_thread.h"
+#include "packager/media/base/media_handler.h"
+
+namespace shaka {
+namespace media {
+namespace {
+const uint8_t kData[] = {0x01, 0x02, 0x03, 0x04};
+}  // namespace
+
+TEST(HandlerCountersTest, CountsStreamDataByType) {
+  HandlerCounters counters;
+
+  std::shared_ptr<MediaSample> media_sample =
+      MediaSample::CopyFrom(kData, sizeof(kData), true);
+  std::shared_ptr<TextSample> text_sample = std::make_shared<TextSample>();
+  text_sample->AppendPayload("abc");
+  std::shared_ptr<CueEvent> cue_event = std::make_shared<CueEvent>();
+
+  counters.Record(*StreamData::FromMediaSample(0, media_sample));
+  counters.Record(*StreamData::FromMediaSample(0, media_sample));
+  counters.Record(*StreamData::FromTextSample(0, text_sample));
+  counters.Record(*StreamData::FromCueEvent(0, cue_event));
+
+  HandlerStats stats;
+  counters.GetStats(&stats);
+  EXPECT_EQ(0u, stats.num_stream_infos);
+  EXPECT_EQ(2u, stats.num_media_samples);
+  EXPECT_EQ(1u, stats.num_text_samples);
+  EXPECT_EQ(1u, stats.num_cue_events);
+  EXPECT_EQ(2 * sizeof(kData) + 3, stats.sample_bytes);
+  EXPECT_EQ(0u, stats.process_time_us);
+}
+
+TEST(HandlerCountersTest, SamplesTiming) {
+  HandlerCounters counters;
+  std::shared_ptr<CueEvent> cue_event = std::make_shared<CueEvent>();
+  std::unique_ptr<StreamData> stream_data =
+      StreamData::FromCueEvent(0, cue_event);
+
+  EXPECT_TRUE(counters.Record(*stream_data));
+  for (uint64_t i = 1; i < HandlerCounters::kTimingSampleInterval; ++i)
+    EXPECT_FALSE(counters.Record(*stream_data));
+  EXPECT_TRUE(counters.Record(*stream_data));
+}
+
+TEST(HandlerCountersTest, ExcludesNestedTime) {
+  const base::TimeDelta kSleepTime = base::TimeDelta::FromMilliseconds(20);
+
+  HandlerCounters upstream_counters;
+  HandlerCounters downstream_counters;
+  std::shared_ptr<CueEvent> cue_event = std::make_shared<CueEvent>();
+  std::unique_ptr<StreamData> stream_data =
+      StreamData::FromCueEvent(0, cue_event);
+
+  ASSERT_TRUE(upstream_counters.Record(*stream_data));
+  {
+    ScopedProcessTimer upstream_timer(&upstream_counters);
+    // Processing nested in a timer is always timed.
+    ASSERT_TRUE(downstream_counters.Record(*stream_data));
+    ASSERT_TRUE(downstream_counters.Record(*stream_data));
+    ScopedProcessTimer downstream_timer(&downstream_counters);
+    base::PlatformThread::Sleep(kSleepTime);
+  }
+  EXPECT_FALSE(ScopedProcessTimer::IsTiming());
+
+  HandlerStats upstream_stats;
+  upstream_counters.GetStats(&upstream_stats);
+  HandlerStats downstream_stats;
+  downstream_counters.GetStats(&downstream_stats);
+  EXPECT_LT(upstream_stats.process_time_us,
+            static_cast<uint64_t>(kSleepTime.InMicroseconds()) / 2);
+  // Two calls recorded with a single timed call.
+  EXPECT_GE(downstream_stats.process_time_us,
+            2 * static_cast<uint64_t>(kSleepTime.InMicroseconds()));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -9,15 +9,22 @@
 #include <curl/curl.h>
 #include <gflags/gflags.h>
 
+#include <vector>
+
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/base/synchronization/lock.h"
+#include "packager/file/curl_handle_pool.h"
+#include "packager/metrics/metrics.h"
 
 DEFINE_bool(disable_peer_verification,
             false,
             "Disable peer verification. This is needed to talk to servers "
             "without valid certificates.");
+DEFINE_bool(enable_http2,
+            false,
+            "Negotiate HTTP/2 with the license servers if supported by both "
+            "sides, falling back to HTTP/1.1 otherwise.");
 
 namespace shaka {
 
@@ -81,21 +88,16 @@ int CurlDebugFunction(CURL* /* handle */,
   return 0;
 }
 
-// Scoped CURL implementation which cleans up itself when goes out of scope.
-class ScopedCurl {
- public:
-  ScopedCurl() { ptr_ = curl_easy_init(); }
-  ~ScopedCurl() {
-    if (ptr_)
-      curl_easy_cleanup(ptr_);
-  }
-
-  CURL* get() { return ptr_; }
-
- private:
-  CURL* ptr_;
-  DISALLOW_COPY_AND_ASSIGN(ScopedCurl);
-};
+bool IsHttp2Supported() {
+  static const bool http2_supported = [] {
+    const bool supported = (curl_version_info(CURLVERSION_NOW)->features &
+                            CURL_VERSION_HTTP2) != 0;
+    LOG_IF(WARNING, !supported)
+        << "HTTP/2 is not supported by libcurl. Using HTTP/1.1.";
+    return supported;
+  }();
+  return http2_supported;
+}
 
 size_t AppendToString(char* ptr, size_t size, size_t nmemb, std::string* response) {
   DCHECK(ptr);
@@ -105,31 +107,6 @@ size_t AppendToString(char* ptr, size_t size, size_t nmemb, std::string* respons
   return total_size;
 }
 
-class LibCurlInitializer {
- public:
-  LibCurlInitializer() : initialized_(false) {
-    base::AutoLock lock(lock_);
-    if (!initialized_) {
-      curl_global_init(CURL_GLOBAL_DEFAULT);
-      initialized_ = true;
-    }
-  }
-
-  ~LibCurlInitializer() {
-    base::AutoLock lock(lock_);
-    if (initialized_) {
-      curl_global_cleanup();
-      initialized_ = false;
-    }
-  }
-
- private:
-  base::Lock lock_;
-  bool initialized_;
-
-  DISALLOW_COPY_AND_ASSIGN(LibCurlInitializer);
-};
-
 }  // namespace
 
 namespace media {
@@ -162,9 +139,10 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
                                      const std::string& data,
                                      std::string* response) {
   DCHECK(method == GET || method == POST);
-  static LibCurlInitializer lib_curl_initializer;
-
-  ScopedCurl scoped_curl;
+  ScopedMetricsTimer metrics_timer(
+      "packager_key_fetch_seconds",
+      "Latency of the requests to the key and license servers.", {});
+  ScopedCurl scoped_curl(CurlHandlePool::GetInstance());
   CURL* curl = scoped_curl.get();
   if (!curl) {
     LOG(ERROR) << "curl_easy_init() failed.";
@@ -179,6 +157,13 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendToString);
   curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+  if (FLAGS_enable_http2 && IsHttp2Supported()) {
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    // Prefer multiplexing over an existing connection to opening a new one.
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+  }
 
   if (FLAGS_disable_peer_verification)
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
@@ -201,19 +186,19 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
     curl_easy_setopt(curl, CURLOPT_CAINFO, ca_file_.data());
   }
+  ScopedCurlSlist headers;
   if (method == POST) {
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
     curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, data.size());
 
-    curl_slist* chunk = nullptr;
     if (data.find("soap:Envelope") != std::string::npos) {
       // Adds Http headers for SOAP requests.
-      chunk = curl_slist_append(chunk, kXmlContentTypeHeader);
-      chunk = curl_slist_append(chunk, kSoapActionHeader);
+      headers.Append(kXmlContentTypeHeader);
+      headers.Append(kSoapActionHeader);
     } else {
-      chunk = curl_slist_append(chunk, kJsonContentTypeHeader);
+      headers.Append(kJsonContentTypeHeader);
     }
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.get());
   }
 
   if (VLOG_IS_ON(kMinLogLevelForCurlDebugFunction)) {
@@ -19,6 +19,9 @@ namespace shaka {
 namespace media {
 
 /// A KeyFetcher implementation that retrieves keys over HTTP(s).
+/// Connections are kept alive in a process wide pool and reused by all the
+/// HttpKeyFetcher objects, so requests to the same server do not pay for a new
+/// TCP and TLS handshake each time.
 /// This class is not fully thread safe. It can be used in multi-thread
 /// environment once constructed, but it may not be safe to create a
 /// HttpKeyFetcher object when any other thread is running due to use of
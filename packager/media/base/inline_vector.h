@@ -0,0 +1,164 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_INLINE_VECTOR_H_
+#define PACKAGER_MEDIA_BASE_INLINE_VECTOR_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace shaka {
+namespace media {
+
+/// A vector which stores up to @a N elements inline, without allocating, and
+/// moves them to the heap beyond that. It is meant for the small per sample
+/// data, e.g. the iv and the subsamples of an encrypted sample, which usually
+/// fit inline. @a T must be default constructible and copyable.
+template <typename T, size_t N>
+class InlineVector {
+ public:
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef T* iterator;
+  typedef const T* const_iterator;
+
+  InlineVector() = default;
+  explicit InlineVector(const std::vector<T>& values) {
+    assign(values.begin(), values.end());
+  }
+  template <typename Iterator>
+  InlineVector(Iterator first, Iterator last) {
+    assign(first, last);
+  }
+  InlineVector(const InlineVector& other) {
+    assign(other.begin(), other.end());
+  }
+  InlineVector(InlineVector&& other) { *this = std::move(other); }
+
+  InlineVector& operator=(const InlineVector& other) {
+    if (this != &other)
+      assign(other.begin(), other.end());
+    return *this;
+  }
+  InlineVector& operator=(InlineVector&& other) {
+    if (this == &other)
+      return *this;
+    if (other.on_heap_) {
+      heap_ = std::move(other.heap_);
+      size_ = heap_.size();
+      on_heap_ = true;
+    } else {
+      clear();
+      std::copy(other.inline_, other.inline_ + other.size_, inline_);
+      size_ = other.size_;
+    }
+    other.clear();
+    return *this;
+  }
+
+  template <typename Iterator>
+  void assign(Iterator first, Iterator last) {
+    clear();
+    for (; first != last; ++first)
+      push_back(*first);
+  }
+
+  void push_back(const T& value) {
+    if (!on_heap_ && size_ < N) {
+      inline_[size_++] = value;
+      return;
+    }
+    if (!on_heap_) {
+      heap_.assign(inline_, inline_ + size_);
+      on_heap_ = true;
+    }
+    heap_.push_back(value);
+    ++size_;
+  }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    push_back(T(std::forward<Args>(args)...));
+  }
+
+  /// Removes the elements. The heap storage, if any, is released so that the
+  /// next elements are stored inline again.
+  void clear() {
+    size_ = 0;
+    if (on_heap_) {
+      std::vector<T>().swap(heap_);
+      on_heap_ = false;
+    }
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  /// @return true if the elements are stored inline.
+  bool is_inline() const { return !on_heap_; }
+
+  T* data() { return on_heap_ ? heap_.data() : inline_; }
+  const T* data() const { return on_heap_ ? heap_.data() : inline_; }
+  iterator begin() { return data(); }
+  iterator end() { return data() + size_; }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + size_; }
+  T& operator[](size_t index) { return data()[index]; }
+  const T& operator[](size_t index) const { return data()[index]; }
+  const T& front() const { return data()[0]; }
+  const T& back() const { return data()[size_ - 1]; }
+
+  /// @return a copy of the elements in a std::vector, for the interfaces
+  ///         which take one.
+  std::vector<T> ToVector() const { return std::vector<T>(begin(), end()); }
+
+ private:
+  T inline_[N] = {};
+  std::vector<T> heap_;
+  size_t size_ = 0;
+  bool on_heap_ = false;
+};
+
+template <typename T, size_t N>
+bool operator==(const InlineVector<T, N>& lhs, const InlineVector<T, N>& rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <typename T, size_t N>
+bool operator==(const InlineVector<T, N>& lhs, const std::vector<T>& rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <typename T, size_t N>
+bool operator==(const std::vector<T>& lhs, const InlineVector<T, N>& rhs) {
+  return rhs == lhs;
+}
+
+template <typename T, size_t N>
+bool operator!=(const InlineVector<T, N>& lhs, const InlineVector<T, N>& rhs) {
+  return !(lhs == rhs);
+}
+
+template <typename T, size_t N>
+bool operator!=(const InlineVector<T, N>& lhs, const std::vector<T>& rhs) {
+  return !(lhs == rhs);
+}
+
+template <typename T, size_t N>
+bool operator!=(const std::vector<T>& lhs, const InlineVector<T, N>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_INLINE_VECTOR_H_
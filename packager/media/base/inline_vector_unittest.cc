@@ -0,0 +1,67 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/inline_vector.h"
+
+#include <gtest/gtest.h>
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+typedef InlineVector<int, 2> SmallVector;
+
+}  // namespace
+
+TEST(InlineVectorTest, StoresInlineUpToTheInlineSize) {
+  SmallVector values;
+  EXPECT_TRUE(values.empty());
+  values.push_back(1);
+  values.emplace_back(2);
+  EXPECT_TRUE(values.is_inline());
+  EXPECT_EQ(std::vector<int>({1, 2}), values);
+}
+
+TEST(InlineVectorTest, MovesToTheHeapBeyondTheInlineSize) {
+  SmallVector values(std::vector<int>({1, 2, 3}));
+  EXPECT_FALSE(values.is_inline());
+  EXPECT_EQ(3u, values.size());
+  EXPECT_EQ(1, values.front());
+  EXPECT_EQ(3, values.back());
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), values.ToVector());
+
+  // Back inline once cleared.
+  values.clear();
+  EXPECT_TRUE(values.empty());
+  values.push_back(4);
+  EXPECT_TRUE(values.is_inline());
+  EXPECT_EQ(std::vector<int>({4}), values);
+}
+
+TEST(InlineVectorTest, CopyAndMove) {
+  const std::vector<int> kInlineValues = {1, 2};
+  const std::vector<int> kHeapValues = {1, 2, 3};
+  for (const std::vector<int>& expected : {kInlineValues, kHeapValues}) {
+    SmallVector values(expected);
+    SmallVector copy(values);
+    EXPECT_EQ(values, copy);
+
+    SmallVector moved(std::move(copy));
+    EXPECT_EQ(expected, moved);
+    EXPECT_TRUE(copy.empty());
+
+    SmallVector assigned;
+    assigned = moved;
+    EXPECT_EQ(expected, assigned);
+    assigned = SmallVector();
+    EXPECT_TRUE(assigned.empty());
+    EXPECT_NE(values, assigned);
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
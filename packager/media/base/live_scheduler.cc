@@ -0,0 +1,123 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/live_scheduler.h"
+
+#include "packager/base/logging.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace media {
+
+LiveStreamLag::LiveStreamLag(LiveScheduler* scheduler,
+                             const std::string& name,
+                             bool low_priority)
+    : scheduler_(scheduler), name_(name), low_priority_(low_priority) {}
+
+LiveStreamLag::~LiveStreamLag() {
+  scheduler_->RemoveStream(this);
+}
+
+void LiveStreamLag::OnSegmentPublished(double end_time_in_seconds) {
+  OnSegmentPublished(end_time_in_seconds, base::TimeTicks::Now());
+}
+
+void LiveStreamLag::OnSegmentPublished(double end_time_in_seconds,
+                                       base::TimeTicks publication_time) {
+  scheduler_->UpdateLag(this, end_time_in_seconds, publication_time);
+}
+
+double LiveStreamLag::lag_in_seconds() const {
+  base::AutoLock auto_lock(scheduler_->lock_);
+  return lag_in_seconds_;
+}
+
+LiveScheduler::LiveScheduler() {
+  metrics_collector_id_ =
+      Metrics::GetInstance()->AddCollector([this](Metrics::Writer* writer) {
+        base::AutoLock auto_lock(lock_);
+        for (const LiveStreamLag* stream : streams_) {
+          writer->Add("packager_live_lag_seconds", Metrics::Type::kGauge,
+                      "Lag of the live streams behind real time.",
+                      {{"stream", stream->name()}}, stream->lag_in_seconds_);
+        }
+        writer->Add("packager_live_lagging_streams", Metrics::Type::kGauge,
+                    "Number of live streams, which are not low priority, "
+                    "lagging more than the maximum lag.",
+                    {},
+                    static_cast<double>(num_lagging_streams_.load(
+                        std::memory_order_relaxed)));
+      });
+}
+
+LiveScheduler::~LiveScheduler() {
+  Metrics::GetInstance()->RemoveCollector(metrics_collector_id_);
+}
+
+LiveScheduler* LiveScheduler::GetInstance() {
+  // Leaked, as the streams may be destroyed at exit.
+  static LiveScheduler* live_scheduler = new LiveScheduler;
+  return live_scheduler;
+}
+
+void LiveScheduler::Configure(double max_lag_in_seconds,
+                              bool degrade_low_priority_outputs) {
+  max_lag_in_seconds_.store(max_lag_in_seconds, std::memory_order_relaxed);
+  degrade_low_priority_outputs_.store(degrade_low_priority_outputs,
+                                      std::memory_order_relaxed);
+}
+
+std::shared_ptr<LiveStreamLag> LiveScheduler::AddStream(
+    const std::string& name,
+    bool low_priority) {
+  std::shared_ptr<LiveStreamLag> stream(
+      new LiveStreamLag(this, name, low_priority));
+  base::AutoLock auto_lock(lock_);
+  streams_.insert(stream.get());
+  return stream;
+}
+
+void LiveScheduler::UpdateLag(LiveStreamLag* stream,
+                              double end_time_in_seconds,
+                              base::TimeTicks publication_time) {
+  const double offset_in_seconds =
+      (publication_time - base::TimeTicks()).InSecondsF() -
+      end_time_in_seconds;
+
+  base::AutoLock auto_lock(lock_);
+  if (!stream->has_offset_ ||
+      offset_in_seconds < stream->min_offset_in_seconds_) {
+    stream->has_offset_ = true;
+    stream->min_offset_in_seconds_ = offset_in_seconds;
+  }
+  stream->lag_in_seconds_ = offset_in_seconds - stream->min_offset_in_seconds_;
+
+  const double max_lag = max_lag_in_seconds();
+  if (max_lag <= 0 || stream->low_priority_)
+    return;
+  // The stream stops lagging once it has caught up to half of the maximum
+  // lag, so its priority does not flip at every segment.
+  const bool was_lagging = stream->lagging();
+  const bool lagging = was_lagging ? stream->lag_in_seconds_ > max_lag / 2
+                                   : stream->lag_in_seconds_ > max_lag;
+  if (lagging == was_lagging)
+    return;
+  stream->lagging_.store(lagging, std::memory_order_relaxed);
+  num_lagging_streams_.fetch_add(lagging ? 1 : -1, std::memory_order_relaxed);
+  LOG(INFO) << "Live stream " << stream->name()
+            << (lagging ? " is lagging " : " caught up, lagging ")
+            << stream->lag_in_seconds_ << " seconds behind real time.";
+}
+
+void LiveScheduler::RemoveStream(LiveStreamLag* stream) {
+  base::AutoLock auto_lock(lock_);
+  streams_.erase(stream);
+  if (stream->lagging())
+    num_lagging_streams_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+}  // namespace media
+}  // namespace shaka
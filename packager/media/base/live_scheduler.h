@@ -0,0 +1,138 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_LIVE_SCHEDULER_H_
+#define PACKAGER_MEDIA_BASE_LIVE_SCHEDULER_H_
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace media {
+
+class LiveScheduler;
+
+/// The lag of a live stream behind real time, i.e. how much later its
+/// segments are published than the wall clock time elapsed since the stream
+/// was on time, relative to their timestamps. The stream is on time when the
+/// difference between the publication time and the timestamps is the
+/// smallest seen, so the startup latency of the pipeline does not count as
+/// lag. This class is thread safe.
+class LiveStreamLag {
+ public:
+  ~LiveStreamLag();
+
+  /// Called as a segment of the stream is published.
+  /// @param end_time_in_seconds is the end of the segment, in seconds.
+  void OnSegmentPublished(double end_time_in_seconds);
+  /// Same as above, with the time of the publication, for testing.
+  void OnSegmentPublished(double end_time_in_seconds,
+                          base::TimeTicks publication_time);
+
+  /// @return the lag of the stream, in seconds.
+  double lag_in_seconds() const;
+  /// @return true if the stream lags more than the maximum lag of the
+  ///         scheduler, until it catches up to half of it. Low priority
+  ///         streams are never lagging.
+  bool lagging() const { return lagging_.load(std::memory_order_relaxed); }
+
+  const std::string& name() const { return name_; }
+  bool low_priority() const { return low_priority_; }
+
+ private:
+  friend class LiveScheduler;
+
+  LiveStreamLag(LiveScheduler* scheduler,
+                const std::string& name,
+                bool low_priority);
+  LiveStreamLag(const LiveStreamLag&) = delete;
+  LiveStreamLag& operator=(const LiveStreamLag&) = delete;
+
+  LiveScheduler* const scheduler_;
+  const std::string name_;
+  const bool low_priority_;
+  std::atomic<bool> lagging_{false};
+  // The following are protected by the lock of |scheduler_|.
+  bool has_offset_ = false;
+  // The smallest difference between the publication times and the end times,
+  // in seconds.
+  double min_offset_in_seconds_ = 0;
+  double lag_in_seconds_ = 0;
+};
+
+/// Tracks the lag of the live streams behind real time, so that the shared
+/// worker pools run the tasks of the lagging streams first, see
+/// TaskExecutor::kLaggingMediaPriority, and the low priority outputs, e.g.
+/// the trick play outputs, are degraded while the other streams lag. It is
+/// disabled until Configure() is called with a maximum lag. This class is
+/// thread safe.
+class LiveScheduler {
+ public:
+  LiveScheduler();
+  ~LiveScheduler();
+
+  /// @return the process wide scheduler.
+  static LiveScheduler* GetInstance();
+
+  /// @param max_lag_in_seconds is the lag above which a stream is lagging.
+  ///        Zero disables the scheduler.
+  /// @param degrade_low_priority_outputs is whether the low priority outputs
+  ///        are degraded while a stream which is not low priority lags.
+  void Configure(double max_lag_in_seconds, bool degrade_low_priority_outputs);
+  bool enabled() const { return max_lag_in_seconds() > 0; }
+
+  /// Add a stream to be tracked.
+  /// @param name identifies the stream in the metrics.
+  /// @param low_priority is whether the stream is degraded first, and never
+  ///        prioritized.
+  /// @return the lag of the stream, which is tracked until it is destroyed.
+  std::shared_ptr<LiveStreamLag> AddStream(const std::string& name,
+                                           bool low_priority);
+
+  /// @return true if the low priority outputs should be degraded, i.e. if
+  ///         enabled and any stream which is not low priority is lagging.
+  bool ShouldDegradeLowPriorityOutputs() const {
+    return degrade_low_priority_outputs_.load(std::memory_order_relaxed) &&
+           num_lagging_streams_.load(std::memory_order_relaxed) > 0;
+  }
+
+ private:
+  friend class LiveStreamLag;
+
+  LiveScheduler(const LiveScheduler&) = delete;
+  LiveScheduler& operator=(const LiveScheduler&) = delete;
+
+  double max_lag_in_seconds() const {
+    return max_lag_in_seconds_.load(std::memory_order_relaxed);
+  }
+  // Update the lag of |stream| with a segment published at
+  // |publication_time|.
+  void UpdateLag(LiveStreamLag* stream,
+                 double end_time_in_seconds,
+                 base::TimeTicks publication_time);
+  void RemoveStream(LiveStreamLag* stream);
+
+  std::atomic<double> max_lag_in_seconds_{0};
+  std::atomic<bool> degrade_low_priority_outputs_{false};
+  // The number of lagging streams, which are not low priority.
+  std::atomic<int> num_lagging_streams_{0};
+
+  mutable base::Lock lock_;
+  // Protected by |lock_|.
+  std::set<LiveStreamLag*> streams_;
+
+  int metrics_collector_id_ = 0;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_LIVE_SCHEDULER_H_
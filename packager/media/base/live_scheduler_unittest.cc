@@ -0,0 +1,100 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/live_scheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const double kMaxLagInSeconds = 4;
+
+base::TimeTicks WallClock(double seconds) {
+  return base::TimeTicks() + base::TimeDelta::FromSecondsD(seconds);
+}
+
+}  // namespace
+
+TEST(LiveSchedulerTest, LagIsRelativeToTheSmallestDelay) {
+  LiveScheduler scheduler;
+  std::shared_ptr<LiveStreamLag> stream = scheduler.AddStream("video", false);
+  // The startup latency of 10 seconds is not lag.
+  stream->OnSegmentPublished(2, WallClock(12));
+  EXPECT_EQ(0, stream->lag_in_seconds());
+  stream->OnSegmentPublished(4, WallClock(15));
+  EXPECT_EQ(1, stream->lag_in_seconds());
+  // Catching up lowers the lag, down to the smallest delay seen.
+  stream->OnSegmentPublished(6, WallClock(15.5));
+  EXPECT_EQ(0, stream->lag_in_seconds());
+  stream->OnSegmentPublished(8, WallClock(18));
+  EXPECT_EQ(0.5, stream->lag_in_seconds());
+}
+
+TEST(LiveSchedulerTest, NotLaggingWhenDisabled) {
+  LiveScheduler scheduler;
+  std::shared_ptr<LiveStreamLag> stream = scheduler.AddStream("video", false);
+  stream->OnSegmentPublished(2, WallClock(2));
+  stream->OnSegmentPublished(4, WallClock(100));
+  EXPECT_FALSE(stream->lagging());
+  EXPECT_FALSE(scheduler.ShouldDegradeLowPriorityOutputs());
+}
+
+TEST(LiveSchedulerTest, LaggingUntilCaughtUpToHalfOfTheMaximumLag) {
+  LiveScheduler scheduler;
+  scheduler.Configure(kMaxLagInSeconds, true);
+  std::shared_ptr<LiveStreamLag> stream = scheduler.AddStream("video", false);
+  stream->OnSegmentPublished(2, WallClock(2));
+  stream->OnSegmentPublished(4, WallClock(8));
+  EXPECT_FALSE(stream->lagging());
+  stream->OnSegmentPublished(6, WallClock(11));
+  EXPECT_TRUE(stream->lagging());
+  EXPECT_TRUE(scheduler.ShouldDegradeLowPriorityOutputs());
+
+  stream->OnSegmentPublished(8, WallClock(11.5));
+  EXPECT_TRUE(stream->lagging());
+  stream->OnSegmentPublished(10, WallClock(11.9));
+  EXPECT_FALSE(stream->lagging());
+  EXPECT_FALSE(scheduler.ShouldDegradeLowPriorityOutputs());
+}
+
+TEST(LiveSchedulerTest, LowPriorityStreamsAreNotLagging) {
+  LiveScheduler scheduler;
+  scheduler.Configure(kMaxLagInSeconds, true);
+  std::shared_ptr<LiveStreamLag> stream =
+      scheduler.AddStream("trick_play", true);
+  stream->OnSegmentPublished(2, WallClock(2));
+  stream->OnSegmentPublished(4, WallClock(100));
+  EXPECT_LT(kMaxLagInSeconds, stream->lag_in_seconds());
+  EXPECT_FALSE(stream->lagging());
+  EXPECT_FALSE(scheduler.ShouldDegradeLowPriorityOutputs());
+}
+
+TEST(LiveSchedulerTest, DegradesOnlyIfEnabled) {
+  LiveScheduler scheduler;
+  scheduler.Configure(kMaxLagInSeconds, false);
+  std::shared_ptr<LiveStreamLag> stream = scheduler.AddStream("video", false);
+  stream->OnSegmentPublished(2, WallClock(2));
+  stream->OnSegmentPublished(4, WallClock(100));
+  EXPECT_TRUE(stream->lagging());
+  EXPECT_FALSE(scheduler.ShouldDegradeLowPriorityOutputs());
+}
+
+TEST(LiveSchedulerTest, RemovedStreamsAreNotLagging) {
+  LiveScheduler scheduler;
+  scheduler.Configure(kMaxLagInSeconds, true);
+  std::shared_ptr<LiveStreamLag> stream = scheduler.AddStream("video", false);
+  stream->OnSegmentPublished(2, WallClock(2));
+  stream->OnSegmentPublished(4, WallClock(100));
+  EXPECT_TRUE(scheduler.ShouldDegradeLowPriorityOutputs());
+  stream.reset();
+  EXPECT_FALSE(scheduler.ShouldDegradeLowPriorityOutputs());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -19,8 +19,14 @@
         'aes_decryptor.h',
         'aes_encryptor.cc',
         'aes_encryptor.h',
+        'aes_key_schedule_cache.cc',
+        'aes_key_schedule_cache.h',
         'aes_pattern_cryptor.cc',
         'aes_pattern_cryptor.h',
+        'aes_segment_encryptor.cc',
+        'aes_segment_encryptor.h',
+        'async_handler.cc',
+        'async_handler.h',
         'audio_stream_info.cc',
         'audio_stream_info.h',
         'audio_timestamp_helper.cc',
@@ -35,6 +41,8 @@
         'buffer_writer.h',
         'byte_queue.cc',
         'byte_queue.h',
+        'caching_key_source.cc',
+        'caching_key_source.h',
         'closure_thread.cc',
         'closure_thread.h',
         'common_pssh_generator.cc',
@@ -43,14 +51,19 @@
         'container_names.h',
         'decrypt_config.cc',
         'decrypt_config.h',
+        'deferred_key_source.cc',
+        'deferred_key_source.h',
         'decryptor_source.cc',
         'decryptor_source.h',
         'encryption_config.h',
         'fourccs.h',
+        'handler_counters.cc',
+        'handler_counters.h',
         'http_key_fetcher.cc',
         'http_key_fetcher.h',
         'id3_tag.cc',
         'id3_tag.h',
+        'inline_vector.h',
         'key_fetcher.cc',
         'key_fetcher.h',
         'key_source.cc',
@@ -58,6 +71,8 @@
         'language_utils.cc',
         'language_utils.h',
         'limits.h',
+        'live_scheduler.cc',
+        'live_scheduler.h',
         'macros.h',
         'media_handler.cc',
         'media_handler.h',
@@ -96,8 +111,16 @@
         'request_signer.h',
         'rsa_key.cc',
         'rsa_key.h',
+        'sample_buffer_pool.cc',
+        'sample_buffer_pool.h',
+        'stage_latency.cc',
+        'stage_latency.h',
         'stream_info.cc',
         'stream_info.h',
+        'stream_progress_tracker.cc',
+        'stream_progress_tracker.h',
+        'task_executor.cc',
+        'task_executor.h',
         'text_sample.cc',
         'text_sample.h',
         'text_stream_info.cc',
@@ -106,6 +129,8 @@
         'text_track_config.cc',
         'text_track_config.h',
         'timestamp.h',
+        'timestamp_rescaler.cc',
+        'timestamp_rescaler.h',
         'video_stream_info.cc',
         'video_stream_info.h',
         'video_util.cc',
@@ -116,9 +141,12 @@
         'widevine_pssh_generator.h'
       ],
       'dependencies': [
+        'key_cache_proto',
         'widevine_common_encryption_proto',
         'widevine_pssh_data_proto',
         '../../base/base.gyp:base',
+        '../../file/file.gyp:file',
+        '../../metrics/metrics.gyp:metrics',
         '../../packager.gyp:status',
         '../../third_party/boringssl/boringssl.gyp:boringssl',
         '../../third_party/curl/curl.gyp:libcurl',
@@ -127,6 +155,18 @@
         '../../version/version.gyp:version',
       ],
     },
+    {
+      'target_name': 'key_cache_proto',
+      'type': '<(component)',
+      'sources': ['key_cache.proto'],
+      'variables': {
+        'proto_in_dir': '.',
+        'proto_out_dir': 'packager/media/base',
+      },
+      'includes': [
+        '../../protoc.gypi',
+      ],
+    },
     {
       'target_name': 'widevine_pssh_data_proto',
       'type': '<(component)',
@@ -168,16 +208,26 @@
       'type': '<(gtest_target_type)',
       'sources': [
         'aes_cryptor_unittest.cc',
+        'aes_key_schedule_cache_unittest.cc',
         'aes_pattern_cryptor_unittest.cc',
+        'aes_segment_encryptor_unittest.cc',
+        'async_handler_unittest.cc',
         'audio_timestamp_helper_unittest.cc',
         'bit_reader_unittest.cc',
         'bit_writer_unittest.cc',
         'buffer_writer_unittest.cc',
+        'byte_queue_unittest.cc',
+        'caching_key_source_unittest.cc',
         'closure_thread_unittest.cc',
         'container_names_unittest.cc',
+        'handler_counters_unittest.cc',
         'decryptor_source_unittest.cc',
+        'deferred_key_source_unittest.cc',
         'http_key_fetcher_unittest.cc',
         'id3_tag_unittest.cc',
+        'inline_vector_unittest.cc',
+        'live_scheduler_unittest.cc',
+        'media_handler_unittest.cc',
         'muxer_util_unittest.cc',
         'offset_byte_queue_unittest.cc',
         'producer_consumer_queue_unittest.cc',
@@ -185,7 +235,11 @@
         'pssh_generator_unittest.cc',
         'raw_key_source_unittest.cc',
         'rsa_key_unittest.cc',
+        'sample_buffer_pool_unittest.cc',
         'status_test_util_unittest.cc',
+        'stream_progress_tracker_unittest.cc',
+        'task_executor_unittest.cc',
+        'timestamp_rescaler_unittest.cc',
         'test/fake_prng.cc',  # For rsa_key_unittest
         'test/fake_prng.h',   # For rsa_key_unittest
         'test/rsa_test_data.cc',  # For rsa_key_unittest
@@ -200,6 +254,7 @@
         '../../third_party/boringssl/boringssl.gyp:boringssl',
         '../test/media_test.gyp:media_test_support',
         'media_base',
+        'media_handler_test_base',
       ],
     },
   ],
@@ -6,10 +6,71 @@
 
 #include "packager/media/base/media_handler.h"
 
+#include "packager/metrics/trace_recorder.h"
+
 #include "packager/status_macros.h"
 
 namespace shaka {
 namespace media {
+namespace {
+
+// The free envelopes of the calling thread. An envelope may be released on
+// another thread than the one that allocated it, e.g. after going through an
+// AsyncHandler, in which case it joins the free list of the releasing thread.
+struct FreeStreamData {
+  FreeStreamData* next;
+};
+thread_local FreeStreamData* g_free_stream_data = nullptr;
+thread_local size_t g_num_free_stream_data = 0;
+// Set once the free list of the thread is released at thread exit, after
+// which envelopes go back to the heap directly.
+thread_local bool g_free_stream_data_released = false;
+
+// Releases the free list of the calling thread at thread exit.
+class FreeStreamDataReleaser {
+ public:
+  ~FreeStreamDataReleaser() {
+    while (g_free_stream_data) {
+      FreeStreamData* next = g_free_stream_data->next;
+      ::operator delete(g_free_stream_data);
+      g_free_stream_data = next;
+    }
+    g_num_free_stream_data = 0;
+    g_free_stream_data_released = true;
+  }
+};
+
+}  // namespace
+
+const size_t StreamData::kMaxPooledPerThread;
+
+void* StreamData::operator new(size_t size) {
+  static_assert(sizeof(StreamData) >= sizeof(FreeStreamData),
+                "StreamData envelopes are too small to be pooled.");
+  if (size != sizeof(StreamData) || !g_free_stream_data)
+    return ::operator new(size);
+  FreeStreamData* memory = g_free_stream_data;
+  g_free_stream_data = memory->next;
+  --g_num_free_stream_data;
+  return memory;
+}
+
+void StreamData::operator delete(void* memory, size_t size) {
+  if (!memory)
+    return;
+  if (size != sizeof(StreamData) || g_free_stream_data_released ||
+      g_num_free_stream_data == kMaxPooledPerThread) {
+    ::operator delete(memory);
+    return;
+  }
+  // Registers the release of the free list at thread exit.
+  thread_local FreeStreamDataReleaser releaser;
+  (void)releaser;
+  FreeStreamData* free_memory = static_cast<FreeStreamData*>(memory);
+  free_memory->next = g_free_stream_data;
+  g_free_stream_data = free_memory;
+  ++g_num_free_stream_data;
+}
 
 std::string StreamDataTypeToString(StreamDataType type) {
   switch (type) {
@@ -80,6 +141,21 @@ Status MediaHandler::Chain(
   return Status::OK;
 }
 
+void MediaHandler::CollectStats(std::set<const MediaHandler*>* visited,
+                                std::vector<HandlerStats>* stats) const {
+  if (!visited->insert(this).second)
+    return;
+  if (!name_.empty()) {
+    HandlerStats handler_stats;
+    handler_stats.name = name_;
+    counters_.GetStats(&handler_stats);
+    handler_stats.queued_bytes = GetQueuedBytes();
+    stats->push_back(handler_stats);
+  }
+  for (const auto& pair : output_handlers_)
+    pair.second.first->CollectStats(visited, stats);
+}
+
 Status MediaHandler::OnFlushRequest(size_t input_stream_index) {
   // The default implementation treats the output stream index to be identical
   // to the input stream index, which is true for most handlers.
@@ -99,7 +175,12 @@ Status MediaHandler::Dispatch(std::unique_ptr<StreamData> stream_data) const {
                   "No output handler exist at the specified index.");
   }
   stream_data->stream_index = handler_it->second.second;
-  return handler_it->second.first->Process(std::move(stream_data));
+  MediaHandler* handler = handler_it->second.first.get();
+  ScopedTraceStream trace_stream(handler->name());
+  if (!handler->counters_.Record(*stream_data))
+    return handler->Process(std::move(stream_data));
+  ScopedProcessTimer timer(&handler->counters_);
+  return handler->Process(std::move(stream_data));
 }
 
 Status MediaHandler::FlushDownstream(size_t output_stream_index) {
@@ -108,11 +189,13 @@ Status MediaHandler::FlushDownstream(size_t output_stream_index) {
     return Status(error::NOT_FOUND,
                   "No output handler exist at the specified index.");
   }
+  ScopedTraceStream trace_stream(handler_it->second.first->name());
   return handler_it->second.first->OnFlushRequest(handler_it->second.second);
 }
 
 Status MediaHandler::FlushAllDownstreams() {
   for (const auto& pair : output_handlers_) {
+    ScopedTraceStream trace_stream(pair.second.first->name());
     Status status = pair.second.first->OnFlushRequest(pair.second.second);
     if (!status.ok()) {
       return status;
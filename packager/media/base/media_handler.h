@@ -9,8 +9,12 @@
 
 #include <map>
 #include <memory>
+#include <set>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "packager/media/base/handler_counters.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/stream_info.h"
 #include "packager/media/base/text_sample.h"
@@ -54,9 +58,18 @@ struct CueEvent {
 
 struct SegmentInfo {
   bool is_subsegment = false;
+  // A low latency chunk is also a subsegment, which is written out as soon as
+  // it is complete instead of at the end of the segment.
+  bool is_chunk = false;
   bool is_encrypted = false;
   int64_t start_timestamp = -1;
   int64_t duration = 0;
+  // The wall clock time at which the first sample of the segment was read
+  // from the input, or a null time if it is not known.
+  base::Time arrival_time;
+  // The time spent encrypting the samples since the start of the segment,
+  // or waiting for them to be encrypted, if the stream is encrypted.
+  base::TimeDelta encryption_time;
   // This is only available if key rotation is enabled. Note that we may have
   // a |key_rotation_encryption_config| even if the segment is not encrypted,
   // which is the case for clear lead.
@@ -64,7 +77,16 @@ struct SegmentInfo {
 };
 
 // TODO(kqyang): Should we use protobuf?
+// StreamData envelopes are created for every message passed between handlers,
+// so they are recycled through a per thread free list instead of going
+// through the heap allocator each time.
 struct StreamData {
+  /// Maximum number of free envelopes cached per thread.
+  static const size_t kMaxPooledPerThread = 256;
+
+  static void* operator new(size_t size);
+  static void operator delete(void* memory, size_t size);
+
   size_t stream_index = static_cast<size_t>(-1);
   StreamDataType stream_data_type = StreamDataType::kUnknown;
 
@@ -174,6 +196,19 @@ class MediaHandler {
 
   static Status Chain(const std::vector<std::shared_ptr<MediaHandler>>& list);
 
+  /// Set the name of the handler in the statistics, which should be its type
+  /// followed by the label of its stream, e.g. "ChunkingHandler:input:video".
+  void set_name(const std::string& name) { name_ = name; }
+  const std::string& name() const { return name_; }
+
+  /// Collect the statistics of the handler and of its downstream handlers.
+  /// Only named handlers are reported. Can be called from any thread.
+  /// @param visited contains the handlers already visited, which are skipped.
+  /// @param stats contains the statistics collected so far on input, and gets
+  ///        the statistics of the newly visited handlers appended on output.
+  void CollectStats(std::set<const MediaHandler*>* visited,
+                    std::vector<HandlerStats>* stats) const;
+
  protected:
   /// Internal implementation of initialize. Note that it should only initialize
   /// the MediaHandler itself. Downstream handlers are handled in Initialize().
@@ -191,6 +226,10 @@ class MediaHandler {
   /// Validate if the stream at the specified index actually exists.
   virtual bool ValidateOutputStreamIndex(size_t stream_index) const;
 
+  /// @return The size of the media samples held by the handler, which is
+  ///         reported in its statistics. Can be called from any thread.
+  virtual uint64_t GetQueuedBytes() const { return 0; }
+
   /// Dispatch the stream data to downstream handlers. Note that
   /// stream_data.stream_index should be the output stream index.
   Status Dispatch(std::unique_ptr<StreamData> stream_data) const;
@@ -262,6 +301,9 @@ class MediaHandler {
   MediaHandler& operator=(const MediaHandler&) = delete;
 
   bool initialized_ = false;
+  std::string name_;
+  // Updated by the upstream handler when it dispatches to this handler.
+  HandlerCounters counters_;
   // Number of input streams.
   size_t num_input_streams_ = 0;
   // The next available output stream index, used by AddHandler.
@@ -0,0 +1,44 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/media_handler.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace shaka {
+namespace media {
+
+TEST(StreamDataTest, ReusesEnvelopes) {
+  StreamData* stream_data = new StreamData;
+  const uintptr_t address = reinterpret_cast<uintptr_t>(stream_data);
+  delete stream_data;
+
+  std::unique_ptr<StreamData> reused =
+      StreamData::FromSegmentInfo(0, std::make_shared<SegmentInfo>());
+  EXPECT_EQ(address, reinterpret_cast<uintptr_t>(reused.get()));
+  EXPECT_EQ(StreamDataType::kSegmentInfo, reused->stream_data_type);
+  EXPECT_TRUE(reused->segment_info);
+  EXPECT_FALSE(reused->media_sample);
+}
+
+TEST(StreamDataTest, ReleasesEnvelopesOfOtherThreads) {
+  const size_t kNumEnvelopes = 2 * StreamData::kMaxPooledPerThread;
+  std::vector<std::unique_ptr<StreamData>> envelopes;
+  for (size_t i = 0; i < kNumEnvelopes; ++i)
+    envelopes.emplace_back(new StreamData);
+
+  // The envelopes beyond the capacity of the free list of the releasing
+  // thread go back to the heap, and the others are freed at thread exit.
+  std::thread release_thread([&envelopes]() { envelopes.clear(); });
+  release_thread.join();
+  EXPECT_TRUE(envelopes.empty());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -8,6 +8,7 @@
 #define PACKAGER_MEDIA_BASE_MEDIA_PARSER_H_
 
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 #include "packager/base/callback.h"
@@ -76,6 +77,13 @@ class MediaParser {
   /// @return true if successful.
   virtual bool Parse(const uint8_t* buf, int size) WARN_UNUSED_RESULT = 0;
 
+  /// Only emit the samples of @a track_ids from now on, so that the parser
+  /// can skip the data of the other tracks rather than allocating their
+  /// samples. It may be called from the init callback. The samples of all the
+  /// tracks are emitted by default, and by parsers which do not support it.
+  /// @param track_ids contains the ids of the tracks to emit the samples of.
+  virtual void SelectTracks(const std::set<uint32_t>& track_ids) {}
+
  private:
   DISALLOW_COPY_AND_ASSIGN(MediaParser);
 };
@@ -10,6 +10,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/media/base/sample_buffer_pool.h"
 
 namespace shaka {
 namespace media {
@@ -26,8 +27,8 @@ MediaSample::MediaSample(const uint8_t* data,
 
   SetData(data, data_size);
   if (side_data) {
-    std::shared_ptr<uint8_t> shared_side_data(new uint8_t[side_data_size],
-                                              std::default_delete<uint8_t[]>());
+    std::shared_ptr<uint8_t> shared_side_data =
+        SampleBufferPool::GetDefault()->Allocate(side_data_size);
     memcpy(shared_side_data.get(), side_data, side_data_size);
     side_data_ = std::move(shared_side_data);
     side_data_size_ = side_data_size;
@@ -90,9 +91,12 @@ std::shared_ptr<MediaSample> MediaSample::Clone() const {
   new_media_sample->side_data_ = side_data_;
   new_media_sample->side_data_size_ = side_data_size_;
   new_media_sample->config_id_ = config_id_;
+  new_media_sample->nalu_layout_ = nalu_layout_;
+  new_media_sample->arrival_time_ = arrival_time_;
+  new_media_sample->skipped_frames_ = skipped_frames_;
   if (decrypt_config_) {
     new_media_sample->decrypt_config_.reset(new DecryptConfig(
-        decrypt_config_->key_id(), decrypt_config_->iv(),
+        decrypt_config_->shared_key_id(), decrypt_config_->iv(),
         decrypt_config_->subsamples(), decrypt_config_->protection_scheme(),
         decrypt_config_->crypt_byte_block(),
         decrypt_config_->skip_byte_block()));
@@ -104,11 +108,12 @@ void MediaSample::TransferData(std::shared_ptr<uint8_t> data,
                                size_t data_size) {
   data_ = std::move(data);
   data_size_ = data_size;
+  nalu_layout_.reset();
 }
 
 void MediaSample::SetData(const uint8_t* data, size_t data_size) {
-  std::shared_ptr<uint8_t> shared_data(new uint8_t[data_size],
-                                       std::default_delete<uint8_t[]>());
+  std::shared_ptr<uint8_t> shared_data =
+      SampleBufferPool::GetDefault()->Allocate(data_size);
   memcpy(shared_data.get(), data, data_size);
   TransferData(std::move(shared_data), data_size);
 }
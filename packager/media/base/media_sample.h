@@ -13,11 +13,22 @@
 #include <vector>
 
 #include "packager/base/logging.h"
+#include "packager/base/time/time.h"
 #include "packager/media/base/decrypt_config.h"
 
 namespace shaka {
 namespace media {
 
+/// Location of a NAL unit in the data of a NAL unit structured video sample.
+struct NaluLocation {
+  /// Offset of the NAL unit header from the start of the sample data, i.e.
+  /// after the NAL unit length field.
+  size_t offset = 0;
+  /// Size of the NAL unit, including the header, excluding the NAL unit
+  /// length field.
+  size_t size = 0;
+};
+
 /// Class to hold a media sample.
 class MediaSample {
  public:
@@ -68,6 +79,9 @@ class MediaSample {
   std::shared_ptr<MediaSample> Clone() const;
 
   /// Transfer data to this media sample. No data copying is involved.
+  /// Buffers allocated from SampleBufferPool::GetDefault() are recycled when
+  /// the last reference to them is dropped. The NAL unit layout, if any, is
+  /// reset as it may not apply to the new data.
   /// @param data points to the data to be transferred.
   /// @param data_size is the size of the data to be transferred.
   void TransferData(std::shared_ptr<uint8_t> data, size_t data_size);
@@ -124,6 +138,24 @@ class MediaSample {
     return data_size_;
   }
 
+  /// @return The sample data as a shared buffer, which allows it to be
+  ///         referenced beyond the lifetime of this sample without copying.
+  std::shared_ptr<const uint8_t> shared_data() const {
+    DCHECK(!end_of_stream());
+    return data_;
+  }
+
+  /// @return A pointer to the sample data that can be modified in place if
+  ///         the data is not shared with any other sample, i.e. this sample
+  ///         holds the only reference to it, NULL otherwise.
+  uint8_t* unique_writable_data() {
+    DCHECK(!end_of_stream());
+    if (!data_ || data_.use_count() != 1)
+      return nullptr;
+    // Sample buffers are always allocated as non-const.
+    return const_cast<uint8_t*>(data_.get());
+  }
+
   const uint8_t* side_data() const { return side_data_.get(); }
 
   size_t side_data_size() const { return side_data_size_; }
@@ -142,6 +174,21 @@ class MediaSample {
     decrypt_config_ = std::move(decrypt_config);
   }
 
+  /// @return The location of the NAL units in the sample data if it has been
+  ///         parsed by an earlier stage, e.g. to generate encryption
+  ///         subsamples, NULL otherwise. It allows later stages to skip
+  ///         parsing the NAL units again.
+  const std::vector<NaluLocation>* nalu_layout() const {
+    return nalu_layout_.get();
+  }
+
+  /// @param nalu_layout is the location of the NAL units in the sample data,
+  ///        in order. It must describe the current sample data.
+  void set_nalu_layout(
+      std::shared_ptr<const std::vector<NaluLocation>> nalu_layout) {
+    nalu_layout_ = std::move(nalu_layout);
+  }
+
   // If there's no data in this buffer, it represents end of stream.
   bool end_of_stream() const { return data_size_ == 0; }
 
@@ -150,6 +197,21 @@ class MediaSample {
     config_id_ = config_id;
   }
 
+  /// @return The wall clock time at which the sample was read from the
+  ///         input, or a null time if it is not known.
+  base::Time arrival_time() const { return arrival_time_; }
+  void set_arrival_time(base::Time arrival_time) {
+    arrival_time_ = arrival_time;
+  }
+
+  /// @return The number of frames following the sample which the demuxer
+  ///         skipped, e.g. for key frame only reads, and which the duration
+  ///         of the sample spans.
+  uint32_t skipped_frames() const { return skipped_frames_; }
+  void set_skipped_frames(uint32_t skipped_frames) {
+    skipped_frames_ = skipped_frames;
+  }
+
  protected:
   // Made it protected to disallow the constructor to be called directly.
   // Create a MediaSample. Buffer will be padded and aligned as necessary.
@@ -187,6 +249,14 @@ class MediaSample {
   // Decrypt configuration.
   std::unique_ptr<DecryptConfig> decrypt_config_;
 
+  // NAL unit layout of |data_|, shared between clones.
+  std::shared_ptr<const std::vector<NaluLocation>> nalu_layout_;
+
+  // Wall clock time at which the sample was read from the input.
+  base::Time arrival_time_;
+  // Number of frames following the sample which were not read.
+  uint32_t skipped_frames_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(MediaSample);
 };
 
@@ -8,8 +8,11 @@
 
 #include <algorithm>
 
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/stage_latency.h"
+#include "packager/media/base/stream_progress_tracker.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -19,6 +22,128 @@ const bool kInitialEncryptionInfo = true;
 const int64_t kStartTime = 0;
 }  // namespace
 
+// Records the latency of the live segments and chunks when they are written,
+// i.e. when the listener is notified, and when they are published, i.e. once
+// the wrapped listener returns. The manifests updated by an
+// AsyncMuxerListener are published when the update is queued. Also times the
+// muxing of the segments, which is passed on with OnSegmentStats().
+class Muxer::SegmentRecordingListener : public MuxerListener {
+ public:
+  SegmentRecordingListener(std::unique_ptr<MuxerListener> listener,
+                           const std::string& stream_label)
+      : listener_(std::move(listener)), stream_label_(stream_label) {}
+
+  // Set the segment or chunk being finalized.
+  void set_segment_info(const SegmentInfo& segment_info) {
+    arrival_time_ = segment_info.arrival_time;
+    encryption_time_ = segment_info.encryption_time;
+  }
+
+  void OnSampleAdded() { ++segment_stats_.num_samples; }
+
+  // Called around the calls to the muxer, which are timed, and whose writes
+  // are timed separately.
+  void StartMuxing() {
+    muxing_ = true;
+    muxing_start_time_ = base::TimeTicks::Now();
+    muxing_start_write_time_us_ = BufferWriter::GetThreadWriteTimeUs();
+  }
+  void EndMuxing() {
+    if (!muxing_)
+      return;
+    muxing_ = false;
+    const int64_t write_time_us =
+        BufferWriter::GetThreadWriteTimeUs() - muxing_start_write_time_us_;
+    const int64_t muxing_time_us =
+        (base::TimeTicks::Now() - muxing_start_time_).InMicroseconds();
+    segment_stats_.write_time_us += write_time_us;
+    segment_stats_.serialize_time_us +=
+        std::max(muxing_time_us - write_time_us, static_cast<int64_t>(0));
+  }
+
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override {
+    listener_->OnEncryptionInfoReady(is_initial_encryption_info,
+                                     protection_scheme, key_id, iv,
+                                     key_system_info);
+  }
+  void OnEncryptionStart() override { listener_->OnEncryptionStart(); }
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override {
+    listener_->OnMediaStart(muxer_options, stream_info, time_scale,
+                            container_type);
+  }
+  void OnSampleDurationReady(uint32_t sample_duration) override {
+    listener_->OnSampleDurationReady(sample_duration);
+  }
+  void OnMediaEnd(const MediaRanges& media_ranges,
+                  float duration_seconds) override {
+    listener_->OnMediaEnd(media_ranges, duration_seconds);
+  }
+  void OnNewSegment(const std::string& segment_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t segment_file_size) override {
+    RecordLatency(kSegmentWriteStage);
+    // The muxing of the segment ends here, and that of the next one starts.
+    const bool muxing = muxing_;
+    EndMuxing();
+    segment_stats_.encrypt_time_us = encryption_time_.InMicroseconds();
+    listener_->OnSegmentStats(segment_stats_);
+    segment_stats_ = SegmentStats();
+    listener_->OnNewSegment(segment_name, start_time, duration,
+                            segment_file_size);
+    RecordLatency(kManifestPublishStage);
+    if (muxing)
+      StartMuxing();
+  }
+  void OnNewChunk(const std::string& segment_name,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override {
+    RecordLatency(kSegmentWriteStage);
+    listener_->OnNewChunk(segment_name, start_time, duration,
+                          start_byte_offset, size);
+    RecordLatency(kManifestPublishStage);
+  }
+  void OnKeyFrame(int64_t timestamp,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override {
+    listener_->OnKeyFrame(timestamp, start_byte_offset, size);
+  }
+  void OnCueEvent(int64_t timestamp, const std::string& cue_data) override {
+    listener_->OnCueEvent(timestamp, cue_data);
+  }
+
+ private:
+  SegmentRecordingListener(const SegmentRecordingListener&) = delete;
+  SegmentRecordingListener& operator=(const SegmentRecordingListener&) =
+      delete;
+
+  // Only the live segments, which have a stream label, are timed.
+  void RecordLatency(const char* stage) {
+    if (!stream_label_.empty())
+      RecordStageLatency(stage, stream_label_, arrival_time_);
+  }
+
+  const std::unique_ptr<MuxerListener> listener_;
+  const std::string stream_label_;
+  base::Time arrival_time_;
+  base::TimeDelta encryption_time_;
+  SegmentStats segment_stats_;
+  // Whether a call to the muxer is being timed.
+  bool muxing_ = false;
+  base::TimeTicks muxing_start_time_;
+  int64_t muxing_start_write_time_us_ = 0;
+};
+
 Muxer::Muxer(const MuxerOptions& options) : options_(options) {
   // "$" is only allowed if the output file name is a template, which is used to
   // support one file per Representation per Period when there are Ad Cues.
@@ -33,6 +158,12 @@ void Muxer::Cancel() {
 }
 
 void Muxer::SetMuxerListener(std::unique_ptr<MuxerListener> muxer_listener) {
+  segment_listener_ = nullptr;
+  if (muxer_listener) {
+    segment_listener_ = new SegmentRecordingListener(
+        std::move(muxer_listener), options_.segment_template);
+    muxer_listener.reset(segment_listener_);
+  }
   muxer_listener_ = std::move(muxer_listener);
 }
 
@@ -46,6 +177,8 @@ Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
   switch (stream_data->stream_data_type) {
     case StreamDataType::kStreamInfo:
       streams_.push_back(std::move(stream_data->stream_info));
+      if (progress_listener_)
+        UpdateProgressDuration();
       return ReinitializeMuxer(kStartTime);
     case StreamDataType::kSegmentInfo: {
       const auto& segment_info = *stream_data->segment_info;
@@ -65,10 +198,31 @@ Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
           muxer_listener_->OnEncryptionStart();
         }
       }
-      return FinalizeSegment(stream_data->stream_index, segment_info);
+      if (!segment_listener_)
+        return FinalizeSegment(stream_data->stream_index, segment_info);
+      segment_listener_->set_segment_info(segment_info);
+      segment_listener_->StartMuxing();
+      status = FinalizeSegment(stream_data->stream_index, segment_info);
+      segment_listener_->EndMuxing();
+      return status;
     }
     case StreamDataType::kMediaSample:
-      return AddSample(stream_data->stream_index, *stream_data->media_sample);
+      if (progress_tracker_) {
+        const MediaSample& sample = *stream_data->media_sample;
+        const double time_scale =
+            streams_[stream_data->stream_index]->time_scale();
+        progress_tracker_->OnSample(
+            sample.data_size(), sample.pts() / time_scale,
+            (sample.pts() + sample.duration()) / time_scale,
+            base::TimeTicks::Now());
+      }
+      if (!segment_listener_)
+        return AddSample(stream_data->stream_index, *stream_data->media_sample);
+      segment_listener_->OnSampleAdded();
+      segment_listener_->StartMuxing();
+      status = AddSample(stream_data->stream_index, *stream_data->media_sample);
+      segment_listener_->EndMuxing();
+      return status;
     case StreamDataType::kCueEvent:
       if (muxer_listener_) {
         const int64_t time_scale =
@@ -96,7 +250,37 @@ Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
 }
 
 Status Muxer::OnFlushRequest(size_t input_stream_index) {
-  return Finalize();
+  Status status;
+  if (segment_listener_) {
+    // The last segment is finalized with the muxer.
+    segment_listener_->StartMuxing();
+    status = Finalize();
+    segment_listener_->EndMuxing();
+  } else {
+    status = Finalize();
+  }
+  if (status.ok() && progress_tracker_)
+    progress_tracker_->OnComplete(base::TimeTicks::Now());
+  return status;
+}
+
+void Muxer::UpdateProgressDuration() {
+  DCHECK(progress_listener_);
+  if (!progress_tracker_) {
+    progress_tracker_.reset(
+        new StreamProgressTracker(name(), progress_listener_.get()));
+  }
+  // The output is complete once its longest stream is.
+  double duration_in_seconds = 0;
+  for (const auto& stream : streams_) {
+    if (stream->time_scale() > 0) {
+      duration_in_seconds =
+          std::max(duration_in_seconds,
+                   static_cast<double>(stream->duration()) /
+                       stream->time_scale());
+    }
+  }
+  progress_tracker_->set_media_duration(duration_in_seconds);
 }
 
 Status Muxer::ReinitializeMuxer(int64_t timestamp) {
@@ -23,6 +23,7 @@ namespace shaka {
 namespace media {
 
 class MediaSample;
+class StreamProgressTracker;
 
 /// Muxer is responsible for taking elementary stream samples and producing
 /// media containers. An optional KeySource can be provided to Muxer
@@ -36,11 +37,19 @@ class Muxer : public MediaHandler {
   /// status of type CANCELLED.
   void Cancel();
 
-  /// Set a MuxerListener event handler for this object.
+  /// Set a MuxerListener event handler for this object. The latency of the
+  /// live segments and chunks, from the arrival of their input, is recorded
+  /// when the listener is notified, see RecordStageLatency(). The listener
+  /// is also passed the statistics of the segments, see
+  /// MuxerListener::OnSegmentStats().
   /// @param muxer_listener should not be NULL.
   void SetMuxerListener(std::unique_ptr<MuxerListener> muxer_listener);
 
-  /// Set a ProgressListener event handler for this object.
+  /// Set a ProgressListener event handler for this object. It is passed the
+  /// throughput of the samples muxed, see
+  /// ProgressListener::OnStreamProgress(), and, by the MP4 and WebM muxers,
+  /// the fraction of the media muxed. Must be called before the muxer
+  /// receives its streams.
   /// @param progress_listener should not be NULL.
   void SetProgressListener(std::unique_ptr<ProgressListener> progress_listener);
 
@@ -75,6 +84,8 @@ class Muxer : public MediaHandler {
   Muxer(const Muxer&) = delete;
   Muxer& operator=(const Muxer&) = delete;
 
+  class SegmentRecordingListener;
+
   // Initialize the muxer. InitializeMuxer may be called multiple times with
   // |options()| updated between calls, which is used to support separate file
   // per Representation per Period for Ad Insertion.
@@ -93,6 +104,10 @@ class Muxer : public MediaHandler {
       size_t stream_id,
       const SegmentInfo& segment_info) = 0;
 
+  // Create the progress tracker, or update the duration of the media it
+  // expects with the streams received so far.
+  void UpdateProgressDuration();
+
   // Re-initialize Muxer. Could be called on StreamInfo or CueEvent.
   // |timestamp| may be used to set the output file name.
   Status ReinitializeMuxer(int64_t timestamp);
@@ -104,7 +119,10 @@ class Muxer : public MediaHandler {
   bool cancelled_ = false;
 
   std::unique_ptr<MuxerListener> muxer_listener_;
+  // Wraps the listener of the muxer. It is owned by |muxer_listener_|.
+  SegmentRecordingListener* segment_listener_ = nullptr;
   std::unique_ptr<ProgressListener> progress_listener_;
+  std::unique_ptr<StreamProgressTracker> progress_tracker_;
   // An external injected clock, can be NULL.
   base::Clock* clock_ = nullptr;
 
@@ -28,6 +28,11 @@ struct MuxerOptions {
   // compensate for negative timestamps in the input.
   uint32_t transport_stream_timestamp_offset_ms = 0;
 
+  /// WebM single segment output only: write the output in a single pass,
+  /// reserving the space for the Cues in front of the Clusters, instead of
+  /// writing to a temporary file which is then copied to the output.
+  bool webm_single_pass_single_segment = false;
+
   /// Output file name. If segment_template is not specified, the Muxer
   /// generates this single output file with all segments concatenated;
   /// Otherwise, it specifies the init segment name.
@@ -39,12 +44,44 @@ struct MuxerOptions {
   /// Optional.
   std::string segment_template;
 
+  /// Segment duration in seconds. Used to estimate the number of segments
+  /// before the media is segmented. Zero if unknown.
+  double segment_duration_in_seconds = 0;
+
   /// Specify temporary directory for intermediate files.
   std::string temp_dir;
 
   /// User-specified bit rate for the media stream. If zero, the muxer will
   /// attempt to estimate.
   uint32_t bandwidth = 0;
+
+  /// Set if the muxer only muxes a time slice of the stream, e.g. the slices
+  /// being muxed in parallel, see PackagingParams.num_vod_time_slices, or a
+  /// segment packaged just in time, see PackagingParams.jit_packaging. Only
+  /// supported by the MP4 muxer with a segment template, and by the MPEG-2 TS
+  /// muxer, whose segments need nothing more. Only the MP4 muxer of the first
+  /// slice writes the init segment, without the media duration, which is not
+  /// known to any slice.
+  bool time_slice = false;
+
+  /// Index of the first segment of the muxer, for $Number$ in
+  /// segment_template. Non-zero for the time slices after the first one, and
+  /// for a live session resumed from a LiveCheckpoint.
+  uint32_t first_segment_index = 0;
+
+  /// Number the segments from the position of the first one in the input
+  /// timeline, i.e. its start time divided by segment_duration_in_seconds,
+  /// instead of from first_segment_index, so that muxers started at different
+  /// times of a live input number the segments alike. Requires segments which
+  /// start at the segment boundaries, see
+  /// PackagingParams.deterministic_output.
+  bool segment_number_from_timeline = false;
+
+  /// The time shard of the stream the muxer muxes, and the number of shards
+  /// of the stream, if the stream is packaged in shards on many machines, see
+  /// PackagingParams.num_vod_time_shards. Zero shards otherwise.
+  uint32_t time_shard_index = 0;
+  uint32_t num_time_shards = 0;
 };
 
 }  // namespace media
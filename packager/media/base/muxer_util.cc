@@ -8,6 +8,7 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -15,6 +16,8 @@
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_split.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/muxer_options.h"
 #include "packager/media/base/video_stream_info.h"
 
 namespace shaka {
@@ -37,6 +40,12 @@ Status ValidateFormatTag(const std::string& format_tag) {
       error::INVALID_ARGUMENT,
       "Format tag should follow this prototype: %0[width]d if exist.");
 }
+
+// Headroom over the estimated segment size, for the container overhead and the
+// variation of the bit rate, so a segment rarely outgrows its buffer.
+const double kSegmentSizeHeadroom = 1.25;
+// Upper bound of the estimated segment size.
+const size_t kMaxEstimatedSegmentSize = 64 * 1024 * 1024;
 }  // namespace
 
 namespace media {
@@ -163,5 +172,43 @@ std::string GetSegmentName(const std::string& segment_template,
   return segment_name;
 }
 
+size_t EstimateSegmentSize(const MuxerOptions& options,
+                           const std::vector<const StreamInfo*>& streams) {
+  if (options.segment_duration_in_seconds <= 0)
+    return 0;
+
+  uint64_t bandwidth = options.bandwidth;
+  if (bandwidth == 0) {
+    // Only audio streams carry their bit rate.
+    for (const StreamInfo* stream : streams) {
+      if (stream->stream_type() != kStreamAudio)
+        return 0;
+      const AudioStreamInfo* audio_stream_info =
+          static_cast<const AudioStreamInfo*>(stream);
+      const uint32_t bitrate = std::max(audio_stream_info->avg_bitrate(),
+                                        audio_stream_info->max_bitrate());
+      if (bitrate == 0)
+        return 0;
+      bandwidth += bitrate;
+    }
+  }
+
+  const double segment_size = bandwidth / 8.0 *
+                              options.segment_duration_in_seconds *
+                              kSegmentSizeHeadroom;
+  return static_cast<size_t>(
+      std::min(segment_size, static_cast<double>(kMaxEstimatedSegmentSize)));
+}
+
+uint32_t GetTimelineSegmentIndex(double segment_duration_in_seconds,
+                                 int64_t start_timestamp,
+                                 uint32_t time_scale) {
+  const int64_t segment_duration =
+      static_cast<int64_t>(segment_duration_in_seconds * time_scale);
+  if (segment_duration <= 0 || start_timestamp <= 0)
+    return 0;
+  return static_cast<uint32_t>(start_timestamp / segment_duration);
+}
+
 }  // namespace media
 }  // namespace shaka
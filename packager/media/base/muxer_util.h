@@ -11,11 +11,14 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include "packager/status.h"
 
 namespace shaka {
 namespace media {
 
+struct MuxerOptions;
 class StreamInfo;
 
 /// Validates the segment template against segment URL construction rule
@@ -37,6 +40,26 @@ std::string GetSegmentName(const std::string& segment_template,
                            uint32_t segment_index,
                            uint32_t bandwidth);
 
+/// Estimate the size of a media segment from the bit rate and the segment
+/// duration, so the segment buffers can be allocated up front.
+/// @param options provides the segment duration. Its bandwidth, if specified,
+///        takes precedence over the bit rates of @a streams.
+/// @param streams are the streams multiplexed in the segment.
+/// @return The estimated segment size in bytes, or 0 if it is not known.
+size_t EstimateSegmentSize(const MuxerOptions& options,
+                           const std::vector<const StreamInfo*>& streams);
+
+/// Get the index of a segment in the input timeline, for
+/// MuxerOptions::segment_number_from_timeline.
+/// @param segment_duration_in_seconds is the target segment duration.
+/// @param start_timestamp is the start time of the segment.
+/// @param time_scale is the time scale of @a start_timestamp.
+/// @return The number of segments of the target duration before
+///         @a start_timestamp, as counted by the ChunkingHandler.
+uint32_t GetTimelineSegmentIndex(double segment_duration_in_seconds,
+                                 int64_t start_timestamp,
+                                 uint32_t time_scale);
+
 }  // namespace media
 }  // namespace shaka
 
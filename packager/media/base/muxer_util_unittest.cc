@@ -6,7 +6,10 @@
 
 #include <gtest/gtest.h>
 
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/video_stream_info.h"
 
 namespace shaka {
 namespace media {
@@ -153,5 +156,41 @@ TEST(MuxerUtilTest, GetSegmentNameLargeTime) {
                            kBandwidth));
 }
 
+TEST(MuxerUtilTest, EstimateSegmentSize) {
+  const uint32_t kMaxBitrate = 160000;
+  const uint32_t kAverageBitrate = 128000;
+  AudioStreamInfo audio_stream_info(
+      1, 44100, 0, kCodecAAC, "mp4a.40.2", nullptr, 0, 16, 2, 44100, 0, 0,
+      kMaxBitrate, kAverageBitrate, "eng", false);
+  VideoStreamInfo video_stream_info;
+
+  MuxerOptions options;
+  // The segment duration is not known.
+  EXPECT_EQ(0u, EstimateSegmentSize(options, {&audio_stream_info}));
+
+  options.segment_duration_in_seconds = 2;
+  // 160 kbps for 2 seconds, with 25% headroom.
+  EXPECT_EQ(50000u, EstimateSegmentSize(options, {&audio_stream_info}));
+  // The bit rate of the video stream is not known.
+  EXPECT_EQ(0u, EstimateSegmentSize(options, {&video_stream_info}));
+  EXPECT_EQ(0u, EstimateSegmentSize(
+                    options, {&audio_stream_info, &video_stream_info}));
+
+  options.bandwidth = 2000000;
+  EXPECT_EQ(625000u, EstimateSegmentSize(
+                         options, {&audio_stream_info, &video_stream_info}));
+}
+
+TEST(MuxerUtilTest, GetTimelineSegmentIndex) {
+  const uint32_t kTimeScale = 90000;
+  // The segment duration is not known.
+  EXPECT_EQ(0u, GetTimelineSegmentIndex(0, 10 * kTimeScale, kTimeScale));
+  EXPECT_EQ(0u, GetTimelineSegmentIndex(2, -90000, kTimeScale));
+  EXPECT_EQ(0u, GetTimelineSegmentIndex(2, 0, kTimeScale));
+  EXPECT_EQ(5u, GetTimelineSegmentIndex(2, 10 * kTimeScale, kTimeScale));
+  // A segment starting a little after its boundary, e.g. at a key frame.
+  EXPECT_EQ(5u, GetTimelineSegmentIndex(2, 10 * kTimeScale + 3000, kTimeScale));
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -48,6 +48,13 @@ void OffsetByteQueue::PeekAt(int64_t offset, const uint8_t** buf, int* size) {
   *size = tail() - offset;
 }
 
+void OffsetByteQueue::PeekAt(int64_t offset, uint8_t** buf, int* size) {
+  const uint8_t* data;
+  PeekAt(offset, &data, size);
+  // The data is part of the storage of |queue_|, which is writable.
+  *buf = const_cast<uint8_t*>(data);
+}
+
 bool OffsetByteQueue::Trim(int64_t max_offset) {
   if (max_offset < head_) return true;
   if (max_offset > tail()) {
@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 
+#include <memory>
+
 #include "packager/media/base/byte_queue.h"
 
 namespace shaka {
@@ -37,6 +39,16 @@ class OffsetByteQueue {
   /// a null @a buf and a @a size of zero.
   void PeekAt(int64_t offset, const uint8_t** buf, int* size);
 
+  /// Same as above, but for buffered data to modify in place.
+  void PeekAt(int64_t offset, uint8_t** buf, int* size);
+
+  /// Get a reference to the buffered data at @a buf, as returned by Peek() or
+  /// PeekAt(), which remains valid after the data is trimmed.
+  /// @see ByteQueue::Share().
+  std::shared_ptr<uint8_t> Share(const uint8_t* buf) const {
+    return queue_.Share(buf);
+  }
+
   /// Mark the bytes up to (but not including) @a max_offset as ready for
   /// deletion. This is relatively inexpensive, but will not necessarily reduce
   /// the resident buffer size right away (or ever).
@@ -7,7 +7,10 @@
 #ifndef PACKAGER_MEDIA_BASE_PRODUCER_CONSUMER_QUEUE_H_
 #define PACKAGER_MEDIA_BASE_PRODUCER_CONSUMER_QUEUE_H_
 
+#include <algorithm>
 #include <deque>
+#include <iterator>
+#include <vector>
 
 #include "packager/base/strings/stringprintf.h"
 #include "packager/base/synchronization/condition_variable.h"
@@ -59,6 +62,33 @@ class ProducerConsumerQueue {
   ///         TIME_OUT if times out, OK otherwise.
   Status Pop(T* element, int64_t timeout_ms);
 
+  /// Push elements to the back of the queue, in order, taking the lock once
+  /// per batch of elements that fit in the queue rather than once per element.
+  /// If the queue reaches its capacity limit, block until spare capacity is
+  /// available or time out or stopped.
+  /// @param elements refers the elements to be pushed.
+  /// @param timeout_ms indicates timeout in milliseconds. A value of zero means
+  ///        return immediately. A negative value means waiting indefinitely.
+  /// @return OK if all the elements were pushed successfully, STOPPED if Stop
+  ///         has been called, TIME_OUT if times out. The leading elements may
+  ///         have been pushed on error.
+  Status PushMany(const std::vector<T>& elements, int64_t timeout_ms);
+
+  /// Pop up to @a max_elements elements from the front of the queue at once.
+  /// If the queue is empty, block for an element to be available to be
+  /// consumed or time out or stopped. Does not wait for more elements once
+  /// some are available.
+  /// @param max_elements is the maximum number of elements popped, which must
+  ///        be greater than zero.
+  /// @param[out] elements receives the popped elements, in order.
+  /// @param timeout_ms indicates timeout in milliseconds. A value of zero means
+  ///        return immediately. A negative value means waiting indefinitely.
+  /// @return STOPPED if Stop has been called and the queue is completely empty,
+  ///         TIME_OUT if times out, OK otherwise.
+  Status PopMany(size_t max_elements,
+                 std::vector<T>* elements,
+                 int64_t timeout_ms);
+
   /// Peek at the element at the specified position from the queue. If the
   /// element is not available yet, block until it to be available or time out
   /// or stopped.
@@ -121,6 +151,13 @@ class ProducerConsumerQueue {
   // Move head_pos_ to center on pos.
   void SlideHeadOnCenter(size_t pos);
 
+  // Wait on |cv| until signaled, or until |timeout_ms| since |timer| was
+  // created elapses. A negative |timeout_ms| means waiting indefinitely.
+  // @return false if timed out without waiting.
+  bool WaitWithTimeout(base::ConditionVariable* cv,
+                       const base::ElapsedTimer& timer,
+                       int64_t timeout_ms);
+
   const size_t capacity_;  // Maximum number of elements; zero means unlimited.
   mutable base::Lock lock_;  // Lock protecting all other variables below.
   size_t head_pos_;          // Head position.
@@ -298,6 +335,106 @@ Status ProducerConsumerQueue<T>::Peek(size_t pos,
   return Status::OK;
 }
 
+template <class T>
+Status ProducerConsumerQueue<T>::PushMany(const std::vector<T>& elements,
+                                          int64_t timeout_ms) {
+  base::AutoLock l(lock_);
+
+  // Check for queue shutdown.
+  if (stop_requested_)
+    return Status(error::STOPPED, "");
+
+  base::ElapsedTimer timer;
+
+  auto iter = elements.begin();
+  while (iter != elements.end()) {
+    while (capacity_ && q_.size() == capacity_) {
+      if (!WaitWithTimeout(&not_full_cv_, timer, timeout_ms))
+        return Status(error::TIME_OUT, "Time out on pushing.");
+      // Re-check for queue shutdown after waking from Wait.
+      if (stop_requested_)
+        return Status(error::STOPPED, "");
+    }
+
+    size_t num_elements = elements.end() - iter;
+    if (capacity_)
+      num_elements = std::min(num_elements, capacity_ - q_.size());
+
+    // Signal consumers to proceed if we are going to create some elements.
+    // There may be enough elements for several of them.
+    if (q_.empty())
+      not_empty_cv_.Broadcast();
+    new_element_cv_.Broadcast();
+
+    q_.insert(q_.end(), iter, iter + num_elements);
+    iter += num_elements;
+  }
+
+  // Signal other producers if there is capacity left.
+  if (capacity_ && q_.size() < capacity_)
+    not_full_cv_.Signal();
+  return Status::OK;
+}
+
+template <class T>
+Status ProducerConsumerQueue<T>::PopMany(size_t max_elements,
+                                         std::vector<T>* elements,
+                                         int64_t timeout_ms) {
+  DCHECK_GT(max_elements, 0u);
+  DCHECK(elements);
+  elements->clear();
+
+  base::AutoLock l(lock_);
+
+  base::ElapsedTimer timer;
+
+  while (q_.empty()) {
+    if (stop_requested_)
+      return Status(error::STOPPED, "");
+    if (!WaitWithTimeout(&not_empty_cv_, timer, timeout_ms))
+      return Status(error::TIME_OUT, "Time out on popping.");
+  }
+
+  // Signal producers to proceed if we are going to create some capacity.
+  // There may be enough capacity for several of them.
+  if (q_.size() == capacity_)
+    not_full_cv_.Broadcast();
+
+  const size_t num_elements = std::min(max_elements, q_.size());
+  elements->assign(std::make_move_iterator(q_.begin()),
+                   std::make_move_iterator(q_.begin() + num_elements));
+  q_.erase(q_.begin(), q_.begin() + num_elements);
+  head_pos_ += num_elements;
+
+  // Signal other consumers if we have more elements.
+  if (!q_.empty())
+    not_empty_cv_.Signal();
+  return Status::OK;
+}
+
+template <class T>
+bool ProducerConsumerQueue<T>::WaitWithTimeout(base::ConditionVariable* cv,
+                                               const base::ElapsedTimer& timer,
+                                               int64_t timeout_ms) {
+  lock_.AssertAcquired();
+
+  if (timeout_ms < 0) {
+    // Wait forever, or until Stop.
+    cv->Wait();
+    return true;
+  }
+  const base::TimeDelta timeout_delta =
+      base::TimeDelta::FromMilliseconds(timeout_ms);
+  const base::TimeDelta elapsed = timer.Elapsed();
+  if (elapsed >= timeout_delta) {
+    // We're through waiting.
+    return false;
+  }
+  // Wait with timeout, or until Stop.
+  cv->TimedWait(timeout_delta - elapsed);
+  return true;
+}
+
 template <class T>
 void ProducerConsumerQueue<T>::SlideHeadOnCenter(size_t pos) {
   lock_.AssertAcquired();
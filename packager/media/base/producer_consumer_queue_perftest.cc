@@ -0,0 +1,96 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/media/base/producer_consumer_queue.h"
+#include "packager/media/test/perf_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const size_t kCapacity = 64;
+// Elements popped per measured run.
+const size_t kElementsPerRun = 1024;
+
+class ProducerThread : public base::SimpleThread {
+ public:
+  ProducerThread(ProducerConsumerQueue<int>* queue, size_t batch_size)
+      : base::SimpleThread("ProducerThread"),
+        queue_(queue),
+        batch_size_(batch_size) {}
+
+  void Run() override {
+    // Push elements to the queue until stopped.
+    if (batch_size_ == 1) {
+      while (queue_->Push(0, kInfiniteTimeout).ok()) {
+      }
+    } else {
+      const std::vector<int> batch(batch_size_, 0);
+      while (queue_->PushMany(batch, kInfiniteTimeout).ok()) {
+      }
+    }
+  }
+
+ private:
+  ProducerConsumerQueue<int>* queue_;
+  const size_t batch_size_;
+};
+
+// Measures the rate at which a consumer pops |kElementsPerRun| elements pushed
+// by |num_producers| threads, |batch_size| elements at a time on both sides.
+void MeasureTransferRate(size_t num_producers, size_t batch_size) {
+  ProducerConsumerQueue<int> queue(kCapacity);
+  std::vector<std::unique_ptr<ProducerThread>> producers;
+  for (size_t i = 0; i < num_producers; ++i) {
+    producers.emplace_back(new ProducerThread(&queue, batch_size));
+    producers.back()->Start();
+  }
+
+  const std::string trace = base::StringPrintf(
+      "%zu_producers_batch_%zu", num_producers, batch_size);
+  int element;
+  std::vector<int> elements;
+  MeasureOperationRate("producer_consumer_queue", trace, [&]() {
+    size_t popped = 0;
+    while (popped < kElementsPerRun) {
+      if (batch_size == 1) {
+        ASSERT_TRUE(queue.Pop(&element, kInfiniteTimeout).ok());
+        ++popped;
+      } else {
+        ASSERT_TRUE(
+            queue.PopMany(batch_size, &elements, kInfiniteTimeout).ok());
+        popped += elements.size();
+      }
+    }
+  });
+
+  queue.Stop();
+  for (auto& producer : producers)
+    producer->Join();
+}
+
+}  // namespace
+
+TEST(ProducerConsumerQueuePerfTest, SingleProducer) {
+  MeasureTransferRate(1, 1);
+  MeasureTransferRate(1, 16);
+}
+
+TEST(ProducerConsumerQueuePerfTest, ContendedProducers) {
+  MeasureTransferRate(4, 1);
+  MeasureTransferRate(4, 16);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,6 +6,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "packager/base/bind.h"
 #include "packager/base/synchronization/waitable_event.h"
 #include "packager/media/base/closure_thread.h"
@@ -138,6 +140,58 @@ TEST(ProducerConsumerQueueTest, PeekWithTimeout) {
   }
 }
 
+TEST(ProducerConsumerQueueTest, PushManyPopMany) {
+  ProducerConsumerQueue<size_t> queue(kCapacity);
+  std::vector<size_t> elements;
+  for (size_t i = 0; i < kCapacity; ++i)
+    elements.push_back(i);
+  ASSERT_OK(queue.PushMany(elements, kInfiniteTimeout));
+  EXPECT_EQ(kCapacity, queue.Size());
+  EXPECT_EQ(kCapacity - 1, queue.TailPos());
+
+  ASSERT_OK(queue.PopMany(3, &elements, kInfiniteTimeout));
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2}), elements);
+  EXPECT_EQ(3u, queue.HeadPos());
+
+  // Fewer elements than requested are popped if that is all there is.
+  ASSERT_OK(queue.PopMany(kCapacity, &elements, kInfiniteTimeout));
+  ASSERT_EQ(kCapacity - 3, elements.size());
+  EXPECT_EQ(3u, elements.front());
+  EXPECT_EQ(kCapacity - 1, elements.back());
+  EXPECT_TRUE(queue.Empty());
+  EXPECT_EQ(kCapacity, queue.HeadPos());
+}
+
+TEST(ProducerConsumerQueueTest, PushManyWithTimeout) {
+  ProducerConsumerQueue<size_t> queue(kCapacity);
+  // One more element than the capacity: the leading elements are pushed.
+  const std::vector<size_t> elements(kCapacity + 1, 1u);
+
+  base::ElapsedTimer timer;
+  ASSERT_EQ(error::TIME_OUT,
+            queue.PushMany(elements, kTimeout).error_code());
+  EXPECT_GE(timer.Elapsed().InMilliseconds(), kTimeout);
+  EXPECT_EQ(kCapacity, queue.Size());
+}
+
+TEST(ProducerConsumerQueueTest, PopManyWithTimeout) {
+  ProducerConsumerQueue<size_t> queue(kCapacity);
+  std::vector<size_t> elements;
+
+  base::ElapsedTimer timer;
+  ASSERT_EQ(error::TIME_OUT,
+            queue.PopMany(kCapacity, &elements, kTimeout).error_code());
+  EXPECT_GE(timer.Elapsed().InMilliseconds(), kTimeout);
+  EXPECT_TRUE(elements.empty());
+
+  queue.Stop();
+  EXPECT_EQ(error::STOPPED,
+            queue.PushMany(std::vector<size_t>(1, 0u), kInfiniteTimeout)
+                .error_code());
+  EXPECT_EQ(error::STOPPED,
+            queue.PopMany(kCapacity, &elements, kInfiniteTimeout).error_code());
+}
+
 TEST(ProducerConsumerQueueTest, CheckStop) {
   std::unique_ptr<base::ElapsedTimer> timer;
   ProducerConsumerQueue<int> queue(kUnlimitedCapacity);
@@ -230,6 +284,21 @@ TEST_F(MultiThreadProducerConsumerQueueTest, Pop) {
   ASSERT_EQ(error::STOPPED, queue_.Pop(&val, kInfiniteTimeout).error_code());
 }
 
+TEST_F(MultiThreadProducerConsumerQueueTest, PopMany) {
+  // The elements are popped in order across batches, with no batch larger
+  // than requested.
+  std::vector<size_t> elements;
+  size_t i = 0;
+  while (i < kCapacity * 3) {
+    ASSERT_OK(queue_.PopMany(kCapacity / 2, &elements, kInfiniteTimeout));
+    ASSERT_FALSE(elements.empty());
+    ASSERT_LE(elements.size(), kCapacity / 2);
+    for (size_t element : elements)
+      EXPECT_EQ(i++, element);
+  }
+  queue_.Stop();
+}
+
 TEST_F(MultiThreadProducerConsumerQueueTest, Peek) {
   const size_t kPositionOne = 25u;
   const size_t kPositionTwo = 88u;
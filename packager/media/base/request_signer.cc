@@ -38,8 +38,9 @@ AesRequestSigner* AesRequestSigner::CreateSigner(
 
 bool AesRequestSigner::GenerateSignature(const std::string& message,
                                          std::string* signature) {
-  aes_cbc_encryptor_->Crypt(base::SHA1HashString(message), signature);
-  return true;
+  const std::string message_digest = base::SHA1HashString(message);
+  base::AutoLock scoped_lock(lock_);
+  return aes_cbc_encryptor_->Crypt(message_digest, signature);
 }
 
 RsaRequestSigner::RsaRequestSigner(
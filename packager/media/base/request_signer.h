@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
 
 namespace shaka {
 namespace media {
@@ -19,12 +20,14 @@ namespace media {
 class AesCbcEncryptor;
 class RsaPrivateKey;
 
-/// Abstract class used for signature generation.
+/// Abstract class used for signature generation. The signing key is set up
+/// once on creation. Implementations should be thread safe, so requests from
+/// concurrent key requests can be signed at the same time.
 class RequestSigner {
  public:
   virtual ~RequestSigner();
 
-  /// Generate signature for the input message.
+  /// Generate signature for the input message. Can be called concurrently.
   /// @param signature should not be NULL.
   /// @return true on success, false otherwise.
   virtual bool GenerateSignature(const std::string& message,
@@ -60,6 +63,8 @@ class AesRequestSigner : public RequestSigner {
   AesRequestSigner(const std::string& signer_name,
                    std::unique_ptr<AesCbcEncryptor> encryptor);
 
+  // Protects |aes_cbc_encryptor_|, which keeps state across Crypt calls.
+  base::Lock lock_;
   std::unique_ptr<AesCbcEncryptor> aes_cbc_encryptor_;
 
   DISALLOW_COPY_AND_ASSIGN(AesRequestSigner);
@@ -83,6 +88,8 @@ class RsaRequestSigner : public RequestSigner {
   RsaRequestSigner(const std::string& signer_name,
                    std::unique_ptr<RsaPrivateKey> rsa_private_key);
 
+  // The key is parsed and checked once on creation. Signing with it is thread
+  // safe.
   std::unique_ptr<RsaPrivateKey> rsa_private_key_;
 
   DISALLOW_COPY_AND_ASSIGN(RsaRequestSigner);
@@ -35,7 +35,7 @@ class RsaPrivateKey {
   bool Decrypt(const std::string& encrypted_message,
                std::string* decrypted_message);
 
-  /// Generate RSASSA-PSS signature.
+  /// Generate RSASSA-PSS signature. This is thread safe.
   /// @param signature must not be NULL.
   /// @return true if successful, false otherwise.
   bool GenerateSignature(const std::string& message, std::string* signature);
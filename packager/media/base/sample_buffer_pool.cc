@@ -0,0 +1,162 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/sample_buffer_pool.h"
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/cpu_affinity.h"
+#include "packager/metrics/huge_page_allocator.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Size classes: the smaller ones fit typical audio packets, the larger ones
+// fit video frames from low bitrate to 4K key frames.
+const size_t kSizeClasses[] = {
+    1 << 10, 4 << 10, 16 << 10, 64 << 10, 256 << 10, 1 << 20, 4 << 20,
+};
+const size_t kNumSizeClasses = arraysize(kSizeClasses);
+const size_t kNotPooled = kNumSizeClasses;
+
+// Maximum number of bytes cached by the default pool, and by each of the
+// pools of the NUMA nodes.
+const size_t kDefaultMaxCachedBytes = 64 << 20;
+// Maximum number of NUMA nodes with a pool of their own.
+const int kMaxNumaNodes = 64;
+
+size_t GetSizeClass(size_t size) {
+  for (size_t i = 0; i < kNumSizeClasses; ++i) {
+    if (size <= kSizeClasses[i])
+      return i;
+  }
+  return kNotPooled;
+}
+
+}  // namespace
+
+class SampleBufferPool::FreeLists
+    : public std::enable_shared_from_this<SampleBufferPool::FreeLists> {
+ public:
+  explicit FreeLists(size_t max_cached_bytes)
+      : max_cached_bytes_(max_cached_bytes), free_buffers_(kNumSizeClasses) {}
+
+  std::shared_ptr<uint8_t> Allocate(size_t size, AllocatorStats::Arena arena) {
+    AllocatorStats* allocator_stats = AllocatorStats::GetInstance();
+    const size_t size_class = GetSizeClass(size);
+    // Only the buffers of the largest size class, and the larger ones, are
+    // allocated on huge pages, if enabled, as they fill at least one.
+    HugePageAllocator* huge_page_allocator = HugePageAllocator::GetInstance();
+    // Empty buffers are common for metadata-only samples and not worth
+    // wasting a pooled buffer on.
+    if (size == 0 || size_class == kNotPooled) {
+      allocator_stats->Allocate(arena, size);
+      HugePageAllocator::Buffer buffer = huge_page_allocator->Allocate(size);
+      const HugePageAllocator::Deleter deleter = buffer.get_deleter();
+      return std::shared_ptr<uint8_t>(
+          buffer.release(),
+          [allocator_stats, arena, size, deleter](uint8_t* released_buffer) {
+            allocator_stats->Release(arena, size);
+            deleter(released_buffer);
+          });
+    }
+
+    HugePageAllocator::Buffer buffer;
+    {
+      base::AutoLock auto_lock(lock_);
+      std::vector<HugePageAllocator::Buffer>& buffers =
+          free_buffers_[size_class];
+      if (!buffers.empty()) {
+        buffer = std::move(buffers.back());
+        buffers.pop_back();
+        cached_bytes_ -= kSizeClasses[size_class];
+      }
+    }
+    if (!buffer)
+      buffer = huge_page_allocator->Allocate(kSizeClasses[size_class]);
+    allocator_stats->Allocate(arena, kSizeClasses[size_class]);
+
+    std::shared_ptr<FreeLists> self = shared_from_this();
+    const HugePageAllocator::Deleter deleter = buffer.get_deleter();
+    return std::shared_ptr<uint8_t>(
+        buffer.release(), [self, allocator_stats, arena, size_class,
+                           deleter](uint8_t* released_buffer) {
+          allocator_stats->Release(arena, kSizeClasses[size_class]);
+          self->Release(HugePageAllocator::Buffer(released_buffer, deleter),
+                        size_class);
+        });
+  }
+
+  size_t cached_bytes() const {
+    base::AutoLock auto_lock(lock_);
+    return cached_bytes_;
+  }
+
+ private:
+  void Release(HugePageAllocator::Buffer buffer, size_t size_class) {
+    DCHECK_LT(size_class, kNumSizeClasses);
+    base::AutoLock auto_lock(lock_);
+    if (cached_bytes_ + kSizeClasses[size_class] <= max_cached_bytes_) {
+      free_buffers_[size_class].push_back(std::move(buffer));
+      cached_bytes_ += kSizeClasses[size_class];
+    }
+  }
+
+  const size_t max_cached_bytes_;
+  mutable base::Lock lock_;
+  size_t cached_bytes_ = 0;
+  // Free buffers indexed by size class.
+  std::vector<std::vector<HugePageAllocator::Buffer>> free_buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(FreeLists);
+};
+
+SampleBufferPool::SampleBufferPool(size_t max_cached_bytes)
+    : free_lists_(std::make_shared<FreeLists>(max_cached_bytes)) {}
+
+SampleBufferPool::~SampleBufferPool() {}
+
+std::shared_ptr<uint8_t> SampleBufferPool::Allocate(
+    size_t size,
+    AllocatorStats::Arena arena) {
+  return free_lists_->Allocate(size, arena);
+}
+
+size_t SampleBufferPool::cached_bytes() const {
+  return free_lists_->cached_bytes();
+}
+
+// static
+SampleBufferPool* SampleBufferPool::GetDefault() {
+  const int node = GetCurrentThreadNumaNode();
+  if (node < 0 || node >= kMaxNumaNodes) {
+    static SampleBufferPool* default_pool =
+        new SampleBufferPool(kDefaultMaxCachedBytes);
+    return default_pool;
+  }
+
+  static std::atomic<SampleBufferPool*> node_pools[kMaxNumaNodes];
+  SampleBufferPool* pool = node_pools[node].load(std::memory_order_acquire);
+  if (pool)
+    return pool;
+  std::unique_ptr<SampleBufferPool> new_pool(
+      new SampleBufferPool(kDefaultMaxCachedBytes));
+  if (node_pools[node].compare_exchange_strong(pool, new_pool.get(),
+                                               std::memory_order_acq_rel)) {
+    return new_pool.release();
+  }
+  // Another thread created it first.
+  return pool;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,61 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_SAMPLE_BUFFER_POOL_H_
+#define PACKAGER_MEDIA_BASE_SAMPLE_BUFFER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "packager/metrics/allocator_stats.h"
+
+namespace shaka {
+namespace media {
+
+/// A thread safe pool of sample buffers. Buffers are grouped in size classes
+/// tuned for audio packets and video frames. A buffer is returned to the pool
+/// when the last reference to it is dropped, so that it can be reused by a
+/// later sample of a similar size without going through the heap allocator.
+/// Buffers larger than the largest size class are allocated directly.
+class SampleBufferPool {
+ public:
+  /// @param max_cached_bytes is the maximum number of bytes held by the free
+  ///        buffers in the pool. Buffers released beyond this limit are freed.
+  explicit SampleBufferPool(size_t max_cached_bytes);
+  ~SampleBufferPool();
+
+  /// @param arena is the arena the buffer is accounted to while in use.
+  /// @return A buffer of at least @a size bytes. The content of the buffer is
+  ///         not initialized. The buffer may outlive the pool.
+  std::shared_ptr<uint8_t> Allocate(
+      size_t size,
+      AllocatorStats::Arena arena = AllocatorStats::kMediaSamples);
+
+  /// @return The number of bytes held by the free buffers in the pool.
+  size_t cached_bytes() const;
+
+  /// @return The pool used by MediaSample. It is never destroyed. Threads
+  ///         pinned to the CPUs of a NUMA node, see SetCurrentThreadCpus(),
+  ///         share a pool of the node, so that the buffers they recycle stay
+  ///         in the memory of the node.
+  static SampleBufferPool* GetDefault();
+
+ private:
+  SampleBufferPool(const SampleBufferPool&) = delete;
+  SampleBufferPool& operator=(const SampleBufferPool&) = delete;
+
+  class FreeLists;
+  // Shared with the deleters of the allocated buffers, so buffers can be
+  // released after the pool is destroyed.
+  std::shared_ptr<FreeLists> free_lists_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_SAMPLE_BUFFER_POOL_H_
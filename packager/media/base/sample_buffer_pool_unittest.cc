@@ -0,0 +1,76 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/sample_buffer_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace shaka {
+namespace media {
+namespace {
+const size_t kMaxCachedBytes = 64 << 10;
+}  // namespace
+
+TEST(SampleBufferPoolTest, RecyclesReleasedBuffers) {
+  SampleBufferPool pool(kMaxCachedBytes);
+  std::shared_ptr<uint8_t> buffer = pool.Allocate(1000);
+  ASSERT_TRUE(buffer);
+  const uint8_t* address = buffer.get();
+  EXPECT_EQ(0u, pool.cached_bytes());
+
+  buffer.reset();
+  EXPECT_LT(0u, pool.cached_bytes());
+
+  // A buffer of a similar size reuses the released buffer.
+  buffer = pool.Allocate(900);
+  EXPECT_EQ(address, buffer.get());
+  EXPECT_EQ(0u, pool.cached_bytes());
+}
+
+TEST(SampleBufferPoolTest, DifferentSizeClassesAreNotShared) {
+  SampleBufferPool pool(kMaxCachedBytes);
+  std::shared_ptr<uint8_t> small_buffer = pool.Allocate(100);
+  small_buffer.reset();
+  const size_t small_buffer_cached_bytes = pool.cached_bytes();
+
+  std::shared_ptr<uint8_t> large_buffer = pool.Allocate(10000);
+  ASSERT_TRUE(large_buffer);
+  // The small buffer remains in the pool.
+  EXPECT_EQ(small_buffer_cached_bytes, pool.cached_bytes());
+}
+
+TEST(SampleBufferPoolTest, RespectsMaxCachedBytes) {
+  SampleBufferPool pool(kMaxCachedBytes);
+  std::vector<std::shared_ptr<uint8_t>> buffers;
+  for (int i = 0; i < 10; ++i)
+    buffers.push_back(pool.Allocate(16 << 10));
+  buffers.clear();
+  EXPECT_LE(pool.cached_bytes(), kMaxCachedBytes);
+}
+
+TEST(SampleBufferPoolTest, LargeBuffersAreNotPooled) {
+  SampleBufferPool pool(kMaxCachedBytes);
+  std::shared_ptr<uint8_t> buffer = pool.Allocate(32 << 20);
+  ASSERT_TRUE(buffer);
+  buffer.reset();
+  EXPECT_EQ(0u, pool.cached_bytes());
+}
+
+TEST(SampleBufferPoolTest, BufferOutlivesPool) {
+  std::shared_ptr<uint8_t> buffer;
+  {
+    SampleBufferPool pool(kMaxCachedBytes);
+    buffer = pool.Allocate(1000);
+  }
+  ASSERT_TRUE(buffer);
+  buffer.get()[999] = 1;
+  buffer.reset();
+}
+
+}  // namespace media
+}  // namespace shaka
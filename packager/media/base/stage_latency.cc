@@ -0,0 +1,37 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/stage_latency.h"
+
+#include <algorithm>
+
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace media {
+
+const char kDemuxStage[] = "demux";
+const char kChunkStage[] = "chunk";
+const char kSegmentWriteStage[] = "segment_write";
+const char kManifestPublishStage[] = "manifest_publish";
+
+void RecordStageLatency(const char* stage,
+                        const std::string& stream,
+                        base::Time arrival_time) {
+  if (arrival_time.is_null())
+    return;
+  // The clock may step backwards, which is not a latency.
+  const base::TimeDelta latency =
+      std::max(base::Time::Now() - arrival_time, base::TimeDelta());
+  Metrics::GetInstance()->ObserveLatency(
+      "packager_latency_seconds",
+      "Time from the arrival of the input to the end of each stage of the "
+      "pipeline.",
+      {{"stage", stage}, {"stream", stream}}, latency);
+}
+
+}  // namespace media
+}  // namespace shaka
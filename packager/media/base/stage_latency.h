@@ -0,0 +1,35 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_STAGE_LATENCY_H_
+#define PACKAGER_MEDIA_BASE_STAGE_LATENCY_H_
+
+#include <string>
+
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace media {
+
+/// The stages of a live pipeline whose latency is measured from the arrival
+/// of the input, see RecordStageLatency().
+extern const char kDemuxStage[];
+extern const char kChunkStage[];
+extern const char kSegmentWriteStage[];
+extern const char kManifestPublishStage[];
+
+/// Record in the packager_latency_seconds histogram the time elapsed since
+/// @a arrival_time, when the data read from the input at that time reaches
+/// @a stage. Nothing is recorded if @a arrival_time is null.
+/// @param stream identifies the stream, e.g. its input or output.
+void RecordStageLatency(const char* stage,
+                        const std::string& stream,
+                        base::Time arrival_time);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_STAGE_LATENCY_H_
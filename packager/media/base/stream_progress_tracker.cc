@@ -0,0 +1,81 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/stream_progress_tracker.h"
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/media/event/progress_listener.h"
+
+namespace shaka {
+namespace media {
+
+StreamProgressTracker::StreamProgressTracker(
+    const std::string& name,
+    ProgressListener* progress_listener)
+    : progress_listener_(progress_listener) {
+  DCHECK(progress_listener_);
+  progress_.name = name;
+}
+
+void StreamProgressTracker::OnSample(uint64_t size,
+                                     double start_seconds,
+                                     double end_seconds,
+                                     base::TimeTicks now) {
+  if (!started_) {
+    started_ = true;
+    first_start_seconds_ = start_seconds;
+    latest_end_seconds_ = end_seconds;
+    start_time_ = now;
+    last_report_time_ = now;
+  }
+  progress_.bytes_processed += size;
+  // The samples are in decoding order, so the end of the latest one is not
+  // necessarily the latest end.
+  latest_end_seconds_ = std::max(latest_end_seconds_, end_seconds);
+
+  if (now - last_report_time_ >=
+      base::TimeDelta::FromMilliseconds(kReportIntervalMs)) {
+    Report(now);
+  }
+}
+
+void StreamProgressTracker::OnComplete(base::TimeTicks now) {
+  if (progress_.complete)
+    return;
+  progress_.complete = true;
+  if (!started_)
+    start_time_ = now;
+  Report(now);
+}
+
+void StreamProgressTracker::Report(base::TimeTicks now) {
+  last_report_time_ = now;
+  progress_.media_seconds_processed =
+      std::max(latest_end_seconds_ - first_start_seconds_, 0.0);
+  progress_.elapsed_seconds = (now - start_time_).InSecondsF();
+  progress_.realtime_factor =
+      progress_.elapsed_seconds > 0
+          ? progress_.media_seconds_processed / progress_.elapsed_seconds
+          : 0;
+  if (progress_.complete) {
+    progress_.eta_seconds = 0;
+  } else if (progress_.media_duration_seconds > 0 &&
+             progress_.realtime_factor > 0) {
+    progress_.eta_seconds =
+        std::max(progress_.media_duration_seconds -
+                     progress_.media_seconds_processed,
+                 0.0) /
+        progress_.realtime_factor;
+  } else {
+    progress_.eta_seconds = -1;
+  }
+  progress_listener_->OnStreamProgress(progress_);
+}
+
+}  // namespace media
+}  // namespace shaka
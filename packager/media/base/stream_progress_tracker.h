@@ -0,0 +1,72 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_STREAM_PROGRESS_TRACKER_H_
+#define PACKAGER_MEDIA_BASE_STREAM_PROGRESS_TRACKER_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/base/time/time.h"
+#include "packager/media/public/stream_progress.h"
+
+namespace shaka {
+namespace media {
+
+class ProgressListener;
+
+/// Measures the throughput of the samples of a stream, and reports it to a
+/// ProgressListener with ProgressListener::OnStreamProgress() at most once
+/// per report interval, and when the stream is complete.
+class StreamProgressTracker {
+ public:
+  /// Interval between the progress reports.
+  static const int64_t kReportIntervalMs = 1000;
+
+  /// @param name identifies the stream in the reports.
+  /// @param progress_listener receives the reports. It must outlive the
+  ///        tracker.
+  StreamProgressTracker(const std::string& name,
+                        ProgressListener* progress_listener);
+
+  /// Set the duration of the media, if it is known, from which the time to
+  /// completion is estimated.
+  void set_media_duration(double media_duration_seconds) {
+    progress_.media_duration_seconds = media_duration_seconds;
+  }
+
+  /// Account a sample processed at @a now.
+  /// @param size is the size of the sample, in bytes.
+  /// @param start_seconds and @a end_seconds are the start and the end of
+  ///        the sample, in seconds.
+  void OnSample(uint64_t size,
+                double start_seconds,
+                double end_seconds,
+                base::TimeTicks now);
+
+  /// Report the stream complete at @a now.
+  void OnComplete(base::TimeTicks now);
+
+ private:
+  StreamProgressTracker(const StreamProgressTracker&) = delete;
+  StreamProgressTracker& operator=(const StreamProgressTracker&) = delete;
+
+  void Report(base::TimeTicks now);
+
+  ProgressListener* const progress_listener_;
+  StreamProgress progress_;
+  bool started_ = false;
+  double first_start_seconds_ = 0;
+  double latest_end_seconds_ = 0;
+  base::TimeTicks start_time_;
+  base::TimeTicks last_report_time_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_STREAM_PROGRESS_TRACKER_H_
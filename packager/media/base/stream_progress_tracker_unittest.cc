@@ -0,0 +1,93 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/stream_progress_tracker.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/media/event/progress_listener.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kName[] = "Muxer:output.mp4";
+const uint64_t kSampleSize = 1000;
+const double kSampleDurationSeconds = 0.5;
+
+class FakeProgressListener : public ProgressListener {
+ public:
+  void OnProgress(double progress) override {}
+  void OnStreamProgress(const StreamProgress& progress) override {
+    reports.push_back(progress);
+  }
+
+  std::vector<StreamProgress> reports;
+};
+
+base::TimeTicks SecondsAfterStart(double seconds) {
+  return base::TimeTicks() + base::TimeDelta::FromSecondsD(seconds);
+}
+
+}  // namespace
+
+class StreamProgressTrackerTest : public ::testing::Test {
+ protected:
+  // Process a sample starting at |start_seconds| at |wall_seconds|.
+  void ProcessSample(double start_seconds, double wall_seconds) {
+    tracker_.OnSample(kSampleSize, start_seconds,
+                      start_seconds + kSampleDurationSeconds,
+                      SecondsAfterStart(wall_seconds));
+  }
+
+  FakeProgressListener listener_;
+  StreamProgressTracker tracker_{kName, &listener_};
+};
+
+TEST_F(StreamProgressTrackerTest, ReportsThroughputAndEta) {
+  tracker_.set_media_duration(10);
+  ProcessSample(0, 0);
+  ProcessSample(0.5, 0.5);
+  EXPECT_TRUE(listener_.reports.empty());
+
+  // Two seconds of media in one second.
+  ProcessSample(1, 0.75);
+  ProcessSample(1.5, 1);
+  ASSERT_EQ(1u, listener_.reports.size());
+  const StreamProgress& progress = listener_.reports[0];
+  EXPECT_EQ(kName, progress.name);
+  EXPECT_EQ(4 * kSampleSize, progress.bytes_processed);
+  EXPECT_DOUBLE_EQ(2, progress.media_seconds_processed);
+  EXPECT_DOUBLE_EQ(10, progress.media_duration_seconds);
+  EXPECT_DOUBLE_EQ(1, progress.elapsed_seconds);
+  EXPECT_DOUBLE_EQ(2, progress.realtime_factor);
+  EXPECT_DOUBLE_EQ(4, progress.eta_seconds);
+  EXPECT_FALSE(progress.complete);
+}
+
+TEST_F(StreamProgressTrackerTest, NoEtaWithoutDuration) {
+  ProcessSample(0, 0);
+  ProcessSample(0.5, 1);
+  ASSERT_EQ(1u, listener_.reports.size());
+  EXPECT_DOUBLE_EQ(1, listener_.reports[0].realtime_factor);
+  EXPECT_LT(listener_.reports[0].eta_seconds, 0);
+}
+
+TEST_F(StreamProgressTrackerTest, ReportsCompletionOnce) {
+  tracker_.set_media_duration(10);
+  ProcessSample(0, 0);
+  tracker_.OnComplete(SecondsAfterStart(0.25));
+  tracker_.OnComplete(SecondsAfterStart(0.5));
+  ASSERT_EQ(1u, listener_.reports.size());
+  EXPECT_TRUE(listener_.reports[0].complete);
+  EXPECT_DOUBLE_EQ(0, listener_.reports[0].eta_seconds);
+  EXPECT_DOUBLE_EQ(2, listener_.reports[0].realtime_factor);
+}
+
+}  // namespace media
+}  // namespace shaka
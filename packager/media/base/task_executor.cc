@@ -0,0 +1,85 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/task_executor.h"
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "packager/base/logging.h"
+
+DEFINE_int32(task_executor_threads,
+             0,
+             "Number of threads running the background tasks of all the "
+             "streams, e.g. sample encryption and manifest updates. 0 means "
+             "the number of CPUs.");
+
+namespace shaka {
+namespace media {
+
+TaskExecutor::TaskExecutor(size_t num_threads, const std::string& name_prefix)
+    : task_available_(&lock_) {
+  DCHECK_GT(num_threads, 0u);
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(new base::DelegateSimpleThread(this, name_prefix));
+    threads_.back()->Start();
+  }
+}
+
+TaskExecutor::~TaskExecutor() {
+  {
+    base::AutoLock auto_lock(lock_);
+    shutting_down_ = true;
+    task_available_.Broadcast();
+  }
+  for (auto& thread : threads_)
+    thread->Join();
+}
+
+TaskExecutor* TaskExecutor::GetInstance() {
+  // Leaked, so the threads outlive the objects destroyed at exit.
+  static TaskExecutor* task_executor = new TaskExecutor(
+      FLAGS_task_executor_threads > 0
+          ? FLAGS_task_executor_threads
+          : std::max(1u, std::thread::hardware_concurrency()),
+      "TaskExecutor");
+  return task_executor;
+}
+
+void TaskExecutor::PostTask(Priority priority, const base::Closure& task) {
+  DCHECK_LT(priority, kNumPriorities);
+  base::AutoLock auto_lock(lock_);
+  tasks_[priority].push_back(task);
+  ++num_tasks_;
+  task_available_.Signal();
+}
+
+void TaskExecutor::Run() {
+  while (true) {
+    base::Closure task;
+    {
+      base::AutoLock auto_lock(lock_);
+      while (num_tasks_ == 0 && !shutting_down_)
+        task_available_.Wait();
+      if (num_tasks_ == 0)
+        return;
+      for (std::deque<base::Closure>& tasks : tasks_) {
+        if (!tasks.empty()) {
+          task = tasks.front();
+          tasks.pop_front();
+          break;
+        }
+      }
+      --num_tasks_;
+    }
+    task.Run();
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
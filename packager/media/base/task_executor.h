@@ -0,0 +1,83 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_TASK_EXECUTOR_H_
+#define PACKAGER_MEDIA_BASE_TASK_EXECUTOR_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/callback.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/simple_thread.h"
+
+namespace shaka {
+namespace media {
+
+/// A pool of a fixed number of threads running the short background tasks of
+/// all the streams, e.g. sample encryption and manifest updates, so the number
+/// of threads does not grow with the number of streams. The pending tasks of
+/// a higher priority run first; tasks of the same priority run in the order
+/// they are posted. Tasks should not block indefinitely, and in particular
+/// must not wait for other tasks of the executor. Long running loops, e.g.
+/// the key production of WidevineKeySource, keep a ClosureThread of their own.
+/// This class is thread safe.
+class TaskExecutor : public base::DelegateSimpleThread::Delegate {
+ public:
+  /// The priorities of the tasks, highest first.
+  enum Priority {
+    /// Tasks on the path of the samples of the live streams lagging behind
+    /// real time, see LiveScheduler.
+    kLaggingMediaPriority,
+    /// Tasks on the path of the samples, e.g. encryption.
+    kMediaPriority,
+    /// Manifest and playlist updates.
+    kManifestPriority,
+    /// Tasks nothing waits for, e.g. deleting old segments.
+    kHousekeepingPriority,
+    kNumPriorities,
+  };
+
+  /// @param num_threads is the number of threads, which must be at least 1.
+  /// @param name_prefix is the prefix of the thread names.
+  TaskExecutor(size_t num_threads, const std::string& name_prefix);
+
+  /// Runs the tasks already posted, then joins the threads.
+  ~TaskExecutor() override;
+
+  /// @return the process wide executor, with --task_executor_threads threads.
+  static TaskExecutor* GetInstance();
+
+  /// Post a task to run on one of the threads.
+  void PostTask(Priority priority, const base::Closure& task);
+
+ private:
+  TaskExecutor(const TaskExecutor&) = delete;
+  TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+  // base::DelegateSimpleThread::Delegate implementation, which runs the tasks
+  // until the executor is destroyed.
+  void Run() override;
+
+  base::Lock lock_;
+  // Signaled when a task is posted, or on destruction.
+  base::ConditionVariable task_available_;
+  // The following are protected by |lock_|.
+  // The pending tasks, by priority.
+  std::deque<base::Closure> tasks_[kNumPriorities];
+  size_t num_tasks_ = 0;
+  bool shutting_down_ = false;
+
+  std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_TASK_EXECUTOR_H_
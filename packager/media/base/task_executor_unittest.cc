@@ -0,0 +1,72 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/task_executor.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/base/synchronization/waitable_event.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+void AppendValue(base::Lock* lock, std::vector<int>* values, int value) {
+  base::AutoLock auto_lock(*lock);
+  values->push_back(value);
+}
+
+void WaitForEvent(base::WaitableEvent* event) {
+  event->Wait();
+}
+
+}  // namespace
+
+TEST(TaskExecutorTest, RunsTasksInOrder) {
+  base::Lock lock;
+  std::vector<int> values;
+  {
+    TaskExecutor executor(1, "TaskExecutorTest");
+    for (int i = 0; i < 100; ++i) {
+      executor.PostTask(TaskExecutor::kManifestPriority,
+                        base::Bind(&AppendValue, &lock, &values, i));
+    }
+    // The destructor runs the tasks posted.
+  }
+  ASSERT_EQ(100u, values.size());
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(i, values[i]);
+}
+
+TEST(TaskExecutorTest, RunsHigherPriorityTasksFirst) {
+  base::WaitableEvent event(base::WaitableEvent::ResetPolicy::MANUAL,
+                            base::WaitableEvent::InitialState::NOT_SIGNALED);
+  base::Lock lock;
+  std::vector<int> values;
+  {
+    TaskExecutor executor(1, "TaskExecutorTest");
+    // Keep the only thread busy, so the next tasks are queued.
+    executor.PostTask(TaskExecutor::kMediaPriority,
+                      base::Bind(&WaitForEvent, &event));
+    executor.PostTask(TaskExecutor::kHousekeepingPriority,
+                      base::Bind(&AppendValue, &lock, &values, 3));
+    executor.PostTask(TaskExecutor::kManifestPriority,
+                      base::Bind(&AppendValue, &lock, &values, 2));
+    executor.PostTask(TaskExecutor::kMediaPriority,
+                      base::Bind(&AppendValue, &lock, &values, 1));
+    executor.PostTask(TaskExecutor::kManifestPriority,
+                      base::Bind(&AppendValue, &lock, &values, 22));
+    event.Signal();
+  }
+  EXPECT_EQ(std::vector<int>({1, 2, 22, 3}), values);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,33 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/timestamp_rescaler.h"
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+TimestampRescaler::TimestampRescaler(uint32_t old_timescale,
+                                     uint32_t new_timescale) {
+  if (old_timescale == 0) {
+    LOG(WARNING) << "Invalid timescale 0.";
+    return;
+  }
+  uint32_t a = old_timescale;
+  uint32_t b = new_timescale;
+  while (b != 0) {
+    const uint32_t r = a % b;
+    a = b;
+    b = r;
+  }
+  // |a| is the greatest common divisor of the timescales.
+  numerator_ = new_timescale / a;
+  denominator_ = old_timescale / a;
+}
+
+}  // namespace media
+}  // namespace shaka
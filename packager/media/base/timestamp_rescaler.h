@@ -0,0 +1,54 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_TIMESTAMP_RESCALER_H_
+#define PACKAGER_MEDIA_BASE_TIMESTAMP_RESCALER_H_
+
+#include <stdint.h>
+
+namespace shaka {
+namespace media {
+
+/// Converts timestamps and durations from one timescale to another with
+/// integer arithmetic. Unlike a conversion through a floating point scale,
+/// the result is exact however large the timestamp, e.g. on streams running
+/// for days. The ratio of the timescales is reduced once, so a conversion is
+/// a multiplication, plus a division unless the new timescale is a multiple of
+/// the old one, e.g. 48kHz or 90kHz from milliseconds.
+class TimestampRescaler {
+ public:
+  /// Creates an identity rescaler.
+  TimestampRescaler() = default;
+
+  /// @param old_timescale is the timescale of the timestamps to convert. The
+  ///        rescaler is an identity one if it is 0, i.e. invalid.
+  /// @param new_timescale is the timescale to convert them to.
+  TimestampRescaler(uint32_t old_timescale, uint32_t new_timescale);
+
+  /// @return @a timestamp in the new timescale, rounded toward zero.
+  int64_t Rescale(int64_t timestamp) const {
+    if (denominator_ == 1)
+      return timestamp * numerator_;
+    // Split the division, so that the multiplications cannot overflow unless
+    // the result does.
+    const int64_t quotient = timestamp / denominator_;
+    const int64_t remainder = timestamp % denominator_;
+    const int64_t fraction = static_cast<int64_t>(
+        static_cast<uint64_t>(remainder < 0 ? -remainder : remainder) *
+        numerator_ / denominator_);
+    return quotient * numerator_ + (remainder < 0 ? -fraction : fraction);
+  }
+
+ private:
+  // The ratio of the new timescale to the old one, in lowest terms.
+  int64_t numerator_ = 1;
+  int64_t denominator_ = 1;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_TIMESTAMP_RESCALER_H_
@@ -0,0 +1,45 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/timestamp_rescaler.h"
+
+#include <gtest/gtest.h>
+
+namespace shaka {
+namespace media {
+
+TEST(TimestampRescalerTest, Identity) {
+  EXPECT_EQ(12345, TimestampRescaler().Rescale(12345));
+  EXPECT_EQ(12345, TimestampRescaler(90000, 90000).Rescale(12345));
+}
+
+TEST(TimestampRescalerTest, MultipleTimescale) {
+  const TimestampRescaler rescaler(1000, 90000);
+  EXPECT_EQ(90000, rescaler.Rescale(1000));
+  EXPECT_EQ(-180, rescaler.Rescale(-2));
+}
+
+TEST(TimestampRescalerTest, RoundsTowardZero) {
+  const TimestampRescaler rescaler(44100, 90000);
+  // 1024 * 90000 / 44100 = 2089.79...
+  EXPECT_EQ(2089, rescaler.Rescale(1024));
+  EXPECT_EQ(-2089, rescaler.Rescale(-1024));
+  EXPECT_EQ(90000, rescaler.Rescale(44100));
+}
+
+TEST(TimestampRescalerTest, ExactForLargeTimestamps) {
+  // A week in a 10MHz timescale.
+  const int64_t kTimestamp = 7LL * 24 * 3600 * 10000000 + 1;
+  EXPECT_EQ(kTimestamp * 9 / 1000,
+            TimestampRescaler(10000000, 90000).Rescale(kTimestamp));
+
+  const TimestampRescaler rescaler(0xffffffff, 0xfffffffe);
+  EXPECT_EQ(0xfffffffe, rescaler.Rescale(0xffffffff));
+  EXPECT_EQ(0xfffffffeLL * 3, rescaler.Rescale(0xffffffffLL * 3));
+}
+
+}  // namespace media
+}  // namespace shaka
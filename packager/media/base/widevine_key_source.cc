@@ -8,6 +8,8 @@
 
 #include <gflags/gflags.h>
 
+#include <algorithm>
+
 #include "packager/base/base64.h"
 #include "packager/base/bind.h"
 #include "packager/base/strings/string_number_conversions.h"
@@ -100,19 +102,27 @@ WidevineKeySource::WidevineKeySource(const std::string& server_url,
       crypto_period_count_(kDefaultCryptoPeriodCount),
       protection_scheme_(protection_scheme),
       start_key_production_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                            base::WaitableEvent::InitialState::NOT_SIGNALED) {
+                            base::WaitableEvent::InitialState::NOT_SIGNALED),
+      prefetch_cv_(&lock_) {
   key_production_thread_.Start();
 }
 
 WidevineKeySource::~WidevineKeySource() {
   if (key_pool_)
     key_pool_->Stop();
+  {
+    // Wake up the production threads waiting for the prefetch horizon.
+    base::AutoLock scoped_lock(lock_);
+    prefetch_cv_.Broadcast();
+  }
   if (key_production_thread_.HasBeenStarted()) {
     // Signal the production thread to start key production if it is not
     // signaled yet so the thread can be joined.
     start_key_production_.Signal();
     key_production_thread_.Join();
   }
+  for (const auto& thread : extra_key_production_threads_)
+    thread->Join();
 }
 
 Status WidevineKeySource::FetchKeys(const std::vector<uint8_t>& content_id,
@@ -127,7 +137,7 @@ Status WidevineKeySource::FetchKeys(const std::vector<uint8_t>& content_id,
   if (enable_entitlement_license_)
     common_encryption_request_->set_enable_entitlement_license(true);
 
-  return FetchKeysInternal(!kEnableKeyRotation, 0, false);
+  return FetchKeysInternal(!kEnableKeyRotation, 0, false, nullptr);
 }
 
 Status WidevineKeySource::FetchKeys(EmeInitDataType init_data_type,
@@ -189,7 +199,7 @@ Status WidevineKeySource::FetchKeys(EmeInitDataType init_data_type,
     common_encryption_request_->set_pssh_data(pssh_data.data(),
                                               pssh_data.size());
   }
-  return FetchKeysInternal(!kEnableKeyRotation, 0, widevine_classic);
+  return FetchKeysInternal(!kEnableKeyRotation, 0, widevine_classic, nullptr);
 }
 
 Status WidevineKeySource::GetKey(const std::string& stream_label,
@@ -230,21 +240,60 @@ Status WidevineKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
       // index. Set the initial value to account for that.
       first_crypto_period_index_ =
           crypto_period_index ? crypto_period_index - 1 : 0;
+      latest_crypto_period_index_ = crypto_period_index;
+      next_crypto_period_index_to_fetch_ = first_crypto_period_index_;
+      next_crypto_period_index_to_push_ = first_crypto_period_index_;
       DCHECK(!key_pool_);
       const size_t queue_size = crypto_period_count_ * 10;
       key_pool_.reset(
           new EncryptionKeyQueue(queue_size, first_crypto_period_index_));
       start_key_production_.Signal();
+      for (uint32_t i = 1; i < max_concurrent_requests_; ++i) {
+        std::unique_ptr<ClosureThread> thread(new ClosureThread(
+            "KeyProductionThread", base::Bind(&WidevineKeySource::ProduceKeys,
+                                              base::Unretained(this))));
+        thread->Start();
+        extra_key_production_threads_.push_back(std::move(thread));
+      }
       key_production_started_ = true;
     }  else if (crypto_period_duration_in_seconds_ !=
                 crypto_period_duration_in_seconds) {
       return Status(error::INVALID_ARGUMENT,
                     "Crypto period duration should not change.");
     }
+    if (crypto_period_index > latest_crypto_period_index_) {
+      latest_crypto_period_index_ = crypto_period_index;
+      prefetch_cv_.Broadcast();
+    }
+  }
+  const int64_t headroom = key_prefetch_headroom();
+  VLOG(2) << "Key prefetch headroom: " << headroom << " crypto periods.";
+  if (headroom < 0) {
+    LOG(WARNING) << "Key for crypto period " << crypto_period_index
+                 << " has not been fetched yet. Waiting for the key server.";
   }
   return GetKeyInternal(crypto_period_index, stream_label, key);
 }
 
+void WidevineKeySource::set_key_prefetch(uint32_t prefetch_crypto_periods,
+                                         uint32_t max_concurrent_requests) {
+  DCHECK_GE(max_concurrent_requests, 1u);
+  base::AutoLock scoped_lock(lock_);
+  DCHECK(!key_production_started_);
+  prefetch_crypto_periods_ = prefetch_crypto_periods;
+  max_concurrent_requests_ = std::max(max_concurrent_requests, 1u);
+}
+
+int64_t WidevineKeySource::key_prefetch_headroom() const {
+  base::AutoLock scoped_lock(lock_);
+  if (!key_pool_)
+    return 0;
+  const int64_t last_available_crypto_period_index =
+      key_pool_->Empty() ? static_cast<int64_t>(key_pool_->HeadPos()) - 1
+                         : static_cast<int64_t>(key_pool_->TailPos());
+  return last_available_crypto_period_index - latest_crypto_period_index_;
+}
+
 void WidevineKeySource::set_signer(std::unique_ptr<RequestSigner> signer) {
   signer_ = std::move(signer);
 }
@@ -265,6 +314,7 @@ Status WidevineKeySource::GetKeyInternal(uint32_t crypto_period_index,
                                   kGetKeyTimeoutInSeconds * 1000);
   if (!status.ok()) {
     if (status.error_code() == error::STOPPED) {
+      base::AutoLock scoped_lock(lock_);
       CHECK(!common_encryption_request_status_.ok());
       return common_encryption_request_status_;
     }
@@ -284,23 +334,72 @@ void WidevineKeySource::FetchKeysTask() {
   start_key_production_.Wait();
   if (!key_pool_ || key_pool_->Stopped())
     return;
+  ProduceKeys();
+}
+
+void WidevineKeySource::ProduceKeys() {
+  while (true) {
+    uint32_t first_crypto_period_index = 0;
+    {
+      base::AutoLock scoped_lock(lock_);
+      // Wait until the next request is within the prefetch horizon.
+      while (!key_fetch_failed_ && !key_pool_->Stopped() &&
+             prefetch_crypto_periods_ != 0 &&
+             next_crypto_period_index_to_fetch_ >
+                 latest_crypto_period_index_ + prefetch_crypto_periods_) {
+        prefetch_cv_.Wait();
+      }
+      if (key_fetch_failed_ || key_pool_->Stopped())
+        return;
+      first_crypto_period_index = next_crypto_period_index_to_fetch_;
+      next_crypto_period_index_to_fetch_ += crypto_period_count_;
+    }
 
-  Status status = FetchKeysInternal(kEnableKeyRotation,
-                                    first_crypto_period_index_,
-                                    false);
-  while (status.ok()) {
-    first_crypto_period_index_ += crypto_period_count_;
-    status = FetchKeysInternal(kEnableKeyRotation,
-                               first_crypto_period_index_,
-                               false);
+    FetchedKeys fetched_keys;
+    fetched_keys.status =
+        FetchKeysInternal(kEnableKeyRotation, first_crypto_period_index, false,
+                          &fetched_keys.crypto_period_keys);
+    if (!fetched_keys.status.ok()) {
+      // Requests in flight still complete, so the keys before the failed
+      // request remain available.
+      base::AutoLock scoped_lock(lock_);
+      key_fetch_failed_ = true;
+    }
+    if (!PushFetchedKeys(first_crypto_period_index, std::move(fetched_keys)))
+      return;
   }
-  common_encryption_request_status_ = status;
-  key_pool_->Stop();
 }
 
-Status WidevineKeySource::FetchKeysInternal(bool enable_key_rotation,
-                                            uint32_t first_crypto_period_index,
-                                            bool widevine_classic) {
+bool WidevineKeySource::PushFetchedKeys(uint32_t first_crypto_period_index,
+                                        FetchedKeys fetched_keys) {
+  base::AutoLock scoped_lock(push_lock_);
+  fetched_keys_[first_crypto_period_index] = std::move(fetched_keys);
+  while (!fetched_keys_.empty() &&
+         fetched_keys_.begin()->first == next_crypto_period_index_to_push_) {
+    const FetchedKeys& next_fetched_keys = fetched_keys_.begin()->second;
+    if (!next_fetched_keys.status.ok()) {
+      {
+        base::AutoLock scoped_status_lock(lock_);
+        common_encryption_request_status_ = next_fetched_keys.status;
+      }
+      key_pool_->Stop();
+      return false;
+    }
+    for (const auto& keys : next_fetched_keys.crypto_period_keys) {
+      if (!PushToKeyPool(keys))
+        return false;
+    }
+    next_crypto_period_index_to_push_ += crypto_period_count_;
+    fetched_keys_.erase(fetched_keys_.begin());
+  }
+  return true;
+}
+
+Status WidevineKeySource::FetchKeysInternal(
+    bool enable_key_rotation,
+    uint32_t first_crypto_period_index,
+    bool widevine_classic,
+    CryptoPeriodKeys* crypto_period_keys) {
   CommonEncryptionRequest request;
   FillRequest(enable_key_rotation, first_crypto_period_index, &request);
 
@@ -322,8 +421,10 @@ Status WidevineKeySource::FetchKeysInternal(bool enable_key_rotation,
 
       bool transient_error = false;
       if (ExtractEncryptionKey(enable_key_rotation, widevine_classic,
-                               raw_response, &transient_error))
+                               first_crypto_period_index, raw_response,
+                               &transient_error, crypto_period_keys)) {
         return Status::OK;
+      }
 
       if (!transient_error) {
         return Status(
@@ -398,10 +499,15 @@ Status WidevineKeySource::GenerateKeyMessage(
 bool WidevineKeySource::ExtractEncryptionKey(
     bool enable_key_rotation,
     bool widevine_classic,
+    uint32_t first_crypto_period_index,
     const std::string& response,
-    bool* transient_error) {
+    bool* transient_error,
+    CryptoPeriodKeys* crypto_period_keys) {
   DCHECK(transient_error);
   *transient_error = false;
+  DCHECK(!enable_key_rotation || crypto_period_keys);
+  if (crypto_period_keys)
+    crypto_period_keys->clear();
 
   SignedModularDrmResponse signed_response_proto;
   if (!JsonStringToMessage(response, &signed_response_proto)) {
@@ -429,7 +535,7 @@ bool WidevineKeySource::ExtractEncryptionKey(
              ? response_proto.tracks_size() >= crypto_period_count_
              : response_proto.tracks_size() >= 1);
 
-  uint32_t current_crypto_period_index = first_crypto_period_index_;
+  uint32_t current_crypto_period_index = first_crypto_period_index;
 
   std::vector<std::vector<uint8_t>> key_ids;
   for (const auto& track : response_proto.tracks()) {
@@ -450,8 +556,8 @@ bool WidevineKeySource::ExtractEncryptionKey(
                      << track.crypto_period_index();
           return false;
         }
-        if (!PushToKeyPool(&encryption_key_map))
-          return false;
+        crypto_period_keys->push_back(std::make_shared<EncryptionKeyMap>());
+        crypto_period_keys->back()->swap(encryption_key_map);
         ++current_crypto_period_index;
       }
     }
@@ -490,16 +596,16 @@ bool WidevineKeySource::ExtractEncryptionKey(
     return true;
   }
 
-  return PushToKeyPool(&encryption_key_map);
+  crypto_period_keys->push_back(std::make_shared<EncryptionKeyMap>());
+  crypto_period_keys->back()->swap(encryption_key_map);
+  return true;
 }
 
 bool WidevineKeySource::PushToKeyPool(
-    EncryptionKeyMap* encryption_key_map) {
+    const std::shared_ptr<EncryptionKeyMap>& keys) {
   DCHECK(key_pool_);
-  DCHECK(encryption_key_map);
-  auto encryption_key_map_shared = std::make_shared<EncryptionKeyMap>();
-  encryption_key_map_shared->swap(*encryption_key_map);
-  Status status = key_pool_->Push(encryption_key_map_shared, kInfiniteTimeout);
+  DCHECK(keys);
+  Status status = key_pool_->Push(keys, kInfiniteTimeout);
   if (!status.ok()) {
     DCHECK_EQ(error::STOPPED, status.error_code());
     return false;
@@ -9,6 +9,9 @@
 
 #include <map>
 #include <memory>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
 #include "packager/base/synchronization/waitable_event.h"
 #include "packager/media/base/closure_thread.h"
 #include "packager/media/base/fourccs.h"
@@ -75,9 +78,38 @@ class WidevineKeySource : public KeySource {
     enable_entitlement_license_ = enable_entitlement_license;
   }
 
+  /// Configure key prefetching for key rotation. Keys are requested in
+  /// batches of crypto periods, with up to @a max_concurrent_requests batches
+  /// requested at the same time, so a slow or retried request does not hold
+  /// back the requests for the following crypto periods. Must be called
+  /// before the first GetCryptoPeriodKey() call.
+  /// @param prefetch_crypto_periods is the number of crypto periods, after the
+  ///        latest crypto period requested with GetCryptoPeriodKey(), to fetch
+  ///        keys for ahead of need. 0 means that keys are fetched as far ahead
+  ///        as the key pool allows.
+  /// @param max_concurrent_requests is the maximum number of key requests in
+  ///        flight at the same time. Must be at least 1.
+  void set_key_prefetch(uint32_t prefetch_crypto_periods,
+                        uint32_t max_concurrent_requests);
+
+  /// @return The number of crypto periods, after the latest crypto period
+  ///         requested with GetCryptoPeriodKey(), whose keys are available,
+  ///         i.e. how far key production is ahead of the media. A negative
+  ///         value means that the media is waiting for keys. Only meaningful
+  ///         once key rotation has started.
+  int64_t key_prefetch_headroom() const;
+
  private:
   typedef ProducerConsumerQueue<std::shared_ptr<EncryptionKeyMap>>
       EncryptionKeyQueue;
+  // Keys of consecutive crypto periods.
+  typedef std::vector<std::shared_ptr<EncryptionKeyMap>> CryptoPeriodKeys;
+
+  // The result of a key rotation request.
+  struct FetchedKeys {
+    Status status;
+    CryptoPeriodKeys crypto_period_keys;
+  };
 
   // Internal routine for getting keys.
   Status GetKeyInternal(uint32_t crypto_period_index,
@@ -86,11 +118,21 @@ class WidevineKeySource : public KeySource {
 
   // The closure task to fetch keys repeatedly.
   void FetchKeysTask();
-
-  // Fetch keys from server.
+  // Fetch keys for key rotation until an error happens or |key_pool_| is
+  // stopped. Runs on every key production thread.
+  void ProduceKeys();
+  // Push the fetched keys to |key_pool_| in crypto period order, stopping
+  // |key_pool_| at the first failed request. Return false if |key_pool_| has
+  // been stopped.
+  bool PushFetchedKeys(uint32_t first_crypto_period_index,
+                       FetchedKeys fetched_keys);
+
+  // Fetch keys from server. |crypto_period_keys| receives the keys if
+  // |enable_key_rotation| is true and can be NULL otherwise.
   Status FetchKeysInternal(bool enable_key_rotation,
                            uint32_t first_crypto_period_index,
-                           bool widevine_classic);
+                           bool widevine_classic,
+                           CryptoPeriodKeys* crypto_period_keys);
 
   // Fill |request| with necessary fields for Widevine encryption request.
   // |request| should not be NULL.
@@ -107,15 +149,19 @@ class WidevineKeySource : public KeySource {
   // should not be NULL.
   bool ExtractEncryptionKey(bool enable_key_rotation,
                             bool widevine_classic,
+                            uint32_t first_crypto_period_index,
                             const std::string& response,
-                            bool* transient_error);
+                            bool* transient_error,
+                            CryptoPeriodKeys* crypto_period_keys);
   // Push the keys to the key pool.
-  bool PushToKeyPool(EncryptionKeyMap* encryption_key_map);
+  bool PushToKeyPool(const std::shared_ptr<EncryptionKeyMap>& keys);
 
   // Indicates whether Widevine protection system should be generated.
   bool generate_widevine_protection_system_ = true;
 
   ClosureThread key_production_thread_;
+  // Additional key production threads for concurrent key requests.
+  std::vector<std::unique_ptr<ClosureThread>> extra_key_production_threads_;
   // The fetcher object used to fetch keys from the license service.
   // It is initialized to a default fetcher on class initialization.
   // Can be overridden using set_key_fetcher for testing or other purposes.
@@ -126,10 +172,28 @@ class WidevineKeySource : public KeySource {
 
   const int crypto_period_count_;
   FourCC protection_scheme_ = FOURCC_NULL;
-  base::Lock lock_;
+  mutable base::Lock lock_;
   bool key_production_started_ = false;
   base::WaitableEvent start_key_production_;
   uint32_t first_crypto_period_index_ = 0;
+  uint32_t prefetch_crypto_periods_ = 0;
+  uint32_t max_concurrent_requests_ = 1;
+  // The following are protected by |lock_|. |prefetch_cv_| is signaled when
+  // any of them changes.
+  base::ConditionVariable prefetch_cv_;
+  // The latest crypto period index requested with GetCryptoPeriodKey().
+  uint32_t latest_crypto_period_index_ = 0;
+  // The first crypto period index of the next key rotation request.
+  uint32_t next_crypto_period_index_to_fetch_ = 0;
+  // Set when a key rotation request failed; no more requests are made.
+  bool key_fetch_failed_ = false;
+  // Protects |fetched_keys_| and |next_crypto_period_index_to_push_|, which
+  // are used to push the keys to |key_pool_| in order.
+  base::Lock push_lock_;
+  // Fetched keys that cannot be pushed yet, keyed by the first crypto
+  // period index of the request.
+  std::map<uint32_t, FetchedKeys> fetched_keys_;
+  uint32_t next_crypto_period_index_to_push_ = 0;
   uint32_t crypto_period_duration_in_seconds_ = 0;
   std::vector<uint8_t> group_id_;
   bool enable_entitlement_license_ = false;
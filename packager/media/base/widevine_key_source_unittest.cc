@@ -20,9 +20,12 @@
 #include "packager/status_test_util.h"
 
 using ::testing::_;
+using ::testing::AtMost;
 using ::testing::Bool;
+using ::testing::Cardinality;
 using ::testing::Combine;
 using ::testing::DoAll;
+using ::testing::Exactly;
 using ::testing::InSequence;
 using ::testing::Return;
 using ::testing::SetArgPointee;
@@ -655,6 +658,86 @@ TEST_P(WidevineKeySourceParameterizedTest, KeyRotationTest) {
   EXPECT_EQ(error::INVALID_ARGUMENT, status.error_code());
 }
 
+// Keys are requested concurrently, in batches of crypto periods, but no
+// further ahead than the prefetch horizon.
+TEST_F(WidevineKeySourceTest, KeyRotationWithPrefetch) {
+  const uint32_t kCryptoPeriodCount = 10;
+  const uint32_t kCryptoPeriodSeconds = 100;
+  const uint32_t kPrefetchCryptoPeriods = 20;
+  const uint32_t kMaxConcurrentRequests = 3;
+  // Requesting kLatestCryptoPeriodIndex moves the prefetch horizon to 47, so
+  // the requests for crypto periods 30 and 40 may be made, but not the
+  // requests for crypto period 50 and later.
+  const uint32_t kLatestCryptoPeriodIndex = 27;
+  const uint32_t kNumRequiredRequests = 3;
+  const uint32_t kNumPrefetchableRequests = 5;
+
+  // Catch all unexpected requests. Declared first so that the expectations
+  // below take precedence.
+  EXPECT_CALL(*mock_request_signer_, GenerateSignature(_, _)).Times(0);
+
+  std::string expected_message = base::StringPrintf(
+      kExpectedRequestMessageFormat, Base64Encode(kContentId).c_str(), kPolicy,
+      GetExpectedProtectionScheme().c_str());
+  EXPECT_CALL(*mock_request_signer_,
+              GenerateSignature(StrEq(expected_message), _))
+      .WillOnce(DoAll(SetArgPointee<1>(kMockSignature), Return(true)));
+  std::string mock_response = base::StringPrintf(
+      kHttpResponseFormat, Base64Encode(GenerateMockLicenseResponse()).c_str());
+  EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(mock_response), Return(Status::OK)));
+
+  for (uint32_t i = 0; i < kNumPrefetchableRequests; ++i) {
+    const uint32_t first_crypto_period_index = i * kCryptoPeriodCount;
+    std::string expected_message = base::StringPrintf(
+        kCryptoPeriodRequestMessageFormat, Base64Encode(kContentId).c_str(),
+        kPolicy, first_crypto_period_index, kCryptoPeriodCount,
+        kCryptoPeriodSeconds, GetExpectedProtectionScheme().c_str());
+    // The requests after the required ones are made ahead of need, so they
+    // may or may not have been made when the test finishes.
+    const Cardinality times =
+        i < kNumRequiredRequests ? Exactly(1) : AtMost(1);
+    EXPECT_CALL(*mock_request_signer_,
+                GenerateSignature(StrEq(expected_message), _))
+        .Times(times)
+        .WillRepeatedly(
+            DoAll(SetArgPointee<1>(kMockSignature), Return(true)));
+
+    std::string expected_post_data = base::StringPrintf(
+        kExpectedSignedMessageFormat, Base64Encode(expected_message).c_str(),
+        Base64Encode(kMockSignature).c_str(), kSignerName);
+    std::string mock_response = base::StringPrintf(
+        kHttpResponseFormat,
+        Base64Encode(GenerateMockKeyRotationLicenseResponse(
+                         first_crypto_period_index, kCryptoPeriodCount))
+            .c_str());
+    EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, expected_post_data, _))
+        .Times(times)
+        .WillRepeatedly(
+            DoAll(SetArgPointee<2>(mock_response), Return(Status::OK)));
+  }
+
+  CreateWidevineKeySource();
+  widevine_key_source_->set_signer(std::move(mock_request_signer_));
+  widevine_key_source_->set_key_prefetch(kPrefetchCryptoPeriods,
+                                         kMaxConcurrentRequests);
+  ASSERT_OK(widevine_key_source_->FetchKeys(content_id_, kPolicy));
+
+  EncryptionKey encryption_key;
+  const uint32_t kCryptoPeriodIndexes[] = {0, 5, kLatestCryptoPeriodIndex};
+  for (uint32_t crypto_period_index : kCryptoPeriodIndexes) {
+    ASSERT_OK(widevine_key_source_->GetCryptoPeriodKey(
+        crypto_period_index, kCryptoPeriodSeconds, "SD", &encryption_key));
+    EXPECT_EQ(GetMockKey("SD", crypto_period_index),
+              ToString(encryption_key.key));
+  }
+  // The keys are available up to at least the end of the batch containing
+  // kLatestCryptoPeriodIndex.
+  EXPECT_GE(widevine_key_source_->key_prefetch_headroom(),
+            static_cast<int64_t>(kNumRequiredRequests * kCryptoPeriodCount -
+                                 1 - kLatestCryptoPeriodIndex));
+}
+
 INSTANTIATE_TEST_CASE_P(WidevineKeySourceInstance,
                         WidevineKeySourceParameterizedTest,
                         Combine(Bool(),
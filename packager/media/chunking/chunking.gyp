@@ -23,6 +23,7 @@
         'text_chunker.h',
       ],
       'dependencies': [
+        '../../metrics/metrics.gyp:metrics',
         '../base/media_base.gyp:media_base',
       ],
     },
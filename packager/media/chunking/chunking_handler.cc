@@ -10,6 +10,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/stage_latency.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -70,6 +71,10 @@ Status ChunkingHandler::OnStreamInfo(std::shared_ptr<const StreamInfo> info) {
       chunking_params_.segment_duration_in_seconds * time_scale_;
   subsegment_duration_ =
       chunking_params_.subsegment_duration_in_seconds * time_scale_;
+  low_latency_chunk_duration_ =
+      chunking_params_.low_latency_chunk_duration_in_seconds * time_scale_;
+  low_latency_chunk_min_duration_ =
+      chunking_params_.low_latency_chunk_min_duration_in_seconds * time_scale_;
   return DispatchStreamInfo(kStreamIndex, std::move(info));
 }
 
@@ -91,16 +96,25 @@ Status ChunkingHandler::OnMediaSample(
   DCHECK_NE(time_scale_, 0u) << "kStreamInfo should arrive before kMediaSample";
 
   const int64_t timestamp = sample->pts();
+  if (!first_sample_segment_index_) {
+    first_sample_segment_index_ =
+        timestamp < cue_offset_ ? 0
+                                : (timestamp - cue_offset_) / segment_duration_;
+  }
 
   bool started_new_segment = false;
+  bool started_new_subsegment = false;
   const bool can_start_new_segment =
       sample->is_key_frame() || !chunking_params_.segment_sap_aligned;
   if (can_start_new_segment) {
     const int64_t segment_index =
         timestamp < cue_offset_ ? 0
                                 : (timestamp - cue_offset_) / segment_duration_;
-    if (!segment_start_time_ ||
-        IsNewSegmentIndex(segment_index, current_segment_index_)) {
+    if (!segment_start_time_ && start_at_segment_boundary_ &&
+        !CanStartFirstSegment(timestamp, segment_index)) {
+      // Discarded below.
+    } else if (!segment_start_time_ ||
+               IsNewSegmentIndex(segment_index, current_segment_index_)) {
       current_segment_index_ = segment_index;
       // Reset subsegment index.
       current_subsegment_index_ = 0;
@@ -108,11 +122,13 @@ Status ChunkingHandler::OnMediaSample(
       RETURN_IF_ERROR(EndSegmentIfStarted());
       segment_start_time_ = timestamp;
       subsegment_start_time_ = timestamp;
+      segment_arrival_time_ = sample->arrival_time();
+      subsegment_arrival_time_ = sample->arrival_time();
       max_segment_time_ = timestamp + sample->duration();
       started_new_segment = true;
     }
   }
-  if (!started_new_segment && IsSubsegmentEnabled()) {
+  if (!started_new_segment && segment_start_time_ && IsSubsegmentEnabled()) {
     const bool can_start_new_subsegment =
         sample->is_key_frame() || !chunking_params_.subsegment_sap_aligned;
     if (can_start_new_subsegment) {
@@ -123,9 +139,25 @@ Status ChunkingHandler::OnMediaSample(
 
         RETURN_IF_ERROR(EndSubsegmentIfStarted());
         subsegment_start_time_ = timestamp;
+        subsegment_arrival_time_ = sample->arrival_time();
+        started_new_subsegment = true;
       }
     }
   }
+  if (started_new_segment || started_new_subsegment) {
+    chunk_start_time_ = timestamp;
+    chunk_arrival_time_ = sample->arrival_time();
+    num_frames_in_chunk_ = 0;
+    num_bytes_in_chunk_ = 0;
+  } else if (IsLowLatencyChunkEnabled() && chunk_start_time_ &&
+             IsLowLatencyChunkComplete(timestamp)) {
+    // Chunks do not need to begin with stream access points.
+    RETURN_IF_ERROR(EndLowLatencyChunkIfStarted());
+    chunk_start_time_ = timestamp;
+    chunk_arrival_time_ = sample->arrival_time();
+    num_frames_in_chunk_ = 0;
+    num_bytes_in_chunk_ = 0;
+  }
 
   VLOG(3) << "Sample ts: " << timestamp << " "
           << " duration: " << sample->duration() << " scale: " << time_scale_
@@ -139,6 +171,9 @@ Status ChunkingHandler::OnMediaSample(
 
   segment_start_time_ = std::min(segment_start_time_.value(), timestamp);
   subsegment_start_time_ = std::min(subsegment_start_time_.value(), timestamp);
+  chunk_start_time_ = std::min(chunk_start_time_.value(), timestamp);
+  ++num_frames_in_chunk_;
+  num_bytes_in_chunk_ += sample->data_size();
   max_segment_time_ =
       std::max(max_segment_time_, timestamp + sample->duration());
   return DispatchMediaSample(kStreamIndex, std::move(sample));
@@ -151,6 +186,11 @@ Status ChunkingHandler::EndSegmentIfStarted() const {
   auto segment_info = std::make_shared<SegmentInfo>();
   segment_info->start_timestamp = segment_start_time_.value();
   segment_info->duration = max_segment_time_ - segment_start_time_.value();
+  segment_info->arrival_time = segment_arrival_time_;
+  // The last chunk of the segment ends with it.
+  RecordStageLatency(kChunkStage, stream_label_,
+                     IsLowLatencyChunkEnabled() ? chunk_arrival_time_
+                                                : segment_arrival_time_);
   return DispatchSegmentInfo(kStreamIndex, std::move(segment_info));
 }
 
@@ -163,8 +203,52 @@ Status ChunkingHandler::EndSubsegmentIfStarted() const {
   subsegment_info->duration =
       max_segment_time_ - subsegment_start_time_.value();
   subsegment_info->is_subsegment = true;
+  // Write subsegments out right away too if low latency chunking is enabled.
+  subsegment_info->is_chunk = IsLowLatencyChunkEnabled();
+  subsegment_info->arrival_time = subsegment_arrival_time_;
+  if (subsegment_info->is_chunk)
+    RecordStageLatency(kChunkStage, stream_label_, subsegment_arrival_time_);
   return DispatchSegmentInfo(kStreamIndex, std::move(subsegment_info));
 }
 
+Status ChunkingHandler::EndLowLatencyChunkIfStarted() const {
+  if (!chunk_start_time_)
+    return Status::OK;
+
+  auto chunk_info = std::make_shared<SegmentInfo>();
+  chunk_info->start_timestamp = chunk_start_time_.value();
+  chunk_info->duration = max_segment_time_ - chunk_start_time_.value();
+  chunk_info->is_subsegment = true;
+  chunk_info->is_chunk = true;
+  chunk_info->arrival_time = chunk_arrival_time_;
+  RecordStageLatency(kChunkStage, stream_label_, chunk_arrival_time_);
+  return DispatchSegmentInfo(kStreamIndex, std::move(chunk_info));
+}
+
+bool ChunkingHandler::CanStartFirstSegment(int64_t timestamp,
+                                           int64_t segment_index) const {
+  const bool at_segment_boundary =
+      timestamp >= cue_offset_ &&
+      (timestamp - cue_offset_) % segment_duration_ == 0;
+  return at_segment_boundary ||
+         IsNewSegmentIndex(segment_index, first_sample_segment_index_.value());
+}
+
+bool ChunkingHandler::IsLowLatencyChunkComplete(int64_t timestamp) const {
+  DCHECK(chunk_start_time_);
+  if (chunking_params_.low_latency_chunk_num_frames > 0 &&
+      num_frames_in_chunk_ >= chunking_params_.low_latency_chunk_num_frames) {
+    return true;
+  }
+  const int64_t chunk_duration = timestamp - chunk_start_time_.value();
+  if (chunking_params_.low_latency_chunk_target_bytes > 0 &&
+      num_bytes_in_chunk_ >= chunking_params_.low_latency_chunk_target_bytes &&
+      chunk_duration >= low_latency_chunk_min_duration_) {
+    return true;
+  }
+  return low_latency_chunk_duration_ > 0 &&
+         chunk_duration >= low_latency_chunk_duration_;
+}
+
 }  // namespace media
 }  // namespace shaka
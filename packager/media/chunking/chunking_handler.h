@@ -9,6 +9,7 @@
 
 #include <atomic>
 #include <queue>
+#include <string>
 
 #include "packager/base/logging.h"
 #include "packager/base/optional.h"
@@ -41,6 +42,19 @@ class ChunkingHandler : public MediaHandler {
   explicit ChunkingHandler(const ChunkingParams& chunking_params);
   ~ChunkingHandler() override = default;
 
+  /// Discard the samples before the first segment boundary, instead of
+  /// starting the first segment with the first sample, so the segments of a
+  /// stream which starts late align with the segments of the other streams.
+  void set_start_at_segment_boundary(bool start_at_segment_boundary) {
+    start_at_segment_boundary_ = start_at_segment_boundary;
+  }
+
+  /// Set the stream label of the latency recorded when the segments and
+  /// chunks end, see RecordStageLatency().
+  void set_stream_label(const std::string& stream_label) {
+    stream_label_ = stream_label;
+  }
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
@@ -61,17 +75,31 @@ class ChunkingHandler : public MediaHandler {
 
   Status EndSegmentIfStarted() const;
   Status EndSubsegmentIfStarted() const;
+  Status EndLowLatencyChunkIfStarted() const;
 
   bool IsSubsegmentEnabled() {
     return subsegment_duration_ > 0 &&
            subsegment_duration_ != segment_duration_;
   }
 
+  bool IsLowLatencyChunkEnabled() const {
+    return chunking_params_.low_latency_chunk_num_frames > 0 ||
+           low_latency_chunk_duration_ > 0;
+  }
+
+  // Whether the current low latency chunk should end before |timestamp|.
+  bool IsLowLatencyChunkComplete(int64_t timestamp) const;
+
+  // Whether the first segment can start at |timestamp|, with |segment_index|.
+  bool CanStartFirstSegment(int64_t timestamp, int64_t segment_index) const;
+
   const ChunkingParams chunking_params_;
 
   // Segment and subsegment duration in stream's time scale.
   int64_t segment_duration_ = 0;
   int64_t subsegment_duration_ = 0;
+  int64_t low_latency_chunk_duration_ = 0;
+  int64_t low_latency_chunk_min_duration_ = 0;
 
   // Current segment index, useful to determine where to do chunking.
   int64_t current_segment_index_ = -1;
@@ -80,12 +108,26 @@ class ChunkingHandler : public MediaHandler {
 
   base::Optional<int64_t> segment_start_time_;
   base::Optional<int64_t> subsegment_start_time_;
+  base::Optional<int64_t> chunk_start_time_;
+  // The arrival times of the first samples of the current segment, subsegment
+  // and chunk.
+  base::Time segment_arrival_time_;
+  base::Time subsegment_arrival_time_;
+  base::Time chunk_arrival_time_;
+  int num_frames_in_chunk_ = 0;
+  uint64_t num_bytes_in_chunk_ = 0;
   int64_t max_segment_time_ = 0;
   uint32_t time_scale_ = 0;
 
   // The offset is applied to sample timestamps so a full segment is generated
   // after cue points.
   int64_t cue_offset_ = 0;
+
+  bool start_at_segment_boundary_ = false;
+  // The segment index of the first sample, for |start_at_segment_boundary_|.
+  base::Optional<int64_t> first_sample_segment_index_;
+
+  std::string stream_label_;
 };
 
 }  // namespace media
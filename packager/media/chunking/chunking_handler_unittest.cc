@@ -155,6 +155,143 @@ TEST_F(ChunkingHandlerTest, VideoAndSubsegmentAndNonzeroStart) {
                         kDuration, !kEncrypted, _)));
 }
 
+TEST_F(ChunkingHandlerTest, StartAtSegmentBoundary) {
+  ChunkingParams chunking_params;
+  chunking_params.segment_duration_in_seconds = 1;
+  SetUpChunkingHandler(1, chunking_params);
+  chunking_handler_->set_start_at_segment_boundary(true);
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetAudioStreamInfo(kTimeScale1))));
+  const int64_t kAudioStartTimestamp = 12345;
+  for (int i = 0; i < 7; ++i) {
+    ASSERT_OK(Process(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(kAudioStartTimestamp + i * kDuration,
+                                     kDuration, kKeyFrame))));
+  }
+  EXPECT_THAT(
+      GetOutputStreamDataVector(),
+      ElementsAre(
+          IsStreamInfo(kStreamIndex, kTimeScale1, !kEncrypted, _),
+          // The samples before the segment boundary 13245 / 1000 != 12945 /
+          // 1000 are discarded.
+          IsMediaSample(kStreamIndex, kAudioStartTimestamp + kDuration * 3,
+                        kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, kAudioStartTimestamp + kDuration * 4,
+                        kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, kAudioStartTimestamp + kDuration * 5,
+                        kDuration, !kEncrypted, _),
+          IsSegmentInfo(kStreamIndex, kAudioStartTimestamp + kDuration * 3,
+                        kDuration * 3, !kIsSubsegment, !kEncrypted),
+          IsMediaSample(kStreamIndex, kAudioStartTimestamp + kDuration * 6,
+                        kDuration, !kEncrypted, _)));
+}
+
+TEST_F(ChunkingHandlerTest, VideoWithLowLatencyChunksOfFrames) {
+  ChunkingParams chunking_params;
+  chunking_params.segment_duration_in_seconds = 10;
+  chunking_params.low_latency_chunk_num_frames = 2;
+  SetUpChunkingHandler(1, chunking_params);
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale1))));
+  for (int i = 0; i < 5; ++i) {
+    // Chunks do not need to begin with key frames.
+    const bool is_key_frame = i == 0;
+    ASSERT_OK(Process(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kDuration, kDuration, is_key_frame))));
+  }
+  ASSERT_OK(OnFlushRequest(kStreamIndex));
+  EXPECT_THAT(
+      GetOutputStreamDataVector(),
+      ElementsAre(
+          IsStreamInfo(kStreamIndex, kTimeScale1, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 0, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, kDuration, kDuration, !kEncrypted, _),
+          IsSegmentInfo(kStreamIndex, 0, kDuration * 2, kIsSubsegment,
+                        !kEncrypted),
+          IsMediaSample(kStreamIndex, 2 * kDuration, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 3 * kDuration, kDuration, !kEncrypted, _),
+          IsSegmentInfo(kStreamIndex, 2 * kDuration, kDuration * 2,
+                        kIsSubsegment, !kEncrypted),
+          IsMediaSample(kStreamIndex, 4 * kDuration, kDuration, !kEncrypted, _),
+          IsSegmentInfo(kStreamIndex, 0, kDuration * 5, !kIsSubsegment,
+                        !kEncrypted)));
+}
+
+TEST_F(ChunkingHandlerTest, AudioWithLowLatencyChunksOfDuration) {
+  ChunkingParams chunking_params;
+  chunking_params.segment_duration_in_seconds = 1;
+  chunking_params.low_latency_chunk_duration_in_seconds = 0.5;
+  SetUpChunkingHandler(1, chunking_params);
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetAudioStreamInfo(kTimeScale0))));
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_OK(Process(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kDuration, kDuration, kKeyFrame))));
+  }
+  EXPECT_THAT(
+      GetOutputStreamDataVector(),
+      ElementsAre(
+          IsStreamInfo(kStreamIndex, kTimeScale0, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 0, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, kDuration, kDuration, !kEncrypted, _),
+          // The chunk ends once it lasts the chunk duration of 400.
+          IsSegmentInfo(kStreamIndex, 0, kDuration * 2, kIsSubsegment,
+                        !kEncrypted),
+          IsMediaSample(kStreamIndex, 2 * kDuration, kDuration, !kEncrypted, _),
+          // The segment ends the chunk too.
+          IsSegmentInfo(kStreamIndex, 0, kDuration * 3, !kIsSubsegment,
+                        !kEncrypted),
+          IsMediaSample(kStreamIndex, 3 * kDuration, kDuration, !kEncrypted,
+                        _)));
+}
+
+TEST_F(ChunkingHandlerTest, VideoWithByteBudgetedLowLatencyChunks) {
+  ChunkingParams chunking_params;
+  chunking_params.segment_duration_in_seconds = 10;
+  chunking_params.low_latency_chunk_duration_in_seconds = 0.9;
+  chunking_params.low_latency_chunk_target_bytes = 20;
+  chunking_params.low_latency_chunk_min_duration_in_seconds = 0.6;
+  SetUpChunkingHandler(1, chunking_params);
+
+  const uint8_t kLargeSample[20] = {};
+  const uint8_t kSmallSample[6] = {};
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale1))));
+  for (int i = 0; i < 7; ++i) {
+    const bool is_key_frame = i == 0;
+    const uint8_t* data = i == 0 ? kLargeSample : kSmallSample;
+    const size_t data_size =
+        i == 0 ? sizeof(kLargeSample) : sizeof(kSmallSample);
+    ASSERT_OK(Process(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kDuration, kDuration, is_key_frame,
+                                     data, data_size))));
+  }
+  ASSERT_OK(OnFlushRequest(kStreamIndex));
+  EXPECT_THAT(
+      GetOutputStreamDataVector(),
+      ElementsAre(
+          IsStreamInfo(kStreamIndex, kTimeScale1, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 0, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, kDuration, kDuration, !kEncrypted, _),
+          // The chunk holds the target bytes from the first sample, but ends
+          // once it lasts the minimum duration of 600.
+          IsSegmentInfo(kStreamIndex, 0, kDuration * 2, kIsSubsegment,
+                        !kEncrypted),
+          IsMediaSample(kStreamIndex, 2 * kDuration, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 3 * kDuration, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 4 * kDuration, kDuration, !kEncrypted, _),
+          // The chunk of small samples ends at the maximum duration of 900.
+          IsSegmentInfo(kStreamIndex, 2 * kDuration, kDuration * 3,
+                        kIsSubsegment, !kEncrypted),
+          IsMediaSample(kStreamIndex, 5 * kDuration, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 6 * kDuration, kDuration, !kEncrypted, _),
+          IsSegmentInfo(kStreamIndex, 0, kDuration * 7, !kIsSubsegment,
+                        !kEncrypted)));
+}
+
 TEST_F(ChunkingHandlerTest, CueEvent) {
   ChunkingParams chunking_params;
   chunking_params.segment_duration_in_seconds = 1;
@@ -60,13 +60,20 @@ double TextEndTimeInSeconds(const StreamInfo& info, const StreamData& data) {
   return static_cast<double>(scaled_time) / time_scale;
 }
 
+size_t GetSampleSize(const StreamData& data) {
+  DCHECK(data.text_sample || data.media_sample);
+  return data.text_sample ? data.text_sample->payload().size()
+                          : data.media_sample->data_size();
+}
+
 Status GetNextCue(double hint,
                   SyncPointQueue* sync_points,
+                  bool* is_waiting,
                   std::shared_ptr<const CueEvent>* out_cue) {
   DCHECK(sync_points);
   DCHECK(out_cue);
 
-  *out_cue = sync_points->GetNext(hint);
+  *out_cue = sync_points->GetNext(hint, is_waiting);
 
   // |*out_cue| will only be null if the job was cancelled.
   return *out_cue ? Status::OK
@@ -116,16 +123,15 @@ Status CueAlignmentHandler::OnFlushRequest(size_t stream_index) {
 
   // Do a once over all the streams to ensure that their states are as we expect
   // them. Video and non-video streams have different allowances here. Video
-  // should absolutely have no cues or samples where as non-video streams may
-  // have cues or samples.
+  // should absolutely have no samples, and only have cues that were promoted
+  // early without a key frame after them, where as non-video streams may have
+  // cues or samples.
   for (StreamState& stream : stream_states_) {
     DCHECK(stream.to_be_flushed);
 
     if (stream.info->stream_type() == kStreamVideo) {
       DCHECK_EQ(stream.samples.size(), 0u)
           << "Video streams should not store samples";
-      DCHECK_EQ(stream.cues.size(), 0u)
-          << "Video streams should not store cues";
     }
   }
 
@@ -133,7 +139,8 @@ Status CueAlignmentHandler::OnFlushRequest(size_t stream_index) {
   // when we call |UseNextSyncPoint|.
   while (sync_points_->HasMore(hint_)) {
     std::shared_ptr<const CueEvent> next_cue;
-    RETURN_IF_ERROR(GetNextCue(hint_, sync_points_, &next_cue));
+    RETURN_IF_ERROR(
+        GetNextCue(hint_, sync_points_, &waiting_at_hint_, &next_cue));
     RETURN_IF_ERROR(UseNewSyncPoint(std::move(next_cue)));
   }
 
@@ -184,8 +191,20 @@ Status CueAlignmentHandler::OnVideoSample(std::unique_ptr<StreamData> sample) {
   const double sample_time = TimeInSeconds(*stream.info, *sample);
   const bool is_key_frame = sample->media_sample->is_key_frame();
 
+  // Cues promoted early, because other streams buffered too much while
+  // waiting for this stream, are inserted at the next key frame.
+  while (is_key_frame && !stream.cues.empty() &&
+         stream.cues.front()->cue_event->time_in_seconds <= sample_time) {
+    RETURN_IF_ERROR(Dispatch(std::move(stream.cues.front())));
+    stream.cues.pop_front();
+  }
+
   if (is_key_frame && sample_time >= hint_) {
-    auto next_sync = sync_points_->PromoteAt(sample_time);
+    // Use the cue at the hint if it was promoted early by another thread, as
+    // the other streams got it at the hint.
+    auto next_sync = sync_points_->GetEarlyPromoted(hint_);
+    if (!next_sync)
+      next_sync = sync_points_->PromoteAt(sample_time);
 
     if (!next_sync) {
       LOG(ERROR) << "Failed to promote sync point at " << sample_time
@@ -218,10 +237,39 @@ Status CueAlignmentHandler::OnNonVideoSample(
   // If all the streams are waiting on a hint, it means that none has next sync
   // point determined. It also means that there are no video streams and we need
   // to wait for all streams to converge on a hint so that we can get the next
-  // sync point.
-  if (EveryoneWaitingAtHint()) {
+  // sync point. Instead of blocking until then, keep buffering samples until
+  // there is a new promoted cue or the buffer is full.
+  while (EveryoneWaitingAtHint()) {
     std::shared_ptr<const CueEvent> next_sync;
-    RETURN_IF_ERROR(GetNextCue(hint_, sync_points_, &next_sync));
+    // Look for a new cue only if we are not waiting yet or if a cue has been
+    // promoted since we last looked, so most samples do not take the lock.
+    const uint64_t promotion_epoch = sync_points_->promotion_epoch();
+    if (!waiting_at_hint_ || promotion_epoch != promotion_epoch_) {
+      promotion_epoch_ = promotion_epoch;
+      next_sync = sync_points_->TryGetNext(hint_, &waiting_at_hint_);
+    }
+    if (!next_sync) {
+      if (!BufferFull())
+        return Status::OK;
+      RETURN_IF_ERROR(
+          GetNextCue(hint_, sync_points_, &waiting_at_hint_, &next_sync));
+    }
+    RETURN_IF_ERROR(UseNewSyncPoint(next_sync));
+  }
+
+  // Some streams have not reached the hint yet, e.g. a sparse text stream or a
+  // video stream that is behind. Rather than buffering the other streams
+  // without bounds, promote the cue at the hint early.
+  while (BufferFull() && sync_points_->HasMore(hint_)) {
+    DCHECK(!waiting_at_hint_);
+    LOG(WARNING) << "Stream buffers are full while waiting for the cue at "
+                 << hint_ << ". Promoting it early.";
+    std::shared_ptr<const CueEvent> next_sync =
+        sync_points_->PromoteEarly(hint_);
+    if (!next_sync) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Failed to promote the cue early.");
+    }
     RETURN_IF_ERROR(UseNewSyncPoint(next_sync));
   }
 
@@ -281,6 +329,20 @@ bool CueAlignmentHandler::EveryoneWaitingAtHint() const {
   return true;
 }
 
+bool CueAlignmentHandler::BufferFull() const {
+  const uint64_t max_buffered_bytes =
+      sync_points_->max_buffered_bytes_per_stream();
+  for (const StreamState& stream_state : stream_states_) {
+    if (stream_state.samples.size() >= kMaxBufferSize)
+      return true;
+    if (max_buffered_bytes > 0 &&
+        stream_state.buffered_bytes >= max_buffered_bytes) {
+      return true;
+    }
+  }
+  return false;
+}
+
 Status CueAlignmentHandler::AcceptSample(std::unique_ptr<StreamData> sample,
                                          StreamState* stream) {
   DCHECK(sample);
@@ -291,6 +353,8 @@ Status CueAlignmentHandler::AcceptSample(std::unique_ptr<StreamData> sample,
   // the sample to the queue.
   const size_t stream_index = sample->stream_index;
 
+  stream->buffered_bytes += GetSampleSize(*sample);
+  buffered_memory_.Increase(GetSampleSize(*sample));
   stream->samples.push_back(std::move(sample));
 
   if (stream->samples.size() > kMaxBufferSize) {
@@ -313,6 +377,8 @@ Status CueAlignmentHandler::RunThroughSamples(StreamState* stream) {
         TimeInSeconds(*stream->info, *stream->samples.front());
 
     if (sample_time < cue_time) {
+      stream->buffered_bytes -= GetSampleSize(*stream->samples.front());
+      buffered_memory_.Decrease(GetSampleSize(*stream->samples.front()));
       RETURN_IF_ERROR(Dispatch(std::move(stream->samples.front())));
       stream->samples.pop_front();
     } else {
@@ -326,6 +392,8 @@ Status CueAlignmentHandler::RunThroughSamples(StreamState* stream) {
   // downstream.
   while (stream->samples.size() &&
          TimeInSeconds(*stream->info, *stream->samples.front()) < hint_) {
+    stream->buffered_bytes -= GetSampleSize(*stream->samples.front());
+    buffered_memory_.Decrease(GetSampleSize(*stream->samples.front()));
     RETURN_IF_ERROR(Dispatch(std::move(stream->samples.front())));
     stream->samples.pop_front();
   }
@@ -11,6 +11,7 @@
 
 #include "packager/media/base/media_handler.h"
 #include "packager/media/chunking/sync_point_queue.h"
+#include "packager/metrics/memory_budget.h"
 
 namespace shaka {
 namespace media {
@@ -37,6 +38,8 @@ class CueAlignmentHandler : public MediaHandler {
     // Cached samples that cannot be dispatched. All the samples should be at or
     // after |hint|.
     std::list<std::unique_ptr<StreamData>> samples;
+    // The size of |samples| in bytes.
+    size_t buffered_bytes = 0;
     // If set, the stream is pending to be flushed.
     bool to_be_flushed = false;
     // Only set for text stream.
@@ -65,6 +68,11 @@ class CueAlignmentHandler : public MediaHandler {
   // Check if everyone is waiting for new hint points.
   bool EveryoneWaitingAtHint() const;
 
+  // Check if the samples buffered by any stream while waiting at the hint
+  // reached the cap, in which case the thread cannot wait for the next cue
+  // without blocking or promoting it early.
+  bool BufferFull() const;
+
   // Dispatch or save incoming sample.
   Status AcceptSample(std::unique_ptr<StreamData> sample,
                       StreamState* stream_state);
@@ -84,6 +92,14 @@ class CueAlignmentHandler : public MediaHandler {
   // event. If all streams get to the hint and there are no video streams, the
   // thread will block until |sync_points_| gives back a promoted cue event.
   double hint_;
+
+  // Set when this thread waits at |hint_| in |sync_points_| while it keeps
+  // buffering samples.
+  bool waiting_at_hint_ = false;
+  // The promotion epoch of |sync_points_| when we last looked for a cue.
+  uint64_t promotion_epoch_ = 0;
+  // The size of the samples of all the streams.
+  MemoryUsage buffered_memory_{MemoryBudget::kCueAlignment};
 };
 
 }  // namespace media
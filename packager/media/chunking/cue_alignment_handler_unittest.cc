@@ -25,6 +25,9 @@ namespace {
 const size_t kOneInput = 1;
 const size_t kOneOutput = 1;
 
+const size_t kTwoInputs = 2;
+const size_t kTwoOutputs = 2;
+
 const size_t kThreeInputs = 3;
 const size_t kThreeOutputs = 3;
 
@@ -624,6 +627,90 @@ TEST_F(CueAlignmentHandlerTest, TextAudioVideoInputWithCues) {
   ASSERT_OK(FlushAll({kTextStream, kAudioStream, kVideoStream}));
 }
 
+TEST_F(CueAlignmentHandlerTest, AudioVideoInputWithEarlyPromotedCue) {
+  const size_t kAudioStream = 0;
+  const size_t kVideoStream = 1;
+
+  const int64_t kSampleDuration = 1000;
+  const int64_t kSample0Start = 0;
+  const int64_t kSample1Start = kSample0Start + kSampleDuration;
+  const int64_t kSample2Start = kSample1Start + kSampleDuration;
+
+  const double kSample1StartInSeconds =
+      static_cast<double>(kSample1Start) / kMsTimeScale;
+
+  // Allow the audio stream to buffer only one sample while the video stream
+  // is behind.
+  AdCueGeneratorParams params;
+  Cuepoint cue;
+  cue.start_time_in_seconds = kSample1StartInSeconds;
+  params.cue_points.push_back(cue);
+  params.max_buffered_bytes_per_stream =
+      2 * GetMediaSample(kSample0Start, kSampleDuration, kKeyFrame)
+              ->data_size();
+  SyncPointQueue sync_points(params);
+  auto handler = std::make_shared<CueAlignmentHandler>(&sync_points);
+  ASSERT_OK(SetUpAndInitializeGraph(handler, kTwoInputs, kTwoOutputs));
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kAudioStream),
+                OnProcess(IsStreamInfo(_, kMsTimeScale, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample0Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kAudioStream),
+                OnProcess(IsCueEvent(_, kSample1StartInSeconds)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample1Start, kSampleDuration, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample2Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kAudioStream), OnFlush(_));
+  }
+
+  // The early promoted cue is inserted at the next video key frame.
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kVideoStream),
+                OnProcess(IsStreamInfo(_, kMsTimeScale, _, _)));
+    EXPECT_CALL(
+        *Output(kVideoStream),
+        OnProcess(IsMediaSample(_, kSample0Start, kSampleDuration, _, _)));
+    EXPECT_CALL(
+        *Output(kVideoStream),
+        OnProcess(IsMediaSample(_, kSample1Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kVideoStream),
+                OnProcess(IsCueEvent(_, kSample1StartInSeconds)));
+    EXPECT_CALL(
+        *Output(kVideoStream),
+        OnProcess(IsMediaSample(_, kSample2Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kVideoStream), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchAudioInfo(kAudioStream));
+  ASSERT_OK(DispatchVideoInfo(kVideoStream));
+
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample0Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample1Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample2Start, kSampleDuration,
+                                kKeyFrame));
+
+  ASSERT_OK(DispatchMediaSample(kVideoStream, kSample0Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kVideoStream, kSample1Start, kSampleDuration,
+                                !kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kVideoStream, kSample2Start, kSampleDuration,
+                                kKeyFrame));
+
+  ASSERT_OK(FlushAll({kAudioStream, kVideoStream}));
+}
+
 // TODO(kqyang): Add more tests, in particular, multi-thread tests.
 
 }  // namespace media
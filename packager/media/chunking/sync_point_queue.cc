@@ -6,15 +6,29 @@
 
 #include "packager/media/chunking/sync_point_queue.h"
 #include "packager/media/base/media_handler.h"
+#include "packager/metrics/metrics.h"
 
 #include <algorithm>
 #include <limits>
 
 namespace shaka {
 namespace media {
+namespace {
+
+void RecordWaitTime(base::TimeDelta wait_time) {
+  if (wait_time.InMicroseconds() <= 0)
+    return;
+  Metrics::GetInstance()->IncrementCounter(
+      "packager_sync_point_queue_wait_seconds_total",
+      "Time the cue alignment threads spent blocked waiting for each other.",
+      {}, wait_time.InSecondsF());
+}
+
+}  // namespace
 
 SyncPointQueue::SyncPointQueue(const AdCueGeneratorParams& params)
-    : sync_condition_(&lock_) {
+    : max_buffered_bytes_per_stream_(params.max_buffered_bytes_per_stream),
+      sync_condition_(&lock_) {
   for (const Cuepoint& point : params.cue_points) {
     std::shared_ptr<CueEvent> event = std::make_shared<CueEvent>();
     event->time_in_seconds = point.start_time_in_seconds;
@@ -31,6 +45,7 @@ void SyncPointQueue::Cancel() {
   {
     base::AutoLock auto_lock(lock_);
     cancelled_ = true;
+    promotion_epoch_.fetch_add(1, std::memory_order_release);
   }
   sync_condition_.Broadcast();
 }
@@ -53,40 +68,121 @@ double SyncPointQueue::GetHint(double time_in_seconds) {
 
 std::shared_ptr<const CueEvent> SyncPointQueue::GetNext(
     double hint_in_seconds) {
+  bool is_waiting = false;
+  return GetNext(hint_in_seconds, &is_waiting);
+}
+
+std::shared_ptr<const CueEvent> SyncPointQueue::GetNext(double hint_in_seconds,
+                                                        bool* is_waiting) {
+  DCHECK(is_waiting);
+
   base::AutoLock auto_lock(lock_);
+  base::TimeDelta wait_time;
   while (!cancelled_) {
-    // Find the promoted cue that would line up with our hint, which is the
-    // first cue that is not less than |hint_in_seconds|.
-    auto iter = promoted_.lower_bound(hint_in_seconds);
-    if (iter != promoted_.end()) {
-      return iter->second;
-    }
-
-    // Promote |hint_in_seconds| if everyone is waiting.
-    if (waiting_thread_count_ + 1 == thread_count_) {
-      std::shared_ptr<const CueEvent> cue = PromoteAtNoLocking(hint_in_seconds);
-      CHECK(cue);
+    std::shared_ptr<const CueEvent> cue =
+        GetNextNoLocking(hint_in_seconds, is_waiting);
+    if (cue) {
+      RecordWaitTime(wait_time);
       return cue;
     }
 
-    waiting_thread_count_++;
-    // This blocks until either a cue is promoted or all threads are blocked
+    // This blocks until either a cue is promoted or all threads are waiting
     // (in which case, the unpromoted cue at the hint will be self-promoted
-    // and returned - see section above). Spurious signal events are possible
-    // with most condition variable implementations, so if it returns, we go
-    // back and check if a cue is actually promoted or not.
+    // and returned - see GetNextNoLocking). Spurious signal events are
+    // possible with most condition variable implementations, so if it
+    // returns, we go back and check if a cue is actually promoted or not.
+    const base::TimeTicks wait_start_time = base::TimeTicks::Now();
     sync_condition_.Wait();
-    waiting_thread_count_--;
+    wait_time += base::TimeTicks::Now() - wait_start_time;
   }
+  StopWaitingNoLocking(hint_in_seconds, is_waiting);
+  RecordWaitTime(wait_time);
   return nullptr;
 }
 
+std::shared_ptr<const CueEvent> SyncPointQueue::TryGetNext(
+    double hint_in_seconds,
+    bool* is_waiting) {
+  DCHECK(is_waiting);
+
+  base::AutoLock auto_lock(lock_);
+  if (cancelled_)
+    return nullptr;
+  return GetNextNoLocking(hint_in_seconds, is_waiting);
+}
+
 std::shared_ptr<const CueEvent> SyncPointQueue::PromoteAt(
     double time_in_seconds) {
   base::AutoLock auto_lock(lock_);
   return PromoteAtNoLocking(time_in_seconds);
 }
 
+std::shared_ptr<const CueEvent> SyncPointQueue::PromoteEarly(
+    double hint_in_seconds) {
+  base::AutoLock auto_lock(lock_);
+
+  auto iter = promoted_.lower_bound(hint_in_seconds);
+  if (iter != promoted_.end())
+    return iter->second;
+
+  std::shared_ptr<const CueEvent> cue = PromoteAtNoLocking(hint_in_seconds);
+  if (cue)
+    early_promoted_.insert(hint_in_seconds);
+  return cue;
+}
+
+std::shared_ptr<const CueEvent> SyncPointQueue::GetEarlyPromoted(
+    double hint_in_seconds) const {
+  base::AutoLock auto_lock(lock_);
+
+  if (early_promoted_.find(hint_in_seconds) == early_promoted_.end())
+    return nullptr;
+  return promoted_.at(hint_in_seconds);
+}
+
+std::shared_ptr<const CueEvent> SyncPointQueue::GetNextNoLocking(
+    double hint_in_seconds,
+    bool* is_waiting) {
+  lock_.AssertAcquired();
+
+  // Find the promoted cue that would line up with our hint, which is the
+  // first cue that is not less than |hint_in_seconds|.
+  auto iter = promoted_.lower_bound(hint_in_seconds);
+  if (iter != promoted_.end()) {
+    StopWaitingNoLocking(hint_in_seconds, is_waiting);
+    return iter->second;
+  }
+
+  size_t& waiting_thread_count = waiting_thread_counts_[hint_in_seconds];
+  if (!*is_waiting) {
+    *is_waiting = true;
+    waiting_thread_count++;
+  }
+
+  // Promote |hint_in_seconds| if everyone is waiting.
+  if (waiting_thread_count == thread_count_) {
+    StopWaitingNoLocking(hint_in_seconds, is_waiting);
+    std::shared_ptr<const CueEvent> cue = PromoteAtNoLocking(hint_in_seconds);
+    CHECK(cue);
+    return cue;
+  }
+  return nullptr;
+}
+
+void SyncPointQueue::StopWaitingNoLocking(double hint_in_seconds,
+                                          bool* is_waiting) {
+  lock_.AssertAcquired();
+
+  if (!*is_waiting)
+    return;
+  *is_waiting = false;
+
+  auto iter = waiting_thread_counts_.find(hint_in_seconds);
+  DCHECK(iter != waiting_thread_counts_.end());
+  if (--iter->second == 0)
+    waiting_thread_counts_.erase(iter);
+}
+
 bool SyncPointQueue::HasMore(double hint_in_seconds) const {
   return hint_in_seconds < std::numeric_limits<double>::max();
 }
@@ -122,7 +218,8 @@ std::shared_ptr<const CueEvent> SyncPointQueue::PromoteAtNoLocking(
   // extra unused cues are simply ignored.
   unpromoted_.erase(unpromoted_.begin(), iter);
 
-  // Wake up other threads that may be waiting.
+  // Wake up other threads that may be waiting, either blocked or buffering.
+  promotion_epoch_.fetch_add(1, std::memory_order_release);
   sync_condition_.Broadcast();
   return std::move(cue);
 }
@@ -4,8 +4,10 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <set>
 
 #include "packager/base/synchronization/condition_variable.h"
 #include "packager/base/synchronization/lock.h"
@@ -38,20 +40,64 @@ class SyncPointQueue {
   /// @return The next cue based on a previous hint. If a cue has been promoted
   ///         that comes after @a hint_in_seconds it is returned. If no cue
   ///         after @a hint_in_seconds has been promoted, this will block until
-  ///         either a cue is promoted or all threads are blocked (in which
+  ///         either a cue is promoted or all threads are waiting (in which
   ///         case, the unpromoted cue at @a hint_in_seconds will be
   ///         self-promoted and returned) or Cancel() is called.
   std::shared_ptr<const CueEvent> GetNext(double hint_in_seconds);
 
+  /// Same as GetNext(double), but for a thread that may already be waiting at
+  /// @a hint_in_seconds after a call to TryGetNext().
+  /// @param is_waiting is the waiting state of the calling thread, as updated
+  ///        by TryGetNext(). It is reset when this function returns.
+  std::shared_ptr<const CueEvent> GetNext(double hint_in_seconds,
+                                          bool* is_waiting);
+
+  /// Non-blocking version of GetNext(). If no cue after @a hint_in_seconds
+  /// has been promoted, the calling thread is counted as waiting at the hint,
+  /// so that the last thread to reach the hint self-promotes it, but it can
+  /// keep buffering its samples instead of blocking. It should call this
+  /// function again when promotion_epoch() changes, or GetNext() once it
+  /// cannot buffer any more.
+  /// @param is_waiting is the waiting state of the calling thread. It should
+  ///        be false initially, and is updated by this function.
+  /// @return The next cue, or nullptr if it is not determined yet.
+  std::shared_ptr<const CueEvent> TryGetNext(double hint_in_seconds,
+                                             bool* is_waiting);
+
+  /// @return A counter that is incremented every time a cue is promoted or the
+  ///         queue is cancelled. It can be read without locking, so that
+  ///         waiting threads only look for a new cue when it changes.
+  uint64_t promotion_epoch() const {
+    return promotion_epoch_.load(std::memory_order_acquire);
+  }
+
   /// Promote the first cue that is not greater than @a time_in_seconds. All
   /// unpromoted cues before the cue will be discarded.
   std::shared_ptr<const CueEvent> PromoteAt(double time_in_seconds);
 
+  /// Promote the cue at @a hint_in_seconds without waiting for a video stream
+  /// to reach it. It is used when the streams of a thread buffered too much
+  /// while waiting for the cue.
+  /// @return The promoted cue. If a cue not less than @a hint_in_seconds has
+  ///         already been promoted, it is returned instead.
+  std::shared_ptr<const CueEvent> PromoteEarly(double hint_in_seconds);
+
+  /// @return The cue at @a hint_in_seconds if it was promoted with
+  ///         PromoteEarly(), or nullptr otherwise.
+  std::shared_ptr<const CueEvent> GetEarlyPromoted(
+      double hint_in_seconds) const;
+
   /// @return True if there are more cues after the given hint. The hint must
   ///         be a hint returned from |GetHint|. Using any other value results
   ///         in undefined behavior.
   bool HasMore(double hint_in_seconds) const;
 
+  /// @return The max size in bytes of the samples buffered per stream while
+  ///         waiting for a cue, 0 if there is no limit.
+  uint64_t max_buffered_bytes_per_stream() const {
+    return max_buffered_bytes_per_stream_;
+  }
+
  private:
   SyncPointQueue(const SyncPointQueue&) = delete;
   SyncPointQueue& operator=(const SyncPointQueue&) = delete;
@@ -60,14 +106,29 @@ class SyncPointQueue {
   // functions that have locks.
   std::shared_ptr<const CueEvent> PromoteAtNoLocking(double time_in_seconds);
 
-  base::Lock lock_;
+  // Return the cue for |hint_in_seconds| if it has been promoted, or promote
+  // it if all the other threads are waiting. It does not block.
+  std::shared_ptr<const CueEvent> GetNextNoLocking(double hint_in_seconds,
+                                                   bool* is_waiting);
+
+  // Remove the calling thread from the threads waiting at |hint_in_seconds|.
+  void StopWaitingNoLocking(double hint_in_seconds, bool* is_waiting);
+
+  const uint64_t max_buffered_bytes_per_stream_;
+
+  mutable base::Lock lock_;
   base::ConditionVariable sync_condition_;
   size_t thread_count_ = 0;
-  size_t waiting_thread_count_ = 0;
+  // The number of threads waiting at each hint. A thread that was waiting at
+  // a hint is only counted for the next hint once it gets the cue.
+  std::map<double, size_t> waiting_thread_counts_;
   bool cancelled_ = false;
+  std::atomic<uint64_t> promotion_epoch_{0};
 
   std::map<double, std::shared_ptr<CueEvent>> unpromoted_;
   std::map<double, std::shared_ptr<CueEvent>> promoted_;
+  // The subset of |promoted_| that was promoted with PromoteEarly().
+  std::set<double> early_promoted_;
 };
 
 }  // namespace media
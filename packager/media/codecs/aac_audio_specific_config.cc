@@ -141,6 +141,19 @@ bool AACAudioSpecificConfig::ConvertToADTS(
     const uint8_t* data,
     size_t data_size,
     std::vector<uint8_t>* audio_frame) const {
+  uint8_t header[kADTSHeaderSize];
+  if (!WriteADTSHeader(data_size, header))
+    return false;
+
+  audio_frame->reserve(kADTSHeaderSize + data_size);
+  audio_frame->assign(header, header + kADTSHeaderSize);
+  audio_frame->insert(audio_frame->end(), data, data + data_size);
+
+  return true;
+}
+
+bool AACAudioSpecificConfig::WriteADTSHeader(size_t data_size,
+                                             uint8_t* header) const {
   DCHECK(audio_object_type_ >= 1 && audio_object_type_ <= 4 &&
          frequency_index_ != 0xf && channel_config_ <= 7);
 
@@ -150,21 +163,15 @@ bool AACAudioSpecificConfig::ConvertToADTS(
   if (size >= (1 << 13))
     return false;
 
-  audio_frame->reserve(size);
-  audio_frame->resize(kADTSHeaderSize);
-
-  audio_frame->at(0) = 0xff;
-  audio_frame->at(1) = 0xf1;
-  audio_frame->at(2) = ((audio_object_type_ - 1) << 6) +
-                       (frequency_index_ << 2) + (channel_config_ >> 2);
-  audio_frame->at(3) =
+  header[0] = 0xff;
+  header[1] = 0xf1;
+  header[2] = ((audio_object_type_ - 1) << 6) + (frequency_index_ << 2) +
+              (channel_config_ >> 2);
+  header[3] =
       ((channel_config_ & 0x3) << 6) + static_cast<uint8_t>(size >> 11);
-  audio_frame->at(4) = static_cast<uint8_t>((size & 0x7ff) >> 3);
-  audio_frame->at(5) = static_cast<uint8_t>(((size & 7) << 5) + 0x1f);
-  audio_frame->at(6) = 0xfc;
-
-  audio_frame->insert(audio_frame->end(), data, data + data_size);
-
+  header[4] = static_cast<uint8_t>((size & 0x7ff) >> 3);
+  header[5] = static_cast<uint8_t>(((size & 7) << 5) + 0x1f);
+  header[6] = 0xfc;
   return true;
 }
 
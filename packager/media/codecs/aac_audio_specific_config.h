@@ -93,6 +93,14 @@ class AACAudioSpecificConfig {
                              size_t data_size,
                              std::vector<uint8_t>* audio_frame) const;
 
+  /// Write the ADTS header of a raw AAC frame, so that the frame can be
+  /// written after it without being copied.
+  /// @param data_size the size of a raw AAC frame.
+  /// @param[out] header points to a buffer of kADTSHeaderSize bytes, which
+  ///             receives the header if successful.
+  /// @return true on success, false if the frame is too large for ADTS.
+  virtual bool WriteADTSHeader(size_t data_size, uint8_t* header) const;
+
   /// @return The audio object type for this AAC config, with possible extension
   ///         considered.
   AudioObjectType GetAudioObjectType() const;
@@ -170,5 +170,34 @@ TEST(AACAudioSpecificConfigTest, IncorrectChannelTest) {
   EXPECT_TRUE(aac_audio_specific_config.Parse(data));
 }
 
+TEST(AACAudioSpecificConfigTest, ConvertToADTS) {
+  AACAudioSpecificConfig aac_audio_specific_config;
+  const std::vector<uint8_t> config = {0x12, 0x10};
+  ASSERT_TRUE(aac_audio_specific_config.Parse(config));
+
+  const uint8_t kRawFrame[] = {0x01, 0x02, 0x03};
+  const uint8_t kExpectedAdtsFrame[] = {
+      0xFF, 0xF1, 0x50, 0x80, 0x01, 0x5F, 0xFC, 0x01, 0x02, 0x03,
+  };
+  std::vector<uint8_t> audio_frame;
+  ASSERT_TRUE(aac_audio_specific_config.ConvertToADTS(
+      kRawFrame, sizeof(kRawFrame), &audio_frame));
+  EXPECT_EQ(std::vector<uint8_t>(std::begin(kExpectedAdtsFrame),
+                                 std::end(kExpectedAdtsFrame)),
+            audio_frame);
+
+  uint8_t header[AACAudioSpecificConfig::kADTSHeaderSize];
+  ASSERT_TRUE(
+      aac_audio_specific_config.WriteADTSHeader(sizeof(kRawFrame), header));
+  EXPECT_EQ(std::vector<uint8_t>(std::begin(kExpectedAdtsFrame),
+                                 std::begin(kExpectedAdtsFrame) +
+                                     sizeof(header)),
+            std::vector<uint8_t>(std::begin(header), std::end(header)));
+
+  // ADTS frame sizes are 13-bit.
+  EXPECT_FALSE(aac_audio_specific_config.WriteADTSHeader(
+      (1 << 13) - AACAudioSpecificConfig::kADTSHeaderSize, header));
+}
+
 }  // namespace media
 }  // namespace shaka
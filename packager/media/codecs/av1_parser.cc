@@ -259,14 +259,15 @@ bool AV1Parser::Parse(const uint8_t* data,
 
   BitReader reader(data, data_size);
   while (reader.bits_available() > 0) {
-    if (!ParseOpenBitstreamUnit(&reader, tiles))
+    if (!ParseOpenBitstreamUnit(data, &reader, tiles))
       return false;
   }
   return true;
 }
 
 // 5.3.1. General OBU syntax.
-bool AV1Parser::ParseOpenBitstreamUnit(BitReader* reader,
+bool AV1Parser::ParseOpenBitstreamUnit(const uint8_t* data,
+                                       BitReader* reader,
                                        std::vector<Tile>* tiles) {
   ObuHeader obu_header;
   RCHECK(ParseObuHeader(reader, &obu_header));
@@ -279,13 +280,29 @@ bool AV1Parser::ParseOpenBitstreamUnit(BitReader* reader,
 
   VLOG(4) << "OBU " << obu_header.obu_type << " size " << obu_size;
 
+  RCHECK(reader->bits_available() >= obu_size * 8);
   const size_t start_position = reader->bit_position();
+  // OBUs are byte aligned.
+  const uint8_t* payload = data + start_position / 8;
   switch (obu_header.obu_type) {
     case OBU_SEQUENCE_HEADER:
+      // The sequence header is usually repeated unchanged before every key
+      // frame, so it is only parsed again if it changes.
+      if (obu_size == sequence_header_payload_.size() &&
+          std::equal(payload, payload + obu_size,
+                     sequence_header_payload_.begin())) {
+        return reader->SkipBits(obu_size * 8);
+      }
+      sequence_header_payload_.clear();
       RCHECK(ParseSequenceHeaderObu(reader));
+      sequence_header_payload_.assign(payload, payload + obu_size);
       break;
     case OBU_FRAME_HEADER:
     case OBU_REDUNDENT_FRAME_HEADER:
+      // A copy of the frame header of the current frame, which is identical
+      // to it, need not be parsed.
+      if (frame_header_.seen_frame_header)
+        return reader->SkipBits(obu_size * 8);
       RCHECK(ParseFrameHeaderObu(obu_header, reader));
       break;
     case OBU_TILE_GROUP:
@@ -295,9 +312,8 @@ bool AV1Parser::ParseOpenBitstreamUnit(BitReader* reader,
       RCHECK(ParseFrameObu(obu_header, obu_size, reader, tiles));
       break;
     default:
-      // Skip all OBUs we are not interested.
-      RCHECK(reader->SkipBits(obu_size * 8));
-      break;
+      // Skip all OBUs we are not interested, including their trailing bits.
+      return reader->SkipBits(obu_size * 8);
   }
 
   const size_t current_position = reader->bit_position();
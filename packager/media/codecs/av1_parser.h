@@ -195,7 +195,10 @@ class AV1Parser {
     bool subsampling_y = false;
   };
 
-  bool ParseOpenBitstreamUnit(BitReader* reader, std::vector<Tile>* tiles);
+  // |data| is the start of the data |reader| reads.
+  bool ParseOpenBitstreamUnit(const uint8_t* data,
+                              BitReader* reader,
+                              std::vector<Tile>* tiles);
   bool ParseObuHeader(BitReader* reader, ObuHeader* obu_header);
   bool ParseObuExtensionHeader(BitReader* reader,
                                ObuExtensionHeader* obu_extension_header);
@@ -277,6 +280,8 @@ class AV1Parser {
   int GetQIndex(bool ignore_delta_q, int segment_id);
 
   SequenceHeaderObu sequence_header_;
+  // The payload of the sequence header OBU |sequence_header_| is parsed from.
+  std::vector<uint8_t> sequence_header_payload_;
   FrameHeaderObu frame_header_;
   static constexpr int kNumRefFrames = 8;
   ReferenceFrame reference_frames_[kNumRefFrames];
@@ -30,5 +30,29 @@ TEST(AV1ParserTest, ParseIFrameSuccess) {
   EXPECT_THAT(tiles, ElementsAre(AV1Parser::Tile{0x1d, 0x4e1}));
 }
 
+TEST(AV1ParserTest, ParseRepeatedIFrames) {
+  const std::vector<uint8_t> buffer = ReadTestDataFile("av1-I-frame-320x240");
+
+  AV1Parser parser;
+  std::vector<AV1Parser::Tile> tiles;
+  ASSERT_TRUE(parser.Parse(buffer.data(), buffer.size(), &tiles));
+  // The repeated sequence header is not parsed again.
+  ASSERT_TRUE(parser.Parse(buffer.data(), buffer.size(), &tiles));
+  EXPECT_THAT(tiles, ElementsAre(AV1Parser::Tile{0x1d, 0x4e1}));
+}
+
+TEST(AV1ParserTest, SkipMetadataObu) {
+  std::vector<uint8_t> buffer = ReadTestDataFile("av1-I-frame-320x240");
+  // Insert a metadata OBU with a 2-byte payload after the temporal delimiter.
+  const uint8_t kMetadataObu[] = {0x2a, 0x02, 0x01, 0x00};
+  buffer.insert(buffer.begin() + 2, std::begin(kMetadataObu),
+                std::end(kMetadataObu));
+
+  AV1Parser parser;
+  std::vector<AV1Parser::Tile> tiles;
+  ASSERT_TRUE(parser.Parse(buffer.data(), buffer.size(), &tiles));
+  EXPECT_THAT(tiles, ElementsAre(AV1Parser::Tile{0x21, 0x4e1}));
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -138,5 +138,83 @@ TEST(H264ByteToUnitStreamConverter, NaluConversionWithSpsExtension) {
             std::end(kExpectedDecoderConfig)), decoder_config);          
 }
 
+TEST(H264ByteToUnitStreamConverter, ConvertInPlace) {
+  std::vector<uint8_t> input_frame =
+      ReadTestDataFile("avc-byte-stream-frame.h264");
+  ASSERT_FALSE(input_frame.empty());
+
+  std::vector<uint8_t> expected_output_frame =
+      ReadTestDataFile("avc3-unit-stream-frame.h264");
+  ASSERT_FALSE(expected_output_frame.empty());
+
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithParameterSetNalus);
+  uint8_t* converted_frame;
+  size_t converted_frame_size;
+  std::vector<uint8_t> output_frame;
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStreamInPlace(
+      input_frame.data(), input_frame.size(), &converted_frame,
+      &converted_frame_size, &output_frame));
+  if (converted_frame) {
+    output_frame.assign(converted_frame,
+                        converted_frame + converted_frame_size);
+  }
+  EXPECT_EQ(expected_output_frame, output_frame);
+}
+
+TEST(H264ByteToUnitStreamConverter, ConvertInPlaceWithLeadingAud) {
+  std::vector<uint8_t> input_frame = {
+      0x00, 0x00, 0x00, 0x01, 0x09, 0xF0,              // AUD.
+      0x00, 0x00, 0x00, 0x01, 0x06, 0x05, 0x01, 0x80,  // SEI.
+      0x00, 0x00, 0x00, 0x01, 0x41, 0x9A, 0x02, 0x03,  // Slice.
+  };
+
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus);
+  uint8_t* converted_frame;
+  size_t converted_frame_size;
+  std::vector<uint8_t> output_frame;
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStreamInPlace(
+      input_frame.data(), input_frame.size(), &converted_frame,
+      &converted_frame_size, &output_frame));
+
+  // The AUD is skipped and the start codes are overwritten.
+  EXPECT_EQ(input_frame.data() + 6, converted_frame);
+  const std::vector<uint8_t> kExpectedOutputFrame = {
+      0x00, 0x00, 0x00, 0x04, 0x06, 0x05, 0x01, 0x80,
+      0x00, 0x00, 0x00, 0x04, 0x41, 0x9A, 0x02, 0x03,
+  };
+  EXPECT_EQ(kExpectedOutputFrame,
+            std::vector<uint8_t>(converted_frame,
+                                 converted_frame + converted_frame_size));
+  EXPECT_TRUE(output_frame.empty());
+}
+
+TEST(H264ByteToUnitStreamConverter, ConvertInPlaceFallsBackToCopy) {
+  const std::vector<uint8_t> kInputFrame = {
+      0x00, 0x00, 0x00, 0x01, 0x06, 0x05, 0x01, 0x80,  // SEI.
+      0x00, 0x00, 0x01, 0x41, 0x9A, 0x02, 0x03,        // Slice.
+  };
+
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus);
+  std::vector<uint8_t> input_frame = kInputFrame;
+  uint8_t* converted_frame;
+  size_t converted_frame_size;
+  std::vector<uint8_t> output_frame;
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStreamInPlace(
+      input_frame.data(), input_frame.size(), &converted_frame,
+      &converted_frame_size, &output_frame));
+
+  // The 3-byte start code cannot be overwritten with a 4-byte length.
+  EXPECT_EQ(nullptr, converted_frame);
+  EXPECT_EQ(0u, converted_frame_size);
+  EXPECT_EQ(kInputFrame, input_frame);
+  std::vector<uint8_t> expected_output_frame;
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStream(
+      kInputFrame.data(), kInputFrame.size(), &expected_output_frame));
+  EXPECT_EQ(expected_output_frame, output_frame);
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -177,10 +177,14 @@ H264Parser::H264Parser() {}
 H264Parser::~H264Parser() {}
 
 const H264Pps* H264Parser::GetPps(int pps_id) {
+  if (pps_id < 0 || pps_id >= kMaxPpsCount)
+    return nullptr;
   return active_PPSes_[pps_id].get();
 }
 
 const H264Sps* H264Parser::GetSps(int sps_id) {
+  if (sps_id < 0 || sps_id >= kMaxSpsCount)
+    return nullptr;
   return active_SPSes_[sps_id].get();
 }
 
@@ -598,7 +602,7 @@ H264Parser::Result H264Parser::ParseSps(const Nalu& nalu, int* sps_id) {
   READ_BITS_OR_RETURN(2, &data);  // reserved_zero_2bits
   READ_BITS_OR_RETURN(8, &sps->level_idc);
   READ_UE_OR_RETURN(&sps->seq_parameter_set_id);
-  TRUE_OR_RETURN(sps->seq_parameter_set_id < 32);
+  TRUE_OR_RETURN(sps->seq_parameter_set_id < kMaxSpsCount);
 
   if (sps->profile_idc == 100 || sps->profile_idc == 110 ||
       sps->profile_idc == 122 || sps->profile_idc == 244 ||
@@ -710,8 +714,9 @@ H264Parser::Result H264Parser::ParsePps(const Nalu& nalu, int* pps_id) {
   std::unique_ptr<H264Pps> pps(new H264Pps());
 
   READ_UE_OR_RETURN(&pps->pic_parameter_set_id);
+  TRUE_OR_RETURN(pps->pic_parameter_set_id < kMaxPpsCount);
   READ_UE_OR_RETURN(&pps->seq_parameter_set_id);
-  TRUE_OR_RETURN(pps->seq_parameter_set_id < 32);
+  TRUE_OR_RETURN(pps->seq_parameter_set_id < kMaxSpsCount);
 
   sps = GetSps(pps->seq_parameter_set_id);
   TRUE_OR_RETURN(sps);
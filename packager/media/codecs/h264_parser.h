@@ -10,7 +10,6 @@
 #include <stdint.h>
 #include <stdlib.h>
 
-#include <map>
 #include <memory>
 
 #include "packager/media/codecs/h26x_bit_reader.h"
@@ -321,11 +320,13 @@ class H264Parser {
   // Parse decoded reference picture marking information (see spec).
   Result ParseDecRefPicMarking(H26xBitReader* br, H264SliceHeader* shdr);
 
-  // PPSes and SPSes stored for future reference.
-  typedef std::map<int, std::unique_ptr<H264Sps>> SpsById;
-  typedef std::map<int, std::unique_ptr<H264Pps>> PpsById;
-  SpsById active_SPSes_;
-  PpsById active_PPSes_;
+  // The SPS and PPS ids are in [0, 31] and [0, 255], see 7.4.2.1.1 and
+  // 7.4.2.2 of the spec.
+  enum { kMaxSpsCount = 32, kMaxPpsCount = 256 };
+
+  // PPSes and SPSes stored for future reference, indexed by id.
+  std::unique_ptr<H264Sps> active_SPSes_[kMaxSpsCount];
+  std::unique_ptr<H264Pps> active_PPSes_[kMaxPpsCount];
 
   DISALLOW_COPY_AND_ASSIGN(H264Parser);
 };
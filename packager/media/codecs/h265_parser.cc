@@ -182,8 +182,24 @@ H265Parser::~H265Parser() {}
 
 H265Parser::Result H265Parser::ParseSliceHeader(const Nalu& nalu,
                                                 H265SliceHeader* slice_header) {
-  DCHECK(nalu.is_video_slice());
   *slice_header = H265SliceHeader();
+  return ParseSliceHeaderInternal(nalu, false, slice_header);
+}
+
+H265Parser::Result H265Parser::ParseSliceHeaderSize(const Nalu& nalu,
+                                                    size_t* header_bit_size) {
+  // Its vectors are left empty, so it is not allocated on the heap.
+  H265SliceHeader slice_header;
+  OK_OR_RETURN(ParseSliceHeaderInternal(nalu, true, &slice_header));
+  *header_bit_size = slice_header.header_bit_size;
+  return kOk;
+}
+
+H265Parser::Result H265Parser::ParseSliceHeaderInternal(
+    const Nalu& nalu,
+    bool header_size_only,
+    H265SliceHeader* slice_header) {
+  DCHECK(nalu.is_video_slice());
 
   // Parses whole element.
   H26xBitReader reader;
@@ -248,7 +264,8 @@ H265Parser::Result H265Parser::ParseSliceHeader(const Nalu& nalu,
 
         const int pic_count =
             slice_header->num_long_term_sps + slice_header->num_long_term_pics;
-        slice_header->long_term_pics_info.resize(pic_count);
+        if (!header_size_only)
+          slice_header->long_term_pics_info.resize(pic_count);
         for (int i = 0; i < pic_count; i++) {
           if (i < slice_header->num_long_term_sps) {
             int lt_idx_sps = 0;
@@ -266,12 +283,12 @@ H265Parser::Result H265Parser::ParseSliceHeader(const Nalu& nalu,
             if (used_by_curr_pic_lt_flag)
               slice_header->used_by_curr_pic_lt++;
           }
-          TRUE_OR_RETURN(br->ReadBool(&slice_header->long_term_pics_info[i]
-                                           .delta_poc_msb_present_flag));
-          if (slice_header->long_term_pics_info[i].delta_poc_msb_present_flag) {
-            TRUE_OR_RETURN(br->ReadUE(
-                &slice_header->long_term_pics_info[i].delta_poc_msb_cycle_lt));
-          }
+          H265SliceHeader::LongTermPicsInfo info = {false, 0};
+          TRUE_OR_RETURN(br->ReadBool(&info.delta_poc_msb_present_flag));
+          if (info.delta_poc_msb_present_flag)
+            TRUE_OR_RETURN(br->ReadUE(&info.delta_poc_msb_cycle_lt));
+          if (!header_size_only)
+            slice_header->long_term_pics_info[i] = info;
         }
       }
 
@@ -376,12 +393,17 @@ H265Parser::Result H265Parser::ParseSliceHeader(const Nalu& nalu,
     TRUE_OR_RETURN(br->ReadUE(&slice_header->num_entry_point_offsets));
     if (slice_header->num_entry_point_offsets > 0) {
       TRUE_OR_RETURN(br->ReadUE(&slice_header->offset_len_minus1));
-      slice_header->entry_point_offset_minus1.resize(
-          slice_header->num_entry_point_offsets);
-      for (int i = 0; i < slice_header->num_entry_point_offsets; i++) {
-        TRUE_OR_RETURN(
-            br->ReadBits(slice_header->offset_len_minus1 + 1,
-                         &slice_header->entry_point_offset_minus1[i]));
+      if (header_size_only) {
+        for (int i = 0; i < slice_header->num_entry_point_offsets; i++)
+          TRUE_OR_RETURN(br->SkipBits(slice_header->offset_len_minus1 + 1));
+      } else {
+        slice_header->entry_point_offset_minus1.resize(
+            slice_header->num_entry_point_offsets);
+        for (int i = 0; i < slice_header->num_entry_point_offsets; i++) {
+          TRUE_OR_RETURN(
+              br->ReadBits(slice_header->offset_len_minus1 + 1,
+                           &slice_header->entry_point_offset_minus1[i]));
+        }
       }
     }
   }
@@ -410,7 +432,9 @@ H265Parser::Result H265Parser::ParsePps(const Nalu& nalu, int* pps_id) {
   std::unique_ptr<H265Pps> pps(new H265Pps);
 
   TRUE_OR_RETURN(br->ReadUE(&pps->pic_parameter_set_id));
+  TRUE_OR_RETURN(pps->pic_parameter_set_id < kMaxPpsCount);
   TRUE_OR_RETURN(br->ReadUE(&pps->seq_parameter_set_id));
+  TRUE_OR_RETURN(pps->seq_parameter_set_id < kMaxSpsCount);
 
   TRUE_OR_RETURN(br->ReadBool(&pps->dependent_slice_segments_enabled_flag));
   TRUE_OR_RETURN(br->ReadBool(&pps->output_flag_present_flag));
@@ -526,6 +550,7 @@ H265Parser::Result H265Parser::ParseSps(const Nalu& nalu, int* sps_id) {
       ReadProfileTierLevel(true, sps->max_sub_layers_minus1, br, sps.get()));
 
   TRUE_OR_RETURN(br->ReadUE(&sps->seq_parameter_set_id));
+  TRUE_OR_RETURN(sps->seq_parameter_set_id < kMaxSpsCount);
   TRUE_OR_RETURN(br->ReadUE(&sps->chroma_format_idc));
   if (sps->chroma_format_idc == 3) {
     TRUE_OR_RETURN(br->ReadBool(&sps->separate_colour_plane_flag));
@@ -624,10 +649,14 @@ H265Parser::Result H265Parser::ParseSps(const Nalu& nalu, int* sps_id) {
 }
 
 const H265Pps* H265Parser::GetPps(int pps_id) {
+  if (pps_id < 0 || pps_id >= kMaxPpsCount)
+    return nullptr;
   return active_ppses_[pps_id].get();
 }
 
 const H265Sps* H265Parser::GetSps(int sps_id) {
+  if (sps_id < 0 || sps_id >= kMaxSpsCount)
+    return nullptr;
   return active_spses_[sps_id].get();
 }
 
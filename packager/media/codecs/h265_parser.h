@@ -7,7 +7,6 @@
 #ifndef PACKAGER_MEDIA_CODECS_H265_PARSER_H_
 #define PACKAGER_MEDIA_CODECS_H265_PARSER_H_
 
-#include <map>
 #include <memory>
 #include <vector>
 
@@ -300,6 +299,13 @@ class H265Parser {
   /// contents of |*slice_header| are undefined.
   Result ParseSliceHeader(const Nalu& nalu, H265SliceHeader* slice_header);
 
+  /// Parses a video slice header only as far as needed to find its size, e.g.
+  /// for subsample encryption. The fields which do not affect the size, like
+  /// the entry point offsets, are skipped instead of being stored.
+  /// @param header_bit_size receives the size of the slice header in bits,
+  ///        not including the NALU header, if kOk is returned.
+  Result ParseSliceHeaderSize(const Nalu& nalu, size_t* header_bit_size);
+
   /// Parses a PPS element.  This object is owned and managed by this class.
   /// The unique ID of the parsed PPS is stored in |*pps_id| if kOk is returned.
   Result ParsePps(const Nalu& nalu, int* pps_id);
@@ -313,6 +319,14 @@ class H265Parser {
   const H265Sps* GetSps(int sps_id);
 
  private:
+  // The SPS and PPS ids are in [0, 15] and [0, 63], see 7.4.3.2.1 and
+  // 7.4.3.3.1 of the spec.
+  enum { kMaxSpsCount = 16, kMaxPpsCount = 64 };
+
+  Result ParseSliceHeaderInternal(const Nalu& nalu,
+                                  bool header_size_only,
+                                  H265SliceHeader* slice_header);
+
   Result ParseVuiParameters(int max_num_sub_layers_minus1,
                             H26xBitReader* br,
                             H265VuiParameters* vui);
@@ -354,11 +368,9 @@ class H265Parser {
 
   Result ByteAlignment(H26xBitReader* br);
 
-  typedef std::map<int, std::unique_ptr<H265Sps>> SpsById;
-  typedef std::map<int, std::unique_ptr<H265Pps>> PpsById;
-
-  SpsById active_spses_;
-  PpsById active_ppses_;
+  // Indexed by id, so that slice headers look them up without searching.
+  std::unique_ptr<H265Sps> active_spses_[kMaxSpsCount];
+  std::unique_ptr<H265Pps> active_ppses_[kMaxPpsCount];
 
   DISALLOW_COPY_AND_ASSIGN(H265Parser);
 };
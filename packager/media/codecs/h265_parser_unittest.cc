@@ -90,6 +90,39 @@ TEST(H265ParserTest, ParseSliceHeader_NonIDR) {
   EXPECT_EQ(128u, header.header_bit_size);
 }
 
+TEST(H265ParserTest, ParseSliceHeaderSize) {
+  int id;
+  Nalu nalu;
+  H265Parser parser;
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH265, kSpsData, arraysize(kSpsData)));
+  ASSERT_EQ(H265Parser::kOk, parser.ParseSps(nalu, &id));
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH265, kPpsData, arraysize(kPpsData)));
+  ASSERT_EQ(H265Parser::kOk, parser.ParsePps(nalu, &id));
+
+  size_t header_bit_size = 0;
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH265, kSliceData, arraysize(kSliceData)));
+  ASSERT_EQ(H265Parser::kOk,
+            parser.ParseSliceHeaderSize(nalu, &header_bit_size));
+  EXPECT_EQ(88u, header_bit_size);
+
+  ASSERT_TRUE(
+      nalu.Initialize(Nalu::kH265, kSliceData2, arraysize(kSliceData2)));
+  ASSERT_EQ(H265Parser::kOk,
+            parser.ParseSliceHeaderSize(nalu, &header_bit_size));
+  EXPECT_EQ(128u, header_bit_size);
+}
+
+TEST(H265ParserTest, ParseSliceHeaderWithUnknownPps) {
+  Nalu nalu;
+  H265Parser parser;
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH265, kSliceData, arraysize(kSliceData)));
+  size_t header_bit_size = 0;
+  EXPECT_NE(H265Parser::kOk,
+            parser.ParseSliceHeaderSize(nalu, &header_bit_size));
+  EXPECT_EQ(nullptr, parser.GetPps(1000));
+  EXPECT_EQ(nullptr, parser.GetSps(-1));
+}
+
 TEST(H265ParserTest, ParseSps) {
   Nalu nalu;
   ASSERT_TRUE(nalu.Initialize(Nalu::kH265, kSpsData, arraysize(kSpsData)));
@@ -2,7 +2,10 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string.h>
+
 #include "packager/base/logging.h"
+#include "packager/base/sys_byteorder.h"
 #include "packager/media/codecs/h26x_bit_reader.h"
 
 namespace shaka {
@@ -14,15 +17,39 @@ bool CheckAnyBitsSet(int byte, int valid_bits) {
   return (byte & ((1 << valid_bits) - 1)) != 0;
 }
 
+// Check if any of the bytes of |word| is zero.
+bool HasZeroByte(uint64_t word) {
+  return ((word - 0x0101010101010101ull) & ~word & 0x8080808080808080ull) !=
+         0;
+}
+
+// |value| should not be zero.
+int CountLeadingZeros(uint64_t value) {
+  DCHECK_NE(value, 0u);
+#if defined(__GNUC__)
+  return __builtin_clzll(value);
+#else
+  int num_zeros = 0;
+  for (int shift = 32; shift > 0; shift /= 2) {
+    if ((value >> (64 - shift)) == 0) {
+      num_zeros += shift;
+      value <<= shift;
+    }
+  }
+  return num_zeros;
+#endif
+}
+
 }  // namespace
 
 H26xBitReader::H26xBitReader()
     : data_(NULL),
       bytes_left_(0),
-      curr_byte_(0),
-      num_remaining_bits_in_curr_byte_(0),
+      cache_(0),
+      bits_in_cache_(0),
+      num_loaded_bytes_(0),
       prev_two_bytes_(0),
-      emulation_prevention_bytes_(0) {}
+      curr_byte_started_(false) {}
 
 H26xBitReader::~H26xBitReader() {}
 
@@ -34,25 +61,59 @@ bool H26xBitReader::Initialize(const uint8_t* data, off_t size) {
 
   data_ = data;
   bytes_left_ = size;
-  num_remaining_bits_in_curr_byte_ = 0;
+  cache_ = 0;
+  bits_in_cache_ = 0;
+  num_loaded_bytes_ = 0;
   // Initially set to 0xffff to accept all initial two-byte sequences.
   prev_two_bytes_ = 0xffff;
-  emulation_prevention_bytes_ = 0;
+  curr_byte_started_ = false;
+  emulation_prevention_byte_positions_.clear();
 
   return true;
 }
 
-bool H26xBitReader::UpdateCurrByte() {
+void H26xBitReader::Refill() {
+  while (bits_in_cache_ <= 56 && bytes_left_ > 0) {
+    const int num_bytes = (64 - bits_in_cache_) / 8;
+    // Emulation prevention bytes follow two zero bytes, so there are none in
+    // the next bytes if none of them is zero, and the last two bytes loaded
+    // are not both zero.
+    if (bytes_left_ >= 8 && prev_two_bytes_ != 0) {
+      uint64_t word;
+      memcpy(&word, data_, sizeof(word));
+      word = base::NetToHost64(word);
+      const int shift = 64 - 8 * num_bytes;
+      const uint64_t bytes = word >> shift;
+      // Pad the unused bytes, so that they are not taken for zero bytes.
+      const uint64_t padding = shift == 0 ? 0 : ~0ull << (8 * num_bytes);
+      if (!HasZeroByte(bytes | padding)) {
+        cache_ |= bytes << (shift - bits_in_cache_);
+        bits_in_cache_ += 8 * num_bytes;
+        data_ += num_bytes;
+        bytes_left_ -= num_bytes;
+        num_loaded_bytes_ += num_bytes;
+        prev_two_bytes_ = num_bytes >= 2
+                              ? static_cast<int>(bytes & 0xffff)
+                              : ((prev_two_bytes_ << 8) | bytes) & 0xffff;
+        continue;
+      }
+    }
+    if (!LoadByte())
+      return;
+  }
+}
+
+bool H26xBitReader::LoadByte() {
   if (bytes_left_ < 1)
     return false;
 
   // Emulation prevention three-byte detection.
   // If a sequence of 0x000003 is found, skip (ignore) the last byte (0x03).
-  if (*data_ == 0x03 && (prev_two_bytes_ & 0xffff) == 0) {
+  if (*data_ == 0x03 && prev_two_bytes_ == 0) {
     // Detected 0x000003, skip last byte.
     ++data_;
     --bytes_left_;
-    ++emulation_prevention_bytes_;
+    emulation_prevention_byte_positions_.push_back(num_loaded_bytes_);
     // Need another full three bytes before we can detect the sequence again.
     prev_two_bytes_ = 0xffff;
 
@@ -61,75 +122,103 @@ bool H26xBitReader::UpdateCurrByte() {
   }
 
   // Load a new byte and advance pointers.
-  curr_byte_ = *data_++ & 0xff;
+  const int byte = *data_++;
   --bytes_left_;
-  num_remaining_bits_in_curr_byte_ = 8;
-
-  prev_two_bytes_ = (prev_two_bytes_ << 8) | curr_byte_;
+  cache_ |= static_cast<uint64_t>(byte) << (56 - bits_in_cache_);
+  bits_in_cache_ += 8;
+  ++num_loaded_bytes_;
 
+  prev_two_bytes_ = ((prev_two_bytes_ << 8) | byte) & 0xffff;
   return true;
 }
 
+void H26xBitReader::ConsumeBits(int num_bits) {
+  DCHECK_LE(num_bits, bits_in_cache_);
+  cache_ = num_bits < 64 ? cache_ << num_bits : 0;
+  bits_in_cache_ -= num_bits;
+  curr_byte_started_ = false;
+}
+
+size_t H26xBitReader::NumEmulationPreventionBytesInCache(
+    size_t num_cached_bytes) const {
+  size_t count = 0;
+  for (auto it = emulation_prevention_byte_positions_.rbegin();
+       it != emulation_prevention_byte_positions_.rend() &&
+       *it + num_cached_bytes >= num_loaded_bytes_;
+       ++it) {
+    ++count;
+  }
+  return count;
+}
+
+size_t H26xBitReader::NumBytesAfterCurrentByte() const {
+  const size_t num_cached_bytes = bits_in_cache_ / 8;
+  return curr_byte_started_ && bits_in_cache_ % 8 == 0 ? num_cached_bytes - 1
+                                                       : num_cached_bytes;
+}
+
 // Read |num_bits| (1 to 31 inclusive) from the stream and return them
 // in |out|, with first bit in the stream as MSB in |out| at position
 // (|num_bits| - 1).
 bool H26xBitReader::ReadBits(int num_bits, int* out) {
-  int bits_left = num_bits;
-  *out = 0;
   DCHECK(num_bits <= 31);
+  *out = 0;
+  if (num_bits == 0)
+    return true;
 
-  while (num_remaining_bits_in_curr_byte_ < bits_left) {
-    // Take all that's left in current byte, shift to make space for the rest.
-    *out |= (curr_byte_ << (bits_left - num_remaining_bits_in_curr_byte_));
-    bits_left -= num_remaining_bits_in_curr_byte_;
-
-    if (!UpdateCurrByte())
+  if (bits_in_cache_ < num_bits) {
+    Refill();
+    if (bits_in_cache_ < num_bits)
       return false;
   }
-
-  *out |= (curr_byte_ >> (num_remaining_bits_in_curr_byte_ - bits_left));
-  *out &= ((1 << num_bits) - 1);
-  num_remaining_bits_in_curr_byte_ -= bits_left;
-
+  *out = static_cast<int>(cache_ >> (64 - num_bits));
+  ConsumeBits(num_bits);
   return true;
 }
 
 bool H26xBitReader::SkipBits(int num_bits) {
-  int bits_left = num_bits;
-  while (num_remaining_bits_in_curr_byte_ < bits_left) {
-    bits_left -= num_remaining_bits_in_curr_byte_;
-    if (!UpdateCurrByte())
-      return false;
+  if (num_bits <= bits_in_cache_) {
+    ConsumeBits(num_bits);
+    return true;
   }
+  if (num_bits > NumBitsLeft())
+    return false;
 
-  num_remaining_bits_in_curr_byte_ -= bits_left;
+  while (num_bits > bits_in_cache_) {
+    num_bits -= bits_in_cache_;
+    cache_ = 0;
+    bits_in_cache_ = 0;
+    Refill();
+    if (bits_in_cache_ == 0)
+      return false;
+  }
+  ConsumeBits(num_bits);
   return true;
 }
 
 bool H26xBitReader::ReadUE(int* val) {
-  int num_bits = -1;
-  int bit;
-  int rest;
-
-  // Count the number of contiguous zero bits.
-  do {
-    if (!ReadBits(1, &bit))
-      return false;
-    num_bits++;
-  } while (bit == 0);
+  if (bits_in_cache_ < 32)
+    Refill();
 
-  if (num_bits > 31)
+  // Count the number of contiguous zero bits. There are more than 56 bits in
+  // the cache unless the stream has reached the end.
+  const int num_bits = cache_ == 0 ? 64 : CountLeadingZeros(cache_);
+  if (num_bits >= bits_in_cache_ || num_bits > 31)
     return false;
 
   // Calculate exp-Golomb code value of size num_bits.
-  *val = (1 << num_bits) - 1;
-
-  if (num_bits > 0) {
-    if (!ReadBits(num_bits, &rest))
-      return false;
-    *val += rest;
+  const int code_size = 2 * num_bits + 1;
+  if (code_size <= bits_in_cache_) {
+    *val = static_cast<int>((cache_ >> (64 - code_size)) - 1);
+    ConsumeBits(code_size);
+    return true;
   }
 
+  ConsumeBits(num_bits + 1);
+  int rest;
+  if (!ReadBits(num_bits, &rest))
+    return false;
+  *val = static_cast<int>((1ull << num_bits) - 1 + rest);
   return true;
 }
 
@@ -149,37 +238,58 @@ bool H26xBitReader::ReadSE(int* val) {
 }
 
 off_t H26xBitReader::NumBitsLeft() {
-  return (num_remaining_bits_in_curr_byte_ + bytes_left_ * 8);
+  // The emulation prevention bytes after the current byte are not read yet.
+  return bits_in_cache_ + bytes_left_ * 8 +
+         NumEmulationPreventionBytesInCache(NumBytesAfterCurrentByte()) * 8;
 }
 
 bool H26xBitReader::HasMoreRBSPData() {
   // Make sure we have more bits, if we are at 0 bits in current byte and
   // updating current byte fails, we don't have more data anyway.
-  if (num_remaining_bits_in_curr_byte_ == 0 && !UpdateCurrByte())
-    return false;
+  int num_remaining_bits_in_curr_byte = bits_in_cache_ % 8;
+  if (num_remaining_bits_in_curr_byte == 0) {
+    if (bits_in_cache_ == 0)
+      Refill();
+    if (bits_in_cache_ == 0)
+      return false;
+    num_remaining_bits_in_curr_byte = 8;
+    curr_byte_started_ = true;
+  }
+  const int curr_byte =
+      static_cast<int>(cache_ >> (64 - num_remaining_bits_in_curr_byte));
 
   // If there is no more RBSP data, then the remaining bits is the stop bit
   // followed by zero paddings. So if there are 1s in the remaining bits
   // excluding the current bit, then the current bit is not a stop bit,
   // regardless of whether it is 1 or not. Therefore there is more data.
-  if (CheckAnyBitsSet(curr_byte_, num_remaining_bits_in_curr_byte_ - 1))
+  if (CheckAnyBitsSet(curr_byte, num_remaining_bits_in_curr_byte - 1))
     return true;
 
   // While the spec disallows it (7.4.1: "The last byte of the NAL unit shall
   // not be equal to 0x00"), some streams have trailing null bytes anyway. We
   // don't handle emulation prevention sequences because HasMoreRBSPData() is
   // not used when parsing slices (where cabac_zero_word elements are legal).
+  // Emulation prevention bytes in the cache are not zero either.
+  const size_t num_cached_bytes =
+      (bits_in_cache_ - num_remaining_bits_in_curr_byte) / 8;
+  if ((cache_ << num_remaining_bits_in_curr_byte) != 0 ||
+      NumEmulationPreventionBytesInCache(num_cached_bytes) > 0) {
+    return true;
+  }
   for (off_t i = 0; i < bytes_left_; i++) {
     if (data_[i] != 0)
       return true;
   }
 
   bytes_left_ = 0;
+  bits_in_cache_ = num_remaining_bits_in_curr_byte;
+  num_loaded_bytes_ -= num_cached_bytes;
   return false;
 }
 
 size_t H26xBitReader::NumEmulationPreventionBytesRead() {
-  return emulation_prevention_bytes_;
+  return emulation_prevention_byte_positions_.size() -
+         NumEmulationPreventionBytesInCache(NumBytesAfterCurrentByte());
 }
 
 }  // namespace media
@@ -10,6 +10,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <vector>
+
 #include "packager/base/macros.h"
 
 namespace shaka {
@@ -19,6 +21,9 @@ namespace media {
 // This is not a generic bit reader class, as it takes into account
 // H.264 stream-specific constraints, such as skipping emulation-prevention
 // bytes and stop bits. See spec for more details.
+// The bits are read from a 64-bit cache. Runs of bytes without any zero byte,
+// which cannot contain emulation prevention bytes, are loaded into the cache
+// a word at a time.
 class H26xBitReader {
  public:
   H26xBitReader();
@@ -68,29 +73,53 @@ class H26xBitReader {
   size_t NumEmulationPreventionBytesRead();
 
  private:
-  // Advance to the next byte, loading it into curr_byte_.
+  // Load bytes into |cache_| until it holds more than 56 bits, or the stream
+  // has reached the end, skipping the emulation prevention bytes.
+  void Refill();
+
+  // Load the next byte into |cache_|, skipping an emulation prevention byte.
   // Return false on end of stream.
-  bool UpdateCurrByte();
+  bool LoadByte();
+
+  // Drop |num_bits| from |cache_|, which has to hold them.
+  void ConsumeBits(int num_bits);
+
+  // Return the number of emulation prevention bytes before the last
+  // |num_cached_bytes| bytes in |cache_|, which are counted as unread.
+  size_t NumEmulationPreventionBytesInCache(size_t num_cached_bytes) const;
 
-  // Pointer to the next unread (not in curr_byte_) byte in the stream.
+  // Return the number of bytes in |cache_| after the current byte.
+  size_t NumBytesAfterCurrentByte() const;
+
+  // Pointer to the next byte not loaded into |cache_|.
   const uint8_t* data_;
 
-  // Bytes left in the stream (without the curr_byte_).
+  // Bytes left in the stream (without the bytes in |cache_|).
   off_t bytes_left_;
 
-  // Contents of the current byte; first unread bit starting at position
-  // 8 - num_remaining_bits_in_curr_byte_ from MSB.
-  int curr_byte_;
+  // The next bits of the stream, emulation prevention bytes excluded, starting
+  // from the MSB. The bits past the first |bits_in_cache_| are zero.
+  uint64_t cache_;
+
+  // Number of bits in |cache_|. It always holds whole bytes minus the bits
+  // read, so bits_in_cache_ % 8 bits remain in the current byte.
+  int bits_in_cache_;
 
-  // Number of bits remaining in curr_byte_
-  int num_remaining_bits_in_curr_byte_;
+  // Number of bytes loaded into |cache_| so far, emulation prevention bytes
+  // excluded.
+  size_t num_loaded_bytes_;
 
   // Used in emulation prevention three byte detection (see spec).
   // Initially set to 0xffff to accept all initial two-byte sequences.
   int prev_two_bytes_;
 
-  // Number of emulation preventation bytes (0x000003) we met.
-  size_t emulation_prevention_bytes_;
+  // Whether the current byte has been started on a byte boundary, by
+  // HasMoreRBSPData(). The emulation prevention bytes before it are read then.
+  bool curr_byte_started_;
+
+  // For each emulation prevention byte (0x000003) we met, the number of bytes
+  // loaded before it.
+  std::vector<size_t> emulation_prevention_byte_positions_;
 
   DISALLOW_COPY_AND_ASSIGN(H26xBitReader);
 };
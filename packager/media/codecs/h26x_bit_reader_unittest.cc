@@ -130,5 +130,63 @@ TEST(H26xBitReaderTest, StopBitOccupyFullByte) {
   EXPECT_FALSE(reader.HasMoreRBSPData());
 }
 
+TEST(H26xBitReaderTest, SkipEmulationPreventionBytes) {
+  H26xBitReader reader;
+  const unsigned char rbsp[] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                0x00, 0x00, 0x03, 0x01, 0x88, 0x99, 0xaa,
+                                0xbb, 0xcc, 0x00, 0x00, 0x03, 0x00, 0x80};
+  int dummy = 0;
+
+  EXPECT_TRUE(reader.Initialize(rbsp, sizeof(rbsp)));
+  EXPECT_EQ(reader.NumBitsLeft(), 168);
+
+  EXPECT_TRUE(reader.ReadBits(28, &dummy));
+  EXPECT_EQ(dummy, 0x1122334);
+  EXPECT_TRUE(reader.ReadBits(24, &dummy));
+  EXPECT_EQ(dummy, 0x455667);
+  EXPECT_EQ(reader.NumBitsLeft(), 116);
+  EXPECT_EQ(reader.NumEmulationPreventionBytesRead(), 0u);
+
+  EXPECT_TRUE(reader.ReadBits(28, &dummy));
+  EXPECT_EQ(dummy, 0x7000001);
+  EXPECT_EQ(reader.NumBitsLeft(), 80);
+  EXPECT_EQ(reader.NumEmulationPreventionBytesRead(), 1u);
+
+  EXPECT_TRUE(reader.SkipBits(40));
+  EXPECT_EQ(reader.NumBitsLeft(), 40);
+  EXPECT_EQ(reader.NumEmulationPreventionBytesRead(), 1u);
+  EXPECT_TRUE(reader.ReadBits(16, &dummy));
+  EXPECT_EQ(dummy, 0);
+  EXPECT_EQ(reader.NumBitsLeft(), 24);
+  EXPECT_TRUE(reader.ReadBits(8, &dummy));
+  EXPECT_EQ(dummy, 0);
+  EXPECT_EQ(reader.NumEmulationPreventionBytesRead(), 2u);
+  EXPECT_EQ(reader.NumBitsLeft(), 8);
+  EXPECT_FALSE(reader.HasMoreRBSPData());
+}
+
+TEST(H26xBitReaderTest, ReadExpGolombCodes) {
+  H26xBitReader reader;
+  // 1 | 010 | 011 | 00100 | 00101 | 0000000001111111111 (1022) | 1.
+  const unsigned char rbsp[] = {0xa6, 0x42, 0x80, 0x3f, 0xf8};
+  int dummy = 0;
+
+  EXPECT_TRUE(reader.Initialize(rbsp, sizeof(rbsp)));
+  EXPECT_TRUE(reader.ReadUE(&dummy));
+  EXPECT_EQ(dummy, 0);
+  EXPECT_TRUE(reader.ReadUE(&dummy));
+  EXPECT_EQ(dummy, 1);
+  EXPECT_TRUE(reader.ReadSE(&dummy));
+  EXPECT_EQ(dummy, -1);
+  EXPECT_TRUE(reader.ReadUE(&dummy));
+  EXPECT_EQ(dummy, 3);
+  EXPECT_TRUE(reader.ReadSE(&dummy));
+  EXPECT_EQ(dummy, -2);
+  EXPECT_TRUE(reader.ReadUE(&dummy));
+  EXPECT_EQ(dummy, 1022);
+  EXPECT_EQ(reader.NumBitsLeft(), 4);
+  EXPECT_FALSE(reader.HasMoreRBSPData());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -54,8 +54,74 @@ bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStream(
   DCHECK(input_frame);
   DCHECK(output_frame);
 
-  BufferWriter output_buffer(input_frame_size + kStreamConversionOverhead);
+  std::vector<Nalu> output_nalus;
+  if (!GetOutputNalus(input_frame, input_frame_size, &output_nalus))
+    return false;
+  WriteNalUnitStream(output_nalus, input_frame_size, output_frame);
+  return true;
+}
+
+bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStreamInPlace(
+    uint8_t* frame,
+    size_t frame_size,
+    uint8_t** converted_frame,
+    size_t* converted_frame_size,
+    std::vector<uint8_t>* output_frame) {
+  DCHECK(frame);
+  DCHECK(converted_frame);
+  DCHECK(converted_frame_size);
+  DCHECK(output_frame);
+
+  std::vector<Nalu> output_nalus;
+  if (!GetOutputNalus(frame, frame_size, &output_nalus))
+    return false;
+
+  // The frame can be converted in place if each NAL unit written follows the
+  // previous one after a 4-byte start code, which is then overwritten with
+  // the 4-byte length, i.e. if there are no 3-byte start codes nor NAL units
+  // stripped between them. The AUD and parameter sets usually lead the frame,
+  // where they are simply skipped.
+  bool can_convert_in_place =
+      !output_nalus.empty() &&
+      output_nalus.front().data() >= frame + kUnitStreamNaluLengthSize;
+  const uint8_t* next_nalu_data =
+      can_convert_in_place ? output_nalus.front().data() : nullptr;
+  for (const Nalu& nalu : output_nalus) {
+    if (nalu.data() != next_nalu_data) {
+      can_convert_in_place = false;
+      break;
+    }
+    next_nalu_data += nalu.header_size() + nalu.payload_size() +
+                      kUnitStreamNaluLengthSize;
+  }
+  if (!can_convert_in_place) {
+    *converted_frame = nullptr;
+    *converted_frame_size = 0;
+    WriteNalUnitStream(output_nalus, frame_size, output_frame);
+    return true;
+  }
+
+  for (const Nalu& nalu : output_nalus) {
+    const uint32_t nalu_size =
+        static_cast<uint32_t>(nalu.header_size() + nalu.payload_size());
+    uint8_t* length = frame + (nalu.data() - frame) - kUnitStreamNaluLengthSize;
+    length[0] = static_cast<uint8_t>(nalu_size >> 24);
+    length[1] = static_cast<uint8_t>(nalu_size >> 16);
+    length[2] = static_cast<uint8_t>(nalu_size >> 8);
+    length[3] = static_cast<uint8_t>(nalu_size);
+  }
+  *converted_frame = frame + (output_nalus.front().data() - frame) -
+                     kUnitStreamNaluLengthSize;
+  *converted_frame_size =
+      next_nalu_data - kUnitStreamNaluLengthSize - *converted_frame;
+  output_frame->clear();
+  return true;
+}
 
+bool H26xByteToUnitStreamConverter::GetOutputNalus(
+    const uint8_t* input_frame,
+    size_t input_frame_size,
+    std::vector<Nalu>* output_nalus) {
   Nalu nalu;
   NaluReader reader(type_, kIsAnnexbByteStream, input_frame, input_frame_size);
   if (!reader.StartsWithStartCode()) {
@@ -64,19 +130,28 @@ bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStream(
   }
 
   while (reader.Advance(&nalu) == NaluReader::kOk) {
-    const uint64_t nalu_size = nalu.payload_size() + nalu.header_size();
-    DCHECK_LE(nalu_size, std::numeric_limits<uint32_t>::max());
+    DCHECK_LE(nalu.payload_size() + nalu.header_size(),
+              std::numeric_limits<uint32_t>::max());
 
     if (ProcessNalu(nalu))
       continue;
+    output_nalus->push_back(nalu);
+  }
+  return true;
+}
 
+void H26xByteToUnitStreamConverter::WriteNalUnitStream(
+    const std::vector<Nalu>& nalus,
+    size_t input_frame_size,
+    std::vector<uint8_t>* output_frame) {
+  BufferWriter output_buffer(input_frame_size + kStreamConversionOverhead);
+  for (const Nalu& nalu : nalus) {
+    const uint64_t nalu_size = nalu.payload_size() + nalu.header_size();
     // Append 4-byte length and NAL unit data to the buffer.
     output_buffer.AppendInt(static_cast<uint32_t>(nalu_size));
     output_buffer.AppendArray(nalu.data(), nalu_size);
   }
-
   output_buffer.SwapBuffer(output_frame);
-  return true;
 }
 
 void H26xByteToUnitStreamConverter::WarnIfNotMatch(
@@ -47,6 +47,28 @@ class H26xByteToUnitStreamConverter {
                                         size_t input_frame_size,
                                         std::vector<uint8_t>* output_frame);
 
+  /// Converts a whole byte stream encoded video frame to NAL unit stream
+  /// format in place, overwriting the 4-byte start codes with the NAL unit
+  /// lengths. The frame is converted to @a output_frame instead if it has
+  /// 3-byte start codes, or NAL units stripped between the ones written.
+  /// @param frame is a buffer containing a whole H.26x frame in byte stream
+  ///        format, which may be modified.
+  /// @param frame_size is the size of the H.26x frame, in bytes.
+  /// @param converted_frame is set to the start of the frame converted in
+  ///        place, within @a frame, or to nullptr if the frame was converted
+  ///        to @a output_frame.
+  /// @param converted_frame_size is set to the size of the frame converted in
+  ///        place, or to 0.
+  /// @param output_frame is a pointer to a vector which will receive the
+  ///        converted frame if it cannot be converted in place.
+  /// @return true if successful, false otherwise.
+  bool ConvertByteStreamToNalUnitStreamInPlace(
+      uint8_t* frame,
+      size_t frame_size,
+      uint8_t** converted_frame,
+      size_t* converted_frame_size,
+      std::vector<uint8_t>* output_frame);
+
   /// Creates either an AVCDecoderConfigurationRecord or a
   /// HEVCDecoderConfigurationRecord from the units extracted from the byte
   /// stream.
@@ -71,6 +93,17 @@ class H26xByteToUnitStreamConverter {
                       const std::vector<uint8_t>& vector);
 
  private:
+  // Collect the NAL units of the frame to write, i.e. those not handled by
+  // ProcessNalu().
+  bool GetOutputNalus(const uint8_t* input_frame,
+                      size_t input_frame_size,
+                      std::vector<Nalu>* output_nalus);
+
+  // Write |nalus| with 4-byte lengths to |output_frame|.
+  void WriteNalUnitStream(const std::vector<Nalu>& nalus,
+                          size_t input_frame_size,
+                          std::vector<uint8_t>* output_frame);
+
   // Process the given Nalu.  If this returns true, it was handled and should
   // not be copied to the buffer.
   virtual bool ProcessNalu(const Nalu& nalu) = 0;
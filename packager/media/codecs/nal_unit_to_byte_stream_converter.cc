@@ -8,6 +8,15 @@
 
 #include <list>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NAL_UNIT_TO_BYTE_STREAM_CONVERTER_USE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define NAL_UNIT_TO_BYTE_STREAM_CONVERTER_USE_NEON
+#endif
+
 #include "packager/base/logging.h"
 #include "packager/media/base/bit_reader.h"
 #include "packager/media/base/buffer_reader.h"
@@ -26,6 +35,8 @@ const uint8_t kNaluStartCode[] = {0x00, 0x00, 0x00, 0x01};
 const uint8_t kEmulationPreventionByte = 0x03;
 
 const uint8_t kAccessUnitDelimiterRbspAnyPrimaryPicType = 0xF0;
+// NAL unit header and primary_pic_type.
+const size_t kAccessUnitDelimiterSize = 2;
 
 bool IsNaluEqual(const Nalu& left, const Nalu& right) {
   if (left.type() != right.type())
@@ -56,39 +67,122 @@ void AddAccessUnitDelimiter(BufferWriter* buffer_writer) {
   buffer_writer->AppendInt(kAccessUnitDelimiterRbspAnyPrimaryPicType);
 }
 
+#if defined(NAL_UNIT_TO_BYTE_STREAM_CONVERTER_USE_SSE2) || \
+    defined(NAL_UNIT_TO_BYTE_STREAM_CONVERTER_USE_NEON)
+// Number of bytes examined in one step by the vectorized scanner.
+const size_t kScanWindowSize = 16;
+
+// Returns true if there is a pair of consecutive zero bytes starting in the
+// |kScanWindowSize| bytes at |data|, which has to have |kScanWindowSize| + 1
+// bytes.
+bool HasZeroPair(const uint8_t* data) {
+#if defined(NAL_UNIT_TO_BYTE_STREAM_CONVERTER_USE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i current =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+  const __m128i next =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 1));
+  return _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(current, zero),
+                                         _mm_cmpeq_epi8(next, zero))) != 0;
+#else
+  const uint8x16_t current = vld1q_u8(data);
+  const uint8x16_t next = vld1q_u8(data + 1);
+  return vmaxvq_u8(vandq_u8(vceqzq_u8(current), vceqzq_u8(next))) != 0;
+#endif
+}
+#endif
+
+// Finds, one after the other, the positions in |input| before which an
+// emulation prevention byte has to be inserted, i.e. the 0x00 to 0x03 bytes
+// following two zero bytes that are not already part of an escaped sequence.
+// Windows without any pair of consecutive zero bytes cannot have such a
+// position and are skipped with SIMD instructions when available.
+class EscapePositionScanner {
+ public:
+  EscapePositionScanner(const uint8_t* input, size_t input_size)
+      : input_(input), input_size_(input_size) {}
+
+  // Returns false if there is no further position, once |input| is scanned.
+  bool Next(size_t* escape_position) {
+    const uint8_t* input = input_;
+    const size_t input_size = input_size_;
+    size_t i = position_;
+    while (i < input_size) {
+#if defined(NAL_UNIT_TO_BYTE_STREAM_CONVERTER_USE_SSE2) || \
+    defined(NAL_UNIT_TO_BYTE_STREAM_CONVERTER_USE_NEON)
+      // The pairs starting in the window cover the escapes up to two bytes
+      // past it. The zero count is at most one after a window without pairs.
+      if (consecutive_zero_count_ == 0 &&
+          input_size - i >= kScanWindowSize + 1 && !HasZeroPair(input + i)) {
+        i += kScanWindowSize;
+        consecutive_zero_count_ = input[i - 1] == 0 ? 1 : 0;
+        continue;
+      }
+#endif
+
+      bool must_escape = false;
+      if (consecutive_zero_count_ == 2) {
+        must_escape = input[i] <= 3;
+        // Note that input[i] can be 0.
+        // 00 00 00 00 00 00 should become
+        // 00 00 03 00 00 03 00 00 03
+        // So consecutive_zero_count_ is reset here and incremented below if
+        // input[i] is 0.
+        consecutive_zero_count_ = 0;
+      }
+      consecutive_zero_count_ =
+          input[i] == 0 ? consecutive_zero_count_ + 1 : 0;
+      ++i;
+      if (must_escape) {
+        position_ = i;
+        *escape_position = i - 1;
+        return true;
+      }
+    }
+    position_ = i;
+    return false;
+  }
+
+  // Returns true if |input| ends with a zero byte, which has to be escaped
+  // too. Only valid once Next() has returned false.
+  bool ends_with_zero() const { return consecutive_zero_count_ > 0; }
+
+ private:
+  const uint8_t* const input_;
+  const size_t input_size_;
+  size_t position_ = 0;
+  // Keep track of consecutive zeros that it has seen (not including the
+  // current byte), so that the algorithm doesn't need to go back to check the
+  // same bytes.
+  int consecutive_zero_count_ = 0;
+};
+
 }  // namespace
 
 void EscapeNalByteSequence(const uint8_t* input,
                            size_t input_size,
                            BufferWriter* output_writer) {
-  // Keep track of consecutive zeros that it has seen (not including the current
-  // byte), so that the algorithm doesn't need to go back to check the same
-  // bytes.
-  int consecutive_zero_count = 0;
-  for (size_t i = 0; i < input_size; ++i) {
-    if (consecutive_zero_count <= 1) {
-      output_writer->AppendInt(input[i]);
-    } else if (consecutive_zero_count == 2) {
-      if (input[i] == 0 || input[i] == 1 || input[i] == 2 || input[i] == 3) {
-        // Must be escaped.
-        output_writer->AppendInt(kEmulationPreventionByte);
-      }
-
-      output_writer->AppendInt(input[i]);
-      // Note that input[i] can be 0.
-      // 00 00 00 00 00 00 should become
-      // 00 00 03 00 00 03 00 00 03
-      // So consecutive_zero_count is reset here and incremented below if
-      // input[i] is 0.
-      consecutive_zero_count = 0;
-    }
-
-    consecutive_zero_count = input[i] == 0 ? consecutive_zero_count + 1 : 0;
+  // Escapes are rare, e.g. in encrypted data, so only leave room for a few of
+  // them; more grow the buffer.
+  const size_t kExpectedMaxEscapeCount = 16;
+  output_writer->Reserve(input_size + kExpectedMaxEscapeCount);
+
+  // The bytes in between the escapes are copied in bulk as soon as the next
+  // escape is found, in the same pass over |input| as the scan, while they are
+  // still in cache.
+  EscapePositionScanner scanner(input, input_size);
+  size_t start = 0;
+  size_t position = 0;
+  while (scanner.Next(&position)) {
+    output_writer->AppendArray(input + start, position - start);
+    output_writer->AppendInt(kEmulationPreventionByte);
+    start = position;
   }
+  output_writer->AppendArray(input + start, input_size - start);
 
   // ISO 14496-10 Section 7.4.1.1 mentions that if the last byte is 0 (which
   // only happens if RBSP has cabac_zero_word), 0x03 must be appended.
-  if (consecutive_zero_count > 0) {
+  if (scanner.ends_with_zero()) {
     DCHECK_GT(input_size, 0u);
     DCHECK_EQ(input[input_size - 1], 0u);
     output_writer->AppendInt(kEmulationPreventionByte);
@@ -263,7 +357,8 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStream(
     std::vector<uint8_t>* output) {
   return ConvertUnitToByteStreamWithSubsamples(
       sample, sample_size, is_key_frame, false, output,
-      nullptr);  // Skip subsample update.
+      nullptr,   // Skip subsample update.
+      nullptr);  // Parse the NAL units.
 }
 
 // This ignores all AUD, SPS, and PPS in the sample. Instead uses the data
@@ -275,7 +370,8 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
     bool is_key_frame,
     bool escape_encrypted_nalu,
     std::vector<uint8_t>* output,
-    std::vector<SubsampleEntry>* subsamples) {
+    std::vector<SubsampleEntry>* subsamples,
+    const std::vector<NaluLocation>* nalu_layout) {
   if (!sample || sample_size == 0) {
     LOG(WARNING) << "Sample is empty.";
     return true;
@@ -283,7 +379,16 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
 
   std::vector<SubsampleEntry> temp_subsamples;
 
-  BufferWriter buffer_writer(sample_size);
+  // Write to the storage of |output|. Also make room for the access unit
+  // delimiter and the decoder configuration written before the NAL units of
+  // the sample.
+  const size_t kNoReservedSize = 0;
+  BufferWriter buffer_writer(kNoReservedSize);
+  buffer_writer.SwapBuffer(output);
+  buffer_writer.Clear();
+  buffer_writer.Reserve(
+      sample_size + arraysize(kNaluStartCode) + kAccessUnitDelimiterSize +
+      (is_key_frame ? decoder_configuration_in_byte_stream_.size() : 0));
   buffer_writer.AppendArray(kNaluStartCode, arraysize(kNaluStartCode));
   AddAccessUnitDelimiter(&buffer_writer);
   if (is_key_frame)
@@ -298,7 +403,22 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
 
   NaluReader nalu_reader(Nalu::kH264, nalu_length_size_, sample, sample_size);
   Nalu nalu;
-  NaluReader::Result result = nalu_reader.Advance(&nalu);
+  size_t nalu_index = 0;
+  // Reads the next NAL unit, using |nalu_layout| if available.
+  auto advance = [&]() {
+    if (!nalu_layout)
+      return nalu_reader.Advance(&nalu);
+    if (nalu_index == nalu_layout->size())
+      return NaluReader::kEOStream;
+    const NaluLocation& location = nalu_layout->at(nalu_index++);
+    if (location.offset + location.size > sample_size ||
+        !nalu.Initialize(Nalu::kH264, sample + location.offset,
+                         location.size)) {
+      return NaluReader::kInvalidStream;
+    }
+    return NaluReader::kOk;
+  };
+  NaluReader::Result result = advance();
 
   size_t start_subsample_id = 0;
   size_t next_subsample_id = 0;
@@ -384,7 +504,7 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
     }
 
     start_subsample_id = next_subsample_id;
-    result = nalu_reader.Advance(&nalu);
+    result = advance();
   }
 
   DCHECK_NE(result, NaluReader::kOk);
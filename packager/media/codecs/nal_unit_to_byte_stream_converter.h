@@ -12,6 +12,7 @@
 
 #include "packager/base/macros.h"
 #include "packager/media/base/decrypt_config.h"
+#include "packager/media/base/media_sample.h"
 #include "packager/media/codecs/avc_decoder_configuration_record.h"
 
 namespace shaka {
@@ -68,9 +69,14 @@ class NalUnitToByteStreamConverter {
   /// @param escape_encrypted_nalu indicates whether an encrypted nalu should be
   ///        escaped. This is needed for Apple Sample AES. Note that
   ///        |subsamples| on return contains the sizes before escaping.
-  /// @param[out] output is set to the the converted sample, on success.
+  /// @param[out] output is set to the the converted sample, on success. Its
+  ///        storage is reused, so passing the same vector for every sample
+  ///        saves an allocation per sample.
   /// @param[in,out] subsamples has the input subsamples and output updated
   ///                subsamples, on success.
+  /// @param nalu_layout is the location of the NAL units in @a sample, as
+  ///        parsed by an earlier stage. The NAL units are parsed from
+  ///        @a sample if it is NULL.
   /// @return true on success, false otherwise.
   virtual bool ConvertUnitToByteStreamWithSubsamples(
       const uint8_t* sample,
@@ -78,7 +84,8 @@ class NalUnitToByteStreamConverter {
       bool is_key_frame,
       bool escape_encrypted_nalu,
       std::vector<uint8_t>* output,
-      std::vector<SubsampleEntry>* subsamples);
+      std::vector<SubsampleEntry>* subsamples,
+      const std::vector<NaluLocation>* nalu_layout);
 
  private:
   friend class NalUnitToByteStreamConverterTest;
@@ -7,6 +7,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/codecs/nal_unit_to_byte_stream_converter.h"
 #include "packager/media/formats/mp4/box_definitions_comparison.h"
@@ -337,6 +338,33 @@ TEST(NalUnitToByteStreamConverterTest, DispersedZeros) {
             output);
 }
 
+// Escape sequences before, across and after the boundaries of the windows
+// scanned at once.
+TEST(NalUnitToByteStreamConverterTest, EscapeLongNalByteSequence) {
+  const uint8_t kNalu[] = {
+      0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB,
+      0xCC, 0xDD, 0xEE, 0xFF, 0x00, 0x00, 0x01, 0x21, 0x22, 0x23, 0x24,
+      0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x00,
+      0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B,
+      0x3C, 0x3D, 0x3E, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+  };
+  BufferWriter writer;
+  EscapeNalByteSequence(kNalu, arraysize(kNalu), &writer);
+
+  const uint8_t kExpectedOutput[] = {
+      0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB,
+      0xCC, 0xDD, 0xEE, 0xFF, 0x00, 0x00, 0x03, 0x01, 0x21, 0x22, 0x23,
+      0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E,
+      0x00, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A,
+      0x3B, 0x3C, 0x3D, 0x3E, 0x3F, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04,
+      0x00, 0x03,
+  };
+  EXPECT_EQ(std::vector<uint8_t>(kExpectedOutput,
+                                 kExpectedOutput + arraysize(kExpectedOutput)),
+            std::vector<uint8_t>(writer.Buffer(),
+                                 writer.Buffer() + writer.Size()));
+}
+
 // Verify that ConvertUnitToByteStream() with escape_data = false works.
 TEST(NalUnitToByteStreamConverterTest, DoNotEscape) {
   // This has sequences that should be escaped if escape_data = true.
@@ -394,7 +422,7 @@ TEST(NalUnitToByteStreamConverterTest, NoClearNAL) {
   std::vector<uint8_t> output;
   EXPECT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples));
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   const uint8_t kExpectedOutput[] = {
       0x00, 0x00, 0x00, 0x01,              // Start code.
@@ -427,6 +455,54 @@ TEST(NalUnitToByteStreamConverterTest, NoClearNAL) {
   EXPECT_EQ(kExpectedOutputSubsamples, subsamples);
 }
 
+// The NAL unit layout passed in is used instead of parsing the sample.
+TEST(NalUnitToByteStreamConverterTest, WithNaluLayout) {
+  const uint8_t kUnitStreamLikeMediaSample[] = {
+      0x00, 0x00, 0x00, 0x0A,  // Size 10 NALU.
+      0x02,                    // NAL unit type.
+      0xFD, 0x78, 0xA4, 0xC3, 0x82, 0x62, 0x11, 0x29, 0x77, // Slice data
+      0x00, 0x00, 0x00, 0x08,  // Size 8 NALU.
+      0x02,                    // NAL unit type.
+      0xFD, 0x78, 0xA4, 0x82, 0x62, 0x29, 0x77, // Slice data
+  };
+  const std::vector<SubsampleEntry> kSubsamples{SubsampleEntry(5, 9),
+                                                SubsampleEntry(5, 7)};
+  std::vector<NaluLocation> nalu_layout(2);
+  nalu_layout[0].offset = 4;
+  nalu_layout[0].size = 10;
+  nalu_layout[1].offset = 18;
+  nalu_layout[1].size = 8;
+
+  NalUnitToByteStreamConverter converter;
+  EXPECT_TRUE(
+      converter.Initialize(kTestAVCDecoderConfigurationRecord,
+                           arraysize(kTestAVCDecoderConfigurationRecord)));
+
+  std::vector<uint8_t> expected_output;
+  std::vector<SubsampleEntry> expected_subsamples = kSubsamples;
+  ASSERT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
+      kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
+      kIsKeyFrame, !kEscapeEncryptedNalu, &expected_output,
+      &expected_subsamples, nullptr));
+
+  std::vector<uint8_t> output;
+  std::vector<SubsampleEntry> subsamples = kSubsamples;
+  ASSERT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
+      kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples,
+      &nalu_layout));
+  EXPECT_EQ(expected_output, output);
+  EXPECT_EQ(expected_subsamples, subsamples);
+
+  // A layout that does not fit in the sample is rejected.
+  nalu_layout[1].size = 9;
+  subsamples = kSubsamples;
+  EXPECT_FALSE(converter.ConvertUnitToByteStreamWithSubsamples(
+      kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples,
+      &nalu_layout));
+}
+
 // Some NAL units have all clear text
 TEST(NalUnitToByteStreamConverterTest, WithSomeClearNAL) {
   // Only the type of the NAL units are checked.
@@ -450,7 +526,7 @@ TEST(NalUnitToByteStreamConverterTest, WithSomeClearNAL) {
   std::vector<uint8_t> output;
   EXPECT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples));
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   const uint8_t kExpectedOutput[] = {
       0x00, 0x00, 0x00, 0x01,              // Start code.
@@ -506,7 +582,7 @@ TEST(NalUnitToByteStreamConverterTest, WithSomeClearNALAndNaluLengthSize2) {
   std::vector<uint8_t> output;
   EXPECT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples));
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   const uint8_t kExpectedOutput[] = {
       0x00, 0x00, 0x00, 0x01,  // Start code.
@@ -567,7 +643,7 @@ TEST(NalUnitToByteStreamConverterTest, EscapeEncryptedNalu) {
   std::vector<uint8_t> output;
   ASSERT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      !kIsKeyFrame, kEscapeEncryptedNalu, &output, &subsamples));
+      !kIsKeyFrame, kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   const uint8_t kExpectedOutput[] = {
       0x00, 0x00, 0x00, 0x01,  // Start code.
@@ -614,7 +690,7 @@ TEST(NalUnitToByteStreamConverterTest, EncryptedNaluEndingWithZero) {
   std::vector<uint8_t> output;
   ASSERT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      !kIsKeyFrame, kEscapeEncryptedNalu, &output, &subsamples));
+      !kIsKeyFrame, kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   const uint8_t kExpectedOutput[] = {
       0x00, 0x00, 0x00, 0x01,  // Start code.
@@ -660,7 +736,7 @@ TEST(NalUnitToByteStreamConverterTest, EncryptedPps) {
   std::vector<uint8_t> output;
   EXPECT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples));
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   // clang-format off
   const uint8_t kExpectedOutput[] = {
@@ -727,7 +803,7 @@ TEST(NalUnitToByteStreamConverterTest, ClearPpsSame) {
   std::vector<uint8_t> output;
   EXPECT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples));
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   // clang-format off
   const uint8_t kExpectedOutput[] = {
@@ -790,7 +866,7 @@ TEST(NalUnitToByteStreamConverterTest, ClearPpsDifferent) {
   std::vector<uint8_t> output;
   EXPECT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples));
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   // clang-format off
   const uint8_t kExpectedOutput[] = {
@@ -856,7 +932,7 @@ TEST(NalUnitToByteStreamConverterTest,
   std::vector<uint8_t> output;
   EXPECT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples));
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   const uint8_t kExpectedOutput[] = {
       0x00, 0x00, 0x00, 0x01,  // Start code.
@@ -918,7 +994,7 @@ TEST(NalUnitToByteStreamConverterTest,
   std::vector<uint8_t> output;
   EXPECT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       kUnitStreamLikeMediaSample, arraysize(kUnitStreamLikeMediaSample),
-      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples));
+      kIsKeyFrame, !kEscapeEncryptedNalu, &output, &subsamples, nullptr));
 
   const uint8_t kExpectedOutput[] = {
       0x00, 0x00, 0x00, 0x01,  // Start code.
@@ -1003,7 +1079,7 @@ TEST(NalUnitToByteStreamConverterTest,
   EXPECT_TRUE(converter.ConvertUnitToByteStreamWithSubsamples(
       unit_stream_like_media_sample.data(),
       unit_stream_like_media_sample.size(), kIsKeyFrame, !kEscapeEncryptedNalu,
-      &output, &subsamples));
+      &output, &subsamples, nullptr));
 
   const uint8_t kExpectedOutputPart1[] = {
       0x00, 0x00, 0x00, 0x01,  // Start code.
@@ -6,8 +6,18 @@
 
 #include "packager/media/codecs/nalu_reader.h"
 
+#include <algorithm>
 #include <iostream>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NALU_READER_USE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define NALU_READER_USE_NEON
+#endif
+
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_reader.h"
 #include "packager/media/codecs/h264_parser.h"
@@ -20,6 +30,51 @@ inline bool IsStartCode(const uint8_t* data) {
   return data[0] == 0x00 && data[1] == 0x00 && data[2] == 0x01;
 }
 
+// Number of bytes examined in one step by the vectorized scanner.
+const size_t kScanWindowSize = 16;
+
+// Returns a pointer to the first three-byte start code in [data, end), or
+// nullptr if there is not one. Windows of |kScanWindowSize| positions without
+// any pair of consecutive zero bytes are skipped with SIMD instructions when
+// available; the remaining candidates are verified byte by byte.
+const uint8_t* FindThreeByteStartCode(const uint8_t* data,
+                                      const uint8_t* end) {
+#if defined(NALU_READER_USE_SSE2) || defined(NALU_READER_USE_NEON)
+  // Two overlapping windows are loaded, i.e. |kScanWindowSize| + 1 bytes, and
+  // a candidate at the last position needs two more bytes to be verified.
+  while (static_cast<size_t>(end - data) >= kScanWindowSize + 2) {
+#if defined(NALU_READER_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i current =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i next =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 1));
+    const int zero_pairs = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(current, zero), _mm_cmpeq_epi8(next, zero)));
+    const bool has_zero_pairs = zero_pairs != 0;
+#else
+    const uint8x16_t current = vld1q_u8(data);
+    const uint8x16_t next = vld1q_u8(data + 1);
+    const bool has_zero_pairs =
+        vmaxvq_u8(vandq_u8(vceqzq_u8(current), vceqzq_u8(next))) != 0;
+#endif
+    if (has_zero_pairs) {
+      for (size_t i = 0; i < kScanWindowSize; ++i) {
+        if (IsStartCode(data + i))
+          return data + i;
+      }
+    }
+    data += kScanWindowSize;
+  }
+#endif  // NALU_READER_USE_SSE2 || NALU_READER_USE_NEON
+
+  for (; end - data >= 3; ++data) {
+    if (IsStartCode(data))
+      return data;
+  }
+  return nullptr;
+}
+
 // Edits |subsamples| given the number of consumed bytes.
 void UpdateSubsamples(uint64_t consumed_bytes,
                       std::vector<SubsampleEntry>* subsamples) {
@@ -313,31 +368,25 @@ bool NaluReader::FindStartCode(const uint8_t* data,
                                uint64_t data_size,
                                uint64_t* offset,
                                uint8_t* start_code_size) {
-  uint64_t bytes_left = data_size;
-
-  while (bytes_left >= 3) {
-    if (IsStartCode(data)) {
-      // Found three-byte start code, set pointer at its beginning.
-      *offset = data_size - bytes_left;
-      *start_code_size = 3;
-
-      // If there is a zero byte before this start code,
-      // then it's actually a four-byte start code, so backtrack one byte.
-      if (*offset > 0 && *(data - 1) == 0x00) {
-        --(*offset);
-        ++(*start_code_size);
-      }
-
-      return true;
+  const uint8_t* start_code = FindThreeByteStartCode(data, data + data_size);
+  if (start_code) {
+    // Found three-byte start code, set pointer at its beginning.
+    *offset = start_code - data;
+    *start_code_size = 3;
+
+    // If there is a zero byte before this start code,
+    // then it's actually a four-byte start code, so backtrack one byte.
+    if (*offset > 0 && *(start_code - 1) == 0x00) {
+      --(*offset);
+      ++(*start_code_size);
     }
 
-    ++data;
-    --bytes_left;
+    return true;
   }
 
   // End of data: offset is pointing to the first byte that was not considered
   // as a possible start of a start code.
-  *offset = data_size - bytes_left;
+  *offset = data_size - std::min<uint64_t>(data_size, 2);
   *start_code_size = 0;
   return false;
 }
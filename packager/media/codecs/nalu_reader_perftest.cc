@@ -0,0 +1,58 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/media/codecs/nalu_reader.h"
+#include "packager/media/test/perf_test_util.h"
+#include "packager/media/test/test_data_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+// Scans all the NAL units in the Annex B byte stream |stream|.
+void MeasureScanThroughput(const std::string& trace,
+                           const std::vector<uint8_t>& stream) {
+  ASSERT_FALSE(stream.empty());
+  MeasureThroughput("nalu_reader_scan", trace, stream.size(), [&stream]() {
+    NaluReader reader(Nalu::kH264, 0, stream.data(), stream.size());
+    Nalu nalu;
+    NaluReader::Result result;
+    while ((result = reader.Advance(&nalu)) == NaluReader::kOk) {
+    }
+    CHECK_EQ(NaluReader::kEOStream, result);
+  });
+}
+
+}  // namespace
+
+// Large slices with few start codes, as in high bitrate video.
+TEST(NaluReaderPerfTest, SyntheticAnnexB) {
+  const size_t kNaluSize = 64 * 1024;
+  const size_t kNaluCount = 64;
+  const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+  std::vector<uint8_t> stream;
+  for (size_t i = 0; i < kNaluCount; ++i) {
+    stream.insert(stream.end(), std::begin(kStartCode), std::end(kStartCode));
+    // Non-IDR slice header followed by payload without start code emulation.
+    stream.push_back(0x01);
+    for (size_t j = 1; j < kNaluSize; ++j)
+      stream.push_back(static_cast<uint8_t>(j % 255 + 1));
+  }
+  MeasureScanThroughput("synthetic", stream);
+}
+
+TEST(NaluReaderPerfTest, RealAnnexB) {
+  MeasureScanThroughput("bear_h264", ReadTestDataFile("bear.h264"));
+}
+
+}  // namespace media
+}  // namespace shaka
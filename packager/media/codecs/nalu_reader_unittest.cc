@@ -6,6 +6,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "packager/media/codecs/nalu_reader.h"
 
 namespace shaka {
@@ -309,6 +311,47 @@ TEST(NaluReaderTest, SubsamplesWithInvalidNalu) {
   EXPECT_EQ(0x14, nalu.type());
 }
 
+// Exercises both the vectorized windows and the scalar tail with start codes
+// at every possible position, including across window boundaries.
+TEST(NaluReaderTest, FindStartCodeAtEveryOffset) {
+  const size_t kBufferSize = 70;
+  for (size_t start_code_size = 3; start_code_size <= 4; ++start_code_size) {
+    for (size_t pos = 0; pos + start_code_size <= kBufferSize; ++pos) {
+      // Fill with single zeros which pair up with nothing to stress the
+      // candidate verification.
+      std::vector<uint8_t> data(kBufferSize);
+      for (size_t i = 0; i < data.size(); ++i)
+        data[i] = (i % 2 == 0) ? 0x00 : 0x11;
+      for (size_t i = 0; i < start_code_size - 1; ++i)
+        data[pos + i] = 0x00;
+      data[pos + start_code_size - 1] = 0x01;
+      // Make sure the byte before does not extend the start code.
+      if (pos > 0)
+        data[pos - 1] = 0x11;
+
+      uint64_t offset = 0;
+      uint8_t found_start_code_size = 0;
+      ASSERT_TRUE(NaluReader::FindStartCode(data.data(), data.size(), &offset,
+                                            &found_start_code_size))
+          << "pos " << pos;
+      EXPECT_EQ(pos, offset);
+      EXPECT_EQ(start_code_size, found_start_code_size);
+    }
+  }
+}
+
+TEST(NaluReaderTest, FindStartCodeNoStartCode) {
+  for (size_t size = 0; size < 40; ++size) {
+    std::vector<uint8_t> data(size, 0x00);
+    uint64_t offset = 0;
+    uint8_t start_code_size = 0;
+    EXPECT_FALSE(NaluReader::FindStartCode(data.data(), data.size(), &offset,
+                                           &start_code_size));
+    EXPECT_EQ(size < 2 ? 0u : size - 2, offset);
+    EXPECT_EQ(0u, start_code_size);
+  }
+}
+
 // No NALU start code in the subsample range. A NALU start code in the buffer
 // not specified by subsamples.
 TEST(NaluReaderTest, FindStartCodeInClearRangeNoNalu) {
@@ -107,11 +107,11 @@ bool H265VideoSliceHeaderParser::ProcessNalu(const Nalu& nalu) {
 
 int64_t H265VideoSliceHeaderParser::GetHeaderSize(const Nalu& nalu) {
   DCHECK(nalu.is_video_slice());
-  H265SliceHeader slice_header;
-  if (parser_.ParseSliceHeader(nalu, &slice_header) != H265Parser::kOk)
+  size_t header_bit_size = 0;
+  if (parser_.ParseSliceHeaderSize(nalu, &header_bit_size) != H265Parser::kOk)
     return -1;
 
-  return NumBitsToNumBytes(slice_header.header_bit_size);
+  return NumBitsToNumBytes(header_bit_size);
 }
 
 }  // namespace media
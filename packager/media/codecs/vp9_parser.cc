@@ -306,6 +306,36 @@ bool ReadBitDepthAndColorSpace(BitReader* reader,
   return true;
 }
 
+// Read the bits of the color config, i.e. the bit depth, the color space and
+// the chroma subsampling, without interpreting them. They are returned in the
+// low |*num_bits| bits of |*bits|, which hold at most 8 bits.
+bool ReadColorConfigBits(BitReader* reader,
+                         uint8_t profile,
+                         uint8_t* bits,
+                         size_t* num_bits) {
+  *bits = 0;
+  *num_bits = 0;
+  auto append_bits = [reader, bits, num_bits](size_t n) {
+    uint8_t value;
+    RCHECK(reader->ReadBits(n, &value));
+    *bits = static_cast<uint8_t>((*bits << n) | value);
+    *num_bits += n;
+    return true;
+  };
+  if (profile >= 2)
+    RCHECK(append_bits(1));  // ten_or_twelve_bit
+  RCHECK(append_bits(3));    // color_space
+  const uint8_t color_space = *bits & 0x07;
+  if (color_space != VPX_COLOR_SPACE_SRGB) {
+    RCHECK(append_bits(1));  // color_range
+    if (profile & 1)
+      RCHECK(append_bits(3));  // subsampling_x, subsampling_y, reserved_zero
+  } else if (profile & 1) {
+    RCHECK(append_bits(1));  // reserved_zero
+  }
+  return true;
+}
+
 bool ReadFrameSize(BitReader* reader, uint32_t* width, uint32_t* height) {
   RCHECK(reader->ReadBits(16, width));
   *width += 1;  // Off by 1.
@@ -425,12 +455,9 @@ bool ReadSegmentation(BitReader* reader) {
   return true;
 }
 
-bool ReadTileInfo(uint32_t width, BitReader* reader) {
-  uint32_t mi_cols = GetNumMiUnits(width);
-
-  uint32_t min_log2_tile_cols;
-  uint32_t max_log2_tile_cols;
-  GetTileNBits(mi_cols, &min_log2_tile_cols, &max_log2_tile_cols);
+bool ReadTileInfo(uint32_t min_log2_tile_cols,
+                  uint32_t max_log2_tile_cols,
+                  BitReader* reader) {
   uint32_t max_ones = max_log2_tile_cols - min_log2_tile_cols;
 
   uint32_t log2_tile_cols = min_log2_tile_cols;
@@ -449,7 +476,16 @@ bool ReadTileInfo(uint32_t width, BitReader* reader) {
 
 }  // namespace
 
-VP9Parser::VP9Parser() : width_(0), height_(0) {}
+VP9Parser::VP9Parser()
+    : width_(0),
+      height_(0),
+      has_color_config_bits_(false),
+      color_config_profile_(0),
+      color_config_bits_(0),
+      color_config_num_bits_(0),
+      tile_cols_width_(0),
+      min_log2_tile_cols_(0),
+      max_log2_tile_cols_(0) {}
 VP9Parser::~VP9Parser() {}
 
 bool VP9Parser::Parse(const uint8_t* data,
@@ -493,7 +529,7 @@ bool VP9Parser::Parse(const uint8_t* data,
 
     if (vpx_frame.is_keyframe) {
       RCHECK(ReadSyncCode(&reader));
-      RCHECK(ReadBitDepthAndColorSpace(&reader, writable_codec_config()));
+      RCHECK(ReadColorConfig(&reader));
       RCHECK(ReadFrameSizes(&reader, &width_, &height_));
     } else {
       bool intra_only = false;
@@ -505,7 +541,7 @@ bool VP9Parser::Parse(const uint8_t* data,
       if (intra_only) {
         RCHECK(ReadSyncCode(&reader));
         if (codec_config().profile() > 0) {
-          RCHECK(ReadBitDepthAndColorSpace(&reader, writable_codec_config()));
+          RCHECK(ReadColorConfig(&reader));
         } else {
           // NOTE: The intra-only frame header does not include the
           // specification of either the color format or color sub-sampling in
@@ -514,6 +550,7 @@ bool VP9Parser::Parse(const uint8_t* data,
           writable_codec_config()->SetChromaSubsampling(
               VPCodecConfigurationRecord::CHROMA_420_COLLOCATED_WITH_LUMA);
           writable_codec_config()->set_bit_depth(8);
+          has_color_config_bits_ = false;
         }
 
         RCHECK(reader.SkipBits(REF_FRAMES));  // refresh_frame_flags
@@ -546,7 +583,12 @@ bool VP9Parser::Parse(const uint8_t* data,
     RCHECK(ReadLoopFilter(&reader));
     RCHECK(ReadQuantization(&reader));
     RCHECK(ReadSegmentation(&reader));
-    RCHECK(ReadTileInfo(width_, &reader));
+    if (width_ != tile_cols_width_) {
+      GetTileNBits(GetNumMiUnits(width_), &min_log2_tile_cols_,
+                   &max_log2_tile_cols_);
+      tile_cols_width_ = width_;
+    }
+    RCHECK(ReadTileInfo(min_log2_tile_cols_, max_log2_tile_cols_, &reader));
 
     uint16_t header_size;
     RCHECK(reader.ReadBits(16, &header_size));
@@ -569,6 +611,29 @@ bool VP9Parser::Parse(const uint8_t* data,
   return true;
 }
 
+bool VP9Parser::ReadColorConfig(BitReader* reader) {
+  const uint8_t profile = codec_config().profile();
+  uint8_t bits;
+  size_t num_bits;
+  RCHECK(ReadColorConfigBits(reader, profile, &bits, &num_bits));
+  // The color config rarely changes within a stream, so the codec config is
+  // only derived again if its bits do.
+  if (has_color_config_bits_ && profile == color_config_profile_ &&
+      bits == color_config_bits_ && num_bits == color_config_num_bits_) {
+    return true;
+  }
+
+  const uint8_t aligned_bits = static_cast<uint8_t>(bits << (8 - num_bits));
+  BitReader color_config_reader(&aligned_bits, 1);
+  RCHECK(ReadBitDepthAndColorSpace(&color_config_reader,
+                                   writable_codec_config()));
+  has_color_config_bits_ = true;
+  color_config_profile_ = profile;
+  color_config_bits_ = bits;
+  color_config_num_bits_ = num_bits;
+  return true;
+}
+
 bool VP9Parser::IsKeyframe(const uint8_t* data, size_t data_size) {
   BitReader reader(data, data_size);
   uint8_t frame_marker;
@@ -16,7 +16,12 @@
 namespace shaka {
 namespace media {
 
-/// Class to parse a vp9 bit stream.
+class BitReader;
+
+/// Class to parse a vp9 bit stream. Only the uncompressed headers of the
+/// frames are parsed, for their sizes, and the fields which rarely change
+/// within a stream, i.e. the color config and the tile column limits of the
+/// frame width, are only interpreted again when they change.
 class VP9Parser : public VPxParser {
  public:
   VP9Parser();
@@ -40,11 +45,26 @@ class VP9Parser : public VPxParser {
   static bool IsKeyframe(const uint8_t* data, size_t data_size);
 
  private:
+  // Read the color config of a key frame or an intra only frame, and update
+  // the codec config if it differs from the last one read.
+  bool ReadColorConfig(BitReader* reader);
+
   // Keep track of the current width and height. Note that they may change from
   // frame to frame.
   uint32_t width_;
   uint32_t height_;
 
+  // The bits of the last color config the codec config was derived from.
+  bool has_color_config_bits_;
+  uint8_t color_config_profile_;
+  uint8_t color_config_bits_;
+  size_t color_config_num_bits_;
+
+  // The tile column limits of |tile_cols_width_|.
+  uint32_t tile_cols_width_;
+  uint32_t min_log2_tile_cols_;
+  uint32_t max_log2_tile_cols_;
+
   DISALLOW_COPY_AND_ASSIGN(VP9Parser);
 };
 
@@ -126,6 +126,46 @@ TEST(VP9ParserTest, KeyframeProfile2Chroma420) {
                                                 160u, 90u)));
 }
 
+TEST(VP9ParserTest, KeyframesWithChangingColorConfig) {
+  const uint8_t kProfile1Chroma422[] = {
+      0xa2, 0x49, 0x83, 0x42, 0x08, 0x01, 0x3e, 0x00, 0xb2, 0x80, 0xc7, 0x04,
+      0x83, 0x83, 0x0e, 0x40, 0x00, 0x2e, 0x7c, 0x66, 0x79, 0xb9, 0xfd, 0x4f,
+      0xc7, 0x86, 0xf7, 0xc3, 0xc0, 0x82, 0xb2, 0x3c, 0xd6, 0xc0, 0xd0, 0x8d,
+      0xee, 0x00, 0x47, 0xe0, 0x00, 0x7e, 0x6f, 0xfe, 0x74, 0x31, 0xc6, 0x4f,
+      0x23, 0x9d, 0x6e, 0x5f, 0xfc, 0xa8, 0xef, 0x67, 0xdc, 0xac, 0xf7, 0x3e,
+      0x31, 0x07, 0xab, 0xc7, 0x11, 0x67, 0x95, 0x30, 0x37, 0x6d, 0xc5, 0xcf,
+      0xa0, 0x96, 0xa7, 0xb8, 0xf4, 0xb4, 0x65, 0xff,
+  };
+  const uint8_t kProfile2Chroma420[] = {
+      0x92, 0x49, 0x83, 0x42, 0x00, 0x04, 0xf8, 0x02, 0xca, 0x04, 0x1c, 0x12,
+      0x0e, 0x0c, 0x3d, 0x00, 0x00, 0xa8, 0x7c, 0x66, 0x85, 0xb9, 0xfb, 0x3c,
+      0xc9, 0xf0, 0xff, 0xde, 0xf8, 0x78, 0x10, 0x59, 0x5f, 0xaa, 0x6e, 0xf0,
+      0x2a, 0x70, 0x00, 0x7e, 0x6f, 0xfe, 0x74, 0x31, 0xc6, 0x4f, 0x23, 0x9d,
+      0x6e, 0x5f, 0xfc, 0xa8, 0xef, 0x67, 0xdc, 0xac, 0xf7, 0x3e, 0x31, 0x07,
+      0xab, 0xc7, 0x11, 0x67, 0x95, 0x30, 0x37, 0xde, 0x13, 0x16, 0x83, 0x0b,
+      0xa4, 0xdf, 0x05, 0xaf, 0x6f, 0xff, 0xd1, 0x74,
+  };
+
+  VP9Parser parser;
+  std::vector<VPxFrameInfo> frames;
+  ASSERT_TRUE(
+      parser.Parse(kProfile1Chroma422, arraysize(kProfile1Chroma422), &frames));
+  // The unchanged color config is not derived again.
+  ASSERT_TRUE(
+      parser.Parse(kProfile1Chroma422, arraysize(kProfile1Chroma422), &frames));
+  EXPECT_EQ("vp09.01.10.08.02.02.02.02.00",
+            parser.codec_config().GetCodecString(kCodecVP9));
+  EXPECT_THAT(frames, ElementsAre(EqualVPxFrame(arraysize(kProfile1Chroma422),
+                                                18u, true, 160u, 90u)));
+
+  ASSERT_TRUE(
+      parser.Parse(kProfile2Chroma420, arraysize(kProfile2Chroma420), &frames));
+  EXPECT_EQ("vp09.02.10.10.01.02.02.02.00",
+            parser.codec_config().GetCodecString(kCodecVP9));
+  EXPECT_THAT(frames, ElementsAre(EqualVPxFrame(arraysize(kProfile2Chroma420),
+                                                18u, true, 160u, 90u)));
+}
+
 TEST(VP9ParserTest, KeyframeProfile3Chroma444) {
   const uint8_t kData[] = {
       0xb1, 0x24, 0xc1, 0xa1, 0x40, 0x00, 0x4f, 0x80, 0x2c, 0xa0, 0x41, 0xc1,
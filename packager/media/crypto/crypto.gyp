@@ -15,14 +15,19 @@
       'sources': [
         'aes_encryptor_factory.cc',
         'aes_encryptor_factory.h',
+        'crypto_backend.cc',
+        'crypto_backend.h',
         'encryption_handler.cc',
         'encryption_handler.h',
+        'pssh_cache.cc',
+        'pssh_cache.h',
         'sample_aes_ec3_cryptor.cc',
         'sample_aes_ec3_cryptor.h',
         'subsample_generator.cc',
         'subsample_generator.h',
       ],
       'dependencies': [
+        '../../metrics/metrics.gyp:metrics',
         '../base/media_base.gyp:media_base',
         '../codecs/codecs.gyp:codecs',
       ],
@@ -31,7 +36,9 @@
       'target_name': 'crypto_unittest',
       'type': '<(gtest_target_type)',
       'sources': [
+        'crypto_backend_unittest.cc',
         'encryption_handler_unittest.cc',
+        'pssh_cache_unittest.cc',
         'sample_aes_ec3_cryptor_unittest.cc',
         'subsample_generator_unittest.cc',
       ],
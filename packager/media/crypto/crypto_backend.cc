@@ -0,0 +1,154 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/crypto/crypto_backend.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <map>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/base/aes_cryptor.h"
+#include "packager/media/crypto/aes_encryptor_factory.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kSoftwareBackendName[] = "software";
+
+// The requests of a batch being encrypted on the TaskExecutor.
+struct SoftwareBatch {
+  SoftwareBatch(size_t num_requests, const CryptoBackend::DoneCallback& done)
+      : num_pending_requests(num_requests), done(done) {}
+
+  std::atomic<size_t> num_pending_requests;
+  const CryptoBackend::DoneCallback done;
+};
+
+// Runs on the TaskExecutor. The last request of |batch| completes it.
+void EncryptRequest(CryptoRequest* request, SoftwareBatch* batch) {
+  request->success =
+      EncryptSampleData(request->subsamples, request->source,
+                        request->sample_size, request->dest,
+                        request->encryptor);
+  if (batch->num_pending_requests.fetch_sub(1) == 1) {
+    batch->done();
+    delete batch;
+  }
+}
+
+// Encrypts the requests with the software cryptors, in parallel on the
+// TaskExecutor, as soon as they are created.
+class SoftwareCryptoBackend : public CryptoBackend {
+ public:
+  SoftwareCryptoBackend() = default;
+
+  std::unique_ptr<AesEncryptorFactory> CreateEncryptorFactory() override {
+    return std::unique_ptr<AesEncryptorFactory>(new AesEncryptorFactory);
+  }
+
+  size_t max_batch_size() const override { return 1; }
+
+  void SubmitBatch(const std::vector<CryptoRequest*>& requests,
+                   TaskExecutor::Priority priority,
+                   const DoneCallback& done) override {
+    if (requests.empty()) {
+      done();
+      return;
+    }
+    SoftwareBatch* batch = new SoftwareBatch(requests.size(), done);
+    for (CryptoRequest* request : requests) {
+      TaskExecutor::GetInstance()->PostTask(
+          priority, base::Bind(&EncryptRequest, base::Unretained(request),
+                               base::Unretained(batch)));
+    }
+  }
+
+ private:
+  SoftwareCryptoBackend(const SoftwareCryptoBackend&) = delete;
+  SoftwareCryptoBackend& operator=(const SoftwareCryptoBackend&) = delete;
+};
+
+// The registered backends, by name.
+struct BackendRegistry {
+  BackendRegistry() {
+    backends[kSoftwareBackendName].reset(new SoftwareCryptoBackend);
+  }
+
+  base::Lock lock;
+  std::map<std::string, std::unique_ptr<CryptoBackend>> backends;
+};
+
+BackendRegistry* GetBackendRegistry() {
+  // Leaked, as the backends may be used until exit.
+  static BackendRegistry* registry = new BackendRegistry;
+  return registry;
+}
+
+}  // namespace
+
+bool EncryptSampleData(const std::vector<SubsampleEntry>& subsamples,
+                       const uint8_t* source,
+                       size_t sample_size,
+                       uint8_t* dest,
+                       AesCryptor* encryptor) {
+  DCHECK(source);
+  DCHECK(dest);
+  DCHECK(encryptor);
+  if (subsamples.empty())
+    return encryptor->Crypt(source, sample_size, dest);
+
+  const bool in_place = source == dest;
+  size_t total_size = 0;
+  for (const SubsampleEntry& subsample : subsamples) {
+    if (subsample.clear_bytes > 0) {
+      if (!in_place)
+        memcpy(dest, source, subsample.clear_bytes);
+      source += subsample.clear_bytes;
+      dest += subsample.clear_bytes;
+      total_size += subsample.clear_bytes;
+    }
+    if (subsample.cipher_bytes > 0) {
+      if (!encryptor->Crypt(source, subsample.cipher_bytes, dest))
+        return false;
+      source += subsample.cipher_bytes;
+      dest += subsample.cipher_bytes;
+      total_size += subsample.cipher_bytes;
+    }
+  }
+  DCHECK_EQ(total_size, sample_size);
+  return true;
+}
+
+// static
+bool CryptoBackend::RegisterBackend(const std::string& name,
+                                    std::unique_ptr<CryptoBackend> backend) {
+  DCHECK(backend);
+  BackendRegistry* registry = GetBackendRegistry();
+  base::AutoLock auto_lock(registry->lock);
+  if (name.empty() || registry->backends.count(name) > 0) {
+    LOG(ERROR) << "Cannot register a crypto backend named '" << name << "'.";
+    return false;
+  }
+  registry->backends[name] = std::move(backend);
+  return true;
+}
+
+// static
+CryptoBackend* CryptoBackend::GetBackend(const std::string& name) {
+  BackendRegistry* registry = GetBackendRegistry();
+  base::AutoLock auto_lock(registry->lock);
+  auto iter = registry->backends.find(name.empty() ? kSoftwareBackendName
+                                                   : name);
+  return iter == registry->backends.end() ? nullptr : iter->second.get();
+}
+
+}  // namespace media
+}  // namespace shaka
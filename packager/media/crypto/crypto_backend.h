@@ -0,0 +1,95 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_CRYPTO_CRYPTO_BACKEND_H_
+#define PACKAGER_MEDIA_CRYPTO_CRYPTO_BACKEND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/media/base/decrypt_config.h"
+#include "packager/media/base/task_executor.h"
+
+namespace shaka {
+namespace media {
+
+class AesCryptor;
+class AesEncryptorFactory;
+
+/// Encrypt the data of a sample, or only its cipher bytes if it has
+/// subsamples.
+/// @param subsamples are the subsamples of the sample, if any.
+/// @param source is the clear data, of @a sample_size bytes.
+/// @param dest receives the encrypted data. It can be @a source.
+/// @param encryptor encrypts the data, starting with its current iv.
+/// @return true on success.
+bool EncryptSampleData(const std::vector<SubsampleEntry>& subsamples,
+                       const uint8_t* source,
+                       size_t sample_size,
+                       uint8_t* dest,
+                       AesCryptor* encryptor);
+
+/// A request to encrypt the data of a sample, submitted to a CryptoBackend.
+struct CryptoRequest {
+  /// Created by the factory of the backend, with the iv of the sample.
+  AesCryptor* encryptor = nullptr;
+  std::vector<SubsampleEntry> subsamples;
+  const uint8_t* source = nullptr;
+  size_t sample_size = 0;
+  uint8_t* dest = nullptr;
+  /// Set by the backend once the request is completed.
+  bool success = false;
+};
+
+/// A backend the bulk encryption of the samples is offloaded to, e.g. a
+/// crypto accelerator or the kernel crypto API. Batches of requests, e.g. the
+/// samples of a fragment, are submitted asynchronously. The default backend,
+/// named "software", encrypts the requests in parallel on the TaskExecutor
+/// with the software cryptors. Backends are registered by name, and are
+/// selected with EncryptionParams::crypto_backend. This class is thread safe.
+class CryptoBackend {
+ public:
+  typedef std::function<void()> DoneCallback;
+
+  virtual ~CryptoBackend() = default;
+
+  /// @return the factory of the encryptors of the requests.
+  virtual std::unique_ptr<AesEncryptorFactory> CreateEncryptorFactory() = 0;
+
+  /// @return the maximum number of requests the backend should be submitted
+  ///         at once. The requests are submitted as soon as they are created
+  ///         if it is 1; otherwise they are held back until there are as
+  ///         many, or until the oldest one is waited for.
+  virtual size_t max_batch_size() const = 0;
+
+  /// Submit a batch of requests, which must stay alive until completed.
+  /// @param priority is the priority of the requests, if the backend runs
+  ///        them on the TaskExecutor.
+  /// @param done is called, on any thread, once all the requests are
+  ///        completed.
+  virtual void SubmitBatch(const std::vector<CryptoRequest*>& requests,
+                           TaskExecutor::Priority priority,
+                           const DoneCallback& done) = 0;
+
+  /// Register @a backend under @a name. The backends live until exit.
+  /// @return false if @a name is empty or already registered, e.g. if it is
+  ///         "software".
+  static bool RegisterBackend(const std::string& name,
+                              std::unique_ptr<CryptoBackend> backend);
+  /// @return the backend registered under @a name, the software backend if
+  ///         @a name is empty, or null if there is none.
+  static CryptoBackend* GetBackend(const std::string& name);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_CRYPTO_CRYPTO_BACKEND_H_
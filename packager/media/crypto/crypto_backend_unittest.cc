@@ -0,0 +1,115 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/crypto/crypto_backend.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/crypto/aes_encryptor_factory.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const uint8_t kKey[]{
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+    0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+};
+const uint8_t kIv[]{
+    0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+};
+const size_t kSampleSize = 40;
+const size_t kNumRequests = 3;
+
+class FakeCryptoBackend : public CryptoBackend {
+ public:
+  std::unique_ptr<AesEncryptorFactory> CreateEncryptorFactory() override {
+    return nullptr;
+  }
+  size_t max_batch_size() const override { return 1; }
+  void SubmitBatch(const std::vector<CryptoRequest*>& requests,
+                   TaskExecutor::Priority priority,
+                   const DoneCallback& done) override {
+    done();
+  }
+};
+
+}  // namespace
+
+TEST(CryptoBackendTest, SoftwareBackendIsTheDefault) {
+  CryptoBackend* backend = CryptoBackend::GetBackend("software");
+  ASSERT_TRUE(backend);
+  EXPECT_EQ(backend, CryptoBackend::GetBackend(""));
+  EXPECT_EQ(1u, backend->max_batch_size());
+  EXPECT_FALSE(CryptoBackend::GetBackend("unknown"));
+}
+
+TEST(CryptoBackendTest, CannotReplaceABackend) {
+  CryptoBackend* software_backend = CryptoBackend::GetBackend("");
+  EXPECT_FALSE(CryptoBackend::RegisterBackend(
+      "software", std::unique_ptr<CryptoBackend>(new FakeCryptoBackend)));
+  EXPECT_FALSE(CryptoBackend::RegisterBackend(
+      "", std::unique_ptr<CryptoBackend>(new FakeCryptoBackend)));
+  EXPECT_EQ(software_backend, CryptoBackend::GetBackend("software"));
+}
+
+TEST(CryptoBackendTest, SoftwareBackendEncryptsABatch) {
+  CryptoBackend* backend = CryptoBackend::GetBackend("");
+  ASSERT_TRUE(backend);
+  std::unique_ptr<AesEncryptorFactory> factory =
+      backend->CreateEncryptorFactory();
+
+  const std::vector<uint8_t> key(std::begin(kKey), std::end(kKey));
+  const std::vector<uint8_t> iv(std::begin(kIv), std::end(kIv));
+  const std::vector<uint8_t> clear_data(kSampleSize, 0x5A);
+  std::vector<std::unique_ptr<AesCryptor>> encryptors;
+  std::vector<std::vector<uint8_t>> cipher_data(kNumRequests);
+  std::vector<CryptoRequest> requests(kNumRequests);
+  std::vector<CryptoRequest*> batch;
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    encryptors.push_back(
+        factory->CreateEncryptor(FOURCC_cenc, 0, 0, kCodecH264, key, iv));
+    ASSERT_TRUE(encryptors.back());
+    cipher_data[i].resize(kSampleSize);
+    requests[i].encryptor = encryptors.back().get();
+    // The second request has subsamples.
+    if (i == 1)
+      requests[i].subsamples = {{8, 16}, {16, 0}};
+    requests[i].source = clear_data.data();
+    requests[i].sample_size = kSampleSize;
+    requests[i].dest = cipher_data[i].data();
+    batch.push_back(&requests[i]);
+  }
+
+  base::WaitableEvent done(base::WaitableEvent::ResetPolicy::MANUAL,
+                           base::WaitableEvent::InitialState::NOT_SIGNALED);
+  backend->SubmitBatch(batch, TaskExecutor::kMediaPriority,
+                       [&done]() { done.Signal(); });
+  done.Wait();
+
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    EXPECT_TRUE(requests[i].success);
+    AesCtrEncryptor encryptor;
+    ASSERT_TRUE(encryptor.InitializeWithIv(key, iv));
+    std::vector<uint8_t> expected_data(kSampleSize);
+    ASSERT_TRUE(EncryptSampleData(requests[i].subsamples, clear_data.data(),
+                                  kSampleSize, expected_data.data(),
+                                  &encryptor));
+    EXPECT_EQ(expected_data, cipher_data[i]);
+  }
+  // The clear bytes of the subsamples are copied.
+  EXPECT_TRUE(std::equal(clear_data.begin(), clear_data.begin() + 8,
+                         cipher_data[1].begin()));
+  EXPECT_NE(cipher_data[0], cipher_data[1]);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -11,18 +11,25 @@
 
 #include <algorithm>
 
+#include "packager/base/synchronization/waitable_event.h"
 #include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/common_pssh_generator.h"
 #include "packager/media/base/key_source.h"
+#include "packager/media/base/live_scheduler.h"
 #include "packager/media/base/macros.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/playready_pssh_generator.h"
 #include "packager/media/base/protection_system_ids.h"
+#include "packager/media/base/sample_buffer_pool.h"
+#include "packager/media/base/task_executor.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/base/widevine_pssh_generator.h"
 #include "packager/media/crypto/aes_encryptor_factory.h"
+#include "packager/media/crypto/crypto_backend.h"
+#include "packager/media/crypto/pssh_cache.h"
 #include "packager/media/crypto/subsample_generator.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -122,44 +129,106 @@ void AddProtectionSystemIfNotExist(
   encryption_config->key_system_info.push_back(pssh_info);
 }
 
-Status FillProtectionSystemInfo(const EncryptionParams& encryption_params,
-                                const EncryptionKey& encryption_key,
-                                EncryptionConfig* encryption_config) {
-  // If generating dummy keys for key rotation, don't generate PSSH info.
-  if (encryption_key.key_ids.empty())
-    return Status::OK;
-
+Status GenerateProtectionSystemInfo(
+    const EncryptionParams& encryption_params,
+    const EncryptionKey& encryption_key,
+    std::vector<ProtectionSystemSpecificInfo>* pssh_infos) {
   std::vector<std::unique_ptr<PsshGenerator>> pssh_generators;
   std::vector<std::vector<uint8_t>> no_pssh_systems;
   FillPsshGenerators(encryption_params, &pssh_generators, &no_pssh_systems);
 
-  encryption_config->key_system_info = encryption_key.key_system_info;
   for (const auto& pssh_generator : pssh_generators) {
     const bool support_multiple_keys = pssh_generator->SupportMultipleKeys();
+    ProtectionSystemSpecificInfo info;
     if (support_multiple_keys) {
-      ProtectionSystemSpecificInfo info;
       RETURN_IF_ERROR(pssh_generator->GeneratePsshFromKeyIds(
           encryption_key.key_ids, &info));
-      AddProtectionSystemIfNotExist(info, encryption_config);
     } else {
-      ProtectionSystemSpecificInfo info;
       RETURN_IF_ERROR(pssh_generator->GeneratePsshFromKeyIdAndKey(
           encryption_key.key_id, encryption_key.key, &info));
-      AddProtectionSystemIfNotExist(info, encryption_config);
     }
+    pssh_infos->push_back(std::move(info));
   }
 
   for (const auto& no_pssh_system : no_pssh_systems) {
     ProtectionSystemSpecificInfo info;
     info.system_id = no_pssh_system;
-    AddProtectionSystemIfNotExist(info, encryption_config);
+    pssh_infos->push_back(std::move(info));
+  }
+  return Status::OK;
+}
+
+// Appends |bytes|, prefixed with their size, to |cache_key|.
+template <typename Bytes>
+void AppendToPsshCacheKey(const Bytes& bytes, std::string* cache_key) {
+  cache_key->append(std::to_string(bytes.size()));
+  cache_key->push_back(':');
+  cache_key->append(bytes.begin(), bytes.end());
+}
+
+// Everything the generated protection system info depends on.
+std::string GetPsshCacheKey(const EncryptionParams& encryption_params,
+                            const EncryptionKey& encryption_key) {
+  std::string cache_key;
+  for (int64_t value :
+       {static_cast<int64_t>(encryption_params.protection_systems),
+        static_cast<int64_t>(encryption_params.protection_scheme),
+        static_cast<int64_t>(encryption_params.key_provider),
+        static_cast<int64_t>(encryption_params.raw_key.pssh.empty())}) {
+    cache_key.append(std::to_string(value));
+    cache_key.push_back(':');
   }
+  AppendToPsshCacheKey(encryption_params.playready_extra_header_data,
+                       &cache_key);
+  AppendToPsshCacheKey(encryption_key.key_id, &cache_key);
+  AppendToPsshCacheKey(encryption_key.key, &cache_key);
+  for (const std::vector<uint8_t>& key_id : encryption_key.key_ids)
+    AppendToPsshCacheKey(key_id, &cache_key);
+  return cache_key;
+}
+
+Status FillProtectionSystemInfo(const EncryptionParams& encryption_params,
+                                const EncryptionKey& encryption_key,
+                                EncryptionConfig* encryption_config) {
+  // If generating dummy keys for key rotation, don't generate PSSH info.
+  if (encryption_key.key_ids.empty())
+    return Status::OK;
 
+  // The streams encrypted with the same key share the generated info.
+  std::shared_ptr<const PsshCache::PsshInfos> pssh_infos;
+  RETURN_IF_ERROR(PsshCache::GetInstance()->GetOrGenerate(
+      GetPsshCacheKey(encryption_params, encryption_key),
+      [&encryption_params,
+       &encryption_key](PsshCache::PsshInfos* pssh_infos) {
+        return GenerateProtectionSystemInfo(encryption_params, encryption_key,
+                                            pssh_infos);
+      },
+      &pssh_infos));
+
+  encryption_config->key_system_info = encryption_key.key_system_info;
+  for (const ProtectionSystemSpecificInfo& info : *pssh_infos)
+    AddProtectionSystemIfNotExist(info, encryption_config);
   return Status::OK;
 }
 
 }  // namespace
 
+struct EncryptionHandler::PendingSample {
+  PendingSample()
+      : done(base::WaitableEvent::ResetPolicy::MANUAL,
+             base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  // Keeps the clear data alive until it is encrypted.
+  std::shared_ptr<const MediaSample> clear_sample;
+  std::shared_ptr<MediaSample> cipher_sample;
+  std::unique_ptr<AesCryptor> encryptor;
+  CryptoRequest request;
+  // Whether |request| is submitted to the crypto backend.
+  bool submitted = false;
+  // Signaled when the sample is encrypted.
+  base::WaitableEvent done;
+};
+
 EncryptionHandler::EncryptionHandler(const EncryptionParams& encryption_params,
                                      KeySource* key_source)
     : encryption_params_(encryption_params),
@@ -168,9 +237,18 @@ EncryptionHandler::EncryptionHandler(const EncryptionParams& encryption_params,
       key_source_(key_source),
       subsample_generator_(
           new SubsampleGenerator(encryption_params.vp9_subsample_encryption)),
-      encryptor_factory_(new AesEncryptorFactory) {}
+      crypto_backend_(
+          CryptoBackend::GetBackend(encryption_params.crypto_backend)) {
+  if (crypto_backend_)
+    encryptor_factory_ = crypto_backend_->CreateEncryptorFactory();
+}
 
-EncryptionHandler::~EncryptionHandler() = default;
+EncryptionHandler::~EncryptionHandler() {
+  // The pending samples are referenced by the crypto backend.
+  SubmitPendingSamples();
+  for (const auto& pending_sample : pending_samples_)
+    pending_sample->done.Wait();
+}
 
 Status EncryptionHandler::InitializeInternal() {
   if (!encryption_params_.stream_label_func) {
@@ -180,10 +258,19 @@ Status EncryptionHandler::InitializeInternal() {
     return Status(error::INVALID_ARGUMENT,
                   "Expects exactly one input and output.");
   }
+  if (!crypto_backend_) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Unknown crypto backend '" +
+                      encryption_params_.crypto_backend + "'.");
+  }
   return Status::OK;
 }
 
 Status EncryptionHandler::Process(std::unique_ptr<StreamData> stream_data) {
+  // Keep the output in order in parallel encryption mode.
+  if (stream_data->stream_data_type != StreamDataType::kMediaSample)
+    RETURN_IF_ERROR(DispatchPendingSamples());
+
   switch (stream_data->stream_data_type) {
     case StreamDataType::kStreamInfo:
       return ProcessStreamInfo(*stream_data->stream_info);
@@ -196,7 +283,9 @@ Status EncryptionHandler::Process(std::unique_ptr<StreamData> stream_data) {
       const bool key_rotation_enabled = crypto_period_duration_ != 0;
       if (key_rotation_enabled)
         segment_info->key_rotation_encryption_config = encryption_config_;
+      segment_info->encryption_time = encryption_time_;
       if (!segment_info->is_subsegment) {
+        encryption_time_ = base::TimeDelta();
         if (key_rotation_enabled)
           check_new_crypto_period_ = true;
         if (remaining_clear_lead_ > 0)
@@ -214,6 +303,11 @@ Status EncryptionHandler::Process(std::unique_ptr<StreamData> stream_data) {
   }
 }
 
+Status EncryptionHandler::OnFlushRequest(size_t input_stream_index) {
+  RETURN_IF_ERROR(DispatchPendingSamples());
+  return MediaHandler::OnFlushRequest(input_stream_index);
+}
+
 Status EncryptionHandler::ProcessStreamInfo(const StreamInfo& clear_info) {
   if (clear_info.is_encrypted()) {
     return Status(error::INVALID_ARGUMENT,
@@ -264,12 +358,8 @@ Status EncryptionHandler::ProcessStreamInfo(const StreamInfo& clear_info) {
 Status EncryptionHandler::ProcessMediaSample(
     std::shared_ptr<const MediaSample> clear_sample) {
   DCHECK(clear_sample);
-
-  // Process the frame even if the frame is not encrypted as the next
-  // (encrypted) frame may be dependent on this clear frame.
-  std::vector<SubsampleEntry> subsamples;
-  RETURN_IF_ERROR(subsample_generator_->GenerateSubsamples(
-      clear_sample->data(), clear_sample->data_size(), &subsamples));
+  ScopedTraceEvent trace_event("EncryptionHandler::ProcessMediaSample",
+                               "crypto");
 
   // Need to setup the encryptor for new segments even if this segment does not
   // need to be encrypted, so we can signal encryption metadata earlier to
@@ -282,6 +372,8 @@ Status EncryptionHandler::ProcessMediaSample(
     const uint32_t crypto_period_duration_in_seconds =
         static_cast<uint32_t>(encryption_params_.crypto_period_duration_in_seconds);
     if (current_crypto_period_index != prev_crypto_period_index_) {
+      // The pending samples are encrypted with the previous key.
+      RETURN_IF_ERROR(DispatchPendingSamples());
       EncryptionKey encryption_key;
       RETURN_IF_ERROR(key_source_->GetCryptoPeriodKey(
           current_crypto_period_index, crypto_period_duration_in_seconds,
@@ -293,49 +385,91 @@ Status EncryptionHandler::ProcessMediaSample(
     check_new_crypto_period_ = false;
   }
 
-  // Since there is no encryption needed right now, send the clear copy
-  // downstream so we can save the costs of copying it.
+  // Full sample encrypted frames, e.g. most audio frames, which are small and
+  // many, have no subsamples and are not parsed.
+  const bool full_sample_encryption =
+      subsample_generator_->full_sample_encryption();
+
+  // Since there is no encryption needed right now, send the clear sample
+  // downstream as is. Process the frame still, as the next (encrypted) frame
+  // may be dependent on this clear frame, but without generating subsamples.
   if (remaining_clear_lead_ > 0) {
+    if (!full_sample_encryption) {
+      RETURN_IF_ERROR(subsample_generator_->ProcessClearFrame(
+          clear_sample->data(), clear_sample->data_size()));
+    }
+    RETURN_IF_ERROR(DispatchPendingSamples());
     return DispatchMediaSample(kStreamIndex, std::move(clear_sample));
   }
 
-  std::shared_ptr<uint8_t> cipher_sample_data(
-      new uint8_t[clear_sample->data_size()], std::default_delete<uint8_t[]>());
+  std::vector<SubsampleEntry> subsamples;
+  if (!full_sample_encryption) {
+    const base::TimeTicks start_time = base::TimeTicks::Now();
+    RETURN_IF_ERROR(subsample_generator_->GenerateSubsamples(
+        clear_sample->data(), clear_sample->data_size(), &subsamples));
+    encryption_time_ += base::TimeTicks::Now() - start_time;
+  }
 
-  const uint8_t* source = clear_sample->data();
-  uint8_t* dest = cipher_sample_data.get();
-  if (!subsamples.empty()) {
-    size_t total_size = 0;
-    for (const SubsampleEntry& subsample : subsamples) {
-      if (subsample.clear_bytes > 0) {
-        memcpy(dest, source, subsample.clear_bytes);
-        source += subsample.clear_bytes;
-        dest += subsample.clear_bytes;
-        total_size += subsample.clear_bytes;
-      }
-      if (subsample.cipher_bytes > 0) {
-        EncryptBytes(source, subsample.cipher_bytes, dest);
-        source += subsample.cipher_bytes;
-        dest += subsample.cipher_bytes;
-        total_size += subsample.cipher_bytes;
-      }
-    }
-    DCHECK_EQ(total_size, clear_sample->data_size());
-  } else {
-    EncryptBytes(source, clear_sample->data_size(), dest);
+  // Encrypt in place if no one else refers to the sample or its data, which
+  // is the common case. Otherwise, copy on write.
+  std::shared_ptr<MediaSample> cipher_sample;
+  uint8_t* cipher_data = nullptr;
+  if (clear_sample.use_count() == 1) {
+    std::shared_ptr<MediaSample> unique_sample =
+        std::const_pointer_cast<MediaSample>(clear_sample);
+    cipher_data = unique_sample->unique_writable_data();
+    if (cipher_data)
+      cipher_sample = std::move(unique_sample);
+  }
+  if (!cipher_sample) {
+    std::shared_ptr<uint8_t> cipher_sample_data =
+        SampleBufferPool::GetDefault()->Allocate(clear_sample->data_size(),
+                                                 AllocatorStats::kCrypto);
+    cipher_data = cipher_sample_data.get();
+    cipher_sample = clear_sample->Clone();
+    cipher_sample->TransferData(std::move(cipher_sample_data),
+                                clear_sample->data_size());
+  }
+
+  // Encryption does not change the NAL unit layout. Pass it on so later
+  // stages, e.g. byte stream conversion, do not need to parse it again.
+  if (!subsample_generator_->nalu_layout().empty()) {
+    cipher_sample->set_nalu_layout(
+        std::make_shared<const std::vector<NaluLocation>>(
+            subsample_generator_->nalu_layout()));
   }
 
-  std::shared_ptr<MediaSample> cipher_sample(clear_sample->Clone());
-  cipher_sample->TransferData(std::move(cipher_sample_data),
-                              clear_sample->data_size());
+  if (!iv_secret_.empty() && !encryptor_->use_constant_iv()) {
+    std::vector<uint8_t> iv;
+    AesCryptor::DeriveIv(protection_scheme_, iv_secret_,
+                         std::max(clear_sample->dts(), static_cast<int64_t>(0)),
+                         &iv);
+    if (!encryptor_->SetIv(iv))
+      return Status(error::ENCRYPTION_FAILURE, "Failed to set iv.");
+  }
+
+  if (encryption_params_.parallel_encryption_window > 1) {
+    return EncryptSampleInParallel(std::move(clear_sample),
+                                   std::move(cipher_sample), cipher_data,
+                                   subsamples);
+  }
+
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  if (!EncryptSampleData(subsamples, clear_sample->data(),
+                         clear_sample->data_size(), cipher_data,
+                         encryptor_.get())) {
+    return Status(error::ENCRYPTION_FAILURE, "Failed to encrypt sample.");
+  }
+  encryption_time_ += base::TimeTicks::Now() - start_time;
 
   // Finish initializing the sample before sending it downstream. We must
   // wait until now to finish the initialization as we will lose access to
   // |decrypt_config| once we set it.
   cipher_sample->set_is_encrypted(true);
   std::unique_ptr<DecryptConfig> decrypt_config(new DecryptConfig(
-      encryption_config_->key_id, encryptor_->iv(), subsamples,
-      protection_scheme_, crypt_byte_block_, skip_byte_block_));
+      key_id_, DecryptConfig::Iv(encryptor_->iv()),
+      DecryptConfig::Subsamples(subsamples), protection_scheme_,
+      crypt_byte_block_, skip_byte_block_));
   cipher_sample->set_decrypt_config(std::move(decrypt_config));
 
   encryptor_->UpdateIv();
@@ -343,6 +477,105 @@ Status EncryptionHandler::ProcessMediaSample(
   return DispatchMediaSample(kStreamIndex, std::move(cipher_sample));
 }
 
+Status EncryptionHandler::EncryptSampleInParallel(
+    std::shared_ptr<const MediaSample> clear_sample,
+    std::shared_ptr<MediaSample> cipher_sample,
+    uint8_t* cipher_data,
+    const std::vector<SubsampleEntry>& subsamples) {
+  std::unique_ptr<PendingSample> pending_sample(new PendingSample);
+  if (idle_encryptors_.empty()) {
+    pending_sample->encryptor = encryptor_factory_->CreateEncryptor(
+        protection_scheme_, crypt_byte_block_, skip_byte_block_, codec_, key_,
+        encryptor_->iv());
+    if (!pending_sample->encryptor)
+      return Status(error::ENCRYPTION_FAILURE, "Failed to create encryptor");
+  } else {
+    pending_sample->encryptor = std::move(idle_encryptors_.back());
+    idle_encryptors_.pop_back();
+  }
+  if (!pending_sample->encryptor->SetIv(encryptor_->iv()))
+    return Status(error::ENCRYPTION_FAILURE, "Failed to set iv.");
+
+  size_t num_crypt_bytes = 0;
+  if (subsamples.empty()) {
+    num_crypt_bytes = clear_sample->data_size();
+  } else {
+    for (const SubsampleEntry& subsample : subsamples)
+      num_crypt_bytes += subsample.cipher_bytes;
+  }
+
+  cipher_sample->set_is_encrypted(true);
+  std::unique_ptr<DecryptConfig> decrypt_config(new DecryptConfig(
+      key_id_, DecryptConfig::Iv(encryptor_->iv()),
+      DecryptConfig::Subsamples(subsamples), protection_scheme_,
+      crypt_byte_block_, skip_byte_block_));
+  cipher_sample->set_decrypt_config(std::move(decrypt_config));
+
+  encryptor_->UpdateIvForCryptedBytes(num_crypt_bytes);
+
+  CryptoRequest& request = pending_sample->request;
+  request.encryptor = pending_sample->encryptor.get();
+  request.subsamples = subsamples;
+  request.source = clear_sample->data();
+  request.sample_size = clear_sample->data_size();
+  request.dest = cipher_data;
+  pending_sample->clear_sample = std::move(clear_sample);
+  pending_sample->cipher_sample = std::move(cipher_sample);
+  unsubmitted_samples_.push_back(pending_sample.get());
+  pending_samples_.push_back(std::move(pending_sample));
+  if (unsubmitted_samples_.size() >= crypto_backend_->max_batch_size())
+    SubmitPendingSamples();
+
+  if (pending_samples_.size() >= encryption_params_.parallel_encryption_window)
+    return DispatchOldestPendingSample();
+  return Status::OK;
+}
+
+void EncryptionHandler::SubmitPendingSamples() {
+  if (unsubmitted_samples_.empty())
+    return;
+  std::vector<CryptoRequest*> requests;
+  for (PendingSample* pending_sample : unsubmitted_samples_) {
+    pending_sample->submitted = true;
+    requests.push_back(&pending_sample->request);
+  }
+  std::vector<PendingSample*> batch;
+  batch.swap(unsubmitted_samples_);
+  const TaskExecutor::Priority priority =
+      stream_lag_ && stream_lag_->lagging()
+          ? TaskExecutor::kLaggingMediaPriority
+          : TaskExecutor::kMediaPriority;
+  crypto_backend_->SubmitBatch(requests, priority, [batch]() {
+    for (PendingSample* pending_sample : batch)
+      pending_sample->done.Signal();
+  });
+}
+
+Status EncryptionHandler::DispatchOldestPendingSample() {
+  DCHECK(!pending_samples_.empty());
+  std::unique_ptr<PendingSample> pending_sample =
+      std::move(pending_samples_.front());
+  pending_samples_.pop_front();
+  // The samples held back for a batch are submitted before waiting.
+  if (!pending_sample->submitted)
+    SubmitPendingSamples();
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  pending_sample->done.Wait();
+  encryption_time_ += base::TimeTicks::Now() - start_time;
+
+  idle_encryptors_.push_back(std::move(pending_sample->encryptor));
+  if (!pending_sample->request.success)
+    return Status(error::ENCRYPTION_FAILURE, "Failed to encrypt sample.");
+  return DispatchMediaSample(kStreamIndex,
+                             std::move(pending_sample->cipher_sample));
+}
+
+Status EncryptionHandler::DispatchPendingSamples() {
+  while (!pending_samples_.empty())
+    RETURN_IF_ERROR(DispatchOldestPendingSample());
+  return Status::OK;
+}
+
 void EncryptionHandler::SetupProtectionPattern(StreamType stream_type) {
   if (stream_type == kStreamVideo &&
       IsPatternEncryptionScheme(protection_scheme_)) {
@@ -358,41 +591,45 @@ void EncryptionHandler::SetupProtectionPattern(StreamType stream_type) {
 }
 
 bool EncryptionHandler::CreateEncryptor(const EncryptionKey& encryption_key) {
+  std::string iv_secret;
+  std::vector<uint8_t> iv = encryption_key.iv;
+  if (!encryption_params_.deterministic_iv_seed.empty()) {
+    iv_secret.assign(encryption_key.key.begin(), encryption_key.key.end());
+    iv_secret += encryption_params_.deterministic_iv_seed;
+    // The initial iv, which is the constant iv of 'cbcs' and SAMPLE-AES.
+    if (iv.empty())
+      AesCryptor::DeriveIv(protection_scheme_, iv_secret, 0, &iv);
+  }
   std::unique_ptr<AesCryptor> encryptor = encryptor_factory_->CreateEncryptor(
       protection_scheme_, crypt_byte_block_, skip_byte_block_, codec_,
-      encryption_key.key, encryption_key.iv);
+      encryption_key.key, iv);
   if (!encryptor)
     return false;
   encryptor_ = std::move(encryptor);
+  key_ = encryption_key.key;
+  iv_secret_ = std::move(iv_secret);
+  idle_encryptors_.clear();
 
   encryption_config_.reset(new EncryptionConfig);
   encryption_config_->protection_scheme = protection_scheme_;
   encryption_config_->crypt_byte_block = crypt_byte_block_;
   encryption_config_->skip_byte_block = skip_byte_block_;
 
-  const std::vector<uint8_t>& iv = encryptor_->iv();
   if (encryptor_->use_constant_iv()) {
     encryption_config_->per_sample_iv_size = 0;
-    encryption_config_->constant_iv = iv;
+    encryption_config_->constant_iv = encryptor_->iv();
   } else {
-    encryption_config_->per_sample_iv_size = static_cast<uint8_t>(iv.size());
+    encryption_config_->per_sample_iv_size =
+        static_cast<uint8_t>(encryptor_->iv().size());
   }
 
   encryption_config_->key_id = encryption_key.key_id;
+  key_id_ = std::make_shared<const std::vector<uint8_t>>(encryption_key.key_id);
   const auto status = FillProtectionSystemInfo(
       encryption_params_, encryption_key, encryption_config_.get());
   return status.ok();
 }
 
-void EncryptionHandler::EncryptBytes(const uint8_t* source,
-                                     size_t source_size,
-                                     uint8_t* dest) {
-  DCHECK(source);
-  DCHECK(dest);
-  DCHECK(encryptor_);
-  CHECK(encryptor_->Crypt(source, source_size, dest));
-}
-
 void EncryptionHandler::InjectSubsampleGeneratorForTesting(
     std::unique_ptr<SubsampleGenerator> generator) {
   subsample_generator_ = std::move(generator);
@@ -7,6 +7,10 @@
 #ifndef PACKAGER_MEDIA_CRYPTO_ENCRYPTION_HANDLER_H_
 #define PACKAGER_MEDIA_CRYPTO_ENCRYPTION_HANDLER_H_
 
+#include <deque>
+#include <memory>
+#include <vector>
+
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/media_handler.h"
 #include "packager/media/public/crypto_params.h"
@@ -16,8 +20,11 @@ namespace media {
 
 class AesCryptor;
 class AesEncryptorFactory;
+class CryptoBackend;
+class LiveStreamLag;
 class SubsampleGenerator;
 struct EncryptionKey;
+struct SubsampleEntry;
 
 class EncryptionHandler : public MediaHandler {
  public:
@@ -26,11 +33,18 @@ class EncryptionHandler : public MediaHandler {
 
   ~EncryptionHandler() override;
 
+  /// @param stream_lag is the lag of the live stream, whose samples are
+  ///        encrypted first on the TaskExecutor while it is lagging.
+  void set_live_stream_lag(std::shared_ptr<LiveStreamLag> stream_lag) {
+    stream_lag_ = std::move(stream_lag);
+  }
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
   Status InitializeInternal() override;
   Status Process(std::unique_ptr<StreamData> stream_data) override;
+  Status OnFlushRequest(size_t input_stream_index) override;
   /// @}
 
  private:
@@ -39,28 +53,32 @@ class EncryptionHandler : public MediaHandler {
   EncryptionHandler(const EncryptionHandler&) = delete;
   EncryptionHandler& operator=(const EncryptionHandler&) = delete;
 
+  // A sample being encrypted on the TaskExecutor in parallel encryption mode.
+  struct PendingSample;
+
   // Processes |stream_info| and sets up stream specific variables.
   Status ProcessStreamInfo(const StreamInfo& stream_info);
   // Processes media sample and encrypts it if needed.
   Status ProcessMediaSample(std::shared_ptr<const MediaSample> clear_sample);
 
+  // Encrypts |cipher_data| of |cipher_sample| with the crypto backend with
+  // the current iv, and advances the iv as if the sample was encrypted by
+  // |encryptor_|. The oldest pending sample is dispatched if the window is
+  // full.
+  Status EncryptSampleInParallel(
+      std::shared_ptr<const MediaSample> clear_sample,
+      std::shared_ptr<MediaSample> cipher_sample,
+      uint8_t* cipher_data,
+      const std::vector<SubsampleEntry>& subsamples);
+  // Waits for the oldest pending sample to be encrypted and dispatches it.
+  Status DispatchOldestPendingSample();
+  // Dispatches all the pending samples, in order.
+  Status DispatchPendingSamples();
+  // Submits the samples held back for a batch to the crypto backend.
+  void SubmitPendingSamples();
+
   void SetupProtectionPattern(StreamType stream_type);
   bool CreateEncryptor(const EncryptionKey& encryption_key);
-  // Encrypt an E-AC3 frame with size |source_size| according to SAMPLE-AES
-  // specification. |dest| should have at least |source_size| bytes.
-  bool SampleAesEncryptEac3Frame(const uint8_t* source,
-                                 size_t source_size,
-                                 uint8_t* dest);
-  // Encrypt an array with size |source_size|. |dest| should have at
-  // least |source_size| bytes.
-  void EncryptBytes(const uint8_t* source, size_t source_size, uint8_t* dest);
-
-  // An E-AC3 frame comprises of one or more syncframes. This function extracts
-  // the syncframe sizes from the source bytes.
-  // Returns false if the frame is not well formed.
-  bool ExtractEac3SyncframeSizes(const uint8_t* source,
-                                 size_t source_size,
-                                 std::vector<size_t>* syncframe_sizes);
 
   // Testing injections.
   void InjectSubsampleGeneratorForTesting(
@@ -75,6 +93,14 @@ class EncryptionHandler : public MediaHandler {
   // Current encryption config and encryptor.
   std::shared_ptr<EncryptionConfig> encryption_config_;
   std::unique_ptr<AesCryptor> encryptor_;
+  // Current encryption key, used to create the encryptors of the parallel
+  // encryption mode.
+  std::vector<uint8_t> key_;
+  // The current key followed by EncryptionParams::deterministic_iv_seed,
+  // which the initialization vectors are derived from, if the seed is set.
+  std::string iv_secret_;
+  // Key ID of the current key, shared by the decrypt configs of the samples.
+  std::shared_ptr<const std::vector<uint8_t>> key_id_;
   Codec codec_ = kUnknownCodec;
   // Remaining clear lead in the stream's time scale.
   int64_t remaining_clear_lead_ = 0;
@@ -83,13 +109,27 @@ class EncryptionHandler : public MediaHandler {
   // Previous crypto period index if key rotation is enabled.
   int64_t prev_crypto_period_index_ = -1;
   bool check_new_crypto_period_ = false;
+  // Time spent encrypting the samples since the start of the segment, passed
+  // on in the SegmentInfo, see SegmentInfo::encryption_time.
+  base::TimeDelta encryption_time_;
 
   std::unique_ptr<SubsampleGenerator> subsample_generator_;
+  // Null if EncryptionParams::crypto_backend is unknown.
+  CryptoBackend* crypto_backend_ = nullptr;
   std::unique_ptr<AesEncryptorFactory> encryptor_factory_;
   // Number of encrypted blocks (16-byte-block) in pattern based encryption.
   uint8_t crypt_byte_block_ = 0;
   /// Number of unencrypted blocks (16-byte-block) in pattern based encryption.
   uint8_t skip_byte_block_ = 0;
+
+  // Samples being encrypted in parallel encryption mode, in decoding order.
+  std::deque<std::unique_ptr<PendingSample>> pending_samples_;
+  // The pending samples not submitted to the crypto backend yet, which are
+  // held back until there is a full batch.
+  std::vector<PendingSample*> unsubmitted_samples_;
+  // Encryptors with the current key that are not used by a pending sample.
+  std::vector<std::unique_ptr<AesCryptor>> idle_encryptors_;
+  std::shared_ptr<LiveStreamLag> stream_lag_;
 };
 
 }  // namespace media
@@ -10,11 +10,13 @@
 #include <gtest/gtest.h>
 
 #include "packager/media/base/aes_cryptor.h"
+#include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/media_handler_test_base.h"
 #include "packager/media/base/mock_aes_cryptor.h"
 #include "packager/media/base/protection_system_ids.h"
 #include "packager/media/base/raw_key_source.h"
 #include "packager/media/crypto/aes_encryptor_factory.h"
+#include "packager/media/crypto/crypto_backend.h"
 #include "packager/media/crypto/subsample_generator.h"
 #include "packager/status_test_util.h"
 
@@ -83,6 +85,24 @@ class MockSubsampleGenerator : public SubsampleGenerator {
                       std::vector<SubsampleEntry>* subsamples));
 };
 
+// Counts the frames parsed by the subsample generator.
+class CountingSubsampleGenerator : public SubsampleGenerator {
+ public:
+  explicit CountingSubsampleGenerator(int* num_frames)
+      : SubsampleGenerator(true), num_frames_(num_frames) {}
+
+  Status GenerateSubsamples(const uint8_t* frame,
+                            size_t frame_size,
+                            std::vector<SubsampleEntry>* subsamples) override {
+    ++*num_frames_;
+    return SubsampleGenerator::GenerateSubsamples(frame, frame_size,
+                                                  subsamples);
+  }
+
+ private:
+  int* const num_frames_;
+};
+
 class MockAesEncryptorFactory : public AesEncryptorFactory {
  public:
   MOCK_METHOD6(CreateEncryptor,
@@ -126,6 +146,10 @@ class EncryptionHandlerTest : public MediaHandlerGraphTestBase {
     return encryption_handler_->Process(std::move(stream_data));
   }
 
+  Status OnFlushRequest(size_t input_stream_index) {
+    return encryption_handler_->OnFlushRequest(input_stream_index);
+  }
+
   EncryptionKey GetMockEncryptionKey() {
     EncryptionKey encryption_key;
     encryption_key.key_id.assign(kKeyId, kKeyId + sizeof(kKeyId));
@@ -146,6 +170,11 @@ class EncryptionHandlerTest : public MediaHandlerGraphTestBase {
         std::move(mock_generator));
   }
 
+  void InjectSubsampleGenerator(std::unique_ptr<SubsampleGenerator> generator) {
+    encryption_handler_->InjectSubsampleGeneratorForTesting(
+        std::move(generator));
+  }
+
   void InjectEncryptorFactoryForTesting(
       std::unique_ptr<AesEncryptorFactory> encryptor_factory) {
     encryption_handler_->InjectEncryptorFactoryForTesting(
@@ -559,6 +588,248 @@ TEST_P(EncryptionHandlerSubsampleTest, SubsampleTest) {
   EXPECT_EQ(GetParam().subsamples, decrypt_config.subsamples());
 }
 
+TEST_F(EncryptionHandlerTest, CopiesOnWriteIfSampleIsShared) {
+  std::unique_ptr<MockAesCryptor> mock_encryptor(new MockAesCryptor);
+  EXPECT_CALL(*mock_encryptor, CryptInternal(_, _, _, _))
+      .WillRepeatedly(Invoke(MockEncrypt));
+  ASSERT_TRUE(mock_encryptor->SetIv(
+      std::vector<uint8_t>(std::begin(kIv), std::end(kIv))));
+
+  std::unique_ptr<MockAesEncryptorFactory> mock_encryptor_factory(
+      new MockAesEncryptorFactory);
+  EXPECT_CALL(*mock_encryptor_factory, CreateEncryptor(_, _, _, _, _, _))
+      .WillOnce(Return(ByMove(std::move(mock_encryptor))));
+  InjectEncryptorFactoryForTesting(std::move(mock_encryptor_factory));
+
+  InjectSubsamples(std::vector<SubsampleEntry>());
+
+  EXPECT_CALL(mock_key_source_, GetKey(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(GetMockEncryptionKey()), Return(Status::OK)));
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale, kCodecH264))));
+
+  // A sample that is still referenced upstream must not be modified.
+  std::shared_ptr<MediaSample> shared_sample =
+      GetMediaSample(0, kSampleDuration, kIsKeyFrame, kData, kDataSize);
+  ASSERT_OK(Process(StreamData::FromMediaSample(kStreamIndex, shared_sample)));
+  EXPECT_EQ(std::vector<uint8_t>(kData, kData + kDataSize),
+            std::vector<uint8_t>(shared_sample->data(),
+                                 shared_sample->data() + kDataSize));
+  EXPECT_FALSE(shared_sample->is_encrypted());
+  const MediaSample& copied_sample =
+      *GetOutputStreamDataVector().back()->media_sample;
+  EXPECT_NE(shared_sample->data(), copied_sample.data());
+  EXPECT_TRUE(copied_sample.is_encrypted());
+
+  // A sample that is not referenced anywhere else is encrypted in place.
+  std::shared_ptr<MediaSample> unique_sample = GetMediaSample(
+      kSampleDuration, kSampleDuration, kIsKeyFrame, kData, kDataSize);
+  const uint8_t* unique_sample_data = unique_sample->data();
+  ASSERT_OK(Process(
+      StreamData::FromMediaSample(kStreamIndex, std::move(unique_sample))));
+  const MediaSample& in_place_sample =
+      *GetOutputStreamDataVector().back()->media_sample;
+  EXPECT_EQ(unique_sample_data, in_place_sample.data());
+  EXPECT_TRUE(in_place_sample.is_encrypted());
+}
+
+TEST_F(EncryptionHandlerTest, ParallelEncryption) {
+  EncryptionParams encryption_params;
+  encryption_params.parallel_encryption_window = 3;
+  SetUpEncryptionHandler(encryption_params);
+
+  EXPECT_CALL(mock_key_source_, GetKey(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(GetMockEncryptionKey()), Return(Status::OK)));
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale, kCodecH264))));
+  const int kNumSamples = 5;
+  for (int i = 0; i < kNumSamples; ++i) {
+    ASSERT_OK(Process(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kSampleDuration, kSampleDuration,
+                                     kIsKeyFrame, kData, kDataSize))));
+  }
+  // The last two samples are still in the window.
+  EXPECT_EQ(static_cast<size_t>(1 + kNumSamples - 2),
+            GetOutputStreamDataVector().size());
+
+  ASSERT_OK(OnFlushRequest(kStreamIndex));
+  const auto& output_stream_data = GetOutputStreamDataVector();
+  ASSERT_EQ(static_cast<size_t>(1 + kNumSamples), output_stream_data.size());
+
+  // The output is the same as with sequential encryption.
+  AesCtrEncryptor encryptor;
+  ASSERT_TRUE(encryptor.InitializeWithIv(
+      std::vector<uint8_t>(std::begin(kKey), std::end(kKey)),
+      std::vector<uint8_t>(std::begin(kIv), std::end(kIv))));
+  const std::vector<uint8_t> clear_data(kData, kData + kDataSize);
+  for (int i = 0; i < kNumSamples; ++i) {
+    const MediaSample& sample = *output_stream_data[1 + i]->media_sample;
+    EXPECT_EQ(i * kSampleDuration, sample.dts());
+    EXPECT_TRUE(sample.is_encrypted());
+    EXPECT_EQ(encryptor.iv(), sample.decrypt_config()->iv());
+
+    std::vector<uint8_t> expected_data;
+    ASSERT_TRUE(encryptor.Crypt(clear_data, &expected_data));
+    EXPECT_EQ(expected_data, std::vector<uint8_t>(
+                                 sample.data(), sample.data() + kDataSize));
+    encryptor.UpdateIv();
+  }
+}
+
+namespace {
+
+const char kBatchedBackendName[] = "test_batched";
+const size_t kBatchSize = 4;
+
+// Encrypts the batches synchronously, recording their sizes.
+class BatchedCryptoBackend : public CryptoBackend {
+ public:
+  std::unique_ptr<AesEncryptorFactory> CreateEncryptorFactory() override {
+    return std::unique_ptr<AesEncryptorFactory>(new AesEncryptorFactory);
+  }
+
+  size_t max_batch_size() const override { return kBatchSize; }
+
+  void SubmitBatch(const std::vector<CryptoRequest*>& requests,
+                   TaskExecutor::Priority priority,
+                   const DoneCallback& done) override {
+    batch_sizes_.push_back(requests.size());
+    for (CryptoRequest* request : requests) {
+      request->success =
+          EncryptSampleData(request->subsamples, request->source,
+                            request->sample_size, request->dest,
+                            request->encryptor);
+    }
+    done();
+  }
+
+  std::vector<size_t> TakeBatchSizes() {
+    std::vector<size_t> batch_sizes;
+    batch_sizes.swap(batch_sizes_);
+    return batch_sizes;
+  }
+
+ private:
+  std::vector<size_t> batch_sizes_;
+};
+
+BatchedCryptoBackend* GetBatchedCryptoBackend() {
+  static BatchedCryptoBackend* backend = [] {
+    BatchedCryptoBackend* backend = new BatchedCryptoBackend;
+    CHECK(CryptoBackend::RegisterBackend(
+        kBatchedBackendName, std::unique_ptr<CryptoBackend>(backend)));
+    return backend;
+  }();
+  return backend;
+}
+
+}  // namespace
+
+TEST_F(EncryptionHandlerTest, ParallelEncryptionInBatches) {
+  BatchedCryptoBackend* backend = GetBatchedCryptoBackend();
+  EncryptionParams encryption_params;
+  encryption_params.parallel_encryption_window = 8;
+  encryption_params.crypto_backend = kBatchedBackendName;
+  SetUpEncryptionHandler(encryption_params);
+
+  EXPECT_CALL(mock_key_source_, GetKey(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(GetMockEncryptionKey()), Return(Status::OK)));
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale, kCodecH264))));
+  const int kNumSamples = 5;
+  for (int i = 0; i < kNumSamples; ++i) {
+    ASSERT_OK(Process(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kSampleDuration, kSampleDuration,
+                                     kIsKeyFrame, kData, kDataSize))));
+  }
+  // A full batch is submitted as soon as there is one.
+  EXPECT_THAT(backend->TakeBatchSizes(), ElementsAre(kBatchSize));
+  EXPECT_EQ(1u, GetOutputStreamDataVector().size());
+
+  // The rest is submitted when it is waited for.
+  ASSERT_OK(OnFlushRequest(kStreamIndex));
+  EXPECT_THAT(backend->TakeBatchSizes(), ElementsAre(1u));
+  const auto& output_stream_data = GetOutputStreamDataVector();
+  ASSERT_EQ(static_cast<size_t>(1 + kNumSamples), output_stream_data.size());
+
+  // The output is the same as with sequential encryption.
+  AesCtrEncryptor encryptor;
+  ASSERT_TRUE(encryptor.InitializeWithIv(
+      std::vector<uint8_t>(std::begin(kKey), std::end(kKey)),
+      std::vector<uint8_t>(std::begin(kIv), std::end(kIv))));
+  const std::vector<uint8_t> clear_data(kData, kData + kDataSize);
+  for (int i = 0; i < kNumSamples; ++i) {
+    const MediaSample& sample = *output_stream_data[1 + i]->media_sample;
+    EXPECT_EQ(i * kSampleDuration, sample.dts());
+    EXPECT_EQ(encryptor.iv(), sample.decrypt_config()->iv());
+
+    std::vector<uint8_t> expected_data;
+    ASSERT_TRUE(encryptor.Crypt(clear_data, &expected_data));
+    EXPECT_EQ(expected_data, std::vector<uint8_t>(
+                                 sample.data(), sample.data() + kDataSize));
+    encryptor.UpdateIv();
+  }
+}
+
+TEST_F(EncryptionHandlerTest, UnknownCryptoBackend) {
+  EncryptionParams encryption_params;
+  encryption_params.parallel_encryption_window = 8;
+  encryption_params.crypto_backend = "unknown";
+  SetUpEncryptionHandler(encryption_params);
+  ASSERT_EQ(error::INVALID_ARGUMENT,
+            encryption_handler_->Initialize().error_code());
+}
+
+TEST_F(EncryptionHandlerTest, FullSampleEncryptedFramesAreNotParsed) {
+  SetUpEncryptionHandler(EncryptionParams());
+  int num_parsed_frames = 0;
+  InjectSubsampleGenerator(std::unique_ptr<SubsampleGenerator>(
+      new CountingSubsampleGenerator(&num_parsed_frames)));
+
+  EXPECT_CALL(mock_key_source_, GetKey(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(GetMockEncryptionKey()), Return(Status::OK)));
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetAudioStreamInfo(kTimeScale, kCodecAAC))));
+  const int kNumSamples = 3;
+  for (int i = 0; i < kNumSamples; ++i) {
+    ASSERT_OK(Process(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kSampleDuration, kSampleDuration,
+                                     kIsKeyFrame, kData, kDataSize))));
+  }
+  EXPECT_EQ(0, num_parsed_frames);
+
+  const auto& output_stream_data = GetOutputStreamDataVector();
+  ASSERT_EQ(static_cast<size_t>(1 + kNumSamples), output_stream_data.size());
+  AesCtrEncryptor encryptor;
+  ASSERT_TRUE(encryptor.InitializeWithIv(
+      std::vector<uint8_t>(std::begin(kKey), std::end(kKey)),
+      std::vector<uint8_t>(std::begin(kIv), std::end(kIv))));
+  const std::vector<uint8_t> clear_data(kData, kData + kDataSize);
+  for (int i = 0; i < kNumSamples; ++i) {
+    const MediaSample& sample = *output_stream_data[1 + i]->media_sample;
+    ASSERT_TRUE(sample.decrypt_config());
+    EXPECT_TRUE(sample.decrypt_config()->subsamples().empty());
+    // The samples share the key ID.
+    EXPECT_EQ(output_stream_data[1]->media_sample->decrypt_config()
+                  ->shared_key_id(),
+              sample.decrypt_config()->shared_key_id());
+
+    std::vector<uint8_t> expected_data;
+    ASSERT_TRUE(encryptor.Crypt(clear_data, &expected_data));
+    EXPECT_EQ(expected_data, std::vector<uint8_t>(
+                                 sample.data(), sample.data() + kDataSize));
+    encryptor.UpdateIv();
+  }
+}
+
 class EncryptionHandlerTrackTypeTest : public EncryptionHandlerTest {};
 
 TEST_F(EncryptionHandlerTrackTypeTest, AudioTrackType) {
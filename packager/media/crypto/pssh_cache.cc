@@ -0,0 +1,75 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/crypto/pssh_cache.h"
+
+#include "packager/base/logging.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Enough for the streams of a few crypto periods of a large ladder.
+const size_t kDefaultCapacity = 256;
+
+}  // namespace
+
+PsshCache::PsshCache(size_t capacity) : capacity_(capacity) {
+  DCHECK_GT(capacity_, 0u);
+}
+
+PsshCache::~PsshCache() {}
+
+PsshCache* PsshCache::GetInstance() {
+  // Leaked, as the encryption handlers may be destroyed at exit.
+  static PsshCache* instance = new PsshCache(kDefaultCapacity);
+  return instance;
+}
+
+Status PsshCache::GetOrGenerate(const std::string& cache_key,
+                                const GenerateCallback& generate,
+                                std::shared_ptr<const PsshInfos>* pssh_infos) {
+  DCHECK(pssh_infos);
+  {
+    base::AutoLock auto_lock(lock_);
+    auto iter = entries_.find(cache_key);
+    if (iter != entries_.end()) {
+      lru_keys_.splice(lru_keys_.begin(), lru_keys_,
+                       iter->second.lru_position);
+      *pssh_infos = iter->second.pssh_infos;
+      return Status::OK;
+    }
+  }
+
+  // Streams with the same key may race to generate it. The first one to
+  // finish is cached.
+  std::shared_ptr<PsshInfos> generated_pssh_infos(new PsshInfos);
+  RETURN_IF_ERROR(generate(generated_pssh_infos.get()));
+
+  base::AutoLock auto_lock(lock_);
+  auto iter = entries_.find(cache_key);
+  if (iter != entries_.end()) {
+    *pssh_infos = iter->second.pssh_infos;
+    return Status::OK;
+  }
+  lru_keys_.push_front(cache_key);
+  entries_[cache_key] = {generated_pssh_infos, lru_keys_.begin()};
+  if (entries_.size() > capacity_) {
+    entries_.erase(lru_keys_.back());
+    lru_keys_.pop_back();
+  }
+  *pssh_infos = std::move(generated_pssh_infos);
+  return Status::OK;
+}
+
+size_t PsshCache::size() const {
+  base::AutoLock auto_lock(lock_);
+  return entries_.size();
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,76 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_CRYPTO_PSSH_CACHE_H_
+#define PACKAGER_MEDIA_CRYPTO_PSSH_CACHE_H_
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/base/protection_system_specific_info.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// Process wide cache of the protection system info generated for a key, so
+/// that the streams encrypted with the same key, e.g. the renditions of a
+/// crypto period with key rotation, share a single generation of the PSSH
+/// boxes, which is expensive for PlayReady. The least recently used entries
+/// are evicted beyond the capacity. This class is thread safe.
+class PsshCache {
+ public:
+  typedef std::vector<ProtectionSystemSpecificInfo> PsshInfos;
+  typedef std::function<Status(PsshInfos* pssh_infos)> GenerateCallback;
+
+  /// @param capacity is the maximum number of cached keys.
+  explicit PsshCache(size_t capacity);
+  ~PsshCache();
+
+  /// @return the process wide cache.
+  static PsshCache* GetInstance();
+
+  /// Get the protection system info cached under @a cache_key, or generate it
+  /// with @a generate and cache it.
+  /// @param cache_key identifies the key and everything else the protection
+  ///        system info depends on.
+  /// @param generate is called without the lock held if there is no entry.
+  ///        It is not cached if it fails.
+  /// @param[out] pssh_infos receives the shared protection system info.
+  Status GetOrGenerate(const std::string& cache_key,
+                       const GenerateCallback& generate,
+                       std::shared_ptr<const PsshInfos>* pssh_infos);
+
+  /// @return the number of cached keys.
+  size_t size() const;
+
+ private:
+  PsshCache(const PsshCache&) = delete;
+  PsshCache& operator=(const PsshCache&) = delete;
+
+  struct Entry {
+    std::shared_ptr<const PsshInfos> pssh_infos;
+    // Position in |lru_keys_|.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  const size_t capacity_;
+  mutable base::Lock lock_;
+  // Protected by |lock_|.
+  std::map<std::string, Entry> entries_;
+  // The keys of |entries_|, the most recently used first.
+  std::list<std::string> lru_keys_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_CRYPTO_PSSH_CACHE_H_
@@ -0,0 +1,94 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/crypto/pssh_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const size_t kCapacity = 2;
+
+// Generates a single info whose system id is |system_id|, counting the
+// generations.
+PsshCache::GenerateCallback GetGenerateCallback(uint8_t system_id,
+                                                int* num_generations) {
+  return [system_id, num_generations](PsshCache::PsshInfos* pssh_infos) {
+    ++*num_generations;
+    ProtectionSystemSpecificInfo info;
+    info.system_id.assign(1, system_id);
+    pssh_infos->push_back(info);
+    return Status::OK;
+  };
+}
+
+}  // namespace
+
+TEST(PsshCacheTest, GeneratesOncePerKey) {
+  PsshCache cache(kCapacity);
+  int num_generations = 0;
+  std::shared_ptr<const PsshCache::PsshInfos> first;
+  ASSERT_OK(cache.GetOrGenerate(
+      "key1", GetGenerateCallback(1, &num_generations), &first));
+  std::shared_ptr<const PsshCache::PsshInfos> second;
+  ASSERT_OK(cache.GetOrGenerate(
+      "key1", GetGenerateCallback(2, &num_generations), &second));
+  EXPECT_EQ(1, num_generations);
+  EXPECT_EQ(first, second);
+  ASSERT_EQ(1u, second->size());
+  EXPECT_EQ(std::vector<uint8_t>(1, 1), (*second)[0].system_id);
+}
+
+TEST(PsshCacheTest, EvictsTheLeastRecentlyUsedKey) {
+  PsshCache cache(kCapacity);
+  int num_generations = 0;
+  std::shared_ptr<const PsshCache::PsshInfos> pssh_infos;
+  ASSERT_OK(cache.GetOrGenerate(
+      "key1", GetGenerateCallback(1, &num_generations), &pssh_infos));
+  ASSERT_OK(cache.GetOrGenerate(
+      "key2", GetGenerateCallback(2, &num_generations), &pssh_infos));
+  // Uses key1, so key2 is evicted next.
+  ASSERT_OK(cache.GetOrGenerate(
+      "key1", GetGenerateCallback(1, &num_generations), &pssh_infos));
+  ASSERT_OK(cache.GetOrGenerate(
+      "key3", GetGenerateCallback(3, &num_generations), &pssh_infos));
+  EXPECT_EQ(3, num_generations);
+  EXPECT_EQ(kCapacity, cache.size());
+
+  ASSERT_OK(cache.GetOrGenerate(
+      "key1", GetGenerateCallback(1, &num_generations), &pssh_infos));
+  EXPECT_EQ(3, num_generations);
+  ASSERT_OK(cache.GetOrGenerate(
+      "key2", GetGenerateCallback(2, &num_generations), &pssh_infos));
+  EXPECT_EQ(4, num_generations);
+}
+
+TEST(PsshCacheTest, FailuresAreNotCached) {
+  PsshCache cache(kCapacity);
+  int num_generations = 0;
+  std::shared_ptr<const PsshCache::PsshInfos> pssh_infos;
+  ASSERT_EQ(error::ENCRYPTION_FAILURE,
+            cache
+                .GetOrGenerate("key1",
+                               [](PsshCache::PsshInfos* pssh_infos) {
+                                 return Status(error::ENCRYPTION_FAILURE,
+                                               "Failed.");
+                               },
+                               &pssh_infos)
+                .error_code());
+  EXPECT_EQ(0u, cache.size());
+  ASSERT_OK(cache.GetOrGenerate(
+      "key1", GetGenerateCallback(1, &num_generations), &pssh_infos));
+  EXPECT_EQ(1, num_generations);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,8 +6,6 @@
 
 #include "packager/media/crypto/sample_aes_ec3_cryptor.h"
 
-#include <algorithm>
-
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_reader.h"
 
@@ -81,28 +79,61 @@ bool SampleAesEc3Cryptor::CryptInternal(const uint8_t* text,
   }
   *crypt_text_size = text_size;
 
-  std::vector<size_t> syncframe_sizes;
-  if (!ExtractEac3SyncframeSizes(text, text_size, &syncframe_sizes))
+  if (!ExtractEac3SyncframeSizes(text, text_size, &syncframe_sizes_))
     return false;
 
+  // The clear bytes are copied as is. So are the residual blocks, which are
+  // left untouched (copied without encryption/decryption).
+  if (crypt_text != text)
+    memcpy(crypt_text, text, text_size);
+
   // MPEG-2 Stream Encryption Format for HTTP Live Streaming 2.3.1.3 Enhanced
   // AC-3: The first 16 bytes, starting with the syncframe() header, are not
   // encrypted.
   const size_t kLeadingClearBytesSize = 16u;
+  const size_t kAesBlockSize = 16u;
 
-  for (size_t syncframe_size : syncframe_sizes) {
-    memcpy(crypt_text, text, std::min(syncframe_size, kLeadingClearBytesSize));
+  // Collect the full blocks of all the syncframes. Since the residual blocks
+  // are left untouched and the cipher block chain continues across
+  // syncframes, crypting them in one call is the same as crypting them
+  // syncframe by syncframe.
+  encrypted_ranges_.clear();
+  size_t encrypted_size = 0;
+  size_t syncframe_offset = 0;
+  for (size_t syncframe_size : syncframe_sizes_) {
     if (syncframe_size > kLeadingClearBytesSize) {
-      // The residual block is left untouched (copied without
-      // encryption/decryption). No need to do special handling here.
-      if (!cryptor_->Crypt(text + kLeadingClearBytesSize,
-                           syncframe_size - kLeadingClearBytesSize,
-                           crypt_text + kLeadingClearBytesSize)) {
-        return false;
+      const size_t size = (syncframe_size - kLeadingClearBytesSize) /
+                          kAesBlockSize * kAesBlockSize;
+      if (size > 0) {
+        encrypted_ranges_.emplace_back(
+            syncframe_offset + kLeadingClearBytesSize, size);
+        encrypted_size += size;
       }
     }
-    text += syncframe_size;
-    crypt_text += syncframe_size;
+    syncframe_offset += syncframe_size;
+  }
+
+  if (encrypted_ranges_.empty())
+    return true;
+  if (encrypted_ranges_.size() == 1) {
+    uint8_t* data = crypt_text + encrypted_ranges_.front().first;
+    return cryptor_->Crypt(data, encrypted_size, data);
+  }
+
+  encrypted_blocks_.resize(encrypted_size);
+  uint8_t* blocks = encrypted_blocks_.data();
+  for (const auto& range : encrypted_ranges_) {
+    memcpy(blocks, crypt_text + range.first, range.second);
+    blocks += range.second;
+  }
+  if (!cryptor_->Crypt(encrypted_blocks_.data(), encrypted_size,
+                       encrypted_blocks_.data())) {
+    return false;
+  }
+  blocks = encrypted_blocks_.data();
+  for (const auto& range : encrypted_ranges_) {
+    memcpy(crypt_text + range.first, blocks, range.second);
+    blocks += range.second;
   }
   return true;
 }
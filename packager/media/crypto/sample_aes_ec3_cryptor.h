@@ -9,16 +9,21 @@
 #ifndef PACKAGER_MEDIA_CRYPTO_SAMPLE_AES_EC3_CRYPTOR_H_
 #define PACKAGER_MEDIA_CRYPTO_SAMPLE_AES_EC3_CRYPTOR_H_
 
+#include <utility>
+#include <vector>
+
 namespace shaka {
 namespace media {
 
 /// Implements SAMPLE-AES E-AC3 encryption / decryption per specification at:
-/// https://goo.gl/1sgcwY.
+/// https://goo.gl/1sgcwY. The encrypted blocks of all the syncframes in a
+/// frame are crypted with a single call to the underlying cryptor.
 class SampleAesEc3Cryptor : public AesCryptor {
  public:
   /// @param cryptor points to an AesCryptor instance which performs the actual
   ///        encryption/decryption. Note that @a cryptor shall not use constant
-  ///        iv.
+  ///        iv, and shall leave the residual partial block untouched, like
+  ///        AES-CBC without padding.
   explicit SampleAesEc3Cryptor(std::unique_ptr<AesCryptor> cryptor);
 
   /// @name AesCryptor implementation overrides.
@@ -39,6 +44,11 @@ class SampleAesEc3Cryptor : public AesCryptor {
   void SetIvInternal() override;
 
   std::unique_ptr<AesCryptor> cryptor_;
+  // Kept across CryptInternal calls to avoid reallocating them per frame.
+  std::vector<size_t> syncframe_sizes_;
+  // Offset and size of the encrypted blocks of each syncframe.
+  std::vector<std::pair<size_t, size_t>> encrypted_ranges_;
+  std::vector<uint8_t> encrypted_blocks_;
 };
 
 }  // namespace media
@@ -9,6 +9,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/mock_aes_cryptor.h"
 
 using ::testing::_;
@@ -17,6 +18,26 @@ using ::testing::Return;
 
 namespace shaka {
 namespace media {
+namespace {
+
+// Generates an E-AC3 frame with syncframes of the specified sizes, which
+// should be even.
+std::vector<uint8_t> GenerateEac3Frame(
+    const std::vector<size_t>& syncframe_sizes) {
+  std::vector<uint8_t> frame;
+  for (size_t syncframe_size : syncframe_sizes) {
+    const size_t frmsiz = syncframe_size / 2 - 1;
+    frame.push_back(0x0B);
+    frame.push_back(0x77);
+    frame.push_back(static_cast<uint8_t>(frmsiz >> 8));
+    frame.push_back(static_cast<uint8_t>(frmsiz & 0xFF));
+    for (size_t i = 4; i < syncframe_size; ++i)
+      frame.push_back(static_cast<uint8_t>(frame.size()));
+  }
+  return frame;
+}
+
+}  // namespace
 
 class SampleAesEc3CryptorTest : public ::testing::Test {
  public:
@@ -39,21 +60,15 @@ class SampleAesEc3CryptorTest : public ::testing::Test {
 };
 
 TEST_F(SampleAesEc3CryptorTest, Crypt) {
-  const std::vector<uint8_t> text = {
-      // First syncframe with 20 bytes.
-      0x0B, 0x77, 0x00, 0x09, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12,
-      0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20,
-      // Second syncframe with 26 bytes.
-      0x0B, 0x77, 0x00, 0x0C, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
-      0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32, 0x33, 0x34,
-      0x35, 0x36,
-      // Third syncframe with 16 bytes.
-      0x0B, 0x77, 0x00, 0x07, 0x15, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32,
-      0x33, 0x34, 0x35, 0x36};
-
-  EXPECT_CALL(*mock_cryptor_, CryptInternal(_, _, _, _))
-      .WillRepeatedly(Invoke([](const uint8_t* text, size_t text_size,
-                                uint8_t* crypt_text, size_t* crypt_text_size) {
+  // Syncframes of 20, 36 and 50 bytes, with 0, 1 and 2 full blocks after the
+  // 16 leading clear bytes.
+  const std::vector<uint8_t> text = GenerateEac3Frame({20, 36, 50});
+
+  // The full blocks of all the syncframes are crypted in one call.
+  const size_t kEncryptedSize = 16 + 32;
+  EXPECT_CALL(*mock_cryptor_, CryptInternal(_, kEncryptedSize, _, _))
+      .WillOnce(Invoke([](const uint8_t* text, size_t text_size,
+                          uint8_t* crypt_text, size_t* crypt_text_size) {
         *crypt_text_size = text_size;
         for (size_t i = 0; i < text_size; ++i) {
           *crypt_text++ = *text++ + 0x40;
@@ -61,17 +76,11 @@ TEST_F(SampleAesEc3CryptorTest, Crypt) {
         return true;
       }));
 
-  const std::vector<uint8_t> expected_crypt_text = {
-      // First syncframe with 20 bytes.
-      0x0B, 0x77, 0x00, 0x09, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12,
-      0x13, 0x14, 0x15, 0x16, 0x57, 0x58, 0x59, 0x60,
-      // Second syncframe with 26 bytes.
-      0x0B, 0x77, 0x00, 0x0C, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
-      0x23, 0x24, 0x25, 0x26, 0x67, 0x68, 0x69, 0x70, 0x71, 0x72, 0x73, 0x74,
-      0x75, 0x76,
-      // Third syncframe with 16 bytes.
-      0x0B, 0x77, 0x00, 0x07, 0x15, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32,
-      0x33, 0x34, 0x35, 0x36};
+  std::vector<uint8_t> expected_crypt_text = text;
+  for (size_t i = 20 + 16; i < 20 + 32; ++i)
+    expected_crypt_text[i] += 0x40;
+  for (size_t i = 56 + 16; i < 56 + 48; ++i)
+    expected_crypt_text[i] += 0x40;
 
   std::vector<uint8_t> crypt_text;
   ASSERT_TRUE(ec3_cryptor_.Crypt(text, &crypt_text));
@@ -102,5 +111,40 @@ TEST_F(SampleAesEc3CryptorTest, InvalidEc3SyncframeSize) {
   ASSERT_FALSE(ec3_cryptor_.Crypt(text, &crypt_text));
 }
 
+TEST(SampleAesEc3CryptorCbcTest, SameAsCryptingSyncframeBySyncframe) {
+  const std::vector<uint8_t> key(16, 'k');
+  const std::vector<uint8_t> iv(16, 'i');
+  const std::vector<size_t> kSyncframeSizes = {20, 36, 50, 100, 1536};
+  const std::vector<uint8_t> text = GenerateEac3Frame(kSyncframeSizes);
+
+  // Reference: crypt the syncframes one by one, leaving the leading 16 bytes
+  // in the clear.
+  AesCbcEncryptor reference_encryptor(kNoPadding);
+  ASSERT_TRUE(reference_encryptor.InitializeWithIv(key, iv));
+  std::vector<uint8_t> expected_crypt_text = text;
+  size_t offset = 0;
+  for (size_t syncframe_size : kSyncframeSizes) {
+    if (syncframe_size > 16) {
+      uint8_t* data = expected_crypt_text.data() + offset + 16;
+      ASSERT_TRUE(reference_encryptor.Crypt(data, syncframe_size - 16, data));
+    }
+    offset += syncframe_size;
+  }
+
+  SampleAesEc3Cryptor ec3_cryptor(
+      std::unique_ptr<AesCryptor>(new AesCbcEncryptor(kNoPadding)));
+  ASSERT_TRUE(ec3_cryptor.InitializeWithIv(key, iv));
+  std::vector<uint8_t> crypt_text;
+  ASSERT_TRUE(ec3_cryptor.Crypt(text, &crypt_text));
+  EXPECT_EQ(expected_crypt_text, crypt_text);
+
+  // In place.
+  ASSERT_TRUE(ec3_cryptor.SetIv(iv));
+  std::vector<uint8_t> in_place_text = text;
+  ASSERT_TRUE(ec3_cryptor.Crypt(in_place_text.data(), in_place_text.size(),
+                                in_place_text.data()));
+  EXPECT_EQ(expected_crypt_text, in_place_text);
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -63,12 +63,14 @@ bool ShouldAlignProtectedData(Codec codec,
 
 // A convenient util class to organize subsamples, e.g. combine consecutive
 // subsamples with only clear bytes, split subsamples if the clear bytes exceeds
-// 2^16 etc.
+// 2^16 etc. Whether the protected data is block aligned, which depends on the
+// protection scheme, is a template parameter so it is a constant in the loops
+// over the units of the frames.
+template <bool kAlignProtectedData>
 class SubsampleOrganizer {
  public:
-  SubsampleOrganizer(bool align_protected_data,
-                     std::vector<SubsampleEntry>* subsamples)
-      : align_protected_data_(align_protected_data), subsamples_(subsamples) {}
+  explicit SubsampleOrganizer(std::vector<SubsampleEntry>* subsamples)
+      : subsamples_(subsamples) {}
 
   ~SubsampleOrganizer() {
     if (accumulated_clear_bytes_ > 0) {
@@ -81,7 +83,7 @@ class SubsampleOrganizer {
     DCHECK_LT(clear_bytes, std::numeric_limits<uint32_t>::max());
     DCHECK_LT(cipher_bytes, std::numeric_limits<uint32_t>::max());
 
-    if (align_protected_data_ && cipher_bytes != 0) {
+    if (kAlignProtectedData && cipher_bytes != 0) {
       const size_t misalign_bytes = cipher_bytes % kAesBlockSize;
       clear_bytes += misalign_bytes;
       cipher_bytes -= misalign_bytes;
@@ -110,7 +112,6 @@ class SubsampleOrganizer {
                               static_cast<uint32_t>(cipher_bytes));
   }
 
-  const bool align_protected_data_ = false;
   std::vector<SubsampleEntry>* const subsamples_ = nullptr;
   size_t accumulated_clear_bytes_ = 0;
 };
@@ -126,6 +127,9 @@ Status SubsampleGenerator::Initialize(FourCC protection_scheme,
                                       const StreamInfo& stream_info) {
   codec_ = stream_info.codec();
   nalu_length_size_ = GetNaluLengthSize(stream_info);
+  nalu_type_ = (codec_ == kCodecH265 || codec_ == kCodecH265DolbyVision)
+                   ? Nalu::kH265
+                   : Nalu::kH264;
 
   switch (codec_) {
     case kCodecAV1:
@@ -204,6 +208,13 @@ Status SubsampleGenerator::Initialize(FourCC protection_scheme,
                       "Unexpected codec for SAMPLE-AES.");
     }
   }
+  full_sample_encryption_ = !av1_parser_ && !header_parser_ &&
+                            !vpx_parser_ && leading_clear_bytes_size_ == 0;
+  // Select the generator of the codec and of the block alignment once, so
+  // that GenerateSubsamples() does not branch on them for every frame.
+  generate_function_ = align_protected_data_
+                           ? SelectGenerateFunction<true>()
+                           : SelectGenerateFunction<false>();
   return Status::OK;
 }
 
@@ -212,33 +223,38 @@ Status SubsampleGenerator::GenerateSubsamples(
     size_t frame_size,
     std::vector<SubsampleEntry>* subsamples) {
   subsamples->clear();
-  switch (codec_) {
-    case kCodecAV1:
-      return GenerateSubsamplesFromAV1Frame(frame, frame_size, subsamples);
-    case kCodecH264:
-      FALLTHROUGH_INTENDED;
-    case kCodecH265:
-    case kCodecH265DolbyVision:
-      return GenerateSubsamplesFromH26xFrame(frame, frame_size, subsamples);
-    case kCodecVP9:
-      if (vp9_subsample_encryption_)
-        return GenerateSubsamplesFromVPxFrame(frame, frame_size, subsamples);
-      // Full sample encrypted so no subsamples.
-      break;
-    default:
-      // Other codecs are full sample encrypted unless there are clear leading
-      // bytes.
-      if (leading_clear_bytes_size_ > 0) {
-        SubsampleOrganizer subsample_organizer(align_protected_data_,
-                                               subsamples);
-        const size_t clear_bytes =
-            std::min(frame_size, leading_clear_bytes_size_);
-        const size_t cipher_bytes = frame_size - clear_bytes;
-        subsample_organizer.AddSubsample(clear_bytes, cipher_bytes);
-      } else {
-        // Full sample encrypted so no subsamples.
-      }
-      break;
+  nalu_layout_.clear();
+  // Full sample encrypted so no subsamples.
+  if (!generate_function_)
+    return Status::OK;
+  return (this->*generate_function_)(frame, frame_size, subsamples);
+}
+
+Status SubsampleGenerator::ProcessClearFrame(const uint8_t* frame,
+                                             size_t frame_size) {
+  nalu_layout_.clear();
+  if (vpx_parser_ || av1_parser_) {
+    std::vector<SubsampleEntry> subsamples;
+    return GenerateSubsamples(frame, frame_size, &subsamples);
+  }
+  // |header_parser_| is only used if |leading_clear_bytes_size_| is not
+  // available, and then only needs the parameter sets.
+  if (!header_parser_ || leading_clear_bytes_size_ != 0)
+    return Status::OK;
+
+  DCHECK_NE(nalu_length_size_, 0u);
+  NaluReader reader(nalu_type_, nalu_length_size_, frame, frame_size);
+  Nalu nalu;
+  NaluReader::Result result;
+  while ((result = reader.Advance(&nalu)) == NaluReader::kOk) {
+    if (!nalu.is_video_slice() && !header_parser_->ProcessNalu(nalu)) {
+      LOG(ERROR) << "Failed to process NAL unit: NAL type = " << nalu.type();
+      return Status(error::ENCRYPTION_FAILURE, "Failed to process NAL unit.");
+    }
+  }
+  if (result != NaluReader::kEOStream) {
+    LOG(ERROR) << "Failed to parse NAL units.";
+    return Status(error::ENCRYPTION_FAILURE, "Failed to parse NAL units.");
   }
   return Status::OK;
 }
@@ -258,6 +274,40 @@ void SubsampleGenerator::InjectAV1ParserForTesting(
   av1_parser_ = std::move(av1_parser);
 }
 
+template <bool kAlignProtectedData>
+SubsampleGenerator::GenerateFunction
+SubsampleGenerator::SelectGenerateFunction() const {
+  if (av1_parser_)
+    return &SubsampleGenerator::GenerateSubsamplesFromAV1Frame<
+        kAlignProtectedData>;
+  if (header_parser_)
+    return &SubsampleGenerator::GenerateSubsamplesFromH26xFrame<
+        kAlignProtectedData>;
+  if (vpx_parser_)
+    return &SubsampleGenerator::GenerateSubsamplesFromVPxFrame<
+        kAlignProtectedData>;
+  // Other codecs are full sample encrypted unless there are clear leading
+  // bytes.
+  if (leading_clear_bytes_size_ > 0) {
+    return &SubsampleGenerator::GenerateSubsamplesWithLeadingClearBytes<
+        kAlignProtectedData>;
+  }
+  return nullptr;
+}
+
+template <bool kAlignProtectedData>
+Status SubsampleGenerator::GenerateSubsamplesWithLeadingClearBytes(
+    const uint8_t* frame,
+    size_t frame_size,
+    std::vector<SubsampleEntry>* subsamples) {
+  SubsampleOrganizer<kAlignProtectedData> subsample_organizer(subsamples);
+  const size_t clear_bytes = std::min(frame_size, leading_clear_bytes_size_);
+  const size_t cipher_bytes = frame_size - clear_bytes;
+  subsample_organizer.AddSubsample(clear_bytes, cipher_bytes);
+  return Status::OK;
+}
+
+template <bool kAlignProtectedData>
 Status SubsampleGenerator::GenerateSubsamplesFromVPxFrame(
     const uint8_t* frame,
     size_t frame_size,
@@ -267,7 +317,7 @@ Status SubsampleGenerator::GenerateSubsamplesFromVPxFrame(
   if (!vpx_parser_->Parse(frame, frame_size, &vpx_frames))
     return Status(error::ENCRYPTION_FAILURE, "Failed to parse vpx frame.");
 
-  SubsampleOrganizer subsample_organizer(align_protected_data_, subsamples);
+  SubsampleOrganizer<kAlignProtectedData> subsample_organizer(subsamples);
 
   size_t total_size = 0;
   for (const VPxFrameInfo& frame : vpx_frames) {
@@ -289,6 +339,7 @@ Status SubsampleGenerator::GenerateSubsamplesFromVPxFrame(
   return Status::OK;
 }
 
+template <bool kAlignProtectedData>
 Status SubsampleGenerator::GenerateSubsamplesFromH26xFrame(
     const uint8_t* frame,
     size_t frame_size,
@@ -296,12 +347,9 @@ Status SubsampleGenerator::GenerateSubsamplesFromH26xFrame(
   DCHECK_NE(nalu_length_size_, 0u);
   DCHECK(header_parser_);
 
-  SubsampleOrganizer subsample_organizer(align_protected_data_, subsamples);
+  SubsampleOrganizer<kAlignProtectedData> subsample_organizer(subsamples);
 
-  const Nalu::CodecType nalu_type =
-      (codec_ == kCodecH265 || codec_ == kCodecH265DolbyVision) ? Nalu::kH265
-                                                                : Nalu::kH264;
-  NaluReader reader(nalu_type, nalu_length_size_, frame, frame_size);
+  NaluReader reader(nalu_type_, nalu_length_size_, frame, frame_size);
 
   Nalu nalu;
   NaluReader::Result result;
@@ -314,6 +362,11 @@ Status SubsampleGenerator::GenerateSubsamplesFromH26xFrame(
     }
 
     const size_t nalu_total_size = nalu.header_size() + nalu.payload_size();
+    NaluLocation nalu_location;
+    nalu_location.offset = nalu.data() - frame;
+    nalu_location.size = nalu_total_size;
+    nalu_layout_.push_back(nalu_location);
+
     size_t clear_bytes = 0;
     if (nalu.is_video_slice() && nalu_total_size >= min_protected_data_size_) {
       clear_bytes = leading_clear_bytes_size_;
@@ -344,6 +397,7 @@ Status SubsampleGenerator::GenerateSubsamplesFromH26xFrame(
   return Status::OK;
 }
 
+template <bool kAlignProtectedData>
 Status SubsampleGenerator::GenerateSubsamplesFromAV1Frame(
     const uint8_t* frame,
     size_t frame_size,
@@ -353,7 +407,7 @@ Status SubsampleGenerator::GenerateSubsamplesFromAV1Frame(
   if (!av1_parser_->Parse(frame, frame_size, &av1_tiles))
     return Status(error::ENCRYPTION_FAILURE, "Failed to parse AV1 frame.");
 
-  SubsampleOrganizer subsample_organizer(align_protected_data_, subsamples);
+  SubsampleOrganizer<kAlignProtectedData> subsample_organizer(subsamples);
 
   size_t last_tile_end_offset = 0;
   for (const AV1Parser::Tile& tile : av1_tiles) {
@@ -11,7 +11,9 @@
 #include <vector>
 
 #include "packager/media/base/fourccs.h"
+#include "packager/media/base/media_sample.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/codecs/nalu_reader.h"
 #include "packager/status.h"
 
 namespace shaka {
@@ -60,6 +62,28 @@ class SubsampleGenerator {
                                     size_t frame_size,
                                     std::vector<SubsampleEntry>* subsamples);
 
+  /// Processes a frame which is not encrypted, e.g. in the clear lead, for
+  /// the parameter sets and headers that the next (encrypted) frames may
+  /// depend on, without generating its subsamples. Only the parameter sets
+  /// of NAL unit structured frames are processed; VPx and AV1 frames are
+  /// parsed fully as their headers depend on the previous frames.
+  /// @param frame points to the start of the frame.
+  /// @param frame_size is the size of the frame.
+  /// @returns OK on success, an error status otherwise.
+  virtual Status ProcessClearFrame(const uint8_t* frame, size_t frame_size);
+
+  /// @return The location of the NAL units in the last frame processed by
+  ///         GenerateSubsamples() if the frame is NAL unit structured, empty
+  ///         otherwise. It can be attached to the sample to avoid parsing the
+  ///         NAL units again in later stages.
+  const std::vector<NaluLocation>& nalu_layout() const { return nalu_layout_; }
+
+  /// @return true if all the frames are full sample encrypted, e.g. for most
+  ///         audio streams, in which case GenerateSubsamples() always outputs
+  ///         no subsamples and does not need to be called. False until
+  ///         initialized.
+  bool full_sample_encryption() const { return full_sample_encryption_; }
+
   // Testing injections.
   void InjectVpxParserForTesting(std::unique_ptr<VPxParser> vpx_parser);
   void InjectVideoSliceHeaderParserForTesting(
@@ -70,18 +94,38 @@ class SubsampleGenerator {
   SubsampleGenerator(const SubsampleGenerator&) = delete;
   SubsampleGenerator& operator=(const SubsampleGenerator&) = delete;
 
+  // Generates the subsamples of a frame of the codec of the stream.
+  typedef Status (SubsampleGenerator::*GenerateFunction)(
+      const uint8_t* frame,
+      size_t frame_size,
+      std::vector<SubsampleEntry>* subsamples);
+
+  // @return The generator of the codec of the stream, or null if the frames
+  //         are full sample encrypted. The generators are specialized on
+  //         whether the protected data is block aligned.
+  template <bool kAlignProtectedData>
+  GenerateFunction SelectGenerateFunction() const;
+
+  template <bool kAlignProtectedData>
   Status GenerateSubsamplesFromVPxFrame(
       const uint8_t* frame,
       size_t frame_size,
       std::vector<SubsampleEntry>* subsamples);
+  template <bool kAlignProtectedData>
   Status GenerateSubsamplesFromH26xFrame(
       const uint8_t* frame,
       size_t frame_size,
       std::vector<SubsampleEntry>* subsamples);
+  template <bool kAlignProtectedData>
   Status GenerateSubsamplesFromAV1Frame(
       const uint8_t* frame,
       size_t frame_size,
       std::vector<SubsampleEntry>* subsamples);
+  template <bool kAlignProtectedData>
+  Status GenerateSubsamplesWithLeadingClearBytes(
+      const uint8_t* frame,
+      size_t frame_size,
+      std::vector<SubsampleEntry>* subsamples);
 
   const bool vp9_subsample_encryption_ = false;
   // Whether the protected portion should be AES block (16 bytes) aligned.
@@ -90,12 +134,19 @@ class SubsampleGenerator {
   // For NAL structured video only, the size of NAL unit length in bytes. Can be
   // 1, 2 or 4 bytes.
   uint8_t nalu_length_size_ = 0;
+  // For NAL structured video only, the type of the NAL units.
+  Nalu::CodecType nalu_type_ = Nalu::kH264;
   // For SAMPLE AES only, 32 bytes for Video and 16 bytes for audio.
   size_t leading_clear_bytes_size_ = 0;
   // For SAMPLE AES only, if the data size is less than this value, none of the
   // bytes are encrypted. The size is 48+1 bytes for video NAL and 32 bytes for
   // audio according to MPEG-2 Stream Encryption Format for HTTP Live Streaming.
   size_t min_protected_data_size_ = 0;
+  bool full_sample_encryption_ = false;
+  // Selected by Initialize(). Null if the frames are full sample encrypted.
+  GenerateFunction generate_function_ = nullptr;
+  // NAL unit layout of the last processed frame.
+  std::vector<NaluLocation> nalu_layout_;
 
   // VPx parser for VPx streams.
   std::unique_ptr<VPxParser> vpx_parser_;
@@ -364,6 +364,42 @@ TEST_P(SubsampleGeneratorTest, H264SubsampleEncryption) {
     EXPECT_THAT(subsamples, ElementsAreArray(kExpectedUnalignedSubsamples));
   else
     EXPECT_THAT(subsamples, ElementsAreArray(kExpectedAlignedSubsamples));
+
+  // The NAL units start after the 1-byte length fields.
+  const std::vector<NaluLocation>& nalu_layout = generator.nalu_layout();
+  ASSERT_EQ(3u, nalu_layout.size());
+  EXPECT_EQ(1u, nalu_layout[0].offset);
+  EXPECT_EQ(9u, nalu_layout[0].size);
+  EXPECT_EQ(11u, nalu_layout[1].offset);
+  EXPECT_EQ(0x27u, nalu_layout[1].size);
+  EXPECT_EQ(51u, nalu_layout[2].offset);
+  EXPECT_EQ(0x32u, nalu_layout[2].size);
+}
+
+TEST_P(SubsampleGeneratorTest, H264ProcessClearFrame) {
+  SubsampleGenerator generator(kVP9SubsampleEncryption);
+  ASSERT_OK(
+      generator.Initialize(protection_scheme_, GetVideoStreamInfo(kCodecH264)));
+
+  constexpr uint8_t kFrame[] = {
+      // Video slice NALU (nalu_size = 9).
+      0x09, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+      // SPS NALU (nalu_size = 4).
+      0x04, 0x67, 0x02, 0x03, 0x04};
+  constexpr size_t kFrameSize = sizeof(kFrame);
+
+  // Only the parameter sets are processed. The slice headers are not parsed.
+  std::unique_ptr<MockVideoSliceHeaderParser> mock_video_slice_header_parser(
+      new MockVideoSliceHeaderParser);
+  EXPECT_CALL(*mock_video_slice_header_parser, ProcessNalu(_))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_video_slice_header_parser, GetHeaderSize(_)).Times(0);
+
+  generator.InjectVideoSliceHeaderParserForTesting(
+      std::move(mock_video_slice_header_parser));
+
+  ASSERT_OK(generator.ProcessClearFrame(kFrame, kFrameSize));
+  EXPECT_TRUE(generator.nalu_layout().empty());
 }
 
 TEST_P(SubsampleGeneratorTest, AV1ParserFailed) {
@@ -443,6 +479,15 @@ TEST_P(SubsampleGeneratorTest, AACIsFullSampleEncrypted) {
   std::vector<SubsampleEntry> subsamples;
   ASSERT_OK(generator.GenerateSubsamples(kFrame, kFrameSize, &subsamples));
   EXPECT_THAT(subsamples, ElementsAre());
+  EXPECT_TRUE(generator.full_sample_encryption());
+}
+
+TEST_P(SubsampleGeneratorTest, VP9IsNotFullSampleEncrypted) {
+  SubsampleGenerator generator(kVP9SubsampleEncryption);
+  EXPECT_FALSE(generator.full_sample_encryption());
+  ASSERT_OK(
+      generator.Initialize(protection_scheme_, GetVideoStreamInfo(kCodecVP9)));
+  EXPECT_FALSE(generator.full_sample_encryption());
 }
 
 INSTANTIATE_TEST_CASE_P(
@@ -454,6 +499,7 @@ TEST(SampleAesSubsampleGeneratorTest, AAC) {
   SubsampleGenerator generator(kVP9SubsampleEncryption);
   ASSERT_OK(generator.Initialize(kAppleSampleAesProtectionScheme,
                                  GetAudioStreamInfo(kCodecAAC)));
+  EXPECT_FALSE(generator.full_sample_encryption());
 
   constexpr size_t kNumFrames = 4;
   constexpr size_t kMaxFrameSize = 100;
@@ -7,30 +7,54 @@
 #include "packager/media/demuxer/demuxer.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
 
 #include "packager/base/bind.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
 #include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/memory_mapped_file_reader.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/decryptor_source.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/macros.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/stage_latency.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/demuxer/push_input.h"
+#include "packager/media/demuxer/sample_index.h"
+#include "packager/media/demuxer/synthetic_media_parser.h"
 #include "packager/media/formats/mp2t/mp2t_media_parser.h"
 #include "packager/media/formats/mp4/mp4_media_parser.h"
 #include "packager/media/formats/webm/webm_media_parser.h"
 #include "packager/media/formats/webvtt/webvtt_parser.h"
 #include "packager/media/formats/wvm/wvm_media_parser.h"
+#include "packager/metrics/trace_recorder.h"
+#include "packager/status_macros.h"
 
 namespace {
 // 65KB, sufficient to determine the container and likely all init data.
 const size_t kInitBufSize = 0x10000;
+// Enough to see the signature of the common containers.
+const size_t kSignatureProbeSize = 0x1000;
 const size_t kBufSize = 0x200000;  // 2MB
-// Maximum number of allowed queued samples. If we are receiving a lot of
-// samples before seeing init_event, something is not right. The number
-// set here is arbitrary though.
-const size_t kQueuedSamplesLimit = 10000;
+// Size of the windows in which memory mapped input is parsed.
+const size_t kMappedWindowSize = 0x1000000;  // 16MB
+// Maximum size of the media samples queued before seeing init_event. A lot
+// of samples are queued if something is not right, or if the stream info comes
+// late in a high bitrate input, e.g. 4K video, in which case the input is
+// parsed again instead of queuing more, see Demuxer::ParseAgain().
+const uint64_t kQueuedSamplesMemoryLimit = 256 * 1024 * 1024;
+// Maximum number of queued text samples, which are small. The number set here
+// is arbitrary though.
+const size_t kQueuedTextSamplesLimit = 10000;
+// Maximum time to wait for the memory budget before checking for
+// cancellation.
+const int64_t kMemoryBudgetWaitMs = 100;
 const size_t kInvalidStreamIndex = static_cast<size_t>(-1);
 const size_t kBaseVideoOutputStreamIndex = 0x100;
 const size_t kBaseAudioOutputStreamIndex = 0x200;
@@ -74,7 +98,17 @@ namespace shaka {
 namespace media {
 
 Demuxer::Demuxer(const std::string& file_name)
-    : file_name_(file_name), buffer_(new uint8_t[kBufSize]) {}
+    : file_name_(file_name),
+      is_push_input_(base::StartsWith(file_name,
+                                      kPushInputPrefix,
+                                      base::CompareCase::SENSITIVE)),
+      is_synthetic_input_(base::StartsWith(file_name,
+                                           kSyntheticInputPrefix,
+                                           base::CompareCase::SENSITIVE)),
+      buffer_(HugePageAllocator::GetInstance()->Allocate(kBufSize)) {
+  if (is_push_input_)
+    push_input_ = PushInput::ParseInputName(file_name);
+}
 
 Demuxer::~Demuxer() {
   if (media_file_)
@@ -85,8 +119,26 @@ void Demuxer::SetKeySource(std::unique_ptr<KeySource> key_source) {
   key_source_ = std::move(key_source);
 }
 
+void Demuxer::SetProgressListener(
+    std::unique_ptr<ProgressListener> progress_listener) {
+  progress_listener_ = std::move(progress_listener);
+}
+
 Status Demuxer::Run() {
+  ScopedTraceJob trace_job(file_name_);
+  const Status status = Demux();
+  if (status.ok() && progress_tracker_)
+    progress_tracker_->OnComplete(base::TimeTicks::Now());
+  // Unblock the pushers of the input, which is no longer read.
+  if (push_input_)
+    push_input_->Close();
+  return status;
+}
+
+Status Demuxer::Demux() {
   LOG(INFO) << "Demuxer::Run() on file '" << file_name_ << "'.";
+  if (use_sample_index_ && File::IsLocalRegularFile(file_name_.c_str()))
+    sample_index_ = SampleIndex::Read(file_name_);
   Status status = InitializeParser();
   // ParserInitEvent callback is called after a few calls to Parse(), which sets
   // up the streams. Only after that, we can verify the outputs below.
@@ -110,8 +162,27 @@ Status Demuxer::Run() {
     }
   }
 
-  while (!cancelled_ && status.ok())
+  if (read_samples_from_index_)
+    return ReadSamplesFromIndex();
+  if (has_decode_time_range_) {
+    return Status(
+        error::INVALID_ARGUMENT,
+        "A decode time range requires an up to date sample index of " +
+            file_name_);
+  }
+  if (demux_tracks_in_parallel_)
+    return DemuxTracksInParallel();
+  if (parse_again_)
+    status = ParseAgain();
+
+  while (!cancelled_ && status.ok()) {
     status.Update(Parse());
+    // The rest of the input is past the time range, unless it is indexed.
+    if (status.ok() && filter_time_range_ && !new_sample_index_ &&
+        num_tracks_past_time_range_ == track_time_ranges_.size()) {
+      status = Status(error::END_OF_STREAM, "");
+    }
+  }
   if (cancelled_ && status.ok())
     return Status(error::CANCELLED, "Demuxer run cancelled");
 
@@ -121,6 +192,8 @@ Status Demuxer::Run() {
       if (!status.ok())
         return status;
     }
+    if (new_sample_index_)
+      new_sample_index_->Write(file_name_);
     return Status::OK;
   }
   return status;
@@ -128,6 +201,9 @@ Status Demuxer::Run() {
 
 void Demuxer::Cancel() {
   cancelled_ = true;
+  // Unblock a read waiting for pushed data.
+  if (push_input_)
+    push_input_->Close();
 }
 
 Status Demuxer::SetHandler(const std::string& stream_label,
@@ -150,28 +226,61 @@ void Demuxer::SetLanguageOverride(const std::string& stream_label,
 
 Status Demuxer::InitializeParser() {
   DCHECK(!media_file_);
-  DCHECK(!all_streams_ready_);
+  DCHECK(!all_streams_ready_ || parsing_again_);
 
   LOG(INFO) << "Initialize Demuxer for file '" << file_name_ << "'.";
 
-  media_file_ = File::Open(file_name_.c_str(), "r");
-  if (!media_file_) {
-    return Status(error::FILE_FAILURE,
-                  "Cannot open file for reading " + file_name_);
+  if (is_synthetic_input_) {
+    SyntheticInputParams synthetic_input_params;
+    if (!SyntheticMediaParser::ParseInputName(file_name_,
+                                              &synthetic_input_params)) {
+      return Status(error::INVALID_ARGUMENT, "Invalid input " + file_name_);
+    }
+    parser_.reset(new SyntheticMediaParser(synthetic_input_params));
+    parser_->Init(
+        base::Bind(&Demuxer::ParserInitEvent, base::Unretained(this)),
+        base::Bind(&Demuxer::NewMediaSampleEvent, base::Unretained(this)),
+        base::Bind(&Demuxer::NewTextSampleEvent, base::Unretained(this)),
+        key_source_.get());
+    // The streams are generated by the first call to Parse().
+    return Status::OK;
+  }
+  if (is_push_input_) {
+    if (!push_input_)
+      return Status(error::INVALID_ARGUMENT, "Invalid input " + file_name_);
+  } else if (use_memory_mapped_input_ &&
+             File::IsLocalRegularFile(file_name_.c_str())) {
+    mapped_file_ =
+        MemoryMappedFileReader::Open(file_name_.c_str(), kMappedWindowSize);
+    if (!mapped_file_) {
+      LOG(WARNING) << "Cannot map file '" << file_name_
+                   << "'. Falling back to buffered reads.";
+    }
+  }
+  if (!push_input_ && !mapped_file_) {
+    media_file_ = File::Open(file_name_.c_str(), "r");
+    if (!media_file_) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot open file for reading " + file_name_);
+    }
   }
 
-  // Read enough bytes before detecting the container.
+  // Read enough bytes before detecting the container. A mapped window is
+  // always large enough. Otherwise the first bytes are read, which identify
+  // the common containers, and more only if they do not.
+  const uint8_t* data = buffer_.get();
   int64_t bytes_read = 0;
-  while (static_cast<size_t>(bytes_read) < kInitBufSize) {
-    int64_t read_result =
-        media_file_->Read(buffer_.get() + bytes_read, kInitBufSize);
-    if (read_result < 0)
-      return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
-    if (read_result == 0)
-      break;
-    bytes_read += read_result;
+  if (mapped_file_) {
+    RETURN_IF_ERROR(ReadNextChunk(kMappedWindowSize, &data, &bytes_read));
+    container_name_ = DetermineContainer(data, bytes_read);
+  } else {
+    RETURN_IF_ERROR(ReadInitBuffer(kSignatureProbeSize, &bytes_read));
+    container_name_ = DetermineContainerFromSignature(data, bytes_read);
+    if (container_name_ == CONTAINER_UNKNOWN) {
+      RETURN_IF_ERROR(ReadInitBuffer(kInitBufSize, &bytes_read));
+      container_name_ = DetermineContainer(data, bytes_read);
+    }
   }
-  container_name_ = DetermineContainer(buffer_.get(), bytes_read);
 
   // Initialize media parser.
   switch (container_name_) {
@@ -200,8 +309,7 @@ Status Demuxer::InitializeParser() {
     case CONTAINER_UNKNOWN: {
       const int64_t kDumpSizeLimit = 512;
       LOG(ERROR) << "Failed to detect the container type from the buffer: "
-                 << base::HexEncode(buffer_.get(),
-                                    std::min(bytes_read, kDumpSizeLimit));
+                 << base::HexEncode(data, std::min(bytes_read, kDumpSizeLimit));
       return Status(error::INVALID_ARGUMENT,
                     "Failed to detect the container type.");
     }
@@ -224,15 +332,34 @@ Status Demuxer::InitializeParser() {
     // descriptor |media_file_| instead of opening the same file again.
     static_cast<mp4::MP4MediaParser*>(parser_.get())->LoadMoov(file_name_);
   }
-  if (!parser_->Parse(buffer_.get(), bytes_read)) {
+  read_time_ = base::Time::Now();
+  if (!parser_->Parse(data, bytes_read)) {
     return Status(error::PARSER_FAILURE,
                   "Cannot parse media file " + file_name_);
   }
   return Status::OK;
 }
 
+Status Demuxer::ParseAgain() {
+  LOG(INFO) << "Parsing '" << file_name_ << "' again from the start.";
+  if (media_file_) {
+    media_file_->Close();
+    media_file_ = nullptr;
+  }
+  mapped_file_.reset();
+  parser_.reset();
+  parse_again_ = false;
+  parsing_again_ = true;
+  return InitializeParser();
+}
+
 void Demuxer::ParserInitEvent(
     const std::vector<std::shared_ptr<StreamInfo>>& stream_infos) {
+  // The streams are set up by the first parsing of the input.
+  if (parsing_again_) {
+    SelectParserTracks();
+    return;
+  }
   if (dump_stream_info_) {
     printf("\nFile \"%s\":\n", file_name_.c_str());
     printf("Found %zu stream(s).\n", stream_infos.size());
@@ -271,6 +398,8 @@ void Demuxer::ParserInitEvent(
         output_handlers().find(stream_index) != output_handlers().end();
     if (handler_set) {
       track_id_to_stream_index_map_[stream_info->track_id()] = stream_index;
+      track_id_to_time_scale_map_[stream_info->track_id()] =
+          stream_info->time_scale();
       stream_indexes_.push_back(stream_index);
       auto iter = language_overrides_.find(stream_index);
       if (iter != language_overrides_.end() &&
@@ -292,15 +421,136 @@ void Demuxer::ParserInitEvent(
     ++base_stream_index;
   }
   all_streams_ready_ = true;
+
+  if (progress_listener_ && !progress_tracker_) {
+    progress_tracker_.reset(
+        new StreamProgressTracker(name(), progress_listener_.get()));
+    // The input is demuxed once its longest selected stream is.
+    double duration_in_seconds = 0;
+    for (const std::shared_ptr<StreamInfo>& stream_info : stream_infos) {
+      if (track_id_to_stream_index_map_[stream_info->track_id()] !=
+              kInvalidStreamIndex &&
+          stream_info->time_scale() > 0) {
+        duration_in_seconds = std::max(
+            duration_in_seconds, static_cast<double>(stream_info->duration()) /
+                                     stream_info->time_scale());
+      }
+    }
+    progress_tracker_->set_media_duration(duration_in_seconds);
+  }
+
+  // The key frames are located by the 'moov' box of a non-fragmented input,
+  // which skips the data of the other frames, rather than by an index.
+  const bool read_key_frames_only =
+      key_frames_only_ && container_name_ == CONTAINER_MOV &&
+      File::IsLocalRegularFile(file_name_.c_str()) &&
+      static_cast<mp4::MP4MediaParser*>(parser_.get())->CanReadTrackSamples();
+
+  // The samples of MP4 inputs are contiguous in the input, so they can be
+  // read with the positions in the index.
+  if (use_sample_index_ && !read_key_frames_only &&
+      container_name_ == CONTAINER_MOV &&
+      File::IsLocalRegularFile(file_name_.c_str())) {
+    read_samples_from_index_ = sample_index_ != nullptr;
+    for (const std::shared_ptr<StreamInfo>& stream_info : stream_infos) {
+      if (read_samples_from_index_ &&
+          !sample_index_->HasTrack(stream_info->track_id())) {
+        LOG(WARNING) << "Track " << stream_info->track_id()
+                     << " is missing from the sample index of '" << file_name_
+                     << "'.";
+        read_samples_from_index_ = false;
+      }
+    }
+    // Decrypted samples differ from the data in the input. The 'moov' box of
+    // a non-fragmented input locates the samples of a time range as well as
+    // an index.
+    if (!read_samples_from_index_ && !key_source_ &&
+        !(has_time_range_ && static_cast<mp4::MP4MediaParser*>(parser_.get())
+                                 ->CanReadTrackSamples())) {
+      new_sample_index_.reset(new SampleIndex);
+      for (const std::shared_ptr<StreamInfo>& stream_info : stream_infos) {
+        new_sample_index_->AddTrack(stream_info->track_id(),
+                                     stream_info->time_scale());
+      }
+    }
+  }
+
+  // The tracks can be read independently only if the 'moov' box describes all
+  // the samples and the input can be opened more than once. Indexing the
+  // input needs the samples in the order of the parser. A time range, or the
+  // key frames only, are read that way even for a single track, which skips
+  // the data of the other samples.
+  demux_tracks_in_parallel_ =
+      (has_time_range_ || read_key_frames_only ||
+       (parallel_track_demuxing_ && stream_indexes_.size() > 1)) &&
+      !read_samples_from_index_ && !new_sample_index_ &&
+      container_name_ == CONTAINER_MOV &&
+      File::IsLocalRegularFile(file_name_.c_str()) &&
+      static_cast<mp4::MP4MediaParser*>(parser_.get())->CanReadTrackSamples();
+  if (read_samples_from_index_ || demux_tracks_in_parallel_) {
+    queued_media_samples_.clear();
+    queued_text_samples_.clear();
+    queued_bytes_ = 0;
+    queued_memory_.Set(0);
+  }
+
+  filter_time_range_ = has_time_range_ && !read_samples_from_index_ &&
+                       !demux_tracks_in_parallel_;
+  if (filter_time_range_) {
+    for (const auto& pair : track_id_to_stream_index_map_) {
+      if (pair.second != kInvalidStreamIndex)
+        track_time_ranges_[pair.first] = TrackTimeRange();
+    }
+  }
+  SelectParserTracks();
+}
+
+void Demuxer::SelectParserTracks() {
+  // The sample index has the samples of all the tracks, including the ones
+  // not selected by this run.
+  if (new_sample_index_)
+    return;
+  std::set<uint32_t> track_ids;
+  // The samples read by ReadSamplesFromIndex() or DemuxTracksInParallel()
+  // are not parsed from the input.
+  if (!read_samples_from_index_ && !demux_tracks_in_parallel_) {
+    for (const auto& pair : track_id_to_stream_index_map_) {
+      if (pair.second != kInvalidStreamIndex)
+        track_ids.insert(pair.first);
+    }
+  }
+  parser_->SelectTracks(track_ids);
 }
 
 bool Demuxer::NewMediaSampleEvent(uint32_t track_id,
                                   std::shared_ptr<MediaSample> sample) {
+  // The samples are read by ReadSamplesFromIndex() or
+  // DemuxTracksInParallel() instead.
+  // The samples are also parsed again if |parse_again_|.
+  if (read_samples_from_index_ || demux_tracks_in_parallel_ || parse_again_)
+    return true;
+  if (sample->arrival_time().is_null())
+    sample->set_arrival_time(read_time_);
   if (!all_streams_ready_) {
-    if (queued_media_samples_.size() >= kQueuedSamplesLimit) {
-      LOG(ERROR) << "Queued samples limit reached: " << kQueuedSamplesLimit;
-      return false;
+    if (queued_bytes_ + sample->data_size() > kQueuedSamplesMemoryLimit) {
+      if (is_push_input_ || !File::IsLocalRegularFile(file_name_.c_str())) {
+        LOG(ERROR) << "Queued samples memory limit reached: "
+                   << kQueuedSamplesMemoryLimit;
+        return false;
+      }
+      LOG(WARNING) << "Queued samples memory limit reached: "
+                   << kQueuedSamplesMemoryLimit
+                   << ". The samples will be parsed again once the stream "
+                      "info is known.";
+      queued_media_samples_.clear();
+      queued_text_samples_.clear();
+      queued_bytes_ = 0;
+      queued_memory_.Set(0);
+      parse_again_ = true;
+      return true;
     }
+    queued_bytes_ += sample->data_size();
+    queued_memory_.Increase(sample->data_size());
     queued_media_samples_.emplace_back(track_id, sample);
     return true;
   }
@@ -313,16 +563,23 @@ bool Demuxer::NewMediaSampleEvent(uint32_t track_id,
                          queued_media_samples_.front().sample)) {
       return false;
     }
+    queued_bytes_ -= queued_media_samples_.front().sample->data_size();
+    queued_memory_.Decrease(queued_media_samples_.front().sample->data_size());
     queued_media_samples_.pop_front();
   }
+  if (new_sample_index_)
+    IndexSample(track_id, *sample);
   return PushMediaSample(track_id, sample);
 }
 
 bool Demuxer::NewTextSampleEvent(uint32_t track_id,
                                  std::shared_ptr<TextSample> sample) {
+  if (parse_again_)
+    return true;
   if (!all_streams_ready_) {
-    if (queued_text_samples_.size() >= kQueuedSamplesLimit) {
-      LOG(ERROR) << "Queued samples limit reached: " << kQueuedSamplesLimit;
+    if (queued_text_samples_.size() >= kQueuedTextSamplesLimit) {
+      LOG(ERROR) << "Queued text samples limit reached: "
+                 << kQueuedTextSamplesLimit;
       return false;
     }
     queued_text_samples_.emplace_back(track_id, sample);
@@ -351,6 +608,32 @@ bool Demuxer::PushMediaSample(uint32_t track_id,
   }
   if (stream_index_iter->second == kInvalidStreamIndex)
     return true;
+  if (filter_time_range_) {
+    std::vector<std::shared_ptr<MediaSample>> held_samples;
+    if (FilterMediaSample(track_id, sample, &held_samples))
+      return true;
+    for (const std::shared_ptr<MediaSample>& held_sample : held_samples) {
+      if (!PushMediaSample(track_id, held_sample))
+        return false;
+    }
+  }
+  if (has_resume_time_) {
+    const int64_t offset = GetTimestampOffset(track_id, sample->dts());
+    sample->set_dts(sample->dts() + offset);
+    sample->set_pts(sample->pts() + offset);
+  }
+  RecordStageLatency(kDemuxStage, file_name_, sample->arrival_time());
+  if (progress_tracker_) {
+    const double time_scale = track_id_to_time_scale_map_.at(track_id);
+    if (time_scale > 0) {
+      base::AutoLock auto_lock(progress_lock_);
+      progress_tracker_->OnSample(sample->data_size(),
+                                  sample->pts() / time_scale,
+                                  (sample->pts() + sample->duration()) /
+                                      time_scale,
+                                  base::TimeTicks::Now());
+    }
+  }
   Status status = DispatchMediaSample(stream_index_iter->second, sample);
   if (!status.ok()) {
     LOG(ERROR) << "Failed to process sample " << stream_index_iter->second
@@ -369,6 +652,12 @@ bool Demuxer::PushTextSample(uint32_t track_id,
   }
   if (stream_index_iter->second == kInvalidStreamIndex)
     return true;
+  if (filter_time_range_ && FilterTextSample(track_id, *sample))
+    return true;
+  if (has_resume_time_) {
+    const int64_t offset = GetTimestampOffset(track_id, sample->start_time());
+    sample->SetTime(sample->start_time() + offset, sample->EndTime() + offset);
+  }
   Status status = DispatchTextSample(stream_index_iter->second, sample);
   if (!status.ok()) {
     LOG(ERROR) << "Failed to process sample " << stream_index_iter->second
@@ -378,25 +667,381 @@ bool Demuxer::PushTextSample(uint32_t track_id,
   return true;
 }
 
+bool Demuxer::FilterMediaSample(
+    uint32_t track_id,
+    const std::shared_ptr<MediaSample>& sample,
+    std::vector<std::shared_ptr<MediaSample>>* held_samples) {
+  TrackTimeRange& range = track_time_ranges_[track_id];
+  if (range.ended)
+    return true;
+  if (sample->dts() >= ToTrackTime(track_id, time_range_end_in_seconds_)) {
+    range.ended = true;
+    range.held_samples.clear();
+    ++num_tracks_past_time_range_;
+    return true;
+  }
+  if (range.started)
+    return false;
+  if (sample->dts() < ToTrackTime(track_id, time_range_start_in_seconds_)) {
+    if (sample->is_key_frame())
+      range.held_samples.clear();
+    range.held_samples.push_back(sample);
+    return true;
+  }
+  range.started = true;
+  held_samples->swap(range.held_samples);
+  return false;
+}
+
+bool Demuxer::FilterTextSample(uint32_t track_id, const TextSample& sample) {
+  TrackTimeRange& range = track_time_ranges_[track_id];
+  if (range.ended)
+    return true;
+  if (sample.start_time() >=
+      ToTrackTime(track_id, time_range_end_in_seconds_)) {
+    range.ended = true;
+    ++num_tracks_past_time_range_;
+    return true;
+  }
+  // The cues still shown at the start of the range are kept.
+  return sample.EndTime() <=
+         ToTrackTime(track_id, time_range_start_in_seconds_);
+}
+
+int64_t Demuxer::ToTrackTime(uint32_t track_id,
+                             double time_in_seconds) const {
+  // The map is not modified, as the tracks may be demuxed in parallel.
+  auto iter = track_id_to_time_scale_map_.find(track_id);
+  DCHECK(iter != track_id_to_time_scale_map_.end());
+  const double time = time_in_seconds * iter->second;
+  if (time >= static_cast<double>(std::numeric_limits<int64_t>::max()))
+    return std::numeric_limits<int64_t>::max();
+  if (time <= static_cast<double>(std::numeric_limits<int64_t>::min()))
+    return std::numeric_limits<int64_t>::min();
+  return std::llround(time);
+}
+
+double Demuxer::timestamp_offset_in_seconds() const {
+  base::AutoLock auto_lock(timestamp_offset_lock_);
+  return timestamp_offset_in_seconds_;
+}
+
+int64_t Demuxer::GetTimestampOffset(uint32_t track_id, int64_t timestamp) {
+  const uint32_t time_scale = track_id_to_time_scale_map_[track_id];
+  if (time_scale == 0)
+    return 0;
+  double offset_in_seconds = 0;
+  {
+    base::AutoLock auto_lock(timestamp_offset_lock_);
+    if (!timestamp_offset_known_) {
+      const double start_in_seconds =
+          static_cast<double>(timestamp) / time_scale;
+      if (start_in_seconds + timestamp_offset_in_seconds_ <
+          resume_time_in_seconds_) {
+        timestamp_offset_in_seconds_ =
+            resume_time_in_seconds_ - start_in_seconds;
+      }
+      LOG(INFO) << "Shifting the timestamps of '" << file_name_ << "' by "
+                << timestamp_offset_in_seconds_
+                << " seconds to resume at " << resume_time_in_seconds_
+                << " seconds.";
+      timestamp_offset_known_ = true;
+    }
+    offset_in_seconds = timestamp_offset_in_seconds_;
+  }
+  return std::llround(offset_in_seconds * time_scale);
+}
+
+Status Demuxer::DemuxTracksInParallel() {
+  LOG(INFO) << "Demuxing the " << stream_indexes_.size()
+            << " selected tracks of '" << file_name_ << "' in parallel.";
+
+  std::vector<std::unique_ptr<ClosureThread>> threads;
+  std::vector<Status> statuses(stream_indexes_.size());
+  for (const auto& pair : track_id_to_stream_index_map_) {
+    if (pair.second == kInvalidStreamIndex)
+      continue;
+    Status* status = &statuses[threads.size()];
+    threads.emplace_back(new ClosureThread(
+        "Demuxer track " + base::UintToString(pair.first),
+        base::Bind(&Demuxer::DemuxTrack, base::Unretained(this), pair.first,
+                   pair.second, status)));
+    threads.back()->Start();
+  }
+
+  Status status;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+    status.Update(statuses[i]);
+  }
+  if (cancelled_ && status.ok())
+    return Status(error::CANCELLED, "Demuxer run cancelled");
+  return status;
+}
+
+void Demuxer::DemuxTrack(uint32_t track_id,
+                         size_t stream_index,
+                         Status* status) {
+  std::unique_ptr<File, FileCloser> file(
+      File::OpenWithNoBuffering(file_name_.c_str(), "r"));
+  if (!file) {
+    *status = Status(error::FILE_FAILURE,
+                     "Cannot open file for reading " + file_name_);
+    return;
+  }
+  const mp4::MP4MediaParser* parser =
+      static_cast<mp4::MP4MediaParser*>(parser_.get());
+  int64_t start_dts = std::numeric_limits<int64_t>::min();
+  int64_t end_dts = std::numeric_limits<int64_t>::max();
+  if (has_time_range_) {
+    start_dts = ToTrackTime(track_id, time_range_start_in_seconds_);
+    end_dts = ToTrackTime(track_id, time_range_end_in_seconds_);
+  }
+  if (!parser->ReadTrackSamples(
+          track_id, start_dts, end_dts, key_frames_only_, file.get(),
+          base::Bind(&Demuxer::PushTrackSample, base::Unretained(this)))) {
+    *status = cancelled_ ? Status(error::CANCELLED, "Demuxer run cancelled")
+                         : Status(error::PARSER_FAILURE,
+                                  "Cannot parse media file " + file_name_);
+    return;
+  }
+  *status = FlushDownstream(stream_index);
+}
+
+bool Demuxer::PushTrackSample(uint32_t track_id,
+                              std::shared_ptr<MediaSample> sample) {
+  return !cancelled_ && PushMediaSample(track_id, sample);
+}
+
+Status Demuxer::ReadSamplesFromIndex() {
+  LOG(INFO) << "Reading the samples of '" << file_name_
+            << "' from its sample index.";
+
+  std::unique_ptr<File, FileCloser> file(
+      File::Open(file_name_.c_str(), "r"));
+  if (!file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for reading " + file_name_);
+  }
+
+  // The next sample of each selected track.
+  struct TrackCursor {
+    uint32_t track_id;
+    std::vector<SampleIndex::Sample>::const_iterator next;
+    std::vector<SampleIndex::Sample>::const_iterator end;
+  };
+  std::vector<TrackCursor> cursors;
+  for (const auto& track : sample_index_->tracks()) {
+    auto iter = track_id_to_stream_index_map_.find(track.first);
+    if (iter == track_id_to_stream_index_map_.end() ||
+        iter->second == kInvalidStreamIndex) {
+      continue;
+    }
+    auto begin = track.second.begin();
+    auto end = track.second.end();
+    if (has_decode_time_range_) {
+      // The samples are in decoding order.
+      auto dts_less = [](const SampleIndex::Sample& sample, int64_t dts) {
+        return sample.dts < dts;
+      };
+      begin = std::lower_bound(begin, end, decode_time_range_start_, dts_less);
+      end = std::lower_bound(begin, end, decode_time_range_end_, dts_less);
+    }
+    if (has_time_range_) {
+      const int64_t start_dts =
+          ToTrackTime(track.first, time_range_start_in_seconds_);
+      const int64_t end_dts =
+          ToTrackTime(track.first, time_range_end_in_seconds_);
+      auto dts_less = [](const SampleIndex::Sample& sample, int64_t dts) {
+        return sample.dts < dts;
+      };
+      end = std::lower_bound(begin, end, end_dts, dts_less);
+      // Start at the last key frame at or before |start_dts|.
+      auto first = std::upper_bound(
+          begin, end, start_dts,
+          [](int64_t dts, const SampleIndex::Sample& sample) {
+            return dts < sample.dts;
+          });
+      while (first != begin) {
+        --first;
+        if (first->is_key_frame)
+          break;
+      }
+      begin = first;
+    }
+    cursors.push_back({track.first, begin, end});
+  }
+
+  // The data of the input from |window_offset|.
+  std::vector<uint8_t> window;
+  uint64_t window_offset = 0;
+  uint64_t file_position = 0;
+  while (!cancelled_) {
+    // Interleave the tracks in the order of the input, which keeps the reads
+    // sequential, while keeping the decoding order within each track.
+    TrackCursor* cursor = nullptr;
+    for (TrackCursor& candidate : cursors) {
+      if (candidate.next != candidate.end &&
+          (!cursor || candidate.next->offset < cursor->next->offset)) {
+        cursor = &candidate;
+      }
+    }
+    if (!cursor)
+      break;
+    const SampleIndex::Sample& indexed_sample = *cursor->next++;
+
+    if (indexed_sample.offset < window_offset ||
+        indexed_sample.offset + indexed_sample.size >
+            window_offset + window.size()) {
+      WaitForMemoryBudget();
+      if (indexed_sample.offset != file_position &&
+          !file->Seek(indexed_sample.offset)) {
+        return Status(error::FILE_FAILURE, "Cannot seek file " + file_name_);
+      }
+      window.resize(std::max<size_t>(indexed_sample.size, kBufSize));
+      size_t bytes_read = 0;
+      while (bytes_read < window.size()) {
+        const int64_t result =
+            file->Read(&window[bytes_read], window.size() - bytes_read);
+        if (result < 0)
+          return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
+        if (result == 0)
+          break;
+        bytes_read += result;
+      }
+      window.resize(bytes_read);
+      window_offset = indexed_sample.offset;
+      file_position = window_offset + bytes_read;
+      if (bytes_read < indexed_sample.size) {
+        return Status(error::FILE_FAILURE,
+                      "Unexpected end of file " + file_name_);
+      }
+    }
+
+    std::shared_ptr<MediaSample> sample(MediaSample::CopyFrom(
+        window.data() + (indexed_sample.offset - window_offset),
+        indexed_sample.size, indexed_sample.is_key_frame));
+    sample->set_dts(indexed_sample.dts);
+    sample->set_pts(indexed_sample.pts);
+    sample->set_duration(indexed_sample.duration);
+    if (!PushMediaSample(cursor->track_id, sample))
+      return Status(error::PARSER_FAILURE, "Failed to process the sample.");
+  }
+  if (cancelled_)
+    return Status(error::CANCELLED, "Demuxer run cancelled");
+
+  for (size_t stream_index : stream_indexes_)
+    RETURN_IF_ERROR(FlushDownstream(stream_index));
+  return Status::OK;
+}
+
+void Demuxer::IndexSample(uint32_t track_id, const MediaSample& sample) {
+  if (sample.is_encrypted()) {
+    LOG(INFO) << "Not indexing '" << file_name_
+              << "', which has encrypted samples.";
+    new_sample_index_.reset();
+    return;
+  }
+  SampleIndex::Sample indexed_sample;
+  indexed_sample.offset = static_cast<mp4::MP4MediaParser*>(parser_.get())
+                              ->current_sample_offset();
+  indexed_sample.size = static_cast<uint32_t>(sample.data_size());
+  indexed_sample.dts = sample.dts();
+  indexed_sample.pts = sample.pts();
+  indexed_sample.duration = sample.duration();
+  indexed_sample.is_key_frame = sample.is_key_frame();
+  new_sample_index_->AddSample(track_id, indexed_sample);
+}
+
 Status Demuxer::Parse() {
-  DCHECK(media_file_);
+  ScopedTraceEvent trace_event("Demuxer::Parse", "demux");
+  DCHECK(media_file_ || mapped_file_ || push_input_ || is_synthetic_input_);
   DCHECK(parser_);
   DCHECK(buffer_);
 
-  int64_t bytes_read = media_file_->Read(buffer_.get(), kBufSize);
+  WaitForMemoryBudget();
+  read_time_ = base::Time::Now();
+  if (is_synthetic_input_) {
+    // There is no data to read, the parser generates the samples.
+    if (static_cast<SyntheticMediaParser*>(parser_.get())->finished()) {
+      if (!parser_->Flush())
+        return Status(error::PARSER_FAILURE, "Failed to flush.");
+      return Status(error::END_OF_STREAM, "");
+    }
+    return parser_->Parse(nullptr, 0)
+               ? Status::OK
+               : Status(error::PARSER_FAILURE,
+                        "Cannot generate the samples of " + file_name_);
+  }
+  const uint8_t* data = nullptr;
+  int64_t bytes_read = 0;
+  RETURN_IF_ERROR(ReadNextChunk(kBufSize, &data, &bytes_read));
+  read_time_ = base::Time::Now();
   if (bytes_read == 0) {
     if (!parser_->Flush())
       return Status(error::PARSER_FAILURE, "Failed to flush.");
     return Status(error::END_OF_STREAM, "");
-  } else if (bytes_read < 0) {
-    return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
   }
 
-  return parser_->Parse(buffer_.get(), bytes_read)
+  return parser_->Parse(data, bytes_read)
              ? Status::OK
              : Status(error::PARSER_FAILURE,
                       "Cannot parse media file " + file_name_);
 }
 
+void Demuxer::WaitForMemoryBudget() {
+  // Checks for cancellation in between.
+  while (!cancelled_ &&
+         !MemoryBudget::GetInstance()->WaitForBudget(
+             base::TimeDelta::FromMilliseconds(kMemoryBudgetWaitMs))) {
+  }
+}
+
+Status Demuxer::ReadInitBuffer(size_t size, int64_t* bytes_read) {
+  DCHECK_LE(size, kBufSize);
+  while (static_cast<size_t>(*bytes_read) < size) {
+    const int64_t read_result =
+        push_input_
+            ? push_input_->Read(buffer_.get() + *bytes_read, size - *bytes_read)
+            : media_file_->Read(buffer_.get() + *bytes_read,
+                                size - *bytes_read);
+    if (read_result < 0)
+      return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
+    if (read_result == 0)
+      break;
+    *bytes_read += read_result;
+  }
+  return Status::OK;
+}
+
+Status Demuxer::ReadNextChunk(size_t max_read_size,
+                              const uint8_t** data,
+                              int64_t* size) {
+  if (mapped_file_) {
+    // The parser is done with the previous window at this point, so it can
+    // be unmapped.
+    size_t window_size = 0;
+    if (!mapped_file_->MapNextWindow(data, &window_size))
+      return Status(error::FILE_FAILURE, "Cannot map file " + file_name_);
+    *size = static_cast<int64_t>(window_size);
+    return Status::OK;
+  }
+
+  if (push_input_) {
+    // The parser is done with the previous pushed buffer at this point, so it
+    // can be released.
+    *size = push_input_->ReadChunk(data);
+    if (*size < 0)
+      return Status(error::CANCELLED, "Input closed " + file_name_);
+    return Status::OK;
+  }
+
+  *data = buffer_.get();
+  *size = media_file_->Read(buffer_.get(), max_read_size);
+  if (*size < 0)
+    return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
+  return Status::OK;
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -15,9 +15,22 @@
       'sources': [
         'demuxer.cc',
         'demuxer.h',
+        'fragment_passthrough.cc',
+        'fragment_passthrough.h',
+        'push_input.cc',
+        'push_input.h',
+        'sample_index.cc',
+        'sample_index.h',
+        'synthetic_media_parser.cc',
+        'synthetic_media_parser.h',
+        'time_slicer.cc',
+        'time_slicer.h',
       ],
       'dependencies': [
+        '../../metrics/metrics.gyp:metrics',
         '../base/media_base.gyp:media_base',
+        '../codecs/codecs.gyp:codecs',
+        '../event/media_event.gyp:media_event',
         '../formats/mp2t/mp2t.gyp:mp2t',
         '../formats/mp4/mp4.gyp:mp4',
         '../formats/webm/webm.gyp:webm',
@@ -31,11 +44,18 @@
       'type': '<(gtest_target_type)',
       'sources': [
         'demuxer_unittest.cc',
+        'fragment_passthrough_unittest.cc',
+        'push_input_unittest.cc',
+        'sample_index_unittest.cc',
+        'synthetic_media_parser_unittest.cc',
+        'time_slicer_unittest.cc',
       ],
       'dependencies': [
+        '../../file/file.gyp:file',
         '../../testing/gmock.gyp:gmock',
         '../../testing/gtest.gyp:gtest',
         '../base/media_base.gyp:media_handler_test_base',
+        '../event/media_event.gyp:mock_muxer_listener',
         '../test/media_test.gyp:media_test_support',
         'demuxer',
       ]
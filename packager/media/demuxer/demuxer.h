@@ -7,13 +7,20 @@
 #ifndef PACKAGER_MEDIA_BASE_DEMUXER_H_
 #define PACKAGER_MEDIA_BASE_DEMUXER_H_
 
+#include <atomic>
 #include <deque>
+#include <map>
 #include <memory>
 #include <vector>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/container_names.h"
+#include "packager/media/base/stream_progress_tracker.h"
+#include "packager/media/event/progress_listener.h"
 #include "packager/media/origin/origin_handler.h"
+#include "packager/metrics/huge_page_allocator.h"
+#include "packager/metrics/memory_budget.h"
 #include "packager/status.h"
 
 namespace shaka {
@@ -26,6 +33,8 @@ class Decryptor;
 class KeySource;
 class MediaParser;
 class MediaSample;
+class PushInput;
+class SampleIndex;
 class StreamInfo;
 
 /// Demuxer is responsible for extracting elementary stream samples from a
@@ -34,7 +43,10 @@ class Demuxer : public OriginHandler {
  public:
   /// @param file_name specifies the input source. It uses prefix matching to
   ///        create a proper File object. The user can extend File to support
-  ///        a custom File object with its own prefix.
+  ///        a custom File object with its own prefix. Names made by
+  ///        PushInput::MakeInputName() read the data pushed to a PushInput.
+  ///        Names starting with kSyntheticInputPrefix generate synthetic
+  ///        streams, see SyntheticMediaParser.
   explicit Demuxer(const std::string& file_name);
   ~Demuxer();
 
@@ -44,6 +56,11 @@ class Demuxer : public OriginHandler {
   ///        demuxed.
   void SetKeySource(std::unique_ptr<KeySource> key_source);
 
+  /// Set a ProgressListener event handler for this object, which is passed
+  /// the throughput of the samples demuxed from the selected streams, see
+  /// ProgressListener::OnStreamProgress(). Must be called before Run().
+  void SetProgressListener(std::unique_ptr<ProgressListener> progress_listener);
+
   /// Drive the remuxing from demuxer side (push). Read the file and push
   /// the Data to Muxer until Eof.
   Status Run() override;
@@ -75,6 +92,84 @@ class Demuxer : public OriginHandler {
     dump_stream_info_ = dump_stream_info;
   }
 
+  /// @param use_memory_mapped_input indicates whether a local input file is
+  ///        read through memory mapped windows that are handed to the parser
+  ///        directly, instead of being read into an intermediate buffer.
+  ///        Ignored for other kinds of input or if mapping fails.
+  void set_use_memory_mapped_input(bool use_memory_mapped_input) {
+    use_memory_mapped_input_ = use_memory_mapped_input;
+  }
+
+  /// @param parallel_track_demuxing indicates whether the tracks of a local,
+  ///        non-fragmented MP4 input with more than one selected stream are
+  ///        demuxed in parallel, each on its own thread with its own reader
+  ///        seeking to the sample offsets in the 'moov' box. The samples of
+  ///        the different streams are then pushed downstream concurrently.
+  ///        Ignored for other kinds of input.
+  void set_parallel_track_demuxing(bool parallel_track_demuxing) {
+    parallel_track_demuxing_ = parallel_track_demuxing;
+  }
+
+  /// @param key_frames_only indicates whether only the key frames of a local,
+  ///        non-fragmented MP4 input are read, each spanning the frames which
+  ///        follow it, see MediaSample::skipped_frames(), e.g. when its
+  ///        outputs are all trick play outputs. The data of the other frames
+  ///        is not read. Ignored for other kinds of input.
+  void set_key_frames_only(bool key_frames_only) {
+    key_frames_only_ = key_frames_only;
+  }
+
+  /// @param use_sample_index indicates whether the samples of a local MP4
+  ///        input are read from its sidecar SampleIndex, if it is up to date,
+  ///        instead of being parsed. Otherwise the index is written once the
+  ///        input is parsed, for the next runs. Ignored for other kinds of
+  ///        input.
+  void set_use_sample_index(bool use_sample_index) {
+    use_sample_index_ = use_sample_index;
+  }
+
+  /// Only demux the samples with decoding timestamps from @a start, included,
+  /// to @a end, excluded, e.g. to package a time slice of the input. The
+  /// samples are read from the SampleIndex of the input, see
+  /// set_use_sample_index(), which must be up to date.
+  void set_decode_time_range(int64_t start, int64_t end) {
+    decode_time_range_start_ = start;
+    decode_time_range_end_ = end;
+    has_decode_time_range_ = true;
+  }
+
+  /// Only demux the samples with decoding times from @a start_in_seconds, on
+  /// the timeline of the input, to @a end_in_seconds, excluded, e.g. to
+  /// package a clip of a long input. Each track starts at its last key frame
+  /// at or before @a start_in_seconds, so the clip can be decoded. The
+  /// samples are read from the SampleIndex of the input if it is up to date,
+  /// or from the 'moov' box of a non-fragmented MP4 input, which only reads
+  /// the data of the range. Other inputs are parsed until all the tracks pass
+  /// @a end_in_seconds, and the samples outside the range are dropped.
+  void set_time_range(double start_in_seconds, double end_in_seconds) {
+    time_range_start_in_seconds_ = start_in_seconds;
+    time_range_end_in_seconds_ = end_in_seconds;
+    has_time_range_ = true;
+  }
+
+  /// Continue the timestamps of a live input packaged before a restart, see
+  /// LiveCheckpoint. The timestamps are shifted by
+  /// @a timestamp_offset_in_seconds, the shift before the restart, unless the
+  /// first sample would then start before @a resume_time_in_seconds, the end
+  /// of the media packaged before the restart, e.g. if the encoder restarted
+  /// too. The shift is then recomputed so that the first sample starts at
+  /// @a resume_time_in_seconds.
+  void set_resume_time(double resume_time_in_seconds,
+                       double timestamp_offset_in_seconds) {
+    resume_time_in_seconds_ = resume_time_in_seconds;
+    timestamp_offset_in_seconds_ = timestamp_offset_in_seconds;
+    has_resume_time_ = true;
+  }
+
+  /// @return The shift, in seconds, of the timestamps of the samples, see
+  ///         set_resume_time(). It may be called from any thread.
+  double timestamp_offset_in_seconds() const;
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
@@ -88,6 +183,7 @@ class Demuxer : public OriginHandler {
     // Will validate the stream index later when stream info is available.
     return true;
   }
+  uint64_t GetQueuedBytes() const override { return queued_bytes_; }
   /// @}
 
  private:
@@ -105,13 +201,21 @@ class Demuxer : public OriginHandler {
     std::shared_ptr<T> sample;
   };
 
+  // Demux the input. Implements Run().
+  Status Demux();
+
   // Initialize the parser. This method primes the demuxer by parsing portions
   // of the media file to extract stream information.
   // @return OK on success.
   Status InitializeParser();
+  // Restart parsing the input from its start with a new parser, once all the
+  // streams are ready, see |parse_again_|.
+  Status ParseAgain();
 
   // Parser init event.
   void ParserInitEvent(const std::vector<std::shared_ptr<StreamInfo>>& streams);
+  // Let the parser skip the samples of the tracks without a handler.
+  void SelectParserTracks();
   // Parser new sample event handler. Queues the samples if init event has not
   // been received, otherwise calls PushSample() to push the sample to
   // corresponding stream.
@@ -122,17 +226,78 @@ class Demuxer : public OriginHandler {
   // Helper function to push the sample to corresponding stream.
   bool PushMediaSample(uint32_t track_id, std::shared_ptr<MediaSample> sample);
   bool PushTextSample(uint32_t track_id, std::shared_ptr<TextSample> sample);
+  // Drop the parsed samples outside of the time range of set_time_range().
+  // The samples from the last key frame before the range are held back until
+  // the range starts with |sample|, and are then returned in |held_samples|,
+  // to be pushed before it. @return true if |sample| is dropped or held back.
+  bool FilterMediaSample(
+      uint32_t track_id,
+      const std::shared_ptr<MediaSample>& sample,
+      std::vector<std::shared_ptr<MediaSample>>* held_samples);
+  bool FilterTextSample(uint32_t track_id, const TextSample& sample);
+  // @return The time of |track_id| in its timescale.
+  int64_t ToTrackTime(uint32_t track_id, double time_in_seconds) const;
+  // @return The shift of the timestamps of |track_id|, in its timescale, see
+  //         set_resume_time(). The shift is determined by |timestamp|, the
+  //         timestamp of the first sample demuxed.
+  int64_t GetTimestampOffset(uint32_t track_id, int64_t timestamp);
+
+  // Demux the selected tracks in parallel, one thread per track.
+  Status DemuxTracksInParallel();
+  // Read the samples of |track_id| with a reader of its own and push them to
+  // |stream_index|. Runs on a thread of DemuxTracksInParallel().
+  void DemuxTrack(uint32_t track_id, size_t stream_index, Status* status);
+  // Sample handler of DemuxTrack().
+  bool PushTrackSample(uint32_t track_id, std::shared_ptr<MediaSample> sample);
+
+  // Push the samples of the selected tracks in |sample_index_|.
+  Status ReadSamplesFromIndex();
+  // Add a sample emitted by |parser_| to |new_sample_index_|.
+  void IndexSample(uint32_t track_id, const MediaSample& sample);
 
   // Read from the source and send it to the parser.
   Status Parse();
+  // Wait while the buffers of the pipeline exceed the memory budget, see
+  // MemoryBudget, or until cancelled.
+  void WaitForMemoryBudget();
+  // Read the next chunk of the source into |*data| and |*size|, either by
+  // mapping it, by taking the next pushed buffer, or by reading up to
+  // |max_read_size| bytes into |buffer_|.
+  // |*size| is 0 at end of stream.
+  Status ReadNextChunk(size_t max_read_size,
+                       const uint8_t** data,
+                       int64_t* size);
+  // Read into |buffer_| until it holds |size| bytes or the end of file is
+  // reached. |*bytes_read| is the number of bytes already in |buffer_|.
+  Status ReadInitBuffer(size_t size, int64_t* bytes_read);
 
   std::string file_name_;
   File* media_file_ = nullptr;
+  // Replaces |media_file_| when the input is read through memory mapping.
+  std::unique_ptr<MemoryMappedFileReader> mapped_file_;
+  // Whether the data of the input is pushed, in which case |push_input_|
+  // replaces |media_file_|. |push_input_| is NULL if the name is invalid.
+  const bool is_push_input_;
+  PushInput* push_input_ = nullptr;
+  // Whether the samples are generated by a SyntheticMediaParser, in which
+  // case there is nothing to read.
+  const bool is_synthetic_input_;
   // A stream is considered ready after receiving the stream info.
   bool all_streams_ready_ = false;
   // Queued samples received in NewSampleEvent() before ParserInitEvent().
   std::deque<QueuedSample<MediaSample>> queued_media_samples_;
   std::deque<QueuedSample<TextSample>> queued_text_samples_;
+  // Size of the data of |queued_media_samples_|.
+  std::atomic<uint64_t> queued_bytes_{0};
+  MemoryUsage queued_memory_{MemoryBudget::kDemuxerQueues};
+  // Whether the queued samples outgrew kQueuedSamplesMemoryLimit, in which
+  // case they and the samples parsed until all the streams are ready are
+  // discarded. The input is then parsed again from its start, which is only
+  // done for local files.
+  bool parse_again_ = false;
+  // Whether the input is being parsed again, in which case the streams are
+  // already set up.
+  bool parsing_again_ = false;
   std::unique_ptr<MediaParser> parser_;
   // TrackId -> StreamIndex map.
   std::map<uint32_t, size_t> track_id_to_stream_index_map_;
@@ -142,12 +307,67 @@ class Demuxer : public OriginHandler {
   // StreamIndex -> language_override map.
   std::map<size_t, std::string> language_overrides_;
   MediaContainerName container_name_ = CONTAINER_UNKNOWN;
-  std::unique_ptr<uint8_t[]> buffer_;
+  HugePageAllocator::Buffer buffer_;
+  // The wall clock time at which the data being parsed was read, which is
+  // the arrival time of the samples parsed from it.
+  base::Time read_time_;
   std::unique_ptr<KeySource> key_source_;
   bool cancelled_ = false;
   // Whether to dump stream info when it is received.
   bool dump_stream_info_ = false;
+  bool use_memory_mapped_input_ = false;
+  bool parallel_track_demuxing_ = false;
+  bool key_frames_only_ = false;
+  // Whether the input qualifies for parallel track demuxing, in which case
+  // the samples emitted by |parser_| are discarded and the tracks are read by
+  // DemuxTracksInParallel() instead.
+  bool demux_tracks_in_parallel_ = false;
+  bool use_sample_index_ = false;
+  // The index of the input, if it is up to date.
+  std::unique_ptr<SampleIndex> sample_index_;
+  // Whether the samples are read with ReadSamplesFromIndex(), in which case
+  // the samples emitted by |parser_| are discarded.
+  bool read_samples_from_index_ = false;
+  // The index built while parsing the input, written at its end.
+  std::unique_ptr<SampleIndex> new_sample_index_;
+  // The decoding time range of the samples read by ReadSamplesFromIndex().
+  bool has_decode_time_range_ = false;
+  int64_t decode_time_range_start_ = 0;
+  int64_t decode_time_range_end_ = 0;
+  // The time range of set_time_range().
+  bool has_time_range_ = false;
+  double time_range_start_in_seconds_ = 0;
+  double time_range_end_in_seconds_ = 0;
+  // Whether the samples parsed are filtered with FilterMediaSample() and
+  // FilterTextSample(), i.e. they are not read from the index or the 'moov'
+  // box, which only read the samples of the range.
+  bool filter_time_range_ = false;
+  // The state of a selected track filtered by the time range.
+  struct TrackTimeRange {
+    // The samples from the last key frame before the range.
+    std::vector<std::shared_ptr<MediaSample>> held_samples;
+    bool started = false;
+    bool ended = false;
+  };
+  std::map<uint32_t, TrackTimeRange> track_time_ranges_;
+  // The number of tracks of |track_time_ranges_| which passed the range, which
+  // ends parsing once it reaches their number.
+  size_t num_tracks_past_time_range_ = 0;
   Status init_event_status_;
+  bool has_resume_time_ = false;
+  double resume_time_in_seconds_ = 0;
+  std::map<uint32_t, uint32_t> track_id_to_time_scale_map_;
+  // Guards the members below, as the tracks may be demuxed in parallel and
+  // the shift is read by the checkpoints.
+  mutable base::Lock timestamp_offset_lock_;
+  bool timestamp_offset_known_ = false;
+  double timestamp_offset_in_seconds_ = 0;
+
+  std::unique_ptr<ProgressListener> progress_listener_;
+  // Created with the streams if there is a progress listener. Guarded by
+  // |progress_lock_|, as the tracks may be demuxed in parallel.
+  std::unique_ptr<StreamProgressTracker> progress_tracker_;
+  base::Lock progress_lock_;
 };
 
 }  // namespace media
@@ -9,8 +9,11 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/base/files/file_util.h"
+#include "packager/file/file.h"
 #include "packager/media/base/media_handler_test_base.h"
 #include "packager/media/base/raw_key_source.h"
+#include "packager/media/demuxer/sample_index.h"
 #include "packager/media/test/test_data_util.h"
 #include "packager/status_test_util.h"
 
@@ -27,6 +30,27 @@ class MockKeySource : public RawKeySource {
   MOCK_METHOD2(GetKey,
                Status(const std::vector<uint8_t>& key_id, EncryptionKey* key));
 };
+
+// The video samples demuxed from an input.
+struct VideoSamples {
+  uint32_t time_scale = 0;
+  std::vector<int64_t> decode_times;
+  std::vector<bool> key_frames;
+};
+
+VideoSamples GetVideoSamples(const CachingMediaHandler& handler) {
+  VideoSamples samples;
+  for (const auto& stream_data : handler.Cache()) {
+    if (stream_data->stream_data_type == StreamDataType::kStreamInfo) {
+      samples.time_scale = stream_data->stream_info->time_scale();
+    } else if (stream_data->stream_data_type ==
+               StreamDataType::kMediaSample) {
+      samples.decode_times.push_back(stream_data->media_sample->dts());
+      samples.key_frames.push_back(stream_data->media_sample->is_key_frame());
+    }
+  }
+  return samples;
+}
 }  // namespace
 
 class DemuxerTest : public MediaHandlerGraphTestBase {
@@ -72,6 +96,272 @@ TEST_F(DemuxerTest, EncryptedContentWithKeySource) {
   EXPECT_OK(demuxer.Run());
 }
 
+TEST_F(DemuxerTest, ParallelTrackDemuxing) {
+  const std::string file_name =
+      GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe();
+
+  std::shared_ptr<CachingMediaHandler> video_handler(new CachingMediaHandler);
+  std::shared_ptr<CachingMediaHandler> audio_handler(new CachingMediaHandler);
+  Demuxer demuxer(file_name);
+  ASSERT_OK(demuxer.SetHandler("video", video_handler));
+  ASSERT_OK(demuxer.SetHandler("audio", audio_handler));
+  ASSERT_OK(demuxer.Run());
+
+  std::shared_ptr<CachingMediaHandler> parallel_video_handler(
+      new CachingMediaHandler);
+  std::shared_ptr<CachingMediaHandler> parallel_audio_handler(
+      new CachingMediaHandler);
+  Demuxer parallel_demuxer(file_name);
+  parallel_demuxer.set_parallel_track_demuxing(true);
+  ASSERT_OK(parallel_demuxer.SetHandler("video", parallel_video_handler));
+  ASSERT_OK(parallel_demuxer.SetHandler("audio", parallel_audio_handler));
+  ASSERT_OK(parallel_demuxer.Run());
+
+  // Each stream gets the same samples, in the same order.
+  const std::pair<CachingMediaHandler*, CachingMediaHandler*> kHandlers[] = {
+      {video_handler.get(), parallel_video_handler.get()},
+      {audio_handler.get(), parallel_audio_handler.get()},
+  };
+  for (const auto& handlers : kHandlers) {
+    const auto& expected = handlers.first->Cache();
+    const auto& actual = handlers.second->Cache();
+    ASSERT_GT(expected.size(), 1u);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(expected[i]->stream_data_type, actual[i]->stream_data_type);
+      if (expected[i]->stream_data_type != StreamDataType::kMediaSample)
+        continue;
+      const MediaSample& expected_sample = *expected[i]->media_sample;
+      const MediaSample& actual_sample = *actual[i]->media_sample;
+      EXPECT_EQ(expected_sample.dts(), actual_sample.dts());
+      EXPECT_EQ(expected_sample.pts(), actual_sample.pts());
+      EXPECT_EQ(expected_sample.duration(), actual_sample.duration());
+      EXPECT_EQ(expected_sample.is_key_frame(), actual_sample.is_key_frame());
+      ASSERT_EQ(expected_sample.data_size(), actual_sample.data_size());
+      EXPECT_EQ(0, memcmp(expected_sample.data(), actual_sample.data(),
+                          expected_sample.data_size()));
+    }
+  }
+}
+
+TEST_F(DemuxerTest, SampleIndex) {
+  // Work on a copy, as the index is written next to the input.
+  base::FilePath input_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&input_path));
+  ASSERT_TRUE(
+      base::CopyFile(GetTestDataFilePath("bear-640x360.mp4"), input_path));
+  const std::string file_name = input_path.AsUTF8Unsafe();
+  const std::string index_file_name = SampleIndex::GetIndexFileName(file_name);
+
+  std::shared_ptr<CachingMediaHandler> handler(new CachingMediaHandler);
+  Demuxer demuxer(file_name);
+  demuxer.set_use_sample_index(true);
+  ASSERT_OK(demuxer.SetHandler("audio", handler));
+  ASSERT_OK(demuxer.Run());
+  std::unique_ptr<SampleIndex> index = SampleIndex::Read(file_name);
+  ASSERT_TRUE(index);
+  EXPECT_EQ(2u, index->tracks().size());
+
+  // The second run reads the samples from the index.
+  std::shared_ptr<CachingMediaHandler> indexed_handler(
+      new CachingMediaHandler);
+  Demuxer indexed_demuxer(file_name);
+  indexed_demuxer.set_use_sample_index(true);
+  ASSERT_OK(indexed_demuxer.SetHandler("audio", indexed_handler));
+  ASSERT_OK(indexed_demuxer.Run());
+
+  const auto& expected = handler->Cache();
+  const auto& actual = indexed_handler->Cache();
+  ASSERT_GT(expected.size(), 1u);
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(expected[i]->stream_data_type, actual[i]->stream_data_type);
+    if (expected[i]->stream_data_type != StreamDataType::kMediaSample)
+      continue;
+    const MediaSample& expected_sample = *expected[i]->media_sample;
+    const MediaSample& actual_sample = *actual[i]->media_sample;
+    EXPECT_EQ(expected_sample.dts(), actual_sample.dts());
+    EXPECT_EQ(expected_sample.pts(), actual_sample.pts());
+    EXPECT_EQ(expected_sample.duration(), actual_sample.duration());
+    EXPECT_EQ(expected_sample.is_key_frame(), actual_sample.is_key_frame());
+    ASSERT_EQ(expected_sample.data_size(), actual_sample.data_size());
+    EXPECT_EQ(0, memcmp(expected_sample.data(), actual_sample.data(),
+                        expected_sample.data_size()));
+  }
+
+  File::Delete(index_file_name.c_str());
+  File::Delete(file_name.c_str());
+}
+
+TEST_F(DemuxerTest, DecodeTimeRange) {
+  base::FilePath input_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&input_path));
+  ASSERT_TRUE(
+      base::CopyFile(GetTestDataFilePath("bear-640x360.mp4"), input_path));
+  const std::string file_name = input_path.AsUTF8Unsafe();
+  const std::string index_file_name = SampleIndex::GetIndexFileName(file_name);
+
+  // Without an index, the range cannot be read.
+  std::shared_ptr<CachingMediaHandler> handler(new CachingMediaHandler);
+  Demuxer demuxer(file_name);
+  demuxer.set_use_sample_index(true);
+  demuxer.set_decode_time_range(0, 1);
+  ASSERT_OK(demuxer.SetHandler("video", handler));
+  EXPECT_EQ(error::INVALID_ARGUMENT, demuxer.Run().error_code());
+
+  // The first full run writes the index.
+  std::shared_ptr<CachingMediaHandler> full_handler(new CachingMediaHandler);
+  Demuxer full_demuxer(file_name);
+  full_demuxer.set_use_sample_index(true);
+  ASSERT_OK(full_demuxer.SetHandler("video", full_handler));
+  ASSERT_OK(full_demuxer.Run());
+  std::vector<int64_t> decode_times;
+  for (const auto& stream_data : full_handler->Cache()) {
+    if (stream_data->stream_data_type == StreamDataType::kMediaSample)
+      decode_times.push_back(stream_data->media_sample->dts());
+  }
+  ASSERT_GT(decode_times.size(), 4u);
+  const int64_t start = decode_times[1];
+  const int64_t end = decode_times[4];
+
+  std::shared_ptr<CachingMediaHandler> range_handler(new CachingMediaHandler);
+  Demuxer range_demuxer(file_name);
+  range_demuxer.set_use_sample_index(true);
+  range_demuxer.set_decode_time_range(start, end);
+  ASSERT_OK(range_demuxer.SetHandler("video", range_handler));
+  ASSERT_OK(range_demuxer.Run());
+
+  std::vector<int64_t> range_decode_times;
+  for (const auto& stream_data : range_handler->Cache()) {
+    if (stream_data->stream_data_type == StreamDataType::kMediaSample)
+      range_decode_times.push_back(stream_data->media_sample->dts());
+  }
+  EXPECT_EQ(std::vector<int64_t>(decode_times.begin() + 1,
+                                 decode_times.begin() + 4),
+            range_decode_times);
+
+  File::Delete(index_file_name.c_str());
+  File::Delete(file_name.c_str());
+}
+
+TEST_F(DemuxerTest, TimeRange) {
+  // Work on copies, as the index is written next to the input.
+  base::FilePath indexed_input_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&indexed_input_path));
+  ASSERT_TRUE(base::CopyFile(GetTestDataFilePath("bear-640x360-av_frag.mp4"),
+                             indexed_input_path));
+  const std::string indexed_file_name = indexed_input_path.AsUTF8Unsafe();
+  const std::string index_file_name =
+      SampleIndex::GetIndexFileName(indexed_file_name);
+
+  // Non-fragmented MP4 read from the 'moov' box, indexed MP4, and inputs
+  // which are parsed.
+  const std::string kFileNames[] = {
+      GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe(),
+      indexed_file_name,
+      GetTestDataFilePath("bear-640x360-av_frag.mp4").AsUTF8Unsafe(),
+      GetTestDataFilePath("bear-640x360.ts").AsUTF8Unsafe(),
+  };
+  for (const std::string& file_name : kFileNames) {
+    SCOPED_TRACE(file_name);
+
+    // The full run also writes the index of |indexed_file_name|.
+    std::shared_ptr<CachingMediaHandler> handler(new CachingMediaHandler);
+    Demuxer demuxer(file_name);
+    demuxer.set_use_sample_index(file_name == indexed_file_name);
+    ASSERT_OK(demuxer.SetHandler("video", handler));
+    ASSERT_OK(demuxer.SetHandler(
+        "audio", std::make_shared<CachingMediaHandler>()));
+    ASSERT_OK(demuxer.Run());
+    const VideoSamples samples = GetVideoSamples(*handler);
+    ASSERT_GT(samples.time_scale, 0u);
+    ASSERT_GT(samples.decode_times.size(), 8u);
+
+    // Start in the middle of a GOP.
+    const size_t num_samples = samples.decode_times.size();
+    const double start_in_seconds =
+        (samples.decode_times[num_samples / 2] + 1.0) / samples.time_scale;
+    const double end_in_seconds =
+        static_cast<double>(samples.decode_times[num_samples * 3 / 4]) /
+        samples.time_scale;
+    size_t first = num_samples / 2;
+    while (first > 0 && !samples.key_frames[first])
+      --first;
+    const size_t end = num_samples * 3 / 4;
+
+    std::shared_ptr<CachingMediaHandler> range_handler(
+        new CachingMediaHandler);
+    Demuxer range_demuxer(file_name);
+    range_demuxer.set_use_sample_index(file_name == indexed_file_name);
+    range_demuxer.set_time_range(start_in_seconds, end_in_seconds);
+    ASSERT_OK(range_demuxer.SetHandler("video", range_handler));
+    ASSERT_OK(range_demuxer.SetHandler(
+        "audio", std::make_shared<CachingMediaHandler>()));
+    ASSERT_OK(range_demuxer.Run());
+    const VideoSamples range_samples = GetVideoSamples(*range_handler);
+
+    // The range starts at the last key frame at or before its start.
+    EXPECT_EQ(std::vector<int64_t>(samples.decode_times.begin() + first,
+                                   samples.decode_times.begin() + end),
+              range_samples.decode_times);
+    ASSERT_FALSE(range_samples.key_frames.empty());
+    EXPECT_TRUE(range_samples.key_frames.front());
+  }
+
+  File::Delete(index_file_name.c_str());
+  File::Delete(indexed_file_name.c_str());
+}
+
+TEST_F(DemuxerTest, KeyFramesOnly) {
+  const std::string file_name =
+      GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe();
+  std::shared_ptr<CachingMediaHandler> handler(new CachingMediaHandler);
+  Demuxer demuxer(file_name);
+  ASSERT_OK(demuxer.SetHandler("video", handler));
+  ASSERT_OK(demuxer.Run());
+
+  std::shared_ptr<CachingMediaHandler> key_frame_handler(
+      new CachingMediaHandler);
+  Demuxer key_frame_demuxer(file_name);
+  key_frame_demuxer.set_key_frames_only(true);
+  ASSERT_OK(key_frame_demuxer.SetHandler("video", key_frame_handler));
+  ASSERT_OK(key_frame_demuxer.Run());
+
+  // Each key frame spans the frames following it, up to the next key frame.
+  std::vector<const MediaSample*> expected_key_frames;
+  std::vector<int64_t> expected_durations;
+  std::vector<uint32_t> expected_skipped_frames;
+  for (const auto& stream_data : handler->Cache()) {
+    if (stream_data->stream_data_type != StreamDataType::kMediaSample)
+      continue;
+    const MediaSample& sample = *stream_data->media_sample;
+    if (sample.is_key_frame()) {
+      expected_key_frames.push_back(&sample);
+      expected_durations.push_back(sample.duration());
+      expected_skipped_frames.push_back(0);
+    } else if (!expected_key_frames.empty()) {
+      expected_durations.back() += sample.duration();
+      ++expected_skipped_frames.back();
+    }
+  }
+  ASSERT_GT(expected_key_frames.size(), 1u);
+
+  std::vector<const MediaSample*> key_frames;
+  for (const auto& stream_data : key_frame_handler->Cache()) {
+    if (stream_data->stream_data_type == StreamDataType::kMediaSample)
+      key_frames.push_back(stream_data->media_sample.get());
+  }
+  ASSERT_EQ(expected_key_frames.size(), key_frames.size());
+  for (size_t i = 0; i < key_frames.size(); ++i) {
+    SCOPED_TRACE(i);
+    EXPECT_TRUE(key_frames[i]->is_key_frame());
+    EXPECT_EQ(expected_key_frames[i]->dts(), key_frames[i]->dts());
+    EXPECT_EQ(expected_key_frames[i]->data_size(), key_frames[i]->data_size());
+    EXPECT_EQ(expected_durations[i], key_frames[i]->duration());
+    EXPECT_EQ(expected_skipped_frames[i], key_frames[i]->skipped_frames());
+  }
+}
+
 // TODO(kqyang): Add more tests.
 
 }  // namespace media
@@ -0,0 +1,641 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/fragment_passthrough.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/muxer_util.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/base/text_sample.h"
+#include "packager/media/base/timestamp_rescaler.h"
+#include "packager/media/event/muxer_listener.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/box_reader.h"
+#include "packager/media/formats/mp4/mp4_media_parser.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+
+using mp4::BoxReader;
+using mp4::TrackFragmentHeader;
+using mp4::TrackFragmentRun;
+
+namespace {
+
+const size_t kBoxHeaderSize = 8;
+const size_t kLargeBoxHeaderSize = 16;
+// The 'moov' box is expected within this many bytes from the start of the
+// input when checking it for passthrough.
+const uint64_t kMaxInitSegmentSize = 0x1000000;  // 16MB
+// The fragments are kept in memory until their segment is written out.
+const uint64_t kMaxBoxSize = 0x40000000;  // 1GB
+
+uint32_t ReadUInt32(const uint8_t* buf) {
+  return (static_cast<uint32_t>(buf[0]) << 24) |
+         (static_cast<uint32_t>(buf[1]) << 16) |
+         (static_cast<uint32_t>(buf[2]) << 8) | buf[3];
+}
+
+void WriteUInt32(uint32_t value, uint8_t* buf) {
+  buf[0] = static_cast<uint8_t>(value >> 24);
+  buf[1] = static_cast<uint8_t>(value >> 16);
+  buf[2] = static_cast<uint8_t>(value >> 8);
+  buf[3] = static_cast<uint8_t>(value);
+}
+
+// Read up to |size| bytes, fewer only at the end of |file|.
+// @return The number of bytes read, or a negative value on error.
+int64_t ReadFully(File* file, uint8_t* buf, size_t size) {
+  size_t bytes_read = 0;
+  while (bytes_read < size) {
+    const int64_t result = file->Read(buf + bytes_read, size - bytes_read);
+    if (result < 0)
+      return result;
+    if (result == 0)
+      break;
+    bytes_read += result;
+  }
+  return bytes_read;
+}
+
+// Read the next top level box of |file| and append it to |data|. |*eof| is set
+// to true instead if the end of |file| is reached. Fails if the box is larger
+// than |max_box_size|.
+Status ReadBox(File* file,
+               uint64_t max_box_size,
+               std::vector<uint8_t>* data,
+               FourCC* type,
+               bool* eof) {
+  const size_t offset = data->size();
+  data->resize(offset + kBoxHeaderSize);
+  int64_t bytes_read = ReadFully(file, data->data() + offset, kBoxHeaderSize);
+  if (bytes_read == 0) {
+    data->resize(offset);
+    *eof = true;
+    return Status::OK;
+  }
+  *eof = false;
+  if (bytes_read != static_cast<int64_t>(kBoxHeaderSize))
+    return Status(error::FILE_FAILURE, "Cannot read box from " +
+                                           file->file_name());
+
+  uint64_t box_size = ReadUInt32(data->data() + offset);
+  *type = static_cast<FourCC>(ReadUInt32(data->data() + offset + 4));
+  size_t header_size = kBoxHeaderSize;
+  if (box_size == 1) {
+    data->resize(offset + kLargeBoxHeaderSize);
+    header_size = kLargeBoxHeaderSize;
+    bytes_read = ReadFully(file, data->data() + offset + kBoxHeaderSize,
+                           kLargeBoxHeaderSize - kBoxHeaderSize);
+    if (bytes_read != static_cast<int64_t>(kLargeBoxHeaderSize -
+                                           kBoxHeaderSize)) {
+      return Status(error::FILE_FAILURE, "Cannot read box from " +
+                                             file->file_name());
+    }
+    box_size = (static_cast<uint64_t>(
+                    ReadUInt32(data->data() + offset + kBoxHeaderSize))
+                << 32) |
+               ReadUInt32(data->data() + offset + kBoxHeaderSize + 4);
+  } else if (box_size == 0) {
+    return Status(error::PARSER_FAILURE,
+                  "Boxes extending to the end of the input are not supported "
+                  "in fragment passthrough: " +
+                      file->file_name());
+  }
+  if (box_size < header_size ||
+      box_size > std::numeric_limits<size_t>::max() - offset) {
+    return Status(error::PARSER_FAILURE,
+                  "Invalid box size in " + file->file_name());
+  }
+  if (box_size > max_box_size) {
+    return Status(error::PARSER_FAILURE,
+                  FourCCToString(*type) + " box too large in " +
+                      file->file_name());
+  }
+
+  data->resize(offset + box_size);
+  bytes_read =
+      ReadFully(file, data->data() + offset + header_size,
+                box_size - header_size);
+  if (bytes_read != static_cast<int64_t>(box_size - header_size)) {
+    return Status(error::FILE_FAILURE,
+                  "Truncated " + FourCCToString(*type) + " box in " +
+                      file->file_name());
+  }
+  return Status::OK;
+}
+
+// @return The offset in |box| of its first child box of type |type|, or 0 if
+//         there is none.
+size_t FindChildBox(const uint8_t* box, size_t box_size, FourCC type) {
+  size_t offset = ReadUInt32(box) == 1 ? kLargeBoxHeaderSize : kBoxHeaderSize;
+  while (offset + kBoxHeaderSize <= box_size) {
+    const uint64_t child_size = ReadUInt32(box + offset);
+    if (child_size < kBoxHeaderSize || child_size > box_size - offset)
+      return 0;
+    if (ReadUInt32(box + offset + 4) == type)
+      return offset;
+    offset += child_size;
+  }
+  return 0;
+}
+
+// Same as ChunkingHandler.
+bool IsNewSegmentIndex(int64_t new_index, int64_t current_index) {
+  return new_index != current_index && new_index != current_index - 1;
+}
+
+bool DiscardMediaSample(uint32_t track_id,
+                        std::shared_ptr<MediaSample> sample) {
+  return true;
+}
+
+bool DiscardTextSample(uint32_t track_id, std::shared_ptr<TextSample> sample) {
+  return true;
+}
+
+}  // namespace
+
+FragmentPassthrough::FragmentPassthrough(const std::string& file_name,
+                                         const MuxerOptions& options)
+    : file_name_(file_name), options_(options) {}
+
+FragmentPassthrough::~FragmentPassthrough() {}
+
+// static
+bool FragmentPassthrough::CanPassThrough(const std::string& file_name,
+                                         const std::string& stream_selector) {
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name.c_str(), "r"));
+  if (!file)
+    return false;
+
+  // Look for the 'moov' box, which is expected before the fragments.
+  std::vector<uint8_t> data;
+  uint64_t bytes_read = 0;
+  while (bytes_read < kMaxInitSegmentSize) {
+    FourCC type = FOURCC_NULL;
+    bool eof = false;
+    data.clear();
+    if (!ReadBox(file.get(), kMaxInitSegmentSize, &data, &type, &eof).ok() ||
+        eof) {
+      return false;
+    }
+    if (type == FOURCC_moof || type == FOURCC_mdat)
+      return false;
+    bytes_read += data.size();
+    if (type != FOURCC_moov)
+      continue;
+
+    bool err = false;
+    std::unique_ptr<BoxReader> reader(
+        BoxReader::ReadBox(data.data(), data.size(), &err));
+    mp4::Movie moov;
+    if (!reader || !moov.Parse(reader.get()))
+      return false;
+    const mp4::Track* track = GetPassThroughTrack(moov);
+    if (!track)
+      return false;
+
+    const mp4::SampleDescription& description =
+        track->media.information.sample_table.description;
+    if (description.type == mp4::kVideo) {
+      if (description.video_entries.empty() ||
+          description.video_entries[0].format == FOURCC_encv) {
+        return false;
+      }
+      return stream_selector == "video" || stream_selector == "0";
+    }
+    if (description.audio_entries.empty() ||
+        description.audio_entries[0].format == FOURCC_enca) {
+      return false;
+    }
+    return stream_selector == "audio" || stream_selector == "0";
+  }
+  return false;
+}
+
+void FragmentPassthrough::SetMuxerListener(
+    std::unique_ptr<MuxerListener> muxer_listener) {
+  muxer_listener_ = std::move(muxer_listener);
+}
+
+Status FragmentPassthrough::Run() {
+  std::unique_ptr<File, FileCloser> input(File::Open(file_name_.c_str(), "r"));
+  if (!input)
+    return Status(error::FILE_FAILURE, "Cannot open file " + file_name_);
+  RETURN_IF_ERROR(PassInitSegment(input.get()));
+
+  std::unique_ptr<Fragment> fragment(new Fragment);
+  while (!cancelled_) {
+    const size_t box_offset = fragment->data.size();
+    FourCC type = FOURCC_NULL;
+    bool eof = false;
+    RETURN_IF_ERROR(ReadBox(input.get(), kMaxBoxSize, &fragment->data, &type,
+                            &eof));
+    if (eof)
+      break;
+
+    switch (type) {
+      case FOURCC_emsg:
+      case FOURCC_prft:
+        // Kept in front of the fragment they precede.
+        break;
+      case FOURCC_moof: {
+        RETURN_IF_ERROR(ReadBox(input.get(), kMaxBoxSize, &fragment->data,
+                                &type, &eof));
+        if (eof || type != FOURCC_mdat) {
+          return Status(error::PARSER_FAILURE,
+                        "Fragment passthrough requires each 'moof' box to be "
+                        "followed by its 'mdat' box in " +
+                            file_name_);
+        }
+        RETURN_IF_ERROR(ParseFragment(box_offset, fragment.get()));
+        RETURN_IF_ERROR(AddFragment(std::move(fragment)));
+        fragment.reset(new Fragment);
+        break;
+      }
+      case FOURCC_mdat:
+        return Status(error::PARSER_FAILURE,
+                      "Unexpected 'mdat' box without 'moof' box in " +
+                          file_name_);
+      default:
+        // 'styp', 'sidx', 'mfra' and the like are generated anew or dropped.
+        VLOG(2) << "Skipping top-level box: " << FourCCToString(type);
+        fragment->data.resize(box_offset);
+        break;
+    }
+  }
+  if (cancelled_)
+    return Status(error::CANCELLED, "Fragment passthrough cancelled");
+
+  RETURN_IF_ERROR(WriteSegment());
+  if (muxer_listener_) {
+    muxer_listener_->OnMediaEnd(
+        MuxerListener::MediaRanges(),
+        static_cast<float>(duration_) / time_scale_);
+  }
+  return Status::OK;
+}
+
+void FragmentPassthrough::Cancel() {
+  cancelled_ = true;
+}
+
+Status FragmentPassthrough::PassInitSegment(File* input) {
+  std::vector<uint8_t> init_segment;
+  size_t ftyp_offset = 0;
+  size_t moov_offset = 0;
+  bool has_ftyp = false;
+  while (true) {
+    const size_t box_offset = init_segment.size();
+    FourCC type = FOURCC_NULL;
+    bool eof = false;
+    RETURN_IF_ERROR(
+        ReadBox(input, kMaxInitSegmentSize, &init_segment, &type, &eof));
+    if (eof || type == FOURCC_moof || type == FOURCC_mdat) {
+      return Status(error::PARSER_FAILURE,
+                    "Fragment passthrough requires the 'moov' box before the "
+                    "media data in " +
+                        file_name_);
+    }
+    if (type == FOURCC_ftyp && !has_ftyp) {
+      ftyp_offset = box_offset;
+      has_ftyp = true;
+    } else if (type == FOURCC_moov) {
+      moov_offset = box_offset;
+      break;
+    } else {
+      init_segment.resize(box_offset);
+    }
+  }
+  if (!has_ftyp)
+    return Status(error::PARSER_FAILURE, "Missing 'ftyp' box in " + file_name_);
+
+  bool err = false;
+  std::unique_ptr<BoxReader> reader(BoxReader::ReadBox(
+      init_segment.data() + ftyp_offset, moov_offset - ftyp_offset, &err));
+  mp4::FileType ftyp;
+  if (!reader || !ftyp.Parse(reader.get()))
+    return Status(error::PARSER_FAILURE, "Invalid 'ftyp' box in " + file_name_);
+  reader.reset(BoxReader::ReadBox(init_segment.data() + moov_offset,
+                                  init_segment.size() - moov_offset, &err));
+  mp4::Movie moov;
+  if (!reader || !moov.Parse(reader.get()))
+    return Status(error::PARSER_FAILURE, "Invalid 'moov' box in " + file_name_);
+
+  const mp4::Track* track = GetPassThroughTrack(moov);
+  if (!track) {
+    return Status(error::PARSER_FAILURE,
+                  "Fragment passthrough requires a fragmented input with a "
+                  "single audio or video track: " +
+                      file_name_);
+  }
+  track_id_ = track->header.track_id;
+  time_scale_ = track->media.header.timescale;
+  if (time_scale_ == 0)
+    return Status(error::PARSER_FAILURE, "Invalid timescale in " + file_name_);
+  segment_duration_ = static_cast<int64_t>(
+      options_.segment_duration_in_seconds * time_scale_);
+  for (const mp4::TrackExtends& trex : moov.extends.tracks) {
+    if (trex.track_id == track_id_)
+      trex_.reset(new mp4::TrackExtends(trex));
+  }
+  if (!trex_)
+    return Status(error::PARSER_FAILURE, "Missing 'trex' box in " + file_name_);
+
+  // The presentation times as adjusted by the edit list, which is passed
+  // through with the 'moov' box. ISO/IEC 14496-12:2015 8.6.6 Edit List Box.
+  for (const mp4::EditListEntry& edit : track->edit.list.edits) {
+    if (edit.media_rate_integer != 1)
+      continue;
+    if (edit.media_time < 0) {
+      // An empty edit, whose |segment_duration| is in the movie timescale.
+      timestamp_adjustment_ +=
+          TimestampRescaler(moov.header.timescale, time_scale_)
+              .Rescale(edit.segment_duration);
+    } else {
+      timestamp_adjustment_ -= edit.media_time;
+    }
+  }
+
+  // The stream info for the manifests is what the demuxer would find.
+  mp4::MP4MediaParser parser;
+  parser.Init(base::Bind(&FragmentPassthrough::OnStreamInfo,
+                         base::Unretained(this)),
+              base::Bind(&DiscardMediaSample), base::Bind(&DiscardTextSample),
+              nullptr);
+  if (!parser.Parse(init_segment.data(),
+                    static_cast<int>(init_segment.size())) ||
+      !stream_info_) {
+    return Status(error::PARSER_FAILURE,
+                  "Cannot get stream info from " + file_name_);
+  }
+
+  styp_.reset(new mp4::SegmentType);
+  styp_->major_brand = ftyp.major_brand;
+  styp_->compatible_brands = ftyp.compatible_brands;
+  // Replace 'cmfc' with 'cmfs' for CMAF segments compatibility.
+  std::replace(styp_->compatible_brands.begin(),
+               styp_->compatible_brands.end(), FOURCC_cmfc, FOURCC_cmfs);
+
+  std::unique_ptr<File, FileCloser> file(
+      File::Open(options_.output_file_name.c_str(), "w"));
+  if (!file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for write " + options_.output_file_name);
+  }
+  if (file->Write(init_segment.data(), init_segment.size()) !=
+      static_cast<int64_t>(init_segment.size())) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot write file " + options_.output_file_name);
+  }
+  if (!file.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close file " + options_.output_file_name);
+  }
+
+  if (muxer_listener_) {
+    muxer_listener_->OnMediaStart(options_, *stream_info_, time_scale_,
+                                  MuxerListener::kContainerMp4);
+  }
+  return Status::OK;
+}
+
+Status FragmentPassthrough::ParseFragment(size_t moof_offset,
+                                          Fragment* fragment) {
+  uint8_t* moof_data = fragment->data.data() + moof_offset;
+  // The 'moof' box and its 'mdat' box, to which the sample data is confined.
+  const size_t fragment_size = fragment->data.size() - moof_offset;
+
+  bool err = false;
+  std::unique_ptr<BoxReader> reader(
+      BoxReader::ReadBox(moof_data, fragment_size, &err));
+  mp4::MovieFragment moof;
+  if (!reader || !moof.Parse(reader.get()))
+    return Status(error::PARSER_FAILURE, "Invalid 'moof' box in " + file_name_);
+  const size_t moof_size = reader->size();
+
+  if (moof.tracks.size() != 1 || moof.tracks[0].header.track_id != track_id_) {
+    return Status(error::PARSER_FAILURE,
+                  "Unexpected track fragments in " + file_name_);
+  }
+  const mp4::TrackFragment& traf = moof.tracks[0];
+  const TrackFragmentHeader& tfhd = traf.header;
+  // The sample data must be addressed relative to the 'moof' box to be moved
+  // along with it.
+  if (tfhd.flags & TrackFragmentHeader::kBaseDataOffsetPresentMask) {
+    return Status(error::PARSER_FAILURE,
+                  "Fragment passthrough does not support explicit base data "
+                  "offsets in " +
+                      file_name_);
+  }
+
+  int64_t dts =
+      traf.decode_time_absent ? next_decode_time_ : traf.decode_time.decode_time;
+  const int64_t fragment_start_dts = dts;
+  bool first_sample = true;
+  fragment->earliest_presentation_time = std::numeric_limits<int64_t>::max();
+  for (const TrackFragmentRun& trun : traf.runs) {
+    if (!(trun.flags & TrackFragmentRun::kDataOffsetPresentMask)) {
+      return Status(error::PARSER_FAILURE,
+                    "Fragment passthrough requires data offsets in 'trun' "
+                    "boxes in " +
+                        file_name_);
+    }
+    uint64_t sample_offset = trun.data_offset;
+    for (uint32_t i = 0; i < trun.sample_count; ++i) {
+      const uint32_t size = i < trun.sample_sizes.size()
+                                ? trun.sample_sizes[i]
+                                : tfhd.default_sample_size > 0
+                                      ? tfhd.default_sample_size
+                                      : trex_->default_sample_size;
+      const uint32_t duration = i < trun.sample_durations.size()
+                                    ? trun.sample_durations[i]
+                                    : tfhd.default_sample_duration > 0
+                                          ? tfhd.default_sample_duration
+                                          : trex_->default_sample_duration;
+      const int64_t cts_offset = i < trun.sample_composition_time_offsets.size()
+                                     ? trun.sample_composition_time_offsets[i]
+                                     : 0;
+      uint32_t flags = trex_->default_sample_flags;
+      if (i < trun.sample_flags.size())
+        flags = trun.sample_flags[i];
+      else if (tfhd.flags & TrackFragmentHeader::kDefaultSampleFlagsPresentMask)
+        flags = tfhd.default_sample_flags;
+      const bool is_key_frame =
+          !(flags & TrackFragmentHeader::kNonKeySampleMask);
+
+      if (sample_offset < moof_size || sample_offset + size > fragment_size) {
+        return Status(error::PARSER_FAILURE,
+                      "Fragment passthrough requires the sample data in the "
+                      "'mdat' box following the 'moof' box in " +
+                          file_name_);
+      }
+
+      const int64_t pts = dts + cts_offset + timestamp_adjustment_;
+      fragment->earliest_presentation_time =
+          std::min(fragment->earliest_presentation_time, pts);
+      if (first_sample)
+        fragment->starts_with_sap = is_key_frame;
+      first_sample = false;
+      if (is_key_frame) {
+        fragment->key_frames.push_back(
+            {pts, moof_offset + sample_offset, size});
+      }
+      if (sample_duration_ == 0)
+        sample_duration_ = duration;
+
+      sample_offset += size;
+      dts += duration;
+    }
+  }
+  if (first_sample)
+    fragment->earliest_presentation_time = dts + timestamp_adjustment_;
+  fragment->duration = dts - fragment_start_dts;
+  next_decode_time_ = dts;
+
+  // Renumber the fragment.
+  const size_t mfhd_offset = FindChildBox(moof_data, moof_size, FOURCC_mfhd);
+  if (mfhd_offset == 0)
+    return Status(error::PARSER_FAILURE, "Missing 'mfhd' box in " + file_name_);
+  // The sequence number follows the header and the version and flags.
+  WriteUInt32(++sequence_number_, moof_data + mfhd_offset + kBoxHeaderSize + 4);
+  return Status::OK;
+}
+
+Status FragmentPassthrough::AddFragment(std::unique_ptr<Fragment> fragment) {
+  const int64_t timestamp = fragment->earliest_presentation_time;
+  const int64_t segment_index =
+      segment_duration_ > 0 && timestamp > 0 ? timestamp / segment_duration_
+                                             : 0;
+  if (fragments_.empty()) {
+    segment_index_ = segment_index;
+  } else if (fragment->starts_with_sap &&
+             (segment_duration_ <= 0 ||
+              IsNewSegmentIndex(segment_index, segment_index_))) {
+    RETURN_IF_ERROR(WriteSegment());
+    segment_index_ = segment_index;
+  }
+  fragments_.push_back(std::move(fragment));
+  return Status::OK;
+}
+
+Status FragmentPassthrough::WriteSegment() {
+  if (fragments_.empty())
+    return Status::OK;
+
+  const int64_t earliest_presentation_time =
+      fragments_.front()->earliest_presentation_time;
+  int64_t segment_duration = 0;
+  for (const std::unique_ptr<Fragment>& fragment : fragments_)
+    segment_duration += fragment->duration;
+
+  BufferWriter header;
+  styp_->Write(&header);
+  if (options_.mp4_params.generate_sidx_in_media_segments) {
+    mp4::SegmentIndex sidx;
+    sidx.reference_id = track_id_;
+    sidx.timescale = time_scale_;
+    sidx.earliest_presentation_time =
+        std::max(earliest_presentation_time, static_cast<int64_t>(0));
+    for (const std::unique_ptr<Fragment>& fragment : fragments_) {
+      if (fragment->data.size() > std::numeric_limits<uint32_t>::max()) {
+        return Status(error::MUXER_FAILURE,
+                      "Fragment too large for 'sidx' in " + file_name_);
+      }
+      mp4::SegmentReference reference;
+      reference.referenced_size = fragment->data.size();
+      reference.subsegment_duration = fragment->duration;
+      reference.starts_with_sap = fragment->starts_with_sap;
+      reference.sap_type = fragment->starts_with_sap
+                               ? mp4::SegmentReference::Type1
+                               : mp4::SegmentReference::TypeUnknown;
+      reference.earliest_presentation_time =
+          std::max(fragment->earliest_presentation_time,
+                   static_cast<int64_t>(0));
+      sidx.references.push_back(reference);
+    }
+    sidx.Write(&header);
+  }
+
+  const std::string segment_name =
+      GetSegmentName(options_.segment_template, earliest_presentation_time,
+                     segment_number_++, options_.bandwidth);
+  std::vector<File::IoBlock> blocks;
+  blocks.push_back({header.Buffer(), header.Size()});
+  uint64_t segment_size = header.Size();
+  for (const std::unique_ptr<Fragment>& fragment : fragments_) {
+    blocks.push_back({fragment->data.data(), fragment->data.size()});
+    segment_size += fragment->data.size();
+  }
+
+  std::unique_ptr<File, FileCloser> file(
+      File::Open(segment_name.c_str(), "w"));
+  if (!file)
+    return Status(error::FILE_FAILURE, "Cannot open file for write " +
+                                           segment_name);
+  if (file->WriteV(blocks) != static_cast<int64_t>(segment_size))
+    return Status(error::FILE_FAILURE, "Cannot write file " + segment_name);
+  // Close the file, which also does flushing, to make sure the file is written
+  // before manifest is updated.
+  if (!file.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + segment_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+
+  if (muxer_listener_) {
+    uint64_t fragment_offset = header.Size();
+    for (const std::unique_ptr<Fragment>& fragment : fragments_) {
+      for (const Fragment::KeyFrame& key_frame : fragment->key_frames) {
+        muxer_listener_->OnKeyFrame(key_frame.timestamp,
+                                    fragment_offset + key_frame.offset,
+                                    key_frame.size);
+      }
+      fragment_offset += fragment->data.size();
+    }
+    muxer_listener_->OnSampleDurationReady(sample_duration_);
+    muxer_listener_->OnNewSegment(segment_name, earliest_presentation_time,
+                                  segment_duration, segment_size);
+  }
+
+  duration_ += segment_duration;
+  fragments_.clear();
+  return Status::OK;
+}
+
+// static
+const mp4::Track* FragmentPassthrough::GetPassThroughTrack(
+    const mp4::Movie& moov) {
+  // Fragmented, with a single track.
+  if (moov.extends.tracks.empty() || moov.tracks.size() != 1)
+    return nullptr;
+  const mp4::Track& track = moov.tracks[0];
+  const mp4::TrackType type =
+      track.media.information.sample_table.description.type;
+  if (type != mp4::kVideo && type != mp4::kAudio)
+    return nullptr;
+  return &track;
+}
+
+void FragmentPassthrough::OnStreamInfo(
+    const std::vector<std::shared_ptr<StreamInfo>>& streams) {
+  if (streams.size() == 1)
+    stream_info_ = streams[0];
+}
+
+}  // namespace media
+}  // namespace shaka
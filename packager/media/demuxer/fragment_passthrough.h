@@ -0,0 +1,146 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_DEMUXER_FRAGMENT_PASSTHROUGH_H_
+#define PACKAGER_MEDIA_DEMUXER_FRAGMENT_PASSTHROUGH_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/origin/origin_handler.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+class File;
+
+namespace media {
+
+class MuxerListener;
+class StreamInfo;
+
+namespace mp4 {
+struct Movie;
+struct SegmentType;
+struct Track;
+struct TrackExtends;
+}  // namespace mp4
+
+/// FragmentPassthrough repackages an already fragmented MP4 input, e.g. CMAF
+/// from an encoder, into MP4 media segments without demuxing its samples. The
+/// 'moof' and 'mdat' boxes of the input are copied to the segments as they
+/// are, with only the sequence number of the fragments renumbered, and a new
+/// 'styp' and 'sidx' written in front of each segment. The init segment is
+/// the 'ftyp' and 'moov' of the input.
+///
+/// A segment ends at the first fragment which starts with a SAP at or after
+/// the segment duration, as with ChunkingHandler, so the fragments of the
+/// input are the subsegments of the output. The MuxerListener is notified as
+/// with an MP4 Muxer, so the manifests are generated as usual.
+///
+/// FragmentPassthrough has no downstream handlers: it is a job of its own.
+class FragmentPassthrough : public OriginHandler {
+ public:
+  /// @param file_name is the fragmented MP4 input.
+  /// @param options are the options of the output. The segment template must
+  ///        be specified.
+  FragmentPassthrough(const std::string& file_name,
+                      const MuxerOptions& options);
+  ~FragmentPassthrough() override;
+
+  /// Check the init segment of an input for passthrough, which requires a
+  /// fragmented MP4 input with a single unencrypted audio or video track,
+  /// selected by @a stream_selector. The fragments are checked as they are
+  /// passed through: Run() fails if their sample data cannot be moved along
+  /// with them.
+  /// @return true if @a file_name can be passed through.
+  static bool CanPassThrough(const std::string& file_name,
+                             const std::string& stream_selector);
+
+  /// Set the listener notified of the output, which takes the ownership.
+  void SetMuxerListener(std::unique_ptr<MuxerListener> muxer_listener);
+
+  /// Copy the fragments of the input to the segments until the end of the
+  /// input.
+  Status Run() override;
+
+  /// Cancel the passthrough in progress. Will cause @a Run to exit with an
+  /// error status of type CANCELLED.
+  void Cancel() override;
+
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status InitializeInternal() override { return Status::OK; }
+  /// @}
+
+ private:
+  FragmentPassthrough(const FragmentPassthrough&) = delete;
+  FragmentPassthrough& operator=(const FragmentPassthrough&) = delete;
+
+  // A fragment of the input, i.e. a 'moof' box and its 'mdat' box, preceded
+  // by the 'emsg' and 'prft' boxes which go with it.
+  struct Fragment {
+    std::vector<uint8_t> data;
+    int64_t earliest_presentation_time = 0;
+    int64_t duration = 0;
+    bool starts_with_sap = false;
+    // Key frames, with their offsets in |data|.
+    struct KeyFrame {
+      int64_t timestamp;
+      uint64_t offset;
+      uint64_t size;
+    };
+    std::vector<KeyFrame> key_frames;
+  };
+
+  // Read the 'ftyp' and 'moov' boxes, write the init segment and notify the
+  // listener of the stream.
+  Status PassInitSegment(File* input);
+  // Decode the timing of |fragment| from its 'moof' box, at |moof_offset| in
+  // its data, and renumber the fragment.
+  Status ParseFragment(size_t moof_offset, Fragment* fragment);
+  // Add |fragment| to the current segment, or start a new segment with it.
+  Status AddFragment(std::unique_ptr<Fragment> fragment);
+  // Write the current segment out, if any.
+  Status WriteSegment();
+
+  // @return The track of @a moov if it can be passed through, null otherwise.
+  static const mp4::Track* GetPassThroughTrack(const mp4::Movie& moov);
+  void OnStreamInfo(const std::vector<std::shared_ptr<StreamInfo>>& streams);
+
+  const std::string file_name_;
+  const MuxerOptions options_;
+  std::unique_ptr<MuxerListener> muxer_listener_;
+  bool cancelled_ = false;
+
+  std::unique_ptr<mp4::SegmentType> styp_;
+  std::unique_ptr<mp4::TrackExtends> trex_;
+  std::shared_ptr<StreamInfo> stream_info_;
+  uint32_t track_id_ = 0;
+  uint32_t time_scale_ = 0;
+  int64_t segment_duration_ = 0;
+  // Offset from the decoding time of the samples to their presentation time,
+  // from the edit list, in addition to the composition offsets.
+  int64_t timestamp_adjustment_ = 0;
+  // The decoding time of the next fragment, for fragments without 'tfdt'.
+  int64_t next_decode_time_ = 0;
+  uint32_t sequence_number_ = 0;
+  uint32_t segment_number_ = 0;
+  int64_t segment_index_ = 0;
+  int64_t duration_ = 0;
+  // The duration of the first sample.
+  uint32_t sample_duration_ = 0;
+  // The fragments of the current segment.
+  std::vector<std::unique_ptr<Fragment>> fragments_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_DEMUXER_FRAGMENT_PASSTHROUGH_H_
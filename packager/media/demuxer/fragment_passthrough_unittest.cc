@@ -0,0 +1,91 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/fragment_passthrough.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/event/mock_muxer_listener.h"
+#include "packager/media/test/test_data_util.h"
+
+using ::testing::_;
+using ::testing::AtLeast;
+using ::testing::Invoke;
+
+namespace shaka {
+namespace media {
+namespace {
+const char kFragmentedAudioFile[] = "bear-mpeg2-aac-only_frag.mp4";
+const char kInitSegment[] = "memory://passthrough/init.mp4";
+const char kSegmentTemplate[] = "memory://passthrough/$Number$.m4s";
+
+std::string GetTestFile(const std::string& name) {
+  return GetTestDataFilePath(name).AsUTF8Unsafe();
+}
+}  // namespace
+
+TEST(FragmentPassthroughTest, CanPassThrough) {
+  EXPECT_TRUE(FragmentPassthrough::CanPassThrough(
+      GetTestFile(kFragmentedAudioFile), "audio"));
+  EXPECT_TRUE(FragmentPassthrough::CanPassThrough(
+      GetTestFile(kFragmentedAudioFile), "0"));
+  EXPECT_FALSE(FragmentPassthrough::CanPassThrough(
+      GetTestFile(kFragmentedAudioFile), "video"));
+  // More than one track.
+  EXPECT_FALSE(FragmentPassthrough::CanPassThrough(
+      GetTestFile("bear-640x360-av_frag.mp4"), "video"));
+  // Encrypted.
+  EXPECT_FALSE(FragmentPassthrough::CanPassThrough(
+      GetTestFile("bear-640x360-v_frag-cenc-senc.mp4"), "video"));
+  // Not fragmented.
+  EXPECT_FALSE(FragmentPassthrough::CanPassThrough(
+      GetTestFile("bear-640x360.mp4"), "video"));
+}
+
+TEST(FragmentPassthroughTest, PassThroughFragments) {
+  MuxerOptions options;
+  options.output_file_name = kInitSegment;
+  options.segment_template = kSegmentTemplate;
+  options.segment_duration_in_seconds = 1;
+
+  std::unique_ptr<MockMuxerListener> listener(new MockMuxerListener);
+  std::vector<std::string> segment_names;
+  std::vector<uint64_t> segment_sizes;
+  EXPECT_CALL(*listener, OnMediaStart(_, _, _, MuxerListener::kContainerMp4));
+  EXPECT_CALL(*listener, OnSampleDurationReady(_)).Times(AtLeast(1));
+  EXPECT_CALL(*listener, OnNewSegment(_, _, _, _))
+      .Times(AtLeast(1))
+      .WillRepeatedly(Invoke([&](const std::string& segment_name,
+                                 int64_t start_time, int64_t duration,
+                                 uint64_t segment_file_size) {
+        segment_names.push_back(segment_name);
+        segment_sizes.push_back(segment_file_size);
+      }));
+  EXPECT_CALL(*listener, OnMediaEndMock(_, _, _, _, _, _, _, _, _));
+
+  FragmentPassthrough passthrough(GetTestFile(kFragmentedAudioFile), options);
+  passthrough.SetMuxerListener(std::move(listener));
+  ASSERT_TRUE(passthrough.Initialize().ok());
+  ASSERT_TRUE(passthrough.Run().ok());
+
+  std::string init_segment;
+  ASSERT_TRUE(File::ReadFileToString(kInitSegment, &init_segment));
+  EXPECT_FALSE(init_segment.empty());
+  ASSERT_EQ("memory://passthrough/1.m4s", segment_names.front());
+  for (size_t i = 0; i < segment_names.size(); ++i) {
+    std::string segment;
+    ASSERT_TRUE(File::ReadFileToString(segment_names[i].c_str(), &segment));
+    EXPECT_EQ(segment_sizes[i], segment.size());
+    // Starts with the new 'styp' box.
+    EXPECT_EQ("styp", segment.substr(4, 4));
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,155 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/push_input.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace media {
+
+const char kPushInputPrefix[] = "push://";
+
+PushInput::PushInput(size_t max_queued_buffers)
+    : max_queued_buffers_(max_queued_buffers),
+      data_available_(&lock_),
+      buffer_released_(&lock_) {
+  DCHECK_GT(max_queued_buffers_, 0u);
+}
+
+PushInput::~PushInput() {}
+
+bool PushInput::Push(std::shared_ptr<const std::vector<uint8_t>> buffer) {
+  DCHECK(buffer);
+  base::AutoLock auto_lock(lock_);
+  // An empty buffer would read as the end of the input.
+  if (buffer->empty())
+    return !ended_ && !closed_;
+  const uint8_t* data = buffer->data();
+  const size_t size = buffer->size();
+  uint64_t sequence_number = 0;
+  return PushLocked({std::move(buffer), data, size}, &sequence_number);
+}
+
+bool PushInput::PushAndWait(const uint8_t* data, size_t size) {
+  base::AutoLock auto_lock(lock_);
+  if (size == 0)
+    return !ended_ && !closed_;
+  uint64_t sequence_number = 0;
+  if (!PushLocked({nullptr, data, size}, &sequence_number))
+    return false;
+  // The data belongs to the caller, so wait for the reader to be done with it.
+  while (num_released_buffers_ <= sequence_number && !closed_)
+    buffer_released_.Wait();
+  return num_released_buffers_ > sequence_number;
+}
+
+void PushInput::End() {
+  base::AutoLock auto_lock(lock_);
+  ended_ = true;
+  data_available_.Signal();
+  buffer_released_.Broadcast();
+}
+
+void PushInput::Close() {
+  base::AutoLock auto_lock(lock_);
+  closed_ = true;
+  // The reader no longer accesses the data of the waiting pushers.
+  buffers_.clear();
+  front_offset_ = 0;
+  data_available_.Signal();
+  buffer_released_.Broadcast();
+}
+
+int64_t PushInput::Read(void* buffer, uint64_t length) {
+  base::AutoLock auto_lock(lock_);
+  if (!WaitForDataLocked())
+    return closed_ ? -1 : 0;
+
+  const Buffer& front = buffers_.front();
+  const size_t bytes_to_copy = static_cast<size_t>(
+      std::min<uint64_t>(length, front.size - front_offset_));
+  memcpy(buffer, front.data + front_offset_, bytes_to_copy);
+  front_offset_ += bytes_to_copy;
+  if (front_offset_ == front.size)
+    ReleaseFrontLocked();
+  return static_cast<int64_t>(bytes_to_copy);
+}
+
+int64_t PushInput::ReadChunk(const uint8_t** data) {
+  DCHECK(data);
+  base::AutoLock auto_lock(lock_);
+  if (!WaitForDataLocked())
+    return closed_ ? -1 : 0;
+
+  const Buffer& front = buffers_.front();
+  *data = front.data + front_offset_;
+  const size_t size = front.size - front_offset_;
+  // The buffer is released by the next read, once the caller is done with it.
+  front_offset_ = front.size;
+  return static_cast<int64_t>(size);
+}
+
+std::string PushInput::MakeInputName(const PushInput& push_input,
+                                     const std::string& name) {
+  return base::StringPrintf("%s%" PRIdPTR "/%s", kPushInputPrefix,
+                            reinterpret_cast<intptr_t>(&push_input),
+                            name.c_str());
+}
+
+PushInput* PushInput::ParseInputName(const std::string& input_name) {
+  const size_t prefix_size = strlen(kPushInputPrefix);
+  if (input_name.compare(0, prefix_size, kPushInputPrefix) != 0)
+    return nullptr;
+  const size_t pos = input_name.find('/', prefix_size);
+  int64_t address = 0;
+  if (pos == std::string::npos ||
+      !base::StringToInt64(
+          input_name.substr(prefix_size, pos - prefix_size), &address)) {
+    LOG(ERROR) << "Expecting a push input with name like "
+                  "'push://<input address>/<input name>', but seeing "
+               << input_name;
+    return nullptr;
+  }
+  return reinterpret_cast<PushInput*>(address);
+}
+
+bool PushInput::PushLocked(Buffer buffer, uint64_t* sequence_number) {
+  while (buffers_.size() >= max_queued_buffers_ && !ended_ && !closed_)
+    buffer_released_.Wait();
+  if (ended_ || closed_)
+    return false;
+  *sequence_number = num_pushed_buffers_++;
+  buffers_.push_back(std::move(buffer));
+  data_available_.Signal();
+  return true;
+}
+
+bool PushInput::WaitForDataLocked() {
+  if (!buffers_.empty() && front_offset_ == buffers_.front().size)
+    ReleaseFrontLocked();
+  while (buffers_.empty() && !ended_ && !closed_)
+    data_available_.Wait();
+  return !closed_ && !buffers_.empty();
+}
+
+void PushInput::ReleaseFrontLocked() {
+  DCHECK(!buffers_.empty());
+  buffers_.pop_front();
+  front_offset_ = 0;
+  ++num_released_buffers_;
+  buffer_released_.Broadcast();
+}
+
+}  // namespace media
+}  // namespace shaka
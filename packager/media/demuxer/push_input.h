@@ -0,0 +1,117 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_DEMUXER_PUSH_INPUT_H_
+#define PACKAGER_MEDIA_DEMUXER_PUSH_INPUT_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+namespace media {
+
+/// Prefix of the inputs whose data is pushed by the application, e.g.
+/// "push://camera".
+extern const char kPushInputPrefix[];
+
+/// PushInput hands the data pushed by an application over to the Demuxer
+/// reading it, without copying it. The buffers are queued up to a maximum
+/// number, after which the pushers block until the Demuxer catches up. This
+/// class is thread safe.
+class PushInput {
+ public:
+  /// @param max_queued_buffers is the maximum number of buffers queued
+  ///        before the pushers block.
+  explicit PushInput(size_t max_queued_buffers);
+  ~PushInput();
+
+  /// Queue @a buffer, which is released once it is parsed.
+  /// @return false if the input is ended or closed.
+  bool Push(std::shared_ptr<const std::vector<uint8_t>> buffer);
+
+  /// Queue @a size bytes at @a data, which belong to the caller, and wait for
+  /// them to be parsed.
+  /// @return false if the input is closed before the data is parsed.
+  bool PushAndWait(const uint8_t* data, size_t size);
+
+  /// Mark the end of the input, once the queued data is parsed.
+  void End();
+
+  /// Stop reading the input. The pending and later pushes fail, and the
+  /// reads return an error.
+  void Close();
+
+  /// Copy up to @a length bytes of the queued data to @a buffer, waiting for
+  /// data if there is none.
+  /// @return The number of bytes copied, 0 at the end of the input, or -1 if
+  ///         the input is closed.
+  int64_t Read(void* buffer, uint64_t length);
+
+  /// Get the rest of the oldest queued buffer without copying it, waiting for
+  /// data if there is none. The buffer returned by the previous call is
+  /// released.
+  /// @param[out] data is set to the start of the data.
+  /// @return The size of the data, 0 at the end of the input, or -1 if the
+  ///         input is closed.
+  int64_t ReadChunk(const uint8_t** data);
+
+  /// @return The name of the input read by the Demuxer, which refers to
+  ///         @a push_input. It is only valid while @a push_input is.
+  static std::string MakeInputName(const PushInput& push_input,
+                                   const std::string& name);
+
+  /// Extract the PushInput of an input name made by MakeInputName().
+  /// @return NULL if @a input_name is not a valid push input name.
+  static PushInput* ParseInputName(const std::string& input_name);
+
+ private:
+  PushInput(const PushInput&) = delete;
+  PushInput& operator=(const PushInput&) = delete;
+
+  struct Buffer {
+    // Owns the data, if it does not belong to a waiting pusher.
+    std::shared_ptr<const std::vector<uint8_t>> owned_data;
+    const uint8_t* data;
+    size_t size;
+  };
+
+  // Queue |buffer| and set |*sequence_number| to its position in the input.
+  // Returns false if the input is ended or closed. Called with |lock_| held.
+  bool PushLocked(Buffer buffer, uint64_t* sequence_number);
+  // Wait for a buffer, releasing the one being read if it is fully read.
+  // Returns false at the end of the input or if the input is closed. Called
+  // with |lock_| held.
+  bool WaitForDataLocked();
+  // Release the buffer being read. Called with |lock_| held.
+  void ReleaseFrontLocked();
+
+  const size_t max_queued_buffers_;
+  base::Lock lock_;
+  // Signaled when a buffer is queued, or the input is ended or closed.
+  base::ConditionVariable data_available_;
+  // Signaled when a buffer is released, or the input is closed.
+  base::ConditionVariable buffer_released_;
+  // The following are protected by |lock_|.
+  std::deque<Buffer> buffers_;
+  // The offset of the data not read yet in the front of |buffers_|.
+  size_t front_offset_ = 0;
+  uint64_t num_pushed_buffers_ = 0;
+  uint64_t num_released_buffers_ = 0;
+  bool ended_ = false;
+  bool closed_ = false;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_DEMUXER_PUSH_INPUT_H_
@@ -0,0 +1,125 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/push_input.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kMaxQueuedBuffers = 2;
+
+std::shared_ptr<const std::vector<uint8_t>> MakeBuffer(const std::string& s) {
+  return std::make_shared<std::vector<uint8_t>>(s.begin(), s.end());
+}
+
+std::string ToString(const uint8_t* data, int64_t size) {
+  return std::string(data, data + size);
+}
+
+}  // namespace
+
+TEST(PushInputTest, ReadChunkDoesNotCopy) {
+  PushInput push_input(kMaxQueuedBuffers);
+  auto buffer = MakeBuffer("abc");
+  ASSERT_TRUE(push_input.Push(buffer));
+  push_input.End();
+
+  const uint8_t* data = nullptr;
+  ASSERT_EQ(3, push_input.ReadChunk(&data));
+  EXPECT_EQ(buffer->data(), data);
+  EXPECT_EQ(0, push_input.ReadChunk(&data));
+  // Released once read.
+  EXPECT_TRUE(buffer.unique());
+}
+
+TEST(PushInputTest, ReadThenReadChunk) {
+  PushInput push_input(kMaxQueuedBuffers);
+  ASSERT_TRUE(push_input.Push(MakeBuffer("abcdef")));
+  ASSERT_TRUE(push_input.Push(MakeBuffer("gh")));
+  push_input.End();
+
+  uint8_t buffer[4];
+  ASSERT_EQ(4, push_input.Read(buffer, sizeof(buffer)));
+  EXPECT_EQ("abcd", ToString(buffer, 4));
+
+  const uint8_t* data = nullptr;
+  ASSERT_EQ(2, push_input.ReadChunk(&data));
+  EXPECT_EQ("ef", ToString(data, 2));
+  ASSERT_EQ(2, push_input.ReadChunk(&data));
+  EXPECT_EQ("gh", ToString(data, 2));
+  EXPECT_EQ(0, push_input.ReadChunk(&data));
+}
+
+TEST(PushInputTest, PushesFailAfterEnd) {
+  PushInput push_input(kMaxQueuedBuffers);
+  push_input.End();
+  EXPECT_FALSE(push_input.Push(MakeBuffer("abc")));
+}
+
+TEST(PushInputTest, ReadsFailAfterClose) {
+  PushInput push_input(kMaxQueuedBuffers);
+  ASSERT_TRUE(push_input.Push(MakeBuffer("abc")));
+  push_input.Close();
+
+  const uint8_t* data = nullptr;
+  EXPECT_EQ(-1, push_input.ReadChunk(&data));
+  EXPECT_FALSE(push_input.Push(MakeBuffer("def")));
+}
+
+TEST(PushInputTest, PushAndWaitWaitsForTheReader) {
+  PushInput push_input(kMaxQueuedBuffers);
+  const std::string kData = "0123456789";
+  const int kNumPushes = 100;
+  bool pushes_succeeded = true;
+  std::thread pusher([&]() {
+    for (int i = 0; i < kNumPushes; ++i) {
+      pushes_succeeded &= push_input.PushAndWait(
+          reinterpret_cast<const uint8_t*>(kData.data()), kData.size());
+    }
+    push_input.End();
+  });
+
+  std::string read_data;
+  const uint8_t* data = nullptr;
+  int64_t size = 0;
+  while ((size = push_input.ReadChunk(&data)) > 0)
+    read_data.append(ToString(data, size));
+  pusher.join();
+
+  EXPECT_TRUE(pushes_succeeded);
+  EXPECT_EQ(kData.size() * kNumPushes, read_data.size());
+}
+
+TEST(PushInputTest, CloseUnblocksPushers) {
+  PushInput push_input(kMaxQueuedBuffers);
+  const std::string kData = "0123456789";
+  bool push_succeeded = true;
+  std::thread pusher([&]() {
+    push_succeeded = push_input.PushAndWait(
+        reinterpret_cast<const uint8_t*>(kData.data()), kData.size());
+  });
+  push_input.Close();
+  pusher.join();
+  EXPECT_FALSE(push_succeeded);
+}
+
+TEST(PushInputTest, InputName) {
+  PushInput push_input(kMaxQueuedBuffers);
+  const std::string input_name =
+      PushInput::MakeInputName(push_input, "push://camera");
+  EXPECT_EQ(0u, input_name.find(kPushInputPrefix));
+  EXPECT_EQ(&push_input, PushInput::ParseInputName(input_name));
+  EXPECT_EQ(nullptr, PushInput::ParseInputName("push://camera"));
+  EXPECT_EQ(nullptr, PushInput::ParseInputName("camera.mp4"));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,176 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/sample_index.h"
+
+#include "packager/base/files/file.h"
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/file/file.h"
+#include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kIndexFileExtension[] = ".sample_index";
+const char kLocalFilePrefix[] = "file://";
+// "SKSI" (Shaka Sample Index).
+const uint32_t kMagic = 0x534b5349;
+// Increase when the format changes. Indexes in other versions are ignored.
+const uint32_t kVersion = 2;
+
+const uint8_t kKeyFrameFlag = 1;
+
+// Get the size and the modification time of a local file, which identify the
+// version of the input an index belongs to.
+bool GetInputKey(const std::string& input_file_name,
+                 uint64_t* size,
+                 int64_t* modification_time) {
+  std::string path = input_file_name;
+  if (base::StartsWith(path, kLocalFilePrefix, base::CompareCase::SENSITIVE))
+    path = path.substr(sizeof(kLocalFilePrefix) - 1);
+  base::File::Info info;
+  if (!base::GetFileInfo(base::FilePath::FromUTF8Unsafe(path), &info)) {
+    LOG(WARNING) << "Cannot get the file info of " << input_file_name;
+    return false;
+  }
+  *size = info.size;
+  *modification_time = info.last_modified.ToInternalValue();
+  return true;
+}
+
+}  // namespace
+
+SampleIndex::SampleIndex() {}
+
+SampleIndex::~SampleIndex() {}
+
+std::string SampleIndex::GetIndexFileName(const std::string& input_file_name) {
+  return input_file_name + kIndexFileExtension;
+}
+
+std::unique_ptr<SampleIndex> SampleIndex::Read(
+    const std::string& input_file_name) {
+  const std::string index_file_name = GetIndexFileName(input_file_name);
+  uint64_t input_size = 0;
+  int64_t modification_time = 0;
+  std::string contents;
+  if (!GetInputKey(input_file_name, &input_size, &modification_time) ||
+      !File::ReadFileToString(index_file_name.c_str(), &contents)) {
+    return nullptr;
+  }
+
+  BufferReader reader(reinterpret_cast<const uint8_t*>(contents.data()),
+                      contents.size());
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t indexed_input_size = 0;
+  int64_t indexed_modification_time = 0;
+  uint32_t num_tracks = 0;
+  if (!reader.Read4(&magic) || magic != kMagic || !reader.Read4(&version) ||
+      version != kVersion) {
+    LOG(WARNING) << "Ignoring " << index_file_name
+                 << " which is not a sample index of version " << kVersion
+                 << ".";
+    return nullptr;
+  }
+  if (!reader.Read8(&indexed_input_size) ||
+      !reader.Read8s(&indexed_modification_time) ||
+      indexed_input_size != input_size ||
+      indexed_modification_time != modification_time) {
+    LOG(INFO) << "Ignoring out of date sample index " << index_file_name;
+    return nullptr;
+  }
+
+  std::unique_ptr<SampleIndex> index(new SampleIndex);
+  bool valid = reader.Read4(&num_tracks);
+  for (uint32_t i = 0; valid && i < num_tracks; ++i) {
+    uint32_t track_id = 0;
+    uint32_t time_scale = 0;
+    uint32_t num_samples = 0;
+    valid = reader.Read4(&track_id) && reader.Read4(&time_scale) &&
+            reader.Read4(&num_samples);
+    if (time_scale != 0)
+      index->time_scales_[track_id] = time_scale;
+    std::vector<Sample>& samples = index->tracks_[track_id];
+    for (uint32_t j = 0; valid && j < num_samples; ++j) {
+      Sample sample;
+      uint8_t flags = 0;
+      valid = reader.Read8(&sample.offset) && reader.Read4(&sample.size) &&
+              reader.Read8s(&sample.dts) && reader.Read8s(&sample.pts) &&
+              reader.Read8s(&sample.duration) && reader.Read1(&flags) &&
+              sample.offset + sample.size <= input_size;
+      sample.is_key_frame = (flags & kKeyFrameFlag) != 0;
+      samples.push_back(sample);
+    }
+  }
+  if (!valid || reader.HasBytes(1)) {
+    LOG(WARNING) << "Ignoring corrupted sample index " << index_file_name;
+    return nullptr;
+  }
+  return index;
+}
+
+bool SampleIndex::Write(const std::string& input_file_name) const {
+  uint64_t input_size = 0;
+  int64_t modification_time = 0;
+  if (!GetInputKey(input_file_name, &input_size, &modification_time))
+    return false;
+
+  BufferWriter writer;
+  writer.AppendInt(kMagic);
+  writer.AppendInt(kVersion);
+  writer.AppendInt(input_size);
+  writer.AppendInt(modification_time);
+  writer.AppendInt(static_cast<uint32_t>(tracks_.size()));
+  for (const auto& track : tracks_) {
+    writer.AppendInt(track.first);
+    writer.AppendInt(GetTimeScale(track.first));
+    writer.AppendInt(static_cast<uint32_t>(track.second.size()));
+    for (const Sample& sample : track.second) {
+      writer.AppendInt(sample.offset);
+      writer.AppendInt(sample.size);
+      writer.AppendInt(sample.dts);
+      writer.AppendInt(sample.pts);
+      writer.AppendInt(sample.duration);
+      writer.AppendInt(sample.is_key_frame ? kKeyFrameFlag : uint8_t{0});
+    }
+  }
+
+  const std::string index_file_name = GetIndexFileName(input_file_name);
+  const std::string contents(reinterpret_cast<const char*>(writer.Buffer()),
+                             writer.Size());
+  if (!File::WriteFileAtomically(index_file_name.c_str(), contents)) {
+    LOG(WARNING) << "Failed to write sample index " << index_file_name;
+    return false;
+  }
+  return true;
+}
+
+void SampleIndex::AddTrack(uint32_t track_id, uint32_t time_scale) {
+  tracks_[track_id];
+  time_scales_[track_id] = time_scale;
+}
+
+void SampleIndex::AddSample(uint32_t track_id, const Sample& sample) {
+  tracks_[track_id].push_back(sample);
+}
+
+bool SampleIndex::HasTrack(uint32_t track_id) const {
+  return tracks_.find(track_id) != tracks_.end();
+}
+
+uint32_t SampleIndex::GetTimeScale(uint32_t track_id) const {
+  auto iter = time_scales_.find(track_id);
+  return iter == time_scales_.end() ? 0 : iter->second;
+}
+
+}  // namespace media
+}  // namespace shaka
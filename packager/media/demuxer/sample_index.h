@@ -0,0 +1,83 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_DEMUXER_SAMPLE_INDEX_H_
+#define PACKAGER_MEDIA_DEMUXER_SAMPLE_INDEX_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace shaka {
+namespace media {
+
+/// SampleIndex holds the positions and timestamps of the samples of the
+/// tracks of an input, so that later runs can read the samples directly from
+/// the input instead of parsing it again. The index is stored in a sidecar
+/// file, along with the size and the modification time of the input, and is
+/// only used if they still match.
+class SampleIndex {
+ public:
+  struct Sample {
+    /// The position of the sample data in the input.
+    uint64_t offset = 0;
+    uint32_t size = 0;
+    int64_t dts = 0;
+    int64_t pts = 0;
+    int64_t duration = 0;
+    bool is_key_frame = false;
+  };
+
+  SampleIndex();
+  ~SampleIndex();
+
+  /// @return the name of the sidecar index of @a input_file_name.
+  static std::string GetIndexFileName(const std::string& input_file_name);
+
+  /// Read the index of an input.
+  /// @param input_file_name is the name of a local input file.
+  /// @return the index, or nullptr if there is no index for the input, or if
+  ///         it is out of date or in an unsupported version.
+  static std::unique_ptr<SampleIndex> Read(const std::string& input_file_name);
+
+  /// Write the index of an input to its sidecar file.
+  /// @param input_file_name is the name of a local input file.
+  /// @return true on success, false otherwise.
+  bool Write(const std::string& input_file_name) const;
+
+  /// Add a track, which may have no samples.
+  /// @param time_scale is the time scale of the timestamps of the samples.
+  void AddTrack(uint32_t track_id, uint32_t time_scale);
+
+  /// Add a sample at the end of a track.
+  void AddSample(uint32_t track_id, const Sample& sample);
+
+  /// @return true if the index has the track @a track_id.
+  bool HasTrack(uint32_t track_id) const;
+
+  /// @return the time scale of the track @a track_id, or 0 if it is unknown.
+  uint32_t GetTimeScale(uint32_t track_id) const;
+
+  /// @return the samples of the tracks, in decoding order, by track id.
+  const std::map<uint32_t, std::vector<Sample>>& tracks() const {
+    return tracks_;
+  }
+
+ private:
+  SampleIndex(const SampleIndex&) = delete;
+  SampleIndex& operator=(const SampleIndex&) = delete;
+
+  std::map<uint32_t, std::vector<Sample>> tracks_;
+  std::map<uint32_t, uint32_t> time_scales_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_DEMUXER_SAMPLE_INDEX_H_
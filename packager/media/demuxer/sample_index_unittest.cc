@@ -0,0 +1,120 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/sample_index.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+namespace media {
+namespace {
+const char kInputData[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+}  // namespace
+
+class SampleIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base::FilePath input_path;
+    ASSERT_TRUE(base::CreateTemporaryFile(&input_path));
+    input_file_name_ = input_path.AsUTF8Unsafe();
+    ASSERT_TRUE(
+        File::WriteStringToFile(input_file_name_.c_str(), kInputData));
+  }
+
+  void TearDown() override {
+    File::Delete(input_file_name_.c_str());
+    File::Delete(SampleIndex::GetIndexFileName(input_file_name_).c_str());
+  }
+
+  SampleIndex::Sample GetSample(uint64_t offset, uint32_t size, int64_t dts) {
+    SampleIndex::Sample sample;
+    sample.offset = offset;
+    sample.size = size;
+    sample.dts = dts;
+    sample.pts = dts + 1;
+    sample.duration = 10;
+    sample.is_key_frame = offset == 0;
+    return sample;
+  }
+
+  std::string input_file_name_;
+};
+
+TEST_F(SampleIndexTest, WriteAndRead) {
+  SampleIndex index;
+  index.AddTrack(1, 90000);
+  index.AddSample(1, GetSample(0, 10, 0));
+  index.AddSample(1, GetSample(20, 5, 10));
+  index.AddSample(2, GetSample(10, 10, 0));
+  index.AddTrack(3, 44100);
+  ASSERT_TRUE(index.Write(input_file_name_));
+
+  std::unique_ptr<SampleIndex> read_index =
+      SampleIndex::Read(input_file_name_);
+  ASSERT_TRUE(read_index);
+  EXPECT_TRUE(read_index->HasTrack(1));
+  EXPECT_TRUE(read_index->HasTrack(2));
+  EXPECT_TRUE(read_index->HasTrack(3));
+  EXPECT_FALSE(read_index->HasTrack(4));
+  ASSERT_EQ(3u, read_index->tracks().size());
+  EXPECT_TRUE(read_index->tracks().at(3).empty());
+  EXPECT_EQ(90000u, read_index->GetTimeScale(1));
+  EXPECT_EQ(0u, read_index->GetTimeScale(2));
+  EXPECT_EQ(44100u, read_index->GetTimeScale(3));
+
+  const std::vector<SampleIndex::Sample>& samples =
+      read_index->tracks().at(1);
+  ASSERT_EQ(2u, samples.size());
+  EXPECT_EQ(20u, samples[1].offset);
+  EXPECT_EQ(5u, samples[1].size);
+  EXPECT_EQ(10, samples[1].dts);
+  EXPECT_EQ(11, samples[1].pts);
+  EXPECT_EQ(10, samples[1].duration);
+  EXPECT_TRUE(samples[0].is_key_frame);
+  EXPECT_FALSE(samples[1].is_key_frame);
+}
+
+TEST_F(SampleIndexTest, NoIndex) {
+  EXPECT_FALSE(SampleIndex::Read(input_file_name_));
+}
+
+TEST_F(SampleIndexTest, IgnoresIndexOfModifiedInput) {
+  SampleIndex index;
+  index.AddSample(1, GetSample(0, 10, 0));
+  ASSERT_TRUE(index.Write(input_file_name_));
+
+  ASSERT_TRUE(File::WriteStringToFile(input_file_name_.c_str(),
+                                      std::string(kInputData) + "more"));
+  EXPECT_FALSE(SampleIndex::Read(input_file_name_));
+}
+
+TEST_F(SampleIndexTest, IgnoresCorruptedIndex) {
+  SampleIndex index;
+  index.AddSample(1, GetSample(0, 10, 0));
+  ASSERT_TRUE(index.Write(input_file_name_));
+
+  const std::string index_file_name =
+      SampleIndex::GetIndexFileName(input_file_name_);
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(index_file_name.c_str(), &contents));
+  contents.resize(contents.size() - 1);
+  ASSERT_TRUE(File::WriteStringToFile(index_file_name.c_str(), contents));
+  EXPECT_FALSE(SampleIndex::Read(input_file_name_));
+}
+
+TEST_F(SampleIndexTest, IgnoresSamplesPastTheEndOfTheInput) {
+  SampleIndex index;
+  index.AddSample(1, GetSample(30, 10, 0));
+  ASSERT_TRUE(index.Write(input_file_name_));
+  EXPECT_FALSE(SampleIndex::Read(input_file_name_));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,588 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/synthetic_media_parser.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "packager/base/logging.h"
+#include "packager/base/macros.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/bit_writer.h"
+#include "packager/media/base/fourccs.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/sample_buffer_pool.h"
+#include "packager/media/base/timestamp.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/codecs/avc_decoder_configuration_record.h"
+
+namespace shaka {
+namespace media {
+
+const char kSyntheticInputPrefix[] = "synthetic://";
+
+const double SyntheticMediaParser::kChunkDurationInSeconds = 0.1;
+
+namespace {
+
+const uint32_t kVideoTrackId = 1;
+const uint32_t kAudioTrackId = 2;
+const uint32_t kVideoTimescale = 90000;
+const uint8_t kNaluLengthSize = 4;
+
+const uint8_t kMainProfile = 77;
+// constraint_set1_flag, i.e. conforming to the Main profile.
+const uint8_t kMainProfileCompatibility = 0x40;
+const uint8_t kLevel40 = 40;
+const uint8_t kLevel51 = 51;
+// The largest frame size of level 4.0, in macroblocks.
+const uint32_t kLevel40MaxFrameSizeInMbs = 8192;
+// 16 bit frame_num and pic_order_cnt_lsb.
+const uint32_t kLog2MaxFrameNumMinus4 = 12;
+const uint32_t kLog2MaxPocLsbMinus4 = 12;
+const uint8_t kIdrNaluHeader = 0x65;  // nal_ref_idc 3, IDR slice.
+const uint8_t kRefNaluHeader = 0x41;  // nal_ref_idc 2, non-IDR slice.
+const uint8_t kNonRefNaluHeader = 0x01;  // nal_ref_idc 0, non-IDR slice.
+const uint8_t kSpsNaluHeader = 0x67;
+const uint8_t kPpsNaluHeader = 0x68;
+// slice_type values meaning that all the slices of the picture have the type.
+const uint32_t kSliceTypeP = 5;
+const uint32_t kSliceTypeB = 6;
+const uint32_t kSliceTypeI = 7;
+// The relative sizes of the frames.
+const double kIFrameWeight = 4;
+const double kPFrameWeight = 1;
+const double kBFrameWeight = 0.5;
+const size_t kMinVideoFrameSize = 64;
+
+const uint8_t kAacLcObjectType = 2;
+const uint32_t kAacFrameSamples = 1024;
+const uint8_t kAacSampleBits = 16;
+const uint32_t kMaxAacChannels = 7;
+const size_t kMinAudioFrameSize = 8;
+// See ISO 14496-3 Table 1.16.
+const uint32_t kAacSamplingFrequencies[] = {96000, 88200, 64000, 48000, 44100,
+                                            32000, 24000, 22050, 16000, 12000,
+                                            11025, 8000,  7350};
+
+// @return The index of |sample_rate| in kAacSamplingFrequencies, or -1.
+int GetAacFrequencyIndex(uint32_t sample_rate) {
+  for (size_t i = 0; i < arraysize(kAacSamplingFrequencies); ++i) {
+    if (kAacSamplingFrequencies[i] == sample_rate)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+
+// Write |value| as ue(v), see 9.1. |value| must be less than 0xFFFF.
+void WriteUE(uint32_t value, BitWriter* writer) {
+  DCHECK_LT(value, 0xFFFFu);
+  // The bits of |value| + 1, preceded by as many zero bits, less one.
+  const uint32_t code = value + 1;
+  size_t num_leading_zero_bits = 0;
+  while ((code >> (num_leading_zero_bits + 1)) != 0)
+    ++num_leading_zero_bits;
+  writer->WriteBits(code, 2 * num_leading_zero_bits + 1);
+}
+
+// Write |value| as se(v), see 9.1.1.
+void WriteSE(int32_t value, BitWriter* writer) {
+  WriteUE(value > 0 ? 2 * value - 1 : -2 * value, writer);
+}
+
+// Write the rbsp_stop_one_bit and the alignment bits.
+void WriteTrailingBits(BitWriter* writer) {
+  writer->WriteBits(1, 1);
+  writer->Flush();
+}
+
+// Append a NAL unit made of |nalu_header| and |rbsp| to |nalu|, with the
+// emulation prevention bytes, see 7.4.1.
+void AppendNalu(uint8_t nalu_header,
+                const std::vector<uint8_t>& rbsp,
+                std::vector<uint8_t>* nalu) {
+  nalu->push_back(nalu_header);
+  int num_zero_bytes = 0;
+  for (uint8_t byte : rbsp) {
+    if (num_zero_bytes >= 2 && byte <= 3) {
+      nalu->push_back(3);
+      num_zero_bytes = 0;
+    }
+    nalu->push_back(byte);
+    num_zero_bytes = byte == 0 ? num_zero_bytes + 1 : 0;
+  }
+}
+
+// See 7.3.2.1.1. The sequence is progressive 4:2:0 without VUI.
+std::vector<uint8_t> MakeSps(uint16_t width,
+                             uint16_t height,
+                             uint8_t level,
+                             uint32_t max_num_ref_frames) {
+  const uint32_t width_in_mbs = (width + 15) / 16;
+  const uint32_t height_in_mbs = (height + 15) / 16;
+  // In units of 2 pixels for 4:2:0.
+  const uint32_t crop_right_offset = (width_in_mbs * 16 - width) / 2;
+  const uint32_t crop_bottom_offset = (height_in_mbs * 16 - height) / 2;
+  const bool frame_cropping = crop_right_offset > 0 || crop_bottom_offset > 0;
+
+  std::vector<uint8_t> rbsp;
+  BitWriter writer(&rbsp);
+  writer.WriteBits(kMainProfile, 8);
+  writer.WriteBits(kMainProfileCompatibility, 8);
+  writer.WriteBits(level, 8);
+  WriteUE(0, &writer);  // seq_parameter_set_id
+  WriteUE(kLog2MaxFrameNumMinus4, &writer);
+  WriteUE(0, &writer);  // pic_order_cnt_type
+  WriteUE(kLog2MaxPocLsbMinus4, &writer);
+  WriteUE(max_num_ref_frames, &writer);
+  writer.WriteBits(0, 1);  // gaps_in_frame_num_value_allowed_flag
+  WriteUE(width_in_mbs - 1, &writer);
+  WriteUE(height_in_mbs - 1, &writer);
+  writer.WriteBits(1, 1);  // frame_mbs_only_flag
+  writer.WriteBits(1, 1);  // direct_8x8_inference_flag
+  writer.WriteBits(frame_cropping ? 1 : 0, 1);
+  if (frame_cropping) {
+    WriteUE(0, &writer);
+    WriteUE(crop_right_offset, &writer);
+    WriteUE(0, &writer);
+    WriteUE(crop_bottom_offset, &writer);
+  }
+  writer.WriteBits(0, 1);  // vui_parameters_present_flag
+  WriteTrailingBits(&writer);
+
+  std::vector<uint8_t> nalu;
+  AppendNalu(kSpsNaluHeader, rbsp, &nalu);
+  return nalu;
+}
+
+// See 7.3.2.2. CAVLC, with a single slice group and default settings.
+std::vector<uint8_t> MakePps() {
+  std::vector<uint8_t> rbsp;
+  BitWriter writer(&rbsp);
+  WriteUE(0, &writer);     // pic_parameter_set_id
+  WriteUE(0, &writer);     // seq_parameter_set_id
+  writer.WriteBits(0, 1);  // entropy_coding_mode_flag
+  writer.WriteBits(0, 1);  // bottom_field_pic_order_in_frame_present_flag
+  WriteUE(0, &writer);     // num_slice_groups_minus1
+  WriteUE(0, &writer);     // num_ref_idx_l0_default_active_minus1
+  WriteUE(0, &writer);     // num_ref_idx_l1_default_active_minus1
+  writer.WriteBits(0, 1);  // weighted_pred_flag
+  writer.WriteBits(0, 2);  // weighted_bipred_idc
+  WriteSE(0, &writer);     // pic_init_qp_minus26
+  WriteSE(0, &writer);     // pic_init_qs_minus26
+  WriteSE(0, &writer);     // chroma_qp_index_offset
+  writer.WriteBits(0, 1);  // deblocking_filter_control_present_flag
+  writer.WriteBits(0, 1);  // constrained_intra_pred_flag
+  writer.WriteBits(0, 1);  // redundant_pic_cnt_present_flag
+  WriteTrailingBits(&writer);
+
+  std::vector<uint8_t> nalu;
+  AppendNalu(kPpsNaluHeader, rbsp, &nalu);
+  return nalu;
+}
+
+// See 7.3.3. The header of a slice covering the whole picture, which is an
+// IDR picture if |type| is 'I', and a non-reference picture if it is 'B'.
+std::vector<uint8_t> MakeSliceNalu(char type,
+                                   uint32_t frame_num,
+                                   uint32_t pic_order_cnt_lsb,
+                                   uint32_t idr_pic_id) {
+  std::vector<uint8_t> rbsp;
+  BitWriter writer(&rbsp);
+  WriteUE(0, &writer);  // first_mb_in_slice
+  WriteUE(type == 'I' ? kSliceTypeI : type == 'P' ? kSliceTypeP : kSliceTypeB,
+          &writer);
+  WriteUE(0, &writer);  // pic_parameter_set_id
+  writer.WriteBits(frame_num & 0xFFFF, kLog2MaxFrameNumMinus4 + 4);
+  if (type == 'I')
+    WriteUE(idr_pic_id, &writer);
+  writer.WriteBits(pic_order_cnt_lsb & 0xFFFF, kLog2MaxPocLsbMinus4 + 4);
+  if (type == 'B')
+    writer.WriteBits(1, 1);  // direct_spatial_mv_pred_flag
+  if (type != 'I') {
+    writer.WriteBits(0, 1);  // num_ref_idx_active_override_flag
+    writer.WriteBits(0, 1);  // ref_pic_list_modification_flag_l0
+  }
+  if (type == 'B')
+    writer.WriteBits(0, 1);  // ref_pic_list_modification_flag_l1
+  // dec_ref_pic_marking().
+  if (type == 'I')
+    writer.WriteBits(0, 2);  // no_output_of_prior_pics, long_term_reference
+  else if (type == 'P')
+    writer.WriteBits(0, 1);  // adaptive_ref_pic_marking_mode_flag
+  WriteSE(0, &writer);       // slice_qp_delta
+  // The slice data starts byte aligned, with a set bit.
+  WriteTrailingBits(&writer);
+
+  std::vector<uint8_t> nalu;
+  AppendNalu(type == 'I'   ? kIdrNaluHeader
+             : type == 'P' ? kRefNaluHeader
+                           : kNonRefNaluHeader,
+             rbsp, &nalu);
+  return nalu;
+}
+
+bool ParseUint(const std::string& value, uint32_t max_value, uint32_t* out) {
+  unsigned parsed_value = 0;
+  if (!base::StringToUint(value, &parsed_value) || parsed_value > max_value)
+    return false;
+  *out = parsed_value;
+  return true;
+}
+
+}  // namespace
+
+SyntheticMediaParser::SyntheticMediaParser(const SyntheticInputParams& params)
+    : params_(params),
+      has_video_(params.video_codec != "none"),
+      has_audio_(params.audio_codec != "none") {}
+
+SyntheticMediaParser::~SyntheticMediaParser() {}
+
+void SyntheticMediaParser::Init(const InitCB& init_cb,
+                                const NewMediaSampleCB& new_media_sample_cb,
+                                const NewTextSampleCB& new_text_sample_cb,
+                                KeySource* decryption_key_source) {
+  DCHECK(!initialized_);
+  DCHECK(!init_cb.is_null());
+  DCHECK(!new_media_sample_cb.is_null());
+  init_cb_ = init_cb;
+  new_sample_cb_ = new_media_sample_cb;
+}
+
+bool SyntheticMediaParser::Flush() {
+  return true;
+}
+
+bool SyntheticMediaParser::Parse(const uint8_t* buf, int size) {
+  if (!initialized_) {
+    std::vector<std::shared_ptr<StreamInfo>> streams;
+    if (has_video_)
+      streams.push_back(InitVideo());
+    if (has_audio_)
+      streams.push_back(InitAudio());
+    if (streams.empty() ||
+        std::find(streams.begin(), streams.end(), nullptr) != streams.end()) {
+      LOG(ERROR) << "Invalid synthetic input parameters.";
+      return false;
+    }
+    // The filler of the largest frame.
+    size_t filler_size = audio_frame_size_;
+    for (const GopFrame& frame : gop_)
+      filler_size = std::max(filler_size, frame.size);
+    filler_.resize(filler_size);
+    for (size_t i = 0; i < filler_size; ++i)
+      filler_[i] = static_cast<uint8_t>(0x80 | (i * 37 & 0x7F));
+
+    initialized_ = true;
+    init_cb_.Run(streams);
+    start_time_ = base::TimeTicks::Now();
+  }
+  if (finished())
+    return true;
+
+  double chunk_end_time = generated_time_ + kChunkDurationInSeconds;
+  if (params_.duration > 0)
+    chunk_end_time = std::min(chunk_end_time, params_.duration);
+  if (params_.realtime) {
+    // The samples of the chunk are only available at its end.
+    const base::TimeDelta wait_time =
+        start_time_ + base::TimeDelta::FromSecondsD(chunk_end_time) -
+        base::TimeTicks::Now();
+    if (wait_time > base::TimeDelta())
+      base::PlatformThread::Sleep(wait_time);
+  }
+  // Interleave the samples by time.
+  while (true) {
+    const double video_time = NextVideoTime();
+    const double audio_time = NextAudioTime();
+    if (std::min(video_time, audio_time) >= chunk_end_time)
+      break;
+    if (!(video_time <= audio_time ? EmitVideoSample() : EmitAudioSample()))
+      return false;
+  }
+  generated_time_ = chunk_end_time;
+  return true;
+}
+
+void SyntheticMediaParser::SelectTracks(const std::set<uint32_t>& track_ids) {
+  tracks_selected_ = true;
+  selected_tracks_ = track_ids;
+}
+
+bool SyntheticMediaParser::finished() const {
+  return params_.duration > 0 && generated_time_ >= params_.duration;
+}
+
+// static
+bool SyntheticMediaParser::ParseInputName(const std::string& input_name,
+                                          SyntheticInputParams* params) {
+  DCHECK(params);
+  if (!base::StartsWith(input_name, kSyntheticInputPrefix,
+                        base::CompareCase::SENSITIVE)) {
+    return false;
+  }
+  const std::string params_string =
+      input_name.substr(strlen(kSyntheticInputPrefix));
+  base::StringPairs pairs;
+  if (!params_string.empty() &&
+      !base::SplitStringIntoKeyValuePairs(params_string, '=', '&', &pairs)) {
+    LOG(ERROR) << "Invalid synthetic input parameters " << params_string;
+    return false;
+  }
+
+  SyntheticInputParams new_params = *params;
+  for (const auto& pair : pairs) {
+    const std::string& name = pair.first;
+    const std::string& value = pair.second;
+    uint32_t uint_value = 0;
+    bool valid = true;
+    if (name == "video_codec") {
+      new_params.video_codec = value;
+      valid = value == "h264" || value == "none";
+    } else if (name == "width" || name == "height") {
+      valid = ParseUint(value, std::numeric_limits<uint16_t>::max(),
+                        &uint_value) &&
+              uint_value > 0 && uint_value % 2 == 0;
+      (name == "width" ? new_params.width : new_params.height) =
+          static_cast<uint16_t>(uint_value);
+    } else if (name == "frame_rate") {
+      valid = base::StringToDouble(value, &new_params.frame_rate) &&
+              new_params.frame_rate > 0 && new_params.frame_rate <= 300;
+    } else if (name == "video_bitrate") {
+      valid = ParseUint(value, std::numeric_limits<uint32_t>::max(),
+                        &new_params.video_bitrate);
+    } else if (name == "gop_size") {
+      valid = ParseUint(value, std::numeric_limits<uint32_t>::max(),
+                        &new_params.gop_size) &&
+              new_params.gop_size > 0;
+    } else if (name == "b_frames") {
+      valid = ParseUint(value, std::numeric_limits<uint32_t>::max(),
+                        &new_params.b_frames);
+    } else if (name == "audio_codec") {
+      new_params.audio_codec = value;
+      valid = value == "aac" || value == "none";
+    } else if (name == "audio_bitrate") {
+      valid = ParseUint(value, std::numeric_limits<uint32_t>::max(),
+                        &new_params.audio_bitrate);
+    } else if (name == "sample_rate") {
+      valid = ParseUint(value, std::numeric_limits<uint32_t>::max(),
+                        &new_params.sample_rate) &&
+              GetAacFrequencyIndex(new_params.sample_rate) >= 0;
+    } else if (name == "channels") {
+      valid = ParseUint(value, kMaxAacChannels, &new_params.channels) &&
+              new_params.channels > 0;
+    } else if (name == "duration") {
+      valid = base::StringToDouble(value, &new_params.duration) &&
+              new_params.duration >= 0;
+    } else if (name == "realtime") {
+      valid = ParseUint(value, 1, &uint_value);
+      new_params.realtime = uint_value == 1;
+    } else {
+      LOG(ERROR) << "Unknown synthetic input parameter " << name;
+      return false;
+    }
+    if (!valid) {
+      LOG(ERROR) << "Invalid synthetic input parameter " << name << "="
+                 << value;
+      return false;
+    }
+  }
+  if (new_params.video_codec == "none" && new_params.audio_codec == "none") {
+    LOG(ERROR) << "A synthetic input needs a video or an audio stream.";
+    return false;
+  }
+  if (new_params.b_frames >= new_params.gop_size) {
+    LOG(ERROR) << "The synthetic input has more B frames ("
+               << new_params.b_frames << ") than its GOP size ("
+               << new_params.gop_size << ").";
+    return false;
+  }
+  *params = new_params;
+  return true;
+}
+
+std::shared_ptr<StreamInfo> SyntheticMediaParser::InitVideo() {
+  if (params_.width == 0 || params_.height == 0 || params_.width % 2 != 0 ||
+      params_.height % 2 != 0 || params_.frame_rate <= 0 ||
+      params_.gop_size == 0 || params_.b_frames >= params_.gop_size) {
+    return nullptr;
+  }
+  frame_duration_ = std::max<int64_t>(
+      1, std::llround(kVideoTimescale / params_.frame_rate));
+
+  // The frames of a group of pictures in decoding order: the key frame, then
+  // each P frame followed by the B frames displayed before it.
+  const uint32_t gop_size = params_.gop_size;
+  gop_.clear();
+  gop_.push_back({0, 'I', 0, 0});
+  uint32_t num_reference_frames = 1;
+  for (uint32_t next = 1; next < gop_size;) {
+    const uint32_t anchor = std::min(next + params_.b_frames, gop_size - 1);
+    gop_.push_back({anchor, 'P', num_reference_frames++, 0});
+    for (uint32_t i = next; i < anchor; ++i)
+      gop_.push_back({i, 'B', num_reference_frames, 0});
+    next = anchor + 1;
+  }
+  double total_weight = 0;
+  for (const GopFrame& frame : gop_) {
+    total_weight += frame.type == 'I'   ? kIFrameWeight
+                    : frame.type == 'P' ? kPFrameWeight
+                                        : kBFrameWeight;
+  }
+  const double gop_bytes =
+      params_.video_bitrate / 8.0 / params_.frame_rate * gop_size;
+  for (GopFrame& frame : gop_) {
+    const double weight = frame.type == 'I'   ? kIFrameWeight
+                          : frame.type == 'P' ? kPFrameWeight
+                                              : kBFrameWeight;
+    frame.size = std::max(
+        kMinVideoFrameSize,
+        static_cast<size_t>(gop_bytes * weight / total_weight));
+  }
+
+  const uint32_t frame_size_in_mbs =
+      ((params_.width + 15) / 16) * ((params_.height + 15) / 16);
+  const uint8_t level =
+      frame_size_in_mbs <= kLevel40MaxFrameSizeInMbs ? kLevel40 : kLevel51;
+  const std::vector<uint8_t> sps = MakeSps(
+      params_.width, params_.height, level, params_.b_frames > 0 ? 2 : 1);
+  const std::vector<uint8_t> pps = MakePps();
+  // See ISO 14496-15 5.3.3.1.
+  std::vector<uint8_t> avc_config = {
+      1, kMainProfile, kMainProfileCompatibility, level,
+      0xFC | (kNaluLengthSize - 1),
+      0xE1,  // One SPS.
+      static_cast<uint8_t>(sps.size() >> 8), static_cast<uint8_t>(sps.size()),
+  };
+  avc_config.insert(avc_config.end(), sps.begin(), sps.end());
+  avc_config.push_back(1);  // One PPS.
+  avc_config.push_back(static_cast<uint8_t>(pps.size() >> 8));
+  avc_config.push_back(static_cast<uint8_t>(pps.size()));
+  avc_config.insert(avc_config.end(), pps.begin(), pps.end());
+
+  const int64_t duration =
+      params_.duration > 0 ? std::llround(params_.duration * kVideoTimescale)
+                           : kInfiniteDuration;
+  return std::make_shared<VideoStreamInfo>(
+      kVideoTrackId, kVideoTimescale, duration, kCodecH264,
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus,
+      AVCDecoderConfigurationRecord::GetCodecString(
+          FOURCC_avc1, kMainProfile, kMainProfileCompatibility, level),
+      avc_config.data(), avc_config.size(), params_.width, params_.height,
+      1 /* pixel_width */, 1 /* pixel_height */,
+      0 /* transfer_characteristics */, 0 /* trick_play_factor */,
+      kNaluLengthSize, std::string(), false);
+}
+
+std::shared_ptr<StreamInfo> SyntheticMediaParser::InitAudio() {
+  const int frequency_index = GetAacFrequencyIndex(params_.sample_rate);
+  if (frequency_index < 0 || params_.channels == 0 ||
+      params_.channels > kMaxAacChannels) {
+    return nullptr;
+  }
+  audio_frame_size_ = std::max(
+      kMinAudioFrameSize,
+      static_cast<size_t>(params_.audio_bitrate / 8.0 * kAacFrameSamples /
+                          params_.sample_rate));
+
+  // AudioSpecificConfig, see ISO 14496-3 1.6.2.1.
+  std::vector<uint8_t> audio_specific_config;
+  BitWriter writer(&audio_specific_config);
+  writer.WriteBits(kAacLcObjectType, 5);
+  writer.WriteBits(frequency_index, 4);
+  writer.WriteBits(params_.channels, 4);
+  // frameLengthFlag, dependsOnCoreCoder and extensionFlag are 0.
+  writer.Flush();
+
+  const int64_t duration =
+      params_.duration > 0
+          ? std::llround(params_.duration * params_.sample_rate)
+          : kInfiniteDuration;
+  return std::make_shared<AudioStreamInfo>(
+      kAudioTrackId, params_.sample_rate, duration, kCodecAAC,
+      AudioStreamInfo::GetCodecString(kCodecAAC, kAacLcObjectType),
+      audio_specific_config.data(), audio_specific_config.size(),
+      kAacSampleBits, static_cast<uint8_t>(params_.channels),
+      params_.sample_rate,
+      0 /* seek preroll */, 0 /* codec delay */, params_.audio_bitrate,
+      params_.audio_bitrate, std::string(), false);
+}
+
+bool SyntheticMediaParser::EmitVideoSample() {
+  const int64_t gop_index = num_video_frames_ / gop_.size();
+  const GopFrame& frame = gop_[num_video_frames_ % gop_.size()];
+  const int64_t display_index = gop_index * gop_.size() + frame.display_index;
+  // The B frames are displayed one frame late.
+  const int64_t reorder_delay = params_.b_frames > 0 ? 1 : 0;
+  const int64_t dts = num_video_frames_ * frame_duration_;
+  const int64_t pts = (display_index + reorder_delay) * frame_duration_;
+  ++num_video_frames_;
+  if (tracks_selected_ && selected_tracks_.count(kVideoTrackId) == 0)
+    return true;
+
+  const std::vector<uint8_t> slice_header =
+      MakeSliceNalu(frame.type, frame.frame_num, frame.display_index * 2,
+                    static_cast<uint32_t>(gop_index % 2));
+  const size_t nalu_size =
+      std::max(frame.size - kNaluLengthSize, slice_header.size());
+  const size_t sample_size = kNaluLengthSize + nalu_size;
+  std::shared_ptr<uint8_t> data =
+      SampleBufferPool::GetDefault()->Allocate(sample_size);
+  uint8_t* dest = data.get();
+  for (int i = kNaluLengthSize - 1; i >= 0; --i)
+    *dest++ = static_cast<uint8_t>(nalu_size >> (8 * i));
+  memcpy(dest, slice_header.data(), slice_header.size());
+  memcpy(dest + slice_header.size(), filler_.data(),
+         nalu_size - slice_header.size());
+
+  std::shared_ptr<MediaSample> sample = MediaSample::CreateEmptyMediaSample();
+  sample->TransferData(std::move(data), sample_size);
+  sample->set_dts(dts);
+  sample->set_pts(pts);
+  sample->set_duration(frame_duration_);
+  sample->set_is_key_frame(frame.type == 'I');
+  return new_sample_cb_.Run(kVideoTrackId, std::move(sample));
+}
+
+bool SyntheticMediaParser::EmitAudioSample() {
+  const int64_t timestamp = num_audio_frames_ * kAacFrameSamples;
+  ++num_audio_frames_;
+  if (tracks_selected_ && selected_tracks_.count(kAudioTrackId) == 0)
+    return true;
+
+  std::shared_ptr<MediaSample> sample =
+      MediaSample::CopyFrom(filler_.data(), audio_frame_size_, true);
+  sample->set_dts(timestamp);
+  sample->set_pts(timestamp);
+  sample->set_duration(kAacFrameSamples);
+  return new_sample_cb_.Run(kAudioTrackId, std::move(sample));
+}
+
+double SyntheticMediaParser::NextVideoTime() const {
+  if (!has_video_)
+    return std::numeric_limits<double>::infinity();
+  return static_cast<double>(num_video_frames_ * frame_duration_) /
+         kVideoTimescale;
+}
+
+double SyntheticMediaParser::NextAudioTime() const {
+  if (!has_audio_)
+    return std::numeric_limits<double>::infinity();
+  return static_cast<double>(num_audio_frames_ * kAacFrameSamples) /
+         params_.sample_rate;
+}
+
+}  // namespace media
+}  // namespace shaka
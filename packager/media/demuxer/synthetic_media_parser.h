@@ -0,0 +1,146 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_DEMUXER_SYNTHETIC_MEDIA_PARSER_H_
+#define PACKAGER_MEDIA_DEMUXER_SYNTHETIC_MEDIA_PARSER_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "packager/base/time/time.h"
+#include "packager/media/base/media_parser.h"
+
+namespace shaka {
+namespace media {
+
+/// Prefix of the synthetic inputs, followed by '&' separated parameters, see
+/// SyntheticInputParams, e.g.
+/// "synthetic://frame_rate=60&video_bitrate=8000000&duration=3600".
+extern const char kSyntheticInputPrefix[];
+
+/// The streams generated by a synthetic input. The parameters of the input
+/// name have the names of the members.
+struct SyntheticInputParams {
+  /// "h264", or "none" for no video stream.
+  std::string video_codec = "h264";
+  /// The width and height of the video, which must be even.
+  uint16_t width = 1280;
+  uint16_t height = 720;
+  double frame_rate = 30;
+  uint32_t video_bitrate = 2000000;
+  /// The number of frames of the groups of pictures, each starting with a key
+  /// frame.
+  uint32_t gop_size = 60;
+  /// The number of B frames between the reference frames.
+  uint32_t b_frames = 0;
+  /// "aac", or "none" for no audio stream.
+  std::string audio_codec = "aac";
+  uint32_t audio_bitrate = 128000;
+  uint32_t sample_rate = 48000;
+  uint32_t channels = 2;
+  /// The duration of the input in seconds, or 0 for an endless input.
+  double duration = 0;
+  /// Whether the samples are generated at the pace of the media, like a live
+  /// source, instead of as fast as they are consumed.
+  bool realtime = false;
+};
+
+/// SyntheticMediaParser generates H.264 video and AAC audio streams at a given
+/// line rate, e.g. to load or soak test the packaging of many channels
+/// without encoders. The video samples are made of a single slice with a
+/// valid header followed by filler data, so that they can be encrypted and
+/// remuxed to any container, but not decoded. The data passed to Parse() is
+/// ignored.
+class SyntheticMediaParser : public MediaParser {
+ public:
+  explicit SyntheticMediaParser(const SyntheticInputParams& params);
+  ~SyntheticMediaParser() override;
+
+  /// @name MediaParser implementation overrides.
+  /// @{
+  void Init(const InitCB& init_cb,
+            const NewMediaSampleCB& new_media_sample_cb,
+            const NewTextSampleCB& new_text_sample_cb,
+            KeySource* decryption_key_source) override;
+  bool Flush() override WARN_UNUSED_RESULT;
+  /// Generate the next samples, up to kChunkDurationInSeconds of media,
+  /// waiting for them to be due if the input is real time. The stream info
+  /// is emitted by the first call.
+  bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  void SelectTracks(const std::set<uint32_t>& track_ids) override;
+  /// @}
+
+  /// @return true once all the samples of a finite input are generated.
+  bool finished() const;
+
+  /// Extract the parameters of an input named @a input_name, which starts
+  /// with kSyntheticInputPrefix. The parameters not in the name keep their
+  /// value in @a params.
+  /// @return false if a parameter is unknown or invalid.
+  static bool ParseInputName(const std::string& input_name,
+                             SyntheticInputParams* params);
+
+  /// The duration of the media generated by each call to Parse().
+  static const double kChunkDurationInSeconds;
+
+ private:
+  SyntheticMediaParser(const SyntheticMediaParser&) = delete;
+  SyntheticMediaParser& operator=(const SyntheticMediaParser&) = delete;
+
+  // A frame of a group of pictures, in decoding order.
+  struct GopFrame {
+    // The position of the frame in presentation order.
+    uint32_t display_index;
+    // 'I', 'P' or 'B'.
+    char type;
+    // The number of reference frames decoded before it in the group.
+    uint32_t frame_num;
+    size_t size;
+  };
+
+  // Set up the generation of the video or audio samples.
+  // Return the stream info of the stream.
+  std::shared_ptr<StreamInfo> InitVideo();
+  std::shared_ptr<StreamInfo> InitAudio();
+  // Emit the next video or audio sample. Return false if it is rejected.
+  bool EmitVideoSample();
+  bool EmitAudioSample();
+  // Time, in seconds, of the next video or audio sample.
+  double NextVideoTime() const;
+  double NextAudioTime() const;
+
+  const SyntheticInputParams params_;
+  InitCB init_cb_;
+  NewMediaSampleCB new_sample_cb_;
+  bool has_video_ = false;
+  bool has_audio_ = false;
+  // The tracks whose samples are emitted, if SelectTracks() is called.
+  bool tracks_selected_ = false;
+  std::set<uint32_t> selected_tracks_;
+  bool initialized_ = false;
+  // The media generated so far, in seconds.
+  double generated_time_ = 0;
+  base::TimeTicks start_time_;
+
+  std::vector<GopFrame> gop_;
+  // The data after the slice headers, which has no zero bytes so that it
+  // needs no emulation prevention.
+  std::vector<uint8_t> filler_;
+  int64_t frame_duration_ = 0;
+  int64_t num_video_frames_ = 0;
+
+  size_t audio_frame_size_ = 0;
+  int64_t num_audio_frames_ = 0;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_DEMUXER_SYNTHETIC_MEDIA_PARSER_H_
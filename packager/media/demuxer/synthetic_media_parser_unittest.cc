@@ -0,0 +1,224 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/synthetic_media_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "packager/base/bind.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/codecs/aac_audio_specific_config.h"
+#include "packager/media/codecs/avc_decoder_configuration_record.h"
+#include "packager/media/codecs/h264_parser.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const uint32_t kVideoTrackId = 1;
+const uint32_t kAudioTrackId = 2;
+
+}  // namespace
+
+class SyntheticMediaParserTest : public testing::Test {
+ protected:
+  void InitParser(const std::string& input_name) {
+    SyntheticInputParams params;
+    ASSERT_TRUE(SyntheticMediaParser::ParseInputName(input_name, &params));
+    parser_.reset(new SyntheticMediaParser(params));
+    parser_->Init(
+        base::Bind(&SyntheticMediaParserTest::InitF, base::Unretained(this)),
+        base::Bind(&SyntheticMediaParserTest::NewSampleF,
+                   base::Unretained(this)),
+        base::Bind(&SyntheticMediaParserTest::NewTextSampleF,
+                   base::Unretained(this)),
+        nullptr);
+  }
+
+  void ParseAll() {
+    while (!parser_->finished())
+      ASSERT_TRUE(parser_->Parse(nullptr, 0));
+    ASSERT_TRUE(parser_->Flush());
+  }
+
+  void InitF(const std::vector<std::shared_ptr<StreamInfo>>& streams) {
+    streams_ = streams;
+  }
+
+  bool NewSampleF(uint32_t track_id, std::shared_ptr<MediaSample> sample) {
+    samples_[track_id].push_back(std::move(sample));
+    return true;
+  }
+
+  bool NewTextSampleF(uint32_t track_id, std::shared_ptr<TextSample> sample) {
+    return false;
+  }
+
+  std::unique_ptr<SyntheticMediaParser> parser_;
+  std::vector<std::shared_ptr<StreamInfo>> streams_;
+  std::map<uint32_t, std::vector<std::shared_ptr<MediaSample>>> samples_;
+};
+
+TEST_F(SyntheticMediaParserTest, ParseInputName) {
+  SyntheticInputParams params;
+  ASSERT_TRUE(SyntheticMediaParser::ParseInputName("synthetic://", &params));
+  EXPECT_EQ("h264", params.video_codec);
+  EXPECT_EQ("aac", params.audio_codec);
+  EXPECT_FALSE(params.realtime);
+
+  ASSERT_TRUE(SyntheticMediaParser::ParseInputName(
+      "synthetic://width=1920&height=1080&frame_rate=29.97&gop_size=30&"
+      "b_frames=2&audio_codec=none&duration=60&realtime=1",
+      &params));
+  EXPECT_EQ(1920u, params.width);
+  EXPECT_EQ(1080u, params.height);
+  EXPECT_DOUBLE_EQ(29.97, params.frame_rate);
+  EXPECT_EQ(30u, params.gop_size);
+  EXPECT_EQ(2u, params.b_frames);
+  EXPECT_EQ("none", params.audio_codec);
+  EXPECT_DOUBLE_EQ(60, params.duration);
+  EXPECT_TRUE(params.realtime);
+}
+
+TEST_F(SyntheticMediaParserTest, ParseInvalidInputName) {
+  SyntheticInputParams params;
+  EXPECT_FALSE(SyntheticMediaParser::ParseInputName("file.mp4", &params));
+  EXPECT_FALSE(
+      SyntheticMediaParser::ParseInputName("synthetic://color=red", &params));
+  EXPECT_FALSE(
+      SyntheticMediaParser::ParseInputName("synthetic://width=641", &params));
+  EXPECT_FALSE(SyntheticMediaParser::ParseInputName(
+      "synthetic://video_codec=vp9", &params));
+  EXPECT_FALSE(SyntheticMediaParser::ParseInputName(
+      "synthetic://sample_rate=12345", &params));
+  EXPECT_FALSE(SyntheticMediaParser::ParseInputName(
+      "synthetic://gop_size=2&b_frames=2", &params));
+  EXPECT_FALSE(SyntheticMediaParser::ParseInputName(
+      "synthetic://video_codec=none&audio_codec=none", &params));
+  // Not modified on failure.
+  EXPECT_EQ(1280u, params.width);
+}
+
+TEST_F(SyntheticMediaParserTest, StreamInfo) {
+  InitParser("synthetic://width=1920&height=1080&sample_rate=44100&"
+             "channels=1&duration=1");
+  ASSERT_TRUE(parser_->Parse(nullptr, 0));
+  ASSERT_EQ(2u, streams_.size());
+
+  const VideoStreamInfo& video =
+      static_cast<const VideoStreamInfo&>(*streams_[0]);
+  EXPECT_EQ(kStreamVideo, video.stream_type());
+  EXPECT_EQ(kCodecH264, video.codec());
+  EXPECT_EQ("avc1.4d4028", video.codec_string());
+  AVCDecoderConfigurationRecord avc_config;
+  ASSERT_TRUE(avc_config.Parse(video.codec_config()));
+  EXPECT_EQ(1920u, avc_config.coded_width());
+  EXPECT_EQ(1080u, avc_config.coded_height());
+
+  const AudioStreamInfo& audio =
+      static_cast<const AudioStreamInfo&>(*streams_[1]);
+  EXPECT_EQ(kCodecAAC, audio.codec());
+  EXPECT_EQ("mp4a.40.2", audio.codec_string());
+  AACAudioSpecificConfig audio_config;
+  ASSERT_TRUE(audio_config.Parse(audio.codec_config()));
+  EXPECT_EQ(44100u, audio_config.GetSamplesPerSecond());
+  EXPECT_EQ(1u, audio_config.GetNumChannels());
+}
+
+TEST_F(SyntheticMediaParserTest, GopStructure) {
+  InitParser("synthetic://frame_rate=25&gop_size=10&b_frames=2&"
+             "video_bitrate=1000000&audio_bitrate=64000&duration=2");
+  ParseAll();
+  ASSERT_EQ(2u, streams_.size());
+
+  H264Parser h264_parser;
+  AVCDecoderConfigurationRecord avc_config;
+  ASSERT_TRUE(avc_config.Parse(streams_[0]->codec_config()));
+  int id = 0;
+  ASSERT_EQ(H264Parser::kOk, h264_parser.ParseSps(avc_config.nalu(0), &id));
+  ASSERT_EQ(H264Parser::kOk, h264_parser.ParsePps(avc_config.nalu(1), &id));
+
+  const std::vector<std::shared_ptr<MediaSample>>& video_samples =
+      samples_[kVideoTrackId];
+  ASSERT_EQ(50u, video_samples.size());
+  const int64_t kFrameDuration = 3600;
+  // The decoding order of the frames of a group, by presentation time.
+  const int kDisplayIndexes[] = {0, 3, 1, 2, 6, 4, 5, 9, 7, 8};
+  const char kSliceTypes[] = "IPBBPBBPBB";
+  size_t total_size = 0;
+  for (size_t i = 0; i < video_samples.size(); ++i) {
+    const MediaSample& sample = *video_samples[i];
+    const size_t gop_index = i / 10;
+    EXPECT_EQ(static_cast<int64_t>(i) * kFrameDuration, sample.dts());
+    EXPECT_EQ(static_cast<int64_t>(gop_index * 10 + kDisplayIndexes[i % 10] +
+                                   1) *
+                  kFrameDuration,
+              sample.pts());
+    EXPECT_EQ(i % 10 == 0, sample.is_key_frame());
+    total_size += sample.data_size();
+
+    NaluReader reader(Nalu::kH264, avc_config.nalu_length_size(),
+                      sample.data(), sample.data_size());
+    Nalu nalu;
+    ASSERT_EQ(NaluReader::kOk, reader.Advance(&nalu));
+    H264SliceHeader slice_header;
+    ASSERT_EQ(H264Parser::kOk,
+              h264_parser.ParseSliceHeader(nalu, &slice_header));
+    switch (kSliceTypes[i % 10]) {
+      case 'I':
+        EXPECT_TRUE(slice_header.IsISlice());
+        EXPECT_TRUE(slice_header.idr_pic_flag);
+        break;
+      case 'P':
+        EXPECT_TRUE(slice_header.IsPSlice());
+        break;
+      case 'B':
+        EXPECT_TRUE(slice_header.IsBSlice());
+        EXPECT_EQ(0, slice_header.nal_ref_idc);
+        break;
+    }
+    EXPECT_EQ(kDisplayIndexes[i % 10] * 2, slice_header.pic_order_cnt_lsb);
+    EXPECT_EQ(NaluReader::kEOStream, reader.Advance(&nalu));
+  }
+  // The bitrate is met.
+  EXPECT_NEAR(250000u, total_size, 1000u);
+
+  const std::vector<std::shared_ptr<MediaSample>>& audio_samples =
+      samples_[kAudioTrackId];
+  // 2 seconds of 1024 samples frames at 48 kHz.
+  ASSERT_EQ(94u, audio_samples.size());
+  for (size_t i = 0; i < audio_samples.size(); ++i) {
+    EXPECT_EQ(static_cast<int64_t>(i) * 1024, audio_samples[i]->pts());
+    EXPECT_EQ(170u, audio_samples[i]->data_size());
+  }
+}
+
+TEST_F(SyntheticMediaParserTest, OnlySelectedTracksAreEmitted) {
+  InitParser("synthetic://duration=1");
+  ASSERT_TRUE(parser_->Parse(nullptr, 0));
+  parser_->SelectTracks({kAudioTrackId});
+  ParseAll();
+  EXPECT_EQ(3u, samples_[kVideoTrackId].size());
+  EXPECT_EQ(47u, samples_[kAudioTrackId].size());
+}
+
+TEST_F(SyntheticMediaParserTest, Realtime) {
+  InitParser("synthetic://video_codec=none&duration=0.3&realtime=1");
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  ParseAll();
+  EXPECT_GE(base::TimeTicks::Now() - start_time,
+            base::TimeDelta::FromMilliseconds(300));
+  EXPECT_EQ(1u, streams_.size());
+  EXPECT_EQ(15u, samples_[kAudioTrackId].size());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,72 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/time_slicer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace shaka {
+namespace media {
+
+std::vector<TimeSlice> SplitIntoTimeSlices(
+    const std::vector<SampleIndex::Sample>& samples,
+    uint32_t time_scale,
+    const ChunkingParams& chunking_params,
+    size_t max_num_slices) {
+  // Same as ChunkingHandler.
+  const int64_t segment_duration =
+      chunking_params.segment_duration_in_seconds * time_scale;
+  if (segment_duration <= 0 || max_num_slices < 2)
+    return std::vector<TimeSlice>();
+
+  // The positions of the samples which start a segment, as ChunkingHandler
+  // starts the segments without ad cues.
+  std::vector<size_t> segment_starts;
+  int64_t current_segment_index = 0;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const SampleIndex::Sample& sample = samples[i];
+    if (!sample.is_key_frame && chunking_params.segment_sap_aligned)
+      continue;
+    const int64_t segment_index =
+        sample.pts < 0 ? 0 : sample.pts / segment_duration;
+    // The segment index may decrease by one without starting a segment, see
+    // IsNewSegmentIndex() in ChunkingHandler.
+    const bool is_new_segment_index =
+        segment_index != current_segment_index &&
+        segment_index != current_segment_index - 1;
+    if (segment_starts.empty() || is_new_segment_index) {
+      current_segment_index = segment_index;
+      segment_starts.push_back(i);
+    }
+  }
+
+  const size_t num_segments = segment_starts.size();
+  const size_t num_slices = std::min(max_num_slices, num_segments);
+  if (num_slices < 2)
+    return std::vector<TimeSlice>();
+
+  std::vector<TimeSlice> slices(num_slices);
+  for (size_t i = 0; i < num_slices; ++i) {
+    const size_t first_segment = i * num_segments / num_slices;
+    const size_t end_segment = (i + 1) * num_segments / num_slices;
+    TimeSlice& slice = slices[i];
+    // The samples before the first segment are discarded by ChunkingHandler,
+    // as with the whole track.
+    slice.start_decode_time =
+        i == 0 ? std::numeric_limits<int64_t>::min()
+               : samples[segment_starts[first_segment]].dts;
+    slice.end_decode_time = end_segment == num_segments
+                                ? std::numeric_limits<int64_t>::max()
+                                : samples[segment_starts[end_segment]].dts;
+    slice.first_segment_index = static_cast<uint32_t>(first_segment);
+    slice.num_segments = static_cast<uint32_t>(end_segment - first_segment);
+  }
+  return slices;
+}
+
+}  // namespace media
+}  // namespace shaka
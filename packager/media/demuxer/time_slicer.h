@@ -0,0 +1,54 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_DEMUXER_TIME_SLICER_H_
+#define PACKAGER_MEDIA_DEMUXER_TIME_SLICER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "packager/media/demuxer/sample_index.h"
+#include "packager/media/public/chunking_params.h"
+
+namespace shaka {
+namespace media {
+
+/// A time slice of a track, made of whole segments.
+struct TimeSlice {
+  /// The decoding time range of the samples of the slice, from
+  /// @a start_decode_time, included, to @a end_decode_time, excluded, in the
+  /// time scale of the track.
+  int64_t start_decode_time = 0;
+  int64_t end_decode_time = 0;
+  /// The index of the first segment of the slice in the track.
+  uint32_t first_segment_index = 0;
+  /// The number of segments of the slice.
+  uint32_t num_segments = 0;
+};
+
+/// Split a track into time slices at the samples which start a segment,
+/// following the rules of ChunkingHandler, so that packaging each slice on its
+/// own produces the same segments as packaging the whole track. The segments
+/// are spread evenly among the slices.
+/// @param samples are the samples of the track, in decoding order.
+/// @param time_scale is the time scale of the timestamps of @a samples.
+/// @param chunking_params are the chunking parameters of the packaging, which
+///        must not have ad cues.
+/// @param max_num_slices is the maximum number of slices.
+/// @return the slices, in order, which cover all the samples, or an empty
+///         vector if the track cannot be split, e.g. if it has fewer than two
+///         segments.
+std::vector<TimeSlice> SplitIntoTimeSlices(
+    const std::vector<SampleIndex::Sample>& samples,
+    uint32_t time_scale,
+    const ChunkingParams& chunking_params,
+    size_t max_num_slices);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_DEMUXER_TIME_SLICER_H_
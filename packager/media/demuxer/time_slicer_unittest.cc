@@ -0,0 +1,93 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/time_slicer.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint32_t kTimeScale = 1000;
+const int64_t kSampleDuration = 250;
+
+// Samples of |kSampleDuration|, with a key frame every |key_frame_interval|
+// samples.
+std::vector<SampleIndex::Sample> GetSamples(size_t num_samples,
+                                            size_t key_frame_interval) {
+  std::vector<SampleIndex::Sample> samples(num_samples);
+  for (size_t i = 0; i < num_samples; ++i) {
+    samples[i].dts = i * kSampleDuration;
+    samples[i].pts = samples[i].dts;
+    samples[i].duration = kSampleDuration;
+    samples[i].is_key_frame = i % key_frame_interval == 0;
+  }
+  return samples;
+}
+
+ChunkingParams GetChunkingParams(double segment_duration_in_seconds) {
+  ChunkingParams params;
+  params.segment_duration_in_seconds = segment_duration_in_seconds;
+  return params;
+}
+
+}  // namespace
+
+TEST(TimeSlicerTest, SplitsAtSegmentBoundaries) {
+  // 10 segments of 1 second, with a key frame every half second.
+  const std::vector<TimeSlice> slices =
+      SplitIntoTimeSlices(GetSamples(40, 2), kTimeScale, GetChunkingParams(1),
+                          3);
+  ASSERT_EQ(3u, slices.size());
+  EXPECT_EQ(std::numeric_limits<int64_t>::min(), slices[0].start_decode_time);
+  EXPECT_EQ(3000, slices[0].end_decode_time);
+  EXPECT_EQ(0u, slices[0].first_segment_index);
+  EXPECT_EQ(3u, slices[0].num_segments);
+  EXPECT_EQ(3000, slices[1].start_decode_time);
+  EXPECT_EQ(6000, slices[1].end_decode_time);
+  EXPECT_EQ(3u, slices[1].first_segment_index);
+  EXPECT_EQ(3u, slices[1].num_segments);
+  EXPECT_EQ(6000, slices[2].start_decode_time);
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), slices[2].end_decode_time);
+  EXPECT_EQ(6u, slices[2].first_segment_index);
+  EXPECT_EQ(4u, slices[2].num_segments);
+}
+
+TEST(TimeSlicerTest, SegmentsStartAtKeyFrames) {
+  // The key frames, every 1.5 seconds, all start a segment, at 0, 1.5, 3, 4.5
+  // and 6 seconds.
+  const std::vector<TimeSlice> slices =
+      SplitIntoTimeSlices(GetSamples(28, 6), kTimeScale, GetChunkingParams(1),
+                          2);
+  ASSERT_EQ(2u, slices.size());
+  EXPECT_EQ(3000, slices[0].end_decode_time);
+  EXPECT_EQ(2u, slices[0].num_segments);
+  EXPECT_EQ(3000, slices[1].start_decode_time);
+  EXPECT_EQ(2u, slices[1].first_segment_index);
+  EXPECT_EQ(3u, slices[1].num_segments);
+}
+
+TEST(TimeSlicerTest, NoMoreSlicesThanSegments) {
+  const std::vector<TimeSlice> slices =
+      SplitIntoTimeSlices(GetSamples(12, 4), kTimeScale, GetChunkingParams(1),
+                          8);
+  EXPECT_EQ(3u, slices.size());
+}
+
+TEST(TimeSlicerTest, CannotSplitSingleSegment) {
+  EXPECT_TRUE(SplitIntoTimeSlices(GetSamples(12, 4), kTimeScale,
+                                  GetChunkingParams(10), 4)
+                  .empty());
+  EXPECT_TRUE(SplitIntoTimeSlices(GetSamples(12, 4), kTimeScale,
+                                  GetChunkingParams(1), 1)
+                  .empty());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,176 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/async_muxer_listener.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/protection_system_specific_info.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/base/task_executor.h"
+
+namespace shaka {
+namespace media {
+
+MuxerListenerQueue::MuxerListenerQueue()
+    : MuxerListenerQueue(TaskExecutor::GetInstance()) {}
+
+MuxerListenerQueue::MuxerListenerQueue(TaskExecutor* executor)
+    : executor_(executor), events_passed_on_(&lock_) {
+  DCHECK(executor_);
+}
+
+MuxerListenerQueue::~MuxerListenerQueue() {
+  base::AutoLock auto_lock(lock_);
+  while (pass_on_task_posted_)
+    events_passed_on_.Wait();
+}
+
+void MuxerListenerQueue::Post(Event event) {
+  base::AutoLock auto_lock(lock_);
+  events_.push_back(std::move(event));
+  ++num_posted_events_;
+  if (!pass_on_task_posted_)
+    PostPassOnTask();
+}
+
+void MuxerListenerQueue::WaitForPostedEvents() {
+  base::AutoLock auto_lock(lock_);
+  const uint64_t num_events = num_posted_events_;
+  while (num_passed_on_events_ < num_events)
+    events_passed_on_.Wait();
+}
+
+void MuxerListenerQueue::PostPassOnTask() {
+  lock_.AssertAcquired();
+  pass_on_task_posted_ = true;
+  executor_->PostTask(TaskExecutor::kManifestPriority,
+                      base::Bind(&MuxerListenerQueue::PassEventsOn,
+                                 base::Unretained(this)));
+}
+
+void MuxerListenerQueue::PassEventsOn() {
+  std::vector<Event> events;
+  {
+    base::AutoLock auto_lock(lock_);
+    events.swap(events_);
+  }
+
+  for (const Event& event : events)
+    event();
+
+  base::AutoLock auto_lock(lock_);
+  num_passed_on_events_ += events.size();
+  // The events posted meanwhile are passed on by another task, so the events
+  // of other queues and the tasks of higher priority are not held up.
+  if (events_.empty())
+    pass_on_task_posted_ = false;
+  else
+    PostPassOnTask();
+  events_passed_on_.Broadcast();
+}
+
+AsyncMuxerListener::AsyncMuxerListener(std::unique_ptr<MuxerListener> listener,
+                                       MuxerListenerQueue* queue)
+    : listener_(std::move(listener)), queue_(queue) {
+  DCHECK(listener_);
+  DCHECK(queue_);
+}
+
+AsyncMuxerListener::~AsyncMuxerListener() {
+  // The events posted refer to |listener_|.
+  queue_->WaitForPostedEvents();
+}
+
+void AsyncMuxerListener::OnEncryptionInfoReady(
+    bool is_initial_encryption_info,
+    FourCC protection_scheme,
+    const std::vector<uint8_t>& key_id,
+    const std::vector<uint8_t>& iv,
+    const std::vector<ProtectionSystemSpecificInfo>& key_system_info) {
+  MuxerListener* listener = listener_.get();
+  queue_->Post([=]() {
+    listener->OnEncryptionInfoReady(is_initial_encryption_info,
+                                    protection_scheme, key_id, iv,
+                                    key_system_info);
+  });
+}
+
+void AsyncMuxerListener::OnEncryptionStart() {
+  MuxerListener* listener = listener_.get();
+  queue_->Post([listener]() { listener->OnEncryptionStart(); });
+}
+
+void AsyncMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
+                                      const StreamInfo& stream_info,
+                                      uint32_t time_scale,
+                                      ContainerType container_type) {
+  MuxerListener* listener = listener_.get();
+  // The stream info belongs to the muxer, so the event has a copy.
+  std::shared_ptr<StreamInfo> stream_info_copy(stream_info.Clone());
+  queue_->Post([=]() {
+    listener->OnMediaStart(muxer_options, *stream_info_copy, time_scale,
+                           container_type);
+  });
+}
+
+void AsyncMuxerListener::OnSampleDurationReady(uint32_t sample_duration) {
+  MuxerListener* listener = listener_.get();
+  queue_->Post([=]() { listener->OnSampleDurationReady(sample_duration); });
+}
+
+void AsyncMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
+                                    float duration_seconds) {
+  MuxerListener* listener = listener_.get();
+  queue_->Post([=]() { listener->OnMediaEnd(media_ranges, duration_seconds); });
+  queue_->WaitForPostedEvents();
+}
+
+void AsyncMuxerListener::OnNewSegment(const std::string& segment_name,
+                                      int64_t start_time,
+                                      int64_t duration,
+                                      uint64_t segment_file_size) {
+  MuxerListener* listener = listener_.get();
+  queue_->Post([=]() {
+    listener->OnNewSegment(segment_name, start_time, duration,
+                           segment_file_size);
+  });
+}
+
+void AsyncMuxerListener::OnSegmentStats(const SegmentStats& segment_stats) {
+  MuxerListener* listener = listener_.get();
+  queue_->Post([=]() { listener->OnSegmentStats(segment_stats); });
+}
+
+void AsyncMuxerListener::OnNewChunk(const std::string& segment_name,
+                                    int64_t start_time,
+                                    int64_t duration,
+                                    uint64_t start_byte_offset,
+                                    uint64_t size) {
+  MuxerListener* listener = listener_.get();
+  queue_->Post([=]() {
+    listener->OnNewChunk(segment_name, start_time, duration, start_byte_offset,
+                         size);
+  });
+}
+
+void AsyncMuxerListener::OnKeyFrame(int64_t timestamp,
+                                    uint64_t start_byte_offset,
+                                    uint64_t size) {
+  MuxerListener* listener = listener_.get();
+  queue_->Post(
+      [=]() { listener->OnKeyFrame(timestamp, start_byte_offset, size); });
+}
+
+void AsyncMuxerListener::OnCueEvent(int64_t timestamp,
+                                    const std::string& cue_data) {
+  MuxerListener* listener = listener_.get();
+  queue_->Post([=]() { listener->OnCueEvent(timestamp, cue_data); });
+}
+
+}  // namespace media
+}  // namespace shaka
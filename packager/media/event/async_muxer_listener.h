@@ -0,0 +1,125 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_ASYNC_MUXER_LISTENER_H_
+#define PACKAGER_MEDIA_EVENT_ASYNC_MUXER_LISTENER_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+class TaskExecutor;
+
+/// A queue of the events of AsyncMuxerListeners, which are passed on to their
+/// listeners on a TaskExecutor, in the order they are posted, by one task at a
+/// time. The task takes the events posted while the previous one was running
+/// as a batch, so the muxers only contend for the queue to append their
+/// events. This class is thread safe.
+class MuxerListenerQueue {
+ public:
+  typedef std::function<void()> Event;
+
+  /// Passes the events on with TaskExecutor::GetInstance().
+  MuxerListenerQueue();
+  /// @param executor passes the events on. It must outlive the queue.
+  explicit MuxerListenerQueue(TaskExecutor* executor);
+  /// Waits for the events already posted to be passed on.
+  ~MuxerListenerQueue();
+
+  /// Post an event to be passed on by the executor.
+  void Post(Event event);
+
+  /// Wait for the events posted so far to be passed on. This must not be
+  /// called by the events.
+  void WaitForPostedEvents();
+
+ private:
+  MuxerListenerQueue(const MuxerListenerQueue&) = delete;
+  MuxerListenerQueue& operator=(const MuxerListenerQueue&) = delete;
+
+  // Post a task passing the events on. |lock_| must be held.
+  void PostPassOnTask();
+  // Passes the events posted so far on, which runs on |executor_|.
+  void PassEventsOn();
+
+  TaskExecutor* const executor_;
+  base::Lock lock_;
+  // Signaled when a batch of events has been passed on.
+  base::ConditionVariable events_passed_on_;
+  // The following are protected by |lock_|.
+  std::vector<Event> events_;
+  uint64_t num_posted_events_ = 0;
+  uint64_t num_passed_on_events_ = 0;
+  // Whether a task passing the events on is posted or running.
+  bool pass_on_task_posted_ = false;
+};
+
+/// AsyncMuxerListener passes the events of a muxer on to a listener through a
+/// MuxerListenerQueue, so that the muxer does not wait for the listener to
+/// update the manifests. The events keep their order. OnMediaEnd() waits for
+/// the events of the queue to be passed on, so the manifests are up to date
+/// once the muxers have ended.
+class AsyncMuxerListener : public MuxerListener {
+ public:
+  /// @param listener is the listener the events are passed on to.
+  /// @param queue is the queue passing the events on, which must outlive this
+  ///        object.
+  AsyncMuxerListener(std::unique_ptr<MuxerListener> listener,
+                     MuxerListenerQueue* queue);
+  /// Waits for the events posted to be passed on.
+  ~AsyncMuxerListener() override;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override;
+  void OnEncryptionStart() override;
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override;
+  void OnMediaEnd(const MediaRanges& media_ranges,
+                  float duration_seconds) override;
+  void OnNewSegment(const std::string& segment_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t segment_file_size) override;
+  void OnSegmentStats(const SegmentStats& segment_stats) override;
+  void OnNewChunk(const std::string& segment_name,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
+  void OnKeyFrame(int64_t timestamp,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
+  void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
+  /// @}
+
+ private:
+  AsyncMuxerListener(const AsyncMuxerListener&) = delete;
+  AsyncMuxerListener& operator=(const AsyncMuxerListener&) = delete;
+
+  std::unique_ptr<MuxerListener> listener_;
+  MuxerListenerQueue* const queue_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_ASYNC_MUXER_LISTENER_H_
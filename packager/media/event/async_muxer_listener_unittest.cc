@@ -0,0 +1,117 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/async_muxer_listener.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/event/mock_muxer_listener.h"
+#include "packager/media/event/muxer_listener_test_helper.h"
+
+namespace shaka {
+namespace media {
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Property;
+using ::testing::StrEq;
+using ::testing::StrictMock;
+
+namespace {
+
+const int64_t kSegmentStartTime = 19283;
+const int64_t kSegmentDuration = 98028;
+const uint64_t kSegmentSize = 756739;
+const uint32_t kTimescale = 90000;
+const int kNumSegments = 100;
+MuxerListener::ContainerType kContainer = MuxerListener::kContainerMp4;
+
+}  // namespace
+
+class AsyncMuxerListenerTest : public ::testing::Test {
+ protected:
+  AsyncMuxerListenerTest() {
+    std::unique_ptr<StrictMock<MockMuxerListener>> listener(
+        new StrictMock<MockMuxerListener>);
+    listener_ = listener.get();
+    async_listener_.reset(new AsyncMuxerListener(std::move(listener), &queue_));
+
+    video_stream_info_ =
+        CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+  }
+
+  MuxerListenerQueue queue_;
+  StrictMock<MockMuxerListener>* listener_;
+  std::unique_ptr<AsyncMuxerListener> async_listener_;
+  MuxerOptions muxer_options_;
+  std::shared_ptr<StreamInfo> video_stream_info_;
+};
+
+TEST_F(AsyncMuxerListenerTest, EventsInOrder) {
+  {
+    InSequence s;
+    EXPECT_CALL(*listener_,
+                OnMediaStart(_, Property(&StreamInfo::codec_string,
+                                         StrEq("codec")),
+                             kTimescale, kContainer));
+    for (int i = 0; i < kNumSegments; ++i) {
+      EXPECT_CALL(*listener_,
+                  OnNewSegment(StrEq("segment.mp4"),
+                               kSegmentStartTime + i * kSegmentDuration,
+                               kSegmentDuration, kSegmentSize));
+    }
+    EXPECT_CALL(*listener_, OnMediaEndMock(_, _, _, _, _, _, _, _, _));
+  }
+
+  video_stream_info_->set_codec_string("codec");
+  async_listener_->OnMediaStart(muxer_options_, *video_stream_info_,
+                                kTimescale, kContainer);
+  // The event has a copy of the stream info.
+  video_stream_info_->set_codec_string("changed_codec");
+  for (int i = 0; i < kNumSegments; ++i) {
+    async_listener_->OnNewSegment("segment.mp4",
+                                  kSegmentStartTime + i * kSegmentDuration,
+                                  kSegmentDuration, kSegmentSize);
+  }
+  async_listener_->OnMediaEnd(MuxerListener::MediaRanges(), 10.0f);
+}
+
+TEST_F(AsyncMuxerListenerTest, OnMediaEndWaitsForEvents) {
+  EXPECT_CALL(*listener_, OnMediaStart(_, _, _, _));
+  EXPECT_CALL(*listener_, OnNewSegment(_, _, _, _)).Times(kNumSegments);
+  EXPECT_CALL(*listener_, OnMediaEndMock(_, _, _, _, _, _, _, _, _));
+
+  async_listener_->OnMediaStart(muxer_options_, *video_stream_info_,
+                                kTimescale, kContainer);
+  for (int i = 0; i < kNumSegments; ++i) {
+    async_listener_->OnNewSegment("segment.mp4", kSegmentStartTime,
+                                  kSegmentDuration, kSegmentSize);
+  }
+  async_listener_->OnMediaEnd(MuxerListener::MediaRanges(), 10.0f);
+  // The events have been passed on once OnMediaEnd returns.
+  ::testing::Mock::VerifyAndClearExpectations(listener_);
+}
+
+TEST_F(AsyncMuxerListenerTest, ListenersShareQueue) {
+  std::unique_ptr<StrictMock<MockMuxerListener>> listener(
+      new StrictMock<MockMuxerListener>);
+  StrictMock<MockMuxerListener>* other_listener = listener.get();
+  AsyncMuxerListener other_async_listener(std::move(listener), &queue_);
+
+  EXPECT_CALL(*listener_, OnCueEvent(1, StrEq("first")));
+  EXPECT_CALL(*other_listener, OnCueEvent(2, StrEq("second")));
+
+  async_listener_->OnCueEvent(1, "first");
+  other_async_listener.OnCueEvent(2, "second");
+  queue_.WaitForPostedEvents();
+  ::testing::Mock::VerifyAndClearExpectations(listener_);
+  ::testing::Mock::VerifyAndClearExpectations(other_listener);
+}
+
+}  // namespace media
+}  // namespace shaka
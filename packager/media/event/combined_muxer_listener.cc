@@ -65,6 +65,23 @@ void CombinedMuxerListener::OnNewSegment(const std::string& file_name,
   }
 }
 
+void CombinedMuxerListener::OnSegmentStats(const SegmentStats& segment_stats) {
+  for (auto& listener : muxer_listeners_) {
+    listener->OnSegmentStats(segment_stats);
+  }
+}
+
+void CombinedMuxerListener::OnNewChunk(const std::string& segment_name,
+                                       int64_t start_time,
+                                       int64_t duration,
+                                       uint64_t start_byte_offset,
+                                       uint64_t size) {
+  for (auto& listener : muxer_listeners_) {
+    listener->OnNewChunk(segment_name, start_time, duration, start_byte_offset,
+                         size);
+  }
+}
+
 void CombinedMuxerListener::OnKeyFrame(int64_t timestamp,
                                        uint64_t start_byte_offset,
                                        uint64_t size) {
@@ -10,6 +10,7 @@
 #include "packager/base/logging.h"
 #include "packager/hls/base/hls_notifier.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/event/muxer_listener_internal.h"
 
@@ -111,6 +112,10 @@ void HlsNotifyMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
                  << ". The result manifest may not be playable.";
   }
   media_info_ = std::move(media_info);
+  if (muxer_options.segment_number_from_timeline) {
+    timeline_segment_duration_in_seconds_ =
+        muxer_options.segment_duration_in_seconds;
+  }
 
   if (!media_info_->has_segment_template()) {
     return;
@@ -235,6 +240,15 @@ void HlsNotifyMuxerListener::OnNewSegment(const std::string& file_name,
     event_info.segment_info = {start_time, duration, segment_file_size};
     event_info_.push_back(event_info);
   } else {
+    if (timeline_segment_duration_in_seconds_ > 0) {
+      const uint32_t segment_index = GetTimelineSegmentIndex(
+          timeline_segment_duration_in_seconds_, start_time,
+          media_info_->reference_time_scale());
+      LOG_IF(WARNING, !hls_notifier_->SetSequenceNumbers(stream_id_.value(),
+                                                         segment_index, 0))
+          << "Failed to set the media sequence number.";
+      timeline_segment_duration_in_seconds_ = 0;
+    }
     // For multisegment, it always starts from the beginning of the file.
     const size_t kStartingByteOffset = 0u;
     const bool result = hls_notifier_->NotifyNewSegment(
@@ -244,6 +258,21 @@ void HlsNotifyMuxerListener::OnNewSegment(const std::string& file_name,
   }
 }
 
+void HlsNotifyMuxerListener::OnNewChunk(const std::string& segment_name,
+                                        int64_t start_time,
+                                        int64_t duration,
+                                        uint64_t start_byte_offset,
+                                        uint64_t size) {
+  // Chunks are only written to segments from segment templates. I-Frames only
+  // playlists do not have partial segments.
+  if (!media_info_->has_segment_template() || iframes_only_)
+    return;
+  const bool result = hls_notifier_->NotifyNewPart(
+      stream_id_.value(), segment_name, start_time, duration,
+      start_byte_offset, size);
+  LOG_IF(WARNING, !result) << "Failed to add new part.";
+}
+
 void HlsNotifyMuxerListener::OnKeyFrame(int64_t timestamp,
                                         uint64_t start_byte_offset,
                                         uint64_t size) {
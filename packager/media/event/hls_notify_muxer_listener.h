@@ -68,6 +68,11 @@ class HlsNotifyMuxerListener : public MuxerListener {
                     int64_t start_time,
                     int64_t duration,
                     uint64_t segment_file_size) override;
+  void OnNewChunk(const std::string& segment_name,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
   void OnKeyFrame(int64_t timestamp, uint64_t start_byte_offset, uint64_t size);
   void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
   /// @}
@@ -96,6 +101,10 @@ class HlsNotifyMuxerListener : public MuxerListener {
   // MediaInfo passed to Notifier::OnNewStream(). Mainly for single segment
   // playlists.
   std::unique_ptr<MediaInfo> media_info_;
+  // The target segment duration if the media sequence number is still to be
+  // derived from the first segment, see
+  // MuxerOptions::segment_number_from_timeline.
+  double timeline_segment_duration_in_seconds_ = 0;
   // Even information for delayed function calls (NotifyNewSegment and
   // NotifyCueEvent) after NotifyNewStream is called in OnMediaEnd. Only needed
   // for on-demand as the functions are called immediately in live mode.
@@ -47,6 +47,13 @@ class MockHlsNotifier : public hls::HlsNotifier {
                     uint64_t duration,
                     uint64_t start_byte_offset,
                     uint64_t size));
+  MOCK_METHOD6(NotifyNewPart,
+               bool(uint32_t stream_id,
+                    const std::string& segment_name,
+                    uint64_t start_time,
+                    uint64_t duration,
+                    uint64_t start_byte_offset,
+                    uint64_t size));
   MOCK_METHOD4(NotifyKeyFrame,
                bool(uint32_t stream_id,
                     uint64_t timestamp,
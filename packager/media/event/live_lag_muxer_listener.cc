@@ -0,0 +1,52 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/live_lag_muxer_listener.h"
+
+#include "packager/base/logging.h"
+#include "packager/media/base/live_scheduler.h"
+
+namespace shaka {
+namespace media {
+
+LiveLagMuxerListener::LiveLagMuxerListener(
+    std::shared_ptr<LiveStreamLag> stream_lag)
+    : stream_lag_(std::move(stream_lag)) {
+  DCHECK(stream_lag_);
+}
+
+LiveLagMuxerListener::~LiveLagMuxerListener() {}
+
+void LiveLagMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
+                                        const StreamInfo& stream_info,
+                                        uint32_t time_scale,
+                                        ContainerType container_type) {
+  time_scale_ = time_scale;
+}
+
+void LiveLagMuxerListener::OnNewSegment(const std::string& segment_name,
+                                        int64_t start_time,
+                                        int64_t duration,
+                                        uint64_t segment_file_size) {
+  OnPublished(start_time + duration);
+}
+
+void LiveLagMuxerListener::OnNewChunk(const std::string& segment_name,
+                                      int64_t start_time,
+                                      int64_t duration,
+                                      uint64_t start_byte_offset,
+                                      uint64_t size) {
+  OnPublished(start_time + duration);
+}
+
+void LiveLagMuxerListener::OnPublished(int64_t end_time) {
+  if (time_scale_ == 0)
+    return;
+  stream_lag_->OnSegmentPublished(static_cast<double>(end_time) / time_scale_);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,72 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_LIVE_LAG_MUXER_LISTENER_H_
+#define PACKAGER_MEDIA_EVENT_LIVE_LAG_MUXER_LISTENER_H_
+
+#include <memory>
+
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+class LiveStreamLag;
+
+/// LiveLagMuxerListener reports the segments and the low latency chunks of a
+/// muxer to the LiveStreamLag of its stream as they are published, and
+/// ignores the other events.
+class LiveLagMuxerListener : public MuxerListener {
+ public:
+  explicit LiveLagMuxerListener(std::shared_ptr<LiveStreamLag> stream_lag);
+  ~LiveLagMuxerListener() override;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override {}
+  void OnEncryptionStart() override {}
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override {}
+  void OnMediaEnd(const MediaRanges& media_ranges,
+                  float duration_seconds) override {}
+  void OnNewSegment(const std::string& segment_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t segment_file_size) override;
+  void OnNewChunk(const std::string& segment_name,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
+  void OnKeyFrame(int64_t timestamp,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override {}
+  void OnCueEvent(int64_t timestamp, const std::string& cue_data) override {}
+  /// @}
+
+ private:
+  LiveLagMuxerListener(const LiveLagMuxerListener&) = delete;
+  LiveLagMuxerListener& operator=(const LiveLagMuxerListener&) = delete;
+
+  // Report the publication of media ending at |end_time|.
+  void OnPublished(int64_t end_time);
+
+  std::shared_ptr<LiveStreamLag> stream_lag_;
+  uint32_t time_scale_ = 0;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_LIVE_LAG_MUXER_LISTENER_H_
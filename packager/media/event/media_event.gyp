@@ -13,11 +13,15 @@
       'target_name': 'media_event',
       'type': '<(component)',
       'sources': [
+        'async_muxer_listener.cc',
+        'async_muxer_listener.h',
         'combined_muxer_listener.cc',
         'combined_muxer_listener.h',
         'event_info.h',
         'hls_notify_muxer_listener.cc',
         'hls_notify_muxer_listener.h',
+        'live_lag_muxer_listener.cc',
+        'live_lag_muxer_listener.h',
         'mpd_notify_muxer_listener.cc',
         'mpd_notify_muxer_listener.h',
         'multi_codec_muxer_listener.cc',
@@ -27,11 +31,16 @@
         'muxer_listener_factory.h',
         'muxer_listener_internal.cc',
         'muxer_listener_internal.h',
+        'segment_report_muxer_listener.cc',
+        'segment_report_muxer_listener.h',
+        'time_slice_muxer_listener.cc',
+        'time_slice_muxer_listener.h',
         'vod_media_info_dump_muxer_listener.cc',
         'vod_media_info_dump_muxer_listener.h',
       ],
       'dependencies': [
         '../../file/file.gyp:file',
+        '../../mpd/mpd.gyp:media_info_file',
         '../../mpd/mpd.gyp:media_info_proto',
         # Depends on full protobuf to read/write with TextFormat.
         '../../third_party/protobuf/protobuf.gyp:protobuf_full_do_not_use',
@@ -55,12 +64,15 @@
       'target_name': 'media_event_unittest',
       'type': '<(gtest_target_type)',
       'sources': [
+        'async_muxer_listener_unittest.cc',
         'hls_notify_muxer_listener_unittest.cc',
         'muxer_listener_internal_unittest.cc',
         'mpd_notify_muxer_listener_unittest.cc',
         'multi_codec_muxer_listener_unittest.cc',
         'muxer_listener_test_helper.cc',
         'muxer_listener_test_helper.h',
+        'segment_report_muxer_listener_unittest.cc',
+        'time_slice_muxer_listener_unittest.cc',
         'vod_media_info_dump_muxer_listener_unittest.cc',
       ],
       'dependencies': [
@@ -62,6 +62,13 @@ class MockMuxerListener : public MuxerListener {
                     int64_t duration,
                     uint64_t segment_file_size));
 
+  MOCK_METHOD5(OnNewChunk,
+               void(const std::string& segment_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t start_byte_offset,
+                    uint64_t size));
+
   MOCK_METHOD3(OnKeyFrame,
                void(int64_t timestamp,
                     uint64_t start_byte_offset,
@@ -10,6 +10,8 @@
 
 #include "packager/base/logging.h"
 #include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/event/muxer_listener_internal.h"
@@ -92,6 +94,10 @@ void MpdNotifyMuxerListener::OnMediaStart(
                  << "\nThe result manifest may not be playable.";
   }
   media_info_ = std::move(media_info);
+  if (muxer_options.segment_number_from_timeline) {
+    timeline_segment_duration_in_seconds_ =
+        muxer_options.segment_duration_in_seconds;
+  }
 
   if (mpd_notifier_->dash_profile() == DashProfile::kLive) {
     if (!NotifyNewContainer())
@@ -177,10 +183,19 @@ void MpdNotifyMuxerListener::OnNewSegment(const std::string& file_name,
                                           int64_t duration,
                                           uint64_t segment_file_size) {
   if (mpd_notifier_->dash_profile() == DashProfile::kLive) {
+    if (timeline_segment_duration_in_seconds_ > 0) {
+      const uint32_t segment_index = GetTimelineSegmentIndex(
+          timeline_segment_duration_in_seconds_, start_time,
+          media_info_->reference_time_scale());
+      LOG_IF(WARNING, !mpd_notifier_->SetStartNumber(notification_id_.value(),
+                                                     segment_index + 1))
+          << "Failed to set the start number.";
+      timeline_segment_duration_in_seconds_ = 0;
+    }
     mpd_notifier_->NotifyNewSegment(notification_id_.value(), start_time,
                                     duration, segment_file_size);
     if (mpd_notifier_->mpd_type() == MpdType::kDynamic)
-      mpd_notifier_->Flush();
+      mpd_notifier_->RequestFlush();
   } else {
     EventInfo event_info;
     event_info.type = EventInfoType::kSegment;
@@ -189,6 +204,14 @@ void MpdNotifyMuxerListener::OnNewSegment(const std::string& file_name,
   }
 }
 
+void MpdNotifyMuxerListener::OnNewChunk(const std::string& segment_name,
+                                        int64_t start_time,
+                                        int64_t duration,
+                                        uint64_t start_byte_offset,
+                                        uint64_t size) {
+  // NO-OP. The MPD only lists complete segments.
+}
+
 void MpdNotifyMuxerListener::OnKeyFrame(int64_t timestamp,
                                         uint64_t start_byte_offset,
                                         uint64_t size) {
@@ -51,6 +51,11 @@ class MpdNotifyMuxerListener : public MuxerListener {
                     int64_t start_time,
                     int64_t duration,
                     uint64_t segment_file_size) override;
+  void OnNewChunk(const std::string& segment_name,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
   void OnKeyFrame(int64_t timestamp, uint64_t start_byte_offset, uint64_t size);
   void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
   /// @}
@@ -70,6 +75,9 @@ class MpdNotifyMuxerListener : public MuxerListener {
   MpdNotifier* const mpd_notifier_ = nullptr;
   base::Optional<uint32_t> notification_id_;
   std::unique_ptr<MediaInfo> media_info_;
+  // The target segment duration if the startNumber is still to be derived
+  // from the first segment, see MuxerOptions::segment_number_from_timeline.
+  double timeline_segment_duration_in_seconds_ = 0;
 
   std::vector<std::string> accessibilities_;
   std::vector<std::string> roles_;
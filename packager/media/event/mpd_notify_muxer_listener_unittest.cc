@@ -393,12 +393,12 @@ TEST_P(MpdNotifyMuxerListenerTest, LiveNoKeyRotation) {
               NotifyNewSegment(_, kStartTime1, kDuration1, kSegmentFileSize1));
   // Flush should only be called once in OnMediaEnd.
   if (GetParam() == MpdType::kDynamic)
-    EXPECT_CALL(*notifier_, Flush());
+    EXPECT_CALL(*notifier_, RequestFlush());
   EXPECT_CALL(*notifier_, NotifyCueEvent(_, kStartTime2));
   EXPECT_CALL(*notifier_,
               NotifyNewSegment(_, kStartTime2, kDuration2, kSegmentFileSize2));
   if (GetParam() == MpdType::kDynamic)
-    EXPECT_CALL(*notifier_, Flush());
+    EXPECT_CALL(*notifier_, RequestFlush());
 
   std::vector<uint8_t> iv(kBogusIv, kBogusIv + arraysize(kBogusIv));
   listener_->OnEncryptionInfoReady(kInitialEncryptionInfo, FOURCC_cbcs,
@@ -466,11 +466,11 @@ TEST_P(MpdNotifyMuxerListenerTest, LiveWithKeyRotation) {
               NotifyNewSegment(_, kStartTime1, kDuration1, kSegmentFileSize1));
   // Flush should only be called once in OnMediaEnd.
   if (GetParam() == MpdType::kDynamic)
-    EXPECT_CALL(*notifier_, Flush());
+    EXPECT_CALL(*notifier_, RequestFlush());
   EXPECT_CALL(*notifier_,
               NotifyNewSegment(_, kStartTime2, kDuration2, kSegmentFileSize2));
   if (GetParam() == MpdType::kDynamic)
-    EXPECT_CALL(*notifier_, Flush());
+    EXPECT_CALL(*notifier_, RequestFlush());
 
   std::vector<uint8_t> iv(kBogusIv, kBogusIv + arraysize(kBogusIv));
   listener_->OnEncryptionInfoReady(kInitialEncryptionInfo, FOURCC_cbc1,
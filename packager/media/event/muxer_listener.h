@@ -54,6 +54,21 @@ class MuxerListener {
     std::vector<Range> subsegment_ranges;
   };
 
+  /// Statistics of the production of a segment, see OnSegmentStats().
+  struct SegmentStats {
+    /// Number of samples in the segment.
+    uint64_t num_samples = 0;
+    /// Time spent encrypting the samples of the segment, in microseconds.
+    int64_t encrypt_time_us = 0;
+    /// Time spent muxing the samples into the segment, excluding writes, in
+    /// microseconds.
+    int64_t serialize_time_us = 0;
+    /// Time spent writing the segment to its file, in microseconds. It does
+    /// not include the writes done on other threads, e.g. with
+    /// Mp4OutputParams::async_segment_write.
+    int64_t write_time_us = 0;
+  };
+
   virtual ~MuxerListener() = default;
 
   /// Called when the media's encryption information is ready.
@@ -129,6 +144,27 @@ class MuxerListener {
                             int64_t duration,
                             uint64_t segment_file_size) = 0;
 
+  /// Called right before OnNewSegment() with the statistics of the segment.
+  /// It is ignored by default.
+  /// @param segment_stats is how the segment was produced.
+  virtual void OnSegmentStats(const SegmentStats& segment_stats) {}
+
+  /// Called when a low latency chunk, i.e. a part of a segment, has been muxed
+  /// and written to the segment file, before the segment is complete.
+  /// OnNewSegment() is still called once the segment is complete.
+  /// @param segment_name is the name of the segment containing the chunk.
+  /// @param start_time is the start time of the chunk, relative to the
+  ///        timescale specified by MediaInfo passed to OnMediaStart().
+  /// @param duration is the duration of the chunk, relative to the timescale
+  ///        specified by MediaInfo passed to OnMediaStart().
+  /// @param start_byte_offset is the offset of the chunk in the segment.
+  /// @param size is the chunk size in bytes.
+  virtual void OnNewChunk(const std::string& segment_name,
+                          int64_t start_time,
+                          int64_t duration,
+                          uint64_t start_byte_offset,
+                          uint64_t size) = 0;
+
   /// Called when there is a new key frame. For Video only. Note that it should
   /// be called before OnNewSegment is called on the containing segment.
   /// @param timestamp is in terms of the timescale of the media.
@@ -11,6 +11,7 @@
 #include "packager/base/memory/ptr_util.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/hls/base/hls_notifier.h"
+#include "packager/media/event/async_muxer_listener.h"
 #include "packager/media/event/combined_muxer_listener.h"
 #include "packager/media/event/hls_notify_muxer_listener.h"
 #include "packager/media/event/mpd_notify_muxer_listener.h"
@@ -25,11 +26,18 @@ namespace {
 const char kMediaInfoSuffix[] = ".media_info";
 
 std::unique_ptr<MuxerListener> CreateMediaInfoDumpListenerInternal(
-    const std::string& output) {
-  DCHECK(!output.empty());
-
-  std::unique_ptr<MuxerListener> listener(
-      new VodMediaInfoDumpMuxerListener(output + kMediaInfoSuffix));
+    const MuxerListenerFactory::StreamData& stream,
+    MediaInfoFileFormat format) {
+  DCHECK(!stream.media_info_output.empty());
+
+  auto listener = base::MakeUnique<VodMediaInfoDumpMuxerListener>(
+      stream.media_info_output + kMediaInfoSuffix);
+  listener->set_format(format);
+  if (!stream.dash_only) {
+    listener->set_hls_playlist(stream.hls_playlist_name, stream.hls_name,
+                               stream.hls_group_id, stream.hls_characteristics);
+  }
+  listener->set_dash_attributes(stream.dash_accessiblities, stream.dash_roles);
   return listener;
 }
 
@@ -81,10 +89,12 @@ std::list<std::unique_ptr<MuxerListener>> CreateHlsListenersInternal(
 
 MuxerListenerFactory::MuxerListenerFactory(bool output_media_info,
                                            MpdNotifier* mpd_notifier,
-                                           hls::HlsNotifier* hls_notifier)
+                                           hls::HlsNotifier* hls_notifier,
+                                           MuxerListenerQueue* listener_queue)
     : output_media_info_(output_media_info),
       mpd_notifier_(mpd_notifier),
-      hls_notifier_(hls_notifier) {}
+      hls_notifier_(hls_notifier),
+      listener_queue_(listener_queue) {}
 
 std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateListener(
     const StreamData& stream) {
@@ -103,7 +113,7 @@ std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateListener(
         new CombinedMuxerListener);
     if (output_media_info_) {
       combined_listener->AddListener(
-          CreateMediaInfoDumpListenerInternal(stream.media_info_output));
+          CreateMediaInfoDumpListenerInternal(stream, media_info_format_));
     }
 
     if (mpd_notifier_ && !stream.hls_only) {
@@ -121,6 +131,10 @@ std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateListener(
     multi_codec_listener->AddListener(std::move(combined_listener));
   }
 
+  if (listener_queue_) {
+    return std::unique_ptr<MuxerListener>(new AsyncMuxerListener(
+        std::move(multi_codec_listener), listener_queue_));
+  }
   return std::move(multi_codec_listener);
 }
 
@@ -131,8 +145,13 @@ std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateHlsListener(
   }
 
   const int stream_index = stream_index_++;
-  return std::move(
+  std::unique_ptr<MuxerListener> listener = std::move(
       CreateHlsListenersInternal(stream, stream_index, hls_notifier_).front());
+  if (listener_queue_) {
+    listener.reset(
+        new AsyncMuxerListener(std::move(listener), listener_queue_));
+  }
+  return listener;
 }
 
 }  // namespace media
@@ -11,6 +11,8 @@
 #include <string>
 #include <vector>
 
+#include "packager/mpd/base/media_info_file.h"
+
 namespace shaka {
 class MpdNotifier;
 
@@ -20,6 +22,7 @@ class HlsNotifier;
 
 namespace media {
 class MuxerListener;
+class MuxerListenerQueue;
 
 /// Factory class for creating MuxerListeners. Will produce a single muxer
 /// listener that will wrap the various muxer listeners that the factory
@@ -62,9 +65,17 @@ class MuxerListenerFactory {
   ///        mpd listener.
   /// @param hls_notifier must be non-null for the combined listener to include
   ///        an HLS listener.
+  /// @param listener_queue, if not null, passes the events of the listeners
+  ///        on asynchronously, see AsyncMuxerListener.
   MuxerListenerFactory(bool output_media_info,
                        MpdNotifier* mpd_notifier,
-                       hls::HlsNotifier* hls_notifier);
+                       hls::HlsNotifier* hls_notifier,
+                       MuxerListenerQueue* listener_queue);
+
+  /// Set the format of the media info dumps, text by default.
+  void set_media_info_format(MediaInfoFileFormat format) {
+    media_info_format_ = format;
+  }
 
   /// Create a listener for a stream.
   std::unique_ptr<MuxerListener> CreateListener(const StreamData& stream);
@@ -73,13 +84,20 @@ class MuxerListenerFactory {
   /// create an HLS listener, this method will return null.
   std::unique_ptr<MuxerListener> CreateHlsListener(const StreamData& stream);
 
+  /// Reserve the index of a stream whose listeners are not created by this
+  /// factory, e.g. an output reused from a previous run, which names its HLS
+  /// playlist "stream_<index>.m3u8" if it has no playlist name.
+  int ReserveStreamIndex() { return stream_index_++; }
+
  private:
   MuxerListenerFactory(const MuxerListenerFactory&) = delete;
   MuxerListenerFactory operator=(const MuxerListenerFactory&) = delete;
 
   bool output_media_info_;
+  MediaInfoFileFormat media_info_format_ = MediaInfoFileFormat::kText;
   MpdNotifier* mpd_notifier_;
   hls::HlsNotifier* hls_notifier_;
+  MuxerListenerQueue* listener_queue_;
 
   // A counter to track which stream we are on.
   int stream_index_ = 0;
@@ -12,6 +12,7 @@
 #include <stdint.h>
 
 #include "packager/base/macros.h"
+#include "packager/media/public/stream_progress.h"
 
 namespace shaka {
 namespace media {
@@ -25,6 +26,11 @@ class ProgressListener {
   /// @param progress is the current progress metric, ranges from 0 to 1.
   virtual void OnProgress(double progress) = 0;
 
+  /// Called periodically with the throughput of the stream, and once it is
+  /// complete, by the demuxers and the muxers. It is ignored by default.
+  /// @param progress is the progress of the stream so far.
+  virtual void OnStreamProgress(const StreamProgress& progress) {}
+
  protected:
   ProgressListener() {}
 
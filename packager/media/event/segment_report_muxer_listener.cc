@@ -0,0 +1,95 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/segment_report_muxer_listener.h"
+
+#include <inttypes.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+std::string EscapeJson(const std::string& value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '"' || c == '\\')
+      escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+}  // namespace
+
+SegmentReportMuxerListener::SegmentReportMuxerListener(
+    const std::string& report_file_name)
+    : report_file_name_(report_file_name) {}
+
+SegmentReportMuxerListener::~SegmentReportMuxerListener() {
+  if (report_file_ && !report_file_->Close())
+    LOG(ERROR) << "Failed to close segment report " << report_file_name_;
+}
+
+void SegmentReportMuxerListener::OnMediaStart(
+    const MuxerOptions& muxer_options,
+    const StreamInfo& stream_info,
+    uint32_t time_scale,
+    ContainerType container_type) {
+  time_scale_ = time_scale;
+  // The muxer is restarted on ad cues in some modes, which continues the
+  // report.
+  if (report_file_ || failed_)
+    return;
+  report_file_ = File::Open(report_file_name_.c_str(), "w");
+  if (!report_file_) {
+    LOG(ERROR) << "Failed to open segment report " << report_file_name_;
+    failed_ = true;
+  }
+}
+
+void SegmentReportMuxerListener::OnSegmentStats(
+    const SegmentStats& segment_stats) {
+  segment_stats_ = segment_stats;
+}
+
+void SegmentReportMuxerListener::OnNewSegment(const std::string& segment_name,
+                                              int64_t start_time,
+                                              int64_t duration,
+                                              uint64_t segment_file_size) {
+  const SegmentStats segment_stats = segment_stats_;
+  segment_stats_ = SegmentStats();
+  if (!report_file_)
+    return;
+
+  const int64_t publish_time_ms =
+      (base::Time::Now() - base::Time::UnixEpoch()).InMilliseconds();
+  const std::string line = base::StringPrintf(
+      "{\"segment\":\"%s\",\"start_pts\":%" PRId64 ",\"duration\":%" PRId64
+      ",\"time_scale\":%u,\"bytes\":%" PRIu64 ",\"samples\":%" PRIu64
+      ",\"encrypt_time_us\":%" PRId64 ",\"serialize_time_us\":%" PRId64
+      ",\"write_time_us\":%" PRId64 ",\"publish_time_ms\":%" PRId64 "}\n",
+      EscapeJson(segment_name).c_str(), start_time, duration, time_scale_,
+      segment_file_size, segment_stats.num_samples,
+      segment_stats.encrypt_time_us, segment_stats.serialize_time_us,
+      segment_stats.write_time_us, publish_time_ms);
+  // Flushed so that the report of a live stream can be followed.
+  if (report_file_->Write(line.data(), line.size()) !=
+          static_cast<int64_t>(line.size()) ||
+      !report_file_->Flush()) {
+    LOG(ERROR) << "Failed to write segment report " << report_file_name_;
+    report_file_->Close();
+    report_file_ = nullptr;
+    failed_ = true;
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,89 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_SEGMENT_REPORT_MUXER_LISTENER_H_
+#define PACKAGER_MEDIA_EVENT_SEGMENT_REPORT_MUXER_LISTENER_H_
+
+#include <string>
+
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+
+class File;
+
+namespace media {
+
+/// SegmentReportMuxerListener writes a JSON line per segment of a muxer to a
+/// report file, with the timing and the size of the segment:
+///
+///     {"segment":"video_1.m4s","start_pts":0,"duration":180000,
+///      "time_scale":90000,"bytes":1048576,"samples":60,
+///      "encrypt_time_us":1200,"serialize_time_us":800,"write_time_us":300,
+///      "publish_time_ms":1577836802000}
+///
+/// The publish time is the wall clock time, in milliseconds since the Unix
+/// epoch, at which the listener is notified of the segment, i.e. after the
+/// listeners before it in a CombinedMuxerListener. The other events are
+/// ignored.
+class SegmentReportMuxerListener : public MuxerListener {
+ public:
+  /// @param report_file_name is the file the report is written to. It is
+  ///        overwritten.
+  explicit SegmentReportMuxerListener(const std::string& report_file_name);
+  ~SegmentReportMuxerListener() override;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override {}
+  void OnEncryptionStart() override {}
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override {}
+  void OnMediaEnd(const MediaRanges& media_ranges,
+                  float duration_seconds) override {}
+  void OnNewSegment(const std::string& segment_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t segment_file_size) override;
+  void OnSegmentStats(const SegmentStats& segment_stats) override;
+  void OnNewChunk(const std::string& segment_name,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override {}
+  void OnKeyFrame(int64_t timestamp,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override {}
+  void OnCueEvent(int64_t timestamp, const std::string& cue_data) override {}
+  /// @}
+
+ private:
+  SegmentReportMuxerListener(const SegmentReportMuxerListener&) = delete;
+  SegmentReportMuxerListener& operator=(const SegmentReportMuxerListener&) =
+      delete;
+
+  const std::string report_file_name_;
+  File* report_file_ = nullptr;
+  // Set if the report file could not be opened or written, after which the
+  // segments are not reported.
+  bool failed_ = false;
+  uint32_t time_scale_ = 0;
+  // The statistics of the next segment.
+  SegmentStats segment_stats_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_SEGMENT_REPORT_MUXER_LISTENER_H_
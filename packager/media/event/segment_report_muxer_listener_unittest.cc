@@ -0,0 +1,86 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/segment_report_muxer_listener.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/event/muxer_listener_test_helper.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kReportFileName[] = "memory://segments.jsonl";
+const uint32_t kTimescale = 90000;
+const int64_t kSegmentDuration = 180000;
+const uint64_t kSegmentSize = 1000;
+
+}  // namespace
+
+class SegmentReportMuxerListenerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    listener_.reset(new SegmentReportMuxerListener(kReportFileName));
+    std::shared_ptr<StreamInfo> stream_info =
+        CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+    listener_->OnMediaStart(MuxerOptions(), *stream_info, kTimescale,
+                            MuxerListener::kContainerMp4);
+  }
+
+  std::string ReadReport() {
+    // The report is complete once the listener is destroyed.
+    listener_.reset();
+    std::string report;
+    EXPECT_TRUE(File::ReadFileToString(kReportFileName, &report));
+    return report;
+  }
+
+  std::unique_ptr<SegmentReportMuxerListener> listener_;
+};
+
+TEST_F(SegmentReportMuxerListenerTest, ReportsSegments) {
+  MuxerListener::SegmentStats segment_stats;
+  segment_stats.num_samples = 60;
+  segment_stats.encrypt_time_us = 1200;
+  segment_stats.serialize_time_us = 800;
+  segment_stats.write_time_us = 300;
+  listener_->OnSegmentStats(segment_stats);
+  listener_->OnNewSegment("video_1.m4s", 0, kSegmentDuration, kSegmentSize);
+  // A segment without statistics.
+  listener_->OnNewSegment("video_2.m4s", kSegmentDuration, kSegmentDuration,
+                          kSegmentSize);
+
+  const std::string report = ReadReport();
+  const size_t first_line_end = report.find('\n');
+  ASSERT_NE(std::string::npos, first_line_end);
+  const std::string first_line = report.substr(0, first_line_end);
+  EXPECT_EQ(0u, first_line.find(
+                    "{\"segment\":\"video_1.m4s\",\"start_pts\":0,"
+                    "\"duration\":180000,\"time_scale\":90000,\"bytes\":1000,"
+                    "\"samples\":60,\"encrypt_time_us\":1200,"
+                    "\"serialize_time_us\":800,\"write_time_us\":300,"
+                    "\"publish_time_ms\":"));
+  const std::string second_line = report.substr(first_line_end + 1);
+  EXPECT_EQ(0u, second_line.find(
+                    "{\"segment\":\"video_2.m4s\",\"start_pts\":180000,"
+                    "\"duration\":180000,\"time_scale\":90000,\"bytes\":1000,"
+                    "\"samples\":0,\"encrypt_time_us\":0,"
+                    "\"serialize_time_us\":0,\"write_time_us\":0,"));
+  // One line per segment.
+  EXPECT_EQ(second_line.size() - 1, second_line.find('\n'));
+}
+
+TEST_F(SegmentReportMuxerListenerTest, IgnoresChunks) {
+  listener_->OnNewChunk("video_1.m4s", 0, kSegmentDuration / 2, 0,
+                        kSegmentSize);
+  EXPECT_EQ("", ReadReport());
+}
+
+}  // namespace media
+}  // namespace shaka
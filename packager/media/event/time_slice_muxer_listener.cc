@@ -0,0 +1,200 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/time_slice_muxer_listener.h"
+
+#include <functional>
+
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+namespace media {
+
+// Passes the events of the slices on to the listener of the stream, in the
+// order of the slices.
+class TimeSliceMuxerListener::Joiner {
+ public:
+  typedef std::function<void(MuxerListener*)> Event;
+
+  Joiner(std::unique_ptr<MuxerListener> listener, size_t num_slices)
+      : listener_(std::move(listener)), slices_(num_slices) {}
+
+  // Pass |event| of slice |slice_index| on, or hold it back until the
+  // previous slices have ended.
+  void AddEvent(size_t slice_index, Event event) {
+    base::AutoLock auto_lock(lock_);
+    if (slice_index == current_slice_)
+      event(listener_.get());
+    else
+      slices_[slice_index].events.push_back(std::move(event));
+  }
+
+  // Pass an event of the first slice on, which the first slice sends before
+  // it ends, so that it is never held back.
+  void AddFirstSliceEvent(size_t slice_index, const Event& event) {
+    if (slice_index != 0)
+      return;
+    base::AutoLock auto_lock(lock_);
+    DCHECK_EQ(0u, current_slice_);
+    event(listener_.get());
+  }
+
+  void EndSlice(size_t slice_index,
+                const MediaRanges& media_ranges,
+                float duration_seconds) {
+    base::AutoLock auto_lock(lock_);
+    Slice& slice = slices_[slice_index];
+    slice.ended = true;
+    slice.media_ranges = media_ranges;
+    slice.duration_seconds = duration_seconds;
+
+    while (current_slice_ < slices_.size() && slices_[current_slice_].ended) {
+      if (++current_slice_ == slices_.size()) {
+        EndMedia();
+        return;
+      }
+      std::vector<Event> events;
+      events.swap(slices_[current_slice_].events);
+      for (const Event& event : events)
+        event(listener_.get());
+    }
+  }
+
+ private:
+  Joiner(const Joiner&) = delete;
+  Joiner& operator=(const Joiner&) = delete;
+
+  struct Slice {
+    // The events held back until the previous slices have ended.
+    std::vector<Event> events;
+    bool ended = false;
+    MediaRanges media_ranges;
+    float duration_seconds = 0;
+  };
+
+  void EndMedia() {
+    MediaRanges media_ranges = slices_.front().media_ranges;
+    float duration_seconds = 0;
+    for (size_t i = 0; i < slices_.size(); ++i) {
+      duration_seconds += slices_[i].duration_seconds;
+      if (i == 0)
+        continue;
+      const std::vector<Range>& ranges =
+          slices_[i].media_ranges.subsegment_ranges;
+      media_ranges.subsegment_ranges.insert(
+          media_ranges.subsegment_ranges.end(), ranges.begin(), ranges.end());
+    }
+    listener_->OnMediaEnd(media_ranges, duration_seconds);
+  }
+
+  base::Lock lock_;
+  std::unique_ptr<MuxerListener> listener_;
+  std::vector<Slice> slices_;
+  // The slice whose events are passed on as they come.
+  size_t current_slice_ = 0;
+};
+
+std::vector<std::unique_ptr<MuxerListener>>
+TimeSliceMuxerListener::CreateSliceListeners(
+    std::unique_ptr<MuxerListener> listener,
+    size_t num_slices) {
+  std::shared_ptr<Joiner> joiner =
+      std::make_shared<Joiner>(std::move(listener), num_slices);
+  std::vector<std::unique_ptr<MuxerListener>> slice_listeners;
+  for (size_t i = 0; i < num_slices; ++i)
+    slice_listeners.emplace_back(new TimeSliceMuxerListener(joiner, i));
+  return slice_listeners;
+}
+
+TimeSliceMuxerListener::TimeSliceMuxerListener(std::shared_ptr<Joiner> joiner,
+                                               size_t slice_index)
+    : joiner_(std::move(joiner)), slice_index_(slice_index) {}
+
+TimeSliceMuxerListener::~TimeSliceMuxerListener() {}
+
+void TimeSliceMuxerListener::OnEncryptionInfoReady(
+    bool is_initial_encryption_info,
+    FourCC protection_scheme,
+    const std::vector<uint8_t>& key_id,
+    const std::vector<uint8_t>& iv,
+    const std::vector<ProtectionSystemSpecificInfo>& key_system_info) {
+  // Only the initial encryption info of the first slice is the initial one of
+  // the stream.
+  if (is_initial_encryption_info && slice_index_ > 0)
+    return;
+  joiner_->AddEvent(slice_index_, [=](MuxerListener* listener) {
+    listener->OnEncryptionInfoReady(is_initial_encryption_info,
+                                    protection_scheme, key_id, iv,
+                                    key_system_info);
+  });
+}
+
+void TimeSliceMuxerListener::OnEncryptionStart() {
+  joiner_->AddFirstSliceEvent(slice_index_, [](MuxerListener* listener) {
+    listener->OnEncryptionStart();
+  });
+}
+
+void TimeSliceMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
+                                          const StreamInfo& stream_info,
+                                          uint32_t time_scale,
+                                          ContainerType container_type) {
+  joiner_->AddFirstSliceEvent(slice_index_, [&](MuxerListener* listener) {
+    listener->OnMediaStart(muxer_options, stream_info, time_scale,
+                           container_type);
+  });
+}
+
+void TimeSliceMuxerListener::OnSampleDurationReady(uint32_t sample_duration) {
+  joiner_->AddFirstSliceEvent(slice_index_, [=](MuxerListener* listener) {
+    listener->OnSampleDurationReady(sample_duration);
+  });
+}
+
+void TimeSliceMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
+                                        float duration_seconds) {
+  joiner_->EndSlice(slice_index_, media_ranges, duration_seconds);
+}
+
+void TimeSliceMuxerListener::OnNewSegment(const std::string& segment_name,
+                                          int64_t start_time,
+                                          int64_t duration,
+                                          uint64_t segment_file_size) {
+  joiner_->AddEvent(slice_index_, [=](MuxerListener* listener) {
+    listener->OnNewSegment(segment_name, start_time, duration,
+                           segment_file_size);
+  });
+}
+
+void TimeSliceMuxerListener::OnNewChunk(const std::string& segment_name,
+                                        int64_t start_time,
+                                        int64_t duration,
+                                        uint64_t start_byte_offset,
+                                        uint64_t size) {
+  joiner_->AddEvent(slice_index_, [=](MuxerListener* listener) {
+    listener->OnNewChunk(segment_name, start_time, duration, start_byte_offset,
+                         size);
+  });
+}
+
+void TimeSliceMuxerListener::OnKeyFrame(int64_t timestamp,
+                                        uint64_t start_byte_offset,
+                                        uint64_t size) {
+  joiner_->AddEvent(slice_index_, [=](MuxerListener* listener) {
+    listener->OnKeyFrame(timestamp, start_byte_offset, size);
+  });
+}
+
+void TimeSliceMuxerListener::OnCueEvent(int64_t timestamp,
+                                        const std::string& cue_data) {
+  joiner_->AddEvent(slice_index_, [=](MuxerListener* listener) {
+    listener->OnCueEvent(timestamp, cue_data);
+  });
+}
+
+}  // namespace media
+}  // namespace shaka
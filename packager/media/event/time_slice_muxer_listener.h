@@ -0,0 +1,81 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_TIME_SLICE_MUXER_LISTENER_H_
+#define PACKAGER_MEDIA_EVENT_TIME_SLICE_MUXER_LISTENER_H_
+
+#include <memory>
+#include <vector>
+
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+/// TimeSliceMuxerListener is the listener of the muxer of a time slice of a
+/// stream, the slices of the stream being muxed in parallel. The listeners of
+/// the slices join their events into the events of a single muxer for the
+/// listener of the stream: the events of a slice are held back until the
+/// previous slices have ended, the media starts with the first slice and ends
+/// once all the slices have ended.
+class TimeSliceMuxerListener : public MuxerListener {
+ public:
+  /// Create the listeners of the slices of a stream.
+  /// @param listener is the listener of the stream.
+  /// @param num_slices is the number of slices.
+  /// @return the listeners of the slices, in the order of the slices.
+  static std::vector<std::unique_ptr<MuxerListener>> CreateSliceListeners(
+      std::unique_ptr<MuxerListener> listener,
+      size_t num_slices);
+
+  ~TimeSliceMuxerListener() override;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override;
+  void OnEncryptionStart() override;
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override;
+  void OnMediaEnd(const MediaRanges& media_ranges,
+                  float duration_seconds) override;
+  void OnNewSegment(const std::string& segment_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t segment_file_size) override;
+  void OnNewChunk(const std::string& segment_name,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
+  void OnKeyFrame(int64_t timestamp,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
+  void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
+  /// @}
+
+ private:
+  class Joiner;
+
+  TimeSliceMuxerListener(std::shared_ptr<Joiner> joiner, size_t slice_index);
+  TimeSliceMuxerListener(const TimeSliceMuxerListener&) = delete;
+  TimeSliceMuxerListener& operator=(const TimeSliceMuxerListener&) = delete;
+
+  std::shared_ptr<Joiner> joiner_;
+  const size_t slice_index_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_TIME_SLICE_MUXER_LISTENER_H_
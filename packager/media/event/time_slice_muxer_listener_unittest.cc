@@ -0,0 +1,109 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/time_slice_muxer_listener.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/event/mock_muxer_listener.h"
+#include "packager/media/event/muxer_listener_test_helper.h"
+
+namespace shaka {
+namespace media {
+
+using ::testing::_;
+using ::testing::FloatEq;
+using ::testing::InSequence;
+using ::testing::StrictMock;
+
+namespace {
+
+const uint32_t kTimescale = 90000;
+const int64_t kSegmentDuration = 180000;
+const uint64_t kSegmentSize = 1000;
+const size_t kNumSlices = 3;
+MuxerListener::ContainerType kContainer = MuxerListener::kContainerMp4;
+
+}  // namespace
+
+class TimeSliceMuxerListenerTest : public ::testing::Test {
+ protected:
+  TimeSliceMuxerListenerTest() {
+    std::unique_ptr<StrictMock<MockMuxerListener>> listener(
+        new StrictMock<MockMuxerListener>);
+    listener_ = listener.get();
+    slice_listeners_ = TimeSliceMuxerListener::CreateSliceListeners(
+        std::move(listener), kNumSlices);
+
+    muxer_options_.segment_template = "$Number$.m4s";
+    stream_info_ = CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+  }
+
+  // Mux segment |segment_index| in slice |slice_index|.
+  void MuxSegment(size_t slice_index, int64_t segment_index) {
+    slice_listeners_[slice_index]->OnNewSegment(
+        SegmentName(segment_index), segment_index * kSegmentDuration,
+        kSegmentDuration, kSegmentSize);
+  }
+
+  void ExpectSegment(int64_t segment_index) {
+    EXPECT_CALL(*listener_,
+                OnNewSegment(SegmentName(segment_index),
+                             segment_index * kSegmentDuration,
+                             kSegmentDuration, kSegmentSize));
+  }
+
+  std::string SegmentName(int64_t segment_index) {
+    return std::to_string(segment_index + 1) + ".m4s";
+  }
+
+  void EndSlice(size_t slice_index) {
+    slice_listeners_[slice_index]->OnMediaEnd(MuxerListener::MediaRanges(),
+                                              1.0f);
+  }
+
+  StrictMock<MockMuxerListener>* listener_;
+  std::vector<std::unique_ptr<MuxerListener>> slice_listeners_;
+  MuxerOptions muxer_options_;
+  std::shared_ptr<StreamInfo> stream_info_;
+};
+
+TEST_F(TimeSliceMuxerListenerTest, JoinsSlicesInOrder) {
+  {
+    InSequence s;
+    EXPECT_CALL(*listener_, OnMediaStart(_, _, kTimescale, kContainer));
+    EXPECT_CALL(*listener_, OnSampleDurationReady(3000));
+    for (int64_t segment_index = 0; segment_index < 6; ++segment_index)
+      ExpectSegment(segment_index);
+    EXPECT_CALL(*listener_,
+                OnMediaEndMock(false, _, _, false, _, _, false, _,
+                               FloatEq(3.0f)));
+  }
+
+  // The slices start at the same time, but only the first one starts the
+  // media.
+  for (const auto& slice_listener : slice_listeners_) {
+    slice_listener->OnMediaStart(muxer_options_, *stream_info_, kTimescale,
+                                 kContainer);
+    slice_listener->OnSampleDurationReady(3000);
+  }
+  // The segments of the last slices are held back until the first slice has
+  // ended.
+  MuxSegment(2, 4);
+  MuxSegment(1, 2);
+  MuxSegment(0, 0);
+  MuxSegment(2, 5);
+  EndSlice(2);
+  MuxSegment(1, 3);
+  MuxSegment(0, 1);
+  EndSlice(0);
+  EndSlice(1);
+}
+
+}  // namespace media
+}  // namespace shaka
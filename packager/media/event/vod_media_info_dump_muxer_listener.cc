@@ -6,12 +6,9 @@
 
 #include "packager/media/event/vod_media_info_dump_muxer_listener.h"
 
-#include <google/protobuf/text_format.h>
-
 #include <cmath>
 
 #include "packager/base/logging.h"
-#include "packager/file/file.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/stream_info.h"
@@ -38,6 +35,7 @@ void VodMediaInfoDumpMuxerListener::OnEncryptionInfoReady(
          "this module.";
   protection_scheme_ = protection_scheme;
   default_key_id_ = default_key_id;
+  iv_ = iv;
   key_system_info_ = key_system_info;
   is_encrypted_ = true;
 }
@@ -47,7 +45,6 @@ void VodMediaInfoDumpMuxerListener::OnMediaStart(
     const StreamInfo& stream_info,
     uint32_t time_scale,
     ContainerType container_type) {
-  DCHECK(muxer_options.segment_template.empty());
   media_info_.reset(new MediaInfo());
   if (!internal::GenerateMediaInfo(muxer_options,
                                    stream_info,
@@ -62,6 +59,29 @@ void VodMediaInfoDumpMuxerListener::OnMediaStart(
     internal::SetContentProtectionFields(protection_scheme_, default_key_id_,
                                          key_system_info_, media_info_.get());
   }
+
+  if (muxer_options.num_time_shards > 0) {
+    media_info_->set_time_shard_index(muxer_options.time_shard_index);
+    media_info_->set_num_time_shards(muxer_options.num_time_shards);
+  }
+  if (media_info_->has_segment_template()) {
+    if (is_encrypted_ && !iv_.empty()) {
+      media_info_->mutable_protected_content()->set_iv(iv_.data(),
+                                                       iv_.size());
+    }
+    if (!hls_playlist_name_.empty())
+      media_info_->set_hls_playlist_name(hls_playlist_name_);
+    if (!hls_name_.empty())
+      media_info_->set_hls_name(hls_name_);
+    if (!hls_group_id_.empty())
+      media_info_->set_hls_group_id(hls_group_id_);
+    for (const std::string& characteristic : hls_characteristics_)
+      media_info_->add_hls_characteristics(characteristic);
+    for (const std::string& accessibility : dash_accessibilities_)
+      media_info_->add_dash_accessibilities(accessibility);
+    for (const std::string& role : dash_roles_)
+      media_info_->add_dash_roles(role);
+  }
 }
 
 void VodMediaInfoDumpMuxerListener::OnEncryptionStart() {}
@@ -77,6 +97,15 @@ void VodMediaInfoDumpMuxerListener::OnSampleDurationReady(
 void VodMediaInfoDumpMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
                                                float duration_seconds) {
   DCHECK(media_info_);
+  if (media_info_->segments_size() > 0) {
+    // Not every muxer knows the duration of the segmented media, e.g. the
+    // MPEG-2 TS muxer, or the muxer of a time shard.
+    int64_t duration = 0;
+    for (const MediaInfo::Segment& segment : media_info_->segments())
+      duration += segment.duration();
+    duration_seconds =
+        static_cast<float>(duration) / media_info_->reference_time_scale();
+  }
   if (!internal::SetVodInformation(media_ranges, duration_seconds,
                                    media_info_.get())) {
     LOG(ERROR) << "Failed to generate VOD information from input.";
@@ -84,13 +113,21 @@ void VodMediaInfoDumpMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
   }
   if (!media_info_->has_bandwidth())
     media_info_->set_bandwidth(max_bitrate_);
-  WriteMediaInfoToFile(*media_info_, output_file_name_);
+  WriteMediaInfoToFile(*media_info_, output_file_name_, format_);
 }
 
 void VodMediaInfoDumpMuxerListener::OnNewSegment(const std::string& file_name,
                                                  int64_t start_time,
                                                  int64_t duration,
                                                  uint64_t segment_file_size) {
+  if (media_info_->has_segment_template()) {
+    MediaInfo::Segment* segment = media_info_->add_segments();
+    segment->set_name(file_name);
+    segment->set_start_time(start_time);
+    segment->set_duration(duration);
+    segment->set_size(segment_file_size);
+  }
+
   const double segment_duration_seconds =
       static_cast<double>(duration) / media_info_->reference_time_scale();
 
@@ -100,6 +137,12 @@ void VodMediaInfoDumpMuxerListener::OnNewSegment(const std::string& file_name,
   max_bitrate_ = std::max(max_bitrate_, bitrate);
 }
 
+void VodMediaInfoDumpMuxerListener::OnNewChunk(const std::string& segment_name,
+                                               int64_t start_time,
+                                               int64_t duration,
+                                               uint64_t start_byte_offset,
+                                               uint64_t size) {}
+
 void VodMediaInfoDumpMuxerListener::OnKeyFrame(int64_t timestamp,
                                                uint64_t start_byte_offset,
                                                uint64_t size) {}
@@ -112,29 +155,9 @@ void VodMediaInfoDumpMuxerListener::OnCueEvent(int64_t timestamp,
 // static
 bool VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
     const MediaInfo& media_info,
-    const std::string& output_file_path) {
-  std::string output_string;
-  if (!google::protobuf::TextFormat::PrintToString(media_info,
-                                                   &output_string)) {
-    LOG(ERROR) << "Failed to serialize MediaInfo to string.";
-    return false;
-  }
-
-  File* file = File::Open(output_file_path.c_str(), "w");
-  if (!file) {
-    LOG(ERROR) << "Failed to open " << output_file_path;
-    return false;
-  }
-  if (file->Write(output_string.data(), output_string.size()) <= 0) {
-    LOG(ERROR) << "Failed to write MediaInfo to file.";
-    file->Close();
-    return false;
-  }
-  if (!file->Close()) {
-    LOG(ERROR) << "Failed to close " << output_file_path;
-    return false;
-  }
-  return true;
+    const std::string& output_file_path,
+    MediaInfoFileFormat format) {
+  return WriteMediaInfoFile(media_info, output_file_path, format);
 }
 
 }  // namespace media
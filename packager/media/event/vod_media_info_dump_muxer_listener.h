@@ -6,7 +6,9 @@
 //
 // Implementation of MuxerListener that converts the info to a MediaInfo
 // protobuf and dumps it to a file.
-// This is specifically for VOD.
+// This is specifically for VOD. The segments of segment template outputs are
+// recorded in the MediaInfo, so that the manifests of streams packaged on
+// many machines can be generated from their MediaInfo files.
 
 #ifndef PACKAGER_MEDIA_EVENT_VOD_MEDIA_INFO_DUMP_MUXER_LISTENER_H_
 #define PACKAGER_MEDIA_EVENT_VOD_MEDIA_INFO_DUMP_MUXER_LISTENER_H_
@@ -18,6 +20,7 @@
 #include "packager/base/macros.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/event/muxer_listener.h"
+#include "packager/mpd/base/media_info_file.h"
 
 namespace shaka {
 
@@ -50,21 +53,53 @@ class VodMediaInfoDumpMuxerListener : public MuxerListener {
                     int64_t start_time,
                     int64_t duration,
                     uint64_t segment_file_size) override;
+  void OnNewChunk(const std::string& segment_name,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
   void OnKeyFrame(int64_t timestamp, uint64_t start_byte_offset, uint64_t size);
   void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
   /// @}
 
-  /// Write @a media_info to @a output_file_path in human readable format.
+  /// Set the HLS playlist of the stream, recorded with the segments of segment
+  /// template outputs so that the HLS playlists can be generated from the
+  /// MediaInfo. Empty values are not recorded.
+  void set_hls_playlist(const std::string& playlist_name,
+                        const std::string& name,
+                        const std::string& group_id,
+                        const std::vector<std::string>& characteristics) {
+    hls_playlist_name_ = playlist_name;
+    hls_name_ = name;
+    hls_group_id_ = group_id;
+    hls_characteristics_ = characteristics;
+  }
+
+  /// Set the DASH accessibilities and roles of the stream, recorded with the
+  /// segments of segment template outputs.
+  void set_dash_attributes(const std::vector<std::string>& accessibilities,
+                           const std::vector<std::string>& roles) {
+    dash_accessibilities_ = accessibilities;
+    dash_roles_ = roles;
+  }
+
+  /// Set the format of the MediaInfo file, human readable text by default.
+  void set_format(MediaInfoFileFormat format) { format_ = format; }
+
+  /// Write @a media_info to @a output_file_path in @a format.
   /// @param media_info is the MediaInfo to write out.
   /// @param output_file_path is the path of the output file.
+  /// @param format is the format of the output file.
   /// @return true on success, false otherwise.
   // TODO(rkuroiwa): Move this to muxer_listener_internal and rename
   // muxer_listener_internal to muxer_listener_util.
   static bool WriteMediaInfoToFile(const MediaInfo& media_info,
-                                   const std::string& output_file_path);
+                                   const std::string& output_file_path,
+                                   MediaInfoFileFormat format);
 
  private:
   std::string output_file_name_;
+  MediaInfoFileFormat format_ = MediaInfoFileFormat::kText;
   std::unique_ptr<MediaInfo> media_info_;
   uint64_t max_bitrate_ = 0;
 
@@ -72,8 +107,16 @@ class VodMediaInfoDumpMuxerListener : public MuxerListener {
   // Storage for values passed to OnEncryptionInfoReady().
   FourCC protection_scheme_;
   std::vector<uint8_t> default_key_id_;
+  std::vector<uint8_t> iv_;
   std::vector<ProtectionSystemSpecificInfo> key_system_info_;
 
+  std::string hls_playlist_name_;
+  std::string hls_name_;
+  std::string hls_group_id_;
+  std::vector<std::string> hls_characteristics_;
+  std::vector<std::string> dash_accessibilities_;
+  std::vector<std::string> dash_roles_;
+
   DISALLOW_COPY_AND_ASSIGN(VodMediaInfoDumpMuxerListener);
 };
 
@@ -274,5 +274,60 @@ TEST_F(VodMediaInfoDumpMuxerListenerTest, CheckBandwidth) {
               FileContentEqualsProto(kExpectedProtobufOutput));
 }
 
+// Verify that the segments of a segment template output are recorded, with
+// the time shard and the HLS playlist of the stream.
+TEST_F(VodMediaInfoDumpMuxerListenerTest, SegmentTemplateTimeShard) {
+  std::shared_ptr<StreamInfo> stream_info =
+      CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+  listener_->set_hls_playlist("video.m3u8", "video", "", {});
+
+  MuxerOptions muxer_options;
+  muxer_options.output_file_name = "init.mp4";
+  muxer_options.segment_template = "seg_$Number$.m4s";
+  muxer_options.time_shard_index = 1;
+  muxer_options.num_time_shards = 4;
+  const uint32_t kReferenceTimeScale = 1000;
+  listener_->OnMediaStart(muxer_options, *stream_info, kReferenceTimeScale,
+                          MuxerListener::kContainerMp4);
+  listener_->OnNewSegment("seg_3.m4s", 4000, 1000, 100);
+  listener_->OnNewSegment("seg_4.m4s", 5000, 1000, 200);
+  // The duration of a time shard is not known to its muxer.
+  listener_->OnMediaEnd(MuxerListener::MediaRanges(), 0);
+
+  const char kExpectedProtobufOutput[] =
+      "bandwidth: 1600\n"
+      "video_info {\n"
+      "  codec: 'avc1.010101'\n"
+      "  width: 720\n"
+      "  height: 480\n"
+      "  time_scale: 10\n"
+      "  pixel_width: 1\n"
+      "  pixel_height: 1\n"
+      "}\n"
+      "reference_time_scale: 1000\n"
+      "container_type: 1\n"
+      "init_segment_name: 'init.mp4'\n"
+      "segment_template: 'seg_$Number$.m4s'\n"
+      "media_duration_seconds: 2\n"
+      "segments {\n"
+      "  name: 'seg_3.m4s'\n"
+      "  start_time: 4000\n"
+      "  duration: 1000\n"
+      "  size: 100\n"
+      "}\n"
+      "segments {\n"
+      "  name: 'seg_4.m4s'\n"
+      "  start_time: 5000\n"
+      "  duration: 1000\n"
+      "  size: 200\n"
+      "}\n"
+      "time_shard_index: 1\n"
+      "num_time_shards: 4\n"
+      "hls_playlist_name: 'video.m3u8'\n"
+      "hls_name: 'video'\n";
+  EXPECT_THAT(temp_file_path_.AsUTF8Unsafe(),
+              FileContentEqualsProto(kExpectedProtobufOutput));
+}
+
 }  // namespace media
 }  // namespace shaka
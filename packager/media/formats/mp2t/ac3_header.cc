@@ -6,6 +6,8 @@
 
 #include "packager/media/formats/mp2t/ac3_header.h"
 
+#include <string.h>
+
 #include "packager/media/base/bit_reader.h"
 #include "packager/media/base/bit_writer.h"
 #include "packager/media/formats/mp2t/mp2t_common.h"
@@ -61,6 +63,10 @@ bool Ac3Header::IsSyncWord(const uint8_t* buf) const {
   return buf[0] == 0x0B && buf[1] == 0x77;
 }
 
+uint8_t Ac3Header::GetSyncWordFirstByte() const {
+  return 0x0B;
+}
+
 size_t Ac3Header::GetMinFrameSize() const {
   // Arbitrary. Actual frame size starts with 96 words.
   const size_t kMinAc3FrameSize = 10u;
@@ -75,6 +81,17 @@ size_t Ac3Header::GetSamplesPerFrame() const {
 }
 
 bool Ac3Header::Parse(const uint8_t* audio_frame, size_t audio_frame_size) {
+  // The fields are read from the 4 bytes after the syncword and the CRC.
+  const size_t kHeaderOffset = 4;
+  if (has_last_header_ &&
+      audio_frame_size >= kHeaderOffset + sizeof(last_header_) &&
+      IsSyncWord(audio_frame) &&
+      memcmp(audio_frame + kHeaderOffset, last_header_,
+             sizeof(last_header_)) == 0) {
+    return true;
+  }
+  has_last_header_ = false;
+
   BitReader frame(audio_frame, audio_frame_size);
 
   // ASTC Standard A/52:2012 5. BIT STREAM SYNTAX.
@@ -107,6 +124,10 @@ bool Ac3Header::Parse(const uint8_t* audio_frame, size_t audio_frame_size) {
 
   RCHECK(frame.ReadBits(1, &lfeon_));
 
+  if (audio_frame_size >= kHeaderOffset + sizeof(last_header_)) {
+    memcpy(last_header_, audio_frame + kHeaderOffset, sizeof(last_header_));
+    has_last_header_ = true;
+  }
   return true;
 }
 
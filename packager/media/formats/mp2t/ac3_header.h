@@ -27,6 +27,7 @@ class Ac3Header : public AudioHeader {
   /// @name AudioHeader implementation overrides.
   /// @{
   bool IsSyncWord(const uint8_t* buf) const override;
+  uint8_t GetSyncWordFirstByte() const override;
   size_t GetMinFrameSize() const override;
   size_t GetSamplesPerFrame() const override;
   bool Parse(const uint8_t* adts_frame, size_t adts_frame_size) override;
@@ -50,6 +51,10 @@ class Ac3Header : public AudioHeader {
   uint8_t bsmod_ = 0;       // Bit stream mode
   uint8_t acmod_ = 0;       // Audio coding mode
   uint8_t lfeon_ = 0;       // Low frequency effects channel on
+  // The bytes after the syncinfo CRC of the last frame parsed, which hold
+  // every field above and which the next frames usually share.
+  bool has_last_header_ = false;
+  uint8_t last_header_[4] = {};
 };
 
 }  // namespace mp2t
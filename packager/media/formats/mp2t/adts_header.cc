@@ -6,6 +6,8 @@
 
 #include "packager/media/formats/mp2t/adts_header.h"
 
+#include <string.h>
+
 #include "packager/media/base/bit_reader.h"
 #include "packager/media/base/bit_writer.h"
 #include "packager/media/formats/mp2t/mp2t_common.h"
@@ -34,6 +36,10 @@ bool AdtsHeader::IsSyncWord(const uint8_t* buf) const {
   return (buf[0] == 0xff) && ((buf[1] & 0xf6) == 0xf0);
 }
 
+uint8_t AdtsHeader::GetSyncWordFirstByte() const {
+  return 0xff;
+}
+
 size_t AdtsHeader::GetMinFrameSize() const {
   return kAdtsHeaderMinSize + 1;
 }
@@ -49,6 +55,17 @@ bool AdtsHeader::Parse(const uint8_t* adts_frame, size_t adts_frame_size) {
   if (adts_frame_size < kAdtsHeaderMinSize)
     return false;
 
+  // Only the frame size of the variable header changes if the fixed header is
+  // the one of the previous frame. |num_blocks_minus_1| must still be 0.
+  if (has_fixed_header_ && memcmp(adts_frame, fixed_header_, 3) == 0 &&
+      (adts_frame[3] & 0xf0) == fixed_header_[3] &&
+      (adts_frame[6] & 0x03) == 0) {
+    frame_size_ = static_cast<uint16_t>(
+        GetFrameSizeWithoutParsing(adts_frame, adts_frame_size));
+    return true;
+  }
+  has_fixed_header_ = false;
+
   BitReader frame(adts_frame, adts_frame_size);
   // Verify frame starts with sync bits (0xfff).
   uint32_t sync;
@@ -76,6 +93,10 @@ bool AdtsHeader::Parse(const uint8_t* adts_frame, size_t adts_frame_size) {
                         "not supported.";
     return false;
   }
+
+  memcpy(fixed_header_, adts_frame, 3);
+  fixed_header_[3] = adts_frame[3] & 0xf0;
+  has_fixed_header_ = true;
   return true;
 }
 
@@ -27,6 +27,7 @@ class AdtsHeader : public AudioHeader {
   /// @name AudioHeader implementation overrides.
   /// @{
   bool IsSyncWord(const uint8_t* buf) const override;
+  uint8_t GetSyncWordFirstByte() const override;
   size_t GetMinFrameSize() const override;
   size_t GetSamplesPerFrame() const override;
   bool Parse(const uint8_t* adts_frame, size_t adts_frame_size) override;
@@ -49,6 +50,10 @@ class AdtsHeader : public AudioHeader {
   uint8_t profile_ = 0;
   uint8_t sampling_frequency_index_ = 0;
   uint8_t channel_configuration_ = 0;
+  // The fixed header of the last frame parsed, i.e. its first 28 bits, see
+  // ISO/IEC 13818-7 6.2.1, which the next frames usually share.
+  bool has_fixed_header_ = false;
+  uint8_t fixed_header_[4] = {};
 };
 
 }  // namespace mp2t
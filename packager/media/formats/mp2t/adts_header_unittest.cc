@@ -90,6 +90,31 @@ TEST_F(AdtsHeaderTest, ParseVariousDataSize) {
   EXPECT_FALSE(adts_header.Parse(adts_frame_.data(), header_size - 1));
 }
 
+TEST_F(AdtsHeaderTest, ParseConsecutiveFrames) {
+  AdtsHeader adts_header;
+  ASSERT_TRUE(adts_header.Parse(adts_frame_.data(), adts_frame_.size()));
+
+  // A frame with the same fixed header and another frame length.
+  std::vector<uint8_t> next_frame = adts_frame_;
+  const size_t kNextFrameSize = 100;
+  next_frame[3] = (next_frame[3] & 0xfc) | (kNextFrameSize >> 11);
+  next_frame[4] = (kNextFrameSize >> 3) & 0xff;
+  next_frame[5] = (next_frame[5] & 0x1f) | ((kNextFrameSize & 0x07) << 5);
+  ASSERT_TRUE(adts_header.Parse(next_frame.data(), next_frame.size()));
+  EXPECT_EQ(kNextFrameSize, adts_header.GetFrameSize());
+  EXPECT_EQ(2u, adts_header.GetNumChannels());
+
+  // A frame with another channel configuration is parsed again.
+  next_frame[3] = (next_frame[3] & 0x3f) | (1 << 6);
+  next_frame[2] &= 0xfe;
+  ASSERT_TRUE(adts_header.Parse(next_frame.data(), next_frame.size()));
+  EXPECT_EQ(1u, adts_header.GetNumChannels());
+
+  // Invalid sampling frequency indexes are still rejected.
+  next_frame[2] |= 0x3c;
+  EXPECT_FALSE(adts_header.Parse(next_frame.data(), next_frame.size()));
+}
+
 }  // Namespace mp2t
 }  // namespace media
 }  // namespace shaka
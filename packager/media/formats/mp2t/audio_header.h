@@ -26,6 +26,10 @@ class AudioHeader {
   /// @return true if corresponds to a syncword.
   virtual bool IsSyncWord(const uint8_t* buf) const = 0;
 
+  /// @return The first byte of the syncword, which is the same in every frame,
+  ///         so that syncword candidates can be found with memchr().
+  virtual uint8_t GetSyncWordFirstByte() const = 0;
+
   /// @return The minium frame size.
   virtual size_t GetMinFrameSize() const = 0;
 
@@ -34,7 +38,9 @@ class AudioHeader {
 
   /// Parse a partial audio frame, extracting the fields within. Only audio
   /// frame header / metadata is parsed. The audio_frame_size must contain the
-  /// full header / metadata.
+  /// full header / metadata. The fields which determine the configuration of
+  /// the stream are only validated again if they differ from the ones of the
+  /// previous successful Parse, as they rarely change between frames.
   /// @param audio_frame is an input parameter pointing to an audio frame.
   /// @param audio_frame_size is the size, in bytes of the input data. It can be
   ///        smaller than the actual frame size, but it should not be smaller
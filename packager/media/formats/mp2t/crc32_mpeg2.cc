@@ -0,0 +1,66 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/crc32_mpeg2.h"
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+const uint32_t kCrcPolynomial = 0x04c11db7;
+const size_t kNumTables = 8;
+
+// Slicing-by-8 tables: table[k][b] is the CRC of byte b followed by k zero
+// bytes, so the CRCs of the 8 bytes of a word are looked up independently.
+class CrcTables {
+ public:
+  CrcTables() {
+    for (uint32_t b = 0; b < 256; ++b) {
+      uint32_t crc = b << 24;
+      for (int bit = 0; bit < 8; ++bit)
+        crc = (crc & 0x80000000) ? (crc << 1) ^ kCrcPolynomial : crc << 1;
+      table_[0][b] = crc;
+    }
+    for (size_t k = 1; k < kNumTables; ++k) {
+      for (size_t b = 0; b < 256; ++b) {
+        const uint32_t crc = table_[k - 1][b];
+        table_[k][b] = (crc << 8) ^ table_[0][crc >> 24];
+      }
+    }
+  }
+
+  const uint32_t* operator[](size_t k) const { return table_[k]; }
+
+ private:
+  uint32_t table_[kNumTables][256];
+};
+
+}  // namespace
+
+uint32_t Crc32Mpeg2(const uint8_t* data, size_t data_size) {
+  // Computed once, on first use, which is thread safe.
+  static const CrcTables tables;
+
+  uint32_t crc = 0xFFFFFFFF;
+  for (; data_size >= kNumTables; data += kNumTables, data_size -= kNumTables) {
+    crc ^= (static_cast<uint32_t>(data[0]) << 24) |
+           (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | data[3];
+    crc = tables[7][crc >> 24] ^ tables[6][(crc >> 16) & 0xFF] ^
+          tables[5][(crc >> 8) & 0xFF] ^ tables[4][crc & 0xFF] ^
+          tables[3][data[4]] ^ tables[2][data[5]] ^ tables[1][data[6]] ^
+          tables[0][data[7]];
+  }
+  for (size_t i = 0; i < data_size; ++i)
+    crc = tables[0][((crc >> 24) ^ data[i]) & 0xFF] ^ (crc << 8);
+  return crc;
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,29 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_FORMATS_MP2T_CRC32_MPEG2_H_
+#define PACKAGER_MEDIA_FORMATS_MP2T_CRC32_MPEG2_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+/// Compute the CRC32/MPEG2 of @a data, i.e. the CRC_32 field of the PSI
+/// sections, 8 bytes at a time.
+/// @param data points to the bytes to checksum.
+/// @param data_size is the number of bytes in @a data.
+/// @return The CRC of @a data. The CRC of a whole section, including its
+///         CRC_32 field, is 0 if the section is valid.
+uint32_t Crc32Mpeg2(const uint8_t* data, size_t data_size);
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_FORMATS_MP2T_CRC32_MPEG2_H_
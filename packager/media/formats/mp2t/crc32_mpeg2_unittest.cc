@@ -0,0 +1,63 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/crc32_mpeg2.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+// The bit by bit computation, from the spec.
+uint32_t BitwiseCrc32Mpeg2(const uint8_t* data, size_t data_size) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < data_size; ++i) {
+    crc ^= static_cast<uint32_t>(data[i]) << 24;
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+  return crc;
+}
+
+}  // namespace
+
+TEST(Crc32Mpeg2Test, CheckValue) {
+  const uint8_t kData[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  EXPECT_EQ(0x0376E6E7u, Crc32Mpeg2(kData, sizeof(kData)));
+}
+
+TEST(Crc32Mpeg2Test, MatchesBitwiseComputation) {
+  std::vector<uint8_t> data(100);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint8_t>(i * 37 + 11);
+  for (size_t size = 0; size <= data.size(); ++size) {
+    EXPECT_EQ(BitwiseCrc32Mpeg2(data.data(), size),
+              Crc32Mpeg2(data.data(), size))
+        << "size " << size;
+  }
+}
+
+TEST(Crc32Mpeg2Test, SectionWithCrcIsZero) {
+  // A PAT with program 1 in PID 0x20.
+  const uint8_t kPat[] = {0x00, 0xB0, 0x0D, 0x00, 0x00, 0xC1, 0x00, 0x00,
+                          0x00, 0x01, 0xE0, 0x20, 0x00, 0x00, 0x00, 0x00};
+  std::vector<uint8_t> pat(std::begin(kPat), std::end(kPat));
+  const uint32_t crc = Crc32Mpeg2(pat.data(), pat.size() - 4);
+  pat[12] = static_cast<uint8_t>(crc >> 24);
+  pat[13] = static_cast<uint8_t>(crc >> 16);
+  pat[14] = static_cast<uint8_t>(crc >> 8);
+  pat[15] = static_cast<uint8_t>(crc);
+  EXPECT_EQ(0u, Crc32Mpeg2(pat.data(), pat.size()));
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
@@ -5,6 +5,7 @@
 #include "packager/media/formats/mp2t/es_parser_audio.h"
 
 #include <stdint.h>
+#include <string.h>
 
 #include <algorithm>
 #include <list>
@@ -54,8 +55,15 @@ static bool LookForSyncWord(const uint8_t* raw_es,
     return false;
   }
 
+  const uint8_t sync_word_first_byte = audio_header->GetSyncWordFirstByte();
   for (int offset = pos; offset < max_offset; offset++) {
-    const uint8_t* cur_buf = &raw_es[offset];
+    // memchr() skips the bytes which cannot start a syncword with vector
+    // instructions of the C library.
+    const uint8_t* cur_buf = static_cast<const uint8_t*>(
+        memchr(&raw_es[offset], sync_word_first_byte, max_offset - offset));
+    if (!cur_buf)
+      break;
+    offset = static_cast<int>(cur_buf - raw_es);
 
     if (!audio_header->IsSyncWord(cur_buf))
       continue;
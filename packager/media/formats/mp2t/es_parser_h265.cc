@@ -54,20 +54,26 @@ bool EsParserH265::ProcessNalu(const Nalu& nalu,
     }
     case Nalu::H265_SPS: {
       DVLOG(LOG_LEVEL_ES) << "Nalu: SPS";
+      if (IsRepeatedParameterSet(nalu))
+        break;
       int sps_id;
       if (h265_parser_->ParseSps(nalu, &sps_id) != H265Parser::kOk)
         return false;
+      RememberParameterSet(nalu, true);
       decoder_config_check_pending_ = true;
       break;
     }
     case Nalu::H265_PPS: {
       DVLOG(LOG_LEVEL_ES) << "Nalu: PPS";
+      if (IsRepeatedParameterSet(nalu))
+        break;
       int pps_id;
       if (h265_parser_->ParsePps(nalu, &pps_id) != H265Parser::kOk) {
         // Allow PPS parsing to fail if waiting for SPS.
         if (last_video_decoder_config_)
           return false;
       } else {
+        RememberParameterSet(nalu, false);
         decoder_config_check_pending_ = true;
       }
       break;
@@ -5,6 +5,7 @@
 #include "packager/media/formats/mp2t/es_parser_h26x.h"
 
 #include <stdint.h>
+#include <string.h>
 
 #include "packager/base/logging.h"
 #include "packager/base/numerics/safe_conversions.h"
@@ -118,6 +119,23 @@ void EsParserH26x::Reset() {
   pending_sample_ = std::shared_ptr<MediaSample>();
   pending_sample_duration_ = 0;
   waiting_for_key_frame_ = true;
+  last_parameter_sets_.clear();
+}
+
+bool EsParserH26x::IsRepeatedParameterSet(const Nalu& nalu) const {
+  auto iter = last_parameter_sets_.find(nalu.type());
+  if (iter == last_parameter_sets_.end())
+    return false;
+  const size_t nalu_size = nalu.header_size() + nalu.payload_size();
+  return iter->second.size() == nalu_size &&
+         memcmp(iter->second.data(), nalu.data(), nalu_size) == 0;
+}
+
+void EsParserH26x::RememberParameterSet(const Nalu& nalu, bool is_sps) {
+  if (is_sps)
+    last_parameter_sets_.clear();
+  last_parameter_sets_[nalu.type()].assign(
+      nalu.data(), nalu.data() + nalu.header_size() + nalu.payload_size());
 }
 
 bool EsParserH26x::SearchForNalu(uint64_t* position, Nalu* nalu) {
@@ -295,16 +313,24 @@ bool EsParserH26x::EmitFrame(int64_t access_unit_pos,
                       << current_timing_desc.pts << " timing_desc_list size "
                       << timing_desc_list_.size();
   int es_size;
-  const uint8_t* es;
+  uint8_t* es;
   es_queue_->PeekAt(access_unit_pos, &es, &es_size);
 
-  // Convert frame to unit stream format.
-  std::vector<uint8_t> converted_frame;
-  if (!stream_converter_->ConvertByteStreamToNalUnitStream(
-          es, access_unit_size, &converted_frame)) {
+  // Convert frame to unit stream format, in the ES queue if possible as the
+  // access unit is not parsed again.
+  uint8_t* converted_frame;
+  size_t converted_frame_size;
+  std::vector<uint8_t> converted_frame_copy;
+  if (!stream_converter_->ConvertByteStreamToNalUnitStreamInPlace(
+          es, access_unit_size, &converted_frame, &converted_frame_size,
+          &converted_frame_copy)) {
     DLOG(ERROR) << "Failure to convert video frame to unit stream format.";
     return false;
   }
+  if (!converted_frame) {
+    converted_frame = converted_frame_copy.data();
+    converted_frame_size = converted_frame_copy.size();
+  }
 
   // Update the video decoder configuration if needed.
   RCHECK(UpdateVideoDecoderConfig(pps_id));
@@ -312,7 +338,7 @@ bool EsParserH26x::EmitFrame(int64_t access_unit_pos,
   // Create the media sample, emitting always the previous sample after
   // calculating its duration.
   std::shared_ptr<MediaSample> media_sample = MediaSample::CopyFrom(
-      converted_frame.data(), converted_frame.size(), is_key_frame);
+      converted_frame, converted_frame_size, is_key_frame);
   media_sample->set_dts(current_timing_desc.dts);
   media_sample->set_pts(current_timing_desc.pts);
   if (pending_sample_) {
@@ -9,7 +9,9 @@
 
 #include <deque>
 #include <list>
+#include <map>
 #include <memory>
+#include <vector>
 
 #include "packager/base/callback.h"
 #include "packager/base/compiler_specific.h"
@@ -52,6 +54,15 @@ class EsParserH26x : public EsParser {
     return stream_converter_.get();
   }
 
+  // Returns true if |nalu| is the same as the last parameter set NAL unit of
+  // its type which was parsed, see RememberParameterSet(). Encoders usually
+  // repeat the parameter sets before every key frame, which then need to be
+  // neither parsed again nor checked for a decoder configuration change.
+  bool IsRepeatedParameterSet(const Nalu& nalu) const;
+  // Remembers |nalu|, which was parsed successfully. A new SPS makes the PPSes
+  // be parsed again, as they may depend on it.
+  void RememberParameterSet(const Nalu& nalu, bool is_sps);
+
  private:
   struct TimingDesc {
     int64_t dts;
@@ -131,6 +142,9 @@ class EsParserH26x : public EsParser {
 
   // Indicates whether waiting for first key frame.
   bool waiting_for_key_frame_ = true;
+
+  // The last parameter set NAL unit of each type, by NAL unit type.
+  std::map<int, std::vector<uint8_t>> last_parameter_sets_;
 };
 
 }  // namespace mp2t
@@ -87,6 +87,9 @@ class TestableEsParser : public EsParserH26x {
         new_stream_info_cb_(new_stream_info_cb),
         decoder_config_check_pending_(false) {}
 
+  using EsParserH26x::IsRepeatedParameterSet;
+  using EsParserH26x::RememberParameterSet;
+
   bool ProcessNalu(const Nalu& nalu,
                    VideoSliceInfo* video_slice_info) override {
     if (codec_type_ == Nalu::kH264 ? (nalu.type() == Nalu::H264_SPS)
@@ -453,6 +456,34 @@ TEST_F(EsParserH26xTest, H264DoesNotStartOnRsv) {
   EXPECT_TRUE(has_stream_info_);
 }
 
+TEST_F(EsParserH26xTest, RepeatedParameterSets) {
+  const uint8_t kSps[] = {0x67, 0x64, 0x00, 0x1f};
+  const uint8_t kOtherSps[] = {0x67, 0x4d, 0x00, 0x1f};
+  const uint8_t kPps[] = {0x68, 0xeb, 0xe3};
+  Nalu sps;
+  Nalu other_sps;
+  Nalu pps;
+  ASSERT_TRUE(sps.Initialize(Nalu::kH264, kSps, arraysize(kSps)));
+  ASSERT_TRUE(
+      other_sps.Initialize(Nalu::kH264, kOtherSps, arraysize(kOtherSps)));
+  ASSERT_TRUE(pps.Initialize(Nalu::kH264, kPps, arraysize(kPps)));
+
+  TestableEsParser es_parser(Nalu::kH264, NewStreamInfoCB(), EmitSampleCB());
+  EXPECT_FALSE(es_parser.IsRepeatedParameterSet(sps));
+  es_parser.RememberParameterSet(sps, true);
+  es_parser.RememberParameterSet(pps, false);
+  EXPECT_TRUE(es_parser.IsRepeatedParameterSet(sps));
+  EXPECT_TRUE(es_parser.IsRepeatedParameterSet(pps));
+
+  // A new SPS makes the PPS be parsed again.
+  EXPECT_FALSE(es_parser.IsRepeatedParameterSet(other_sps));
+  es_parser.RememberParameterSet(other_sps, true);
+  EXPECT_FALSE(es_parser.IsRepeatedParameterSet(pps));
+
+  es_parser.Reset();
+  EXPECT_FALSE(es_parser.IsRepeatedParameterSet(other_sps));
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
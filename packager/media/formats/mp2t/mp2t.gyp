@@ -20,6 +20,8 @@
         'audio_header.h',
         'continuity_counter.cc',
         'continuity_counter.h',
+        'crc32_mpeg2.cc',
+        'crc32_mpeg2.h',
         'es_parser_audio.cc',
         'es_parser_audio.h',
         'es_parser_h264.cc',
@@ -60,6 +62,7 @@
         'ts_writer.h',
       ],
       'dependencies': [
+        '../../../metrics/metrics.gyp:metrics',
         '../../base/media_base.gyp:media_base',
         '../../crypto/crypto.gyp:crypto',
         '../../codecs/codecs.gyp:codecs',
@@ -71,12 +74,15 @@
       'sources': [
         'ac3_header_unittest.cc',
         'adts_header_unittest.cc',
+        'crc32_mpeg2_unittest.cc',
         'es_parser_h264_unittest.cc',
         'es_parser_h26x_unittest.cc',
         'mp2t_media_parser_unittest.cc',
         'mpeg1_header_unittest.cc',
         'pes_packet_generator_unittest.cc',
         'program_map_table_writer_unittest.cc',
+        'ts_section_pes_unittest.cc',
+        'ts_section_psi_unittest.cc',
         'ts_segmenter_unittest.cc',
         'ts_writer_unittest.cc',
       ],
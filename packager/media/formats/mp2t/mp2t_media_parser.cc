@@ -4,6 +4,7 @@
 
 #include "packager/media/formats/mp2t/mp2t_media_parser.h"
 
+#include <algorithm>
 #include <memory>
 #include "packager/base/bind.h"
 #include "packager/media/base/media_sample.h"
@@ -24,6 +25,10 @@ namespace shaka {
 namespace media {
 namespace mp2t {
 
+namespace {
+const uint8_t kTsHeaderSyncword = 0x47;
+}  // namespace
+
 class PidState {
  public:
   enum PidType {
@@ -144,7 +149,10 @@ void PidState::ResetState() {
 
 Mp2tMediaParser::Mp2tMediaParser()
     : sbr_in_mimetype_(false),
-      is_initialized_(false) {
+      pid_table_(TsSection::kPidMax + 1),
+      is_initialized_(false),
+      tracks_selected_(false),
+      track_selection_pending_(false) {
 }
 
 Mp2tMediaParser::~Mp2tMediaParser() {}
@@ -171,8 +179,11 @@ bool Mp2tMediaParser::Flush() {
     PidState* pid_state = pair.second.get();
     pid_state->Flush();
   }
+  if (track_selection_pending_)
+    ApplyTrackSelection();
   bool result = EmitRemainingSamples();
   pids_.clear();
+  std::fill(pid_table_.begin(), pid_table_.end(), nullptr);
 
   // Remove any bytes left in the TS buffer.
   // (i.e. any partial TS packet => less than 188 bytes).
@@ -183,9 +194,122 @@ bool Mp2tMediaParser::Flush() {
 bool Mp2tMediaParser::Parse(const uint8_t* buf, int size) {
   DVLOG(1) << "Mp2tMediaParser::Parse size=" << size;
 
-  // Add the data to the parser state.
+  // Complete the partial TS packet left from the previous call first.
+  const uint8_t* ts_buffer;
+  int ts_buffer_size;
+  ts_byte_queue_.Peek(&ts_buffer, &ts_buffer_size);
+  if (ts_buffer_size > 0) {
+    DCHECK_LT(ts_buffer_size, TsPacket::kPacketSize);
+    const int bytes_to_push =
+        std::min(size, TsPacket::kPacketSize - ts_buffer_size);
+    ts_byte_queue_.Push(buf, bytes_to_push);
+    buf += bytes_to_push;
+    size -= bytes_to_push;
+    if (!ProcessQueuedTsPackets())
+      return false;
+    ts_byte_queue_.Peek(&ts_buffer, &ts_buffer_size);
+  }
+
+  // Fast path: the TS packets aligned on a syncword are processed in place,
+  // without going through |ts_byte_queue_|.
+  if (ts_buffer_size == 0) {
+    while (size >= TsPacket::kPacketSize && buf[0] == kTsHeaderSyncword) {
+      bool is_valid = false;
+      if (!ProcessTsPacket(buf, &is_valid))
+        return false;
+      // Let the slow path resynchronize.
+      if (!is_valid)
+        break;
+      buf += TsPacket::kPacketSize;
+      size -= TsPacket::kPacketSize;
+    }
+  }
+
+  // Add the remaining data to the parser state.
   ts_byte_queue_.Push(buf, size);
+  if (!ProcessQueuedTsPackets())
+    return false;
+
+  // The tracks may have been selected while parsing the last TS packet.
+  if (track_selection_pending_)
+    ApplyTrackSelection();
+
+  // Emit the A/V buffers that kept accumulating during TS parsing.
+  return EmitRemainingSamples();
+}
+
+void Mp2tMediaParser::SelectTracks(const std::set<uint32_t>& track_ids) {
+  tracks_selected_ = true;
+  track_selection_pending_ = true;
+  selected_track_ids_ = track_ids;
+}
+
+void Mp2tMediaParser::AddPidState(int pid,
+                                  std::unique_ptr<PidState> pid_state) {
+  auto result = pids_.insert(
+      std::pair<int, std::unique_ptr<PidState>>(pid, std::move(pid_state)));
+  if (result.second)
+    pid_table_[pid] = result.first->second.get();
+}
+
+void Mp2tMediaParser::ApplyTrackSelection() {
+  track_selection_pending_ = false;
+  for (const auto& pair : pids_) {
+    PidState* pid_state = pair.second.get();
+    if ((pid_state->pid_type() == PidState::kPidAudioPes ||
+         pid_state->pid_type() == PidState::kPidVideoPes) &&
+        selected_track_ids_.find(pair.first) == selected_track_ids_.end()) {
+      DVLOG(1) << "Disabling PID " << pair.first << " of an unselected track.";
+      pid_state->Disable();
+      pid_state->sample_queue().clear();
+    }
+  }
+}
+
+bool Mp2tMediaParser::ProcessTsPacket(const uint8_t* buf, bool* is_valid) {
+  DCHECK_EQ(buf[0], kTsHeaderSyncword);
+  *is_valid = true;
+
+  if (track_selection_pending_)
+    ApplyTrackSelection();
+
+  // Drop the packets of unwanted PIDs before parsing them.
+  const int pid = ((buf[1] & 0x1f) << 8) | buf[2];
+  PidState* pid_state = pid_table_[pid];
+  if ((!pid_state && pid != TsSection::kPidPat) ||
+      (pid_state && !pid_state->IsEnabled())) {
+    DVLOG(LOG_LEVEL_TS) << "Ignoring TS packet for pid: " << pid;
+    return true;
+  }
+
+  // Parse the TS header.
+  std::unique_ptr<TsPacket> ts_packet(
+      TsPacket::Parse(buf, TsPacket::kPacketSize));
+  if (!ts_packet) {
+    DVLOG(1) << "Error: invalid TS packet";
+    *is_valid = false;
+    return true;
+  }
+  DVLOG(LOG_LEVEL_TS)
+      << "Processing PID=" << ts_packet->pid()
+      << " start_unit=" << ts_packet->payload_unit_start_indicator();
+
+  if (!pid_state) {
+    // Create the PAT state here if needed.
+    std::unique_ptr<TsSection> pat_section_parser(new TsSectionPat(
+        base::Bind(&Mp2tMediaParser::RegisterPmt, base::Unretained(this))));
+    std::unique_ptr<PidState> pat_pid_state(new PidState(
+        ts_packet->pid(), PidState::kPidPat, std::move(pat_section_parser)));
+    pat_pid_state->Enable();
+    pid_state = pat_pid_state.get();
+    AddPidState(ts_packet->pid(), std::move(pat_pid_state));
+  }
 
+  // Parse the section.
+  return pid_state->PushTsPacket(*ts_packet);
+}
+
+bool Mp2tMediaParser::ProcessQueuedTsPackets() {
   while (true) {
     const uint8_t* ts_buffer;
     int ts_buffer_size;
@@ -202,48 +326,19 @@ bool Mp2tMediaParser::Parse(const uint8_t* buf, int size) {
       continue;
     }
 
-    // Parse the TS header, skipping 1 byte if the header is invalid.
-    std::unique_ptr<TsPacket> ts_packet(
-        TsPacket::Parse(ts_buffer, ts_buffer_size));
-    if (!ts_packet) {
-      DVLOG(1) << "Error: invalid TS packet";
+    // Skip 1 byte if the header is invalid.
+    bool is_valid = false;
+    if (!ProcessTsPacket(ts_buffer, &is_valid))
+      return false;
+    if (!is_valid) {
       ts_byte_queue_.Pop(1);
       continue;
     }
-    DVLOG(LOG_LEVEL_TS)
-        << "Processing PID=" << ts_packet->pid()
-        << " start_unit=" << ts_packet->payload_unit_start_indicator();
-
-    // Parse the section.
-    std::map<int, std::unique_ptr<PidState>>::iterator it =
-        pids_.find(ts_packet->pid());
-    if (it == pids_.end() &&
-        ts_packet->pid() == TsSection::kPidPat) {
-      // Create the PAT state here if needed.
-      std::unique_ptr<TsSection> pat_section_parser(new TsSectionPat(
-          base::Bind(&Mp2tMediaParser::RegisterPmt, base::Unretained(this))));
-      std::unique_ptr<PidState> pat_pid_state(new PidState(
-          ts_packet->pid(), PidState::kPidPat, std::move(pat_section_parser)));
-      pat_pid_state->Enable();
-      it = pids_
-               .insert(std::pair<int, std::unique_ptr<PidState>>(
-                   ts_packet->pid(), std::move(pat_pid_state)))
-               .first;
-    }
-
-    if (it != pids_.end()) {
-      if (!it->second->PushTsPacket(*ts_packet))
-        return false;
-    } else {
-      DVLOG(LOG_LEVEL_TS) << "Ignoring TS packet for pid: " << ts_packet->pid();
-    }
 
     // Go to the next packet.
     ts_byte_queue_.Pop(TsPacket::kPacketSize);
   }
-
-  // Emit the A/V buffers that kept accumulating during TS parsing.
-  return EmitRemainingSamples();
+  return true;
 }
 
 void Mp2tMediaParser::RegisterPmt(int program_number, int pmt_pid) {
@@ -267,8 +362,7 @@ void Mp2tMediaParser::RegisterPmt(int program_number, int pmt_pid) {
   std::unique_ptr<PidState> pmt_pid_state(
       new PidState(pmt_pid, PidState::kPidPmt, std::move(pmt_section_parser)));
   pmt_pid_state->Enable();
-  pids_.insert(std::pair<int, std::unique_ptr<PidState>>(
-      pmt_pid, std::move(pmt_pid_state)));
+  AddPidState(pmt_pid, std::move(pmt_pid_state));
 }
 
 void Mp2tMediaParser::RegisterPes(int pmt_pid,
@@ -324,9 +418,11 @@ void Mp2tMediaParser::RegisterPes(int pmt_pid,
       is_audio ? PidState::kPidAudioPes : PidState::kPidVideoPes;
   std::unique_ptr<PidState> pes_pid_state(
       new PidState(pes_pid, pid_type, std::move(pes_section_parser)));
-  pes_pid_state->Enable();
-  pids_.insert(std::pair<int, std::unique_ptr<PidState>>(
-      pes_pid, std::move(pes_pid_state)));
+  if (!tracks_selected_ ||
+      selected_track_ids_.find(pes_pid) != selected_track_ids_.end()) {
+    pes_pid_state->Enable();
+  }
+  AddPidState(pes_pid, std::move(pes_pid_state));
 }
 
 void Mp2tMediaParser::OnNewStreamInfo(
@@ -8,6 +8,8 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <set>
+#include <vector>
 
 #include "packager/media/base/byte_queue.h"
 #include "packager/media/base/media_parser.h"
@@ -39,11 +41,29 @@ class Mp2tMediaParser : public MediaParser {
             KeySource* decryption_key_source) override;
   bool Flush() override WARN_UNUSED_RESULT;
   bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  void SelectTracks(const std::set<uint32_t>& track_ids) override;
   /// @}
 
  private:
   typedef std::map<int, std::unique_ptr<PidState>> PidMap;
 
+  // Add |pid_state| to |pids_| and |pid_table_|.
+  void AddPidState(int pid, std::unique_ptr<PidState> pid_state);
+
+  // Disable the PES PIDs not in |selected_track_ids_|, so their packets are
+  // dropped before PES reassembly, and drop their pending samples.
+  void ApplyTrackSelection();
+
+  // Process the TS packet at |buf|, which holds at least one TS packet
+  // starting on a syncword. Packets of PIDs which are not registered or are
+  // disabled are dropped before their header is fully parsed.
+  // |is_valid| is set to false if the TS packet header is invalid.
+  // Return false on parsing errors.
+  bool ProcessTsPacket(const uint8_t* buf, bool* is_valid);
+
+  // Process the TS packets in |ts_byte_queue_|, resynchronizing as needed.
+  bool ProcessQueuedTsPackets();
+
   // Callback invoked to register a Program Map Table.
   // Note: Does nothing if the PID is already registered.
   void RegisterPmt(int program_number, int pmt_pid);
@@ -84,10 +104,19 @@ class Mp2tMediaParser : public MediaParser {
 
   // List of PIDs and their states.
   PidMap pids_;
+  // The states of |pids_| indexed by PID, for the lookups of every packet.
+  std::vector<PidState*> pid_table_;
 
   // Whether |init_cb_| has been invoked.
   bool is_initialized_;
 
+  // Only the PES PIDs in |selected_track_ids_| are enabled, if
+  // |tracks_selected_|. The selection is applied between TS packets, as it may
+  // be made while a PES packet is parsed. See SelectTracks().
+  bool tracks_selected_;
+  bool track_selection_pending_;
+  std::set<uint32_t> selected_track_ids_;
+
   // A map used to track unsupported stream types and make sure the error is
   // only logged once.
   std::map<uint8_t, bool> stream_type_logged_once_;
@@ -41,6 +41,8 @@ class Mp2tMediaParserTest : public testing::Test {
   int video_frame_count_;
   int64_t video_min_dts_;
   int64_t video_max_dts_;
+  // Select the video tracks only on init if true.
+  bool select_video_tracks_ = false;
 
   bool AppendData(const uint8_t* data, size_t length) {
     return parser_->Parse(data, static_cast<int>(length));
@@ -67,6 +69,14 @@ class Mp2tMediaParserTest : public testing::Test {
       DVLOG(1) << stream_info->ToString();
       stream_map_[stream_info->track_id()] = stream_info;
     }
+    if (select_video_tracks_) {
+      std::set<uint32_t> track_ids;
+      for (const auto& stream_info : stream_infos) {
+        if (stream_info->stream_type() == kStreamVideo)
+          track_ids.insert(stream_info->track_id());
+      }
+      parser_->SelectTracks(track_ids);
+    }
   }
 
   bool OnNewSample(uint32_t track_id, std::shared_ptr<MediaSample> sample) {
@@ -152,6 +162,29 @@ TEST_F(Mp2tMediaParserTest, UnalignedAppend512_H265) {
   EXPECT_EQ(82, video_frame_count_);
 }
 
+TEST_F(Mp2tMediaParserTest, AlignedAppend_H264) {
+  // Test appends of whole TS packets, which are parsed in place.
+  ParseMpeg2TsFile("bear-640x360.ts", 7 * 188);
+  EXPECT_EQ(79, video_frame_count_);
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_EQ(82, video_frame_count_);
+}
+
+TEST_F(Mp2tMediaParserTest, AlignedAppendWholeFile_H265) {
+  ParseMpeg2TsFile("bear-640x360-hevc.ts", 1 << 30);
+  EXPECT_EQ(78, video_frame_count_);
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_EQ(82, video_frame_count_);
+}
+
+TEST_F(Mp2tMediaParserTest, SelectTracks) {
+  select_video_tracks_ = true;
+  ParseMpeg2TsFile("bear-640x360.ts", 512);
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_EQ(82, video_frame_count_);
+  EXPECT_EQ(0, audio_frame_count_);
+}
+
 TEST_F(Mp2tMediaParserTest, TimestampWrapAround) {
   // "bear-640x360.ts" has been transcoded from bear-640x360.mp4 by applying a
   // time offset of 95442s (close to 2^33 / 90000) which results in timestamps
@@ -100,6 +100,10 @@ bool Mpeg1Header::IsSyncWord(const uint8_t* buf) const {
          && ((buf[1] & 0b00000110) != 0b00000000);
 }
 
+uint8_t Mpeg1Header::GetSyncWordFirstByte() const {
+  return 0xff;
+}
+
 size_t Mpeg1Header::GetMinFrameSize() const {
   return kMpeg1HeaderMinSize + 1;
 }
@@ -116,6 +120,17 @@ bool Mpeg1Header::Parse(const uint8_t* mpeg1_frame, size_t mpeg1_frame_size) {
   if (mpeg1_frame_size < kMpeg1HeaderMinSize)
     return false;
 
+  // Only the padding bit is read if the other fields are the ones of the
+  // previous frame.
+  if (has_last_header_ && mpeg1_frame[0] == 0xff &&
+      mpeg1_frame[1] == last_header_[0] &&
+      (mpeg1_frame[2] & 0b11111100) == last_header_[1] &&
+      (mpeg1_frame[3] & 0b11000000) == last_header_[2]) {
+    padded_ = (mpeg1_frame[2] & 0b00000010) >> 1;
+    return true;
+  }
+  has_last_header_ = false;
+
   BitReader frame(mpeg1_frame, mpeg1_frame_size);
   // Verify frame starts with sync bits (0x7ff).
   uint32_t sync;
@@ -148,6 +163,10 @@ bool Mpeg1Header::Parse(const uint8_t* mpeg1_frame, size_t mpeg1_frame_size) {
   // Skip copyright, origination and emphasis info.
   RCHECK(frame.SkipBits(4));
 
+  last_header_[0] = mpeg1_frame[1];
+  last_header_[1] = mpeg1_frame[2] & 0b11111100;
+  last_header_[2] = mpeg1_frame[3] & 0b11000000;
+  has_last_header_ = true;
   return true;
 }
 
@@ -22,6 +22,7 @@ class Mpeg1Header : public AudioHeader {
   /// @name AudioHeader implementation overrides.
   /// @{
   bool IsSyncWord(const uint8_t* buf) const override;
+  uint8_t GetSyncWordFirstByte() const override;
   size_t GetMinFrameSize() const override;
   size_t GetSamplesPerFrame() const override;
   bool Parse(const uint8_t* mpeg1_frame, size_t mpeg1_frame_size) override;
@@ -47,6 +48,11 @@ class Mpeg1Header : public AudioHeader {
   uint32_t sample_rate_ = 0; /* in hz */
   uint8_t padded_ = 0;
   uint8_t channel_mode_ = 0;
+  // The header bytes of the last frame parsed after the syncword byte,
+  // without the padding, private and mode extension bits, which the next
+  // frames usually share.
+  bool has_last_header_ = false;
+  uint8_t last_header_[3] = {};
 };
 
 }  // namespace mp2t
@@ -27,7 +27,7 @@ namespace {
 const uint8_t kVideoStreamId = 0xE0;
 const uint8_t kAacAudioStreamId = 0xC0;
 const uint8_t kAc3AudioStreamId = 0xBD;  // AC3 uses private stream 1 id.
-const double kTsTimescale = 90000.0;
+const uint32_t kTsTimescale = 90000;
 }  // namespace
 
 PesPacketGenerator::PesPacketGenerator(
@@ -48,7 +48,8 @@ bool PesPacketGenerator::Initialize(const StreamInfo& stream_info) {
                        << " is not supported.";
       return false;
     }
-    timescale_scale_ = kTsTimescale / video_stream_info.time_scale();
+    to_ts_timescale_ =
+        TimestampRescaler(video_stream_info.time_scale(), kTsTimescale);
     converter_.reset(new NalUnitToByteStreamConverter());
     return converter_->Initialize(video_stream_info.codec_config().data(),
                                   video_stream_info.codec_config().size());
@@ -56,7 +57,8 @@ bool PesPacketGenerator::Initialize(const StreamInfo& stream_info) {
   if (stream_type_ == kStreamAudio) {
     const AudioStreamInfo& audio_stream_info =
         static_cast<const AudioStreamInfo&>(stream_info);
-    timescale_scale_ = kTsTimescale / audio_stream_info.time_scale();
+    to_ts_timescale_ =
+        TimestampRescaler(audio_stream_info.time_scale(), kTsTimescale);
     if (audio_stream_info.codec() == Codec::kCodecAAC) {
       audio_stream_id_ = kAacAudioStreamId;
       adts_converter_.reset(new AACAudioSpecificConfig());
@@ -79,13 +81,19 @@ bool PesPacketGenerator::Initialize(const StreamInfo& stream_info) {
 }
 
 bool PesPacketGenerator::PushSample(const MediaSample& sample) {
-  if (!current_processing_pes_)
-    current_processing_pes_.reset(new PesPacket());
+  if (!current_processing_pes_) {
+    if (!free_pes_packets_.empty()) {
+      current_processing_pes_ = std::move(free_pes_packets_.back());
+      free_pes_packets_.pop_back();
+    } else {
+      current_processing_pes_.reset(new PesPacket());
+    }
+  }
 
-  const int64_t pts =
-      sample.pts() * timescale_scale_ + transport_stream_timestamp_offset_;
-  const int64_t dts =
-      sample.dts() * timescale_scale_ + transport_stream_timestamp_offset_;
+  const int64_t pts = to_ts_timescale_.Rescale(sample.pts()) +
+                      transport_stream_timestamp_offset_;
+  const int64_t dts = to_ts_timescale_.Rescale(sample.dts()) +
+                      transport_stream_timestamp_offset_;
 
   if (pts < 0 || dts < 0) {
     LOG(ERROR) << "Seeing negative timestamp (" << pts << "," << dts << ")"
@@ -103,37 +111,37 @@ bool PesPacketGenerator::PushSample(const MediaSample& sample) {
     DCHECK(converter_);
     std::vector<SubsampleEntry> subsamples;
     if (sample.decrypt_config())
-      subsamples = sample.decrypt_config()->subsamples();
+      subsamples = sample.decrypt_config()->subsamples().ToVector();
     const bool kEscapeEncryptedNalu = true;
-    std::vector<uint8_t> byte_stream;
+    // The sample is converted in the storage of the PES packet data.
+    std::vector<uint8_t>* byte_stream = current_processing_pes_->mutable_data();
     if (!converter_->ConvertUnitToByteStreamWithSubsamples(
             sample.data(), sample.data_size(), sample.is_key_frame(),
-            kEscapeEncryptedNalu, &byte_stream, &subsamples)) {
+            kEscapeEncryptedNalu, byte_stream, &subsamples,
+            sample.nalu_layout())) {
       LOG(ERROR) << "Failed to convert sample to byte stream.";
       return false;
     }
 
-    current_processing_pes_->mutable_data()->swap(byte_stream);
     current_processing_pes_->set_stream_id(kVideoStreamId);
     pes_packets_.push_back(std::move(current_processing_pes_));
     return true;
   }
   DCHECK_EQ(stream_type_, kStreamAudio);
 
-  std::vector<uint8_t> audio_frame;
+  std::vector<uint8_t>* audio_frame = current_processing_pes_->mutable_data();
 
   // AAC is carried in ADTS.
   if (adts_converter_) {
     if (!adts_converter_->ConvertToADTS(sample.data(), sample.data_size(),
-                                        &audio_frame))
+                                        audio_frame))
       return false;
   } else {
-    audio_frame.assign(sample.data(), sample.data() + sample.data_size());
+    audio_frame->assign(sample.data(), sample.data() + sample.data_size());
   }
 
   // TODO(rkuriowa): Put multiple samples in the PES packet to reduce # of PES
   // packets.
-  current_processing_pes_->mutable_data()->swap(audio_frame);
   current_processing_pes_->set_stream_id(audio_stream_id_);
   pes_packets_.push_back(std::move(current_processing_pes_));
   return true;
@@ -150,6 +158,12 @@ std::unique_ptr<PesPacket> PesPacketGenerator::GetNextPesPacket() {
   return pes;
 }
 
+void PesPacketGenerator::ReleasePesPacket(
+    std::unique_ptr<PesPacket> pes_packet) {
+  DCHECK(pes_packet);
+  free_pes_packets_.push_back(std::move(pes_packet));
+}
+
 bool PesPacketGenerator::Flush() {
   return true;
 }
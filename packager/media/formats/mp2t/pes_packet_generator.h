@@ -7,11 +7,13 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP2T_PES_PACKET_GENERATOR_H_
 #define PACKAGER_MEDIA_FORMATS_MP2T_PES_PACKET_GENERATOR_H_
 
-#include <list>
+#include <deque>
 #include <memory>
+#include <vector>
 
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/base/timestamp_rescaler.h"
 
 namespace shaka {
 namespace media {
@@ -55,6 +57,11 @@ class PesPacketGenerator {
   /// @return Next PES packet that is ready.
   virtual std::unique_ptr<PesPacket> GetNextPesPacket();
 
+  /// Gives a PES packet obtained from GetNextPesPacket() back once it has
+  /// been written, so that the packet and the storage of its data are reused
+  /// for the next samples.
+  void ReleasePesPacket(std::unique_ptr<PesPacket> pes_packet);
+
   /// Flush the object.
   /// This may increase NumberOfReadyPesPackets().
   /// @return true on success, false otherwise.
@@ -66,9 +73,8 @@ class PesPacketGenerator {
   StreamType stream_type_;
 
   const uint32_t transport_stream_timestamp_offset_ = 0;
-  // Calculated by 90000 / input stream's timescale. This is used to scale the
-  // timestamps.
-  double timescale_scale_ = 0.0;
+  // Converts the timestamps of the input stream to the 90kHz timescale.
+  TimestampRescaler to_ts_timescale_;
 
   std::unique_ptr<NalUnitToByteStreamConverter> converter_;
   std::unique_ptr<AACAudioSpecificConfig> adts_converter_;
@@ -79,7 +85,9 @@ class PesPacketGenerator {
 
   // Audio stream id PES packet is codec dependent.
   uint8_t audio_stream_id_ = 0;
-  std::list<std::unique_ptr<PesPacket>> pes_packets_;
+  std::deque<std::unique_ptr<PesPacket>> pes_packets_;
+  // Released PES packets, ready to be reused.
+  std::vector<std::unique_ptr<PesPacket>> free_pes_packets_;
 
   DISALLOW_COPY_AND_ASSIGN(PesPacketGenerator);
 };
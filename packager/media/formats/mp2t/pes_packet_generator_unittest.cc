@@ -101,13 +101,14 @@ class MockNalUnitToByteStreamConverter : public NalUnitToByteStreamConverter {
   MOCK_METHOD2(Initialize,
                bool(const uint8_t* decoder_configuration_data,
                     size_t decoder_configuration_data_size));
-  MOCK_METHOD6(ConvertUnitToByteStreamWithSubsamples,
+  MOCK_METHOD7(ConvertUnitToByteStreamWithSubsamples,
                bool(const uint8_t* sample,
                     size_t sample_size,
                     bool is_key_frame,
                     bool escape_encrypted_nalu,
                     std::vector<uint8_t>* output,
-                    std::vector<SubsampleEntry>* subsamples));
+                    std::vector<SubsampleEntry>* subsamples,
+                    const std::vector<NaluLocation>* nalu_layout));
 };
 
 class MockAACAudioSpecificConfig : public AACAudioSpecificConfig {
@@ -209,7 +210,7 @@ TEST_F(PesPacketGeneratorTest, AddVideoSample) {
       new MockNalUnitToByteStreamConverter());
   EXPECT_CALL(*mock, ConvertUnitToByteStreamWithSubsamples(
                          _, arraysize(kAnyData), kIsKeyFrame,
-                         kEscapeEncryptedNalu, _, Pointee(IsEmpty())))
+                         kEscapeEncryptedNalu, _, Pointee(IsEmpty()), _))
       .WillOnce(DoAll(SetArgPointee<4>(expected_data), Return(true)));
 
   UseMockNalUnitToByteStreamConverter(std::move(mock));
@@ -256,7 +257,7 @@ TEST_F(PesPacketGeneratorTest, AddEncryptedVideoSample) {
       new MockNalUnitToByteStreamConverter());
   EXPECT_CALL(*mock, ConvertUnitToByteStreamWithSubsamples(
                          _, arraysize(kAnyData), kIsKeyFrame,
-                         kEscapeEncryptedNalu, _, Pointee(Eq(subsamples))))
+                         kEscapeEncryptedNalu, _, Pointee(Eq(subsamples)), _))
       .WillOnce(DoAll(SetArgPointee<4>(expected_data), Return(true)));
 
   UseMockNalUnitToByteStreamConverter(std::move(mock));
@@ -289,7 +290,7 @@ TEST_F(PesPacketGeneratorTest, AddVideoSampleFailedToConvert) {
       new MockNalUnitToByteStreamConverter());
   EXPECT_CALL(*mock, ConvertUnitToByteStreamWithSubsamples(
                          _, arraysize(kAnyData), kIsKeyFrame,
-                         kEscapeEncryptedNalu, _, Pointee(IsEmpty())))
+                         kEscapeEncryptedNalu, _, Pointee(IsEmpty()), _))
       .WillOnce(Return(false));
 
   UseMockNalUnitToByteStreamConverter(std::move(mock));
@@ -329,6 +330,29 @@ TEST_F(PesPacketGeneratorTest, AddAudioSample) {
   EXPECT_TRUE(generator_.Flush());
 }
 
+TEST_F(PesPacketGeneratorTest, ReusesReleasedPesPacket) {
+  std::shared_ptr<AudioStreamInfo> stream_info(
+      CreateAudioStreamInfo(kAacCodec));
+  EXPECT_TRUE(generator_.Initialize(*stream_info));
+
+  std::shared_ptr<MediaSample> sample =
+      MediaSample::CopyFrom(kAnyData, arraysize(kAnyData), kIsKeyFrame);
+  EXPECT_TRUE(generator_.PushSample(*sample));
+  std::unique_ptr<PesPacket> pes_packet = generator_.GetNextPesPacket();
+  ASSERT_TRUE(pes_packet);
+  const PesPacket* released_pes_packet = pes_packet.get();
+  generator_.ReleasePesPacket(std::move(pes_packet));
+
+  sample->set_pts(kDuration);
+  sample->set_dts(kDuration);
+  EXPECT_TRUE(generator_.PushSample(*sample));
+  pes_packet = generator_.GetNextPesPacket();
+  EXPECT_EQ(released_pes_packet, pes_packet.get());
+  EXPECT_EQ(static_cast<int64_t>(kDuration), pes_packet->pts());
+  // The ADTS header followed by the sample.
+  EXPECT_EQ(7u + arraysize(kAnyData), pes_packet->data().size());
+}
+
 TEST_F(PesPacketGeneratorTest, AddAudioSampleFailedToConvert) {
   std::shared_ptr<AudioStreamInfo> stream_info(
       CreateAudioStreamInfo(kAacCodec));
@@ -374,7 +398,7 @@ TEST_F(PesPacketGeneratorTest, TimeStampScaling) {
       new MockNalUnitToByteStreamConverter());
   EXPECT_CALL(*mock, ConvertUnitToByteStreamWithSubsamples(
                          _, arraysize(kAnyData), kIsKeyFrame,
-                         kEscapeEncryptedNalu, _, Pointee(IsEmpty())))
+                         kEscapeEncryptedNalu, _, Pointee(IsEmpty()), _))
       .WillOnce(Return(true));
 
   UseMockNalUnitToByteStreamConverter(std::move(mock));
@@ -9,6 +9,8 @@
 
 #include <stdint.h>
 
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "packager/media/base/buffer_writer.h"
@@ -29,6 +31,15 @@ class ProgramMapTableWriter {
   explicit ProgramMapTableWriter(Codec codec);
   virtual ~ProgramMapTableWriter() = default;
 
+  /// Adds another elementary stream to the program, described by
+  /// @a pmt_writer, so that a single PMT lists several elementary streams. The
+  /// elementary stream of this writer, with kElementaryPid, carries the PCR.
+  /// Must be called before any PMT is written.
+  /// @param pid is the PID of the elementary stream, other than
+  ///        kElementaryPid.
+  void AddElementaryStream(uint8_t pid,
+                           std::unique_ptr<ProgramMapTableWriter> pmt_writer);
+
   /// Writes TS packets with PMT for encrypted segments.
   // Virtual for testing.
   virtual bool EncryptedSegmentPmt(BufferWriter* writer);
@@ -52,13 +63,22 @@ class ProgramMapTableWriter {
   ProgramMapTableWriter(const ProgramMapTableWriter&) = delete;
   ProgramMapTableWriter& operator=(const ProgramMapTableWriter&) = delete;
 
+  // Writes the entry of the elementary stream, with |pid|, in the PMT.
+  bool WriteElementaryStreamInfo(bool encrypted,
+                                 uint8_t pid,
+                                 BufferWriter* es_info) const;
+
   // Writes descriptors for PMT (only needed for encrypted PMT).
   virtual bool WriteDescriptors(BufferWriter* writer) const = 0;
 
   const Codec codec_;
   ContinuityCounter continuity_counter_;
+  // The PMTs, already in TS packets.
   BufferWriter clear_pmt_;
   BufferWriter encrypted_pmt_;
+  // The other elementary streams of the program, with their PIDs.
+  std::vector<std::pair<uint8_t, std::unique_ptr<ProgramMapTableWriter>>>
+      additional_streams_;
 };
 
 /// ProgramMapTableWriter for video codecs.
@@ -6,6 +6,7 @@
 
 #include <gtest/gtest.h>
 
+#include <memory>
 #include <vector>
 
 #include "packager/media/base/buffer_writer.h"
@@ -216,6 +217,52 @@ TEST_F(ProgramMapTableWriterTest, ClearAac) {
                           160, kPmtAac, arraysize(kPmtAac), buffer.Buffer()));
 }
 
+// Verify that a PMT with more than one elementary stream lists them all, with
+// the PCR on the first one.
+TEST_F(ProgramMapTableWriterTest, ClearH264AndAac) {
+  const std::vector<uint8_t> aac_audio_specific_config(
+      std::begin(kAacBasicProfileExtraData),
+      std::end(kAacBasicProfileExtraData));
+  std::unique_ptr<ProgramMapTableWriter> aac_writer(
+      new AudioProgramMapTableWriter(kCodecAAC, aac_audio_specific_config));
+  VideoProgramMapTableWriter writer(kCodecH264);
+  writer.AddElementaryStream(0x51, std::move(aac_writer));
+  BufferWriter buffer;
+  writer.ClearSegmentPmt(&buffer);
+
+  const uint8_t kExpectedPmtPrefix[] = {
+      0x47,  // Sync byte.
+      0x40,  // payload_unit_start_indicator set.
+      0x20,  // pid.
+      0x30,  // Adaptation field and payload are both present. counter = 0.
+      0x9C,  // Adaptation Field length.
+      0x00,  // All adaptation field flags 0.
+  };
+  const uint8_t kPmtH264AndAac[] = {
+      0x00,                    // pointer field
+      0x02,                    // table id must be 0x02.
+      0xB0,                    // assumes length is <= 256 bytes.
+      0x17,                    // length of the rest of this array.
+      0x00, 0x01,              // program number.
+      0xC1,                    // version 0, current next indicator 1.
+      0x00,                    // section number
+      0x00,                    // last section number.
+      0xE0,                    // first 3 bits reserved.
+      0x50,                    // PCR PID is the first elementary stream PID.
+      0xF0,                    // first 4 bits reserved.
+      0x00,                    // No descriptor at this level.
+      0x1B, 0xE0, 0x50,        // stream_type -> PID.
+      0xF0, 0x00,              // Es_info_length is 0.
+      0x0F, 0xE0, 0x51,        // stream_type -> PID.
+      0xF0, 0x00,              // Es_info_length is 0.
+      0x5A, 0x21, 0x57, 0xEE,  // CRC32.
+  };
+  ASSERT_EQ(kTsPacketSize, buffer.Size());
+  EXPECT_NO_FATAL_FAILURE(ExpectTsPacketEqual(
+      kExpectedPmtPrefix, arraysize(kExpectedPmtPrefix), 155, kPmtH264AndAac,
+      arraysize(kPmtH264AndAac), buffer.Buffer()));
+}
+
 TEST_F(ProgramMapTableWriterTest, ClearAc3) {
   const std::vector<uint8_t> audio_specific_config(std::begin(kAc3SetupData),
                                                    std::end(kAc3SetupData));
@@ -6,6 +6,8 @@
 
 #include "packager/media/formats/mp2t/ts_muxer.h"
 
+#include "packager/status_macros.h"
+
 namespace shaka {
 namespace media {
 namespace mp2t {
@@ -17,46 +19,112 @@ const uint32_t kTsTimescale = 90000;
 TsMuxer::TsMuxer(const MuxerOptions& muxer_options) : Muxer(muxer_options) {}
 TsMuxer::~TsMuxer() {}
 
+Status TsMuxer::Process(std::unique_ptr<StreamData> stream_data) {
+  // StreamInfos are kept by Muxer in the order they arrive, which may not be
+  // the order of the input streams.
+  if (stream_data->stream_data_type == StreamDataType::kStreamInfo)
+    stream_info_index_ = stream_data->stream_index;
+  return Muxer::Process(std::move(stream_data));
+}
+
+Status TsMuxer::OnFlushRequest(size_t input_stream_index) {
+  if (num_input_streams() <= 1u)
+    return Muxer::OnFlushRequest(input_stream_index);
+  if (segmenter_) {
+    RETURN_IF_ERROR(segmenter_->FinishStream(
+        GetSegmenterStreamIndex(input_stream_index)));
+  }
+  // The output is finalized once all the input streams are flushed.
+  if (++num_flushed_streams_ < num_input_streams())
+    return Status::OK;
+  return Muxer::OnFlushRequest(input_stream_index);
+}
+
 Status TsMuxer::InitializeMuxer() {
-  if (streams().size() > 1u)
-    return Status(error::MUXER_FAILURE, "Cannot handle more than one streams.");
+  if (num_input_streams() <= 1u) {
+    segmenter_.reset(new TsSegmenter(options(), muxer_listener()));
+    main_stream_ = streams()[0];
+    Status status = segmenter_->Initialize(*main_stream_);
+    FireOnMediaStartEvent();
+    return status;
+  }
 
-  segmenter_.reset(new TsSegmenter(options(), muxer_listener()));
-  Status status = segmenter_->Initialize(*streams()[0]);
+  if (segmenter_) {
+    return Status(error::MUXER_FAILURE,
+                  "Cannot change the streams of a multiplexed TS output.");
+  }
+  stream_infos_.resize(num_input_streams());
+  DCHECK_LT(stream_info_index_, stream_infos_.size());
+  stream_infos_[stream_info_index_] = streams().back();
+  if (streams().size() < num_input_streams())
+    return Status::OK;
+  return InitializeSegmenterForStreams();
+}
+
+Status TsMuxer::InitializeSegmenterForStreams() {
+  main_stream_id_ = 0;
+  for (size_t i = 0; i < stream_infos_.size(); ++i) {
+    if (stream_infos_[i]->stream_type() == StreamType::kStreamVideo) {
+      main_stream_id_ = i;
+      break;
+    }
+  }
+  main_stream_ = stream_infos_[main_stream_id_];
+
+  segmenter_.reset(
+      new TsSegmenter(options(), muxer_listener(), stream_infos_.size()));
+  for (size_t i = 0; i < stream_infos_.size(); ++i) {
+    RETURN_IF_ERROR(segmenter_->InitializeStream(GetSegmenterStreamIndex(i),
+                                                 *stream_infos_[i]));
+  }
   FireOnMediaStartEvent();
-  return status;
+  return Status::OK;
+}
+
+size_t TsMuxer::GetSegmenterStreamIndex(size_t stream_id) const {
+  if (stream_id == main_stream_id_)
+    return 0;
+  return stream_id < main_stream_id_ ? stream_id + 1 : stream_id;
 }
 
 Status TsMuxer::Finalize() {
+  if (!segmenter_) {
+    return Status(error::MUXER_FAILURE,
+                  "Missing StreamInfos of the multiplexed streams.");
+  }
   FireOnMediaEndEvent();
   return segmenter_->Finalize();
 }
 
 Status TsMuxer::AddSample(size_t stream_id, const MediaSample& sample) {
-  DCHECK_EQ(stream_id, 0u);
-  if (num_samples_ < 2) {
-    sample_durations_[num_samples_] = sample.duration() * kTsTimescale / 
-                                      streams().front()->time_scale();
-    if (num_samples_ == 1 && muxer_listener()) 
+  if (!segmenter_) {
+    return Status(error::MUXER_FAILURE,
+                  "Samples received before the StreamInfos of all the "
+                  "multiplexed streams.");
+  }
+  if (stream_id == main_stream_id_ && num_samples_ < 2) {
+    sample_durations_[num_samples_] = sample.duration() * kTsTimescale /
+                                      main_stream_->time_scale();
+    if (num_samples_ == 1 && muxer_listener())
       muxer_listener()->OnSampleDurationReady(sample_durations_[num_samples_]);
     num_samples_++;
-  } 
-  return segmenter_->AddSample(sample);
+  }
+  return segmenter_->AddSample(GetSegmenterStreamIndex(stream_id), sample);
 }
 
 Status TsMuxer::FinalizeSegment(size_t stream_id,
                                 const SegmentInfo& segment_info) {
-  DCHECK_EQ(stream_id, 0u);
-  return segment_info.is_subsegment
-             ? Status::OK
-             : segmenter_->FinalizeSegment(segment_info.start_timestamp,
-                                           segment_info.duration);
+  // The segments are those of the main stream.
+  if (stream_id != main_stream_id_ || segment_info.is_subsegment)
+    return Status::OK;
+  return segmenter_->FinalizeSegment(segment_info.start_timestamp,
+                                     segment_info.duration);
 }
 
 void TsMuxer::FireOnMediaStartEvent() {
   if (!muxer_listener())
     return;
-  muxer_listener()->OnMediaStart(options(), *streams().front(), kTsTimescale,
+  muxer_listener()->OnMediaStart(options(), *main_stream_, kTsTimescale,
                                  MuxerListener::kContainerMpeg2ts);
 }
 
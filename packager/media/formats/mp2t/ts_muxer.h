@@ -16,12 +16,22 @@ namespace media {
 namespace mp2t {
 
 /// MPEG2 TS muxer.
-/// This is a single program, single elementary stream TS muxer.
+/// This is a single program TS muxer. With more than one input stream, the
+/// streams are muxed as elementary streams of the program. The segments, the
+/// PCR and the MuxerListener events are those of the main stream, which is the
+/// first video stream, or the first stream if there is no video.
 class TsMuxer : public Muxer {
  public:
   explicit TsMuxer(const MuxerOptions& muxer_options);
   ~TsMuxer() override;
 
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status Process(std::unique_ptr<StreamData> stream_data) override;
+  Status OnFlushRequest(size_t input_stream_index) override;
+  /// @}
+
  private:
   // Muxer implementation.
   Status InitializeMuxer() override;
@@ -34,7 +44,22 @@ class TsMuxer : public Muxer {
   void FireOnMediaStartEvent();
   void FireOnMediaEndEvent();
 
+  // Creates the segmenter once the StreamInfos of all the input streams are
+  // received, with more than one input stream.
+  Status InitializeSegmenterForStreams();
+  // @return the index of the elementary stream of the input stream
+  //         |stream_id| in |segmenter_|, where the main stream comes first.
+  size_t GetSegmenterStreamIndex(size_t stream_id) const;
+
   std::unique_ptr<TsSegmenter> segmenter_;
+  // The input stream index of the last StreamInfo.
+  size_t stream_info_index_ = 0;
+  // The StreamInfos by input stream index, with more than one input stream.
+  std::vector<std::shared_ptr<const StreamInfo>> stream_infos_;
+  // The input stream index and the StreamInfo of the main stream.
+  size_t main_stream_id_ = 0;
+  std::shared_ptr<const StreamInfo> main_stream_;
+  size_t num_flushed_streams_ = 0;
   int64_t sample_durations_[2];
   int64_t num_samples_ = 0;
 
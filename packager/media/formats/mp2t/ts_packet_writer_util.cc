@@ -6,6 +6,8 @@
 
 #include "packager/media/formats/mp2t/ts_packet_writer_util.h"
 
+#include <string.h>
+
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/formats/mp2t/continuity_counter.h"
@@ -18,6 +20,8 @@ namespace {
 
 const int kPcrFieldsSize = 6;
 const uint8_t kSyncByte = 0x47;
+// Used for adaptation field padding bytes.
+const uint8_t kPaddingByte = 0xFF;
 
 // This is the size of the first few fields in a TS packet, i.e. TS packet size
 // without adaptation field or the payload.
@@ -26,54 +30,28 @@ const int kTsPacketSize = 188;
 const int kTsPacketMaximumPayloadSize =
     kTsPacketSize - kTsPacketHeaderSize;
 
-// Used for adaptation field padding bytes.
-const uint8_t kPaddingBytes[] = {
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-};
-static_assert(arraysize(kPaddingBytes) >= kTsPacketMaximumPayloadSize,
-              "Padding array is not big enough.");
+// The size of the adaptation_field_length field itself.
+const int kAdaptationFieldLengthSize = 1;
+// The size of all leading flags (not including the adaptation_field_length).
+const int kAdaptationFieldHeaderSize = 1;
+const int kTsPacketMaximumPayloadSizeWithPcr =
+    kTsPacketMaximumPayloadSize - kAdaptationFieldLengthSize -
+    kAdaptationFieldHeaderSize - kPcrFieldsSize;
 
 // |remaining_data_size| is the amount of data that has to be written. This may
 // be bigger than a TS packet size.
 // |remaining_data_size| matters if it is short and requires padding.
-void WriteAdaptationField(bool has_pcr,
-                          uint64_t pcr_base,
-                          size_t remaining_data_size,
-                          BufferWriter* writer) {
+// Returns the number of bytes written to |field|.
+size_t WriteAdaptationField(bool has_pcr,
+                            uint64_t pcr_base,
+                            size_t remaining_data_size,
+                            uint8_t* field) {
   // Special case where a TS packet requires 1 byte padding.
   if (!has_pcr && remaining_data_size == kTsPacketMaximumPayloadSize - 1) {
-    writer->AppendInt(static_cast<uint8_t>(0));
-    return;
+    field[0] = 0;
+    return kAdaptationFieldLengthSize;
   }
 
-  // The size of the field itself.
-  const int kAdaptationFieldLengthSize = 1;
-
-  // The size of all leading flags (not including the adaptation_field_length).
-  const int kAdaptationFieldHeaderSize = 1;
   size_t adaptation_field_length =
       kAdaptationFieldHeaderSize + (has_pcr ? kPcrFieldsSize : 0);
   if (remaining_data_size < kTsPacketMaximumPayloadSize) {
@@ -85,29 +63,40 @@ void WriteAdaptationField(bool has_pcr,
     }
   }
 
-  writer->AppendInt(static_cast<uint8_t>(adaptation_field_length));
-  int remaining_bytes = static_cast<int>(adaptation_field_length);
-  writer->AppendInt(static_cast<uint8_t>(
-      // All flags except PCR_flag are 0.
-      static_cast<uint8_t>(has_pcr) << 4));
-  remaining_bytes -= 1;
+  uint8_t* position = field;
+  *position++ = static_cast<uint8_t>(adaptation_field_length);
+  // All flags except PCR_flag are 0.
+  *position++ = static_cast<uint8_t>(has_pcr) << 4;
 
   if (has_pcr) {
-    // program_clock_reference_extension = 0.
-    const uint32_t most_significant_32bits_pcr =
-        static_cast<uint32_t>(pcr_base >> 1);
-    const uint16_t pcr_last_bit_reserved_and_pcr_extension =
-        ((pcr_base & 1) << 15);
-    writer->AppendInt(most_significant_32bits_pcr);
-    writer->AppendInt(pcr_last_bit_reserved_and_pcr_extension);
-    remaining_bytes -= kPcrFieldsSize;
+    // The 33 bits of PCR base, followed by the reserved bits and
+    // program_clock_reference_extension, which are all 0.
+    *position++ = static_cast<uint8_t>(pcr_base >> 25);
+    *position++ = static_cast<uint8_t>(pcr_base >> 17);
+    *position++ = static_cast<uint8_t>(pcr_base >> 9);
+    *position++ = static_cast<uint8_t>(pcr_base >> 1);
+    *position++ = static_cast<uint8_t>((pcr_base & 1) << 7);
+    *position++ = 0;
   }
-  DCHECK_GE(remaining_bytes, 0);
-  if (remaining_bytes == 0)
-    return;
 
-  DCHECK_GE(static_cast<int>(arraysize(kPaddingBytes)), remaining_bytes);
-  writer->AppendArray(kPaddingBytes, remaining_bytes);
+  const size_t field_size =
+      kAdaptationFieldLengthSize + adaptation_field_length;
+  DCHECK_GE(field + field_size, position);
+  memset(position, kPaddingByte, field + field_size - position);
+  return field_size;
+}
+
+// Returns the number of TS packets a payload of |payload_size| is split into.
+size_t GetTsPacketCount(size_t payload_size, bool has_pcr) {
+  // PCR, if any, is in the first TS packet only.
+  const size_t first_packet_payload_size =
+      has_pcr ? kTsPacketMaximumPayloadSizeWithPcr
+              : kTsPacketMaximumPayloadSize;
+  if (payload_size <= first_packet_payload_size)
+    return 1;
+  return 1 + (payload_size - first_packet_payload_size +
+              kTsPacketMaximumPayloadSize - 1) /
+                 kTsPacketMaximumPayloadSize;
 }
 
 }  // namespace
@@ -120,44 +109,66 @@ void WritePayloadToBufferWriter(const uint8_t* payload,
                                 uint64_t pcr_base,
                                 ContinuityCounter* continuity_counter,
                                 BufferWriter* writer) {
-  size_t payload_bytes_written = 0;
+  // The TS packets are written in place, in one go, rather than field by
+  // field.
+  const size_t packet_count = GetTsPacketCount(payload_size, has_pcr);
+  uint8_t* packet = writer->Expand(packet_count * kTsPacketSize);
 
-  do {
+  // transport_error_indicator and transport_priority are both '0'.
+  const uint8_t pid_high_bits = static_cast<uint8_t>((pid >> 8) & 0x1F);
+  const uint8_t pid_low_bits = static_cast<uint8_t>(pid);
+
+  size_t payload_bytes_written = 0;
+  for (size_t i = 0; i < packet_count; ++i) {
     const bool must_write_adaptation_header = has_pcr;
     const size_t bytes_left = payload_size - payload_bytes_written;
     const bool has_adaptation_field = must_write_adaptation_header ||
                                       bytes_left < kTsPacketMaximumPayloadSize;
 
-    writer->AppendInt(kSyncByte);
-    writer->AppendInt(static_cast<uint16_t>(
-        // transport_error_indicator and transport_priority are both '0'.
-        static_cast<int>(payload_unit_start_indicator) << 14 | pid));
-
+    packet[0] = kSyncByte;
+    packet[1] = static_cast<uint8_t>(payload_unit_start_indicator) << 6 |
+                pid_high_bits;
+    packet[2] = pid_low_bits;
     const uint8_t adaptation_field_control =
         ((has_adaptation_field ? 1 : 0) << 1) | ((bytes_left != 0) ? 1 : 0);
     // transport_scrambling_control is '00'.
-    writer->AppendInt(static_cast<uint8_t>(adaptation_field_control << 4 |
-                                           continuity_counter->GetNext()));
+    packet[3] = static_cast<uint8_t>(adaptation_field_control << 4 |
+                                     continuity_counter->GetNext());
 
+    size_t header_size = kTsPacketHeaderSize;
     if (has_adaptation_field) {
-      const size_t before = writer->Size();
-      WriteAdaptationField(has_pcr, pcr_base, bytes_left, writer);
-      const size_t bytes_for_adaptation_field = writer->Size() - before;
-
-      const size_t write_bytes =
-          kTsPacketMaximumPayloadSize - bytes_for_adaptation_field;
-      writer->AppendArray(payload + payload_bytes_written, write_bytes);
-      payload_bytes_written += write_bytes;
-    } else {
-      writer->AppendArray(payload + payload_bytes_written,
-                          kTsPacketMaximumPayloadSize);
-      payload_bytes_written += kTsPacketMaximumPayloadSize;
+      header_size += WriteAdaptationField(has_pcr, pcr_base, bytes_left,
+                                          packet + kTsPacketHeaderSize);
+    }
+
+    const size_t write_bytes = kTsPacketSize - header_size;
+    DCHECK_LE(write_bytes, bytes_left);
+    if (write_bytes > 0) {
+      memcpy(packet + header_size, payload + payload_bytes_written,
+             write_bytes);
     }
+    payload_bytes_written += write_bytes;
+    packet += kTsPacketSize;
 
     // Once written, not needed for this payload.
     has_pcr = false;
     payload_unit_start_indicator = false;
-  } while (payload_bytes_written < payload_size);
+  }
+  DCHECK_EQ(payload_size, payload_bytes_written);
+}
+
+void WritePacketsToBufferWriter(const uint8_t* packets,
+                                size_t packets_size,
+                                ContinuityCounter* continuity_counter,
+                                BufferWriter* writer) {
+  DCHECK_EQ(0u, packets_size % kTsPacketSize);
+  uint8_t* output = writer->Expand(packets_size);
+  memcpy(output, packets, packets_size);
+  for (size_t offset = 0; offset < packets_size; offset += kTsPacketSize) {
+    uint8_t* continuity_counter_byte = output + offset + 3;
+    *continuity_counter_byte = static_cast<uint8_t>(
+        (*continuity_counter_byte & 0xF0) | continuity_counter->GetNext());
+  }
 }
 
 }  // namespace mp2t
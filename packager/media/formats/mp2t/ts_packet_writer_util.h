@@ -40,6 +40,19 @@ void WritePayloadToBufferWriter(const uint8_t* payload,
                                 ContinuityCounter* continuity_counter,
                                 BufferWriter* output);
 
+/// Writes TS packets written before with WritePayloadToBufferWriter, with
+/// their continuity_counter renumbered. This lets payloads which are repeated
+/// in every segment, e.g. PSI tables, be put into TS packets only once.
+/// @param packets are the TS packets.
+/// @param packets_size is the size of @a packets, which must be a multiple of
+///        the TS packet size.
+/// @param continuity_counter is the continuity_counter for these TS packets.
+/// @param output is where the TS packets get written.
+void WritePacketsToBufferWriter(const uint8_t* packets,
+                                size_t packets_size,
+                                ContinuityCounter* continuity_counter,
+                                BufferWriter* output);
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -4,6 +4,8 @@
 
 #include "packager/media/formats/mp2t/ts_section_pes.h"
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/media/base/bit_reader.h"
@@ -102,16 +104,11 @@ bool TsSectionPes::Parse(bool payload_unit_start_indicator,
   if (wait_for_pusi_ && !payload_unit_start_indicator)
     return true;
 
-  bool parse_result = true;
   if (payload_unit_start_indicator) {
-    // Try emitting a packet since we might have a pending PES packet
-    // with an undefined size.
-    // In this case, a unit is emitted when the next unit is coming.
-    int raw_pes_size;
-    const uint8_t* raw_pes;
-    pes_byte_queue_.Peek(&raw_pes, &raw_pes_size);
-    if (raw_pes_size > 0)
-      parse_result = Emit(true);
+    // The ES bytes of the previous PES, including a PES with an undefined
+    // size, have already been passed to the ES parser.
+    DVLOG_IF(1, es_bytes_remaining_ > 0)
+        << "Incomplete PES: " << es_bytes_remaining_ << " bytes missing";
 
     // Reset the state.
     ResetPesState();
@@ -120,18 +117,46 @@ bool TsSectionPes::Parse(bool payload_unit_start_indicator,
     wait_for_pusi_ = false;
   }
 
-  // Add the data to the parser state.
-  if (size > 0)
-    pes_byte_queue_.Push(buf, size);
+  if (pes_header_parsed_)
+    return ParseEs(buf, size, kNoTimestamp, kNoTimestamp);
 
-  // Try emitting the current PES packet.
-  return (parse_result && Emit(false));
+  // Only the PES header is reassembled, when it spans several TS packets.
+  const uint8_t* raw_pes;
+  int raw_pes_size;
+  pes_header_byte_queue_.Peek(&raw_pes, &raw_pes_size);
+  const bool is_header_queued = raw_pes_size > 0;
+  if (is_header_queued) {
+    pes_header_byte_queue_.Push(buf, size);
+    pes_header_byte_queue_.Peek(&raw_pes, &raw_pes_size);
+  } else {
+    raw_pes = buf;
+    raw_pes_size = size;
+  }
+
+  int header_size = 0;
+  int64_t pts = kNoTimestamp;
+  int64_t dts = kNoTimestamp;
+  if (!ParsePesHeader(raw_pes, raw_pes_size, &header_size, &pts, &dts)) {
+    ResetPesState();
+    return false;
+  }
+  if (header_size == 0) {
+    // Wait for the rest of the header.
+    if (!is_header_queued && size > 0)
+      pes_header_byte_queue_.Push(buf, size);
+    return true;
+  }
+  pes_header_parsed_ = true;
+
+  // The ES bytes are passed to the ES parser straight from the TS packets,
+  // which is the only copy before the ES parser.
+  return ParseEs(raw_pes + header_size, raw_pes_size - header_size, pts, dts);
 }
 
 void TsSectionPes::Flush() {
-  // Try emitting a packet since we might have a pending PES packet
-  // with an undefined size.
-  Emit(true);
+  // The pending PES, possibly with an undefined size, has already been passed
+  // to the ES parser.
+  ResetPesState();
 
   // Flush the underlying ES parser.
   es_parser_->Flush();
@@ -148,40 +173,18 @@ void TsSectionPes::Reset() {
   es_parser_->Reset();
 }
 
-bool TsSectionPes::Emit(bool emit_for_unknown_size) {
-  int raw_pes_size;
-  const uint8_t* raw_pes;
-  pes_byte_queue_.Peek(&raw_pes, &raw_pes_size);
+bool TsSectionPes::ParsePesHeader(const uint8_t* raw_pes,
+                                  int raw_pes_size,
+                                  int* header_size,
+                                  int64_t* media_pts,
+                                  int64_t* media_dts) {
+  *header_size = 0;
 
   // A PES should be at least 6 bytes.
   // Wait for more data to come if not enough bytes.
   if (raw_pes_size < 6)
     return true;
 
-  // Check whether we have enough data to start parsing.
-  int pes_packet_length =
-      (static_cast<int>(raw_pes[4]) << 8) |
-      (static_cast<int>(raw_pes[5]));
-  if ((pes_packet_length == 0 && !emit_for_unknown_size) ||
-      (pes_packet_length != 0 && raw_pes_size < pes_packet_length + 6)) {
-    // Wait for more data to come either because:
-    // - there are not enough bytes,
-    // - or the PES size is unknown and the "force emit" flag is not set.
-    //   (PES size might be unknown for video PES packet).
-    return true;
-  }
-  DVLOG(LOG_LEVEL_PES) << "pes_packet_length=" << pes_packet_length;
-
-  // Parse the packet.
-  bool parse_result = ParseInternal(raw_pes, raw_pes_size);
-
-  // Reset the state.
-  ResetPesState();
-
-  return parse_result;
-}
-
-bool TsSectionPes::ParseInternal(const uint8_t* raw_pes, int raw_pes_size) {
   BitReader bit_reader(raw_pes, raw_pes_size);
 
   // Read up to the pes_packet_length (6 bytes).
@@ -194,8 +197,7 @@ bool TsSectionPes::ParseInternal(const uint8_t* raw_pes, int raw_pes_size) {
 
   RCHECK(packet_start_code_prefix == kPesStartCode);
   DVLOG(LOG_LEVEL_PES) << "stream_id=" << std::hex << stream_id << std::dec;
-  if (pes_packet_length == 0)
-    pes_packet_length = static_cast<int>(bit_reader.bits_available()) / 8;
+  DVLOG(LOG_LEVEL_PES) << "pes_packet_length=" << pes_packet_length;
 
   // Ignore the PES for unknown stream IDs.
   // ATSC Standard A/52:2012 3. GENERIC IDENTIFICATION OF AN AC-3 STREAM.
@@ -205,10 +207,16 @@ bool TsSectionPes::ParseInternal(const uint8_t* raw_pes, int raw_pes_size) {
   bool is_audio_stream_id =
       ((stream_id & 0xe0) == 0xc0) || stream_id == kPrivateStream1;
   bool is_video_stream_id = ((stream_id & 0xf0) == 0xe0);
-  if (!is_audio_stream_id && !is_video_stream_id)
+  if (!is_audio_stream_id && !is_video_stream_id) {
+    ignore_pes_ = true;
+    *header_size = 6;
     return true;
+  }
 
   // Read up to "pes_header_data_length".
+  // Wait for more data to come if the header is not complete.
+  if (raw_pes_size < 9 || raw_pes_size < 9 + raw_pes[8])
+    return true;
   int dummy_2;
   int PES_scrambling_control;
   int PES_priority;
@@ -243,10 +251,13 @@ bool TsSectionPes::ParseInternal(const uint8_t* raw_pes, int raw_pes_size) {
   // Compute the size and the offset of the ES payload.
   // "6" for the 6 bytes read before and including |pes_packet_length|.
   // "3" for the 3 bytes read before and including |pes_header_data_length|.
-  int es_size = pes_packet_length - 3 - pes_header_data_length;
+  // The ES payload runs up to the next PES if |pes_packet_length| is 0.
   int es_offset = 6 + 3 + pes_header_data_length;
-  RCHECK(es_size >= 0);
-  RCHECK(es_offset + es_size <= raw_pes_size);
+  if (pes_packet_length != 0) {
+    int es_size = pes_packet_length - 3 - pes_header_data_length;
+    RCHECK(es_size >= 0);
+    es_bytes_remaining_ = es_size;
+  }
 
   // Read the timing information section.
   bool is_pts_valid = false;
@@ -271,15 +282,13 @@ bool TsSectionPes::ParseInternal(const uint8_t* raw_pes, int raw_pes_size) {
   }
 
   // Convert and unroll the timestamps.
-  int64_t media_pts(kNoTimestamp);
-  int64_t media_dts(kNoTimestamp);
   if (is_pts_valid) {
     int64_t pts = ConvertTimestampSectionToTimestamp(pts_section);
     if (previous_pts_valid_)
       pts = UnrollTimestamp(previous_pts_, pts);
     previous_pts_ = pts;
     previous_pts_valid_ = true;
-    media_pts = pts;
+    *media_pts = pts;
   }
   if (is_dts_valid) {
     int64_t dts = ConvertTimestampSectionToTimestamp(dts_section);
@@ -287,7 +296,7 @@ bool TsSectionPes::ParseInternal(const uint8_t* raw_pes, int raw_pes_size) {
       dts = UnrollTimestamp(previous_dts_, dts);
     previous_dts_ = dts;
     previous_dts_valid_ = true;
-    media_dts = dts;
+    *media_dts = dts;
   }
 
   // Discard the rest of the PES packet header.
@@ -298,18 +307,41 @@ bool TsSectionPes::ParseInternal(const uint8_t* raw_pes, int raw_pes_size) {
        static_cast<int>(bit_reader.bits_available()) / 8);
   RCHECK(pes_header_remaining_size >= 0);
 
-  // Read the PES packet.
   DVLOG(LOG_LEVEL_PES)
-      << "Emit a reassembled PES:"
-      << " size=" << es_size
-      << " pts=" << media_pts
-      << " dts=" << media_dts
+      << "Parsed a PES header:"
+      << " es_size=" << es_bytes_remaining_
+      << " pts=" << *media_pts
+      << " dts=" << *media_dts
       << " data_alignment_indicator=" << data_alignment_indicator;
-  return es_parser_->Parse(&raw_pes[es_offset], es_size, media_pts, media_dts);
+  *header_size = es_offset;
+  return true;
+}
+
+bool TsSectionPes::ParseEs(const uint8_t* buf,
+                           int size,
+                           int64_t pts,
+                           int64_t dts) {
+  if (ignore_pes_)
+    return true;
+  // Discard the bytes after the end of a PES with a defined size.
+  if (es_bytes_remaining_ >= 0) {
+    size = std::min(size, es_bytes_remaining_);
+    es_bytes_remaining_ -= size;
+  }
+  if (size == 0 && pts == kNoTimestamp)
+    return true;
+  if (!es_parser_->Parse(buf, size, pts, dts)) {
+    ResetPesState();
+    return false;
+  }
+  return true;
 }
 
 void TsSectionPes::ResetPesState() {
-  pes_byte_queue_.Reset();
+  pes_header_byte_queue_.Reset();
+  pes_header_parsed_ = false;
+  ignore_pes_ = false;
+  es_bytes_remaining_ = -1;
   wait_for_pusi_ = true;
 }
 
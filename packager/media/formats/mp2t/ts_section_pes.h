@@ -30,19 +30,36 @@ class TsSectionPes : public TsSection {
   void Reset() override;
 
  private:
-  // Emit a reassembled PES packet.
-  // Return true if successful.
-  // |emit_for_unknown_size| is used to force emission for PES packets
-  // whose size is unknown.
-  bool Emit(bool emit_for_unknown_size);
-
-  // Parse a PES packet, return true if successful.
-  bool ParseInternal(const uint8_t* raw_pes, int raw_pes_size);
+  // Parse the header of a PES packet, return true if successful.
+  // |header_size| is set to the size of the header, or to 0 if
+  // |raw_pes| does not hold the whole header yet.
+  // |media_pts| and |media_dts| are set to the unrolled timestamps, or to
+  // kNoTimestamp if not present.
+  bool ParsePesHeader(const uint8_t* raw_pes,
+                      int raw_pes_size,
+                      int* header_size,
+                      int64_t* media_pts,
+                      int64_t* media_dts);
+
+  // Pass the ES bytes of the current PES to the ES parser, return true if
+  // successful.
+  bool ParseEs(const uint8_t* buf, int size, int64_t pts, int64_t dts);
 
   void ResetPesState();
 
-  // Bytes of the current PES.
-  ByteQueue pes_byte_queue_;
+  // Bytes of the header of the current PES, when it spans several TS
+  // packets. The ES bytes are not reassembled.
+  ByteQueue pes_header_byte_queue_;
+
+  // Whether the header of the current PES has been parsed.
+  bool pes_header_parsed_ = false;
+
+  // Whether the current PES has an unknown stream ID.
+  bool ignore_pes_ = false;
+
+  // The number of ES bytes of the current PES yet to be passed to the ES
+  // parser, or -1 if its size is undefined.
+  int es_bytes_remaining_ = -1;
 
   // ES parser.
   std::unique_ptr<EsParser> es_parser_;
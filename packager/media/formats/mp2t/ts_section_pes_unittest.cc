@@ -0,0 +1,153 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/ts_section_pes.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/media/base/timestamp.h"
+#include "packager/media/formats/mp2t/es_parser.h"
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+const uint32_t kPid = 0x100;
+const int64_t kPts = 90000;
+const uint8_t kVideoStreamId = 0xE0;
+const uint8_t kPaddingStreamId = 0xBE;
+
+// Records the bytes and timestamps passed to the ES parser.
+class RecordingEsParser : public EsParser {
+ public:
+  struct Chunk {
+    std::vector<uint8_t> data;
+    int64_t pts;
+    int64_t dts;
+  };
+
+  explicit RecordingEsParser(std::vector<Chunk>* chunks)
+      : EsParser(kPid), chunks_(chunks) {}
+
+  bool Parse(const uint8_t* buf, int size, int64_t pts, int64_t dts) override {
+    chunks_->push_back({std::vector<uint8_t>(buf, buf + size), pts, dts});
+    return true;
+  }
+  void Flush() override {}
+  void Reset() override {}
+
+ private:
+  std::vector<Chunk>* chunks_;
+};
+
+// Returns a PES with a PTS, followed by |num_trailing_bytes| bytes.
+std::vector<uint8_t> GetPes(uint8_t stream_id,
+                            const std::vector<uint8_t>& es,
+                            size_t num_trailing_bytes) {
+  const size_t kPtsSize = 5;
+  const size_t pes_packet_length = 3 + kPtsSize + es.size();
+  std::vector<uint8_t> pes = {
+      0x00, 0x00, 0x01, stream_id,
+      static_cast<uint8_t>(pes_packet_length >> 8),
+      static_cast<uint8_t>(pes_packet_length),
+      0x80, 0x80, kPtsSize,
+      // '0010', PTS[32..30], marker.
+      static_cast<uint8_t>(0x21 | ((kPts >> 29) & 0x0E)),
+      // PTS[29..15], marker.
+      static_cast<uint8_t>(kPts >> 22),
+      static_cast<uint8_t>(((kPts >> 14) & 0xFE) | 1),
+      // PTS[14..0], marker.
+      static_cast<uint8_t>(kPts >> 7),
+      static_cast<uint8_t>(((kPts << 1) & 0xFE) | 1),
+  };
+  pes.insert(pes.end(), es.begin(), es.end());
+  pes.resize(pes.size() + num_trailing_bytes, 0xFF);
+  return pes;
+}
+
+std::vector<uint8_t> GetEs(size_t size) {
+  std::vector<uint8_t> es(size);
+  for (size_t i = 0; i < es.size(); ++i)
+    es[i] = static_cast<uint8_t>(i);
+  return es;
+}
+
+}  // namespace
+
+class TsSectionPesTest : public ::testing::Test {
+ protected:
+  TsSectionPesTest()
+      : section_(std::unique_ptr<EsParser>(new RecordingEsParser(&chunks_))) {}
+
+  // Parses |pes| as the payloads of TS packets of |payload_sizes| bytes, the
+  // last one taking the rest of |pes|.
+  bool ParsePes(const std::vector<uint8_t>& pes,
+                const std::vector<size_t>& payload_sizes) {
+    size_t offset = 0;
+    for (size_t i = 0; i <= payload_sizes.size(); ++i) {
+      const size_t size = i < payload_sizes.size() ? payload_sizes[i]
+                                                   : pes.size() - offset;
+      if (!section_.Parse(i == 0, pes.data() + offset,
+                          static_cast<int>(size))) {
+        return false;
+      }
+      offset += size;
+    }
+    return true;
+  }
+
+  std::vector<uint8_t> GetParsedEs() const {
+    std::vector<uint8_t> es;
+    for (const RecordingEsParser::Chunk& chunk : chunks_)
+      es.insert(es.end(), chunk.data.begin(), chunk.data.end());
+    return es;
+  }
+
+  std::vector<RecordingEsParser::Chunk> chunks_;
+  TsSectionPes section_;
+};
+
+TEST_F(TsSectionPesTest, PassesEsBytesAsTheyArrive) {
+  const std::vector<uint8_t> es = GetEs(400);
+  ASSERT_TRUE(ParsePes(GetPes(kVideoStreamId, es, 10), {184, 184}));
+
+  // One chunk per TS packet, without the header nor the trailing bytes.
+  ASSERT_EQ(3u, chunks_.size());
+  EXPECT_EQ(kPts, chunks_[0].pts);
+  EXPECT_EQ(kNoTimestamp, chunks_[0].dts);
+  EXPECT_EQ(kNoTimestamp, chunks_[1].pts);
+  EXPECT_EQ(kNoTimestamp, chunks_[2].pts);
+  EXPECT_EQ(es, GetParsedEs());
+}
+
+TEST_F(TsSectionPesTest, ReassemblesTheHeader) {
+  const std::vector<uint8_t> es = GetEs(100);
+  ASSERT_TRUE(ParsePes(GetPes(kVideoStreamId, es, 0), {4, 6}));
+
+  ASSERT_FALSE(chunks_.empty());
+  EXPECT_EQ(kPts, chunks_[0].pts);
+  EXPECT_EQ(es, GetParsedEs());
+}
+
+TEST_F(TsSectionPesTest, IgnoresUnknownStreamIds) {
+  ASSERT_TRUE(ParsePes(GetPes(kPaddingStreamId, GetEs(400), 0), {184, 184}));
+  EXPECT_TRUE(chunks_.empty());
+}
+
+TEST_F(TsSectionPesTest, RejectsInvalidStartCode) {
+  std::vector<uint8_t> pes = GetPes(kVideoStreamId, GetEs(100), 0);
+  pes[2] = 0x02;
+  EXPECT_FALSE(ParsePes(pes, {}));
+  EXPECT_TRUE(chunks_.empty());
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
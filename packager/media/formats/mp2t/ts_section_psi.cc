@@ -10,37 +10,33 @@
 
 #include "packager/base/logging.h"
 #include "packager/media/base/bit_reader.h"
+#include "packager/media/formats/mp2t/crc32_mpeg2.h"
 #include "packager/media/formats/mp2t/mp2t_common.h"
 
-static bool IsCrcValid(const uint8_t* buf, int size) {
-  uint32_t crc = 0xffffffffu;
-  const uint32_t kCrcPoly = 0x4c11db7;
-
-  for (int k = 0; k < size; k++) {
-    int nbits = 8;
-    uint32_t data_msb_aligned = buf[k];
-    data_msb_aligned <<= (32 - nbits);
-
-    while (nbits > 0) {
-      if ((data_msb_aligned ^ crc) & 0x80000000) {
-        crc <<= 1;
-        crc ^= kCrcPoly;
-      } else {
-        crc <<= 1;
-      }
-
-      data_msb_aligned <<= 1;
-      nbits--;
-    }
-  }
-
-  return (crc == 0);
-}
-
 namespace shaka {
 namespace media {
 namespace mp2t {
 
+namespace {
+
+// The 8 bytes of the header up to last_section_number, and the CRC_32.
+const int kMinSectionLengthWithId = 12;
+
+// Identifies a section with the syntax of the PAT and the PMT by its table_id,
+// version_number, section_length and CRC_32, which change with its content.
+uint64_t GetSectionId(const uint8_t* raw_psi, int psi_length) {
+  const uint8_t* crc = raw_psi + psi_length - 4;
+  const uint32_t crc32 = (static_cast<uint32_t>(crc[0]) << 24) |
+                         (static_cast<uint32_t>(crc[1]) << 16) |
+                         (static_cast<uint32_t>(crc[2]) << 8) | crc[3];
+  const int version_number = (raw_psi[5] >> 1) & 0x1f;
+  return (static_cast<uint64_t>(raw_psi[0]) << 49) |
+         (static_cast<uint64_t>(version_number) << 44) |
+         (static_cast<uint64_t>(psi_length) << 32) | crc32;
+}
+
+}  // namespace
+
 TsSectionPsi::TsSectionPsi()
     : wait_for_pusi_(true),
       leading_bytes_to_discard_(0) {
@@ -107,13 +103,28 @@ bool TsSectionPsi::Parse(bool payload_unit_start_indicator,
       << psi_length << " vs " << raw_psi_size;
 
   // Verify the CRC.
-  RCHECK(IsCrcValid(raw_psi, psi_length));
+  RCHECK(Crc32Mpeg2(raw_psi, psi_length) == 0);
+
+  // The PAT and the PMT are repeated unchanged several times per second, so
+  // a valid section identical to the last one parsed is not parsed again.
+  const bool has_section_id =
+      (raw_psi[1] & 0x80) != 0 && psi_length >= kMinSectionLengthWithId;
+  const uint64_t section_id =
+      has_section_id ? GetSectionId(raw_psi, psi_length) : 0;
+  if (has_section_id && has_last_section_id_ &&
+      section_id == last_section_id_) {
+    ResetPsiState();
+    return true;
+  }
 
   // Parse the PSI section.
   BitReader bit_reader(raw_psi, raw_psi_size);
   bool status = ParsePsiSection(&bit_reader);
-  if (status)
+  if (status) {
     ResetPsiState();
+    has_last_section_id_ = has_section_id;
+    last_section_id_ = section_id;
+  }
 
   return status;
 }
@@ -124,6 +135,7 @@ void TsSectionPsi::Flush() {
 void TsSectionPsi::Reset() {
   ResetPsiSection();
   ResetPsiState();
+  has_last_section_id_ = false;
 }
 
 void TsSectionPsi::ResetPsiState() {
@@ -5,6 +5,8 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP2T_TS_SECTION_PSI_H_
 #define PACKAGER_MEDIA_FORMATS_MP2T_TS_SECTION_PSI_H_
 
+#include <stdint.h>
+
 #include "packager/base/compiler_specific.h"
 #include "packager/media/base/byte_queue.h"
 #include "packager/media/formats/mp2t/ts_section.h"
@@ -46,6 +48,10 @@ class TsSectionPsi : public TsSection {
   // Number of leading bytes to discard (pointer field).
   int leading_bytes_to_discard_;
 
+  // Identifies the last section parsed, see GetSectionId().
+  bool has_last_section_id_ = false;
+  uint64_t last_section_id_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(TsSectionPsi);
 };
 
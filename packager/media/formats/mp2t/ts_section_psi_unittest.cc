@@ -0,0 +1,95 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/ts_section_psi.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/media/formats/mp2t/crc32_mpeg2.h"
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+class CountingTsSectionPsi : public TsSectionPsi {
+ public:
+  bool ParsePsiSection(BitReader* bit_reader) override {
+    ++num_parsed_sections;
+    return true;
+  }
+  void ResetPsiSection() override {}
+
+  int num_parsed_sections = 0;
+};
+
+// Returns the payload of a TS packet with a PAT, starting with the pointer
+// field.
+std::vector<uint8_t> GetPatPayload(int version_number, int pmt_pid) {
+  std::vector<uint8_t> payload = {
+      0x00,  // pointer_field.
+      0x00, 0xB0, 0x0D, 0x00, 0x00,
+      static_cast<uint8_t>(0xC1 | (version_number << 1)),
+      0x00, 0x00, 0x00, 0x01,
+      static_cast<uint8_t>(0xE0 | (pmt_pid >> 8)),
+      static_cast<uint8_t>(pmt_pid),
+  };
+  const uint32_t crc = Crc32Mpeg2(payload.data() + 1, payload.size() - 1);
+  for (int shift = 24; shift >= 0; shift -= 8)
+    payload.push_back(static_cast<uint8_t>(crc >> shift));
+  return payload;
+}
+
+bool ParsePayload(const std::vector<uint8_t>& payload, TsSectionPsi* section) {
+  const bool kPayloadUnitStartIndicator = true;
+  return section->Parse(kPayloadUnitStartIndicator, payload.data(),
+                        static_cast<int>(payload.size()));
+}
+
+}  // namespace
+
+TEST(TsSectionPsiTest, SkipsRepeatedSections) {
+  CountingTsSectionPsi section;
+  ASSERT_TRUE(ParsePayload(GetPatPayload(0, 0x20), &section));
+  ASSERT_TRUE(ParsePayload(GetPatPayload(0, 0x20), &section));
+  EXPECT_EQ(1, section.num_parsed_sections);
+
+  // A new version, or new content, is parsed.
+  ASSERT_TRUE(ParsePayload(GetPatPayload(1, 0x20), &section));
+  EXPECT_EQ(2, section.num_parsed_sections);
+  ASSERT_TRUE(ParsePayload(GetPatPayload(1, 0x21), &section));
+  EXPECT_EQ(3, section.num_parsed_sections);
+
+  // A reset section parses the next one again.
+  section.Reset();
+  ASSERT_TRUE(ParsePayload(GetPatPayload(1, 0x21), &section));
+  EXPECT_EQ(4, section.num_parsed_sections);
+}
+
+TEST(TsSectionPsiTest, RejectsInvalidCrc) {
+  CountingTsSectionPsi section;
+  std::vector<uint8_t> payload = GetPatPayload(0, 0x20);
+  payload.back() ^= 1;
+  EXPECT_FALSE(ParsePayload(payload, &section));
+  EXPECT_EQ(0, section.num_parsed_sections);
+}
+
+TEST(TsSectionPsiTest, RejectsInvalidCrcOfRepeatedSection) {
+  CountingTsSectionPsi section;
+  ASSERT_TRUE(ParsePayload(GetPatPayload(0, 0x20), &section));
+  // A corrupted body with the same header and CRC as the last section.
+  std::vector<uint8_t> payload = GetPatPayload(0, 0x20);
+  payload[9] ^= 1;
+  EXPECT_FALSE(ParsePayload(payload, &section));
+  EXPECT_EQ(1, section.num_parsed_sections);
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
@@ -8,12 +8,15 @@
 
 #include <memory>
 
+#include "packager/base/strings/string_util.h"
+#include "packager/file/file.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/event/muxer_listener.h"
 #include "packager/media/formats/mp2t/pes_packet.h"
 #include "packager/media/formats/mp2t/program_map_table_writer.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/status.h"
 #include "packager/status_macros.h"
 
@@ -22,7 +25,7 @@ namespace media {
 namespace mp2t {
 
 namespace {
-const double kTsTimescale = 90000;
+const uint32_t kTsTimescale = 90000;
 
 bool IsAudioCodec(Codec codec) {
   return codec >= kCodecAudio && codec < kCodecAudioMaxPlusOne;
@@ -32,22 +35,78 @@ bool IsVideoCodec(Codec codec) {
   return codec >= kCodecVideo && codec < kCodecVideoMaxPlusOne;
 }
 
+// Creates the PMT writer of a stream from its first |sample|.
+Status CreatePmtWriter(Codec codec,
+                       const std::vector<uint8_t>& audio_codec_config,
+                       const MediaSample& sample,
+                       std::unique_ptr<ProgramMapTableWriter>* pmt_writer) {
+  if (codec == kCodecAC3) {
+    // https://goo.gl/N7Tvqi MPEG-2 Stream Encryption Format for HTTP Live
+    // Streaming 2.3.2.2 AC-3 Setup: For AC-3, the setup_data in the
+    // audio_setup_information is the first 10 bytes of the audio data (the
+    // syncframe()).
+    // For unencrypted AC3, the setup_data is not used, so what is in there
+    // does not matter.
+    const size_t kSetupDataSize = 10u;
+    if (sample.data_size() < kSetupDataSize) {
+      LOG(ERROR) << "Sample is too small for AC3: " << sample.data_size();
+      return Status(error::MUXER_FAILURE, "Sample is too small for AC3.");
+    }
+    const std::vector<uint8_t> setup_data(sample.data(),
+                                          sample.data() + kSetupDataSize);
+    pmt_writer->reset(new AudioProgramMapTableWriter(codec, setup_data));
+  } else if (IsAudioCodec(codec)) {
+    pmt_writer->reset(
+        new AudioProgramMapTableWriter(codec, audio_codec_config));
+  } else {
+    DCHECK(IsVideoCodec(codec));
+    pmt_writer->reset(new VideoProgramMapTableWriter(codec));
+  }
+  return Status::OK;
+}
+
+uint64_t GetDts(const PesPacket& pes_packet) {
+  return pes_packet.has_dts() ? pes_packet.dts() : pes_packet.pts();
+}
+
 }  // namespace
 
 TsSegmenter::TsSegmenter(const MuxerOptions& options, MuxerListener* listener)
+    : TsSegmenter(options, listener, 1) {}
+
+TsSegmenter::TsSegmenter(const MuxerOptions& options,
+                         MuxerListener* listener,
+                         size_t num_streams)
     : muxer_options_(options),
       listener_(listener),
       transport_stream_timestamp_offset_(
-          options.transport_stream_timestamp_offset_ms * kTsTimescale / 1000),
-      pes_packet_generator_(
-          new PesPacketGenerator(transport_stream_timestamp_offset_)) {}
+          TimestampRescaler(1000, kTsTimescale)
+              .Rescale(options.transport_stream_timestamp_offset_ms)),
+      streams_(num_streams),
+      segment_number_(options.first_segment_index),
+      number_from_timeline_(options.segment_number_from_timeline) {
+  DCHECK_GT(num_streams, 0u);
+  // The PIDs of the elementary streams are 8 bits.
+  DCHECK_LE(ProgramMapTableWriter::kElementaryPid + num_streams, 0xFFu);
+  for (ElementaryStream& stream : streams_) {
+    stream.pes_packet_generator.reset(
+        new PesPacketGenerator(transport_stream_timestamp_offset_));
+  }
+}
 
 TsSegmenter::~TsSegmenter() {}
 
 Status TsSegmenter::Initialize(const StreamInfo& stream_info) {
+  return InitializeStream(0, stream_info);
+}
+
+Status TsSegmenter::InitializeStream(size_t stream_index,
+                                     const StreamInfo& stream_info) {
+  DCHECK_LT(stream_index, streams_.size());
+  ElementaryStream& stream = streams_[stream_index];
   if (muxer_options_.segment_template.empty())
     return Status(error::MUXER_FAILURE, "Segment template not specified.");
-  if (!pes_packet_generator_->Initialize(stream_info)) {
+  if (!stream.pes_packet_generator->Initialize(stream_info)) {
     return Status(error::MUXER_FAILURE,
                   "Failed to initialize PesPacketGenerator.");
   }
@@ -60,11 +119,16 @@ Status TsSegmenter::Initialize(const StreamInfo& stream_info) {
     return Status(error::MUXER_FAILURE, "Unsupported stream type.");
   }
 
-  codec_ = stream_info.codec();
+  stream.codec = stream_info.codec();
   if (stream_type == StreamType::kStreamAudio)
-    audio_codec_config_ = stream_info.codec_config();
-
-  timescale_scale_ = kTsTimescale / stream_info.time_scale();
+    stream.audio_codec_config = stream_info.codec_config();
+
+  stream.to_ts_timescale =
+      TimestampRescaler(stream_info.time_scale(), kTsTimescale);
+  // |segment_buffer_| is reused across segments, so it is sized only once.
+  estimated_segment_size_ +=
+      EstimateSegmentSize(muxer_options_, {&stream_info});
+  segment_buffer_.Reserve(estimated_segment_size_);
   return Status::OK;
 }
 
@@ -73,44 +137,55 @@ Status TsSegmenter::Finalize() {
 }
 
 Status TsSegmenter::AddSample(const MediaSample& sample) {
-  if (!ts_writer_) {
-    std::unique_ptr<ProgramMapTableWriter> pmt_writer;
-    if (codec_ == kCodecAC3) {
-      // https://goo.gl/N7Tvqi MPEG-2 Stream Encryption Format for HTTP Live
-      // Streaming 2.3.2.2 AC-3 Setup: For AC-3, the setup_data in the
-      // audio_setup_information is the first 10 bytes of the audio data (the
-      // syncframe()).
-      // For unencrypted AC3, the setup_data is not used, so what is in there
-      // does not matter.
-      const size_t kSetupDataSize = 10u;
-      if (sample.data_size() < kSetupDataSize) {
-        LOG(ERROR) << "Sample is too small for AC3: " << sample.data_size();
-        return Status(error::MUXER_FAILURE, "Sample is too small for AC3.");
-      }
-      const std::vector<uint8_t> setup_data(sample.data(),
-                                            sample.data() + kSetupDataSize);
-      pmt_writer.reset(new AudioProgramMapTableWriter(codec_, setup_data));
-    } else if (IsAudioCodec(codec_)) {
-      pmt_writer.reset(
-          new AudioProgramMapTableWriter(codec_, audio_codec_config_));
-    } else {
-      DCHECK(IsVideoCodec(codec_));
-      pmt_writer.reset(new VideoProgramMapTableWriter(codec_));
-    }
-    ts_writer_.reset(new TsWriter(std::move(pmt_writer)));
+  return AddSample(0, sample);
+}
+
+Status TsSegmenter::AddSample(size_t stream_index, const MediaSample& sample) {
+  DCHECK_LT(stream_index, streams_.size());
+  ElementaryStream& stream = streams_[stream_index];
+  if (!ts_writer_ && !stream.pmt_writer) {
+    RETURN_IF_ERROR(CreatePmtWriter(stream.codec, stream.audio_codec_config,
+                                    sample, &stream.pmt_writer));
+    if (streams_.size() == 1)
+      ts_writer_.reset(new TsWriter(std::move(stream.pmt_writer)));
+    else
+      RETURN_IF_ERROR(CreateTsWriterIfReady());
   }
 
-  if (sample.is_encrypted())
+  if (sample.is_encrypted()) {
+    if (streams_.size() > 1) {
+      return Status(error::MUXER_FAILURE,
+                    "Cannot mux encrypted samples with other streams.");
+    }
     ts_writer_->SignalEncrypted();
+  }
 
-  if (!segment_started_ && !sample.is_key_frame())
+  if (streams_.size() == 1 && !segment_started_ && !sample.is_key_frame())
     LOG(WARNING) << "A segment will start with a non key frame.";
 
-  if (!pes_packet_generator_->PushSample(sample)) {
+  if (!stream.pes_packet_generator->PushSample(sample)) {
     return Status(error::MUXER_FAILURE,
                   "Failed to add sample to PesPacketGenerator.");
   }
-  return WritePesPackets();
+  if (streams_.size() == 1)
+    return WritePesPackets();
+  PullPesPackets(&stream);
+  return WriteInterleavedPesPackets();
+}
+
+Status TsSegmenter::FinishStream(size_t stream_index) {
+  DCHECK_LT(stream_index, streams_.size());
+  // A single stream is flushed by FinalizeSegment().
+  if (streams_.size() == 1)
+    return Status::OK;
+  ElementaryStream& stream = streams_[stream_index];
+  if (!stream.pes_packet_generator->Flush())
+    return Status(error::MUXER_FAILURE, "Failed to flush PesPacketGenerator.");
+  PullPesPackets(&stream);
+  stream.finished = true;
+  if (!ts_writer_)
+    RETURN_IF_ERROR(CreateTsWriterIfReady());
+  return WriteInterleavedPesPackets();
 }
 
 void TsSegmenter::InjectTsWriterForTesting(std::unique_ptr<TsWriter> writer) {
@@ -119,7 +194,7 @@ void TsSegmenter::InjectTsWriterForTesting(std::unique_ptr<TsWriter> writer) {
 
 void TsSegmenter::InjectPesPacketGeneratorForTesting(
     std::unique_ptr<PesPacketGenerator> generator) {
-  pes_packet_generator_ = std::move(generator);
+  streams_[0].pes_packet_generator = std::move(generator);
 }
 
 void TsSegmenter::SetSegmentStartedForTesting(bool value) {
@@ -137,37 +212,149 @@ Status TsSegmenter::StartSegmentIfNeeded(int64_t next_pts) {
 }
 
 Status TsSegmenter::WritePesPackets() {
-  while (pes_packet_generator_->NumberOfReadyPesPackets() > 0u) {
+  PesPacketGenerator* pes_packet_generator =
+      streams_[0].pes_packet_generator.get();
+  while (pes_packet_generator->NumberOfReadyPesPackets() > 0u) {
     std::unique_ptr<PesPacket> pes_packet =
-        pes_packet_generator_->GetNextPesPacket();
+        pes_packet_generator->GetNextPesPacket();
 
     Status status = StartSegmentIfNeeded(pes_packet->pts());
     if (!status.ok())
       return status;
 
-    if (listener_ && IsVideoCodec(codec_) && pes_packet->is_key_frame()) {
+    const uint64_t start_pos = segment_buffer_.Size();
+    if (!ts_writer_->AddPesPacket(*pes_packet, &segment_buffer_))
+      return Status(error::MUXER_FAILURE, "Failed to add PES packet.");
+
+    if (listener_ && IsVideoCodec(streams_[0].codec) &&
+        pes_packet->is_key_frame()) {
+      const uint64_t end_pos = segment_buffer_.Size();
+      listener_->OnKeyFrame(pes_packet->pts(), start_pos, end_pos - start_pos);
+    }
+    // The packet and its data are reused for the next samples.
+    pes_packet_generator->ReleasePesPacket(std::move(pes_packet));
+  }
+  return Status::OK;
+}
 
-      uint64_t start_pos = segment_buffer_.Size();	    
-      const int64_t timestamp = pes_packet->pts();
-      if (!ts_writer_->AddPesPacket(std::move(pes_packet), &segment_buffer_))
-        return Status(error::MUXER_FAILURE, "Failed to add PES packet.");
+void TsSegmenter::PullPesPackets(ElementaryStream* stream) {
+  while (stream->pes_packet_generator->NumberOfReadyPesPackets() > 0u) {
+    stream->pes_packets.push_back(
+        stream->pes_packet_generator->GetNextPesPacket());
+    ++stream->num_pes_packets;
+  }
+}
 
-      uint64_t end_pos = segment_buffer_.Size();
-      
-      listener_->OnKeyFrame(timestamp, start_pos, end_pos - start_pos);
-    } else {
-      if (!ts_writer_->AddPesPacket(std::move(pes_packet), &segment_buffer_))
-        return Status(error::MUXER_FAILURE, "Failed to add PES packet.");
+Status TsSegmenter::CreateTsWriterIfReady() {
+  DCHECK(!ts_writer_);
+  for (const ElementaryStream& stream : streams_) {
+    if (!stream.pmt_writer && !stream.finished)
+      return Status::OK;
+  }
+  std::unique_ptr<ProgramMapTableWriter> pmt_writer =
+      std::move(streams_[0].pmt_writer);
+  for (size_t i = 1; i < streams_.size(); ++i) {
+    if (!streams_[i].pmt_writer)
+      continue;
+    if (!pmt_writer) {
+      return Status(error::MUXER_FAILURE,
+                    "The first stream, which carries the PCR, has no samples.");
     }
+    pmt_writer->AddElementaryStream(
+        static_cast<uint8_t>(ProgramMapTableWriter::kElementaryPid + i),
+        std::move(streams_[i].pmt_writer));
   }
+  // No samples at all.
+  if (!pmt_writer)
+    return Status::OK;
+  ts_writer_.reset(new TsWriter(std::move(pmt_writer)));
   return Status::OK;
 }
 
+Status TsSegmenter::WriteInterleavedPesPackets() {
+  if (!ts_writer_)
+    return Status::OK;
+  while (true) {
+    // The next PES packet is the one with the lowest DTS, which is known only
+    // if all the streams which are not finished have PES packets queued.
+    size_t next_index = streams_.size();
+    bool blocked = false;
+    // True if no more PES packets will come from the streams other than the
+    // first.
+    bool others_drained = true;
+    for (size_t i = 0; i < streams_.size(); ++i) {
+      const ElementaryStream& stream = streams_[i];
+      if (i > 0 && !(stream.finished && stream.pes_packets.empty()))
+        others_drained = false;
+      if (stream.pes_packets.empty()) {
+        if (!stream.finished)
+          blocked = true;
+        continue;
+      }
+      if (next_index == streams_.size() ||
+          GetDts(*stream.pes_packets.front()) <
+              GetDts(*streams_[next_index].pes_packets.front())) {
+        next_index = i;
+      }
+    }
+
+    // A pending segment ends before the next PES packet of the first stream,
+    // once the PES packets of the other streams before it are written.
+    if (!pending_segments_.empty() &&
+        streams_[0].num_written_pes_packets ==
+            pending_segments_.front().end_pes_packet_index &&
+        (others_drained || (!blocked && next_index == 0))) {
+      const PendingSegment segment = pending_segments_.front();
+      pending_segments_.pop_front();
+      if (segment_started_) {
+        segment_start_timestamp_ =
+            streams_[0].to_ts_timescale.Rescale(segment.start_timestamp) +
+            transport_stream_timestamp_offset_;
+        RETURN_IF_ERROR(
+            WriteSegment(segment.start_timestamp, segment.duration));
+      }
+      continue;
+    }
+    if (blocked || next_index == streams_.size())
+      return Status::OK;
+
+    ElementaryStream& stream = streams_[next_index];
+    std::unique_ptr<PesPacket> pes_packet =
+        std::move(stream.pes_packets.front());
+    stream.pes_packets.pop_front();
+
+    RETURN_IF_ERROR(StartSegmentIfNeeded(pes_packet->pts()));
+    const uint64_t start_pos = segment_buffer_.Size();
+    if (!ts_writer_->AddPesPacketToStream(next_index, *pes_packet,
+                                          &segment_buffer_)) {
+      return Status(error::MUXER_FAILURE, "Failed to add PES packet.");
+    }
+    if (next_index == 0) {
+      ++stream.num_written_pes_packets;
+      if (listener_ && IsVideoCodec(stream.codec) &&
+          pes_packet->is_key_frame()) {
+        const uint64_t end_pos = segment_buffer_.Size();
+        listener_->OnKeyFrame(pes_packet->pts(), start_pos,
+                              end_pos - start_pos);
+      }
+    }
+    // The packet and its data are reused for the next samples.
+    stream.pes_packet_generator->ReleasePesPacket(std::move(pes_packet));
+  }
+}
+
 Status TsSegmenter::FinalizeSegment(uint64_t start_timestamp,
                                     uint64_t duration) {
-  if (!pes_packet_generator_->Flush()) {
+  ElementaryStream& stream = streams_[0];
+  if (!stream.pes_packet_generator->Flush()) {
     return Status(error::MUXER_FAILURE, "Failed to flush PesPacketGenerator.");
   }
+  if (streams_.size() > 1) {
+    PullPesPackets(&stream);
+    pending_segments_.push_back(
+        {start_timestamp, duration, stream.num_pes_packets});
+    return WriteInterleavedPesPackets();
+  }
   Status status = WritePesPackets();
   if (!status.ok())
     return status;
@@ -176,9 +363,25 @@ Status TsSegmenter::FinalizeSegment(uint64_t start_timestamp,
   // be false.
   if (!segment_started_)
     return Status::OK;
+  return WriteSegment(start_timestamp, duration);
+}
+
+Status TsSegmenter::WriteSegment(uint64_t start_timestamp, uint64_t duration) {
+  if (number_from_timeline_) {
+    segment_number_ = GetTimelineSegmentIndex(
+        muxer_options_.segment_duration_in_seconds,
+        streams_[0].to_ts_timescale.Rescale(start_timestamp), kTsTimescale);
+    number_from_timeline_ = false;
+  }
+  // The segments sent to a UDP destination share the url.
   std::string segment_path =
-        GetSegmentName(muxer_options_.segment_template, segment_start_timestamp_,
-                       segment_number_++, muxer_options_.bandwidth);
+      base::StartsWith(muxer_options_.segment_template, kUdpFilePrefix,
+                       base::CompareCase::SENSITIVE)
+          ? muxer_options_.segment_template
+          : GetSegmentName(muxer_options_.segment_template,
+                           segment_start_timestamp_, segment_number_,
+                           muxer_options_.bandwidth);
+  ++segment_number_;
 
   const int64_t file_size = segment_buffer_.Size();
   std::unique_ptr<File, FileCloser> segment_file;	  
@@ -190,7 +393,12 @@ Status TsSegmenter::FinalizeSegment(uint64_t start_timestamp,
   
   RETURN_IF_ERROR(segment_buffer_.WriteToFile(segment_file.get()));
 
-  if (!segment_file.release()->Close()) {
+  bool closed = false;
+  {
+    ScopedTraceEvent trace_event("CloseSegmentFile", "io");
+    closed = segment_file.release()->Close();
+  }
+  if (!closed) {
     return Status(
         error::FILE_FAILURE,
         "Cannot close file " + segment_path +
@@ -198,10 +406,11 @@ Status TsSegmenter::FinalizeSegment(uint64_t start_timestamp,
   }
 
   if (listener_) {
+    const TimestampRescaler& to_ts_timescale = streams_[0].to_ts_timescale;
     listener_->OnNewSegment(segment_path,
-                            start_timestamp * timescale_scale_ +
+                            to_ts_timescale.Rescale(start_timestamp) +
                                 transport_stream_timestamp_offset_,
-                            duration * timescale_scale_, file_size);
+                            to_ts_timescale.Rescale(duration), file_size);
   }
   segment_started_ = false;
   
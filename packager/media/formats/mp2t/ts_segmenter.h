@@ -7,9 +7,11 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP2T_TS_SEGMENTER_H_
 #define PACKAGER_MEDIA_FORMATS_MP2T_TS_SEGMENTER_H_
 
+#include <deque>
 #include <memory>
 #include "packager/file/file.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/base/timestamp_rescaler.h"
 #include "packager/media/formats/mp2t/pes_packet_generator.h"
 #include "packager/media/formats/mp2t/ts_writer.h"
 #include "packager/status.h"
@@ -33,6 +35,14 @@ class TsSegmenter {
   /// @param listener is the MuxerListener that should be used to notify events.
   ///        This may be null, in which case no events are sent.
   TsSegmenter(const MuxerOptions& options, MuxerListener* listener);
+  /// Create a segmenter which muxes several elementary streams into the single
+  /// program of its output. The PES packets of the streams are interleaved by
+  /// DTS, and the segments are those of the first stream, which carries the
+  /// PCR. The listener is notified of the first stream only.
+  /// @param num_streams is the number of elementary streams.
+  TsSegmenter(const MuxerOptions& options,
+              MuxerListener* listener,
+              size_t num_streams);
   ~TsSegmenter();
 
   /// Initialize the object.
@@ -40,6 +50,11 @@ class TsSegmenter {
   /// @return OK on success.
   Status Initialize(const StreamInfo& stream_info);
 
+  /// Initialize the elementary stream at @a stream_index.
+  /// @param stream_info is the stream info of the elementary stream.
+  /// @return OK on success.
+  Status InitializeStream(size_t stream_index, const StreamInfo& stream_info);
+
   /// Finalize the segmenter.
   /// @return OK on success.
   Status Finalize();
@@ -48,9 +63,23 @@ class TsSegmenter {
   /// @return OK on success.
   Status AddSample(const MediaSample& sample);
 
+  /// @param sample of the elementary stream at @a stream_index gets added to
+  ///        this object.
+  /// @return OK on success.
+  Status AddSample(size_t stream_index, const MediaSample& sample);
+
+  /// Signal that there are no more samples for the elementary stream at
+  /// @a stream_index. With more than one stream, the last segment is written
+  /// once all the streams are finished.
+  /// @return OK on success.
+  Status FinishStream(size_t stream_index);
+
   /// Flush all the samples that are (possibly) buffered and write them to the
   /// current segment, this will close the file. If a file is not already opened
-  /// before calling this, this will open one and write them to file.
+  /// before calling this, this will open one and write them to file. With more
+  /// than one stream, this ends the segment of the first stream, and the
+  /// segment is written once the PES packets of the other streams before the
+  /// end of the segment are written.
   /// @param start_timestamp is the segment's start timestamp in the input
   ///        stream's time scale.
   /// @param duration is the segment's duration in the input stream's time
@@ -71,25 +100,68 @@ class TsSegmenter {
   void SetSegmentStartedForTesting(bool value);
   
  private:
+  // An elementary stream of the program.
+  struct ElementaryStream {
+    // Codec for the stream.
+    Codec codec = kUnknownCodec;
+    std::vector<uint8_t> audio_codec_config;
+    // Converts the timestamps of the input stream to TS's timescale (which is
+    // 90000). Used for calculating the duration in seconds fo the current
+    // segment.
+    TimestampRescaler to_ts_timescale;
+    std::unique_ptr<PesPacketGenerator> pes_packet_generator;
+
+    // The following are only used with more than one stream.
+    // The PMT writer of the stream, until |ts_writer_| is created.
+    std::unique_ptr<ProgramMapTableWriter> pmt_writer;
+    // The PES packets waiting to be interleaved with the other streams.
+    std::deque<std::unique_ptr<PesPacket>> pes_packets;
+    uint64_t num_pes_packets = 0;
+    uint64_t num_written_pes_packets = 0;
+    bool finished = false;
+  };
+
+  // A segment of the first stream, to be written once the PES packets of the
+  // other streams before its end are written.
+  struct PendingSegment {
+    uint64_t start_timestamp;
+    uint64_t duration;
+    // The number of PES packets of the first stream up to the end of the
+    // segment.
+    uint64_t end_pes_packet_index;
+  };
+
   Status StartSegmentIfNeeded(int64_t next_pts);
 
   // Writes PES packets (carried in TsPackets) to a buffer.
   Status WritePesPackets();
 
+  // Moves the ready PES packets of |stream| to its queue.
+  void PullPesPackets(ElementaryStream* stream);
+  // Creates |ts_writer_| once the PMT writers of all the streams with samples
+  // are created.
+  Status CreateTsWriterIfReady();
+  // Writes the queued PES packets of the streams, in DTS order, and the
+  // pending segments they complete.
+  Status WriteInterleavedPesPackets();
+
+  // Writes the current segment to its file.
+  Status WriteSegment(uint64_t start_timestamp, uint64_t duration);
+
   const MuxerOptions& muxer_options_;
   MuxerListener* const listener_;
 
-  // Codec for the stream.
-  Codec codec_ = kUnknownCodec;
-  std::vector<uint8_t> audio_codec_config_;
-
   const uint32_t transport_stream_timestamp_offset_ = 0;
-  // Scale used to scale the input stream to TS's timesccale (which is 90000).
-  // Used for calculating the duration in seconds fo the current segment.
-  double timescale_scale_ = 1.0;
+
+  std::vector<ElementaryStream> streams_;
+  std::deque<PendingSegment> pending_segments_;
+  uint64_t estimated_segment_size_ = 0;
 
   // Used for segment template.
   uint64_t segment_number_ = 0;
+  // Whether |segment_number_| is still to be derived from the start time of
+  // the first segment, see MuxerOptions::segment_number_from_timeline.
+  bool number_from_timeline_ = false;
 
   std::unique_ptr<TsWriter> ts_writer_;
  
@@ -98,7 +170,6 @@ class TsSegmenter {
   // Set to true if segment_buffer_ is initialized, set to false after
   // FinalizeSegment() succeeds.
   bool segment_started_ = false;
-  std::unique_ptr<PesPacketGenerator> pes_packet_generator_;
 
   int64_t segment_start_timestamp_ = -1;
   DISALLOW_COPY_AND_ASSIGN(TsSegmenter);
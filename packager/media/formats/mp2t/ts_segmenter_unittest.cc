@@ -7,6 +7,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/file/file.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/event/mock_muxer_listener.h"
@@ -54,6 +55,48 @@ const uint8_t kAnyData[] = {
     0x01, 0x0F, 0x3C,
 };
 
+// AAC basic profile.
+const uint8_t kAacExtraData[] = {0x12, 0x10};
+const uint8_t kSampleBits = 16;
+const uint8_t kNumChannels = 2;
+const uint32_t kSamplingFrequency = 44100;
+const uint64_t kSeekPreroll = 0;
+const uint64_t kCodecDelay = 0;
+const uint32_t kMaxBitrate = 320000;
+const uint32_t kAverageBitrate = 256000;
+const char kAacCodecString[] = "mp4a.40.2";
+
+std::shared_ptr<AudioStreamInfo> CreateAacStreamInfo() {
+  return std::make_shared<AudioStreamInfo>(
+      kTrackId, kTimeScale, kDuration, kCodecAAC, kAacCodecString,
+      kAacExtraData, arraysize(kAacExtraData), kSampleBits, kNumChannels,
+      kSamplingFrequency, kSeekPreroll, kCodecDelay, kMaxBitrate,
+      kAverageBitrate, kLanguage, kIsEncrypted);
+}
+
+std::shared_ptr<MediaSample> CreateSample(int64_t timestamp) {
+  std::shared_ptr<MediaSample> sample =
+      MediaSample::CopyFrom(kAnyData, arraysize(kAnyData), kIsKeyFrame);
+  sample->set_dts(timestamp);
+  sample->set_pts(timestamp);
+  sample->set_duration(3000);
+  return sample;
+}
+
+// @return the PIDs of the TS packets of the file at |path|.
+std::vector<int> GetPids(const std::string& path) {
+  const size_t kTsPacketSize = 188;
+  std::string content;
+  EXPECT_TRUE(File::ReadFileToString(path.c_str(), &content));
+  EXPECT_EQ(0u, content.size() % kTsPacketSize);
+  std::vector<int> pids;
+  for (size_t i = 0; i + kTsPacketSize <= content.size(); i += kTsPacketSize) {
+    pids.push_back((static_cast<uint8_t>(content[i + 1]) & 0x1F) << 8 |
+                   static_cast<uint8_t>(content[i + 2]));
+  }
+  return pids;
+}
+
 class MockPesPacketGenerator : public PesPacketGenerator {
  public:
   MockPesPacketGenerator()
@@ -85,14 +128,12 @@ class MockTsWriter : public TsWriter {
   MOCK_METHOD1(NewSegment, bool(BufferWriter* buffer_writer));
   MOCK_METHOD0(SignalEncrypted, void());
 
-  // Similar to the hack above but takes a std::unique_ptr.
-  MOCK_METHOD2(AddPesPacketMock, bool(PesPacket* pes_packet,
-			  BufferWriter* buffer_writer));
-  bool AddPesPacket(std::unique_ptr<PesPacket> pes_packet,
-		  BufferWriter* buffer_writer) override {
-     buffer_writer->AppendArray(kAnyData, arraysize(kAnyData));
-    // No need to keep the pes packet around for the current tests.
-    return AddPesPacketMock(pes_packet.get(), buffer_writer);
+  MOCK_METHOD2(AddPesPacketMock, bool(const PesPacket* pes_packet,
+                                      BufferWriter* buffer_writer));
+  bool AddPesPacket(const PesPacket& pes_packet,
+                    BufferWriter* buffer_writer) override {
+    buffer_writer->AppendArray(kAnyData, arraysize(kAnyData));
+    return AddPesPacketMock(&pes_packet, buffer_writer);
   }
 };
 
@@ -411,6 +452,46 @@ TEST_F(TsSegmenterTest, EncryptedSample) {
   EXPECT_OK(segmenter.AddSample(*sample2));
 }
 
+// Verify that the PES packets of the streams are interleaved by DTS, in the
+// segments of the first stream.
+TEST_F(TsSegmenterTest, MultiplexedStreams) {
+  MuxerOptions options;
+  options.segment_template = "memory://multiplexed/file$Number$.ts";
+  const size_t kNumStreams = 2;
+  TsSegmenter segmenter(options, nullptr, kNumStreams);
+
+  ASSERT_OK(segmenter.InitializeStream(0, *CreateAacStreamInfo()));
+  ASSERT_OK(segmenter.InitializeStream(1, *CreateAacStreamInfo()));
+
+  EXPECT_OK(segmenter.AddSample(0, *CreateSample(0)));
+  EXPECT_OK(segmenter.AddSample(1, *CreateSample(1000)));
+  EXPECT_OK(segmenter.AddSample(0, *CreateSample(3000)));
+  EXPECT_OK(segmenter.AddSample(1, *CreateSample(4000)));
+  EXPECT_OK(segmenter.FinalizeSegment(0, 6000));
+  EXPECT_OK(segmenter.AddSample(0, *CreateSample(6000)));
+  // The first segment is written once the PES packets of the second stream
+  // before its end are written.
+  EXPECT_OK(segmenter.AddSample(1, *CreateSample(7000)));
+  EXPECT_OK(segmenter.FinalizeSegment(6000, 3000));
+  EXPECT_OK(segmenter.FinishStream(0));
+  EXPECT_OK(segmenter.AddSample(1, *CreateSample(10000)));
+  EXPECT_OK(segmenter.FinishStream(1));
+  EXPECT_OK(segmenter.Finalize());
+
+  const int kPatPid = 0x00;
+  const int kPmtPid = ProgramMapTableWriter::kPmtPid;
+  const int kFirstPid = ProgramMapTableWriter::kElementaryPid;
+  const int kSecondPid = kFirstPid + 1;
+  EXPECT_EQ(std::vector<int>({kPatPid, kPmtPid, kFirstPid, kSecondPid,
+                              kFirstPid, kSecondPid}),
+            GetPids("memory://multiplexed/file1.ts"));
+  // The samples of the second stream after the end of the first stream are in
+  // the last segment.
+  EXPECT_EQ(std::vector<int>(
+                {kPatPid, kPmtPid, kFirstPid, kSecondPid, kSecondPid}),
+            GetPids("memory://multiplexed/file2.ts"));
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -56,13 +56,14 @@ const int kTsPacketMaximumPayloadSize =
 
 const size_t kMaxPesPacketLengthValue = 0xFFFF;
 
-void WritePatToBuffer(const uint8_t* pat,
-                      int pat_size,
-                      ContinuityCounter* continuity_counter,
-                      BufferWriter* writer) {
+// Puts |kPat| into TS packets, to be written with WritePacketsToBufferWriter.
+void PacketizePat(BufferWriter* pat_packets) {
   const int kPatPid = 0;
-  WritePayloadToBufferWriter(pat, pat_size, kPayloadUnitStartIndicator, kPatPid,
-                             !kHasPcr, 0, continuity_counter, writer);
+  // The continuity counters are renumbered when the packets are written.
+  ContinuityCounter any_continuity_counter;
+  WritePayloadToBufferWriter(kPat, arraysize(kPat), kPayloadUnitStartIndicator,
+                             kPatPid, !kHasPcr, 0, &any_continuity_counter,
+                             pat_packets);
 }
 
 // The only difference between writing PTS or DTS is the leading bits.
@@ -87,7 +88,10 @@ void WritePtsOrDts(uint8_t leading_bits,
   writer->AppendInt(fifth_byte);
 }
 
+// |has_pcr| is true only for the elementary stream with the PCR PID.
 bool WritePesToBuffer(const PesPacket& pes,
+                      int pid,
+                      bool has_pcr,
                       ContinuityCounter* continuity_counter,
                       BufferWriter* current_buffer) {
   // The size of the length field.
@@ -99,10 +103,9 @@ bool WritePesToBuffer(const PesPacket& pes,
       kTsPacketMaximumPayloadSize - kAdaptationFieldLengthSize -
       kAdaptationFieldHeaderSize - kPcrFieldSize;
   const uint64_t pcr_base = pes.has_dts() ? pes.dts() : pes.pts();
-  const int pid = ProgramMapTableWriter::kElementaryPid;
 
   // This writer will hold part of PES packet after PES_packet_length field.
-  BufferWriter pes_header_writer;
+  BufferWriter pes_header_writer(kTsPacketSize);
   // The first bit must be '10' for PES with video or audio stream id. The other
   // flags (bits) don't matter so they are 0.
   pes_header_writer.AppendInt(static_cast<uint8_t>(0x80));
@@ -136,49 +139,48 @@ bool WritePesToBuffer(const PesPacket& pes,
   first_ts_packet_buffer.AppendBuffer(pes_header_writer);
 
   const size_t available_payload =
-      kTsPacketMaxPayloadWithPcr - first_ts_packet_buffer.Size();
+      (has_pcr ? kTsPacketMaxPayloadWithPcr : kTsPacketMaximumPayloadSize) -
+      first_ts_packet_buffer.Size();
   const size_t bytes_consumed = std::min(pes.data().size(), available_payload);
   first_ts_packet_buffer.AppendArray(pes.data().data(), bytes_consumed);
 
-  BufferWriter output_writer;
+  // The TS packets go straight to the segment buffer.
   WritePayloadToBufferWriter(first_ts_packet_buffer.Buffer(),
                              first_ts_packet_buffer.Size(),
-                             kPayloadUnitStartIndicator, pid, kHasPcr, pcr_base,
-                             continuity_counter, &output_writer);
+                             kPayloadUnitStartIndicator, pid, has_pcr,
+                             pcr_base, continuity_counter, current_buffer);
 
   const size_t remaining_pes_data_size = pes.data().size() - bytes_consumed;
   if (remaining_pes_data_size > 0) {
     WritePayloadToBufferWriter(pes.data().data() + bytes_consumed,
                                remaining_pes_data_size,
                                !kPayloadUnitStartIndicator, pid, !kHasPcr, 0,
-                               continuity_counter, &output_writer);
+                               continuity_counter, current_buffer);
   }
-
-  current_buffer->AppendBuffer(output_writer);
   return true;
 }
 
 }  // namespace
 
 TsWriter::TsWriter(std::unique_ptr<ProgramMapTableWriter> pmt_writer)
-    : pmt_writer_(std::move(pmt_writer)) {}
+    : pat_(kTsPacketSize), pmt_writer_(std::move(pmt_writer)) {
+  PacketizePat(&pat_);
+}
 
 TsWriter::~TsWriter() {}
 
 bool TsWriter::NewSegment(BufferWriter* buffer) {
-
-  BufferWriter psi;
-  WritePatToBuffer(kPat, arraysize(kPat), &pat_continuity_counter_, &psi);
+  WritePacketsToBufferWriter(pat_.Buffer(), pat_.Size(),
+                             &pat_continuity_counter_, buffer);
   if (encrypted_) {
-    if (!pmt_writer_->EncryptedSegmentPmt(&psi)) {
+    if (!pmt_writer_->EncryptedSegmentPmt(buffer)) {
       return false;
     }
   } else {
-    if (!pmt_writer_->ClearSegmentPmt(&psi)) {
+    if (!pmt_writer_->ClearSegmentPmt(buffer)) {
       return false;
     }
   }
-  buffer->AppendBuffer(psi);
 
   return true;
 }
@@ -187,16 +189,23 @@ void TsWriter::SignalEncrypted() {
   encrypted_ = true;
 }
 
-bool TsWriter::AddPesPacket(std::unique_ptr<PesPacket> pes_packet,
-		            BufferWriter* buffer) {
+bool TsWriter::AddPesPacket(const PesPacket& pes_packet,
+                            BufferWriter* buffer) {
+  return AddPesPacketToStream(0, pes_packet, buffer);
+}
 
-  if (!WritePesToBuffer(*pes_packet, &elementary_stream_continuity_counter_,
+bool TsWriter::AddPesPacketToStream(size_t stream_index,
+                                    const PesPacket& pes_packet,
+                                    BufferWriter* buffer) {
+  const int pid =
+      ProgramMapTableWriter::kElementaryPid + static_cast<int>(stream_index);
+  const bool has_pcr = stream_index == 0;
+  if (!WritePesToBuffer(pes_packet, pid, has_pcr,
+                        &elementary_stream_continuity_counters_[stream_index],
                         buffer)) {
     LOG(ERROR) << "Failed to write pes to buffer.";
     return false;
   }
-
-  // No need to keep pes_packet around so not passing it anywhere.
   return true;
 }
 
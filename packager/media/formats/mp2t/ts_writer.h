@@ -40,12 +40,20 @@ class TsWriter {
   /// Signals the writer that the rest of the segments are encrypted.
   virtual void SignalEncrypted();
 
-  /// Add PesPacket to the instance. PesPacket might not be added to the buffer
-  /// immediately.
-  /// @param pes_packet gets added to the writer.
+  /// Put a PesPacket into TS packets and write them to @a buffer.
+  /// @param pes_packet is not needed once this returns, so it can be reused.
   /// @param buffer to write pes packet.
   /// @return true on success, false otherwise.
-  virtual bool AddPesPacket(std::unique_ptr<PesPacket> pes_packet, BufferWriter* buffer);
+  virtual bool AddPesPacket(const PesPacket& pes_packet, BufferWriter* buffer);
+
+  /// Same as AddPesPacket(), but for the elementary stream at @a stream_index
+  /// of a program with several elementary streams, with PID
+  /// ProgramMapTableWriter::kElementaryPid + @a stream_index. Only the
+  /// elementary stream at index 0, which is the one of AddPesPacket(), carries
+  /// the PCR.
+  bool AddPesPacketToStream(size_t stream_index,
+                            const PesPacket& pes_packet,
+                            BufferWriter* buffer);
 
  private:
   TsWriter(const TsWriter&) = delete;
@@ -54,8 +62,11 @@ class TsWriter {
   // True if further segments generated by this instance should be encrypted.
   bool encrypted_ = false;
 
+  // The PAT, already in TS packets.
+  BufferWriter pat_;
   ContinuityCounter pat_continuity_counter_;
-  ContinuityCounter elementary_stream_continuity_counter_;
+  // Continuity counters of the elementary streams, by stream index.
+  std::map<size_t, ContinuityCounter> elementary_stream_continuity_counters_;
 
   std::unique_ptr<ProgramMapTableWriter> pmt_writer_;
 };
@@ -0,0 +1,187 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/formats/mp2t/pes_packet.h"
+#include "packager/media/formats/mp2t/pes_packet_generator.h"
+#include "packager/media/formats/mp2t/program_map_table_writer.h"
+#include "packager/media/formats/mp2t/ts_writer.h"
+#include "packager/media/test/perf_test_util.h"
+#include "packager/media/test/test_data_util.h"
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+const uint8_t kVideoStreamId = 0xE0;
+const int64_t kFrameDuration = 3000;
+const uint32_t kTsTimescale = 90000;
+
+// Packetizes |frames| into a TS segment, one PES packet per frame.
+void MeasurePacketizationThroughput(
+    const std::string& trace,
+    const std::vector<std::vector<uint8_t>>& frames) {
+  size_t total_size = 0;
+  for (const std::vector<uint8_t>& frame : frames)
+    total_size += frame.size();
+  ASSERT_GT(total_size, 0u);
+
+  TsWriter ts_writer(std::unique_ptr<ProgramMapTableWriter>(
+      new VideoProgramMapTableWriter(kCodecH264)));
+  BufferWriter buffer;
+  PesPacket pes;
+  MeasureThroughput("ts_writer_add_pes_packet", trace, total_size, [&]() {
+    buffer.Clear();
+    CHECK(ts_writer.NewSegment(&buffer));
+    int64_t timestamp = 0;
+    for (const std::vector<uint8_t>& frame : frames) {
+      pes.set_stream_id(kVideoStreamId);
+      pes.set_pts(timestamp);
+      pes.set_dts(timestamp);
+      *pes.mutable_data() = frame;
+      CHECK(ts_writer.AddPesPacket(pes, &buffer));
+      timestamp += kFrameDuration;
+    }
+  });
+}
+
+// Converts |samples| to PES packets and packetizes them into a TS segment, as
+// TsSegmenter does.
+void MeasureTsOutputThroughput(
+    const std::string& trace,
+    const StreamInfo& stream_info,
+    std::unique_ptr<ProgramMapTableWriter> pmt_writer,
+    const std::vector<std::shared_ptr<MediaSample>>& samples) {
+  size_t total_size = 0;
+  for (const std::shared_ptr<MediaSample>& sample : samples)
+    total_size += sample->data_size();
+  ASSERT_GT(total_size, 0u);
+
+  const uint32_t kTimestampOffset = 0;
+  PesPacketGenerator generator(kTimestampOffset);
+  ASSERT_TRUE(generator.Initialize(stream_info));
+  TsWriter ts_writer(std::move(pmt_writer));
+  BufferWriter buffer;
+  MeasureThroughput("ts_output", trace, total_size, [&]() {
+    buffer.Clear();
+    CHECK(ts_writer.NewSegment(&buffer));
+    for (const std::shared_ptr<MediaSample>& sample : samples) {
+      CHECK(generator.PushSample(*sample));
+      while (generator.NumberOfReadyPesPackets() > 0) {
+        std::unique_ptr<PesPacket> pes = generator.GetNextPesPacket();
+        CHECK(ts_writer.AddPesPacket(*pes, &buffer));
+        generator.ReleasePesPacket(std::move(pes));
+      }
+    }
+  });
+}
+
+}  // namespace
+
+TEST(TsWriterPerfTest, SyntheticFrames) {
+  const size_t kFrameSize = 50 * 1024;
+  const size_t kFrameCount = 60;
+  std::vector<std::vector<uint8_t>> frames(kFrameCount,
+                                           std::vector<uint8_t>(kFrameSize));
+  for (std::vector<uint8_t>& frame : frames) {
+    for (size_t i = 0; i < frame.size(); ++i)
+      frame[i] = static_cast<uint8_t>(i);
+  }
+  MeasurePacketizationThroughput("synthetic", frames);
+}
+
+TEST(TsWriterPerfTest, RealStream) {
+  // The Annex B stream is split into frame sized chunks; PES packetization
+  // does not depend on the frame boundaries.
+  const size_t kChunkSize = 8 * 1024;
+  const std::vector<uint8_t> stream = ReadTestDataFile("bear.h264");
+  std::vector<std::vector<uint8_t>> frames;
+  for (size_t offset = 0; offset < stream.size(); offset += kChunkSize) {
+    const size_t size = std::min(kChunkSize, stream.size() - offset);
+    frames.emplace_back(stream.begin() + offset,
+                        stream.begin() + offset + size);
+  }
+  MeasurePacketizationThroughput("bear_h264", frames);
+}
+
+TEST(TsWriterPerfTest, H264Samples) {
+  // An avcC with 4 byte NAL unit lengths, and one SPS and one PPS.
+  const uint8_t kAvcDecoderConfig[] = {
+      0x01, 0x00, 0x00, 0x00, 0xFF, 0xE1, 0x00, 0x1D, 0x67, 0x64, 0x00,
+      0x1E, 0xAC, 0xD9, 0x40, 0xB4, 0x2F, 0xF9, 0x7F, 0xF0, 0x00, 0x80,
+      0x00, 0x91, 0x00, 0x00, 0x03, 0x03, 0xE9, 0x00, 0x00, 0xEA, 0x60,
+      0x0F, 0x16, 0x2D, 0x96, 0x01, 0x00, 0x0A, 0x68, 0xFE, 0xFD, 0xFC,
+      0xFB, 0x11, 0x12, 0x13, 0x14, 0x15,
+  };
+  VideoStreamInfo stream_info(
+      0, kTsTimescale, 0, kCodecH264,
+      H26xStreamFormat::kNalUnitStreamWithParameterSetNalus, "avc1",
+      kAvcDecoderConfig, sizeof(kAvcDecoderConfig), 1280, 720, 1, 1, 0, 0, 4,
+      "und", false);
+  // 2 seconds of 8 Mbps video, as single slice NAL units.
+  const size_t kSampleSize = 1000 * 1000 / 30;
+  const size_t kSampleCount = 60;
+  std::vector<std::shared_ptr<MediaSample>> samples;
+  for (size_t i = 0; i < kSampleCount; ++i) {
+    std::vector<uint8_t> data(kSampleSize, 0x5A);
+    const uint32_t nalu_size = static_cast<uint32_t>(kSampleSize - 4);
+    data[0] = static_cast<uint8_t>(nalu_size >> 24);
+    data[1] = static_cast<uint8_t>(nalu_size >> 16);
+    data[2] = static_cast<uint8_t>(nalu_size >> 8);
+    data[3] = static_cast<uint8_t>(nalu_size);
+    // An IDR slice for the first sample, a non IDR slice for the others.
+    data[4] = i == 0 ? 0x65 : 0x41;
+    samples.push_back(MediaSample::CopyFrom(data.data(), data.size(), i == 0));
+    samples.back()->set_dts(i * kFrameDuration);
+    samples.back()->set_pts(i * kFrameDuration);
+  }
+  MeasureTsOutputThroughput(
+      "h264", stream_info,
+      std::unique_ptr<ProgramMapTableWriter>(
+          new VideoProgramMapTableWriter(kCodecH264)),
+      samples);
+}
+
+TEST(TsWriterPerfTest, AacSamples) {
+  // AAC LC, 44.1kHz, stereo.
+  const std::vector<uint8_t> kAudioSpecificConfig = {0x12, 0x10};
+  AudioStreamInfo stream_info(0, kTsTimescale, 0, kCodecAAC, "mp4a.40.2",
+                              kAudioSpecificConfig.data(),
+                              kAudioSpecificConfig.size(), 16, 2, 44100, 0, 0,
+                              0, 0, "und", false);
+  // 2 seconds of 128 kbps audio.
+  const size_t kSampleSize = 372;
+  const size_t kSampleCount = 86;
+  const int64_t kSampleDuration = 2090;
+  std::vector<std::shared_ptr<MediaSample>> samples;
+  for (size_t i = 0; i < kSampleCount; ++i) {
+    std::vector<uint8_t> data(kSampleSize, static_cast<uint8_t>(i));
+    samples.push_back(MediaSample::CopyFrom(data.data(), data.size(), true));
+    samples.back()->set_dts(i * kSampleDuration);
+    samples.back()->set_pts(i * kSampleDuration);
+  }
+  MeasureTsOutputThroughput(
+      "aac", stream_info,
+      std::unique_ptr<ProgramMapTableWriter>(new AudioProgramMapTableWriter(
+          kCodecAAC, kAudioSpecificConfig)),
+      samples);
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
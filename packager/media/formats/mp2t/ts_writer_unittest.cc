@@ -302,7 +302,7 @@ TEST_F(TsWriterTest, AddPesPacket) {
   };
   pes->mutable_data()->assign(kAnyData, kAnyData + arraysize(kAnyData));
 
-  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(pes), &buffer_writer));
+  EXPECT_TRUE(ts_writer.AddPesPacket(*pes, &buffer_writer));
   
   // 3 TS Packets. PAT, PMT, and PES.
   
@@ -347,6 +347,65 @@ TEST_F(TsWriterTest, AddPesPacket) {
       buffer_writer.Buffer() + kPesStartPosition));
 }
 
+// Verify that the PES packets of another elementary stream of the program have
+// their own PID and continuity counter, without PCR.
+TEST_F(TsWriterTest, AddPesPacketToStream) {
+  TsWriter ts_writer(std::unique_ptr<ProgramMapTableWriter>(
+      new VideoProgramMapTableWriter(kCodecForTesting)));
+  BufferWriter buffer_writer;
+  EXPECT_TRUE(ts_writer.NewSegment(&buffer_writer));
+
+  std::unique_ptr<PesPacket> pes(new PesPacket());
+  pes->set_stream_id(0xC0);
+  pes->set_pts(0x900);
+  pes->set_dts(0x900);
+  const uint8_t kAnyData[] = {
+      0x12, 0x88, 0x4f, 0x4a,
+  };
+  pes->mutable_data()->assign(kAnyData, kAnyData + arraysize(kAnyData));
+
+  EXPECT_TRUE(ts_writer.AddPesPacket(*pes, &buffer_writer));
+  EXPECT_TRUE(ts_writer.AddPesPacketToStream(1, *pes, &buffer_writer));
+
+  // 4 TS Packets. PAT, PMT, and a PES for each stream.
+  ASSERT_EQ(752u, buffer_writer.Size());
+
+  const int kPesStartPosition = 564;
+
+  const uint8_t kExpectedOutputPrefix[] = {
+      0x47,  // Sync byte.
+      0x40,  // payload_unit_start_indicator set.
+      0x51,  // pid.
+      0x30,  // Adaptation field and payload are both present. counter = 0.
+      0xA0,  // Adaptation Field length.
+      0x00,  // No pcr.
+  };
+
+  const uint8_t kExpectedPayload[] = {
+      0x00, 0x00, 0x01,  // Start code.
+      0xC0,              // stream id.
+      0x00, 0x11,        // PES_packet_length.
+      0x80,              // Flags.
+      0xC0,              // PTS and DTS both present.
+      0x0A,              // PES_header_data_length.
+      0x31,  // Since PTS is 0 this is '0011' (fixed) and marker bit at LSB.
+      0x00,  // PTS leading bits 0.
+      0x01,  // PTS 0 followed by marker bit.
+      0x12,  // PTS 0x900 shifted.
+      0x01,  // PTS 0 followed by marker bit.
+      0x11,  // Fixed '0001' followed by marker bit at LSB.
+      0x00,  // DTS leading bits 0.
+      0x01,  // DTS 0 followed by marker bit.
+      0x12,  // DTS 0x900 shifted.
+      0x01,  // DTS 0 followed by marker bit.
+      0x12, 0x88, 0x4f, 0x4a,  // Payload.
+  };
+  EXPECT_NO_FATAL_FAILURE(ExpectTsPacketEqual(
+      kExpectedOutputPrefix, arraysize(kExpectedOutputPrefix), 159,
+      kExpectedPayload, arraysize(kExpectedPayload),
+      buffer_writer.Buffer() + kPesStartPosition));
+}
+
 // Verify that PES packet > 64KiB can be handled.
 TEST_F(TsWriterTest, BigPesPacket) {
   TsWriter ts_writer(std::unique_ptr<ProgramMapTableWriter>(
@@ -362,7 +421,7 @@ TEST_F(TsWriterTest, BigPesPacket) {
   const std::vector<uint8_t> big_data(400, 0x23);
   *pes->mutable_data() = big_data;
 
-  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(pes), &buffer_writer));
+  EXPECT_TRUE(ts_writer.AddPesPacket(*pes, &buffer_writer));
 
   // The first TsPacket can only carry
   // 177 (TS packet size - header - adaptation_field) - 19 (PES header data) =
@@ -395,7 +454,7 @@ TEST_F(TsWriterTest, PesPtsZeroNoDts) {
   };
   pes->mutable_data()->assign(kAnyData, kAnyData + arraysize(kAnyData));
 
-  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(pes), &buffer_writer));
+  EXPECT_TRUE(ts_writer.AddPesPacket(*pes, &buffer_writer));
 
   // 3 TS Packets. PAT, PMT, and PES.
   ASSERT_EQ(564u, buffer_writer.Size());
@@ -454,7 +513,7 @@ TEST_F(TsWriterTest, TsPacketPayload183Bytes) {
   std::vector<uint8_t> pes_payload(157 + 183, 0xAF);
   *pes->mutable_data() = pes_payload;
 
-  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(pes), &buffer_writer));
+  EXPECT_TRUE(ts_writer.AddPesPacket(*pes, &buffer_writer));
 
   const uint8_t kExpectedOutputPrefix[] = {
       0x47,  // Sync byte.
@@ -18,8 +18,8 @@ Box::~Box() {}
 
 bool Box::Parse(BoxReader* reader) {
   DCHECK(reader);
-  BoxBuffer buffer(reader);
-  return ReadWriteInternal(&buffer);
+  BoxReadBuffer buffer(reader);
+  return ReadInternal(&buffer);
 }
 
 void Box::Write(BufferWriter* writer) {
@@ -29,12 +29,18 @@ void Box::Write(BufferWriter* writer) {
   DCHECK_EQ(size, box_size_);
 
   size_t buffer_size_before_write = writer->Size();
-  BoxBuffer buffer(writer);
-  CHECK(ReadWriteInternal(&buffer));
+  BoxWriteBuffer buffer(writer);
+  CHECK(WriteInternal(&buffer));
   DCHECK_EQ(box_size_, writer->Size() - buffer_size_before_write)
       << FourCCToString(BoxType());
 }
 
+void Box::WriteInOnePass(BufferWriter* writer) {
+  DCHECK(writer);
+  BoxWriteBuffer buffer(writer, BoxWriteBuffer::kOnePassWrite);
+  buffer.WriteChildInOnePass(this, BoxWriteBuffer::kMandatoryBox);
+}
+
 void Box::WriteHeader(BufferWriter* writer) {
   DCHECK(writer);
   // Compute and update box size.
@@ -42,8 +48,8 @@ void Box::WriteHeader(BufferWriter* writer) {
   DCHECK_EQ(size, box_size_);
 
   size_t buffer_size_before_write = writer->Size();
-  BoxBuffer buffer(writer);
-  CHECK(ReadWriteHeaderInternal(&buffer));
+  BoxWriteBuffer buffer(writer);
+  CHECK(WriteHeaderInternal(&buffer));
   DCHECK_EQ(HeaderSize(), writer->Size() - buffer_size_before_write);
 }
 
@@ -52,13 +58,18 @@ uint32_t Box::ComputeSize() {
   return box_size_;
 }
 
+bool Box::PrepareOnePassWrite() {
+  return ComputeSize() != 0;
+}
+
 uint32_t Box::HeaderSize() const {
   const uint32_t kFourCCSize = 4;
   // We don't support 64-bit size.
   return kFourCCSize + sizeof(uint32_t);
 }
 
-bool Box::ReadWriteHeaderInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool Box::ReadWriteHeaderInternal(Buffer* buffer) {
   if (buffer->Reading()) {
     // Skip for read mode, which is handled already in BoxReader.
   } else {
@@ -69,6 +80,13 @@ bool Box::ReadWriteHeaderInternal(BoxBuffer* buffer) {
   return true;
 }
 
+template bool Box::ReadWriteHeaderInternal(BoxReadBuffer* buffer);
+template bool Box::ReadWriteHeaderInternal(BoxWriteBuffer* buffer);
+
+bool Box::WriteHeaderInternal(BoxWriteBuffer* buffer) {
+  return ReadWriteHeaderInternal(buffer);
+}
+
 FullBox::FullBox() = default;
 FullBox::~FullBox() = default;
 
@@ -77,7 +95,8 @@ uint32_t FullBox::HeaderSize() const {
   return Box::HeaderSize() + 1 + 3;
 }
 
-bool FullBox::ReadWriteHeaderInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool FullBox::ReadWriteHeaderInternal(Buffer* buffer) {
   RCHECK(Box::ReadWriteHeaderInternal(buffer));
 
   uint32_t vflags;
@@ -92,6 +111,13 @@ bool FullBox::ReadWriteHeaderInternal(BoxBuffer* buffer) {
   return true;
 }
 
+template bool FullBox::ReadWriteHeaderInternal(BoxReadBuffer* buffer);
+template bool FullBox::ReadWriteHeaderInternal(BoxWriteBuffer* buffer);
+
+bool FullBox::WriteHeaderInternal(BoxWriteBuffer* buffer) {
+  return ReadWriteHeaderInternal(buffer);
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
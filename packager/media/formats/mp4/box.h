@@ -18,9 +18,13 @@ class BufferWriter;
 
 namespace mp4 {
 
-class BoxBuffer;
+template <bool kReading>
+class BoxBufferT;
 class BoxReader;
 
+typedef BoxBufferT<true> BoxReadBuffer;
+typedef BoxBufferT<false> BoxWriteBuffer;
+
 /// Defines the base ISO BMFF box objects as defined in ISO 14496-12:2012
 /// ISO BMFF section 4.2. All ISO BMFF compatible boxes inherit from either
 /// Box or FullBox.
@@ -41,6 +45,13 @@ struct Box {
   /// @param writer points to a BufferWriter object which wraps the buffer for
   ///        writing.
   void WriteHeader(BufferWriter* writer);
+  /// Write the box to buffer in a single pass over the box tree. The size of
+  /// each box is written as a placeholder and back-patched once its content
+  /// is written, instead of being computed for the whole tree upfront. The
+  /// output is identical to Write() and box sizes are updated as well.
+  /// @param writer points to a BufferWriter object which wraps the buffer for
+  ///        writing.
+  void WriteInOnePass(BufferWriter* writer);
   /// Compute the size of this box. It will also update box size.
   /// @return The size of result box including child boxes. A value of 0 should
   ///         be returned if the box should not be written.
@@ -57,17 +68,30 @@ struct Box {
  protected:
   /// Read/write mp4 box header. Note that this function expects that
   /// ComputeSize has been invoked already.
+  /// @param buffer is either a BoxReadBuffer or a BoxWriteBuffer.
   /// @return true on success, false otherwise.
-  virtual bool ReadWriteHeaderInternal(BoxBuffer* buffer);
+  template <typename Buffer>
+  bool ReadWriteHeaderInternal(Buffer* buffer);
 
  private:
-  friend class BoxBuffer;
-  // Read/write the mp4 box from/to BoxBuffer. Note that this function expects
-  // that ComputeSize has been invoked already.
-  virtual bool ReadWriteInternal(BoxBuffer* buffer) = 0;
+  template <bool kReading>
+  friend class BoxBufferT;
+  // Read/write the mp4 box from/to the buffer. Boxes usually implement both
+  // with a single ReadWriteInternal() template, see DECLARE_BOX_METHODS. Note
+  // that these functions expect that ComputeSize has been invoked already.
+  virtual bool ReadInternal(BoxReadBuffer* buffer) = 0;
+  virtual bool WriteInternal(BoxWriteBuffer* buffer) = 0;
+  // Write the mp4 box header, which differs between Box and FullBox.
+  virtual bool WriteHeaderInternal(BoxWriteBuffer* buffer);
   // Compute the size of this box. A value of 0 should be returned if the box
   // should not be written. Note that this function won't update box size.
   virtual size_t ComputeSizeInternal() = 0;
+  // Prepare the box to be written by WriteInOnePass(), e.g. update the fields
+  // that depend on its content. The default implementation computes the size
+  // of the box, which walks its children, so boxes with children or many
+  // entries written in one pass should override it.
+  // Returns false if the box should not be written, like a box size of 0.
+  virtual bool PrepareOnePassWrite();
 
   // We don't support 64-bit box sizes. 32-bit should be large enough for our
   // current needs.
@@ -91,7 +115,11 @@ struct FullBox : Box {
   uint32_t flags = 0;
 
  protected:
-  bool ReadWriteHeaderInternal(BoxBuffer* buffer) final;
+  template <typename Buffer>
+  bool ReadWriteHeaderInternal(Buffer* buffer);
+
+ private:
+  bool WriteHeaderInternal(BoxWriteBuffer* buffer) final;
 
   // Not using DISALLOW_COPY_AND_ASSIGN here intentionally to allow the compiler
   // generated copy constructor and assignment operator.
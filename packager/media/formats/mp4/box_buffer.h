@@ -20,29 +20,44 @@ namespace mp4 {
 
 /// Class for MP4 box I/O. Box I/O is symmetric and exclusive, so we can define
 /// a single method to do either reading or writing box objects.
-/// BoxBuffer wraps either BoxReader for reading or BufferWriter for writing.
-/// Thus it is capable of doing either reading or writing, but not both.
-class BoxBuffer {
+/// BoxBufferT wraps either BoxReader for reading or BufferWriter for writing.
+/// The direction is a template parameter, so that a box defines a single
+/// ReadWriteInternal() template and the Reading() branches are resolved at
+/// compile time in each of BoxReadBuffer and BoxWriteBuffer.
+template <bool kReading>
+class BoxBufferT {
  public:
+  enum WriteMode { kOnePassWrite };
+
   /// Create a reader version of the BoxBuffer.
   /// @param reader should not be NULL.
-  explicit BoxBuffer(BoxReader* reader) : reader_(reader), writer_(NULL) {
+  explicit BoxBufferT(BoxReader* reader) : reader_(reader), writer_(NULL) {
+    static_assert(kReading, "BoxReader requires a BoxReadBuffer.");
     DCHECK(reader);
   }
   /// Create a writer version of the BoxBuffer.
   /// @param writer should not be NULL.
-  explicit BoxBuffer(BufferWriter* writer) : reader_(NULL), writer_(writer) {
+  explicit BoxBufferT(BufferWriter* writer) : reader_(NULL), writer_(writer) {
+    static_assert(!kReading, "BufferWriter requires a BoxWriteBuffer.");
+    DCHECK(writer);
+  }
+  /// Create a writer version of the BoxBuffer which writes child boxes in a
+  /// single pass, see Box::WriteInOnePass.
+  /// @param writer should not be NULL.
+  BoxBufferT(BufferWriter* writer, WriteMode mode)
+      : reader_(NULL), writer_(writer), one_pass_write_(true) {
+    static_assert(!kReading, "BufferWriter requires a BoxWriteBuffer.");
     DCHECK(writer);
   }
-  ~BoxBuffer() {}
+  ~BoxBufferT() {}
 
   /// @return true for reader, false for writer.
-  bool Reading() const { return reader_ != NULL; }
+  static constexpr bool Reading() { return kReading; }
 
   /// @return Current read/write position. In read mode, this is the current
   ///         read position. In write mode, it is the same as Size().
   size_t Pos() const {
-    if (reader_)
+    if (kReading)
       return reader_->pos();
     return writer_->Size();
   }
@@ -52,7 +67,7 @@ class BoxBuffer {
   ///         includes all data that has been written, and will change as more
   ///         data is written.
   size_t Size() const {
-    if (reader_)
+    if (kReading)
       return reader_->size();
     return writer_->Size();
   }
@@ -60,7 +75,7 @@ class BoxBuffer {
   /// @return In read mode, return the number of bytes left in the box.
   ///         In write mode, return 0.
   size_t BytesLeft() const {
-    if (reader_)
+    if (kReading)
       return reader_->size() - reader_->pos();
     return 0;
   }
@@ -68,43 +83,43 @@ class BoxBuffer {
   /// @name Read/write integers of various sizes and signedness.
   /// @{
   bool ReadWriteUInt8(uint8_t* v) {
-    if (reader_)
+    if (kReading)
       return reader_->Read1(v);
     writer_->AppendInt(*v);
     return true;
   }
   bool ReadWriteUInt16(uint16_t* v) {
-    if (reader_)
+    if (kReading)
       return reader_->Read2(v);
     writer_->AppendInt(*v);
     return true;
   }
   bool ReadWriteUInt32(uint32_t* v) {
-    if (reader_)
+    if (kReading)
       return reader_->Read4(v);
     writer_->AppendInt(*v);
     return true;
   }
   bool ReadWriteUInt64(uint64_t* v) {
-    if (reader_)
+    if (kReading)
       return reader_->Read8(v);
     writer_->AppendInt(*v);
     return true;
   }
   bool ReadWriteInt16(int16_t* v) {
-    if (reader_)
+    if (kReading)
       return reader_->Read2s(v);
     writer_->AppendInt(*v);
     return true;
   }
   bool ReadWriteInt32(int32_t* v) {
-    if (reader_)
+    if (kReading)
       return reader_->Read4s(v);
     writer_->AppendInt(*v);
     return true;
   }
   bool ReadWriteInt64(int64_t* v) {
-    if (reader_)
+    if (kReading)
       return reader_->Read8s(v);
     writer_->AppendInt(*v);
     return true;
@@ -115,19 +130,19 @@ class BoxBuffer {
   /// @param num_bytes should not be larger than sizeof(v), i.e. 8.
   /// @return true on success, false otherwise.
   bool ReadWriteUInt64NBytes(uint64_t* v, size_t num_bytes) {
-    if (reader_)
+    if (kReading)
       return reader_->ReadNBytesInto8(v, num_bytes);
     writer_->AppendNBytes(*v, num_bytes);
     return true;
   }
   bool ReadWriteInt64NBytes(int64_t* v, size_t num_bytes) {
-    if (reader_)
+    if (kReading)
       return reader_->ReadNBytesInto8s(v, num_bytes);
     writer_->AppendNBytes(*v, num_bytes);
     return true;
   }
   bool ReadWriteVector(std::vector<uint8_t>* vector, size_t count) {
-    if (reader_)
+    if (kReading)
       return reader_->ReadToVector(vector, count);
     DCHECK_EQ(vector->size(), count);
     writer_->AppendArray(vector->data(), count);
@@ -137,7 +152,7 @@ class BoxBuffer {
   /// Reads @a size characters from the buffer and sets it to str.
   /// Writes @a str to the buffer. Write mode ignores @a size.
   bool ReadWriteString(std::string* str, size_t size) {
-    if (reader_)
+    if (kReading)
       return reader_->ReadToString(str, size);
     DCHECK_EQ(str->size(), size);
     writer_->AppendArray(reinterpret_cast<const uint8_t*>(str->data()),
@@ -146,7 +161,7 @@ class BoxBuffer {
   }
 
   bool ReadWriteFourCC(FourCC* fourcc) {
-    if (reader_)
+    if (kReading)
       return reader_->ReadFourCC(fourcc);
     writer_->AppendInt(static_cast<uint32_t>(*fourcc));
     return true;
@@ -155,7 +170,7 @@ class BoxBuffer {
   /// Prepare child boxes for reading/writing.
   /// @return true on success, false otherwise.
   bool PrepareChildren() {
-    if (reader_)
+    if (kReading)
       return reader_->ScanChildren();
     // NOP in write mode.
     return true;
@@ -164,22 +179,30 @@ class BoxBuffer {
   /// Read/write child box.
   /// @return true on success, false otherwise.
   bool ReadWriteChild(Box* box) {
-    if (reader_)
+    if (kReading)
       return reader_->ReadChild(box);
+    if (one_pass_write_) {
+      WriteChildInOnePass(box, kMandatoryBox);
+      return true;
+    }
     // The box is mandatory, i.e. the box size should not be 0.
     DCHECK_NE(0u, box->box_size());
-    CHECK(box->ReadWriteInternal(this));
+    CHECK(ReadWriteBox(box));
     return true;
   }
 
   /// Read/write child box if exists.
   /// @return true on success, false otherwise.
   bool TryReadWriteChild(Box* box) {
-    if (reader_)
+    if (kReading)
       return reader_->TryReadChild(box);
+    if (one_pass_write_) {
+      WriteChildInOnePass(box, kOptionalBox);
+      return true;
+    }
     // The box is optional, i.e. it can be skipped if the box size is 0.
     if (box->box_size() != 0)
-      CHECK(box->ReadWriteInternal(this));
+      CHECK(ReadWriteBox(box));
     return true;
   }
 
@@ -187,7 +210,7 @@ class BoxBuffer {
   ///        of bytes to be padded with zero in write mode.
   /// @return true on success, false otherwise.
   bool IgnoreBytes(size_t num_bytes) {
-    if (reader_)
+    if (kReading)
       return reader_->SkipBytes(num_bytes);
     std::vector<uint8_t> vector(num_bytes, 0);
     writer_->AppendVector(vector);
@@ -200,10 +223,40 @@ class BoxBuffer {
   BufferWriter* writer() { return writer_; }
 
  private:
+  friend struct Box;
+
+  enum ChildBox { kMandatoryBox, kOptionalBox };
+
+  // Dispatch to the read or write specialization of |box|.
+  bool ReadWriteBox(Box* box) { return ReadWriteBox(box, this); }
+  static bool ReadWriteBox(Box* box, BoxReadBuffer* buffer) {
+    return box->ReadInternal(buffer);
+  }
+  static bool ReadWriteBox(Box* box, BoxWriteBuffer* buffer) {
+    return box->WriteInternal(buffer);
+  }
+
+  // Write |box| with a placeholder size, which is back-patched once its
+  // content is written. Optional boxes are skipped if they should not be
+  // written.
+  void WriteChildInOnePass(Box* box, ChildBox child_box) {
+    const bool should_write = box->PrepareOnePassWrite();
+    if (!should_write && child_box == kOptionalBox)
+      return;
+    // The box is mandatory, i.e. it should have some content.
+    DCHECK(should_write);
+    const size_t start_position = writer_->Size();
+    CHECK(ReadWriteBox(box));
+    box->box_size_ = static_cast<uint32_t>(writer_->Size() - start_position);
+    writer_->OverwriteNBytes(start_position, box->box_size_,
+                             sizeof(box->box_size_));
+  }
+
   BoxReader* reader_;
   BufferWriter* writer_;
+  bool one_pass_write_ = false;
 
-  DISALLOW_COPY_AND_ASSIGN(BoxBuffer);
+  DISALLOW_COPY_AND_ASSIGN(BoxBufferT);
 };
 
 }  // namespace mp4
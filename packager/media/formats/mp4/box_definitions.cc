@@ -18,6 +18,16 @@ DEFINE_bool(mvex_before_trak,
             "Android MediaExtractor requires mvex to be written before trak. "
             "Set the flag to true to comply with the requirement.");
 
+// Defines the read and write specializations of box T from its
+// ReadWriteInternal() template.
+#define DEFINE_BOX_READ_WRITE(T)                  \
+  bool T::ReadInternal(BoxReadBuffer* buffer) {   \
+    return ReadWriteInternal(buffer);             \
+  }                                               \
+  bool T::WriteInternal(BoxWriteBuffer* buffer) { \
+    return ReadWriteInternal(buffer);             \
+  }
+
 namespace {
 const uint32_t kFourCCSize = 4;
 
@@ -138,7 +148,8 @@ FourCC FileType::BoxType() const {
   return FOURCC_ftyp;
 }
 
-bool FileType::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool FileType::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteFourCC(&major_brand) &&
          buffer->ReadWriteUInt32(&minor_version));
@@ -155,6 +166,8 @@ bool FileType::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(FileType)
+
 size_t FileType::ComputeSizeInternal() {
   return HeaderSize() + kFourCCSize + sizeof(minor_version) +
          kFourCCSize * compatible_brands.size();
@@ -171,7 +184,8 @@ FourCC ProtectionSystemSpecificHeader::BoxType() const {
   return FOURCC_pssh;
 }
 
-bool ProtectionSystemSpecificHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool ProtectionSystemSpecificHeader::ReadWriteInternal(Buffer* buffer) {
   if (buffer->Reading()) {
     BoxReader* reader = buffer->reader();
     DCHECK(reader);
@@ -184,6 +198,8 @@ bool ProtectionSystemSpecificHeader::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(ProtectionSystemSpecificHeader)
+
 size_t ProtectionSystemSpecificHeader::ComputeSizeInternal() {
   return raw_box.size();
 }
@@ -195,7 +211,8 @@ FourCC SampleAuxiliaryInformationOffset::BoxType() const {
   return FOURCC_saio;
 }
 
-bool SampleAuxiliaryInformationOffset::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SampleAuxiliaryInformationOffset::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   if (flags & 1)
     RCHECK(buffer->IgnoreBytes(8));  // aux_info_type and parameter.
@@ -210,6 +227,8 @@ bool SampleAuxiliaryInformationOffset::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SampleAuxiliaryInformationOffset)
+
 size_t SampleAuxiliaryInformationOffset::ComputeSizeInternal() {
   // This box is optional. Skip it if it is empty.
   if (offsets.size() == 0)
@@ -225,7 +244,8 @@ FourCC SampleAuxiliaryInformationSize::BoxType() const {
   return FOURCC_saiz;
 }
 
-bool SampleAuxiliaryInformationSize::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SampleAuxiliaryInformationSize::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   if (flags & 1)
     RCHECK(buffer->IgnoreBytes(8));
@@ -237,6 +257,8 @@ bool SampleAuxiliaryInformationSize::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SampleAuxiliaryInformationSize)
+
 size_t SampleAuxiliaryInformationSize::ComputeSizeInternal() {
   // This box is optional. Skip it if it is empty.
   if (sample_count == 0)
@@ -246,9 +268,10 @@ size_t SampleAuxiliaryInformationSize::ComputeSizeInternal() {
          (default_sample_info_size == 0 ? sample_info_sizes.size() : 0);
 }
 
+template <typename Buffer>
 bool SampleEncryptionEntry::ReadWrite(uint8_t iv_size,
                                       bool has_subsamples,
-                                      BoxBuffer* buffer) {
+                                      Buffer* buffer) {
   DCHECK(IsIvSizeValid(iv_size));
   DCHECK(buffer);
 
@@ -319,7 +342,8 @@ FourCC SampleEncryption::BoxType() const {
   return FOURCC_senc;
 }
 
-bool SampleEncryption::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SampleEncryption::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
 
   // If we don't know |iv_size|, store sample encryption data to parse later
@@ -349,6 +373,8 @@ bool SampleEncryption::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SampleEncryption)
+
 size_t SampleEncryption::ComputeSizeInternal() {
   const uint32_t sample_count =
       static_cast<uint32_t>(sample_encryption_entries.size());
@@ -370,6 +396,11 @@ size_t SampleEncryption::ComputeSizeInternal() {
   return box_size;
 }
 
+bool SampleEncryption::PrepareOnePassWrite() {
+  // Sample encryption box is optional. Skip it if it is empty.
+  return !sample_encryption_entries.empty();
+}
+
 bool SampleEncryption::ParseFromSampleEncryptionData(
     uint8_t iv_size,
     std::vector<SampleEncryptionEntry>* sample_encryption_entries) const {
@@ -395,10 +426,13 @@ FourCC OriginalFormat::BoxType() const {
   return FOURCC_frma;
 }
 
-bool OriginalFormat::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool OriginalFormat::ReadWriteInternal(Buffer* buffer) {
   return ReadWriteHeaderInternal(buffer) && buffer->ReadWriteFourCC(&format);
 }
 
+DEFINE_BOX_READ_WRITE(OriginalFormat)
+
 size_t OriginalFormat::ComputeSizeInternal() {
   return HeaderSize() + kFourCCSize;
 }
@@ -410,12 +444,15 @@ FourCC SchemeType::BoxType() const {
   return FOURCC_schm;
 }
 
-bool SchemeType::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SchemeType::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteFourCC(&type) &&
          buffer->ReadWriteUInt32(&version));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SchemeType)
+
 size_t SchemeType::ComputeSizeInternal() {
   return HeaderSize() + kFourCCSize + sizeof(version);
 }
@@ -427,7 +464,8 @@ FourCC TrackEncryption::BoxType() const {
   return FOURCC_tenc;
 }
 
-bool TrackEncryption::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool TrackEncryption::ReadWriteInternal(Buffer* buffer) {
   if (!buffer->Reading()) {
     if (default_kid.size() != kCencKeyIdSize) {
       LOG(WARNING) << "CENC defines key id length of " << kCencKeyIdSize
@@ -477,6 +515,8 @@ bool TrackEncryption::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(TrackEncryption)
+
 size_t TrackEncryption::ComputeSizeInternal() {
   return HeaderSize() + sizeof(uint32_t) + kCencKeyIdSize +
          (default_constant_iv.empty()
@@ -491,12 +531,15 @@ FourCC SchemeInfo::BoxType() const {
   return FOURCC_schi;
 }
 
-bool SchemeInfo::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SchemeInfo::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&track_encryption));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SchemeInfo)
+
 size_t SchemeInfo::ComputeSizeInternal() {
   return HeaderSize() + track_encryption.ComputeSize();
 }
@@ -508,7 +551,8 @@ FourCC ProtectionSchemeInfo::BoxType() const {
   return FOURCC_sinf;
 }
 
-bool ProtectionSchemeInfo::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool ProtectionSchemeInfo::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&format) && buffer->ReadWriteChild(&type));
   if (IsProtectionSchemeSupported(type.type)) {
@@ -524,6 +568,8 @@ bool ProtectionSchemeInfo::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(ProtectionSchemeInfo)
+
 size_t ProtectionSchemeInfo::ComputeSizeInternal() {
   // Skip sinf box if it is not initialized.
   if (format.format == FOURCC_NULL)
@@ -539,7 +585,8 @@ FourCC MovieHeader::BoxType() const {
   return FOURCC_mvhd;
 }
 
-bool MovieHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool MovieHeader::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
 
   size_t num_bytes = (version == 1) ? sizeof(uint64_t) : sizeof(uint32_t);
@@ -558,6 +605,8 @@ bool MovieHeader::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(MovieHeader)
+
 size_t MovieHeader::ComputeSizeInternal() {
   version = IsFitIn32Bits(creation_time, modification_time, duration) ? 0 : 1;
   return HeaderSize() + sizeof(uint32_t) * (1 + version) * 3 +
@@ -576,7 +625,8 @@ FourCC TrackHeader::BoxType() const {
   return FOURCC_tkhd;
 }
 
-bool TrackHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool TrackHeader::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
 
   size_t num_bytes = (version == 1) ? sizeof(uint64_t) : sizeof(uint32_t);
@@ -603,6 +653,8 @@ bool TrackHeader::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(TrackHeader)
+
 size_t TrackHeader::ComputeSizeInternal() {
   version = IsFitIn32Bits(creation_time, modification_time, duration) ? 0 : 1;
   return HeaderSize() + sizeof(track_id) +
@@ -618,7 +670,8 @@ FourCC SampleDescription::BoxType() const {
   return FOURCC_stsd;
 }
 
-bool SampleDescription::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SampleDescription::ReadWriteInternal(Buffer* buffer) {
   uint32_t count = 0;
   switch (type) {
     case kVideo:
@@ -671,6 +724,8 @@ bool SampleDescription::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SampleDescription)
+
 size_t SampleDescription::ComputeSizeInternal() {
   size_t box_size = HeaderSize() + sizeof(uint32_t);
   if (type == kVideo) {
@@ -693,7 +748,8 @@ FourCC DecodingTimeToSample::BoxType() const {
   return FOURCC_stts;
 }
 
-bool DecodingTimeToSample::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool DecodingTimeToSample::ReadWriteInternal(Buffer* buffer) {
   uint32_t count = static_cast<uint32_t>(decoding_time.size());
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteUInt32(&count));
 
@@ -705,6 +761,8 @@ bool DecodingTimeToSample::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(DecodingTimeToSample)
+
 size_t DecodingTimeToSample::ComputeSizeInternal() {
   return HeaderSize() + sizeof(uint32_t) +
          sizeof(DecodingTime) * decoding_time.size();
@@ -717,7 +775,8 @@ FourCC CompositionTimeToSample::BoxType() const {
   return FOURCC_ctts;
 }
 
-bool CompositionTimeToSample::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool CompositionTimeToSample::ReadWriteInternal(Buffer* buffer) {
   uint32_t count = static_cast<uint32_t>(composition_offset.size());
   if (!buffer->Reading()) {
     // Determine whether version 0 or version 1 should be used.
@@ -751,6 +810,8 @@ bool CompositionTimeToSample::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(CompositionTimeToSample)
+
 size_t CompositionTimeToSample::ComputeSizeInternal() {
   // This box is optional. Skip it if it is empty.
   if (composition_offset.empty())
@@ -770,7 +831,8 @@ FourCC SampleToChunk::BoxType() const {
   return FOURCC_stsc;
 }
 
-bool SampleToChunk::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SampleToChunk::ReadWriteInternal(Buffer* buffer) {
   uint32_t count = static_cast<uint32_t>(chunk_info.size());
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteUInt32(&count));
 
@@ -786,6 +848,8 @@ bool SampleToChunk::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SampleToChunk)
+
 size_t SampleToChunk::ComputeSizeInternal() {
   return HeaderSize() + sizeof(uint32_t) +
          sizeof(ChunkInfo) * chunk_info.size();
@@ -798,7 +862,8 @@ FourCC SampleSize::BoxType() const {
   return FOURCC_stsz;
 }
 
-bool SampleSize::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SampleSize::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&sample_size) &&
          buffer->ReadWriteUInt32(&sample_count));
@@ -814,6 +879,8 @@ bool SampleSize::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SampleSize)
+
 size_t SampleSize::ComputeSizeInternal() {
   return HeaderSize() + sizeof(sample_size) + sizeof(sample_count) +
          (sample_size == 0 ? sizeof(uint32_t) * sizes.size() : 0);
@@ -826,7 +893,8 @@ FourCC CompactSampleSize::BoxType() const {
   return FOURCC_stz2;
 }
 
-bool CompactSampleSize::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool CompactSampleSize::ReadWriteInternal(Buffer* buffer) {
   uint32_t sample_count = static_cast<uint32_t>(sizes.size());
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->IgnoreBytes(3) &&
          buffer->ReadWriteUInt8(&field_size) &&
@@ -871,6 +939,8 @@ bool CompactSampleSize::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(CompactSampleSize)
+
 size_t CompactSampleSize::ComputeSizeInternal() {
   return HeaderSize() + sizeof(uint32_t) + sizeof(uint32_t) +
          (field_size * sizes.size() + 7) / 8;
@@ -883,7 +953,8 @@ FourCC ChunkOffset::BoxType() const {
   return FOURCC_stco;
 }
 
-bool ChunkOffset::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool ChunkOffset::ReadWriteInternal(Buffer* buffer) {
   uint32_t count = static_cast<uint32_t>(offsets.size());
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteUInt32(&count));
 
@@ -893,6 +964,8 @@ bool ChunkOffset::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(ChunkOffset)
+
 size_t ChunkOffset::ComputeSizeInternal() {
   return HeaderSize() + sizeof(uint32_t) + sizeof(uint32_t) * offsets.size();
 }
@@ -904,7 +977,8 @@ FourCC ChunkLargeOffset::BoxType() const {
   return FOURCC_co64;
 }
 
-bool ChunkLargeOffset::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool ChunkLargeOffset::ReadWriteInternal(Buffer* buffer) {
   uint32_t count = static_cast<uint32_t>(offsets.size());
 
   if (!buffer->Reading()) {
@@ -927,6 +1001,8 @@ bool ChunkLargeOffset::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(ChunkLargeOffset)
+
 size_t ChunkLargeOffset::ComputeSizeInternal() {
   uint32_t count = static_cast<uint32_t>(offsets.size());
   int use_large_offset =
@@ -942,7 +1018,8 @@ FourCC SyncSample::BoxType() const {
   return FOURCC_stss;
 }
 
-bool SyncSample::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SyncSample::ReadWriteInternal(Buffer* buffer) {
   uint32_t count = static_cast<uint32_t>(sample_number.size());
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteUInt32(&count));
 
@@ -952,6 +1029,8 @@ bool SyncSample::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SyncSample)
+
 size_t SyncSample::ComputeSizeInternal() {
   // Sync sample box is optional. Skip it if it is empty.
   if (sample_number.empty())
@@ -960,7 +1039,8 @@ size_t SyncSample::ComputeSizeInternal() {
          sizeof(uint32_t) * sample_number.size();
 }
 
-bool CencSampleEncryptionInfoEntry::ReadWrite(BoxBuffer* buffer) {
+template <typename Buffer>
+bool CencSampleEncryptionInfoEntry::ReadWrite(Buffer* buffer) {
   if (!buffer->Reading()) {
     if (key_id.size() != kCencKeyIdSize) {
       LOG(WARNING) << "CENC defines key id length of " << kCencKeyIdSize
@@ -1007,7 +1087,8 @@ uint32_t CencSampleEncryptionInfoEntry::ComputeSize() const {
       (constant_iv.empty() ? 0 : (sizeof(uint8_t) + constant_iv.size())));
 }
 
-bool AudioRollRecoveryEntry::ReadWrite(BoxBuffer* buffer) {
+template <typename Buffer>
+bool AudioRollRecoveryEntry::ReadWrite(Buffer* buffer) {
   RCHECK(buffer->ReadWriteInt16(&roll_distance));
   return true;
 }
@@ -1023,7 +1104,8 @@ FourCC SampleGroupDescription::BoxType() const {
   return FOURCC_sgpd;
 }
 
-bool SampleGroupDescription::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SampleGroupDescription::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&grouping_type));
 
@@ -1040,8 +1122,10 @@ bool SampleGroupDescription::ReadWriteInternal(BoxBuffer* buffer) {
   }
 }
 
-template <typename T>
-bool SampleGroupDescription::ReadWriteEntries(BoxBuffer* buffer,
+DEFINE_BOX_READ_WRITE(SampleGroupDescription)
+
+template <typename Buffer, typename T>
+bool SampleGroupDescription::ReadWriteEntries(Buffer* buffer,
                                               std::vector<T>* entries) {
   uint32_t default_length = 0;
   if (!buffer->Reading()) {
@@ -1110,7 +1194,8 @@ FourCC SampleToGroup::BoxType() const {
   return FOURCC_sbgp;
 }
 
-bool SampleToGroup::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SampleToGroup::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&grouping_type));
   if (version == 1)
@@ -1133,6 +1218,8 @@ bool SampleToGroup::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SampleToGroup)
+
 size_t SampleToGroup::ComputeSizeInternal() {
   // This box is optional. Skip it if it is not used.
   if (entries.empty())
@@ -1149,7 +1236,8 @@ FourCC SampleTable::BoxType() const {
   return FOURCC_stbl;
 }
 
-bool SampleTable::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SampleTable::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&description) &&
          buffer->ReadWriteChild(&decoding_time_to_sample) &&
@@ -1197,6 +1285,8 @@ bool SampleTable::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SampleTable)
+
 size_t SampleTable::ComputeSizeInternal() {
   size_t box_size = HeaderSize() + description.ComputeSize() +
                     decoding_time_to_sample.ComputeSize() +
@@ -1218,7 +1308,8 @@ FourCC EditList::BoxType() const {
   return FOURCC_elst;
 }
 
-bool EditList::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool EditList::ReadWriteInternal(Buffer* buffer) {
   uint32_t count = static_cast<uint32_t>(edits.size());
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteUInt32(&count));
   edits.resize(count);
@@ -1234,6 +1325,8 @@ bool EditList::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(EditList)
+
 size_t EditList::ComputeSizeInternal() {
   // EditList box is optional. Skip it if it is empty.
   if (edits.empty())
@@ -1258,11 +1351,14 @@ FourCC Edit::BoxType() const {
   return FOURCC_edts;
 }
 
-bool Edit::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool Edit::ReadWriteInternal(Buffer* buffer) {
   return ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&list);
 }
 
+DEFINE_BOX_READ_WRITE(Edit)
+
 size_t Edit::ComputeSizeInternal() {
   // Edit box is optional. Skip it if it is empty.
   if (list.edits.empty())
@@ -1277,7 +1373,8 @@ FourCC HandlerReference::BoxType() const {
   return FOURCC_hdlr;
 }
 
-bool HandlerReference::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool HandlerReference::ReadWriteInternal(Buffer* buffer) {
   std::vector<uint8_t> handler_name;
   if (!buffer->Reading()) {
     switch (handler_type) {
@@ -1310,6 +1407,8 @@ bool HandlerReference::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(HandlerReference)
+
 size_t HandlerReference::ComputeSizeInternal() {
   size_t box_size = HeaderSize() + kFourCCSize + 16;  // 16 bytes Reserved
   switch (handler_type) {
@@ -1330,7 +1429,8 @@ size_t HandlerReference::ComputeSizeInternal() {
   return box_size;
 }
 
-bool Language::ReadWrite(BoxBuffer* buffer) {
+template <typename Buffer>
+bool Language::ReadWrite(Buffer* buffer) {
   if (buffer->Reading()) {
     // Read language codes into temp first then use BitReader to read the
     // values. ISO-639-2/T language code: unsigned int(5)[3] language (2 bytes).
@@ -1373,7 +1473,8 @@ FourCC ID3v2::BoxType() const {
   return FOURCC_ID32;
 }
 
-bool ID3v2::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool ID3v2::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && language.ReadWrite(buffer) &&
          buffer->ReadWriteVector(&id3v2_data, buffer->Reading()
                                                   ? buffer->BytesLeft()
@@ -1381,6 +1482,8 @@ bool ID3v2::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(ID3v2)
+
 size_t ID3v2::ComputeSizeInternal() {
   // Skip ID3v2 box generation if there is no id3 data.
   return id3v2_data.size() == 0
@@ -1395,12 +1498,15 @@ FourCC Metadata::BoxType() const {
   return FOURCC_meta;
 }
 
-bool Metadata::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool Metadata::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&handler) && buffer->TryReadWriteChild(&id3v2));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(Metadata)
+
 size_t Metadata::ComputeSizeInternal() {
   size_t id3v2_size = id3v2.ComputeSize();
   // Skip metadata box generation if there is no metadata box.
@@ -1417,7 +1523,8 @@ FourCC CodecConfiguration::BoxType() const {
   return box_type;
 }
 
-bool CodecConfiguration::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool CodecConfiguration::ReadWriteInternal(Buffer* buffer) {
   DCHECK_NE(box_type, FOURCC_NULL);
   RCHECK(ReadWriteHeaderInternal(buffer));
 
@@ -1440,6 +1547,8 @@ bool CodecConfiguration::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(CodecConfiguration)
+
 size_t CodecConfiguration::ComputeSizeInternal() {
   if (data.empty())
     return 0;
@@ -1454,13 +1563,16 @@ FourCC PixelAspectRatio::BoxType() const {
   return FOURCC_pasp;
 }
 
-bool PixelAspectRatio::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool PixelAspectRatio::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&h_spacing) &&
          buffer->ReadWriteUInt32(&v_spacing));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(PixelAspectRatio)
+
 size_t PixelAspectRatio::ComputeSizeInternal() {
   // This box is optional. Skip it if it is not initialized.
   if (h_spacing == 0 && v_spacing == 0)
@@ -1481,7 +1593,8 @@ FourCC VideoSampleEntry::BoxType() const {
   return format;
 }
 
-bool VideoSampleEntry::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool VideoSampleEntry::ReadWriteInternal(Buffer* buffer) {
   std::vector<uint8_t> compressor_name;
   if (buffer->Reading()) {
     DCHECK(buffer->reader());
@@ -1594,6 +1707,8 @@ bool VideoSampleEntry::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(VideoSampleEntry)
+
 size_t VideoSampleEntry::ComputeSizeInternal() {
   const FourCC actual_format = GetActualFormat();
   if (actual_format == FOURCC_NULL)
@@ -1666,7 +1781,8 @@ FourCC ElementaryStreamDescriptor::BoxType() const {
   return FOURCC_esds;
 }
 
-bool ElementaryStreamDescriptor::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool ElementaryStreamDescriptor::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   if (buffer->Reading()) {
     std::vector<uint8_t> data;
@@ -1685,6 +1801,8 @@ bool ElementaryStreamDescriptor::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(ElementaryStreamDescriptor)
+
 size_t ElementaryStreamDescriptor::ComputeSizeInternal() {
   // This box is optional. Skip it if not initialized.
   if (es_descriptor.decoder_config_descriptor().object_type() ==
@@ -1702,7 +1820,8 @@ FourCC DTSSpecific::BoxType() const {
   return FOURCC_ddts;
 }
 
-bool DTSSpecific::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool DTSSpecific::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&sampling_frequency) &&
          buffer->ReadWriteUInt32(&max_bitrate) &&
@@ -1721,6 +1840,8 @@ bool DTSSpecific::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(DTSSpecific)
+
 size_t DTSSpecific::ComputeSizeInternal() {
   // This box is optional. Skip it if not initialized.
   if (sampling_frequency == 0)
@@ -1737,13 +1858,16 @@ FourCC AC3Specific::BoxType() const {
   return FOURCC_dac3;
 }
 
-bool AC3Specific::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool AC3Specific::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteVector(
              &data, buffer->Reading() ? buffer->BytesLeft() : data.size()));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(AC3Specific)
+
 size_t AC3Specific::ComputeSizeInternal() {
   // This box is optional. Skip it if not initialized.
   if (data.empty())
@@ -1758,13 +1882,16 @@ FourCC EC3Specific::BoxType() const {
   return FOURCC_dec3;
 }
 
-bool EC3Specific::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool EC3Specific::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   size_t size = buffer->Reading() ? buffer->BytesLeft() : data.size();
   RCHECK(buffer->ReadWriteVector(&data, size));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(EC3Specific)
+
 size_t EC3Specific::ComputeSizeInternal() {
   // This box is optional. Skip it if not initialized.
   if (data.empty())
@@ -1779,13 +1906,16 @@ FourCC AC4Specific::BoxType() const {
   return FOURCC_dac4;
 }
 
-bool AC4Specific::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool AC4Specific::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   size_t size = buffer->Reading() ? buffer->BytesLeft() : data.size();
   RCHECK(buffer->ReadWriteVector(&data, size));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(AC4Specific)
+
 size_t AC4Specific::ComputeSizeInternal() {
   // This box is optional. Skip it if not initialized.
   if (data.empty())
@@ -1800,7 +1930,8 @@ FourCC OpusSpecific::BoxType() const {
   return FOURCC_dOps;
 }
 
-bool OpusSpecific::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool OpusSpecific::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   if (buffer->Reading()) {
     std::vector<uint8_t> data;
@@ -1834,6 +1965,8 @@ bool OpusSpecific::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(OpusSpecific)
+
 size_t OpusSpecific::ComputeSizeInternal() {
   // This box is optional. Skip it if not initialized.
   if (opus_identification_header.empty())
@@ -1853,13 +1986,16 @@ FourCC FlacSpecific::BoxType() const {
   return FOURCC_dfLa;
 }
 
-bool FlacSpecific::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool FlacSpecific::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   size_t size = buffer->Reading() ? buffer->BytesLeft() : data.size();
   RCHECK(buffer->ReadWriteVector(&data, size));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(FlacSpecific)
+
 size_t FlacSpecific::ComputeSizeInternal() {
   // This box is optional. Skip it if not initialized.
   if (data.empty())
@@ -1878,7 +2014,8 @@ FourCC AudioSampleEntry::BoxType() const {
   return format;
 }
 
-bool AudioSampleEntry::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool AudioSampleEntry::ReadWriteInternal(Buffer* buffer) {
   if (buffer->Reading()) {
     DCHECK(buffer->reader());
     format = buffer->reader()->type();
@@ -1925,6 +2062,8 @@ bool AudioSampleEntry::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(AudioSampleEntry)
+
 size_t AudioSampleEntry::ComputeSizeInternal() {
   if (GetActualFormat() == FOURCC_NULL)
     return 0;
@@ -1945,12 +2084,15 @@ FourCC WebVTTConfigurationBox::BoxType() const {
   return FOURCC_vttC;
 }
 
-bool WebVTTConfigurationBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool WebVTTConfigurationBox::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   return buffer->ReadWriteString(
       &config, buffer->Reading() ? buffer->BytesLeft() : config.size());
 }
 
+DEFINE_BOX_READ_WRITE(WebVTTConfigurationBox)
+
 size_t WebVTTConfigurationBox::ComputeSizeInternal() {
   return HeaderSize() + config.size();
 }
@@ -1962,13 +2104,16 @@ FourCC WebVTTSourceLabelBox::BoxType() const {
   return FOURCC_vlab;
 }
 
-bool WebVTTSourceLabelBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool WebVTTSourceLabelBox::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   return buffer->ReadWriteString(&source_label, buffer->Reading()
                                                     ? buffer->BytesLeft()
                                                     : source_label.size());
 }
 
+DEFINE_BOX_READ_WRITE(WebVTTSourceLabelBox)
+
 size_t WebVTTSourceLabelBox::ComputeSizeInternal() {
   if (source_label.empty())
     return 0;
@@ -1986,7 +2131,8 @@ FourCC TextSampleEntry::BoxType() const {
   return format;
 }
 
-bool TextSampleEntry::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool TextSampleEntry::ReadWriteInternal(Buffer* buffer) {
   if (buffer->Reading()) {
     DCHECK(buffer->reader());
     format = buffer->reader()->type();
@@ -2004,6 +2150,8 @@ bool TextSampleEntry::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(TextSampleEntry)
+
 size_t TextSampleEntry::ComputeSizeInternal() {
   // 6 for the (anonymous) reserved bytes for SampleEntry class.
   return HeaderSize() + 6 + sizeof(data_reference_index) +
@@ -2017,7 +2165,8 @@ FourCC MediaHeader::BoxType() const {
   return FOURCC_mdhd;
 }
 
-bool MediaHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool MediaHeader::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
 
   uint8_t num_bytes = (version == 1) ? sizeof(uint64_t) : sizeof(uint32_t);
@@ -2031,6 +2180,8 @@ bool MediaHeader::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(MediaHeader)
+
 size_t MediaHeader::ComputeSizeInternal() {
   version = IsFitIn32Bits(creation_time, modification_time, duration) ? 0 : 1;
   return HeaderSize() + sizeof(timescale) +
@@ -2048,7 +2199,8 @@ VideoMediaHeader::~VideoMediaHeader() = default;
 FourCC VideoMediaHeader::BoxType() const {
   return FOURCC_vmhd;
 }
-bool VideoMediaHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool VideoMediaHeader::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt16(&graphicsmode) &&
          buffer->ReadWriteUInt16(&opcolor_red) &&
@@ -2057,6 +2209,8 @@ bool VideoMediaHeader::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(VideoMediaHeader)
+
 size_t VideoMediaHeader::ComputeSizeInternal() {
   return HeaderSize() + sizeof(graphicsmode) + sizeof(opcolor_red) +
          sizeof(opcolor_green) + sizeof(opcolor_blue);
@@ -2069,12 +2223,15 @@ FourCC SoundMediaHeader::BoxType() const {
   return FOURCC_smhd;
 }
 
-bool SoundMediaHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SoundMediaHeader::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteUInt16(&balance) &&
          buffer->IgnoreBytes(2));  // reserved.
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SoundMediaHeader)
+
 size_t SoundMediaHeader::ComputeSizeInternal() {
   return HeaderSize() + sizeof(balance) + sizeof(uint16_t);
 }
@@ -2086,10 +2243,13 @@ FourCC SubtitleMediaHeader::BoxType() const {
   return FOURCC_sthd;
 }
 
-bool SubtitleMediaHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SubtitleMediaHeader::ReadWriteInternal(Buffer* buffer) {
   return ReadWriteHeaderInternal(buffer);
 }
 
+DEFINE_BOX_READ_WRITE(SubtitleMediaHeader)
+
 size_t SubtitleMediaHeader::ComputeSizeInternal() {
   return HeaderSize();
 }
@@ -2104,7 +2264,8 @@ DataEntryUrl::~DataEntryUrl() = default;
 FourCC DataEntryUrl::BoxType() const {
   return FOURCC_url;
 }
-bool DataEntryUrl::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool DataEntryUrl::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   if (buffer->Reading()) {
     RCHECK(buffer->ReadWriteVector(&location, buffer->BytesLeft()));
@@ -2114,6 +2275,8 @@ bool DataEntryUrl::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(DataEntryUrl)
+
 size_t DataEntryUrl::ComputeSizeInternal() {
   return HeaderSize() + location.size();
 }
@@ -2124,7 +2287,8 @@ DataReference::~DataReference() = default;
 FourCC DataReference::BoxType() const {
   return FOURCC_dref;
 }
-bool DataReference::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool DataReference::ReadWriteInternal(Buffer* buffer) {
   uint32_t entry_count = static_cast<uint32_t>(data_entry.size());
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&entry_count));
@@ -2135,6 +2299,8 @@ bool DataReference::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(DataReference)
+
 size_t DataReference::ComputeSizeInternal() {
   uint32_t count = static_cast<uint32_t>(data_entry.size());
   size_t box_size = HeaderSize() + sizeof(count);
@@ -2150,11 +2316,14 @@ FourCC DataInformation::BoxType() const {
   return FOURCC_dinf;
 }
 
-bool DataInformation::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool DataInformation::ReadWriteInternal(Buffer* buffer) {
   return ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&dref);
 }
 
+DEFINE_BOX_READ_WRITE(DataInformation)
+
 size_t DataInformation::ComputeSizeInternal() {
   return HeaderSize() + dref.ComputeSize();
 }
@@ -2166,7 +2335,8 @@ FourCC MediaInformation::BoxType() const {
   return FOURCC_minf;
 }
 
-bool MediaInformation::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool MediaInformation::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&dinf) &&
          buffer->ReadWriteChild(&sample_table));
@@ -2187,6 +2357,8 @@ bool MediaInformation::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(MediaInformation)
+
 size_t MediaInformation::ComputeSizeInternal() {
   size_t box_size =
       HeaderSize() + dinf.ComputeSize() + sample_table.ComputeSize();
@@ -2213,7 +2385,8 @@ FourCC Media::BoxType() const {
   return FOURCC_mdia;
 }
 
-bool Media::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool Media::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&header));
   if (buffer->Reading()) {
@@ -2236,6 +2409,8 @@ bool Media::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(Media)
+
 size_t Media::ComputeSizeInternal() {
   handler.handler_type =
       TrackTypeToFourCC(information.sample_table.description.type);
@@ -2250,7 +2425,8 @@ FourCC Track::BoxType() const {
   return FOURCC_trak;
 }
 
-bool Track::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool Track::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&header) && buffer->ReadWriteChild(&media) &&
          buffer->TryReadWriteChild(&edit) &&
@@ -2258,6 +2434,8 @@ bool Track::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(Track)
+
 size_t Track::ComputeSizeInternal() {
   return HeaderSize() + header.ComputeSize() + media.ComputeSize() +
          edit.ComputeSize();
@@ -2270,13 +2448,16 @@ FourCC MovieExtendsHeader::BoxType() const {
   return FOURCC_mehd;
 }
 
-bool MovieExtendsHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool MovieExtendsHeader::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   size_t num_bytes = (version == 1) ? sizeof(uint64_t) : sizeof(uint32_t);
   RCHECK(buffer->ReadWriteUInt64NBytes(&fragment_duration, num_bytes));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(MovieExtendsHeader)
+
 size_t MovieExtendsHeader::ComputeSizeInternal() {
   // This box is optional. Skip it if it is not used.
   if (fragment_duration == 0)
@@ -2292,7 +2473,8 @@ FourCC TrackExtends::BoxType() const {
   return FOURCC_trex;
 }
 
-bool TrackExtends::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool TrackExtends::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&track_id) &&
          buffer->ReadWriteUInt32(&default_sample_description_index) &&
@@ -2302,6 +2484,8 @@ bool TrackExtends::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(TrackExtends)
+
 size_t TrackExtends::ComputeSizeInternal() {
   return HeaderSize() + sizeof(track_id) +
          sizeof(default_sample_description_index) +
@@ -2316,7 +2500,8 @@ FourCC MovieExtends::BoxType() const {
   return FOURCC_mvex;
 }
 
-bool MovieExtends::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool MovieExtends::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->TryReadWriteChild(&header));
   if (buffer->Reading()) {
@@ -2329,6 +2514,8 @@ bool MovieExtends::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(MovieExtends)
+
 size_t MovieExtends::ComputeSizeInternal() {
   // This box is optional. Skip it if it does not contain any track.
   if (tracks.size() == 0)
@@ -2346,7 +2533,8 @@ FourCC Movie::BoxType() const {
   return FOURCC_moov;
 }
 
-bool Movie::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool Movie::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&header));
   if (buffer->Reading()) {
@@ -2379,6 +2567,8 @@ bool Movie::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(Movie)
+
 size_t Movie::ComputeSizeInternal() {
   size_t box_size = HeaderSize() + header.ComputeSize() +
                     metadata.ComputeSize() + extends.ComputeSize();
@@ -2396,13 +2586,16 @@ FourCC TrackFragmentDecodeTime::BoxType() const {
   return FOURCC_tfdt;
 }
 
-bool TrackFragmentDecodeTime::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool TrackFragmentDecodeTime::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   size_t num_bytes = (version == 1) ? sizeof(uint64_t) : sizeof(uint32_t);
   RCHECK(buffer->ReadWriteUInt64NBytes(&decode_time, num_bytes));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(TrackFragmentDecodeTime)
+
 size_t TrackFragmentDecodeTime::ComputeSizeInternal() {
   version = IsFitIn32Bits(decode_time) ? 0 : 1;
   return HeaderSize() + sizeof(uint32_t) * (1 + version);
@@ -2415,11 +2608,14 @@ FourCC MovieFragmentHeader::BoxType() const {
   return FOURCC_mfhd;
 }
 
-bool MovieFragmentHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool MovieFragmentHeader::ReadWriteInternal(Buffer* buffer) {
   return ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&sequence_number);
 }
 
+DEFINE_BOX_READ_WRITE(MovieFragmentHeader)
+
 size_t MovieFragmentHeader::ComputeSizeInternal() {
   return HeaderSize() + sizeof(sequence_number);
 }
@@ -2431,7 +2627,8 @@ FourCC TrackFragmentHeader::BoxType() const {
   return FOURCC_tfhd;
 }
 
-bool TrackFragmentHeader::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool TrackFragmentHeader::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteUInt32(&track_id));
 
   if (flags & kBaseDataOffsetPresentMask) {
@@ -2468,6 +2665,8 @@ bool TrackFragmentHeader::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(TrackFragmentHeader)
+
 size_t TrackFragmentHeader::ComputeSizeInternal() {
   size_t box_size = HeaderSize() + sizeof(track_id);
   if (flags & kSampleDescriptionIndexPresentMask)
@@ -2488,7 +2687,8 @@ FourCC TrackFragmentRun::BoxType() const {
   return FOURCC_trun;
 }
 
-bool TrackFragmentRun::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool TrackFragmentRun::ReadWriteInternal(Buffer* buffer) {
   if (!buffer->Reading()) {
     // Determine whether version 0 or version 1 should be used.
     // Use version 0 if possible, use version 1 if there is a negative
@@ -2591,6 +2791,8 @@ bool TrackFragmentRun::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(TrackFragmentRun)
+
 size_t TrackFragmentRun::ComputeSizeInternal() {
   size_t box_size = HeaderSize() + sizeof(sample_count);
   if (flags & kDataOffsetPresentMask)
@@ -2612,7 +2814,8 @@ FourCC TrackFragment::BoxType() const {
   return FOURCC_traf;
 }
 
-bool TrackFragment::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool TrackFragment::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&header));
   if (buffer->Reading()) {
@@ -2638,6 +2841,8 @@ bool TrackFragment::ReadWriteInternal(BoxBuffer* buffer) {
          buffer->TryReadWriteChild(&sample_encryption);
 }
 
+DEFINE_BOX_READ_WRITE(TrackFragment)
+
 size_t TrackFragment::ComputeSizeInternal() {
   size_t box_size = HeaderSize() + header.ComputeSize() +
                     decode_time.ComputeSize() + auxiliary_size.ComputeSize() +
@@ -2652,6 +2857,11 @@ size_t TrackFragment::ComputeSizeInternal() {
   return box_size;
 }
 
+bool TrackFragment::PrepareOnePassWrite() {
+  // The children are prepared as they are written.
+  return true;
+}
+
 MovieFragment::MovieFragment() = default;
 MovieFragment::~MovieFragment() = default;
 
@@ -2659,7 +2869,8 @@ FourCC MovieFragment::BoxType() const {
   return FOURCC_moof;
 }
 
-bool MovieFragment::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool MovieFragment::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->ReadWriteChild(&header));
   if (buffer->Reading()) {
@@ -2675,6 +2886,8 @@ bool MovieFragment::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(MovieFragment)
+
 size_t MovieFragment::ComputeSizeInternal() {
   size_t box_size = HeaderSize() + header.ComputeSize();
   for (uint32_t i = 0; i < tracks.size(); ++i)
@@ -2684,6 +2897,11 @@ size_t MovieFragment::ComputeSizeInternal() {
   return box_size;
 }
 
+bool MovieFragment::PrepareOnePassWrite() {
+  // The children are prepared as they are written.
+  return true;
+}
+
 SegmentIndex::SegmentIndex() = default;
 SegmentIndex::~SegmentIndex() = default;
 
@@ -2691,7 +2909,8 @@ FourCC SegmentIndex::BoxType() const {
   return FOURCC_sidx;
 }
 
-bool SegmentIndex::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool SegmentIndex::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&reference_id) &&
          buffer->ReadWriteUInt32(&timescale));
@@ -2732,6 +2951,8 @@ bool SegmentIndex::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(SegmentIndex)
+
 size_t SegmentIndex::ComputeSizeInternal() {
   version = IsFitIn32Bits(earliest_presentation_time, first_offset) ? 0 : 1;
   return HeaderSize() + sizeof(reference_id) + sizeof(timescale) +
@@ -2739,6 +2960,31 @@ size_t SegmentIndex::ComputeSizeInternal() {
          3 * sizeof(uint32_t) * references.size();
 }
 
+ProducerReferenceTime::ProducerReferenceTime() = default;
+ProducerReferenceTime::~ProducerReferenceTime() = default;
+
+FourCC ProducerReferenceTime::BoxType() const {
+  return FOURCC_prft;
+}
+
+template <typename Buffer>
+bool ProducerReferenceTime::ReadWriteInternal(Buffer* buffer) {
+  size_t num_bytes = (version == 1) ? sizeof(uint64_t) : sizeof(uint32_t);
+  RCHECK(ReadWriteHeaderInternal(buffer) &&
+         buffer->ReadWriteUInt32(&reference_track_id) &&
+         buffer->ReadWriteUInt64(&ntp_timestamp) &&
+         buffer->ReadWriteUInt64NBytes(&media_time, num_bytes));
+  return true;
+}
+
+DEFINE_BOX_READ_WRITE(ProducerReferenceTime)
+
+size_t ProducerReferenceTime::ComputeSizeInternal() {
+  version = IsFitIn32Bits(media_time) ? 0 : 1;
+  return HeaderSize() + sizeof(reference_track_id) + sizeof(ntp_timestamp) +
+         sizeof(uint32_t) * (1 + version);
+}
+
 MediaData::MediaData() = default;
 MediaData::~MediaData() = default;
 
@@ -2746,11 +2992,14 @@ FourCC MediaData::BoxType() const {
   return FOURCC_mdat;
 }
 
-bool MediaData::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool MediaData::ReadWriteInternal(Buffer* buffer) {
   NOTIMPLEMENTED() << "Actual data is parsed and written separately.";
   return false;
 }
 
+DEFINE_BOX_READ_WRITE(MediaData)
+
 size_t MediaData::ComputeSizeInternal() {
   return HeaderSize() + data_size;
 }
@@ -2762,11 +3011,14 @@ FourCC CueSourceIDBox::BoxType() const {
   return FOURCC_vsid;
 }
 
-bool CueSourceIDBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool CueSourceIDBox::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteInt32(&source_id));
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(CueSourceIDBox)
+
 size_t CueSourceIDBox::ComputeSizeInternal() {
   if (source_id == kCueSourceIdNotSet)
     return 0;
@@ -2780,13 +3032,16 @@ FourCC CueTimeBox::BoxType() const {
   return FOURCC_ctim;
 }
 
-bool CueTimeBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool CueTimeBox::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   return buffer->ReadWriteString(
       &cue_current_time,
       buffer->Reading() ? buffer->BytesLeft() : cue_current_time.size());
 }
 
+DEFINE_BOX_READ_WRITE(CueTimeBox)
+
 size_t CueTimeBox::ComputeSizeInternal() {
   if (cue_current_time.empty())
     return 0;
@@ -2800,12 +3055,15 @@ FourCC CueIDBox::BoxType() const {
   return FOURCC_iden;
 }
 
-bool CueIDBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool CueIDBox::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   return buffer->ReadWriteString(
       &cue_id, buffer->Reading() ? buffer->BytesLeft() : cue_id.size());
 }
 
+DEFINE_BOX_READ_WRITE(CueIDBox)
+
 size_t CueIDBox::ComputeSizeInternal() {
   if (cue_id.empty())
     return 0;
@@ -2819,12 +3077,15 @@ FourCC CueSettingsBox::BoxType() const {
   return FOURCC_sttg;
 }
 
-bool CueSettingsBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool CueSettingsBox::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   return buffer->ReadWriteString(
       &settings, buffer->Reading() ? buffer->BytesLeft() : settings.size());
 }
 
+DEFINE_BOX_READ_WRITE(CueSettingsBox)
+
 size_t CueSettingsBox::ComputeSizeInternal() {
   if (settings.empty())
     return 0;
@@ -2838,12 +3099,15 @@ FourCC CuePayloadBox::BoxType() const {
   return FOURCC_payl;
 }
 
-bool CuePayloadBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool CuePayloadBox::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   return buffer->ReadWriteString(
       &cue_text, buffer->Reading() ? buffer->BytesLeft() : cue_text.size());
 }
 
+DEFINE_BOX_READ_WRITE(CuePayloadBox)
+
 size_t CuePayloadBox::ComputeSizeInternal() {
   return HeaderSize() + cue_text.size();
 }
@@ -2855,10 +3119,13 @@ FourCC VTTEmptyCueBox::BoxType() const {
   return FOURCC_vtte;
 }
 
-bool VTTEmptyCueBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool VTTEmptyCueBox::ReadWriteInternal(Buffer* buffer) {
   return ReadWriteHeaderInternal(buffer);
 }
 
+DEFINE_BOX_READ_WRITE(VTTEmptyCueBox)
+
 size_t VTTEmptyCueBox::ComputeSizeInternal() {
   return HeaderSize();
 }
@@ -2870,13 +3137,16 @@ FourCC VTTAdditionalTextBox::BoxType() const {
   return FOURCC_vtta;
 }
 
-bool VTTAdditionalTextBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool VTTAdditionalTextBox::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer));
   return buffer->ReadWriteString(
       &cue_additional_text,
       buffer->Reading() ? buffer->BytesLeft() : cue_additional_text.size());
 }
 
+DEFINE_BOX_READ_WRITE(VTTAdditionalTextBox)
+
 size_t VTTAdditionalTextBox::ComputeSizeInternal() {
   return HeaderSize() + cue_additional_text.size();
 }
@@ -2888,7 +3158,8 @@ FourCC VTTCueBox::BoxType() const {
   return FOURCC_vttc;
 }
 
-bool VTTCueBox::ReadWriteInternal(BoxBuffer* buffer) {
+template <typename Buffer>
+bool VTTCueBox::ReadWriteInternal(Buffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
          buffer->TryReadWriteChild(&cue_source_id) &&
          buffer->TryReadWriteChild(&cue_id) &&
@@ -2898,6 +3169,8 @@ bool VTTCueBox::ReadWriteInternal(BoxBuffer* buffer) {
   return true;
 }
 
+DEFINE_BOX_READ_WRITE(VTTCueBox)
+
 size_t VTTCueBox::ComputeSizeInternal() {
   return HeaderSize() + cue_source_id.ComputeSize() + cue_id.ComputeSize() +
          cue_time.ComputeSize() + cue_settings.ComputeSize() +
@@ -28,19 +28,20 @@ enum TrackType {
   kText,
 };
 
-class BoxBuffer;
-
-#define DECLARE_BOX_METHODS(T)                        \
- public:                                              \
-  T();                                                \
-  ~T() override;                                      \
-                                                      \
-  FourCC BoxType() const override;                    \
-                                                      \
- private:                                             \
-  bool ReadWriteInternal(BoxBuffer* buffer) override; \
-  size_t ComputeSizeInternal() override;              \
-                                                      \
+#define DECLARE_BOX_METHODS(T)                         \
+ public:                                               \
+  T();                                                 \
+  ~T() override;                                       \
+                                                       \
+  FourCC BoxType() const override;                     \
+                                                       \
+ private:                                              \
+  bool ReadInternal(BoxReadBuffer* buffer) override;   \
+  bool WriteInternal(BoxWriteBuffer* buffer) override; \
+  template <typename Buffer>                           \
+  bool ReadWriteInternal(Buffer* buffer);              \
+  size_t ComputeSizeInternal() override;               \
+                                                       \
  public:
 
 struct FileType : Box {
@@ -82,7 +83,8 @@ struct SampleEncryptionEntry {
   ///        constains subsamples.
   /// @param buffer points to the box buffer for reading or writing.
   /// @return true on success, false otherwise.
-  bool ReadWrite(uint8_t iv_size, bool has_subsamples, BoxBuffer* buffer);
+  template <typename Buffer>
+  bool ReadWrite(uint8_t iv_size, bool has_subsamples, Buffer* buffer);
   /// Parse SampleEncryptionEntry from buffer.
   /// @param iv_size specifies the size of initialization vector.
   /// @param has_subsamples indicates whether this sample encryption entry
@@ -125,6 +127,9 @@ struct SampleEncryption : FullBox {
 
   uint8_t iv_size = kInvalidIvSize;
   std::vector<SampleEncryptionEntry> sample_encryption_entries;
+
+ private:
+  bool PrepareOnePassWrite() override;
 };
 
 struct OriginalFormat : Box {
@@ -231,7 +236,8 @@ struct HandlerReference : FullBox {
 };
 
 struct Language {
-  bool ReadWrite(BoxBuffer* buffer);
+  template <typename Buffer>
+  bool ReadWrite(Buffer* buffer);
   uint32_t ComputeSize() const;
 
   std::string code;
@@ -501,7 +507,8 @@ struct SyncSample : FullBox {
 };
 
 struct CencSampleEncryptionInfoEntry {
-  bool ReadWrite(BoxBuffer* buffer);
+  template <typename Buffer>
+  bool ReadWrite(Buffer* buffer);
   uint32_t ComputeSize() const;
 
   uint8_t is_protected = 0u;
@@ -517,7 +524,8 @@ struct CencSampleEncryptionInfoEntry {
 };
 
 struct AudioRollRecoveryEntry {
-  bool ReadWrite(BoxBuffer* buffer);
+  template <typename Buffer>
+  bool ReadWrite(Buffer* buffer);
   uint32_t ComputeSize() const;
 
   int16_t roll_distance = 0;
@@ -526,8 +534,8 @@ struct AudioRollRecoveryEntry {
 struct SampleGroupDescription : FullBox {
   DECLARE_BOX_METHODS(SampleGroupDescription);
 
-  template <typename T>
-  bool ReadWriteEntries(BoxBuffer* buffer, std::vector<T>* entries);
+  template <typename Buffer, typename T>
+  bool ReadWriteEntries(Buffer* buffer, std::vector<T>* entries);
 
   uint32_t grouping_type = 0;
   // Only present if grouping_type == 'seig'.
@@ -755,6 +763,9 @@ struct TrackFragment : Box {
   SampleAuxiliaryInformationSize auxiliary_size;
   SampleAuxiliaryInformationOffset auxiliary_offset;
   SampleEncryption sample_encryption;
+
+ private:
+  bool PrepareOnePassWrite() override;
 };
 
 struct MovieFragment : Box {
@@ -763,6 +774,9 @@ struct MovieFragment : Box {
   MovieFragmentHeader header;
   std::vector<TrackFragment> tracks;
   std::vector<ProtectionSystemSpecificHeader> pssh;
+
+ private:
+  bool PrepareOnePassWrite() override;
 };
 
 struct SegmentReference {
@@ -797,6 +811,17 @@ struct SegmentIndex : FullBox {
   std::vector<SegmentReference> references;
 };
 
+struct ProducerReferenceTime : FullBox {
+  DECLARE_BOX_METHODS(ProducerReferenceTime);
+
+  uint32_t reference_track_id = 0u;
+  // The wall clock time at which |media_time| was produced, in the NTP
+  // format, i.e. seconds since 1900 in the upper 32 bits and the fraction of
+  // a second in the lower 32 bits.
+  uint64_t ntp_timestamp = 0u;
+  uint64_t media_time = 0u;
+};
+
 // The actual data is parsed and written separately.
 struct MediaData : Box {
   DECLARE_BOX_METHODS(MediaData);
@@ -463,6 +463,13 @@ inline bool operator==(const SegmentIndex& lhs, const SegmentIndex& rhs) {
          lhs.references == rhs.references;
 }
 
+inline bool operator==(const ProducerReferenceTime& lhs,
+                       const ProducerReferenceTime& rhs) {
+  return lhs.reference_track_id == rhs.reference_track_id &&
+         lhs.ntp_timestamp == rhs.ntp_timestamp &&
+         lhs.media_time == rhs.media_time;
+}
+
 inline bool operator==(const CueSourceIDBox& lhs,
                        const CueSourceIDBox& rhs) {
   return lhs.source_id == rhs.source_id;
@@ -0,0 +1,84 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/test/perf_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+
+namespace {
+
+// A typical two-second video fragment at 60fps.
+const uint32_t kSampleCount = 120;
+
+MovieFragment CreateMovieFragment() {
+  MovieFragment moof;
+  moof.header.sequence_number = 1;
+  moof.tracks.resize(1);
+  TrackFragment& traf = moof.tracks[0];
+  traf.header.track_id = 1;
+  traf.header.flags = TrackFragmentHeader::kDefaultBaseIsMoofMask;
+  traf.decode_time.decode_time = 90000;
+
+  traf.runs.resize(1);
+  TrackFragmentRun& trun = traf.runs[0];
+  trun.flags = TrackFragmentRun::kDataOffsetPresentMask |
+               TrackFragmentRun::kSampleDurationPresentMask |
+               TrackFragmentRun::kSampleSizePresentMask |
+               TrackFragmentRun::kSampleFlagsPresentMask |
+               TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
+  trun.sample_count = kSampleCount;
+  for (uint32_t i = 0; i < kSampleCount; ++i) {
+    trun.sample_durations.push_back(1500);
+    trun.sample_sizes.push_back(10000 + i * 37);
+    trun.sample_flags.push_back(i == 0 ? 0 : 0x10000);
+    trun.sample_composition_time_offsets.push_back((i % 3) * 1500);
+  }
+  return moof;
+}
+
+}  // namespace
+
+TEST(BoxDefinitionsPerfTest, WriteMovieFragment) {
+  MovieFragment moof = CreateMovieFragment();
+  BufferWriter buffer;
+  moof.Write(&buffer);
+  const size_t moof_size = buffer.Size();
+
+  MeasureThroughput("moof_serialization", "trun", moof_size, [&]() {
+    buffer.Clear();
+    moof.Write(&buffer);
+  });
+  MeasureOperationRate("moof_serialization", "trun", [&]() {
+    buffer.Clear();
+    moof.Write(&buffer);
+  });
+}
+
+TEST(BoxDefinitionsPerfTest, WriteMovieFragmentInOnePass) {
+  MovieFragment moof = CreateMovieFragment();
+  BufferWriter buffer;
+  moof.WriteInOnePass(&buffer);
+  const size_t moof_size = buffer.Size();
+
+  MeasureThroughput("moof_serialization", "trun_one_pass", moof_size, [&]() {
+    buffer.Clear();
+    moof.WriteInOnePass(&buffer);
+  });
+  MeasureOperationRate("moof_serialization", "trun_one_pass", [&]() {
+    buffer.Clear();
+    moof.WriteInOnePass(&buffer);
+  });
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
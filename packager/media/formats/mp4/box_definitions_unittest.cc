@@ -789,6 +789,18 @@ class BoxDefinitionsTestGeneral : public testing::Test {
     tfdt->version = 0;
   }
 
+  void Fill(ProducerReferenceTime* prft) {
+    prft->reference_track_id = 1;
+    prft->ntp_timestamp = 0xE3F1A2B312345678ULL;
+    prft->media_time = 234029673820ULL;
+    prft->version = 1;
+  }
+
+  void Modify(ProducerReferenceTime* prft) {
+    prft->media_time = 4567;
+    prft->version = 0;
+  }
+
   void Fill(MovieFragmentHeader* mfhd) { mfhd->sequence_number = 23235; }
 
   void Modify(MovieFragmentHeader* mfhd) { mfhd->sequence_number = 67890; }
@@ -1062,6 +1074,7 @@ typedef testing::Types<MediaHeader,
                        MovieExtends,
                        Movie,
                        TrackFragmentDecodeTime,
+                       ProducerReferenceTime,
                        MovieFragmentHeader,
                        TrackFragmentHeader,
                        TrackFragmentRun,
@@ -1400,6 +1413,43 @@ TEST_F(BoxDefinitionsTest, SampleEncryptionWithIvUnknownWhenReading) {
   ASSERT_EQ(senc.sample_encryption_entries, sample_encryption_entries);
 }
 
+TEST_F(BoxDefinitionsTest, MovieFragmentWriteInOnePass) {
+  MovieFragment moof;
+  Fill(&moof);
+  Modify(&moof);
+  Fill(&moof.tracks[0].sample_encryption);
+  moof.pssh.resize(1);
+  Fill(&moof.pssh[0]);
+  // Optional boxes that are empty should be skipped.
+  moof.tracks[1].auxiliary_offset.offsets.clear();
+  moof.tracks[1].auxiliary_size.sample_count = 0;
+
+  moof.Write(buffer_.get());
+  const std::vector<uint8_t> expected(buffer_->Buffer(),
+                                      buffer_->Buffer() + buffer_->Size());
+  const uint32_t expected_box_size = moof.box_size();
+  const uint32_t expected_senc_box_size =
+      moof.tracks[0].sample_encryption.box_size();
+
+  // Invalidate the box sizes, which should be updated by the write.
+  MovieFragment moof_one_pass = moof;
+  moof_one_pass.ComputeSize();
+  moof_one_pass.tracks[0].sample_encryption.flags = 0;
+  moof_one_pass.tracks[0].sample_encryption.ComputeSize();
+  moof_one_pass.tracks[0].sample_encryption.flags =
+      moof.tracks[0].sample_encryption.flags;
+
+  BufferWriter one_pass_buffer;
+  moof_one_pass.WriteInOnePass(&one_pass_buffer);
+  EXPECT_EQ(expected,
+            std::vector<uint8_t>(
+                one_pass_buffer.Buffer(),
+                one_pass_buffer.Buffer() + one_pass_buffer.Size()));
+  EXPECT_EQ(expected_box_size, moof_one_pass.box_size());
+  EXPECT_EQ(expected_senc_box_size,
+            moof_one_pass.tracks[0].sample_encryption.box_size());
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
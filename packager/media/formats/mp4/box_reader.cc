@@ -24,10 +24,10 @@ BoxReader::BoxReader(const uint8_t* buf, size_t size)
 }
 
 BoxReader::~BoxReader() {
-  if (scanned_ && !children_.empty()) {
-    for (ChildMap::iterator itr = children_.begin(); itr != children_.end();
-         ++itr) {
-      DVLOG(1) << "Skipping unknown box: " << FourCCToString(itr->first);
+  if (scanned_) {
+    for (const ChildEntry& child : children_) {
+      if (!child.read)
+        DVLOG(1) << "Skipping unknown box: " << FourCCToString(child.type);
     }
   }
 }
@@ -68,17 +68,17 @@ bool BoxReader::ScanChildren() {
   DCHECK(!scanned_);
   scanned_ = true;
 
+  // Only the headers are read. The readers of the children are created when
+  // the children are read.
   while (pos() < size()) {
-    std::unique_ptr<BoxReader> child(
-        new BoxReader(&data()[pos()], size() - pos()));
+    FourCC box_type;
+    uint64_t box_size;
     bool err;
-    if (!child->ReadHeader(&err))
+    if (!StartBox(&data()[pos()], size() - pos(), &box_type, &box_size, &err))
       return false;
 
-    FourCC box_type = child->type();
-    size_t box_size = child->size();
-    children_.insert(std::pair<FourCC, std::unique_ptr<BoxReader>>(
-        box_type, std::move(child)));
+    children_.push_back({box_type, pos(), static_cast<size_t>(box_size),
+                         false});
     VLOG(2) << "Child " << FourCCToString(box_type) << " size 0x" << std::hex
             << box_size << std::dec;
     RCHECK(SkipBytes(box_size));
@@ -91,24 +91,39 @@ bool BoxReader::ReadChild(Box* child) {
   DCHECK(scanned_);
   FourCC child_type = child->BoxType();
 
-  ChildMap::iterator itr = children_.find(child_type);
-  RCHECK(itr != children_.end());
+  ChildEntry* entry = FindChild(child_type);
+  RCHECK(entry);
   DVLOG(2) << "Found a " << FourCCToString(child_type) << " box.";
-  RCHECK(child->Parse(itr->second.get()));
-  children_.erase(itr);
-  return true;
+  return ParseChild(entry, child);
 }
 
 bool BoxReader::ChildExist(Box* child) {
-  return children_.count(child->BoxType()) > 0;
+  return FindChild(child->BoxType()) != nullptr;
 }
 
 bool BoxReader::TryReadChild(Box* child) {
-  if (!children_.count(child->BoxType()))
+  if (!FindChild(child->BoxType()))
     return true;
   return ReadChild(child);
 }
 
+bool BoxReader::ParseChild(ChildEntry* child, Box* box) {
+  DCHECK(!child->read);
+  child->read = true;
+  BoxReader child_reader(&data()[child->offset], child->size);
+  bool err;
+  RCHECK(child_reader.ReadHeader(&err));
+  return box->Parse(&child_reader);
+}
+
+BoxReader::ChildEntry* BoxReader::FindChild(FourCC type) {
+  for (ChildEntry& child : children_) {
+    if (child.type == type && !child.read)
+      return &child;
+  }
+  return nullptr;
+}
+
 bool BoxReader::ReadHeader(bool* err) {
   uint64_t size = 0;
   *err = false;
@@ -5,7 +5,6 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP4_BOX_READER_H_
 #define PACKAGER_MEDIA_FORMATS_MP4_BOX_READER_H_
 
-#include <map>
 #include <memory>
 #include <vector>
 
@@ -111,13 +110,27 @@ class BoxReader : public BufferReader {
   // true, the error is unrecoverable and the stream should be aborted.
   bool ReadHeader(bool* err);
 
-  FourCC type_;
+  // A child box found by ScanChildren().
+  struct ChildEntry {
+    FourCC type;
+    // The position and size of the child box, header included, in the box.
+    size_t offset;
+    size_t size;
+    bool read;
+  };
+
+  // Parse |box| from |child|, and mark |child| read.
+  bool ParseChild(ChildEntry* child, Box* box);
 
-  typedef std::multimap<FourCC, std::unique_ptr<BoxReader>> ChildMap;
+  // @return the first child of type |type| not read yet, or nullptr.
+  ChildEntry* FindChild(FourCC type);
 
-  // The set of child box FourCCs and their corresponding buffer readers. Only
-  // valid if scanned_ is true.
-  ChildMap children_;
+  FourCC type_;
+
+  // The child boxes, in the order of the box. Their readers are only created
+  // when they are read, so the children which are never read cost nothing
+  // more than their entry. Only valid if scanned_ is true.
+  std::vector<ChildEntry> children_;
   bool scanned_;
 
   DISALLOW_COPY_AND_ASSIGN(BoxReader);
@@ -138,15 +151,19 @@ bool BoxReader::TryReadChildren(std::vector<T>* children) {
   children->resize(1);
   FourCC child_type = (*children)[0].BoxType();
 
-  ChildMap::iterator start_itr = children_.lower_bound(child_type);
-  ChildMap::iterator end_itr = children_.upper_bound(child_type);
-  children->resize(std::distance(start_itr, end_itr));
+  size_t num_children = 0;
+  for (const ChildEntry& child : children_) {
+    if (child.type == child_type && !child.read)
+      ++num_children;
+  }
+  children->resize(num_children);
   typename std::vector<T>::iterator child_itr = children->begin();
-  for (ChildMap::iterator itr = start_itr; itr != end_itr; ++itr) {
-    RCHECK(child_itr->Parse(itr->second.get()));
+  for (ChildEntry& child : children_) {
+    if (child.type != child_type || child.read)
+      continue;
+    RCHECK(ParseChild(&child, &*child_itr));
     ++child_itr;
   }
-  children_.erase(start_itr, end_itr);
 
   DVLOG(2) << "Found " << children->size() << " " << FourCCToString(child_type)
            << " boxes.";
@@ -32,8 +32,10 @@ static const uint8_t kSkipBox[] = {
 
 struct FreeBox : Box {
   FourCC BoxType() const override { return FOURCC_free; }
-  bool ReadWriteInternal(BoxBuffer* buffer) override {
-    return true;
+  bool ReadInternal(BoxReadBuffer* buffer) override { return true; }
+  bool WriteInternal(BoxWriteBuffer* buffer) override {
+    NOTIMPLEMENTED();
+    return false;
   }
   size_t ComputeSizeInternal() override {
     NOTIMPLEMENTED();
@@ -43,9 +45,13 @@ struct FreeBox : Box {
 
 struct PsshBox : Box {
   FourCC BoxType() const override { return FOURCC_pssh; }
-  bool ReadWriteInternal(BoxBuffer* buffer) override {
+  bool ReadInternal(BoxReadBuffer* buffer) override {
     return buffer->ReadWriteUInt32(&val);
   }
+  bool WriteInternal(BoxWriteBuffer* buffer) override {
+    NOTIMPLEMENTED();
+    return false;
+  }
   size_t ComputeSizeInternal() override {
     NOTIMPLEMENTED();
     return 0;
@@ -56,20 +62,20 @@ struct PsshBox : Box {
 
 struct SkipBox : FullBox {
   FourCC BoxType() const override { return FOURCC_skip; }
-  bool ReadWriteInternal(BoxBuffer* buffer) override {
+  bool ReadInternal(BoxReadBuffer* buffer) override {
     RCHECK(ReadWriteHeaderInternal(buffer) && buffer->ReadWriteUInt8(&a) &&
            buffer->ReadWriteUInt8(&b) && buffer->ReadWriteUInt16(&c) &&
            buffer->ReadWriteInt32(&d) &&
            buffer->ReadWriteInt64NBytes(&e, sizeof(uint32_t)));
     RCHECK(buffer->PrepareChildren());
-    if (buffer->Reading()) {
-      DCHECK(buffer->reader());
-      RCHECK(buffer->reader()->ReadChildren(&kids));
-    } else {
-      NOTIMPLEMENTED();
-    }
+    DCHECK(buffer->reader());
+    RCHECK(buffer->reader()->ReadChildren(&kids));
     return buffer->TryReadWriteChild(&empty);
   }
+  bool WriteInternal(BoxWriteBuffer* buffer) override {
+    NOTIMPLEMENTED();
+    return false;
+  }
   size_t ComputeSizeInternal() override {
     NOTIMPLEMENTED();
     return 0;
@@ -14,6 +14,7 @@
 #include "packager/media/base/media_sample.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/key_frame_info.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -31,28 +32,39 @@ int64_t GetSeekPreroll(const StreamInfo& stream_info) {
   return audio_stream_info.seek_preroll_ns();
 }
 
-void NewSampleEncryptionEntry(const DecryptConfig& decrypt_config,
-                              bool use_constant_iv,
-                              TrackFragment* traf) {
-  SampleEncryption& sample_encryption = traf->sample_encryption;
-  SampleEncryptionEntry sample_encryption_entry;
-  if (!use_constant_iv)
-    sample_encryption_entry.initialization_vector = decrypt_config.iv();
-  sample_encryption_entry.subsamples = decrypt_config.subsamples();
-  sample_encryption.sample_encryption_entries.push_back(
-      sample_encryption_entry);
-  traf->auxiliary_size.sample_info_sizes.push_back(
-      sample_encryption_entry.ComputeSize());
+// Adds |value| to the per-sample |entries| of a fragment with |sample_count|
+// samples before it. The first value is kept in |default_value| and the
+// entries are only built once a value differs from it, as a field with the
+// same value for all the samples is hoisted to the 'tfhd' defaults.
+template <typename T>
+void AddSampleEntry(T value,
+                    uint32_t sample_count,
+                    uint32_t expected_sample_count,
+                    std::vector<T>* entries,
+                    T* default_value) {
+  if (sample_count == 0) {
+    *default_value = value;
+    return;
+  }
+  if (entries->empty()) {
+    if (value == *default_value)
+      return;
+    entries->reserve(std::max(expected_sample_count, sample_count + 1));
+    entries->assign(sample_count, *default_value);
+  }
+  entries->push_back(value);
 }
 
 }  // namespace
 
 Fragmenter::Fragmenter(std::shared_ptr<const StreamInfo> stream_info,
                        TrackFragment* traf,
-                       int64_t edit_list_offset)
+                       int64_t edit_list_offset,
+                       bool reference_sample_data)
     : stream_info_(std::move(stream_info)),
       traf_(traf),
       edit_list_offset_(edit_list_offset),
+      reference_sample_data_(reference_sample_data),
       seek_preroll_(GetSeekPreroll(*stream_info_)),
       earliest_presentation_time_(kInvalidTime),
       first_sap_time_(kInvalidTime) {
@@ -75,30 +87,51 @@ Status Fragmenter::AddSample(const MediaSample& sample) {
   if (sample.side_data_size() > 0)
     LOG(WARNING) << "MP4 samples do not support side data. Side data ignored.";
 
-  // Fill in sample parameters. It will be optimized later.
-  traf_->runs[0].sample_sizes.push_back(
-      static_cast<uint32_t>(sample.data_size()));
-  traf_->runs[0].sample_durations.push_back(duration);
-  traf_->runs[0].sample_flags.push_back(
-      sample.is_key_frame() ? 0 : TrackFragmentHeader::kNonKeySampleMask);
-
-  if (sample.decrypt_config()) {
-    NewSampleEncryptionEntry(
-        *sample.decrypt_config(),
-        !stream_info_->encryption_config().constant_iv.empty(), traf_);
+  // Fill in sample parameters. The per-sample entries are only built for the
+  // fields which cannot be hoisted to the 'tfhd' defaults.
+  TrackFragmentRun& trun = traf_->runs[0];
+  TrackFragmentHeader& tfhd = traf_->header;
+  AddSampleEntry(static_cast<uint32_t>(sample.data_size()), trun.sample_count,
+                 expected_sample_count_, &trun.sample_sizes,
+                 &tfhd.default_sample_size);
+  AddSampleEntry(static_cast<uint32_t>(duration), trun.sample_count,
+                 expected_sample_count_, &trun.sample_durations,
+                 &tfhd.default_sample_duration);
+  const uint32_t sample_flags =
+      sample.is_key_frame() ? 0 : TrackFragmentHeader::kNonKeySampleMask;
+  AddSampleEntry(sample_flags, trun.sample_count, expected_sample_count_,
+                 &trun.sample_flags, &tfhd.default_sample_flags);
+
+  // Composition offsets have no default. They are all zero until a sample has
+  // a different pts and dts.
+  const int64_t composition_offset = pts - dts;
+  if (composition_offset != 0 &&
+      !(trun.flags & TrackFragmentRun::kSampleCompTimeOffsetsPresentMask)) {
+    trun.flags |= TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
+    trun.sample_composition_time_offsets.reserve(
+        std::max(expected_sample_count_, trun.sample_count + 1));
+    trun.sample_composition_time_offsets.assign(trun.sample_count, 0);
   }
+  if (trun.flags & TrackFragmentRun::kSampleCompTimeOffsetsPresentMask)
+    trun.sample_composition_time_offsets.push_back(composition_offset);
+  ++trun.sample_count;
+
+  if (sample.decrypt_config())
+    AddSampleEncryptionEntry(*sample.decrypt_config());
 
   if (stream_info_->stream_type() == StreamType::kStreamVideo &&
       sample.is_key_frame()) {
     key_frame_infos_.push_back(
-        {static_cast<uint64_t>(pts), data_->Size(), sample.data_size()});
+        {static_cast<uint64_t>(pts), data_size_, sample.data_size()});
   }
 
-  data_->AppendArray(sample.data(), sample.data_size());
-
-  traf_->runs[0].sample_composition_time_offsets.push_back(pts - dts);
-  if (pts != dts)
-    traf_->runs[0].flags |= TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
+  if (reference_sample_data_) {
+    if (sample.data_size() > 0)
+      sample_data_.push_back({sample.shared_data(), sample.data_size()});
+  } else {
+    data_->AppendArray(sample.data(), sample.data_size());
+  }
+  data_size_ += sample.data_size();
 
   // Exclude the part of sample with negative pts out of duration calculation as
   // they are not presented.
@@ -136,14 +169,26 @@ Status Fragmenter::InitializeFragment(int64_t first_sample_dts) {
   const int64_t dts_before_edit = first_sample_dts + edit_list_offset_;
   traf_->decode_time.decode_time = dts_before_edit;
 
-  traf_->runs.clear();
+  // The boxes of the previous fragment are reset in place rather than
+  // rebuilt, so their vectors keep their capacity from one fragment to the
+  // next.
   traf_->runs.resize(1);
-  traf_->runs[0].flags = TrackFragmentRun::kDataOffsetPresentMask;
+  TrackFragmentRun& trun = traf_->runs[0];
+  trun.flags = TrackFragmentRun::kDataOffsetPresentMask;
+  trun.sample_count = 0;
+  trun.data_offset = 0;
+  trun.sample_flags.clear();
+  trun.sample_sizes.clear();
+  trun.sample_durations.clear();
+  trun.sample_composition_time_offsets.clear();
   traf_->auxiliary_size.sample_info_sizes.clear();
   traf_->auxiliary_offset.offsets.clear();
-  traf_->sample_encryption.sample_encryption_entries.clear();
+  std::vector<SampleEncryptionEntry>& sample_encryption_entries =
+      traf_->sample_encryption.sample_encryption_entries;
+  for (SampleEncryptionEntry& entry : sample_encryption_entries)
+    spare_sample_encryption_entries_.push_back(std::move(entry));
+  sample_encryption_entries.clear();
   traf_->sample_group_descriptions.clear();
-  traf_->sample_to_groups.clear();
   traf_->header.sample_description_index = 1;  // 1-based.
   traf_->header.flags = TrackFragmentHeader::kDefaultBaseIsMoofMask |
                         TrackFragmentHeader::kSampleDescriptionIndexPresentMask;
@@ -151,76 +196,106 @@ Status Fragmenter::InitializeFragment(int64_t first_sample_dts) {
   fragment_duration_ = 0;
   earliest_presentation_time_ = kInvalidTime;
   first_sap_time_ = kInvalidTime;
-  data_.reset(new BufferWriter());
+  if (data_)
+    data_->Clear();
+  else
+    data_.reset(new BufferWriter());
+  sample_data_.clear();
+  data_size_ = 0;
   key_frame_infos_.clear();
   return Status::OK;
 }
 
 Status Fragmenter::FinalizeFragment() {
+  ScopedTraceEvent trace_event("Fragmenter::FinalizeFragment", "mux");
   if (stream_info_->is_encrypted()) {
     Status status = FinalizeFragmentForEncryption();
     if (!status.ok())
       return status;
   }
 
-  // Optimize trun box.
-  traf_->runs[0].sample_count =
-      static_cast<uint32_t>(traf_->runs[0].sample_sizes.size());
-  if (OptimizeSampleEntries(&traf_->runs[0].sample_durations,
-                            &traf_->header.default_sample_duration)) {
-    traf_->header.flags |=
-        TrackFragmentHeader::kDefaultSampleDurationPresentMask;
-  } else {
-    traf_->runs[0].flags |= TrackFragmentRun::kSampleDurationPresentMask;
-  }
-  if (OptimizeSampleEntries(&traf_->runs[0].sample_sizes,
-                            &traf_->header.default_sample_size)) {
-    traf_->header.flags |= TrackFragmentHeader::kDefaultSampleSizePresentMask;
-  } else {
-    traf_->runs[0].flags |= TrackFragmentRun::kSampleSizePresentMask;
-  }
-  if (OptimizeSampleEntries(&traf_->runs[0].sample_flags,
-                            &traf_->header.default_sample_flags)) {
-    traf_->header.flags |= TrackFragmentHeader::kDefaultSampleFlagsPresentMask;
-  } else {
-    traf_->runs[0].flags |= TrackFragmentRun::kSampleFlagsPresentMask;
-  }
+  // Optimize trun box. The per-sample entries of a field are only built by
+  // AddSample() if the field has different values, otherwise its value goes
+  // to the tfhd defaults.
+  TrackFragmentRun& trun = traf_->runs[0];
+  TrackFragmentHeader& tfhd = traf_->header;
+  expected_sample_count_ = trun.sample_count;
+  if (trun.sample_durations.empty())
+    tfhd.flags |= TrackFragmentHeader::kDefaultSampleDurationPresentMask;
+  else
+    trun.flags |= TrackFragmentRun::kSampleDurationPresentMask;
+  if (trun.sample_sizes.empty())
+    tfhd.flags |= TrackFragmentHeader::kDefaultSampleSizePresentMask;
+  else
+    trun.flags |= TrackFragmentRun::kSampleSizePresentMask;
+  if (trun.sample_flags.empty())
+    tfhd.flags |= TrackFragmentHeader::kDefaultSampleFlagsPresentMask;
+  else
+    trun.flags |= TrackFragmentRun::kSampleFlagsPresentMask;
 
   // Add SampleToGroup boxes. A SampleToGroup box with grouping type of 'roll'
   // needs to be added if there is seek preroll, referencing sample group
   // description in track level; Also need to add SampleToGroup boxes
   // correponding to every SampleGroupDescription boxes, referencing sample
   // group description in fragment level.
-  DCHECK_EQ(traf_->sample_to_groups.size(), 0u);
+  // The SampleToGroup boxes of the previous fragment are overwritten.
+  size_t num_sample_to_groups = 0;
   if (seek_preroll_ > 0) {
-    traf_->sample_to_groups.resize(traf_->sample_to_groups.size() + 1);
-    SampleToGroup& sample_to_group = traf_->sample_to_groups.back();
-    sample_to_group.grouping_type = FOURCC_roll;
-
-    sample_to_group.entries.resize(1);
-    SampleToGroupEntry& sample_to_group_entry = sample_to_group.entries.back();
-    sample_to_group_entry.sample_count = traf_->runs[0].sample_count;
-    sample_to_group_entry.group_description_index =
-        SampleToGroupEntry::kTrackGroupDescriptionIndexBase + 1;
+    SetSampleToGroup(FOURCC_roll,
+                     SampleToGroupEntry::kTrackGroupDescriptionIndexBase + 1,
+                     num_sample_to_groups++);
   }
   for (const auto& sample_group_description :
        traf_->sample_group_descriptions) {
-    traf_->sample_to_groups.resize(traf_->sample_to_groups.size() + 1);
-    SampleToGroup& sample_to_group = traf_->sample_to_groups.back();
-    sample_to_group.grouping_type = sample_group_description.grouping_type;
-
-    sample_to_group.entries.resize(1);
-    SampleToGroupEntry& sample_to_group_entry = sample_to_group.entries.back();
-    sample_to_group_entry.sample_count = traf_->runs[0].sample_count;
-    sample_to_group_entry.group_description_index =
-        SampleToGroupEntry::kTrackFragmentGroupDescriptionIndexBase + 1;
+    SetSampleToGroup(
+        sample_group_description.grouping_type,
+        SampleToGroupEntry::kTrackFragmentGroupDescriptionIndexBase + 1,
+        num_sample_to_groups++);
   }
+  traf_->sample_to_groups.resize(num_sample_to_groups);
 
   fragment_finalized_ = true;
   fragment_initialized_ = false;
   return Status::OK;
 }
 
+void Fragmenter::AddSampleEncryptionEntry(
+    const DecryptConfig& decrypt_config) {
+  // Reuse the entries of the previous fragments, with their vectors.
+  std::vector<SampleEncryptionEntry>& entries =
+      traf_->sample_encryption.sample_encryption_entries;
+  if (spare_sample_encryption_entries_.empty()) {
+    entries.emplace_back();
+  } else {
+    entries.push_back(std::move(spare_sample_encryption_entries_.back()));
+    spare_sample_encryption_entries_.pop_back();
+  }
+  SampleEncryptionEntry& entry = entries.back();
+  if (stream_info_->encryption_config().constant_iv.empty()) {
+    entry.initialization_vector.assign(decrypt_config.iv().begin(),
+                                       decrypt_config.iv().end());
+  } else {
+    entry.initialization_vector.clear();
+  }
+  entry.subsamples.assign(decrypt_config.subsamples().begin(),
+                          decrypt_config.subsamples().end());
+  traf_->auxiliary_size.sample_info_sizes.push_back(entry.ComputeSize());
+}
+
+void Fragmenter::SetSampleToGroup(FourCC grouping_type,
+                                  uint32_t group_description_index,
+                                  size_t index) {
+  if (traf_->sample_to_groups.size() <= index)
+    traf_->sample_to_groups.resize(index + 1);
+  SampleToGroup& sample_to_group = traf_->sample_to_groups[index];
+  sample_to_group.grouping_type = grouping_type;
+
+  sample_to_group.entries.resize(1);
+  SampleToGroupEntry& sample_to_group_entry = sample_to_group.entries.back();
+  sample_to_group_entry.sample_count = traf_->runs[0].sample_count;
+  sample_to_group_entry.group_description_index = group_description_index;
+}
+
 void Fragmenter::GenerateSegmentReference(SegmentReference* reference) const {
   // NOTE: Daisy chain is not supported currently.
   reference->reference_type = false;
@@ -247,7 +322,7 @@ Status Fragmenter::FinalizeFragmentForEncryption() {
     return Status::OK;
   }
   if (sample_encryption.sample_encryption_entries.size() !=
-      traf_->runs[0].sample_sizes.size()) {
+      traf_->runs[0].sample_count) {
     LOG(ERROR) << "Partially encrypted segment is not supported";
     return Status(error::MUXER_FAILURE,
                   "Partially encrypted segment is not supported.");
@@ -11,18 +11,21 @@
 #include <vector>
 
 #include "packager/base/logging.h"
+#include "packager/media/base/fourccs.h"
 #include "packager/status.h"
 
 namespace shaka {
 namespace media {
 
 class BufferWriter;
+class DecryptConfig;
 class MediaSample;
 class StreamInfo;
 
 namespace mp4 {
 
 struct KeyFrameInfo;
+struct SampleEncryptionEntry;
 struct SegmentReference;
 struct TrackFragment;
 
@@ -30,13 +33,23 @@ struct TrackFragment;
 /// box and corresponding 'mdat' box.
 class Fragmenter {
  public:
+  /// Sample data referenced, instead of copied, by the fragment.
+  struct SampleData {
+    std::shared_ptr<const uint8_t> data;
+    size_t size;
+  };
+
   /// @param info contains stream information.
   /// @param traf points to a TrackFragment box.
   /// @param edit_list_offset is the edit list offset that is encoded in Edit
   ///        List. It should be 0 if there is no EditList.
+  /// @param reference_sample_data indicates whether the fragment references
+  ///        the sample buffers in sample_data() instead of copying the sample
+  ///        data to data().
   Fragmenter(std::shared_ptr<const StreamInfo> info,
              TrackFragment* traf,
-             int64_t edit_list_offset);
+             int64_t edit_list_offset,
+             bool reference_sample_data);
 
   ~Fragmenter();
 
@@ -67,6 +80,9 @@ class Fragmenter {
   bool fragment_initialized() const { return fragment_initialized_; }
   bool fragment_finalized() const { return fragment_finalized_; }
   BufferWriter* data() { return data_.get(); }
+  const std::vector<SampleData>& sample_data() const { return sample_data_; }
+  /// @return The size of the fragment's sample data, i.e. mdat payload.
+  uint64_t data_size() const { return data_size_; }
   const std::vector<KeyFrameInfo>& key_frame_infos() const {
     return key_frame_infos_;
   }
@@ -82,12 +98,20 @@ class Fragmenter {
 
  private:
   Status FinalizeFragmentForEncryption();
+  // Add the 'senc' entry of a sample to the fragment.
+  void AddSampleEncryptionEntry(const DecryptConfig& decrypt_config);
+  // Set the SampleToGroup box at |index| of the fragment, referencing
+  // |group_description_index| for all its samples.
+  void SetSampleToGroup(FourCC grouping_type,
+                        uint32_t group_description_index,
+                        size_t index);
   // Check if the current fragment starts with SAP.
   bool StartsWithSAP() const;
 
   std::shared_ptr<const StreamInfo> stream_info_;
   TrackFragment* traf_ = nullptr;
   int64_t edit_list_offset_ = 0;
+  bool reference_sample_data_ = false;
   int64_t seek_preroll_ = 0;
   bool fragment_initialized_ = false;
   bool fragment_finalized_ = false;
@@ -95,8 +119,15 @@ class Fragmenter {
   int64_t earliest_presentation_time_ = 0;
   int64_t first_sap_time_ = 0;
   std::unique_ptr<BufferWriter> data_;
+  std::vector<SampleData> sample_data_;
+  uint64_t data_size_ = 0;
+  // The sample count of the previous fragment, used to reserve the per-sample
+  // entries of the next one.
+  uint32_t expected_sample_count_ = 0;
   // Saves key frames information, for Video.
   std::vector<KeyFrameInfo> key_frame_infos_;
+  // The 'senc' entries of the previous fragments, reused with their vectors.
+  std::vector<SampleEncryptionEntry> spare_sample_encryption_entries_;
 
   DISALLOW_COPY_AND_ASSIGN(Fragmenter);
 };
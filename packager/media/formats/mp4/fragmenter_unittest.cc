@@ -0,0 +1,144 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/fragmenter.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+const uint8_t kData[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+const int64_t kDuration = 1000;
+const uint32_t kNonKey = TrackFragmentHeader::kNonKeySampleMask;
+
+std::shared_ptr<StreamInfo> CreateVideoStreamInfo() {
+  return std::make_shared<VideoStreamInfo>(
+      1, 90000, 0, kCodecH264,
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus, "avc1",
+      nullptr, 0, 320, 240, 1, 1, 0, 0, 4, "und", false);
+}
+
+}  // namespace
+
+class FragmenterTest : public ::testing::Test {
+ protected:
+  FragmenterTest() : fragmenter_(CreateVideoStreamInfo(), &traf_, 0, false) {}
+
+  void AddSample(int64_t dts,
+                 int64_t pts,
+                 int64_t duration,
+                 size_t size,
+                 bool is_key_frame) {
+    std::shared_ptr<MediaSample> sample =
+        MediaSample::CopyFrom(kData, size, is_key_frame);
+    sample->set_dts(dts);
+    sample->set_pts(pts);
+    sample->set_duration(duration);
+    ASSERT_OK(fragmenter_.AddSample(*sample));
+  }
+
+  TrackFragment traf_;
+  Fragmenter fragmenter_;
+};
+
+TEST_F(FragmenterTest, IdenticalEntriesGoToDefaults) {
+  for (int64_t i = 0; i < 3; ++i)
+    AddSample(i * kDuration, i * kDuration, kDuration, 4, true);
+  ASSERT_OK(fragmenter_.FinalizeFragment());
+
+  const TrackFragmentRun& trun = traf_.runs[0];
+  EXPECT_EQ(3u, trun.sample_count);
+  EXPECT_EQ(static_cast<uint32_t>(TrackFragmentRun::kDataOffsetPresentMask),
+            trun.flags);
+  EXPECT_TRUE(trun.sample_durations.empty());
+  EXPECT_TRUE(trun.sample_sizes.empty());
+  EXPECT_TRUE(trun.sample_flags.empty());
+  EXPECT_TRUE(trun.sample_composition_time_offsets.empty());
+
+  const uint32_t kDefaultsMask =
+      TrackFragmentHeader::kDefaultSampleDurationPresentMask |
+      TrackFragmentHeader::kDefaultSampleSizePresentMask |
+      TrackFragmentHeader::kDefaultSampleFlagsPresentMask;
+  EXPECT_EQ(kDefaultsMask, traf_.header.flags & kDefaultsMask);
+  EXPECT_EQ(static_cast<uint32_t>(kDuration),
+            traf_.header.default_sample_duration);
+  EXPECT_EQ(4u, traf_.header.default_sample_size);
+  EXPECT_EQ(0u, traf_.header.default_sample_flags);
+}
+
+TEST_F(FragmenterTest, DifferentEntriesArePerSample) {
+  AddSample(0, 0, kDuration, 4, true);
+  AddSample(kDuration, kDuration, kDuration, 8, false);
+  AddSample(2 * kDuration, 4 * kDuration, 2 * kDuration, 4, false);
+  ASSERT_OK(fragmenter_.FinalizeFragment());
+
+  const TrackFragmentRun& trun = traf_.runs[0];
+  EXPECT_EQ(3u, trun.sample_count);
+  EXPECT_TRUE(trun.flags & TrackFragmentRun::kSampleDurationPresentMask);
+  EXPECT_TRUE(trun.flags & TrackFragmentRun::kSampleSizePresentMask);
+  EXPECT_TRUE(trun.flags & TrackFragmentRun::kSampleFlagsPresentMask);
+  EXPECT_TRUE(trun.flags &
+              TrackFragmentRun::kSampleCompTimeOffsetsPresentMask);
+  EXPECT_THAT(trun.sample_durations,
+              ::testing::ElementsAre(1000u, 1000u, 2000u));
+  EXPECT_THAT(trun.sample_sizes, ::testing::ElementsAre(4u, 8u, 4u));
+  EXPECT_THAT(trun.sample_flags, ::testing::ElementsAre(0u, kNonKey, kNonKey));
+  EXPECT_THAT(trun.sample_composition_time_offsets,
+              ::testing::ElementsAre(0, 0, 2000));
+  EXPECT_FALSE(traf_.header.flags &
+               TrackFragmentHeader::kDefaultSampleDurationPresentMask);
+  EXPECT_FALSE(traf_.header.flags &
+               TrackFragmentHeader::kDefaultSampleSizePresentMask);
+  EXPECT_FALSE(traf_.header.flags &
+               TrackFragmentHeader::kDefaultSampleFlagsPresentMask);
+}
+
+TEST_F(FragmenterTest, StartsNewFragmentWithDefaults) {
+  AddSample(0, 0, kDuration, 4, true);
+  AddSample(kDuration, kDuration, kDuration, 8, false);
+  ASSERT_OK(fragmenter_.FinalizeFragment());
+  EXPECT_EQ(2u, traf_.runs[0].sample_sizes.size());
+
+  fragmenter_.ClearFragmentFinalized();
+  AddSample(2 * kDuration, 2 * kDuration, kDuration, 8, true);
+  AddSample(3 * kDuration, 3 * kDuration, kDuration, 8, true);
+  ASSERT_OK(fragmenter_.FinalizeFragment());
+
+  EXPECT_EQ(2u, traf_.runs[0].sample_count);
+  EXPECT_TRUE(traf_.runs[0].sample_sizes.empty());
+  EXPECT_TRUE(traf_.header.flags &
+              TrackFragmentHeader::kDefaultSampleSizePresentMask);
+  EXPECT_EQ(8u, traf_.header.default_sample_size);
+}
+
+TEST_F(FragmenterTest, ReusesEntriesOfPreviousFragment) {
+  AddSample(0, 0, kDuration, 4, true);
+  AddSample(kDuration, kDuration, kDuration, 8, false);
+  ASSERT_OK(fragmenter_.FinalizeFragment());
+  const uint32_t* sample_sizes = traf_.runs[0].sample_sizes.data();
+
+  fragmenter_.ClearFragmentFinalized();
+  AddSample(2 * kDuration, 2 * kDuration, kDuration, 8, true);
+  AddSample(3 * kDuration, 3 * kDuration, kDuration, 4, false);
+  ASSERT_OK(fragmenter_.FinalizeFragment());
+
+  // The entries of the new fragment are in the storage of the previous one.
+  EXPECT_THAT(traf_.runs[0].sample_sizes, ::testing::ElementsAre(8u, 4u));
+  EXPECT_EQ(sample_sizes, traf_.runs[0].sample_sizes.data());
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
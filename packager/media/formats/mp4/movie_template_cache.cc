@@ -0,0 +1,141 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/movie_template_cache.h"
+
+#include "packager/base/logging.h"
+#include "packager/media/base/encryption_config.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+
+namespace {
+
+// Number of templates kept by the process wide cache. A ladder is usually
+// encrypted with a few keys, e.g. one per track type, in each crypto period.
+const size_t kMaxTemplates = 16;
+
+void AppendToKey(const std::vector<uint8_t>& data, std::string* key) {
+  const uint32_t size = static_cast<uint32_t>(data.size());
+  key->append(reinterpret_cast<const char*>(&size), sizeof(size));
+  key->append(data.begin(), data.end());
+}
+
+// Serializes the fields of |encryption_config| which the template depends on.
+std::string GetTemplateKey(const EncryptionConfig& encryption_config) {
+  std::string key;
+  const uint32_t protection_scheme = encryption_config.protection_scheme;
+  key.append(reinterpret_cast<const char*>(&protection_scheme),
+             sizeof(protection_scheme));
+  key.push_back(static_cast<char>(encryption_config.crypt_byte_block));
+  key.push_back(static_cast<char>(encryption_config.skip_byte_block));
+  key.push_back(static_cast<char>(encryption_config.per_sample_iv_size));
+  AppendToKey(encryption_config.constant_iv, &key);
+  AppendToKey(encryption_config.key_id, &key);
+  for (const ProtectionSystemSpecificInfo& system :
+       encryption_config.key_system_info) {
+    AppendToKey(system.psshs, &key);
+  }
+  return key;
+}
+
+void GenerateSinf(const EncryptionConfig& encryption_config,
+                  ProtectionSchemeInfo* sinf) {
+  DCHECK_NE(encryption_config.protection_scheme, FOURCC_NULL);
+  sinf->type.type = encryption_config.protection_scheme;
+
+  // The version of cenc implemented here. CENC 4.
+  const int kCencSchemeVersion = 0x00010000;
+  sinf->type.version = kCencSchemeVersion;
+
+  auto& track_encryption = sinf->info.track_encryption;
+  track_encryption.default_is_protected = 1;
+
+  track_encryption.default_crypt_byte_block =
+      encryption_config.crypt_byte_block;
+  track_encryption.default_skip_byte_block = encryption_config.skip_byte_block;
+  switch (encryption_config.protection_scheme) {
+    case FOURCC_cenc:
+    case FOURCC_cbc1:
+      DCHECK_EQ(track_encryption.default_crypt_byte_block, 0u);
+      DCHECK_EQ(track_encryption.default_skip_byte_block, 0u);
+      // CENCv3 10.1 ‘cenc’ AES-CTR scheme and 10.2 ‘cbc1’ AES-CBC scheme:
+      // The version of the Track Encryption Box (‘tenc’) SHALL be 0.
+      track_encryption.version = 0;
+      break;
+    case FOURCC_cbcs:
+    case FOURCC_cens:
+      // CENCv3 10.3 ‘cens’ AES-CTR subsample pattern encryption scheme and
+      //        10.4 ‘cbcs’ AES-CBC subsample pattern encryption scheme:
+      // The version of the Track Encryption Box (‘tenc’) SHALL be 1.
+      track_encryption.version = 1;
+      break;
+    default:
+      NOTREACHED() << "Unexpected protection scheme "
+                   << encryption_config.protection_scheme;
+  }
+
+  track_encryption.default_per_sample_iv_size =
+      encryption_config.per_sample_iv_size;
+  track_encryption.default_constant_iv = encryption_config.constant_iv;
+  track_encryption.default_kid = encryption_config.key_id;
+}
+
+std::shared_ptr<const MovieTemplate> GenerateTemplate(
+    const EncryptionConfig& encryption_config) {
+  std::shared_ptr<MovieTemplate> movie_template(new MovieTemplate);
+  for (const ProtectionSystemSpecificInfo& system :
+       encryption_config.key_system_info) {
+    if (system.psshs.empty())
+      continue;
+    ProtectionSystemSpecificHeader pssh;
+    pssh.raw_box = system.psshs;
+    movie_template->pssh.push_back(pssh);
+  }
+  GenerateSinf(encryption_config, &movie_template->sinf);
+  return movie_template;
+}
+
+}  // namespace
+
+MovieTemplateCache::MovieTemplateCache(size_t max_templates)
+    : max_templates_(max_templates) {
+  DCHECK_GT(max_templates, 0u);
+}
+
+MovieTemplateCache::~MovieTemplateCache() {}
+
+MovieTemplateCache* MovieTemplateCache::GetInstance() {
+  // Leaked, as it may be used by muxers finalized at exit.
+  static MovieTemplateCache* cache = new MovieTemplateCache(kMaxTemplates);
+  return cache;
+}
+
+std::shared_ptr<const MovieTemplate> MovieTemplateCache::GetTemplate(
+    const EncryptionConfig& encryption_config) {
+  std::string key = GetTemplateKey(encryption_config);
+
+  base::AutoLock auto_lock(lock_);
+  for (auto it = templates_.begin(); it != templates_.end(); ++it) {
+    if (it->first == key) {
+      // Move it to the front, as the most recently used.
+      templates_.splice(templates_.begin(), templates_, it);
+      return it->second;
+    }
+  }
+
+  std::shared_ptr<const MovieTemplate> movie_template =
+      GenerateTemplate(encryption_config);
+  templates_.emplace_front(std::move(key), movie_template);
+  if (templates_.size() > max_templates_)
+    templates_.pop_back();
+  return movie_template;
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,71 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_FORMATS_MP4_MOVIE_TEMPLATE_CACHE_H_
+#define PACKAGER_MEDIA_FORMATS_MP4_MOVIE_TEMPLATE_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+
+namespace shaka {
+namespace media {
+
+struct EncryptionConfig;
+
+namespace mp4 {
+
+/// The protection boxes of a 'moov' box, which only depend on the encryption
+/// configuration and are shared by all the renditions encrypted with it.
+struct MovieTemplate {
+  /// 'pssh' boxes to be carried in the stream.
+  std::vector<ProtectionSystemSpecificHeader> pssh;
+  /// 'sinf' box of the encrypted sample entries, with the scheme type and the
+  /// 'tenc' box. Its original format is left as FOURCC_NULL, to be patched
+  /// for each sample entry.
+  ProtectionSchemeInfo sinf;
+};
+
+/// A cache of the movie templates of the most recent encryption
+/// configurations, so the templates are built once per configuration, e.g.
+/// per crypto period with key rotation, instead of once per rendition.
+/// This class is thread safe.
+class MovieTemplateCache {
+ public:
+  /// @param max_templates is the maximum number of templates kept.
+  explicit MovieTemplateCache(size_t max_templates);
+  ~MovieTemplateCache();
+
+  /// @return the process wide cache shared by the MP4 muxers.
+  static MovieTemplateCache* GetInstance();
+
+  /// @return the template for @a encryption_config, which is built if it is
+  ///         not cached yet.
+  std::shared_ptr<const MovieTemplate> GetTemplate(
+      const EncryptionConfig& encryption_config);
+
+ private:
+  MovieTemplateCache(const MovieTemplateCache&) = delete;
+  MovieTemplateCache& operator=(const MovieTemplateCache&) = delete;
+
+  const size_t max_templates_;
+  base::Lock lock_;
+  // Templates keyed by the encryption configuration they are built from, the
+  // most recently used first. Protected by |lock_|.
+  std::list<std::pair<std::string, std::shared_ptr<const MovieTemplate>>>
+      templates_;
+};
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_FORMATS_MP4_MOVIE_TEMPLATE_CACHE_H_
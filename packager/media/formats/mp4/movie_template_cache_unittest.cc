@@ -0,0 +1,89 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/movie_template_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/encryption_config.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+const uint8_t kKeyId[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+                          0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10};
+const uint8_t kPssh[] = {0x00, 0x00, 0x00, 0x08, 'p', 's', 's', 'h'};
+
+EncryptionConfig CreateEncryptionConfig(uint8_t key_id_suffix) {
+  EncryptionConfig encryption_config;
+  encryption_config.protection_scheme = FOURCC_cbcs;
+  encryption_config.crypt_byte_block = 1;
+  encryption_config.skip_byte_block = 9;
+  encryption_config.per_sample_iv_size = 16;
+  encryption_config.key_id.assign(std::begin(kKeyId), std::end(kKeyId));
+  encryption_config.key_id.back() = key_id_suffix;
+  encryption_config.key_system_info.resize(2);
+  encryption_config.key_system_info[0].psshs.assign(std::begin(kPssh),
+                                                    std::end(kPssh));
+  return encryption_config;
+}
+
+}  // namespace
+
+TEST(MovieTemplateCacheTest, GeneratesProtectionBoxes) {
+  MovieTemplateCache cache(2);
+  const EncryptionConfig encryption_config = CreateEncryptionConfig(0);
+  std::shared_ptr<const MovieTemplate> movie_template =
+      cache.GetTemplate(encryption_config);
+
+  // Key systems without pssh are skipped.
+  ASSERT_EQ(1u, movie_template->pssh.size());
+  EXPECT_EQ(encryption_config.key_system_info[0].psshs,
+            movie_template->pssh[0].raw_box);
+
+  const ProtectionSchemeInfo& sinf = movie_template->sinf;
+  EXPECT_EQ(FOURCC_NULL, sinf.format.format);
+  EXPECT_EQ(FOURCC_cbcs, sinf.type.type);
+  const TrackEncryption& tenc = sinf.info.track_encryption;
+  EXPECT_EQ(1u, tenc.version);
+  EXPECT_EQ(1u, tenc.default_is_protected);
+  EXPECT_EQ(1u, tenc.default_crypt_byte_block);
+  EXPECT_EQ(9u, tenc.default_skip_byte_block);
+  EXPECT_EQ(16u, tenc.default_per_sample_iv_size);
+  EXPECT_EQ(encryption_config.key_id, tenc.default_kid);
+}
+
+TEST(MovieTemplateCacheTest, SharesTemplatesOfTheSameConfig) {
+  MovieTemplateCache cache(2);
+  std::shared_ptr<const MovieTemplate> movie_template =
+      cache.GetTemplate(CreateEncryptionConfig(0));
+  EXPECT_EQ(movie_template, cache.GetTemplate(CreateEncryptionConfig(0)));
+  EXPECT_NE(movie_template, cache.GetTemplate(CreateEncryptionConfig(1)));
+
+  EncryptionConfig other_pssh = CreateEncryptionConfig(0);
+  other_pssh.key_system_info[1].psshs = other_pssh.key_system_info[0].psshs;
+  EXPECT_NE(movie_template, cache.GetTemplate(other_pssh));
+}
+
+TEST(MovieTemplateCacheTest, EvictsLeastRecentlyUsedTemplates) {
+  MovieTemplateCache cache(2);
+  std::shared_ptr<const MovieTemplate> template0 =
+      cache.GetTemplate(CreateEncryptionConfig(0));
+  std::shared_ptr<const MovieTemplate> template1 =
+      cache.GetTemplate(CreateEncryptionConfig(1));
+  // Use template 0, so template 1 is evicted by template 2.
+  EXPECT_EQ(template0, cache.GetTemplate(CreateEncryptionConfig(0)));
+  cache.GetTemplate(CreateEncryptionConfig(2));
+
+  EXPECT_EQ(template0, cache.GetTemplate(CreateEncryptionConfig(0)));
+  EXPECT_NE(template1, cache.GetTemplate(CreateEncryptionConfig(1)));
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
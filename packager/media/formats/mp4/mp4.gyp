@@ -29,6 +29,8 @@
         'fragmenter.cc',
         'fragmenter.h',
         'key_frame_info.h',
+        'movie_template_cache.cc',
+        'movie_template_cache.h',
         'mp4_media_parser.cc',
         'mp4_media_parser.h',
         'mp4_muxer.cc',
@@ -45,6 +47,7 @@
         'track_run_iterator.h',
       ],
       'dependencies': [
+        '../../../metrics/metrics.gyp:metrics',
         '../../../third_party/boringssl/boringssl.gyp:boringssl',
         '../../../third_party/gflags/gflags.gyp:gflags',
         '../../base/media_base.gyp:media_base',
@@ -61,6 +64,8 @@
         'chunk_info_iterator_unittest.cc',
         'composition_offset_iterator_unittest.cc',
         'decoding_time_iterator_unittest.cc',
+        'fragmenter_unittest.cc',
+        'movie_template_cache_unittest.cc',
         'mp4_media_parser_unittest.cc',
         'sync_sample_iterator_unittest.cc',
         'track_run_iterator_unittest.cc',
@@ -4,7 +4,10 @@
 
 #include "packager/media/formats/mp4/mp4_media_parser.h"
 
+#include <gflags/gflags.h>
+
 #include <algorithm>
+#include <limits>
 
 #include "packager/base/callback.h"
 #include "packager/base/callback_helpers.h"
@@ -12,6 +15,7 @@
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/file/file_util.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/buffer_reader.h"
 #include "packager/media/base/decrypt_config.h"
@@ -19,6 +23,8 @@
 #include "packager/media/base/macros.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/rcheck.h"
+#include "packager/media/base/sample_buffer_pool.h"
+#include "packager/media/base/timestamp_rescaler.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/base/video_util.h"
 #include "packager/media/codecs/ac3_audio_util.h"
@@ -34,17 +40,24 @@
 #include "packager/media/formats/mp4/box_reader.h"
 #include "packager/media/formats/mp4/track_run_iterator.h"
 
+DEFINE_uint64(mp4_mdat_spill_limit,
+              0,
+              "MP4 only. Maximum number of bytes buffered to parse inputs "
+              "which are not seekable, e.g. pipes, and have the 'mdat' box "
+              "before the 'moov' box. The input is buffered until the 'moov' "
+              "box is found, then its samples are parsed from the buffer. 0 "
+              "rejects such inputs.");
+DEFINE_bool(mp4_spill_mdat_to_temp_file,
+            false,
+            "MP4 only. Buffer the 'mdat' box which precedes the 'moov' box of "
+            "an input which is not seekable in a temporary file instead of "
+            "memory. See --mp4_mdat_spill_limit.");
+
 namespace shaka {
 namespace media {
 namespace mp4 {
 namespace {
 
-uint64_t Rescale(uint64_t time_in_old_scale,
-                 uint32_t old_scale,
-                 uint32_t new_scale) {
-  return (static_cast<double>(time_in_old_scale) / old_scale) * new_scale;
-}
-
 H26xStreamFormat GetH26xStreamFormat(FourCC fourcc) {
   switch (fourcc) {
     case FOURCC_avc1:
@@ -168,15 +181,29 @@ bool UpdateCodecStringForDolbyVision(
 
 const uint64_t kNanosecondsPerSecond = 1000000000ull;
 
+// The minimum size of the reads of ReadTrackSamples(). Samples which are
+// contiguous in the file are read together.
+const size_t kMinTrackReadSize = 64 * 1024;
+
+// The size of the chunks in which the spilled input is parsed again.
+const size_t kSpillReplayChunkSize = 1 << 20;
+
 }  // namespace
 
 MP4MediaParser::MP4MediaParser()
     : state_(kWaitingForInit),
       decryption_key_source_(NULL),
       moof_head_(0),
-      mdat_tail_(0) {}
-
-MP4MediaParser::~MP4MediaParser() {}
+      mdat_tail_(0),
+      current_sample_offset_(0),
+      spilling_(false),
+      mdat_before_moov_(false),
+      spill_size_(0),
+      tracks_selected_(false) {}
+
+MP4MediaParser::~MP4MediaParser() {
+  DiscardSpill();
+}
 
 void MP4MediaParser::Init(const InitCB& init_cb,
                           const NewMediaSampleCB& new_media_sample_cb,
@@ -193,6 +220,9 @@ void MP4MediaParser::Init(const InitCB& init_cb,
   decryption_key_source_ = decryption_key_source;
   if (decryption_key_source)
     decryptor_source_.reset(new DecryptorSource(decryption_key_source));
+  // The input is kept from its start until the 'moov' box is found, in case
+  // it comes after the 'mdat' box.
+  spilling_ = FLAGS_mp4_mdat_spill_limit > 0;
 }
 
 void MP4MediaParser::Reset() {
@@ -200,11 +230,19 @@ void MP4MediaParser::Reset() {
   runs_.reset();
   moof_head_ = 0;
   mdat_tail_ = 0;
+  mdat_before_moov_ = false;
+  DiscardSpill();
 }
 
 bool MP4MediaParser::Flush() {
   DCHECK_NE(state_, kWaitingForInit);
+  const bool missing_moov = mdat_before_moov_ && !moov_;
   Reset();
+  if (missing_moov) {
+    LOG(ERROR) << "Reached the end of the input before the 'moov' box.";
+    ChangeState(kError);
+    return false;
+  }
   ChangeState(kParsingBoxes);
   return true;
 }
@@ -215,6 +253,11 @@ bool MP4MediaParser::Parse(const uint8_t* buf, int size) {
   if (state_ == kError)
     return false;
 
+  if (spilling_ && !Spill(buf, size)) {
+    Reset();
+    ChangeState(kError);
+    return false;
+  }
   queue_.Push(buf, size);
 
   bool result, err = false;
@@ -232,6 +275,10 @@ bool MP4MediaParser::Parse(const uint8_t* buf, int size) {
     }
   } while (result && !err);
 
+  // The 'moov' box has been found after the 'mdat' box.
+  if (!err && spilling_ && moov_)
+    err = !ReplaySpill();
+
   if (err) {
     DLOG(ERROR) << "Error while parsing MP4";
     moov_.reset();
@@ -243,6 +290,11 @@ bool MP4MediaParser::Parse(const uint8_t* buf, int size) {
   return true;
 }
 
+void MP4MediaParser::SelectTracks(const std::set<uint32_t>& track_ids) {
+  tracks_selected_ = true;
+  selected_track_ids_ = track_ids;
+}
+
 bool MP4MediaParser::LoadMoov(const std::string& file_path) {
   std::unique_ptr<File, FileCloser> file(
       File::OpenWithNoBuffering(file_path.c_str(), "r"));
@@ -318,6 +370,127 @@ bool MP4MediaParser::LoadMoov(const std::string& file_path) {
   return true;
 }
 
+bool MP4MediaParser::CanReadTrackSamples() const {
+  return moov_ && moov_->extends.tracks.empty();
+}
+
+bool MP4MediaParser::ReadTrackSamples(
+    uint32_t track_id,
+    int64_t start_dts,
+    int64_t end_dts,
+    bool key_frames_only,
+    File* file,
+    const NewMediaSampleCB& new_sample_cb) const {
+  DCHECK(CanReadTrackSamples());
+  DCHECK(file);
+
+  TrackRunIterator runs(moov_.get());
+  RCHECK(runs.Init());
+
+  // Find the last key frame at or before |start_dts| in the sample tables, so
+  // the data before it is not read. Without one, the track is read from its
+  // start.
+  int64_t first_dts = std::numeric_limits<int64_t>::min();
+  for (; runs.IsRunValid(); runs.AdvanceRun()) {
+    if (runs.track_id() != track_id)
+      continue;
+    for (; runs.IsSampleValid() && runs.dts() <= start_dts;
+         runs.AdvanceSample()) {
+      if (runs.is_keyframe())
+        first_dts = runs.dts();
+    }
+  }
+  RCHECK(runs.Init());
+
+  // The data of the file from |buffer_offset|.
+  std::vector<uint8_t> buffer;
+  int64_t buffer_offset = 0;
+  // The file position, which is past |buffer| after a read.
+  int64_t file_position = -1;
+  // With |key_frames_only|, the last key frame read, which is passed on once
+  // the frames following it are skipped.
+  std::shared_ptr<MediaSample> key_frame;
+
+  bool done = false;
+  for (; runs.IsRunValid() && !done; runs.AdvanceRun()) {
+    if (runs.track_id() != track_id)
+      continue;
+    for (; runs.IsSampleValid(); runs.AdvanceSample()) {
+      if (runs.dts() < first_dts)
+        continue;
+      if (runs.dts() >= end_dts) {
+        done = true;
+        break;
+      }
+      if (key_frames_only && !runs.is_keyframe()) {
+        // The frames before the first key frame cannot be decoded.
+        if (key_frame) {
+          key_frame->set_duration(key_frame->duration() + runs.duration());
+          key_frame->set_skipped_frames(key_frame->skipped_frames() + 1);
+        }
+        continue;
+      }
+      // Samples of non-fragmented files are never encrypted, see
+      // TrackRunIterator::Init().
+      DCHECK(!runs.is_encrypted());
+      const int64_t sample_offset = runs.sample_offset();
+      const int64_t sample_size = runs.sample_size();
+      RCHECK(sample_offset >= 0 && sample_size >= 0);
+
+      if (sample_offset < buffer_offset ||
+          sample_offset + sample_size >
+              buffer_offset + static_cast<int64_t>(buffer.size())) {
+        // Read the sample along with the data following it, which is likely
+        // to contain the next samples of the track, unless they are skipped.
+        if (sample_offset != file_position && !file->Seek(sample_offset)) {
+          LOG(ERROR) << "Failed to seek to sample offset " << sample_offset;
+          return false;
+        }
+        const size_t min_read_size = key_frames_only ? 0 : kMinTrackReadSize;
+        buffer.resize(
+            std::max(static_cast<size_t>(sample_size), min_read_size));
+        size_t bytes_read = 0;
+        while (bytes_read < buffer.size()) {
+          const int64_t result =
+              file->Read(&buffer[bytes_read], buffer.size() - bytes_read);
+          if (result <= 0)
+            break;
+          bytes_read += result;
+        }
+        buffer.resize(bytes_read);
+        buffer_offset = sample_offset;
+        file_position = sample_offset + bytes_read;
+        if (static_cast<int64_t>(bytes_read) < sample_size) {
+          LOG(ERROR) << "Failed to read sample at offset " << sample_offset
+                     << " of size " << sample_size;
+          return false;
+        }
+      }
+
+      std::shared_ptr<MediaSample> stream_sample(MediaSample::CopyFrom(
+          buffer.data() + (sample_offset - buffer_offset), sample_size,
+          runs.is_keyframe()));
+      stream_sample->set_dts(runs.dts());
+      stream_sample->set_pts(runs.cts());
+      stream_sample->set_duration(runs.duration());
+      if (key_frames_only) {
+        std::swap(key_frame, stream_sample);
+        if (!stream_sample)
+          continue;
+      }
+      if (!new_sample_cb.Run(track_id, stream_sample)) {
+        LOG(ERROR) << "Failed to process the sample.";
+        return false;
+      }
+    }
+  }
+  if (key_frame && !new_sample_cb.Run(track_id, key_frame)) {
+    LOG(ERROR) << "Failed to process the sample.";
+    return false;
+  }
+  return true;
+}
+
 bool MP4MediaParser::ParseBox(bool* err) {
   const uint8_t* buf;
   int size;
@@ -325,6 +498,16 @@ bool MP4MediaParser::ParseBox(bool* err) {
   if (!size)
     return false;
 
+  // Skip the rest of an 'mdat' box preceding the 'moov' box. It is parsed
+  // from the spill once the 'moov' box is found.
+  if (mdat_before_moov_ && !moov_ && queue_.head() < mdat_tail_) {
+    if (!queue_.Trim(mdat_tail_))
+      return false;
+    queue_.Peek(&buf, &size);
+    if (!size)
+      return false;
+  }
+
   std::unique_ptr<BoxReader> reader(BoxReader::ReadBox(buf, size, err));
   if (reader.get() == NULL)
     return false;
@@ -332,13 +515,25 @@ bool MP4MediaParser::ParseBox(bool* err) {
   if (reader->type() == FOURCC_mdat) {
     if (!moov_) {
       // For seekable files, we seek to the 'moov' and load the 'moov' first
-      // then seek back (see LoadMoov function for details); we do not support
-      // having 'mdat' before 'moov' for non-seekable files. The code ends up
-      // here only if it is a non-seekable file.
-      NOTIMPLEMENTED() << " Non-seekable Files with 'mdat' box before 'moov' "
-                          "box is not supported.";
-      *err = true;
-      return false;
+      // then seek back (see LoadMoov function for details). Non-seekable
+      // files with 'mdat' before 'moov' are spilled until the 'moov' is
+      // found, if allowed.
+      if (!spilling_) {
+        NOTIMPLEMENTED() << " Non-seekable Files with 'mdat' box before "
+                            "'moov' box is not supported without "
+                            "--mp4_mdat_spill_limit.";
+        *err = true;
+        return false;
+      }
+      if (!mdat_before_moov_) {
+        mdat_before_moov_ = true;
+        if (FLAGS_mp4_spill_mdat_to_temp_file && !SpillToTempFile()) {
+          *err = true;
+          return false;
+        }
+      }
+      mdat_tail_ = queue_.head() + reader->size();
+      return true;
     } else {
       // This can happen if there are unused 'mdat' boxes, which is unusual
       // but allowed by the spec. Ignore the 'mdat' and proceed.
@@ -353,6 +548,12 @@ bool MP4MediaParser::ParseBox(bool* err) {
 
   if (reader->type() == FOURCC_moov) {
     *err = !ParseMoov(reader.get());
+    if (!*err && spilling_) {
+      // Let Parse() replay the spill, which replaces the queue.
+      if (mdat_before_moov_)
+        return false;
+      DiscardSpill();
+    }
   } else if (reader->type() == FOURCC_moof) {
     moof_head_ = queue_.head();
     *err = !ParseMoof(reader.get());
@@ -370,6 +571,107 @@ bool MP4MediaParser::ParseBox(bool* err) {
   return !(*err);
 }
 
+bool MP4MediaParser::Spill(const uint8_t* buf, int size) {
+  DCHECK(spilling_);
+  spill_size_ += size;
+  if (spill_size_ > FLAGS_mp4_mdat_spill_limit) {
+    LOG(ERROR) << "The 'mdat' box before the 'moov' box exceeds "
+                  "--mp4_mdat_spill_limit="
+               << FLAGS_mp4_mdat_spill_limit << ".";
+    return false;
+  }
+  if (!spill_file_) {
+    spill_.insert(spill_.end(), buf, buf + size);
+    return true;
+  }
+  if (spill_file_->Write(buf, size) != size) {
+    LOG(ERROR) << "Failed to write to spill file " << spill_file_name_;
+    return false;
+  }
+  return true;
+}
+
+bool MP4MediaParser::SpillToTempFile() {
+  DCHECK(!spill_file_);
+  if (!TempFilePath("", &spill_file_name_)) {
+    LOG(ERROR) << "Failed to create a spill file.";
+    return false;
+  }
+  spill_file_.reset(File::Open(spill_file_name_.c_str(), "w"));
+  if (!spill_file_) {
+    LOG(ERROR) << "Failed to open spill file " << spill_file_name_;
+    return false;
+  }
+  const int64_t spill_size = static_cast<int64_t>(spill_.size());
+  if (spill_file_->Write(spill_.data(), spill_.size()) != spill_size) {
+    LOG(ERROR) << "Failed to write to spill file " << spill_file_name_;
+    return false;
+  }
+  std::vector<uint8_t>().swap(spill_);
+  return true;
+}
+
+bool MP4MediaParser::ReplaySpill() {
+  DCHECK(moov_);
+  DCHECK(mdat_before_moov_);
+  // The sample offsets in the 'moov' box are file offsets, so the input is
+  // parsed again from its start, as with LoadMoov(). The 'moov' box is
+  // skipped the second time.
+  spilling_ = false;
+  queue_.Reset();
+  mdat_tail_ = 0;
+
+  if (!spill_file_) {
+    std::vector<uint8_t> spill;
+    spill.swap(spill_);
+    for (size_t pos = 0; pos < spill.size(); pos += kSpillReplayChunkSize) {
+      const size_t size = std::min(kSpillReplayChunkSize, spill.size() - pos);
+      if (!Parse(spill.data() + pos, static_cast<int>(size)))
+        return false;
+    }
+    DiscardSpill();
+    return true;
+  }
+
+  if (!spill_file_.release()->Close()) {
+    LOG(ERROR) << "Failed to close spill file " << spill_file_name_;
+    return false;
+  }
+  std::unique_ptr<File, FileCloser> file(
+      File::Open(spill_file_name_.c_str(), "r"));
+  if (!file) {
+    LOG(ERROR) << "Failed to open spill file " << spill_file_name_;
+    return false;
+  }
+  std::vector<uint8_t> buffer(kSpillReplayChunkSize);
+  while (true) {
+    const int64_t bytes_read = file->Read(buffer.data(), buffer.size());
+    if (bytes_read < 0) {
+      LOG(ERROR) << "Failed to read spill file " << spill_file_name_;
+      return false;
+    }
+    if (bytes_read == 0)
+      break;
+    if (!Parse(buffer.data(), static_cast<int>(bytes_read)))
+      return false;
+  }
+  file.reset();
+  DiscardSpill();
+  return true;
+}
+
+void MP4MediaParser::DiscardSpill() {
+  spilling_ = false;
+  spill_size_ = 0;
+  std::vector<uint8_t>().swap(spill_);
+  spill_file_.reset();
+  if (!spill_file_name_.empty()) {
+    if (!File::Delete(spill_file_name_.c_str()))
+      LOG(WARNING) << "Failed to delete spill file " << spill_file_name_;
+    spill_file_name_.clear();
+  }
+}
+
 bool MP4MediaParser::ParseMoov(BoxReader* reader) {
   if (moov_)
     return true;  // Already parsed the 'moov' box.
@@ -390,14 +692,13 @@ bool MP4MediaParser::ParseMoov(BoxReader* reader) {
       duration = track->media.header.duration;
     } else if (moov_->extends.header.fragment_duration > 0) {
       DCHECK(moov_->header.timescale != 0);
-      duration = Rescale(moov_->extends.header.fragment_duration,
-                         moov_->header.timescale,
-                         timescale);
+      duration = TimestampRescaler(moov_->header.timescale, timescale)
+                     .Rescale(moov_->extends.header.fragment_duration);
     } else if (moov_->header.duration > 0 &&
                moov_->header.duration != std::numeric_limits<uint64_t>::max()) {
       DCHECK(moov_->header.timescale != 0);
-      duration =
-          Rescale(moov_->header.duration, moov_->header.timescale, timescale);
+      duration = TimestampRescaler(moov_->header.timescale, timescale)
+                     .Rescale(moov_->header.duration);
     }
 
     const SampleDescription& samp_descr =
@@ -788,6 +1089,14 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
 
   DCHECK(!(*err));
 
+  // Skip the runs of the tracks not selected without reading their data, which
+  // is trimmed from the queue with the samples of the other runs.
+  if (tracks_selected_ && selected_track_ids_.find(runs_->track_id()) ==
+                               selected_track_ids_.end()) {
+    runs_->AdvanceRun();
+    return true;
+  }
+
   const uint8_t* buf;
   int buf_size;
   queue_.Peek(&buf, &buf_size);
@@ -833,8 +1142,6 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
       MediaSample::CopyFrom(media_data, kDummyDataSize, runs_->is_keyframe()));
 
   if (runs_->is_encrypted()) {
-    std::shared_ptr<uint8_t> decrypted_media_data(
-        new uint8_t[media_data_size], std::default_delete<uint8_t[]>());
     std::unique_ptr<DecryptConfig> decrypt_config = runs_->GetDecryptConfig();
     if (!decrypt_config) {
       *err = true;
@@ -843,12 +1150,14 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
     }
 
     if (!decryptor_source_) {
-      stream_sample->SetData(media_data, media_data_size);
+      stream_sample->TransferData(queue_.Share(media_data), media_data_size);
       // If the demuxer does not have the decryptor_source_, store
       // decrypt_config so that the demuxed sample can be decrypted later.
       stream_sample->set_decrypt_config(std::move(decrypt_config));
       stream_sample->set_is_encrypted(true);
     } else {
+      std::shared_ptr<uint8_t> decrypted_media_data =
+          SampleBufferPool::GetDefault()->Allocate(media_data_size);
       if (!decryptor_source_->DecryptSampleBuffer(decrypt_config.get(),
                                                   media_data, media_data_size,
                                                   decrypted_media_data.get())) {
@@ -860,7 +1169,8 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
                                   media_data_size);
     }
   } else {
-    stream_sample->SetData(media_data, media_data_size);
+    // Reference the data in the queue rather than copying it.
+    stream_sample->TransferData(queue_.Share(media_data), media_data_size);
   }
 
   stream_sample->set_dts(runs_->dts());
@@ -874,6 +1184,7 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
            << ", cts=" << runs_->cts()
            << ", size=" << runs_->sample_size();
 
+  current_sample_offset_ = sample_offset;
   if (!new_sample_cb_.Run(runs_->track_id(), stream_sample)) {
     *err = true;
     LOG(ERROR) << "Failed to process the sample.";
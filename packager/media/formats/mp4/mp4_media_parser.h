@@ -11,14 +11,20 @@
 
 #include <map>
 #include <memory>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "packager/base/callback_forward.h"
+#include "packager/file/file_closer.h"
 #include "packager/media/base/decryptor_source.h"
 #include "packager/media/base/media_parser.h"
 #include "packager/media/base/offset_byte_queue.h"
 
 namespace shaka {
+
+class File;
+
 namespace media {
 namespace mp4 {
 
@@ -40,6 +46,7 @@ class MP4MediaParser : public MediaParser {
             KeySource* decryption_key_source) override;
   bool Flush() override WARN_UNUSED_RESULT;
   bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  void SelectTracks(const std::set<uint32_t>& track_ids) override;
   /// @}
 
   /// Handles ISO-BMFF containers which have the 'moov' box trailing the
@@ -50,6 +57,39 @@ class MP4MediaParser : public MediaParser {
   /// @return true if successful, false otherwise.
   bool LoadMoov(const std::string& file_path);
 
+  /// @return true if the parsed 'moov' box describes all the samples, i.e.
+  ///         the file is not fragmented, so the samples of each track can be
+  ///         read with ReadTrackSamples().
+  bool CanReadTrackSamples() const;
+
+  /// Reads the samples of a track of a non-fragmented file directly at the
+  /// offsets given by the 'moov' box, instead of parsing the file in order.
+  /// Calls for different tracks can run concurrently, each with its own file.
+  /// @param track_id is the id of the track to read.
+  /// @param start_dts is the decoding timestamp of the first sample to read,
+  ///        which is moved back to the last key frame at or before it, so the
+  ///        samples read can be decoded. The data of the samples before it is
+  ///        not read.
+  /// @param end_dts is the decoding timestamp at which reading stops,
+  ///        excluded.
+  /// @param key_frames_only indicates whether only the key frames are read,
+  ///        e.g. for trick play. Each spans the frames skipped until the next
+  ///        key frame, see MediaSample::skipped_frames().
+  /// @param file is the media file, opened for reading.
+  /// @param new_sample_cb is called with the samples of the track, in
+  ///        decoding order.
+  /// @return true if successful, false otherwise.
+  bool ReadTrackSamples(uint32_t track_id,
+                        int64_t start_dts,
+                        int64_t end_dts,
+                        bool key_frames_only,
+                        File* file,
+                        const NewMediaSampleCB& new_sample_cb) const;
+
+  /// @return the offset in the input of the data of the sample being passed
+  ///         to the new sample callback. Only valid during the callback.
+  int64_t current_sample_offset() const { return current_sample_offset_; }
+
  private:
   enum State {
     kWaitingForInit,
@@ -79,6 +119,16 @@ class MP4MediaParser : public MediaParser {
 
   bool EnqueueSample(bool* err);
 
+  // Appends the input to the spill. Fails if --mp4_mdat_spill_limit is
+  // exceeded.
+  bool Spill(const uint8_t* buf, int size);
+  // Moves the spill to a temporary file, where the rest of the input is
+  // spilled too.
+  bool SpillToTempFile();
+  // Parses the spilled input again, once the 'moov' box has been parsed.
+  bool ReplaySpill();
+  void DiscardSpill();
+
   void Reset();
 
   State state_;
@@ -98,10 +148,27 @@ class MP4MediaParser : public MediaParser {
   // |mdat_tail_| is the stream offset of the end of the current 'mdat' box.
   // Valid iff it is greater than the head of the queue.
   int64_t mdat_tail_;
+  // See current_sample_offset().
+  int64_t current_sample_offset_;
 
   std::unique_ptr<Movie> moov_;
   std::unique_ptr<TrackRunIterator> runs_;
 
+  // Non-seekable inputs with the 'mdat' box before the 'moov' box are kept
+  // from their start, in |spill_| or |spill_file_|, until the 'moov' box is
+  // parsed. The samples are then parsed from the spill.
+  bool spilling_;
+  bool mdat_before_moov_;
+  uint64_t spill_size_;
+  std::vector<uint8_t> spill_;
+  std::unique_ptr<File, FileCloser> spill_file_;
+  std::string spill_file_name_;
+
+  // The runs of the tracks not in |selected_track_ids_| are skipped, if
+  // |tracks_selected_|. See SelectTracks().
+  bool tracks_selected_;
+  std::set<uint32_t> selected_track_ids_;
+
   DISALLOW_COPY_AND_ASSIGN(MP4MediaParser);
 };
 
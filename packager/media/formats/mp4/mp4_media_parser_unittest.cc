@@ -4,6 +4,7 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <gflags/gflags.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -16,6 +17,9 @@
 #include "packager/media/formats/mp4/mp4_media_parser.h"
 #include "packager/media/test/test_data_util.h"
 
+DECLARE_uint64(mp4_mdat_spill_limit);
+DECLARE_bool(mp4_spill_mdat_to_temp_file);
+
 using ::testing::_;
 using ::testing::DoAll;
 using ::testing::Return;
@@ -53,6 +57,8 @@ class MP4MediaParserTest : public testing::Test {
   std::unique_ptr<MP4MediaParser> parser_;
   size_t num_streams_;
   size_t num_samples_;
+  // Select the video tracks only on init if true.
+  bool select_video_tracks_ = false;
 
   bool AppendData(const uint8_t* data, size_t length) {
     return parser_->Parse(data, static_cast<int>(length));
@@ -80,6 +86,14 @@ class MP4MediaParserTest : public testing::Test {
     }
     num_streams_ = streams.size();
     num_samples_ = 0;
+    if (select_video_tracks_) {
+      std::set<uint32_t> track_ids;
+      for (const auto& stream_info : streams) {
+        if (stream_info->stream_type() == kStreamVideo)
+          track_ids.insert(stream_info->track_id());
+      }
+      parser_->SelectTracks(track_ids);
+    }
   }
 
   bool NewSampleF(uint32_t track_id, std::shared_ptr<MediaSample> sample) {
@@ -101,6 +115,14 @@ class MP4MediaParserTest : public testing::Test {
         decryption_key_source);
   }
 
+  // Parses the file as if it were not seekable, i.e. without LoadMoov().
+  bool ParseMP4Stream(const std::string& filename, int append_bytes) {
+    InitializeParser(NULL);
+    std::vector<uint8_t> buffer = ReadTestDataFile(filename);
+    return AppendDataInPieces(buffer.data(), buffer.size(), append_bytes) &&
+           parser_->Flush();
+  }
+
   bool ParseMP4File(const std::string& filename, int append_bytes) {
     InitializeParser(NULL);
     if (!parser_->LoadMoov(GetTestDataFilePath(filename).AsUTF8Unsafe()))
@@ -201,6 +223,52 @@ TEST_F(MP4MediaParserTest, TrailingMoovAndAdditionalMdat) {
   EXPECT_EQ(201u, num_samples_);
 }
 
+TEST_F(MP4MediaParserTest, TrailingMoovNotSeekable) {
+  EXPECT_FALSE(ParseMP4Stream("bear-640x360-trailing-moov.mp4", 1024));
+}
+
+TEST_F(MP4MediaParserTest, TrailingMoovNotSeekableWithSpill) {
+  gflags::FlagSaver flag_saver;
+  FLAGS_mp4_mdat_spill_limit = 10 << 20;
+  EXPECT_TRUE(ParseMP4Stream("bear-640x360-trailing-moov.mp4", 1024));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, TrailingMoovAndAdditionalMdatNotSeekableWithSpill) {
+  gflags::FlagSaver flag_saver;
+  FLAGS_mp4_mdat_spill_limit = 10 << 20;
+  EXPECT_TRUE(ParseMP4Stream(
+      "bear-640x360-trailing-moov-additional-mdat.mp4", 1024));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, TrailingMoovNotSeekableWithSpillToTempFile) {
+  gflags::FlagSaver flag_saver;
+  FLAGS_mp4_mdat_spill_limit = 10 << 20;
+  FLAGS_mp4_spill_mdat_to_temp_file = true;
+  EXPECT_TRUE(ParseMP4Stream("bear-640x360-trailing-moov.mp4", 1024));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, TrailingMoovNotSeekableExceedsSpillLimit) {
+  gflags::FlagSaver flag_saver;
+  FLAGS_mp4_mdat_spill_limit = 4096;
+  EXPECT_FALSE(ParseMP4Stream("bear-640x360-trailing-moov.mp4", 1024));
+  EXPECT_EQ(0u, num_streams_);
+}
+
+TEST_F(MP4MediaParserTest, LeadingMoovWithSpill) {
+  // Nothing is spilled once the 'moov' box is found.
+  gflags::FlagSaver flag_saver;
+  FLAGS_mp4_mdat_spill_limit = 8192;
+  EXPECT_TRUE(ParseMP4Stream("bear-640x360.mp4", 1024));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+}
+
 TEST_F(MP4MediaParserTest, Flush) {
   // Flush while reading sample data, then start a new stream.
   InitializeParser(NULL);
@@ -240,6 +308,21 @@ TEST_F(MP4MediaParserTest, NON_FRAGMENTED_MP4) {
   EXPECT_EQ(201u, num_samples_);
 }
 
+TEST_F(MP4MediaParserTest, SelectTracks) {
+  select_video_tracks_ = true;
+  EXPECT_TRUE(ParseMP4File("bear-640x360.mp4", 512));
+  EXPECT_EQ(2u, num_streams_);
+  // The 82 video samples, without the 119 audio samples.
+  EXPECT_EQ(82u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, SelectTracksFragmented) {
+  select_video_tracks_ = true;
+  EXPECT_TRUE(ParseMP4File("bear-640x360-av_frag.mp4", 512));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(82u, num_samples_);
+}
+
 TEST_F(MP4MediaParserTest, CencWithoutDecryptionSource) {
   EXPECT_TRUE(ParseMP4File("bear-640x360-v_frag-cenc-aux.mp4", 512));
   EXPECT_EQ(1u, num_streams_);
@@ -22,6 +22,7 @@
 #include "packager/media/codecs/es_descriptor.h"
 #include "packager/media/event/muxer_listener.h"
 #include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/movie_template_cache.h"
 #include "packager/media/formats/mp4/multi_segment_segmenter.h"
 #include "packager/media/formats/mp4/single_segment_segmenter.h"
 #include "packager/status_macros.h"
@@ -97,46 +98,10 @@ FourCC CodecToFourCC(Codec codec, H26xStreamFormat h26x_stream_format) {
 void GenerateSinf(FourCC old_type,
                   const EncryptionConfig& encryption_config,
                   ProtectionSchemeInfo* sinf) {
+  // Only the original format is specific to the sample entry.
+  *sinf =
+      MovieTemplateCache::GetInstance()->GetTemplate(encryption_config)->sinf;
   sinf->format.format = old_type;
-
-  DCHECK_NE(encryption_config.protection_scheme, FOURCC_NULL);
-  sinf->type.type = encryption_config.protection_scheme;
-
-  // The version of cenc implemented here. CENC 4.
-  const int kCencSchemeVersion = 0x00010000;
-  sinf->type.version = kCencSchemeVersion;
-
-  auto& track_encryption = sinf->info.track_encryption;
-  track_encryption.default_is_protected = 1;
-
-  track_encryption.default_crypt_byte_block =
-      encryption_config.crypt_byte_block;
-  track_encryption.default_skip_byte_block = encryption_config.skip_byte_block;
-  switch (encryption_config.protection_scheme) {
-    case FOURCC_cenc:
-    case FOURCC_cbc1:
-      DCHECK_EQ(track_encryption.default_crypt_byte_block, 0u);
-      DCHECK_EQ(track_encryption.default_skip_byte_block, 0u);
-      // CENCv3 10.1 ‘cenc’ AES-CTR scheme and 10.2 ‘cbc1’ AES-CBC scheme:
-      // The version of the Track Encryption Box (‘tenc’) SHALL be 0.
-      track_encryption.version = 0;
-      break;
-    case FOURCC_cbcs:
-    case FOURCC_cens:
-      // CENCv3 10.3 ‘cens’ AES-CTR subsample pattern encryption scheme and
-      //        10.4 ‘cbcs’ AES-CBC subsample pattern encryption scheme:
-      // The version of the Track Encryption Box (‘tenc’) SHALL be 1.
-      track_encryption.version = 1;
-      break;
-    default:
-      NOTREACHED() << "Unexpected protection scheme "
-                   << encryption_config.protection_scheme;
-  }
-
-  track_encryption.default_per_sample_iv_size =
-      encryption_config.per_sample_iv_size;
-  track_encryption.default_constant_iv = encryption_config.constant_iv;
-  track_encryption.default_kid = encryption_config.key_id;
 }
 
 // The roll distance is expressed in sample units and always takes negative
@@ -278,15 +243,9 @@ Status MP4Muxer::DelayInitializeMuxer() {
     }
 
     if (stream->is_encrypted() && options().mp4_params.include_pssh_in_stream) {
-      moov->pssh.clear();
-      const auto& key_system_info = stream->encryption_config().key_system_info;
-      for (const ProtectionSystemSpecificInfo& system : key_system_info) {
-        if (system.psshs.empty())
-          continue;
-        ProtectionSystemSpecificHeader pssh;
-        pssh.raw_box = system.psshs;
-        moov->pssh.push_back(pssh);
-      }
+      moov->pssh = MovieTemplateCache::GetInstance()
+                       ->GetTemplate(stream->encryption_config())
+                       ->pssh;
     }
   }
 
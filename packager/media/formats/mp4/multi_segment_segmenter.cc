@@ -7,29 +7,44 @@
 #include "packager/media/formats/mp4/multi_segment_segmenter.h"
 
 #include <algorithm>
+#include <limits>
 
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/file/io_executor.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/media/event/muxer_listener.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/key_frame_info.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
 namespace media {
 namespace mp4 {
 
+namespace {
+// Maximum number of segments being written at once. Muxing waits for the
+// oldest one to be written beyond that, which bounds the buffered data.
+const size_t kMaxPendingSegments = 4;
+}  // namespace
+
 MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options,
                                              std::unique_ptr<FileType> ftyp,
                                              std::unique_ptr<Movie> moov)
     : Segmenter(options, std::move(ftyp), std::move(moov)),
       styp_(new SegmentType),
-      num_segments_(0) {
+      num_segments_(options.first_segment_index),
+      number_from_timeline_(options.segment_number_from_timeline),
+      write_segments_async_(options.mp4_params.async_segment_write &&
+                            !options.segment_template.empty()),
+      segment_written_(&lock_) {
   // Use the same brands for styp as ftyp.
   styp_->major_brand = Segmenter::ftyp()->major_brand;
   styp_->compatible_brands = Segmenter::ftyp()->compatible_brands;
@@ -38,7 +53,14 @@ MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options,
                FOURCC_cmfc, FOURCC_cmfs);
 }
 
-MultiSegmentSegmenter::~MultiSegmentSegmenter() {}
+MultiSegmentSegmenter::~MultiSegmentSegmenter() {
+  // The segments being written refer to |lock_| and |segment_written_|.
+  base::AutoLock auto_lock(lock_);
+  for (const std::unique_ptr<PendingSegment>& segment : pending_segments_) {
+    while (!segment->written)
+      segment_written_.Wait();
+  }
+}
 
 bool MultiSegmentSegmenter::GetInitRange(size_t* offset, size_t* size) {
   VLOG(1) << "MultiSegmentSegmenter outputs init segment: "
@@ -57,12 +79,19 @@ std::vector<Range> MultiSegmentSegmenter::GetSegmentRanges() {
 }
 
 Status MultiSegmentSegmenter::DoInitialize() {
+  // The init segment of a stream muxed in time slices is written by the first
+  // slice.
+  if (options().time_slice && options().first_segment_index > 0)
+    return Status::OK;
   return WriteInitSegment();
 }
 
 Status MultiSegmentSegmenter::DoFinalize() {
-  // Update init segment with media duration set.
-  RETURN_IF_ERROR(WriteInitSegment());
+  RETURN_IF_ERROR(NotifyWrittenSegments(0));
+  // Update init segment with media duration set, unless only a time slice of
+  // the media has been muxed.
+  if (!options().time_slice)
+    RETURN_IF_ERROR(WriteInitSegment());
   SetComplete();
   return Status::OK;
 }
@@ -71,6 +100,38 @@ Status MultiSegmentSegmenter::DoFinalizeSegment() {
   return WriteSegment();
 }
 
+Status MultiSegmentSegmenter::DoFinalizeChunk() {
+  DCHECK(!sidx()->references.empty());
+  // Keep the listener notifications in order.
+  RETURN_IF_ERROR(NotifyWrittenSegments(0));
+  if (!segment_file_)
+    RETURN_IF_ERROR(OpenSegment(false));
+
+  const uint64_t chunk_offset = segment_header_size_ + written_fragment_size();
+  const uint64_t chunk_size = fragment_buffer_size();
+  RETURN_IF_ERROR(WriteFragmentBuffer(segment_file_.get()));
+  // Flush the chunk out right away so it becomes available to the clients
+  // before the segment is complete.
+  if (!segment_file_->Flush()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot flush file " + segment_file_name_);
+  }
+
+  if (muxer_listener()) {
+    const SegmentReference& chunk_reference = sidx()->references.back();
+    muxer_listener()->OnNewChunk(
+        segment_file_name_, chunk_reference.earliest_presentation_time,
+        chunk_reference.subsegment_duration, chunk_offset, chunk_size);
+  }
+  return Status::OK;
+}
+
+Status MultiSegmentSegmenter::DoAddSample() {
+  if (pending_segments_.empty())
+    return Status::OK;
+  return NotifyWrittenSegments(std::numeric_limits<size_t>::max());
+}
+
 Status MultiSegmentSegmenter::WriteInitSegment() {
   DCHECK(ftyp());
   DCHECK(moov());
@@ -90,6 +151,87 @@ Status MultiSegmentSegmenter::WriteInitSegment() {
 Status MultiSegmentSegmenter::WriteSegment() {
   DCHECK(sidx());
   DCHECK(fragment_buffer());
+
+  // The file is already open if the segment is written in chunks.
+  if (!segment_file_) {
+    if (write_segments_async_)
+      return WriteSegmentAsync();
+    RETURN_IF_ERROR(OpenSegment(true));
+  }
+
+  const size_t segment_size =
+      segment_header_size_ + written_fragment_size() + fragment_buffer_size();
+  DCHECK_NE(segment_size, 0u);
+
+  if (muxer_listener()) {
+    for (const KeyFrameInfo& key_frame_info : key_frame_infos()) {
+      muxer_listener()->OnKeyFrame(
+          key_frame_info.timestamp,
+          segment_header_size_ + key_frame_info.start_byte_offset,
+          key_frame_info.size);
+    }
+  }
+  RETURN_IF_ERROR(WriteFragmentBuffer(segment_file_.get()));
+
+  // Close the file, which also does flushing, to make sure the file is written
+  // before manifest is updated.
+  bool closed = false;
+  {
+    ScopedTraceEvent trace_event("CloseSegmentFile", "io");
+    closed = segment_file_.release()->Close();
+  }
+  if (!closed) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + segment_file_name_ +
+            ", possibly file permission issue or running out of disk space.");
+  }
+
+  const uint64_t segment_duration = GetSegmentDuration();
+  UpdateProgress(segment_duration);
+  if (muxer_listener()) {
+    muxer_listener()->OnSampleDurationReady(sample_duration());
+    muxer_listener()->OnNewSegment(segment_file_name_,
+                                   sidx()->earliest_presentation_time,
+                                   segment_duration, segment_size);
+  }
+
+  return Status::OK;
+}
+
+Status MultiSegmentSegmenter::WriteSegmentAsync() {
+  // Notify the segments written so far, and bound the number of segments
+  // being written.
+  RETURN_IF_ERROR(NotifyWrittenSegments(kMaxPendingSegments - 1));
+
+  std::unique_ptr<PendingSegment> segment(new PendingSegment);
+  segment->header = GenerateSegmentHeader(true);
+  segment->file_name = segment_file_name_;
+  segment->size = segment_header_size_ + fragment_buffer_size();
+  DCHECK_NE(segment->size, 0u);
+  for (const KeyFrameInfo& key_frame_info : key_frame_infos()) {
+    segment->key_frame_infos.push_back(
+        {key_frame_info.timestamp,
+         segment_header_size_ + key_frame_info.start_byte_offset,
+         key_frame_info.size});
+  }
+  segment->earliest_presentation_time = sidx()->earliest_presentation_time;
+  segment->duration = GetSegmentDuration();
+  segment->sample_duration = sample_duration();
+  segment->fragments = TakeFragmentBuffer();
+  segment->memory.Set(segment->size);
+
+  PendingSegment* pending_segment = segment.get();
+  pending_segments_.push_back(std::move(segment));
+  IoExecutor::GetLocalInstance()->PostTask(
+      base::Bind(&MultiSegmentSegmenter::WritePendingSegment,
+                 base::Unretained(this), base::Unretained(pending_segment)));
+  return Status::OK;
+}
+
+std::unique_ptr<BufferWriter> MultiSegmentSegmenter::GenerateSegmentHeader(
+    bool include_sidx) {
+  DCHECK(sidx());
   DCHECK(styp_);
 
   DCHECK(!sidx()->references.empty());
@@ -99,69 +241,129 @@ Status MultiSegmentSegmenter::WriteSegment() {
       sidx()->references[0].earliest_presentation_time;
 
   std::unique_ptr<BufferWriter> buffer(new BufferWriter());
-  std::unique_ptr<File, FileCloser> file;
-  std::string file_name;
   if (options().segment_template.empty()) {
     // Append the segment to output file if segment template is not specified.
-    file_name = options().output_file_name.c_str();
-    file.reset(File::Open(file_name.c_str(), "a"));
-    if (!file) {
+    segment_file_name_ = options().output_file_name;
+  } else {
+    if (number_from_timeline_) {
+      num_segments_ = GetTimelineSegmentIndex(
+          options().segment_duration_in_seconds,
+          sidx()->earliest_presentation_time, sidx()->timescale);
+      number_from_timeline_ = false;
+    }
+    segment_file_name_ = GetSegmentName(options().segment_template,
+                                        sidx()->earliest_presentation_time,
+                                        num_segments_++, options().bandwidth);
+    styp_->Write(buffer.get());
+  }
+
+  if (include_sidx && options().mp4_params.generate_sidx_in_media_segments)
+    sidx()->Write(buffer.get());
+
+  segment_header_size_ = buffer->Size();
+  return buffer;
+}
+
+Status MultiSegmentSegmenter::OpenSegment(bool include_sidx) {
+  DCHECK(!segment_file_);
+
+  std::unique_ptr<BufferWriter> buffer = GenerateSegmentHeader(include_sidx);
+  if (options().segment_template.empty()) {
+    segment_file_.reset(File::Open(segment_file_name_.c_str(), "a"));
+    if (!segment_file_) {
       return Status(error::FILE_FAILURE, "Cannot open file for append " +
                                              options().output_file_name);
     }
   } else {
-    file_name = GetSegmentName(options().segment_template,
-                               sidx()->earliest_presentation_time,
-                               num_segments_++, options().bandwidth);
-    file.reset(File::Open(file_name.c_str(), "w"));
-    if (!file) {
+    segment_file_.reset(File::Open(segment_file_name_.c_str(), "w"));
+    if (!segment_file_) {
       return Status(error::FILE_FAILURE,
-                    "Cannot open file for write " + file_name);
+                    "Cannot open file for write " + segment_file_name_);
     }
-    styp_->Write(buffer.get());
   }
 
-  if (options().mp4_params.generate_sidx_in_media_segments)
-    sidx()->Write(buffer.get());
+  if (segment_header_size_ == 0)
+    return Status::OK;
+  return buffer->WriteToFile(segment_file_.get());
+}
 
-  const size_t segment_header_size = buffer->Size();
-  const size_t segment_size = segment_header_size + fragment_buffer()->Size();
-  DCHECK_NE(segment_size, 0u);
+uint64_t MultiSegmentSegmenter::GetSegmentDuration() {
+  uint64_t segment_duration = 0;
+  // ISO/IEC 23009-1:2012: the value shall be identical to sum of the the
+  // values of all Subsegment_duration fields in the first ‘sidx’ box.
+  for (size_t i = 0; i < sidx()->references.size(); ++i)
+    segment_duration += sidx()->references[i].subsegment_duration;
+  return segment_duration;
+}
 
-  RETURN_IF_ERROR(buffer->WriteToFile(file.get()));
-  if (muxer_listener()) {
-    for (const KeyFrameInfo& key_frame_info : key_frame_infos()) {
-      muxer_listener()->OnKeyFrame(
-          key_frame_info.timestamp,
-          segment_header_size + key_frame_info.start_byte_offset,
-          key_frame_info.size);
-    }
+void MultiSegmentSegmenter::WritePendingSegment(PendingSegment* segment) {
+  Status status = WriteSegmentFile(segment);
+  // Release the sample data early. The fragment buffer is kept to be reused
+  // for a later segment.
+  segment->header.reset();
+  segment->fragments.referenced_data.clear();
+  segment->memory.Set(0);
+
+  base::AutoLock auto_lock(lock_);
+  segment->status = status;
+  segment->written = true;
+  segment_written_.Signal();
+}
+
+// static
+Status MultiSegmentSegmenter::WriteSegmentFile(PendingSegment* segment) {
+  ScopedTraceEvent trace_event("WriteSegmentFile", "io");
+  std::unique_ptr<File, FileCloser> file(
+      File::Open(segment->file_name.c_str(), "w"));
+  if (!file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for write " + segment->file_name);
   }
-  RETURN_IF_ERROR(fragment_buffer()->WriteToFile(file.get()));
+  if (segment->header->Size() > 0)
+    RETURN_IF_ERROR(segment->header->WriteToFile(file.get()));
+  RETURN_IF_ERROR(WriteFragments(&segment->fragments, file.get()));
 
   // Close the file, which also does flushing, to make sure the file is written
   // before manifest is updated.
   if (!file.release()->Close()) {
     return Status(
         error::FILE_FAILURE,
-        "Cannot close file " + file_name +
+        "Cannot close file " + segment->file_name +
             ", possibly file permission issue or running out of disk space.");
   }
+  return Status::OK;
+}
 
-  uint64_t segment_duration = 0;
-  // ISO/IEC 23009-1:2012: the value shall be identical to sum of the the
-  // values of all Subsegment_duration fields in the first ‘sidx’ box.
-  for (size_t i = 0; i < sidx()->references.size(); ++i)
-    segment_duration += sidx()->references[i].subsegment_duration;
+Status MultiSegmentSegmenter::NotifyWrittenSegments(
+    size_t max_pending_segments) {
+  while (!pending_segments_.empty()) {
+    PendingSegment& segment = *pending_segments_.front();
+    {
+      base::AutoLock auto_lock(lock_);
+      while (!segment.written &&
+             pending_segments_.size() > max_pending_segments) {
+        segment_written_.Wait();
+      }
+      if (!segment.written)
+        return Status::OK;
+    }
+    RETURN_IF_ERROR(segment.status);
 
-  UpdateProgress(segment_duration);
-  if (muxer_listener()) {
-    muxer_listener()->OnSampleDurationReady(sample_duration());
-    muxer_listener()->OnNewSegment(file_name,
-                                   sidx()->earliest_presentation_time,
-                                   segment_duration, segment_size);
+    UpdateProgress(segment.duration);
+    if (muxer_listener()) {
+      for (const KeyFrameInfo& key_frame_info : segment.key_frame_infos) {
+        muxer_listener()->OnKeyFrame(key_frame_info.timestamp,
+                                     key_frame_info.start_byte_offset,
+                                     key_frame_info.size);
+      }
+      muxer_listener()->OnSampleDurationReady(segment.sample_duration);
+      muxer_listener()->OnNewSegment(segment.file_name,
+                                     segment.earliest_presentation_time,
+                                     segment.duration, segment.size);
+    }
+    RecycleFragmentBuffer(std::move(segment.fragments.buffer));
+    pending_segments_.pop_front();
   }
-
   return Status::OK;
 }
 
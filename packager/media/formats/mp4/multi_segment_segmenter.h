@@ -7,7 +7,16 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 #define PACKAGER_MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/formats/mp4/key_frame_info.h"
 #include "packager/media/formats/mp4/segmenter.h"
+#include "packager/metrics/memory_budget.h"
 
 namespace shaka {
 namespace media {
@@ -20,6 +29,10 @@ struct SegmentType;
 /// are written to files defined by @b MuxerOptions.segment_template if
 /// specified; otherwise, the segments are appended to the main output file
 /// specified by @b MuxerOptions.output_file_name.
+/// With @b Mp4OutputParams.async_segment_write, segment files are written on
+/// the IoExecutor threads while the next segments are muxed. MuxerListener is
+/// notified of a segment, on the muxing thread and in order, once its file is
+/// written and closed.
 class MultiSegmentSegmenter : public Segmenter {
  public:
   MultiSegmentSegmenter(const MuxerOptions& options,
@@ -39,13 +52,66 @@ class MultiSegmentSegmenter : public Segmenter {
   Status DoInitialize() override;
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
+  Status DoFinalizeChunk() override;
+  Status DoAddSample() override;
+
+  // A segment handed over to an IoExecutor thread to be written.
+  struct PendingSegment {
+    std::string file_name;
+    std::unique_ptr<BufferWriter> header;
+    BufferedFragments fragments;
+    // Sent to MuxerListener once the segment is written.
+    std::vector<KeyFrameInfo> key_frame_infos;
+    uint64_t earliest_presentation_time = 0;
+    uint64_t duration = 0;
+    uint64_t size = 0;
+    uint32_t sample_duration = 0;
+    // The memory of the segment until it is written.
+    MemoryUsage memory{MemoryBudget::kPendingSegments};
+    // Protected by |lock_|.
+    bool written = false;
+    Status status;
+  };
 
   // Write segment to file.
   Status WriteInitSegment();
   Status WriteSegment();
+  // Hand the current segment over to an IoExecutor thread.
+  Status WriteSegmentAsync();
+  // Generate the header of the current segment and its file name.
+  // The 'sidx' box, if enabled, is only written if @a include_sidx is true, as
+  // it cannot be generated before the segment is complete.
+  std::unique_ptr<BufferWriter> GenerateSegmentHeader(bool include_sidx);
+  // Open the file of the current segment and write the segment header to it.
+  Status OpenSegment(bool include_sidx);
+  // Sum of the subsegment durations of the current segment.
+  uint64_t GetSegmentDuration();
+  // Runs on an IoExecutor thread.
+  void WritePendingSegment(PendingSegment* segment);
+  static Status WriteSegmentFile(PendingSegment* segment);
+  // Notify MuxerListener of the segments written so far, in order, waiting
+  // until at most @a max_pending_segments are still being written.
+  // @return the first write error, if any.
+  Status NotifyWrittenSegments(size_t max_pending_segments);
 
   std::unique_ptr<SegmentType> styp_;
   uint32_t num_segments_;
+  // Whether |num_segments_| is still to be derived from the start time of the
+  // first segment, see MuxerOptions::segment_number_from_timeline.
+  bool number_from_timeline_;
+  // The file of the current segment. It is kept open across the low latency
+  // chunks of the segment, and is null otherwise.
+  std::unique_ptr<File, FileCloser> segment_file_;
+  std::string segment_file_name_;
+  size_t segment_header_size_ = 0;
+
+  const bool write_segments_async_;
+  // Segments being written, oldest first. Only accessed on the muxing thread,
+  // except for the fields of PendingSegment protected by |lock_|.
+  std::deque<std::unique_ptr<PendingSegment>> pending_segments_;
+  base::Lock lock_;
+  // Signaled when a pending segment is written.
+  base::ConditionVariable segment_written_;
 
   DISALLOW_COPY_AND_ASSIGN(MultiSegmentSegmenter);
 };
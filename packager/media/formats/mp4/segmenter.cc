@@ -9,29 +9,39 @@
 #include <algorithm>
 
 #include "packager/base/logging.h"
+#include "packager/file/file.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/id3_tag.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/base/timestamp_rescaler.h"
 #include "packager/media/chunking/chunking_handler.h"
 #include "packager/media/event/progress_listener.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/fragmenter.h"
 #include "packager/media/formats/mp4/key_frame_info.h"
+#include "packager/media/formats/mp4/movie_template_cache.h"
+#include "packager/status_macros.h"
 #include "packager/version/version.h"
 
 namespace shaka {
 namespace media {
 namespace mp4 {
-
 namespace {
 
-uint64_t Rescale(uint64_t time_in_old_scale,
-                 uint32_t old_scale,
-                 uint32_t new_scale) {
-  return static_cast<double>(time_in_old_scale) / old_scale * new_scale;
+// Seconds from the NTP epoch, 1900, to the Unix epoch, 1970.
+const uint64_t kNtpToUnixEpochSeconds = 2208988800ull;
+
+uint64_t ToNtpTimestamp(base::Time time) {
+  const int64_t microseconds =
+      (time - base::Time::UnixEpoch()).InMicroseconds();
+  const uint64_t seconds =
+      static_cast<uint64_t>(microseconds / 1000000) + kNtpToUnixEpochSeconds;
+  const uint64_t fraction =
+      (static_cast<uint64_t>(microseconds % 1000000) << 32) / 1000000;
+  return (seconds << 32) | fraction;
 }
 
 }  // namespace
@@ -77,9 +87,16 @@ Status Segmenter::Initialize(
     }
 
     fragmenters_[i].reset(
-        new Fragmenter(streams[i], &moof_->tracks[i], edit_list_offset));
+        new Fragmenter(streams[i], &moof_->tracks[i], edit_list_offset,
+                       options_.mp4_params.scatter_gather_output));
   }
 
+  std::vector<const StreamInfo*> stream_infos;
+  for (const std::shared_ptr<const StreamInfo>& stream : streams)
+    stream_infos.push_back(stream.get());
+  segment_size_hint_ = EstimateSegmentSize(options_, stream_infos);
+  fragment_buffer_->Reserve(segment_size_hint_);
+
   // Choose the first stream if there is no VIDEO.
   if (sidx_->reference_id == 0)
     sidx_->reference_id = 1;
@@ -90,7 +107,10 @@ Status Segmenter::Initialize(
 
   // Use the reference stream's time scale as movie time scale.
   moov_->header.timescale = sidx_->timescale;
-  moof_->header.sequence_number = 1;
+  // The fragments of a time slice follow those of the previous slices, which
+  // have a single fragment per segment.
+  moof_->header.sequence_number = options_.first_segment_index + 1;
+  number_from_timeline_ = options_.segment_number_from_timeline;
 
   // Fill in version information.
   const std::string version = GetPackagerVersion();
@@ -112,8 +132,9 @@ Status Segmenter::Finalize() {
   moov_->extends.header.fragment_duration = 0;
   for (size_t i = 0; i < stream_durations_.size(); ++i) {
     uint64_t duration =
-        Rescale(stream_durations_[i], moov_->tracks[i].media.header.timescale,
-                moov_->header.timescale);
+        TimestampRescaler(moov_->tracks[i].media.header.timescale,
+                          moov_->header.timescale)
+            .Rescale(stream_durations_[i]);
     if (duration > moov_->extends.header.fragment_duration)
       moov_->extends.header.fragment_duration = duration;
   }
@@ -141,7 +162,7 @@ Status Segmenter::AddSample(size_t stream_id, const MediaSample& sample) {
   if (sample_duration_ == 0)
     sample_duration_ = sample.duration();
   stream_durations_[stream_id] += sample.duration();
-  return Status::OK;
+  return DoAddSample();
 }
 
 Status Segmenter::FinalizeSegment(size_t stream_id,
@@ -165,28 +186,81 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
       return Status::OK;
   }
 
+  if (number_from_timeline_ && !segment_info.is_subsegment) {
+    // The fragments are the segments, see
+    // MuxerOptions::segment_number_from_timeline.
+    const uint32_t time_scale = moov_->tracks[stream_id].media.header.timescale;
+    moof_->header.sequence_number =
+        GetTimelineSegmentIndex(options_.segment_duration_in_seconds,
+                                segment_info.start_timestamp, time_scale) +
+        1;
+    number_from_timeline_ = false;
+  }
+
+  // 'prft' precedes the 'moof' box of the fragment. It maps the start of the
+  // segment or chunk to the wall clock time its first sample arrived.
+  uint64_t prft_size = 0;
+  if (options_.mp4_params.generate_prft_boxes &&
+      !segment_info.arrival_time.is_null() &&
+      segment_info.start_timestamp >= 0) {
+    ProducerReferenceTime prft;
+    prft.reference_track_id = GetReferenceStreamId() + 1;
+    prft.ntp_timestamp = ToNtpTimestamp(segment_info.arrival_time);
+    prft.media_time = segment_info.start_timestamp;
+    prft.Write(fragment_buffer_.get());
+    prft_size = prft.box_size();
+  }
+
+  const uint64_t moof_start_offset = fragment_buffer_size();
+  // Differs from |moof_start_offset| if sample data is referenced.
+  const size_t moof_buffer_position = fragment_buffer_->Size();
+
+  // Write the fragment to buffer. 'moof' is written in one pass with
+  // placeholder data offsets, which are back-patched below now that the size
+  // of 'moof' and its child boxes is known.
+  moof_->WriteInOnePass(fragment_buffer_.get());
+
   MediaData mdat;
   // Data offset relative to 'moof': moof size + mdat header size.
-  // The code will also update box sizes for moof_ and its child boxes.
-  uint64_t data_offset = moof_->ComputeSize() + mdat.HeaderSize();
+  uint64_t data_offset = moof_->box_size() + mdat.HeaderSize();
   // 'traf' should follow 'mfhd' moof header box.
   uint64_t next_traf_position = moof_->HeaderSize() + moof_->header.box_size();
   for (size_t i = 0; i < moof_->tracks.size(); ++i) {
     TrackFragment& traf = moof_->tracks[i];
+    const uint64_t traf_position = next_traf_position;
+    next_traf_position += traf.box_size();
     if (traf.auxiliary_offset.offsets.size() > 0) {
       DCHECK_EQ(traf.auxiliary_offset.offsets.size(), 1u);
       DCHECK(!traf.sample_encryption.sample_encryption_entries.empty());
 
-      next_traf_position += traf.box_size();
       // SampleEncryption 'senc' box should be the last box in 'traf'.
       // |auxiliary_offset| should point to the data of SampleEncryption.
+      const uint64_t senc_position =
+          next_traf_position - traf.sample_encryption.box_size();
       traf.auxiliary_offset.offsets[0] =
-          next_traf_position - traf.sample_encryption.box_size() +
-          traf.sample_encryption.HeaderSize() +
+          senc_position + traf.sample_encryption.HeaderSize() +
           sizeof(uint32_t);  // for sample count field in 'senc'
+      // The offset is the last field of 'saio', which precedes 'senc'.
+      const size_t offset_size =
+          traf.auxiliary_offset.version == 1 ? sizeof(uint64_t)
+                                             : sizeof(uint32_t);
+      fragment_buffer_->OverwriteNBytes(
+          moof_buffer_position + senc_position - offset_size,
+          traf.auxiliary_offset.offsets[0], offset_size);
     }
     traf.runs[0].data_offset = data_offset + mdat.data_size;
-    mdat.data_size += static_cast<uint32_t>(fragmenters_[i]->data()->Size());
+    mdat.data_size += static_cast<uint32_t>(fragmenters_[i]->data_size());
+
+    // The data offset of the first 'trun' follows its sample count. The runs
+    // follow 'tfhd' and 'tfdt'.
+    DCHECK(traf.runs[0].flags & TrackFragmentRun::kDataOffsetPresentMask);
+    const uint64_t data_offset_position =
+        traf_position + traf.HeaderSize() + traf.header.box_size() +
+        (traf.decode_time_absent ? 0 : traf.decode_time.box_size()) +
+        traf.runs[0].HeaderSize() + sizeof(traf.runs[0].sample_count);
+    fragment_buffer_->OverwriteNBytes(
+        moof_buffer_position + data_offset_position, traf.runs[0].data_offset,
+        sizeof(traf.runs[0].data_offset));
   }
 
   // Generate segment reference.
@@ -194,12 +268,8 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
   fragmenters_[GetReferenceStreamId()]->GenerateSegmentReference(
       &sidx_->references[sidx_->references.size() - 1]);
   sidx_->references[sidx_->references.size() - 1].referenced_size =
-      data_offset + mdat.data_size;
+      prft_size + data_offset + mdat.data_size;
 
-  const uint64_t moof_start_offset = fragment_buffer_->Size();
-
-  // Write the fragment to buffer.
-  moof_->Write(fragment_buffer_.get());
   mdat.WriteHeader(fragment_buffer_.get());
 
   bool first_key_frame = true;
@@ -213,14 +283,25 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
           fragmenter->key_frame_infos().front();
       first_key_frame = false;
       key_frame_infos_.push_back(
-          {key_frame_info.timestamp, moof_start_offset,
-           fragment_buffer_->Size() - moof_start_offset + key_frame_info.size});
+          {key_frame_info.timestamp,
+           written_fragment_size_ + moof_start_offset,
+           fragment_buffer_size() - moof_start_offset + key_frame_info.size});
+    }
+    if (options_.mp4_params.scatter_gather_output) {
+      for (const Fragmenter::SampleData& sample_data :
+           fragmenter->sample_data()) {
+        referenced_data_.push_back(
+            {fragment_buffer_->Size(), sample_data.data, sample_data.size});
+        referenced_data_size_ += sample_data.size;
+      }
+    } else {
+      fragment_buffer_->AppendBuffer(*fragmenter->data());
     }
-    fragment_buffer_->AppendBuffer(*fragmenter->data());
   }
 
   // Increase sequence_number for next fragment.
   ++moof_->header.sequence_number;
+  fragment_memory_.Set(fragment_buffer_size());
 
   for (std::unique_ptr<Fragmenter>& fragmenter : fragmenters_)
     fragmenter->ClearFragmentFinalized();
@@ -229,8 +310,92 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
     // Reset segment information to initial state.
     sidx_->references.clear();
     key_frame_infos_.clear();
+    written_fragment_size_ = 0;
     return status;
   }
+  if (segment_info.is_chunk)
+    return DoFinalizeChunk();
+  return Status::OK;
+}
+
+Status Segmenter::WriteFragmentBuffer(File* file) {
+  const size_t size = fragment_buffer_size();
+  Status status =
+      WriteFragmentData(fragment_buffer_.get(), referenced_data_, size, file);
+  referenced_data_.clear();
+  referenced_data_size_ = 0;
+  fragment_memory_.Set(0);
+  if (!status.ok())
+    return status;
+  written_fragment_size_ += size;
+  return Status::OK;
+}
+
+Segmenter::BufferedFragments Segmenter::TakeFragmentBuffer() {
+  BufferedFragments fragments;
+  fragments.size = fragment_buffer_size();
+  fragments.buffer = std::move(fragment_buffer_);
+  fragments.referenced_data.swap(referenced_data_);
+  if (spare_fragment_buffers_.empty()) {
+    fragment_buffer_.reset(new BufferWriter);
+    fragment_buffer_->Reserve(segment_size_hint_);
+  } else {
+    fragment_buffer_ = std::move(spare_fragment_buffers_.back());
+    spare_fragment_buffers_.pop_back();
+  }
+  referenced_data_size_ = 0;
+  // The fragments are accounted by the caller from now on.
+  fragment_memory_.Set(0);
+  written_fragment_size_ += fragments.size;
+  return fragments;
+}
+
+void Segmenter::RecycleFragmentBuffer(std::unique_ptr<BufferWriter> buffer) {
+  DCHECK(buffer);
+  buffer->Clear();
+  spare_fragment_buffers_.push_back(std::move(buffer));
+}
+
+// static
+Status Segmenter::WriteFragments(BufferedFragments* fragments, File* file) {
+  return WriteFragmentData(fragments->buffer.get(),
+                           fragments->referenced_data, fragments->size, file);
+}
+
+// static
+Status Segmenter::WriteFragmentData(
+    BufferWriter* fragment_buffer,
+    const std::vector<ReferencedData>& referenced_data,
+    size_t size,
+    File* file) {
+  if (referenced_data.empty())
+    return fragment_buffer->WriteToFile(file);
+
+  // Interleave the box data in |fragment_buffer| with the referenced sample
+  // data, so everything is written out with a single vectored write.
+  std::vector<File::IoBlock> blocks;
+  blocks.reserve(referenced_data.size() * 2 + 1);
+  const uint8_t* buffer = fragment_buffer->Buffer();
+  size_t buffer_offset = 0;
+  for (const ReferencedData& data : referenced_data) {
+    if (data.buffer_offset > buffer_offset) {
+      blocks.push_back(
+          {buffer + buffer_offset, data.buffer_offset - buffer_offset});
+      buffer_offset = data.buffer_offset;
+    }
+    blocks.push_back({data.data.get(), data.size});
+  }
+  if (fragment_buffer->Size() > buffer_offset) {
+    blocks.push_back(
+        {buffer + buffer_offset, fragment_buffer->Size() - buffer_offset});
+  }
+
+  const int64_t size_written = file->WriteV(blocks);
+  fragment_buffer->Clear();
+  if (size_written != static_cast<int64_t>(size)) {
+    return Status(error::FILE_FAILURE,
+                  "Fail to write fragments to file " + file->file_name());
+  }
   return Status::OK;
 }
 
@@ -247,6 +412,10 @@ double Segmenter::GetDuration() const {
   return static_cast<double>(duration) / moov_->header.timescale;
 }
 
+Status Segmenter::DoAddSample() {
+  return Status::OK;
+}
+
 void Segmenter::UpdateProgress(uint64_t progress) {
   accumulated_progress_ += progress;
 
@@ -278,15 +447,8 @@ void Segmenter::FinalizeFragmentForKeyRotation(
     bool fragment_encrypted,
     const EncryptionConfig& encryption_config) {
   if (options_.mp4_params.include_pssh_in_stream) {
-    moof_->pssh.clear();
-    const auto& key_system_info = encryption_config.key_system_info;
-    for (const ProtectionSystemSpecificInfo& system : key_system_info) {
-      if (system.psshs.empty())
-        continue;
-      ProtectionSystemSpecificHeader pssh;
-      pssh.raw_box = system.psshs;
-      moof_->pssh.push_back(pssh);
-    }
+    moof_->pssh =
+        MovieTemplateCache::GetInstance()->GetTemplate(encryption_config)->pssh;
   } else {
     LOG(WARNING)
         << "Key rotation and no pssh in stream may not work well together.";
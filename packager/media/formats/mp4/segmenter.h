@@ -12,19 +12,23 @@
 #include <vector>
 
 #include "packager/base/optional.h"
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/range.h"
 #include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/metrics/memory_budget.h"
 #include "packager/status.h"
 
 namespace shaka {
+
+class File;
+
 namespace media {
 
 struct EncryptionConfig;
 struct MuxerOptions;
 struct SegmentInfo;
 
-class BufferWriter;
 class MediaSample;
 class MuxerListener;
 class ProgressListener;
@@ -101,6 +105,22 @@ class Segmenter {
   uint32_t sample_duration() const { return sample_duration_; }
 
  protected:
+  /// Sample data referenced by the buffered fragments in scatter/gather output
+  /// mode, which is to be written at @a buffer_offset of the fragment buffer.
+  struct ReferencedData {
+    size_t buffer_offset;
+    std::shared_ptr<const uint8_t> data;
+    size_t size;
+  };
+
+  /// Buffered fragments detached from the segmenter.
+  struct BufferedFragments {
+    std::unique_ptr<BufferWriter> buffer;
+    std::vector<ReferencedData> referenced_data;
+    /// The size of the fragments, including the referenced sample data.
+    size_t size = 0;
+  };
+
   /// Update segmentation progress using ProgressListener.
   void UpdateProgress(uint64_t progress);
   /// Set progress to 100%.
@@ -110,6 +130,30 @@ class Segmenter {
   FileType* ftyp() { return ftyp_.get(); }
   Movie* moov() { return moov_.get(); }
   BufferWriter* fragment_buffer() { return fragment_buffer_.get(); }
+  /// @return The size of the buffered fragments, including the sample data
+  ///         that is referenced rather than copied into fragment_buffer().
+  size_t fragment_buffer_size() const {
+    return fragment_buffer_->Size() + referenced_data_size_;
+  }
+  /// Write the buffered fragments to @a file and clear the fragment buffer.
+  /// @return OK on success, an error status otherwise.
+  Status WriteFragmentBuffer(File* file);
+  /// Detach the buffered fragments, so they can be written out later, e.g. on
+  /// another thread, with WriteFragments(). The fragment buffer is left
+  /// empty, as after WriteFragmentBuffer().
+  /// @return The buffered fragments.
+  BufferedFragments TakeFragmentBuffer();
+  /// Hand a buffer detached by TakeFragmentBuffer() back once its fragments
+  /// are written, so a later TakeFragmentBuffer() reuses its memory instead of
+  /// allocating a new fragment buffer.
+  void RecycleFragmentBuffer(std::unique_ptr<BufferWriter> buffer);
+  /// Write fragments detached by TakeFragmentBuffer() to @a file.
+  /// @return OK on success, an error status otherwise.
+  static Status WriteFragments(BufferedFragments* fragments, File* file);
+  /// @return The size of the fragments of the current segment which are
+  ///         already written out by WriteFragmentBuffer(), e.g. as low latency
+  ///         chunks.
+  size_t written_fragment_size() const { return written_fragment_size_; }
   SegmentIndex* sidx() { return sidx_.get(); }
   MuxerListener* muxer_listener() { return muxer_listener_; }
   uint64_t progress_target() { return progress_target_; }
@@ -125,9 +169,23 @@ class Segmenter {
   virtual Status DoInitialize() = 0;
   virtual Status DoFinalize() = 0;
   virtual Status DoFinalizeSegment() = 0;
+  // Called when a low latency chunk is complete. The chunk is in the fragment
+  // buffer, along with the earlier fragments of the segment which are not
+  // written out yet.
+  virtual Status DoFinalizeChunk() = 0;
+  // Called after a sample is added. The default implementation does nothing.
+  virtual Status DoAddSample();
 
   uint32_t GetReferenceStreamId();
 
+  // Write |fragment_buffer| interleaved with |referenced_data|, of |size|
+  // bytes in total, to |file|, and clear |fragment_buffer|.
+  static Status WriteFragmentData(
+      BufferWriter* fragment_buffer,
+      const std::vector<ReferencedData>& referenced_data,
+      size_t size,
+      File* file);
+
   void FinalizeFragmentForKeyRotation(
       size_t stream_id,
       bool fragment_encrypted,
@@ -137,7 +195,20 @@ class Segmenter {
   std::unique_ptr<FileType> ftyp_;
   std::unique_ptr<Movie> moov_;
   std::unique_ptr<MovieFragment> moof_;
+  // Whether the sequence number of the first fragment is still to be derived
+  // from its start time, see MuxerOptions::segment_number_from_timeline.
+  bool number_from_timeline_ = false;
   std::unique_ptr<BufferWriter> fragment_buffer_;
+  // Buffers returned by RecycleFragmentBuffer(), to be reused.
+  std::vector<std::unique_ptr<BufferWriter>> spare_fragment_buffers_;
+  // Estimated segment size, which new fragment buffers are allocated for.
+  size_t segment_size_hint_ = 0;
+  // Sample data of the buffered fragments in scatter/gather output mode.
+  std::vector<ReferencedData> referenced_data_;
+  size_t referenced_data_size_ = 0;
+  // The memory of the fragments buffered, i.e. fragment_buffer_size().
+  MemoryUsage fragment_memory_{MemoryBudget::kFragmentBuffers};
+  size_t written_fragment_size_ = 0;
   std::unique_ptr<SegmentIndex> sidx_;
   std::vector<std::unique_ptr<Fragmenter>> fragmenters_;
   MuxerListener* muxer_listener_ = nullptr;
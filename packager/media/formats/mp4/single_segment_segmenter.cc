@@ -7,6 +7,8 @@
 #include "packager/media/formats/mp4/single_segment_segmenter.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include "packager/file/file.h"
 #include "packager/file/file_util.h"
@@ -15,17 +17,33 @@
 #include "packager/media/event/progress_listener.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/key_frame_info.h"
+#include "packager/status_macros.h"
 
 namespace shaka {
 namespace media {
 namespace mp4 {
 
+namespace {
+
+// Size of the header of a 'free' box, which is also the smallest 'free' box.
+const size_t kFreeBoxHeaderSize = 8;
+// Margins applied to the estimated number of subsegments to absorb deviations
+// of the actual subsegment durations from the requested segment duration.
+const double kSubsegmentCountMarginRatio = 1.1;
+const size_t kExtraSubsegmentCount = 4;
+// |referenced_size| of a 'sidx' reference is a 31-bit field.
+const uint64_t kMaxReferencedSize = 0x7FFFFFFF;
+
+}  // namespace
+
 SingleSegmentSegmenter::SingleSegmentSegmenter(const MuxerOptions& options,
                                                std::unique_ptr<FileType> ftyp,
                                                std::unique_ptr<Movie> moov)
     : Segmenter(options, std::move(ftyp), std::move(moov)) {}
 
 SingleSegmentSegmenter::~SingleSegmentSegmenter() {
+  if (output_file_)
+    output_file_.release()->Close();
   if (temp_file_)
     temp_file_.release()->Close();
   if (!temp_file_name_.empty()) {
@@ -54,6 +72,16 @@ std::vector<Range> SingleSegmentSegmenter::GetSegmentRanges() {
   uint64_t next_offset =
       ftyp()->ComputeSize() + moov()->ComputeSize() + vod_sidx_->ComputeSize() +
       vod_sidx_->first_offset;
+  if (options().mp4_params.hierarchical_sidx_subsegments > 0) {
+    // |vod_sidx_| references the child 'sidx' boxes.
+    for (const Range& subsegment_range : subsegment_ranges_) {
+      Range r;
+      r.start = next_offset + subsegment_range.start;
+      r.end = next_offset + subsegment_range.end;
+      ranges.push_back(r);
+    }
+    return ranges;
+  }
   for (const SegmentReference& segment_reference : vod_sidx_->references) {
     Range r;
     r.start = next_offset;
@@ -66,6 +94,26 @@ std::vector<Range> SingleSegmentSegmenter::GetSegmentRanges() {
 }
 
 Status SingleSegmentSegmenter::DoInitialize() {
+  if (options().mp4_params.single_pass_single_segment) {
+    reserved_header_size_ = EstimateHeaderSize();
+    if (reserved_header_size_ > 0) {
+      output_file_.reset(File::Open(options().output_file_name.c_str(), "w"));
+      if (!output_file_) {
+        return Status(error::FILE_FAILURE, "Cannot open file to write " +
+                                               options().output_file_name);
+      }
+      // Reserve space for the header. The part of it that is not used by the
+      // header becomes the payload of a 'free' box.
+      std::unique_ptr<BufferWriter> buffer(new BufferWriter());
+      const std::vector<uint8_t> zeros(reserved_header_size_, 0);
+      buffer->AppendVector(zeros);
+      return buffer->WriteToFile(output_file_.get());
+    }
+    LOG(WARNING) << "Cannot estimate the index size of '"
+                 << options().output_file_name
+                 << "'. Writing fragments to a temporary file instead.";
+  }
+
   // Single segment segmentation involves two stages:
   //   Stage 1: Create media subsegments from media samples
   //   Stage 2: Update media header (moov) which involves copying of media
@@ -84,11 +132,147 @@ Status SingleSegmentSegmenter::DoInitialize() {
 }
 
 Status SingleSegmentSegmenter::DoFinalize() {
-  DCHECK(temp_file_);
   DCHECK(ftyp());
   DCHECK(moov());
   DCHECK(vod_sidx_);
 
+  if (child_sidx_)
+    RETURN_IF_ERROR(FinishChildIndex());
+
+  if (output_file_) {
+    if (HeaderFitsInReservedSpace())
+      return FinalizeInReservedSpace();
+    LOG(WARNING) << "The space reserved for the index of '"
+                 << options().output_file_name
+                 << "' is too small. Rewriting the file.";
+    RETURN_IF_ERROR(MoveFragmentsToTempFile());
+  }
+  return FinalizeWithTempFile();
+}
+
+size_t SingleSegmentSegmenter::EstimateHeaderSize() {
+  const double segment_duration = options().segment_duration_in_seconds;
+  // |progress_target| is the duration of the reference stream at this point.
+  const uint64_t media_duration = progress_target();
+  if (segment_duration <= 0 || media_duration == 0 || sidx()->timescale == 0)
+    return 0;
+
+  const double estimated_subsegment_count =
+      static_cast<double>(media_duration) / sidx()->timescale /
+      segment_duration;
+  size_t estimated_reference_count = static_cast<size_t>(
+      std::ceil(estimated_subsegment_count * kSubsegmentCountMarginRatio));
+  // With hierarchical indexing, the 'sidx' box in the header references the
+  // child 'sidx' boxes instead.
+  const uint32_t subsegments_per_child =
+      options().mp4_params.hierarchical_sidx_subsegments;
+  if (subsegments_per_child > 0) {
+    estimated_reference_count =
+        (estimated_reference_count + subsegments_per_child - 1) /
+        subsegments_per_child;
+  }
+  SegmentIndex estimated_sidx;
+  estimated_sidx.references.resize(estimated_reference_count +
+                                   kExtraSubsegmentCount);
+  // Assume 64-bit time and offset fields, i.e. the largest 'sidx'.
+  estimated_sidx.earliest_presentation_time =
+      std::numeric_limits<uint64_t>::max();
+
+  // The 'mehd' box is only populated in Finalize. Assume it has 64-bit fields.
+  const uint64_t fragment_duration = moov()->extends.header.fragment_duration;
+  moov()->extends.header.fragment_duration =
+      std::numeric_limits<uint64_t>::max();
+  const size_t moov_size = moov()->ComputeSize();
+  moov()->extends.header.fragment_duration = fragment_duration;
+
+  return ftyp()->ComputeSize() + moov_size + estimated_sidx.ComputeSize() +
+         kFreeBoxHeaderSize;
+}
+
+bool SingleSegmentSegmenter::HeaderFitsInReservedSpace() {
+  vod_sidx_->first_offset = 0;
+  size_t header_size =
+      ftyp()->ComputeSize() + moov()->ComputeSize() + vod_sidx_->ComputeSize();
+  if (header_size == reserved_header_size_)
+    return true;
+  if (header_size + kFreeBoxHeaderSize > reserved_header_size_)
+    return false;
+
+  // The 'free' box sits between 'sidx' and the first subsegment, which is
+  // signaled with |first_offset|.
+  vod_sidx_->first_offset = reserved_header_size_ - header_size;
+  header_size =
+      ftyp()->ComputeSize() + moov()->ComputeSize() + vod_sidx_->ComputeSize();
+  if (header_size + vod_sidx_->first_offset != reserved_header_size_) {
+    // Changing |first_offset| changed the size of 'sidx'.
+    vod_sidx_->first_offset = 0;
+    return false;
+  }
+  return true;
+}
+
+Status SingleSegmentSegmenter::FinalizeInReservedSpace() {
+  if (!output_file_->Seek(0)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek in file " + options().output_file_name);
+  }
+
+  // Write ftyp, moov, sidx and free box header to the reserved space.
+  std::unique_ptr<BufferWriter> buffer(new BufferWriter());
+  ftyp()->Write(buffer.get());
+  moov()->Write(buffer.get());
+  vod_sidx_->Write(buffer.get());
+  if (vod_sidx_->first_offset > 0) {
+    buffer->AppendInt(static_cast<uint32_t>(vod_sidx_->first_offset));
+    buffer->AppendInt(static_cast<uint32_t>(FOURCC_free));
+  }
+  DCHECK_LE(buffer->Size(), reserved_header_size_);
+  RETURN_IF_ERROR(buffer->WriteToFile(output_file_.get()));
+
+  if (!output_file_.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + options().output_file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+  SetComplete();
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::MoveFragmentsToTempFile() {
+  if (!output_file_.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close file " + options().output_file_name);
+  }
+  std::unique_ptr<File, FileCloser> file(
+      File::Open(options().output_file_name.c_str(), "r"));
+  if (!file || !file->Seek(reserved_header_size_)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to read " + options().output_file_name);
+  }
+
+  if (!TempFilePath(options().temp_dir, &temp_file_name_))
+    return Status(error::FILE_FAILURE, "Unable to create temporary file.");
+  temp_file_.reset(File::Open(temp_file_name_.c_str(), "w"));
+  if (!temp_file_) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to write " + temp_file_name_);
+  }
+  if (File::CopyFile(file.get(), temp_file_.get()) < 0) {
+    return Status(error::FILE_FAILURE,
+                  "Failed to copy fragments to " + temp_file_name_);
+  }
+  if (!file.release()->Close()) {
+    return Status(error::FILE_FAILURE, "Cannot close file " +
+                                           options().output_file_name +
+                                           " after reading.");
+  }
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::FinalizeWithTempFile() {
+  DCHECK(temp_file_);
+
   // Close the temp file to prepare for reading later.
   if (!temp_file_.release()->Close()) {
     return Status(
@@ -198,7 +382,22 @@ Status SingleSegmentSegmenter::DoFinalizeSegment() {
     vod_sidx_->timescale = sidx()->timescale;
     vod_sidx_->earliest_presentation_time = vod_ref.earliest_presentation_time;
   }
-  vod_sidx_->references.push_back(vod_ref);
+  const uint32_t subsegments_per_child =
+      options().mp4_params.hierarchical_sidx_subsegments;
+  size_t segment_size = fragment_buffer_size();
+  if (subsegments_per_child > 0) {
+    if (child_sidx_ && child_sidx_reserved_size_ + child_subsegments_size_ +
+                               segment_size >
+                           kMaxReferencedSize) {
+      RETURN_IF_ERROR(FinishChildIndex());
+    }
+    if (!child_sidx_)
+      RETURN_IF_ERROR(ReserveChildIndex());
+    child_sidx_->references.push_back(vod_ref);
+    child_subsegments_size_ += segment_size;
+  } else {
+    vod_sidx_->references.push_back(vod_ref);
+  }
 
   if (muxer_listener()) {
     for (const KeyFrameInfo& key_frame_info : key_frame_infos()) {
@@ -209,10 +408,20 @@ Status SingleSegmentSegmenter::DoFinalizeSegment() {
                                    key_frame_info.size);
     }
   }
-  // Append fragment buffer to temp file.
-  size_t segment_size = fragment_buffer()->Size();
-  Status status = fragment_buffer()->WriteToFile(temp_file_.get());
+  // Append fragment buffer to the output file or the temp file.
+  Range subsegment_range;
+  subsegment_range.start = media_size_;
+  // Ranges are inclusive, so -1 to the size.
+  subsegment_range.end = media_size_ + segment_size - 1;
+  subsegment_ranges_.push_back(subsegment_range);
+  Status status = WriteFragmentBuffer(media_file());
   if (!status.ok()) return status;
+  media_size_ += segment_size;
+
+  if (child_sidx_ &&
+      child_sidx_->references.size() >= subsegments_per_child) {
+    RETURN_IF_ERROR(FinishChildIndex());
+  }
 
   UpdateProgress(vod_ref.subsegment_duration);
   if (muxer_listener()) {
@@ -224,6 +433,93 @@ Status SingleSegmentSegmenter::DoFinalizeSegment() {
   return Status::OK;
 }
 
+Status SingleSegmentSegmenter::ReserveChildIndex() {
+  DCHECK(!child_sidx_);
+  child_sidx_.reset(new SegmentIndex());
+  child_sidx_->reference_id = sidx()->reference_id;
+  child_sidx_->timescale = sidx()->timescale;
+
+  // Reserve space for the largest child 'sidx' box, i.e. with all the
+  // references and 64-bit time and offset fields.
+  SegmentIndex largest_sidx;
+  largest_sidx.references.resize(
+      options().mp4_params.hierarchical_sidx_subsegments);
+  largest_sidx.earliest_presentation_time =
+      std::numeric_limits<uint64_t>::max();
+  child_sidx_reserved_size_ = largest_sidx.ComputeSize();
+  child_sidx_offset_ = media_size_;
+  child_subsegments_size_ = 0;
+
+  std::unique_ptr<BufferWriter> buffer(new BufferWriter());
+  const std::vector<uint8_t> zeros(child_sidx_reserved_size_, 0);
+  buffer->AppendVector(zeros);
+  RETURN_IF_ERROR(buffer->WriteToFile(media_file()));
+  media_size_ += child_sidx_reserved_size_;
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::FinishChildIndex() {
+  DCHECK(child_sidx_);
+  DCHECK(!child_sidx_->references.empty());
+  std::unique_ptr<SegmentIndex> child_sidx = std::move(child_sidx_);
+
+  const std::vector<SegmentReference>& refs = child_sidx->references;
+  SegmentReference top_ref = refs[0];
+  top_ref.reference_type = true;
+  top_ref.referenced_size = child_sidx_reserved_size_ + child_subsegments_size_;
+  for (size_t i = 1; i < refs.size(); ++i) {
+    top_ref.subsegment_duration += refs[i].subsegment_duration;
+    top_ref.earliest_presentation_time = std::min(
+        top_ref.earliest_presentation_time, refs[i].earliest_presentation_time);
+  }
+  // The SAP fields describe the first subsegment of the child 'sidx' box.
+  if (top_ref.sap_type != SegmentReference::TypeUnknown) {
+    top_ref.sap_delta_time = refs[0].earliest_presentation_time +
+                             refs[0].sap_delta_time -
+                             top_ref.earliest_presentation_time;
+  }
+  child_sidx->earliest_presentation_time = refs[0].earliest_presentation_time;
+
+  // The space not used by the child 'sidx' box becomes a 'free' box between
+  // the child 'sidx' box and its first subsegment, which is signaled with
+  // |first_offset|. The space is a multiple of the size of a reference plus
+  // possibly the size of the 64-bit fields, so it is large enough for a 'free'
+  // box.
+  const size_t child_sidx_size = child_sidx->ComputeSize();
+  DCHECK_LE(child_sidx_size, child_sidx_reserved_size_);
+  child_sidx->first_offset = child_sidx_reserved_size_ - child_sidx_size;
+  DCHECK_EQ(child_sidx_size, child_sidx->ComputeSize());
+  DCHECK(child_sidx->first_offset == 0 ||
+         child_sidx->first_offset >= kFreeBoxHeaderSize);
+
+  std::unique_ptr<BufferWriter> buffer(new BufferWriter());
+  child_sidx->Write(buffer.get());
+  if (child_sidx->first_offset > 0) {
+    buffer->AppendInt(static_cast<uint32_t>(child_sidx->first_offset));
+    buffer->AppendInt(static_cast<uint32_t>(FOURCC_free));
+  }
+
+  // The fragments in |output_file_| follow the space reserved for the header.
+  const uint64_t media_start = output_file_ ? reserved_header_size_ : 0;
+  File* file = media_file();
+  const std::string& file_name =
+      output_file_ ? options().output_file_name : temp_file_name_;
+  if (!file->Seek(media_start + child_sidx_offset_))
+    return Status(error::FILE_FAILURE, "Cannot seek in file " + file_name);
+  RETURN_IF_ERROR(buffer->WriteToFile(file));
+  if (!file->Seek(media_start + media_size_))
+    return Status(error::FILE_FAILURE, "Cannot seek in file " + file_name);
+
+  vod_sidx_->references.push_back(top_ref);
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::DoFinalizeChunk() {
+  // The chunks stay in the fragment buffer until the end of the segment, as
+  // the fragments are referenced from the index of the single output file.
+  return Status::OK;
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
@@ -26,6 +26,15 @@ namespace mp4 {
 /// overall subsegment/fragment duration not smaller than defined duration and
 /// yet meet SAP requirements. SingleSegmentSegmenter ignores @b
 /// MuxerOptions.mp4_params.generate_sidx_in_media_segments.
+/// With @b MuxerOptions.mp4_params.single_pass_single_segment, space for the
+/// 'moov' and 'sidx' boxes is reserved at the start of the output file and the
+/// fragments are written to the output file directly; otherwise the fragments
+/// are written to a temporary file and copied to the output file after the
+/// 'sidx' box is known.
+/// With @b MuxerOptions.mp4_params.hierarchical_sidx_subsegments, the
+/// subsegments are indexed by child 'sidx' boxes, each written in front of the
+/// subsegments it indexes once they are complete, and the 'sidx' box after
+/// 'moov' references the child 'sidx' boxes instead of the subsegments.
 class SingleSegmentSegmenter : public Segmenter {
  public:
   SingleSegmentSegmenter(const MuxerOptions& options,
@@ -45,10 +54,47 @@ class SingleSegmentSegmenter : public Segmenter {
   Status DoInitialize() override;
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
+  Status DoFinalizeChunk() override;
+
+  // Estimate the size of the ftyp, moov and sidx boxes of the final file.
+  // Returns 0 if the size cannot be estimated.
+  size_t EstimateHeaderSize();
+  // Returns true if the header fits in the space reserved at the start of
+  // |output_file_|, with the slack, if any, large enough for a 'free' box.
+  bool HeaderFitsInReservedSpace();
+  // Write the header to the space reserved at the start of |output_file_|.
+  Status FinalizeInReservedSpace();
+  // Move the fragments written to |output_file_| to a temporary file, so the
+  // output can be finalized as if a temporary file had been used all along.
+  Status MoveFragmentsToTempFile();
+  Status FinalizeWithTempFile();
+  // Returns the file the fragments are written to.
+  File* media_file() {
+    return output_file_ ? output_file_.get() : temp_file_.get();
+  }
+  // Reserve space for a child 'sidx' box in front of the next subsegments.
+  Status ReserveChildIndex();
+  // Write the child 'sidx' box to the space reserved for it and reference it
+  // from |vod_sidx_|.
+  Status FinishChildIndex();
 
   std::unique_ptr<SegmentIndex> vod_sidx_;
+  // Output file being written in a single pass, or NULL if the fragments are
+  // written to |temp_file_|.
+  std::unique_ptr<File, FileCloser> output_file_;
+  size_t reserved_header_size_ = 0;
   std::string temp_file_name_;
   std::unique_ptr<File, FileCloser> temp_file_;
+  // Size of the fragments and child 'sidx' boxes written so far.
+  uint64_t media_size_ = 0;
+  // Ranges of the subsegments, relative to the first byte after the header.
+  std::vector<Range> subsegment_ranges_;
+  // The child 'sidx' box being populated, if any, with the offset and the size
+  // of the space reserved for it, and the size of the subsegments it indexes.
+  std::unique_ptr<SegmentIndex> child_sidx_;
+  uint64_t child_sidx_offset_ = 0;
+  size_t child_sidx_reserved_size_ = 0;
+  uint64_t child_subsegments_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(SingleSegmentSegmenter);
 };
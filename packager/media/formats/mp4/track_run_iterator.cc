@@ -13,10 +13,12 @@ DEFINE_bool(mp4_reset_initial_composition_offset_to_zero,
 
 #include <algorithm>
 #include <limits>
+#include <set>
 
 #include "packager/media/base/buffer_reader.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/rcheck.h"
+#include "packager/media/base/timestamp_rescaler.h"
 #include "packager/media/formats/mp4/chunk_info_iterator.h"
 #include "packager/media/formats/mp4/composition_offset_iterator.h"
 #include "packager/media/formats/mp4/decoding_time_iterator.h"
@@ -24,13 +26,6 @@ DEFINE_bool(mp4_reset_initial_composition_offset_to_zero,
 
 namespace {
 const int64_t kInvalidOffset = std::numeric_limits<int64_t>::max();
-
-int64_t Rescale(int64_t time_in_old_scale,
-                uint32_t old_scale,
-                uint32_t new_scale) {
-  return (static_cast<double>(time_in_old_scale) / old_scale) * new_scale;
-}
-
 }  // namespace
 
 namespace shaka {
@@ -44,9 +39,81 @@ struct SampleInfo {
   bool is_keyframe;
 };
 
+// Decodes the sample information of a track of a non-fragmented mp4 from its
+// sample tables, one sample at a time.
+class SampleTableReader {
+ public:
+  SampleTableReader(const SampleTable& sample_table, int64_t start_dts)
+      : sample_size_(sample_table.sample_size),
+        decoding_time_(sample_table.decoding_time_to_sample),
+        composition_offset_(sample_table.composition_time_to_sample),
+        has_composition_offset_(composition_offset_.IsValid()),
+        sync_sample_(sample_table.sync_sample),
+        sample_index_(0),
+        dts_(start_dts) {
+    LoadSample();
+  }
+
+  // Skip forward to |sample_index|, 0-based.
+  void SkipTo(uint32_t sample_index) {
+    DCHECK_GE(sample_index, sample_index_);
+    while (sample_index_ < sample_index)
+      Advance();
+  }
+
+  void Advance() {
+    DCHECK_LT(sample_index_, sample_size_.sample_count);
+    dts_ += sample_.duration;
+    ++sample_index_;
+    decoding_time_.AdvanceSample();
+    if (has_composition_offset_)
+      composition_offset_.AdvanceSample();
+    sync_sample_.AdvanceSample();
+    LoadSample();
+  }
+
+  uint32_t sample_index() const { return sample_index_; }
+  // The decoding timestamp of the current sample.
+  int64_t dts() const { return dts_; }
+  const SampleInfo& sample() const { return sample_; }
+
+ private:
+  SampleTableReader(const SampleTableReader&) = delete;
+  SampleTableReader& operator=(const SampleTableReader&) = delete;
+
+  void LoadSample() {
+    // The table sizes are verified in Init().
+    if (sample_index_ >= sample_size_.sample_count)
+      return;
+    sample_.size = sample_size_.sample_size != 0
+                       ? sample_size_.sample_size
+                       : sample_size_.sizes[sample_index_];
+    sample_.duration = decoding_time_.sample_delta();
+    sample_.cts_offset =
+        has_composition_offset_ ? composition_offset_.sample_offset() : 0;
+    sample_.is_keyframe = sync_sample_.IsSyncSample();
+  }
+
+  const SampleSize& sample_size_;
+  DecodingTimeIterator decoding_time_;
+  CompositionOffsetIterator composition_offset_;
+  const bool has_composition_offset_;
+  SyncSampleIterator sync_sample_;
+  uint32_t sample_index_;
+  int64_t dts_;
+  SampleInfo sample_;
+};
+
 struct TrackRunInfo {
   uint32_t track_id;
+  // Empty if the samples are decoded by |sample_table_reader|.
   std::vector<SampleInfo> samples;
+  uint32_t sample_count;
+  // Set for the runs of non-fragmented mp4, i.e. chunks.
+  SampleTableReader* sample_table_reader;
+  // The index of the first sample of the run in the track, and of the chunk.
+  uint32_t first_sample_index;
+  uint32_t chunk_index;
   int64_t timescale;
   int64_t start_dts;
   int64_t sample_start_offset;
@@ -72,6 +139,10 @@ struct TrackRunInfo {
 
 TrackRunInfo::TrackRunInfo()
     : track_id(0),
+      sample_count(0),
+      sample_table_reader(nullptr),
+      first_sample_index(0),
+      chunk_index(0),
       timescale(-1),
       start_dts(-1),
       sample_start_offset(-1),
@@ -84,7 +155,7 @@ TrackRunInfo::TrackRunInfo()
 TrackRunInfo::~TrackRunInfo() {}
 
 TrackRunIterator::TrackRunIterator(const Movie* moov)
-    : moov_(moov), sample_dts_(0), sample_offset_(0) {
+    : moov_(moov), sample_index_(0), sample_dts_(0), sample_offset_(0) {
   CHECK(moov);
 }
 
@@ -158,48 +229,38 @@ class CompareMinTrackRunDataOffset {
 
 bool TrackRunIterator::Init() {
   runs_.clear();
+  sample_table_readers_.clear();
 
   for (std::vector<Track>::const_iterator trak = moov_->tracks.begin();
        trak != moov_->tracks.end(); ++trak) {
-    const SampleDescription& stsd =
-        trak->media.information.sample_table.description;
+    const SampleTable& sample_table = trak->media.information.sample_table;
+    const SampleDescription& stsd = sample_table.description;
     if (stsd.type != kAudio && stsd.type != kVideo) {
       DVLOG(1) << "Skipping unhandled track type";
       continue;
     }
 
-    DecodingTimeIterator decoding_time(
-        trak->media.information.sample_table.decoding_time_to_sample);
+    DecodingTimeIterator decoding_time(sample_table.decoding_time_to_sample);
     CompositionOffsetIterator composition_offset(
-        trak->media.information.sample_table.composition_time_to_sample);
-    bool has_composition_offset = composition_offset.IsValid();
-    ChunkInfoIterator chunk_info(
-        trak->media.information.sample_table.sample_to_chunk);
-    SyncSampleIterator sync_sample(
-        trak->media.information.sample_table.sync_sample);
+        sample_table.composition_time_to_sample);
+    ChunkInfoIterator chunk_info(sample_table.sample_to_chunk);
     // Skip processing saiz and saio boxes for non-fragmented mp4 as we
     // don't support encrypted non-fragmented mp4.
 
-    const SampleSize& sample_size =
-        trak->media.information.sample_table.sample_size;
+    const SampleSize& sample_size = sample_table.sample_size;
     const std::vector<uint64_t>& chunk_offset_vector =
-        trak->media.information.sample_table.chunk_large_offset.offsets;
-
-    // dts is directly adjusted, which then propagates to pts as pts is encoded
-    // as difference (composition offset) to dts in mp4.
-    int64_t run_start_dts = GetTimestampAdjustment(*moov_, *trak, nullptr);
+        sample_table.chunk_large_offset.offsets;
 
     uint32_t num_samples = sample_size.sample_count;
     uint32_t num_chunks = static_cast<uint32_t>(chunk_offset_vector.size());
 
-    // Check that total number of samples match.
-    DCHECK_EQ(num_samples, decoding_time.NumSamples());
-    if (has_composition_offset) {
-      DCHECK_EQ(num_samples, composition_offset.NumSamples());
-    }
-    if (num_chunks > 0) {
-      DCHECK_EQ(num_samples, chunk_info.NumSamples(1, num_chunks));
-    }
+    // Check that total number of samples match, since the samples are only
+    // decoded while iterating.
+    RCHECK(decoding_time.NumSamples() == num_samples);
+    if (composition_offset.IsValid())
+      RCHECK(composition_offset.NumSamples() == num_samples);
+    if (sample_size.sample_size == 0)
+      RCHECK(sample_size.sizes.size() >= num_samples);
     DCHECK_GE(num_chunks, chunk_info.LastFirstChunk());
 
     if (num_samples > 0) {
@@ -208,6 +269,12 @@ bool TrackRunIterator::Init() {
       RCHECK(chunk_info.IsValid());
     }
 
+    // dts is directly adjusted, which then propagates to pts as pts is encoded
+    // as difference (composition offset) to dts in mp4.
+    sample_table_readers_.emplace_back(new SampleTableReader(
+        sample_table, GetTimestampAdjustment(*moov_, *trak, nullptr)));
+    SampleTableReader* reader = sample_table_readers_.back().get();
+
     uint32_t sample_index = 0;
     for (uint32_t chunk_index = 0; chunk_index < num_chunks; ++chunk_index) {
       RCHECK(chunk_info.current_chunk() == chunk_index + 1);
@@ -215,8 +282,10 @@ bool TrackRunIterator::Init() {
       TrackRunInfo tri;
       tri.track_id = trak->header.track_id;
       tri.timescale = trak->media.header.timescale;
-      tri.start_dts = run_start_dts;
       tri.sample_start_offset = chunk_offset_vector[chunk_index];
+      tri.sample_table_reader = reader;
+      tri.first_sample_index = sample_index;
+      tri.chunk_index = chunk_index;
 
       uint32_t desc_idx = chunk_info.sample_description_index();
       RCHECK(desc_idx > 0);  // Descriptions are one-indexed in the file.
@@ -241,46 +310,59 @@ bool TrackRunIterator::Init() {
                    .default_is_protected == 0);
       }
 
-      uint32_t samples_per_chunk = chunk_info.samples_per_chunk();
-      tri.samples.resize(samples_per_chunk);
-      for (uint32_t k = 0; k < samples_per_chunk; ++k) {
-        SampleInfo& sample = tri.samples[k];
-        sample.size = sample_size.sample_size != 0
-                          ? sample_size.sample_size
-                          : sample_size.sizes[sample_index];
-        sample.duration = decoding_time.sample_delta();
-        sample.cts_offset =
-            has_composition_offset ? composition_offset.sample_offset() : 0;
-        sample.is_keyframe = sync_sample.IsSyncSample();
-
-        run_start_dts += sample.duration;
-
-        // Advance to next sample. Should success except for last sample.
-        ++sample_index;
-        RCHECK(chunk_info.AdvanceSample() && sync_sample.AdvanceSample());
-        if (sample_index == num_samples) {
-          // We should hit end of tables for decoding time and composition
-          // offset.
-          RCHECK(!decoding_time.AdvanceSample());
-          if (has_composition_offset)
-            RCHECK(!composition_offset.AdvanceSample());
-        } else {
-          RCHECK(decoding_time.AdvanceSample());
-          if (has_composition_offset)
-            RCHECK(composition_offset.AdvanceSample());
-        }
-      }
+      tri.sample_count = chunk_info.samples_per_chunk();
+      sample_index += tri.sample_count;
+      RCHECK(sample_index <= num_samples);
+      chunk_info.AdvanceChunk();
 
       runs_.push_back(tri);
     }
+    RCHECK(sample_index == num_samples);
   }
 
   std::sort(runs_.begin(), runs_.end(), CompareMinTrackRunDataOffset());
+
+  // The readers only go forward, so the runs of a track have to be visited in
+  // chunk order, which is the case unless the chunks are out of order in the
+  // file.
+  std::map<SampleTableReader*, uint32_t> next_chunk_indices;
+  std::set<SampleTableReader*> unordered_readers;
+  for (const TrackRunInfo& run : runs_) {
+    uint32_t& next_chunk_index = next_chunk_indices[run.sample_table_reader];
+    if (run.chunk_index < next_chunk_index)
+      unordered_readers.insert(run.sample_table_reader);
+    next_chunk_index = run.chunk_index + 1;
+  }
+  for (SampleTableReader* reader : unordered_readers)
+    DecodeSamples(reader);
+
   run_itr_ = runs_.begin();
   ResetRun();
   return true;
 }
 
+void TrackRunIterator::DecodeSamples(SampleTableReader* reader) {
+  DVLOG(1) << "Chunks out of order. Decoding the samples upfront.";
+  std::vector<TrackRunInfo*> runs;
+  for (TrackRunInfo& run : runs_) {
+    if (run.sample_table_reader == reader)
+      runs.push_back(&run);
+  }
+  std::sort(runs.begin(), runs.end(),
+            [](const TrackRunInfo* a, const TrackRunInfo* b) {
+              return a->chunk_index < b->chunk_index;
+            });
+  for (TrackRunInfo* run : runs) {
+    run->start_dts = reader->dts();
+    run->samples.reserve(run->sample_count);
+    for (uint32_t i = 0; i < run->sample_count; ++i) {
+      run->samples.push_back(reader->sample());
+      reader->Advance();
+    }
+    run->sample_table_reader = nullptr;
+  }
+}
+
 bool TrackRunIterator::Init(const MovieFragment& moof) {
   runs_.clear();
 
@@ -418,6 +500,7 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
         }
       }
 
+      tri.sample_count = trun.sample_count;
       tri.samples.resize(trun.sample_count);
       for (size_t k = 0; k < trun.sample_count; k++) {
         PopulateSampleInfo(*trex, traf.header, trun, k, &tri.samples[k]);
@@ -443,16 +526,32 @@ void TrackRunIterator::AdvanceRun() {
 void TrackRunIterator::ResetRun() {
   if (!IsRunValid())
     return;
-  sample_dts_ = run_itr_->start_dts;
   sample_offset_ = run_itr_->sample_start_offset;
-  sample_itr_ = run_itr_->samples.begin();
+  sample_index_ = 0;
+  SampleTableReader* reader = run_itr_->sample_table_reader;
+  if (reader) {
+    // The samples of the runs skipped, if any, are skipped too.
+    reader->SkipTo(run_itr_->first_sample_index);
+    sample_dts_ = reader->dts();
+  } else {
+    sample_dts_ = run_itr_->start_dts;
+  }
 }
 
 void TrackRunIterator::AdvanceSample() {
   DCHECK(IsSampleValid());
-  sample_dts_ += sample_itr_->duration;
-  sample_offset_ += sample_itr_->size;
-  ++sample_itr_;
+  sample_dts_ += sample_info().duration;
+  sample_offset_ += sample_info().size;
+  ++sample_index_;
+  if (run_itr_->sample_table_reader)
+    run_itr_->sample_table_reader->Advance();
+}
+
+const SampleInfo& TrackRunIterator::sample_info() const {
+  DCHECK(IsSampleValid());
+  if (run_itr_->sample_table_reader)
+    return run_itr_->sample_table_reader->sample();
+  return run_itr_->samples[sample_index_];
 }
 
 // This implementation only indicates a need for caching if CENC auxiliary
@@ -469,9 +568,9 @@ bool TrackRunIterator::CacheAuxInfo(const uint8_t* buf, int buf_size) {
 
   std::vector<SampleEncryptionEntry>& sample_encryption_entries =
       runs_[run_itr_ - runs_.begin()].sample_encryption_entries;
-  sample_encryption_entries.resize(run_itr_->samples.size());
+  sample_encryption_entries.resize(run_itr_->sample_count);
   int64_t pos = 0;
-  for (size_t i = 0; i < run_itr_->samples.size(); i++) {
+  for (size_t i = 0; i < run_itr_->sample_count; i++) {
     int info_size = run_itr_->aux_info_default_size;
     if (!info_size)
       info_size = run_itr_->aux_info_sizes[i];
@@ -491,7 +590,7 @@ bool TrackRunIterator::CacheAuxInfo(const uint8_t* buf, int buf_size) {
 bool TrackRunIterator::IsRunValid() const { return run_itr_ != runs_.end(); }
 
 bool TrackRunIterator::IsSampleValid() const {
-  return IsRunValid() && (sample_itr_ != run_itr_->samples.end());
+  return IsRunValid() && (sample_index_ < run_itr_->sample_count);
 }
 
 // Because tracks are in sorted order and auxiliary information is cached when
@@ -568,7 +667,7 @@ int64_t TrackRunIterator::sample_offset() const {
 
 int TrackRunIterator::sample_size() const {
   DCHECK(IsSampleValid());
-  return sample_itr_->size;
+  return sample_info().size;
 }
 
 int64_t TrackRunIterator::dts() const {
@@ -578,17 +677,17 @@ int64_t TrackRunIterator::dts() const {
 
 int64_t TrackRunIterator::cts() const {
   DCHECK(IsSampleValid());
-  return sample_dts_ + sample_itr_->cts_offset;
+  return sample_dts_ + sample_info().cts_offset;
 }
 
 int64_t TrackRunIterator::duration() const {
   DCHECK(IsSampleValid());
-  return sample_itr_->duration;
+  return sample_info().duration;
 }
 
 bool TrackRunIterator::is_keyframe() const {
   DCHECK(IsSampleValid());
-  return sample_itr_->is_keyframe;
+  return sample_info().is_keyframe;
 }
 
 const TrackEncryption& TrackRunIterator::track_encryption() const {
@@ -602,7 +701,7 @@ std::unique_ptr<DecryptConfig> TrackRunIterator::GetDecryptConfig() {
   std::vector<uint8_t> iv;
   std::vector<SubsampleEntry> subsamples;
 
-  size_t sample_idx = sample_itr_ - run_itr_->samples.begin();
+  size_t sample_idx = sample_index_;
   if (sample_idx < run_itr_->sample_encryption_entries.size()) {
     const SampleEncryptionEntry& sample_encryption_entry =
         run_itr_->sample_encryption_entries[sample_idx];
@@ -662,8 +761,9 @@ int64_t TrackRunIterator::GetTimestampAdjustment(const Movie& movie,
         // This is an empty edit. |segment_duration| is in movie's timescale
         // instead of track's timescale.
         const int64_t scaled_time =
-            Rescale(edit.segment_duration, movie.header.timescale,
-                    track.media.header.timescale);
+            TimestampRescaler(movie.header.timescale,
+                              track.media.header.timescale)
+                .Rescale(edit.segment_duration);
         timestamp_adjustment += scaled_time;
       } else {
         timestamp_adjustment -= edit.media_time;
@@ -18,6 +18,7 @@ class DecryptConfig;
 
 namespace mp4 {
 
+class SampleTableReader;
 struct SampleInfo;
 struct TrackRunInfo;
 
@@ -29,7 +30,9 @@ class TrackRunIterator {
   ~TrackRunIterator();
 
   /// For non-fragmented mp4, moov contains all the chunk information; This
-  /// function sets up the iterator to access all the chunks.
+  /// function sets up the iterator to access all the chunks. The sample
+  /// information is decoded from the sample tables while iterating, so the
+  /// memory used does not grow with the number of samples.
   /// For fragmented mp4, chunk and sample information are generally contained
   /// in moof. This function is a no-op in this case. Init(moof) will be called
   /// later after parsing moof.
@@ -103,6 +106,10 @@ class TrackRunIterator {
 
  private:
   void ResetRun();
+  const SampleInfo& sample_info() const;
+  // Decode the samples of the runs of |reader| upfront, in chunk order, for
+  // tracks whose runs are not visited in chunk order.
+  void DecodeSamples(SampleTableReader* reader);
   const TrackEncryption& track_encryption() const;
   int64_t GetTimestampAdjustment(const Movie& movie,
                                  const Track& track,
@@ -112,7 +119,10 @@ class TrackRunIterator {
 
   std::vector<TrackRunInfo> runs_;
   std::vector<TrackRunInfo>::const_iterator run_itr_;
-  std::vector<SampleInfo>::const_iterator sample_itr_;
+  // Index of the current sample in the current run.
+  uint32_t sample_index_;
+  // The sample table readers of the tracks of a non-fragmented mp4.
+  std::vector<std::unique_ptr<SampleTableReader>> sample_table_readers_;
 
   // Track the start dts of the next segment, only useful if decode_time box is
   // absent.
@@ -142,6 +142,29 @@ class TrackRunIteratorTest : public testing::Test {
     moov_.tracks[2].media.information.sample_table.description.type = kHint;
   }
 
+  // Sets up the sample tables of a non-fragmented mp4:
+  //  - audio: 4 samples in 2 chunks at |audio_chunk_offsets|.
+  //  - video: 3 samples in 1 chunk at offset 500, only the first one is a sync
+  //    sample.
+  void CreateSampleTables(const std::vector<uint64_t>& audio_chunk_offsets) {
+    SampleTable& audio_table = moov_.tracks[0].media.information.sample_table;
+    audio_table.decoding_time_to_sample.decoding_time.push_back({4, 1024});
+    audio_table.sample_to_chunk.chunk_info.push_back({1, 2, 1});
+    audio_table.sample_size.sample_count = 4;
+    audio_table.sample_size.sizes = {10, 20, 30, 40};
+    audio_table.chunk_large_offset.offsets = audio_chunk_offsets;
+
+    SampleTable& video_table = moov_.tracks[1].media.information.sample_table;
+    video_table.decoding_time_to_sample.decoding_time.push_back({3, 1});
+    video_table.composition_time_to_sample.composition_offset = {
+        {1, 0}, {1, 2}, {1, 0}};
+    video_table.sample_to_chunk.chunk_info.push_back({1, 3, 1});
+    video_table.sample_size.sample_size = 5;
+    video_table.sample_size.sample_count = 3;
+    video_table.chunk_large_offset.offsets = {500};
+    video_table.sync_sample.sample_number = {1};
+  }
+
   MovieFragment CreateFragment() {
     MovieFragment moof;
     moof.tracks.resize(2);
@@ -295,6 +318,91 @@ TEST_F(TrackRunIteratorTest, NoRunsTest) {
   EXPECT_FALSE(iter_->IsSampleValid());
 }
 
+TEST_F(TrackRunIteratorTest, NonFragmentedTest) {
+  CreateSampleTables({100, 1000});
+  iter_.reset(new TrackRunIterator(&moov_));
+  ASSERT_TRUE(iter_->Init());
+
+  EXPECT_EQ(1u, iter_->track_id());
+  EXPECT_EQ(100, iter_->sample_offset());
+  EXPECT_EQ(10, iter_->sample_size());
+  EXPECT_EQ(0, iter_->dts());
+  iter_->AdvanceSample();
+  EXPECT_EQ(110, iter_->sample_offset());
+  EXPECT_EQ(20, iter_->sample_size());
+  EXPECT_EQ(1024, iter_->dts());
+  iter_->AdvanceSample();
+  EXPECT_FALSE(iter_->IsSampleValid());
+
+  iter_->AdvanceRun();
+  EXPECT_EQ(2u, iter_->track_id());
+  const int64_t kExpectedCts[] = {0, 3, 2};
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(iter_->IsSampleValid());
+    EXPECT_EQ(500 + 5 * i, iter_->sample_offset());
+    EXPECT_EQ(5, iter_->sample_size());
+    EXPECT_EQ(i, iter_->dts());
+    EXPECT_EQ(kExpectedCts[i], iter_->cts());
+    EXPECT_EQ(i == 0, iter_->is_keyframe());
+    iter_->AdvanceSample();
+  }
+  EXPECT_FALSE(iter_->IsSampleValid());
+
+  iter_->AdvanceRun();
+  EXPECT_EQ(1u, iter_->track_id());
+  EXPECT_EQ(1000, iter_->sample_offset());
+  EXPECT_EQ(30, iter_->sample_size());
+  EXPECT_EQ(2048, iter_->dts());
+  EXPECT_EQ(1024, iter_->duration());
+  iter_->AdvanceSample();
+  EXPECT_EQ(1030, iter_->sample_offset());
+  EXPECT_EQ(40, iter_->sample_size());
+  EXPECT_EQ(3072, iter_->dts());
+  iter_->AdvanceRun();
+  EXPECT_FALSE(iter_->IsRunValid());
+}
+
+TEST_F(TrackRunIteratorTest, NonFragmentedSkippedRunTest) {
+  CreateSampleTables({100, 1000});
+  iter_.reset(new TrackRunIterator(&moov_));
+  ASSERT_TRUE(iter_->Init());
+
+  // The samples of a run which is not read are skipped.
+  iter_->AdvanceRun();
+  iter_->AdvanceRun();
+  EXPECT_EQ(1u, iter_->track_id());
+  EXPECT_EQ(30, iter_->sample_size());
+  EXPECT_EQ(2048, iter_->dts());
+}
+
+TEST_F(TrackRunIteratorTest, NonFragmentedChunksOutOfOrderTest) {
+  CreateSampleTables({1000, 100});
+  iter_.reset(new TrackRunIterator(&moov_));
+  ASSERT_TRUE(iter_->Init());
+
+  // The second chunk comes first in the file.
+  EXPECT_EQ(1u, iter_->track_id());
+  EXPECT_EQ(100, iter_->sample_offset());
+  EXPECT_EQ(30, iter_->sample_size());
+  EXPECT_EQ(2048, iter_->dts());
+  iter_->AdvanceRun();
+  EXPECT_EQ(2u, iter_->track_id());
+  iter_->AdvanceRun();
+  EXPECT_EQ(1u, iter_->track_id());
+  EXPECT_EQ(1000, iter_->sample_offset());
+  EXPECT_EQ(10, iter_->sample_size());
+  EXPECT_EQ(0, iter_->dts());
+}
+
+TEST_F(TrackRunIteratorTest, NonFragmentedSampleCountMismatchTest) {
+  CreateSampleTables({100, 1000});
+  moov_.tracks[0]
+      .media.information.sample_table.decoding_time_to_sample.decoding_time[0]
+      .sample_count = 5;
+  iter_.reset(new TrackRunIterator(&moov_));
+  EXPECT_FALSE(iter_->Init());
+}
+
 TEST_F(TrackRunIteratorTest, BasicOperationTest) {
   iter_.reset(new TrackRunIterator(&moov_));
   MovieFragment moof = CreateFragment();
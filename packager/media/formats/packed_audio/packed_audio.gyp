@@ -19,6 +19,7 @@
         'packed_audio_writer.h',
       ],
       'dependencies': [
+        '../../../metrics/metrics.gyp:metrics',
         '../../base/media_base.gyp:media_base',
         '../../codecs/codecs.gyp:codecs',
       ],
@@ -17,16 +17,19 @@
 namespace shaka {
 namespace media {
 namespace {
-std::string TimestampToString(uint64_t timestamp) {
-  // https://tools.ietf.org/html/rfc8216 The ID3 payload MUST be a 33-bit MPEG-2
-  // Program Elementary Stream timestamp expressed as a big-endian eight-octet
-  // number, with the upper 31 bits set to zero.
-  timestamp &= 0x1FFFFFFFFull;
-
-  BufferWriter buffer;
-  buffer.AppendInt(timestamp);
-  return std::string(buffer.Buffer(), buffer.Buffer() + buffer.Size());
-}
+// https://tools.ietf.org/html/rfc8216 The ID3 payload MUST be a 33-bit MPEG-2
+// Program Elementary Stream timestamp expressed as a big-endian eight-octet
+// number, with the upper 31 bits set to zero.
+const size_t kTimestampSize = 8;
+const uint64_t kTimestampMask = 0x1FFFFFFFFull;
+
+// The timestamp is the data of the first private frame of the ID3 tag, which
+// follows the ID3v2 header, the frame header and the owner identifier with
+// its null terminator.
+const size_t kId3v2HeaderSize = 10;
+const size_t kId3v2FrameHeaderSize = 10;
+const size_t kTimestampOffset = kId3v2HeaderSize + kId3v2FrameHeaderSize +
+                                sizeof(kTimestampOwnerIdentifier);
 }  // namespace
 
 PackedAudioSegmenter::PackedAudioSegmenter(
@@ -46,6 +49,8 @@ Status PackedAudioSegmenter::Initialize(const StreamInfo& stream_info) {
   codec_ = stream_info.codec();
   audio_codec_config_ = stream_info.codec_config();
   timescale_scale_ = kPackedAudioTimescale / stream_info.time_scale();
+  to_packed_audio_timescale_ = TimestampRescaler(
+      stream_info.time_scale(), static_cast<uint32_t>(kPackedAudioTimescale));
 
   if (codec_ == kCodecAAC) {
     adts_converter_ = CreateAdtsConverter();
@@ -67,14 +72,12 @@ Status PackedAudioSegmenter::AddSample(const MediaSample& sample) {
   }
 
   if (adts_converter_) {
-    std::vector<uint8_t> audio_frame;
-    if (!adts_converter_->ConvertToADTS(sample.data(), sample.data_size(),
-                                        &audio_frame))
+    uint8_t adts_header[AACAudioSpecificConfig::kADTSHeaderSize];
+    if (!adts_converter_->WriteADTSHeader(sample.data_size(), adts_header))
       return Status(error::MUXER_FAILURE, "Failed to convert to ADTS.");
-    segment_buffer_.AppendArray(audio_frame.data(), audio_frame.size());
-  } else {
-    segment_buffer_.AppendArray(sample.data(), sample.data_size());
+    segment_buffer_.AppendArray(adts_header, sizeof(adts_header));
   }
+  segment_buffer_.AppendArray(sample.data(), sample.data_size());
   return Status::OK;
 }
 
@@ -123,14 +126,16 @@ Status PackedAudioSegmenter::EncryptionAudioSetup(const MediaSample& sample) {
   }
   audio_setup_information_.assign(buffer.Buffer(),
                                   buffer.Buffer() + buffer.Size());
+  // The audio setup information goes in the ID3 tag.
+  id3_tag_template_.clear();
   return Status::OK;
 }
 
 Status PackedAudioSegmenter::StartNewSegment(const MediaSample& sample) {
   segment_buffer_.Clear();
 
-  const int64_t pts =
-      sample.pts() * timescale_scale_ + transport_stream_timestamp_offset_;
+  const int64_t pts = to_packed_audio_timescale_.Rescale(sample.pts()) +
+                      transport_stream_timestamp_offset_;
   if (pts < 0) {
     LOG(ERROR) << "Seeing negative timestamp " << pts
                << " after applying offset "
@@ -140,14 +145,21 @@ Status PackedAudioSegmenter::StartNewSegment(const MediaSample& sample) {
     return Status(error::MUXER_FAILURE, "Unsupported negative timestamp.");
   }
 
-  // Use a unique_ptr so it can be mocked for testing.
-  std::unique_ptr<Id3Tag> id3_tag = CreateId3Tag();
-  id3_tag->AddPrivateFrame(kTimestampOwnerIdentifier, TimestampToString(pts));
-  if (!audio_setup_information_.empty()) {
-    id3_tag->AddPrivateFrame(kAudioDescriptionOwnerIdentifier,
-                             audio_setup_information_);
+  if (id3_tag_template_.empty()) {
+    // Use a unique_ptr so it can be mocked for testing.
+    std::unique_ptr<Id3Tag> id3_tag = CreateId3Tag();
+    id3_tag->AddPrivateFrame(kTimestampOwnerIdentifier,
+                             std::string(kTimestampSize, '\0'));
+    if (!audio_setup_information_.empty()) {
+      id3_tag->AddPrivateFrame(kAudioDescriptionOwnerIdentifier,
+                               audio_setup_information_);
+    }
+    CHECK(id3_tag->WriteToVector(&id3_tag_template_));
+    CHECK_GE(id3_tag_template_.size(), kTimestampOffset + kTimestampSize);
   }
-  CHECK(id3_tag->WriteToBuffer(&segment_buffer_));
+  segment_buffer_.AppendVector(id3_tag_template_);
+  segment_buffer_.OverwriteNBytes(kTimestampOffset, pts & kTimestampMask,
+                                  kTimestampSize);
 
   return Status::OK;
 }
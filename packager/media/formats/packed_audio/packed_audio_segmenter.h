@@ -8,9 +8,11 @@
 #define PACKAGER_MEDIA_FORMATS_PACKED_AUDIO_PACKED_AUDIO_SEGMENTER_H_
 
 #include <memory>
+#include <vector>
 
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/base/timestamp_rescaler.h"
 #include "packager/status.h"
 
 namespace shaka {
@@ -88,6 +90,9 @@ class PackedAudioSegmenter {
   // Calculated by output stream's timescale / input stream's timescale. This is
   // used to scale the timestamps.
   double timescale_scale_ = 0.0;
+  // Converts the timestamps of the input stream exactly, unlike
+  // |timescale_scale_|.
+  TimestampRescaler to_packed_audio_timescale_;
   // Whether it is the start of a new segment.
   bool start_of_new_segment_ = true;
 
@@ -95,6 +100,9 @@ class PackedAudioSegmenter {
   std::string audio_setup_information_;
   // AAC is carried in ADTS.
   std::unique_ptr<AACAudioSpecificConfig> adts_converter_;
+  // The ID3 tag at the start of every segment, built once, with the timestamp
+  // patched in for each segment.
+  std::vector<uint8_t> id3_tag_template_;
 
   BufferWriter segment_buffer_;
 };
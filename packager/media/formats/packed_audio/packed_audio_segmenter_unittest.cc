@@ -9,6 +9,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <cstring>
+
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/id3_tag.h"
 #include "packager/media/base/media_sample.h"
@@ -17,11 +19,9 @@
 
 using ::testing::_;
 using ::testing::ByMove;
-using ::testing::DoAll;
 using ::testing::ElementsAreArray;
 using ::testing::Invoke;
 using ::testing::Return;
-using ::testing::SetArgPointee;
 using ::testing::Test;
 
 namespace shaka {
@@ -50,8 +50,11 @@ const uint32_t kMaxBitrate = 320000;
 const uint32_t kAverageBitrate = 256000;
 
 const char kSample1Data[] = "sample 1 data";
-const char kAdtsSample1Data[] = "adts sample 1 data";
 const char kSample2Data[] = "sample 2 data";
+const char kAdtsHeader[] = "adtshdr";
+static_assert(sizeof(kAdtsHeader) - 1 ==
+                  AACAudioSpecificConfig::kADTSHeaderSize,
+              "");
 const int64_t kPts1 = 0x12345;
 const int64_t kDts1 = 0x12000;
 const int64_t kPts2 = 0x12445;
@@ -65,11 +68,26 @@ const char kScaledPts2[] = {0, 0, 0, 0, 0, 0x12, 0x44, 0x50};
 // String form of kLargePts * kExpectedTimescaleScale truncated to 33 bits.
 const char kTruncatedScaledLargePts[] = {0, 0, 0, 0, 0x34, 0x56, 0x78, 0x10};
 
-const char kSegment1Data[] = "segment 1 data";
-const char kSegment2Data[] = "segment 2 data";
+std::string ArrayToString(const char (&timestamp)[8]) {
+  return std::string(std::begin(timestamp), std::end(timestamp));
+}
+
+// @return The ID3 tag expected at the start of a segment.
+std::string GetId3TagData(const char (&timestamp)[8],
+                          const std::string& audio_setup_information) {
+  Id3Tag id3_tag;
+  id3_tag.AddPrivateFrame(kTimestampOwnerIdentifier, ArrayToString(timestamp));
+  if (!audio_setup_information.empty()) {
+    id3_tag.AddPrivateFrame(kAudioDescriptionOwnerIdentifier,
+                            audio_setup_information);
+  }
+  std::vector<uint8_t> data;
+  EXPECT_TRUE(id3_tag.WriteToVector(&data));
+  return std::string(data.begin(), data.end());
+}
 
-std::vector<uint8_t> StringToVector(const std::string& s) {
-  return std::vector<uint8_t>(s.begin(), s.end());
+std::string GetId3TagData(const char (&timestamp)[8]) {
+  return GetId3TagData(timestamp, "");
 }
 
 std::shared_ptr<AudioStreamInfo> CreateAudioStreamInfo(Codec codec) {
@@ -105,17 +123,7 @@ std::shared_ptr<MediaSample> CreateEncryptedSample(
 class MockAACAudioSpecificConfig : public AACAudioSpecificConfig {
  public:
   MOCK_METHOD1(Parse, bool(const std::vector<uint8_t>& data));
-  MOCK_CONST_METHOD3(ConvertToADTS,
-                     bool(const uint8_t* data,
-                          size_t data_size,
-                          std::vector<uint8_t>* audio_frame));
-};
-
-class MockId3Tag : public Id3Tag {
- public:
-  MOCK_METHOD2(AddPrivateFrame,
-               void(const std::string&, const std::string& data));
-  MOCK_METHOD1(WriteToBuffer, bool(BufferWriter* buffer_writer));
+  MOCK_CONST_METHOD2(WriteADTSHeader, bool(size_t data_size, uint8_t* header));
 };
 
 class TestablePackedAudioSegmenter : public PackedAudioSegmenter {
@@ -127,6 +135,11 @@ class TestablePackedAudioSegmenter : public PackedAudioSegmenter {
   MOCK_METHOD0(CreateId3Tag, std::unique_ptr<Id3Tag>());
 };
 
+bool WriteAdtsHeader(size_t data_size, uint8_t* header) {
+  memcpy(header, kAdtsHeader, AACAudioSpecificConfig::kADTSHeaderSize);
+  return true;
+}
+
 }  // namespace
 
 class PackedAudioSegmenterTest : public ::testing::Test {
@@ -140,6 +153,14 @@ class PackedAudioSegmenterTest : public ::testing::Test {
   }
 
  protected:
+  // The ID3 tag is built once, and only patched with the timestamp of each
+  // segment.
+  void ExpectId3TagCreatedOnce() {
+    EXPECT_CALL(segmenter_, CreateId3Tag()).WillOnce(Invoke([]() {
+      return std::unique_ptr<Id3Tag>(new Id3Tag);
+    }));
+  }
+
   TestablePackedAudioSegmenter segmenter_;
   std::unique_ptr<MockAACAudioSpecificConfig> mock_adts_converter_;
 };
@@ -171,197 +192,159 @@ TEST_F(PackedAudioSegmenterTest, AacAddSample) {
   EXPECT_CALL(*mock_adts_converter_, Parse(ElementsAreArray(kCodecConfig)))
       .WillOnce(Return(true));
   EXPECT_CALL(*mock_adts_converter_,
-              ConvertToADTS(_, sizeof(kSample1Data) - 1, _))
-      .WillOnce(DoAll(SetArgPointee<2>(StringToVector(kAdtsSample1Data)),
-                      Return(true)));
+              WriteADTSHeader(sizeof(kSample1Data) - 1, _))
+      .WillOnce(Invoke(WriteAdtsHeader));
 
   EXPECT_CALL(segmenter_, CreateAdtsConverter())
       .WillOnce(Return(ByMove(std::move(mock_adts_converter_))));
   ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecAAC)));
 
-  std::unique_ptr<MockId3Tag> mock_id3_tag(new MockId3Tag);
-  EXPECT_CALL(*mock_id3_tag,
-              AddPrivateFrame(
-                  kTimestampOwnerIdentifier,
-                  std::string(std::begin(kScaledPts1), std::end(kScaledPts1))));
-  EXPECT_CALL(*mock_id3_tag, WriteToBuffer(_))
-      .WillOnce(Invoke([](BufferWriter* buffer) {
-        buffer->AppendString(kSegment1Data);
-        return true;
-      }));
-  EXPECT_CALL(segmenter_, CreateId3Tag())
-      .WillOnce(Return(ByMove(std::move(mock_id3_tag))));
-
+  ExpectId3TagCreatedOnce();
   ASSERT_OK(segmenter_.AddSample(*CreateSample(kPts1, kDts1, kSample1Data)));
-  EXPECT_EQ(std::string(kSegment1Data) + kAdtsSample1Data, GetSegmentData());
+  EXPECT_EQ(GetId3TagData(kScaledPts1) + kAdtsHeader + kSample1Data,
+            GetSegmentData());
 }
 
-TEST_F(PackedAudioSegmenterTest, TruncateLargeTimestamp) {
+TEST_F(PackedAudioSegmenterTest, AacAddSampleFailed) {
   EXPECT_CALL(*mock_adts_converter_, Parse(ElementsAreArray(kCodecConfig)))
       .WillOnce(Return(true));
   EXPECT_CALL(*mock_adts_converter_,
-              ConvertToADTS(_, sizeof(kSample1Data) - 1, _))
-      .WillOnce(DoAll(SetArgPointee<2>(StringToVector(kAdtsSample1Data)),
-                      Return(true)));
+              WriteADTSHeader(sizeof(kSample1Data) - 1, _))
+      .WillOnce(Return(false));
 
   EXPECT_CALL(segmenter_, CreateAdtsConverter())
       .WillOnce(Return(ByMove(std::move(mock_adts_converter_))));
   ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecAAC)));
 
-  std::unique_ptr<MockId3Tag> mock_id3_tag(new MockId3Tag);
-  EXPECT_CALL(*mock_id3_tag,
-              AddPrivateFrame(kTimestampOwnerIdentifier,
-                              std::string(std::begin(kTruncatedScaledLargePts),
-                                          std::end(kTruncatedScaledLargePts))));
-  EXPECT_CALL(*mock_id3_tag, WriteToBuffer(_))
-      .WillOnce(Invoke([](BufferWriter* buffer) {
-        buffer->AppendString(kSegment1Data);
-        return true;
-      }));
-  EXPECT_CALL(segmenter_, CreateId3Tag())
-      .WillOnce(Return(ByMove(std::move(mock_id3_tag))));
+  ExpectId3TagCreatedOnce();
+  ASSERT_NOT_OK(
+      segmenter_.AddSample(*CreateSample(kPts1, kDts1, kSample1Data)));
+}
+
+TEST_F(PackedAudioSegmenterTest, TruncateLargeTimestamp) {
+  EXPECT_CALL(*mock_adts_converter_, Parse(ElementsAreArray(kCodecConfig)))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_adts_converter_,
+              WriteADTSHeader(sizeof(kSample1Data) - 1, _))
+      .WillOnce(Invoke(WriteAdtsHeader));
 
+  EXPECT_CALL(segmenter_, CreateAdtsConverter())
+      .WillOnce(Return(ByMove(std::move(mock_adts_converter_))));
+  ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecAAC)));
+
+  ExpectId3TagCreatedOnce();
   ASSERT_OK(
       segmenter_.AddSample(*CreateSample(kLargePts, kLargePts, kSample1Data)));
+  EXPECT_EQ(GetId3TagData(kTruncatedScaledLargePts) + kAdtsHeader +
+                kSample1Data,
+            GetSegmentData());
 }
 
 TEST_F(PackedAudioSegmenterTest, Ac3AddSample) {
   ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecAC3)));
 
-  std::unique_ptr<MockId3Tag> mock_id3_tag(new MockId3Tag);
-  EXPECT_CALL(*mock_id3_tag, AddPrivateFrame(kTimestampOwnerIdentifier, _));
-  EXPECT_CALL(*mock_id3_tag, WriteToBuffer(_))
-      .WillOnce(Invoke([](BufferWriter* buffer) {
-        buffer->AppendString(kSegment1Data);
-        return true;
-      }));
-  EXPECT_CALL(segmenter_, CreateId3Tag())
-      .WillOnce(Return(ByMove(std::move(mock_id3_tag))));
-
+  ExpectId3TagCreatedOnce();
   ASSERT_OK(segmenter_.AddSample(*CreateSample(kPts1, kDts1, kSample1Data)));
-  EXPECT_EQ(std::string(kSegment1Data) + kSample1Data, GetSegmentData());
+  EXPECT_EQ(GetId3TagData(kScaledPts1) + kSample1Data, GetSegmentData());
 }
 
 TEST_F(PackedAudioSegmenterTest, Ac3AddSampleTwice) {
   ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecAC3)));
 
-  std::unique_ptr<MockId3Tag> mock_id3_tag(new MockId3Tag);
-  EXPECT_CALL(*mock_id3_tag, AddPrivateFrame(kTimestampOwnerIdentifier, _));
-  EXPECT_CALL(*mock_id3_tag, WriteToBuffer(_))
-      .WillOnce(Invoke([](BufferWriter* buffer) {
-        buffer->AppendString(kSegment1Data);
-        return true;
-      }));
-  EXPECT_CALL(segmenter_, CreateId3Tag())
-      .WillOnce(Return(ByMove(std::move(mock_id3_tag))));
-
+  ExpectId3TagCreatedOnce();
   ASSERT_OK(segmenter_.AddSample(*CreateSample(kPts1, kDts1, kSample1Data)));
   ASSERT_OK(segmenter_.AddSample(*CreateSample(kPts2, kDts2, kSample2Data)));
-  EXPECT_EQ(std::string(kSegment1Data) + kSample1Data + kSample2Data,
+  EXPECT_EQ(GetId3TagData(kScaledPts1) + kSample1Data + kSample2Data,
             GetSegmentData());
 }
 
 TEST_F(PackedAudioSegmenterTest, Ac3AddSampleTwiceWithFinalize) {
   ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecAC3)));
 
-  std::unique_ptr<MockId3Tag> mock_id3_tag(new MockId3Tag);
-  EXPECT_CALL(*mock_id3_tag,
-              AddPrivateFrame(
-                  kTimestampOwnerIdentifier,
-                  std::string(std::begin(kScaledPts1), std::end(kScaledPts1))));
-  EXPECT_CALL(*mock_id3_tag, WriteToBuffer(_))
-      .WillOnce(Invoke([](BufferWriter* buffer) {
-        buffer->AppendString(kSegment1Data);
-        return true;
-      }));
-  EXPECT_CALL(segmenter_, CreateId3Tag())
-      .WillOnce(Return(ByMove(std::move(mock_id3_tag))));
-
+  ExpectId3TagCreatedOnce();
   ASSERT_OK(segmenter_.AddSample(*CreateSample(kPts1, kDts1, kSample1Data)));
   ASSERT_OK(segmenter_.FinalizeSegment());
-  EXPECT_EQ(std::string(kSegment1Data) + kSample1Data, GetSegmentData());
-
-  std::unique_ptr<MockId3Tag> mock_id3_tag2(new MockId3Tag);
-  EXPECT_CALL(*mock_id3_tag2,
-              AddPrivateFrame(
-                  kTimestampOwnerIdentifier,
-                  std::string(std::begin(kScaledPts2), std::end(kScaledPts2))));
-  EXPECT_CALL(*mock_id3_tag2, WriteToBuffer(_))
-      .WillOnce(Invoke([](BufferWriter* buffer) {
-        buffer->AppendString(kSegment2Data);
-        return true;
-      }));
-  EXPECT_CALL(segmenter_, CreateId3Tag())
-      .WillOnce(Return(ByMove(std::move(mock_id3_tag2))));
+  EXPECT_EQ(GetId3TagData(kScaledPts1) + kSample1Data, GetSegmentData());
 
   ASSERT_OK(segmenter_.AddSample(*CreateSample(kPts2, kDts2, kSample2Data)));
-  EXPECT_EQ(std::string(kSegment2Data) + kSample2Data, GetSegmentData());
+  EXPECT_EQ(GetId3TagData(kScaledPts2) + kSample2Data, GetSegmentData());
 }
 
 TEST_F(PackedAudioSegmenterTest, AacAddEncryptedSample) {
   EXPECT_CALL(*mock_adts_converter_, Parse(ElementsAreArray(kCodecConfig)))
       .WillOnce(Return(true));
   EXPECT_CALL(*mock_adts_converter_,
-              ConvertToADTS(_, sizeof(kSample1Data) - 1, _))
-      .WillOnce(DoAll(SetArgPointee<2>(StringToVector(kAdtsSample1Data)),
-                      Return(true)));
+              WriteADTSHeader(sizeof(kSample1Data) - 1, _))
+      .WillOnce(Invoke(WriteAdtsHeader));
 
   EXPECT_CALL(segmenter_, CreateAdtsConverter())
       .WillOnce(Return(ByMove(std::move(mock_adts_converter_))));
   ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecAAC)));
 
-  std::unique_ptr<MockId3Tag> mock_id3_tag(new MockId3Tag);
-  EXPECT_CALL(*mock_id3_tag, AddPrivateFrame(kTimestampOwnerIdentifier, _));
-  // Derived from |kCodecConfig|.
-  const char kExpectedAacSetup[] = "zach\x0\x0\x1\x4\x2B\x92\x8\x0";
-  EXPECT_CALL(*mock_id3_tag,
-              AddPrivateFrame(kAudioDescriptionOwnerIdentifier,
-                              std::string(std::begin(kExpectedAacSetup),
-                                          std::end(kExpectedAacSetup) - 1)));
-  EXPECT_CALL(*mock_id3_tag, WriteToBuffer(_)).WillOnce(Return(true));
-  EXPECT_CALL(segmenter_, CreateId3Tag())
-      .WillOnce(Return(ByMove(std::move(mock_id3_tag))));
-
+  ExpectId3TagCreatedOnce();
   ASSERT_OK(
       segmenter_.AddSample(*CreateEncryptedSample(kPts1, kDts1, kSample1Data)));
+  // Derived from |kCodecConfig|.
+  const char kExpectedAacSetup[] = "zach\x0\x0\x1\x4\x2B\x92\x8\x0";
+  EXPECT_EQ(GetId3TagData(kScaledPts1,
+                          std::string(std::begin(kExpectedAacSetup),
+                                      std::end(kExpectedAacSetup) - 1)) +
+                kAdtsHeader + kSample1Data,
+            GetSegmentData());
 }
 
 TEST_F(PackedAudioSegmenterTest, Ac3AddEncryptedSample) {
   ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecAC3)));
 
-  std::unique_ptr<MockId3Tag> mock_id3_tag(new MockId3Tag);
-  EXPECT_CALL(*mock_id3_tag, AddPrivateFrame(kTimestampOwnerIdentifier, _));
-  // Derived from |kSample1Data|.
-  const char kExpectedAc3Setup[] = "zac3\x0\x0\x1\xAsample 1 d";
-  EXPECT_CALL(*mock_id3_tag,
-              AddPrivateFrame(kAudioDescriptionOwnerIdentifier,
-                              std::string(std::begin(kExpectedAc3Setup),
-                                          std::end(kExpectedAc3Setup) - 1)));
-  EXPECT_CALL(*mock_id3_tag, WriteToBuffer(_)).WillOnce(Return(true));
-  EXPECT_CALL(segmenter_, CreateId3Tag())
-      .WillOnce(Return(ByMove(std::move(mock_id3_tag))));
-
+  ExpectId3TagCreatedOnce();
   ASSERT_OK(
       segmenter_.AddSample(*CreateEncryptedSample(kPts1, kDts1, kSample1Data)));
+  // Derived from |kSample1Data|.
+  const char kExpectedAc3Setup[] = "zac3\x0\x0\x1\xAsample 1 d";
+  EXPECT_EQ(GetId3TagData(kScaledPts1,
+                          std::string(std::begin(kExpectedAc3Setup),
+                                      std::end(kExpectedAc3Setup) - 1)) +
+                kSample1Data,
+            GetSegmentData());
 }
 
 TEST_F(PackedAudioSegmenterTest, Eac3AddEncryptedSample) {
   ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecEAC3)));
 
-  std::unique_ptr<MockId3Tag> mock_id3_tag(new MockId3Tag);
-  EXPECT_CALL(*mock_id3_tag, AddPrivateFrame(kTimestampOwnerIdentifier, _));
+  ExpectId3TagCreatedOnce();
+  ASSERT_OK(
+      segmenter_.AddSample(*CreateEncryptedSample(kPts1, kDts1, kSample1Data)));
   // Derived from |kCodecConfig|.
   const char kExpectedEac3Setup[] = "zec3\x0\x0\x1\x4\x2B\x92\x8\x0";
-  EXPECT_CALL(*mock_id3_tag,
-              AddPrivateFrame(kAudioDescriptionOwnerIdentifier,
-                              std::string(std::begin(kExpectedEac3Setup),
-                                          std::end(kExpectedEac3Setup) - 1)));
-  EXPECT_CALL(*mock_id3_tag, WriteToBuffer(_)).WillOnce(Return(true));
+  EXPECT_EQ(GetId3TagData(kScaledPts1,
+                          std::string(std::begin(kExpectedEac3Setup),
+                                      std::end(kExpectedEac3Setup) - 1)) +
+                kSample1Data,
+            GetSegmentData());
+}
+
+TEST_F(PackedAudioSegmenterTest, Ac3ClearLead) {
+  ASSERT_OK(segmenter_.Initialize(*CreateAudioStreamInfo(kCodecAC3)));
+
+  // The ID3 tag is built again with the audio setup information once the
+  // samples are encrypted.
   EXPECT_CALL(segmenter_, CreateId3Tag())
-      .WillOnce(Return(ByMove(std::move(mock_id3_tag))));
+      .Times(2)
+      .WillRepeatedly(
+          Invoke([]() { return std::unique_ptr<Id3Tag>(new Id3Tag); }));
+  ASSERT_OK(segmenter_.AddSample(*CreateSample(kPts1, kDts1, kSample1Data)));
+  ASSERT_OK(segmenter_.FinalizeSegment());
+  EXPECT_EQ(GetId3TagData(kScaledPts1) + kSample1Data, GetSegmentData());
 
   ASSERT_OK(
-      segmenter_.AddSample(*CreateEncryptedSample(kPts1, kDts1, kSample1Data)));
+      segmenter_.AddSample(*CreateEncryptedSample(kPts2, kDts2, kSample2Data)));
+  // Derived from |kSample2Data|.
+  const char kExpectedAc3Setup[] = "zac3\x0\x0\x1\xAsample 2 d";
+  EXPECT_EQ(GetId3TagData(kScaledPts2,
+                          std::string(std::begin(kExpectedAc3Setup),
+                                      std::end(kExpectedAc3Setup) - 1)) +
+                kSample2Data,
+            GetSegmentData());
 }
 
 }  // namespace media
@@ -8,6 +8,7 @@
 
 #include "packager/media/base/muxer_util.h"
 #include "packager/media/formats/packed_audio/packed_audio_segmenter.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -18,8 +19,9 @@ PackedAudioWriter::PackedAudioWriter(const MuxerOptions& muxer_options)
       transport_stream_timestamp_offset_(
           muxer_options.transport_stream_timestamp_offset_ms *
           kPackedAudioTimescale / 1000),
-      segmenter_(new PackedAudioSegmenter(transport_stream_timestamp_offset_)) {
-}
+      segmenter_(new PackedAudioSegmenter(transport_stream_timestamp_offset_)),
+      segment_number_(muxer_options.first_segment_index),
+      number_from_timeline_(muxer_options.segment_number_from_timeline) {}
 
 PackedAudioWriter::~PackedAudioWriter() = default;
 
@@ -75,6 +77,13 @@ Status PackedAudioWriter::FinalizeSegment(size_t stream_id,
 
   const uint64_t segment_timestamp =
       segment_info.start_timestamp * segmenter_->TimescaleScale();
+  if (number_from_timeline_) {
+    segment_number_ =
+        GetTimelineSegmentIndex(options().segment_duration_in_seconds,
+                                segment_timestamp,
+                                static_cast<uint32_t>(kPackedAudioTimescale));
+    number_from_timeline_ = false;
+  }
   std::string segment_path =
       options().segment_template.empty()
           ? options().output_file_name
@@ -124,7 +133,12 @@ Status PackedAudioWriter::WriteSegment(const std::string& segment_path,
 
 Status PackedAudioWriter::CloseFile(std::unique_ptr<File, FileCloser> file) {
   std::string file_name = file->file_name();
-  if (!file.release()->Close()) {
+  bool closed = false;
+  {
+    ScopedTraceEvent trace_event("CloseSegmentFile", "io");
+    closed = file.release()->Close();
+  }
+  if (!closed) {
     return Status(
         error::FILE_FAILURE,
         "Cannot close file " + file_name +
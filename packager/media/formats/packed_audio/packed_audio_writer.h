@@ -54,6 +54,9 @@ class PackedAudioWriter : public Muxer {
 
   // Used in multi-segment mode for segment template.
   uint64_t segment_number_ = 0;
+  // Whether |segment_number_| is still to be derived from the start time of
+  // the first segment, see MuxerOptions::segment_number_from_timeline.
+  bool number_from_timeline_ = false;
 };
 
 }  // namespace media
@@ -0,0 +1,209 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/webm/cluster_writer.h"
+
+#include <limits>
+
+#include "packager/base/logging.h"
+#include "packager/third_party/libwebm/src/mkvmuxerutil.hpp"
+#include "packager/third_party/libwebm/src/webmids.hpp"
+
+namespace shaka {
+namespace media {
+namespace webm {
+namespace {
+
+// The largest relative timecode of a Block, which is a signed 16-bit field.
+const int64_t kMaxBlockTimecode = 0x7FFF;
+// The size of the Cluster size, so that it can be updated in place.
+const int32_t kClusterSizeSize = 8;
+// Track number, relative timecode and flags, assuming a one byte track number.
+const uint64_t kBlockHeaderSize = 4;
+
+// Writes the header of a SimpleBlock or Block: the track number, the relative
+// timecode and the flags.
+bool WriteBlockHeader(mkvmuxer::IMkvWriter* writer,
+                      uint64_t track_number,
+                      int64_t relative_timecode,
+                      uint64_t flags) {
+  return mkvmuxer::WriteUInt(writer, track_number) == 0 &&
+         mkvmuxer::SerializeInt(writer, relative_timecode, 2) == 0 &&
+         mkvmuxer::SerializeInt(writer, flags, 1) == 0;
+}
+
+bool WriteData(mkvmuxer::IMkvWriter* writer,
+               const uint8_t* data,
+               uint64_t size) {
+  DCHECK_LE(size, std::numeric_limits<uint32_t>::max());
+  return size == 0 ||
+         writer->Write(data, static_cast<mkvmuxer::uint32>(size)) == 0;
+}
+
+}  // namespace
+
+ClusterWriter::ClusterWriter(uint64_t timecode,
+                             uint64_t timecode_scale,
+                             mkvmuxer::IMkvWriter* writer)
+    : timecode_(timecode), timecode_scale_(timecode_scale), writer_(writer) {
+  DCHECK(writer_);
+}
+
+ClusterWriter::~ClusterWriter() {}
+
+bool ClusterWriter::AddBlock(const Block& block) {
+  if (finalized_)
+    return false;
+  const int64_t relative_timecode = GetRelativeTimecode(block.timecode);
+  if (relative_timecode < 0)
+    return false;
+  if (size_position_ < 0 && !WriteClusterHeader())
+    return false;
+
+  const bool simple_block = !block.additional && block.duration == 0;
+  const uint64_t element_size =
+      simple_block ? WriteSimpleBlock(block, relative_timecode)
+                   : WriteBlockGroup(block, relative_timecode);
+  if (element_size == 0)
+    return false;
+  payload_size_ += element_size;
+  return true;
+}
+
+bool ClusterWriter::Finalize() {
+  if (finalized_ || size_position_ < 0)
+    return false;
+
+  if (writer_->Seekable()) {
+    const int64_t position = writer_->Position();
+    if (writer_->Position(size_position_) ||
+        mkvmuxer::WriteUIntSize(writer_, payload_size_, kClusterSizeSize) ||
+        writer_->Position(position)) {
+      return false;
+    }
+  }
+  finalized_ = true;
+  return true;
+}
+
+int64_t ClusterWriter::GetRelativeTimecode(int64_t abs_timecode) const {
+  const int64_t relative_timecode =
+      abs_timecode - static_cast<int64_t>(timecode_);
+  if (relative_timecode < 0 || relative_timecode > kMaxBlockTimecode)
+    return -1;
+  return relative_timecode;
+}
+
+uint64_t ClusterWriter::Size() const {
+  // The Cluster size is always coded on 8 bytes.
+  return mkvmuxer::EbmlMasterElementSize(mkvmuxer::kMkvCluster,
+                                         std::numeric_limits<uint64_t>::max()) +
+         payload_size_;
+}
+
+bool ClusterWriter::WriteClusterHeader() {
+  if (mkvmuxer::WriteID(writer_, mkvmuxer::kMkvCluster))
+    return false;
+  size_position_ = writer_->Position();
+  // The size is unknown until the Cluster is finalized.
+  if (mkvmuxer::SerializeInt(writer_, mkvmuxer::kEbmlUnknownValue,
+                             kClusterSizeSize)) {
+    return false;
+  }
+  if (!mkvmuxer::WriteEbmlElement(writer_, mkvmuxer::kMkvTimecode, timecode_))
+    return false;
+  payload_size_ += mkvmuxer::EbmlElementSize(mkvmuxer::kMkvTimecode, timecode_);
+  return true;
+}
+
+uint64_t ClusterWriter::WriteSimpleBlock(const Block& block,
+                                         int64_t relative_timecode) {
+  const uint64_t payload_size = kBlockHeaderSize + block.data_size;
+  if (mkvmuxer::WriteID(writer_, mkvmuxer::kMkvSimpleBlock) ||
+      mkvmuxer::WriteUInt(writer_, payload_size) ||
+      !WriteBlockHeader(writer_, block.track_number, relative_timecode,
+                        block.is_key ? 0x80 : 0) ||
+      !WriteData(writer_, block.data, block.data_size)) {
+    return 0;
+  }
+  return mkvmuxer::GetUIntSize(mkvmuxer::kMkvSimpleBlock) +
+         mkvmuxer::GetCodedUIntSize(payload_size) + payload_size;
+}
+
+uint64_t ClusterWriter::WriteBlockGroup(const Block& block,
+                                        int64_t relative_timecode) {
+  uint64_t block_more_payload_size = 0;
+  uint64_t block_additions_payload_size = 0;
+  uint64_t block_additions_size = 0;
+  if (block.additional) {
+    block_more_payload_size =
+        mkvmuxer::EbmlElementSize(mkvmuxer::kMkvBlockAddID, block.add_id) +
+        mkvmuxer::EbmlElementSize(mkvmuxer::kMkvBlockAdditional,
+                                  block.additional, block.additional_size);
+    block_additions_payload_size =
+        mkvmuxer::EbmlMasterElementSize(mkvmuxer::kMkvBlockMore,
+                                        block_more_payload_size) +
+        block_more_payload_size;
+    block_additions_size =
+        mkvmuxer::EbmlMasterElementSize(mkvmuxer::kMkvBlockAdditions,
+                                        block_additions_payload_size) +
+        block_additions_payload_size;
+  }
+  const uint64_t reference_block_size =
+      block.is_key ? 0
+                   : mkvmuxer::EbmlElementSize(mkvmuxer::kMkvReferenceBlock,
+                                               block.reference_timecode);
+  const uint64_t block_duration_size =
+      block.duration == 0
+          ? 0
+          : mkvmuxer::EbmlElementSize(mkvmuxer::kMkvBlockDuration,
+                                      block.duration);
+
+  const uint64_t block_payload_size = kBlockHeaderSize + block.data_size;
+  const uint64_t block_group_payload_size =
+      mkvmuxer::EbmlMasterElementSize(mkvmuxer::kMkvBlock,
+                                      block_payload_size) +
+      block_payload_size + block_additions_size + reference_block_size +
+      block_duration_size;
+
+  // The flags of a Block are always 0.
+  if (!mkvmuxer::WriteEbmlMasterElement(writer_, mkvmuxer::kMkvBlockGroup,
+                                        block_group_payload_size) ||
+      !mkvmuxer::WriteEbmlMasterElement(writer_, mkvmuxer::kMkvBlock,
+                                        block_payload_size) ||
+      !WriteBlockHeader(writer_, block.track_number, relative_timecode, 0) ||
+      !WriteData(writer_, block.data, block.data_size)) {
+    return 0;
+  }
+  if (block.additional &&
+      (!mkvmuxer::WriteEbmlMasterElement(writer_, mkvmuxer::kMkvBlockAdditions,
+                                         block_additions_payload_size) ||
+       !mkvmuxer::WriteEbmlMasterElement(writer_, mkvmuxer::kMkvBlockMore,
+                                         block_more_payload_size) ||
+       !mkvmuxer::WriteEbmlElement(writer_, mkvmuxer::kMkvBlockAddID,
+                                   block.add_id) ||
+       !mkvmuxer::WriteEbmlElement(writer_, mkvmuxer::kMkvBlockAdditional,
+                                   block.additional, block.additional_size))) {
+    return 0;
+  }
+  if (!block.is_key &&
+      !mkvmuxer::WriteEbmlElement(writer_, mkvmuxer::kMkvReferenceBlock,
+                                  block.reference_timecode)) {
+    return 0;
+  }
+  if (block.duration > 0 &&
+      !mkvmuxer::WriteEbmlElement(writer_, mkvmuxer::kMkvBlockDuration,
+                                  block.duration)) {
+    return 0;
+  }
+  return mkvmuxer::EbmlMasterElementSize(mkvmuxer::kMkvBlockGroup,
+                                         block_group_payload_size) +
+         block_group_payload_size;
+}
+
+}  // namespace webm
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,95 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_FORMATS_WEBM_CLUSTER_WRITER_H_
+#define PACKAGER_MEDIA_FORMATS_WEBM_CLUSTER_WRITER_H_
+
+#include <stdint.h>
+
+#include "packager/third_party/libwebm/src/mkvmuxer.hpp"
+
+namespace shaka {
+namespace media {
+namespace webm {
+
+/// Used to write a Cluster to the output stream. Unlike mkvmuxer::Cluster,
+/// the frame data is written straight from the caller's buffer: the
+/// SimpleBlock and BlockGroup headers are serialized here, with the same
+/// layout as libwebm, so there is no copy or allocation per frame.
+class ClusterWriter {
+ public:
+  /// A frame to be written. The data is referenced, not copied.
+  struct Block {
+    const uint8_t* data = nullptr;
+    uint64_t data_size = 0;
+    uint64_t track_number = 0;
+    /// The absolute WebM timecode of the frame.
+    uint64_t timecode = 0;
+    bool is_key = false;
+    /// If non-zero, the WebM duration written in a BlockGroup.
+    uint64_t duration = 0;
+    /// The WebM timecode of the reference frame, for non-key frames written
+    /// in a BlockGroup.
+    uint64_t reference_timecode = 0;
+    /// If set, the BlockAdditional data written in a BlockGroup, with its
+    /// BlockAddID.
+    const uint8_t* additional = nullptr;
+    uint64_t additional_size = 0;
+    uint64_t add_id = 0;
+  };
+
+  /// @param timecode is the WebM timecode of the Cluster.
+  /// @param timecode_scale is the WebM timecode scale, in nanoseconds.
+  /// @param writer is the writer of the Cluster, which must outlive it.
+  ClusterWriter(uint64_t timecode,
+                uint64_t timecode_scale,
+                mkvmuxer::IMkvWriter* writer);
+  ~ClusterWriter();
+
+  /// Writes a frame as a SimpleBlock, or as a BlockGroup if it has a duration
+  /// or additional data. The Cluster header is written before the first
+  /// frame.
+  /// @return true on success.
+  bool AddBlock(const Block& block);
+
+  /// Closes the Cluster. Updates its size if the writer is seekable.
+  /// @return true on success, false if no frame was written.
+  bool Finalize();
+
+  /// @return The timecode of @a abs_timecode relative to the Cluster, or -1
+  ///         if it does not fit in a Block.
+  int64_t GetRelativeTimecode(int64_t abs_timecode) const;
+
+  /// @return The size in bytes of the whole Cluster element.
+  uint64_t Size() const;
+
+  uint64_t timecode() const { return timecode_; }
+  uint64_t timecode_scale() const { return timecode_scale_; }
+
+ private:
+  ClusterWriter(const ClusterWriter&) = delete;
+  ClusterWriter& operator=(const ClusterWriter&) = delete;
+
+  bool WriteClusterHeader();
+  // @return The size of the element written, 0 on failure.
+  uint64_t WriteSimpleBlock(const Block& block, int64_t relative_timecode);
+  uint64_t WriteBlockGroup(const Block& block, int64_t relative_timecode);
+
+  const uint64_t timecode_;
+  const uint64_t timecode_scale_;
+  mkvmuxer::IMkvWriter* const writer_;
+
+  // The position of the Cluster size, -1 until the header is written.
+  int64_t size_position_ = -1;
+  uint64_t payload_size_ = 0;
+  bool finalized_ = false;
+};
+
+}  // namespace webm
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_FORMATS_WEBM_CLUSTER_WRITER_H_
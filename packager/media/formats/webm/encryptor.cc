@@ -8,6 +8,7 @@
 
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/media/formats/webm/webm_constants.h"
 
 namespace shaka {
@@ -33,7 +34,7 @@ void WriteEncryptedFrameHeader(const DecryptConfig* decrypt_config,
 
       const uint8_t signal_byte = kWebMEncryptedSignal | kWebMPartitionedSignal;
       header_buffer->AppendInt(signal_byte);
-      header_buffer->AppendVector(decrypt_config->iv());
+      header_buffer->AppendArray(decrypt_config->iv().data(), iv_size);
       header_buffer->AppendInt(static_cast<uint8_t>(num_partitions));
 
       uint32_t partition_offset = 0;
@@ -55,7 +56,7 @@ void WriteEncryptedFrameHeader(const DecryptConfig* decrypt_config,
       // Use whole-frame encryption: | signal_byte(1) | iv | enc_data |
       const uint8_t signal_byte = kWebMEncryptedSignal;
       header_buffer->AppendInt(signal_byte);
-      header_buffer->AppendVector(decrypt_config->iv());
+      header_buffer->AppendArray(decrypt_config->iv().data(), iv_size);
     }
   } else {
     // Clear sample: | signal_byte(0) | data |
@@ -102,8 +103,9 @@ void UpdateFrameForEncryption(MediaSample* sample) {
   WriteEncryptedFrameHeader(sample->decrypt_config(), &header_buffer);
 
   const size_t sample_size = header_buffer.Size() + sample->data_size();
-  std::shared_ptr<uint8_t> new_sample_data(new uint8_t[sample_size],
-                                           std::default_delete<uint8_t[]>());
+  std::shared_ptr<uint8_t> new_sample_data =
+      SampleBufferPool::GetDefault()->Allocate(sample_size,
+                                               AllocatorStats::kCrypto);
   memcpy(new_sample_data.get(), header_buffer.Buffer(), header_buffer.Size());
   memcpy(&new_sample_data.get()[header_buffer.Size()], sample->data(),
          sample->data_size());
@@ -10,6 +10,7 @@
 #include "packager/media/base/muxer_util.h"
 #include "packager/media/base/stream_info.h"
 #include "packager/media/event/muxer_listener.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/status_macros.h"
 #include "packager/third_party/libwebm/src/mkvmuxer.hpp"
 
@@ -38,7 +39,10 @@ Status MultiSegmentSegmenter::FinalizeSegment(uint64_t start_timestamp,
 
     // Close the file, which also does flushing, to make sure the file is
     // written before manifest is updated.
-    RETURN_IF_ERROR(writer_->Close());
+    {
+      ScopedTraceEvent trace_event("CloseSegmentFile", "io");
+      RETURN_IF_ERROR(writer_->Close());
+    }
 
     if (!File::Copy(temp_file_name_.c_str(), segment_name.c_str()))
       return Status(error::FILE_FAILURE, "Failure to copy memory file.");
@@ -101,7 +105,7 @@ Status MultiSegmentSegmenter::NewSegment(uint64_t start_timestamp,
   }
 
   const uint64_t start_timecode = FromBmffTimestamp(start_timestamp);
-  return SetCluster(start_timecode, 0, writer_.get());
+  return SetCluster(start_timecode, writer_.get());
 }
 
 }  // namespace webm
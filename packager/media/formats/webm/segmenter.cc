@@ -260,12 +260,9 @@ Status Segmenter::WriteSegmentHeader(uint64_t file_size, MkvWriter* writer) {
   return Status::OK;
 }
 
-Status Segmenter::SetCluster(uint64_t start_webm_timecode,
-                             uint64_t position,
-                             MkvWriter* writer) {
+Status Segmenter::SetCluster(uint64_t start_webm_timecode, MkvWriter* writer) {
   const uint64_t scale = segment_info_.timecode_scale();
-  cluster_.reset(new mkvmuxer::Cluster(start_webm_timecode, position, scale));
-  cluster_->Init(writer);
+  cluster_.reset(new ClusterWriter(start_webm_timecode, scale, writer));
   return Status::OK;
 }
 
@@ -374,24 +371,20 @@ Status Segmenter::InitializeAudioTrack(const AudioStreamInfo& info,
 }
 
 Status Segmenter::WriteFrame(bool write_duration) {
-  // Create a frame manually so we can create non-SimpleBlock frames.  This
-  // is required to allow the frame duration to be added.  If the duration
-  // is not set, then a SimpleBlock will still be written.
-  mkvmuxer::Frame frame;
-
-  if (!frame.Init(prev_sample_->data(), prev_sample_->data_size())) {
-    return Status(error::MUXER_FAILURE,
-                  "Error adding sample to segment: Frame::Init failed");
-  }
-
+  // The frame is written straight from the sample buffer. A BlockGroup is
+  // written instead of a SimpleBlock to add the frame duration, if set.
+  const uint64_t scale = cluster_->timecode_scale();
+  ClusterWriter::Block block;
+  block.data = prev_sample_->data();
+  block.data_size = prev_sample_->data_size();
+  block.track_number = track_id_;
+  block.timecode = NsToWebMTimecode(
+      BmffTimestampToNs(prev_sample_->pts(), time_scale_), scale);
+  block.is_key = prev_sample_->is_key_frame();
   if (write_duration) {
-    frame.set_duration(
-        BmffTimestampToNs(prev_sample_->duration(), time_scale_));
+    block.duration = NsToWebMTimecode(
+        BmffTimestampToNs(prev_sample_->duration(), time_scale_), scale);
   }
-  frame.set_is_key(prev_sample_->is_key_frame());
-  frame.set_timestamp(
-      BmffTimestampToNs(prev_sample_->pts(), time_scale_));
-  frame.set_track_number(track_id_);
 
   if (prev_sample_->side_data_size() > 0) {
     uint64_t block_add_id;
@@ -399,29 +392,24 @@ Status Segmenter::WriteFrame(bool write_duration) {
     // done to mimic ffmpeg behavior. See webm_cluster_parser.cc for details.
     CHECK_GT(prev_sample_->side_data_size(), sizeof(block_add_id));
     memcpy(&block_add_id, prev_sample_->side_data(), sizeof(block_add_id));
-    if (!frame.AddAdditionalData(
-            prev_sample_->side_data() + sizeof(block_add_id),
-            prev_sample_->side_data_size() - sizeof(block_add_id),
-            block_add_id)) {
-      return Status(
-          error::MUXER_FAILURE,
-          "Error adding sample to segment: Frame::AddAditionalData Failed");
-    }
+    block.additional = prev_sample_->side_data() + sizeof(block_add_id);
+    block.additional_size =
+        prev_sample_->side_data_size() - sizeof(block_add_id);
+    block.add_id = block_add_id;
   }
 
-  if (!prev_sample_->is_key_frame() && !frame.CanBeSimpleBlock()) {
-    frame.set_reference_block_timestamp(
-        BmffTimestampToNs(reference_frame_timestamp_, time_scale_));
+  if (!block.is_key) {
+    block.reference_timecode = NsToWebMTimecode(
+        BmffTimestampToNs(reference_frame_timestamp_, time_scale_), scale);
   }
 
   // GetRelativeTimecode will return -1 if the relative timecode is too large
   // to fit in the frame.
-  if (cluster_->GetRelativeTimecode(NsToWebMTimecode(
-          frame.timestamp(), cluster_->timecode_scale())) < 0) {
+  if (cluster_->GetRelativeTimecode(block.timecode) < 0) {
     const double segment_duration =
-        static_cast<double>(frame.timestamp() -
-                            WebMTimecodeToNs(cluster_->timecode(),
-                                             cluster_->timecode_scale())) /
+        static_cast<double>(
+            BmffTimestampToNs(prev_sample_->pts(), time_scale_) -
+            WebMTimecodeToNs(cluster_->timecode(), scale)) /
         kSecondsToNs;
     LOG(ERROR) << "Error adding sample to segment: segment too large, "
                << segment_duration
@@ -430,9 +418,9 @@ Status Segmenter::WriteFrame(bool write_duration) {
                   "Error adding sample to segment: segment too large");
   }
 
-  if (!cluster_->AddFrame(&frame)) {
+  if (!cluster_->AddBlock(block)) {
     return Status(error::MUXER_FAILURE,
-                  "Error adding sample to segment: Cluster::AddFrame failed");
+                  "Error adding sample to segment: Cluster::AddBlock failed");
   }
 
   // A reference frame is needed for non-keyframes.  Having a reference to the
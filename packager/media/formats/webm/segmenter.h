@@ -11,6 +11,7 @@
 
 #include "packager/base/optional.h"
 #include "packager/media/base/range.h"
+#include "packager/media/formats/webm/cluster_writer.h"
 #include "packager/media/formats/webm/mkv_writer.h"
 #include "packager/media/formats/webm/seek_head.h"
 #include "packager/status.h"
@@ -83,16 +84,14 @@ class Segmenter {
   /// Writes the Segment header to @a writer.
   Status WriteSegmentHeader(uint64_t file_size, MkvWriter* writer);
   /// Creates a Cluster object with the given parameters.
-  Status SetCluster(uint64_t start_webm_timecode,
-                    uint64_t position,
-                    MkvWriter* writer);
+  Status SetCluster(uint64_t start_webm_timecode, MkvWriter* writer);
 
   /// Update segmentation progress using ProgressListener.
   void UpdateProgress(uint64_t progress);
   void set_progress_target(uint64_t target) { progress_target_ = target; }
 
   const MuxerOptions& options() const { return options_; }
-  mkvmuxer::Cluster* cluster() { return cluster_.get(); }
+  ClusterWriter* cluster() { return cluster_.get(); }
   mkvmuxer::Cues* cues() { return &cues_; }
   MuxerListener* muxer_listener() { return muxer_listener_; }
   SeekHead* seek_head() { return &seek_head_; }
@@ -128,7 +127,7 @@ class Segmenter {
 
   const MuxerOptions& options_;
 
-  std::unique_ptr<mkvmuxer::Cluster> cluster_;
+  std::unique_ptr<ClusterWriter> cluster_;
   mkvmuxer::Cues cues_;
   SeekHead seek_head_;
   mkvmuxer::SegmentInfo segment_info_;
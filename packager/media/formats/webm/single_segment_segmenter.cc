@@ -125,7 +125,7 @@ Status SingleSegmentSegmenter::NewSegment(uint64_t start_timestamp,
   if (!cues()->AddCue(cue_point))
     return Status(error::INTERNAL_ERROR, "Error adding CuePoint.");
 
-  return SetCluster(start_timecode, position, writer_.get());
+  return SetCluster(start_timecode, writer_.get());
 }
 
 }  // namespace webm
@@ -6,6 +6,7 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include <vector>
 #include "packager/media/formats/webm/segmenter_test_base.h"
 
 namespace shaka {
@@ -289,5 +290,76 @@ TEST_F(SingleSegmentSegmenterTest, ReallyLargeTimestamp) {
   }
 }
 
+TEST_F(SingleSegmentSegmenterTest, SinglePass) {
+  MuxerOptions options = CreateMuxerOptions();
+  options.webm_single_pass_single_segment = true;
+  options.segment_duration_in_seconds = 5;
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
+
+  // Write the samples to the Segmenter.
+  for (int i = 0; i < 8; i++) {
+    if (i == 5) {
+      ASSERT_OK(segmenter_->FinalizeSegment(0, 5 * kDuration, !kSubsegment));
+    }
+    std::shared_ptr<MediaSample> sample =
+        CreateSample(kKeyFrame, kDuration, kNoSideData);
+    ASSERT_OK(segmenter_->AddSample(*sample));
+  }
+  ASSERT_OK(
+      segmenter_->FinalizeSegment(5 * kDuration, 3 * kDuration, !kSubsegment));
+  ASSERT_OK(segmenter_->Finalize());
+
+  // The Cues directly follow the header, followed by the unused reserved
+  // space and the Clusters.
+  uint64_t init_start = 0;
+  uint64_t init_end = 0;
+  ASSERT_TRUE(segmenter_->GetInitRangeStartAndEnd(&init_start, &init_end));
+  uint64_t index_start = 0;
+  uint64_t index_end = 0;
+  ASSERT_TRUE(segmenter_->GetIndexRangeStartAndEnd(&index_start, &index_end));
+  EXPECT_EQ(init_end + 1, index_start);
+  std::vector<Range> ranges = segmenter_->GetSegmentRanges();
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_LT(index_end + 1, ranges[0].start);
+
+  // Verify the resulting data.
+  ClusterParser parser;
+  ASSERT_NO_FATAL_FAILURE(parser.PopulateFromSegment(OutputFileName()));
+  ASSERT_EQ(2u, parser.cluster_count());
+  EXPECT_EQ(5u, parser.GetFrameCountForCluster(0));
+  EXPECT_EQ(3u, parser.GetFrameCountForCluster(1));
+}
+
+TEST_F(SingleSegmentSegmenterTest, SinglePassCuesOutgrowReservedSpace) {
+  MuxerOptions options = CreateMuxerOptions();
+  options.webm_single_pass_single_segment = true;
+  // Much longer than the actual segments, so that too few Cue points are
+  // estimated.
+  options.segment_duration_in_seconds = 1000;
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
+
+  const int kNumSegments = 20;
+  for (int i = 0; i < kNumSegments; i++) {
+    std::shared_ptr<MediaSample> sample =
+        CreateSample(kKeyFrame, kDuration, kNoSideData);
+    ASSERT_OK(segmenter_->AddSample(*sample));
+    ASSERT_OK(
+        segmenter_->FinalizeSegment(i * kDuration, kDuration, !kSubsegment));
+  }
+  ASSERT_OK(segmenter_->Finalize());
+
+  // The Cues are written after the Clusters instead.
+  uint64_t index_start = 0;
+  uint64_t index_end = 0;
+  ASSERT_TRUE(segmenter_->GetIndexRangeStartAndEnd(&index_start, &index_end));
+  std::vector<Range> ranges = segmenter_->GetSegmentRanges();
+  ASSERT_EQ(static_cast<size_t>(kNumSegments), ranges.size());
+  EXPECT_LT(ranges.back().end, index_start);
+
+  ClusterParser parser;
+  ASSERT_NO_FATAL_FAILURE(parser.PopulateFromSegment(OutputFileName()));
+  ASSERT_EQ(static_cast<size_t>(kNumSegments), parser.cluster_count());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -7,11 +7,15 @@
 #include "packager/media/formats/webm/two_pass_single_segment_segmenter.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 #include "packager/file/file_util.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/status_macros.h"
 #include "packager/third_party/libwebm/src/mkvmuxer.hpp"
 #include "packager/third_party/libwebm/src/mkvmuxerutil.hpp"
 #include "packager/third_party/libwebm/src/webmids.hpp"
@@ -20,6 +24,26 @@ namespace shaka {
 namespace media {
 namespace webm {
 namespace {
+// The size of a Void element header, with an 8-byte coded size so that a Void
+// element can fill any space of at least this size.
+const uint64_t kVoidHeaderSize = 9;
+// Margins applied to the estimated number of Cue points to absorb deviations
+// of the actual segment durations from the requested segment duration.
+const double kCuePointCountMarginRatio = 1.1;
+const int kExtraCuePointCount = 4;
+
+// Writes a Void element of |size| bytes, including its header.
+bool WriteVoid(mkvmuxer::IMkvWriter* writer, uint64_t size) {
+  DCHECK_GE(size, kVoidHeaderSize);
+  if (mkvmuxer::WriteID(writer, mkvmuxer::kMkvVoid) ||
+      mkvmuxer::WriteUIntSize(writer, size - kVoidHeaderSize, 8)) {
+    return false;
+  }
+  const std::vector<uint8_t> zeros(size - kVoidHeaderSize);
+  return zeros.empty() ||
+         writer->Write(zeros.data(), static_cast<uint32_t>(zeros.size())) == 0;
+}
+
 // Cues will be inserted before clusters. All clusters will be shifted down by
 // the size of cues. However, cluster positions affect the size of cues. This
 // function adjusts cues size iteratively until it is stable.
@@ -69,6 +93,13 @@ TwoPassSingleSegmentSegmenter::TwoPassSingleSegmentSegmenter(
 TwoPassSingleSegmentSegmenter::~TwoPassSingleSegmentSegmenter() {}
 
 Status TwoPassSingleSegmentSegmenter::DoInitialize() {
+  if (options().webm_single_pass_single_segment) {
+    bool single_pass = false;
+    RETURN_IF_ERROR(InitializeSinglePass(&single_pass));
+    if (single_pass)
+      return Status::OK;
+  }
+
   // Assume the amount of time to copy the temp file as the same amount
   // of time as to make it.
   set_progress_target(duration() * 2);
@@ -85,6 +116,9 @@ Status TwoPassSingleSegmentSegmenter::DoInitialize() {
 }
 
 Status TwoPassSingleSegmentSegmenter::DoFinalize() {
+  if (reserved_cues_size_ > 0)
+    return FinalizeSinglePass();
+
   const uint64_t header_size = init_end() + 1;
   const uint64_t cues_pos = header_size - segment_payload_pos();
   const uint64_t cues_size = UpdateCues(cues());
@@ -137,6 +171,100 @@ Status TwoPassSingleSegmentSegmenter::DoFinalize() {
   return real_writer->Close();
 }
 
+Status TwoPassSingleSegmentSegmenter::InitializeSinglePass(bool* single_pass) {
+  *single_pass = false;
+  const uint64_t reserved_cues_size = EstimateCuesSize();
+  if (reserved_cues_size == 0) {
+    LOG(WARNING) << "Unable to estimate the size of the Cues of "
+                 << options().output_file_name
+                 << ", falling back to two-pass output.";
+    return Status::OK;
+  }
+
+  std::unique_ptr<MkvWriter> output(new MkvWriter);
+  RETURN_IF_ERROR(output->Open(options().output_file_name));
+  if (!output->Seekable()) {
+    LOG(WARNING) << options().output_file_name
+                 << " is not seekable, falling back to two-pass output.";
+    return output->Close();
+  }
+  set_progress_target(duration());
+  set_writer(std::move(output));
+  RETURN_IF_ERROR(SingleSegmentSegmenter::DoInitialize());
+
+  // Reserve the space for the Cues right after the header; the Clusters
+  // follow it.
+  const uint64_t cues_pos = init_end() + 1 - segment_payload_pos();
+  if (!WriteVoid(writer(), reserved_cues_size))
+    return Status(error::FILE_FAILURE, "Error reserving space for Cues.");
+  seek_head()->set_cues_pos(cues_pos);
+  seek_head()->set_cluster_pos(cues_pos + reserved_cues_size);
+  reserved_cues_size_ = reserved_cues_size;
+  *single_pass = true;
+  return Status::OK;
+}
+
+Status TwoPassSingleSegmentSegmenter::FinalizeSinglePass() {
+  // The Clusters are already in place, so are the Cue point positions.
+  const uint64_t cues_size = cues()->Size();
+  if (cues_size != reserved_cues_size_ &&
+      cues_size + kVoidHeaderSize > reserved_cues_size_) {
+    LOG(WARNING) << "The Cues of " << options().output_file_name << " ("
+                 << cues_size << " bytes) do not fit in the reserved space ("
+                 << reserved_cues_size_
+                 << " bytes), writing them after the Clusters.";
+    // The reserved space stays a Void element.
+    return SingleSegmentSegmenter::DoFinalize();
+  }
+
+  const uint64_t file_size = writer()->Position();
+  const uint64_t header_size = init_end() + 1;
+  writer()->Position(header_size);
+  set_index_start(header_size);
+  if (!cues()->Write(writer()))
+    return Status(error::FILE_FAILURE, "Error writing Cues data.");
+  set_index_end(writer()->Position() - 1);
+  if (cues_size < reserved_cues_size_ &&
+      !WriteVoid(writer(), reserved_cues_size_ - cues_size)) {
+    return Status(error::FILE_FAILURE, "Error writing Void element.");
+  }
+  DCHECK_EQ(writer()->Position(),
+            static_cast<int64_t>(header_size + reserved_cues_size_));
+
+  writer()->Position(0);
+  RETURN_IF_ERROR(WriteSegmentHeader(file_size, writer()));
+  DCHECK_EQ(writer()->Position(), static_cast<int64_t>(header_size));
+  return writer()->Close();
+}
+
+uint64_t TwoPassSingleSegmentSegmenter::EstimateCuesSize() {
+  const double segment_duration = options().segment_duration_in_seconds;
+  if (segment_duration <= 0 || duration() == 0)
+    return 0;
+
+  // |duration()| is in the timescale of the stream; the Cue times are WebM
+  // timecodes in milliseconds.
+  const uint64_t duration_timecode = FromBmffTimestamp(duration());
+  const double estimated_cue_point_count =
+      duration_timecode / 1000.0 / segment_duration;
+  const int cue_point_count =
+      static_cast<int>(std::ceil(estimated_cue_point_count *
+                                 kCuePointCountMarginRatio)) +
+      kExtraCuePointCount;
+
+  // Assume the largest Cluster positions, as the output size is not known.
+  mkvmuxer::Cues estimated_cues;
+  for (int i = 0; i < cue_point_count; ++i) {
+    mkvmuxer::CuePoint* cue_point = new mkvmuxer::CuePoint;
+    cue_point->set_time(duration_timecode);
+    cue_point->set_track(track_id());
+    cue_point->set_cluster_pos(std::numeric_limits<uint64_t>::max());
+    if (!estimated_cues.AddCue(cue_point))
+      return 0;
+  }
+  return estimated_cues.Size() + kVoidHeaderSize;
+}
+
 bool TwoPassSingleSegmentSegmenter::CopyFileWithClusterRewrite(
     File* source,
     MkvWriter* dest,
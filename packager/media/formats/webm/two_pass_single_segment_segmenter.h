@@ -23,6 +23,10 @@ namespace webm {
 
 /// An implementation of a Segmenter for a single-segment that performs two
 /// passes.  This does not use seeking and is used for non-seekable files.
+///
+/// With MuxerOptions::webm_single_pass_single_segment, a seekable output is
+/// instead written in a single pass: space for the Cues, estimated from the
+/// media duration, is reserved in front of the Clusters as a Void element.
 class TwoPassSingleSegmentSegmenter : public SingleSegmentSegmenter {
  public:
   explicit TwoPassSingleSegmentSegmenter(const MuxerOptions& options);
@@ -41,7 +45,20 @@ class TwoPassSingleSegmentSegmenter : public SingleSegmentSegmenter {
                                   MkvWriter* dest,
                                   uint64_t last_size);
 
+  // Opens the output for a single pass and reserves the space for the Cues.
+  // |*single_pass| is set to false, without error, if the output is not
+  // seekable or the size of the Cues cannot be estimated.
+  Status InitializeSinglePass(bool* single_pass);
+  // Writes the Cues to the reserved space, or after the Clusters if they do
+  // not fit, and rewrites the header.
+  Status FinalizeSinglePass();
+  // @return The estimated upper bound of the size of the Cues, including the
+  //         Void element filling the reserved space, or 0 if unknown.
+  uint64_t EstimateCuesSize();
+
   std::string temp_file_name_;
+  // The size of the space reserved for the Cues. Non-zero in single pass.
+  uint64_t reserved_cues_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(TwoPassSingleSegmentSegmenter);
 };
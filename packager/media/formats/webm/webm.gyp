@@ -13,6 +13,8 @@
       'target_name': 'webm',
       'type': '<(component)',
       'sources': [
+        'cluster_writer.cc',
+        'cluster_writer.h',
         'encryptor.cc',
         'encryptor.h',
         'mkv_writer.cc',
@@ -55,6 +57,7 @@
         'webm_webvtt_parser.h'
       ],
       'dependencies': [
+        '../../../metrics/metrics.gyp:metrics',
         '../../../third_party/boringssl/boringssl.gyp:boringssl',
         '../../../third_party/gflags/gflags.gyp:gflags',
         '../../../third_party/libwebm/libwebm.gyp:mkvmuxer',
@@ -10,6 +10,7 @@
 #include "packager/base/logging.h"
 #include "packager/base/sys_byteorder.h"
 #include "packager/media/base/decrypt_config.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/media/base/timestamp.h"
 #include "packager/media/codecs/vp8_parser.h"
 #include "packager/media/codecs/vp9_parser.h"
@@ -175,6 +176,86 @@ bool WebMClusterParser::OnListEnd(int id) {
   return result;
 }
 
+int WebMClusterParser::OnWholeList(int id, const uint8_t* data, int size) {
+  if (id != kWebMIdBlockGroup)
+    return 0;
+
+  // The common BlockGroups, with a Block and possibly a BlockDuration, a
+  // ReferenceBlock and a DiscardPadding, are parsed in place, without copying
+  // the Block. The others, or any malformed element, are parsed element by
+  // element, which reports the errors.
+  const uint8_t* block = nullptr;
+  int block_size = 0;
+  int64_t duration = -1;
+  bool discard_padding_set = false;
+  int64_t discard_padding = 0;
+  bool reference_block_set = false;
+  int pos = 0;
+  while (pos < size) {
+    int element_id = 0;
+    int64_t element_size = 0;
+    const int header_size = WebMParseElementHeader(
+        data + pos, size - pos, &element_id, &element_size);
+    if (header_size <= 0 || element_size > size - pos - header_size)
+      return 0;
+    const uint8_t* element_data = data + pos + header_size;
+    const int element_data_size = static_cast<int>(element_size);
+    switch (element_id) {
+      case kWebMIdBlock:
+        if (block)
+          return 0;
+        block = element_data;
+        block_size = element_data_size;
+        break;
+      case kWebMIdBlockDuration:
+        // Durations not fitting in an int64_t are reported as errors.
+        if (duration != -1 || element_data_size <= 0 ||
+            element_data_size > 8 ||
+            (element_data_size == 8 && (element_data[0] & 0x80) != 0)) {
+          return 0;
+        }
+        duration = 0;
+        for (int i = 0; i < element_data_size; ++i)
+          duration = (duration << 8) | element_data[i];
+        break;
+      case kWebMIdDiscardPadding:
+        if (discard_padding_set || element_data_size <= 0 ||
+            element_data_size > 8) {
+          return 0;
+        }
+        discard_padding_set = true;
+        discard_padding = static_cast<int8_t>(element_data[0]);
+        for (int i = 1; i < element_data_size; ++i)
+          discard_padding = (discard_padding << 8) | element_data[i];
+        break;
+      case kWebMIdReferenceBlock:
+        // A signed integer of 1 to 8 bytes. Other sizes are left to the
+        // element by element parsing.
+        if (element_data_size <= 0 || element_data_size > 8)
+          return 0;
+        reference_block_set = true;
+        break;
+      case kWebMIdCodecState:
+      case kWebMIdVoid:
+      case kWebMIdCRC32:
+        break;
+      default:
+        return 0;
+    }
+    pos += header_size + element_data_size;
+  }
+
+  if (!block) {
+    LOG(ERROR) << "Block missing from BlockGroup.";
+    return -1;
+  }
+  if (!ParseBlock(false, block, block_size, NULL, 0, duration,
+                  discard_padding, reference_block_set)) {
+    return -1;
+  }
+  return size;
+}
+
 bool WebMClusterParser::OnUInt(int id, int64_t val) {
   int64_t* dst;
   switch (id) {
@@ -392,8 +473,8 @@ bool WebMClusterParser::OnBlock(bool is_simple_block,
         buffer->set_decrypt_config(std::move(decrypt_config));
         buffer->set_is_encrypted(true);
       } else {
-        std::shared_ptr<uint8_t> decrypted_media_data(
-            new uint8_t[media_data_size], std::default_delete<uint8_t[]>());
+        std::shared_ptr<uint8_t> decrypted_media_data =
+            SampleBufferPool::GetDefault()->Allocate(media_data_size);
         if (!decryptor_source_->DecryptSampleBuffer(
                 decrypt_config.get(), media_data, media_data_size,
                 decrypted_media_data.get())) {
@@ -402,6 +483,10 @@ bool WebMClusterParser::OnBlock(bool is_simple_block,
         }
         buffer->TransferData(std::move(decrypted_media_data), media_data_size);
       }
+    } else if (byte_queue_ &&
+               byte_queue_->Contains(media_data, media_data_size)) {
+      // Reference the frame in the queue rather than copying it.
+      buffer->TransferData(byte_queue_->Share(media_data), media_data_size);
     } else {
       buffer->SetData(media_data, media_data_size);
     }
@@ -12,6 +12,7 @@
 #include <string>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/media/base/byte_queue.h"
 #include "packager/media/base/decryptor_source.h"
 #include "packager/media/base/media_parser.h"
 #include "packager/media/base/media_sample.h"
@@ -153,10 +154,18 @@ class WebMClusterParser : public WebMParserClient {
   /// @return true if the last Parse() call stopped at the end of a cluster.
   bool cluster_ended() const { return cluster_ended_; }
 
+  /// Let the samples reference the frames parsed from the data queued in
+  /// @a byte_queue rather than copy them.
+  /// @param byte_queue holds the data passed to Parse(). May be NULL.
+  void set_byte_queue(const ByteQueue* byte_queue) {
+    byte_queue_ = byte_queue;
+  }
+
  private:
   // WebMParserClient methods.
   WebMParserClient* OnListStart(int id) override;
   bool OnListEnd(int id) override;
+  int OnWholeList(int id, const uint8_t* data, int size) override;
   bool OnUInt(int id, int64_t val) override;
   bool OnBinary(int id, const uint8_t* data, int size) override;
 
@@ -199,6 +208,8 @@ class WebMClusterParser : public WebMParserClient {
   std::string video_encryption_key_id_;
 
   WebMListParser parser_;
+  // Not owned.
+  const ByteQueue* byte_queue_ = nullptr;
 
   // Indicates whether init_cb has been executed. |init_cb| is executed when we
   // have codec configuration of video stream, which is extracted from the first
@@ -666,6 +666,53 @@ TEST_F(WebMClusterParserTest, ParseBlockGroup) {
   ASSERT_TRUE(VerifyBuffers(kBlockInfo, block_count));
 }
 
+// A BlockGroup available as a whole is parsed in place, which must support
+// the ReferenceBlock and the Void elements too.
+TEST_F(WebMClusterParserTest, ParseBlockGroupWithReferenceBlock) {
+  const BlockInfo kBlockInfo[] = {
+      {kVideoTrackNum, 0, 34, false, NULL, 0, false},
+  };
+  int block_count = arraysize(kBlockInfo);
+
+  const uint8_t kClusterData[] = {
+    0x1F, 0x43, 0xB6, 0x75, 0x95,  // Cluster(size=21)
+    0xE7, 0x81, 0x00,  // Timecode(size=1, value=0)
+    0xA0, 0x90,  // BlockGroup(size=16)
+    0xA1, 0x85, 0x82, 0x00, 0x00, 0x00, 0x55,  // Block(size=5, track=2, ts=0)
+    0x9B, 0x81, 0x22,  // BlockDuration(size=1, value=34)
+    0xFB, 0x81, 0xFF,  // ReferenceBlock(size=1, value=-1)
+    0xEC, 0x81, 0x00,  // Void(size=1)
+  };
+  const int kClusterSize = arraysize(kClusterData);
+
+  int result = parser_->Parse(kClusterData, kClusterSize);
+  EXPECT_EQ(kClusterSize, result);
+  ASSERT_TRUE(VerifyBuffers(kBlockInfo, block_count));
+}
+
+// A ReferenceBlock of an invalid size is not parsed in place, but as before.
+TEST_F(WebMClusterParserTest, ParseBlockGroupWithLongReferenceBlock) {
+  const BlockInfo kBlockInfo[] = {
+      {kVideoTrackNum, 0, 34, false, NULL, 0, false},
+  };
+  int block_count = arraysize(kBlockInfo);
+
+  const uint8_t kClusterData[] = {
+    0x1F, 0x43, 0xB6, 0x75, 0x9A,  // Cluster(size=26)
+    0xE7, 0x81, 0x00,  // Timecode(size=1, value=0)
+    0xA0, 0x95,  // BlockGroup(size=21)
+    0xA1, 0x85, 0x82, 0x00, 0x00, 0x00, 0x55,  // Block(size=5, track=2, ts=0)
+    0x9B, 0x81, 0x22,  // BlockDuration(size=1, value=34)
+    0xFB, 0x89, 0xFF, 0xFF, 0xFF, 0xFF,  // ReferenceBlock(size=9)
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  };
+  const int kClusterSize = arraysize(kClusterData);
+
+  int result = parser_->Parse(kClusterData, kClusterSize);
+  EXPECT_EQ(kClusterSize, result);
+  ASSERT_TRUE(VerifyBuffers(kBlockInfo, block_count));
+}
+
 TEST_F(WebMClusterParserTest, ParseSimpleBlockAndBlockGroupMixture) {
   const BlockInfo kBlockInfo[] = {
       {kAudioTrackNum, 0, 23, true, NULL, 0, false},
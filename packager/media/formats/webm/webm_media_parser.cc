@@ -215,6 +215,7 @@ int WebMMediaParser::ParseInfoAndTracks(const uint8_t* data, int size) {
       tracks_parser.audio_encryption_key_id(),
       tracks_parser.video_encryption_key_id(), new_sample_cb_, init_cb_,
       decryption_key_source_));
+  cluster_parser_->set_byte_queue(&byte_queue_);
 
   return bytes_parsed;
 }
@@ -430,6 +430,19 @@ static const ListElementInfo kListElementInfo[] = {
   LIST_ELEMENT_INFO(kWebMIdSimpleTag, 3, kSimpleTagIds),
 };
 
+// |value| should not be zero.
+static int CountLeadingZeros(uint8_t value) {
+  DCHECK_NE(value, 0u);
+#if defined(__GNUC__)
+  return __builtin_clz(value) - 24;
+#else
+  int num_zeros = 0;
+  for (int mask = 0x80; (value & mask) == 0; mask >>= 1)
+    ++num_zeros;
+  return num_zeros;
+#endif
+}
+
 // Parses an element header id or size field. These fields are variable length
 // encoded. The first byte indicates how many bytes the field occupies.
 // |buf|  - The buffer to parse.
@@ -457,23 +470,17 @@ static int ParseWebMElementHeaderField(const uint8_t* buf,
   if (size == 0)
     return 0;
 
-  int mask = 0x80;
   uint8_t ch = buf[0];
-  int extra_bytes = -1;
-  bool all_ones = false;
-  for (int i = 0; i < max_bytes; ++i) {
-    if ((ch & mask) != 0) {
-      mask = ~mask & 0xff;
-      *num = mask_first_byte ? ch & mask : ch;
-      all_ones = (ch & mask) == mask;
-      extra_bytes = i;
-      break;
-    }
-    mask = 0x80 | mask >> 1;
-  }
-
-  if (extra_bytes == -1)
+  // The number of leading zeros of the first byte is the number of bytes
+  // following it.
+  if (ch == 0)
+    return -1;
+  const int extra_bytes = CountLeadingZeros(ch);
+  if (extra_bytes >= max_bytes)
     return -1;
+  const int mask = 0xff >> (extra_bytes + 1);
+  *num = mask_first_byte ? ch & mask : ch;
+  bool all_ones = (ch & mask) == mask;
 
   // Return 0 if we need more data.
   if ((1 + extra_bytes) > size)
@@ -699,6 +706,10 @@ bool WebMParserClient::OnListEnd(int id) {
   return false;
 }
 
+int WebMParserClient::OnWholeList(int id, const uint8_t* data, int size) {
+  return 0;
+}
+
 bool WebMParserClient::OnUInt(int id, int64_t val) {
   DVLOG(1) << "Unexpected unsigned integer element with ID " << std::hex << id;
   return false;
@@ -871,6 +882,23 @@ int WebMListParser::ParseListElement(int header_size,
   }
 
   if (id_type == LIST) {
+    // A list whose whole content is available may be parsed by the client at
+    // once, e.g. a BlockGroup, which is as frequent as the frames.
+    if (element_size > 0 && size >= element_size) {
+      const int whole_list_result = list_state.client_->OnWholeList(
+          id, data, static_cast<int>(element_size));
+      if (whole_list_result < 0)
+        return -1;
+      if (whole_list_result > 0) {
+        DCHECK_EQ(whole_list_result, element_size);
+        const int result = header_size + whole_list_result;
+        list_state.bytes_parsed_ += result;
+        if (list_state.bytes_parsed_ == list_state.size_ && !OnListEnd())
+          return -1;
+        return result;
+      }
+    }
+
     list_state.bytes_parsed_ += header_size;
 
     if (!OnListStart(id, element_size))
@@ -33,6 +33,13 @@ class WebMParserClient {
 
   virtual WebMParserClient* OnListStart(int id);
   virtual bool OnListEnd(int id);
+  /// Called before OnListStart() for a child list whose whole content is
+  /// available, so the client can parse it at once instead of receiving the
+  /// calls of its elements, e.g. for the lists as frequent as the frames.
+  /// @param data is the content of the list, without its header.
+  /// @return @a size if the list is parsed, 0 to parse it element by element
+  ///         or < 0 on error.
+  virtual int OnWholeList(int id, const uint8_t* data, int size);
   virtual bool OnUInt(int id, int64_t val);
   virtual bool OnFloat(int id, double val);
   virtual bool OnBinary(int id, const uint8_t* data, int size);
@@ -13,7 +13,7 @@
 namespace shaka {
 namespace media {
 
-LineReader::LineReader() : should_flush_(false) {}
+LineReader::LineReader() : scanned_size_(0), should_flush_(false) {}
 
 void LineReader::PushData(const uint8_t* data, size_t data_size) {
   buffer_.Push(data, static_cast<int>(data_size));
@@ -29,7 +29,7 @@ bool LineReader::Next(std::string* out) {
   const uint8_t* data;
   int data_size;
   buffer_.Peek(&data, &data_size);
-  for (i = 0; i < data_size; i++) {
+  for (i = scanned_size_; i < data_size; i++) {
     // Handle \n
     if (data[i] == '\n') {
       skip = 1;
@@ -41,8 +41,10 @@ bool LineReader::Next(std::string* out) {
       // Only read if we can see the next character; this ensures we don't get
       // the '\n' in the next PushData.
       if (i + 1 == data_size) {
-        if (!should_flush_)
+        if (!should_flush_) {
+          scanned_size_ = i;
           return false;
+        }
         skip = 1;
       } else {
         if (data[i + 1] == '\n')
@@ -55,12 +57,14 @@ bool LineReader::Next(std::string* out) {
   }
 
   if (i == data_size && (!should_flush_ || i == 0)) {
+    scanned_size_ = i;
     return false;
   }
 
   // TODO(modmaker): Handle character encodings?
   out->assign(data, data + i);
   buffer_.Pop(i + skip);
+  scanned_size_ = 0;
   return true;
 }
 
@@ -68,7 +72,7 @@ void LineReader::Flush() {
   should_flush_ = true;
 }
 
-BlockReader::BlockReader() : should_flush_(false) {}
+BlockReader::BlockReader() : num_lines_(0), should_flush_(false) {}
 
 void BlockReader::PushData(const uint8_t* data, size_t data_size) {
   source_.PushData(data, data_size);
@@ -81,22 +85,32 @@ bool BlockReader::Next(std::vector<std::string>* out) {
   bool end_block = false;
   // Read through lines until a non-empty line is found. With a non-empty
   // line is found, start adding the lines to the output and once an empty
-  // line if found again, stop adding lines and exit.
-  std::string line;
-  while (source_.Next(&line)) {
-    if (!temp_.empty() && line.empty()) {
+  // line if found again, stop adding lines and exit. The lines are read into
+  // the strings left from previous blocks, to reuse their storage.
+  while (true) {
+    if (num_lines_ == temp_.size())
+      temp_.emplace_back();
+    std::string* line = &temp_[num_lines_];
+    if (!source_.Next(line))
+      break;
+    if (num_lines_ > 0 && line->empty()) {
       end_block = true;
       break;
     }
-    if (!line.empty()) {
-      temp_.emplace_back(std::move(line));
-    }
+    if (!line->empty())
+      ++num_lines_;
   }
 
-  if (!end_block && (!should_flush_ || temp_.empty()))
+  if (!end_block && (!should_flush_ || num_lines_ == 0))
     return false;
 
-  *out = std::move(temp_);
+  // Hand the lines out, and take the strings of the previous block in return
+  // along with the spare ones.
+  out->swap(temp_);
+  for (size_t i = num_lines_; i < out->size(); ++i)
+    temp_.emplace_back(std::move((*out)[i]));
+  out->resize(num_lines_);
+  num_lines_ = 0;
   return true;
 }
 
@@ -37,6 +37,9 @@ class LineReader {
   LineReader operator=(const LineReader&) = delete;
 
   ByteQueue buffer_;
+  // Number of bytes at the front of |buffer_| already scanned for a line
+  // terminator, so a line pushed in pieces is not scanned again each time.
+  int scanned_size_;
   bool should_flush_;
 };
 
@@ -46,7 +49,8 @@ class BlockReader {
 
   /// Pushes data onto the end of the buffer.
   void PushData(const uint8_t* data, size_t data_size);
-  /// Reads the next block from the buffer.
+  /// Reads the next block from the buffer. The strings previously in @a out
+  /// are recycled to hold the lines of the following blocks.
   /// @return True if a block is read, false if there is no block in the buffer.
   bool Next(std::vector<std::string>* out);
   /// Indicates that no more data is coming and that calls to Next should
@@ -58,7 +62,10 @@ class BlockReader {
   BlockReader operator=(const BlockReader&) = delete;
 
   LineReader source_;
+  // The lines of the current block are the first |num_lines_| strings; the
+  // rest are kept to be reused.
   std::vector<std::string> temp_;
+  size_t num_lines_;
   bool should_flush_;
 };
 
@@ -178,5 +178,48 @@ TEST(TextReadersTest, ReadBlocksMultipleReads) {
   EXPECT_THAT(block, ElementsAre("block 1", "block 2"));
 }
 
+TEST(TextReadersTest, ReadLinesPushedByteByByte) {
+  const uint8_t text[] = "line 1\r\nline 2\rline 3\n";
+
+  LineReader reader;
+  std::vector<std::string> lines;
+  std::string s;
+  for (size_t i = 0; i < sizeof(text) - 1; i++) {
+    reader.PushData(text + i, 1);
+    while (reader.Next(&s))
+      lines.push_back(s);
+  }
+  reader.Flush();
+  ASSERT_FALSE(reader.Next(&s));
+
+  EXPECT_THAT(lines, ElementsAre("line 1", "line 2", "line 3"));
+}
+
+TEST(TextReadersTest, ReadBlocksIntoReusedVector) {
+  const uint8_t text[] =
+      "block 1 line 1\n"
+      "block 1 line 2\n"
+      "block 1 line 3\n"
+      "\n"
+      "block 2\n"
+      "\n"
+      "block 3 line 1\n"
+      "block 3 line 2\n";
+
+  BlockReader reader;
+  reader.PushData(text, sizeof(text) - 1);
+  reader.Flush();
+
+  std::vector<std::string> block;
+  ASSERT_TRUE(reader.Next(&block));
+  EXPECT_THAT(block, ElementsAre("block 1 line 1", "block 1 line 2",
+                                 "block 1 line 3"));
+  ASSERT_TRUE(reader.Next(&block));
+  EXPECT_THAT(block, ElementsAre("block 2"));
+  ASSERT_TRUE(reader.Next(&block));
+  EXPECT_THAT(block, ElementsAre("block 3 line 1", "block 3 line 2"));
+  ASSERT_FALSE(reader.Next(&block));
+}
+
 }  // namespace media
 }  // namespace shaka
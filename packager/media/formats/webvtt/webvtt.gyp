@@ -30,6 +30,7 @@
       ],
       'dependencies': [
         '../../../base/base.gyp:base',
+        '../../../metrics/metrics.gyp:metrics',
         '../../base/media_base.gyp:media_base',
         '../../formats/mp4/mp4.gyp:mp4',
         '../../origin/origin.gyp:origin',
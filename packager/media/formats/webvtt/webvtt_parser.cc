@@ -110,29 +110,27 @@ bool WebVttParser::Parse(const uint8_t* buf, int size) {
 
 bool WebVttParser::Parse() {
   if (!initialized_) {
-    std::vector<std::string> block;
-    if (!reader_.Next(&block)) {
+    if (!reader_.Next(&block_)) {
       return true;
     }
 
     // Check the header. It is possible for a 0xFEFF BOM to come before the
     // header text.
-    if (block.size() != 1) {
+    if (block_.size() != 1) {
       LOG(ERROR) << "Failed to read WEBVTT header - "
-                 << "block size should be 1 but was " << block.size() << ".";
+                 << "block size should be 1 but was " << block_.size() << ".";
       return false;
     }
-    if (block[0] != "WEBVTT" && block[0] != "\xEF\xBB\xBFWEBVTT") {
+    if (block_[0] != "WEBVTT" && block_[0] != "\xEF\xBB\xBFWEBVTT") {
       LOG(ERROR) << "Failed to read WEBVTT header - should be WEBVTT but was "
-                 << block[0];
+                 << block_[0];
       return false;
     }
     initialized_ = true;
   }
 
-  std::vector<std::string> block;
-  while (reader_.Next(&block)) {
-    if (!ParseBlock(block))
+  while (reader_.Next(&block_)) {
+    if (!ParseBlock(block_))
       return false;
   }
   return true;
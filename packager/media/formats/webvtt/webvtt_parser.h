@@ -43,6 +43,8 @@ class WebVttParser : public MediaParser {
   NewTextSampleCB new_text_sample_cb_;
 
   BlockReader reader_;
+  // The block being parsed, kept to reuse the storage of its lines.
+  std::vector<std::string> block_;
   std::string style_region_config_;
   bool saw_cue_ = false;
   bool stream_info_dispatched_ = false;
@@ -12,6 +12,7 @@
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -28,7 +29,9 @@ WebVttTextOutputHandler::WebVttTextOutputHandler(
     const MuxerOptions& muxer_options,
     std::unique_ptr<MuxerListener> muxer_listener)
     : muxer_options_(muxer_options),
-      muxer_listener_(std::move(muxer_listener)) {}
+      muxer_listener_(std::move(muxer_listener)),
+      segment_index_(muxer_options.first_segment_index),
+      number_from_timeline_(muxer_options.segment_number_from_timeline) {}
 
 Status WebVttTextOutputHandler::InitializeInternal() {
   return Status::OK;
@@ -78,6 +81,7 @@ Status WebVttTextOutputHandler::OnStreamInfo(const StreamInfo& info) {
                            ToString(info.codec_config())));
   muxer_listener_->OnMediaStart(muxer_options_, info, info.time_scale(),
                                 MuxerListener::kContainerText);
+  time_scale_ = info.time_scale();
   return Status::OK;
 }
 
@@ -85,6 +89,12 @@ Status WebVttTextOutputHandler::OnSegmentInfo(const SegmentInfo& info) {
   total_duration_ms_ += info.duration;
 
   const std::string& segment_template = muxer_options_.segment_template;
+  if (number_from_timeline_) {
+    segment_index_ =
+        GetTimelineSegmentIndex(muxer_options_.segment_duration_in_seconds,
+                                info.start_timestamp, time_scale_);
+    number_from_timeline_ = false;
+  }
   const uint32_t index = segment_index_++;
   const uint64_t start = info.start_timestamp;
   const uint64_t duration = info.duration;
@@ -104,7 +114,12 @@ Status WebVttTextOutputHandler::OnSegmentInfo(const SegmentInfo& info) {
   buffer_->WriteTo(file.get());
   buffer_->Reset();
 
-  if (!file.release()->Close()) {
+  bool closed = false;
+  {
+    ScopedTraceEvent trace_event("CloseSegmentFile", "io");
+    closed = file.release()->Close();
+  }
+  if (!closed) {
     return Status(error::FILE_FAILURE, "Failed to close " + filename);
   }
 
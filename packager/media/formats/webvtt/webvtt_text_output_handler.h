@@ -48,6 +48,10 @@ class WebVttTextOutputHandler : public MediaHandler {
   // Sum together all segment durations so we know how long the stream is.
   uint64_t total_duration_ms_ = 0;
   uint32_t segment_index_ = 0;
+  uint32_t time_scale_ = 0;
+  // Whether |segment_index_| is still to be derived from the start time of
+  // the first segment, see MuxerOptions::segment_number_from_timeline.
+  bool number_from_timeline_ = false;
 
   std::unique_ptr<WebVttFileBuffer> buffer_;
 };
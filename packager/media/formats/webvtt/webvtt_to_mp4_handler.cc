@@ -7,11 +7,9 @@
 #include "packager/media/formats/webvtt/webvtt_to_mp4_handler.h"
 
 #include <algorithm>
-#include <map>
 
 #include "packager/media/base/buffer_writer.h"
-#include "packager/media/formats/mp4/box_buffer.h"
-#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/base/fourccs.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -19,72 +17,58 @@ namespace media {
 namespace {
 size_t kTrackId = 0;
 
-enum class DisplayActionType { ADD, REMOVE };
+const size_t kBoxHeaderSize = 8;
+// The 'vtte' box has no payload, so it is always the same.
+const uint8_t kEmptyCueBox[] = {0, 0, 0, 8, 'v', 't', 't', 'e'};
 
-struct DisplayAction {
-  DisplayActionType type;
-  const TextSample* sample;
-};
-
-std::multimap<int64_t, DisplayAction> CreateActionList(
-    int64_t segment_start,
-    int64_t segment_end,
-    const std::list<std::shared_ptr<const TextSample>>& samples) {
-  std::multimap<int64_t, DisplayAction> actions;
-
-  for (const auto& sample : samples) {
-    DCHECK(sample);
+size_t ComputeStringBoxSize(const std::string& value) {
+  return value.empty() ? 0 : kBoxHeaderSize + value.size();
+}
 
-    // The add action should occur either in this segment or in a previous
-    // segment.
-    DCHECK_LT(sample->start_time(), segment_end);
-    actions.insert(
-        {sample->start_time(), {DisplayActionType::ADD, sample.get()}});
-
-    // If the remove happens in a later segment, then we don't want to include
-    // that action.
-    if (sample->EndTime() < segment_end) {
-      actions.insert(
-          {sample->EndTime(), {DisplayActionType::REMOVE, sample.get()}});
-    }
-  }
+void WriteBoxHeader(FourCC type, size_t box_size, BufferWriter* out) {
+  out->AppendInt(static_cast<uint32_t>(box_size));
+  out->AppendInt(static_cast<uint32_t>(type));
+}
 
-  return actions;
+void WriteStringBox(FourCC type, const std::string& value, BufferWriter* out) {
+  WriteBoxHeader(type, kBoxHeaderSize + value.size(), out);
+  out->AppendString(value);
 }
 
+// Writes the 'vttc' box of |sample| straight from its strings, with the same
+// layout as mp4::VTTCueBox: the optional 'iden' and 'sttg' boxes, then the
+// 'payl' box.
 void WriteSample(const TextSample& sample, BufferWriter* out) {
-  mp4::VTTCueBox box;
-
-  if (sample.id().length()) {
-    box.cue_id.cue_id = sample.id();
-  }
-  if (sample.settings().length()) {
-    box.cue_settings.settings = sample.settings();
-  }
-  if (sample.payload().length()) {
-    box.cue_payload.cue_text = sample.payload();
-  }
+  const size_t box_size = kBoxHeaderSize + ComputeStringBoxSize(sample.id()) +
+                          ComputeStringBoxSize(sample.settings()) +
+                          kBoxHeaderSize + sample.payload().size();
+  WriteBoxHeader(FOURCC_vttc, box_size, out);
+  if (!sample.id().empty())
+    WriteStringBox(FOURCC_iden, sample.id(), out);
+  if (!sample.settings().empty())
+    WriteStringBox(FOURCC_sttg, sample.settings(), out);
+  WriteStringBox(FOURCC_payl, sample.payload(), out);
 
   // If there is internal timing, i.e. WebVTT cue timestamp, then
   // cue_current_time should be populated
   // "which gives the VTT timestamp associated with the start time of sample."
   // TODO(rkuroiwa): Reuse TimestampToMilliseconds() to check if there is an
   // internal timestamp in the payload to set CueTimeBox.cue_current_time.
-  box.Write(out);
 }
 
-void WriteSamples(const std::list<const TextSample*>& samples,
+void WriteSamples(const std::vector<const TextSample*>& samples,
                   BufferWriter* writer) {
-  DCHECK_GE(samples.size(), 0u);
-
-  for (const auto& sample : samples) {
+  for (const TextSample* sample : samples) {
     WriteSample(*sample, writer);
   }
 }
 
 void WriteEmptySample(BufferWriter* writer) {
-  mp4::VTTEmptyCueBox box;
-  box.Write(writer);
+  writer->AppendArray(kEmptyCueBox, sizeof(kEmptyCueBox));
+}
+
+bool StartsBefore(const TextSample* a, const TextSample* b) {
+  return a->start_time() < b->start_time();
 }
 
 std::shared_ptr<MediaSample> CreateMediaSample(const BufferWriter& buffer,
@@ -185,63 +169,68 @@ Status WebVttToMp4Handler::OnTextSample(
 
 Status WebVttToMp4Handler::DispatchCurrentSegment(int64_t segment_start,
                                                   int64_t segment_end) {
+  // The samples in the order they go on screen. They normally arrive in that
+  // order already, in which case they are not sorted again. Samples which
+  // start at the same time keep their order.
+  segment_samples_.clear();
+  for (const auto& sample : current_segment_) {
+    DCHECK(sample);
+    // The sample should start either in this segment or in a previous
+    // segment.
+    DCHECK_LT(sample->start_time(), segment_end);
+    segment_samples_.push_back(sample.get());
+  }
+  if (!std::is_sorted(segment_samples_.begin(), segment_samples_.end(),
+                      StartsBefore)) {
+    std::stable_sort(segment_samples_.begin(), segment_samples_.end(),
+                     StartsBefore);
+  }
+
   // Active will hold all the samples that are "on screen" for the current
   // section of time.
-  std::list<const TextSample*> active;
-
-  // Move through the segment, jumping between each change to the current state.
-  // A change is defined as a group of one or more DisplayActions.
-  int section_start = segment_start;
+  active_samples_.clear();
+  auto next = segment_samples_.begin();
 
-  // |actions| is a map of [time] -> [action].
-  auto actions = CreateActionList(segment_start, segment_end, current_segment_);
-  auto front = actions.begin();
+  // Move through the segment in a single sweep, jumping between each change
+  // to the current state, i.e. one or more samples starting or ending.
+  int64_t section_start = segment_start;
 
   // As it is possible to have a segment with no samples, we can't base this
-  // loop on the number of actions. So we need to keep iterating until we
+  // loop on the number of samples. So we need to keep iterating until we
   // have written enough sections to get to the end of the segment.
   while (section_start < segment_end) {
-    // Apply all actions that occur at the start of this part of the segment.
-    // Normally we would only want "== section_start" but as it is possible for
-    // samples to span multiple segments, their start time will be before the
-    // segment's start time. So we want to apply them too if they come before
-    // the segment. Thus why we use "<=".
-    while (front != actions.end() && front->first <= section_start) {
-      auto& action = front->second;
-
-      switch (action.type) {
-        case DisplayActionType::ADD: {
-          active.push_back(action.sample);
-          break;
-        }
-        case DisplayActionType::REMOVE: {
-          auto found = std::find(active.begin(), active.end(), action.sample);
-          DCHECK(found != active.end());
-          active.erase(found);
-          break;
-        }
-        default: {
-          NOTREACHED() << "Unsupported DisplayActionType "
-                       << static_cast<int>(action.type);
-          break;
-        }
-      }
-
-      // We have "consumed" the action at the front. We can move on.
-      front++;
+    // Add the samples which start at the start of this part of the segment.
+    // As it is possible for samples to span multiple segments, their start
+    // time will be before the segment's start time, so add them too.
+    while (next != segment_samples_.end() &&
+           (*next)->start_time() <= section_start) {
+      active_samples_.push_back(*next);
+      ++next;
     }
-
-    // The end of the section will either be the start of the next section or
-    // the end of the segment.
-    int64_t section_end = front == actions.end() ? segment_end : front->first;
+    // Remove the samples which have ended.
+    active_samples_.erase(
+        std::remove_if(active_samples_.begin(), active_samples_.end(),
+                       [section_start](const TextSample* sample) {
+                         return sample->EndTime() <= section_start;
+                       }),
+        active_samples_.end());
+
+    // The end of the section will either be the next start or end of a
+    // sample, or the end of the segment.
+    int64_t section_end = segment_end;
+    if (next != segment_samples_.end())
+      section_end = std::min(section_end, (*next)->start_time());
+    for (const TextSample* sample : active_samples_)
+      section_end = std::min(section_end, sample->EndTime());
     DCHECK_GT(section_end, section_start);
-    DCHECK_LE(section_end, segment_end);
-    RETURN_IF_ERROR(MergeDispatchSamples(section_start, section_end, active));
+    RETURN_IF_ERROR(
+        MergeDispatchSamples(section_start, section_end, active_samples_));
 
     section_start = section_end;
   }
 
-  DCHECK(front == actions.end()) << "We should have processed all actions.";
+  DCHECK(next == segment_samples_.end())
+      << "We should have processed all samples.";
 
   return Status::OK;
 }
@@ -249,7 +238,7 @@ Status WebVttToMp4Handler::DispatchCurrentSegment(int64_t segment_start,
 Status WebVttToMp4Handler::MergeDispatchSamples(
     int64_t start_time,
     int64_t end_time,
-    const std::list<const TextSample*>& state) {
+    const std::vector<const TextSample*>& state) {
   DCHECK_GT(end_time, start_time);
 
   box_writer_.Clear();
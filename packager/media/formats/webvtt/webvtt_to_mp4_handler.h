@@ -11,6 +11,7 @@
 
 #include <list>
 #include <queue>
+#include <vector>
 
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_handler.h"
@@ -41,9 +42,13 @@ class WebVttToMp4Handler : public MediaHandler {
   Status DispatchCurrentSegment(int64_t segment_start, int64_t segment_end);
   Status MergeDispatchSamples(int64_t start_in_seconds,
                               int64_t end_in_seconds,
-                              const std::list<const TextSample*>& state);
+                              const std::vector<const TextSample*>& state);
 
   std::list<std::shared_ptr<const TextSample>> current_segment_;
+  // The samples of the current segment by start time, and those on screen,
+  // kept across segments to reuse their storage.
+  std::vector<const TextSample*> segment_samples_;
+  std::vector<const TextSample*> active_samples_;
 
   // This is the current state of the box we are writing.
   BufferWriter box_writer_;
@@ -7,7 +7,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/webvtt/webvtt_to_mp4_handler.h"
 #include "packager/status_test_util.h"
 
@@ -50,6 +52,13 @@ MATCHER_P(MediaSampleContainsId, id, "") {
   return s.find(id) != std::string::npos;
 }
 
+MATCHER_P(MediaSampleDataIs, data, "") {
+  auto& sample = arg->media_sample;
+  return sample && std::vector<uint8_t>(sample->data(),
+                                        sample->data() + sample->data_size()) ==
+                       data;
+}
+
 class WebVttToMp4HandlerTest : public MediaHandlerTestBase {
  protected:
   Status SetUpTestGraph() {
@@ -697,5 +706,134 @@ TEST_F(WebVttToMp4HandlerTest, CrossSegmentSamples) {
   ASSERT_OK(DispatchSegment(kSegment2Start, kSegment2End));
   ASSERT_OK(Flush());
 }
+// Verify that the cues are written as 'vttc' boxes, and the gaps as 'vtte'
+// boxes.
+//
+// |[-- SEGMENT ------------]|
+// |         [--- SAMPLE ---]|
+// |[- GAP -]                |
+//
+TEST_F(WebVttToMp4HandlerTest, CueBoxes) {
+  const int64_t kSegmentStart = 0;
+  const int64_t kSegmentEnd = 10000;
+  const int64_t kSegmentDuration = kSegmentEnd - kSegmentStart;
+
+  const int64_t kGapStart = kSegmentStart;
+  const int64_t kGapEnd = kGapStart + 200;
+  const int64_t kGapDuration = kGapEnd - kGapStart;
+
+  const int64_t kSampleStart = kGapEnd;
+  const int64_t kSampleEnd = kSegmentEnd;
+  const int64_t kSampleDuration = kSampleEnd - kSampleStart;
+
+  BufferWriter gap_writer;
+  mp4::VTTEmptyCueBox empty_cue_box;
+  empty_cue_box.Write(&gap_writer);
+  const std::vector<uint8_t> kGapData(gap_writer.Buffer(),
+                                      gap_writer.Buffer() + gap_writer.Size());
+
+  BufferWriter sample_writer;
+  mp4::VTTCueBox cue_box;
+  cue_box.cue_id.cue_id = kId1;
+  cue_box.cue_payload.cue_text = kSimplePayload;
+  cue_box.Write(&sample_writer);
+  const std::vector<uint8_t> kSampleData(
+      sample_writer.Buffer(), sample_writer.Buffer() + sample_writer.Size());
+
+  ASSERT_OK(SetUpTestGraph());
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Out(), OnProcess(IsStreamInfo(kStreamIndex, _, _, _)));
+
+    // Gap
+    EXPECT_CALL(*Out(), OnProcess(AllOf(
+                            IsMediaSample(kStreamIndex, kGapStart,
+                                          kGapDuration, !kEncrypted, _),
+                            MediaSampleDataIs(kGapData))));
+    // Sample
+    EXPECT_CALL(*Out(), OnProcess(AllOf(
+                            IsMediaSample(kStreamIndex, kSampleStart,
+                                          kSampleDuration, !kEncrypted, _),
+                            MediaSampleDataIs(kSampleData))));
+    // Segment
+    EXPECT_CALL(*Out(), OnProcess(IsSegmentInfo(kStreamIndex, kSegmentStart,
+                                                kSegmentDuration, !kSubSegment,
+                                                !kEncrypted)));
+
+    EXPECT_CALL(*Out(), OnFlush(kStreamIndex));
+  }
+
+  ASSERT_OK(DispatchStream());
+  ASSERT_OK(DispatchText(kId1, kSimplePayload, kSampleStart, kSampleEnd));
+  ASSERT_OK(DispatchSegment(kSegmentStart, kSegmentEnd));
+  ASSERT_OK(Flush());
+}
+
+// Verify that samples which do not arrive in the order of their start times
+// are grouped as if they did.
+//
+// |[-- SEGMENT ------------------]|
+// |[-- SAMPLE (2nd) --]           |
+// |         [-- SAMPLE (1st) ----]|
+//
+TEST_F(WebVttToMp4HandlerTest, OutOfOrderSamples) {
+  const int64_t kSegmentStart = 0;
+  const int64_t kSegmentEnd = 10000;
+  const int64_t kSegmentDuration = kSegmentEnd - kSegmentStart;
+
+  const int64_t kSample1Start = kSegmentStart;
+  const int64_t kSample1End = kSegmentEnd - 3000;
+
+  const int64_t kSample2Start = kSegmentStart + 3000;
+  const int64_t kSample2End = kSegmentEnd;
+
+  ASSERT_OK(SetUpTestGraph());
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Out(), OnProcess(IsStreamInfo(kStreamIndex, _, _, _)));
+
+    // Sample 1
+    EXPECT_CALL(*Out(), OnProcess(AllOf(
+                            IsMediaSample(kStreamIndex, kSample1Start,
+                                          kSample2Start - kSample1Start,
+                                          !kEncrypted, _),
+                            MediaSampleContainsId(kId1),
+                            Not(MediaSampleContainsId(kId2)))));
+
+    // Sample 1 and Sample 2
+    EXPECT_CALL(*Out(), OnProcess(AllOf(
+                            IsMediaSample(kStreamIndex, kSample2Start,
+                                          kSample1End - kSample2Start,
+                                          !kEncrypted, _),
+                            MediaSampleContainsId(kId1),
+                            MediaSampleContainsId(kId2))));
+
+    // Sample 2
+    EXPECT_CALL(*Out(), OnProcess(AllOf(
+                            IsMediaSample(kStreamIndex, kSample1End,
+                                          kSample2End - kSample1End,
+                                          !kEncrypted, _),
+                            Not(MediaSampleContainsId(kId1)),
+                            MediaSampleContainsId(kId2))));
+
+    // Segment
+    EXPECT_CALL(*Out(), OnProcess(IsSegmentInfo(kStreamIndex, kSegmentStart,
+                                                kSegmentDuration, !kSubSegment,
+                                                !kEncrypted)));
+
+    EXPECT_CALL(*Out(), OnFlush(kStreamIndex));
+  }
+
+  ASSERT_OK(DispatchStream());
+  ASSERT_OK(DispatchText(kId2, kSimplePayload, kSample2Start, kSample2End));
+  ASSERT_OK(DispatchText(kId1, kSimplePayload, kSample1Start, kSample1End));
+  ASSERT_OK(DispatchSegment(kSegmentStart, kSegmentEnd));
+  ASSERT_OK(Flush());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -445,9 +445,10 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
         }
         pes_packet_bytes_ -= num_bytes;
         if (pes_stream_id_ !=  kV2MetadataStreamId) {
-          sample_data_.resize(sample_data_.size() + num_bytes);
-          memcpy(&sample_data_[sample_data_.size() - num_bytes], read_ptr,
-                 num_bytes);
+          // The crypto units are decrypted in place in |sample_data_|, so
+          // this is the only copy of the payload before the output.
+          sample_data_.insert(sample_data_.end(), read_ptr,
+                              read_ptr + num_bytes);
         }
         prev_pes_stream_id_ = pes_stream_id_;
         read_ptr += num_bytes;
@@ -822,14 +823,23 @@ bool WvmMediaParser::Output(bool output_encrypted_sample) {
     media_sample_->set_is_encrypted(true);
   } else {
     if ((prev_pes_stream_id_ & kPesStreamIdVideoMask) == kPesStreamIdVideo) {
-      // Convert video stream to unit stream and get config.
+      // Convert video stream to unit stream and get config. The decrypted
+      // sample is converted in place if possible, as it is not used again.
+      uint8_t* converted_frame;
+      size_t converted_frame_size;
       std::vector<uint8_t> nal_unit_stream;
-      if (!byte_to_unit_stream_converter_.ConvertByteStreamToNalUnitStream(
-              sample_data_.data(), sample_data_.size(), &nal_unit_stream)) {
+      if (!byte_to_unit_stream_converter_
+               .ConvertByteStreamToNalUnitStreamInPlace(
+                   sample_data_.data(), sample_data_.size(), &converted_frame,
+                   &converted_frame_size, &nal_unit_stream)) {
         LOG(ERROR) << "Could not convert h.264 byte stream sample";
         return false;
       }
-      media_sample_->SetData(nal_unit_stream.data(), nal_unit_stream.size());
+      if (!converted_frame) {
+        converted_frame = nal_unit_stream.data();
+        converted_frame_size = nal_unit_stream.size();
+      }
+      media_sample_->SetData(converted_frame, converted_frame_size);
       if (!is_initialized_) {
         // Set extra data for video stream from AVC Decoder Config Record.
         // Also, set codec string from the AVC Decoder Config Record.
@@ -1096,6 +1106,10 @@ bool WvmMediaParser::ProcessEcm() {
                << ", expected size = " << kEcmSizeBytes;
     return false;
   }
+  // The ECM is repeated in the stream. The decryptors, and the asset key,
+  // are only set up again if it changes.
+  if (content_decryptor_ && ecm_ == processed_ecm_)
+    return true;
   const uint8_t* ecm_data = ecm_.data();
   DCHECK(ecm_data);
   ecm_data += sizeof(uint32_t);  // old version field - skip.
@@ -1145,6 +1159,7 @@ bool WvmMediaParser::ProcessEcm() {
   }
 
   content_decryptor_ = std::move(content_decryptor);
+  processed_ecm_ = ecm_;
   return true;
 }
 
@@ -244,6 +244,8 @@ class WvmMediaParser : public MediaParser {
   H264ByteToUnitStreamConverter byte_to_unit_stream_converter_;
 
   std::vector<uint8_t, std::allocator<uint8_t>> ecm_;
+  // The ECM |content_decryptor_| was set up from.
+  std::vector<uint8_t> processed_ecm_;
   std::vector<uint8_t> psm_data_;
   std::vector<uint8_t> index_data_;
   std::map<std::string, uint32_t> program_demux_stream_map_;
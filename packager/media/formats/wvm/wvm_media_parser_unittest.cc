@@ -6,7 +6,9 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <iterator>
 #include <string>
+#include <vector>
 
 #include "packager/base/bind.h"
 #include "packager/base/bind_helpers.h"
@@ -18,6 +20,7 @@
 #include "packager/media/base/stream_info.h"
 #include "packager/media/base/timestamp.h"
 #include "packager/media/base/video_stream_info.h"
+#include "packager/media/formats/mp2t/crc32_mpeg2.h"
 #include "packager/media/formats/wvm/wvm_media_parser.h"
 #include "packager/media/test/test_data_util.h"
 
@@ -28,6 +31,9 @@ const uint32_t kExpectedStreams = 4;
 const int kExpectedVideoFrameCount = 826;
 const int kExpectedAudioFrameCount = 1184;
 const int kExpectedEncryptedSampleCount = 554;
+// CRCs of the decrypted video and audio samples, concatenated.
+const uint32_t kExpectedVideoDataCrc = 0x6b11eb6b;
+const uint32_t kExpectedAudioDataCrc = 0x84f0e83f;
 const uint8_t kExpectedAssetKey[] =
     "\x92\x48\xd2\x45\x39\x0e\x0a\x49\xd4\x83\xba\x9b\x43\xfc\x69\xc3";
 const uint8_t k64ByteAssetKey[] =
@@ -37,6 +43,7 @@ const uint8_t k64ByteAssetKey[] =
     "\x92\x48\xd2\x45\x39\x0e\x0a\x49\xd4\x83\xba\x9b\x43\xfc\x69\xc3";
 const size_t kInitDataSize = 0x4000;
 const char kMultiConfigWvmFile[] = "bear-multi-configs.wvm";
+const uint8_t kEcmStreamId = 0xF0;
 }  // namespace
 
 using ::testing::_;
@@ -90,6 +97,8 @@ class WvmMediaParserTest : public testing::Test {
   int64_t video_max_dts_;
   int32_t current_track_id_;
   EncryptionKey encryption_key_;
+  std::vector<uint8_t> video_data_;
+  std::vector<uint8_t> audio_data_;
 
   void OnInit(const std::vector<std::shared_ptr<StreamInfo>>& stream_infos) {
     DVLOG(1) << "OnInit: " << stream_infos.size() << " streams.";
@@ -111,9 +120,13 @@ class WvmMediaParserTest : public testing::Test {
       if (stream->second->stream_type() == kStreamAudio) {
         ++audio_frame_count_;
         stream_type = "audio";
+        audio_data_.insert(audio_data_.end(), sample->data(),
+                           sample->data() + sample->data_size());
       } else if (stream->second->stream_type() == kStreamVideo) {
         ++video_frame_count_;
         stream_type = "video";
+        video_data_.insert(video_data_.end(), sample->data(),
+                           sample->data() + sample->data_size());
         // Verify timestamps are increasing.
         if (video_max_dts_ == kNoTimestamp) {
           video_max_dts_ = sample->dts();
@@ -156,6 +169,18 @@ class WvmMediaParserTest : public testing::Test {
     std::vector<uint8_t> buffer = ReadTestDataFile(filename);
     EXPECT_TRUE(parser_->Parse(buffer.data(), static_cast<int>(buffer.size())));
   }
+
+  // Repeat the first ECM PES packet of |buffer| right after it.
+  void RepeatFirstEcm(std::vector<uint8_t>* buffer) {
+    const uint8_t kEcmStartCode[] = {0x00, 0x00, 0x01, kEcmStreamId};
+    auto ecm = std::search(buffer->begin(), buffer->end(),
+                           std::begin(kEcmStartCode), std::end(kEcmStartCode));
+    ASSERT_TRUE(ecm + 6 <= buffer->end());
+    // The start code is followed by the 16-bit size of the rest of the packet.
+    const size_t ecm_size = 6 + (ecm[4] << 8 | ecm[5]);
+    const std::vector<uint8_t> ecm_packet(ecm, ecm + ecm_size);
+    buffer->insert(ecm + ecm_size, ecm_packet.begin(), ecm_packet.end());
+  }
 };
 
 TEST_F(WvmMediaParserTest, ParseWvmWithoutKeySource) {
@@ -198,6 +223,30 @@ TEST_F(WvmMediaParserTest, ParseWvm) {
   EXPECT_EQ(kExpectedVideoFrameCount, video_frame_count_);
   EXPECT_EQ(kExpectedAudioFrameCount, audio_frame_count_);
   EXPECT_EQ(0, encrypted_sample_count_);
+  // The samples are decrypted and converted to NAL unit streams in place, and
+  // match the samples decrypted and converted with copies.
+  EXPECT_EQ(kExpectedVideoDataCrc,
+            mp2t::Crc32Mpeg2(video_data_.data(), video_data_.size()));
+  EXPECT_EQ(kExpectedAudioDataCrc,
+            mp2t::Crc32Mpeg2(audio_data_.data(), audio_data_.size()));
+}
+
+TEST_F(WvmMediaParserTest, ParseWvmWithRepeatedEcm) {
+  // The asset key is only fetched for the first of the identical ECMs.
+  EXPECT_CALL(*key_source_, FetchKeys(_, _)).WillOnce(Return(Status::OK));
+  EXPECT_CALL(*key_source_, GetKey(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(encryption_key_), Return(Status::OK)));
+  InitializeParser();
+  std::vector<uint8_t> buffer = ReadTestDataFile(kWvmFile);
+  RepeatFirstEcm(&buffer);
+  EXPECT_TRUE(parser_->Parse(buffer.data(), static_cast<int>(buffer.size())));
+  EXPECT_EQ(kExpectedVideoFrameCount, video_frame_count_);
+  EXPECT_EQ(kExpectedAudioFrameCount, audio_frame_count_);
+  EXPECT_EQ(0, encrypted_sample_count_);
+  EXPECT_EQ(kExpectedVideoDataCrc,
+            mp2t::Crc32Mpeg2(video_data_.data(), video_data_.size()));
+  EXPECT_EQ(kExpectedAudioDataCrc,
+            mp2t::Crc32Mpeg2(audio_data_.data(), audio_data_.size()));
 }
 
 TEST_F(WvmMediaParserTest, ParseWvmWith64ByteAssetKey) {
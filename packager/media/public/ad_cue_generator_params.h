@@ -7,6 +7,8 @@
 #ifndef PACKAGER_MEDIA_PUBLIC_AD_CUE_GENERATOR_PARAMS_H_
 #define PACKAGER_MEDIA_PUBLIC_AD_CUE_GENERATOR_PARAMS_H_
 
+#include <stdint.h>
+
 #include <vector>
 
 namespace shaka {
@@ -23,6 +25,13 @@ struct Cuepoint {
 struct AdCueGeneratorParams {
   /// List of cuepoints.
   std::vector<Cuepoint> cue_points;
+
+  /// Max size in bytes of the samples of a stream that are buffered while
+  /// waiting for the other streams to reach the next cue. When it is reached,
+  /// the cue is promoted early, at its own start time instead of at the next
+  /// video key frame, or the stream blocks if there are no video streams
+  /// to wait for. 0 means no limit other than the number of samples.
+  uint64_t max_buffered_bytes_per_stream = 16 * 1024 * 1024;
 };
 
 }  // namespace shaka
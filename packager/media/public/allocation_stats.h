@@ -0,0 +1,53 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_PUBLIC_ALLOCATION_STATS_H_
+#define PACKAGER_MEDIA_PUBLIC_ALLOCATION_STATS_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace shaka {
+
+/// Allocation statistics of a subsystem of the packager.
+struct ArenaStats {
+  /// The subsystem, e.g. "media_samples", "muxing_buffers", "manifests" or
+  /// "crypto".
+  std::string name;
+  /// Memory currently allocated by the subsystem, in bytes.
+  uint64_t allocated_bytes = 0;
+  /// Number of allocations made by the subsystem so far.
+  uint64_t num_allocations = 0;
+};
+
+/// Allocation statistics of the process.
+struct AllocationStats {
+  /// The heap allocator the statistics are from: "jemalloc", "tcmalloc",
+  /// "glibc", or empty if the allocator does not report statistics.
+  std::string allocator;
+  /// Memory allocated from the heap, in bytes, as reported by the allocator.
+  uint64_t heap_allocated_bytes = 0;
+  /// Memory held by the heap allocator, allocated or not, in bytes.
+  uint64_t heap_bytes = 0;
+  /// Resident memory of the process, in bytes. Linux only.
+  uint64_t resident_bytes = 0;
+  /// Memory of the buffers allocated on huge pages, in bytes, see
+  /// PackagingParams::huge_pages.
+  uint64_t huge_page_bytes = 0;
+  /// Number of buffers allocated on huge pages so far.
+  uint64_t num_huge_page_allocations = 0;
+  /// Number of buffers allocated from the heap so far as they could not be
+  /// allocated on huge pages.
+  uint64_t num_huge_page_fallbacks = 0;
+  /// The allocations of the subsystems.
+  std::vector<ArenaStats> arenas;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_PUBLIC_ALLOCATION_STATS_H_
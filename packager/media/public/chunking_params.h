@@ -25,6 +25,24 @@ struct ChunkingParams {
   /// Setting to subsegment_sap_aligned to true but segment_sap_aligned to false
   /// is not allowed.
   bool subsegment_sap_aligned = true;
+
+  /// Low latency chunking: end a chunk, i.e. a 'moof' + 'mdat' pair that is
+  /// written out as soon as it is complete, every
+  /// @a low_latency_chunk_num_frames frames or every
+  /// @a low_latency_chunk_duration_in_seconds seconds, whichever comes first.
+  /// Chunks do not need to begin with stream access points. Chunking is
+  /// disabled if both are zero. Only applies to MP4 with segment template.
+  int low_latency_chunk_num_frames = 0;
+  double low_latency_chunk_duration_in_seconds = 0;
+
+  /// Byte budgeted low latency chunking: also end a chunk once its samples
+  /// add up to @a low_latency_chunk_target_bytes bytes, if it lasts at least
+  /// @a low_latency_chunk_min_duration_in_seconds seconds. The chunks are
+  /// then shorter where the bitrate peaks, e.g. on scene changes, and
+  /// @a low_latency_chunk_duration_in_seconds, which is required, is the
+  /// maximum chunk duration. Disabled if zero.
+  uint64_t low_latency_chunk_target_bytes = 0;
+  double low_latency_chunk_min_duration_in_seconds = 0;
 };
 
 }  // namespace shaka
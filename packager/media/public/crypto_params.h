@@ -98,6 +98,12 @@ struct WidevineEncryptionParams {
   std::vector<uint8_t> group_id;
   /// Enables entitlement license when set to true.
   bool enable_entitlement_license;
+  /// The number of crypto periods to fetch keys for ahead of the media when
+  /// key rotation is enabled. 0 means as far ahead as possible.
+  uint32_t key_prefetch_crypto_periods = 0;
+  /// The maximum number of concurrent key requests when key rotation is
+  /// enabled.
+  uint32_t max_concurrent_key_requests = 1;
 };
 
 /// PlayReady encryption parameters.
@@ -142,6 +148,23 @@ struct RawKeyParams {
   std::map<StreamLabel, KeyInfo> key_map;
 };
 
+/// Local key cache parameters. Keys from the Widevine and PlayReady key
+/// providers are cached on disk, so repeated packaging of the same content
+/// does not need to request the keys again. The cache is disabled if
+/// `cache_directory` is empty.
+struct KeyCacheParams {
+  /// The directory to store the cached keys in.
+  std::string cache_directory;
+  /// The AES key, 16, 24 or 32 bytes, used to encrypt the cached keys.
+  std::vector<uint8_t> wrapping_key;
+  /// The time to live of the cached keys in seconds.
+  uint32_t ttl_in_seconds = 86400;
+  /// Whether the cache directory is shared by several packagers, e.g. a
+  /// s3:// or gs:// bucket of a fleet. The cache is then loaded again on a
+  /// miss and saved as soon as a key is fetched.
+  bool shared = false;
+};
+
 /// Encryption parameters.
 struct EncryptionParams {
   /// Specifies the key provider, which determines which key provider is used
@@ -152,6 +175,12 @@ struct EncryptionParams {
   WidevineEncryptionParams widevine;
   PlayReadyEncryptionParams playready;
   RawKeyParams raw_key;
+  /// Local key cache for the Widevine and PlayReady key providers.
+  KeyCacheParams key_cache;
+  /// Maximum time to wait for the key source to fetch its keys, which it does
+  /// while the rest of the packager is initialized. Packager::Initialize()
+  /// fails if the keys are not fetched in time. 0 waits indefinitely.
+  double key_fetch_timeout_in_seconds = 0;
 
   /// The protection systems to generate, multiple can be OR'd together.
   ProtectionSystem protection_systems;
@@ -182,6 +211,19 @@ struct EncryptionParams {
   double crypto_period_duration_in_seconds = kNoKeyRotation;
   /// Enable/disable subsample encryption for VP9.
   bool vp9_subsample_encryption = true;
+  /// Maximum number of samples of a stream that are encrypted concurrently on
+  /// the threads shared by all the streams. The samples are still output in
+  /// order. 0 or 1 means that the samples are encrypted one after another.
+  uint32_t parallel_encryption_window = 0;
+  /// Name of the backend the parallel encryption is offloaded to, which is
+  /// submitted batches of samples, e.g. a crypto accelerator registered with
+  /// media::CryptoBackend::RegisterBackend. Empty means the software backend.
+  std::string crypto_backend;
+  /// If not empty, the initialization vectors are derived from the key, this
+  /// seed and the sample timestamps instead of being random, so that
+  /// packagers fed the same input encrypt the samples identically. The seed
+  /// must differ between the streams using the same key.
+  std::string deterministic_iv_seed;
 
   /// Encrypted stream information that is used to determine stream label.
   struct EncryptedStreamAttributes {
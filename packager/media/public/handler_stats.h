@@ -0,0 +1,45 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_PUBLIC_HANDLER_STATS_H_
+#define PACKAGER_MEDIA_PUBLIC_HANDLER_STATS_H_
+
+#include <stdint.h>
+
+#include <string>
+
+namespace shaka {
+
+/// Throughput and latency statistics of a handler of the packaging pipeline.
+struct HandlerStats {
+  /// The type of the handler, followed by the label of its stream or output,
+  /// e.g. "ChunkingHandler:input.mp4:video" or "Muxer:output_video.mp4".
+  std::string name;
+
+  /// Number of stream data received by the handler, by type.
+  uint64_t num_stream_infos = 0;
+  uint64_t num_media_samples = 0;
+  uint64_t num_text_samples = 0;
+  uint64_t num_segment_infos = 0;
+  uint64_t num_scte35_events = 0;
+  uint64_t num_cue_events = 0;
+
+  /// Total size of the media and text samples received by the handler.
+  uint64_t sample_bytes = 0;
+
+  /// Size of the media samples currently held by the handler, e.g. queued by
+  /// a demuxer until the stream info of all its streams is known.
+  uint64_t queued_bytes = 0;
+
+  /// Estimated time spent in the handler processing stream data, excluding
+  /// the time spent in the downstream handlers it dispatches to on the same
+  /// thread, in microseconds. It is extrapolated from a sample of the calls.
+  uint64_t process_time_us = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_PUBLIC_HANDLER_STATS_H_
@@ -7,6 +7,8 @@
 #ifndef PACKAGER_MEDIA_PUBLIC_MP4_OUTPUT_PARAMS_H_
 #define PACKAGER_MEDIA_PUBLIC_MP4_OUTPUT_PARAMS_H_
 
+#include <stdint.h>
+
 namespace shaka {
 
 /// MP4 (ISO-BMFF) output related parameters.
@@ -20,6 +22,44 @@ struct Mp4OutputParams {
   /// Note that it is required by spec if segment_template contains $Times$
   /// specifier.
   bool generate_sidx_in_media_segments = true;
+  /// Write the sample data of the fragments directly from the sample buffers
+  /// with vectored writes instead of copying it into the fragment buffer
+  /// first. Reduces memory copies and peak buffer growth for long fragments
+  /// at high bitrates.
+  bool scatter_gather_output = false;
+  /// For single segment (on-demand) output only. Reserve space for the 'moov'
+  /// and 'sidx' boxes at the start of the output file, based on an estimate
+  /// from the segment duration and the media duration, and write the file in
+  /// a single pass instead of writing the fragments to a temporary file and
+  /// copying them afterwards. Unused reserved space is filled with a 'free'
+  /// box. Falls back to the temporary file if the estimate is too small or
+  /// cannot be made.
+  bool single_pass_single_segment = false;
+  /// For multi segment output with a segment template only. Write completed
+  /// segment files on the I/O threads while muxing continues, instead of on
+  /// the muxing thread. The manifests are still only updated once a segment
+  /// file is written and closed. Not used for low latency chunks.
+  bool async_segment_write = false;
+  /// For single segment (on-demand) output only. If positive, the subsegments
+  /// are indexed by a hierarchy of 'sidx' boxes instead of a single one: a
+  /// child 'sidx' box for every this many subsegments, written in front of
+  /// them as soon as they are complete, and a top level 'sidx' box after the
+  /// 'moov' box which references the child 'sidx' boxes. Shrinks the index
+  /// players load first for long assets.
+  uint32_t hierarchical_sidx_subsegments = 0;
+  /// For multi segment output with a segment template only. Copy the
+  /// fragments of an already fragmented MP4 input, with a single unencrypted
+  /// track, to the media segments as they are, instead of demuxing and
+  /// fragmenting its samples again. Only used for streams without encryption,
+  /// decryption, trick play, language override or ad cues, whose input is not
+  /// shared with other streams. The segments end at the first fragment which
+  /// starts with a SAP after the segment duration.
+  bool fragment_passthrough = false;
+  /// Write a 'prft' box in front of the fragments of live streams, mapping
+  /// the start of each segment or low latency chunk to the wall clock time
+  /// its first sample arrived at the input, so that players and monitoring
+  /// can measure the latency from the input.
+  bool generate_prft_boxes = false;
 };
 
 }  // namespace shaka
@@ -14,9 +14,12 @@
       'type': '<(component)',
       'sources': [
         'ad_cue_generator_params.h',
+        'allocation_stats.h',
         'chunking_params.h',
         'crypto_params.h',
+        'handler_stats.h',
         'mp4_output_params.h',
+        'stream_progress.h',
       ],
     },
   ],
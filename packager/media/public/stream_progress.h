@@ -0,0 +1,42 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_PUBLIC_STREAM_PROGRESS_H_
+#define PACKAGER_MEDIA_PUBLIC_STREAM_PROGRESS_H_
+
+#include <stdint.h>
+
+#include <string>
+
+namespace shaka {
+
+/// Throughput of an input or an output of the packaging pipeline.
+struct StreamProgress {
+  /// The input or the output, e.g. "Demuxer:input.mp4" or
+  /// "Muxer:output_video.mp4", as in HandlerStats::name.
+  std::string name;
+  /// Size of the samples processed so far, in bytes.
+  uint64_t bytes_processed = 0;
+  /// Media processed so far, from the start of the first sample to the end of
+  /// the latest one, in seconds.
+  double media_seconds_processed = 0;
+  /// Duration of the media, in seconds, or 0 if it is not known, e.g. for a
+  /// live input.
+  double media_duration_seconds = 0;
+  /// Wall clock time since the first sample was processed, in seconds.
+  double elapsed_seconds = 0;
+  /// Media seconds processed per wall clock second, or 0 until it is known.
+  double realtime_factor = 0;
+  /// Estimated wall clock time until the stream is complete, in seconds, or
+  /// a negative value if the duration of the media is not known.
+  double eta_seconds = -1;
+  /// True once the stream is complete.
+  bool complete = false;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_PUBLIC_STREAM_PROGRESS_H_
@@ -16,8 +16,15 @@ Status Replicator::InitializeInternal() {
 Status Replicator::Process(std::unique_ptr<StreamData> stream_data) {
   Status status;
 
+  // The last output takes over the envelope instead of a copy, which saves a
+  // copy and its reference counting when there is a single output.
+  const size_t num_outputs = output_handlers().size();
+  size_t output_count = 0;
   for (auto& out : output_handlers()) {
-    std::unique_ptr<StreamData> copy(new StreamData(*stream_data));
+    std::unique_ptr<StreamData> copy =
+        ++output_count == num_outputs
+            ? std::move(stream_data)
+            : std::unique_ptr<StreamData>(new StreamData(*stream_data));
     copy->stream_index = out.first;
 
     status.Update(Dispatch(std::move(copy)));
@@ -31,5 +31,17 @@
         'run_tests_with_atexit_manager',
       ],
     },
+    {
+      'target_name': 'perf_test_support',
+      'type': '<(component)',
+      'sources': [
+        'perf_test_util.cc',
+        'perf_test_util.h',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        '../../testing/perf/perf_test.gyp:perf_test',
+      ],
+    },
   ],
 }
@@ -0,0 +1,59 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/test/perf_test_util.h"
+
+#include "packager/base/time/time.h"
+#include "packager/testing/perf/perf_test.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const int64_t kMinMeasurementDurationMs = 1000;
+
+// Returns the number of times |run| can be called per second.
+double MeasureRunsPerSecond(const std::function<void()>& run) {
+  // Warm up caches and lazily initialized state.
+  run();
+
+  int64_t runs = 0;
+  int64_t runs_in_batch = 1;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  base::TimeDelta elapsed;
+  do {
+    for (int64_t i = 0; i < runs_in_batch; ++i)
+      run();
+    runs += runs_in_batch;
+    // Check the clock less often as the runs turn out to be short.
+    runs_in_batch *= 2;
+    elapsed = base::TimeTicks::Now() - start;
+  } while (elapsed.InMilliseconds() < kMinMeasurementDurationMs);
+  return runs / elapsed.InSecondsF();
+}
+
+}  // namespace
+
+void MeasureThroughput(const std::string& measurement,
+                       const std::string& trace,
+                       size_t bytes_per_run,
+                       const std::function<void()>& run) {
+  const double kBytesPerMegabyte = 1024 * 1024;
+  perf_test::PrintResult(
+      measurement, "", trace,
+      MeasureRunsPerSecond(run) * bytes_per_run / kBytesPerMegabyte, "MB/s",
+      true);
+}
+
+void MeasureOperationRate(const std::string& measurement,
+                          const std::string& trace,
+                          const std::function<void()>& run) {
+  perf_test::PrintResult(measurement, "", trace, MeasureRunsPerSecond(run),
+                         "ops/s", true);
+}
+
+}  // namespace media
+}  // namespace shaka
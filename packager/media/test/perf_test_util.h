@@ -0,0 +1,35 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_TEST_PERF_TEST_UTIL_H_
+#define PACKAGER_MEDIA_TEST_PERF_TEST_UTIL_H_
+
+#include <stddef.h>
+
+#include <functional>
+#include <string>
+
+namespace shaka {
+namespace media {
+
+// Runs |run| repeatedly for about a second and reports, through
+// perf_test::PrintResult(), the throughput in MB/s given that each run
+// processes |bytes_per_run| bytes.
+void MeasureThroughput(const std::string& measurement,
+                       const std::string& trace,
+                       size_t bytes_per_run,
+                       const std::function<void()>& run);
+
+// Runs |run| repeatedly for about a second and reports, through
+// perf_test::PrintResult(), the number of runs per second.
+void MeasureOperationRate(const std::string& measurement,
+                          const std::string& trace,
+                          const std::function<void()>& run);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_TEST_PERF_TEST_UTIL_H_
@@ -7,18 +7,33 @@
 #include "packager/media/trick_play/trick_play_handler.h"
 
 #include "packager/base/logging.h"
+#include "packager/media/base/live_scheduler.h"
 #include "packager/media/base/video_stream_info.h"
 
 namespace shaka {
 namespace media {
 namespace {
 const size_t kStreamIndexIn = 0;
-const size_t kStreamIndexOut = 0;
 }  // namespace
 
-TrickPlayHandler::TrickPlayHandler(uint32_t factor) : factor_(factor) {
-  DCHECK_GE(factor, 1u)
-      << "Trick Play Handles must have a factor of 1 or higher.";
+TrickPlayHandler::TrickPlayHandler(uint32_t factor)
+    : TrickPlayHandler(std::vector<uint32_t>{factor}, 0) {}
+
+TrickPlayHandler::TrickPlayHandler(const std::vector<uint32_t>& factors,
+                                   uint32_t key_frame_interval)
+    : key_frame_interval_(key_frame_interval) {
+  DCHECK(!factors.empty());
+  for (uint32_t factor : factors) {
+    DCHECK_GE(factor, 1u)
+        << "Trick Play Handles must have a factor of 1 or higher.";
+    streams_.emplace_back(new TrickPlayStream(factor));
+  }
+}
+
+TrickPlayHandler::~TrickPlayHandler() = default;
+
+bool TrickPlayHandler::ValidateOutputStreamIndex(size_t stream_index) const {
+  return stream_index < streams_.size();
 }
 
 Status TrickPlayHandler::InitializeInternal() {
@@ -40,9 +55,7 @@ Status TrickPlayHandler::Process(std::unique_ptr<StreamData> stream_data) {
       return OnMediaSample(*stream_data->media_sample);
 
     case StreamDataType::kCueEvent:
-      // Add the cue event to be dispatched later.
-      delayed_messages_.push_back(std::move(stream_data));
-      return Status::OK;
+      return OnCueEvent(std::move(stream_data->cue_event));
 
     default:
       return Status(error::TRICK_PLAY_ERROR,
@@ -55,11 +68,13 @@ Status TrickPlayHandler::OnFlushRequest(size_t input_stream_index) {
   DCHECK_EQ(input_stream_index, 0u);
 
   // Send everything out in its "as-is" state as we no longer need to update
-  // anything.
+  // anything. The empty segments at the end of the streams are dropped as
+  // there is no segment to merge them into.
   Status s;
-  while (s.ok() && delayed_messages_.size()) {
-    s.Update(Dispatch(std::move(delayed_messages_.front())));
-    delayed_messages_.pop_front();
+  for (const auto& stream : streams_) {
+    while (s.ok() && stream->delayed_messages.size())
+      s.Update(DispatchDelayedMessage(stream.get()));
+    stream->empty_segment.reset();
   }
 
   return s.ok() ? MediaHandler::FlushAllDownstreams() : s;
@@ -71,49 +86,140 @@ Status TrickPlayHandler::OnStreamInfo(const StreamInfo& info) {
                   "Trick play does not support non-video stream");
   }
 
-  // Copy the video so we can edit it. Set play back rate to be zero. It will be
-  // updated later before being dispatched downstream.
-  video_info_ = std::make_shared<VideoStreamInfo>(
-      static_cast<const VideoStreamInfo&>(info));
-
-  if (video_info_->trick_play_factor() > 0) {
+  const VideoStreamInfo& video_info = static_cast<const VideoStreamInfo&>(info);
+  if (video_info.trick_play_factor() > 0) {
     return Status(error::TRICK_PLAY_ERROR,
                   "This stream is already a trick play stream.");
   }
 
-  video_info_->set_trick_play_factor(factor_);
-  video_info_->set_playback_rate(0);
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    TrickPlayStream* stream = streams_[i].get();
+
+    // Copy the video so we can edit it.
+    stream->video_info = std::make_shared<VideoStreamInfo>(video_info);
+    stream->video_info->set_trick_play_factor(stream->factor);
+
+    if (key_frame_interval_ > 0) {
+      // The play back rate is the number of frames between two trick play
+      // frames, which is known upfront.
+      stream->video_info->set_playback_rate(stream->factor *
+                                            key_frame_interval_);
+      Status s = DispatchStreamInfo(i, stream->video_info);
+      if (!s.ok())
+        return s;
+      continue;
+    }
+
+    // Set play back rate to be zero. It will be updated later before being
+    // dispatched downstream.
+    stream->video_info->set_playback_rate(0);
 
-  // Add video info to the message queue so that it can be sent out with all
-  // other messages. It won't be sent until the second trick play frame comes
-  // through. Until then, it can be updated via the |video_info_| member.
-  delayed_messages_.push_back(
-      StreamData::FromStreamInfo(kStreamIndexOut, video_info_));
+    // Add video info to the message queue so that it can be sent out with all
+    // other messages. It won't be sent until the second trick play frame
+    // comes through. Until then, it can be updated via |video_info|.
+    stream->delayed_messages.push_back(
+        StreamData::FromStreamInfo(i, stream->video_info));
+  }
 
   return Status::OK;
 }
 
 Status TrickPlayHandler::OnSegmentInfo(
     std::shared_ptr<const SegmentInfo> info) {
-  if (delayed_messages_.empty()) {
-    return Status(error::TRICK_PLAY_ERROR,
-                  "Cannot handle segments with no preceding samples.");
-  }
-
   // Trick play does not care about sub segments, only full segments matter.
   if (info->is_subsegment) {
     return Status::OK;
   }
 
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    Status s = key_frame_interval_ > 0
+                   ? OnStreamingSegmentInfo(i, streams_[i].get(), info)
+                   : OnDelayedSegmentInfo(i, streams_[i].get(), info);
+    if (!s.ok())
+      return s;
+  }
+  return Status::OK;
+}
+
+Status TrickPlayHandler::OnCueEvent(std::shared_ptr<const CueEvent> cue_event) {
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    if (key_frame_interval_ > 0) {
+      Status s = DispatchCueEvent(i, cue_event);
+      if (!s.ok())
+        return s;
+    } else {
+      // Add the cue event to be dispatched later.
+      streams_[i]->delayed_messages.push_back(
+          StreamData::FromCueEvent(i, cue_event));
+    }
+  }
+  return Status::OK;
+}
+
+Status TrickPlayHandler::OnMediaSample(const MediaSample& sample) {
+  total_frames_++;
+
+  if (sample.is_key_frame())
+    total_key_frames_++;
+  // The trick play outputs are degraded first while the live streams lag
+  // behind real time.
+  const bool degrade =
+      sample.is_key_frame() && key_frame_interval_ == 0 &&
+      LiveScheduler::GetInstance()->ShouldDegradeLowPriorityOutputs();
+
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    TrickPlayStream* stream = streams_[i].get();
+
+    // A degraded trick play frame is dropped, but for the first one, and is
+    // spanned by the previous trick play frame like the other dropped frames.
+    const bool drop_trick_frame = degrade && stream->previous_trick_frame;
+    if (sample.is_key_frame() &&
+        (total_key_frames_ - 1) % stream->factor == 0 && !drop_trick_frame) {
+      Status s = key_frame_interval_ > 0
+                     ? OnStreamingTrickFrame(i, stream, sample)
+                     : OnDelayedTrickFrame(i, stream, sample);
+      if (!s.ok())
+        return s;
+      continue;
+    }
+
+    // The trick play frames already span the dropped frames if the key frame
+    // interval is known.
+    if (key_frame_interval_ > 0)
+      continue;
+
+    // If the frame is not a trick play frame, then take the duration of this
+    // frame and add it to the previous trick play frame so that it will span
+    // the gap created by not passing this frame through.
+    DCHECK(stream->previous_trick_frame);
+    stream->previous_trick_frame->set_duration(
+        stream->previous_trick_frame->duration() + sample.duration());
+  }
+
+  // The frames skipped by a key frame only read, which the duration of the
+  // sample spans already, count in the play back rate.
+  total_frames_ += sample.skipped_frames();
+  return Status::OK;
+}
+
+Status TrickPlayHandler::OnDelayedSegmentInfo(
+    size_t stream_index,
+    TrickPlayStream* stream,
+    std::shared_ptr<const SegmentInfo> info) {
+  if (stream->delayed_messages.empty()) {
+    return Status(error::TRICK_PLAY_ERROR,
+                  "Cannot handle segments with no preceding samples.");
+  }
+
   const StreamDataType previous_type =
-      delayed_messages_.back()->stream_data_type;
+      stream->delayed_messages.back()->stream_data_type;
 
   switch (previous_type) {
     case StreamDataType::kSegmentInfo:
       // In the case that there was an empty segment (no trick frame between in
       // a segment) extend the previous segment to include the empty segment to
       // avoid holes.
-      previous_segment_->duration += info->duration;
+      stream->previous_segment->duration += info->duration;
       return Status::OK;
 
     case StreamDataType::kMediaSample:
@@ -121,9 +227,9 @@ Status TrickPlayHandler::OnSegmentInfo(
       // Add the segment info to the list of delayed messages. Segment info will
       // not get sent downstream until the next trick play frame comes through
       // or flush is called.
-      previous_segment_ = std::make_shared<SegmentInfo>(*info);
-      delayed_messages_.push_back(
-          StreamData::FromSegmentInfo(kStreamIndexOut, previous_segment_));
+      stream->previous_segment = std::make_shared<SegmentInfo>(*info);
+      stream->delayed_messages.push_back(
+          StreamData::FromSegmentInfo(stream_index, stream->previous_segment));
       return Status::OK;
 
     default:
@@ -133,63 +239,93 @@ Status TrickPlayHandler::OnSegmentInfo(
   }
 }
 
-Status TrickPlayHandler::OnMediaSample(const MediaSample& sample) {
-  total_frames_++;
-
-  if (sample.is_key_frame()) {
-    total_key_frames_++;
-
-    if ((total_key_frames_ - 1) % factor_ == 0) {
-      return OnTrickFrame(sample);
-    }
-  }
-  // If the frame is not a trick play frame, then take the duration of this
-  // frame and add it to the previous trick play frame so that it will span the
-  // gap created by not passing this frame through.
-  DCHECK(previous_trick_frame_);
-  previous_trick_frame_->set_duration(previous_trick_frame_->duration() +
-                                      sample.duration());
-
-  return Status::OK;
-}
-
-Status TrickPlayHandler::OnTrickFrame(const MediaSample& sample) {
-  total_trick_frames_++;
+Status TrickPlayHandler::OnDelayedTrickFrame(size_t stream_index,
+                                             TrickPlayStream* stream,
+                                             const MediaSample& sample) {
+  stream->total_trick_frames++;
 
   // Make a message we can store until later.
-  previous_trick_frame_ = sample.Clone();
+  stream->previous_trick_frame = sample.Clone();
 
   // Add the message to our queue so that it will be ready to go out.
-  delayed_messages_.push_back(
-      StreamData::FromMediaSample(kStreamIndexOut, previous_trick_frame_));
+  stream->delayed_messages.push_back(
+      StreamData::FromMediaSample(stream_index, stream->previous_trick_frame));
+  delayed_memory_.Increase(stream->previous_trick_frame->data_size());
 
   // We need two trick play frames before we can send out our stream info, so we
   // cannot send this media sample until after we send our sample info
   // downstream.
-  if (total_trick_frames_ < 2) {
+  if (stream->total_trick_frames < 2) {
     return Status::OK;
   }
 
   // Update this now as it may be sent out soon via the delay message queue.
-  if (total_trick_frames_ == 2) {
+  if (stream->total_trick_frames == 2) {
     // At this point, video_info will be at the head of the delay message queue
     // and can still be updated safely.
 
     // The play back rate is determined by the number of frames between the
     // first two trick play frames. The first trick play frame will be the
     // first frame in the video.
-    video_info_->set_playback_rate(total_frames_ - 1);
+    stream->video_info->set_playback_rate(total_frames_ - 1);
   }
 
   // Send out all delayed messages up until the new trick play frame we just
   // added.
   Status s;
-  while (s.ok() && delayed_messages_.size() > 1) {
-    s.Update(Dispatch(std::move(delayed_messages_.front())));
-    delayed_messages_.pop_front();
-  }
+  while (s.ok() && stream->delayed_messages.size() > 1)
+    s.Update(DispatchDelayedMessage(stream));
   return s;
 }
 
+Status TrickPlayHandler::DispatchDelayedMessage(TrickPlayStream* stream) {
+  DCHECK(!stream->delayed_messages.empty());
+  std::unique_ptr<StreamData> message =
+      std::move(stream->delayed_messages.front());
+  stream->delayed_messages.pop_front();
+  if (message->stream_data_type == StreamDataType::kMediaSample)
+    delayed_memory_.Decrease(message->media_sample->data_size());
+  return Dispatch(std::move(message));
+}
+
+Status TrickPlayHandler::OnStreamingSegmentInfo(
+    size_t stream_index,
+    TrickPlayStream* stream,
+    std::shared_ptr<const SegmentInfo> info) {
+  if (!stream->segment_has_trick_frames) {
+    // Hold the empty segment back until the next segment with trick play
+    // frames, which will include it to avoid holes.
+    if (stream->empty_segment)
+      stream->empty_segment->duration += info->duration;
+    else
+      stream->empty_segment = std::make_shared<SegmentInfo>(*info);
+    return Status::OK;
+  }
+  stream->segment_has_trick_frames = false;
+
+  if (!stream->empty_segment)
+    return DispatchSegmentInfo(stream_index, std::move(info));
+
+  std::shared_ptr<SegmentInfo> segment = std::make_shared<SegmentInfo>(*info);
+  segment->start_timestamp = stream->empty_segment->start_timestamp;
+  segment->duration += stream->empty_segment->duration;
+  stream->empty_segment.reset();
+  return DispatchSegmentInfo(stream_index, std::move(segment));
+}
+
+Status TrickPlayHandler::OnStreamingTrickFrame(size_t stream_index,
+                                               TrickPlayStream* stream,
+                                               const MediaSample& sample) {
+  stream->total_trick_frames++;
+  stream->segment_has_trick_frames = true;
+
+  // With a constant frame rate and key frame interval, the trick play frame
+  // spans the frames until the next trick play frame.
+  std::shared_ptr<MediaSample> trick_frame = sample.Clone();
+  trick_frame->set_duration(sample.duration() * stream->factor *
+                            key_frame_interval_);
+  return DispatchMediaSample(stream_index, std::move(trick_frame));
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -8,64 +8,118 @@
 #define PACKAGER_MEDIA_BASE_TRICK_PLAY_HANDLER_H_
 
 #include <list>
+#include <vector>
 
 #include "packager/media/base/media_handler.h"
+#include "packager/metrics/memory_budget.h"
 
 namespace shaka {
 namespace media {
 
 class VideoStreamInfo;
 
-/// TrickPlayHandler is a single-input single-output media handler. It takes
-/// the input stream and converts it to a trick play stream by limiting which
-/// samples get passed downstream.
+/// TrickPlayHandler is a single-input media handler. It takes the input
+/// stream and converts it to one trick play stream per trick play factor, by
+/// limiting which samples get passed downstream. Output stream i carries the
+/// trick play stream of the i-th factor; the key frames are selected in a
+/// single pass shared by all the factors.
 // The stream data in trick play streams are not simple duplicates. Some
 // information get changed (e.g. VideoStreamInfo.trick_play_factor).
 class TrickPlayHandler : public MediaHandler {
  public:
   explicit TrickPlayHandler(uint32_t factor);
 
+  /// @param factors are the trick play factors, one per output stream.
+  /// @param key_frame_interval is the number of frames from one key frame to
+  ///        the next in the input, which must have a constant frame rate. If
+  ///        non-zero, trick play frames are sent downstream as soon as they
+  ///        arrive, with durations computed from the frame duration and the
+  ///        key frame interval. Otherwise, they are held back until the next
+  ///        trick play frame, which gives their actual durations.
+  TrickPlayHandler(const std::vector<uint32_t>& factors,
+                   uint32_t key_frame_interval);
+
+  ~TrickPlayHandler() override;
+
+ protected:
+  /// MediaHandler implementation overrides.
+  bool ValidateOutputStreamIndex(size_t stream_index) const override;
+
  private:
   TrickPlayHandler(const TrickPlayHandler&) = delete;
   TrickPlayHandler& operator=(const TrickPlayHandler&) = delete;
 
+  // The state of the trick play stream of a factor.
+  struct TrickPlayStream {
+    explicit TrickPlayStream(uint32_t factor) : factor(factor) {}
+
+    const uint32_t factor;
+    uint64_t total_trick_frames = 0;
+
+    // We cannot just send video info through as we need to calculate the play
+    // rate using the first two trick play frames. This reference should only
+    // be used to update the play back rate before video info is sent
+    // downstream. After getting sent downstream, this should never be used.
+    std::shared_ptr<VideoStreamInfo> video_info;
+
+    // We need to track the segment that most recently finished so that we can
+    // extend its duration if there are empty segments.
+    std::shared_ptr<SegmentInfo> previous_segment;
+
+    // Since we are dropping frames, the time that those frames would have
+    // been on screen need to be added to the frame before them. Keep a
+    // reference to the most recent trick play frame so that we can grow its
+    // duration as we drop other frames.
+    std::shared_ptr<MediaSample> previous_trick_frame;
+
+    // Since we cannot send messages downstream right away, keep a queue of
+    // messages that need to be sent down. At the start, we use this to queue
+    // messages until we can send out |video_info|. To ensure messages are
+    // kept in order, messages are only dispatched through this queue and
+    // never directly. Unused if the key frame interval is known.
+    std::list<std::unique_ptr<StreamData>> delayed_messages;
+
+    // Used if the key frame interval is known. Segments without trick play
+    // frames cannot be sent downstream. They are merged into the next
+    // segment with trick play frames instead.
+    bool segment_has_trick_frames = false;
+    std::shared_ptr<SegmentInfo> empty_segment;
+  };
+
   Status InitializeInternal() override;
   Status Process(std::unique_ptr<StreamData> stream_data) override;
   Status OnFlushRequest(size_t input_stream_index) override;
 
   Status OnStreamInfo(const StreamInfo& info);
   Status OnSegmentInfo(std::shared_ptr<const SegmentInfo> info);
+  Status OnCueEvent(std::shared_ptr<const CueEvent> cue_event);
   Status OnMediaSample(const MediaSample& sample);
-  Status OnTrickFrame(const MediaSample& sample);
 
-  const uint32_t factor_;
+  // Delayed mode, used when the key frame interval is unknown.
+  Status OnDelayedSegmentInfo(size_t stream_index,
+                              TrickPlayStream* stream,
+                              std::shared_ptr<const SegmentInfo> info);
+  Status OnDelayedTrickFrame(size_t stream_index,
+                             TrickPlayStream* stream,
+                             const MediaSample& sample);
+  // Dispatch the oldest delayed message of |stream|.
+  Status DispatchDelayedMessage(TrickPlayStream* stream);
+
+  // Streaming mode, used when the key frame interval is known.
+  Status OnStreamingSegmentInfo(size_t stream_index,
+                                TrickPlayStream* stream,
+                                std::shared_ptr<const SegmentInfo> info);
+  Status OnStreamingTrickFrame(size_t stream_index,
+                               TrickPlayStream* stream,
+                               const MediaSample& sample);
+
+  const uint32_t key_frame_interval_;
+  std::vector<std::unique_ptr<TrickPlayStream>> streams_;
 
   uint64_t total_frames_ = 0;
   uint64_t total_key_frames_ = 0;
-  uint64_t total_trick_frames_ = 0;
-
-  // We cannot just send video info through as we need to calculate the play
-  // rate using the first two trick play frames. This reference should only be
-  // used to update the play back rate before video info is sent downstream.
-  // After getting sent downstream, this should never be used.
-  std::shared_ptr<VideoStreamInfo> video_info_;
-
-  // We need to track the segment that most recently finished so that we can
-  // extend its duration if there are empty segments.
-  std::shared_ptr<SegmentInfo> previous_segment_;
-
-  // Since we are dropping frames, the time that those frames would have been
-  // on screen need to be added to the frame before them. Keep a reference to
-  // the most recent trick play frame so that we can grow its duration as we
-  // drop other frames.
-  std::shared_ptr<MediaSample> previous_trick_frame_;
-
-  // Since we cannot send messages downstream right away, keep a queue of
-  // messages that need to be sent down. At the start, we use this to queue
-  // messages until we can send out |video_info_|. To ensure messages are
-  // kept in order, messages are only dispatched through this queue and never
-  // directly.
-  std::list<std::unique_ptr<StreamData>> delayed_messages_;
+  // The size of the delayed trick play frames of all the streams.
+  MemoryUsage delayed_memory_{MemoryBudget::kTrickPlay};
 };
 
 }  // namespace media
@@ -39,6 +39,13 @@ class TrickPlayHandlerTest : public MediaHandlerTestBase {
         std::make_shared<TrickPlayHandler>(factor), kInputCount, kOutputCount));
   }
 
+  void SetUpAndInitializeGraph(const std::vector<uint32_t>& factors,
+                               uint32_t key_frame_interval) {
+    ASSERT_OK(MediaHandlerTestBase::SetUpAndInitializeGraph(
+        std::make_shared<TrickPlayHandler>(factors, key_frame_interval),
+        kInputCount, factors.size()));
+  }
+
   Status DispatchVideoInfo() {
     auto info = GetVideoStreamInfo(kTimescale);
     auto data = StreamData::FromStreamInfo(kStreamIndex, std::move(info));
@@ -51,6 +58,17 @@ class TrickPlayHandlerTest : public MediaHandlerTestBase {
     return Input(kInputIndex)->Dispatch(std::move(data));
   }
 
+  // Dispatch a key frame spanning |skipped_frames| frames which were not
+  // read, as a key frame only read does.
+  Status DispatchKeyFrame(int64_t time,
+                          int64_t duration,
+                          uint32_t skipped_frames) {
+    auto sample = GetMediaSample(time, duration, kKeyFrame);
+    sample->set_skipped_frames(skipped_frames);
+    auto data = StreamData::FromMediaSample(kStreamIndex, std::move(sample));
+    return Input(kInputIndex)->Dispatch(std::move(data));
+  }
+
   Status DispatchSegment(int64_t start_time, int64_t duration) {
     const bool kSubSegment = true;
 
@@ -158,6 +176,46 @@ TEST_F(TrickPlayHandlerTest, TrickTrackWithSamplesOnlyGetsKeyFrames) {
   ASSERT_OK(Flush());
 }
 
+// The key frames of a key frame only read span the skipped frames, which
+// count in the play back rate.
+TEST_F(TrickPlayHandlerTest, TrickTrackWithSkippedFrames) {
+  const uint32_t kTrickPlayFactor = 1u;
+
+  const int64_t kFrameDuration = 100;
+  const int64_t kFrame0 = 0;
+  const int64_t kFrame3 = 300;
+  const int64_t kFrame6 = 600;
+
+  // Key frame every three frames, the others being skipped.
+  const uint32_t kSkippedFrames = 2;
+  const int64_t kPlayRate = 3;
+  const int64_t kTrickPlayDuration = kFrameDuration * 3;
+
+  SetUpAndInitializeGraph(kTrickPlayFactor);
+
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(kOutputIndex),
+                OnProcess(IsVideoStream(_, kTrickPlayFactor, kPlayRate)));
+    EXPECT_CALL(
+        *Output(kOutputIndex),
+        OnProcess(IsMediaSample(_, kFrame0, kTrickPlayDuration, _, kKeyFrame)));
+    EXPECT_CALL(
+        *Output(kOutputIndex),
+        OnProcess(IsMediaSample(_, kFrame3, kTrickPlayDuration, _, kKeyFrame)));
+    EXPECT_CALL(
+        *Output(kOutputIndex),
+        OnProcess(IsMediaSample(_, kFrame6, kTrickPlayDuration, _, kKeyFrame)));
+    EXPECT_CALL(*Output(kOutputIndex), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchVideoInfo());
+  ASSERT_OK(DispatchKeyFrame(kFrame0, kTrickPlayDuration, kSkippedFrames));
+  ASSERT_OK(DispatchKeyFrame(kFrame3, kTrickPlayDuration, kSkippedFrames));
+  ASSERT_OK(DispatchKeyFrame(kFrame6, kTrickPlayDuration, kSkippedFrames));
+  ASSERT_OK(Flush());
+}
+
 // This test makes sure that when the trick play handler is initialized using
 // a non-main-stream track that only a sub set of information gets passed
 // through.
@@ -300,5 +358,174 @@ TEST_F(TrickPlayHandlerTest, TrickTrackWithSamplesAndSegments) {
   ASSERT_OK(Flush());
 }
 
+// This test makes sure that the trick play frames are sent downstream as soon
+// as they arrive if the key frame interval is known.
+TEST_F(TrickPlayHandlerTest, StreamingTrickTrackWithSamplesAndSegments) {
+  const uint32_t kTrickPlayFactor = 1u;
+  const uint32_t kKeyFrameInterval = 2u;
+
+  const int64_t kFrameDuration = 100;
+  const int64_t kFrame0 = 0;
+  const int64_t kFrame1 = 100;
+  const int64_t kFrame2 = 200;
+  const int64_t kFrame3 = 300;
+
+  const int64_t kSegmentDuration = 400;
+  const int64_t kSegment0 = 0;
+
+  const int64_t kPlayRate = 2;
+  const int64_t kTrickPlayDuration = kFrameDuration * 2;
+
+  SetUpAndInitializeGraph({kTrickPlayFactor}, kKeyFrameInterval);
+
+  EXPECT_CALL(*Output(kOutputIndex),
+              OnProcess(IsVideoStream(_, kTrickPlayFactor, kPlayRate)));
+  ASSERT_OK(DispatchVideoInfo());
+  testing::Mock::VerifyAndClearExpectations(Output(kOutputIndex));
+
+  // The first trick play frame is sent without waiting for the second one.
+  EXPECT_CALL(
+      *Output(kOutputIndex),
+      OnProcess(IsMediaSample(_, kFrame0, kTrickPlayDuration, _, kKeyFrame)));
+  ASSERT_OK(DispatchSample(kFrame0, kFrameDuration, kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame1, kFrameDuration, !kKeyFrame));
+  testing::Mock::VerifyAndClearExpectations(Output(kOutputIndex));
+
+  EXPECT_CALL(
+      *Output(kOutputIndex),
+      OnProcess(IsMediaSample(_, kFrame2, kTrickPlayDuration, _, kKeyFrame)));
+  ASSERT_OK(DispatchSample(kFrame2, kFrameDuration, kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame3, kFrameDuration, !kKeyFrame));
+  testing::Mock::VerifyAndClearExpectations(Output(kOutputIndex));
+
+  EXPECT_CALL(*Output(kOutputIndex),
+              OnProcess(IsSegmentInfo(_, kSegment0, kSegmentDuration, _, _)));
+  ASSERT_OK(DispatchSegment(kSegment0, kSegmentDuration));
+  testing::Mock::VerifyAndClearExpectations(Output(kOutputIndex));
+
+  EXPECT_CALL(*Output(kOutputIndex), OnFlush(_));
+  ASSERT_OK(Flush());
+}
+
+// This test makes sure that the segments without trick play frames are merged
+// into the next segment with trick play frames if the key frame interval is
+// known, and dropped at the end of the stream.
+TEST_F(TrickPlayHandlerTest, StreamingTrickTrackWithEmptySegments) {
+  const uint32_t kTrickPlayFactor = 2u;
+  const uint32_t kKeyFrameInterval = 2u;
+
+  const int64_t kFrameDuration = 100;
+  const int64_t kFrame0 = 0;
+  const int64_t kFrame1 = 100;
+  const int64_t kFrame2 = 200;
+  const int64_t kFrame3 = 300;
+  const int64_t kFrame4 = 400;
+  const int64_t kFrame5 = 500;
+  const int64_t kFrame6 = 600;
+  const int64_t kFrame7 = 700;
+
+  // One GOP per segment, so every other segment has no trick play frame.
+  const int64_t kSegmentDuration = 200;
+  const int64_t kSegment0 = 0;
+  const int64_t kSegment1 = 200;
+  const int64_t kSegment2 = 400;
+  const int64_t kSegment3 = 600;
+
+  const int64_t kPlayRate = 4;
+  const int64_t kTrickPlayDuration = kFrameDuration * 4;
+
+  SetUpAndInitializeGraph({kTrickPlayFactor}, kKeyFrameInterval);
+
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(kOutputIndex),
+                OnProcess(IsVideoStream(_, kTrickPlayFactor, kPlayRate)));
+    EXPECT_CALL(
+        *Output(kOutputIndex),
+        OnProcess(IsMediaSample(_, kFrame0, kTrickPlayDuration, _, kKeyFrame)));
+    EXPECT_CALL(*Output(kOutputIndex),
+                OnProcess(IsSegmentInfo(_, kSegment0, kSegmentDuration, _, _)));
+    EXPECT_CALL(
+        *Output(kOutputIndex),
+        OnProcess(IsMediaSample(_, kFrame4, kTrickPlayDuration, _, kKeyFrame)));
+    // Segment One is merged with Segment Two.
+    EXPECT_CALL(
+        *Output(kOutputIndex),
+        OnProcess(IsSegmentInfo(_, kSegment1, kSegmentDuration * 2, _, _)));
+    EXPECT_CALL(*Output(kOutputIndex), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchVideoInfo());
+
+  ASSERT_OK(DispatchSample(kFrame0, kFrameDuration, kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame1, kFrameDuration, !kKeyFrame));
+  ASSERT_OK(DispatchSegment(kSegment0, kSegmentDuration));
+
+  ASSERT_OK(DispatchSample(kFrame2, kFrameDuration, kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame3, kFrameDuration, !kKeyFrame));
+  ASSERT_OK(DispatchSegment(kSegment1, kSegmentDuration));
+
+  ASSERT_OK(DispatchSample(kFrame4, kFrameDuration, kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame5, kFrameDuration, !kKeyFrame));
+  ASSERT_OK(DispatchSegment(kSegment2, kSegmentDuration));
+
+  ASSERT_OK(DispatchSample(kFrame6, kFrameDuration, kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame7, kFrameDuration, !kKeyFrame));
+  ASSERT_OK(DispatchSegment(kSegment3, kSegmentDuration));
+
+  ASSERT_OK(Flush());
+}
+
+// This test makes sure that a handler with multiple factors outputs one trick
+// play stream per factor.
+TEST_F(TrickPlayHandlerTest, TrickTracksWithMultipleFactors) {
+  const uint32_t kTrickPlayFactor1 = 1u;
+  const uint32_t kTrickPlayFactor2 = 2u;
+  const size_t kOutputIndex1 = 0;
+  const size_t kOutputIndex2 = 1;
+
+  const int64_t kFrameDuration = 100;
+  const int64_t kFrame0 = 0;
+  const int64_t kFrame1 = 100;
+  const int64_t kFrame2 = 200;
+  const int64_t kFrame3 = 300;
+  const int64_t kFrame4 = 400;
+  const int64_t kFrame5 = 500;
+
+  SetUpAndInitializeGraph({kTrickPlayFactor1, kTrickPlayFactor2}, 0);
+
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(kOutputIndex1),
+                OnProcess(IsVideoStream(_, kTrickPlayFactor1, 2)));
+    EXPECT_CALL(*Output(kOutputIndex1),
+                OnProcess(IsMediaSample(_, kFrame0, 200, _, kKeyFrame)));
+    EXPECT_CALL(*Output(kOutputIndex1),
+                OnProcess(IsMediaSample(_, kFrame2, 200, _, kKeyFrame)));
+    EXPECT_CALL(*Output(kOutputIndex1),
+                OnProcess(IsMediaSample(_, kFrame4, 200, _, kKeyFrame)));
+    EXPECT_CALL(*Output(kOutputIndex1), OnFlush(_));
+  }
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(kOutputIndex2),
+                OnProcess(IsVideoStream(_, kTrickPlayFactor2, 4)));
+    EXPECT_CALL(*Output(kOutputIndex2),
+                OnProcess(IsMediaSample(_, kFrame0, 400, _, kKeyFrame)));
+    EXPECT_CALL(*Output(kOutputIndex2),
+                OnProcess(IsMediaSample(_, kFrame4, 200, _, kKeyFrame)));
+    EXPECT_CALL(*Output(kOutputIndex2), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchVideoInfo());
+  ASSERT_OK(DispatchSample(kFrame0, kFrameDuration, kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame1, kFrameDuration, !kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame2, kFrameDuration, kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame3, kFrameDuration, !kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame4, kFrameDuration, kKeyFrame));
+  ASSERT_OK(DispatchSample(kFrame5, kFrameDuration, !kKeyFrame));
+  ASSERT_OK(Flush());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -0,0 +1,197 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/allocator_stats.h"
+
+#if defined(__linux__)
+#include <malloc.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// Resolved if the packager is linked with, or preloaded with, jemalloc or
+// tcmalloc respectively, and null otherwise.
+extern "C" {
+int mallctl(const char* name,
+            void* oldp,
+            size_t* oldlenp,
+            void* newp,
+            size_t newlen) __attribute__((weak));
+int MallocExtension_GetNumericProperty(const char* property, size_t* value)
+    __attribute__((weak));
+}
+#endif  // defined(__linux__)
+
+#include "packager/base/logging.h"
+#include "packager/metrics/huge_page_allocator.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace {
+
+// Fill the heap statistics of |stats| from the allocator of the process.
+void GetHeapStats(AllocationStats* stats) {
+#if defined(__linux__)
+  if (mallctl) {
+    // jemalloc caches its statistics until the epoch is advanced.
+    uint64_t epoch = 1;
+    size_t epoch_size = sizeof(epoch);
+    size_t allocated = 0;
+    size_t mapped = 0;
+    size_t size = sizeof(size_t);
+    if (mallctl("epoch", &epoch, &epoch_size, &epoch, epoch_size) == 0 &&
+        mallctl("stats.allocated", &allocated, &size, nullptr, 0) == 0 &&
+        mallctl("stats.mapped", &mapped, &size, nullptr, 0) == 0) {
+      stats->allocator = "jemalloc";
+      stats->heap_allocated_bytes = allocated;
+      stats->heap_bytes = mapped;
+      return;
+    }
+  }
+  if (MallocExtension_GetNumericProperty) {
+    size_t allocated = 0;
+    size_t heap_size = 0;
+    if (MallocExtension_GetNumericProperty("generic.current_allocated_bytes",
+                                           &allocated) &&
+        MallocExtension_GetNumericProperty("generic.heap_size", &heap_size)) {
+      stats->allocator = "tcmalloc";
+      stats->heap_allocated_bytes = allocated;
+      stats->heap_bytes = heap_size;
+      return;
+    }
+  }
+#if defined(__GLIBC__)
+  // The memory mapped chunks, hblkhd, are allocated.
+#if __GLIBC_PREREQ(2, 33)
+  const struct mallinfo2 info = mallinfo2();
+#else
+  // The fields wrap around at 4 GiB.
+  const struct mallinfo info = mallinfo();
+#endif
+  stats->allocator = "glibc";
+  stats->heap_allocated_bytes = static_cast<size_t>(info.uordblks) +
+                                static_cast<size_t>(info.hblkhd);
+  stats->heap_bytes =
+      static_cast<size_t>(info.arena) + static_cast<size_t>(info.hblkhd);
+#endif  // defined(__GLIBC__)
+#endif  // defined(__linux__)
+}
+
+uint64_t GetResidentBytes() {
+#if defined(__linux__)
+  FILE* statm = fopen("/proc/self/statm", "r");
+  if (!statm)
+    return 0;
+  unsigned long size_pages = 0;
+  unsigned long resident_pages = 0;
+  const int num_fields = fscanf(statm, "%lu %lu", &size_pages, &resident_pages);
+  fclose(statm);
+  if (num_fields != 2)
+    return 0;
+  return static_cast<uint64_t>(resident_pages) * sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif  // defined(__linux__)
+}
+
+}  // namespace
+
+AllocatorStats::AllocatorStats() {
+  for (int i = 0; i < kNumArenas; ++i) {
+    allocated_bytes_[i].store(0, std::memory_order_relaxed);
+    num_allocations_[i].store(0, std::memory_order_relaxed);
+  }
+
+  metrics_collector_id_ =
+      Metrics::GetInstance()->AddCollector([this](Metrics::Writer* writer) {
+        const AllocationStats stats = GetStats();
+        for (const ArenaStats& arena : stats.arenas) {
+          writer->Add("packager_allocated_bytes", Metrics::Type::kGauge,
+                      "Memory allocated by the subsystems of the packager, "
+                      "by arena.",
+                      {{"arena", arena.name}},
+                      static_cast<double>(arena.allocated_bytes));
+          writer->Add("packager_allocations_total", Metrics::Type::kCounter,
+                      "Allocations made by the subsystems of the packager, "
+                      "by arena.",
+                      {{"arena", arena.name}},
+                      static_cast<double>(arena.num_allocations));
+        }
+        if (!stats.allocator.empty()) {
+          writer->Add("packager_heap_allocated_bytes", Metrics::Type::kGauge,
+                      "Memory allocated from the heap, as reported by the "
+                      "allocator.",
+                      {{"allocator", stats.allocator}},
+                      static_cast<double>(stats.heap_allocated_bytes));
+          writer->Add("packager_heap_bytes", Metrics::Type::kGauge,
+                      "Memory held by the heap allocator.",
+                      {{"allocator", stats.allocator}},
+                      static_cast<double>(stats.heap_bytes));
+        }
+        if (stats.resident_bytes > 0) {
+          writer->Add("packager_resident_bytes", Metrics::Type::kGauge,
+                      "Resident memory of the process.", {},
+                      static_cast<double>(stats.resident_bytes));
+        }
+      });
+}
+
+AllocatorStats::~AllocatorStats() {
+  Metrics::GetInstance()->RemoveCollector(metrics_collector_id_);
+}
+
+AllocatorStats* AllocatorStats::GetInstance() {
+  // Leaked, as the buffers may be released at exit.
+  static AllocatorStats* allocator_stats = new AllocatorStats;
+  return allocator_stats;
+}
+
+uint64_t AllocatorStats::GetAllocatedBytes(Arena arena) const {
+  DCHECK_LT(arena, kNumArenas);
+  const int64_t bytes = allocated_bytes_[arena].load(std::memory_order_relaxed);
+  return bytes > 0 ? bytes : 0;
+}
+
+AllocationStats AllocatorStats::GetStats() const {
+  AllocationStats stats;
+  GetHeapStats(&stats);
+  stats.resident_bytes = GetResidentBytes();
+  const HugePageAllocator* huge_page_allocator =
+      HugePageAllocator::GetInstance();
+  stats.huge_page_bytes = huge_page_allocator->GetHugePageBytes();
+  stats.num_huge_page_allocations =
+      huge_page_allocator->GetNumHugePageAllocations();
+  stats.num_huge_page_fallbacks = huge_page_allocator->GetNumFallbacks();
+  for (int i = 0; i < kNumArenas; ++i) {
+    const Arena arena = static_cast<Arena>(i);
+    ArenaStats arena_stats;
+    arena_stats.name = GetArenaName(arena);
+    arena_stats.allocated_bytes = GetAllocatedBytes(arena);
+    arena_stats.num_allocations =
+        num_allocations_[i].load(std::memory_order_relaxed);
+    stats.arenas.push_back(arena_stats);
+  }
+  return stats;
+}
+
+// static
+const char* AllocatorStats::GetArenaName(Arena arena) {
+  switch (arena) {
+    case kMediaSamples:
+      return "media_samples";
+    case kMuxingBuffers:
+      return "muxing_buffers";
+    case kManifests:
+      return "manifests";
+    case kCrypto:
+      return "crypto";
+    case kNumArenas:
+      break;
+  }
+  NOTREACHED();
+  return "unknown";
+}
+
+}  // namespace shaka
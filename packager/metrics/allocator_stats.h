@@ -0,0 +1,79 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_ALLOCATOR_STATS_H_
+#define PACKAGER_METRICS_ALLOCATOR_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "packager/media/public/allocation_stats.h"
+
+namespace shaka {
+
+/// Attributes the memory allocated by the packager to the subsystems which
+/// allocate most of it, or arenas, and reports it with the statistics of the
+/// heap allocator of the process: jemalloc or tcmalloc, when the packager is
+/// linked with, or preloaded with, one of them, or glibc. The statistics are
+/// exported as the packager_allocated_bytes and packager_heap_*_bytes
+/// metrics, and returned by Packager::GetAllocationStats(). This class is
+/// thread safe.
+class AllocatorStats {
+ public:
+  /// The subsystems the allocations are attributed to.
+  enum Arena {
+    /// The buffers of the media samples.
+    kMediaSamples,
+    /// The buffers the boxes and segments are muxed into.
+    kMuxingBuffers,
+    /// The XML documents of the manifests.
+    kManifests,
+    /// The buffers of the encrypted samples.
+    kCrypto,
+    kNumArenas,
+  };
+
+  AllocatorStats();
+  ~AllocatorStats();
+
+  /// @return the process wide statistics.
+  static AllocatorStats* GetInstance();
+
+  /// Account an allocation of @a bytes to @a arena.
+  void Allocate(Arena arena, size_t bytes) {
+    allocated_bytes_[arena].fetch_add(bytes, std::memory_order_relaxed);
+    num_allocations_[arena].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Account the release of @a bytes allocated from @a arena.
+  void Release(Arena arena, size_t bytes) {
+    allocated_bytes_[arena].fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  /// @return the memory currently allocated from @a arena, in bytes.
+  uint64_t GetAllocatedBytes(Arena arena) const;
+
+  /// @return the statistics of the heap allocator and of the arenas.
+  AllocationStats GetStats() const;
+
+  /// @return the name of @a arena, as in the metrics.
+  static const char* GetArenaName(Arena arena);
+
+ private:
+  AllocatorStats(const AllocatorStats&) = delete;
+  AllocatorStats& operator=(const AllocatorStats&) = delete;
+
+  std::atomic<int64_t> allocated_bytes_[kNumArenas];
+  std::atomic<uint64_t> num_allocations_[kNumArenas];
+
+  int metrics_collector_id_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_ALLOCATOR_STATS_H_
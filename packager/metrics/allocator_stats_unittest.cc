@@ -0,0 +1,63 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/allocator_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+
+TEST(AllocatorStatsTest, AccountsAllocationsByArena) {
+  AllocatorStats allocator_stats;
+  allocator_stats.Allocate(AllocatorStats::kMediaSamples, 100);
+  allocator_stats.Allocate(AllocatorStats::kMediaSamples, 50);
+  allocator_stats.Allocate(AllocatorStats::kCrypto, 10);
+  allocator_stats.Release(AllocatorStats::kMediaSamples, 100);
+  EXPECT_EQ(50u, allocator_stats.GetAllocatedBytes(
+                     AllocatorStats::kMediaSamples));
+  EXPECT_EQ(10u, allocator_stats.GetAllocatedBytes(AllocatorStats::kCrypto));
+  EXPECT_EQ(0u, allocator_stats.GetAllocatedBytes(AllocatorStats::kManifests));
+
+  const AllocationStats stats = allocator_stats.GetStats();
+  ASSERT_EQ(static_cast<size_t>(AllocatorStats::kNumArenas),
+            stats.arenas.size());
+  EXPECT_EQ("media_samples", stats.arenas[0].name);
+  EXPECT_EQ(50u, stats.arenas[0].allocated_bytes);
+  EXPECT_EQ(2u, stats.arenas[0].num_allocations);
+  EXPECT_EQ("crypto", stats.arenas[3].name);
+  EXPECT_EQ(1u, stats.arenas[3].num_allocations);
+}
+
+TEST(AllocatorStatsTest, ReleasingUnaccountedMemoryIsNotNegative) {
+  AllocatorStats allocator_stats;
+  allocator_stats.Release(AllocatorStats::kManifests, 100);
+  EXPECT_EQ(0u, allocator_stats.GetAllocatedBytes(AllocatorStats::kManifests));
+}
+
+#if defined(__linux__)
+TEST(AllocatorStatsTest, ReportsHeapAndResidentMemory) {
+  AllocatorStats allocator_stats;
+  const AllocationStats stats = allocator_stats.GetStats();
+  EXPECT_FALSE(stats.allocator.empty());
+  EXPECT_GT(stats.heap_bytes, 0u);
+  EXPECT_GT(stats.resident_bytes, 0u);
+}
+#endif  // defined(__linux__)
+
+TEST(AllocatorStatsTest, ExportsMetrics) {
+  AllocatorStats allocator_stats;
+  allocator_stats.Allocate(AllocatorStats::kMuxingBuffers, 4096);
+  const std::string output = Metrics::GetInstance()->Export();
+  EXPECT_NE(std::string::npos,
+            output.find(
+                "packager_allocated_bytes{arena=\"muxing_buffers\"} 4096"));
+}
+
+}  // namespace shaka
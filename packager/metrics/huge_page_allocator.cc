@@ -0,0 +1,160 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/huge_page_allocator.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif  // defined(__linux__)
+
+#include "packager/base/logging.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace {
+
+#if defined(__linux__)
+const size_t kHugePageSize = HugePageAllocator::kHugePageSize;
+
+// Map |size| bytes, a multiple of the huge page size, from the hugetlbfs
+// pool. Fails if not enough huge pages are reserved.
+uint8_t* MapHugetlbfs(size_t size) {
+#if defined(MAP_HUGETLB)
+  void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  return address == MAP_FAILED ? nullptr : static_cast<uint8_t*>(address);
+#else
+  return nullptr;
+#endif  // defined(MAP_HUGETLB)
+}
+
+// Map |size| bytes, a multiple of the huge page size, aligned to a huge page
+// so that the kernel can back the whole mapping with transparent huge pages.
+// Fails if transparent huge pages are not supported.
+uint8_t* MapTransparent(size_t size) {
+#if defined(MADV_HUGEPAGE)
+  // Map an extra huge page, so that an aligned range fits, then unmap the
+  // ends.
+  const size_t reserved_size = size + kHugePageSize;
+  void* address = mmap(nullptr, reserved_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (address == MAP_FAILED)
+    return nullptr;
+  uint8_t* reserved = static_cast<uint8_t*>(address);
+  const size_t head = (kHugePageSize - reinterpret_cast<uintptr_t>(reserved) %
+                                           kHugePageSize) %
+                      kHugePageSize;
+  uint8_t* start = reserved + head;
+  if (head > 0)
+    munmap(reserved, head);
+  munmap(start + size, reserved_size - head - size);
+  if (madvise(start, size, MADV_HUGEPAGE) != 0) {
+    munmap(start, size);
+    return nullptr;
+  }
+  return start;
+#else
+  return nullptr;
+#endif  // defined(MADV_HUGEPAGE)
+}
+#endif  // defined(__linux__)
+
+}  // namespace
+
+void HugePageAllocator::Deleter::operator()(uint8_t* buffer) const {
+  if (mapped_size_ == 0) {
+    delete[] buffer;
+    return;
+  }
+  DCHECK(allocator_);
+  allocator_->Release(buffer, mapped_size_);
+}
+
+HugePageAllocator::HugePageAllocator()
+    : mode_(kDisabled),
+      huge_page_bytes_(0),
+      num_huge_page_allocations_(0),
+      num_fallbacks_(0) {
+  metrics_collector_id_ =
+      Metrics::GetInstance()->AddCollector([this](Metrics::Writer* writer) {
+        if (mode() == kDisabled && GetNumHugePageAllocations() == 0)
+          return;
+        writer->Add("packager_huge_page_bytes", Metrics::Type::kGauge,
+                    "Memory of the buffers allocated on huge pages.", {},
+                    static_cast<double>(GetHugePageBytes()));
+        writer->Add("packager_huge_page_allocations_total",
+                    Metrics::Type::kCounter,
+                    "Buffers allocated on huge pages.", {},
+                    static_cast<double>(GetNumHugePageAllocations()));
+        writer->Add("packager_huge_page_fallbacks_total",
+                    Metrics::Type::kCounter,
+                    "Buffers allocated from the heap as they could not be "
+                    "allocated on huge pages.",
+                    {}, static_cast<double>(GetNumFallbacks()));
+      });
+}
+
+HugePageAllocator::~HugePageAllocator() {
+  Metrics::GetInstance()->RemoveCollector(metrics_collector_id_);
+}
+
+HugePageAllocator* HugePageAllocator::GetInstance() {
+  // Leaked, as the buffers may be released at exit.
+  static HugePageAllocator* allocator = new HugePageAllocator;
+  return allocator;
+}
+
+// static
+bool HugePageAllocator::ParseMode(const std::string& name, Mode* mode) {
+  if (name.empty()) {
+    *mode = kDisabled;
+  } else if (name == "thp") {
+    *mode = kTransparent;
+  } else if (name == "hugetlbfs") {
+    *mode = kHugetlbfs;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+HugePageAllocator::Buffer HugePageAllocator::Allocate(size_t size) {
+  const Mode mode = this->mode();
+  if (mode == kDisabled || size < kHugePageSize)
+    return Buffer(new uint8_t[size], Deleter());
+
+#if defined(__linux__)
+  const size_t mapped_size =
+      (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  uint8_t* buffer = nullptr;
+  if (mode == kHugetlbfs)
+    buffer = MapHugetlbfs(mapped_size);
+  if (!buffer)
+    buffer = MapTransparent(mapped_size);
+  if (buffer) {
+    huge_page_bytes_.fetch_add(mapped_size, std::memory_order_relaxed);
+    num_huge_page_allocations_.fetch_add(1, std::memory_order_relaxed);
+    return Buffer(buffer, Deleter(this, mapped_size));
+  }
+#endif  // defined(__linux__)
+
+  if (num_fallbacks_.fetch_add(1, std::memory_order_relaxed) == 0) {
+    LOG(WARNING) << "Failed to allocate a buffer on huge pages. Allocating "
+                    "the buffers which cannot be from the heap instead.";
+  }
+  return Buffer(new uint8_t[size], Deleter());
+}
+
+void HugePageAllocator::Release(uint8_t* buffer, size_t mapped_size) {
+#if defined(__linux__)
+  munmap(buffer, mapped_size);
+  huge_page_bytes_.fetch_sub(mapped_size, std::memory_order_relaxed);
+#else
+  NOTREACHED();
+#endif  // defined(__linux__)
+}
+
+}  // namespace shaka
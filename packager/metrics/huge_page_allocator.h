@@ -0,0 +1,109 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_HUGE_PAGE_ALLOCATOR_H_
+#define PACKAGER_METRICS_HUGE_PAGE_ALLOCATOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace shaka {
+
+/// Allocates the large, long lived buffers of the pipeline, e.g. the read
+/// buffers of the demuxers, the threaded I/O caches and the byte queues which
+/// are not mirrored, on huge pages if enabled, which saves TLB misses and page
+/// faults. Buffers smaller than a huge page, and buffers which cannot be
+/// allocated on huge pages, e.g. when no huge pages are reserved, are
+/// allocated from the heap instead. The allocations are exported as the
+/// packager_huge_page_* metrics. Linux only. This class is thread safe.
+class HugePageAllocator {
+ public:
+  /// Where the buffers are allocated.
+  enum Mode {
+    /// From the heap.
+    kDisabled,
+    /// On anonymous mappings aligned to, and advised to be backed by,
+    /// transparent huge pages.
+    kTransparent,
+    /// On the huge pages reserved in the hugetlbfs pool, or as in
+    /// kTransparent if there are not enough of them.
+    kHugetlbfs,
+  };
+
+  /// Releases the buffers allocated by Allocate().
+  class Deleter {
+   public:
+    Deleter() = default;
+    Deleter(HugePageAllocator* allocator, size_t mapped_size)
+        : allocator_(allocator), mapped_size_(mapped_size) {}
+
+    void operator()(uint8_t* buffer) const;
+
+   private:
+    HugePageAllocator* allocator_ = nullptr;
+    // The size of the mapping of the buffer, or 0 if it is on the heap.
+    size_t mapped_size_ = 0;
+  };
+  typedef std::unique_ptr<uint8_t[], Deleter> Buffer;
+
+  HugePageAllocator();
+  ~HugePageAllocator();
+
+  /// @return the process wide allocator.
+  static HugePageAllocator* GetInstance();
+
+  /// @param name is "thp", "hugetlbfs", or empty for kDisabled.
+  /// @param mode gets the mode named @a name.
+  /// @return true on success, false if @a name is not a mode.
+  static bool ParseMode(const std::string& name, Mode* mode);
+
+  void set_mode(Mode mode) { mode_.store(mode, std::memory_order_relaxed); }
+  Mode mode() const { return mode_.load(std::memory_order_relaxed); }
+
+  /// @return a buffer of at least @a size bytes, which is not initialized.
+  ///         The buffer must not outlive the allocator, which the process
+  ///         wide one never does.
+  Buffer Allocate(size_t size);
+
+  /// @return the memory currently allocated on huge pages, in bytes.
+  uint64_t GetHugePageBytes() const {
+    return huge_page_bytes_.load(std::memory_order_relaxed);
+  }
+  /// @return the number of buffers allocated on huge pages so far.
+  uint64_t GetNumHugePageAllocations() const {
+    return num_huge_page_allocations_.load(std::memory_order_relaxed);
+  }
+  /// @return the number of buffers allocated from the heap so far, although
+  ///         they are large enough for huge pages, as the mappings failed.
+  uint64_t GetNumFallbacks() const {
+    return num_fallbacks_.load(std::memory_order_relaxed);
+  }
+
+  /// The size of a huge page, the minimum size of the buffers allocated on
+  /// huge pages.
+  static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+ private:
+  HugePageAllocator(const HugePageAllocator&) = delete;
+  HugePageAllocator& operator=(const HugePageAllocator&) = delete;
+
+  void Release(uint8_t* buffer, size_t mapped_size);
+
+  std::atomic<Mode> mode_;
+  std::atomic<uint64_t> huge_page_bytes_;
+  std::atomic<uint64_t> num_huge_page_allocations_;
+  std::atomic<uint64_t> num_fallbacks_;
+
+  int metrics_collector_id_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_HUGE_PAGE_ALLOCATOR_H_
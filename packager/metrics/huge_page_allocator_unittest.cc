@@ -0,0 +1,90 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/huge_page_allocator.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <string>
+
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace {
+
+const size_t kHugePageSize = HugePageAllocator::kHugePageSize;
+
+}  // namespace
+
+TEST(HugePageAllocatorTest, ParseMode) {
+  HugePageAllocator::Mode mode;
+  ASSERT_TRUE(HugePageAllocator::ParseMode("thp", &mode));
+  EXPECT_EQ(HugePageAllocator::kTransparent, mode);
+  ASSERT_TRUE(HugePageAllocator::ParseMode("hugetlbfs", &mode));
+  EXPECT_EQ(HugePageAllocator::kHugetlbfs, mode);
+  ASSERT_TRUE(HugePageAllocator::ParseMode("", &mode));
+  EXPECT_EQ(HugePageAllocator::kDisabled, mode);
+  EXPECT_FALSE(HugePageAllocator::ParseMode("always", &mode));
+}
+
+TEST(HugePageAllocatorTest, AllocatesFromTheHeapIfDisabled) {
+  HugePageAllocator allocator;
+  HugePageAllocator::Buffer buffer = allocator.Allocate(3 * kHugePageSize);
+  ASSERT_TRUE(buffer);
+  memset(buffer.get(), 1, 3 * kHugePageSize);
+  EXPECT_EQ(0u, allocator.GetNumHugePageAllocations());
+  EXPECT_EQ(0u, allocator.GetNumFallbacks());
+}
+
+TEST(HugePageAllocatorTest, AllocatesSmallBuffersFromTheHeap) {
+  HugePageAllocator allocator;
+  allocator.set_mode(HugePageAllocator::kTransparent);
+  HugePageAllocator::Buffer buffer = allocator.Allocate(kHugePageSize - 1);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(0u, allocator.GetNumHugePageAllocations());
+  EXPECT_EQ(0u, allocator.GetNumFallbacks());
+}
+
+class HugePageAllocatorModeTest
+    : public ::testing::TestWithParam<HugePageAllocator::Mode> {};
+
+// Whether the buffer is on huge pages depends on the kernel, e.g. the
+// hugetlbfs pool is usually empty, but it is always allocated.
+TEST_P(HugePageAllocatorModeTest, AllocatesOnHugePagesOrFallsBack) {
+  HugePageAllocator allocator;
+  allocator.set_mode(GetParam());
+  const size_t size = kHugePageSize + kHugePageSize / 2;
+  {
+    HugePageAllocator::Buffer buffer = allocator.Allocate(size);
+    ASSERT_TRUE(buffer);
+    memset(buffer.get(), 1, size);
+    EXPECT_EQ(1u, allocator.GetNumHugePageAllocations() +
+                      allocator.GetNumFallbacks());
+    if (allocator.GetNumHugePageAllocations() > 0) {
+      EXPECT_EQ(0u,
+                reinterpret_cast<uintptr_t>(buffer.get()) % kHugePageSize);
+      EXPECT_EQ(2 * kHugePageSize, allocator.GetHugePageBytes());
+    }
+  }
+  EXPECT_EQ(0u, allocator.GetHugePageBytes());
+}
+
+INSTANTIATE_TEST_CASE_P(Modes,
+                        HugePageAllocatorModeTest,
+                        ::testing::Values(HugePageAllocator::kTransparent,
+                                          HugePageAllocator::kHugetlbfs));
+
+TEST(HugePageAllocatorTest, ExportsMetricsOnceEnabled) {
+  HugePageAllocator allocator;
+  EXPECT_EQ(std::string::npos, Metrics::GetInstance()->Export().find(
+                                   "packager_huge_page_bytes"));
+  allocator.set_mode(HugePageAllocator::kTransparent);
+  EXPECT_NE(std::string::npos, Metrics::GetInstance()->Export().find(
+                                   "packager_huge_page_bytes 0"));
+}
+
+}  // namespace shaka
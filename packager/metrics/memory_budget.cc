@@ -0,0 +1,184 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/memory_budget.h"
+
+#include "packager/base/logging.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace {
+
+// The change of the usage of a MemoryUsage which is reported to the budget.
+const uint64_t kReportGranularity = 64 * 1024;
+
+}  // namespace
+
+MemoryBudget::MemoryBudget() : memory_released_(&lock_) {
+  for (std::atomic<int64_t>& usage : usage_)
+    usage.store(0, std::memory_order_relaxed);
+
+  metrics_collector_id_ =
+      Metrics::GetInstance()->AddCollector([this](Metrics::Writer* writer) {
+        for (int i = 0; i < kNumComponents; ++i) {
+          const Component component = static_cast<Component>(i);
+          writer->Add("packager_memory_bytes", Metrics::Type::kGauge,
+                      "Memory used by the buffers of the pipeline, by "
+                      "component.",
+                      {{"component", GetComponentName(component)}},
+                      static_cast<double>(GetUsage(component)));
+        }
+        writer->Add("packager_memory_budget_bytes", Metrics::Type::kGauge,
+                    "Memory budget of the buffers of the pipeline. 0 means "
+                    "no budget.",
+                    {}, static_cast<double>(limit()));
+      });
+}
+
+MemoryBudget::~MemoryBudget() {
+  Metrics::GetInstance()->RemoveCollector(metrics_collector_id_);
+}
+
+MemoryBudget* MemoryBudget::GetInstance() {
+  // Leaked, as the buffers may be released at exit.
+  static MemoryBudget* memory_budget = new MemoryBudget;
+  return memory_budget;
+}
+
+void MemoryBudget::set_limit(uint64_t limit) {
+  limit_.store(limit, std::memory_order_seq_cst);
+  // The waiters may be within the new limit.
+  base::AutoLock auto_lock(lock_);
+  memory_released_.Broadcast();
+}
+
+void MemoryBudget::Add(Component component, int64_t bytes) {
+  DCHECK_LT(component, kNumComponents);
+  usage_[component].fetch_add(bytes, std::memory_order_relaxed);
+  total_usage_.fetch_add(bytes, std::memory_order_seq_cst);
+  if (bytes < 0 && num_waiters_.load(std::memory_order_seq_cst) > 0) {
+    base::AutoLock auto_lock(lock_);
+    memory_released_.Broadcast();
+  }
+}
+
+uint64_t MemoryBudget::GetUsage(Component component) const {
+  DCHECK_LT(component, kNumComponents);
+  const int64_t usage = usage_[component].load(std::memory_order_relaxed);
+  return usage > 0 ? usage : 0;
+}
+
+uint64_t MemoryBudget::GetTotalUsage() const {
+  const int64_t usage = total_usage_.load(std::memory_order_relaxed);
+  return usage > 0 ? usage : 0;
+}
+
+bool MemoryBudget::WaitForBudget(base::TimeDelta max_wait) {
+  if (!ShouldWait())
+    return true;
+
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  const base::TimeTicks deadline = start_time + max_wait;
+  bool within_budget = true;
+  {
+    base::AutoLock auto_lock(lock_);
+    num_waiters_.fetch_add(1, std::memory_order_seq_cst);
+    while (ShouldWait()) {
+      const base::TimeDelta remaining = deadline - base::TimeTicks::Now();
+      if (remaining <= base::TimeDelta()) {
+        within_budget = false;
+        break;
+      }
+      memory_released_.TimedWait(remaining);
+    }
+    num_waiters_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+  Metrics::GetInstance()->ObserveDuration(
+      "packager_memory_budget_wait_seconds",
+      "Time the inputs waited for the memory of the pipeline to be within "
+      "the budget.",
+      {}, base::TimeTicks::Now() - start_time);
+  return within_budget;
+}
+
+// static
+const char* MemoryBudget::GetComponentName(Component component) {
+  switch (component) {
+    case kDemuxerQueues:
+      return "demuxer_queues";
+    case kCueAlignment:
+      return "cue_alignment";
+    case kTrickPlay:
+      return "trick_play";
+    case kFragmentBuffers:
+      return "fragment_buffers";
+    case kPendingSegments:
+      return "pending_segments";
+    case kOutputCaches:
+      return "output_caches";
+    case kManifestState:
+      return "manifest_state";
+    case kNumComponents:
+      break;
+  }
+  NOTREACHED();
+  return "unknown";
+}
+
+// static
+bool MemoryBudget::IsReleasedAsynchronously(Component component) {
+  return component == kPendingSegments || component == kOutputCaches;
+}
+
+int64_t MemoryBudget::GetAsynchronousUsage() const {
+  int64_t usage = 0;
+  for (int i = 0; i < kNumComponents; ++i) {
+    if (IsReleasedAsynchronously(static_cast<Component>(i)))
+      usage += usage_[i].load(std::memory_order_relaxed);
+  }
+  return usage;
+}
+
+bool MemoryBudget::ShouldWait() const {
+  const uint64_t limit = limit_.load(std::memory_order_seq_cst);
+  return limit > 0 &&
+         total_usage_.load(std::memory_order_seq_cst) >
+             static_cast<int64_t>(limit) &&
+         GetAsynchronousUsage() > 0;
+}
+
+MemoryUsage::MemoryUsage(MemoryBudget::Component component)
+    : MemoryUsage(component, MemoryBudget::GetInstance()) {}
+
+MemoryUsage::MemoryUsage(MemoryBudget::Component component,
+                         MemoryBudget* budget)
+    : component_(component), budget_(budget) {
+  DCHECK(budget_);
+}
+
+MemoryUsage::~MemoryUsage() {
+  Set(0);
+}
+
+void MemoryUsage::Set(uint64_t bytes) {
+  bytes_ = bytes;
+  const uint64_t change = bytes_ > reported_bytes_ ? bytes_ - reported_bytes_
+                                                   : reported_bytes_ - bytes_;
+  // Releasing all of the memory is always reported, so nothing is left once
+  // the buffers are empty.
+  if (change < kReportGranularity && (bytes_ > 0 || reported_bytes_ == 0))
+    return;
+  budget_->Add(component_, static_cast<int64_t>(bytes_) -
+                               static_cast<int64_t>(reported_bytes_));
+  reported_bytes_ = bytes_;
+}
+
+void MemoryUsage::Decrease(uint64_t bytes) {
+  DCHECK_LE(bytes, bytes_);
+  Set(bytes_ > bytes ? bytes_ - bytes : 0);
+}
+
+}  // namespace shaka
@@ -0,0 +1,134 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_MEMORY_BUDGET_H_
+#define PACKAGER_METRICS_MEMORY_BUDGET_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// A process wide budget for the memory of the buffers of the pipeline, which
+/// the components account as their buffers grow and shrink, e.g. with
+/// MemoryUsage. When the budget is exceeded, the inputs wait in
+/// WaitForBudget() before reading more, so a slow output slows the inputs
+/// down instead of growing the buffers. The usage of each component is
+/// exported as the packager_memory_bytes metric. This class is thread safe.
+class MemoryBudget {
+ public:
+  /// The components using the memory.
+  enum Component {
+    /// The samples queued by the demuxers until the streams are known.
+    kDemuxerQueues,
+    /// The samples held back by the cue alignment handlers.
+    kCueAlignment,
+    /// The trick play frames delayed by the trick play handlers.
+    kTrickPlay,
+    /// The fragments of the segments being muxed.
+    kFragmentBuffers,
+    /// The segments being written by the I/O threads.
+    kPendingSegments,
+    /// The data cached by the threaded output files.
+    kOutputCaches,
+    /// The state of the manifests and playlists.
+    kManifestState,
+    kNumComponents,
+  };
+
+  MemoryBudget();
+  ~MemoryBudget();
+
+  /// @return the process wide budget.
+  static MemoryBudget* GetInstance();
+
+  /// @param limit is the budget, in bytes. 0, the default, means no budget.
+  void set_limit(uint64_t limit);
+  uint64_t limit() const { return limit_.load(std::memory_order_relaxed); }
+
+  /// Add @a bytes, which may be negative, to the usage of @a component.
+  void Add(Component component, int64_t bytes);
+
+  /// @return the memory used by @a component, in bytes.
+  uint64_t GetUsage(Component component) const;
+  /// @return the memory used by all the components, in bytes.
+  uint64_t GetTotalUsage() const;
+
+  /// Wait until the usage is within the budget, unless none of the memory is
+  /// released by other threads, e.g. the I/O threads, in which case waiting
+  /// would not help.
+  /// @param max_wait is the maximum time to wait, so the caller can check
+  ///        whether it is cancelled.
+  /// @return false if @a max_wait expired with the budget still exceeded.
+  bool WaitForBudget(base::TimeDelta max_wait);
+
+  /// @return the name of @a component, as in the metrics.
+  static const char* GetComponentName(Component component);
+
+ private:
+  MemoryBudget(const MemoryBudget&) = delete;
+  MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+  // @return true if the memory of |component| is released by other threads
+  //         than the inputs, e.g. the I/O threads.
+  static bool IsReleasedAsynchronously(Component component);
+  // @return the usage of the components of IsReleasedAsynchronously().
+  int64_t GetAsynchronousUsage() const;
+  // @return true if the caller of WaitForBudget() should wait.
+  bool ShouldWait() const;
+
+  std::atomic<uint64_t> limit_{0};
+  std::atomic<int64_t> usage_[kNumComponents];
+  std::atomic<int64_t> total_usage_{0};
+  // The number of threads in WaitForBudget(), which are only signaled if
+  // there are any.
+  std::atomic<int> num_waiters_{0};
+
+  base::Lock lock_;
+  // Signaled when memory is released while there are waiters.
+  base::ConditionVariable memory_released_;
+
+  int metrics_collector_id_ = 0;
+};
+
+/// Accounts the memory of a buffer of a component to the MemoryBudget, e.g.
+/// the samples queued by a demuxer. The budget is only updated when the
+/// usage changes by a few tens of KBs, so small buffers do not contend for
+/// it. The memory is released on destruction. This class is not thread safe.
+class MemoryUsage {
+ public:
+  /// Accounts to MemoryBudget::GetInstance().
+  explicit MemoryUsage(MemoryBudget::Component component);
+  /// @param budget must outlive this object.
+  MemoryUsage(MemoryBudget::Component component, MemoryBudget* budget);
+  ~MemoryUsage();
+
+  /// Set the memory used by the buffer, in bytes.
+  void Set(uint64_t bytes);
+  void Increase(uint64_t bytes) { Set(bytes_ + bytes); }
+  void Decrease(uint64_t bytes);
+
+  uint64_t bytes() const { return bytes_; }
+
+ private:
+  MemoryUsage(const MemoryUsage&) = delete;
+  MemoryUsage& operator=(const MemoryUsage&) = delete;
+
+  const MemoryBudget::Component component_;
+  MemoryBudget* const budget_;
+  uint64_t bytes_ = 0;
+  // The bytes added to |budget_|.
+  uint64_t reported_bytes_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_MEMORY_BUDGET_H_
@@ -0,0 +1,85 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/memory_budget.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "packager/base/threading/platform_thread.h"
+
+namespace shaka {
+
+TEST(MemoryBudgetTest, AccountsUsageByComponent) {
+  MemoryBudget budget;
+  budget.Add(MemoryBudget::kDemuxerQueues, 100);
+  budget.Add(MemoryBudget::kOutputCaches, 50);
+  budget.Add(MemoryBudget::kDemuxerQueues, -30);
+  EXPECT_EQ(70u, budget.GetUsage(MemoryBudget::kDemuxerQueues));
+  EXPECT_EQ(50u, budget.GetUsage(MemoryBudget::kOutputCaches));
+  EXPECT_EQ(0u, budget.GetUsage(MemoryBudget::kTrickPlay));
+  EXPECT_EQ(120u, budget.GetTotalUsage());
+}
+
+TEST(MemoryBudgetTest, MemoryUsageReportsLargeChanges) {
+  MemoryBudget budget;
+  {
+    MemoryUsage usage(MemoryBudget::kCueAlignment, &budget);
+    // Small changes are not reported.
+    usage.Increase(100);
+    EXPECT_EQ(100u, usage.bytes());
+    EXPECT_EQ(0u, budget.GetUsage(MemoryBudget::kCueAlignment));
+
+    usage.Increase(1024 * 1024);
+    EXPECT_EQ(1024u * 1024 + 100,
+              budget.GetUsage(MemoryBudget::kCueAlignment));
+
+    // Emptying the buffer is always reported.
+    usage.Decrease(1024 * 1024 + 100);
+    EXPECT_EQ(0u, budget.GetUsage(MemoryBudget::kCueAlignment));
+
+    usage.Set(1024 * 1024);
+  }
+  // Released on destruction.
+  EXPECT_EQ(0u, budget.GetTotalUsage());
+}
+
+TEST(MemoryBudgetTest, NoWaitWithoutLimit) {
+  MemoryBudget budget;
+  budget.Add(MemoryBudget::kOutputCaches, 1000);
+  EXPECT_TRUE(budget.WaitForBudget(base::TimeDelta::FromSeconds(10)));
+}
+
+TEST(MemoryBudgetTest, NoWaitWithoutAsynchronousUsage) {
+  MemoryBudget budget;
+  budget.set_limit(100);
+  // Only the caller could release it, so waiting would not help.
+  budget.Add(MemoryBudget::kDemuxerQueues, 1000);
+  EXPECT_TRUE(budget.WaitForBudget(base::TimeDelta::FromSeconds(10)));
+}
+
+TEST(MemoryBudgetTest, WaitTimesOut) {
+  MemoryBudget budget;
+  budget.set_limit(100);
+  budget.Add(MemoryBudget::kPendingSegments, 1000);
+  EXPECT_FALSE(budget.WaitForBudget(base::TimeDelta::FromMilliseconds(10)));
+}
+
+TEST(MemoryBudgetTest, WaitsForMemoryToBeReleased) {
+  MemoryBudget budget;
+  budget.set_limit(100);
+  budget.Add(MemoryBudget::kOutputCaches, 1000);
+  std::thread releaser([&budget]() {
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(10));
+    budget.Add(MemoryBudget::kOutputCaches, -950);
+  });
+  EXPECT_TRUE(budget.WaitForBudget(base::TimeDelta::FromSeconds(10)));
+  EXPECT_EQ(50u, budget.GetTotalUsage());
+  releaser.join();
+}
+
+}  // namespace shaka
@@ -0,0 +1,246 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/metrics.h"
+
+#include <inttypes.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace {
+
+// Upper bounds of the histogram buckets, in seconds.
+const double kLatencyBuckets[] = {0.01, 0.05, 0.1, 0.25, 0.5, 1,
+                                  2,    4,    8,   16,   32};
+const size_t kNumLatencyBuckets =
+    sizeof(kLatencyBuckets) / sizeof(kLatencyBuckets[0]);
+
+const char* TypeToString(Metrics::Type type) {
+  switch (type) {
+    case Metrics::Type::kCounter:
+      return "counter";
+    case Metrics::Type::kGauge:
+      return "gauge";
+    case Metrics::Type::kSummary:
+      return "summary";
+    case Metrics::Type::kHistogram:
+      return "histogram";
+  }
+  return "untyped";
+}
+
+// Escapes a label value or a help text as the exposition format requires.
+std::string Escape(const std::string& value, bool escape_quote) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    if (c == '\\') {
+      escaped += "\\\\";
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else if (c == '"' && escape_quote) {
+      escaped += "\\\"";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+// Formats |labels| as {name="value",...}, or an empty string without labels.
+std::string FormatLabels(const Metrics::Labels& labels) {
+  if (labels.empty())
+    return std::string();
+  std::string formatted = "{";
+  for (const auto& label : labels) {
+    if (formatted.size() > 1)
+      formatted += ",";
+    formatted += label.first + "=\"" + Escape(label.second, true) + "\"";
+  }
+  formatted += "}";
+  return formatted;
+}
+
+std::string FormatValue(double value) {
+  return base::StringPrintf("%.17g", value);
+}
+
+// Adds the le label of a histogram bucket to |formatted_labels|.
+std::string AddBucketLabel(const std::string& formatted_labels,
+                           const std::string& upper_bound) {
+  const std::string label = "le=\"" + upper_bound + "\"}";
+  if (formatted_labels.empty())
+    return "{" + label;
+  return formatted_labels.substr(0, formatted_labels.size() - 1) + "," +
+         label;
+}
+
+}  // namespace
+
+class Metrics::FamilyWriter : public Metrics::Writer {
+ public:
+  explicit FamilyWriter(Families* families) : families_(families) {}
+
+  void Add(const std::string& name,
+           Type type,
+           const std::string& help,
+           const Labels& labels,
+           double value) override {
+    DCHECK(type == Type::kCounter || type == Type::kGauge);
+    GetValue(name, type, help, labels, families_)->value += value;
+  }
+
+ private:
+  Families* const families_;
+};
+
+Metrics::Metrics() = default;
+
+Metrics::~Metrics() = default;
+
+Metrics* Metrics::GetInstance() {
+  // Intentionally leaked, so metrics can be pushed during static destruction.
+  static Metrics* instance = new Metrics;
+  return instance;
+}
+
+void Metrics::IncrementCounter(const std::string& name,
+                               const std::string& help,
+                               const Labels& labels,
+                               double value) {
+  base::AutoLock auto_lock(lock_);
+  GetValue(name, Type::kCounter, help, labels, &families_)->value += value;
+}
+
+void Metrics::ObserveDuration(const std::string& name,
+                              const std::string& help,
+                              const Labels& labels,
+                              base::TimeDelta duration) {
+  base::AutoLock auto_lock(lock_);
+  Value* value = GetValue(name, Type::kSummary, help, labels, &families_);
+  value->value += duration.InSecondsF();
+  ++value->count;
+}
+
+void Metrics::ObserveLatency(const std::string& name,
+                             const std::string& help,
+                             const Labels& labels,
+                             base::TimeDelta latency) {
+  const double seconds = latency.InSecondsF();
+  base::AutoLock auto_lock(lock_);
+  Value* value = GetValue(name, Type::kHistogram, help, labels, &families_);
+  if (value->bucket_counts.empty())
+    value->bucket_counts.resize(kNumLatencyBuckets);
+  for (size_t i = 0; i < kNumLatencyBuckets; ++i) {
+    if (seconds <= kLatencyBuckets[i]) {
+      ++value->bucket_counts[i];
+      break;
+    }
+  }
+  value->value += seconds;
+  ++value->count;
+}
+
+int Metrics::AddCollector(const Collector& collector) {
+  base::AutoLock auto_lock(collectors_lock_);
+  const int collector_id = next_collector_id_++;
+  collectors_[collector_id] = collector;
+  return collector_id;
+}
+
+void Metrics::RemoveCollector(int collector_id) {
+  base::AutoLock auto_lock(collectors_lock_);
+  collectors_.erase(collector_id);
+}
+
+std::string Metrics::Export() {
+  Families families;
+  {
+    base::AutoLock auto_lock(collectors_lock_);
+    FamilyWriter writer(&families);
+    for (const auto& entry : collectors_)
+      entry.second(&writer);
+  }
+  {
+    base::AutoLock auto_lock(lock_);
+    for (const auto& entry : families_) {
+      if (families.find(entry.first) != families.end()) {
+        LOG(WARNING) << "Metric " << entry.first
+                     << " is both pushed and collected.";
+        continue;
+      }
+      families[entry.first] = entry.second;
+    }
+  }
+
+  std::string output;
+  for (const auto& entry : families) {
+    const std::string& name = entry.first;
+    const Family& family = entry.second;
+    output += "# HELP " + name + " " + Escape(family.help, false) + "\n";
+    output += "# TYPE " + name + " " + TypeToString(family.type) + "\n";
+    for (const auto& value : family.values) {
+      if (family.type == Type::kHistogram) {
+        uint64_t cumulative_count = 0;
+        for (size_t i = 0; i < value.second.bucket_counts.size(); ++i) {
+          cumulative_count += value.second.bucket_counts[i];
+          output += name + "_bucket" +
+                    AddBucketLabel(value.first, base::StringPrintf(
+                                                    "%g", kLatencyBuckets[i])) +
+                    " " + base::StringPrintf("%" PRIu64, cumulative_count) +
+                    "\n";
+        }
+        output += name + "_bucket" + AddBucketLabel(value.first, "+Inf") +
+                  " " + base::StringPrintf("%" PRIu64, value.second.count) +
+                  "\n";
+      }
+      if (family.type == Type::kSummary ||
+          family.type == Type::kHistogram) {
+        output += name + "_sum" + value.first + " " +
+                  FormatValue(value.second.value) + "\n";
+        output += name + "_count" + value.first + " " +
+                  base::StringPrintf("%" PRIu64, value.second.count) + "\n";
+      } else {
+        output +=
+            name + value.first + " " + FormatValue(value.second.value) + "\n";
+      }
+    }
+  }
+  return output;
+}
+
+Metrics::Value* Metrics::GetValue(const std::string& name,
+                                  Type type,
+                                  const std::string& help,
+                                  const Labels& labels,
+                                  Families* families) {
+  auto iter = families->find(name);
+  if (iter == families->end()) {
+    Family& family = (*families)[name];
+    family.type = type;
+    family.help = help;
+    return &family.values[FormatLabels(labels)];
+  }
+  DCHECK(iter->second.type == type) << "Conflicting types for " << name;
+  return &iter->second.values[FormatLabels(labels)];
+}
+
+ScopedMetricsTimer::ScopedMetricsTimer(const std::string& name,
+                                       const std::string& help,
+                                       const Metrics::Labels& labels)
+    : name_(name),
+      help_(help),
+      labels_(labels),
+      start_time_(base::TimeTicks::Now()) {}
+
+ScopedMetricsTimer::~ScopedMetricsTimer() {
+  Metrics::GetInstance()->ObserveDuration(name_, help_, labels_,
+                                          base::TimeTicks::Now() - start_time_);
+}
+
+}  // namespace shaka
@@ -0,0 +1,50 @@
+# Copyright 2020 Google Inc. All rights reserved.
+#
+# Use of this source code is governed by a BSD-style
+# license that can be found in the LICENSE file or at
+# https://developers.google.com/open-source/licenses/bsd
+
+{
+  'variables': {
+    'shaka_code': 1,
+  },
+  'targets': [
+    {
+      'target_name': 'metrics',
+      'type': '<(component)',
+      'sources': [
+        'allocator_stats.cc',
+        'allocator_stats.h',
+        'huge_page_allocator.cc',
+        'huge_page_allocator.h',
+        'memory_budget.cc',
+        'memory_budget.h',
+        'metrics.cc',
+        'metrics.h',
+        'metrics_server.cc',
+        'metrics_server.h',
+        'trace_recorder.cc',
+        'trace_recorder.h',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+      ],
+    },
+    {
+      'target_name': 'metrics_unittest',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'allocator_stats_unittest.cc',
+        'huge_page_allocator_unittest.cc',
+        'memory_budget_unittest.cc',
+        'metrics_unittest.cc',
+        'trace_recorder_unittest.cc',
+      ],
+      'dependencies': [
+        '../testing/gtest.gyp:gtest',
+        '../testing/gtest.gyp:gtest_main',
+        'metrics',
+      ],
+    },
+  ],
+}
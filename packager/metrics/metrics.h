@@ -0,0 +1,152 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_METRICS_H_
+#define PACKAGER_METRICS_METRICS_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// A process wide registry of metrics, which are exported in the Prometheus
+/// text exposition format. Metrics are either pushed to the registry as they
+/// happen, e.g. the latency of a manifest write, or pulled from collectors
+/// when they are exported, e.g. the fill level of a cache. This class is
+/// thread safe.
+class Metrics {
+ public:
+  enum class Type {
+    kCounter,
+    kGauge,
+    kSummary,
+    kHistogram,
+  };
+
+  /// Label names to label values.
+  using Labels = std::map<std::string, std::string>;
+
+  /// Receives the metrics reported by a collector.
+  class Writer {
+   public:
+    virtual ~Writer() = default;
+
+    /// Report the current value of a counter or a gauge.
+    virtual void Add(const std::string& name,
+                     Type type,
+                     const std::string& help,
+                     const Labels& labels,
+                     double value) = 0;
+  };
+
+  /// A collector reports its metrics to the Writer when metrics are exported.
+  using Collector = std::function<void(Writer*)>;
+
+  Metrics();
+  ~Metrics();
+
+  /// @return the process wide registry.
+  static Metrics* GetInstance();
+
+  /// Add @a value to a counter.
+  void IncrementCounter(const std::string& name,
+                        const std::string& help,
+                        const Labels& labels,
+                        double value);
+
+  /// Add an observation of @a duration to a summary, in seconds.
+  void ObserveDuration(const std::string& name,
+                       const std::string& help,
+                       const Labels& labels,
+                       base::TimeDelta duration);
+
+  /// Add an observation of @a latency to a histogram, in seconds. The
+  /// histograms share buckets from 10ms to 32s, which cover the latencies of
+  /// the stages of a live pipeline.
+  void ObserveLatency(const std::string& name,
+                      const std::string& help,
+                      const Labels& labels,
+                      base::TimeDelta latency);
+
+  /// Register a collector, which is called on the exporting thread.
+  /// @return an id to remove the collector.
+  int AddCollector(const Collector& collector);
+
+  /// Remove a collector. The collector is not called after this returns.
+  void RemoveCollector(int collector_id);
+
+  /// @return All the metrics, in the Prometheus text exposition format.
+  std::string Export();
+
+ private:
+  Metrics(const Metrics&) = delete;
+  Metrics& operator=(const Metrics&) = delete;
+
+  struct Value {
+    double value = 0;
+    // Only used by summaries and histograms, for which |value| is the sum.
+    uint64_t count = 0;
+    // Only used by histograms: the number of observations in each bucket,
+    // not cumulative.
+    std::vector<uint64_t> bucket_counts;
+  };
+
+  struct Family {
+    Type type = Type::kCounter;
+    std::string help;
+    // Values by formatted labels.
+    std::map<std::string, Value> values;
+  };
+
+  using Families = std::map<std::string, Family>;
+
+  class FamilyWriter;
+
+  static Value* GetValue(const std::string& name,
+                         Type type,
+                         const std::string& help,
+                         const Labels& labels,
+                         Families* families);
+
+  base::Lock lock_;
+  // Pushed metrics by name. Protected by |lock_|.
+  Families families_;
+
+  // Held while the collectors are called, so that they can push metrics.
+  base::Lock collectors_lock_;
+  // Protected by |collectors_lock_|.
+  std::map<int, Collector> collectors_;
+  int next_collector_id_ = 0;
+};
+
+/// Times its scope and adds the duration to a summary on destruction.
+class ScopedMetricsTimer {
+ public:
+  ScopedMetricsTimer(const std::string& name,
+                     const std::string& help,
+                     const Metrics::Labels& labels);
+  ~ScopedMetricsTimer();
+
+ private:
+  ScopedMetricsTimer(const ScopedMetricsTimer&) = delete;
+  ScopedMetricsTimer& operator=(const ScopedMetricsTimer&) = delete;
+
+  const std::string name_;
+  const std::string help_;
+  const Metrics::Labels labels_;
+  const base::TimeTicks start_time_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_METRICS_H_
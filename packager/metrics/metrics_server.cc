@@ -0,0 +1,339 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/metrics_server.h"
+
+#if defined(OS_WIN)
+
+#include <windows.h>
+#include <ws2tcpip.h>
+#define close closesocket
+#define poll WSAPoll
+
+#else
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define INVALID_SOCKET -1
+
+#endif  // defined(OS_WIN)
+
+#include <string.h>
+
+#include <string>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace {
+
+// How often the serving thread checks whether it should stop.
+const int kPollIntervalMs = 100;
+// Requests are read up to the end of their headers, which are not larger.
+const size_t kMaxRequestSize = 8192;
+// The bodies of the requests passed to the request handler are not larger.
+const size_t kMaxRequestBodySize = 1024 * 1024;
+// Requests are dropped if they are not received within this time.
+const int kRequestTimeoutSeconds = 5;
+
+int GetSocketErrorCode() {
+#if defined(OS_WIN)
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+// Waits up to |timeout_ms| for |socket| to be readable.
+// Returns true if it is readable.
+bool WaitReadable(SOCKET socket, int timeout_ms) {
+  struct pollfd poll_fd;
+  poll_fd.fd = socket;
+  poll_fd.events = POLLIN;
+  poll_fd.revents = 0;
+  return poll(&poll_fd, 1, timeout_ms) > 0;
+}
+
+bool SendAll(SOCKET socket, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const int result = send(socket, data.data() + sent,
+                            static_cast<int>(data.size() - sent), 0);
+    if (result <= 0)
+      return false;
+    sent += result;
+  }
+  return true;
+}
+
+std::string FormatResponse(const std::string& status,
+                           const std::string& content_type,
+                           const std::string& body) {
+  return base::StringPrintf(
+             "HTTP/1.1 %s\r\n"
+             "Content-Type: %s\r\n"
+             "Content-Length: %zu\r\n"
+             "Connection: close\r\n"
+             "\r\n",
+             status.c_str(), content_type.c_str(), body.size()) +
+         body;
+}
+
+// Returns the value of the header |name|, which is lower case, in the headers
+// of |request|, or an empty string if there is no such header.
+std::string GetHeader(const std::string& request, const std::string& name) {
+  const std::string headers =
+      base::ToLowerASCII(request.substr(0, request.find("\r\n\r\n") + 2));
+  const std::string prefix = "\r\n" + name + ":";
+  const size_t pos = headers.find(prefix);
+  if (pos == std::string::npos)
+    return std::string();
+  const size_t value_start = pos + prefix.size();
+  std::string value;
+  base::TrimWhitespaceASCII(
+      request.substr(value_start,
+                     headers.find("\r\n", value_start) - value_start),
+      base::TRIM_ALL, &value);
+  return value;
+}
+
+// Compares in a time which does not depend on where the strings differ, so
+// that the token cannot be guessed from the response times.
+bool SecureEquals(const std::string& a, const std::string& b) {
+  if (a.size() != b.size())
+    return false;
+  uint8_t difference = 0;
+  for (size_t i = 0; i < a.size(); ++i)
+    difference |= static_cast<uint8_t>(a[i] ^ b[i]);
+  return difference == 0;
+}
+
+// Reads the body of |request|, which holds the received part of the request,
+// up to its Content-Length. Returns false on failure.
+bool ReadRequestBody(SOCKET connection,
+                     const std::string& request,
+                     std::string* body) {
+  const size_t headers_end = request.find("\r\n\r\n") + 4;
+  *body = request.substr(headers_end);
+
+  size_t content_length = 0;
+  const std::string headers =
+      base::ToLowerASCII(request.substr(0, headers_end));
+  const char kContentLength[] = "\r\ncontent-length:";
+  const size_t pos = headers.find(kContentLength);
+  if (pos != std::string::npos) {
+    const size_t value_start = pos + strlen(kContentLength);
+    std::string value;
+    base::TrimWhitespaceASCII(
+        headers.substr(value_start,
+                       headers.find("\r\n", value_start) - value_start),
+        base::TRIM_ALL, &value);
+    if (!base::StringToSizeT(value, &content_length) ||
+        content_length > kMaxRequestBodySize) {
+      return false;
+    }
+  }
+
+  // Clients, e.g. libcurl, may wait for the server to accept the body.
+  if (body->size() < content_length &&
+      headers.find("\r\nexpect: 100-continue") != std::string::npos &&
+      !SendAll(connection, "HTTP/1.1 100 Continue\r\n\r\n")) {
+    return false;
+  }
+
+  char buffer[4096];
+  while (body->size() < content_length) {
+    if (!WaitReadable(connection, kRequestTimeoutSeconds * 1000))
+      return false;
+    const int result = recv(connection, buffer, sizeof(buffer), 0);
+    if (result <= 0)
+      return false;
+    body->append(buffer, result);
+  }
+  body->resize(content_length);
+  return true;
+}
+
+}  // namespace
+
+const char MetricsServer::kLoopbackAddress[] = "127.0.0.1";
+
+// static
+bool MetricsServer::IsLoopbackAddress(const std::string& listen_address) {
+  struct in_addr address;
+  if (inet_pton(AF_INET, listen_address.c_str(), &address) != 1)
+    return false;
+  // 127.0.0.0/8.
+  return (ntohl(address.s_addr) >> 24) == 127;
+}
+
+MetricsServer::MetricsServer(Metrics* metrics)
+    : base::SimpleThread("MetricsServer"),
+      metrics_(metrics),
+      socket_(INVALID_SOCKET) {
+  DCHECK(metrics_);
+}
+
+MetricsServer::~MetricsServer() {
+  Stop();
+}
+
+bool MetricsServer::Start(uint16_t port) {
+  DCHECK_EQ(INVALID_SOCKET, socket_);
+
+#if defined(OS_WIN)
+  WSADATA wsa_data;
+  int wsa_error = WSAStartup(MAKEWORD(2, 2), &wsa_data);
+  if (wsa_error != 0) {
+    LOG(ERROR) << "Winsock start up failed with error " << wsa_error;
+    return false;
+  }
+  wsa_started_ = true;
+#endif  // defined(OS_WIN)
+
+  SOCKET new_socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (new_socket == INVALID_SOCKET) {
+    LOG(ERROR) << "Could not allocate socket, error = " << GetSocketErrorCode();
+    return false;
+  }
+
+  const int optval = 1;
+  if (setsockopt(new_socket, SOL_SOCKET, SO_REUSEADDR,
+                 reinterpret_cast<const char*>(&optval),
+                 sizeof(optval)) < 0) {
+    LOG(WARNING) << "Failed to set SO_REUSEADDR, error = "
+                 << GetSocketErrorCode();
+  }
+
+  struct sockaddr_in local_sock_addr;
+  memset(&local_sock_addr, 0, sizeof(local_sock_addr));
+  local_sock_addr.sin_family = AF_INET;
+  local_sock_addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, listen_address_.c_str(),
+                &local_sock_addr.sin_addr) != 1) {
+    LOG(ERROR) << "Invalid listen address " << listen_address_
+               << ", which should be an IPv4 address.";
+    close(new_socket);
+    return false;
+  }
+  socklen_t addr_size = sizeof(local_sock_addr);
+  if (bind(new_socket, reinterpret_cast<struct sockaddr*>(&local_sock_addr),
+           addr_size) < 0 ||
+      listen(new_socket, SOMAXCONN) < 0 ||
+      getsockname(new_socket,
+                  reinterpret_cast<struct sockaddr*>(&local_sock_addr),
+                  &addr_size) < 0) {
+    LOG(ERROR) << "Could not listen on " << listen_address_ << ":" << port
+               << ", error = " << GetSocketErrorCode();
+    close(new_socket);
+    return false;
+  }
+
+  socket_ = new_socket;
+  port_ = ntohs(local_sock_addr.sin_port);
+  VLOG(1) << "Serving metrics at http://" << listen_address_ << ":" << port_
+          << "/metrics";
+  base::SimpleThread::Start();
+  return true;
+}
+
+void MetricsServer::Stop() {
+  if (socket_ != INVALID_SOCKET) {
+    stopping_ = true;
+    Join();
+    close(socket_);
+    socket_ = INVALID_SOCKET;
+  }
+#if defined(OS_WIN)
+  if (wsa_started_) {
+    WSACleanup();
+    wsa_started_ = false;
+  }
+#endif  // defined(OS_WIN)
+}
+
+void MetricsServer::Run() {
+  while (!stopping_) {
+    if (!WaitReadable(socket_, kPollIntervalMs))
+      continue;
+    SOCKET connection = accept(socket_, nullptr, nullptr);
+    if (connection == INVALID_SOCKET) {
+      VLOG(1) << "Failed to accept connection, error = "
+              << GetSocketErrorCode();
+      continue;
+    }
+    ServeConnection(connection);
+    close(connection);
+  }
+}
+
+void MetricsServer::ServeConnection(SOCKET connection) {
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos) {
+    if (request.size() > kMaxRequestSize ||
+        !WaitReadable(connection, kRequestTimeoutSeconds * 1000)) {
+      return;
+    }
+    const int result = recv(connection, buffer, sizeof(buffer), 0);
+    if (result <= 0)
+      return;
+    request.append(buffer, result);
+  }
+
+  // Only the request line matters, e.g. "GET /metrics HTTP/1.1".
+  const std::string request_line = request.substr(0, request.find("\r\n"));
+  const size_t method_end = request_line.find(' ');
+  const size_t path_end = request_line.find(' ', method_end + 1);
+  const std::string method = request_line.substr(0, method_end);
+  const std::string path =
+      method_end == std::string::npos
+          ? std::string()
+          : request_line.substr(method_end + 1, path_end - method_end - 1);
+
+  const bool is_metrics_path =
+      path == "/metrics" || path.find("/metrics?") == 0;
+  std::string response;
+  if (!is_metrics_path && request_handler_) {
+    std::string body;
+    if (!request_token_.empty() &&
+        !SecureEquals(GetHeader(request, "authorization"),
+                      "Bearer " + request_token_)) {
+      response = FormatResponse("401 Unauthorized", "text/plain",
+                                "Missing or invalid bearer token.\n");
+    } else if (!ReadRequestBody(connection, request, &body)) {
+      response = FormatResponse("400 Bad Request", "text/plain",
+                                "Invalid request body.\n");
+    } else {
+      std::string response_body;
+      const std::string status =
+          request_handler_(method, path, body, &response_body);
+      response = FormatResponse(status, "application/json", response_body);
+    }
+  } else if (method != "GET") {
+    response = FormatResponse("405 Method Not Allowed", "text/plain",
+                              "Only GET is supported.\n");
+  } else if (!is_metrics_path) {
+    response = FormatResponse("404 Not Found", "text/plain", "Not found.\n");
+  } else {
+    response = FormatResponse("200 OK", "text/plain; version=0.0.4",
+                              metrics_->Export());
+  }
+  if (!SendAll(connection, response)) {
+    VLOG(1) << "Failed to send the response, error = "
+            << GetSocketErrorCode();
+  }
+}
+
+}  // namespace shaka
@@ -0,0 +1,111 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_METRICS_SERVER_H_
+#define PACKAGER_METRICS_METRICS_SERVER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+#include "packager/base/threading/simple_thread.h"
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#else
+typedef int SOCKET;
+#endif  // defined(OS_WIN)
+
+namespace shaka {
+
+class Metrics;
+
+/// A minimal HTTP server serving the metrics of a Metrics registry at
+/// /metrics, for Prometheus to scrape. Requests are served one at a time on
+/// a dedicated thread. It listens on the loopback address unless configured
+/// otherwise, and the requests to its request handler can be required to
+/// carry a shared token.
+class MetricsServer : public base::SimpleThread {
+ public:
+  /// Handles a request to a path other than /metrics.
+  /// @param method is the request method, e.g. "POST".
+  /// @param path is the request path, including the query if any.
+  /// @param body is the request body, which may be empty.
+  /// @param response_body gets the JSON response body.
+  /// @return The HTTP status, e.g. "200 OK".
+  typedef std::function<std::string(const std::string& method,
+                                    const std::string& path,
+                                    const std::string& body,
+                                    std::string* response_body)>
+      RequestHandler;
+
+  /// @param metrics is the registry to export. It must outlive the server.
+  explicit MetricsServer(Metrics* metrics);
+
+  /// Stops the server if it is running.
+  ~MetricsServer() override;
+
+  /// Listen on @a port of the listen address and start serving.
+  /// @param port is the TCP port to listen on. 0 picks a free port.
+  /// @return true on success.
+  bool Start(uint16_t port);
+
+  /// Stop serving and wait for the serving thread to exit.
+  void Stop();
+
+  /// Serve the requests to the paths other than /metrics with @a handler,
+  /// e.g. a control API. It must be called before Start().
+  void set_request_handler(RequestHandler handler) {
+    request_handler_ = std::move(handler);
+  }
+
+  /// Listen on @a listen_address, an IPv4 address, e.g. "0.0.0.0" for all
+  /// the interfaces, instead of kLoopbackAddress. It must be called before
+  /// Start().
+  void set_listen_address(const std::string& listen_address) {
+    listen_address_ = listen_address;
+  }
+
+  /// Require the requests passed to the request handler to carry @a token in
+  /// an "Authorization: Bearer <token>" header, and reject the others with
+  /// "401 Unauthorized". /metrics is served without it. It must be called
+  /// before Start().
+  void set_request_token(const std::string& token) { request_token_ = token; }
+
+  /// @return true if @a listen_address is an IPv4 loopback address, which
+  ///         only the local host can reach.
+  static bool IsLoopbackAddress(const std::string& listen_address);
+
+  /// The address the server listens on by default.
+  static const char kLoopbackAddress[];
+
+  /// @return The port the server listens on, once started.
+  uint16_t port() const { return port_; }
+
+ private:
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  // base::SimpleThread implementation override.
+  void Run() override;
+
+  void ServeConnection(SOCKET connection);
+
+  Metrics* const metrics_;
+  RequestHandler request_handler_;
+  std::string listen_address_ = kLoopbackAddress;
+  std::string request_token_;
+  SOCKET socket_;
+  uint16_t port_ = 0;
+  std::atomic<bool> stopping_{false};
+  bool wsa_started_ = false;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_METRICS_SERVER_H_
@@ -0,0 +1,229 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/metrics/metrics.h"
+#include "packager/metrics/metrics_server.h"
+
+#if !defined(OS_WIN)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif  // !defined(OS_WIN)
+
+namespace shaka {
+
+TEST(MetricsTest, ExportsCounters) {
+  Metrics metrics;
+  metrics.IncrementCounter("bytes_total", "Bytes written.",
+                           {{"output", "a.mp4"}}, 10);
+  metrics.IncrementCounter("bytes_total", "Bytes written.",
+                           {{"output", "a.mp4"}}, 5);
+  metrics.IncrementCounter("bytes_total", "Bytes written.",
+                           {{"output", "b.mp4"}}, 1);
+  EXPECT_EQ(
+      "# HELP bytes_total Bytes written.\n"
+      "# TYPE bytes_total counter\n"
+      "bytes_total{output=\"a.mp4\"} 15\n"
+      "bytes_total{output=\"b.mp4\"} 1\n",
+      metrics.Export());
+}
+
+TEST(MetricsTest, ExportsSummaries) {
+  Metrics metrics;
+  metrics.ObserveDuration("write_seconds", "Write latency.", {},
+                          base::TimeDelta::FromMilliseconds(250));
+  metrics.ObserveDuration("write_seconds", "Write latency.", {},
+                          base::TimeDelta::FromMilliseconds(500));
+  EXPECT_EQ(
+      "# HELP write_seconds Write latency.\n"
+      "# TYPE write_seconds summary\n"
+      "write_seconds_sum 0.75\n"
+      "write_seconds_count 2\n",
+      metrics.Export());
+}
+
+TEST(MetricsTest, ExportsHistograms) {
+  Metrics metrics;
+  metrics.ObserveLatency("latency_seconds", "Stage latency.",
+                         {{"stage", "demux"}},
+                         base::TimeDelta::FromMilliseconds(75));
+  metrics.ObserveLatency("latency_seconds", "Stage latency.",
+                         {{"stage", "demux"}},
+                         base::TimeDelta::FromSeconds(60));
+  const std::string output = metrics.Export();
+  EXPECT_NE(std::string::npos,
+            output.find("# TYPE latency_seconds histogram\n"));
+  EXPECT_NE(std::string::npos,
+            output.find("latency_seconds_bucket{stage=\"demux\",le=\"0.05\"}"
+                        " 0\n"));
+  EXPECT_NE(std::string::npos,
+            output.find("latency_seconds_bucket{stage=\"demux\",le=\"0.1\"}"
+                        " 1\n"));
+  EXPECT_NE(std::string::npos,
+            output.find("latency_seconds_bucket{stage=\"demux\",le=\"32\"}"
+                        " 1\n"));
+  EXPECT_NE(std::string::npos,
+            output.find("latency_seconds_bucket{stage=\"demux\",le=\"+Inf\"}"
+                        " 2\n"));
+  EXPECT_NE(std::string::npos,
+            output.find("latency_seconds_sum{stage=\"demux\"} 60.075"));
+  EXPECT_NE(std::string::npos,
+            output.find("latency_seconds_count{stage=\"demux\"} 2\n"));
+}
+
+TEST(MetricsTest, EscapesLabelValues) {
+  Metrics metrics;
+  metrics.IncrementCounter("c", "Help.", {{"l", "a\"b\\c\nd"}}, 1);
+  EXPECT_EQ(
+      "# HELP c Help.\n"
+      "# TYPE c counter\n"
+      "c{l=\"a\\\"b\\\\c\\nd\"} 1\n",
+      metrics.Export());
+}
+
+TEST(MetricsTest, Collectors) {
+  Metrics metrics;
+  double level = 42;
+  const int collector_id =
+      metrics.AddCollector([&level](Metrics::Writer* writer) {
+        writer->Add("level", Metrics::Type::kGauge, "Fill level.",
+                    {{"cache", "1"}}, level);
+      });
+  EXPECT_EQ(
+      "# HELP level Fill level.\n"
+      "# TYPE level gauge\n"
+      "level{cache=\"1\"} 42\n",
+      metrics.Export());
+
+  level = 7;
+  EXPECT_NE(std::string::npos, metrics.Export().find("level{cache=\"1\"} 7\n"));
+
+  metrics.RemoveCollector(collector_id);
+  EXPECT_EQ("", metrics.Export());
+}
+
+#if !defined(OS_WIN)
+namespace {
+
+std::string SendRequest(uint16_t port, const std::string& request) {
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  EXPECT_NE(-1, sock);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  EXPECT_EQ(0, connect(sock, reinterpret_cast<struct sockaddr*>(&addr),
+                       sizeof(addr)));
+
+  EXPECT_EQ(static_cast<ssize_t>(request.size()),
+            send(sock, request.data(), request.size(), 0));
+
+  std::string response;
+  char buffer[1024];
+  ssize_t result;
+  while ((result = recv(sock, buffer, sizeof(buffer), 0)) > 0)
+    response.append(buffer, result);
+  close(sock);
+  return response;
+}
+
+std::string Get(uint16_t port, const std::string& path) {
+  return SendRequest(port, "GET " + path + " HTTP/1.1\r\n\r\n");
+}
+
+}  // namespace
+
+TEST(MetricsServerTest, ServesMetrics) {
+  Metrics metrics;
+  metrics.IncrementCounter("c", "Help.", {}, 3);
+
+  MetricsServer server(&metrics);
+  ASSERT_TRUE(server.Start(0));
+  ASSERT_NE(0u, server.port());
+
+  const std::string response = Get(server.port(), "/metrics");
+  EXPECT_EQ(0u, response.find("HTTP/1.1 200 OK\r\n"));
+  EXPECT_NE(std::string::npos, response.find("# TYPE c counter\nc 3\n"));
+
+  EXPECT_EQ(0u, Get(server.port(), "/").find("HTTP/1.1 404 Not Found\r\n"));
+  server.Stop();
+}
+
+TEST(MetricsServerTest, PassesOtherRequestsToHandler) {
+  Metrics metrics;
+  MetricsServer server(&metrics);
+  server.set_request_handler([](const std::string& method,
+                                const std::string& path,
+                                const std::string& body,
+                                std::string* response_body) {
+    *response_body = method + " " + path + " " + body;
+    return std::string("201 Created");
+  });
+  ASSERT_TRUE(server.Start(0));
+
+  const std::string response = SendRequest(
+      server.port(),
+      "POST /sessions HTTP/1.1\r\nContent-Length: 7\r\n\r\n{\"a\":1}");
+  EXPECT_EQ(0u, response.find("HTTP/1.1 201 Created\r\n"));
+  EXPECT_NE(std::string::npos,
+            response.find("\r\n\r\nPOST /sessions {\"a\":1}"));
+
+  EXPECT_EQ(0u, Get(server.port(), "/metrics").find("HTTP/1.1 200 OK\r\n"));
+  server.Stop();
+}
+
+TEST(MetricsServerTest, RequiresRequestToken) {
+  Metrics metrics;
+  MetricsServer server(&metrics);
+  server.set_request_handler([](const std::string& method,
+                                const std::string& path,
+                                const std::string& body,
+                                std::string* response_body) {
+    return std::string("200 OK");
+  });
+  server.set_request_token("secret");
+  ASSERT_TRUE(server.Start(0));
+
+  EXPECT_EQ(0u, Get(server.port(), "/sessions")
+                    .find("HTTP/1.1 401 Unauthorized\r\n"));
+  EXPECT_EQ(0u, SendRequest(server.port(),
+                            "GET /sessions HTTP/1.1\r\n"
+                            "Authorization: Bearer wrong\r\n\r\n")
+                    .find("HTTP/1.1 401 Unauthorized\r\n"));
+  EXPECT_EQ(0u, SendRequest(server.port(),
+                            "GET /sessions HTTP/1.1\r\n"
+                            "authorization: Bearer secret\r\n\r\n")
+                    .find("HTTP/1.1 200 OK\r\n"));
+  // The metrics do not need the token.
+  EXPECT_EQ(0u, Get(server.port(), "/metrics").find("HTTP/1.1 200 OK\r\n"));
+  server.Stop();
+}
+
+TEST(MetricsServerTest, ListensOnListenAddress) {
+  Metrics metrics;
+  MetricsServer server(&metrics);
+  server.set_listen_address("127.0.0.2");
+  ASSERT_TRUE(server.Start(0));
+  server.Stop();
+
+  MetricsServer invalid_server(&metrics);
+  invalid_server.set_listen_address("localhost");
+  EXPECT_FALSE(invalid_server.Start(0));
+}
+
+TEST(MetricsServerTest, IsLoopbackAddress) {
+  EXPECT_TRUE(MetricsServer::IsLoopbackAddress("127.0.0.1"));
+  EXPECT_TRUE(MetricsServer::IsLoopbackAddress("127.1.2.3"));
+  EXPECT_FALSE(MetricsServer::IsLoopbackAddress("0.0.0.0"));
+  EXPECT_FALSE(MetricsServer::IsLoopbackAddress("10.0.0.1"));
+  EXPECT_FALSE(MetricsServer::IsLoopbackAddress("localhost"));
+}
+#endif  // !defined(OS_WIN)
+
+}  // namespace shaka
@@ -0,0 +1,252 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/trace_recorder.h"
+
+#include <inttypes.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/process/process_handle.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/platform_thread.h"
+
+namespace shaka {
+namespace {
+
+// The job and stream the spans of the calling thread are tagged with.
+thread_local const std::string* g_current_job = nullptr;
+thread_local const std::string* g_current_stream = nullptr;
+
+// Appends |value| as a quoted JSON string to |json|.
+void AppendJsonString(const std::string& value, std::string* json) {
+  *json += '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      *json += '\\';
+      *json += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      base::StringAppendF(json, "\\u%04x", c);
+    } else {
+      *json += c;
+    }
+  }
+  *json += '"';
+}
+
+}  // namespace
+
+const size_t TraceRecorder::kMaxEventsPerThread;
+
+struct TraceRecorder::Event {
+  const char* name = nullptr;
+  const char* category = nullptr;
+  int64_t start_time_us = 0;
+  int64_t duration_us = 0;
+  std::string job;
+  std::string stream;
+};
+
+// An append only list of events, written by a single thread and read by any
+// thread. The events are stored in fixed size blocks, which are published
+// with release stores once written, so neither side takes a lock.
+class TraceRecorder::ThreadBuffer {
+ public:
+  ThreadBuffer(int64_t thread_id, const std::string& thread_name)
+      : thread_id_(thread_id), thread_name_(thread_name) {}
+
+  ~ThreadBuffer() {
+    Block* block = head_.next.load(std::memory_order_relaxed);
+    while (block) {
+      Block* next = block->next.load(std::memory_order_relaxed);
+      delete block;
+      block = next;
+    }
+  }
+
+  // Must only be called on the thread owning the buffer.
+  void Add(Event event) {
+    if (num_events_ == kMaxEventsPerThread) {
+      if (!overflowed_) {
+        LOG(WARNING) << "Dropping the trace events of thread " << thread_name_
+                     << " after " << kMaxEventsPerThread << " events.";
+        overflowed_ = true;
+      }
+      return;
+    }
+    size_t size = tail_->size.load(std::memory_order_relaxed);
+    if (size == kBlockSize) {
+      Block* block = new Block;
+      tail_->next.store(block, std::memory_order_release);
+      tail_ = block;
+      size = 0;
+    }
+    tail_->events[size] = std::move(event);
+    tail_->size.store(size + 1, std::memory_order_release);
+    ++num_events_;
+  }
+
+  // Can be called on any thread.
+  template <typename Function>
+  void ForEach(Function function) const {
+    for (const Block* block = &head_; block;
+         block = block->next.load(std::memory_order_acquire)) {
+      const size_t size = block->size.load(std::memory_order_acquire);
+      for (size_t i = 0; i < size; ++i)
+        function(block->events[i]);
+    }
+  }
+
+  int64_t thread_id() const { return thread_id_; }
+  const std::string& thread_name() const { return thread_name_; }
+
+ private:
+  ThreadBuffer(const ThreadBuffer&) = delete;
+  ThreadBuffer& operator=(const ThreadBuffer&) = delete;
+
+  static const size_t kBlockSize = 1024;
+
+  struct Block {
+    Event events[kBlockSize];
+    std::atomic<size_t> size{0};
+    std::atomic<Block*> next{nullptr};
+  };
+
+  const int64_t thread_id_;
+  const std::string thread_name_;
+  Block head_;
+  // Only accessed by the writer.
+  Block* tail_ = &head_;
+  size_t num_events_ = 0;
+  bool overflowed_ = false;
+};
+
+TraceRecorder::TraceRecorder() = default;
+
+TraceRecorder::~TraceRecorder() = default;
+
+TraceRecorder* TraceRecorder::GetInstance() {
+  // Intentionally leaked, as the threads keep pointers to their buffers.
+  static TraceRecorder* instance = new TraceRecorder;
+  return instance;
+}
+
+void TraceRecorder::Start() {
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void TraceRecorder::Stop() {
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+void TraceRecorder::AddSpan(const char* name,
+                            const char* category,
+                            base::TimeTicks start_time,
+                            base::TimeDelta duration) {
+  Event event;
+  event.name = name;
+  event.category = category;
+  event.start_time_us = (start_time - base::TimeTicks()).InMicroseconds();
+  event.duration_us = duration.InMicroseconds();
+  if (g_current_job)
+    event.job = *g_current_job;
+  if (g_current_stream)
+    event.stream = *g_current_stream;
+  GetThreadBuffer()->Add(std::move(event));
+}
+
+std::string TraceRecorder::ExportJson() {
+  const int64_t process_id = static_cast<int64_t>(base::GetCurrentProcId());
+
+  std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first_event = true;
+  auto append_header = [&json, &first_event, process_id](
+                           const char* name, const char* phase,
+                           int64_t thread_id) {
+    if (!first_event)
+      json += ',';
+    first_event = false;
+    json += "{\"name\":";
+    AppendJsonString(name, &json);
+    base::StringAppendF(&json,
+                        ",\"ph\":\"%s\",\"pid\":%" PRId64 ",\"tid\":%" PRId64,
+                        phase, process_id, thread_id);
+  };
+
+  base::AutoLock auto_lock(lock_);
+  for (const auto& thread_buffer : thread_buffers_) {
+    const int64_t thread_id = thread_buffer->thread_id();
+    append_header("thread_name", "M", thread_id);
+    json += ",\"args\":{\"name\":";
+    AppendJsonString(thread_buffer->thread_name(), &json);
+    json += "}}";
+
+    thread_buffer->ForEach([&json, &append_header, thread_id](
+                               const Event& event) {
+      append_header(event.name, "X", thread_id);
+      json += ",\"cat\":";
+      AppendJsonString(event.category, &json);
+      base::StringAppendF(&json, ",\"ts\":%" PRId64 ",\"dur\":%" PRId64,
+                          event.start_time_us, event.duration_us);
+      json += ",\"args\":{";
+      if (!event.job.empty()) {
+        json += "\"job\":";
+        AppendJsonString(event.job, &json);
+      }
+      if (!event.stream.empty()) {
+        if (!event.job.empty())
+          json += ',';
+        json += "\"stream\":";
+        AppendJsonString(event.stream, &json);
+      }
+      json += "}}";
+    });
+  }
+  json += "]}";
+  return json;
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::GetThreadBuffer() {
+  // The buffer of the calling thread, once it recorded a span.
+  thread_local ThreadBuffer* thread_buffer = nullptr;
+  if (!thread_buffer) {
+    std::unique_ptr<ThreadBuffer> new_thread_buffer(new ThreadBuffer(
+        static_cast<int64_t>(base::PlatformThread::CurrentId()),
+        base::PlatformThread::GetName()));
+    thread_buffer = new_thread_buffer.get();
+    base::AutoLock auto_lock(lock_);
+    thread_buffers_.push_back(std::move(new_thread_buffer));
+  }
+  return thread_buffer;
+}
+
+ScopedTraceJob::ScopedTraceJob(const std::string& job)
+    : parent_(g_current_job) {
+  g_current_job = &job;
+}
+
+ScopedTraceJob::~ScopedTraceJob() {
+  g_current_job = parent_;
+}
+
+const std::string* ScopedTraceJob::Current() {
+  return g_current_job;
+}
+
+ScopedTraceStream::ScopedTraceStream(const std::string& stream)
+    : parent_(g_current_stream) {
+  if (!stream.empty())
+    g_current_stream = &stream;
+}
+
+ScopedTraceStream::~ScopedTraceStream() {
+  g_current_stream = parent_;
+}
+
+const std::string* ScopedTraceStream::Current() {
+  return g_current_stream;
+}
+
+}  // namespace shaka
@@ -0,0 +1,151 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_TRACE_RECORDER_H_
+#define PACKAGER_METRICS_TRACE_RECORDER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// Records spans of the packaging pipeline, which are exported in the Chrome
+/// trace event JSON format, e.g. to be viewed in chrome://tracing or
+/// Perfetto. Each thread appends its events to its own buffer without taking
+/// any lock, so recording has little impact on the pipeline. Spans are tagged
+/// with the job, i.e. the input, and the stream of the thread that records
+/// them, see ScopedTraceJob and ScopedTraceStream.
+class TraceRecorder {
+ public:
+  /// The spans recorded by a thread beyond this number are dropped.
+  static const size_t kMaxEventsPerThread = 1 << 20;
+
+  /// @return the process wide recorder.
+  static TraceRecorder* GetInstance();
+
+  /// @return true if spans are being recorded.
+  static bool IsEnabled() {
+    return GetInstance()->enabled_.load(std::memory_order_relaxed);
+  }
+
+  /// Start recording spans. The spans recorded before are kept.
+  void Start();
+
+  /// Stop recording spans.
+  void Stop();
+
+  /// Record a span which started at @a start_time and lasted @a duration, on
+  /// the calling thread. It is tagged with the current job and stream of the
+  /// thread.
+  /// @param name is the name of the span. It must be a string literal.
+  /// @param category is the category of the span. It must be a string
+  ///        literal.
+  void AddSpan(const char* name,
+               const char* category,
+               base::TimeTicks start_time,
+               base::TimeDelta duration);
+
+  /// @return All the recorded spans, in the Chrome trace event JSON format.
+  ///         Can be called while spans are recorded.
+  std::string ExportJson();
+
+ private:
+  TraceRecorder();
+  ~TraceRecorder();
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  struct Event;
+  class ThreadBuffer;
+
+  ThreadBuffer* GetThreadBuffer();
+
+  std::atomic<bool> enabled_{false};
+
+  base::Lock lock_;
+  // Buffers of the threads which recorded spans. They are never deleted, as
+  // the threads keep pointers to them. Protected by |lock_|.
+  std::vector<std::unique_ptr<ThreadBuffer>> thread_buffers_;
+};
+
+/// Records a span covering its scope, if the recorder is enabled when it is
+/// constructed.
+class ScopedTraceEvent {
+ public:
+  /// @param name is the name of the span. It must be a string literal.
+  /// @param category is the category of the span. It must be a string
+  ///        literal.
+  ScopedTraceEvent(const char* name, const char* category)
+      : name_(name), category_(category) {
+    if (TraceRecorder::IsEnabled()) {
+      enabled_ = true;
+      start_time_ = base::TimeTicks::Now();
+    }
+  }
+
+  ~ScopedTraceEvent() {
+    if (enabled_) {
+      TraceRecorder::GetInstance()->AddSpan(
+          name_, category_, start_time_, base::TimeTicks::Now() - start_time_);
+    }
+  }
+
+ private:
+  ScopedTraceEvent(const ScopedTraceEvent&) = delete;
+  ScopedTraceEvent& operator=(const ScopedTraceEvent&) = delete;
+
+  const char* const name_;
+  const char* const category_;
+  bool enabled_ = false;
+  base::TimeTicks start_time_;
+};
+
+/// Tags the spans recorded on the calling thread in its scope with @a job.
+class ScopedTraceJob {
+ public:
+  /// @param job must outlive this object.
+  explicit ScopedTraceJob(const std::string& job);
+  ~ScopedTraceJob();
+
+  /// @return The job of the calling thread, or nullptr.
+  static const std::string* Current();
+
+ private:
+  ScopedTraceJob(const ScopedTraceJob&) = delete;
+  ScopedTraceJob& operator=(const ScopedTraceJob&) = delete;
+
+  const std::string* const parent_;
+};
+
+/// Tags the spans recorded on the calling thread in its scope with
+/// @a stream. Nested scopes override the enclosing ones, unless their stream
+/// is empty.
+class ScopedTraceStream {
+ public:
+  /// @param stream must outlive this object.
+  explicit ScopedTraceStream(const std::string& stream);
+  ~ScopedTraceStream();
+
+  /// @return The stream of the calling thread, or nullptr.
+  static const std::string* Current();
+
+ private:
+  ScopedTraceStream(const ScopedTraceStream&) = delete;
+  ScopedTraceStream& operator=(const ScopedTraceStream&) = delete;
+
+  const std::string* const parent_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_TRACE_RECORDER_H_
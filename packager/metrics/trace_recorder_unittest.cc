@@ -0,0 +1,98 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/trace_recorder.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace shaka {
+namespace {
+
+size_t CountOccurrences(const std::string& text, const std::string& pattern) {
+  size_t count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+}  // namespace
+
+// The recorder is process wide, so each test records spans with its own name.
+
+TEST(TraceRecorderTest, RecordsTaggedSpans) {
+  TraceRecorder* recorder = TraceRecorder::GetInstance();
+  recorder->Start();
+  {
+    const std::string job = "input.mp4";
+    const std::string stream = "Muxer:\"video\".mp4";
+    ScopedTraceJob trace_job(job);
+    ScopedTraceStream trace_stream(stream);
+    ScopedTraceEvent trace_event("TaggedSpan", "test");
+  }
+  recorder->Stop();
+
+  const std::string json = recorder->ExportJson();
+  EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  EXPECT_NE(std::string::npos,
+            json.find("\"name\":\"TaggedSpan\",\"ph\":\"X\""))
+      << json;
+  EXPECT_NE(std::string::npos,
+            json.find("\"args\":{\"job\":\"input.mp4\","
+                      "\"stream\":\"Muxer:\\\"video\\\".mp4\"}"))
+      << json;
+  EXPECT_EQ(nullptr, ScopedTraceJob::Current());
+  EXPECT_EQ(nullptr, ScopedTraceStream::Current());
+}
+
+TEST(TraceRecorderTest, NestedStreams) {
+  const std::string outer = "outer";
+  const std::string inner = "inner";
+  ScopedTraceStream outer_stream(outer);
+  {
+    ScopedTraceStream inner_stream(inner);
+    EXPECT_EQ(&inner, ScopedTraceStream::Current());
+  }
+  EXPECT_EQ(&outer, ScopedTraceStream::Current());
+  {
+    const std::string unnamed;
+    ScopedTraceStream unnamed_stream(unnamed);
+    EXPECT_EQ(&outer, ScopedTraceStream::Current());
+  }
+}
+
+TEST(TraceRecorderTest, IgnoresSpansWhenDisabled) {
+  TraceRecorder* recorder = TraceRecorder::GetInstance();
+  ASSERT_FALSE(TraceRecorder::IsEnabled());
+  { ScopedTraceEvent trace_event("DisabledSpan", "test"); }
+  EXPECT_EQ(std::string::npos, recorder->ExportJson().find("DisabledSpan"));
+}
+
+TEST(TraceRecorderTest, RecordsSpansOfAllThreads) {
+  // More than a block of events per thread.
+  const size_t kNumSpans = 3000;
+  TraceRecorder* recorder = TraceRecorder::GetInstance();
+  recorder->Start();
+  auto record_spans = [kNumSpans]() {
+    for (size_t i = 0; i < kNumSpans; ++i)
+      ScopedTraceEvent trace_event("ThreadSpan", "test");
+  };
+  std::thread thread1(record_spans);
+  std::thread thread2(record_spans);
+  // Export concurrently with the recording.
+  recorder->ExportJson();
+  thread1.join();
+  thread2.join();
+  recorder->Stop();
+
+  EXPECT_EQ(2 * kNumSpans,
+            CountOccurrences(recorder->ExportJson(), "\"ThreadSpan\""));
+}
+
+}  // namespace shaka
@@ -6,6 +6,7 @@
 
 #include "packager/mpd/base/adaptation_set.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "packager/base/logging.h"
@@ -190,6 +191,7 @@ Representation* AdaptationSet::AddRepresentation(const MediaInfo& media_info) {
     return NULL;
   }
   UpdateFromMediaInfo(media_info);
+  cached_xml_.reset();
   Representation* representation_ptr = new_representation.get();
   representation_map_[representation_ptr->id()] = std::move(new_representation);
   return representation_ptr;
@@ -205,30 +207,67 @@ Representation* AdaptationSet::CopyRepresentation(
       new Representation(representation, std::move(listener)));
 
   UpdateFromMediaInfo(new_representation->GetMediaInfo());
+  cached_xml_.reset();
   Representation* representation_ptr = new_representation.get();
   representation_map_[representation_ptr->id()] = std::move(new_representation);
   return representation_ptr;
 }
 
+void AdaptationSet::RemoveRepresentation(uint32_t representation_id) {
+  representation_map_.erase(representation_id);
+  timeline_positions_.erase(representation_id);
+
+  video_widths_.clear();
+  video_heights_.clear();
+  video_frame_rates_.clear();
+  picture_aspect_ratio_.clear();
+  for (const auto& representation_pair : representation_map_)
+    UpdateFromMediaInfo(representation_pair.second->GetMediaInfo());
+  cached_xml_.reset();
+}
+
 void AdaptationSet::AddContentProtectionElement(
     const ContentProtectionElement& content_protection_element) {
   content_protection_elements_.push_back(content_protection_element);
   RemoveDuplicateAttributes(&content_protection_elements_.back());
+  cached_xml_.reset();
 }
 
 void AdaptationSet::UpdateContentProtectionPssh(const std::string& drm_uuid,
                                                 const std::string& pssh) {
   UpdateContentProtectionPsshHelper(drm_uuid, pssh,
                                     &content_protection_elements_);
+  cached_xml_.reset();
 }
 
 void AdaptationSet::AddAccessibility(const std::string& scheme,
                                      const std::string& value) {
   accessibilities_.push_back(Accessibility{scheme, value});
+  cached_xml_.reset();
 }
 
 void AdaptationSet::AddRole(Role role) {
   roles_.insert(role);
+  cached_xml_.reset();
+}
+
+xml::scoped_xml_ptr<xmlNode> AdaptationSet::GetXml() {
+  if (XmlChanged()) {
+    cached_xml_ = GenerateXml();
+    if (!cached_xml_)
+      return xml::scoped_xml_ptr<xmlNode>();
+  }
+  return xml::scoped_xml_ptr<xmlNode>(xmlCopyNode(cached_xml_.get(), 1));
+}
+
+bool AdaptationSet::XmlChanged() const {
+  if (!cached_xml_)
+    return true;
+  for (const auto& representation_pair : representation_map_) {
+    if (representation_pair.second->XmlChanged())
+      return true;
+  }
+  return false;
 }
 
 // Creates a copy of <AdaptationSet> xml element, iterate thru all the
@@ -237,7 +276,7 @@ void AdaptationSet::AddRole(Role role) {
 // can be passed to Representation to avoid setting redundant attributes. For
 // example, if AdaptationSet@width is set, then Representation@width is
 // redundant and should not be set.
-xml::scoped_xml_ptr<xmlNode> AdaptationSet::GetXml() {
+xml::scoped_xml_ptr<xmlNode> AdaptationSet::GenerateXml() {
   xml::AdaptationSetXmlNode adaptation_set;
 
   bool suppress_representation_width = false;
@@ -348,38 +387,38 @@ void AdaptationSet::ForceSetSegmentAlignment(bool segment_alignment) {
   segments_aligned_ =
       segment_alignment ? kSegmentAlignmentTrue : kSegmentAlignmentFalse;
   force_set_segment_alignment_ = true;
+  cached_xml_.reset();
 }
 
 void AdaptationSet::AddAdaptationSetSwitching(
     const AdaptationSet* adaptation_set) {
   switchable_adaptation_sets_.push_back(adaptation_set);
+  cached_xml_.reset();
 }
 
-// For dynamic MPD, storing all start_time and duration will out-of-memory
-// because there's no way of knowing when it will end. Static MPD
-// subsegmentAlignment check is *not* done here because it is possible that some
-// Representations might not have been added yet (e.g. a thread is assigned per
-// muxer so one might run faster than others). To be clear, for dynamic MPD, all
-// Representations should be added before a segment is added.
+// The segments are checked as they are added. For static MPD, it is possible
+// that some Representations have not been added yet (e.g. a thread is assigned
+// per muxer so one might run faster than others), so whether all the segments
+// are aligned is only decided in CheckStaticSegmentAlignment(). To be clear,
+// for dynamic MPD, all Representations should be added before a segment is
+// added.
 void AdaptationSet::OnNewSegmentForRepresentation(uint32_t representation_id,
                                                   uint64_t start_time,
-                                                  uint64_t duration) {
-  if (mpd_options_.mpd_type == MpdType::kDynamic) {
-    CheckDynamicSegmentAlignment(representation_id, start_time, duration);
-  } else {
-    representation_segment_start_times_[representation_id].push_back(
-        start_time);
-  }
+                                                  uint64_t /* duration */) {
+  cached_xml_.reset();
+  CheckSegmentAlignment(representation_id, start_time);
 }
 
 void AdaptationSet::OnSetFrameRateForRepresentation(uint32_t representation_id,
                                                     uint32_t frame_duration,
                                                     uint32_t timescale) {
   RecordFrameRate(frame_duration, timescale);
+  cached_xml_.reset();
 }
 
 void AdaptationSet::AddTrickPlayReference(const AdaptationSet* adaptation_set) {
   trick_play_references_.push_back(adaptation_set);
+  cached_xml_.reset();
 }
 
 const std::list<Representation*> AdaptationSet::GetRepresentations() const {
@@ -424,121 +463,151 @@ void AdaptationSet::UpdateFromMediaInfo(const MediaInfo& media_info) {
   }
 }
 
-// This implementation assumes that each representations' segments' are
-// contiguous.
-// Also assumes that all Representations are added before this is called.
-// This checks whether the first elements of the lists in
-// representation_segment_start_times_ are aligned.
-// For example, suppose this method was just called with args rep_id=2
-// start_time=1.
-// 1 -> [1, 100, 200]
-// 2 -> [1]
-// The timestamps of the first elements match, so this flags
-// segments_aligned_=true.
-// Also since the first segment start times match, the first element of all the
-// lists are removed, so the map of lists becomes:
-// 1 -> [100, 200]
-// 2 -> []
-// Note that there could be false positives.
-// e.g. just got rep_id=3 start_time=1 duration=300, and the duration of the
-// whole AdaptationSet is 300.
-// 1 -> [1, 100, 200]
-// 2 -> [1, 90, 100]
-// 3 -> [1]
-// They are not aligned but this will be marked as aligned.
-// But since this is unlikely to happen in the packager (and to save
-// computation), this isn't handled at the moment.
-void AdaptationSet::CheckDynamicSegmentAlignment(uint32_t representation_id,
-                                                 uint64_t start_time,
-                                                 uint64_t /* duration */) {
+// The n-th segment of every Representation is expected to start at the same
+// time. This implementation assumes that each Representation's segments are
+// added in order. The start times of the Representation furthest ahead are
+// kept run-length encoded in |expected_start_times_|, and every Representation
+// keeps its position in them, so each new segment is checked in constant time.
+// For example, after Representation 1 added segments at 0, 100, 200 and
+// Representation 2 added a segment at 0:
+// expected_start_times_: [{start_time=0, step=100, count=3}]
+// 1 -> {run_index=0, offset=3}
+// 2 -> {run_index=0, offset=1}
+// A new segment of Representation 2 must start at 100, and a new segment of
+// Representation 1 at 300 extends the run.
+void AdaptationSet::CheckSegmentAlignment(uint32_t representation_id,
+                                          uint64_t start_time) {
   if (segments_aligned_ == kSegmentAlignmentFalse ||
       force_set_segment_alignment_) {
     return;
   }
 
-  std::list<uint64_t>& current_representation_start_times =
-      representation_segment_start_times_[representation_id];
-  current_representation_start_times.push_back(start_time);
-  // There's no way to detemine whether the segments are aligned if some
-  // representations do not have any segments.
-  if (representation_segment_start_times_.size() != representation_map_.size())
-    return;
-
-  DCHECK(!current_representation_start_times.empty());
-  const uint64_t expected_start_time =
-      current_representation_start_times.front();
-  for (const auto& key_value : representation_segment_start_times_) {
-    const std::list<uint64_t>& representation_start_time = key_value.second;
-    // If there are no entries in a list, then there is no way for the
-    // segment alignment status to change.
-    // Note that it can be empty because entries get deleted below.
-    if (representation_start_time.empty())
-      return;
-
-    if (expected_start_time != representation_start_time.front()) {
+  auto position_iter = timeline_positions_.find(representation_id);
+  if (position_iter == timeline_positions_.end()) {
+    // In a dynamic MPD, a Representation may be added after the others
+    // started, so its first segment is checked against the segment starting
+    // at the same time rather than the first segment of the others.
+    const TimelinePosition joining_position =
+        mpd_options_.mpd_type == MpdType::kDynamic
+            ? JoinTimeline(start_time)
+            : TimelinePosition();
+    position_iter =
+        timeline_positions_.emplace(representation_id, joining_position).first;
+  }
+  TimelinePosition& position = position_iter->second;
+  // Skip the runs the Representation is past, but stay on the last run, which
+  // may still be extended.
+  while (position.run_index + 1 < expected_start_times_.size() &&
+         position.offset == expected_start_times_[position.run_index].count) {
+    ++position.run_index;
+    position.offset = 0;
+  }
+  if (position.run_index < expected_start_times_.size() &&
+      position.offset < expected_start_times_[position.run_index].count) {
+    const StartTimeRun& run = expected_start_times_[position.run_index];
+    const uint64_t expected_start_time =
+        run.start_time + position.offset * run.step;
+    if (expected_start_time != start_time) {
       VLOG(1) << "Seeing Misaligned segments with different start_times: "
-              << expected_start_time << " vs "
-              << representation_start_time.front();
+              << expected_start_time << " vs " << start_time;
       // Flag as false and clear the start times data, no need to keep it
       // around.
       segments_aligned_ = kSegmentAlignmentFalse;
-      representation_segment_start_times_.clear();
+      expected_start_times_.clear();
+      timeline_positions_.clear();
       return;
     }
+  } else {
+    // This is the Representation furthest ahead.
+    AppendExpectedStartTime(start_time);
+    if (position.run_index < expected_start_times_.size() &&
+        position.offset == expected_start_times_[position.run_index].count) {
+      ++position.run_index;
+      position.offset = 0;
+    }
   }
+  ++position.offset;
+  ++position.segment_count;
+
+  if (mpd_options_.mpd_type != MpdType::kDynamic)
+    return;
+  // There's no way to determine whether the segments are aligned if some
+  // representations do not have any segments.
+  if (timeline_positions_.size() != representation_map_.size())
+    return;
   segments_aligned_ = kSegmentAlignmentTrue;
 
-  for (auto& key_value : representation_segment_start_times_) {
-    std::list<uint64_t>& representation_start_time = key_value.second;
-    representation_start_time.pop_front();
+  // Storing the entire timeline of a dynamic MPD is not reasonable, so the runs
+  // all the Representations are past are dropped.
+  size_t runs_to_drop = expected_start_times_.size();
+  for (const auto& key_value : timeline_positions_)
+    runs_to_drop = std::min(runs_to_drop, key_value.second.run_index);
+  if (runs_to_drop == 0)
+    return;
+  expected_start_times_.erase(expected_start_times_.begin(),
+                              expected_start_times_.begin() + runs_to_drop);
+  for (auto& key_value : timeline_positions_)
+    key_value.second.run_index -= runs_to_drop;
+}
+
+void AdaptationSet::AppendExpectedStartTime(uint64_t start_time) {
+  if (!expected_start_times_.empty()) {
+    StartTimeRun& run = expected_start_times_.back();
+    if (run.count == 1 && start_time > run.start_time) {
+      run.step = start_time - run.start_time;
+      run.count = 2;
+      return;
+    }
+    if (run.count > 1 && start_time == run.start_time + run.count * run.step) {
+      ++run.count;
+      return;
+    }
   }
+  expected_start_times_.push_back({start_time, 0, 1});
 }
 
-// Make sure all segements start times match for all Representations.
-// This assumes that the segments are contiguous.
+AdaptationSet::TimelinePosition AdaptationSet::JoinTimeline(
+    uint64_t start_time) {
+  TimelinePosition position;
+  for (size_t i = 0; i < expected_start_times_.size(); ++i) {
+    StartTimeRun& run = expected_start_times_[i];
+    if (start_time < run.start_time)
+      break;
+    const uint64_t last_start_time =
+        run.start_time + (run.count - 1) * run.step;
+    if (start_time > last_start_time) {
+      if (i + 1 < expected_start_times_.size())
+        continue;
+      // The Representation is ahead of the others. The start times the others
+      // have not reached yet are expected to follow the last run.
+      if (run.step > 0 && (start_time - run.start_time) % run.step == 0)
+        run.count = (start_time - run.start_time) / run.step;
+      position.run_index = i;
+      position.offset = run.count;
+      break;
+    }
+    if (run.step == 0 || (start_time - run.start_time) % run.step == 0) {
+      position.run_index = i;
+      position.offset =
+          run.step == 0 ? 0 : (start_time - run.start_time) / run.step;
+    }
+    break;
+  }
+  // If the segment does not start at any of the start times, it is checked
+  // against the first one, which flags the misalignment.
+  return position;
+}
+
+// Make sure all segements start times match for all Representations. The start
+// times are checked as the segments are added, so only the number of segments
+// is left to compare.
 void AdaptationSet::CheckStaticSegmentAlignment() {
   if (segments_aligned_ == kSegmentAlignmentFalse ||
       force_set_segment_alignment_) {
     return;
   }
-  if (representation_segment_start_times_.empty())
-    return;
-  if (representation_segment_start_times_.size() == 1) {
-    segments_aligned_ = kSegmentAlignmentTrue;
+  if (timeline_positions_.empty())
     return;
-  }
-
-  // This is not the most efficient implementation to compare the values
-  // because expected_time_line is compared against all other time lines, but
-  // probably the most readable.
-  const std::list<uint64_t>& expected_time_line =
-      representation_segment_start_times_.begin()->second;
-
-  bool all_segment_time_line_same_length = true;
-  // Note that the first entry is skipped because it is expected_time_line.
-  RepresentationTimeline::const_iterator it =
-      representation_segment_start_times_.begin();
-  for (++it; it != representation_segment_start_times_.end(); ++it) {
-    const std::list<uint64_t>& other_time_line = it->second;
-    if (expected_time_line.size() != other_time_line.size()) {
-      all_segment_time_line_same_length = false;
-    }
-
-    const std::list<uint64_t>* longer_list = &other_time_line;
-    const std::list<uint64_t>* shorter_list = &expected_time_line;
-    if (expected_time_line.size() > other_time_line.size()) {
-      shorter_list = &other_time_line;
-      longer_list = &expected_time_line;
-    }
-
-    if (!std::equal(shorter_list->begin(), shorter_list->end(),
-                    longer_list->begin())) {
-      // Some segments are definitely unaligned.
-      segments_aligned_ = kSegmentAlignmentFalse;
-      representation_segment_start_times_.clear();
-      return;
-    }
-  }
 
   // TODO(rkuroiwa): The right way to do this is to also check the durations.
   // For example:
@@ -546,9 +615,13 @@ void AdaptationSet::CheckStaticSegmentAlignment() {
   // (b)  3 4 5 6
   // could be true or false depending on the length of the third segment of (a).
   // i.e. if length of the third segment is 2, then this is not aligned.
-  if (!all_segment_time_line_same_length) {
-    segments_aligned_ = kSegmentAlignmentUnknown;
-    return;
+  const uint64_t segment_count =
+      timeline_positions_.begin()->second.segment_count;
+  for (const auto& key_value : timeline_positions_) {
+    if (key_value.second.segment_count != segment_count) {
+      segments_aligned_ = kSegmentAlignmentUnknown;
+      return;
+    }
   }
 
   segments_aligned_ = kSegmentAlignmentTrue;
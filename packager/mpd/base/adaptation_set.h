@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
@@ -69,6 +70,12 @@ class AdaptationSet {
   virtual Representation* CopyRepresentation(
       const Representation& representation);
 
+  /// Remove the Representation with @a representation_id, e.g. of a stream
+  /// detached from a running live session. The attributes derived from the
+  /// Representations, e.g. @maxWidth, are updated accordingly.
+  /// @param representation_id is the id of the Representation.
+  virtual void RemoveRepresentation(uint32_t representation_id);
+
   /// Add a ContenProtection element to the adaptation set.
   /// AdaptationSet does not add <ContentProtection> elements
   /// automatically to itself even if @a media_info.protected_content is
@@ -110,10 +117,16 @@ class AdaptationSet {
 
   /// Makes a copy of AdaptationSet xml element with its child Representation
   /// and ContentProtection elements.
+  /// The element is only regenerated if the AdaptationSet or one of its
+  /// Representations changed since the last call.
   /// @return On success returns a non-NULL scoped_xml_ptr. Otherwise returns a
   ///         NULL scoped_xml_ptr.
   xml::scoped_xml_ptr<xmlNode> GetXml();
 
+  /// @return true if the AdaptationSet or one of its Representations changed
+  ///         since the last call to GetXml().
+  bool XmlChanged() const;
+
   /// Forces the (sub)segmentAlignment field to be set to @a segment_alignment.
   /// Use this if you are certain that the (sub)segments are alinged/unaligned
   /// for the AdaptationSet.
@@ -133,7 +146,10 @@ class AdaptationSet {
 
   /// Set AdaptationSet@id.
   /// @param id is the new ID to be set.
-  void set_id(uint32_t id) { id_ = id; }
+  void set_id(uint32_t id) {
+    id_ = id;
+    cached_xml_.reset();
+  }
 
   /// Notifies the AdaptationSet instance that a new (sub)segment was added to
   /// the Representation with @a representation_id.
@@ -214,36 +230,55 @@ class AdaptationSet {
     kSegmentAlignmentFalse
   };
 
-  // This maps Representations (IDs) to a list of start times of the segments.
-  // e.g.
-  // If Representation 1 has start time 0, 100, 200 and Representation 2 has
-  // start times 0, 200, 400, then the map contains:
-  // 1 -> [0, 100, 200]
-  // 2 -> [0, 200, 400]
-  typedef std::map<uint32_t, std::list<uint64_t>> RepresentationTimeline;
+  // A run of |count| segment start times: |start_time|,
+  // |start_time| + |step|, |start_time| + 2 * |step|, ...
+  // |step| is 0 if |count| is 1.
+  struct StartTimeRun {
+    uint64_t start_time;
+    uint64_t step;
+    uint64_t count;
+  };
+
+  // The position of the next segment of a Representation in
+  // |expected_start_times_|.
+  struct TimelinePosition {
+    size_t run_index = 0;
+    uint64_t offset = 0;
+    uint64_t segment_count = 0;
+  };
 
   // Update AdaptationSet attributes for new MediaInfo.
   void UpdateFromMediaInfo(const MediaInfo& media_info);
 
-  /// Called from OnNewSegmentForRepresentation(). Checks whether the segments
-  /// are aligned. Sets segments_aligned_.
-  /// This is only for dynamic MPD. For static MPD,
-  /// CheckStaticSegmentAlignment() should be used.
+  /// Called from OnNewSegmentForRepresentation(). Checks the start time of the
+  /// new segment against the segments of the other Representations with the
+  /// same index, and sets segments_aligned_ to false if they differ. For
+  /// dynamic MPD, sets segments_aligned_ to true once all the Representations
+  /// have segments.
   /// @param representation_id is the id of the Representation with a new
   ///        segment.
   /// @param start_time is the start time of the new segment.
-  /// @param duration is the duration of the new segment.
-  void CheckDynamicSegmentAlignment(uint32_t representation_id,
-                                    uint64_t start_time,
-                                    uint64_t duration);
+  void CheckSegmentAlignment(uint32_t representation_id, uint64_t start_time);
+
+  // Appends |start_time| to |expected_start_times_|.
+  void AppendExpectedStartTime(uint64_t start_time);
+
+  // @return The position in |expected_start_times_| of a Representation
+  //         added after the others started, whose first segment starts at
+  //         |start_time|.
+  TimelinePosition JoinTimeline(uint64_t start_time);
 
-  // Checks representation_segment_start_times_ and sets segments_aligned_.
+  // Sets segments_aligned_ to true if all the Representations checked so far
+  // have the same number of segments.
   // Use this for static MPD, do not use for dynamic MPD.
   void CheckStaticSegmentAlignment();
 
   // Records the framerate of a Representation.
   void RecordFrameRate(uint32_t frame_duration, uint32_t timescale);
 
+  // Generates the <AdaptationSet> element, see GetXml().
+  xml::scoped_xml_ptr<xmlNode> GenerateXml();
+
   std::list<ContentProtectionElement> content_protection_elements_;
   // representation_id => Representation map. It also keeps the representations_
   // sorted by default.
@@ -303,20 +338,24 @@ class AdaptationSet {
   SegmentAligmentStatus segments_aligned_;
   bool force_set_segment_alignment_;
 
-  // Keeps track of segment start times of Representations.
-  // For static MPD, this will not be cleared, all the segment start times are
-  // stored in this. This should not out-of-memory for a reasonable length
-  // video and reasonable subsegment length.
-  // For dynamic MPD, the entries are deleted (see
-  // CheckDynamicSegmentAlignment() implementation comment) because storing the
-  // entire timeline is not reasonable and may cause an out-of-memory problem.
-  RepresentationTimeline representation_segment_start_times_;
+  // The segment start times of the Representation furthest ahead, run-length
+  // encoded, which the segments of the other Representations are checked
+  // against as they are added. Segments of the same duration take one run.
+  // For dynamic MPD, the runs all the Representations are past are dropped.
+  std::deque<StartTimeRun> expected_start_times_;
+  // Representation ID => position of its next segment in
+  // |expected_start_times_|, for the Representations with segments.
+  std::map<uint32_t, TimelinePosition> timeline_positions_;
 
   // Record the original AdaptationSets the trick play stream belongs to. There
   // can be more than one reference AdaptationSets as multiple streams e.g. SD
   // and HD videos in different AdaptationSets can share the same trick play
   // stream.
   std::vector<const AdaptationSet*> trick_play_references_;
+
+  // The element generated by the last call to GetXml(). Reset whenever the
+  // AdaptationSet changes.
+  xml::scoped_xml_ptr<xmlNode> cached_xml_;
 };
 
 }  // namespace shaka
@@ -812,6 +812,105 @@ TEST_F(LiveAdaptationSetTest, SegmentAlignmentDynamicMpd) {
   EXPECT_THAT(unaligned.get(), Not(AttributeSet("segmentAlignment")));
 }
 
+// Verify that the segments of a Representation added to a dynamic MPD after
+// the others started are checked against the segments starting at the same
+// time.
+TEST_F(LiveAdaptationSetTest, SegmentAlignmentDynamicMpdLateRepresentation) {
+  const uint64_t kDuration = 10u;
+  const uint64_t kAnySize = 19834u;
+
+  const char k480pMediaInfo[] =
+      "video_info {\n"
+      "  codec: 'avc1'\n"
+      "  width: 720\n"
+      "  height: 480\n"
+      "  time_scale: 10\n"
+      "  frame_duration: 10\n"
+      "  pixel_width: 8\n"
+      "  pixel_height: 9\n"
+      "}\n"
+      "container_type: 1\n";
+  const char k360pMediaInfo[] =
+      "video_info {\n"
+      "  codec: 'avc1'\n"
+      "  width: 640\n"
+      "  height: 360\n"
+      "  time_scale: 10\n"
+      "  frame_duration: 10\n"
+      "  pixel_width: 1\n"
+      "  pixel_height: 1\n"
+      "}\n"
+      "container_type: 1\n";
+
+  mpd_options_.mpd_type = MpdType::kDynamic;
+  auto adaptation_set = CreateAdaptationSet(kNoLanguage);
+  Representation* representation_480p =
+      adaptation_set->AddRepresentation(ConvertToMediaInfo(k480pMediaInfo));
+  for (int i = 0; i < 3; ++i)
+    representation_480p->AddNewSegment(i * kDuration, kDuration, kAnySize);
+
+  // The late Representation starts ahead of the other one.
+  Representation* representation_360p =
+      adaptation_set->AddRepresentation(ConvertToMediaInfo(k360pMediaInfo));
+  representation_360p->AddNewSegment(5 * kDuration, kDuration, kAnySize);
+  for (int i = 3; i < 6; ++i)
+    representation_480p->AddNewSegment(i * kDuration, kDuration, kAnySize);
+  xml::scoped_xml_ptr<xmlNode> aligned(adaptation_set->GetXml());
+  EXPECT_THAT(aligned.get(), AttributeEqual("segmentAlignment", "true"));
+
+  // The removed Representation is not checked anymore.
+  adaptation_set->RemoveRepresentation(representation_360p->id());
+  representation_480p->AddNewSegment(6 * kDuration, kDuration, kAnySize);
+  aligned = adaptation_set->GetXml();
+  EXPECT_THAT(aligned.get(), AttributeEqual("segmentAlignment", "true"));
+
+  // A late Representation not starting at a segment boundary is not aligned.
+  representation_360p =
+      adaptation_set->AddRepresentation(ConvertToMediaInfo(k360pMediaInfo));
+  representation_360p->AddNewSegment(5 * kDuration + 1, kDuration, kAnySize);
+  xml::scoped_xml_ptr<xmlNode> unaligned(adaptation_set->GetXml());
+  EXPECT_THAT(unaligned.get(), Not(AttributeSet("segmentAlignment")));
+}
+
+// Verify that the XML is only regenerated when the AdaptationSet or one of its
+// Representations changes.
+TEST_F(LiveAdaptationSetTest, XmlChanged) {
+  const char kVideoMediaInfo[] =
+      "video_info {\n"
+      "  codec: 'avc1'\n"
+      "  width: 720\n"
+      "  height: 480\n"
+      "  time_scale: 10\n"
+      "  frame_duration: 10\n"
+      "  pixel_width: 1\n"
+      "  pixel_height: 1\n"
+      "}\n"
+      "container_type: 1\n";
+
+  mpd_options_.mpd_type = MpdType::kDynamic;
+  auto adaptation_set = CreateAdaptationSet(kNoLanguage);
+  Representation* representation =
+      adaptation_set->AddRepresentation(ConvertToMediaInfo(kVideoMediaInfo));
+  EXPECT_TRUE(adaptation_set->XmlChanged());
+
+  xml::scoped_xml_ptr<xmlNode> xml(adaptation_set->GetXml());
+  EXPECT_FALSE(adaptation_set->XmlChanged());
+  EXPECT_FALSE(representation->XmlChanged());
+  // The cached XML is returned.
+  EXPECT_EQ(XmlNodeToString(xml.get()),
+            XmlNodeToString(adaptation_set->GetXml().get()));
+
+  representation->AddNewSegment(0, 10, 1000);
+  EXPECT_TRUE(representation->XmlChanged());
+  EXPECT_TRUE(adaptation_set->XmlChanged());
+  xml = adaptation_set->GetXml();
+  EXPECT_FALSE(adaptation_set->XmlChanged());
+
+  adaptation_set->AddRole(AdaptationSet::kRoleMain);
+  EXPECT_TRUE(adaptation_set->XmlChanged());
+  EXPECT_FALSE(representation->XmlChanged());
+}
+
 // Verify that segmentAlignment is set to true if all the Representations
 // segments' are aligned and the DASH profile is Live and MPD type is static.
 TEST_F(LiveAdaptationSetTest, SegmentAlignmentStaticMpd) {
@@ -935,6 +1034,43 @@ TEST_F(OnDemandAdaptationSetTest, AdaptationSetMaxWidthAndMaxHeight) {
   EXPECT_THAT(adaptation_set_xml.get(), Not(AttributeSet("height")));
 }
 
+// Verify that the attributes derived from the Representations are updated
+// when a Representation is removed.
+TEST_F(OnDemandAdaptationSetTest, RemoveRepresentation) {
+  const char kVideoMediaInfo1080p[] =
+      "video_info {\n"
+      "  codec: \"avc1\"\n"
+      "  width: 1920\n"
+      "  height: 1080\n"
+      "  time_scale: 3000\n"
+      "  frame_duration: 100\n"
+      "}\n"
+      "container_type: 1\n";
+  const char kVideoMediaInfo720p[] =
+      "video_info {\n"
+      "  codec: \"avc1\"\n"
+      "  width: 1280\n"
+      "  height: 720\n"
+      "  time_scale: 3000\n"
+      "  frame_duration: 100\n"
+      "}\n"
+      "container_type: 1\n";
+  auto adaptation_set = CreateAdaptationSet(kNoLanguage);
+  Representation* representation_1080p = adaptation_set->AddRepresentation(
+      ConvertToMediaInfo(kVideoMediaInfo1080p));
+  ASSERT_TRUE(representation_1080p);
+  ASSERT_TRUE(adaptation_set->AddRepresentation(
+      ConvertToMediaInfo(kVideoMediaInfo720p)));
+
+  adaptation_set->RemoveRepresentation(representation_1080p->id());
+  EXPECT_EQ(1u, adaptation_set->GetRepresentations().size());
+  xml::scoped_xml_ptr<xmlNode> adaptation_set_xml(adaptation_set->GetXml());
+  EXPECT_THAT(adaptation_set_xml.get(), AttributeEqual("width", "1280"));
+  EXPECT_THAT(adaptation_set_xml.get(), AttributeEqual("height", "720"));
+  EXPECT_THAT(adaptation_set_xml.get(), Not(AttributeSet("maxWidth")));
+  EXPECT_THAT(adaptation_set_xml.get(), Not(AttributeSet("maxHeight")));
+}
+
 // Verify that Representation::SetSampleDuration() works by checking that
 // AdaptationSet@frameRate is in the XML.
 TEST_F(AdaptationSetTest, SetSampleDuration) {
@@ -16,6 +16,9 @@ namespace shaka {
 
 BandwidthEstimator::BandwidthEstimator() = default;
 
+BandwidthEstimator::BandwidthEstimator(double window_duration)
+    : window_duration_(window_duration) {}
+
 BandwidthEstimator::~BandwidthEstimator() = default;
 
 void BandwidthEstimator::AddBlock(uint64_t size_in_bytes, double duration) {
@@ -29,6 +32,10 @@ void BandwidthEstimator::AddBlock(uint64_t size_in_bytes, double duration) {
   const uint64_t size_in_bits = size_in_bytes * kBitsInByte;
   total_size_in_bits_ += size_in_bits;
   total_duration_ += duration;
+  if (window_duration_ > 0) {
+    window_blocks_.push_back({size_in_bits, duration});
+    SlideWindow();
+  }
 
   const size_t kTargetDurationThreshold = 10;
   if (initial_blocks_.size() < kTargetDurationThreshold) {
@@ -40,12 +47,22 @@ void BandwidthEstimator::AddBlock(uint64_t size_in_bytes, double duration) {
     // Use the average duration as the target block duration. It will be used
     // to filter small blocks from bandwidth calculation.
     target_block_duration_ = GetAverageBlockDuration();
+    if (window_duration_ > 0) {
+      for (size_t i = 0; i < window_blocks_.size(); ++i)
+        AddBitrate(first_window_block_index_ + i, window_blocks_[i]);
+      return;
+    }
     for (const Block& block : initial_blocks_) {
       max_bitrate_ =
           std::max(max_bitrate_, GetBitrate(block, target_block_duration_));
     }
     return;
   }
+  if (window_duration_ > 0) {
+    AddBitrate(first_window_block_index_ + window_blocks_.size() - 1,
+               window_blocks_.back());
+    return;
+  }
   max_bitrate_ = std::max(max_bitrate_, GetBitrate({size_in_bits, duration},
                                                    target_block_duration_));
 }
@@ -57,6 +74,8 @@ uint64_t BandwidthEstimator::Estimate() const {
 }
 
 uint64_t BandwidthEstimator::Max() const {
+  if (window_duration_ > 0 && target_block_duration_ != 0)
+    return max_bitrates_.empty() ? 0 : max_bitrates_.front().bitrate;
   if (max_bitrate_ != 0)
     return max_bitrate_;
 
@@ -67,13 +86,46 @@ uint64_t BandwidthEstimator::Max() const {
 
   // Calculate maximum bitrate with the target duration calculated above.
   uint64_t max_bitrate = 0;
-  for (const Block& block : initial_blocks_) {
+  auto update_max_bitrate = [&](const Block& block) {
     max_bitrate =
         std::max(max_bitrate, GetBitrate(block, target_block_duration));
-  }
+  };
+  if (window_duration_ > 0)
+    std::for_each(window_blocks_.begin(), window_blocks_.end(),
+                  update_max_bitrate);
+  else
+    std::for_each(initial_blocks_.begin(), initial_blocks_.end(),
+                  update_max_bitrate);
   return max_bitrate;
 }
 
+void BandwidthEstimator::AddBitrate(uint64_t index, const Block& block) {
+  const uint64_t bitrate = GetBitrate(block, target_block_duration_);
+  // The blocks with lower bitrates cannot be the max while this block is in
+  // the window.
+  while (!max_bitrates_.empty() && max_bitrates_.back().bitrate <= bitrate)
+    max_bitrates_.pop_back();
+  max_bitrates_.push_back({index, bitrate});
+}
+
+void BandwidthEstimator::SlideWindow() {
+  DCHECK(!window_blocks_.empty());
+  // The latest block is not counted in the window.
+  while (window_blocks_.size() > 1 &&
+         total_duration_ - window_blocks_.front().duration -
+                 window_blocks_.back().duration >=
+             window_duration_) {
+    total_size_in_bits_ -= window_blocks_.front().size_in_bits;
+    total_duration_ -= window_blocks_.front().duration;
+    window_blocks_.pop_front();
+    ++first_window_block_index_;
+  }
+  while (!max_bitrates_.empty() &&
+         max_bitrates_.front().index < first_window_block_index_) {
+    max_bitrates_.pop_front();
+  }
+}
+
 double BandwidthEstimator::GetAverageBlockDuration() const {
   if (initial_blocks_.empty())
     return 0.0;
@@ -85,6 +137,12 @@ double BandwidthEstimator::GetAverageBlockDuration() const {
   return sum / initial_blocks_.size();
 }
 
+size_t BandwidthEstimator::EstimateMemoryUsage() const {
+  return initial_blocks_.capacity() * sizeof(Block) +
+         window_blocks_.size() * sizeof(Block) +
+         max_bitrates_.size() * sizeof(BlockBitrate);
+}
+
 uint64_t BandwidthEstimator::GetBitrate(const Block& block,
                                         double target_block_duration) const {
   if (block.duration < 0.5 * target_block_duration) {
@@ -7,15 +7,27 @@
 #ifndef MPD_BASE_BANDWIDTH_ESTIMATOR_H_
 #define MPD_BASE_BANDWIDTH_ESTIMATOR_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include <deque>
 #include <vector>
 
 namespace shaka {
 
+/// Estimates the average and peak bandwidths of a stream from the sizes and
+/// durations of its segments. Each block is processed in constant amortized
+/// time, and the memory used is bounded by the window, if any.
 class BandwidthEstimator {
  public:
+  /// Creates an estimator of the bandwidths of all the blocks.
   BandwidthEstimator();
+  /// Creates an estimator of the bandwidths of the blocks in a sliding window,
+  /// e.g. the segments in a live manifest.
+  /// @param window_duration is the duration of the window in seconds. The
+  ///        latest block is not counted in the window, as in the manifests.
+  ///        The window covers all the blocks if it is 0.
+  explicit BandwidthEstimator(double window_duration);
   ~BandwidthEstimator();
 
   /// @param size is the size of the block in bytes. Should be positive.
@@ -24,16 +36,19 @@ class BandwidthEstimator {
 
   /// @return The estimate bandwidth, in bits per second, calculated from the
   ///         sum of the sizes of every block, divided by the sum of durations
-  ///         of every block, of the number of blocks specified in the
-  ///         constructor. The value is rounded up to the nearest integer.
+  ///         of every block, of the blocks in the window. The value is rounded
+  ///         up to the nearest integer.
   uint64_t Estimate() const;
 
-  /// @return The max bandwidth, in bits per second, of the number of blocks
-  ///         specified in the constructor. The value is rounded up to the
-  ///         nearest integer. Note that small blocks w.r.t.
-  ///         |target_block_duration| are not counted.
+  /// @return The max bandwidth, in bits per second, of the blocks in the
+  ///         window. The value is rounded up to the nearest integer. Note that
+  ///         small blocks w.r.t. |target_block_duration| are not counted.
   uint64_t Max() const;
 
+  /// @return The approximate number of bytes allocated by the estimator, not
+  ///         including the object itself.
+  size_t EstimateMemoryUsage() const;
+
  private:
   BandwidthEstimator(const BandwidthEstimator&) = delete;
   BandwidthEstimator& operator=(const BandwidthEstimator&) = delete;
@@ -42,6 +57,17 @@ class BandwidthEstimator {
     uint64_t size_in_bits;
     double duration;
   };
+  // A candidate for the max bitrate of the window.
+  struct BlockBitrate {
+    // Index of the block, in the order the blocks are added.
+    uint64_t index;
+    uint64_t bitrate;
+  };
+  // Add the bitrate of the block at |index| to the candidates of the max
+  // bitrate of the window.
+  void AddBitrate(uint64_t index, const Block& block);
+  // Remove the blocks out of the window.
+  void SlideWindow();
   // Return the average block duration of the blocks in |initial_blocks_|.
   double GetAverageBlockDuration() const;
   // Return the bitrate of the block. Note that a bitrate of 0 is returned if
@@ -56,6 +82,16 @@ class BandwidthEstimator {
   uint64_t total_size_in_bits_ = 0;
   double total_duration_ = 0;
   uint64_t max_bitrate_ = 0;
+
+  // The following are used for windowed estimates only.
+  const double window_duration_ = 0;
+  // The blocks in the window, oldest first.
+  std::deque<Block> window_blocks_;
+  // Index of the first block in |window_blocks_|.
+  uint64_t first_window_block_index_ = 0;
+  // The bitrates of the blocks in the window which are larger than the
+  // bitrates of all the blocks after them, so the front one is the max.
+  std::deque<BlockBitrate> max_bitrates_;
 };
 
 }  // namespace shaka
@@ -63,4 +63,36 @@ TEST(BandwidthEstimatorTest, ExcludeShortBlocksMore) {
   EXPECT_EQ(kExpectedMax, be.Max());
 }
 
+TEST(BandwidthEstimatorTest, Window) {
+  const double kDuration = 1.0;
+  const double kWindowDuration = 5 * kDuration;
+  BandwidthEstimator be(kWindowDuration);
+
+  // The blocks shrink, then stay at 1 byte from the 16th block on.
+  for (uint64_t i = 1; i <= 20; ++i)
+    be.AddBlock(i <= 15 ? 100 - i : 1, kDuration);
+
+  // The window has the 5 blocks before the latest one, i.e. blocks 15 to 20.
+  EXPECT_EQ(85 * kBitsInByte, be.Max());
+  EXPECT_EQ((85 + 5) * kBitsInByte / 6, be.Estimate());
+
+  // Block 15 slides out of the window.
+  be.AddBlock(1, kDuration);
+  EXPECT_EQ(kBitsInByte, be.Max());
+  EXPECT_EQ(kBitsInByte, be.Estimate());
+}
+
+TEST(BandwidthEstimatorTest, WindowMemoryUsageIsBounded) {
+  const double kDuration = 1.0;
+  const double kWindowDuration = 5 * kDuration;
+  BandwidthEstimator be(kWindowDuration);
+
+  for (int i = 0; i < 20; ++i)
+    be.AddBlock(100, kDuration);
+  const size_t memory_usage = be.EstimateMemoryUsage();
+  for (int i = 0; i < 1000; ++i)
+    be.AddBlock(100, kDuration);
+  EXPECT_EQ(memory_usage, be.EstimateMemoryUsage());
+}
+
 } // namespace shaka
@@ -0,0 +1,89 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/manifest_file_writer.h"
+
+#include <zlib.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/sha1.h"
+#include "packager/file/file.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace {
+
+const char kGzipExtension[] = ".gz";
+// The manifests are compressed once per update, but fetched many times, so
+// the best compression is worth its cost.
+const int kGzipCompressionLevel = Z_BEST_COMPRESSION;
+// 15 bits of window, plus 16 for a gzip header and trailer.
+const int kGzipWindowBits = 15 + 16;
+const int kGzipMemoryLevel = 8;
+
+bool GzipCompress(const std::string& input, std::string* output) {
+  z_stream stream = {};
+  if (deflateInit2(&stream, kGzipCompressionLevel, Z_DEFLATED, kGzipWindowBits,
+                   kGzipMemoryLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  output->resize(deflateBound(&stream, input.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&(*output)[0]);
+  stream.avail_out = static_cast<uInt>(output->size());
+  const int result = deflate(&stream, Z_FINISH);
+  output->resize(stream.total_out);
+  deflateEnd(&stream);
+  return result == Z_STREAM_END;
+}
+
+}  // namespace
+
+ManifestFileWriter::ManifestFileWriter(const std::string& format)
+    : format_(format) {}
+
+ManifestFileWriter::~ManifestFileWriter() {}
+
+bool ManifestFileWriter::Write(const std::string& file_path,
+                               const std::string& content) {
+  std::string content_hash = base::SHA1HashString(content);
+  auto it = content_hashes_.find(file_path);
+  if (it != content_hashes_.end() && it->second == content_hash) {
+    ++skipped_writes_;
+    Metrics::GetInstance()->IncrementCounter(
+        "packager_manifest_writes_skipped_total",
+        "Manifest writes skipped because the content did not change.",
+        {{"format", format_}}, 1);
+    return true;
+  }
+
+  if (write_gzip_copies_) {
+    std::string compressed;
+    if (!GzipCompress(content, &compressed)) {
+      LOG(ERROR) << "Failed to compress " << file_path;
+      return false;
+    }
+    const std::string compressed_file_path = file_path + kGzipExtension;
+    if (!File::WriteFileAtomically(compressed_file_path.c_str(),
+                                   compressed)) {
+      if (it != content_hashes_.end())
+        content_hashes_.erase(it);
+      return false;
+    }
+  }
+
+  if (!File::WriteFileAtomically(file_path.c_str(), content)) {
+    // The file may have either content now.
+    if (it != content_hashes_.end())
+      content_hashes_.erase(it);
+    return false;
+  }
+  content_hashes_[file_path] = std::move(content_hash);
+  return true;
+}
+
+}  // namespace shaka
@@ -0,0 +1,57 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_MANIFEST_FILE_WRITER_H_
+#define MPD_BASE_MANIFEST_FILE_WRITER_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+namespace shaka {
+
+/// Writes manifests atomically, skipping the writes of the content already
+/// written to the same path, which would cost a rename and possibly a CDN
+/// invalidation for nothing. Only a hash of the content is kept per path.
+/// A gzip copy of each manifest can also be written, so that the origin
+/// serves the compressed manifests without compressing them per request.
+/// This class is not thread safe.
+class ManifestFileWriter {
+ public:
+  /// @param format is the manifest format, e.g. "dash" or "hls", which labels
+  ///        the count of skipped writes.
+  explicit ManifestFileWriter(const std::string& format);
+  ~ManifestFileWriter();
+
+  /// Writes @a content to @a file_path, unless it is the content last written
+  /// there by this writer. The gzip copy, if enabled, is written first to
+  /// @a file_path + ".gz", so that it is up to date when the manifest is.
+  /// @return true on success or if the write is skipped, false otherwise.
+  bool Write(const std::string& file_path, const std::string& content);
+
+  /// Enables the gzip copies of the manifests written after this call.
+  void set_write_gzip_copies(bool write_gzip_copies) {
+    write_gzip_copies_ = write_gzip_copies;
+  }
+
+  /// @return the number of writes skipped so far.
+  uint64_t skipped_writes() const { return skipped_writes_; }
+
+ private:
+  ManifestFileWriter(const ManifestFileWriter&) = delete;
+  ManifestFileWriter& operator=(const ManifestFileWriter&) = delete;
+
+  const std::string format_;
+  // Maps the file paths to the SHA-1 digests of their contents.
+  std::map<std::string, std::string> content_hashes_;
+  uint64_t skipped_writes_ = 0;
+  bool write_gzip_copies_ = false;
+};
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_MANIFEST_FILE_WRITER_H_
@@ -0,0 +1,86 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/manifest_file_writer.h"
+
+#include <gtest/gtest.h>
+#include <zlib.h>
+
+#include "packager/file/file.h"
+
+namespace shaka {
+
+namespace {
+const char kFilePath[] = "memory://manifest.mpd";
+const char kOtherFilePath[] = "memory://other.mpd";
+const char kGzipFilePath[] = "memory://manifest.mpd.gz";
+
+std::string GzipDecompress(const std::string& input) {
+  z_stream stream = {};
+  // 15 bits of window, plus 16 for a gzip header and trailer.
+  if (inflateInit2(&stream, 15 + 16) != Z_OK)
+    return std::string();
+  std::string output(1024, '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+  stream.avail_out = static_cast<uInt>(output.size());
+  const int result = inflate(&stream, Z_FINISH);
+  output.resize(stream.total_out);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END ? output : std::string();
+}
+
+}  // namespace
+
+TEST(ManifestFileWriterTest, SkipUnchangedContent) {
+  ManifestFileWriter file_writer("dash");
+  ASSERT_TRUE(file_writer.Write(kFilePath, "content 1"));
+  ASSERT_TRUE(File::Delete(kFilePath));
+
+  // Deleting the file shows that the unchanged content is not rewritten.
+  EXPECT_TRUE(file_writer.Write(kFilePath, "content 1"));
+  std::string content;
+  EXPECT_FALSE(File::ReadFileToString(kFilePath, &content));
+  EXPECT_EQ(1u, file_writer.skipped_writes());
+
+  // The content is tracked per path.
+  EXPECT_TRUE(file_writer.Write(kOtherFilePath, "content 1"));
+  ASSERT_TRUE(File::ReadFileToString(kOtherFilePath, &content));
+  EXPECT_EQ("content 1", content);
+
+  EXPECT_TRUE(file_writer.Write(kFilePath, "content 2"));
+  ASSERT_TRUE(File::ReadFileToString(kFilePath, &content));
+  EXPECT_EQ("content 2", content);
+  EXPECT_EQ(1u, file_writer.skipped_writes());
+
+  ASSERT_TRUE(File::Delete(kFilePath));
+  ASSERT_TRUE(File::Delete(kOtherFilePath));
+}
+
+TEST(ManifestFileWriterTest, GzipCopies) {
+  ManifestFileWriter file_writer("dash");
+  file_writer.set_write_gzip_copies(true);
+  ASSERT_TRUE(file_writer.Write(kFilePath, "content 1"));
+
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(kGzipFilePath, &content));
+  EXPECT_EQ("content 1", GzipDecompress(content));
+
+  // The gzip copy is not rewritten with the unchanged content either.
+  ASSERT_TRUE(File::Delete(kGzipFilePath));
+  EXPECT_TRUE(file_writer.Write(kFilePath, "content 1"));
+  EXPECT_FALSE(File::ReadFileToString(kGzipFilePath, &content));
+
+  EXPECT_TRUE(file_writer.Write(kFilePath, "content 2"));
+  ASSERT_TRUE(File::ReadFileToString(kGzipFilePath, &content));
+  EXPECT_EQ("content 2", GzipDecompress(content));
+
+  ASSERT_TRUE(File::Delete(kFilePath));
+  ASSERT_TRUE(File::Delete(kGzipFilePath));
+}
+
+}  // namespace shaka
@@ -0,0 +1,96 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/media_info_file.h"
+
+#include <google/protobuf/text_format.h>
+
+#include "packager/base/logging.h"
+#include "packager/file/file.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+namespace {
+
+// The binary files start with a NUL byte, which never starts a text format
+// file, followed by "SMI" and the version of the layout.
+const char kBinaryMagic[] = {'\0', 'S', 'M', 'I'};
+const char kBinaryVersion = 1;
+const size_t kBinaryHeaderSize = sizeof(kBinaryMagic) + 1;
+
+bool IsBinaryMediaInfo(const std::string& file_content) {
+  return file_content.size() >= sizeof(kBinaryMagic) &&
+         file_content.compare(0, sizeof(kBinaryMagic), kBinaryMagic,
+                              sizeof(kBinaryMagic)) == 0;
+}
+
+}  // namespace
+
+bool WriteMediaInfoFile(const MediaInfo& media_info,
+                        const std::string& file_path,
+                        MediaInfoFileFormat format) {
+  std::string output_string;
+  if (format == MediaInfoFileFormat::kBinary) {
+    output_string.assign(kBinaryMagic, sizeof(kBinaryMagic));
+    output_string += kBinaryVersion;
+    if (!media_info.AppendToString(&output_string)) {
+      LOG(ERROR) << "Failed to serialize MediaInfo to string.";
+      return false;
+    }
+  } else if (!google::protobuf::TextFormat::PrintToString(media_info,
+                                                          &output_string)) {
+    LOG(ERROR) << "Failed to serialize MediaInfo to string.";
+    return false;
+  }
+
+  File* file = File::Open(file_path.c_str(), "w");
+  if (!file) {
+    LOG(ERROR) << "Failed to open " << file_path;
+    return false;
+  }
+  if (file->Write(output_string.data(), output_string.size()) <= 0) {
+    LOG(ERROR) << "Failed to write MediaInfo to file.";
+    file->Close();
+    return false;
+  }
+  if (!file->Close()) {
+    LOG(ERROR) << "Failed to close " << file_path;
+    return false;
+  }
+  return true;
+}
+
+bool ReadMediaInfoFile(const std::string& file_path, MediaInfo* media_info) {
+  std::string file_content;
+  if (!File::ReadFileToString(file_path.c_str(), &file_content)) {
+    LOG(ERROR) << "Failed to read " << file_path << " to string.";
+    return false;
+  }
+
+  if (IsBinaryMediaInfo(file_content)) {
+    if (file_content.size() < kBinaryHeaderSize ||
+        file_content[sizeof(kBinaryMagic)] != kBinaryVersion) {
+      LOG(ERROR) << "Unsupported MediaInfo file version in " << file_path;
+      return false;
+    }
+    if (!media_info->ParseFromArray(
+            file_content.data() + kBinaryHeaderSize,
+            static_cast<int>(file_content.size() - kBinaryHeaderSize))) {
+      LOG(ERROR) << "Failed to parse " << file_path << " to MediaInfo.";
+      return false;
+    }
+    return true;
+  }
+
+  if (!::google::protobuf::TextFormat::ParseFromString(file_content,
+                                                       media_info)) {
+    LOG(ERROR) << "Failed to parse " << file_content << " to MediaInfo.";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace shaka
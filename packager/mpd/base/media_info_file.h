@@ -0,0 +1,39 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_MEDIA_INFO_FILE_H_
+#define MPD_BASE_MEDIA_INFO_FILE_H_
+
+#include <string>
+
+namespace shaka {
+
+class MediaInfo;
+
+/// The formats of the MediaInfo files, i.e. the `.media_info` files written
+/// with --output_media_info and read by mpd_generator and hls_generator.
+enum class MediaInfoFileFormat {
+  /// Human readable text format protobuf.
+  kText,
+  /// A versioned header followed by the binary protobuf, which is parsed
+  /// much faster than the text format, e.g. for long segment lists.
+  kBinary,
+};
+
+/// Writes @a media_info to @a file_path in @a format.
+/// @return true on success, false otherwise.
+bool WriteMediaInfoFile(const MediaInfo& media_info,
+                        const std::string& file_path,
+                        MediaInfoFileFormat format);
+
+/// Reads the MediaInfo in @a file_path, in either format. This function is
+/// thread safe, so many files can be read in parallel.
+/// @return true on success, false otherwise.
+bool ReadMediaInfoFile(const std::string& file_path, MediaInfo* media_info);
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_MEDIA_INFO_FILE_H_
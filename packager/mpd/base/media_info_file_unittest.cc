@@ -0,0 +1,68 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/media_info_file.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+
+namespace {
+const char kFilePath[] = "memory://stream.mp4.media_info";
+
+MediaInfo GetMediaInfo() {
+  MediaInfo media_info;
+  media_info.set_bandwidth(400000);
+  media_info.set_reference_time_scale(90000);
+  media_info.mutable_video_info()->set_codec("avc1.010101");
+  for (int i = 0; i < 3; ++i) {
+    MediaInfo::Segment* segment = media_info.add_segments();
+    segment->set_name("segment-" + std::to_string(i) + ".m4s");
+    segment->set_start_time(i * 180000);
+    segment->set_duration(180000);
+    segment->set_size(1000 + i);
+  }
+  return media_info;
+}
+}  // namespace
+
+class MediaInfoFileTest
+    : public ::testing::TestWithParam<MediaInfoFileFormat> {};
+
+TEST_P(MediaInfoFileTest, RoundTrip) {
+  const MediaInfo media_info = GetMediaInfo();
+  ASSERT_TRUE(WriteMediaInfoFile(media_info, kFilePath, GetParam()));
+
+  MediaInfo read_media_info;
+  ASSERT_TRUE(ReadMediaInfoFile(kFilePath, &read_media_info));
+  EXPECT_EQ(media_info.SerializeAsString(),
+            read_media_info.SerializeAsString());
+  File::Delete(kFilePath);
+}
+
+INSTANTIATE_TEST_CASE_P(Formats,
+                        MediaInfoFileTest,
+                        ::testing::Values(MediaInfoFileFormat::kText,
+                                          MediaInfoFileFormat::kBinary));
+
+TEST(MediaInfoFileVersionTest, RejectsUnknownVersion) {
+  ASSERT_TRUE(WriteMediaInfoFile(GetMediaInfo(), kFilePath,
+                                 MediaInfoFileFormat::kBinary));
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(kFilePath, &content));
+  // The version follows the 4 bytes magic.
+  content[4] = 2;
+  ASSERT_TRUE(File::WriteStringToFile(kFilePath, content));
+
+  MediaInfo media_info;
+  EXPECT_FALSE(ReadMediaInfoFile(kFilePath, &media_info));
+  File::Delete(kFilePath);
+}
+
+}  // namespace shaka
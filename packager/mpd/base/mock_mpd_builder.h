@@ -49,6 +49,7 @@ class MockAdaptationSet : public AdaptationSet {
   MOCK_METHOD1(AddRepresentation, Representation*(const MediaInfo& media_info));
   MOCK_METHOD1(CopyRepresentation,
                Representation*(const Representation& representation));
+  MOCK_METHOD1(RemoveRepresentation, void(uint32_t representation_id));
   MOCK_METHOD1(AddContentProtectionElement,
                void(const ContentProtectionElement& element));
   MOCK_METHOD2(UpdateContentProtectionPssh,
@@ -6,7 +6,15 @@
 
 #include "packager/mpd/base/mpd_builder.h"
 
+#include <stdio.h>
+#include <string.h>
+#if defined(__linux__)
+#include <malloc.h>
+#endif  // defined(__linux__)
+
 #include <algorithm>
+#include <iterator>
+#include <set>
 
 #include "packager/base/files/file_path.h"
 #include "packager/base/logging.h"
@@ -16,7 +24,9 @@
 #include "packager/base/synchronization/lock.h"
 #include "packager/base/time/default_clock.h"
 #include "packager/base/time/time.h"
+#include "packager/metrics/allocator_stats.h"
 #include "packager/mpd/base/adaptation_set.h"
+#include "packager/mpd/base/mpd_patch_builder.h"
 #include "packager/mpd/base/mpd_utils.h"
 #include "packager/mpd/base/period.h"
 #include "packager/mpd/base/representation.h"
@@ -72,20 +82,43 @@ bool Positive(double d) {
   return d > 0.0;
 }
 
-// Return current time in XML DateTime format. The value is in UTC, so the
-// string ends with a 'Z'.
-std::string XmlDateTimeNowWithOffset(
-    int32_t offset_seconds,
-    base::Clock* clock) {
-  base::Time time = clock->Now();
-  time += base::TimeDelta::FromSeconds(offset_seconds);
+// Return |time| in XML DateTime format. The value is in UTC, so the string
+// ends with a 'Z'.
+std::string XmlDateTime(base::Time time, bool with_milliseconds) {
   base::Time::Exploded time_exploded;
   time.UTCExplode(&time_exploded);
 
-  return base::StringPrintf("%4d-%02d-%02dT%02d:%02d:%02dZ", time_exploded.year,
-                            time_exploded.month, time_exploded.day_of_month,
-                            time_exploded.hour, time_exploded.minute,
-                            time_exploded.second);
+  std::string date_time = base::StringPrintf(
+      "%4d-%02d-%02dT%02d:%02d:%02d", time_exploded.year, time_exploded.month,
+      time_exploded.day_of_month, time_exploded.hour, time_exploded.minute,
+      time_exploded.second);
+  if (with_milliseconds)
+    base::StringAppendF(&date_time, ".%03d", time_exploded.millisecond);
+  return date_time + "Z";
+}
+
+// Parse |date_time| in the XML DateTime format of XmlDateTime(), without
+// milliseconds.
+bool ParseXmlDateTime(const std::string& date_time, base::Time* time) {
+  base::Time::Exploded time_exploded = {};
+  char zone = 0;
+  if (sscanf(date_time.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d%c",
+             &time_exploded.year, &time_exploded.month,
+             &time_exploded.day_of_month, &time_exploded.hour,
+             &time_exploded.minute, &time_exploded.second, &zone) != 7 ||
+      zone != 'Z' || !time_exploded.HasValidValues()) {
+    return false;
+  }
+  *time = base::Time::FromUTCExploded(time_exploded);
+  return true;
+}
+
+// Return current time in XML DateTime format.
+std::string XmlDateTimeNowWithOffset(
+    int32_t offset_seconds,
+    base::Clock* clock) {
+  return XmlDateTime(
+      clock->Now() + base::TimeDelta::FromSeconds(offset_seconds), false);
 }
 
 void SetIfPositive(const char* attr_name, double value, XmlNode* mpd) {
@@ -105,12 +138,64 @@ std::string MakePathRelative(const std::string& media_path,
   return relative_path.NormalizePathSeparatorsTo('/').AsUTF8Unsafe();
 }
 
+std::string RemoveFileProtocol(const std::string& path) {
+  const std::string kFileProtocol("file://");
+  return path.find(kFileProtocol) == 0 ? path.substr(kFileProtocol.size())
+                                       : path;
+}
+
+#if defined(__linux__)
+// Allocation functions of libxml which account the XML documents to the
+// manifests arena. The sizes are taken from the allocator, so memory allocated
+// by libxml before they are installed can still be freed through them.
+void AccountXmlAllocation(void* memory) {
+  if (memory) {
+    AllocatorStats::GetInstance()->Allocate(AllocatorStats::kManifests,
+                                            malloc_usable_size(memory));
+  }
+}
+
+void ReleaseXmlAllocation(void* memory) {
+  if (memory) {
+    AllocatorStats::GetInstance()->Release(AllocatorStats::kManifests,
+                                           malloc_usable_size(memory));
+  }
+}
+
+void* XmlMalloc(size_t size) {
+  void* memory = malloc(size);
+  AccountXmlAllocation(memory);
+  return memory;
+}
+
+void* XmlRealloc(void* memory, size_t size) {
+  ReleaseXmlAllocation(memory);
+  void* new_memory = realloc(memory, size);
+  AccountXmlAllocation(new_memory ? new_memory : memory);
+  return new_memory;
+}
+
+void XmlFree(void* memory) {
+  ReleaseXmlAllocation(memory);
+  free(memory);
+}
+
+char* XmlStrdup(const char* str) {
+  char* copy = strdup(str);
+  AccountXmlAllocation(copy);
+  return copy;
+}
+#endif  // defined(__linux__)
+
 // Spooky static initialization/cleanup of libxml.
 class LibXmlInitializer {
  public:
   LibXmlInitializer() : initialized_(false) {
     base::AutoLock lock(lock_);
     if (!initialized_) {
+#if defined(__linux__)
+      xmlMemSetup(XmlFree, XmlMalloc, XmlRealloc, XmlStrdup);
+#endif  // defined(__linux__)
       xmlInitParser();
       initialized_ = true;
     }
@@ -134,7 +219,10 @@ class LibXmlInitializer {
 }  // namespace
 
 MpdBuilder::MpdBuilder(const MpdOptions& mpd_options)
-    : mpd_options_(mpd_options), clock_(new base::DefaultClock()) {}
+    : mpd_options_(mpd_options),
+      availability_start_time_(
+          mpd_options.mpd_params.availability_start_time),
+      clock_(new base::DefaultClock()) {}
 
 MpdBuilder::~MpdBuilder() {}
 
@@ -164,6 +252,12 @@ bool MpdBuilder::ToString(std::string* output) {
   if (!doc)
     return false;
 
+  if (IsPatchEnabled()) {
+    if (!patch_builder_)
+      patch_builder_.reset(new MpdPatchBuilder);
+    patch_builder_->Update(xmlDocGetRootElement(doc.get()), periods_, &patch_);
+  }
+
   static const int kNiceFormat = 1;
   int doc_str_size = 0;
   xmlChar* doc_str = nullptr;
@@ -192,6 +286,9 @@ xmlDocPtr MpdBuilder::GenerateMpd() {
       return nullptr;
   }
 
+  // Must be after BaseURL and before Period elements.
+  AddPatchLocation(&mpd);
+
   bool output_period_duration = false;
   if (mpd_options_.mpd_type == MpdType::kStatic) {
     UpdatePeriodDurationAndPresentationTimestamp();
@@ -199,6 +296,8 @@ xmlDocPtr MpdBuilder::GenerateMpd() {
     // case of only one period, Period@duration is redundant as it is identical
     // to Mpd Duration so the convention is not to output Period@duration.
     output_period_duration = periods_.size() > 1;
+  } else {
+    RemoveExpiredPeriods();
   }
 
   for (const auto& period : periods_) {
@@ -287,9 +386,22 @@ void MpdBuilder::AddDynamicMpdInfo(XmlNode* mpd_node) {
   static const char kDynamicMpdType[] = "dynamic";
   mpd_node->SetStringAttribute("type", kDynamicMpdType);
 
-  // No offset from NOW.
-  mpd_node->SetStringAttribute("publishTime",
-                               XmlDateTimeNowWithOffset(0, clock_.get()));
+  if (IsPatchEnabled()) {
+    // The patches are applied to the MPD with their originalPublishTime, so
+    // each MPD must have a distinct publishTime.
+    base::Time publish_time = GetPublishTime();
+    if (!last_publish_time_.is_null() && publish_time <= last_publish_time_)
+      publish_time = last_publish_time_ + base::TimeDelta::FromMilliseconds(1);
+    last_publish_time_ = publish_time;
+    mpd_node->SetStringAttribute("publishTime",
+                                 XmlDateTime(publish_time, true));
+    // MPD@id is required to apply patches. There is one MPD per instance.
+    static const char kMpdId[] = "mpd";
+    mpd_node->SetStringAttribute("id", kMpdId);
+  } else {
+    mpd_node->SetStringAttribute("publishTime",
+                                 XmlDateTime(GetPublishTime(), false));
+  }
 
   // 'availabilityStartTime' is required for dynamic profile. Calculate if
   // not already calculated.
@@ -336,6 +448,38 @@ void MpdBuilder::AddUtcTiming(XmlNode* mpd_node) {
   }
 }
 
+void MpdBuilder::AddPatchLocation(XmlNode* mpd_node) {
+  DCHECK(mpd_node);
+  if (!IsPatchEnabled())
+    return;
+
+  const std::string mpd_file_path =
+      RemoveFileProtocol(mpd_options_.mpd_params.mpd_output);
+  std::string patch_location =
+      RemoveFileProtocol(mpd_options_.mpd_params.mpd_patch_output);
+  if (!mpd_file_path.empty()) {
+    const FilePath mpd_dir(FilePath::FromUTF8Unsafe(mpd_file_path)
+                               .DirName()
+                               .AsEndingWithSeparator());
+    if (!mpd_dir.empty())
+      patch_location = MakePathRelative(patch_location, mpd_dir);
+  }
+
+  XmlNode patch_location_node("PatchLocation");
+  // The patch is replaced with the next MPD update.
+  if (Positive(mpd_options_.mpd_params.minimum_update_period)) {
+    patch_location_node.SetFloatingPointAttribute(
+        "ttl", mpd_options_.mpd_params.minimum_update_period);
+  }
+  patch_location_node.SetContent(patch_location);
+  mpd_node->AddChild(patch_location_node.PassScopedPtr());
+}
+
+bool MpdBuilder::IsPatchEnabled() const {
+  return mpd_options_.mpd_type == MpdType::kDynamic &&
+         !mpd_options_.mpd_params.mpd_patch_output.empty();
+}
+
 float MpdBuilder::GetStaticMpdDuration() {
   DCHECK_EQ(MpdType::kStatic, mpd_options_.mpd_type);
 
@@ -369,6 +513,41 @@ bool MpdBuilder::GetEarliestTimestamp(double* timestamp_seconds) {
   return true;
 }
 
+bool MpdBuilder::GetLatestTimestamp(double* timestamp_seconds) {
+  DCHECK(timestamp_seconds);
+  if (periods_.empty())
+    return false;
+  double timestamp = 0;
+  double latest_timestamp = -1;
+  for (const auto* adaptation_set : periods_.back()->GetAdaptationSets()) {
+    for (const auto* representation : adaptation_set->GetRepresentations()) {
+      if (representation->GetStartAndEndTimestamps(nullptr, &timestamp) &&
+          timestamp > latest_timestamp) {
+        latest_timestamp = timestamp;
+      }
+    }
+  }
+  if (latest_timestamp < 0)
+    return false;
+  *timestamp_seconds = latest_timestamp;
+  return true;
+}
+
+base::Time MpdBuilder::GetPublishTime() {
+  if (!mpd_options_.mpd_params.publish_time_from_timeline)
+    return clock_->Now();
+  base::Time availability_start_time;
+  double latest_timestamp = 0;
+  if (!ParseXmlDateTime(availability_start_time_, &availability_start_time) ||
+      !GetLatestTimestamp(&latest_timestamp)) {
+    LOG(WARNING) << "Could not derive the publishTime from the timeline.";
+    return clock_->Now();
+  }
+  return availability_start_time +
+         base::TimeDelta::FromMilliseconds(
+             static_cast<int64_t>(latest_timestamp * 1000));
+}
+
 void MpdBuilder::UpdatePeriodDurationAndPresentationTimestamp() {
   DCHECK_EQ(MpdType::kStatic, mpd_options_.mpd_type);
 
@@ -419,13 +598,75 @@ void MpdBuilder::UpdatePeriodDurationAndPresentationTimestamp() {
   }
 }
 
+size_t MpdBuilder::EstimateMemoryUsage() const {
+  size_t size = patch_.capacity();
+  for (const auto& period : periods_) {
+    for (const auto* adaptation_set : period->GetAdaptationSets()) {
+      for (const auto* representation : adaptation_set->GetRepresentations()) {
+        size +=
+            sizeof(*representation) + representation->EstimateMemoryUsage();
+      }
+    }
+  }
+  return size;
+}
+
+void MpdBuilder::RemoveExpiredPeriods() {
+  DCHECK_EQ(MpdType::kDynamic, mpd_options_.mpd_type);
+  const double time_shift_buffer_depth =
+      mpd_options_.mpd_params.time_shift_buffer_depth;
+  if (time_shift_buffer_depth <= 0 || periods_.size() < 2)
+    return;
+
+  base::Optional<double> latest_end_time;
+  for (const auto& period : periods_) {
+    for (const auto* adaptation_set : period->GetAdaptationSets()) {
+      for (const auto* representation : adaptation_set->GetRepresentations()) {
+        double end_time = 0;
+        if (representation->GetStartAndEndTimestamps(nullptr, &end_time)) {
+          latest_end_time =
+              std::max(latest_end_time.value_or(end_time), end_time);
+        }
+      }
+    }
+  }
+  if (!latest_end_time)
+    return;
+  const double time_shift_buffer_start =
+      *latest_end_time - time_shift_buffer_depth;
+
+  // A Period ends where the next Period starts. The Representations of a
+  // Period are copied to the next Period on a cue, keeping their IDs, and only
+  // the copies are updated from then on, so a Period whose Representations all
+  // have copies is no longer referred to.
+  while (periods_.size() > 1) {
+    const Period* next_period = std::next(periods_.begin())->get();
+    if (next_period->start_time_in_seconds() > time_shift_buffer_start)
+      return;
+
+    std::set<uint32_t> later_representation_ids;
+    for (auto it = std::next(periods_.begin()); it != periods_.end(); ++it) {
+      for (const auto* adaptation_set : (*it)->GetAdaptationSets()) {
+        for (const auto* representation :
+             adaptation_set->GetRepresentations()) {
+          later_representation_ids.insert(representation->id());
+        }
+      }
+    }
+    for (const auto* adaptation_set : periods_.front()->GetAdaptationSets()) {
+      for (const auto* representation : adaptation_set->GetRepresentations()) {
+        if (later_representation_ids.count(representation->id()) == 0)
+          return;
+      }
+    }
+    periods_.pop_front();
+  }
+}
+
 void MpdBuilder::MakePathsRelativeToMpd(const std::string& mpd_path,
                                         MediaInfo* media_info) {
   DCHECK(media_info);
-  const std::string kFileProtocol("file://");
-  std::string mpd_file_path = (mpd_path.find(kFileProtocol) == 0)
-                                  ? mpd_path.substr(kFileProtocol.size())
-                                  : mpd_path;
+  const std::string mpd_file_path = RemoveFileProtocol(mpd_path);
 
   if (!mpd_file_path.empty()) {
     const FilePath mpd_dir(FilePath::FromUTF8Unsafe(mpd_file_path)
@@ -18,6 +18,7 @@
 #include <string>
 
 #include "packager/base/time/clock.h"
+#include "packager/base/time/time.h"
 #include "packager/mpd/base/mpd_options.h"
 
 // TODO(rkuroiwa): For classes with |id_|, consider removing the field and let
@@ -27,6 +28,7 @@ namespace shaka {
 
 class AdaptationSet;
 class MediaInfo;
+class MpdPatchBuilder;
 class Period;
 
 namespace xml {
@@ -59,6 +61,29 @@ class MpdBuilder {
   // TODO(kqyang): Handle file IO in this class as in HLS media_playlist?
   virtual bool ToString(std::string* output);
 
+  /// @return The MPD Patch from the MPD written by the previous call to
+  ///         ToString() to the MPD written by the last call. Empty if MPD
+  ///         Patch is not enabled or ToString() was called once.
+  const std::string& patch() const { return patch_; }
+
+  /// @return The approximate number of bytes allocated for the state of the
+  ///         MPD which grows with the streams, i.e. the Representations of
+  ///         its Periods.
+  size_t EstimateMemoryUsage() const;
+
+  /// @return The availabilityStartTime of a dynamic MPD, which is empty until
+  ///         the MPD is first written.
+  const std::string& availability_start_time() const {
+    return availability_start_time_;
+  }
+
+  /// Set the availabilityStartTime of a dynamic MPD, instead of deriving it
+  /// from the current time when the MPD is first written, e.g. to resume a
+  /// live session.
+  void set_availability_start_time(const std::string& availability_start_time) {
+    availability_start_time_ = availability_start_time;
+  }
+
   /// Adjusts the fields of MediaInfo so that paths are relative to the
   /// specified MPD path.
   /// @param mpd_path is the file path of the MPD file.
@@ -102,6 +127,12 @@ class MpdBuilder {
   // Add UTCTiming element if utc timing is provided.
   void AddUtcTiming(xml::XmlNode* mpd_node);
 
+  // Add PatchLocation element if MPD Patch is enabled.
+  void AddPatchLocation(xml::XmlNode* mpd_node);
+
+  // Returns true if MPD Patches are generated along with the MPD.
+  bool IsPatchEnabled() const;
+
   float GetStaticMpdDuration();
 
   // Set MPD attributes for dynamic profile MPD. Uses non-zero |mpd_options_| as
@@ -112,9 +143,21 @@ class MpdBuilder {
   // successful, false otherwise.
   bool GetEarliestTimestamp(double* timestamp_seconds);
 
+  // Gets the end of the latest segment of the last Period. Returns true if
+  // successful, false otherwise.
+  bool GetLatestTimestamp(double* timestamp_seconds);
+
+  // Returns the publishTime of a 'dynamic' MPD, see
+  // MpdParams::publish_time_from_timeline.
+  base::Time GetPublishTime();
+
   // Update Period durations and presentation timestamps.
   void UpdatePeriodDurationAndPresentationTimestamp();
 
+  // Removes the Periods of a 'dynamic' MPD which ended before the time shift
+  // buffer, once all their Representations continue in later Periods.
+  void RemoveExpiredPeriods();
+
   MpdOptions mpd_options_;
   std::list<std::unique_ptr<Period>> periods_;
 
@@ -127,6 +170,11 @@ class MpdBuilder {
   // By default, this returns the current time. This can be injected for
   // testing.
   std::unique_ptr<base::Clock> clock_;
+
+  // The following are used for MPD Patch only.
+  std::unique_ptr<MpdPatchBuilder> patch_builder_;
+  std::string patch_;
+  base::Time last_publish_time_;
 };
 
 }  // namespace shaka
@@ -0,0 +1,83 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/media/test/perf_test_util.h"
+#include "packager/mpd/base/adaptation_set.h"
+#include "packager/mpd/base/mpd_builder.h"
+#include "packager/mpd/base/period.h"
+#include "packager/mpd/base/representation.h"
+#include "packager/mpd/test/mpd_builder_test_helper.h"
+
+namespace shaka {
+
+namespace {
+
+const double kPeriodStartTimeSeconds = 0.0;
+const bool kContentProtectionInAdaptationSet = true;
+
+Representation* AddRepresentation(MpdBuilder* mpd,
+                                  const MediaInfo& media_info) {
+  AdaptationSet* adaptation_set =
+      mpd->GetOrCreatePeriod(kPeriodStartTimeSeconds)
+          ->GetOrCreateAdaptationSet(media_info,
+                                     kContentProtectionInAdaptationSet);
+  return adaptation_set->AddRepresentation(media_info);
+}
+
+void MeasureToStringRate(const std::string& trace, MpdBuilder* mpd) {
+  std::string mpd_string;
+  media::MeasureOperationRate("mpd_generation", trace,
+                              [&]() { CHECK(mpd->ToString(&mpd_string)); });
+}
+
+}  // namespace
+
+TEST(MpdBuilderPerfTest, OnDemand) {
+  MpdBuilder mpd{MpdOptions()};
+  ASSERT_TRUE(
+      AddRepresentation(&mpd, GetTestMediaInfo(kFileNameVideoMediaInfo1)));
+  ASSERT_TRUE(
+      AddRepresentation(&mpd, GetTestMediaInfo(kFileNameVideoMediaInfo2)));
+  ASSERT_TRUE(
+      AddRepresentation(&mpd, GetTestMediaInfo(kFileNameAudioMediaInfo1)));
+  MeasureToStringRate("on_demand", &mpd);
+}
+
+TEST(MpdBuilderPerfTest, LiveWithManySegments) {
+  const size_t kSegmentCount = 5000;
+  const int64_t kSegmentDuration = 10 * 6;
+  const uint64_t kSegmentSize = 100000;
+
+  MpdOptions mpd_options;
+  mpd_options.dash_profile = DashProfile::kLive;
+  mpd_options.mpd_type = MpdType::kDynamic;
+  MpdBuilder mpd(mpd_options);
+
+  MediaInfo media_info = GetTestMediaInfo(kFileNameVideoMediaInfo1);
+  media_info.clear_init_range();
+  media_info.clear_index_range();
+  media_info.set_init_segment_url("init.mp4");
+  media_info.set_segment_template("segment-$Time$.m4s");
+  media_info.set_segment_template_url("segment-$Time$.m4s");
+  Representation* representation = AddRepresentation(&mpd, media_info);
+  ASSERT_TRUE(representation);
+  // Vary the segment durations slightly so SegmentTimeline entries cannot be
+  // merged with repeat counts.
+  int64_t start_time = 0;
+  for (size_t i = 0; i < kSegmentCount; ++i) {
+    const int64_t duration = kSegmentDuration + static_cast<int64_t>(i % 2);
+    representation->AddNewSegment(start_time, duration, kSegmentSize);
+    start_time += duration;
+  }
+  MeasureToStringRate(base::StringPrintf("live_%zu_segments", kSegmentCount),
+                      &mpd);
+}
+
+}  // namespace shaka
@@ -15,6 +15,7 @@
 #include "packager/version/version.h"
 
 using ::testing::HasSubstr;
+using ::testing::Not;
 
 namespace shaka {
 
@@ -321,6 +322,96 @@ TEST_F(LiveMpdBuilderTest, StaticCheckMpdAttributes) {
   ASSERT_EQ(kExpectedOutput, mpd_doc);
 }
 
+// Check that a patch from the previous MPD is generated with each MPD.
+TEST_F(LiveMpdBuilderTest, MpdPatch) {
+  mutable_mpd_options()->mpd_params.mpd_output = "foo/manifest.mpd";
+  mutable_mpd_options()->mpd_params.mpd_patch_output = "foo/manifest.mpp";
+  mutable_mpd_options()->mpd_params.minimum_update_period = 2;
+
+  MediaInfo media_info = GetTestMediaInfo(kFileNameVideoMediaInfo1);
+  media_info.set_segment_template_url("$Number$.m4s");
+  Period* period = mpd_.GetOrCreatePeriod(0);
+  AdaptationSet* adaptation_set =
+      period->GetOrCreateAdaptationSet(media_info, true);
+  adaptation_set->set_id(0);
+  Representation* representation =
+      adaptation_set->AddRepresentation(media_info);
+  const uint64_t kDuration = 1000;
+  const uint64_t kSize = 1000;
+  representation->AddNewSegment(0, kDuration, kSize);
+  representation->AddNewSegment(kDuration, kDuration, kSize);
+
+  std::string mpd_doc;
+  ASSERT_TRUE(mpd_.ToString(&mpd_doc));
+  EXPECT_THAT(mpd_doc, HasSubstr("publishTime=\"2016-01-11T15:10:24.000Z\""));
+  EXPECT_THAT(mpd_doc, HasSubstr("id=\"mpd\""));
+  EXPECT_THAT(mpd_doc, HasSubstr("<PatchLocation ttl=\"2\">manifest.mpp"
+                                 "</PatchLocation>"));
+  EXPECT_TRUE(mpd_.patch().empty());
+
+  representation->AddNewSegment(2 * kDuration, kDuration, kSize);
+  ASSERT_TRUE(mpd_.ToString(&mpd_doc));
+  // The clock did not advance, but the publishTime must.
+  EXPECT_THAT(mpd_doc, HasSubstr("publishTime=\"2016-01-11T15:10:24.001Z\""));
+  const std::string& patch = mpd_.patch();
+  EXPECT_THAT(patch,
+              HasSubstr("mpdId=\"mpd\""
+                        " originalPublishTime=\"2016-01-11T15:10:24.000Z\""
+                        " publishTime=\"2016-01-11T15:10:24.001Z\""));
+  EXPECT_THAT(patch, HasSubstr("<replace sel=\"/MPD/@publishTime\">"
+                               "2016-01-11T15:10:24.001Z</replace>"));
+  EXPECT_THAT(patch,
+              HasSubstr("<replace sel=\"/MPD/Period[@id='0']"
+                        "/AdaptationSet[@id='0']/Representation[@id='0']"
+                        "/SegmentTemplate/SegmentTimeline/S[@t='0']\">"));
+  EXPECT_THAT(patch, HasSubstr("<S t=\"0\" d=\"1000\" r=\"2\"/>"));
+}
+
+// Periods which ended before the time shift buffer are removed once their
+// Representations continue in later Periods.
+TEST_F(LiveMpdBuilderTest, RemoveExpiredPeriods) {
+  mutable_mpd_options()->mpd_params.time_shift_buffer_depth = 10;
+
+  MediaInfo media_info = GetTestMediaInfo(kFileNameVideoMediaInfo1);
+  media_info.set_segment_template_url("$Number$.m4s");
+  const uint32_t time_scale = media_info.reference_time_scale();
+  const uint64_t kSize = 1000;
+
+  Period* period = mpd_.GetOrCreatePeriod(0);
+  AdaptationSet* adaptation_set =
+      period->GetOrCreateAdaptationSet(media_info, true);
+  adaptation_set->set_id(0);
+  Representation* representation =
+      adaptation_set->AddRepresentation(media_info);
+  for (int i = 0; i < 5; ++i)
+    representation->AddNewSegment(i * time_scale, time_scale, kSize);
+
+  // A cue at 5 seconds.
+  Period* next_period = mpd_.GetOrCreatePeriod(5);
+  AdaptationSet* next_adaptation_set =
+      next_period->GetOrCreateAdaptationSet(media_info, true);
+  next_adaptation_set->set_id(0);
+  Representation* next_representation =
+      next_adaptation_set->CopyRepresentation(*representation);
+  // The copy shares the MediaInfo.
+  EXPECT_EQ(&representation->GetMediaInfo(),
+            &next_representation->GetMediaInfo());
+  for (int i = 5; i < 12; ++i)
+    next_representation->AddNewSegment(i * time_scale, time_scale, kSize);
+
+  std::string mpd_doc;
+  ASSERT_TRUE(mpd_.ToString(&mpd_doc));
+  EXPECT_THAT(mpd_doc, HasSubstr("<Period id=\"0\""));
+  EXPECT_THAT(mpd_doc, HasSubstr("<Period id=\"1\""));
+
+  // The time shift buffer starts at 6 seconds now.
+  for (int i = 12; i < 16; ++i)
+    next_representation->AddNewSegment(i * time_scale, time_scale, kSize);
+  ASSERT_TRUE(mpd_.ToString(&mpd_doc));
+  EXPECT_THAT(mpd_doc, Not(HasSubstr("<Period id=\"0\"")));
+  EXPECT_THAT(mpd_doc, HasSubstr("<Period id=\"1\""));
+}
+
 namespace {
 const char kMediaFile[] = "foo/bar/media.mp4";
 const char kMediaFileBase[] = "media.mp4";
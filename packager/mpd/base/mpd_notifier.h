@@ -99,11 +99,54 @@ class MpdNotifier {
   virtual bool NotifyMediaInfoUpdate(uint32_t container_id,
                                      const MediaInfo& media_info) = 0;
 
+  /// Restore the startNumber of a container of a restarted live session, see
+  /// LiveCheckpoint. Must be called before any segment of the container is
+  /// notified.
+  /// @param container_id Container ID obtained from calling
+  ///        NotifyNewContainer().
+  /// @param start_number is the number of the next segment.
+  /// @return true on success, false otherwise, e.g. if it is not supported.
+  virtual bool SetStartNumber(uint32_t container_id, uint32_t start_number) {
+    return false;
+  }
+
+  /// @param[out] availability_start_time is set to the availabilityStartTime
+  ///             of the dynamic MPD, as an xs:dateTime.
+  /// @return true if the availabilityStartTime is known, false otherwise.
+  virtual bool GetAvailabilityStartTime(std::string* availability_start_time) {
+    return false;
+  }
+
+  /// Restore the availabilityStartTime of a restarted live session, see
+  /// LiveCheckpoint. Must be called before the MPD is written.
+  /// @param availability_start_time is an xs:dateTime.
+  /// @return true on success, false otherwise, e.g. if it is not supported.
+  virtual bool SetAvailabilityStartTime(
+      const std::string& availability_start_time) {
+    return false;
+  }
+
+  /// Remove the Representation of a container detached from a running live
+  /// session, see Packager::RemoveInput(), from the current Period. The
+  /// container must not be notified anymore.
+  /// @param segment_template is the segment template of the container, as in
+  ///        the MediaInfo passed to NotifyNewContainer().
+  /// @return true on success, false otherwise, e.g. if it is not supported.
+  virtual bool RemoveContainer(const std::string& segment_template) {
+    return false;
+  }
+
   /// Call this method to force a flush. Implementations might not write out
   /// the MPD to a stream (file, stdout, etc.) when the MPD is updated, this
   /// forces a flush.
   virtual bool Flush() = 0;
 
+  /// Call this method when the MPD is updated for a new segment of a dynamic
+  /// MPD. Implementations may coalesce the requests of the Representations,
+  /// and write out the MPD later; the default implementation calls Flush().
+  /// @return true on success, false otherwise.
+  virtual bool RequestFlush() { return Flush(); }
+
   /// @return include_mspr_pro option flag
   bool include_mspr_pro() const { return mpd_options_.mpd_params.include_mspr_pro; }
 
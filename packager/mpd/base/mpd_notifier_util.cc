@@ -8,12 +8,14 @@
 
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
-#include "packager/file/file.h"
 #include "packager/mpd/base/mpd_utils.h"
 
 namespace shaka {
 
-bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder) {
+bool WriteMpdToFile(const std::string& output_path,
+                    const std::string& patch_output_path,
+                    MpdBuilder* mpd_builder,
+                    ManifestFileWriter* file_writer) {
   CHECK(!output_path.empty());
 
   std::string mpd;
@@ -22,7 +24,15 @@ bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder) {
     return false;
   }
 
-  if (!File::WriteFileAtomically(output_path.c_str(), mpd)) {
+  // The patch is written first, so it is available to the clients as soon as
+  // the MPD it applies to is superseded.
+  if (!patch_output_path.empty() && !mpd_builder->patch().empty() &&
+      !file_writer->Write(patch_output_path, mpd_builder->patch())) {
+    LOG(ERROR) << "Failed to write mpd patch to: " << patch_output_path;
+    return false;
+  }
+
+  if (!file_writer->Write(output_path, mpd)) {
     LOG(ERROR) << "Failed to write mpd to: " << output_path;
     return false;
   }
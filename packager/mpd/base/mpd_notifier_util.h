@@ -14,6 +14,7 @@
 #include <vector>
 
 #include "packager/base/base64.h"
+#include "packager/mpd/base/manifest_file_writer.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_builder.h"
 
@@ -28,8 +29,14 @@ enum ContentType {
 
 /// Outputs MPD to @a output_path.
 /// @param output_path is the path to the MPD output location.
+/// @param patch_output_path is the path to the MPD Patch output location. The
+///        patch, if any, is written before the MPD. Ignored if empty.
 /// @param mpd_builder is the MPD builder instance.
-bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder);
+/// @param file_writer writes the files, skipping the unchanged ones.
+bool WriteMpdToFile(const std::string& output_path,
+                    const std::string& patch_output_path,
+                    MpdBuilder* mpd_builder,
+                    ManifestFileWriter* file_writer);
 
 /// Determines the content type of |media_info|.
 /// @param media_info is the information about the media.
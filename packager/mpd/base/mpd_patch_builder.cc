@@ -0,0 +1,391 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/mpd_patch_builder.h"
+
+#include <set>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/mpd/base/adaptation_set.h"
+#include "packager/mpd/base/period.h"
+#include "packager/mpd/base/representation.h"
+#include "packager/mpd/base/xml/xml_node.h"
+
+namespace shaka {
+
+namespace {
+
+const char kPatchNamespace[] = "urn:mpeg:dash:schema:mpd-patch:2020";
+const char kXmlNamespaceXsi[] = "http://www.w3.org/2001/XMLSchema-instance";
+const char kPatchSchemaLocation[] =
+    "urn:mpeg:dash:schema:mpd-patch:2020 DASH-MPD-PATCH.xsd";
+
+typedef std::vector<xml::scoped_xml_ptr<xmlNode>> Operations;
+
+std::string GetAttribute(xmlNodePtr node, const char* name) {
+  xml::scoped_xml_ptr<xmlChar> value(xmlGetProp(node, BAD_CAST name));
+  return value ? reinterpret_cast<const char*>(value.get()) : "";
+}
+
+std::map<std::string, std::string> GetAttributes(xmlNodePtr node) {
+  std::map<std::string, std::string> attributes;
+  for (xmlAttrPtr attribute = node->properties; attribute;
+       attribute = attribute->next) {
+    const char* name = reinterpret_cast<const char*>(attribute->name);
+    attributes[name] = GetAttribute(node, name);
+  }
+  return attributes;
+}
+
+std::vector<xmlNodePtr> GetChildElements(xmlNodePtr node, const char* name) {
+  std::vector<xmlNodePtr> children;
+  for (xmlNodePtr child = xmlFirstElementChild(node); child;
+       child = xmlNextElementSibling(child)) {
+    if (xmlStrcmp(child->name, BAD_CAST name) == 0)
+      children.push_back(child);
+  }
+  return children;
+}
+
+xmlNodePtr GetChildElement(xmlNodePtr node, const char* name) {
+  std::vector<xmlNodePtr> children = GetChildElements(node, name);
+  return children.empty() ? nullptr : children.front();
+}
+
+std::string NodeToString(xmlNodePtr node) {
+  xmlBufferPtr buffer = xmlBufferCreate();
+  xmlNodeDump(buffer, node->doc, node, 0, 0);
+  std::string output(reinterpret_cast<const char*>(xmlBufferContent(buffer)),
+                     xmlBufferLength(buffer));
+  xmlBufferFree(buffer);
+  return output;
+}
+
+std::string IdSelector(const char* name, const std::string& id) {
+  return std::string(name) + "[@id='" + id + "']";
+}
+
+std::string SegmentSelector(const std::string& segment_timeline_selector,
+                            int64_t start_time) {
+  return segment_timeline_selector + "/S[@t='" +
+         base::Uint64ToString(start_time) + "']";
+}
+
+// @return The Period without the parts which are patched per Representation:
+//         the attributes of the Representations and SegmentTemplates, except
+//         the IDs, and the S elements. Empty if the Representations cannot be
+//         selected by ID.
+std::string GetStaticPeriodXml(xmlNodePtr period) {
+  xml::scoped_xml_ptr<xmlNode> copy(xmlCopyNode(period, 1));
+  for (xmlNodePtr adaptation_set :
+       GetChildElements(copy.get(), "AdaptationSet")) {
+    if (GetAttribute(adaptation_set, "id").empty())
+      return "";
+    for (xmlNodePtr representation :
+         GetChildElements(adaptation_set, "Representation")) {
+      const std::string id = GetAttribute(representation, "id");
+      if (id.empty())
+        return "";
+      while (representation->properties)
+        xmlRemoveProp(representation->properties);
+      xmlSetProp(representation, BAD_CAST "id", BAD_CAST id.c_str());
+
+      xmlNodePtr segment_template =
+          GetChildElement(representation, "SegmentTemplate");
+      if (!segment_template)
+        continue;
+      while (segment_template->properties)
+        xmlRemoveProp(segment_template->properties);
+      xmlNodePtr segment_timeline =
+          GetChildElement(segment_template, "SegmentTimeline");
+      if (segment_timeline)
+        xmlNodeSetContent(segment_timeline, nullptr);
+    }
+  }
+  return NodeToString(copy.get());
+}
+
+const Representation* FindRepresentation(
+    const std::list<std::unique_ptr<Period>>& periods,
+    const std::string& period_id,
+    const std::string& representation_id) {
+  for (const auto& period : periods) {
+    if (base::UintToString(period->id()) != period_id)
+      continue;
+    for (const AdaptationSet* adaptation_set : period->GetAdaptationSets()) {
+      for (const Representation* representation :
+           adaptation_set->GetRepresentations()) {
+        if (base::UintToString(representation->id()) == representation_id)
+          return representation;
+      }
+    }
+  }
+  return nullptr;
+}
+
+xml::scoped_xml_ptr<xmlNode> NewOperation(const char* name,
+                                          const std::string& selector) {
+  xml::XmlNode operation(name);
+  operation.SetStringAttribute("sel", selector);
+  return operation.PassScopedPtr();
+}
+
+xml::scoped_xml_ptr<xmlNode> NewSegmentElement(
+    const SegmentInfo& segment_info) {
+  xml::XmlNode segment("S");
+  segment.SetIntegerAttribute("t", segment_info.start_time);
+  segment.SetIntegerAttribute("d", segment_info.duration);
+  if (segment_info.repeat > 0)
+    segment.SetIntegerAttribute("r", segment_info.repeat);
+  return segment.PassScopedPtr();
+}
+
+void AddAttributeOperations(
+    const std::string& selector,
+    const std::map<std::string, std::string>& old_attributes,
+    const std::map<std::string, std::string>& new_attributes,
+    Operations* operations) {
+  for (const auto& attribute : new_attributes) {
+    auto iter = old_attributes.find(attribute.first);
+    if (iter != old_attributes.end() && iter->second == attribute.second)
+      continue;
+    xml::scoped_xml_ptr<xmlNode> operation;
+    if (iter == old_attributes.end()) {
+      operation = NewOperation("add", selector);
+      xmlSetProp(operation.get(), BAD_CAST "type",
+                 BAD_CAST("@" + attribute.first).c_str());
+    } else {
+      operation = NewOperation("replace", selector + "/@" + attribute.first);
+    }
+    xmlNodeAddContent(operation.get(), BAD_CAST attribute.second.c_str());
+    operations->push_back(std::move(operation));
+  }
+  for (const auto& attribute : old_attributes) {
+    if (new_attributes.find(attribute.first) == new_attributes.end()) {
+      operations->push_back(
+          NewOperation("remove", selector + "/@" + attribute.first));
+    }
+  }
+}
+
+// The segments slid out of the window are removed from the front of the
+// timeline, the S elements which changed, typically the first and last ones,
+// are replaced, and the new segments are added at the end.
+// @return false if the S elements cannot be selected unambiguously while the
+//         timeline is patched, in which case it must be replaced.
+bool AddSegmentTimelineOperations(
+    const std::string& selector,
+    const std::vector<SegmentInfo>& old_segment_infos,
+    const std::vector<SegmentInfo>& new_segment_infos,
+    Operations* operations) {
+  Operations timeline_operations;
+  auto old_iter = old_segment_infos.begin();
+  auto new_iter = new_segment_infos.begin();
+  if (new_iter != new_segment_infos.end()) {
+    for (; old_iter != old_segment_infos.end(); ++old_iter) {
+      const int64_t end_time =
+          old_iter->start_time + old_iter->duration * (old_iter->repeat + 1);
+      if (end_time > new_iter->start_time)
+        break;
+      timeline_operations.push_back(NewOperation(
+          "remove", SegmentSelector(selector, old_iter->start_time)));
+    }
+  }
+
+  std::set<int64_t> old_start_times;
+  for (auto iter = old_iter; iter != old_segment_infos.end(); ++iter)
+    old_start_times.insert(iter->start_time);
+  for (; old_iter != old_segment_infos.end() &&
+         new_iter != new_segment_infos.end();
+       ++old_iter, ++new_iter) {
+    if (old_iter->start_time == new_iter->start_time &&
+        old_iter->duration == new_iter->duration &&
+        old_iter->repeat == new_iter->repeat) {
+      continue;
+    }
+    if (old_iter->start_time != new_iter->start_time &&
+        old_start_times.count(new_iter->start_time) > 0) {
+      return false;
+    }
+    xml::scoped_xml_ptr<xmlNode> operation = NewOperation(
+        "replace", SegmentSelector(selector, old_iter->start_time));
+    xmlAddChild(operation.get(), NewSegmentElement(*new_iter).release());
+    timeline_operations.push_back(std::move(operation));
+  }
+  for (; old_iter != old_segment_infos.end(); ++old_iter) {
+    timeline_operations.push_back(NewOperation(
+        "remove", SegmentSelector(selector, old_iter->start_time)));
+  }
+  if (new_iter != new_segment_infos.end()) {
+    xml::scoped_xml_ptr<xmlNode> operation = NewOperation("add", selector);
+    for (; new_iter != new_segment_infos.end(); ++new_iter)
+      xmlAddChild(operation.get(), NewSegmentElement(*new_iter).release());
+    timeline_operations.push_back(std::move(operation));
+  }
+
+  for (auto& operation : timeline_operations)
+    operations->push_back(std::move(operation));
+  return true;
+}
+
+}  // namespace
+
+MpdPatchBuilder::MpdPatchBuilder() {}
+
+MpdPatchBuilder::~MpdPatchBuilder() {}
+
+void MpdPatchBuilder::Update(xmlNodePtr mpd,
+                             const std::list<std::unique_ptr<Period>>& periods,
+                             std::string* patch) {
+  DCHECK(mpd);
+  DCHECK(patch);
+
+  Operations operations;
+  std::map<std::string, std::string> mpd_attributes = GetAttributes(mpd);
+  AddAttributeOperations("/MPD", mpd_attributes_, mpd_attributes, &operations);
+
+  std::map<std::string, PeriodState> period_states;
+  std::string previous_period_id;
+  for (xmlNodePtr period : GetChildElements(mpd, "Period")) {
+    const std::string period_id = GetAttribute(period, "id");
+    const std::string period_selector =
+        "/MPD/" + IdSelector("Period", period_id);
+    PeriodState& period_state = period_states[period_id];
+    period_state.static_xml = GetStaticPeriodXml(period);
+
+    auto old_period_state = periods_.find(period_id);
+    if (old_period_state == periods_.end()) {
+      // New Periods are added after the Period preceding them.
+      xml::scoped_xml_ptr<xmlNode> operation;
+      if (previous_period_id.empty()) {
+        operation = NewOperation("add", "/MPD");
+      } else {
+        operation = NewOperation(
+            "add", "/MPD/" + IdSelector("Period", previous_period_id));
+        xmlSetProp(operation.get(), BAD_CAST "pos", BAD_CAST "after");
+      }
+      xmlAddChild(operation.get(), xmlCopyNode(period, 1));
+      operations.push_back(std::move(operation));
+    } else if (period_state.static_xml.empty() ||
+               period_state.static_xml !=
+                   old_period_state->second.static_xml) {
+      xml::scoped_xml_ptr<xmlNode> operation =
+          NewOperation("replace", period_selector);
+      xmlAddChild(operation.get(), xmlCopyNode(period, 1));
+      operations.push_back(std::move(operation));
+      old_period_state = periods_.end();
+    }
+    previous_period_id = period_id;
+    if (period_state.static_xml.empty())
+      continue;
+
+    for (xmlNodePtr adaptation_set :
+         GetChildElements(period, "AdaptationSet")) {
+      const std::string adaptation_set_selector =
+          period_selector + "/" +
+          IdSelector("AdaptationSet", GetAttribute(adaptation_set, "id"));
+      for (xmlNodePtr representation :
+           GetChildElements(adaptation_set, "Representation")) {
+        const std::string representation_id =
+            GetAttribute(representation, "id");
+        const std::string representation_selector =
+            adaptation_set_selector + "/" +
+            IdSelector("Representation", representation_id);
+        RepresentationState& representation_state =
+            period_state.representations[representation_selector];
+        representation_state.attributes = GetAttributes(representation);
+
+        xmlNodePtr segment_template =
+            GetChildElement(representation, "SegmentTemplate");
+        if (segment_template) {
+          representation_state.segment_template_attributes =
+              GetAttributes(segment_template);
+        }
+        xmlNodePtr segment_timeline =
+            segment_template
+                ? GetChildElement(segment_template, "SegmentTimeline")
+                : nullptr;
+        if (segment_timeline) {
+          const Representation* representation_object =
+              FindRepresentation(periods, period_id, representation_id);
+          CHECK(representation_object);
+          representation_state.segment_infos.assign(
+              representation_object->segment_infos().begin(),
+              representation_object->segment_infos().end());
+        }
+
+        // Patch the Representations of the Periods which were not replaced.
+        if (old_period_state == periods_.end())
+          continue;
+        const RepresentationState& old_representation_state =
+            old_period_state->second.representations[representation_selector];
+        AddAttributeOperations(representation_selector,
+                               old_representation_state.attributes,
+                               representation_state.attributes, &operations);
+        if (!segment_template)
+          continue;
+        const std::string segment_template_selector =
+            representation_selector + "/SegmentTemplate";
+        AddAttributeOperations(
+            segment_template_selector,
+            old_representation_state.segment_template_attributes,
+            representation_state.segment_template_attributes, &operations);
+        if (!segment_timeline)
+          continue;
+        const std::string segment_timeline_selector =
+            segment_template_selector + "/SegmentTimeline";
+        if (!AddSegmentTimelineOperations(
+                segment_timeline_selector,
+                old_representation_state.segment_infos,
+                representation_state.segment_infos, &operations)) {
+          xml::scoped_xml_ptr<xmlNode> operation =
+              NewOperation("replace", segment_timeline_selector);
+          xmlAddChild(operation.get(),
+                      xmlCopyNode(segment_timeline, 1));
+          operations.push_back(std::move(operation));
+        }
+      }
+    }
+  }
+  for (const auto& old_period_state : periods_) {
+    if (period_states.find(old_period_state.first) == period_states.end()) {
+      operations.push_back(NewOperation(
+          "remove", "/MPD/" + IdSelector("Period", old_period_state.first)));
+    }
+  }
+
+  patch->clear();
+  const std::string publish_time = GetAttribute(mpd, "publishTime");
+  if (!publish_time_.empty()) {
+    xml::XmlNode patch_node("Patch");
+    patch_node.SetStringAttribute("xmlns", kPatchNamespace);
+    patch_node.SetStringAttribute("xmlns:xsi", kXmlNamespaceXsi);
+    patch_node.SetStringAttribute("xsi:schemaLocation", kPatchSchemaLocation);
+    patch_node.SetStringAttribute("mpdId", GetAttribute(mpd, "id"));
+    patch_node.SetStringAttribute("originalPublishTime", publish_time_);
+    patch_node.SetStringAttribute("publishTime", publish_time);
+    for (auto& operation : operations)
+      CHECK(patch_node.AddChild(std::move(operation)));
+
+    static const char kXmlVersion[] = "1.0";
+    xml::scoped_xml_ptr<xmlDoc> doc(xmlNewDoc(BAD_CAST kXmlVersion));
+    xmlDocSetRootElement(doc.get(), patch_node.Release());
+    static const int kNiceFormat = 1;
+    int doc_str_size = 0;
+    xmlChar* doc_str = nullptr;
+    xmlDocDumpFormatMemoryEnc(doc.get(), &doc_str, &doc_str_size, "UTF-8",
+                              kNiceFormat);
+    patch->assign(doc_str, doc_str + doc_str_size);
+    xmlFree(doc_str);
+  }
+
+  publish_time_ = publish_time;
+  mpd_attributes_.swap(mpd_attributes);
+  periods_.swap(period_states);
+}
+
+}  // namespace shaka
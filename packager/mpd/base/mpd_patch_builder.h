@@ -0,0 +1,72 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MPD_BASE_MPD_PATCH_BUILDER_H_
+#define PACKAGER_MPD_BASE_MPD_PATCH_BUILDER_H_
+
+#include <libxml/tree.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/mpd/base/segment_info.h"
+
+namespace shaka {
+
+class Period;
+
+/// Generates MPD Patch documents (ISO/IEC 23009-1 5.15), which update the
+/// previous version of a dynamic MPD to the current one.
+/// The SegmentTimelines are patched with the segments added and removed since
+/// the previous MPD, and the attributes of the MPD, Representation and
+/// SegmentTemplate elements are patched individually. A Period with any other
+/// change is replaced as a whole. The other children of the MPD element are
+/// assumed not to change.
+class MpdPatchBuilder {
+ public:
+  MpdPatchBuilder();
+  ~MpdPatchBuilder();
+
+  /// Generates the patch from the MPD passed to the previous call to @a mpd,
+  /// then records @a mpd for the next call.
+  /// @param mpd is the MPD element of the new MPD, with @id and @publishTime.
+  /// @param periods are the Periods @a mpd was generated from.
+  /// @param[out] patch is set to the patch document, or cleared on the first
+  ///             call.
+  void Update(xmlNodePtr mpd,
+              const std::list<std::unique_ptr<Period>>& periods,
+              std::string* patch);
+
+ private:
+  MpdPatchBuilder(const MpdPatchBuilder&) = delete;
+  MpdPatchBuilder& operator=(const MpdPatchBuilder&) = delete;
+
+  struct RepresentationState {
+    std::map<std::string, std::string> attributes;
+    std::map<std::string, std::string> segment_template_attributes;
+    // The segments in the SegmentTimeline, if any.
+    std::vector<SegmentInfo> segment_infos;
+  };
+  struct PeriodState {
+    // The Period element without the parts patched per Representation, or
+    // empty if they cannot be patched.
+    std::string static_xml;
+    // Keyed by the selector of the Representation.
+    std::map<std::string, RepresentationState> representations;
+  };
+
+  std::string publish_time_;
+  std::map<std::string, std::string> mpd_attributes_;
+  // Keyed by Period@id.
+  std::map<std::string, PeriodState> periods_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MPD_BASE_MPD_PATCH_BUILDER_H_
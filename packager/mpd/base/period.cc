@@ -77,7 +77,7 @@ AdaptationSet* Period::GetOrCreateAdaptationSet(
   // Set duration if it is not set. It may be updated later from duration
   // calculated from segments.
   if (duration_seconds_ == 0)
-    duration_seconds_ = media_info.media_duration_seconds();
+    set_duration_seconds(media_info.media_duration_seconds());
 
   const std::string key = GetAdaptationSetKey(
       media_info, mpd_options_.mpd_params.allow_codec_switching);
@@ -117,10 +117,27 @@ AdaptationSet* Period::GetOrCreateAdaptationSet(
   AdaptationSet* adaptation_set_ptr = new_adaptation_set.get();
   adaptation_sets.push_back(adaptation_set_ptr);
   adaptation_sets_.emplace_back(std::move(new_adaptation_set));
+  cached_xml_.reset();
   return adaptation_set_ptr;
 }
 
 xml::scoped_xml_ptr<xmlNode> Period::GetXml(bool output_period_duration) {
+  bool changed = !cached_xml_ ||
+                 cached_xml_output_period_duration_ != output_period_duration;
+  for (auto iter = adaptation_sets_.begin();
+       !changed && iter != adaptation_sets_.end(); ++iter) {
+    changed = (*iter)->XmlChanged();
+  }
+  if (changed) {
+    cached_xml_ = GenerateXml(output_period_duration);
+    if (!cached_xml_)
+      return nullptr;
+    cached_xml_output_period_duration_ = output_period_duration;
+  }
+  return xml::scoped_xml_ptr<xmlNode>(xmlCopyNode(cached_xml_.get(), 1));
+}
+
+xml::scoped_xml_ptr<xmlNode> Period::GenerateXml(bool output_period_duration) {
   adaptation_sets_.sort(
       [](const std::unique_ptr<AdaptationSet>& adaptation_set_a,
          const std::unique_ptr<AdaptationSet>& adaptation_set_b) {
@@ -137,6 +154,9 @@ xml::scoped_xml_ptr<xmlNode> Period::GetXml(bool output_period_duration) {
   period.SetId(id_);
   // Iterate thru AdaptationSets and add them to one big Period element.
   for (const auto& adaptation_set : adaptation_sets_) {
+    // The Representations of a live AdaptationSet may have all been removed.
+    if (adaptation_set->GetRepresentations().empty())
+      continue;
     xml::scoped_xml_ptr<xmlNode> child(adaptation_set->GetXml());
     if (!child || !period.AddChild(std::move(child)))
       return nullptr;
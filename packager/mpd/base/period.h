@@ -48,6 +48,9 @@ class Period {
       bool content_protection_in_adaptation_set);
 
   /// Generates <Period> xml element with its child AdaptationSet elements.
+  /// The element is only regenerated if the Period or one of its
+  /// AdaptationSets changed since the last call, so a closed Period is not
+  /// regenerated.
   /// @return On success returns a non-NULL scoped_xml_ptr. Otherwise returns a
   ///         NULL scoped_xml_ptr.
   xml::scoped_xml_ptr<xmlNode> GetXml(bool output_period_duration);
@@ -55,6 +58,9 @@ class Period {
   /// @return The list of AdaptationSets in this Period.
   const std::list<AdaptationSet*> GetAdaptationSets() const;
 
+  /// @return The ID of this Period.
+  uint32_t id() const { return id_; }
+
   /// @return The start time of this Period.
   double start_time_in_seconds() const { return start_time_in_seconds_; }
 
@@ -63,6 +69,8 @@ class Period {
 
   /// Set period duration.
   void set_duration_seconds(double duration_seconds) {
+    if (duration_seconds_ != duration_seconds)
+      cached_xml_.reset();
     duration_seconds_ = duration_seconds;
   }
 
@@ -90,6 +98,9 @@ class Period {
   friend class MpdBuilder;
   friend class PeriodTest;
 
+  // Generates the <Period> element, see GetXml().
+  xml::scoped_xml_ptr<xmlNode> GenerateXml(bool output_period_duration);
+
   // Calls AdaptationSet constructor. For mock injection.
   virtual std::unique_ptr<AdaptationSet> NewAdaptationSet(
       const std::string& lang,
@@ -164,6 +175,12 @@ class Period {
         protected_content_map_;
   };
   ProtectedAdaptationSetMap protected_adaptation_set_map_;
+
+  // The element generated by the last call to GetXml(), with the
+  // |output_period_duration| it was generated with. Reset whenever the Period
+  // changes.
+  xml::scoped_xml_ptr<xmlNode> cached_xml_;
+  bool cached_xml_output_period_duration_ = false;
 };
 
 }  // namespace shaka
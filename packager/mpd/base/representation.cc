@@ -13,6 +13,7 @@
 #include "packager/base/logging.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
+#include "packager/file/segment_reaper.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/base/mpd_utils.h"
@@ -80,6 +81,20 @@ uint32_t GetTimeScale(const MediaInfo& media_info) {
   return 1;
 }
 
+// The segments out of the time shift buffer are not kept only for the
+// bandwidth estimate. Note that a window of 0, i.e. all the segments, does not
+// keep the segments.
+double GetBandwidthEstimationWindow(const MpdOptions& mpd_options) {
+  const MpdParams& mpd_params = mpd_options.mpd_params;
+  if (mpd_options.mpd_type == MpdType::kDynamic &&
+      mpd_params.time_shift_buffer_depth > 0 &&
+      mpd_params.bandwidth_estimation_window >
+          mpd_params.time_shift_buffer_depth) {
+    return mpd_params.time_shift_buffer_depth;
+  }
+  return mpd_params.bandwidth_estimation_window;
+}
+
 }  // namespace
 
 Representation::Representation(
@@ -87,15 +102,27 @@ Representation::Representation(
     const MpdOptions& mpd_options,
     uint32_t id,
     std::unique_ptr<RepresentationStateChangeListener> state_change_listener)
-    : media_info_(media_info),
+    : Representation(std::make_shared<MediaInfo>(media_info),
+                     mpd_options,
+                     id,
+                     std::move(state_change_listener)) {}
+
+Representation::Representation(
+    std::shared_ptr<MediaInfo> media_info,
+    const MpdOptions& mpd_options,
+    uint32_t id,
+    std::unique_ptr<RepresentationStateChangeListener> state_change_listener)
+    : media_info_(std::move(media_info)),
       id_(id),
+      bandwidth_estimator_(GetBandwidthEstimationWindow(mpd_options)),
       mpd_options_(mpd_options),
       state_change_listener_(std::move(state_change_listener)),
       allow_approximate_segment_timeline_(
           // TODO(kqyang): Need a better check. $Time is legitimate but not a
           // template.
-          media_info.segment_template().find("$Time") == std::string::npos &&
-          mpd_options_.mpd_params.allow_approximate_segment_timeline) {}
+          media_info_->segment_template().find("$Time") == std::string::npos &&
+          (mpd_options_.mpd_params.allow_approximate_segment_timeline ||
+           mpd_options_.mpd_params.segment_template_constant_duration)) {}
 
 Representation::Representation(
     const Representation& representation,
@@ -115,9 +142,9 @@ Representation::Representation(
 Representation::~Representation() {}
 
 bool Representation::Init() {
-  if (!AtLeastOneTrue(media_info_.has_video_info(),
-                      media_info_.has_audio_info(),
-                      media_info_.has_text_info())) {
+  if (!AtLeastOneTrue(media_info_->has_video_info(),
+                      media_info_->has_audio_info(),
+                      media_info_->has_text_info())) {
     // This is an error. Segment information can be in AdaptationSet, Period, or
     // MPD but the interface does not provide a way to set them.
     // See 5.3.9.1 ISO 23009-1:2012 for segment info.
@@ -125,34 +152,34 @@ bool Representation::Init() {
     return false;
   }
 
-  if (MoreThanOneTrue(media_info_.has_video_info(),
-                      media_info_.has_audio_info(),
-                      media_info_.has_text_info())) {
+  if (MoreThanOneTrue(media_info_->has_video_info(),
+                      media_info_->has_audio_info(),
+                      media_info_->has_text_info())) {
     LOG(ERROR) << "Only one of VideoInfo, AudioInfo, or TextInfo can be set.";
     return false;
   }
 
-  if (media_info_.container_type() == MediaInfo::CONTAINER_UNKNOWN) {
+  if (media_info_->container_type() == MediaInfo::CONTAINER_UNKNOWN) {
     LOG(ERROR) << "'container_type' in MediaInfo cannot be CONTAINER_UNKNOWN.";
     return false;
   }
 
-  if (media_info_.has_video_info()) {
+  if (media_info_->has_video_info()) {
     mime_type_ = GetVideoMimeType();
-    if (!HasRequiredVideoFields(media_info_.video_info())) {
+    if (!HasRequiredVideoFields(media_info_->video_info())) {
       LOG(ERROR) << "Missing required fields to create a video Representation.";
       return false;
     }
-  } else if (media_info_.has_audio_info()) {
+  } else if (media_info_->has_audio_info()) {
     mime_type_ = GetAudioMimeType();
-  } else if (media_info_.has_text_info()) {
+  } else if (media_info_->has_text_info()) {
     mime_type_ = GetTextMimeType();
   }
 
   if (mime_type_.empty())
     return false;
 
-  codecs_ = GetCodecs(media_info_);
+  codecs_ = GetCodecs(*media_info_);
   return true;
 }
 
@@ -160,12 +187,14 @@ void Representation::AddContentProtectionElement(
     const ContentProtectionElement& content_protection_element) {
   content_protection_elements_.push_back(content_protection_element);
   RemoveDuplicateAttributes(&content_protection_elements_.back());
+  cached_xml_.reset();
 }
 
 void Representation::UpdateContentProtectionPssh(const std::string& drm_uuid,
                                                  const std::string& pssh) {
   UpdateContentProtectionPsshHelper(drm_uuid, pssh,
                                     &content_protection_elements_);
+  cached_xml_.reset();
 }
 
 void Representation::AddNewSegment(int64_t start_time,
@@ -175,6 +204,7 @@ void Representation::AddNewSegment(int64_t start_time,
     LOG(WARNING) << "Got segment with start_time and duration == 0. Ignoring.";
     return;
   }
+  cached_xml_.reset();
 
   // In order for the oldest segment to be accessible for at least
   // |time_shift_buffer_depth| seconds, the latest segment should not be in the
@@ -190,26 +220,42 @@ void Representation::AddNewSegment(int64_t start_time,
   current_buffer_depth_ += segment_infos_.back().duration;
 
   bandwidth_estimator_.AddBlock(
-      size, static_cast<double>(duration) / media_info_.reference_time_scale());
+      size,
+      static_cast<double>(duration) / media_info_->reference_time_scale());
 }
 
 void Representation::SetSampleDuration(uint32_t frame_duration) {
   // Sample duration is used to generate approximate SegmentTimeline.
   // Text is required to have exactly the same segment duration.
-  if (media_info_.has_audio_info() || media_info_.has_video_info())
+  if (media_info_->has_audio_info() || media_info_->has_video_info())
     frame_duration_ = frame_duration;
+  cached_xml_.reset();
 
-  if (media_info_.has_video_info()) {
-    media_info_.mutable_video_info()->set_frame_duration(frame_duration);
+  if (media_info_->has_video_info()) {
+    if (media_info_->video_info().frame_duration() != frame_duration)
+      MutableMediaInfo()->mutable_video_info()->set_frame_duration(
+          frame_duration);
     if (state_change_listener_) {
       state_change_listener_->OnSetFrameRateForRepresentation(
-          frame_duration, media_info_.video_info().time_scale());
+          frame_duration, media_info_->video_info().time_scale());
     }
   }
 }
 
 const MediaInfo& Representation::GetMediaInfo() const {
-  return media_info_;
+  return *media_info_;
+}
+
+xml::scoped_xml_ptr<xmlNode> Representation::GetXml() {
+  if (!cached_xml_ ||
+      cached_xml_suppression_flags_ != output_suppression_flags_) {
+    cached_xml_ = GenerateXml();
+    if (!cached_xml_)
+      return xml::scoped_xml_ptr<xmlNode>();
+    cached_xml_suppression_flags_ = output_suppression_flags_;
+  }
+  output_suppression_flags_ = 0;
+  return xml::scoped_xml_ptr<xmlNode>(xmlCopyNode(cached_xml_.get(), 1));
 }
 
 // Uses info in |media_info_| and |content_protection_elements_| to create a
@@ -218,17 +264,17 @@ const MediaInfo& Representation::GetMediaInfo() const {
 // AddVideoInfo() (possibly adds FramePacking elements), AddAudioInfo() (Adds
 // AudioChannelConfig elements), AddContentProtectionElements*(), and
 // AddVODOnlyInfo() (Adds segment info).
-xml::scoped_xml_ptr<xmlNode> Representation::GetXml() {
+xml::scoped_xml_ptr<xmlNode> Representation::GenerateXml() {
   if (!HasRequiredMediaInfoFields()) {
     LOG(ERROR) << "MediaInfo missing required fields.";
     return xml::scoped_xml_ptr<xmlNode>();
   }
 
-  const uint64_t bandwidth = media_info_.has_bandwidth()
-                                 ? media_info_.bandwidth()
+  const uint64_t bandwidth = media_info_->has_bandwidth()
+                                 ? media_info_->bandwidth()
                                  : bandwidth_estimator_.Max();
 
-  DCHECK(!(HasVODOnlyFields(media_info_) && HasLiveOnlyFields(media_info_)));
+  DCHECK(!(HasVODOnlyFields(*media_info_) && HasLiveOnlyFields(*media_info_)));
 
   xml::RepresentationXmlNode representation;
   // Mandatory fields for Representation.
@@ -238,12 +284,12 @@ xml::scoped_xml_ptr<xmlNode> Representation::GetXml() {
     representation.SetStringAttribute("codecs", codecs_);
   representation.SetStringAttribute("mimeType", mime_type_);
 
-  const bool has_video_info = media_info_.has_video_info();
-  const bool has_audio_info = media_info_.has_audio_info();
+  const bool has_video_info = media_info_->has_video_info();
+  const bool has_audio_info = media_info_->has_audio_info();
 
   if (has_video_info &&
       !representation.AddVideoInfo(
-          media_info_.video_info(),
+          media_info_->video_info(),
           !(output_suppression_flags_ & kSuppressWidth),
           !(output_suppression_flags_ & kSuppressHeight),
           !(output_suppression_flags_ & kSuppressFrameRate))) {
@@ -252,7 +298,7 @@ xml::scoped_xml_ptr<xmlNode> Representation::GetXml() {
   }
 
   if (has_audio_info &&
-      !representation.AddAudioInfo(media_info_.audio_info())) {
+      !representation.AddAudioInfo(media_info_->audio_info())) {
     LOG(ERROR) << "Failed to add audio info to Representation XML.";
     return xml::scoped_xml_ptr<xmlNode>();
   }
@@ -262,22 +308,23 @@ xml::scoped_xml_ptr<xmlNode> Representation::GetXml() {
     return xml::scoped_xml_ptr<xmlNode>();
   }
 
-  if (HasVODOnlyFields(media_info_) &&
-      !representation.AddVODOnlyInfo(media_info_)) {
+  if (HasVODOnlyFields(*media_info_) &&
+      !representation.AddVODOnlyInfo(*media_info_)) {
     LOG(ERROR) << "Failed to add VOD info.";
     return xml::scoped_xml_ptr<xmlNode>();
   }
 
-  if (HasLiveOnlyFields(media_info_) &&
-      !representation.AddLiveOnlyInfo(media_info_, segment_infos_,
-                                      start_number_)) {
+  if (HasLiveOnlyFields(*media_info_) &&
+      !representation.AddLiveOnlyInfo(
+          *media_info_, segment_infos_, start_number_,
+          mpd_options_.mpd_params.segment_template_constant_duration,
+          allow_approximate_segment_timeline_ ? GetErrorThreshold() : 0)) {
     LOG(ERROR) << "Failed to add Live info.";
     return xml::scoped_xml_ptr<xmlNode>();
   }
   // TODO(rkuroiwa): It is likely that all representations have the exact same
   // SegmentTemplate. Optimize and propagate the tag up to AdaptationSet level.
 
-  output_suppression_flags_ = 0;
   return representation.PassScopedPtr();
 }
 
@@ -287,10 +334,11 @@ void Representation::SuppressOnce(SuppressFlag flag) {
 
 void Representation::SetPresentationTimeOffset(
     double presentation_time_offset) {
-  int64_t pto = presentation_time_offset * media_info_.reference_time_scale();
-  if (pto <= 0)
+  int64_t pto = presentation_time_offset * media_info_->reference_time_scale();
+  if (pto <= 0 || pto == media_info_->presentation_time_offset())
     return;
-  media_info_.set_presentation_time_offset(pto);
+  MutableMediaInfo()->set_presentation_time_offset(pto);
+  cached_xml_.reset();
 }
 
 bool Representation::GetStartAndEndTimestamps(
@@ -302,25 +350,25 @@ bool Representation::GetStartAndEndTimestamps(
   if (start_timestamp_seconds) {
     *start_timestamp_seconds =
         static_cast<double>(segment_infos_.begin()->start_time) /
-        GetTimeScale(media_info_);
+        GetTimeScale(*media_info_);
   }
   if (end_timestamp_seconds) {
     *end_timestamp_seconds =
         static_cast<double>(segment_infos_.rbegin()->start_time +
                             segment_infos_.rbegin()->duration *
                                 (segment_infos_.rbegin()->repeat + 1)) /
-        GetTimeScale(media_info_);
+        GetTimeScale(*media_info_);
   }
   return true;
 }
 
 bool Representation::HasRequiredMediaInfoFields() const {
-  if (HasVODOnlyFields(media_info_) && HasLiveOnlyFields(media_info_)) {
+  if (HasVODOnlyFields(*media_info_) && HasLiveOnlyFields(*media_info_)) {
     LOG(ERROR) << "MediaInfo cannot have both VOD and Live fields.";
     return false;
   }
 
-  if (!media_info_.has_container_type()) {
+  if (!media_info_->has_container_type()) {
     LOG(ERROR) << "MediaInfo missing required field: container_type.";
     return false;
   }
@@ -390,16 +438,17 @@ bool Representation::ApproximiatelyEqual(int64_t time1, int64_t time2) const {
   // target duration of 2 seconds, the closest segment duration would be 1.984
   // or 2.00533.
 
+  // So we consider two times equal if they differ by less than one sample.
+  return std::abs(time1 - time2) <= GetErrorThreshold();
+}
+
+int64_t Representation::GetErrorThreshold() const {
   // An arbitrary error threshold cap. This makes sure that the error is not too
   // large for large samples.
   const double kErrorThresholdSeconds = 0.05;
-
-  // So we consider two times equal if they differ by less than one sample.
-  const uint32_t error_threshold =
-      std::min(frame_duration_,
-               static_cast<uint32_t>(kErrorThresholdSeconds *
-                                     media_info_.reference_time_scale()));
-  return std::abs(time1 - time2) <= error_threshold;
+  return std::min(frame_duration_,
+                  static_cast<uint32_t>(kErrorThresholdSeconds *
+                                        media_info_->reference_time_scale()));
 }
 
 int64_t Representation::AdjustDuration(int64_t duration) const {
@@ -407,7 +456,7 @@ int64_t Representation::AdjustDuration(int64_t duration) const {
     return duration;
   const int64_t scaled_target_duration =
       mpd_options_.mpd_params.target_segment_duration *
-      media_info_.reference_time_scale();
+      media_info_->reference_time_scale();
   return ApproximiatelyEqual(scaled_target_duration, duration)
              ? scaled_target_duration
              : duration;
@@ -418,7 +467,7 @@ void Representation::SlideWindow() {
       mpd_options_.mpd_type == MpdType::kStatic)
     return;
 
-  const uint32_t time_scale = GetTimeScale(media_info_);
+  const uint32_t time_scale = GetTimeScale(*media_info_);
   DCHECK_GT(time_scale, 0u);
 
   const int64_t time_shift_buffer_depth = static_cast<int64_t>(
@@ -427,8 +476,8 @@ void Representation::SlideWindow() {
   if (current_buffer_depth_ <= time_shift_buffer_depth)
     return;
 
-  std::list<SegmentInfo>::iterator first = segment_infos_.begin();
-  std::list<SegmentInfo>::iterator last = first;
+  std::deque<SegmentInfo>::iterator first = segment_infos_.begin();
+  std::deque<SegmentInfo>::iterator last = first;
   for (; last != segment_infos_.end(); ++last) {
     // Remove the current segment only if it falls completely out of time shift
     // buffer range.
@@ -453,73 +502,82 @@ void Representation::RemoveOldSegment(SegmentInfo* segment_info) {
     return;
 
   segments_to_be_removed_.push_back(
-      media::GetSegmentName(media_info_.segment_template(), segment_start_time,
-                            start_number_ - 1, media_info_.bandwidth()));
+      media::GetSegmentName(media_info_->segment_template(), segment_start_time,
+                            start_number_ - 1, media_info_->bandwidth()));
   while (segments_to_be_removed_.size() >
          mpd_options_.mpd_params.preserved_segments_outside_live_window) {
-    VLOG(2) << "Deleting " << segments_to_be_removed_.front();
-    if (!File::Delete(segments_to_be_removed_.front().c_str())) {
-      LOG(WARNING) << "Failed to delete " << segments_to_be_removed_.front()
-                   << "; Will retry later.";
-      break;
-    }
+    SegmentReaper::GetInstance()->Delete(segments_to_be_removed_.front());
     segments_to_be_removed_.pop_front();
   }
 }
 
 std::string Representation::GetVideoMimeType() const {
-  return GetMimeType("video", media_info_.container_type());
+  return GetMimeType("video", media_info_->container_type());
 }
 
 std::string Representation::GetAudioMimeType() const {
-  return GetMimeType("audio", media_info_.container_type());
+  return GetMimeType("audio", media_info_->container_type());
 }
 
 std::string Representation::GetTextMimeType() const {
-  CHECK(media_info_.has_text_info());
-  if (media_info_.text_info().codec() == "ttml") {
-    switch (media_info_.container_type()) {
+  CHECK(media_info_->has_text_info());
+  if (media_info_->text_info().codec() == "ttml") {
+    switch (media_info_->container_type()) {
       case MediaInfo::CONTAINER_TEXT:
         return "application/ttml+xml";
       case MediaInfo::CONTAINER_MP4:
         return "application/mp4";
       default:
         LOG(ERROR) << "Failed to determine MIME type for TTML container: "
-                   << media_info_.container_type();
+                   << media_info_->container_type();
         return "";
     }
   }
-  if (media_info_.text_info().codec() == "wvtt") {
-    if (media_info_.container_type() == MediaInfo::CONTAINER_TEXT) {
+  if (media_info_->text_info().codec() == "wvtt") {
+    if (media_info_->container_type() == MediaInfo::CONTAINER_TEXT) {
       return "text/vtt";
-    } else if (media_info_.container_type() == MediaInfo::CONTAINER_MP4) {
+    } else if (media_info_->container_type() == MediaInfo::CONTAINER_MP4) {
       return "application/mp4";
     }
     LOG(ERROR) << "Failed to determine MIME type for VTT container: "
-               << media_info_.container_type();
+               << media_info_->container_type();
     return "";
   }
 
   LOG(ERROR) << "Cannot determine MIME type for format: "
-             << media_info_.text_info().codec()
-             << " container: " << media_info_.container_type();
+             << media_info_->text_info().codec()
+             << " container: " << media_info_->container_type();
   return "";
 }
 
+MediaInfo* Representation::MutableMediaInfo() {
+  if (!media_info_.unique())
+    media_info_ = std::make_shared<MediaInfo>(*media_info_);
+  return media_info_.get();
+}
+
+size_t Representation::EstimateMemoryUsage() const {
+  size_t size = segment_infos_.size() * sizeof(SegmentInfo) +
+                bandwidth_estimator_.EstimateMemoryUsage();
+  for (const std::string& segment_name : segments_to_be_removed_)
+    size += sizeof(segment_name) + segment_name.capacity();
+  return size;
+}
+
 std::string Representation::RepresentationAsString() const {
   std::string s = base::StringPrintf("Representation (id=%d,", id_);
-  if (media_info_.has_video_info()) {
-    const MediaInfo_VideoInfo& video_info = media_info_.video_info();
+  if (media_info_->has_video_info()) {
+    const MediaInfo_VideoInfo& video_info = media_info_->video_info();
     base::StringAppendF(&s, "codec='%s',width=%d,height=%d",
                         video_info.codec().c_str(), video_info.width(),
                         video_info.height());
-  } else if (media_info_.has_audio_info()) {
-    const MediaInfo_AudioInfo& audio_info = media_info_.audio_info();
+  } else if (media_info_->has_audio_info()) {
+    const MediaInfo_AudioInfo& audio_info = media_info_->audio_info();
     base::StringAppendF(
         &s, "codec='%s',frequency=%d,language='%s'", audio_info.codec().c_str(),
         audio_info.sampling_frequency(), audio_info.language().c_str());
-  } else if (media_info_.has_text_info()) {
-    const MediaInfo_TextInfo& text_info = media_info_.text_info();
+  } else if (media_info_->has_text_info()) {
+    const MediaInfo_TextInfo& text_info = media_info_->text_info();
     base::StringAppendF(&s, "codec='%s',language='%s'",
                         text_info.codec().c_str(),
                         text_info.language().c_str());
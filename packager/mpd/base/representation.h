@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <list>
 #include <memory>
 
@@ -115,9 +116,14 @@ class Representation {
   /// @return MediaInfo for the Representation.
   virtual const MediaInfo& GetMediaInfo() const;
 
-  /// @return Copy of <Representation>.
+  /// @return Copy of <Representation>. It is only regenerated if the
+  ///         Representation changed since the last call.
   xml::scoped_xml_ptr<xmlNode> GetXml();
 
+  /// @return true if the Representation changed since the last call to
+  ///         GetXml().
+  bool XmlChanged() const { return !cached_xml_; }
+
   /// By calling this methods, the next time GetXml() is
   /// called, the corresponding attributes will not be set.
   /// For example, if SuppressOnce(kSuppressWidth) is called, then GetXml() will
@@ -145,7 +151,30 @@ class Representation {
   /// @return ID number for <Representation>.
   uint32_t id() const { return id_; }
 
-  void set_media_info(const MediaInfo& media_info) { media_info_ = media_info; }
+  /// @return The segments in the SegmentTimeline of this Representation.
+  const std::deque<SegmentInfo>& segment_infos() const {
+    return segment_infos_;
+  }
+
+  /// @return The approximate number of bytes allocated for the state which
+  ///         grows with the stream, e.g. the segments, not including the
+  ///         object itself.
+  size_t EstimateMemoryUsage() const;
+
+  /// Set the startNumber of the SegmentTemplate, i.e. the number of the next
+  /// segment added, e.g. to resume a live session. Must be called before any
+  /// segment is added.
+  void set_start_number(uint32_t start_number) {
+    start_number_ = start_number;
+  }
+
+  void set_media_info(MediaInfo&& media_info) {
+    // Swapped rather than moved, which is a deep copy before protobuf 3.4.
+    std::shared_ptr<MediaInfo> new_media_info(new MediaInfo);
+    new_media_info->Swap(&media_info);
+    media_info_ = std::move(new_media_info);
+    cached_xml_.reset();
+  }
 
  protected:
   /// @param media_info is a MediaInfo containing information on the media.
@@ -163,6 +192,8 @@ class Representation {
       std::unique_ptr<RepresentationStateChangeListener> state_change_listener);
 
   /// @param representation points to the original Representation to be cloned.
+  ///        The copy shares the MediaInfo of @a representation until either
+  ///        of them changes it.
   /// @param state_change_listener is an event handler for state changes to
   ///        the representation. If null, no event handler registered.
   Representation(
@@ -173,13 +204,26 @@ class Representation {
   Representation(const Representation&) = delete;
   Representation& operator=(const Representation&) = delete;
 
+  Representation(
+      std::shared_ptr<MediaInfo> media_info,
+      const MpdOptions& mpd_options,
+      uint32_t representation_id,
+      std::unique_ptr<RepresentationStateChangeListener> state_change_listener);
+
   friend class AdaptationSet;
   friend class RepresentationTest;
 
+  // Returns |media_info_| to be changed, copying it first if it is shared with
+  // the copies of this Representation in other Periods.
+  MediaInfo* MutableMediaInfo();
+
   // Returns true if |media_info_| has required fields to generate a valid
   // Representation. Otherwise returns false.
   bool HasRequiredMediaInfoFields() const;
 
+  // Generates the <Representation> element, see GetXml().
+  xml::scoped_xml_ptr<xmlNode> GenerateXml();
+
   // Add a SegmentInfo. This function may insert an adjusted SegmentInfo if
   // |allow_approximate_segment_timeline_| is set.
   void AddSegmentInfo(int64_t start_time, int64_t duration);
@@ -189,6 +233,9 @@ class Representation {
   // two times match.
   bool ApproximiatelyEqual(int64_t time1, int64_t time2) const;
 
+  // The largest difference, in timescale, of two approximately equal times.
+  int64_t GetErrorThreshold() const;
+
   // Return adjusted duration if |allow_aproximate_segment_timeline_or_duration|
   // is set; otherwise duration is returned without adjustment.
   int64_t AdjustDuration(int64_t duration) const;
@@ -210,13 +257,17 @@ class Representation {
   std::string RepresentationAsString() const;
 
   // Init() checks that only one of VideoInfo, AudioInfo, or TextInfo is set. So
-  // any logic using this can assume only one set.
-  MediaInfo media_info_;
+  // any logic using this can assume only one set. Copied on write, see
+  // MutableMediaInfo().
+  std::shared_ptr<MediaInfo> media_info_;
   std::list<ContentProtectionElement> content_protection_elements_;
 
   int64_t current_buffer_depth_ = 0;
+  // The segments, run-length encoded. A deque so that new segments are
+  // appended and the segments out of the live window are removed in constant
+  // time, without an allocation per entry.
   // TODO(kqyang): Address sliding window issue with multiple periods.
-  std::list<SegmentInfo> segment_infos_;
+  std::deque<SegmentInfo> segment_infos_;
   // A list to hold the file names of the segments to be removed temporarily.
   // Once a file is actually removed, it is removed from the list.
   std::list<std::string> segments_to_be_removed_;
@@ -238,6 +289,11 @@ class Representation {
   // Bit vector for tracking witch attributes should not be output.
   int output_suppression_flags_ = 0;
 
+  // The element generated by the last call to GetXml(), with the suppression
+  // flags it was generated with. Reset whenever the Representation changes.
+  xml::scoped_xml_ptr<xmlNode> cached_xml_;
+  int cached_xml_suppression_flags_ = 0;
+
   // When set to true, allows segments to have slightly different durations (up
   // to one sample).
   const bool allow_approximate_segment_timeline_ = false;
@@ -14,6 +14,7 @@
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/file/segment_reaper.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/test/mpd_builder_test_helper.h"
 #include "packager/mpd/test/xml_compare.h"
@@ -1241,6 +1242,76 @@ INSTANTIATE_TEST_CASE_P(InitialStartTime,
                         TimeShiftBufferDepthTest,
                         Values(0, 1000));
 
+class ConstantSegmentDurationTest : public SegmentTimelineTestBase {
+ public:
+  void SetUp() override {
+    mpd_options_.mpd_params.segment_template_constant_duration = true;
+    // Five segments.
+    mpd_options_.mpd_params.time_shift_buffer_depth =
+        5 * kTargetSegmentDurationInSeconds;
+    SegmentTimelineTestBase::SetUp();
+    representation_->SetSampleDuration(kSampleDuration);
+  }
+
+  std::string ExpectedDurationXml(int expected_start_number) {
+    const char kOutputTemplate[] =
+        "<Representation id=\"1\" bandwidth=\"%" PRIu64
+        "\" "
+        " codecs=\"avc1.010101\" mimeType=\"video/mp4\" sar=\"1:1\" "
+        " width=\"720\" height=\"480\" frameRate=\"10/2\">\n"
+        "  <SegmentTemplate timescale=\"1000\" "
+        "   initialization=\"init.mp4\" media=\"$Number$.mp4\" "
+        "   startNumber=\"%d\" duration=\"%" PRId64 "\"/>\n"
+        "</Representation>\n";
+    return base::StringPrintf(kOutputTemplate, bandwidth_estimator_.Max(),
+                              expected_start_number,
+                              kScaledTargetSegmentDuration);
+  }
+};
+
+// The durations of the segments vary by less than a sample, and the window
+// slides. The segments are still addressed from the start of the period.
+TEST_F(ConstantSegmentDurationTest, RegularCadence) {
+  const uint64_t kSize = 128;
+  const int kNumSegments = 20;
+  int64_t start_time = 0;
+  for (int i = 0; i < kNumSegments; ++i) {
+    const int64_t duration = kScaledTargetSegmentDuration + (i % 2 ? 1 : -1);
+    AddSegments(start_time, duration, kSize, 0);
+    start_time += duration;
+  }
+  EXPECT_THAT(representation_->GetXml().get(),
+              XmlNodeEqual(ExpectedDurationXml(kDefaultStartNumber)));
+}
+
+TEST_F(ConstantSegmentDurationTest, BrokenCadence) {
+  const uint64_t kSize = 128;
+  const int kNumSegments = 20;
+  AddSegments(0, kScaledTargetSegmentDuration, kSize, kNumSegments - 1);
+  const int64_t kLongDuration = 3 * kScaledTargetSegmentDuration;
+  const int64_t long_segment_start_time =
+      kNumSegments * kScaledTargetSegmentDuration;
+  AddSegments(long_segment_start_time, kLongDuration, kSize, 0);
+  AddSegments(long_segment_start_time + kLongDuration,
+              kScaledTargetSegmentDuration, kSize, 0);
+
+  // Back to a SegmentTimeline while the long segment is in the window, which
+  // keeps the last five segments worth of duration.
+  const int kExpectedStartNumber = kNumSegments;
+  const std::string expected_s_elements =
+      base::StringPrintf(kSElementTemplateWithoutR,
+                         long_segment_start_time - kScaledTargetSegmentDuration,
+                         kScaledTargetSegmentDuration) +
+      base::StringPrintf(kSElementTemplateWithoutR, long_segment_start_time,
+                         kLongDuration) +
+      base::StringPrintf(kSElementTemplateWithoutR,
+                         long_segment_start_time + kLongDuration,
+                         kScaledTargetSegmentDuration);
+  EXPECT_THAT(
+      representation_->GetXml().get(),
+      XmlNodeEqual(ExpectedXml(expected_s_elements, kExpectedStartNumber)));
+}
+
 namespace {
 const int kTimeShiftBufferDepth = 2;
 const int kNumPreservedSegmentsOutsideLiveWindow = 3;
@@ -1281,6 +1352,8 @@ class RepresentationDeleteSegmentsTest : public SegmentTimelineTestBase {
   }
 
   bool SegmentDeleted(const std::string& segment_name) {
+    // The segments are deleted in the background.
+    SegmentReaper::GetInstance()->Flush();
     std::unique_ptr<File, FileCloser> file_closer(
         File::Open(segment_name.c_str(), "r"));
     return file_closer.get() == nullptr;
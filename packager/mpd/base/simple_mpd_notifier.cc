@@ -8,6 +8,9 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/stl_util.h"
+#include "packager/file/file.h"
+#include "packager/metrics/metrics.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/mpd/base/adaptation_set.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/mpd_notifier_util.h"
@@ -17,17 +20,46 @@
 
 namespace shaka {
 
+namespace {
+// The maximum time a flush request of a dynamic MPD waits for the other
+// Representations to report their segments.
+const int64_t kMaxFlushDelayInMs = 500;
+}  // namespace
+
 SimpleMpdNotifier::SimpleMpdNotifier(const MpdOptions& mpd_options)
     : MpdNotifier(mpd_options),
       output_path_(mpd_options.mpd_params.mpd_output),
+      patch_output_path_(mpd_options.mpd_params.mpd_patch_output),
       mpd_builder_(new MpdBuilder(mpd_options)),
       content_protection_in_adaptation_set_(
-          mpd_options.mpd_params.generate_dash_if_iop_compliant_mpd) {
+          mpd_options.mpd_params.generate_dash_if_iop_compliant_mpd),
+      file_writer_("dash"),
+      flush_requested_(&lock_) {
   for (const std::string& base_url : mpd_options.mpd_params.base_urls)
     mpd_builder_->AddBaseUrl(base_url);
+  file_writer_.set_write_gzip_copies(mpd_options.mpd_params.gzip_manifests);
+
+  metrics_collector_id_ =
+      Metrics::GetInstance()->AddCollector([this](Metrics::Writer* writer) {
+        base::AutoLock auto_lock(lock_);
+        writer->Add("packager_manifest_state_bytes", Metrics::Type::kGauge,
+                    "Approximate memory used by the state of the manifests "
+                    "which grows with the streams.",
+                    {{"format", "dash"}, {"manifest", output_path_}},
+                    static_cast<double>(mpd_builder_->EstimateMemoryUsage()));
+      });
 }
 
-SimpleMpdNotifier::~SimpleMpdNotifier() {}
+SimpleMpdNotifier::~SimpleMpdNotifier() {
+  Metrics::GetInstance()->RemoveCollector(metrics_collector_id_);
+  {
+    base::AutoLock auto_lock(lock_);
+    shutting_down_ = true;
+    flush_requested_.Signal();
+  }
+  if (flush_thread_)
+    flush_thread_->Join();
+}
 
 bool SimpleMpdNotifier::Init() {
   return true;
@@ -59,14 +91,13 @@ bool SimpleMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
     return false;
 
   *container_id = representation->id();
-  if (content_protection_in_adaptation_set_) {
-    // ContentProtection elements are already added to AdaptationSet above.
-    // Use RepresentationId to AdaptationSet map to update ContentProtection
-    // in AdaptationSet in NotifyEncryptionUpdate.
-    representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
-  } else {
+  // ContentProtection elements are already added to AdaptationSet above if
+  // |content_protection_in_adaptation_set_|. Use RepresentationId to
+  // AdaptationSet map to update ContentProtection in AdaptationSet in
+  // NotifyEncryptionUpdate.
+  representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
+  if (!content_protection_in_adaptation_set_)
     AddContentProtectionElements(media_info, representation);
-  }
   representation_map_[representation->id()] = representation;
   return true;
 }
@@ -94,6 +125,8 @@ bool SimpleMpdNotifier::NotifyNewSegment(uint32_t container_id,
     return false;
   }
   it->second->AddNewSegment(start_time, duration, size);
+  segmented_representations_.insert(container_id);
+  updated_representations_.insert(container_id);
   return true;
 }
 
@@ -129,14 +162,12 @@ bool SimpleMpdNotifier::NotifyCueEvent(uint32_t container_id,
   if (!representation)
     return false;
 
-  if (content_protection_in_adaptation_set_) {
-    // ContentProtection elements are already added to AdaptationSet above.
-    // Use RepresentationId to AdaptationSet map to update ContentProtection
-    // in AdaptationSet in NotifyEncryptionUpdate.
-    representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
-  } else {
+  // The Representation and AdaptationSet in the previous Period are no longer
+  // updated, which lets MpdBuilder remove the Period once it is out of the
+  // time shift buffer.
+  representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
+  if (!content_protection_in_adaptation_set_)
     AddContentProtectionElements(media_info, representation);
-  }
   representation_map_[representation->id()] = representation;
   return true;
 }
@@ -177,13 +208,125 @@ bool SimpleMpdNotifier::NotifyMediaInfoUpdate(uint32_t container_id,
   MediaInfo adjusted_media_info(media_info);
   MpdBuilder::MakePathsRelativeToMpd(output_path_, &adjusted_media_info);
 
-  it->second->set_media_info(adjusted_media_info);
+  it->second->set_media_info(std::move(adjusted_media_info));
+  return true;
+}
+
+bool SimpleMpdNotifier::SetStartNumber(uint32_t container_id,
+                                       uint32_t start_number) {
+  base::AutoLock auto_lock(lock_);
+  auto it = representation_map_.find(container_id);
+  if (it == representation_map_.end()) {
+    LOG(ERROR) << "Unexpected container_id: " << container_id;
+    return false;
+  }
+  it->second->set_start_number(start_number);
+  return true;
+}
+
+bool SimpleMpdNotifier::RemoveContainer(const std::string& segment_template) {
+  base::AutoLock auto_lock(lock_);
+  bool removed = false;
+  for (auto it = representation_map_.begin();
+       it != representation_map_.end();) {
+    const uint32_t container_id = it->first;
+    if (it->second->GetMediaInfo().segment_template() != segment_template) {
+      ++it;
+      continue;
+    }
+    representation_id_to_adaptation_set_[container_id]->RemoveRepresentation(
+        container_id);
+    representation_id_to_adaptation_set_.erase(container_id);
+    segmented_representations_.erase(container_id);
+    updated_representations_.erase(container_id);
+    it = representation_map_.erase(it);
+    removed = true;
+  }
+  if (!removed) {
+    LOG(ERROR) << "No container with segment template " << segment_template;
+    return false;
+  }
+  return true;
+}
+
+bool SimpleMpdNotifier::GetAvailabilityStartTime(
+    std::string* availability_start_time) {
+  base::AutoLock auto_lock(lock_);
+  *availability_start_time = mpd_builder_->availability_start_time();
+  return !availability_start_time->empty();
+}
+
+bool SimpleMpdNotifier::SetAvailabilityStartTime(
+    const std::string& availability_start_time) {
+  base::AutoLock auto_lock(lock_);
+  mpd_builder_->set_availability_start_time(availability_start_time);
   return true;
 }
 
 bool SimpleMpdNotifier::Flush() {
   base::AutoLock auto_lock(lock_);
-  return WriteMpdToFile(output_path_, mpd_builder_.get());
+  return WriteMpd();
+}
+
+bool SimpleMpdNotifier::RequestFlush() {
+  if (mpd_type() != MpdType::kDynamic)
+    return Flush();
+
+  base::AutoLock auto_lock(lock_);
+  if (!flush_thread_) {
+    flush_thread_.reset(new base::DelegateSimpleThread(this, "MpdFlush"));
+    flush_thread_->Start();
+  }
+  const base::TimeTicks now = base::TimeTicks::Now();
+  if (updated_representations_.size() >= segmented_representations_.size()) {
+    // Every Representation has reported, so there is no reason to wait.
+    flush_deadline_ = now;
+    flush_requested_.Signal();
+  } else if (flush_deadline_.is_null()) {
+    flush_deadline_ =
+        now + base::TimeDelta::FromMilliseconds(kMaxFlushDelayInMs);
+    flush_requested_.Signal();
+  }
+  return true;
+}
+
+void SimpleMpdNotifier::Run() {
+  base::AutoLock auto_lock(lock_);
+  while (true) {
+    if (shutting_down_) {
+      if (!flush_deadline_.is_null())
+        WriteMpd();
+      return;
+    }
+    if (flush_deadline_.is_null()) {
+      flush_requested_.Wait();
+      continue;
+    }
+    const base::TimeTicks now = base::TimeTicks::Now();
+    if (now < flush_deadline_) {
+      flush_requested_.TimedWait(flush_deadline_ - now);
+      continue;
+    }
+    // The failures are logged by WriteMpdToFile(), and the next write
+    // retries.
+    WriteMpd();
+  }
+}
+
+bool SimpleMpdNotifier::WriteMpd() {
+  lock_.AssertAcquired();
+  updated_representations_.clear();
+  flush_deadline_ = base::TimeTicks();
+  mpd_memory_.Set(mpd_builder_->EstimateMemoryUsage());
+
+  ScopedMetricsTimer metrics_timer("packager_manifest_write_seconds",
+                                   "Latency of the manifest writes.",
+                                   {{"format", "dash"}});
+  ScopedTraceEvent trace_event("SimpleMpdNotifier::Flush", "manifest");
+  // The MPD and its patch share the directory syncs.
+  AtomicWriteBatch write_batch;
+  return WriteMpdToFile(output_path_, patch_output_path_, mpd_builder_.get(),
+                        &file_writer_);
 }
 
 }  // namespace shaka
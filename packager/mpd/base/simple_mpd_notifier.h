@@ -9,10 +9,16 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
+#include "packager/base/synchronization/condition_variable.h"
 #include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/base/time/time.h"
+#include "packager/metrics/memory_budget.h"
+#include "packager/mpd/base/manifest_file_writer.h"
 #include "packager/mpd/base/mpd_notifier.h"
 #include "packager/mpd/base/mpd_notifier_util.h"
 
@@ -26,7 +32,12 @@ struct MpdOptions;
 
 /// A simple MpdNotifier implementation which receives muxer listener event and
 /// generates an Mpd file.
-class SimpleMpdNotifier : public MpdNotifier {
+/// For dynamic MPDs, the flushes requested with RequestFlush() are coalesced:
+/// the MPD is written on a background thread once every segmented
+/// Representation has reported a new segment, or after a short delay
+/// otherwise.
+class SimpleMpdNotifier : public MpdNotifier,
+                          public base::DelegateSimpleThread::Delegate {
  public:
   explicit SimpleMpdNotifier(const MpdOptions& mpd_options);
   ~SimpleMpdNotifier() override;
@@ -49,7 +60,13 @@ class SimpleMpdNotifier : public MpdNotifier {
                               const std::vector<uint8_t>& new_pssh) override;
   bool NotifyMediaInfoUpdate(uint32_t container_id,
                              const MediaInfo& media_info) override;
+  bool SetStartNumber(uint32_t container_id, uint32_t start_number) override;
+  bool RemoveContainer(const std::string& segment_template) override;
+  bool GetAvailabilityStartTime(std::string* availability_start_time) override;
+  bool SetAvailabilityStartTime(
+      const std::string& availability_start_time) override;
   bool Flush() override;
+  bool RequestFlush() override;
   /// @}
 
  private:
@@ -66,17 +83,46 @@ class SimpleMpdNotifier : public MpdNotifier {
     mpd_builder_ = std::move(mpd_builder);
   }
 
-  // MPD output path.
+  // base::DelegateSimpleThread::Delegate implementation, which writes the MPD
+  // for the pending flush requests until the notifier is destroyed.
+  void Run() override;
+
+  // Writes the MPD and clears the pending flush requests. |lock_| must be
+  // held.
+  bool WriteMpd();
+
+  // MPD and MPD Patch output paths.
   std::string output_path_;
+  std::string patch_output_path_;
   std::unique_ptr<MpdBuilder> mpd_builder_;
   bool content_protection_in_adaptation_set_ = true;
   base::Lock lock_;
+  ManifestFileWriter file_writer_;
+  // The memory of |mpd_builder_|, updated as the MPD is written.
+  MemoryUsage mpd_memory_{MemoryBudget::kManifestState};
 
   uint32_t next_adaptation_set_id_ = 0;
   // Maps Representation ID to Representation.
   std::map<uint32_t, Representation*> representation_map_;
   // Maps Representation ID to AdaptationSet. This is for updating the PSSH.
   std::map<uint32_t, AdaptationSet*> representation_id_to_adaptation_set_;
+
+  // Signaled when the MPD should be written without waiting for the deadline,
+  // or on destruction.
+  base::ConditionVariable flush_requested_;
+  // The Representations with segments, e.g. excluding the text files which are
+  // not segmented.
+  std::set<uint32_t> segmented_representations_;
+  // The Representations with new segments since the last write.
+  std::set<uint32_t> updated_representations_;
+  // The time by which the MPD is written, or null if no flush is pending.
+  base::TimeTicks flush_deadline_;
+  bool shutting_down_ = false;
+  // Started by the first RequestFlush().
+  std::unique_ptr<base::DelegateSimpleThread> flush_thread_;
+
+  // Reports the memory used by the MPD to the metrics.
+  int metrics_collector_id_ = 0;
 };
 
 }  // namespace shaka
@@ -383,4 +383,94 @@ TEST_F(SimpleMpdNotifierTest, MultipleMediaInfo) {
       notifier.NotifyNewContainer(valid_media_info3_, &unused_container_id));
 }
 
+// Verify that the flushes requested for a dynamic MPD are coalesced until
+// every Representation has reported a new segment.
+TEST_F(SimpleMpdNotifierTest, RemoveContainer) {
+  empty_mpd_option_.mpd_type = MpdType::kDynamic;
+  std::unique_ptr<MockMpdBuilder> mock_mpd_builder(new MockMpdBuilder());
+  std::unique_ptr<MockRepresentation> representation1(
+      new MockRepresentation(1));
+  std::unique_ptr<MockRepresentation> representation2(
+      new MockRepresentation(2));
+  MediaInfo media_info1 = valid_media_info1_;
+  media_info1.set_segment_template("video1-$Number$.m4s");
+  MediaInfo media_info2 = valid_media_info2_;
+  media_info2.set_segment_template("video2-$Number$.m4s");
+
+  EXPECT_CALL(*mock_mpd_builder, GetOrCreatePeriod(_))
+      .WillRepeatedly(Return(default_mock_period_.get()));
+  EXPECT_CALL(*default_mock_period_, GetOrCreateAdaptationSet(_, _))
+      .WillRepeatedly(Return(default_mock_adaptation_set_.get()));
+  EXPECT_CALL(*default_mock_adaptation_set_, AddRepresentation(_))
+      .WillOnce(Return(representation1.get()))
+      .WillOnce(Return(representation2.get()));
+  EXPECT_CALL(*representation1, GetMediaInfo())
+      .WillRepeatedly(ReturnRef(media_info1));
+  EXPECT_CALL(*representation2, GetMediaInfo())
+      .WillRepeatedly(ReturnRef(media_info2));
+  EXPECT_CALL(*default_mock_adaptation_set_, RemoveRepresentation(1));
+
+  SimpleMpdNotifier notifier(empty_mpd_option_);
+  SetMpdBuilder(&notifier, std::move(mock_mpd_builder));
+  uint32_t container_id1;
+  uint32_t container_id2;
+  EXPECT_TRUE(notifier.NotifyNewContainer(media_info1, &container_id1));
+  EXPECT_TRUE(notifier.NotifyNewContainer(media_info2, &container_id2));
+
+  EXPECT_TRUE(notifier.RemoveContainer("video1-$Number$.m4s"));
+  // The removed container cannot be notified anymore.
+  EXPECT_FALSE(notifier.NotifyNewSegment(container_id1, 0, 100, 123456));
+  EXPECT_FALSE(notifier.RemoveContainer("video1-$Number$.m4s"));
+}
+
+TEST_F(SimpleMpdNotifierTest, RequestFlushDynamic) {
+  empty_mpd_option_.mpd_type = MpdType::kDynamic;
+  std::unique_ptr<MockMpdBuilder> mock_mpd_builder(new MockMpdBuilder());
+  std::unique_ptr<MockRepresentation> representation1(
+      new MockRepresentation(1));
+  std::unique_ptr<MockRepresentation> representation2(
+      new MockRepresentation(2));
+
+  EXPECT_CALL(*mock_mpd_builder, GetOrCreatePeriod(_))
+      .WillRepeatedly(Return(default_mock_period_.get()));
+  EXPECT_CALL(*default_mock_period_, GetOrCreateAdaptationSet(_, _))
+      .WillRepeatedly(Return(default_mock_adaptation_set_.get()));
+  EXPECT_CALL(*default_mock_adaptation_set_, AddRepresentation(_))
+      .WillOnce(Return(representation1.get()))
+      .WillOnce(Return(representation2.get()));
+  EXPECT_CALL(*representation1, AddNewSegment(_, _, _)).Times(2);
+  EXPECT_CALL(*representation2, AddNewSegment(_, _, _)).Times(2);
+  // Once for Flush() and once for the two RequestFlush() calls.
+  EXPECT_CALL(*mock_mpd_builder, ToString(_))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+
+  {
+    SimpleMpdNotifier notifier(empty_mpd_option_);
+    SetMpdBuilder(&notifier, std::move(mock_mpd_builder));
+    uint32_t container_id1;
+    uint32_t container_id2;
+    EXPECT_TRUE(
+        notifier.NotifyNewContainer(valid_media_info1_, &container_id1));
+    EXPECT_TRUE(
+        notifier.NotifyNewContainer(valid_media_info2_, &container_id2));
+
+    const uint64_t kSegmentDuration = 100u;
+    const uint64_t kSegmentSize = 123456u;
+    EXPECT_TRUE(notifier.NotifyNewSegment(container_id1, 0, kSegmentDuration,
+                                          kSegmentSize));
+    EXPECT_TRUE(notifier.NotifyNewSegment(container_id2, 0, kSegmentDuration,
+                                          kSegmentSize));
+    EXPECT_TRUE(notifier.Flush());
+
+    EXPECT_TRUE(notifier.NotifyNewSegment(container_id1, kSegmentDuration,
+                                          kSegmentDuration, kSegmentSize));
+    EXPECT_TRUE(notifier.RequestFlush());
+    EXPECT_TRUE(notifier.NotifyNewSegment(container_id2, kSegmentDuration,
+                                          kSegmentDuration, kSegmentSize));
+    EXPECT_TRUE(notifier.RequestFlush());
+    // The notifier joins the flushing thread on destruction.
+  }
+}
+
 }  // namespace shaka
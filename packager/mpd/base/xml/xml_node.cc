@@ -7,7 +7,10 @@
 #include "packager/mpd/base/xml/xml_node.h"
 
 #include <gflags/gflags.h>
+#include <libxml/parserInternals.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <limits>
 #include <set>
 
@@ -19,11 +22,6 @@
 #include "packager/mpd/base/mpd_utils.h"
 #include "packager/mpd/base/segment_info.h"
 
-DEFINE_bool(segment_template_constant_duration,
-            false,
-            "Generates SegmentTemplate@duration if all segments except the "
-            "last one has the same duration if this flag is set to true.");
-
 DEFINE_bool(dash_add_last_segment_number_when_needed,
             false,
             "Adds a Supplemental Descriptor with @schemeIdUri "
@@ -46,19 +44,37 @@ std::string RangeToString(const Range& range) {
 }
 
 // Check if segments are continuous and all segments except the last one are of
-// the same duration.
-bool IsTimelineConstantDuration(const std::list<SegmentInfo>& segment_infos,
-                                uint32_t start_number) {
-  if (!FLAGS_segment_template_constant_duration)
-    return false;
-
+// the same duration, and if the numbers of the segments match their start
+// times, within |tolerance|, i.e. a segment starting k durations after
+// |presentation_time_offset| has the number of the first segment plus k. Sets
+// |period_start_number| to the number of the segment starting at
+// |presentation_time_offset|.
+bool IsTimelineConstantDuration(const std::deque<SegmentInfo>& segment_infos,
+                                uint32_t start_number,
+                                uint64_t presentation_time_offset,
+                                int64_t tolerance,
+                                uint32_t* period_start_number) {
   DCHECK(!segment_infos.empty());
   if (segment_infos.size() > 2)
     return false;
 
   const SegmentInfo& first_segment = segment_infos.front();
-  if (first_segment.start_time != first_segment.duration * (start_number - 1))
+  if (first_segment.duration <= 0)
     return false;
+  const int64_t start_time =
+      first_segment.start_time - static_cast<int64_t>(presentation_time_offset);
+  if (start_time < -tolerance)
+    return false;
+  const int64_t num_earlier_segments =
+      (std::max<int64_t>(start_time, 0) + first_segment.duration / 2) /
+      first_segment.duration;
+  if (std::abs(start_time - num_earlier_segments * first_segment.duration) >
+          tolerance ||
+      num_earlier_segments >= start_number) {
+    return false;
+  }
+  *period_start_number =
+      start_number - static_cast<uint32_t>(num_earlier_segments);
 
   if (segment_infos.size() == 1)
     return true;
@@ -73,18 +89,33 @@ bool IsTimelineConstantDuration(const std::list<SegmentInfo>& segment_infos,
   return expected_last_segment_start_time == last_segment.start_time;
 }
 
-bool PopulateSegmentTimeline(const std::list<SegmentInfo>& segment_infos,
+// The S elements are serialized directly, instead of creating a node and two or
+// three attributes per segment, which dominates the generation of live MPDs
+// with long timelines. The indentation is the same as libxml2's, with the
+// SegmentTimeline at MPD/Period/AdaptationSet/Representation/SegmentTemplate.
+bool PopulateSegmentTimeline(const std::deque<SegmentInfo>& segment_infos,
                              XmlNode* segment_timeline) {
-  for (const SegmentInfo& segment_info : segment_infos) {
-    XmlNode s_element("S");
-    s_element.SetIntegerAttribute("t", segment_info.start_time);
-    s_element.SetIntegerAttribute("d", segment_info.duration);
-    if (segment_info.repeat > 0)
-      s_element.SetIntegerAttribute("r", segment_info.repeat);
+  const size_t kSegmentTimelineIndent = 10;
+  const size_t kSIndent = kSegmentTimelineIndent + 2;
 
-    CHECK(segment_timeline->AddChild(s_element.PassScopedPtr()));
+  std::string content = "\n";
+  // About 30 characters per S element.
+  content.reserve(segment_infos.size() * (kSIndent + 30) +
+                  kSegmentTimelineIndent);
+  for (const SegmentInfo& segment_info : segment_infos) {
+    content.append(kSIndent, ' ');
+    content += "<S t=\"";
+    content += base::Uint64ToString(segment_info.start_time);
+    content += "\" d=\"";
+    content += base::Uint64ToString(segment_info.duration);
+    if (segment_info.repeat > 0) {
+      content += "\" r=\"";
+      content += base::Uint64ToString(segment_info.repeat);
+    }
+    content += "\"/>\n";
   }
-
+  content.append(kSegmentTimelineIndent, ' ');
+  segment_timeline->SetRawContent(content);
   return true;
 }
 
@@ -197,6 +228,14 @@ void XmlNode::SetId(uint32_t id) {
   SetIntegerAttribute("id", id);
 }
 
+void XmlNode::SetRawContent(const std::string& content) {
+  DCHECK(node_);
+  xmlNodePtr text = xmlNewTextLen(BAD_CAST content.data(), content.size());
+  // libxml2 writes the text nodes with this name without escaping.
+  text->name = xmlStringTextNoenc;
+  xmlAddChild(node_.get(), text);
+}
+
 void XmlNode::SetContent(const std::string& content) {
   DCHECK(node_);
   xmlNodeSetContent(node_.get(), BAD_CAST content.c_str());
@@ -406,8 +445,10 @@ bool RepresentationXmlNode::AddVODOnlyInfo(const MediaInfo& media_info) {
 
 bool RepresentationXmlNode::AddLiveOnlyInfo(
     const MediaInfo& media_info,
-    const std::list<SegmentInfo>& segment_infos,
-    uint32_t start_number) {
+    const std::deque<SegmentInfo>& segment_infos,
+    uint32_t start_number,
+    bool segment_template_constant_duration,
+    int64_t tolerance) {
   XmlNode segment_template("SegmentTemplate");
   if (media_info.has_reference_time_scale()) {
     segment_template.SetIntegerAttribute("timescale",
@@ -424,16 +465,25 @@ bool RepresentationXmlNode::AddLiveOnlyInfo(
                                         media_info.init_segment_url());
   }
 
+  // Don't use SegmentTimeline if all segments except the last one are of the
+  // same duration. The segments are then addressed from the start of the
+  // period, instead of from the first segment listed.
+  uint32_t period_start_number = start_number;
+  const bool constant_duration =
+      segment_template_constant_duration && !segment_infos.empty() &&
+      IsTimelineConstantDuration(segment_infos, start_number,
+                                 media_info.presentation_time_offset(),
+                                 tolerance, &period_start_number);
+
   if (media_info.has_segment_template_url()) {
     segment_template.SetStringAttribute("media",
                                         media_info.segment_template_url());
-    segment_template.SetIntegerAttribute("startNumber", start_number);
+    segment_template.SetIntegerAttribute(
+        "startNumber", constant_duration ? period_start_number : start_number);
   }
 
   if (!segment_infos.empty()) {
-    // Don't use SegmentTimeline if all segments except the last one are of
-    // the same duration.
-    if (IsTimelineConstantDuration(segment_infos, start_number)) {
+    if (constant_duration) {
       segment_template.SetIntegerAttribute("duration",
                                            segment_infos.front().duration);
       if (FLAGS_dash_add_last_segment_number_when_needed) {
@@ -13,6 +13,7 @@
 #include <libxml/tree.h>
 #include <stdint.h>
 
+#include <deque>
 #include <list>
 #include <set>
 
@@ -74,6 +75,12 @@ class XmlNode {
   ///        be added to the element.
   void SetContent(const std::string& content);
 
+  /// Set the contents of an XML element to serialized XML, which is written
+  /// as is. Unlike child elements, it does not create a node per element.
+  /// @param content is the serialized XML, including the whitespaces needed
+  ///        to format it like the rest of the document.
+  void SetRawContent(const std::string& content);
+
   /// @return namespaces used in the node and its descendents.
   std::set<std::string> ExtractReferencedNamespaces();
 
@@ -184,9 +191,18 @@ class RepresentationXmlNode : public RepresentationBaseXmlNode {
 
   /// @param segment_infos is a set of SegmentInfos. This method assumes that
   ///        SegmentInfos are sorted by its start time.
+  /// @param start_number is the number of the first segment.
+  /// @param segment_template_constant_duration generates
+  ///        SegmentTemplate@duration instead of a SegmentTimeline if all the
+  ///        segments except the last one have the same duration, and if the
+  ///        segment numbers match their start times.
+  /// @param tolerance is how far, in timescale, the start times may be from
+  ///        the segment numbers.
   bool AddLiveOnlyInfo(const MediaInfo& media_info,
-                       const std::list<SegmentInfo>& segment_infos,
-                       uint32_t start_number);
+                       const std::deque<SegmentInfo>& segment_infos,
+                       uint32_t start_number,
+                       bool segment_template_constant_duration,
+                       int64_t tolerance);
 
  private:
   // Add AudioChannelConfiguration element. Note that it is a required element
@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 #include <libxml/tree.h>
 
+#include <deque>
 #include <list>
 
 #include "packager/base/logging.h"
@@ -17,7 +18,6 @@
 #include "packager/mpd/base/xml/xml_node.h"
 #include "packager/mpd/test/xml_compare.h"
 
-DECLARE_bool(segment_template_constant_duration);
 DECLARE_bool(dash_add_last_segment_number_when_needed);
 
 using ::testing::ElementsAre;
@@ -354,15 +354,15 @@ TEST(XmlNodeTest, AddAC4AudioInfoMPEGSchemeIMS) {
       "</Representation>\n"));
 }
 
+const bool kConstantDuration = true;
+const int64_t kNoTolerance = 0;
+
 class LiveSegmentTimelineTest : public ::testing::Test {
  protected:
   void SetUp() override {
-    FLAGS_segment_template_constant_duration = true;
     media_info_.set_segment_template_url("$Number$.m4s");
   }
 
-  void TearDown() override { FLAGS_segment_template_constant_duration = false; }
-
   MediaInfo media_info_;
 };
 
@@ -372,12 +372,13 @@ TEST_F(LiveSegmentTimelineTest, OneSegmentInfo) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
   ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber,
+                                     kConstantDuration, kNoTolerance));
 
   EXPECT_THAT(
       representation.GetRawPtr(),
@@ -393,12 +394,13 @@ TEST_F(LiveSegmentTimelineTest, OneSegmentInfoNonZeroStartTime) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kNonZeroStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
   ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber,
+                                     kConstantDuration, kNoTolerance));
 
   EXPECT_THAT(representation.GetRawPtr(),
               XmlNodeEqual(
@@ -417,18 +419,43 @@ TEST_F(LiveSegmentTimelineTest, OneSegmentInfoMatchingStartTimeAndNumber) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kNonZeroStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
   ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber,
+                                     kConstantDuration, kNoTolerance));
+
+  // The segments are numbered from the start of the period.
+  EXPECT_THAT(
+      representation.GetRawPtr(),
+      XmlNodeEqual("<Representation>"
+                   "  <SegmentTemplate media=\"$Number$.m4s\" "
+                   "                   startNumber=\"1\" duration=\"100\"/>"
+                   "</Representation>"));
+}
+
+TEST_F(LiveSegmentTimelineTest, StartTimeWithinTolerance) {
+  const uint32_t kStartNumber = 6;
+  const uint64_t kApproximateStartTime = 498;
+  const uint64_t kDuration = 100;
+  const uint64_t kRepeat = 9;
+  const int64_t kTolerance = 2;
+
+  std::deque<SegmentInfo> segment_infos = {
+      {kApproximateStartTime, kDuration, kRepeat},
+  };
+  RepresentationXmlNode representation;
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(media_info_, segment_infos,
+                                             kStartNumber, kConstantDuration,
+                                             kTolerance));
 
   EXPECT_THAT(
       representation.GetRawPtr(),
       XmlNodeEqual("<Representation>"
                    "  <SegmentTemplate media=\"$Number$.m4s\" "
-                   "                   startNumber=\"6\" duration=\"100\"/>"
+                   "                   startNumber=\"1\" duration=\"100\"/>"
                    "</Representation>"));
 }
 
@@ -443,13 +470,14 @@ TEST_F(LiveSegmentTimelineTest, AllSegmentsSameDurationExpectLastOne) {
   const uint64_t kDuration2 = 200;
   const uint64_t kRepeat2 = 0;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime1, kDuration1, kRepeat1},
       {kStartTime2, kDuration2, kRepeat2},
   };
   RepresentationXmlNode representation;
   ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber,
+                                     kConstantDuration, kNoTolerance));
 
   EXPECT_THAT(
       representation.GetRawPtr(),
@@ -470,13 +498,14 @@ TEST_F(LiveSegmentTimelineTest, SecondSegmentInfoNonZeroRepeat) {
   const uint64_t kDuration2 = 200;
   const uint64_t kRepeat2 = 1;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime1, kDuration1, kRepeat1},
       {kStartTime2, kDuration2, kRepeat2},
   };
   RepresentationXmlNode representation;
   ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber,
+                                     kConstantDuration, kNoTolerance));
 
   EXPECT_THAT(representation.GetRawPtr(),
               XmlNodeEqual(
@@ -502,13 +531,14 @@ TEST_F(LiveSegmentTimelineTest, TwoSegmentInfoWithGap) {
   const uint64_t kDuration2 = 200;
   const uint64_t kRepeat2 = 0;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime1, kDuration1, kRepeat1},
       {kStartTime2, kDuration2, kRepeat2},
   };
   RepresentationXmlNode representation;
   ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber,
+                                     kConstantDuration, kNoTolerance));
 
   EXPECT_THAT(representation.GetRawPtr(),
               XmlNodeEqual(
@@ -528,14 +558,15 @@ TEST_F(LiveSegmentTimelineTest, LastSegmentNumberSupplementalProperty) {
   const uint64_t kDuration = 100;                                               
   const uint64_t kRepeat = 9;                                                   
                                                                                 
-  std::list<SegmentInfo> segment_infos = {                                      
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime, kDuration, kRepeat},                                         
   };                                                                            
   RepresentationXmlNode representation;                                         
   FLAGS_dash_add_last_segment_number_when_needed = true;                       
                                                                                 
   ASSERT_TRUE(                                                                  
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber,
+                                     kConstantDuration, kNoTolerance));
                                                                                 
   EXPECT_THAT(                                                                  
       representation.GetRawPtr(),                                               
@@ -23,6 +23,21 @@
       },
       'includes': ['../protoc.gypi'],
     },
+    {
+      'target_name': 'media_info_file',
+      'type': 'static_library',
+      'sources': [
+        'base/media_info_file.cc',
+        'base/media_info_file.h',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../file/file.gyp:file',
+        # Depends on full protobuf to read/write with TextFormat.
+        '../third_party/protobuf/protobuf.gyp:protobuf_full_do_not_use',
+        'media_info_proto',
+      ],
+    },
     {
       # Used by both MPD and HLS. It should really be moved to a common
       # directory shared by MPD and HLS.
@@ -31,9 +46,14 @@
       'sources': [
         'base/bandwidth_estimator.cc',
         'base/bandwidth_estimator.h',
+        'base/manifest_file_writer.cc',
+        'base/manifest_file_writer.h',
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../file/file.gyp:file',
+        '../metrics/metrics.gyp:metrics',
+        '../third_party/zlib/zlib.gyp:zlib',
       ],
     },
     {
@@ -50,6 +70,8 @@
         'base/mpd_notifier_util.h',
         'base/mpd_notifier.h',
         'base/mpd_options.h',
+        'base/mpd_patch_builder.cc',
+        'base/mpd_patch_builder.h',
         'base/mpd_utils.cc',
         'base/mpd_utils.h',
         'base/period.cc',
@@ -68,6 +90,7 @@
         '../base/base.gyp:base',
         '../file/file.gyp:file',
         '../media/base/media_base.gyp:media_base',
+        '../metrics/metrics.gyp:metrics',
         '../third_party/gflags/gflags.gyp:gflags',
         '../third_party/libxml/libxml.gyp:libxml',
         '../version/version.gyp:version',
@@ -99,6 +122,8 @@
       'sources': [
         'base/adaptation_set_unittest.cc',
         'base/bandwidth_estimator_unittest.cc',
+        'base/manifest_file_writer_unittest.cc',
+        'base/media_info_file_unittest.cc',
         'base/mpd_builder_unittest.cc',
         'base/mpd_utils_unittest.cc',
         'base/period_unittest.cc',
@@ -110,6 +135,7 @@
         'test/xml_compare.cc',
         'test/xml_compare.h',
         'util/mpd_writer_unittest.cc',
+        'util/time_shard_merger_unittest.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
@@ -118,6 +144,8 @@
         '../testing/gmock.gyp:gmock',
         '../testing/gtest.gyp:gtest',
         '../third_party/gflags/gflags.gyp:gflags',
+        '../third_party/zlib/zlib.gyp:zlib',
+        'media_info_file',
         'mpd_builder',
         'mpd_mocks',
         'mpd_util',
@@ -129,10 +157,13 @@
       'sources': [
         'util/mpd_writer.cc',
         'util/mpd_writer.h',
+        'util/time_shard_merger.cc',
+        'util/time_shard_merger.h',
       ],
       'dependencies': [
         '../file/file.gyp:file',
         '../third_party/gflags/gflags.gyp:gflags',
+        'media_info_file',
         'mpd_builder',
         'mpd_mocks',
       ],
@@ -16,6 +16,10 @@ namespace shaka {
 struct MpdParams {
   /// MPD output file path.
   std::string mpd_output;
+  /// MPD Patch output file path. If set, a patch updating the previous MPD to
+  /// the current one is written with every MPD update, and referenced from the
+  /// MPD with a PatchLocation element. For dynamic MPD only.
+  std::string mpd_patch_output;
   /// BaseURLs for the MPD. The values will be added as <BaseURL> element(s)
   /// under the <MPD> element.
   std::vector<std::string> base_urls;
@@ -44,6 +48,15 @@ struct MpdParams {
   /// accessible as they may still be accessed by the player. The segments are
   /// not removed if the value is zero.
   size_t preserved_segments_outside_live_window = 0;
+  /// Duration, in seconds, of the sliding window of the latest segments used
+  /// to estimate Representation@bandwidth. The latest segment is always
+  /// included. All the segments are used if the value is zero. The window is
+  /// at most @a time_shift_buffer_depth for dynamic MPDs.
+  double bandwidth_estimation_window = 0;
+  /// Write a gzip copy of the MPD and of its patch beside them, with a ".gz"
+  /// extension, compressed once per update so that the origin can serve them
+  /// without compressing them per request.
+  bool gzip_manifests = false;
   /// UTCTimings. For dynamic MPD only.
   struct UtcTiming {
     std::string scheme_id_uri;
@@ -74,6 +87,15 @@ struct MpdParams {
   /// Ignored if $Time$ is used in segment template, since $Time$ requires
   /// accurate Segment Timeline.
   bool allow_approximate_segment_timeline = false;
+  /// For live profile with $Number$ only. Use SegmentTemplate@duration
+  /// instead of a SegmentTimeline while all the segments in the window, except
+  /// the last one, have the same duration, e.g. from encoders with regular
+  /// GOPs, so that the size of the MPD does not grow with the time shift
+  /// buffer depth. Durations within one sample, and 50ms at most, of each other
+  /// are considered the same. The segment numbers must match their start
+  /// times, as they do with deterministic output. The SegmentTimeline is
+  /// generated again while a segment of another duration is in the window.
+  bool segment_template_constant_duration = false;
   /// This is the target segment duration requested by the user. The actual
   /// segment duration may be different to the target segment duration.
   /// This parameter is included here to calculate the approximate
@@ -87,6 +109,14 @@ struct MpdParams {
   /// <ContentProtection ...> element alongside with <cenc:pssh>
   /// when using PlayReady protection system.
   bool include_mspr_pro = true;
+  /// The availabilityStartTime of a dynamic MPD, as an xs:dateTime in UTC,
+  /// e.g. 2020-01-01T00:00:00Z. It is derived from the wall clock time of the
+  /// first segment if not specified.
+  std::string availability_start_time;
+  /// Derive the publishTime of a dynamic MPD from availability_start_time and
+  /// the end of the latest segment instead of the wall clock, so that
+  /// packagers fed the same input write identical MPDs.
+  bool publish_time_from_timeline = false;
 };
 
 }  // namespace shaka
@@ -175,7 +175,13 @@ bool XmlEqual(const std::string& xml1, xmlNodePtr xml2) {
   xmlNodePtr xml1_root_element = xmlDocGetRootElement(xml1_doc.get());
   if (!xml1_root_element)
     return false;
-  return CompareNodes(xml1_root_element, xml2);
+  // |xml2| is reparsed, as some of its elements may be raw content, see
+  // XmlNode::SetRawContent().
+  xml::scoped_xml_ptr<xmlDoc> xml2_doc(GetDocFromString(XmlNodeToString(xml2)));
+  xmlNodePtr xml2_root_element = xmlDocGetRootElement(xml2_doc.get());
+  if (!xml2_root_element)
+    return false;
+  return CompareNodes(xml1_root_element, xml2_root_element);
 }
 
 std::string XmlNodeToString(xmlNodePtr xml_node) {
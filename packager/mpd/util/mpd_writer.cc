@@ -7,16 +7,17 @@
 #include "packager/mpd/util/mpd_writer.h"
 
 #include <gflags/gflags.h>
-#include <google/protobuf/text_format.h>
 #include <stdint.h>
 
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
 #include "packager/file/file.h"
+#include "packager/mpd/base/media_info_file.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/mpd_notifier.h"
 #include "packager/mpd/base/mpd_utils.h"
 #include "packager/mpd/base/simple_mpd_notifier.h"
+#include "packager/mpd/util/time_shard_merger.h"
 
 DEFINE_bool(generate_dash_if_iop_compliant_mpd,
             true,
@@ -44,30 +45,41 @@ MpdWriter::MpdWriter() : notifier_factory_(new SimpleMpdNotifierFactory()) {}
 MpdWriter::~MpdWriter() {}
 
 bool MpdWriter::AddFile(const std::string& media_info_path) {
-  std::string file_content;
-  if (!File::ReadFileToString(media_info_path.c_str(), &file_content)) {
-    LOG(ERROR) << "Failed to read " << media_info_path << " to string.";
-    return false;
-  }
-
   MediaInfo media_info;
-  if (!::google::protobuf::TextFormat::ParseFromString(file_content,
-                                                       &media_info)) {
-    LOG(ERROR) << "Failed to parse " << file_content << " to MediaInfo.";
+  if (!ReadMediaInfoFile(media_info_path, &media_info))
     return false;
-  }
-
   media_infos_.push_back(media_info);
   return true;
 }
 
+void MpdWriter::AddMediaInfo(const MediaInfo& media_info) {
+  media_infos_.push_back(media_info);
+}
+
+bool MpdWriter::ReadMediaInfoFile(const std::string& media_info_path,
+                                  MediaInfo* media_info) {
+  return shaka::ReadMediaInfoFile(media_info_path, media_info);
+}
+
 void MpdWriter::AddBaseUrl(const std::string& base_url) {
   base_urls_.push_back(base_url);
 }
 
 bool MpdWriter::WriteMpdToFile(const char* file_name) {
   CHECK(file_name);
+  std::vector<MediaInfo> media_infos(media_infos_.begin(), media_infos_.end());
+  if (!MergeTimeShards(&media_infos)) {
+    LOG(ERROR) << "Failed to merge the time shards of the streams.";
+    return false;
+  }
+
   MpdOptions mpd_options;
+  // The streams with a segment template, e.g. packaged in time shards, are
+  // listed with the segments recorded in their MediaInfo.
+  for (const MediaInfo& media_info : media_infos) {
+    if (media_info.has_segment_template())
+      mpd_options.dash_profile = DashProfile::kLive;
+  }
   mpd_options.mpd_params.base_urls = base_urls_;
   mpd_options.mpd_params.mpd_output = file_name;
   mpd_options.mpd_params.generate_dash_if_iop_compliant_mpd =
@@ -79,13 +91,24 @@ bool MpdWriter::WriteMpdToFile(const char* file_name) {
     return false;
   }
 
-  for (const MediaInfo& media_info : media_infos_) {
-    uint32_t unused_conatiner_id;
-    if (!notifier->NotifyNewContainer(media_info, &unused_conatiner_id)) {
+  for (MediaInfo& media_info : media_infos) {
+    std::vector<MediaInfo::Segment> segments(media_info.segments().begin(),
+                                             media_info.segments().end());
+    media_info.clear_segments();
+    uint32_t container_id;
+    if (!notifier->NotifyNewContainer(media_info, &container_id)) {
       LOG(ERROR) << "Failed to add MediaInfo for media file: "
                  << media_info.media_file_name();
       return false;
     }
+    for (const MediaInfo::Segment& segment : segments) {
+      if (!notifier->NotifyNewSegment(container_id, segment.start_time(),
+                                      segment.duration(), segment.size())) {
+        LOG(ERROR) << "Failed to add the segments of "
+                   << media_info.segment_template();
+        return false;
+      }
+    }
   }
 
   if (!notifier->Flush()) {
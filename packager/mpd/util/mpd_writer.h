@@ -45,18 +45,29 @@ class MpdNotifierFactory {
 // AdaptationSets by checking the video_info, audio_info, and text_info fields.
 // Therefore, this cannot handle an instance of MediaInfo with video, audio, and
 // text combination.
+// The MediaInfo of the time shards of a stream are merged, see
+// MergeTimeShards(), and the segments recorded in the MediaInfo of the streams
+// with a segment template are listed in the MPD.
 class MpdWriter {
  public:
   MpdWriter();
   ~MpdWriter();
 
   // Add |media_info_path| for MPD generation.
-  // The content of |media_info_path| should be a string representation of
-  // MediaInfo, i.e. the content should be a result of using
-  // google::protobuf::TestFormat::Print*() methods.
+  // The content of |media_info_path| should be a MediaInfo file, see
+  // WriteMediaInfoFile().
   // If necessary, this method can be called after WriteMpd*() methods.
   bool AddFile(const std::string& media_info_path);
 
+  // Add |media_info| for MPD generation, e.g. as read by ReadMediaInfoFile().
+  void AddMediaInfo(const MediaInfo& media_info);
+
+  // Read the MediaInfo in |media_info_path|, in text or binary format, to
+  // |media_info|. This method is thread safe, so the files of many MPDs can be
+  // read in parallel.
+  static bool ReadMediaInfoFile(const std::string& media_info_path,
+                                MediaInfo* media_info);
+
   // |base_url| will be used for <BaseURL> element for the MPD. The BaseURL
   // element will be a direct child element of the <MPD> element.
   void AddBaseUrl(const std::string& base_url);
@@ -0,0 +1,118 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/util/time_shard_merger.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+#include "packager/base/logging.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+
+namespace {
+
+// Merge |shards|, the MediaInfo of the time shards of a stream, into
+// |merged|.
+bool MergeStreamShards(const std::vector<const MediaInfo*>& shards,
+                       MediaInfo* merged) {
+  const MediaInfo& first_shard = *shards.front();
+  const std::string& segment_template = first_shard.segment_template();
+  const uint32_t num_shards = first_shard.num_time_shards();
+
+  std::vector<const MediaInfo*> shards_by_index(num_shards);
+  for (const MediaInfo* shard : shards) {
+    if (shard->num_time_shards() != num_shards ||
+        shard->time_shard_index() >= num_shards ||
+        shard->reference_time_scale() != first_shard.reference_time_scale() ||
+        shard->container_type() != first_shard.container_type()) {
+      LOG(ERROR) << "The time shards of " << segment_template
+                 << " do not match.";
+      return false;
+    }
+    const MediaInfo*& shard_at_index =
+        shards_by_index[shard->time_shard_index()];
+    if (shard_at_index) {
+      LOG(ERROR) << "Time shard " << shard->time_shard_index() << " of "
+                 << segment_template << " is listed more than once.";
+      return false;
+    }
+    shard_at_index = shard;
+  }
+
+  *merged = *shards_by_index.front();
+  merged->clear_segments();
+  merged->clear_time_shard_index();
+  merged->clear_num_time_shards();
+  double media_duration_seconds = 0;
+  int64_t end_time = 0;
+  for (uint32_t i = 0; i < num_shards; ++i) {
+    const MediaInfo* shard = shards_by_index[i];
+    if (!shard) {
+      LOG(ERROR) << "Time shard " << i << " of " << segment_template
+                 << " is missing.";
+      return false;
+    }
+    if (shard->segments_size() > 0 && merged->segments_size() > 0 &&
+        shard->segments(0).start_time() < end_time) {
+      LOG(ERROR) << "Time shard " << i << " of " << segment_template
+                 << " overlaps the previous shard.";
+      return false;
+    }
+    for (const MediaInfo::Segment& segment : shard->segments()) {
+      *merged->add_segments() = segment;
+      end_time = segment.start_time() + segment.duration();
+    }
+    media_duration_seconds += shard->media_duration_seconds();
+    merged->set_bandwidth(std::max(merged->bandwidth(), shard->bandwidth()));
+  }
+  merged->set_media_duration_seconds(media_duration_seconds);
+  return true;
+}
+
+}  // namespace
+
+bool MergeTimeShards(std::vector<MediaInfo>* media_infos) {
+  DCHECK(media_infos);
+  std::map<std::string, std::vector<const MediaInfo*>> shards_by_stream;
+  for (const MediaInfo& media_info : *media_infos) {
+    if (media_info.num_time_shards() == 0)
+      continue;
+    if (media_info.segment_template().empty()) {
+      LOG(ERROR) << "Time shards must have a segment template.";
+      return false;
+    }
+    shards_by_stream[media_info.segment_template()].push_back(&media_info);
+  }
+  if (shards_by_stream.empty())
+    return true;
+
+  std::map<std::string, MediaInfo> merged_streams;
+  for (const auto& stream : shards_by_stream) {
+    if (!MergeStreamShards(stream.second, &merged_streams[stream.first]))
+      return false;
+  }
+
+  std::vector<MediaInfo> merged_media_infos;
+  for (MediaInfo& media_info : *media_infos) {
+    if (media_info.num_time_shards() == 0) {
+      merged_media_infos.push_back(std::move(media_info));
+      continue;
+    }
+    // In place of the first shard of the stream.
+    auto merged_stream = merged_streams.find(media_info.segment_template());
+    if (merged_stream != merged_streams.end()) {
+      merged_media_infos.push_back(std::move(merged_stream->second));
+      merged_streams.erase(merged_stream);
+    }
+  }
+  media_infos->swap(merged_media_infos);
+  return true;
+}
+
+}  // namespace shaka
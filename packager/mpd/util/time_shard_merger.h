@@ -0,0 +1,29 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_UTIL_TIME_SHARD_MERGER_H_
+#define MPD_UTIL_TIME_SHARD_MERGER_H_
+
+#include <vector>
+
+namespace shaka {
+
+class MediaInfo;
+
+/// Merge the MediaInfo of the time shards of each stream, see
+/// MediaInfo.num_time_shards, into a single MediaInfo with the segments of all
+/// the shards, in place of the first shard of the stream. The shards of a
+/// stream are those with the same segment template. The other MediaInfo are
+/// kept as they are.
+/// @param media_infos is the MediaInfo to merge, e.g. as read from the
+///        MediaInfo files of all the shards packaged.
+/// @return false if a shard is missing or the shards of a stream do not
+///         match.
+bool MergeTimeShards(std::vector<MediaInfo>* media_infos);
+
+}  // namespace shaka
+
+#endif  // MPD_UTIL_TIME_SHARD_MERGER_H_
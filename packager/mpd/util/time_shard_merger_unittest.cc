@@ -0,0 +1,106 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/util/time_shard_merger.h"
+
+namespace shaka {
+
+namespace {
+
+const char kVideoTemplate[] = "video_$Number$.m4s";
+const char kAudioTemplate[] = "audio_$Number$.m4s";
+
+// A time shard of a stream with one segment of a second per shard.
+MediaInfo CreateShard(const std::string& segment_template,
+                      uint32_t shard_index,
+                      uint32_t num_shards,
+                      uint32_t bandwidth) {
+  MediaInfo media_info;
+  media_info.set_reference_time_scale(1000);
+  media_info.set_segment_template(segment_template);
+  media_info.set_bandwidth(bandwidth);
+  media_info.set_media_duration_seconds(1);
+  media_info.set_time_shard_index(shard_index);
+  media_info.set_num_time_shards(num_shards);
+  MediaInfo::Segment* segment = media_info.add_segments();
+  segment->set_start_time(shard_index * 1000);
+  segment->set_duration(1000);
+  segment->set_size(100 + shard_index);
+  return media_info;
+}
+
+}  // namespace
+
+TEST(TimeShardMergerTest, MergeShards) {
+  MediaInfo text;
+  text.set_media_file_name("text.vtt");
+  std::vector<MediaInfo> media_infos = {
+      CreateShard(kVideoTemplate, 1, 3, 2000),
+      text,
+      CreateShard(kAudioTemplate, 0, 1, 100),
+      CreateShard(kVideoTemplate, 2, 3, 1000),
+      CreateShard(kVideoTemplate, 0, 3, 1500),
+  };
+  ASSERT_TRUE(MergeTimeShards(&media_infos));
+  ASSERT_EQ(3u, media_infos.size());
+
+  // In place of the first shard listed.
+  const MediaInfo& video = media_infos[0];
+  EXPECT_EQ(kVideoTemplate, video.segment_template());
+  EXPECT_FALSE(video.has_time_shard_index());
+  EXPECT_FALSE(video.has_num_time_shards());
+  EXPECT_EQ(2000u, video.bandwidth());
+  EXPECT_FLOAT_EQ(3, video.media_duration_seconds());
+  ASSERT_EQ(3, video.segments_size());
+  for (int i = 0; i < video.segments_size(); ++i) {
+    EXPECT_EQ(i * 1000, video.segments(i).start_time());
+    EXPECT_EQ(100u + i, video.segments(i).size());
+  }
+
+  EXPECT_EQ("text.vtt", media_infos[1].media_file_name());
+  EXPECT_EQ(kAudioTemplate, media_infos[2].segment_template());
+  EXPECT_EQ(1, media_infos[2].segments_size());
+}
+
+TEST(TimeShardMergerTest, MissingShard) {
+  std::vector<MediaInfo> media_infos = {
+      CreateShard(kVideoTemplate, 0, 3, 1000),
+      CreateShard(kVideoTemplate, 2, 3, 1000),
+  };
+  EXPECT_FALSE(MergeTimeShards(&media_infos));
+}
+
+TEST(TimeShardMergerTest, DuplicatedShard) {
+  std::vector<MediaInfo> media_infos = {
+      CreateShard(kVideoTemplate, 0, 2, 1000),
+      CreateShard(kVideoTemplate, 1, 2, 1000),
+      CreateShard(kVideoTemplate, 1, 2, 1000),
+  };
+  EXPECT_FALSE(MergeTimeShards(&media_infos));
+}
+
+TEST(TimeShardMergerTest, InconsistentNumberOfShards) {
+  std::vector<MediaInfo> media_infos = {
+      CreateShard(kVideoTemplate, 0, 2, 1000),
+      CreateShard(kVideoTemplate, 1, 3, 1000),
+  };
+  EXPECT_FALSE(MergeTimeShards(&media_infos));
+}
+
+TEST(TimeShardMergerTest, OverlappingShards) {
+  MediaInfo second_shard = CreateShard(kVideoTemplate, 1, 2, 1000);
+  second_shard.mutable_segments(0)->set_start_time(500);
+  std::vector<MediaInfo> media_infos = {
+      CreateShard(kVideoTemplate, 0, 2, 1000),
+      second_shard,
+  };
+  EXPECT_FALSE(MergeTimeShards(&media_infos));
+}
+
+}  // namespace shaka
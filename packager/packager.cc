@@ -6,29 +6,48 @@
 
 #include "packager/packager.h"
 
+#include <inttypes.h>
+
 #include <algorithm>
+#include <limits>
+#include <set>
+#include <thread>
 
+#include "packager/app/incremental_packaging.h"
 #include "packager/app/job_manager.h"
 #include "packager/app/libcrypto_threading.h"
+#include "packager/app/live_checkpoint.h"
+#include "packager/app/manifest_event_publisher.h"
 #include "packager/app/muxer_factory.h"
 #include "packager/app/packager_util.h"
 #include "packager/app/stream_descriptor.h"
 #include "packager/base/at_exit.h"
+#include "packager/base/bind.h"
 #include "packager/base/files/file_path.h"
 #include "packager/base/logging.h"
 #include "packager/base/optional.h"
 #include "packager/base/path_service.h"
+#include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
 #include "packager/base/threading/simple_thread.h"
 #include "packager/base/time/clock.h"
+#include "packager/file/cpu_affinity.h"
 #include "packager/file/file.h"
+#include "packager/file/memory_origin_server.h"
 #include "packager/hls/base/hls_notifier.h"
 #include "packager/hls/base/simple_hls_notifier.h"
+#include "packager/media/base/async_handler.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/container_names.h"
+#include "packager/media/base/deferred_key_source.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/language_utils.h"
+#include "packager/media/base/live_scheduler.h"
 #include "packager/media/base/muxer.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
@@ -37,13 +56,30 @@
 #include "packager/media/chunking/text_chunker.h"
 #include "packager/media/crypto/encryption_handler.h"
 #include "packager/media/demuxer/demuxer.h"
+#include "packager/media/demuxer/fragment_passthrough.h"
+#include "packager/media/demuxer/push_input.h"
+#include "packager/media/demuxer/sample_index.h"
+#include "packager/media/demuxer/synthetic_media_parser.h"
+#include "packager/media/demuxer/time_slicer.h"
+#include "packager/media/event/async_muxer_listener.h"
+#include "packager/media/event/combined_muxer_listener.h"
+#include "packager/media/event/live_lag_muxer_listener.h"
 #include "packager/media/event/muxer_listener_factory.h"
+#include "packager/media/event/progress_listener.h"
+#include "packager/media/event/segment_report_muxer_listener.h"
+#include "packager/media/event/time_slice_muxer_listener.h"
 #include "packager/media/event/vod_media_info_dump_muxer_listener.h"
 #include "packager/media/formats/webvtt/text_padder.h"
 #include "packager/media/formats/webvtt/webvtt_text_output_handler.h"
 #include "packager/media/formats/webvtt/webvtt_to_mp4_handler.h"
 #include "packager/media/replicator/replicator.h"
 #include "packager/media/trick_play/trick_play_handler.h"
+#include "packager/metrics/allocator_stats.h"
+#include "packager/metrics/huge_page_allocator.h"
+#include "packager/metrics/memory_budget.h"
+#include "packager/metrics/metrics.h"
+#include "packager/metrics/metrics_server.h"
+#include "packager/metrics/trace_recorder.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/simple_mpd_notifier.h"
@@ -63,9 +99,34 @@ namespace media {
 namespace {
 
 const char kMediaInfoSuffix[] = ".media_info";
+const char kSegmentReportSuffix[] = ".segments.jsonl";
 
 const int64_t kDefaultTextZeroBiasMs = 10 * 60 * 1000;  // 10 minutes
 
+// Number of buffers pushed to an input which are queued before the pushers
+// block.
+const size_t kMaxQueuedPushedBuffers = 16;
+
+MediaInfoFileFormat GetMediaInfoFileFormat(const PackagingParams& params) {
+  return params.binary_media_info ? MediaInfoFileFormat::kBinary
+                                  : MediaInfoFileFormat::kText;
+}
+
+// @return the name of |key_provider| in the logs and the metrics.
+std::string KeyProviderName(KeyProvider key_provider) {
+  switch (key_provider) {
+    case KeyProvider::kWidevine:
+      return "widevine";
+    case KeyProvider::kPlayReady:
+      return "playready";
+    case KeyProvider::kRawKey:
+      return "raw_key";
+    case KeyProvider::kNone:
+      break;
+  }
+  return "none";
+}
+
 MuxerOptions CreateMuxerOptions(const StreamDescriptor& stream,
                                 const PackagingParams& params) {
   MuxerOptions options;
@@ -73,10 +134,16 @@ MuxerOptions CreateMuxerOptions(const StreamDescriptor& stream,
   options.mp4_params = params.mp4_output_params;
   options.transport_stream_timestamp_offset_ms =
       params.transport_stream_timestamp_offset_ms;
+  options.webm_single_pass_single_segment =
+      params.webm_single_pass_single_segment;
+  options.segment_duration_in_seconds =
+      params.chunking_params.segment_duration_in_seconds;
   options.temp_dir = params.temp_dir;
   options.bandwidth = stream.bandwidth;
   options.output_file_name = stream.output;
   options.segment_template = stream.segment_template;
+  options.segment_number_from_timeline =
+      params.deterministic_output && !stream.segment_template.empty();
 
   return options;
 }
@@ -84,7 +151,7 @@ MuxerOptions CreateMuxerOptions(const StreamDescriptor& stream,
 MuxerListenerFactory::StreamData ToMuxerListenerData(
     const StreamDescriptor& stream) {
   MuxerListenerFactory::StreamData data;
-  data.media_info_output = stream.output;
+  data.media_info_output = GetMediaInfoOutput(stream);
 
   data.hls_group_id = stream.hls_group_id;
   data.hls_name = stream.hls_name;
@@ -105,7 +172,34 @@ MuxerListenerFactory::StreamData ToMuxerListenerData(
 bool DetermineTextFileCodec(const std::string& file, std::string* out) {
   CHECK(out);
 
+  // WebVTT is recognized from its header, so only the beginning of WebVTT
+  // inputs, which can be large or growing live feeds, is read.
+  const size_t kTextFileHeaderSize = 0x10000;
   std::string content;
+  File* text_file = File::Open(file.c_str(), "r");
+  if (!text_file) {
+    LOG(ERROR) << "Failed to open file " << file
+               << " to determine file format.";
+    return false;
+  }
+  content.resize(kTextFileHeaderSize);
+  size_t bytes_read = 0;
+  while (bytes_read < content.size()) {
+    const int64_t result =
+        text_file->Read(&content[bytes_read], content.size() - bytes_read);
+    if (result <= 0)
+      break;
+    bytes_read += result;
+  }
+  text_file->Close();
+  content.resize(bytes_read);
+  if (DetermineContainer(reinterpret_cast<const uint8_t*>(content.data()),
+                         content.size()) == CONTAINER_WEBVTT) {
+    *out = "wvtt";
+    return true;
+  }
+
+  // TTML is recognized by parsing the whole document.
   if (!File::ReadFileToString(file.c_str(), &content)) {
     LOG(ERROR) << "Failed to open file " << file
                << " to determine file format.";
@@ -117,11 +211,6 @@ bool DetermineTextFileCodec(const std::string& file, std::string* out) {
   MediaContainerName container_name =
       DetermineContainer(content_data, content.size());
 
-  if (container_name == CONTAINER_WEBVTT) {
-    *out = "wvtt";
-    return true;
-  }
-
   if (container_name == CONTAINER_TTML) {
     *out = "ttml";
     return true;
@@ -199,8 +288,12 @@ Status ValidateStreamDescriptor(bool dump_stream_info,
                   "Stream stream_selector not specified.");
   }
 
-  // If a segment template is provided, it must be valid.
-  if (stream.segment_template.length()) {
+  // If a segment template is provided, it must be valid. A UDP url sends all
+  // the segments to the same destination instead.
+  const bool is_udp_segment_template =
+      base::StartsWith(stream.segment_template, kUdpFilePrefix,
+                       base::CompareCase::SENSITIVE);
+  if (stream.segment_template.length() && !is_udp_segment_template) {
     RETURN_IF_ERROR(ValidateSegmentTemplate(stream.segment_template));
   }
 
@@ -211,6 +304,10 @@ Status ValidateStreamDescriptor(bool dump_stream_info,
   if (output_format == CONTAINER_UNKNOWN) {
     return Status(error::INVALID_ARGUMENT, "Unsupported output format.");
   }
+  if (is_udp_segment_template && output_format != CONTAINER_MPEG2TS) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Only TS segments can be sent to a UDP 'segment_template'.");
+  }
   if (output_format == MediaContainerName::CONTAINER_MPEG2TS) {
     if (stream.segment_template.empty()) {
       return Status(
@@ -264,6 +361,199 @@ Status ValidateStreamDescriptor(bool dump_stream_info,
     RETURN_IF_ERROR(ValidateSegmentTemplate(stream.output));
   }
 
+  if (stream.start_time < 0 || stream.end_time < 0 ||
+      (stream.end_time > 0 && stream.end_time <= stream.start_time)) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Invalid time range of input '" + stream.input +
+                      "'. 'end_time' must be after 'start_time'.");
+  }
+
+  return Status::OK;
+}
+
+// Validates two stream descriptors with the same TS segment template, which are
+// muxed into one output with PackagingParams.multiplex_ts_streams.
+Status ValidateMultiplexedTsStreams(const PackagingParams& packaging_params,
+                                    const StreamDescriptor& first,
+                                    const StreamDescriptor& other) {
+  const std::string error_prefix =
+      "Cannot multiplex the streams with segment template '" +
+      other.segment_template + "': ";
+  if (first.input != other.input) {
+    return Status(error::INVALID_ARGUMENT,
+                  error_prefix + "the streams must have the same input.");
+  }
+  if (first.trick_play_factor || other.trick_play_factor) {
+    return Status(error::INVALID_ARGUMENT,
+                  error_prefix + "trick play is not supported.");
+  }
+  if (packaging_params.encryption_params.key_provider != KeyProvider::kNone &&
+      !(first.skip_encryption && other.skip_encryption)) {
+    return Status(error::INVALID_ARGUMENT,
+                  error_prefix + "encryption is not supported.");
+  }
+  if (packaging_params.async_queue_capacity > 0 ||
+      packaging_params.output_queue_capacity > 0) {
+    return Status(error::INVALID_ARGUMENT,
+                  error_prefix + "asynchronous queues are not supported.");
+  }
+  if (!packaging_params.ad_cue_generator_params.cue_points.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  error_prefix + "ad cues are not supported.");
+  }
+  return Status::OK;
+}
+
+// Just in time packaging packages each segment on its own, from the sample
+// index of a local single track input, so the segments must not depend on
+// each other, nor on the whole stream like the manifests do.
+Status ValidateJitParams(
+    const PackagingParams& packaging_params,
+    const std::vector<StreamDescriptor>& stream_descriptors) {
+  const ChunkingParams& chunking_params = packaging_params.chunking_params;
+  const bool has_subsegments =
+      chunking_params.subsegment_duration_in_seconds > 0 &&
+      chunking_params.subsegment_duration_in_seconds !=
+          chunking_params.segment_duration_in_seconds;
+  if (!packaging_params.mpd_params.mpd_output.empty() ||
+      !packaging_params.hls_params.master_playlist_output.empty() ||
+      !packaging_params.ad_cue_generator_params.cue_points.empty() ||
+      !packaging_params.live_checkpoint_file.empty() || has_subsegments ||
+      chunking_params.low_latency_chunk_num_frames > 0 ||
+      chunking_params.low_latency_chunk_duration_in_seconds > 0 ||
+      packaging_params.encryption_params.clear_lead_in_seconds > 0 ||
+      packaging_params.decryption_params.key_provider != KeyProvider::kNone) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Just in time packaging does not support manifests, ad "
+                  "cues, live checkpoints, subsegments, low latency chunks, "
+                  "clear lead or decryption.");
+  }
+  for (const StreamDescriptor& stream : stream_descriptors) {
+    const MediaContainerName output_format = GetOutputFormat(stream);
+    if ((output_format != CONTAINER_MOV &&
+         output_format != CONTAINER_MPEG2TS) ||
+        stream.segment_template.empty() ||
+        stream.segment_template.find("$Time") != std::string::npos ||
+        stream.trick_play_factor > 0 ||
+        !File::IsLocalRegularFile(stream.input.c_str())) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Just in time packaging requires MP4 or MPEG-2 TS "
+                    "outputs with $Number$ segment templates, from local "
+                    "files, without trick play: " +
+                        stream.input + ":" + stream.stream_selector);
+    }
+  }
+  return Status::OK;
+}
+
+Status ValidateDeterministicParams(
+    const PackagingParams& packaging_params,
+    const std::vector<StreamDescriptor>& stream_descriptors) {
+  const ChunkingParams& chunking_params = packaging_params.chunking_params;
+  const bool has_subsegments =
+      chunking_params.subsegment_duration_in_seconds > 0 &&
+      chunking_params.subsegment_duration_in_seconds !=
+          chunking_params.segment_duration_in_seconds;
+  // The segments must be numbered from their start times, which the ad cues
+  // shift, and each must have a single fragment.
+  if (!packaging_params.ad_cue_generator_params.cue_points.empty() ||
+      has_subsegments || chunking_params.low_latency_chunk_num_frames > 0 ||
+      chunking_params.low_latency_chunk_duration_in_seconds > 0 ||
+      !packaging_params.live_checkpoint_file.empty() ||
+      packaging_params.num_vod_time_slices > 1 ||
+      packaging_params.num_vod_time_shards > 0 ||
+      packaging_params.jit_packaging ||
+      packaging_params.encryption_params.clear_lead_in_seconds > 0) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Deterministic output does not support ad cues, "
+                  "subsegments, low latency chunks, live checkpoints, time "
+                  "slices, time shards, just in time packaging or clear "
+                  "lead.");
+  }
+  // The wall clock times differ between the packagers.
+  if (packaging_params.mp4_output_params.generate_prft_boxes ||
+      packaging_params.hls_params.program_date_time) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Deterministic output does not support 'prft' boxes or "
+                  "EXT-X-PROGRAM-DATE-TIME.");
+  }
+  const MpdParams& mpd_params = packaging_params.mpd_params;
+  if (!mpd_params.mpd_output.empty() &&
+      !stream_descriptors.front().segment_template.empty() &&
+      !mpd_params.generate_static_live_mpd &&
+      mpd_params.availability_start_time.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Deterministic output requires the availabilityStartTime "
+                  "of the dynamic MPD.");
+  }
+  return Status::OK;
+}
+
+Status ValidateTimeShardParams(
+    const PackagingParams& packaging_params,
+    const std::vector<StreamDescriptor>& stream_descriptors) {
+  if (packaging_params.vod_time_shard_index >=
+      packaging_params.num_vod_time_shards) {
+    return Status(error::INVALID_ARGUMENT,
+                  "The time shard index must be less than the number of time "
+                  "shards.");
+  }
+  const ChunkingParams& chunking_params = packaging_params.chunking_params;
+  const bool has_subsegments =
+      chunking_params.subsegment_duration_in_seconds > 0 &&
+      chunking_params.subsegment_duration_in_seconds !=
+          chunking_params.segment_duration_in_seconds;
+  if (!packaging_params.output_media_info ||
+      !packaging_params.mpd_params.mpd_output.empty() ||
+      !packaging_params.hls_params.master_playlist_output.empty() ||
+      !packaging_params.ad_cue_generator_params.cue_points.empty() ||
+      !packaging_params.live_checkpoint_file.empty() ||
+      packaging_params.jit_packaging || has_subsegments ||
+      chunking_params.low_latency_chunk_num_frames > 0 ||
+      chunking_params.low_latency_chunk_duration_in_seconds > 0 ||
+      packaging_params.encryption_params.clear_lead_in_seconds > 0 ||
+      packaging_params.decryption_params.key_provider != KeyProvider::kNone) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Time shards require output_media_info, and do not support "
+                  "manifests, which are generated from the MediaInfo files "
+                  "of the shards, ad cues, live checkpoints, just in time "
+                  "packaging, subsegments, low latency chunks, clear lead or "
+                  "decryption.");
+  }
+  for (const StreamDescriptor& stream : stream_descriptors) {
+    const MediaContainerName output_format = GetOutputFormat(stream);
+    if ((output_format != CONTAINER_MOV &&
+         output_format != CONTAINER_MPEG2TS) ||
+        stream.segment_template.empty() || stream.trick_play_factor > 0 ||
+        stream.start_time > 0 || stream.end_time > 0 ||
+        !File::IsLocalRegularFile(stream.input.c_str())) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Time shards require MP4 or MPEG-2 TS outputs with "
+                    "segment templates, from local files, without trick play "
+                    "or time range: " +
+                        stream.input + ":" + stream.stream_selector);
+    }
+  }
+  return Status::OK;
+}
+
+// Incremental packaging reuses the MediaInfo files of the outputs of a
+// previous run, and does not support the options whose outputs depend on the
+// other outputs or on the previous run.
+Status ValidateIncrementalParams(const PackagingParams& packaging_params) {
+  if (!packaging_params.output_media_info ||
+      !packaging_params.live_checkpoint_file.empty() ||
+      !packaging_params.manifest_aggregator_url.empty() ||
+      !packaging_params.ad_cue_generator_params.cue_points.empty() ||
+      packaging_params.jit_packaging ||
+      packaging_params.num_vod_time_shards > 0 ||
+      packaging_params.multiplex_ts_streams) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Incremental packaging requires output_media_info, and "
+                  "does not support live checkpoints, manifest aggregation, "
+                  "ad cues, just in time packaging, time shards or "
+                  "multiplexed TS streams.");
+  }
   return Status::OK;
 }
 
@@ -285,8 +575,41 @@ Status ValidateParams(const PackagingParams& packaging_params,
   // generates multiple segments specified using segment template.
   const bool on_demand_dash_profile =
       stream_descriptors.begin()->segment_template.empty();
+
+  const ChunkingParams& chunking_params = packaging_params.chunking_params;
+  if (chunking_params.low_latency_chunk_num_frames < 0 ||
+      chunking_params.low_latency_chunk_duration_in_seconds < 0) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Low latency chunk size cannot be negative.");
+  }
+  if (on_demand_dash_profile &&
+      (chunking_params.low_latency_chunk_num_frames > 0 ||
+       chunking_params.low_latency_chunk_duration_in_seconds > 0)) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Low latency chunks require segment_template.");
+  }
+  if (chunking_params.low_latency_chunk_min_duration_in_seconds < 0 ||
+      (chunking_params.low_latency_chunk_target_bytes > 0 &&
+       chunking_params.low_latency_chunk_min_duration_in_seconds >
+           chunking_params.low_latency_chunk_duration_in_seconds)) {
+    return Status(error::INVALID_ARGUMENT,
+                  "The minimum low latency chunk duration cannot be negative "
+                  "or exceed the low latency chunk duration.");
+  }
+  if (chunking_params.low_latency_chunk_target_bytes > 0 &&
+      chunking_params.low_latency_chunk_duration_in_seconds <= 0) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Byte budgeted low latency chunks require a low latency "
+                  "chunk duration, which is their maximum duration.");
+  }
+  if (packaging_params.live_max_lag_in_seconds < 0) {
+    return Status(error::INVALID_ARGUMENT,
+                  "The maximum live lag cannot be negative.");
+  }
+
   std::set<std::string> outputs;
-  std::set<std::string> segment_templates;
+  std::map<std::string, const StreamDescriptor*> segment_templates;
+  std::map<std::string, const StreamDescriptor*> inputs;
   for (const auto& descriptor : stream_descriptors) {
     if (on_demand_dash_profile != descriptor.segment_template.empty()) {
       return Status(error::INVALID_ARGUMENT,
@@ -298,6 +621,17 @@ Status ValidateParams(const PackagingParams& packaging_params,
     RETURN_IF_ERROR(ValidateStreamDescriptor(
         packaging_params.test_params.dump_stream_info, descriptor));
 
+    // The streams of an input share its demuxer, and so its time range.
+    const StreamDescriptor*& first_of_input = inputs[descriptor.input];
+    if (!first_of_input) {
+      first_of_input = &descriptor;
+    } else if (first_of_input->start_time != descriptor.start_time ||
+               first_of_input->end_time != descriptor.end_time) {
+      return Status(error::INVALID_ARGUMENT,
+                    "The streams of input '" + descriptor.input +
+                        "' must have the same 'start_time' and 'end_time'.");
+    }
+
     if (base::StartsWith(descriptor.input, "udp://",
                          base::CompareCase::SENSITIVE)) {
       const HlsParams& hls_params = packaging_params.hls_params;
@@ -323,24 +657,35 @@ Status ValidateParams(const PackagingParams& packaging_params,
       outputs.insert(descriptor.output);
     }
     if (!descriptor.segment_template.empty()) {
-      if (segment_templates.find(descriptor.segment_template) !=
-          segment_templates.end()) {
+      const auto seen = segment_templates.find(descriptor.segment_template);
+      if (seen == segment_templates.end()) {
+        segment_templates[descriptor.segment_template] = &descriptor;
+      } else if (packaging_params.multiplex_ts_streams &&
+                 GetOutputFormat(descriptor) == CONTAINER_MPEG2TS) {
+        RETURN_IF_ERROR(ValidateMultiplexedTsStreams(
+            packaging_params, *seen->second, descriptor));
+      } else {
         return Status(error::INVALID_ARGUMENT,
                       "Seeing duplicated segment templates '" +
                           descriptor.segment_template +
                           "' in stream descriptors. Every segment template "
                           "must be unique.");
       }
-      segment_templates.insert(descriptor.segment_template);
     }
   }
 
-  if (packaging_params.output_media_info && !on_demand_dash_profile) {
-    // TODO(rkuroiwa, kqyang): Support partial media info dump for live.
-    return Status(error::UNIMPLEMENTED,
-                  "--output_media_info is only supported for on-demand profile "
-                  "(not using segment_template).");
+  if (packaging_params.jit_packaging)
+    RETURN_IF_ERROR(ValidateJitParams(packaging_params, stream_descriptors));
+  if (packaging_params.deterministic_output) {
+    RETURN_IF_ERROR(
+        ValidateDeterministicParams(packaging_params, stream_descriptors));
   }
+  if (packaging_params.num_vod_time_shards > 0) {
+    RETURN_IF_ERROR(
+        ValidateTimeShardParams(packaging_params, stream_descriptors));
+  }
+  if (packaging_params.incremental_packaging)
+    RETURN_IF_ERROR(ValidateIncrementalParams(packaging_params));
 
   return Status::OK;
 }
@@ -365,7 +710,7 @@ bool StreamDescriptorCompareFn(const StreamDescriptor& a,
 }
 
 // A fake clock that always return time 0 (epoch). Should only be used for
-// testing.
+// testing and deterministic output.
 class FakeClock : public base::Clock {
  public:
   base::Time Now() override { return base::Time(); }
@@ -417,7 +762,21 @@ Status CreateDemuxer(const StreamDescriptor& stream,
                      const PackagingParams& packaging_params,
                      std::shared_ptr<Demuxer>* new_demuxer) {
   std::shared_ptr<Demuxer> demuxer = std::make_shared<Demuxer>(stream.input);
+  demuxer->set_name("Demuxer:" + stream.input);
   demuxer->set_dump_stream_info(packaging_params.test_params.dump_stream_info);
+  demuxer->set_use_memory_mapped_input(
+      packaging_params.use_memory_mapped_input);
+  demuxer->set_parallel_track_demuxing(
+      packaging_params.parallel_track_demuxing);
+  demuxer->set_use_sample_index(packaging_params.use_input_sample_index);
+  if (packaging_params.progress_callback)
+    demuxer->SetProgressListener(CreateProgressListener(packaging_params));
+  if (stream.start_time > 0 || stream.end_time > 0) {
+    demuxer->set_time_range(stream.start_time,
+                            stream.end_time > 0
+                                ? stream.end_time
+                                : std::numeric_limits<double>::infinity());
+  }
 
   if (packaging_params.decryption_params.key_provider != KeyProvider::kNone) {
     std::unique_ptr<KeySource> decryption_key_source(
@@ -434,10 +793,39 @@ Status CreateDemuxer(const StreamDescriptor& stream,
   return Status::OK;
 }
 
+// Use Sample AES in MPEG2TS.
+// TODO(kqyang): Consider adding a new flag to enable Sample AES as we
+// will support CENC in TS in the future.
+bool UseSampleAes(const StreamDescriptor& stream) {
+  const MediaContainerName output_format = GetOutputFormat(stream);
+  return output_format == CONTAINER_MPEG2TS ||
+         output_format == CONTAINER_AAC || output_format == CONTAINER_AC3 ||
+         output_format == CONTAINER_EAC3;
+}
+
+// @return A key which is the same for the streams whose samples are encrypted
+//         the same way by CreateEncryptionHandler, empty if |stream| is not
+//         encrypted.
+// The TS and packed audio outputs cannot share the encrypted samples of the
+// cbcs outputs, although both use AES-CBC with a pattern: SAMPLE-AES leaves
+// the first 32 bytes of each H.264 NAL unit and the first 16 bytes of each
+// audio frame in the clear, and leaves the shorter ones unencrypted, while
+// cbcs protects the NAL units from the end of their headers and the audio
+// frames whole. The encrypted bytes differ, so they get separate branches.
+std::string GetEncryptionKey(const StreamDescriptor& stream,
+                             KeySource* key_source) {
+  if (stream.skip_encryption || !key_source)
+    return "";
+  return std::string(UseSampleAes(stream) ? "sample-aes:" : "default:") +
+         stream.drm_label;
+}
+
+// |stream_lag| is the lag of the live stream, if live scheduling is enabled.
 std::shared_ptr<MediaHandler> CreateEncryptionHandler(
     const PackagingParams& packaging_params,
     const StreamDescriptor& stream,
-    KeySource* key_source) {
+    KeySource* key_source,
+    std::shared_ptr<LiveStreamLag> stream_lag) {
   if (stream.skip_encryption) {
     return nullptr;
   }
@@ -449,16 +837,16 @@ std::shared_ptr<MediaHandler> CreateEncryptionHandler(
   // Make a copy so that we can modify it for this specific stream.
   EncryptionParams encryption_params = packaging_params.encryption_params;
 
-  // Use Sample AES in MPEG2TS.
-  // TODO(kqyang): Consider adding a new flag to enable Sample AES as we
-  // will support CENC in TS in the future.
-  if (GetOutputFormat(stream) == CONTAINER_MPEG2TS ||
-      GetOutputFormat(stream) == CONTAINER_AAC ||
-      GetOutputFormat(stream) == CONTAINER_AC3 ||
-      GetOutputFormat(stream) == CONTAINER_EAC3) {
+  if (UseSampleAes(stream)) {
     VLOG(1) << "Use Apple Sample AES encryption for MPEG2TS or Packed Audio.";
     encryption_params.protection_scheme = kAppleSampleAesProtectionScheme;
   }
+  if (packaging_params.deterministic_output) {
+    // Unique to the streams sharing a key.
+    encryption_params.deterministic_iv_seed =
+        (stream.output.empty() ? stream.segment_template : stream.output) +
+        ":" + stream.stream_selector;
+  }
 
   if (!stream.drm_label.empty()) {
     const std::string& drm_label = stream.drm_label;
@@ -475,7 +863,50 @@ std::shared_ptr<MediaHandler> CreateEncryptionHandler(
         kDefaultMaxHdPixels, kDefaultMaxUhd1Pixels, std::placeholders::_1);
   }
 
-  return std::make_shared<EncryptionHandler>(encryption_params, key_source);
+  auto encryption_handler =
+      std::make_shared<EncryptionHandler>(encryption_params, key_source);
+  encryption_handler->set_live_stream_lag(std::move(stream_lag));
+  return encryption_handler;
+}
+
+// Name |handler|, which may be null, in the pipeline statistics.
+void SetStatsName(const char* type,
+                  const std::string& label,
+                  MediaHandler* handler) {
+  if (handler)
+    handler->set_name(std::string(type) + ":" + label);
+}
+
+// Passes the progress of a demuxer or a muxer to the progress callback.
+class CallbackProgressListener : public ProgressListener {
+ public:
+  explicit CallbackProgressListener(
+      const std::function<void(const StreamProgress&)>& callback)
+      : callback_(callback) {}
+
+  void OnProgress(double progress) override {}
+  void OnStreamProgress(const StreamProgress& progress) override {
+    callback_(progress);
+  }
+
+ private:
+  const std::function<void(const StreamProgress&)> callback_;
+
+  DISALLOW_COPY_AND_ASSIGN(CallbackProgressListener);
+};
+
+std::unique_ptr<ProgressListener> CreateProgressListener(
+    const PackagingParams& packaging_params) {
+  return std::unique_ptr<ProgressListener>(
+      new CallbackProgressListener(packaging_params.progress_callback));
+}
+
+std::string GetStreamLabel(const StreamDescriptor& stream) {
+  return stream.input + ":" + stream.stream_selector;
+}
+
+std::string GetOutputLabel(const StreamDescriptor& stream) {
+  return stream.output.empty() ? stream.segment_template : stream.output;
 }
 
 std::unique_ptr<MediaHandler> CreateTextChunker(
@@ -521,7 +952,16 @@ Status CreateHlsTextJob(const StreamDescriptor& stream,
                          : nullptr;
   auto chunker = CreateTextChunker(packaging_params.chunking_params);
 
-  job_manager->Add("Segmented Text Job", demuxer);
+  const std::string label = GetStreamLabel(stream);
+  SetStatsName("TextPadder", label, padder.get());
+  SetStatsName("CueAlignmentHandler", label, cue_aligner.get());
+  SetStatsName("TextChunker", label, chunker.get());
+  SetStatsName("WebVttTextOutputHandler", GetOutputLabel(stream),
+               output.get());
+
+  // Text inputs are files, which end, so the text jobs of the many
+  // languages of a presentation share the worker threads.
+  job_manager->AddPooled("Segmented Text Job", demuxer, stream.input);
 
   return MediaHandler::Chain({std::move(padder), std::move(cue_aligner),
                               std::move(chunker), std::move(output)});
@@ -610,7 +1050,8 @@ Status CreateTextJobs(
 
       if (packaging_params.output_media_info) {
         VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
-            text_media_info, stream.output + kMediaInfoSuffix);
+            text_media_info, stream.output + kMediaInfoSuffix,
+            GetMediaInfoFileFormat(packaging_params));
       }
     }
   }
@@ -625,6 +1066,8 @@ Status CreateAudioVideoJobs(
     SyncPointQueue* sync_points,
     MuxerListenerFactory* muxer_listener_factory,
     MuxerFactory* muxer_factory,
+    LiveCheckpoint* live_checkpoint,
+    bool start_at_segment_boundary,
     JobManager* job_manager) {
   DCHECK(muxer_listener_factory);
   DCHECK(muxer_factory);
@@ -646,15 +1089,85 @@ Status CreateAudioVideoJobs(
     cue_aligners[stream.input] =
         sync_points ? std::make_shared<CueAlignmentHandler>(sync_points)
                     : nullptr;
+    SetStatsName("CueAlignmentHandler", stream.input,
+                 cue_aligners[stream.input].get());
+  }
+
+  // The inputs continue the timestamps of their streams in the checkpoint.
+  if (live_checkpoint) {
+    std::map<std::string, std::vector<std::string>> segment_templates;
+    for (const StreamDescriptor& stream : streams)
+      segment_templates[stream.input].push_back(stream.segment_template);
+    for (auto& source : sources) {
+      live_checkpoint->ResumeInput(segment_templates[source.first],
+                                   source.second);
+    }
+  }
+
+  // The inputs whose outputs are all trick play outputs only need their key
+  // frames.
+  std::map<std::string, bool> trick_play_inputs;
+  for (const StreamDescriptor& stream : streams) {
+    if (stream.output.empty() && stream.segment_template.empty())
+      continue;
+    auto trick_play_input = trick_play_inputs.emplace(stream.input, true);
+    if (!stream.trick_play_factor)
+      trick_play_input.first->second = false;
+  }
+  for (const auto& trick_play_input : trick_play_inputs) {
+    if (trick_play_input.second)
+      sources[trick_play_input.first]->set_key_frames_only(true);
   }
 
   for (auto& source : sources) {
-    job_manager->Add("RemuxJob", source.second);
+    job_manager->Add("RemuxJob", source.second, source.first);
+  }
+
+  // The outputs of an input stream share the chunking, and branch by the way
+  // they are encrypted: the encryption key of each branch, with the trick
+  // play factors of the branch in the order of the streams. A single trick
+  // play handler outputs all of them.
+  std::map<std::pair<std::string, std::string>,
+           std::map<std::string, std::vector<uint32_t>>>
+      encryption_branches;
+  for (const StreamDescriptor& stream : streams) {
+    if (stream.output.empty() && stream.segment_template.empty())
+      continue;
+    auto& trick_play_factors =
+        encryption_branches[{stream.input, stream.stream_selector}]
+                           [GetEncryptionKey(stream, encryption_key_source)];
+    if (stream.trick_play_factor)
+      trick_play_factors.push_back(stream.trick_play_factor);
+  }
+
+  // A stream is low priority in live scheduling if all its outputs are, the
+  // trick play outputs always being low priority.
+  std::map<std::pair<std::string, std::string>, bool> low_priority_streams;
+  for (const StreamDescriptor& stream : streams) {
+    if (stream.output.empty() && stream.segment_template.empty())
+      continue;
+    auto low_priority = low_priority_streams.emplace(
+        std::make_pair(stream.input, stream.stream_selector), true);
+    if (!stream.low_priority && !stream.trick_play_factor)
+      low_priority.first->second = false;
   }
 
-  // Replicators are shared among all streams with the same input and stream
-  // selector.
-  std::shared_ptr<MediaHandler> replicator;
+  // The last handler of the chunking of the current stream, which feeds all
+  // its encryption branches.
+  std::shared_ptr<MediaHandler> chunking_output;
+  // The lag of the current stream, if live scheduling is enabled, which is
+  // reported by its outputs.
+  std::shared_ptr<LiveStreamLag> stream_lag;
+  // Replicators and trick play handlers are shared among all streams with the
+  // same input, stream selector and encryption.
+  struct EncryptionBranch {
+    std::shared_ptr<MediaHandler> replicator;
+    std::shared_ptr<MediaHandler> trick_play;
+  };
+  std::map<std::string, EncryptionBranch> stream_branches;
+  // With multiplex_ts_streams, the TS muxers are shared among all streams with
+  // the same segment template.
+  std::map<std::string, std::shared_ptr<Muxer>> multiplexed_ts_muxers;
 
   std::string previous_input;
   std::string previous_selector;
@@ -678,9 +1191,13 @@ Status CreateAudioVideoJobs(
       continue;
     }
 
+    const std::string label = GetStreamLabel(stream);
+    const auto& branches =
+        encryption_branches[{stream.input, stream.stream_selector}];
+
     // Just because it is a different stream descriptor does not mean it is a
     // new stream. Multiple stream descriptors may have the same stream but
-    // only differ by trick play factor.
+    // only differ by trick play factor or encryption.
     if (new_stream) {
       if (!stream.language.empty()) {
         demuxer->SetLanguageOverride(stream.stream_selector, stream.language);
@@ -690,29 +1207,93 @@ Status CreateAudioVideoJobs(
       if (is_text) {
         handlers.emplace_back(
             std::make_shared<TextPadder>(kDefaultTextZeroBiasMs));
+        SetStatsName("TextPadder", label, handlers.back().get());
       }
       if (sync_points) {
         handlers.emplace_back(cue_aligner);
       }
+      // The cue aligner is shared by all the streams of an input, so the
+      // asynchronous edge is inserted after it.
+      if (packaging_params.async_queue_capacity > 0) {
+        handlers.emplace_back(std::make_shared<AsyncHandler>(
+            packaging_params.async_queue_capacity));
+        SetStatsName("AsyncHandler", label, handlers.back().get());
+      }
       if (is_text) {
         handlers.emplace_back(
             CreateTextChunker(packaging_params.chunking_params));
+        SetStatsName("TextChunker", label, handlers.back().get());
       } else {
-        handlers.emplace_back(std::make_shared<ChunkingHandler>(
-            packaging_params.chunking_params));
+        auto chunker =
+            std::make_shared<ChunkingHandler>(packaging_params.chunking_params);
+        chunker->set_start_at_segment_boundary(start_at_segment_boundary);
+        chunker->set_stream_label(label);
+        handlers.emplace_back(std::move(chunker));
+        SetStatsName("ChunkingHandler", label, handlers.back().get());
+      }
+      if (branches.size() > 1) {
+        handlers.emplace_back(std::make_shared<Replicator>());
+        SetStatsName("Replicator", label, handlers.back().get());
       }
-      handlers.emplace_back(CreateEncryptionHandler(packaging_params, stream,
-                                                    encryption_key_source));
-
-      replicator = std::make_shared<Replicator>();
-      handlers.emplace_back(replicator);
 
       RETURN_IF_ERROR(MediaHandler::Chain(handlers));
       RETURN_IF_ERROR(demuxer->SetHandler(stream.stream_selector, handlers[0]));
+      chunking_output = handlers.back();
+      stream_branches.clear();
+
+      stream_lag.reset();
+      if (LiveScheduler::GetInstance()->enabled()) {
+        stream_lag = LiveScheduler::GetInstance()->AddStream(
+            label,
+            low_priority_streams[{stream.input, stream.stream_selector}]);
+      }
+    }
+
+    const std::string encryption_key =
+        GetEncryptionKey(stream, encryption_key_source);
+    auto branch = stream_branches.find(encryption_key);
+    if (branch == stream_branches.end()) {
+      branch =
+          stream_branches.emplace(encryption_key, EncryptionBranch()).first;
+      std::shared_ptr<MediaHandler> encryption_handler =
+          CreateEncryptionHandler(packaging_params, stream,
+                                  encryption_key_source, stream_lag);
+      SetStatsName("EncryptionHandler", label, encryption_handler.get());
+
+      std::shared_ptr<MediaHandler>& replicator = branch->second.replicator;
+      replicator = std::make_shared<Replicator>();
+      SetStatsName("Replicator", label, replicator.get());
+      RETURN_IF_ERROR(MediaHandler::Chain(
+          {chunking_output, encryption_handler, replicator}));
+
+      // Trick play is optional. The key frames are selected once for all the
+      // trick play outputs of the branch.
+      const std::vector<uint32_t>& factors = branches.at(encryption_key);
+      if (!factors.empty()) {
+        std::shared_ptr<MediaHandler>& trick_play = branch->second.trick_play;
+        trick_play = std::make_shared<TrickPlayHandler>(
+            factors, packaging_params.trick_play_key_frame_interval);
+        SetStatsName("TrickPlayHandler", label, trick_play.get());
+        RETURN_IF_ERROR(replicator->AddHandler(trick_play));
+      }
     }
+    const std::shared_ptr<MediaHandler>& replicator = branch->second.replicator;
+    const std::shared_ptr<MediaHandler>& trick_play = branch->second.trick_play;
 
-    // Create the muxer (output) for this track.
+    // Create the muxer (output) for this track, unless it is muxed into the
+    // output of a previous track. The shared muxer notifies the manifests with
+    // the listener of the first track.
     const auto output_format = GetOutputFormat(stream);
+    const bool multiplexed = packaging_params.multiplex_ts_streams &&
+                             output_format == CONTAINER_MPEG2TS;
+    if (multiplexed) {
+      auto shared_muxer = multiplexed_ts_muxers.find(stream.segment_template);
+      if (shared_muxer != multiplexed_ts_muxers.end()) {
+        RETURN_IF_ERROR(
+            MediaHandler::Chain({replicator, shared_muxer->second}));
+        continue;
+      }
+    }
     std::shared_ptr<Muxer> muxer =
         muxer_factory->CreateMuxer(output_format, stream);
     if (!muxer) {
@@ -720,17 +1301,31 @@ Status CreateAudioVideoJobs(
                                                  stream.input + ":" +
                                                  stream.stream_selector);
     }
+    if (multiplexed)
+      multiplexed_ts_muxers[stream.segment_template] = muxer;
 
     std::unique_ptr<MuxerListener> muxer_listener =
         muxer_listener_factory->CreateListener(ToMuxerListenerData(stream));
+    // The trick play outputs are published along with the stream.
+    const bool report_lag = stream_lag && !stream.trick_play_factor;
+    if (report_lag || packaging_params.output_segment_report) {
+      std::unique_ptr<CombinedMuxerListener> combined_listener(
+          new CombinedMuxerListener);
+      combined_listener->AddListener(std::move(muxer_listener));
+      if (report_lag) {
+        combined_listener->AddListener(std::unique_ptr<MuxerListener>(
+            new LiveLagMuxerListener(stream_lag)));
+      }
+      // Last, so that the segments are reported once published.
+      if (packaging_params.output_segment_report) {
+        combined_listener->AddListener(std::unique_ptr<MuxerListener>(
+            new SegmentReportMuxerListener(GetMediaInfoOutput(stream) +
+                                           kSegmentReportSuffix)));
+      }
+      muxer_listener = std::move(combined_listener);
+    }
     muxer->SetMuxerListener(std::move(muxer_listener));
 
-    // Trick play is optional.
-    std::shared_ptr<MediaHandler> trick_play =
-        stream.trick_play_factor
-            ? std::make_shared<TrickPlayHandler>(stream.trick_play_factor)
-            : nullptr;
-
     // TODO(modmaker): Move to MOV muxer?
     const auto input_container = DetermineContainerFromFileName(stream.input);
     auto text_to_mp4 =
@@ -738,13 +1333,373 @@ Status CreateAudioVideoJobs(
             ? std::make_shared<WebVttToMp4Handler>()
             : nullptr;
 
-    RETURN_IF_ERROR(
-        MediaHandler::Chain({replicator, trick_play, text_to_mp4, muxer}));
+    // Run each output on its own thread if requested. The replicator and the
+    // trick play handler pass the same samples to all the outputs, which do
+    // not modify them.
+    std::shared_ptr<MediaHandler> output_queue =
+        packaging_params.output_queue_capacity > 0
+            ? std::make_shared<AsyncHandler>(
+                  packaging_params.output_queue_capacity)
+            : nullptr;
+
+    const std::string output_label = GetOutputLabel(stream);
+    SetStatsName("AsyncHandler", output_label, output_queue.get());
+    SetStatsName("WebVttToMp4Handler", output_label, text_to_mp4.get());
+    SetStatsName("Muxer", output_label, muxer.get());
+    if (packaging_params.progress_callback)
+      muxer->SetProgressListener(CreateProgressListener(packaging_params));
+
+    // The outputs of the trick play handler are in the order of the trick
+    // play streams.
+    RETURN_IF_ERROR(MediaHandler::Chain(
+        {stream.trick_play_factor ? trick_play : replicator, output_queue,
+         text_to_mp4, muxer}));
   }
 
   return Status::OK;
 }
 
+// @return true if the fragments of the input of |stream| can be copied to its
+//         output as they are, see Mp4OutputParams.fragment_passthrough.
+bool CanPassThroughFragments(const StreamDescriptor& stream,
+                             const PackagingParams& packaging_params,
+                             KeySource* encryption_key_source) {
+  const ChunkingParams& chunking_params = packaging_params.chunking_params;
+  if (base::StartsWith(stream.input, kPushInputPrefix,
+                       base::CompareCase::SENSITIVE) ||
+      base::StartsWith(stream.input, kSyntheticInputPrefix,
+                       base::CompareCase::SENSITIVE) ||
+      GetOutputFormat(stream) != CONTAINER_MOV || stream.output.empty() ||
+      stream.segment_template.empty() || stream.trick_play_factor > 0 ||
+      stream.start_time > 0 || stream.end_time > 0 ||
+      !stream.language.empty() ||
+      (encryption_key_source && !stream.skip_encryption) ||
+      packaging_params.decryption_params.key_provider != KeyProvider::kNone ||
+      !chunking_params.segment_sap_aligned ||
+      chunking_params.low_latency_chunk_num_frames > 0 ||
+      chunking_params.low_latency_chunk_duration_in_seconds > 0) {
+    return false;
+  }
+  return FragmentPassthrough::CanPassThrough(stream.input,
+                                             stream.stream_selector);
+}
+
+// Create a passthrough job for each stream whose fragments can be copied from
+// its input, which must not be shared with other streams. The other streams
+// are added to |remaining_streams|.
+Status CreateFragmentPassthroughJobs(
+    const std::vector<std::reference_wrapper<const StreamDescriptor>>& streams,
+    const PackagingParams& packaging_params,
+    KeySource* encryption_key_source,
+    MuxerListenerFactory* muxer_listener_factory,
+    JobManager* job_manager,
+    std::vector<std::reference_wrapper<const StreamDescriptor>>*
+        remaining_streams) {
+  std::map<std::string, size_t> num_streams_per_input;
+  for (const StreamDescriptor& stream : streams)
+    ++num_streams_per_input[stream.input];
+
+  for (const StreamDescriptor& stream : streams) {
+    if (num_streams_per_input[stream.input] != 1 ||
+        !CanPassThroughFragments(stream, packaging_params,
+                                 encryption_key_source)) {
+      remaining_streams->push_back(stream);
+      continue;
+    }
+    VLOG(1) << "Passing through the fragments of " << stream.input;
+
+    auto passthrough = std::make_shared<FragmentPassthrough>(
+        stream.input, CreateMuxerOptions(stream, packaging_params));
+    passthrough->SetMuxerListener(
+        muxer_listener_factory->CreateListener(ToMuxerListenerData(stream)));
+    SetStatsName("FragmentPassthrough", GetOutputLabel(stream),
+                 passthrough.get());
+    job_manager->Add("PassthroughJob", passthrough, stream.input);
+  }
+  return Status::OK;
+}
+
+// @return the time slices |stream| is packaged in, see
+//         PackagingParams.num_vod_time_slices, or an empty vector if it is
+//         packaged as a whole.
+std::vector<TimeSlice> GetTimeSlices(const StreamDescriptor& stream,
+                                     const PackagingParams& packaging_params,
+                                     KeySource* encryption_key_source) {
+  const ChunkingParams& chunking_params = packaging_params.chunking_params;
+  const bool has_subsegments =
+      chunking_params.subsegment_duration_in_seconds > 0 &&
+      chunking_params.subsegment_duration_in_seconds !=
+          chunking_params.segment_duration_in_seconds;
+  if (GetOutputFormat(stream) != CONTAINER_MOV || stream.output.empty() ||
+      stream.segment_template.empty() || stream.trick_play_factor > 0 ||
+      stream.start_time > 0 || stream.end_time > 0 ||
+      (encryption_key_source && !stream.skip_encryption) ||
+      packaging_params.decryption_params.key_provider != KeyProvider::kNone ||
+      has_subsegments || chunking_params.low_latency_chunk_num_frames > 0 ||
+      chunking_params.low_latency_chunk_duration_in_seconds > 0 ||
+      !File::IsLocalRegularFile(stream.input.c_str())) {
+    return std::vector<TimeSlice>();
+  }
+  std::unique_ptr<SampleIndex> sample_index = SampleIndex::Read(stream.input);
+  if (!sample_index || sample_index->tracks().size() != 1)
+    return std::vector<TimeSlice>();
+  const auto& track = *sample_index->tracks().begin();
+  return SplitIntoTimeSlices(track.second,
+                             sample_index->GetTimeScale(track.first),
+                             chunking_params,
+                             packaging_params.num_vod_time_slices);
+}
+
+// Create a job for each time slice of each stream which can be packaged in
+// time slices, whose input must not be shared with other streams. The other
+// streams are added to |remaining_streams|.
+Status CreateTimeSliceJobs(
+    const std::vector<std::reference_wrapper<const StreamDescriptor>>& streams,
+    const PackagingParams& packaging_params,
+    KeySource* encryption_key_source,
+    MuxerListenerFactory* muxer_listener_factory,
+    MuxerFactory* muxer_factory,
+    JobManager* job_manager,
+    std::vector<std::reference_wrapper<const StreamDescriptor>>*
+        remaining_streams) {
+  std::map<std::string, size_t> num_streams_per_input;
+  for (const StreamDescriptor& stream : streams)
+    ++num_streams_per_input[stream.input];
+
+  for (const StreamDescriptor& stream : streams) {
+    const std::vector<TimeSlice> time_slices =
+        num_streams_per_input[stream.input] == 1
+            ? GetTimeSlices(stream, packaging_params, encryption_key_source)
+            : std::vector<TimeSlice>();
+    if (time_slices.empty()) {
+      remaining_streams->push_back(stream);
+      continue;
+    }
+    LOG(INFO) << "Packaging " << stream.input << " in " << time_slices.size()
+              << " time slices.";
+
+    // The listeners of the slices pass the events of the slices on to the
+    // listener of the stream as if the stream was muxed as a whole.
+    std::vector<std::unique_ptr<MuxerListener>> slice_listeners =
+        TimeSliceMuxerListener::CreateSliceListeners(
+            muxer_listener_factory->CreateListener(ToMuxerListenerData(stream)),
+            time_slices.size());
+    for (size_t i = 0; i < time_slices.size(); ++i) {
+      const TimeSlice& time_slice = time_slices[i];
+      std::shared_ptr<Demuxer> demuxer;
+      RETURN_IF_ERROR(CreateDemuxer(stream, packaging_params, &demuxer));
+      demuxer->set_use_sample_index(true);
+      demuxer->set_decode_time_range(time_slice.start_decode_time,
+                                     time_slice.end_decode_time);
+      if (!stream.language.empty())
+        demuxer->SetLanguageOverride(stream.stream_selector, stream.language);
+
+      std::shared_ptr<MediaHandler> chunker =
+          std::make_shared<ChunkingHandler>(packaging_params.chunking_params);
+      std::shared_ptr<Muxer> muxer = muxer_factory->CreateTimeSliceMuxer(
+          CONTAINER_MOV, stream, time_slice.first_segment_index);
+      if (!muxer) {
+        return Status(error::INVALID_ARGUMENT, "Failed to create muxer for " +
+                                                   stream.input + ":" +
+                                                   stream.stream_selector);
+      }
+      muxer->SetMuxerListener(std::move(slice_listeners[i]));
+
+      const std::string label =
+          GetOutputLabel(stream) + ":slice" + base::SizeTToString(i);
+      SetStatsName("ChunkingHandler", label, chunker.get());
+      SetStatsName("Muxer", label, muxer.get());
+      if (packaging_params.progress_callback)
+        muxer->SetProgressListener(CreateProgressListener(packaging_params));
+      RETURN_IF_ERROR(MediaHandler::Chain({chunker, muxer}));
+      RETURN_IF_ERROR(demuxer->SetHandler(stream.stream_selector, chunker));
+      job_manager->Add("TimeSliceJob", demuxer, stream.input);
+    }
+  }
+  return Status::OK;
+}
+
+// Discards the samples of an input which is only demuxed to index it.
+class DiscardingHandler : public MediaHandler {
+ public:
+  DiscardingHandler() = default;
+
+ protected:
+  Status InitializeInternal() override { return Status::OK; }
+  Status Process(std::unique_ptr<StreamData> stream_data) override {
+    return Status::OK;
+  }
+  Status OnFlushRequest(size_t input_stream_index) override {
+    return Status::OK;
+  }
+
+ private:
+  DiscardingHandler(const DiscardingHandler&) = delete;
+  DiscardingHandler& operator=(const DiscardingHandler&) = delete;
+};
+
+// Read the sample index of the input of |stream|, which must have a single
+// track. The input is indexed first if its index is missing or out of date.
+Status ReadSingleTrackSampleIndex(const StreamDescriptor& stream,
+                                  std::unique_ptr<SampleIndex>* index) {
+  std::unique_ptr<SampleIndex>& sample_index = *index;
+  sample_index = SampleIndex::Read(stream.input);
+  if (!sample_index) {
+    LOG(INFO) << "Indexing " << stream.input << ".";
+    std::shared_ptr<Demuxer> demuxer = std::make_shared<Demuxer>(stream.input);
+    demuxer->set_use_sample_index(true);
+    RETURN_IF_ERROR(demuxer->SetHandler(stream.stream_selector,
+                                        std::make_shared<DiscardingHandler>()));
+    RETURN_IF_ERROR(demuxer->Initialize());
+    RETURN_IF_ERROR(demuxer->Run());
+    sample_index = SampleIndex::Read(stream.input);
+    if (!sample_index) {
+      return Status(error::FILE_FAILURE,
+                    "Failed to index " + stream.input +
+                        ", which must be an MP4 file.");
+    }
+  }
+  if (sample_index->tracks().size() != 1 ||
+      sample_index->tracks().begin()->second.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Time slicing requires single track inputs: " +
+                      stream.input);
+  }
+  return Status::OK;
+}
+
+// @return a time slice with all the samples of a stream.
+TimeSlice WholeStreamTimeSlice() {
+  TimeSlice whole_stream;
+  whole_stream.start_decode_time = std::numeric_limits<int64_t>::min();
+  whole_stream.end_decode_time = std::numeric_limits<int64_t>::max();
+  whole_stream.num_segments = 1;
+  return whole_stream;
+}
+
+// Get the time slices of the segments of |stream|, which is packaged just in
+// time, from the sample index of its input.
+Status GetJitSegments(const StreamDescriptor& stream,
+                      const PackagingParams& packaging_params,
+                      std::vector<TimeSlice>* segments) {
+  std::unique_ptr<SampleIndex> sample_index;
+  RETURN_IF_ERROR(ReadSingleTrackSampleIndex(stream, &sample_index));
+
+  const auto& track = *sample_index->tracks().begin();
+  // One segment per slice.
+  *segments = SplitIntoTimeSlices(
+      track.second, sample_index->GetTimeScale(track.first),
+      packaging_params.chunking_params, track.second.size());
+  if (segments->empty()) {
+    // A single segment is not split.
+    segments->push_back(WholeStreamTimeSlice());
+  }
+  return Status::OK;
+}
+
+// Package the segment of |stream| in the time slice |segment| of its input,
+// with the init segment of the stream if it is the first segment.
+Status PackageJitSegment(const StreamDescriptor& stream,
+                         const TimeSlice& segment,
+                         const PackagingParams& packaging_params,
+                         KeySource* encryption_key_source,
+                         MuxerFactory* muxer_factory) {
+  std::shared_ptr<Demuxer> demuxer;
+  RETURN_IF_ERROR(CreateDemuxer(stream, packaging_params, &demuxer));
+  demuxer->set_use_sample_index(true);
+  demuxer->set_decode_time_range(segment.start_decode_time,
+                                 segment.end_decode_time);
+  if (!stream.language.empty())
+    demuxer->SetLanguageOverride(stream.stream_selector, stream.language);
+
+  std::shared_ptr<MediaHandler> chunker =
+      std::make_shared<ChunkingHandler>(packaging_params.chunking_params);
+  std::shared_ptr<MediaHandler> encryption_handler = CreateEncryptionHandler(
+      packaging_params, stream, encryption_key_source, nullptr);
+  std::shared_ptr<Muxer> muxer = muxer_factory->CreateTimeSliceMuxer(
+      GetOutputFormat(stream), stream, segment.first_segment_index);
+  if (!muxer) {
+    return Status(error::INVALID_ARGUMENT, "Failed to create muxer for " +
+                                               stream.input + ":" +
+                                               stream.stream_selector);
+  }
+  RETURN_IF_ERROR(MediaHandler::Chain({chunker, encryption_handler, muxer}));
+  RETURN_IF_ERROR(demuxer->SetHandler(stream.stream_selector, chunker));
+  RETURN_IF_ERROR(demuxer->Initialize());
+  return demuxer->Run();
+}
+
+// Create a job packaging the time shard PackagingParams.vod_time_shard_index
+// of each stream. The shards of a stream are time slices of its input, from
+// the sample index of the input.
+Status CreateTimeShardJobs(
+    const std::vector<std::reference_wrapper<const StreamDescriptor>>& streams,
+    const PackagingParams& packaging_params,
+    KeySource* encryption_key_source,
+    MuxerListenerFactory* muxer_listener_factory,
+    MuxerFactory* muxer_factory,
+    JobManager* job_manager) {
+  const uint32_t shard_index = packaging_params.vod_time_shard_index;
+  for (const StreamDescriptor& stream : streams) {
+    std::unique_ptr<SampleIndex> sample_index;
+    RETURN_IF_ERROR(ReadSingleTrackSampleIndex(stream, &sample_index));
+    const auto& track = *sample_index->tracks().begin();
+    std::vector<TimeSlice> shards = SplitIntoTimeSlices(
+        track.second, sample_index->GetTimeScale(track.first),
+        packaging_params.chunking_params,
+        packaging_params.num_vod_time_shards);
+    if (shards.empty())
+      shards.push_back(WholeStreamTimeSlice());
+    if (shard_index >= shards.size()) {
+      LOG(INFO) << stream.input << " has only " << shards.size()
+                << " time shards, skipping.";
+      continue;
+    }
+    const TimeSlice& shard = shards[shard_index];
+
+    std::shared_ptr<Demuxer> demuxer;
+    RETURN_IF_ERROR(CreateDemuxer(stream, packaging_params, &demuxer));
+    demuxer->set_use_sample_index(true);
+    demuxer->set_decode_time_range(shard.start_decode_time,
+                                   shard.end_decode_time);
+    if (!stream.language.empty())
+      demuxer->SetLanguageOverride(stream.stream_selector, stream.language);
+
+    std::shared_ptr<MediaHandler> chunker =
+        std::make_shared<ChunkingHandler>(packaging_params.chunking_params);
+    std::shared_ptr<MediaHandler> encryption_handler = CreateEncryptionHandler(
+        packaging_params, stream, encryption_key_source, nullptr);
+    std::shared_ptr<Muxer> muxer = muxer_factory->CreateTimeShardMuxer(
+        GetOutputFormat(stream), stream, shard.first_segment_index,
+        shard_index, shards.size());
+    if (!muxer) {
+      return Status(error::INVALID_ARGUMENT, "Failed to create muxer for " +
+                                                 stream.input + ":" +
+                                                 stream.stream_selector);
+    }
+    // The shards of a stream are packaged on different machines, each writing
+    // a MediaInfo file of its own.
+    MuxerListenerFactory::StreamData listener_data =
+        ToMuxerListenerData(stream);
+    listener_data.media_info_output +=
+        ".shard" + base::UintToString(shard_index);
+    muxer->SetMuxerListener(
+        muxer_listener_factory->CreateListener(listener_data));
+
+    const std::string label =
+        GetOutputLabel(stream) + ":shard" + base::UintToString(shard_index);
+    SetStatsName("ChunkingHandler", label, chunker.get());
+    SetStatsName("EncryptionHandler", label, encryption_handler.get());
+    SetStatsName("Muxer", label, muxer.get());
+    if (packaging_params.progress_callback)
+      muxer->SetProgressListener(CreateProgressListener(packaging_params));
+    RETURN_IF_ERROR(MediaHandler::Chain({chunker, encryption_handler, muxer}));
+    RETURN_IF_ERROR(demuxer->SetHandler(stream.stream_selector, chunker));
+    job_manager->Add("TimeShardJob", demuxer, stream.input);
+  }
+  return Status::OK;
+}
+
 Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
                      const PackagingParams& packaging_params,
                      MpdNotifier* mpd_notifier,
@@ -752,6 +1707,7 @@ Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
                      SyncPointQueue* sync_points,
                      MuxerListenerFactory* muxer_listener_factory,
                      MuxerFactory* muxer_factory,
+                     LiveCheckpoint* live_checkpoint,
                      JobManager* job_manager) {
   DCHECK(muxer_factory);
   DCHECK(muxer_listener_factory);
@@ -815,26 +1771,312 @@ Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
                                    muxer_factory, mpd_notifier, job_manager));
   }
 
+  if (packaging_params.num_vod_time_shards > 0) {
+    RETURN_IF_ERROR(CreateTimeShardJobs(
+        audio_video_streams, packaging_params, encryption_key_source,
+        muxer_listener_factory, muxer_factory, job_manager));
+    return job_manager->InitializeJobs();
+  }
+
+  // Passthrough does not take part in cue alignment.
+  if (packaging_params.mp4_output_params.fragment_passthrough && !sync_points) {
+    std::vector<std::reference_wrapper<const StreamDescriptor>>
+        remaining_streams;
+    RETURN_IF_ERROR(CreateFragmentPassthroughJobs(
+        audio_video_streams, packaging_params, encryption_key_source,
+        muxer_listener_factory, job_manager, &remaining_streams));
+    audio_video_streams.swap(remaining_streams);
+  }
+
+  // Time slices do not take part in cue alignment either.
+  if (packaging_params.num_vod_time_slices > 1 && !sync_points) {
+    std::vector<std::reference_wrapper<const StreamDescriptor>>
+        remaining_streams;
+    RETURN_IF_ERROR(CreateTimeSliceJobs(
+        audio_video_streams, packaging_params, encryption_key_source,
+        muxer_listener_factory, muxer_factory, job_manager,
+        &remaining_streams));
+    audio_video_streams.swap(remaining_streams);
+  }
+
   RETURN_IF_ERROR(CreateAudioVideoJobs(
       audio_video_streams, packaging_params, encryption_key_source, sync_points,
-      muxer_listener_factory, muxer_factory, job_manager));
+      muxer_listener_factory, muxer_factory, live_checkpoint,
+      /* start_at_segment_boundary */ packaging_params.deterministic_output,
+      job_manager));
 
   // Initialize processing graph.
   return job_manager->InitializeJobs();
 }
 
+std::string HandlerStatsToJson(const std::vector<HandlerStats>& stats) {
+  std::string json = "{\"handlers\":[";
+  for (size_t i = 0; i < stats.size(); ++i) {
+    const HandlerStats& handler_stats = stats[i];
+    std::string name;
+    for (char c : handler_stats.name) {
+      if (c == '"' || c == '\\')
+        name += '\\';
+      name += c;
+    }
+    base::StringAppendF(
+        &json,
+        "%s{\"name\":\"%s\",\"stream_infos\":%" PRIu64
+        ",\"media_samples\":%" PRIu64 ",\"text_samples\":%" PRIu64
+        ",\"segment_infos\":%" PRIu64 ",\"scte35_events\":%" PRIu64
+        ",\"cue_events\":%" PRIu64 ",\"sample_bytes\":%" PRIu64
+        ",\"queued_bytes\":%" PRIu64 ",\"process_time_us\":%" PRIu64 "}",
+        i == 0 ? "" : ",", name.c_str(), handler_stats.num_stream_infos,
+        handler_stats.num_media_samples, handler_stats.num_text_samples,
+        handler_stats.num_segment_infos, handler_stats.num_scte35_events,
+        handler_stats.num_cue_events, handler_stats.sample_bytes,
+        handler_stats.queued_bytes, handler_stats.process_time_us);
+  }
+  json += "]}";
+  return json;
+}
+
+// Log the statistics of the handlers of |job_manager| every |interval| until
+// |stop| is signaled.
+void LogStatsPeriodically(const JobManager* job_manager,
+                          base::TimeDelta interval,
+                          base::WaitableEvent* stop) {
+  while (!stop->TimedWait(interval)) {
+    LOG(INFO) << "Pipeline stats: "
+              << HandlerStatsToJson(job_manager->GetHandlerStats());
+  }
+}
+
+// Write |live_checkpoint| every |interval| until |stop| is signaled.
+void WriteCheckpointPeriodically(LiveCheckpoint* live_checkpoint,
+                                 base::TimeDelta interval,
+                                 base::WaitableEvent* stop) {
+  while (!stop->TimedWait(interval)) {
+    const Status status = live_checkpoint->Write();
+    if (!status.ok())
+      LOG(WARNING) << status;
+  }
+}
+
+// Report the statistics of the handlers of |job_manager| as counters labeled
+// with the handler type and its stream or output.
+void ExportHandlerStats(const JobManager* job_manager,
+                        Metrics::Writer* writer) {
+  for (const HandlerStats& stats : job_manager->GetHandlerStats()) {
+    const size_t separator = stats.name.find(':');
+    Metrics::Labels labels;
+    labels["handler"] = stats.name.substr(0, separator);
+    if (separator != std::string::npos)
+      labels["stream"] = stats.name.substr(separator + 1);
+
+    writer->Add("packager_handler_media_samples_total",
+                Metrics::Type::kCounter,
+                "Media samples received by the handler.", labels,
+                static_cast<double>(stats.num_media_samples));
+    writer->Add("packager_handler_text_samples_total", Metrics::Type::kCounter,
+                "Text samples received by the handler.", labels,
+                static_cast<double>(stats.num_text_samples));
+    writer->Add("packager_handler_segments_total", Metrics::Type::kCounter,
+                "Segments received by the handler.", labels,
+                static_cast<double>(stats.num_segment_infos));
+    writer->Add("packager_handler_sample_bytes_total",
+                Metrics::Type::kCounter,
+                "Bytes of the samples received by the handler.", labels,
+                static_cast<double>(stats.sample_bytes));
+    writer->Add("packager_handler_queued_bytes", Metrics::Type::kGauge,
+                "Bytes of the samples held by the handler.", labels,
+                static_cast<double>(stats.queued_bytes));
+    writer->Add("packager_handler_process_seconds_total",
+                Metrics::Type::kCounter,
+                "Estimated time spent in the handler, excluding downstream "
+                "handlers.",
+                labels, stats.process_time_us / 1e6);
+  }
+}
+
+// Exports the handler statistics to the metrics registry during its lifetime.
+class ScopedHandlerStatsExport {
+ public:
+  explicit ScopedHandlerStatsExport(const JobManager* job_manager)
+      : collector_id_(Metrics::GetInstance()->AddCollector(
+            std::bind(&ExportHandlerStats, job_manager,
+                      std::placeholders::_1))) {}
+
+  ~ScopedHandlerStatsExport() {
+    Metrics::GetInstance()->RemoveCollector(collector_id_);
+  }
+
+ private:
+  ScopedHandlerStatsExport(const ScopedHandlerStatsExport&) = delete;
+  ScopedHandlerStatsExport& operator=(const ScopedHandlerStatsExport&) =
+      delete;
+
+  const int collector_id_;
+};
+
+// Records the spans of the pipeline during its lifetime, then writes them to
+// |trace_output|.
+class ScopedTraceRecording {
+ public:
+  explicit ScopedTraceRecording(const std::string& trace_output)
+      : trace_output_(trace_output) {
+    TraceRecorder::GetInstance()->Start();
+  }
+
+  ~ScopedTraceRecording() {
+    TraceRecorder* recorder = TraceRecorder::GetInstance();
+    recorder->Stop();
+    if (!File::WriteStringToFile(trace_output_.c_str(),
+                                 recorder->ExportJson())) {
+      LOG(ERROR) << "Failed to write the trace to " << trace_output_;
+    }
+  }
+
+ private:
+  ScopedTraceRecording(const ScopedTraceRecording&) = delete;
+  ScopedTraceRecording& operator=(const ScopedTraceRecording&) = delete;
+
+  const std::string trace_output_;
+};
+
+// Find the PushInput of |input| in |push_inputs|, which is NULL if the
+// packager is not initialized. |lock| protects |push_inputs|.
+Status GetPushInput(
+    const std::map<std::string, std::unique_ptr<PushInput>>* push_inputs,
+    base::Lock* lock,
+    const std::string& input,
+    PushInput** push_input) {
+  if (!push_inputs)
+    return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
+  base::AutoLock auto_lock(*lock);
+  auto iter = push_inputs->find(input);
+  if (iter == push_inputs->end())
+    return Status(error::NOT_FOUND, "Not a push input: " + input);
+  *push_input = iter->second.get();
+  return Status::OK;
+}
+
 }  // namespace
 }  // namespace media
 
 struct Packager::PackagerInternal {
+  // Copy |descriptors| to |streams_for_jobs| with the names of the inputs and
+  // the outputs the jobs use, and the languages in ISO-639-2. |lock| must be
+  // held.
+  Status PrepareStreams(const std::vector<StreamDescriptor>& descriptors,
+                        std::vector<StreamDescriptor>* streams_for_jobs);
+
   media::FakeClock fake_clock;
   std::unique_ptr<KeySource> encryption_key_source;
+  // Outlives the notifiers which publish to it.
+  std::unique_ptr<ManifestEventPublisher> manifest_event_publisher;
   std::unique_ptr<MpdNotifier> mpd_notifier;
   std::unique_ptr<hls::HlsNotifier> hls_notifier;
   BufferCallbackParams buffer_callback_params;
+  // Outlives the listeners of the jobs, and is outlived by the notifiers.
+  std::unique_ptr<media::MuxerListenerQueue> muxer_listener_queue;
+  // The inputs whose data is pushed, by input name. They outlive the jobs.
+  std::map<std::string, std::unique_ptr<media::PushInput>> push_inputs;
   std::unique_ptr<media::JobManager> job_manager;
+  // Outlived by the notifiers it wraps.
+  std::unique_ptr<media::LiveCheckpoint> live_checkpoint;
+  // Writes the fingerprints of the outputs once they are packaged, see
+  // PackagingParams.incremental_packaging.
+  std::unique_ptr<media::IncrementalPackaging> incremental_packaging;
+  double live_checkpoint_interval_in_seconds = 0;
+  double stats_log_interval_in_seconds = 0;
+  uint16_t metrics_port = 0;
+  std::string metrics_address;
+  uint16_t origin_port = 0;
+  std::string trace_output;
+
+  // The params and the factories of the session, for the streams added while
+  // it runs. The listener factory continues the names of the playlists.
+  PackagingParams packaging_params;
+  std::unique_ptr<media::MuxerFactory> muxer_factory;
+  std::unique_ptr<media::MuxerListenerFactory> muxer_listener_factory;
+  // Protects the push inputs and the streams below, which change while the
+  // session runs.
+  base::Lock lock;
+  // The stream descriptors of the session, including the removed ones, whose
+  // inputs, outputs and segment templates are not used again.
+  std::vector<StreamDescriptor> stream_descriptors;
+  // The copies of the stream descriptors passed to the jobs, by input.
+  std::map<std::string, std::vector<StreamDescriptor>> input_streams;
+  std::set<std::string> removed_inputs;
+
+  // The streams packaged just in time, see PackagingParams.jit_packaging,
+  // with the time slice of each of their segments.
+  struct JitStream {
+    StreamDescriptor stream;
+    std::vector<media::TimeSlice> segments;
+  };
+  // The packaging of a segment, which the requests of the segment wait for.
+  struct JitRequest {
+    bool done = false;
+    Status status;
+  };
+  std::vector<JitStream> jit_streams;
+  // The stream and the segment indexes of the outputs packaged just in time,
+  // by file name.
+  std::map<std::string, std::pair<size_t, uint32_t>> jit_files;
+  // The segments being packaged, by stream and segment index. Protected by
+  // |lock|, and signaled when a segment is packaged.
+  std::map<std::pair<size_t, uint32_t>, std::shared_ptr<JitRequest>>
+      jit_requests;
+  base::ConditionVariable jit_segment_packaged{&lock};
+  // Signaled by Cancel(), which ends Run() in just in time packaging.
+  base::WaitableEvent jit_cancelled{
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED};
 };
 
+Status Packager::PackagerInternal::PrepareStreams(
+    const std::vector<StreamDescriptor>& descriptors,
+    std::vector<StreamDescriptor>* streams_for_jobs) {
+  lock.AssertAcquired();
+  for (const StreamDescriptor& descriptor : descriptors) {
+    // We may need to overwrite some values, so make a copy first.
+    StreamDescriptor copy = descriptor;
+
+    if (base::StartsWith(descriptor.input, media::kPushInputPrefix,
+                         base::CompareCase::SENSITIVE)) {
+      std::unique_ptr<media::PushInput>& push_input =
+          push_inputs[descriptor.input];
+      if (!push_input)
+        push_input.reset(new media::PushInput(media::kMaxQueuedPushedBuffers));
+      copy.input =
+          media::PushInput::MakeInputName(*push_input, descriptor.input);
+    } else if (buffer_callback_params.read_func &&
+               !base::StartsWith(descriptor.input,
+                                 media::kSyntheticInputPrefix,
+                                 base::CompareCase::SENSITIVE)) {
+      copy.input =
+          File::MakeCallbackFileName(buffer_callback_params, descriptor.input);
+    }
+
+    if (buffer_callback_params.write_func) {
+      copy.output =
+          File::MakeCallbackFileName(buffer_callback_params, descriptor.output);
+      copy.segment_template = File::MakeCallbackFileName(
+          buffer_callback_params, descriptor.segment_template);
+    }
+
+    // Update language to ISO_639_2 code if set.
+    if (!copy.language.empty()) {
+      copy.language = LanguageToISO_639_2(descriptor.language);
+      if (copy.language == "und") {
+        return Status(
+            error::INVALID_ARGUMENT,
+            "Unknown/invalid language specified: " + descriptor.language);
+      }
+    }
+
+    streams_for_jobs->push_back(copy);
+  }
+  return Status::OK;
+}
+
 Packager::Packager() {}
 
 Packager::~Packager() {}
@@ -842,12 +2084,30 @@ Packager::~Packager() {}
 Status Packager::Initialize(
     const PackagingParams& packaging_params,
     const std::vector<StreamDescriptor>& stream_descriptors) {
-  // Needed by base::WorkedPool used in ThreadedIoFile.
-  static base::AtExitManager exit;
-  static media::LibcryptoThreading libcrypto_threading;
-
   if (internal_)
     return Status(error::INVALID_ARGUMENT, "Already initialized.");
+  return InitializeSession(packaging_params, stream_descriptors, nullptr);
+}
+
+Status Packager::Reinitialize(
+    const std::vector<StreamDescriptor>& stream_descriptors) {
+  if (!internal_)
+    return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
+  const PackagingParams packaging_params = internal_->packaging_params;
+  // The rest of the previous session, e.g. its notifiers, is released before
+  // the new session writes to the same outputs.
+  PackagerInternal previous;
+  previous.encryption_key_source = std::move(internal_->encryption_key_source);
+  internal_.reset();
+  return InitializeSession(packaging_params, stream_descriptors, &previous);
+}
+
+Status Packager::InitializeSession(
+    const PackagingParams& packaging_params,
+    const std::vector<StreamDescriptor>& stream_descriptors,
+    PackagerInternal* previous) {
+  // Needed by base::WorkedPool used in ThreadedIoFile.
+  static base::AtExitManager exit;
 
   RETURN_IF_ERROR(media::ValidateParams(packaging_params, stream_descriptors));
 
@@ -858,15 +2118,40 @@ Status Packager::Initialize(
 
   std::unique_ptr<PackagerInternal> internal(new PackagerInternal);
 
+  // Only the key sources, the encryptors and the decryptors use libcrypto, so
+  // clear content is packaged without setting up its threading.
+  if (packaging_params.encryption_params.key_provider != KeyProvider::kNone ||
+      packaging_params.decryption_params.key_provider != KeyProvider::kNone) {
+    static media::LibcryptoThreading libcrypto_threading;
+  }
+
   // Create encryption key source if needed.
-  if (packaging_params.encryption_params.key_provider != KeyProvider::kNone) {
-    internal->encryption_key_source = CreateEncryptionKeySource(
-        static_cast<media::FourCC>(
-            packaging_params.encryption_params.protection_scheme),
-        packaging_params.encryption_params);
-    if (!internal->encryption_key_source)
-      return Status(error::INVALID_ARGUMENT, "Failed to create key source.");
+  media::DeferredKeySource* deferred_key_source = nullptr;
+  if (previous && previous->encryption_key_source) {
+    internal->encryption_key_source =
+        std::move(previous->encryption_key_source);
+  } else if (packaging_params.encryption_params.key_provider !=
+             KeyProvider::kNone) {
+    // The keys are fetched while the rest of the session is set up, which
+    // only needs to know whether there is a key source, and waited for
+    // before returning.
+    const EncryptionParams& encryption_params =
+        packaging_params.encryption_params;
+    deferred_key_source = new media::DeferredKeySource(
+        media::KeyProviderName(encryption_params.key_provider),
+        [encryption_params]() {
+          return CreateEncryptionKeySource(
+              static_cast<media::FourCC>(encryption_params.protection_scheme),
+              encryption_params);
+        });
+    internal->encryption_key_source.reset(deferred_key_source);
   }
+  auto wait_for_keys = [deferred_key_source, &packaging_params]() {
+    if (!deferred_key_source)
+      return Status::OK;
+    return deferred_key_source->Wait(base::TimeDelta::FromSecondsD(
+        packaging_params.encryption_params.key_fetch_timeout_in_seconds));
+  };
 
   // Update MPD output and HLS output if needed.
   MpdParams mpd_params = packaging_params.mpd_params;
@@ -878,9 +2163,33 @@ Status Packager::Initialize(
       packaging_params.chunking_params.segment_duration_in_seconds;
   mpd_params.target_segment_duration = target_segment_duration;
   hls_params.target_segment_duration = target_segment_duration;
+  mpd_params.publish_time_from_timeline = packaging_params.deterministic_output;
+  if (hls_params.part_target_duration <= 0) {
+    hls_params.part_target_duration =
+        packaging_params.chunking_params.low_latency_chunk_duration_in_seconds;
+  }
 
   // Store callback params to make it available during packaging.
   internal->buffer_callback_params = packaging_params.buffer_callback_params;
+  internal->stats_log_interval_in_seconds =
+      packaging_params.stats_log_interval_in_seconds;
+  internal->metrics_port = packaging_params.metrics_port;
+  internal->metrics_address = packaging_params.metrics_address;
+  internal->origin_port = packaging_params.origin_port;
+  internal->trace_output = packaging_params.trace_output;
+  media::LiveScheduler::GetInstance()->Configure(
+      packaging_params.live_max_lag_in_seconds,
+      packaging_params.degrade_low_priority_outputs);
+  MemoryBudget::GetInstance()->set_limit(
+      packaging_params.memory_budget_in_bytes);
+  HugePageAllocator::Mode huge_page_mode;
+  if (!HugePageAllocator::ParseMode(packaging_params.huge_pages,
+                                    &huge_page_mode)) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Invalid huge_pages '" + packaging_params.huge_pages +
+                      "', should be 'thp' or 'hugetlbfs'.");
+  }
+  HugePageAllocator::GetInstance()->set_mode(huge_page_mode);
   if (internal->buffer_callback_params.write_func) {
     mpd_params.mpd_output = File::MakeCallbackFileName(
         internal->buffer_callback_params, mpd_params.mpd_output);
@@ -902,12 +2211,43 @@ Status Packager::Initialize(
   hls_params.is_independent_segments =
       packaging_params.chunking_params.segment_sap_aligned;
 
+  if (!packaging_params.live_checkpoint_file.empty()) {
+    internal->live_checkpoint.reset(
+        new media::LiveCheckpoint(packaging_params.live_checkpoint_file));
+    RETURN_IF_ERROR(internal->live_checkpoint->Load());
+    internal->live_checkpoint_interval_in_seconds =
+        packaging_params.live_checkpoint_interval_in_seconds > 0
+            ? packaging_params.live_checkpoint_interval_in_seconds
+            : target_segment_duration;
+  }
+
+  if (!packaging_params.manifest_aggregator_url.empty()) {
+    if (mpd_params.mpd_output.empty() &&
+        hls_params.master_playlist_output.empty()) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Publishing the manifest events requires an MPD or an "
+                    "HLS master playlist output.");
+    }
+    internal->manifest_event_publisher.reset(
+        new ManifestEventPublisher(packaging_params.manifest_aggregator_url,
+                                   packaging_params.manifest_node_id));
+  }
+
   if (!mpd_params.mpd_output.empty()) {
     const bool on_demand_dash_profile =
         stream_descriptors.begin()->segment_template.empty();
     const MpdOptions mpd_options =
         media::GetMpdOptions(on_demand_dash_profile, mpd_params);
     internal->mpd_notifier.reset(new SimpleMpdNotifier(mpd_options));
+    if (internal->live_checkpoint) {
+      internal->mpd_notifier = internal->live_checkpoint->WrapMpdNotifier(
+          mpd_options, std::move(internal->mpd_notifier));
+    }
+    if (internal->manifest_event_publisher) {
+      internal->mpd_notifier =
+          internal->manifest_event_publisher->WrapMpdNotifier(
+              mpd_options, std::move(internal->mpd_notifier));
+    }
     if (!internal->mpd_notifier->Init()) {
       LOG(ERROR) << "MpdNotifier failed to initialize.";
       return Status(error::INVALID_ARGUMENT,
@@ -917,61 +2257,144 @@ Status Packager::Initialize(
 
   if (!hls_params.master_playlist_output.empty()) {
     internal->hls_notifier.reset(new hls::SimpleHlsNotifier(hls_params));
+    if (internal->live_checkpoint) {
+      internal->hls_notifier = internal->live_checkpoint->WrapHlsNotifier(
+          std::move(internal->hls_notifier));
+    }
+    if (internal->manifest_event_publisher) {
+      internal->hls_notifier =
+          internal->manifest_event_publisher->WrapHlsNotifier(
+              std::move(internal->hls_notifier));
+    }
   }
 
+  if (internal->live_checkpoint)
+    RETURN_IF_ERROR(internal->live_checkpoint->Restore());
+
   std::unique_ptr<SyncPointQueue> sync_points;
   if (!packaging_params.ad_cue_generator_params.cue_points.empty()) {
     sync_points.reset(
         new SyncPointQueue(packaging_params.ad_cue_generator_params));
   }
-  internal->job_manager.reset(new JobManager(std::move(sync_points)));
+  size_t num_worker_threads = 0;
+  if (packaging_params.num_worker_threads > 0) {
+    num_worker_threads = packaging_params.num_worker_threads;
+  } else if (packaging_params.num_worker_threads < 0) {
+    // hardware_concurrency() may return 0 if it is not computable.
+    num_worker_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  internal->job_manager.reset(
+      new JobManager(std::move(sync_points), num_worker_threads));
+  if (!packaging_params.job_cpu_sets.empty()) {
+    std::vector<std::vector<int>> cpu_sets;
+    for (const std::string& cpu_list : packaging_params.job_cpu_sets) {
+      std::vector<int> cpus;
+      if (!ParseCpuList(cpu_list, &cpus)) {
+        return Status(error::INVALID_ARGUMENT,
+                      "Invalid job CPU set '" + cpu_list + "'.");
+      }
+      cpu_sets.push_back(cpus);
+    }
+    internal->job_manager->set_cpu_sets(cpu_sets);
+  }
 
   std::vector<StreamDescriptor> streams_for_jobs;
+  {
+    base::AutoLock auto_lock(internal->lock);
+    RETURN_IF_ERROR(
+        internal->PrepareStreams(stream_descriptors, &streams_for_jobs));
+    internal->stream_descriptors = stream_descriptors;
+    for (size_t i = 0; i < stream_descriptors.size(); ++i) {
+      internal->input_streams[stream_descriptors[i].input].push_back(
+          streams_for_jobs[i]);
+    }
+  }
 
-  for (const StreamDescriptor& descriptor : stream_descriptors) {
-    // We may need to overwrite some values, so make a copy first.
-    StreamDescriptor copy = descriptor;
+  internal->packaging_params = packaging_params;
+  internal->muxer_factory.reset(new media::MuxerFactory(packaging_params));
+  // The creation times written in the init segments are fixed for
+  // deterministic output.
+  if (packaging_params.test_params.inject_fake_clock ||
+      packaging_params.deterministic_output) {
+    internal->muxer_factory->OverrideClock(&internal->fake_clock);
+  }
+  internal->muxer_factory->SetLiveCheckpoint(internal->live_checkpoint.get());
 
-    if (internal->buffer_callback_params.read_func) {
-      copy.input = File::MakeCallbackFileName(internal->buffer_callback_params,
-                                              descriptor.input);
+  if (packaging_params.async_manifest_updates &&
+      (internal->mpd_notifier || internal->hls_notifier)) {
+    internal->muxer_listener_queue.reset(new media::MuxerListenerQueue);
+  }
+  internal->muxer_listener_factory.reset(new media::MuxerListenerFactory(
+      packaging_params.output_media_info, internal->mpd_notifier.get(),
+      internal->hls_notifier.get(), internal->muxer_listener_queue.get()));
+  internal->muxer_listener_factory->set_media_info_format(
+      media::GetMediaInfoFileFormat(packaging_params));
+
+  if (packaging_params.jit_packaging) {
+    std::vector<PackagerInternal::JitStream>& jit_streams =
+        internal->jit_streams;
+    jit_streams.resize(streams_for_jobs.size());
+    // The inputs are indexed in parallel, each by a single thread as the
+    // streams of an input share its sample index.
+    std::map<std::string, std::vector<size_t>> streams_by_input;
+    for (size_t i = 0; i < streams_for_jobs.size(); ++i) {
+      jit_streams[i].stream = streams_for_jobs[i];
+      streams_by_input[streams_for_jobs[i].input].push_back(i);
     }
-
-    if (internal->buffer_callback_params.write_func) {
-      copy.output = File::MakeCallbackFileName(internal->buffer_callback_params,
-                                               descriptor.output);
-      copy.segment_template = File::MakeCallbackFileName(
-          internal->buffer_callback_params, descriptor.segment_template);
+    std::vector<Status> statuses(streams_for_jobs.size());
+    std::vector<std::thread> indexing_threads;
+    for (const auto& input : streams_by_input) {
+      const std::vector<size_t>& stream_indexes = input.second;
+      indexing_threads.emplace_back([&jit_streams, &statuses, &stream_indexes,
+                                     &packaging_params]() {
+        for (size_t i : stream_indexes) {
+          statuses[i] = media::GetJitSegments(jit_streams[i].stream,
+                                              packaging_params,
+                                              &jit_streams[i].segments);
+        }
+      });
     }
-
-    // Update language to ISO_639_2 code if set.
-    if (!copy.language.empty()) {
-      copy.language = LanguageToISO_639_2(descriptor.language);
-      if (copy.language == "und") {
-        return Status(
-            error::INVALID_ARGUMENT,
-            "Unknown/invalid language specified: " + descriptor.language);
+    for (std::thread& thread : indexing_threads)
+      thread.join();
+    for (const Status& status : statuses)
+      RETURN_IF_ERROR(status);
+
+    for (size_t stream_index = 0; stream_index < jit_streams.size();
+         ++stream_index) {
+      const StreamDescriptor& stream = jit_streams[stream_index].stream;
+      if (!stream.output.empty())
+        internal->jit_files[stream.output] = {stream_index, 0};
+      for (uint32_t i = 0; i < jit_streams[stream_index].segments.size();
+           ++i) {
+        internal->jit_files[media::GetSegmentName(
+            stream.segment_template, 0, i, stream.bandwidth)] = {stream_index,
+                                                                 i};
       }
     }
-
-    streams_for_jobs.push_back(copy);
+    RETURN_IF_ERROR(wait_for_keys());
+    internal_ = std::move(internal);
+    return Status::OK;
   }
 
-  media::MuxerFactory muxer_factory(packaging_params);
-  if (packaging_params.test_params.inject_fake_clock) {
-    muxer_factory.OverrideClock(&internal->fake_clock);
+  if (packaging_params.incremental_packaging) {
+    internal->incremental_packaging.reset(
+        new media::IncrementalPackaging(internal->packaging_params));
+    std::vector<StreamDescriptor> remaining_streams;
+    RETURN_IF_ERROR(internal->incremental_packaging->ReuseUnchangedOutputs(
+        streams_for_jobs, internal->muxer_listener_factory.get(),
+        internal->mpd_notifier.get(), internal->hls_notifier.get(),
+        &remaining_streams));
+    streams_for_jobs.swap(remaining_streams);
   }
 
-  media::MuxerListenerFactory muxer_listener_factory(
-      packaging_params.output_media_info, internal->mpd_notifier.get(),
-      internal->hls_notifier.get());
-
   RETURN_IF_ERROR(media::CreateAllJobs(
       streams_for_jobs, packaging_params, internal->mpd_notifier.get(),
       internal->encryption_key_source.get(),
-      internal->job_manager->sync_points(), &muxer_listener_factory,
-      &muxer_factory, internal->job_manager.get()));
+      internal->job_manager->sync_points(),
+      internal->muxer_listener_factory.get(), internal->muxer_factory.get(),
+      internal->live_checkpoint.get(), internal->job_manager.get()));
 
+  RETURN_IF_ERROR(wait_for_keys());
   internal_ = std::move(internal);
   return Status::OK;
 }
@@ -980,8 +2403,102 @@ Status Packager::Run() {
   if (!internal_)
     return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
 
-  RETURN_IF_ERROR(internal_->job_manager->RunJobs());
+  // The trace is written when Run() returns, whether it succeeds or not.
+  std::unique_ptr<media::ScopedTraceRecording> trace_recording;
+  if (!internal_->trace_output.empty()) {
+    trace_recording.reset(
+        new media::ScopedTraceRecording(internal_->trace_output));
+  }
+
+  std::unique_ptr<media::ScopedHandlerStatsExport> stats_export;
+  // Declared after |stats_export| so it stops serving first.
+  std::unique_ptr<MetricsServer> metrics_server;
+  if (internal_->metrics_port > 0) {
+    stats_export.reset(
+        new media::ScopedHandlerStatsExport(internal_->job_manager.get()));
+    // Registers the allocation metrics before the first allocation.
+    AllocatorStats::GetInstance();
+    metrics_server.reset(new MetricsServer(Metrics::GetInstance()));
+    metrics_server->set_listen_address(internal_->metrics_address);
+    if (!metrics_server->Start(internal_->metrics_port)) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Failed to serve the metrics on port " +
+                        std::to_string(internal_->metrics_port) + ".");
+    }
+  }
+
+  std::unique_ptr<MemoryOriginServer> origin_server;
+  if (internal_->origin_port > 0) {
+    origin_server.reset(
+        new MemoryOriginServer(MemoryOriginServer::kDefaultNumThreads));
+    if (internal_->packaging_params.jit_packaging) {
+      origin_server->set_missing_file_handler(
+          [this](const std::string& file_name) {
+            const Status status = PackageJitFile(kMemoryFilePrefix + file_name);
+            if (!status.ok() && status.error_code() != error::NOT_FOUND)
+              LOG(ERROR) << "Failed to package " << file_name << ": " << status;
+            return status.ok();
+          });
+    }
+    if (!origin_server->Start(internal_->origin_port)) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Failed to serve the memory files on port " +
+                        std::to_string(internal_->origin_port) + ".");
+    }
+  }
 
+  std::unique_ptr<media::ClosureThread> stats_logger;
+  base::WaitableEvent stop_stats_logger(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  if (internal_->stats_log_interval_in_seconds > 0) {
+    stats_logger.reset(new media::ClosureThread(
+        "StatsLogger",
+        base::Bind(&media::LogStatsPeriodically,
+                   base::Unretained(internal_->job_manager.get()),
+                   base::TimeDelta::FromSecondsD(
+                       internal_->stats_log_interval_in_seconds),
+                   base::Unretained(&stop_stats_logger))));
+    stats_logger->Start();
+  }
+  std::unique_ptr<media::ClosureThread> checkpoint_writer;
+  base::WaitableEvent stop_checkpoint_writer(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  if (internal_->live_checkpoint) {
+    checkpoint_writer.reset(new media::ClosureThread(
+        "CheckpointWriter",
+        base::Bind(&media::WriteCheckpointPeriodically,
+                   base::Unretained(internal_->live_checkpoint.get()),
+                   base::TimeDelta::FromSecondsD(
+                       internal_->live_checkpoint_interval_in_seconds),
+                   base::Unretained(&stop_checkpoint_writer))));
+    checkpoint_writer->Start();
+  }
+  Status status;
+  if (internal_->packaging_params.jit_packaging) {
+    // The segments are packaged on request until the session is cancelled.
+    internal_->jit_cancelled.Wait();
+  } else {
+    status = internal_->job_manager->RunJobs();
+  }
+  if (stats_logger) {
+    stop_stats_logger.Signal();
+    stats_logger->Join();
+  }
+  if (checkpoint_writer) {
+    stop_checkpoint_writer.Signal();
+    checkpoint_writer->Join();
+    // The last checkpoint is written even if the session failed or was
+    // cancelled, e.g. to be restarted.
+    const Status checkpoint_status = internal_->live_checkpoint->Write();
+    if (!checkpoint_status.ok())
+      LOG(WARNING) << checkpoint_status;
+  }
+  RETURN_IF_ERROR(status);
+
+  if (internal_->muxer_listener_queue)
+    internal_->muxer_listener_queue->WaitForPostedEvents();
   if (internal_->hls_notifier) {
     if (!internal_->hls_notifier->Flush())
       return Status(error::INVALID_ARGUMENT, "Failed to flush Hls.");
@@ -990,6 +2507,8 @@ Status Packager::Run() {
     if (!internal_->mpd_notifier->Flush())
       return Status(error::INVALID_ARGUMENT, "Failed to flush Mpd.");
   }
+  if (internal_->incremental_packaging)
+    RETURN_IF_ERROR(internal_->incremental_packaging->WriteFingerprints());
   return Status::OK;
 }
 
@@ -999,6 +2518,219 @@ void Packager::Cancel() {
     return;
   }
   internal_->job_manager->CancelJobs();
+  internal_->jit_cancelled.Signal();
+}
+
+Status Packager::PushInputData(
+    const std::string& input,
+    std::shared_ptr<const std::vector<uint8_t>> data) {
+  media::PushInput* push_input = nullptr;
+  RETURN_IF_ERROR(media::GetPushInput(
+      internal_ ? &internal_->push_inputs : nullptr,
+      internal_ ? &internal_->lock : nullptr, input, &push_input));
+  if (!push_input->Push(std::move(data)))
+    return Status(error::STOPPED, "Input " + input + " is no longer read.");
+  return Status::OK;
+}
+
+Status Packager::PushInputData(const std::string& input,
+                               const uint8_t* data,
+                               size_t size) {
+  media::PushInput* push_input = nullptr;
+  RETURN_IF_ERROR(media::GetPushInput(
+      internal_ ? &internal_->push_inputs : nullptr,
+      internal_ ? &internal_->lock : nullptr, input, &push_input));
+  if (!push_input->PushAndWait(data, size))
+    return Status(error::STOPPED, "Input " + input + " is no longer read.");
+  return Status::OK;
+}
+
+Status Packager::EndInput(const std::string& input) {
+  media::PushInput* push_input = nullptr;
+  RETURN_IF_ERROR(media::GetPushInput(
+      internal_ ? &internal_->push_inputs : nullptr,
+      internal_ ? &internal_->lock : nullptr, input, &push_input));
+  push_input->End();
+  return Status::OK;
+}
+
+Status Packager::AddStreams(
+    const std::vector<StreamDescriptor>& stream_descriptors) {
+  if (!internal_)
+    return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
+  const PackagingParams& packaging_params = internal_->packaging_params;
+  // Cue alignment requires all the streams to start together.
+  if (internal_->job_manager->sync_points()) {
+    return Status(error::UNIMPLEMENTED,
+                  "Streams cannot be added to a session with ad cues.");
+  }
+  for (const StreamDescriptor& descriptor : stream_descriptors) {
+    if (descriptor.stream_selector == "text" &&
+        media::GetOutputFormat(descriptor) != media::CONTAINER_MOV) {
+      return Status(error::UNIMPLEMENTED,
+                    "Text streams cannot be added to a running session.");
+    }
+  }
+
+  base::AutoLock auto_lock(internal_->lock);
+  if (internal_->stream_descriptors.begin()->segment_template.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Streams can only be added to live sessions, with segment "
+                  "templates.");
+  }
+  for (const StreamDescriptor& descriptor : stream_descriptors) {
+    if (internal_->input_streams.find(descriptor.input) !=
+        internal_->input_streams.end()) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Input " + descriptor.input +
+                        " is already read by the session.");
+    }
+  }
+  // The outputs and the segment templates are checked against the ones of
+  // the session.
+  std::vector<StreamDescriptor> session_descriptors =
+      internal_->stream_descriptors;
+  session_descriptors.insert(session_descriptors.end(),
+                             stream_descriptors.begin(),
+                             stream_descriptors.end());
+  RETURN_IF_ERROR(
+      media::ValidateParams(packaging_params, session_descriptors));
+
+  std::vector<StreamDescriptor> streams_for_jobs;
+  RETURN_IF_ERROR(
+      internal_->PrepareStreams(stream_descriptors, &streams_for_jobs));
+  std::vector<std::reference_wrapper<const StreamDescriptor>> streams(
+      streams_for_jobs.begin(), streams_for_jobs.end());
+  std::sort(streams.begin(), streams.end(), media::StreamDescriptorCompareFn);
+
+  // The streams start at a segment boundary, so their segments align with
+  // the segments of the other streams.
+  Status status = media::CreateAudioVideoJobs(
+      streams, packaging_params, internal_->encryption_key_source.get(),
+      nullptr, internal_->muxer_listener_factory.get(),
+      internal_->muxer_factory.get(), internal_->live_checkpoint.get(),
+      /* start_at_segment_boundary */ true, internal_->job_manager.get());
+  if (!status.ok()) {
+    internal_->job_manager->DiscardAddedJobs();
+    return status;
+  }
+  RETURN_IF_ERROR(internal_->job_manager->StartAddedJobs());
+
+  internal_->stream_descriptors.insert(internal_->stream_descriptors.end(),
+                                       stream_descriptors.begin(),
+                                       stream_descriptors.end());
+  for (size_t i = 0; i < stream_descriptors.size(); ++i) {
+    internal_->input_streams[stream_descriptors[i].input].push_back(
+        streams_for_jobs[i]);
+  }
+  return Status::OK;
+}
+
+Status Packager::RemoveInput(const std::string& input) {
+  if (!internal_)
+    return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
+  std::vector<StreamDescriptor> streams;
+  media::PushInput* push_input = nullptr;
+  {
+    base::AutoLock auto_lock(internal_->lock);
+    auto iter = internal_->input_streams.find(input);
+    if (iter == internal_->input_streams.end() ||
+        internal_->removed_inputs.count(input) > 0) {
+      return Status(error::NOT_FOUND,
+                    "Input " + input + " is not read by the session.");
+    }
+    internal_->removed_inputs.insert(input);
+    streams = iter->second;
+    auto push_iter = internal_->push_inputs.find(input);
+    if (push_iter != internal_->push_inputs.end())
+      push_input = push_iter->second.get();
+  }
+
+  // The pushes of the input fail from now on.
+  if (push_input)
+    push_input->Close();
+  RETURN_IF_ERROR(internal_->job_manager->RemoveJobs(streams.front().input));
+  // The manifests are updated once the events of the removed streams are
+  // passed on.
+  if (internal_->muxer_listener_queue)
+    internal_->muxer_listener_queue->WaitForPostedEvents();
+
+  // Multiplexed streams share their segment template.
+  std::set<std::string> segment_templates;
+  bool removed = true;
+  for (const StreamDescriptor& stream : streams) {
+    if (!segment_templates.insert(stream.segment_template).second)
+      continue;
+    if (internal_->hls_notifier && !stream.dash_only &&
+        !internal_->hls_notifier->RemoveStream(stream.segment_template)) {
+      removed = false;
+    }
+    if (internal_->mpd_notifier && !stream.hls_only &&
+        !internal_->mpd_notifier->RemoveContainer(stream.segment_template)) {
+      removed = false;
+    }
+  }
+  if (internal_->mpd_notifier && !internal_->mpd_notifier->RequestFlush())
+    removed = false;
+  if (!removed) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Failed to remove the streams of " + input +
+                      " from the manifests.");
+  }
+  return Status::OK;
+}
+
+Status Packager::PackageJitFile(const std::string& file_name) {
+  if (!internal_ || !internal_->packaging_params.jit_packaging) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Not initialized for just in time packaging.");
+  }
+
+  std::pair<size_t, uint32_t> segment;
+  std::shared_ptr<PackagerInternal::JitRequest> request;
+  {
+    base::AutoLock auto_lock(internal_->lock);
+    auto file = internal_->jit_files.find(file_name);
+    if (file == internal_->jit_files.end()) {
+      return Status(error::NOT_FOUND,
+                    "Not packaged just in time: " + file_name);
+    }
+    segment = file->second;
+    auto pending = internal_->jit_requests.find(segment);
+    if (pending != internal_->jit_requests.end()) {
+      request = pending->second;
+      while (!request->done)
+        internal_->jit_segment_packaged.Wait();
+      return request->status;
+    }
+    request = std::make_shared<PackagerInternal::JitRequest>();
+    internal_->jit_requests[segment] = request;
+  }
+
+  const PackagerInternal::JitStream& jit_stream =
+      internal_->jit_streams[segment.first];
+  const Status status = media::PackageJitSegment(
+      jit_stream.stream, jit_stream.segments[segment.second],
+      internal_->packaging_params, internal_->encryption_key_source.get(),
+      internal_->muxer_factory.get());
+
+  base::AutoLock auto_lock(internal_->lock);
+  request->done = true;
+  request->status = status;
+  internal_->jit_requests.erase(segment);
+  internal_->jit_segment_packaged.Broadcast();
+  return status;
+}
+
+std::vector<HandlerStats> Packager::GetStats() const {
+  if (!internal_)
+    return std::vector<HandlerStats>();
+  return internal_->job_manager->GetHandlerStats();
+}
+
+// static
+AllocationStats Packager::GetAllocationStats() {
+  return AllocatorStats::GetInstance()->GetStats();
 }
 
 std::string Packager::GetLibraryVersion() {
@@ -14,12 +14,20 @@
       'type': '<(libpackager_type)',
       'sources': [
         # TODO(kqyang): Clean up the file path.
+        'app/incremental_packaging.cc',
+        'app/incremental_packaging.h',
         'app/job_manager.cc',
         'app/job_manager.h',
         'app/muxer_factory.cc',
         'app/muxer_factory.h',
         'app/libcrypto_threading.cc',
         'app/libcrypto_threading.h',
+        'app/live_checkpoint.cc',
+        'app/live_checkpoint.h',
+        'app/manifest_aggregator.cc',
+        'app/manifest_aggregator.h',
+        'app/manifest_event_publisher.cc',
+        'app/manifest_event_publisher.h',
         'app/packager_util.cc',
         'app/packager_util.h',
         'packager.cc',
@@ -28,6 +36,9 @@
       'dependencies': [
         'file/file.gyp:file',
         'hls/hls.gyp:hls_builder',
+        'hls/hls.gyp:hls_util',
+        'live_checkpoint_proto',
+        'manifest_event_proto',
         'media/chunking/chunking.gyp:chunking',
         'media/codecs/codecs.gyp:codecs',
         'media/crypto/crypto.gyp:crypto',
@@ -42,7 +53,9 @@
         'media/public/public.gyp:public',
         'media/replicator/replicator.gyp:replicator',
         'media/trick_play/trick_play.gyp:trick_play',
+        'metrics/metrics.gyp:metrics',
         'mpd/mpd.gyp:mpd_builder',
+        'mpd/mpd.gyp:mpd_util',
         'third_party/boringssl/boringssl.gyp:boringssl',
         'version/version.gyp:version',
       ],
@@ -77,6 +90,8 @@
         'app/muxer_flags.cc',
         'app/muxer_flags.h',
         'app/packager_main.cc',
+        'app/packager_service.cc',
+        'app/packager_service.h',
         'app/playready_key_encryption_flags.cc',
         'app/playready_key_encryption_flags.h',
         'app/raw_key_encryption_flags.cc',
@@ -97,7 +112,12 @@
       'dependencies': [
         'base/base.gyp:base',
         'file/file.gyp:file',
+        'hls/hls.gyp:hls_builder',
         'libpackager',
+        'media/base/media_base.gyp:media_base',
+        'metrics/metrics.gyp:metrics',
+        'mpd/mpd.gyp:mpd_builder',
+        'packager_service_proto',
         'third_party/gflags/gflags.gyp:gflags',
         'tools/license_notice.gyp:license_notice',
       ],
@@ -109,10 +129,68 @@
         }],
       ],
     },
+    {
+      'target_name': 'live_checkpoint_proto',
+      'type': '<(component)',
+      'sources': ['app/live_checkpoint.proto'],
+      'variables': {
+        'proto_in_dir': 'app',
+        'proto_out_dir': 'packager/app',
+      },
+      'includes': [
+        'protoc.gypi',
+      ],
+    },
+    {
+      'target_name': 'manifest_event_proto',
+      'type': '<(component)',
+      'sources': ['app/manifest_event.proto'],
+      'variables': {
+        'proto_in_dir': 'app',
+        'proto_out_dir': 'packager/app',
+      },
+      'includes': [
+        'protoc.gypi',
+      ],
+    },
+    {
+      'target_name': 'packager_service_proto',
+      'type': '<(component)',
+      'sources': ['app/packager_service.proto'],
+      'variables': {
+        'proto_in_dir': 'app',
+        'proto_out_dir': 'packager/app',
+      },
+      'includes': [
+        'protoc.gypi',
+      ],
+    },
+    {
+      'target_name': 'hls_generator',
+      'type': 'executable',
+      'sources': [
+        'app/hls_generator.cc',
+        'app/hls_generator_flags.h',
+        'app/manifest_generator_util.cc',
+        'app/manifest_generator_util.h',
+        'app/vlog_flags.cc',
+        'app/vlog_flags.h',
+      ],
+      'dependencies': [
+        'base/base.gyp:base',
+        'file/file.gyp:file',
+        'hls/hls.gyp:hls_util',
+        'mpd/mpd.gyp:mpd_util',
+        'third_party/gflags/gflags.gyp:gflags',
+        'tools/license_notice.gyp:license_notice',
+      ],
+    },
     {
       'target_name': 'mpd_generator',
       'type': 'executable',
       'sources': [
+        'app/manifest_generator_util.cc',
+        'app/manifest_generator_util.h',
         'app/mpd_generator.cc',
         'app/mpd_generator_flags.h',
         'app/vlog_flags.cc',
@@ -120,6 +198,8 @@
       ],
       'dependencies': [
         'base/base.gyp:base',
+        'file/file.gyp:file',
+        'hls/hls.gyp:hls_util',
         'mpd/mpd.gyp:mpd_util',
         'third_party/gflags/gflags.gyp:gflags',
         'tools/license_notice.gyp:license_notice',
@@ -129,10 +209,15 @@
       'target_name': 'packager_test',
       'type': '<(gtest_target_type)',
       'sources': [
+        'app/incremental_packaging_unittest.cc',
+        'app/live_checkpoint_unittest.cc',
+        'app/manifest_aggregator_unittest.cc',
         'packager_test.cc',
       ],
       'dependencies': [
         'libpackager',
+        'manifest_event_proto',
+        'mpd/mpd.gyp:mpd_mocks',
         'testing/gmock.gyp:gmock',
         'testing/gtest.gyp:gtest',
         'testing/gtest.gyp:gtest_main',
@@ -198,6 +283,41 @@
         'testing/gtest.gyp:gtest_main',
       ]
     },
+    {
+      # Micro benchmarks of the throughput critical code. Not run as part of
+      # the builder tests.
+      'target_name': 'packager_perftests',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'file/io_cache_perftest.cc',
+        'hls/base/media_playlist_perftest.cc',
+        'media/base/aes_cryptor_perftest.cc',
+        'media/base/producer_consumer_queue_perftest.cc',
+        'media/codecs/nalu_reader_perftest.cc',
+        'media/formats/mp2t/ts_writer_perftest.cc',
+        'media/formats/mp4/box_definitions_perftest.cc',
+        'mpd/base/mpd_builder_perftest.cc',
+        'mpd/test/mpd_builder_test_helper.cc',
+        'mpd/test/mpd_builder_test_helper.h',
+        'mpd/test/xml_compare.cc',
+        'mpd/test/xml_compare.h',
+      ],
+      'dependencies': [
+        'base/base.gyp:base',
+        'file/file.gyp:file',
+        'hls/hls.gyp:hls_builder',
+        'media/base/media_base.gyp:media_base',
+        'media/codecs/codecs.gyp:codecs',
+        'media/formats/mp2t/mp2t.gyp:mp2t',
+        'media/formats/mp4/mp4.gyp:mp4',
+        'media/test/media_test.gyp:media_test_support',
+        'media/test/media_test.gyp:perf_test_support',
+        'mpd/mpd.gyp:mpd_builder',
+        'testing/gmock.gyp:gmock',
+        'testing/gtest.gyp:gtest',
+        'third_party/gflags/gflags.gyp:gflags',
+      ],
+    },
     {
       'target_name': 'packager_builder_tests',
       'type': 'none',
@@ -217,6 +337,7 @@
         'media/formats/webvtt/webvtt.gyp:webvtt_unittest',
         'media/formats/wvm/wvm.gyp:wvm_unittest',
         'media/trick_play/trick_play.gyp:trick_play_unittest',
+        'metrics/metrics.gyp:metrics_unittest',
         'mpd/mpd.gyp:mpd_unittest',
         'packager_test',
         'status_unittest',
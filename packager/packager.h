@@ -7,6 +7,8 @@
 #ifndef PACKAGER_PACKAGER_H_
 #define PACKAGER_PACKAGER_H_
 
+#include <functional>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -14,9 +16,13 @@
 #include "packager/file/public/buffer_callback_params.h"
 #include "packager/hls/public/hls_params.h"
 #include "packager/media/public/ad_cue_generator_params.h"
+#include "packager/media/public/allocation_stats.h"
 #include "packager/media/public/chunking_params.h"
 #include "packager/media/public/crypto_params.h"
+#include "packager/media/public/handler_stats.h"
 #include "packager/media/public/mp4_output_params.h"
+#include "packager/media/public/stream_progress.h"
+#include "packager/media/public/stream_progress.h"
 #include "packager/mpd/public/mpd_params.h"
 #include "packager/status.h"
 
@@ -44,15 +50,206 @@ struct PackagingParams {
   /// audio) timestamps to compensate for possible negative timestamps in the
   /// input.
   uint32_t transport_stream_timestamp_offset_ms = 0;
+  /// If true, the MPEG2-TS streams of an input with the same segment template
+  /// are muxed into a single program of one output, instead of one output
+  /// each. The PES packets of the streams are interleaved by DTS, and the
+  /// segments and the PCR follow the first video stream. The streams must not
+  /// be encrypted, have trick play or ad cues, nor run on asynchronous queues.
+  /// The manifests list the output once, as its first video stream.
+  bool multiplex_ts_streams = false;
+  /// If true, WebM single segment (on-demand) outputs are written in a single
+  /// pass: the space for the Cues is reserved in front of the Clusters,
+  /// estimated from the media duration and the segment duration, instead of
+  /// writing the output to a temporary file first and copying it behind the
+  /// Cues. Falls back to the two-pass output if the output is not seekable or
+  /// the media duration is unknown. If the Cues outgrow the reserved space,
+  /// they are written after the Clusters.
+  bool webm_single_pass_single_segment = false;
   /// Chunking (segmentation) related parameters.
   ChunkingParams chunking_params;
+  /// If non-zero, chunking, encryption and muxing of each audio / video stream
+  /// run on a dedicated thread, decoupled from demuxing through a queue that
+  /// holds up to this many messages. A value of zero runs the whole pipeline
+  /// of an input on a single thread.
+  uint32_t async_queue_capacity = 0;
+  /// If non-zero, each output of a stream, i.e. its muxing chain, runs on a
+  /// dedicated thread fed through a queue that holds up to this many
+  /// messages, so the outputs of a stream are muxed in parallel. A value of
+  /// zero runs the outputs of a stream one after another.
+  uint32_t output_queue_capacity = 0;
+  /// The number of frames from one key frame to the next in the video inputs
+  /// with trick play outputs, which must have a constant frame rate. If
+  /// non-zero, trick play frames are muxed as soon as they are demuxed, with
+  /// durations computed from this interval, instead of being held back until
+  /// the next trick play frame.
+  uint32_t trick_play_key_frame_interval = 0;
+  /// If non-zero, the buffers of the pipeline, e.g. the queued samples, the
+  /// segments being written and the output caches, share a process wide
+  /// budget of this many bytes. The inputs wait while the budget is exceeded
+  /// by data the outputs have yet to write, so slow outputs slow the inputs
+  /// down instead of growing the buffers.
+  uint64_t memory_budget_in_bytes = 0;
+  /// If positive, the live streams are scheduled by their lag behind real
+  /// time, i.e. how much later their segments are published than their
+  /// timestamps warrant: the samples of the streams lagging more than this
+  /// many seconds are encrypted first on the shared worker threads, until
+  /// they catch up to half of it.
+  double live_max_lag_in_seconds = 0;
+  /// If true, the trick play frames are thinned out while a stream which is
+  /// not low priority lags, see `live_max_lag_in_seconds`.
+  bool degrade_low_priority_outputs = false;
+  /// If positive, the statistics returned by Packager::GetStats() are logged
+  /// as a JSON line at this interval, in seconds, while the pipeline runs.
+  double stats_log_interval_in_seconds = 0;
+  /// If non-zero, the packager metrics are served in the Prometheus text
+  /// format at http://<host>:<metrics_port>/metrics while the pipeline runs.
+  uint16_t metrics_port = 0;
+  /// The IPv4 address the metrics are served on, the loopback address by
+  /// default, so that only the local host can scrape them. "0.0.0.0" serves
+  /// them on all the interfaces.
+  std::string metrics_address = "127.0.0.1";
+  /// If non-zero, the memory:// outputs, e.g. the segments and the manifests
+  /// of a live session, are served over HTTP at
+  /// http://<host>:<origin_port>/<name> while the pipeline runs, so the
+  /// packager can be its own origin. Segments are streamed as their chunks
+  /// are written, and LL-HLS blocking playlist reloads are supported.
+  uint16_t origin_port = 0;
+  /// If not empty, spans of the pipeline, e.g. demuxing, encryption, muxing
+  /// and manifest writes, are recorded while the pipeline runs and written to
+  /// this file in the Chrome trace event JSON format, which can be viewed in
+  /// Perfetto or chrome://tracing.
+  std::string trace_output;
+  /// If not empty, the state of a live session, i.e. the live window of its
+  /// manifests, its segment numbering and the shift of its timestamps, is
+  /// checkpointed to this file. A packager restarted with the same streams
+  /// resumes the session from it.
+  std::string live_checkpoint_file;
+  /// Interval, in seconds, at which the live checkpoint is written. Zero
+  /// writes it every segment duration.
+  double live_checkpoint_interval_in_seconds = 0;
+  /// If not empty, the notifier events of the segmented streams, i.e. their
+  /// segments, cues and key updates, are also published to the
+  /// ManifestAggregator at this URL, e.g. http://<host>:<port>/events, which
+  /// builds a single MPD and HLS master playlist for the streams of a live
+  /// channel packaged on several nodes. The MPD or the HLS playlists must be
+  /// generated locally too, e.g. to a scratch location.
+  std::string manifest_aggregator_url;
+  /// Identifies the node in the logs of the aggregator.
+  std::string manifest_node_id;
+  /// If true, the segments and the manifests are derived only from the input
+  /// timeline, so that redundant packagers fed the same input write identical
+  /// bytes whenever they start: the segments start at the segment boundaries
+  /// and are numbered from their start times, the initialization vectors are
+  /// derived from the keys, the streams and the sample timestamps, and the
+  /// times written in the segments and in the MPD are fixed or derived from
+  /// mpd_params.availability_start_time, which must be set for a dynamic MPD.
+  /// Ad cues, subsegments, low latency chunks and live checkpoints are not
+  /// supported.
+  bool deterministic_output = false;
+  /// Maximum number of packaging jobs, i.e. inputs, that run at the same time.
+  /// If there are more jobs, they run on a pool of this many worker threads
+  /// in turn, which is only suitable for inputs that terminate, e.g. VOD. Zero
+  /// runs every job on its own thread. A negative value sizes the pool to the
+  /// hardware concurrency. Segmented text inputs always share a pool of this
+  /// many threads, or of the hardware concurrency if zero, as they are files
+  /// which terminate. Ignored if there are ad cues to align.
+  int32_t num_worker_threads = 0;
+  /// CPU sets, in the Linux cpulist format, e.g. "0-7,16-23", the jobs are
+  /// pinned to. The jobs of an input are pinned to one of the sets, which are
+  /// assigned to the inputs in turn. The sample buffers and the I/O threads of
+  /// a job then stay on the NUMA node of its CPUs. Linux only. Empty leaves
+  /// the placement of the jobs to the operating system.
+  std::vector<std::string> job_cpu_sets;
+  /// Allocate the large, long lived buffers, i.e. the demuxer read buffers,
+  /// the threaded I/O caches and the largest sample buffers, on huge pages:
+  /// "thp" on transparent huge pages, "hugetlbfs" on the huge pages reserved
+  /// in the hugetlbfs pool, or on transparent huge pages if there are not
+  /// enough of them. The byte queues of the parsers are mirrored on Linux,
+  /// which keeps them on regular pages. The buffers which cannot be allocated
+  /// on huge pages are allocated from the heap. Process wide. Linux only.
+  /// Empty allocates all the buffers from the heap.
+  std::string huge_pages;
+  /// Read local input files through memory mapping instead of buffered reads,
+  /// which saves a copy of the input data. Not supported on Windows.
+  bool use_memory_mapped_input = false;
+  /// Demux the tracks of local, non-fragmented MP4 inputs in parallel, one
+  /// thread and one reader per track, when more than one track is packaged.
+  bool parallel_track_demuxing = false;
+  /// Pass the events of the muxers on to the manifest notifiers on a thread
+  /// of their own, so that the muxers do not wait for the manifests to be
+  /// updated. The muxers wait for the pending events when they end.
+  bool async_manifest_updates = false;
+  /// Read the samples of local MP4 inputs from their <input>.sample_index
+  /// sidecar files, if they are up to date, instead of parsing the inputs.
+  /// Otherwise the sidecar files are written for the next runs.
+  bool use_input_sample_index = false;
+  /// If greater than one, an MP4 output with a segment template whose input is
+  /// a local, single track MP4 file with an up to date sample index, see
+  /// use_input_sample_index, is split into up to this many time slices at
+  /// segment boundaries, which are packaged in parallel, each as a job of its
+  /// own. The segments and the manifests are the same as if the output was
+  /// packaged as a whole. Not used with encryption, trick play, ad cues,
+  /// subsegments or low latency chunks.
+  uint32_t num_vod_time_slices = 0;
+  /// If positive, only a time shard of each stream is packaged, so that the
+  /// streams can be packaged on many machines, each packaging a shard: the
+  /// streams are split into up to this many shards at segment boundaries,
+  /// from the sample index of their inputs, see use_input_sample_index, which
+  /// is written if it is missing. The streams split in fewer shards are not
+  /// packaged by the machines of the missing shards. Requires
+  /// output_media_info: the MediaInfo of each shard, named after the output
+  /// of the stream, or its segment template if it has no output, suffixed
+  /// with `.shard<index>.media_info`, records its segments, and mpd_generator
+  /// generates the manifests from the MediaInfo files of all the shards. Only
+  /// MP4 and MPEG-2 TS outputs with segment templates, from local single
+  /// track MP4 inputs, are supported.
+  uint32_t num_vod_time_shards = 0;
+  /// The index of the time shard packaged, less than num_vod_time_shards.
+  uint32_t vod_time_shard_index = 0;
+  /// If true, the streams are not packaged ahead of time. Each segment is
+  /// packaged when it is requested instead, see Packager::PackageJitFile(),
+  /// from the time range of the input in the sample index of the input, see
+  /// use_input_sample_index, which Packager::Initialize() writes if it is
+  /// missing. With origin_port, the missing memory:// outputs are packaged
+  /// when they are requested from the origin, and Packager::Run() serves them
+  /// until Packager::Cancel(). Only MP4 and MPEG-2 TS outputs with $Number$
+  /// segment templates, from local single track MP4 inputs, are supported.
+  /// The manifests are not generated.
+  bool jit_packaging = false;
+  /// Skip the outputs of a VOD job whose input, stream descriptor, chunking,
+  /// encryption and muxer options did not change since the previous run, and
+  /// add them to the manifests from their MediaInfo files, see
+  /// output_media_info, which is required. The outputs of a stream of an input
+  /// are reused together. With an HLS playlist, only the outputs with a
+  /// segment template are reused, as the MediaInfo records their segments.
+  /// Only the outputs of local files are reused.
+  bool incremental_packaging = false;
 
   /// Out of band cuepoint parameters.
   AdCueGeneratorParams ad_cue_generator_params;
 
   /// Create a human readable format of MediaInfo. The output file name will be
-  /// the name specified by output flag, suffixed with `.media_info`.
+  /// the name specified by output flag, suffixed with `.media_info`. The
+  /// MediaInfo of the outputs with a segment template records their segments,
+  /// and is written when the stream ends.
   bool output_media_info = false;
+  /// Write the MediaInfo files above as binary protobuf instead of text,
+  /// which mpd_generator and hls_generator parse much faster for long
+  /// segment lists. They read both formats.
+  bool binary_media_info = false;
+  /// Write a report of the segments of each output, named like the
+  /// MediaInfo, suffixed with `.segments.jsonl`. It has a JSON line per
+  /// segment with its start, duration, size and number of samples, the time
+  /// spent encrypting, muxing and writing it, and the wall clock time at which
+  /// it was published, see SegmentReportMuxerListener.
+  bool output_segment_report = false;
+  /// If set, called about once a second with the progress of each input, as
+  /// it is demuxed, and of each output, as it is muxed: its bytes and media
+  /// seconds processed, the speed relative to real time and, if the duration
+  /// of the media is known, the estimated time left. It is called again when
+  /// the input or the output is complete. It is called from the threads of
+  /// the pipeline, so it must be thread safe and return quickly.
+  std::function<void(const StreamProgress& progress)> progress_callback;
   /// DASH MPD related parameters.
   MpdParams mpd_params;
   /// HLS related parameters.
@@ -71,7 +268,9 @@ struct PackagingParams {
 
 /// Defines a single input/output stream.
 struct StreamDescriptor {
-  /// Input/source media file path or network stream URL. Required.
+  /// Input/source media file path or network stream URL, or "push://<name>"
+  /// for data pushed with Packager::PushInputData(), or "synthetic://..." for
+  /// generated streams, see media::SyntheticInputParams. Required.
   std::string input;
 
   /// Stream selector, can be `audio`, `video`, `text` or a zero based stream
@@ -133,6 +332,22 @@ struct StreamDescriptor {
   bool dash_only = false;
   /// Set to true to indicate that the stream is for hls only.
   bool hls_only = false;
+
+  /// Optional start of the part of the input to package, in seconds on the
+  /// timeline of the input. Each stream starts at its last key frame at or
+  /// before it. Only the part of the input from that key frame is read for
+  /// non-fragmented MP4 inputs and inputs with an up to date sample index,
+  /// see `PackagingParams.use_input_sample_index`.
+  double start_time = 0;
+  /// Optional end of the part of the input to package, in seconds on the
+  /// timeline of the input, excluded. 0 means the end of the input.
+  double end_time = 0;
+
+  /// Set to true to indicate that the stream is low priority in live
+  /// scheduling, see `PackagingParams.live_max_lag_in_seconds`: it is never
+  /// prioritized, and its lag does not degrade the other streams. Trick play
+  /// streams are always low priority.
+  bool low_priority = false;
 };
 
 class SHAKA_EXPORT Packager {
@@ -148,14 +363,88 @@ class SHAKA_EXPORT Packager {
       const PackagingParams& packaging_params,
       const std::vector<StreamDescriptor>& stream_descriptors);
 
+  /// Initialize the packaging pipeline again, with new streams and the
+  /// packaging parameters of the previous Initialize(), e.g. to package the
+  /// next clip with the same packager. The encryption key source of the
+  /// previous session, and so its keys and its key server connection, is
+  /// reused. It must not be called while Run() runs.
+  /// @param stream_descriptors a list of stream descriptors.
+  /// @return OK on success, an appropriate error code on failure, after which
+  ///         the packager has to be initialized with Initialize().
+  Status Reinitialize(const std::vector<StreamDescriptor>& stream_descriptors);
+
   /// Run the pipeline to completion (or failed / been cancelled). Note
-  /// that it blocks until completion.
+  /// that it blocks until completion. With PackagingParams.jit_packaging, it
+  /// serves the origin until it is cancelled.
   /// @return OK on success, an appropriate error code on failure.
   Status Run();
 
   /// Cancel packaging. Note that it has to be called from another thread.
   void Cancel();
 
+  /// Push data to a stream descriptor input of the form "push://<name>",
+  /// which is demuxed as it arrives instead of being read from a file. It is
+  /// called from another thread while Run() runs, and blocks while a few
+  /// buffers of the input are already pending.
+  /// @param input is the input of the stream descriptors, e.g. "push://cam".
+  /// @param data is parsed without being copied, and released once parsed.
+  /// @return OK on success, NOT_FOUND if @a input is not a push input, or
+  ///         STOPPED if the input is ended or no longer read.
+  Status PushInputData(const std::string& input,
+                       std::shared_ptr<const std::vector<uint8_t>> data);
+
+  /// Same as above, for data which belongs to the caller. It blocks until the
+  /// data is parsed, so that it is not copied either.
+  Status PushInputData(const std::string& input,
+                       const uint8_t* data,
+                       size_t size);
+
+  /// Mark the end of a push input, once the data pushed so far is parsed.
+  /// @return OK on success, NOT_FOUND if @a input is not a push input.
+  Status EndInput(const std::string& input);
+
+  /// Add streams to a running live session, e.g. a new rendition, which are
+  /// packaged along with the other streams and added to the manifests. It is
+  /// called from another thread while Run() runs. The first segment of each
+  /// stream starts at a segment boundary of the session, so that it aligns
+  /// with the other streams.
+  /// @param stream_descriptors have segment templates and inputs which are
+  ///        not, and were not, read by the session. Their outputs and segment
+  ///        templates must not be used by the session.
+  /// @return OK on success, an appropriate error code on failure, e.g.
+  ///         UNIMPLEMENTED for text streams or with ad cues.
+  Status AddStreams(const std::vector<StreamDescriptor>& stream_descriptors);
+
+  /// Stop packaging the streams of @a input in a running live session, and
+  /// remove them from the manifests, while the other streams keep running. It
+  /// is called from another thread while Run() runs.
+  /// @param input is the input of the stream descriptors, as passed to
+  ///        Initialize() or AddStreams().
+  /// @return OK on success, NOT_FOUND if @a input is not read by the session.
+  Status RemoveInput(const std::string& input);
+
+  /// Package an output file of a session initialized with
+  /// PackagingParams.jit_packaging, i.e. a segment, or an init segment, which
+  /// is packaged with the first segment. It may be called from several
+  /// threads. Concurrent requests for the same segment wait for it to be
+  /// packaged once.
+  /// @param file_name is a segment name generated from a segment template of
+  ///        the session, or the init segment of an MP4 output.
+  /// @return OK on success, NOT_FOUND if @a file_name is not an output of the
+  ///         session.
+  Status PackageJitFile(const std::string& file_name);
+
+  /// @return The throughput and latency statistics of the handlers of the
+  ///         pipeline. It can be called from another thread while Run() is
+  ///         running.
+  std::vector<HandlerStats> GetStats() const;
+
+  /// @return The memory allocated by the media samples, muxing buffers,
+  ///         manifests and encryption of the packager, and the statistics of
+  ///         the heap allocator of the process. The allocations are process
+  ///         wide, not per instance. It can be called from any thread.
+  static AllocationStats GetAllocationStats();
+
   /// @return The version of the library.
   static std::string GetLibraryVersion();
 
@@ -189,6 +478,14 @@ class SHAKA_EXPORT Packager {
   Packager& operator=(const Packager&) = delete;
 
   struct PackagerInternal;
+
+  // Initializes |internal_|, with the encryption key source of |previous| if
+  // it is not NULL.
+  Status InitializeSession(
+      const PackagingParams& packaging_params,
+      const std::vector<StreamDescriptor>& stream_descriptors,
+      PackagerInternal* previous);
+
   std::unique_ptr<PackagerInternal> internal_;
 };
 
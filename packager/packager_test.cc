@@ -7,6 +7,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "packager/packager.h"
 
 using testing::_;
@@ -23,8 +26,11 @@ namespace shaka {
 namespace {
 
 const char kTestFile[] = "packager/media/test/data/bear-640x360.mp4";
+const char kPushInput[] = "push://bear";
 const char kOutputVideo[] = "output_video.mp4";
 const char kOutputVideoTemplate[] = "output_video_$Number$.m4s";
+const char kOutputVideoTrickPlay[] = "output_video_trick_play.mp4";
+const char kOutputVideoClear[] = "output_video_clear.mp4";
 const char kOutputAudio[] = "output_audio.mp4";
 const char kOutputAudioTemplate[] = "output_audio_$Number$.m4s";
 const char kOutputMpd[] = "output.mpd";
@@ -112,6 +118,111 @@ TEST_F(PackagerTest, Success) {
   ASSERT_EQ(Status::OK, packager.Run());
 }
 
+TEST_F(PackagerTest, GetStats) {
+  Packager packager;
+  EXPECT_TRUE(packager.GetStats().empty());
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  ASSERT_EQ(Status::OK, packager.Run());
+
+  const std::string kChunkerName =
+      std::string("ChunkingHandler:") + kTestFile + ":video";
+  const std::string kMuxerName = "Muxer:" + GetFullPath(kOutputVideo);
+  const std::string kDemuxerName = std::string("Demuxer:") + kTestFile;
+  bool found_chunker = false;
+  bool found_muxer = false;
+  bool found_demuxer = false;
+  for (const HandlerStats& stats : packager.GetStats()) {
+    if (stats.name == kDemuxerName) {
+      found_demuxer = true;
+      // The samples queued until the stream info is known are all pushed.
+      EXPECT_EQ(0u, stats.queued_bytes);
+    } else if (stats.name == kChunkerName) {
+      found_chunker = true;
+      EXPECT_EQ(1u, stats.num_stream_infos);
+      EXPECT_GT(stats.num_media_samples, 0u);
+      EXPECT_GT(stats.sample_bytes, 0u);
+    } else if (stats.name == kMuxerName) {
+      found_muxer = true;
+      EXPECT_GT(stats.num_segment_infos, 0u);
+    }
+  }
+  EXPECT_TRUE(found_chunker);
+  EXPECT_TRUE(found_muxer);
+  EXPECT_TRUE(found_demuxer);
+}
+
+TEST_F(PackagerTest, Reinitialize) {
+  Packager packager;
+  EXPECT_NE(Status::OK, packager.Reinitialize(SetupStreamDescriptors()));
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  ASSERT_EQ(Status::OK, packager.Run());
+
+  std::vector<StreamDescriptor> stream_descriptors = SetupStreamDescriptors();
+  stream_descriptors.pop_back();
+  stream_descriptors[0].output = GetFullPath(kOutputVideoTrickPlay);
+  ASSERT_EQ(Status::OK, packager.Reinitialize(stream_descriptors));
+  ASSERT_EQ(Status::OK, packager.Run());
+
+  // The stats are the ones of the new session.
+  const std::vector<HandlerStats> stats = packager.GetStats();
+  EXPECT_TRUE(std::any_of(stats.begin(), stats.end(),
+                          [this](const HandlerStats& handler_stats) {
+                            return handler_stats.name ==
+                                   "Muxer:" +
+                                       GetFullPath(kOutputVideoTrickPlay);
+                          }));
+  EXPECT_FALSE(std::any_of(stats.begin(), stats.end(),
+                           [this](const HandlerStats& handler_stats) {
+                             return handler_stats.name ==
+                                    "Muxer:" + GetFullPath(kOutputAudio);
+                           }));
+}
+
+TEST_F(PackagerTest, ParallelOutputs) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  packaging_params.output_queue_capacity = 4;
+
+  std::vector<StreamDescriptor> stream_descriptors = SetupStreamDescriptors();
+  StreamDescriptor trick_play_descriptor = stream_descriptors[0];
+  trick_play_descriptor.output = GetFullPath(kOutputVideoTrickPlay);
+  trick_play_descriptor.trick_play_factor = 1;
+  stream_descriptors.push_back(trick_play_descriptor);
+
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(packaging_params, stream_descriptors));
+  ASSERT_EQ(Status::OK, packager.Run());
+}
+
+TEST_F(PackagerTest, SharedChunking) {
+  std::vector<StreamDescriptor> stream_descriptors = SetupStreamDescriptors();
+  StreamDescriptor clear_descriptor = stream_descriptors[0];
+  clear_descriptor.output = GetFullPath(kOutputVideoClear);
+  clear_descriptor.skip_encryption = true;
+  stream_descriptors.push_back(clear_descriptor);
+
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(SetupPackagingParams(), stream_descriptors));
+  ASSERT_EQ(Status::OK, packager.Run());
+
+  // The encrypted and the clear outputs of the video branch after the
+  // chunking.
+  const std::string kVideoLabel = std::string(kTestFile) + ":video";
+  int num_chunkers = 0;
+  int num_encryption_handlers = 0;
+  for (const HandlerStats& stats : packager.GetStats()) {
+    if (stats.name == "ChunkingHandler:" + kVideoLabel)
+      ++num_chunkers;
+    else if (stats.name == "EncryptionHandler:" + kVideoLabel)
+      ++num_encryption_handlers;
+  }
+  EXPECT_EQ(1, num_chunkers);
+  EXPECT_EQ(1, num_encryption_handlers);
+}
+
 TEST_F(PackagerTest, MissingStreamDescriptors) {
   std::vector<StreamDescriptor> stream_descriptors;
   Packager packager;
@@ -266,6 +377,39 @@ TEST_F(PackagerTest, ReadFromBufferFailed) {
   ASSERT_EQ(error::FILE_FAILURE, packager.Run().error_code());
 }
 
+TEST_F(PackagerTest, ReadFromPushInput) {
+  auto stream_descriptors = SetupStreamDescriptors();
+  for (StreamDescriptor& stream_descriptor : stream_descriptors)
+    stream_descriptor.input = kPushInput;
+
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(SetupPackagingParams(), stream_descriptors));
+
+  FILE* file_ptr = fopen(kTestFile, "rb");
+  ASSERT_TRUE(file_ptr);
+  Status push_status;
+  std::thread pusher([&packager, &push_status, file_ptr]() {
+    const size_t kBufferSize = 4096;
+    while (true) {
+      std::shared_ptr<std::vector<uint8_t>> buffer(
+          new std::vector<uint8_t>(kBufferSize));
+      buffer->resize(fread(buffer->data(), 1, kBufferSize, file_ptr));
+      if (buffer->empty())
+        break;
+      push_status = packager.PushInputData(kPushInput, buffer);
+      if (!push_status.ok())
+        return;
+    }
+    push_status = packager.EndInput(kPushInput);
+  });
+
+  ASSERT_EQ(Status::OK, packager.Run());
+  pusher.join();
+  EXPECT_EQ(Status::OK, push_status);
+  fclose(file_ptr);
+}
+
 // TODO(kqyang): Add more tests.
 
 }  // namespace shaka